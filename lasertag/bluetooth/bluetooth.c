@@ -5,223 +5,244 @@
  *      Author: hutch
  */
 
-// DONT COMPILE AND LINK THIS INTO YOUR PROJECT.
-// IT IS ALREADY COMPILED INTO THE LASERTAG LIBRARY.
+// Built as the bluetooth library, which is linked ahead of libzybo so that it
+// takes the place of the older, polled copy of this driver in libzybo.
+//
+// Bytes move between two byte rings and the UARTLite's 16-byte FIFOs a FIFO at
+// a time. When the hardware routes the UART interrupt to the GIC, the
+// interrupt does this: it fires when the receive FIFO stops being empty and
+// when the transmit FIFO empties, so each transmit interrupt refills the whole
+// FIFO. Without the interrupt, bluetooth_poll() does the same from the timer
+// ISR.
 
-#include <Xuartlite.h>
 #include <stdio.h>
+#include <string.h>
 
 #include "bluetooth.h"
 #include "xparameters.h"
+#include "xuartlite.h"
 
-static XUartLite bluetooth_uartInstance; // Handle to the bluetooth UART.
-static XUartLite_Config
-    bluetooth_uartConfig; // Handle to the bluetooth UART config.
+#ifdef XPAR_FABRIC_BLUETOOTH_UARTLITE_0_INTERRUPT_INTR
+#define BLUETOOTH_UART_INTERRUPT_ID                                            \
+  XPAR_FABRIC_BLUETOOTH_UARTLITE_0_INTERRUPT_INTR
+#endif
+
+#ifdef BLUETOOTH_UART_INTERRUPT_ID
+#include "xscugic.h"
+#define BLUETOOTH_UART_INTERRUPT_PRIORITY 0xA0
+#define BLUETOOTH_UART_INTERRUPT_RISING_EDGE 0x3
+#endif
 
-// This implements a dedicated buffer for storing values from the ADC
-// until they are read and processed by detector().
-// adcBuffer_t is similar to a queue.
-#define BLUETOOTH_QUEUE_SIZE 1000
 #define BLUETOOTH_UART_FIFO_SIZE 16
+#define BLUETOOTH_QUEUE_MASK (BLUETOOTH_QUEUE_SIZE - 1)
+#define BLUETOOTH_LINE_SIZE 100
+
+_Static_assert((BLUETOOTH_QUEUE_SIZE & BLUETOOTH_QUEUE_MASK) == 0,
+               "BLUETOOTH_QUEUE_SIZE must be a power of two");
+
+// One side adds bytes and only moves indexIn, the other takes them and only
+// moves indexOut, so the ISR and the caller can share a ring without locking.
+// The indices run freely and are masked when used; their difference is the
+// element count.
 typedef struct {
-  uint16_t indexIn;                   // New values go here.
-  uint16_t indexOut;                  // Pull old values from here.
-  uint8_t data[BLUETOOTH_QUEUE_SIZE]; // Store values here.
-  uint16_t elementCount; // Number of values contained in adcBuffer_t.
-  uint16_t size;         // queue can hold this many elements.
-} bluetooth_queue_t;
-
-static bluetooth_queue_t
-    bluetooth_receiveQueue; // characters read from the bluetooth UART go here.
-static bluetooth_queue_t
-    bluetooth_transmitQueue; // characters that need to be transmitted to the
-                             // bluetooth UART go here.
-
-// Init the q.
-void bluetooth_queueInit(bluetooth_queue_t *q, uint16_t size) {
-  q->indexIn = 0;
-  q->indexOut = 0;
-  q->elementCount = 0;
-  q->size = size;
+  uint8_t data[BLUETOOTH_QUEUE_SIZE];
+  volatile uint16_t indexIn;  // Total bytes ever added.
+  volatile uint16_t indexOut; // Total bytes ever taken.
+} bluetooth_ring_t;
+
+static XUartLite bluetooth_uartInstance; // Handle to the bluetooth UART.
+// Characters read from the bluetooth UART go here.
+static bluetooth_ring_t bluetooth_receiveQueue;
+// Characters that need to be transmitted to the bluetooth UART go here.
+static bluetooth_ring_t bluetooth_transmitQueue;
+static bool bluetooth_interruptDriven;
+
+// Keeps the compiler from moving ring data accesses past an index update.
+// One core, so the CPU itself needs no barrier.
+static inline void bluetooth_compilerBarrier() {
+  __asm__ volatile("" ::: "memory");
 }
 
-// Implemented as a fixed-size circular buffer.
-// indexIn always points to an empty location (by definition).
-// indexOut always points to the oldest element.
-// buffer is empty if indexIn == indexOut. Buffer is full if incremented indexIn
-// == indexOut
-void bluetooth_queuePush(bluetooth_queue_t *q, uint8_t data) {
-  if (q->elementCount <
-      q->size) // Increment the element count unless you are already full.
-    q->elementCount++;
-  q->data[q->indexIn] = data;              // write,
-  q->indexIn = (q->indexIn + 1) % q->size; // then increment.
-  if (q->indexIn ==
-      q->indexOut) { // If you are now pointing at the out pointer,
-    q->indexOut = (q->indexOut + 1) % q->size; // move the out pointer up.
-  }
+static uint16_t bluetooth_ringElementCount(const bluetooth_ring_t *ring) {
+  return (uint16_t)(ring->indexIn - ring->indexOut);
 }
 
-// Removes a single item from the ADC buffer.
-// Does not signal an error if the ADC buffer is currently
-// empty. Simply returns a default value of 0 if the buffer is currently empty.
-uint8_t bluetooth_queuePop(bluetooth_queue_t *q) {
-  uint8_t returnValue = 0;
-  if (q->indexIn == q->indexOut) // Just return 0 if empty.
-    return 0;
-  else {
-    returnValue =
-        q->data[q->indexOut]; // Not empty, get the return value from buffer.
-    q->indexOut = (q->indexOut + 1) % q->size; // increment the out index.
-    q->elementCount--;                         // One less element.
-  }
-  return returnValue;
+static uint16_t bluetooth_ringSpace(const bluetooth_ring_t *ring) {
+  return BLUETOOTH_QUEUE_SIZE - bluetooth_ringElementCount(ring);
 }
 
-// Provides read access to all elements in the ADC buffer.
-// No error messages are provided. In cases of error, a 0 is returned.
-// index = 0 indexes the oldest data in the queue.
-uint32_t bluetooth_queueReadElementAt(bluetooth_queue_t *q, uint32_t index) {
-  // Just return 0 if there if the buffer is empty or not enough elements for
-  // the index.
-  if ((q->indexIn == q->indexOut) || (index + 1 > q->elementCount))
-    return 0;
-  // Otherwise, there are enough elements, just do modulo addressing.
-  return q->data[(q->indexOut + index) % q->size];
+// Copies up to size bytes into ring, in at most two runs. Returns the number
+// copied.
+static uint16_t bluetooth_ringWrite(bluetooth_ring_t *ring, const uint8_t *data,
+                                    uint16_t size) {
+  uint16_t space = bluetooth_ringSpace(ring);
+  uint16_t count = size < space ? size : space;
+  uint16_t start = ring->indexIn & BLUETOOTH_QUEUE_MASK;
+  uint16_t firstRun = BLUETOOTH_QUEUE_SIZE - start;
+  if (firstRun > count)
+    firstRun = count;
+  memcpy(&ring->data[start], data, firstRun);
+  memcpy(ring->data, &data[firstRun], count - firstRun);
+  bluetooth_compilerBarrier();
+  ring->indexIn += count;
+  return count;
 }
 
-// Functional interface to access element count.
-uint16_t bluetooth_queueElementCount(bluetooth_queue_t *q) {
-  return q->elementCount;
+// Copies up to maxSize bytes out of ring, in at most two runs. Returns the
+// number copied.
+static uint16_t bluetooth_ringRead(bluetooth_ring_t *ring, uint8_t *data,
+                                   uint16_t maxSize) {
+  uint16_t available = bluetooth_ringElementCount(ring);
+  uint16_t count = maxSize < available ? maxSize : available;
+  uint16_t start = ring->indexOut & BLUETOOTH_QUEUE_MASK;
+  uint16_t firstRun = BLUETOOTH_QUEUE_SIZE - start;
+  if (firstRun > count)
+    firstRun = count;
+  bluetooth_compilerBarrier();
+  memcpy(data, &ring->data[start], firstRun);
+  memcpy(&data[firstRun], ring->data, count - firstRun);
+  bluetooth_compilerBarrier();
+  ring->indexOut += count;
+  return count;
 }
 
-// Check if the queue is empty.
-bool bluetooth_queueEmpty(bluetooth_queue_t *q) {
-  return (q->indexIn == q->indexOut);
+// Moves what the receive FIFO holds into the receive queue, and refills the
+// transmit FIFO from the transmit queue. Each direction is one XUartLite call
+// of up to a FIFO's worth.
+static void bluetooth_service() {
+  uint8_t chunk[BLUETOOTH_UART_FIFO_SIZE];
+  uint16_t space = bluetooth_ringSpace(&bluetooth_receiveQueue);
+  uint16_t bytesRead = XUartLite_Recv(
+      &bluetooth_uartInstance, chunk,
+      space < BLUETOOTH_UART_FIFO_SIZE ? space : BLUETOOTH_UART_FIFO_SIZE);
+  bluetooth_ringWrite(&bluetooth_receiveQueue, chunk, bytesRead);
+
+  // Send straight from the ring: the bytes up to the wrap point, at most a
+  // FIFO's worth. XUartLite_Send() takes what fits in the FIFO.
+  bluetooth_ring_t *ring = &bluetooth_transmitQueue;
+  uint16_t count = bluetooth_ringElementCount(ring);
+  uint16_t start = ring->indexOut & BLUETOOTH_QUEUE_MASK;
+  if (count > BLUETOOTH_QUEUE_SIZE - start)
+    count = BLUETOOTH_QUEUE_SIZE - start;
+  if (count > BLUETOOTH_UART_FIFO_SIZE)
+    count = BLUETOOTH_UART_FIFO_SIZE;
+  if (count == 0)
+    return;
+  bluetooth_compilerBarrier();
+  ring->indexOut +=
+      XUartLite_Send(&bluetooth_uartInstance, &ring->data[start], count);
 }
 
-// Check if the queue is full.
-bool bluetooth_queueFull(bluetooth_queue_t *q) {
-  return !(q->elementCount < q->size);
+#ifdef BLUETOOTH_UART_INTERRUPT_ID
+// Called by the GIC on the UART interrupt.
+static void bluetooth_uartIsr(__attribute__((unused)) void *callBackRef) {
+  bluetooth_service();
 }
 
-uint16_t bluetooth_queueSize(bluetooth_queue_t *q) { return q->size; }
+// Routes the UART interrupt straight to bluetooth_uartIsr(), which goes into
+// the GIC's handler table next to the ones interrupts_initAll() set up.
+static bool bluetooth_connectInterrupt() {
+  XScuGic_RegisterHandler(XPAR_SCUGIC_0_CPU_BASEADDR,
+                          BLUETOOTH_UART_INTERRUPT_ID,
+                          (Xil_InterruptHandler)bluetooth_uartIsr, NULL);
+  XScuGic_SetPriTrigTypeByDistAddr(XPAR_SCUGIC_0_DIST_BASEADDR,
+                                   BLUETOOTH_UART_INTERRUPT_ID,
+                                   BLUETOOTH_UART_INTERRUPT_PRIORITY,
+                                   BLUETOOTH_UART_INTERRUPT_RISING_EDGE);
+  XScuGic_EnableIntr(XPAR_SCUGIC_0_DIST_BASEADDR, BLUETOOTH_UART_INTERRUPT_ID);
+  XUartLite_EnableInterrupt(&bluetooth_uartInstance);
+  return true;
+}
+#else
+// This hardware does not route the UART interrupt, so bluetooth_poll() has to
+// be called.
+static bool bluetooth_connectInterrupt() { return false; }
+#endif
 
 // Used to initialize any bluetooth data structures.
 // Must be called before accessing any of the bluetooth_ routines.
+// Connects the UART interrupt when the hardware provides one (see
+// bluetooth_isInterruptDriven()).
 int bluetooth_init() {
-  bluetooth_queueInit(&bluetooth_receiveQueue,
-                      BLUETOOTH_QUEUE_SIZE); // init the receive q.
-  bluetooth_queueInit(&bluetooth_transmitQueue,
-                      BLUETOOTH_QUEUE_SIZE); // init the transmit q.
+  bluetooth_receiveQueue.indexIn = bluetooth_receiveQueue.indexOut = 0;
+  bluetooth_transmitQueue.indexIn = bluetooth_transmitQueue.indexOut = 0;
   // Init the bluetooth UART.
-  int status =
-      XUartLite_CfgInitialize(&bluetooth_uartInstance, &bluetooth_uartConfig,
-                              XPAR_BLUETOOTH_UARTLITE_0_BASEADDR);
+  int status = XUartLite_Initialize(&bluetooth_uartInstance,
+                                    XPAR_BLUETOOTH_UARTLITE_0_DEVICE_ID);
   if (status != XST_SUCCESS) {
     printf("bluetooth_init(): Unable to initialize bluetooth UART\n.");
     return BLUETOOTH_INIT_STATUS_FAIL;
   }
+  XUartLite_ResetFifos(&bluetooth_uartInstance);
+  bluetooth_interruptDriven = bluetooth_connectInterrupt();
   return BLUETOOTH_INIT_STATUS_OK;
 }
 
-// Writes data to the bluetooth modem via the bluetooth_UART.
-// Returns the number of characters written.
-// Nonblocking.
-// Can be data or commands. Switch on bluetooth modem board determines whether
-// is interpreted as data or commands.
-uint16_t bluetooth_uartWrite(uint8_t *data, uint16_t size) {
-  return XUartLite_Send(&bluetooth_uartInstance, data, size);
-}
-
-// Reads data from the bluetooth modem via the bluetooth_UART.
-// Returns the number of characters read.
-// Nonblocking.
-uint16_t bluetooth_uartRead(uint8_t *data, uint16_t maxSize) {
-  return XUartLite_Recv(&bluetooth_uartInstance, data, maxSize);
-}
-
 // Reads characters from the bluetooth buffer. Characters are placed in the
 // bluetooth_receiveQueue by reading the bluetooth UART and pushing them into
 // the queue. Will only read upto maxSize characters. Returns the number of
 // characters read.
 uint16_t bluetooth_receiveQueueRead(uint8_t *data, uint16_t maxSize) {
-  uint16_t bytesRead = 0;
-  // Read the characters unless the receive queue empties.
-  for (uint16_t i = 0;
-       i < maxSize && !bluetooth_queueEmpty(&bluetooth_receiveQueue); i++) {
-    data[i] = bluetooth_queuePop(&bluetooth_receiveQueue);
-    bytesRead++;
-  }
-  return bytesRead; // Let the caller know how many bytes were read.
+  return bluetooth_ringRead(&bluetooth_receiveQueue, data, maxSize);
 }
 
 // Writes characters to the bluetooth transmit queue. The characters from the
 // buffer need to be written from the queue to the bluetooth UART. Returns the
 // number of characters written.
 uint16_t bluetooth_transmitQueueWrite(uint8_t *data, uint16_t size) {
-  uint16_t bytesWritten = 0;
-  // Write the characters unless the transmit queue fills up.
-  for (uint16_t i = 0;
-       i < size && !bluetooth_queueFull(&bluetooth_transmitQueue); i++) {
-    bluetooth_queuePush(&bluetooth_transmitQueue, data[i]);
-    bytesWritten++;
+  uint16_t bytesWritten =
+      bluetooth_ringWrite(&bluetooth_transmitQueue, data, size);
+  // The transmit interrupt only comes when the FIFO empties, so if it is
+  // already empty, start it off here. The UART interrupt is held off so the
+  // ISR cannot refill the FIFO at the same time.
+  if (bluetooth_interruptDriven && bytesWritten > 0 &&
+      !XUartLite_IsSending(&bluetooth_uartInstance)) {
+    XUartLite_DisableInterrupt(&bluetooth_uartInstance);
+    bluetooth_service();
+    XUartLite_EnableInterrupt(&bluetooth_uartInstance);
   }
-  return bytesWritten; // Let the caller know how many bytes were written.
+  return bytesWritten;
+}
+
+// Returns the number of bytes bluetooth_transmitQueueWrite() can take right
+// now. Only grows until the next write, so a caller can check it to write a
+// message whole or not at all.
+uint16_t bluetooth_transmitQueueSpace() {
+  return bluetooth_ringSpace(&bluetooth_transmitQueue);
+}
+
+// Returns the number of bytes waiting to be sent.
+uint16_t bluetooth_transmitQueueElementCount() {
+  return bluetooth_ringElementCount(&bluetooth_transmitQueue);
 }
 
+// Returns true if the UART interrupt moves the data, in which case
+// bluetooth_poll() does nothing and need not be called.
+bool bluetooth_isInterruptDriven() { return bluetooth_interruptDriven; }
+
 // Polls the bluetooth for data.
 // Received data from the bluetooth UART are placed in the receive queue.
 // Data in the transmit queue are sent to the bluetooth UART.
 // bluetooth UART only operates at 9600 BAUD, so don't call this more than about
-// every 5 ms or so. Presumed that this will be called in a timer ISR.
+// every 5 ms or so. Presumed that this will be called in a timer ISR. Only
+// needed when there is no UART interrupt; otherwise it returns at once.
 void bluetooth_poll() {
-  // Read characters from the bluetooth UART and copy to the receive queue.
-  uint8_t readData[BLUETOOTH_UART_FIFO_SIZE];
-  // How much room is in the receive queue?
-  uint16_t receiveQueueSpace =
-      bluetooth_queueSize(&bluetooth_receiveQueue) -
-      bluetooth_queueElementCount(&bluetooth_receiveQueue);
-  // Requested number of bytes will be either all the chars in the UART FIFO, or
-  // the available space in the recieve queue.
-  uint16_t requestedReadCount = receiveQueueSpace > BLUETOOTH_UART_FIFO_SIZE
-                                    ? BLUETOOTH_UART_FIFO_SIZE
-                                    : receiveQueueSpace;
-  // Transfer whatever you read to the receive queue.
-  uint16_t bytesRead = bluetooth_uartRead(readData, requestedReadCount);
-  //    if (bytesRead != 0)
-  //        printf("received %d bytes.\n", bytesRead);
-  for (uint16_t i = 0; i < bytesRead; i++) {
-    bluetooth_queuePush(&bluetooth_receiveQueue, readData[i]);
-  }
-  // Read chars from the transmit queue and send them to the bluetooth UART.
-  // Transmit characters one at a time so you won't have to put anything back
-  // into the transmit queue.
-  bool transmitOk =
-      true; // This will be set to false if unable to transmit a byte.
-  uint16_t bytesToTransmit =
-      bluetooth_queueElementCount(&bluetooth_transmitQueue);
-  // Loop will write bytes to the bluetooth UART until the UART is full or all
-  // characters are transmitted.
-  for (uint16_t i = 0; i < bytesToTransmit && transmitOk; i++) {
-    uint8_t transmitData[1]; // Only transmit one byte at a time.
-    transmitData[0] = bluetooth_queueReadElementAt(
-        &bluetooth_transmitQueue, i); // Read the byte to be transmitted.
-    uint8_t bytesWritten =
-        bluetooth_uartWrite(transmitData, 1); // Ask for it to be written.
-    if (bytesWritten == 1) { // Successful if one byte was written.
-      transmitOk = true;
-      bluetooth_queuePop(
-          &bluetooth_transmitQueue); // Successfully written so pop the data off
-                                     // the queue.
-    } else {                         // Not successful, so terminate.
-      transmitOk = false;
-    }
-  }
+  if (!bluetooth_interruptDriven)
+    bluetooth_service();
 }
 
 // Starts an interactive loop that queries the user for input, transmits that
 // input to the bluetooth UART and then prints the result. Useful for
 // configuring the bluetooth modem when in command mode. Terminates if the user
-// types a single "." on a line of input.
-// void bluetooth_interactiveLoop() {}
+// types a single "." on a line of input. Replies are printed before the next
+// line is read.
+void bluetooth_interactiveLoop() {
+  char line[BLUETOOTH_LINE_SIZE];
+  while (fgets(line, sizeof(line), stdin) && strcmp(line, ".\n") != 0) {
+    uint8_t reply[BLUETOOTH_UART_FIFO_SIZE];
+    uint16_t count;
+    while ((count = bluetooth_receiveQueueRead(reply, sizeof(reply))) > 0)
+      fwrite(reply, 1, count, stdout);
+    bluetooth_transmitQueueWrite((uint8_t *)line, strlen(line));
+  }
+}
@@ -14,8 +14,14 @@
 #define BLUETOOTH_INIT_STATUS_FAIL 0
 #define BLUETOOTH_INIT_STATUS_OK 1
 
+// Byte rings between the caller and the UART. A power of two, so wrapping an
+// index is a mask.
+#define BLUETOOTH_QUEUE_SIZE 1024
+
 // Used to initialize any bluetooth data structures.
 // Must be called before accessing any of the bluetooth_ routines.
+// Connects the UART interrupt when the hardware provides one (see
+// bluetooth_isInterruptDriven()).
 int bluetooth_init();
 
 // Reads characters from the bluetooth buffer. Characters are placed in the
@@ -29,11 +35,24 @@ uint16_t bluetooth_receiveQueueRead(uint8_t *data, uint16_t maxSize);
 // number of characters written.
 uint16_t bluetooth_transmitQueueWrite(uint8_t *data, uint16_t size);
 
+// Returns the number of bytes bluetooth_transmitQueueWrite() can take right
+// now. Only grows until the next write, so a caller can check it to write a
+// message whole or not at all.
+uint16_t bluetooth_transmitQueueSpace();
+
+// Returns the number of bytes waiting to be sent.
+uint16_t bluetooth_transmitQueueElementCount();
+
+// Returns true if the UART interrupt moves the data, in which case
+// bluetooth_poll() does nothing and need not be called.
+bool bluetooth_isInterruptDriven();
+
 // Polls the bluetooth for data.
 // Received data from the bluetooth UART are placed in the receive queue.
 // Data in the transmit queue are sent to the bluetooth UART.
 // bluetooth UART only operates at 9600 BAUD, so don't call this more than about
-// every 5 ms or so. Presumed that this will be called in a timer ISR.
+// every 5 ms or so. Presumed that this will be called in a timer ISR. Only
+// needed when there is no UART interrupt; otherwise it returns at once.
 void bluetooth_poll();
 
 // Starts an interactive loop that queries the user for input, transmits that
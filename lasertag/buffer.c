@@ -0,0 +1,66 @@
+#include "buffer.h"
+#include "trace.h"
+#include <stdint.h>
+
+// This implements a dedicated circular buffer for storing values
+// from the ADC until they are read and processed by the detector.
+// The function of the buffer is similar to a queue or FIFO.
+
+// Big enough to hold a third of a second of 100 kHz ADC samples.
+#define BUFFER_SIZE 32768
+
+#define BUFFER_EMPTY_RETURN_VALUE 0
+
+typedef struct {
+    uint32_t indexIn; // Points to the next open slot.
+    uint32_t indexOut; // Points to the next element to be removed.
+    uint32_t elementCount; // Number of elements in the buffer.
+    buffer_data_t data[BUFFER_SIZE]; // Values are stored here.
+} buffer_t;
+
+// The buffer is written by the ISR and read by the detector.
+volatile static buffer_t buf;
+
+// Initialize the buffer to empty.
+void buffer_init(void){
+    buf.indexIn = 0;
+    buf.indexOut = 0;
+    buf.elementCount = 0;
+}
+
+// Add a value to the buffer. Overwrite the oldest value if full.
+void buffer_pushover(buffer_data_t value){
+    //if the buffer is full, drop the oldest element to make room
+    if(buf.elementCount == BUFFER_SIZE){
+        buf.indexOut = (buf.indexOut + 1) % BUFFER_SIZE;
+        buf.elementCount--;
+    }
+    //write the value and advance indexIn, wrapping at the end
+    buf.data[buf.indexIn] = value;
+    buf.indexIn = (buf.indexIn + 1) % BUFFER_SIZE;
+    buf.elementCount++;
+    TRACE_INSTANT(TRACE_ID_ADC_PUSH, buf.elementCount);
+}
+
+// Remove a value from the buffer. Return zero if empty.
+buffer_data_t buffer_pop(void){
+    //guard clause for an empty buffer
+    if(buf.elementCount == 0){
+        return BUFFER_EMPTY_RETURN_VALUE;
+    }
+    //read the oldest value and advance indexOut, wrapping at the end
+    buffer_data_t value = buf.data[buf.indexOut];
+    buf.indexOut = (buf.indexOut + 1) % BUFFER_SIZE;
+    buf.elementCount--;
+    return value;
+}
+
+// Return the number of elements in the buffer.
+uint32_t buffer_elements(void){
+    return buf.elementCount;
+}
+
+// Return the capacity of the buffer in elements.
+uint32_t buffer_size(void){
+    return BUFFER_SIZE;
+}
@@ -0,0 +1,349 @@
+#include "detector.h"
+#include "buffer.h"
+#include "filter.h"
+#include "hitLedTimer.h"
+#include "interrupts.h"
+#include "lockoutTimer.h"
+#include "perfCounters.h"
+#include "profiler.h"
+#include "trace.h"
+#include <stdint.h>
+#include <stdio.h>
+
+// Half of the 12-bit unipolar ADC range. Dividing by this and subtracting 1
+// maps 0:4095 onto -1.0:1.0.
+#define ADC_HALF_SCALE 2047.5
+#define ADC_SCALE_OFFSET 1.0
+
+// Index of the median value once the 10 power values are sorted.
+#define MEDIAN_INDEX (FILTER_FREQUENCY_COUNT / 2)
+
+#define FUDGE_FACTOR_COUNT 6
+#define DEFAULT_FUDGE_FACTOR_INDEX 2
+
+#define DETECTOR_TEST_FUDGE_FACTOR_INDEX DEFAULT_FUDGE_FACTOR_INDEX
+
+// A hit requires the max power to exceed median power * fudge factor.
+static const double fudgeFactors[FUDGE_FACTOR_COUNT] = {10, 20, 50, 100, 200,
+                                                        500};
+
+static uint32_t fudgeFactorIndex = DEFAULT_FUDGE_FACTOR_INDEX;
+
+// Statistics.
+static uint32_t invocationCount;
+static uint32_t sampleCount;
+
+// Counts samples so the FIR filter only runs once per decimation period.
+static uint16_t decimationCount;
+
+// The first power computation must be forced to fill in the running sums.
+static bool forcePowerCompute;
+
+// Latched hit for detector_hitDetected()/detector_clearHit().
+static bool hitDetectedFlag;
+static uint16_t lastHitFrequency;
+
+static bool ignoreAllHitsFlag;
+static bool ignoredFrequencies[FILTER_FREQUENCY_COUNT];
+static detector_hitCount_t hitCounts[FILTER_FREQUENCY_COUNT];
+
+// Hit event queue. Only detector() pushes and the main loop drains it, so no
+// locking is needed.
+static detector_hitEvent_t hitEvents[DETECTOR_HIT_EVENT_QUEUE_SIZE];
+static uint16_t hitEventIndexIn;
+static uint16_t hitEventIndexOut;
+static uint16_t hitEventCount;
+static uint32_t hitEventOverflowCount;
+
+// Profiling scopes for detector() and its stages (see profiler.h).
+PROFILER_SCOPE(detector_profileScope, "detector");
+PROFILER_SCOPE(detector_firProfileScope, "fir");
+PROFILER_SCOPE(detector_iirProfileScope, "iir");
+PROFILER_SCOPE(detector_powerProfileScope, "power");
+PROFILER_SCOPE(detector_hitCheckProfileScope, "hitCheck");
+
+// Hardware event counts for the filter stages (see perfCounters.h).
+PERF_COUNTERS_STAGE(detector_firStage, "fir");
+PERF_COUNTERS_STAGE(detector_iirStage, "iir");
+PERF_COUNTERS_STAGE(detector_powerStage, "power");
+
+// Initialize the detector module.
+// By default, all frequencies are considered for hits.
+// Assumes the filter module is initialized previously.
+void detector_init(void){
+    invocationCount = 0;
+    sampleCount = 0;
+    decimationCount = 0;
+    forcePowerCompute = true;
+    hitDetectedFlag = false;
+    lastHitFrequency = 0;
+    ignoreAllHitsFlag = false;
+    fudgeFactorIndex = DEFAULT_FUDGE_FACTOR_INDEX;
+    for(uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++){
+        ignoredFrequencies[i] = false;
+        hitCounts[i] = 0;
+    }
+    hitEventIndexIn = 0;
+    hitEventIndexOut = 0;
+    hitEventCount = 0;
+    hitEventOverflowCount = 0;
+}
+
+// freqArray is indexed by frequency number. If an element is set to true,
+// the frequency will be ignored. Multiple frequencies can be ignored.
+// Your shot frequency (based on the switches) is a good choice to ignore.
+void detector_setIgnoredFrequencies(bool freqArray[]){
+    for(uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++){
+        ignoredFrequencies[i] = freqArray[i];
+    }
+}
+
+// Adds a record to the hit event queue. If the queue is full the record is
+// dropped and counted so the consumer can tell it fell behind.
+static void detector_pushHitEvent(uint16_t frequencyNumber, double peakPower,
+                                  double powerRatio){
+    if(hitEventCount == DETECTOR_HIT_EVENT_QUEUE_SIZE){
+        hitEventOverflowCount++;
+        return;
+    }
+    detector_hitEvent_t *event = &hitEvents[hitEventIndexIn];
+    event->sampleIndex = sampleCount;
+    event->frequencyNumber = frequencyNumber;
+    event->peakPower = peakPower;
+    event->powerRatio = powerRatio;
+    hitEventIndexIn = (hitEventIndexIn + 1) % DETECTOR_HIT_EVENT_QUEUE_SIZE;
+    hitEventCount++;
+}
+
+// Runs the hit-detection algorithm on the current power values.
+// Returns true if the max power exceeds median power * fudge factor.
+// The winning frequency, its power and the peak/median ratio are returned
+// through the pointer arguments. Has no other side effects.
+static bool detector_hitAlgorithm(uint16_t *frequencyNumber, double *peakPower,
+                                  double *powerRatio){
+    double sorted[FILTER_FREQUENCY_COUNT];
+    uint16_t maxIndex = 0;
+    filter_getCurrentPowerValues(sorted);
+    //find the max before sorting scrambles the indices
+    for(uint16_t i = 1; i < FILTER_FREQUENCY_COUNT; i++){
+        if(sorted[i] > sorted[maxIndex]){
+            maxIndex = i;
+        }
+    }
+    *frequencyNumber = maxIndex;
+    *peakPower = sorted[maxIndex];
+    //insertion sort is plenty fast for 10 values
+    for(uint16_t i = 1; i < FILTER_FREQUENCY_COUNT; i++){
+        double value = sorted[i];
+        int16_t j = i - 1;
+        while(j >= 0 && sorted[j] > value){
+            sorted[j + 1] = sorted[j];
+            j--;
+        }
+        sorted[j + 1] = value;
+    }
+    double median = sorted[MEDIAN_INDEX];
+    *powerRatio = (median > 0) ? *peakPower / median : 0;
+    return *peakPower > median * fudgeFactors[fudgeFactorIndex];
+}
+
+// Checks the current power values for a hit and records it if found.
+static void detector_checkForHit(){
+    uint16_t frequencyNumber;
+    double peakPower;
+    double powerRatio;
+    if(!detector_hitAlgorithm(&frequencyNumber, &peakPower, &powerRatio)){
+        return;
+    }
+    if(ignoredFrequencies[frequencyNumber]){
+        return;
+    }
+    lockoutTimer_start();
+    hitLedTimer_start();
+    hitCounts[frequencyNumber]++;
+    hitDetectedFlag = true;
+    lastHitFrequency = frequencyNumber;
+    detector_pushHitEvent(frequencyNumber, peakPower, powerRatio);
+    TRACE_INSTANT(TRACE_ID_HIT, frequencyNumber);
+}
+
+// Runs the entire detector: decimating FIR-filter, IIR-filters,
+// power-computation, hit-detection. If interruptsCurrentlyEnabled = true,
+// interrupts are running. If interruptsCurrentlyEnabled = false you can pop
+// values from the ADC buffer without disabling interrupts. If
+// interruptsCurrentlyEnabled = true, do the following:
+// 1. disable interrupts.
+// 2. pop the value from the ADC buffer.
+// 3. re-enable interrupts.
+// Ignore hits on frequencies specified with detector_setIgnoredFrequencies().
+// Assumption: draining the ADC buffer occurs faster than it can fill.
+void detector(bool interruptsCurrentlyEnabled){
+    PROFILER_BEGIN(detector_profileScope);
+    invocationCount++;
+    //only process what is in the buffer now so the call is bounded
+    uint32_t elementCount = buffer_elements();
+    TRACE_BEGIN(TRACE_ID_DETECTOR, elementCount);
+    for(uint32_t i = 0; i < elementCount; i++){
+        if(interruptsCurrentlyEnabled){
+            interrupts_disableArmInts();
+        }
+        buffer_data_t rawAdcValue = buffer_pop();
+        if(interruptsCurrentlyEnabled){
+            interrupts_enableArmInts();
+        }
+        sampleCount++;
+        filter_addNewInput(rawAdcValue / ADC_HALF_SCALE - ADC_SCALE_OFFSET);
+        decimationCount++;
+        if(decimationCount < FILTER_FIR_DECIMATION_FACTOR){
+            continue;
+        }
+        decimationCount = 0;
+        //run all of the filters and update the power values
+        PROFILER_BEGIN(detector_firProfileScope);
+        PERF_COUNTERS_BEGIN(detector_firStage);
+        TRACE_BEGIN(TRACE_ID_FIR, 0);
+        filter_firFilter();
+        TRACE_END(TRACE_ID_FIR, 0);
+        PERF_COUNTERS_END(detector_firStage);
+        PROFILER_END(detector_firProfileScope);
+        // All the IIR filters, then all the powers, so each stage is timed
+        // once per decimated sample rather than once per frequency.
+        PROFILER_BEGIN(detector_iirProfileScope);
+        PERF_COUNTERS_BEGIN(detector_iirStage);
+        TRACE_BEGIN(TRACE_ID_IIR, 0);
+        for(uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++){
+            filter_iirFilter(f);
+        }
+        TRACE_END(TRACE_ID_IIR, 0);
+        PERF_COUNTERS_END(detector_iirStage);
+        PROFILER_END(detector_iirProfileScope);
+        PROFILER_BEGIN(detector_powerProfileScope);
+        PERF_COUNTERS_BEGIN(detector_powerStage);
+        TRACE_BEGIN(TRACE_ID_POWER, 0);
+        for(uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++){
+            filter_computePower(f, forcePowerCompute, false);
+        }
+        TRACE_END(TRACE_ID_POWER, 0);
+        PERF_COUNTERS_END(detector_powerStage);
+        PROFILER_END(detector_powerProfileScope);
+        forcePowerCompute = false;
+        if(!lockoutTimer_running() && !ignoreAllHitsFlag){
+            PROFILER_BEGIN(detector_hitCheckProfileScope);
+            detector_checkForHit();
+            PROFILER_END(detector_hitCheckProfileScope);
+        }
+    }
+    TRACE_END(TRACE_ID_DETECTOR, elementCount);
+    PROFILER_END(detector_profileScope);
+}
+
+// Returns true if a hit was detected.
+bool detector_hitDetected(void){
+    return hitDetectedFlag;
+}
+
+// Returns the frequency number that caused the hit.
+uint16_t detector_getFrequencyNumberOfLastHit(void){
+    return lastHitFrequency;
+}
+
+// Clear the detected hit once you have accounted for it.
+void detector_clearHit(void){
+    hitDetectedFlag = false;
+}
+
+// Copies up to maxEvents queued hit records, oldest first, into events[] and
+// removes them from the queue. Returns the number of records copied.
+// Call from the same context as detector().
+uint16_t detector_getHitEvents(detector_hitEvent_t events[],
+                               uint16_t maxEvents){
+    uint16_t copied = 0;
+    while(copied < maxEvents && hitEventCount > 0){
+        events[copied] = hitEvents[hitEventIndexOut];
+        hitEventIndexOut = (hitEventIndexOut + 1) % DETECTOR_HIT_EVENT_QUEUE_SIZE;
+        hitEventCount--;
+        copied++;
+    }
+    return copied;
+}
+
+// Returns the number of hit records waiting in the event queue.
+uint16_t detector_getHitEventCount(void){
+    return hitEventCount;
+}
+
+// Returns the number of hit records dropped because the event queue was full.
+uint32_t detector_getHitEventOverflowCount(void){
+    return hitEventOverflowCount;
+}
+
+// Returns the number of ADC samples processed since detector_init().
+uint32_t detector_getSampleCount(void){
+    return sampleCount;
+}
+
+// Ignore all hits. Used to provide some limited invincibility in some game
+// modes. The detector will ignore all hits if the flag is true, otherwise will
+// respond to hits normally.
+void detector_ignoreAllHits(bool flagValue){
+    ignoreAllHitsFlag = flagValue;
+}
+
+// Get the current hit counts.
+// Copy the current hit counts into the user-provided hitArray
+// using a for-loop.
+void detector_getHitCounts(detector_hitCount_t hitArray[]){
+    for(uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++){
+        hitArray[i] = hitCounts[i];
+    }
+}
+
+// Allows the fudge-factor index to be set externally from the detector.
+// The actual values for fudge-factors is stored in an array found in detector.c
+void detector_setFudgeFactorIndex(uint32_t factor){
+    if(factor < FUDGE_FACTOR_COUNT){
+        fudgeFactorIndex = factor;
+    }
+}
+
+// Returns the detector invocation count.
+// The count is incremented each time detector is called.
+// Used for run-time statistics.
+uint32_t detector_getInvocationCount(void){
+    return invocationCount;
+}
+
+/******************************************************
+******************** Test Routines ********************
+******************************************************/
+
+// Power values that should register a hit on frequency 3.
+static const double hitPowerValues[FILTER_FREQUENCY_COUNT] = {
+    20, 30, 40, 9000, 35, 25, 40, 30, 20, 15};
+
+// Power values that should not register a hit.
+static const double noHitPowerValues[FILTER_FREQUENCY_COUNT] = {
+    20, 30, 40, 600, 35, 25, 40, 30, 20, 15};
+
+// Create two sets of power values and call your hit detection algorithm
+// on each set. With the same fudge factor, your hit detect algorithm
+// should detect a hit on the first set and not detect a hit on the second.
+void detector_runTest(void){
+    uint16_t frequencyNumber;
+    double peakPower;
+    double powerRatio;
+    printf("******** detector_runTest() ********\n");
+    detector_setFudgeFactorIndex(DETECTOR_TEST_FUDGE_FACTOR_INDEX);
+    for(uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++){
+        filter_setCurrentPowerValue(i, hitPowerValues[i]);
+    }
+    bool hit = detector_hitAlgorithm(&frequencyNumber, &peakPower, &powerRatio);
+    printf("hit set: %s (frequency %d, ratio %.1f)\n",
+           hit ? "PASSED" : "FAILED", frequencyNumber, powerRatio);
+    for(uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++){
+        filter_setCurrentPowerValue(i, noHitPowerValues[i]);
+    }
+    hit = detector_hitAlgorithm(&frequencyNumber, &peakPower, &powerRatio);
+    printf("no-hit set: %s (ratio %.1f)\n", hit ? "FAILED" : "PASSED",
+           powerRatio);
+}
@@ -16,6 +16,23 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 typedef uint16_t detector_hitCount_t;
 
+// Number of hit records the event queue can hold before it overflows.
+#define DETECTOR_HIT_EVENT_QUEUE_SIZE 32
+
+// One record per detected hit. Hits are queued so a slow main loop does not
+// lose or coalesce them.
+typedef struct {
+  // Number of ADC samples processed by the detector when the hit was detected.
+  // Samples arrive at 100 kHz, so this doubles as a 10 us timestamp.
+  uint32_t sampleIndex;
+  // Frequency number that caused the hit.
+  uint16_t frequencyNumber;
+  // Power of the winning frequency.
+  double peakPower;
+  // Peak power divided by the median power of all frequencies.
+  double powerRatio;
+} detector_hitEvent_t;
+
 // Initialize the detector module.
 // By default, all frequencies are considered for hits.
 // Assumes the filter module is initialized previously.
@@ -47,6 +64,21 @@ uint16_t detector_getFrequencyNumberOfLastHit(void);
 // Clear the detected hit once you have accounted for it.
 void detector_clearHit(void);
 
+// Copies up to maxEvents queued hit records, oldest first, into events[] and
+// removes them from the queue. Returns the number of records copied.
+// Call from the same context as detector().
+uint16_t detector_getHitEvents(detector_hitEvent_t events[],
+                               uint16_t maxEvents);
+
+// Returns the number of hit records waiting in the event queue.
+uint16_t detector_getHitEventCount(void);
+
+// Returns the number of hit records dropped because the event queue was full.
+uint32_t detector_getHitEventOverflowCount(void);
+
+// Returns the number of ADC samples processed since detector_init().
+uint32_t detector_getSampleCount(void);
+
 // Ignore all hits. Used to provide some limited invincibility in some game
 // modes. The detector will ignore all hits if the flag is true, otherwise will
 // respond to hits normally.
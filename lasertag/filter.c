@@ -40,6 +40,9 @@
 // static array to store the power output of each bandpass filter
 static double currentPowerValue[POWER_SIZE];
 
+// oldest outputQueue value used by the last power computation of each filter
+static double oldestPowerValue[POWER_SIZE];
+
 // xQueue to store input from receiver board
 static queue_t xQueue;
 
@@ -219,7 +222,7 @@ void outputQueues_init(){
                 break;
         }
         queue_init(&outputQueues[i], OUTPUTQUEUE_SIZE, name);
-        for(uint8_t j = 0; j < OUTPUTQUEUE_SIZE; j++){
+        for(uint32_t j = 0; j < OUTPUTQUEUE_SIZE; j++){
             queue_overwritePush(&outputQueues[i], QUEUE_INIT_VALUE);
         }
     }
@@ -260,11 +263,11 @@ double filter_iirFilter(uint16_t filterNumber){
     queue_data_t term_2 = 0;
     //calculate term 1
     for(uint8_t i = 0; i < YQUEUE_SIZE; i++){
-        term_1 = IIR_B_Coefficients[filterNumber][i] * queue_readElementAt(&yQueue, i);
+        term_1 += IIR_B_Coefficients[filterNumber][i] * queue_readElementAt(&yQueue, YQUEUE_SIZE - 1 - i);
     }
     //calculate term 2
     for(uint8_t i = 0; i < ZQUEUE_SIZE; i++){
-        term_2 = IIR_A_Coefficients[filterNumber][i+1] * queue_readElementAt(&zQueues[filterNumber], i);
+        term_2 += IIR_A_Coefficients[filterNumber][i+1] * queue_readElementAt(&zQueues[filterNumber], ZQUEUE_SIZE - 1 - i);
     }
     //output is difference of term 1 and term 2
     output = term_1 - term_2;
@@ -298,6 +301,7 @@ double filter_computePower(uint16_t filterNumber, bool forceComputeFromScratch,
             double voltage = queue_readElementAt(outputQueue, i);
             power += voltage*voltage;
         }
+        oldestPowerValue[filterNumber] = queue_readElementAt(outputQueue, 0);
         filter_setCurrentPowerValue(filterNumber, power);
         return power;
     }
@@ -305,15 +309,18 @@ double filter_computePower(uint16_t filterNumber, bool forceComputeFromScratch,
     //1. Keep track of the power computed in previous run
     queue_data_t prev_power = filter_getCurrentPowerValue(filterNumber);
 
-    //2. Keep track of the oldest outputQueue value used in previous run
-    queue_data_t oldest_value = queue_readElementAt(outputQueue, outputQueue->indexOut);
+    //2. The oldest value used in the previous run has since been pushed out
+    queue_data_t oldest_value = oldestPowerValue[filterNumber];
     
     //3. Get the newest value from the output queue
-    queue_data_t newest_value = queue_readElementAt(outputQueue,outputQueue->indexIn);
+    queue_data_t newest_value = queue_readElementAt(outputQueue, OUTPUTQUEUE_SIZE - 1);
 
     //4. compute new_power
     power = prev_power - (oldest_value * oldest_value) + (newest_value * newest_value);
 
+    // remember the oldest value used in this run for the next one
+    oldestPowerValue[filterNumber] = queue_readElementAt(outputQueue, 0);
+
     // set power value for this filternumber
     filter_setCurrentPowerValue(filterNumber, power);
     return power;
@@ -16,6 +16,13 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 // Uncomment to run continuous/shooter mode, Milestone 3, Task 3
 // #define RUNNING_MODE_M3_T3
 
+// Uncomment to find how far the sample rate can be raised before the detector
+// falls behind
+// #define RUNNING_MODE_SAMPLE_RATE_STRESS
+
+// Uncomment to record raw ADC samples and stream them to the host
+// #define RUNNING_MODE_ADC_CAPTURE
+
 // Uncomment to run two-player mode, Milestone 5
 // #define RUNNING_MODE_M5
 
@@ -92,6 +99,14 @@ int main() {
   }
 #endif
 
+#ifdef RUNNING_MODE_SAMPLE_RATE_STRESS
+  runningModes_sampleRateStress();
+#endif
+
+#ifdef RUNNING_MODE_ADC_CAPTURE
+  runningModes_captureRawAdcValues();
+#endif
+
 #ifdef RUNNING_MODE_M5
   // No printf here since board not likely connected to host with USB
   game_twoTeamTag();
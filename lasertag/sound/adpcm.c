@@ -0,0 +1,194 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "adpcm.h"
+
+#define STEP_INDEX_MAX 88
+#define NIBBLE_MASK 0x0F
+#define NIBBLE_BITS 4
+#define NIBBLE_SIGN_BIT 0x08
+#define NIBBLE_STEP_BIT 0x04
+#define NIBBLE_HALF_STEP_BIT 0x02
+#define NIBBLE_QUARTER_STEP_BIT 0x01
+#define BYTE_MASK 0xFF
+#define BITS_PER_BYTE 8
+
+// Standard IMA-ADPCM tables.
+static const int8_t indexTable[16] = {-1, -1, -1, -1, 2, 4, 6, 8,
+                                      -1, -1, -1, -1, 2, 4, 6, 8};
+
+static const int16_t stepTable[STEP_INDEX_MAX + 1] = {
+    7,     8,     9,     10,    11,    12,    13,    14,    16,    17,
+    19,    21,    23,    25,    28,    31,    34,    37,    41,    45,
+    50,    55,    60,    66,    73,    80,    88,    97,    107,   118,
+    130,   143,   157,   173,   190,   209,   230,   253,   279,   307,
+    337,   371,   408,   449,   494,   544,   598,   658,   724,   796,
+    876,   963,   1060,  1166,  1282,  1411,  1552,  1707,  1878,  2066,
+    2272,  2499,  2749,  3024,  3327,  3660,  4026,  4428,  4871,  5358,
+    5894,  6484,  7132,  7845,  8630,  9493,  10442, 11487, 12635, 13899,
+    15289, 16818, 18500, 20350, 22385, 24623, 27086, 29794, 32767};
+
+// Applies one nibble to the predictor and step index. Shared by the encoder
+// and decoder so they always agree.
+static inline void applyNibble(int16_t *predictor, uint8_t *stepIndex,
+                               uint8_t nibble) {
+  int32_t step = stepTable[*stepIndex];
+  int32_t difference = step >> 3;
+  if (nibble & NIBBLE_STEP_BIT)
+    difference += step;
+  if (nibble & NIBBLE_HALF_STEP_BIT)
+    difference += step >> 1;
+  if (nibble & NIBBLE_QUARTER_STEP_BIT)
+    difference += step >> 2;
+  int32_t value = *predictor;
+  value += (nibble & NIBBLE_SIGN_BIT) ? -difference : difference;
+  if (value > INT16_MAX)
+    value = INT16_MAX;
+  else if (value < INT16_MIN)
+    value = INT16_MIN;
+  *predictor = (int16_t)value;
+  int16_t index = *stepIndex + indexTable[nibble];
+  if (index < 0)
+    index = 0;
+  else if (index > STEP_INDEX_MAX)
+    index = STEP_INDEX_MAX;
+  *stepIndex = (uint8_t)index;
+}
+
+// Picks the nibble that best moves predictor towards sample.
+static uint8_t chooseNibble(int16_t predictor, uint8_t stepIndex,
+                            int16_t sample) {
+  int32_t step = stepTable[stepIndex];
+  int32_t difference = (int32_t)sample - predictor;
+  uint8_t nibble = 0;
+  if (difference < 0) {
+    nibble = NIBBLE_SIGN_BIT;
+    difference = -difference;
+  }
+  if (difference >= step) {
+    nibble |= NIBBLE_STEP_BIT;
+    difference -= step;
+  }
+  step >>= 1;
+  if (difference >= step) {
+    nibble |= NIBBLE_HALF_STEP_BIT;
+    difference -= step;
+  }
+  step >>= 1;
+  if (difference >= step)
+    nibble |= NIBBLE_QUARTER_STEP_BIT;
+  return nibble;
+}
+
+// Returns the number of bytes needed to encode sampleCount samples.
+uint32_t adpcm_getEncodedByteCount(uint32_t sampleCount) {
+  uint32_t fullBlocks = sampleCount / ADPCM_SAMPLES_PER_BLOCK;
+  uint32_t remainder = sampleCount % ADPCM_SAMPLES_PER_BLOCK;
+  uint32_t bytes = fullBlocks * ADPCM_BLOCK_BYTES;
+  if (remainder) // Header plus the remaining samples, two per byte.
+    bytes += ADPCM_BLOCK_HEADER_BYTES + remainder / 2;
+  return bytes;
+}
+
+// Encodes sampleCount samples into encoded, which must hold
+// adpcm_getEncodedByteCount(sampleCount) bytes.
+void adpcm_encode(const int16_t samples[], uint32_t sampleCount,
+                  uint8_t encoded[]) {
+  uint8_t stepIndex = 0; // Carried from block to block.
+  uint32_t i = 0;
+  while (i < sampleCount) {
+    // The header restarts the predictor at the actual sample.
+    int16_t predictor = samples[i++];
+    *encoded++ = (uint16_t)predictor & BYTE_MASK;
+    *encoded++ = (uint16_t)predictor >> BITS_PER_BYTE;
+    *encoded++ = stepIndex;
+    *encoded++ = 0;
+    uint32_t blockEnd = i + ADPCM_SAMPLES_PER_BLOCK - 1;
+    if (blockEnd > sampleCount)
+      blockEnd = sampleCount;
+    bool highNibble = false;
+    for (; i < blockEnd; i++) {
+      uint8_t nibble = chooseNibble(predictor, stepIndex, samples[i]);
+      applyNibble(&predictor, &stepIndex, nibble);
+      if (highNibble)
+        *encoded++ |= nibble << NIBBLE_BITS;
+      else
+        *encoded = nibble;
+      highNibble = !highNibble;
+    }
+    if (highNibble) // Odd sample count; the high nibble is padding.
+      encoded++;
+  }
+}
+
+// Starts decoding sampleCount samples from data.
+void adpcm_initDecoder(adpcm_decoder_t *decoder, const uint8_t *data,
+                       uint32_t sampleCount) {
+  decoder->data = data;
+  decoder->samplesRemaining = sampleCount;
+  decoder->blockSamplesLeft = 0;
+  decoder->predictor = 0;
+  decoder->stepIndex = 0;
+  decoder->highNibbleNext = false;
+}
+
+// Returns true once every sample has been decoded.
+bool adpcm_isDone(const adpcm_decoder_t *decoder) {
+  return decoder->samplesRemaining == 0;
+}
+
+// Decodes up to maxSamples samples into samples and returns how many were
+// decoded (fewer only at the end of the stream).
+uint32_t adpcm_decode(adpcm_decoder_t *decoder, int16_t samples[],
+                      uint32_t maxSamples) {
+  // Work on local copies so the compiler can keep the state in registers.
+  const uint8_t *data = decoder->data;
+  int16_t predictor = decoder->predictor;
+  uint8_t stepIndex = decoder->stepIndex;
+  bool highNibbleNext = decoder->highNibbleNext;
+  uint16_t blockSamplesLeft = decoder->blockSamplesLeft;
+  if (maxSamples > decoder->samplesRemaining)
+    maxSamples = decoder->samplesRemaining;
+
+  for (uint32_t i = 0; i < maxSamples; i++) {
+    if (blockSamplesLeft == 0) {
+      // Block header: the first sample is stored as is.
+      predictor = (int16_t)(data[0] | (data[1] << BITS_PER_BYTE));
+      stepIndex = data[2];
+      if (stepIndex > STEP_INDEX_MAX)
+        stepIndex = STEP_INDEX_MAX;
+      data += ADPCM_BLOCK_HEADER_BYTES;
+      highNibbleNext = false;
+      blockSamplesLeft = ADPCM_SAMPLES_PER_BLOCK - 1;
+      samples[i] = predictor;
+      continue;
+    }
+    uint8_t nibble;
+    if (highNibbleNext) {
+      nibble = data[-1] >> NIBBLE_BITS;
+    } else {
+      nibble = *data++ & NIBBLE_MASK;
+    }
+    highNibbleNext = !highNibbleNext;
+    applyNibble(&predictor, &stepIndex, nibble);
+    blockSamplesLeft--;
+    samples[i] = predictor;
+  }
+
+  decoder->data = data;
+  decoder->predictor = predictor;
+  decoder->stepIndex = stepIndex;
+  decoder->highNibbleNext = highNibbleNext;
+  decoder->blockSamplesLeft = blockSamplesLeft;
+  decoder->samplesRemaining -= maxSamples;
+  return maxSamples;
+}
@@ -0,0 +1,63 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// IMA-ADPCM (4 bits per sample) encoder and incremental decoder for the sound
+// assets. wav2pack encodes them into soundPack.bin; sound_tick() decodes a few
+// samples at a time.
+//
+// The stream uses the mono block layout of IMA-ADPCM .wav files (format tag
+// 0x11): each ADPCM_BLOCK_BYTES block starts with a 4-byte header (the first
+// sample as little-endian int16, then the step index, then a zero byte)
+// followed by two samples per byte, low nibble first. The last block may be
+// shorter. Restarting the predictor every block keeps errors from
+// accumulating.
+
+#ifndef ADPCM_H_
+#define ADPCM_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define ADPCM_BLOCK_BYTES 256
+#define ADPCM_BLOCK_HEADER_BYTES 4
+// The header holds one sample and every data byte holds two.
+#define ADPCM_SAMPLES_PER_BLOCK                                                \
+  ((ADPCM_BLOCK_BYTES - ADPCM_BLOCK_HEADER_BYTES) * 2 + 1)
+
+// Decoder state for one stream.
+typedef struct {
+  const uint8_t *data;       // Next encoded byte.
+  uint32_t samplesRemaining; // Samples left in the stream.
+  uint16_t blockSamplesLeft; // Samples left in the current block.
+  int16_t predictor;         // Last decoded sample.
+  uint8_t stepIndex;         // Index into the step-size table.
+  bool highNibbleNext;       // The high nibble of data[-1] is next.
+} adpcm_decoder_t;
+
+// Returns the number of bytes needed to encode sampleCount samples.
+uint32_t adpcm_getEncodedByteCount(uint32_t sampleCount);
+
+// Encodes sampleCount samples into encoded, which must hold
+// adpcm_getEncodedByteCount(sampleCount) bytes.
+void adpcm_encode(const int16_t samples[], uint32_t sampleCount,
+                  uint8_t encoded[]);
+
+// Starts decoding sampleCount samples from data.
+void adpcm_initDecoder(adpcm_decoder_t *decoder, const uint8_t *data,
+                       uint32_t sampleCount);
+
+// Returns true once every sample has been decoded.
+bool adpcm_isDone(const adpcm_decoder_t *decoder);
+
+// Decodes up to maxSamples samples into samples and returns how many were
+// decoded (fewer only at the end of the stream).
+uint32_t adpcm_decode(adpcm_decoder_t *decoder, int16_t samples[],
+                      uint32_t maxSamples);
+
+#endif /* ADPCM_H_ */
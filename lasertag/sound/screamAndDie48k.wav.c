@@ -1,86164 +0,0 @@
-// This file was generated by executing this statement: wav2c screamAndDie48k.wav
-
-#include <stdint.h>
-
-uint16_t screamAndDie48k_wav[86158] = {
-32531,
-32464,
-32508,
-32521,
-32528,
-32501,
-32500,
-32511,
-32520,
-32519,
-32503,
-32504,
-32511,
-32519,
-32513,
-32506,
-32501,
-32515,
-32523,
-32516,
-32491,
-32488,
-32537,
-32648,
-32767,
-32811,
-32786,
-32723,
-32739,
-32839,
-32978,
-33061,
-33055,
-32998,
-32984,
-33040,
-33170,
-33270,
-33316,
-33290,
-33262,
-33264,
-33292,
-33293,
-33274,
-33259,
-33285,
-33313,
-33273,
-33153,
-33028,
-32980,
-33014,
-33046,
-33038,
-33004,
-33004,
-33038,
-33041,
-33019,
-32993,
-33029,
-33061,
-33034,
-32919,
-32789,
-32743,
-32749,
-32781,
-32773,
-32767,
-32760,
-32774,
-32757,
-32768,
-32779,
-32779,
-32700,
-32556,
-32455,
-32465,
-32552,
-32570,
-32473,
-32326,
-32256,
-32263,
-32256,
-32161,
-32027,
-31958,
-31977,
-32020,
-32021,
-31984,
-31980,
-32005,
-32025,
-32001,
-31960,
-31991,
-32094,
-32225,
-32289,
-32278,
-32237,
-32239,
-32259,
-32276,
-32251,
-32238,
-32250,
-32278,
-32264,
-32226,
-32228,
-32318,
-32458,
-32543,
-32539,
-32495,
-32491,
-32517,
-32534,
-32504,
-32491,
-32505,
-32539,
-32522,
-32481,
-32477,
-32558,
-32682,
-32775,
-32797,
-32772,
-32744,
-32755,
-32832,
-32974,
-33136,
-33246,
-33287,
-33283,
-33287,
-33285,
-33272,
-33255,
-33281,
-33326,
-33294,
-33172,
-33041,
-33049,
-33195,
-33323,
-33333,
-33260,
-33234,
-33283,
-33318,
-33286,
-33244,
-33264,
-33311,
-33302,
-33251,
-33243,
-33305,
-33343,
-33248,
-33100,
-33023,
-33044,
-33031,
-32915,
-32780,
-32799,
-32947,
-33071,
-33067,
-33004,
-33000,
-33024,
-32963,
-32771,
-32584,
-32511,
-32538,
-32532,
-32440,
-32309,
-32237,
-32235,
-32252,
-32264,
-32263,
-32254,
-32251,
-32248,
-32258,
-32268,
-32258,
-32238,
-32244,
-32274,
-32289,
-32227,
-32109,
-32009,
-31970,
-31986,
-32003,
-32009,
-32007,
-31999,
-31979,
-31978,
-32033,
-32149,
-32257,
-32290,
-32271,
-32232,
-32244,
-32262,
-32265,
-32256,
-32244,
-32253,
-32260,
-32260,
-32255,
-32253,
-32251,
-32259,
-32260,
-32261,
-32237,
-32238,
-32298,
-32431,
-32544,
-32565,
-32495,
-32451,
-32517,
-32648,
-32756,
-32777,
-32776,
-32772,
-32775,
-32746,
-32740,
-32803,
-32931,
-33017,
-33035,
-33032,
-33106,
-33241,
-33326,
-33317,
-33257,
-33248,
-33284,
-33308,
-33283,
-33255,
-33265,
-33295,
-33296,
-33270,
-33258,
-33284,
-33298,
-33279,
-33258,
-33277,
-33314,
-33279,
-33149,
-33007,
-32968,
-33024,
-33073,
-33033,
-32969,
-32981,
-33106,
-33224,
-33270,
-33255,
-33306,
-33422,
-33523,
-33483,
-33334,
-33165,
-33050,
-32950,
-32840,
-32750,
-32738,
-32756,
-32694,
-32512,
-32317,
-32238,
-32276,
-32286,
-32184,
-32037,
-31961,
-31983,
-32024,
-32006,
-31986,
-31986,
-32013,
-32011,
-31989,
-31989,
-32008,
-32007,
-31978,
-32016,
-32150,
-32305,
-32331,
-32230,
-32163,
-32256,
-32431,
-32510,
-32419,
-32298,
-32254,
-32263,
-32214,
-32088,
-31993,
-31987,
-31988,
-31905,
-31765,
-31684,
-31719,
-31781,
-31774,
-31712,
-31695,
-31781,
-31915,
-32010,
-32032,
-31997,
-31973,
-31987,
-32069,
-32203,
-32351,
-32468,
-32527,
-32535,
-32505,
-32478,
-32514,
-32626,
-32767,
-32830,
-32778,
-32708,
-32730,
-32858,
-32981,
-33020,
-33005,
-33053,
-33158,
-33277,
-33311,
-33293,
-33267,
-33269,
-33272,
-33287,
-33288,
-33287,
-33262,
-33249,
-33299,
-33416,
-33529,
-33566,
-33547,
-33524,
-33528,
-33533,
-33521,
-33571,
-33688,
-33822,
-33849,
-33783,
-33731,
-33789,
-33865,
-33824,
-33623,
-33374,
-33193,
-33079,
-32970,
-32843,
-32767,
-32750,
-32759,
-32690,
-32550,
-32374,
-32266,
-32225,
-32256,
-32273,
-32264,
-32232,
-32233,
-32278,
-32308,
-32242,
-32105,
-32018,
-32057,
-32196,
-32290,
-32293,
-32251,
-32235,
-32243,
-32250,
-32274,
-32364,
-32486,
-32560,
-32537,
-32494,
-32493,
-32492,
-32384,
-32183,
-32015,
-31999,
-32038,
-32003,
-31861,
-31746,
-31735,
-31759,
-31683,
-31536,
-31476,
-31598,
-31811,
-31969,
-31999,
-31992,
-31996,
-32004,
-32000,
-32042,
-32177,
-32370,
-32498,
-32507,
-32482,
-32526,
-32658,
-32785,
-32807,
-32769,
-32719,
-32759,
-32852,
-32972,
-33047,
-33058,
-33016,
-32988,
-33026,
-33144,
-33299,
-33427,
-33513,
-33549,
-33555,
-33536,
-33519,
-33525,
-33542,
-33552,
-33531,
-33519,
-33525,
-33554,
-33547,
-33526,
-33511,
-33539,
-33567,
-33545,
-33499,
-33498,
-33578,
-33705,
-33772,
-33798,
-33805,
-33827,
-33803,
-33657,
-33411,
-33168,
-33030,
-33012,
-33046,
-33025,
-32921,
-32749,
-32596,
-32529,
-32524,
-32517,
-32437,
-32317,
-32242,
-32237,
-32237,
-32153,
-31983,
-31820,
-31736,
-31731,
-31747,
-31750,
-31741,
-31730,
-31735,
-31773,
-31879,
-32032,
-32186,
-32260,
-32276,
-32248,
-32247,
-32254,
-32272,
-32263,
-32217,
-32102,
-31942,
-31800,
-31733,
-31744,
-31745,
-31670,
-31510,
-31345,
-31241,
-31260,
-31390,
-31571,
-31714,
-31748,
-31723,
-31746,
-31866,
-31999,
-32044,
-31995,
-32014,
-32171,
-32391,
-32511,
-32477,
-32453,
-32563,
-32813,
-33019,
-33093,
-33040,
-32989,
-32996,
-33068,
-33205,
-33408,
-33645,
-33831,
-33878,
-33781,
-33629,
-33519,
-33500,
-33541,
-33577,
-33545,
-33451,
-33339,
-33273,
-33257,
-33263,
-33267,
-33303,
-33401,
-33511,
-33572,
-33555,
-33564,
-33694,
-33901,
-34055,
-34033,
-33895,
-33741,
-33641,
-33544,
-33415,
-33281,
-33169,
-33071,
-32935,
-32801,
-32732,
-32761,
-32770,
-32667,
-32464,
-32306,
-32262,
-32273,
-32259,
-32220,
-32237,
-32300,
-32299,
-32192,
-32045,
-31996,
-32019,
-31992,
-31862,
-31743,
-31779,
-31959,
-32130,
-32224,
-32294,
-32432,
-32564,
-32590,
-32461,
-32326,
-32262,
-32274,
-32248,
-32164,
-32045,
-31933,
-31798,
-31652,
-31538,
-31494,
-31488,
-31464,
-31454,
-31499,
-31624,
-31714,
-31740,
-31743,
-31813,
-31932,
-32008,
-32011,
-32027,
-32125,
-32249,
-32300,
-32270,
-32299,
-32444,
-32646,
-32765,
-32779,
-32757,
-32754,
-32759,
-32799,
-32947,
-33287,
-33706,
-34035,
-34138,
-34074,
-33945,
-33844,
-33770,
-33756,
-33798,
-33844,
-33778,
-33562,
-33271,
-33075,
-33024,
-33100,
-33216,
-33360,
-33487,
-33576,
-33568,
-33505,
-33486,
-33551,
-33691,
-33778,
-33753,
-33598,
-33362,
-33108,
-32909,
-32797,
-32777,
-32782,
-32743,
-32636,
-32519,
-32457,
-32497,
-32548,
-32553,
-32428,
-32295,
-32222,
-32246,
-32264,
-32154,
-31955,
-31794,
-31752,
-31786,
-31747,
-31627,
-31513,
-31518,
-31646,
-31797,
-31934,
-32038,
-32155,
-32250,
-32298,
-32271,
-32178,
-32030,
-31878,
-31770,
-31748,
-31751,
-31707,
-31588,
-31478,
-31447,
-31480,
-31498,
-31492,
-31540,
-31675,
-31858,
-31970,
-32040,
-32138,
-32308,
-32465,
-32516,
-32493,
-32505,
-32605,
-32746,
-32862,
-32969,
-33108,
-33239,
-33295,
-33268,
-33297,
-33489,
-33830,
-34149,
-34292,
-34242,
-34094,
-33976,
-33986,
-34147,
-34412,
-34641,
-34687,
-34489,
-34138,
-33795,
-33587,
-33522,
-33533,
-33550,
-33545,
-33526,
-33510,
-33524,
-33578,
-33679,
-33778,
-33844,
-33816,
-33716,
-33548,
-33346,
-33133,
-32937,
-32791,
-32701,
-32625,
-32512,
-32360,
-32206,
-32105,
-32040,
-31997,
-31959,
-31971,
-32017,
-32054,
-32013,
-31917,
-31823,
-31781,
-31750,
-31703,
-31617,
-31538,
-31485,
-31447,
-31449,
-31490,
-31570,
-31659,
-31715,
-31761,
-31786,
-31773,
-31708,
-31657,
-31744,
-31959,
-32178,
-32225,
-32111,
-31989,
-31955,
-31972,
-31895,
-31763,
-31671,
-31712,
-31789,
-31783,
-31703,
-31679,
-31830,
-32099,
-32346,
-32479,
-32499,
-32491,
-32520,
-32598,
-32740,
-32928,
-33175,
-33498,
-33866,
-34208,
-34450,
-34586,
-34696,
-34850,
-34997,
-35060,
-34974,
-34861,
-34792,
-34796,
-34772,
-34666,
-34519,
-34378,
-34240,
-34045,
-33802,
-33603,
-33509,
-33474,
-33364,
-33132,
-32843,
-32642,
-32557,
-32537,
-32506,
-32478,
-32490,
-32545,
-32565,
-32496,
-32374,
-32293,
-32315,
-32422,
-32524,
-32568,
-32515,
-32378,
-32206,
-32070,
-32025,
-32041,
-32000,
-31839,
-31602,
-31403,
-31281,
-31143,
-30927,
-30686,
-30606,
-30708,
-30902,
-30985,
-30961,
-30949,
-31045,
-31191,
-31261,
-31240,
-31236,
-31345,
-31518,
-31665,
-31743,
-31824,
-31969,
-32133,
-32244,
-32264,
-32249,
-32254,
-32266,
-32258,
-32234,
-32249,
-32355,
-32512,
-32662,
-32743,
-32765,
-32769,
-32817,
-32915,
-33079,
-33209,
-33320,
-33392,
-33531,
-33752,
-34030,
-34281,
-34488,
-34668,
-34804,
-34816,
-34673,
-34489,
-34457,
-34606,
-34785,
-34799,
-34672,
-34578,
-34589,
-34586,
-34426,
-34166,
-34008,
-34014,
-34027,
-33843,
-33507,
-33186,
-33025,
-32932,
-32812,
-32655,
-32541,
-32463,
-32354,
-32190,
-32043,
-31992,
-32002,
-32000,
-31983,
-31993,
-32029,
-32021,
-31930,
-31798,
-31689,
-31577,
-31434,
-31290,
-31229,
-31241,
-31235,
-31127,
-30993,
-30939,
-30960,
-30985,
-30967,
-30999,
-31128,
-31263,
-31292,
-31220,
-31178,
-31229,
-31286,
-31244,
-31173,
-31186,
-31323,
-31451,
-31480,
-31465,
-31515,
-31627,
-31739,
-31826,
-31980,
-32230,
-32452,
-32541,
-32517,
-32573,
-32796,
-33113,
-33380,
-33581,
-33796,
-34018,
-34211,
-34299,
-34426,
-34668,
-35015,
-35276,
-35365,
-35333,
-35301,
-35252,
-35065,
-34695,
-34308,
-34132,
-34257,
-34540,
-34754,
-34794,
-34677,
-34515,
-34361,
-34270,
-34274,
-34323,
-34310,
-34074,
-33642,
-33163,
-32863,
-32758,
-32729,
-32636,
-32479,
-32338,
-32214,
-32030,
-31769,
-31540,
-31464,
-31516,
-31528,
-31431,
-31272,
-31178,
-31104,
-30933,
-30662,
-30436,
-30385,
-30473,
-30513,
-30468,
-30418,
-30448,
-30503,
-30481,
-30444,
-30534,
-30790,
-31077,
-31221,
-31234,
-31236,
-31272,
-31250,
-31136,
-31012,
-30978,
-31002,
-30931,
-30789,
-30728,
-30909,
-31214,
-31440,
-31488,
-31514,
-31646,
-31900,
-32132,
-32362,
-32687,
-33150,
-33667,
-34073,
-34406,
-34773,
-35246,
-35724,
-36085,
-36297,
-36400,
-36408,
-36285,
-36045,
-35801,
-35649,
-35575,
-35497,
-35356,
-35206,
-35095,
-35009,
-34894,
-34747,
-34606,
-34544,
-34539,
-34570,
-34586,
-34557,
-34414,
-34134,
-33744,
-33385,
-33153,
-33062,
-32995,
-32883,
-32722,
-32591,
-32509,
-32418,
-32269,
-32097,
-32007,
-32025,
-32037,
-31886,
-31518,
-31073,
-30683,
-30420,
-30181,
-29955,
-29756,
-29698,
-29714,
-29724,
-29612,
-29472,
-29461,
-29685,
-30079,
-30493,
-30734,
-30797,
-30721,
-30662,
-30697,
-30819,
-30944,
-30996,
-30988,
-30971,
-30973,
-30974,
-30959,
-30984,
-31069,
-31215,
-31335,
-31447,
-31648,
-32024,
-32531,
-33025,
-33411,
-33741,
-34118,
-34579,
-35080,
-35568,
-36019,
-36387,
-36592,
-36587,
-36437,
-36271,
-36159,
-36076,
-35955,
-35815,
-35693,
-35595,
-35485,
-35347,
-35260,
-35287,
-35422,
-35543,
-35571,
-35478,
-35275,
-34963,
-34523,
-34015,
-33584,
-33335,
-33274,
-33258,
-33142,
-32862,
-32491,
-32129,
-31872,
-31731,
-31694,
-31742,
-31798,
-31772,
-31545,
-31141,
-30679,
-30333,
-30129,
-30024,
-29914,
-29807,
-29678,
-29488,
-29203,
-28936,
-28888,
-29148,
-29553,
-29843,
-29937,
-29963,
-30079,
-30247,
-30373,
-30464,
-30652,
-30947,
-31148,
-31050,
-30734,
-30485,
-30531,
-30792,
-31040,
-31177,
-31254,
-31350,
-31480,
-31639,
-31935,
-32421,
-33045,
-33636,
-34096,
-34500,
-34953,
-35464,
-35978,
-36403,
-36713,
-36853,
-36750,
-36454,
-36099,
-35870,
-35813,
-35832,
-35855,
-35842,
-35826,
-35742,
-35585,
-35396,
-35316,
-35406,
-35555,
-35605,
-35451,
-35154,
-34799,
-34444,
-34077,
-33734,
-33464,
-33283,
-33118,
-32837,
-32397,
-31903,
-31545,
-31444,
-31550,
-31697,
-31745,
-31655,
-31461,
-31159,
-30755,
-30316,
-29997,
-29894,
-29944,
-29917,
-29679,
-29265,
-28875,
-28635,
-28590,
-28672,
-28870,
-29146,
-29432,
-29648,
-29768,
-29878,
-30053,
-30302,
-30529,
-30674,
-30722,
-30734,
-30717,
-30693,
-30708,
-30835,
-31108,
-31427,
-31668,
-31800,
-31977,
-32395,
-33080,
-33867,
-34531,
-35034,
-35478,
-35968,
-36443,
-36777,
-36919,
-36914,
-36815,
-36593,
-36281,
-35987,
-35837,
-35781,
-35620,
-35276,
-34894,
-34755,
-34921,
-35226,
-35473,
-35631,
-35763,
-35844,
-35707,
-35344,
-34888,
-34598,
-34475,
-34377,
-34130,
-33762,
-33362,
-33007,
-32685,
-32410,
-32250,
-32204,
-32252,
-32290,
-32274,
-32156,
-31901,
-31526,
-31149,
-30897,
-30796,
-30688,
-30413,
-29932,
-29399,
-28977,
-28752,
-28672,
-28662,
-28669,
-28700,
-28797,
-28987,
-29234,
-29485,
-29704,
-29931,
-30197,
-30437,
-30556,
-30498,
-30357,
-30248,
-30227,
-30304,
-30515,
-30866,
-31284,
-31578,
-31710,
-31883,
-32342,
-33128,
-33960,
-34604,
-35070,
-35531,
-36023,
-36377,
-36455,
-36377,
-36315,
-36332,
-36250,
-35986,
-35605,
-35225,
-34872,
-34518,
-34274,
-34301,
-34581,
-34841,
-34846,
-34643,
-34532,
-34637,
-34812,
-34810,
-34644,
-34480,
-34406,
-34270,
-33936,
-33485,
-33159,
-33043,
-32994,
-32823,
-32546,
-32318,
-32250,
-32255,
-32221,
-32112,
-31984,
-31871,
-31734,
-31529,
-31281,
-31028,
-30792,
-30564,
-30329,
-30097,
-29867,
-29616,
-29360,
-29162,
-29094,
-29178,
-29380,
-29628,
-29895,
-30132,
-30313,
-30415,
-30485,
-30600,
-30773,
-30934,
-30958,
-30847,
-30738,
-30803,
-31107,
-31505,
-31873,
-32184,
-32611,
-33275,
-34134,
-34977,
-35630,
-36079,
-36392,
-36603,
-36675,
-36616,
-36551,
-36582,
-36654,
-36573,
-36185,
-35593,
-35027,
-34690,
-34544,
-34469,
-34353,
-34208,
-34076,
-33964,
-33865,
-33775,
-33751,
-33787,
-33838,
-33802,
-33607,
-33304,
-32998,
-32810,
-32749,
-32753,
-32759,
-32761,
-32785,
-32805,
-32737,
-32536,
-32264,
-32051,
-31994,
-32030,
-32040,
-31871,
-31490,
-30981,
-30481,
-30120,
-29880,
-29670,
-29415,
-29190,
-29111,
-29164,
-29224,
-29192,
-29202,
-29441,
-29900,
-30317,
-30469,
-30433,
-30475,
-30705,
-30951,
-31013,
-30974,
-31093,
-31493,
-31995,
-32366,
-32590,
-32882,
-33367,
-33983,
-34561,
-35044,
-35497,
-35933,
-36279,
-36427,
-36395,
-36309,
-36297,
-36385,
-36447,
-36318,
-35924,
-35368,
-34885,
-34597,
-34436,
-34196,
-33820,
-33426,
-33220,
-33216,
-33302,
-33326,
-33272,
-33171,
-33047,
-32900,
-32782,
-32744,
-32766,
-32759,
-32629,
-32442,
-32292,
-32266,
-32351,
-32501,
-32665,
-32771,
-32739,
-32575,
-32386,
-32283,
-32254,
-32159,
-31898,
-31543,
-31211,
-30967,
-30728,
-30411,
-30057,
-29730,
-29503,
-29337,
-29229,
-29198,
-29286,
-29468,
-29705,
-29983,
-30303,
-30657,
-30969,
-31190,
-31367,
-31582,
-31902,
-32278,
-32647,
-32977,
-33322,
-33681,
-34054,
-34393,
-34737,
-35100,
-35476,
-35744,
-35846,
-35795,
-35688,
-35546,
-35344,
-35030,
-34666,
-34330,
-34070,
-33846,
-33624,
-33377,
-33145,
-32904,
-32695,
-32550,
-32500,
-32516,
-32521,
-32500,
-32498,
-32520,
-32536,
-32495,
-32472,
-32547,
-32705,
-32804,
-32792,
-32740,
-32766,
-32785,
-32696,
-32511,
-32479,
-32682,
-32928,
-32893,
-32588,
-32316,
-32298,
-32440,
-32478,
-32460,
-32520,
-32674,
-32578,
-32079,
-31445,
-31156,
-31307,
-31522,
-31453,
-31209,
-31099,
-31216,
-31307,
-31264,
-31274,
-31568,
-32056,
-32423,
-32603,
-32786,
-33129,
-33462,
-33540,
-33461,
-33511,
-33864,
-34253,
-34408,
-34340,
-34260,
-34299,
-34287,
-34164,
-34011,
-34006,
-34045,
-33934,
-33575,
-33160,
-32835,
-32562,
-32192,
-31782,
-31522,
-31484,
-31449,
-31154,
-30637,
-30194,
-30063,
-30188,
-30344,
-30432,
-30515,
-30655,
-30777,
-30782,
-30666,
-30540,
-30463,
-30435,
-30452,
-30591,
-30899,
-31294,
-31632,
-31885,
-32216,
-32808,
-33640,
-34506,
-35179,
-35612,
-35879,
-36073,
-36263,
-36510,
-36911,
-37408,
-37840,
-37973,
-37790,
-37419,
-37053,
-36719,
-36343,
-35894,
-35406,
-34936,
-34465,
-33976,
-33500,
-33100,
-32760,
-32381,
-31912,
-31435,
-31042,
-30736,
-30349,
-29824,
-29288,
-28964,
-28947,
-29095,
-29236,
-29330,
-29489,
-29725,
-29967,
-30100,
-30197,
-30371,
-30644,
-30837,
-30806,
-30614,
-30463,
-30476,
-30525,
-30439,
-30196,
-29941,
-29796,
-29718,
-29614,
-29465,
-29383,
-29404,
-29508,
-29611,
-29708,
-29833,
-29993,
-30170,
-30426,
-30862,
-31567,
-32499,
-33566,
-34706,
-35928,
-37108,
-38110,
-38743,
-39130,
-39476,
-39992,
-40604,
-41081,
-41255,
-41166,
-40995,
-40855,
-40678,
-40329,
-39746,
-38993,
-38129,
-37156,
-36011,
-34752,
-33505,
-32398,
-31392,
-30427,
-29484,
-28673,
-28010,
-27400,
-26779,
-26264,
-26140,
-26441,
-26988,
-27439,
-27790,
-28184,
-28761,
-29424,
-30037,
-30635,
-31312,
-32007,
-32465,
-32546,
-32398,
-32257,
-32171,
-31948,
-31509,
-30988,
-30570,
-30263,
-29899,
-29488,
-29167,
-29037,
-28969,
-28767,
-28487,
-28333,
-28495,
-28888,
-29430,
-30187,
-31283,
-32685,
-34084,
-35249,
-36185,
-37135,
-38206,
-39276,
-40114,
-40583,
-40750,
-40751,
-40669,
-40508,
-40177,
-39655,
-38989,
-38308,
-37617,
-36779,
-35670,
-34404,
-33304,
-32566,
-32019,
-31348,
-30485,
-29717,
-29313,
-29189,
-29030,
-28767,
-28645,
-28899,
-29410,
-29806,
-30017,
-30253,
-30767,
-31442,
-31982,
-32321,
-32638,
-33128,
-33646,
-33937,
-33903,
-33659,
-33344,
-32951,
-32476,
-31949,
-31441,
-30837,
-30066,
-29163,
-28385,
-27853,
-27522,
-27239,
-27068,
-27138,
-27491,
-27946,
-28373,
-28858,
-29562,
-30466,
-31389,
-32241,
-33187,
-34408,
-35833,
-37169,
-38216,
-39011,
-39665,
-40135,
-40269,
-40057,
-39680,
-39302,
-38885,
-38223,
-37249,
-36123,
-35103,
-34276,
-33536,
-32722,
-31848,
-31021,
-30392,
-29931,
-29577,
-29291,
-29154,
-29257,
-29586,
-30004,
-30385,
-30712,
-31104,
-31618,
-32236,
-32828,
-33294,
-33639,
-33912,
-34152,
-34334,
-34386,
-34302,
-34161,
-34043,
-33921,
-33662,
-33160,
-32522,
-31900,
-31363,
-30738,
-29906,
-28977,
-28254,
-27926,
-27868,
-27879,
-27897,
-28071,
-28501,
-29092,
-29736,
-30434,
-31295,
-32341,
-33399,
-34317,
-35071,
-35757,
-36441,
-37109,
-37700,
-38188,
-38530,
-38680,
-38608,
-38310,
-37784,
-37048,
-36190,
-35398,
-34770,
-34221,
-33499,
-32503,
-31367,
-30407,
-29758,
-29392,
-29107,
-28811,
-28425,
-28015,
-27656,
-27506,
-27605,
-27872,
-28195,
-28571,
-29067,
-29680,
-30254,
-30733,
-31262,
-32013,
-32922,
-33633,
-33915,
-33881,
-33840,
-33923,
-34017,
-34043,
-34164,
-34529,
-35041,
-35373,
-35404,
-35338,
-35447,
-35712,
-35887,
-35898,
-35911,
-36130,
-36385,
-36391,
-36076,
-35771,
-35801,
-36110,
-36307,
-36162,
-35746,
-35331,
-34932,
-34430,
-33795,
-33182,
-32779,
-32443,
-31984,
-31318,
-30637,
-30095,
-29612,
-29065,
-28459,
-28047,
-27893,
-27875,
-27782,
-27659,
-27729,
-28093,
-28607,
-29073,
-29480,
-29948,
-30518,
-31015,
-31297,
-31322,
-31219,
-31076,
-30960,
-30911,
-30978,
-31103,
-31199,
-31193,
-31091,
-30889,
-30527,
-30017,
-29575,
-29486,
-29889,
-30634,
-31539,
-32546,
-33735,
-35025,
-36233,
-37196,
-37994,
-38784,
-39551,
-40155,
-40506,
-40760,
-41116,
-41635,
-42154,
-42502,
-42548,
-42232,
-41470,
-40285,
-38826,
-37328,
-35864,
-34344,
-32635,
-30758,
-28902,
-27206,
-25716,
-24392,
-23292,
-22548,
-22272,
-22416,
-22806,
-23275,
-23800,
-24457,
-25333,
-26420,
-27643,
-28968,
-30364,
-31781,
-33050,
-33993,
-34541,
-34805,
-34961,
-35078,
-35094,
-34904,
-34498,
-34024,
-33589,
-33246,
-32865,
-32342,
-31619,
-30791,
-29944,
-29168,
-28521,
-28142,
-28237,
-28888,
-30028,
-31338,
-32637,
-33895,
-35252,
-36787,
-38371,
-39839,
-41108,
-42235,
-43260,
-44056,
-44452,
-44322,
-43774,
-42971,
-42004,
-40831,
-39344,
-37561,
-35585,
-33570,
-31570,
-29652,
-27890,
-26411,
-25231,
-24258,
-23385,
-22695,
-22368,
-22518,
-23025,
-23674,
-24435,
-25412,
-26691,
-28147,
-29570,
-30958,
-32410,
-33991,
-35472,
-36611,
-37326,
-37742,
-37903,
-37701,
-37010,
-35990,
-34901,
-33948,
-33034,
-32013,
-30844,
-29657,
-28587,
-27737,
-27161,
-26908,
-26911,
-27053,
-27216,
-27426,
-27798,
-28415,
-29356,
-30682,
-32472,
-34629,
-36940,
-39074,
-40889,
-42309,
-43359,
-44056,
-44440,
-44517,
-44149,
-43153,
-41571,
-39800,
-38303,
-37163,
-35983,
-34366,
-32340,
-30305,
-28576,
-27126,
-25821,
-24740,
-24077,
-23892,
-24005,
-24243,
-24670,
-25394,
-26348,
-27327,
-28273,
-29341,
-30700,
-32174,
-33442,
-34324,
-34976,
-35649,
-36378,
-36994,
-37340,
-37404,
-37218,
-36731,
-35878,
-34770,
-33658,
-32712,
-31867,
-30880,
-29723,
-28562,
-27690,
-27209,
-27054,
-27179,
-27612,
-28368,
-29303,
-30197,
-31004,
-31877,
-32995,
-34333,
-35717,
-37023,
-38269,
-39454,
-40462,
-41150,
-41530,
-41715,
-41717,
-41357,
-40458,
-39085,
-37490,
-35853,
-34211,
-32585,
-31109,
-29927,
-28912,
-27805,
-26482,
-25194,
-24333,
-24053,
-24174,
-24440,
-24777,
-25237,
-25819,
-26428,
-26997,
-27634,
-28419,
-29373,
-30323,
-31206,
-31990,
-32746,
-33465,
-34094,
-34587,
-34869,
-34929,
-34798,
-34688,
-34791,
-35205,
-35732,
-36190,
-36497,
-36758,
-37011,
-37173,
-37161,
-37117,
-37258,
-37667,
-38133,
-38389,
-38375,
-38199,
-37973,
-37742,
-37544,
-37542,
-37670,
-37621,
-36944,
-35602,
-34009,
-32672,
-31660,
-30654,
-29390,
-27939,
-26540,
-25298,
-24183,
-23284,
-22813,
-22839,
-23158,
-23505,
-23863,
-24437,
-25321,
-26398,
-27516,
-28714,
-30059,
-31399,
-32424,
-33001,
-33340,
-33735,
-34216,
-34560,
-34633,
-34465,
-34186,
-33748,
-33177,
-32639,
-32406,
-32501,
-32696,
-32811,
-33008,
-33602,
-34588,
-35605,
-36270,
-36629,
-37056,
-37803,
-38707,
-39391,
-39648,
-39624,
-39710,
-40197,
-41161,
-42348,
-43330,
-43657,
-43123,
-41871,
-40319,
-38892,
-37768,
-36756,
-35477,
-33576,
-31059,
-28194,
-25386,
-22860,
-20689,
-18959,
-17810,
-17373,
-17488,
-17883,
-18401,
-19181,
-20479,
-22293,
-24345,
-26301,
-28069,
-29729,
-31372,
-32922,
-34312,
-35473,
-36415,
-37067,
-37342,
-37221,
-36801,
-36275,
-35846,
-35629,
-35603,
-35529,
-35206,
-34538,
-33768,
-33140,
-32786,
-32637,
-32701,
-33097,
-33861,
-34748,
-35375,
-35670,
-35986,
-36781,
-38117,
-39675,
-41087,
-42292,
-43327,
-44116,
-44413,
-44128,
-43389,
-42382,
-41045,
-39213,
-36841,
-34157,
-31416,
-28698,
-26001,
-23385,
-21071,
-19199,
-17784,
-16831,
-16446,
-16774,
-17725,
-19006,
-20379,
-21811,
-23452,
-25280,
-27141,
-28890,
-30548,
-32214,
-33800,
-35172,
-36257,
-37201,
-38132,
-38938,
-39396,
-39381,
-39059,
-38640,
-38186,
-37600,
-36780,
-35810,
-34763,
-33686,
-32530,
-31317,
-30129,
-29138,
-28511,
-28471,
-29117,
-30348,
-31838,
-33336,
-34916,
-36840,
-39291,
-41982,
-44489,
-46454,
-47825,
-48608,
-48668,
-47822,
-46075,
-43730,
-41140,
-38477,
-35594,
-32334,
-28750,
-25214,
-22221,
-20057,
-18671,
-17773,
-17157,
-16847,
-16987,
-17597,
-18527,
-19609,
-20876,
-22451,
-24321,
-26270,
-28004,
-29467,
-30839,
-32366,
-34134,
-35950,
-37537,
-38693,
-39472,
-40098,
-40699,
-41154,
-41202,
-40769,
-40075,
-39395,
-38656,
-37527,
-35787,
-33723,
-31800,
-30265,
-28924,
-27627,
-26601,
-26315,
-26965,
-28246,
-29773,
-31472,
-33614,
-36340,
-39386,
-42274,
-44708,
-46644,
-48132,
-49026,
-49079,
-48151,
-46269,
-43597,
-40232,
-36330,
-32126,
-28060,
-24535,
-21777,
-19728,
-18245,
-17229,
-16709,
-16675,
-17036,
-17689,
-18582,
-19768,
-21186,
-22730,
-24257,
-25781,
-27306,
-28798,
-30099,
-31159,
-32073,
-33013,
-34045,
-35172,
-36406,
-37750,
-39062,
-40023,
-40456,
-40470,
-40415,
-40347,
-40012,
-39052,
-37568,
-35997,
-34805,
-33994,
-33368,
-32815,
-32517,
-32691,
-33339,
-34252,
-35292,
-36517,
-38131,
-40241,
-42725,
-45224,
-47278,
-48499,
-48695,
-47915,
-46307,
-44039,
-41205,
-37862,
-34106,
-30079,
-26064,
-22359,
-19236,
-16791,
-14980,
-13754,
-13138,
-13155,
-13736,
-14719,
-15964,
-17474,
-19265,
-21259,
-23310,
-25296,
-27213,
-29073,
-30809,
-32337,
-33641,
-34809,
-35894,
-36900,
-37738,
-38402,
-38878,
-39200,
-39402,
-39546,
-39653,
-39617,
-39290,
-38586,
-37626,
-36603,
-35628,
-34780,
-34125,
-33791,
-33750,
-33801,
-33800,
-33869,
-34380,
-35555,
-37304,
-39368,
-41626,
-44091,
-46622,
-48844,
-50268,
-50645,
-49928,
-48141,
-45325,
-41676,
-37552,
-33312,
-29055,
-24806,
-20688,
-17093,
-14309,
-12359,
-11067,
-10356,
-10363,
-11181,
-12713,
-14703,
-16965,
-19403,
-21877,
-24242,
-26407,
-28497,
-30595,
-32597,
-34240,
-35416,
-36291,
-37139,
-38014,
-38820,
-39493,
-40156,
-40924,
-41659,
-42042,
-41879,
-41246,
-40423,
-39556,
-38621,
-37509,
-36244,
-34959,
-33844,
-33030,
-32583,
-32515,
-32748,
-33234,
-33975,
-35144,
-36949,
-39460,
-42386,
-45169,
-47218,
-48258,
-48388,
-47838,
-46627,
-44522,
-41301,
-37103,
-32451,
-27941,
-23913,
-20408,
-17382,
-14879,
-13030,
-11890,
-11437,
-11587,
-12332,
-13647,
-15492,
-17724,
-20174,
-22672,
-25082,
-27308,
-29314,
-31093,
-32663,
-34071,
-35327,
-36497,
-37570,
-38509,
-39244,
-39770,
-40213,
-40747,
-41446,
-42144,
-42541,
-42414,
-41764,
-40742,
-39494,
-38098,
-36676,
-35471,
-34682,
-34308,
-34084,
-33858,
-33729,
-34073,
-35095,
-36669,
-38438,
-40132,
-41708,
-43209,
-44587,
-45595,
-45899,
-45200,
-43408,
-40682,
-37340,
-33684,
-29842,
-25998,
-22380,
-19349,
-17001,
-15183,
-13721,
-12681,
-12322,
-12732,
-13674,
-14891,
-16349,
-18176,
-20300,
-22388,
-24216,
-25907,
-27777,
-29871,
-31902,
-33546,
-34816,
-35909,
-37017,
-38104,
-39131,
-40063,
-40894,
-41555,
-42040,
-42424,
-42717,
-42785,
-42418,
-41631,
-40632,
-39590,
-38434,
-37108,
-35794,
-34947,
-34767,
-35085,
-35533,
-36014,
-36759,
-37931,
-39442,
-41003,
-42442,
-43755,
-44857,
-45543,
-45524,
-44690,
-43045,
-40668,
-37582,
-33925,
-29932,
-25961,
-22310,
-19192,
-16722,
-14932,
-13811,
-13308,
-13384,
-13986,
-15005,
-16291,
-17713,
-19237,
-20888,
-22679,
-24529,
-26316,
-27946,
-29421,
-30772,
-32023,
-33118,
-33980,
-34640,
-35253,
-36061,
-37189,
-38534,
-39836,
-40857,
-41527,
-41906,
-42003,
-41763,
-41118,
-40187,
-39238,
-38552,
-38199,
-38099,
-38100,
-38200,
-38463,
-38934,
-39591,
-40387,
-41330,
-42426,
-43509,
-44340,
-44716,
-44682,
-44375,
-43745,
-42444,
-40055,
-36497,
-32199,
-27814,
-23858,
-20457,
-17503,
-14954,
-12960,
-11771,
-11506,
-12003,
-12977,
-14162,
-15531,
-17133,
-19030,
-21200,
-23570,
-26065,
-28482,
-30541,
-32007,
-32938,
-33636,
-34386,
-35237,
-36003,
-36582,
-37022,
-37453,
-37907,
-38381,
-38866,
-39366,
-39779,
-39917,
-39739,
-39437,
-39272,
-39375,
-39627,
-39876,
-40061,
-40159,
-40184,
-40161,
-40244,
-40609,
-41319,
-42359,
-43704,
-45344,
-47024,
-48222,
-48390,
-47410,
-45591,
-43242,
-40330,
-36651,
-32257,
-27591,
-23142,
-19096,
-15458,
-12304,
-9881,
-8348,
-7637,
-7613,
-8261,
-9640,
-11667,
-14071,
-16669,
-19398,
-22288,
-25121,
-27647,
-29751,
-31587,
-33324,
-34906,
-36189,
-37159,
-37980,
-38769,
-39393,
-39751,
-39894,
-40123,
-40521,
-40913,
-41027,
-40885,
-40728,
-40701,
-40673,
-40429,
-40079,
-39918,
-40119,
-40411,
-40420,
-40092,
-39823,
-40118,
-41170,
-42860,
-44904,
-46974,
-48657,
-49489,
-49279,
-48149,
-46362,
-43919,
-40573,
-36230,
-31243,
-26228,
-21602,
-17439,
-13749,
-10675,
-8462,
-7106,
-6419,
-6289,
-6841,
-8240,
-10406,
-13015,
-15769,
-18562,
-21374,
-24104,
-26620,
-28857,
-30881,
-32771,
-34555,
-36195,
-37620,
-38690,
-39287,
-39463,
-39491,
-39640,
-40002,
-40407,
-40770,
-41073,
-41334,
-41377,
-41057,
-40495,
-40063,
-40023,
-40262,
-40508,
-40652,
-40818,
-41151,
-41673,
-42482,
-43788,
-45653,
-47688,
-49249,
-49955,
-49944,
-49418,
-48222,
-45911,
-42356,
-38034,
-33566,
-29196,
-24790,
-20297,
-16089,
-12632,
-10085,
-8330,
-7228,
-6846,
-7226,
-8222,
-9661,
-11537,
-13983,
-16982,
-20158,
-23102,
-25608,
-27816,
-29909,
-31899,
-33697,
-35195,
-36456,
-37521,
-38441,
-39226,
-39874,
-40420,
-40817,
-41074,
-41172,
-41171,
-41027,
-40705,
-40117,
-39356,
-38542,
-37842,
-37313,
-37013,
-37038,
-37519,
-38433,
-39619,
-40882,
-42237,
-43854,
-45790,
-47792,
-49381,
-50235,
-50291,
-49640,
-48222,
-45836,
-42370,
-37981,
-33106,
-28155,
-23455,
-19122,
-15248,
-11934,
-9394,
-7848,
-7372,
-7722,
-8511,
-9489,
-10757,
-12532,
-14841,
-17403,
-19972,
-22475,
-24996,
-27420,
-29516,
-31173,
-32585,
-34032,
-35582,
-37065,
-38373,
-39535,
-40625,
-41558,
-42206,
-42578,
-42840,
-43017,
-42967,
-42470,
-41579,
-40585,
-39810,
-39380,
-39211,
-39159,
-39132,
-39203,
-39571,
-40412,
-41741,
-43300,
-44816,
-46152,
-47309,
-48191,
-48553,
-48140,
-46891,
-44860,
-41997,
-38221,
-33597,
-28564,
-23716,
-19521,
-16196,
-13736,
-12042,
-10834,
-9903,
-9199,
-9044,
-9763,
-11353,
-13481,
-15748,
-17975,
-20166,
-22233,
-24127,
-25862,
-27601,
-29379,
-31046,
-32407,
-33491,
-34502,
-35594,
-36776,
-37962,
-39158,
-40327,
-41373,
-42189,
-42741,
-43117,
-43293,
-43219,
-42970,
-42814,
-42993,
-43426,
-43741,
-43734,
-43555,
-43596,
-44077,
-44933,
-45999,
-47155,
-48302,
-49184,
-49492,
-49005,
-47736,
-45719,
-42992,
-39486,
-35292,
-30641,
-25896,
-21421,
-17503,
-14270,
-11724,
-9723,
-8175,
-7049,
-6441,
-6496,
-7384,
-9222,
-11902,
-15024,
-18023,
-20543,
-22658,
-24711,
-26883,
-29018,
-30824,
-32244,
-33477,
-34682,
-35782,
-36623,
-37248,
-37916,
-38724,
-39487,
-39903,
-39960,
-39933,
-40020,
-40161,
-40185,
-40238,
-40667,
-41602,
-42673,
-43347,
-43517,
-43663,
-44358,
-45736,
-47493,
-49271,
-50925,
-52367,
-53319,
-53415,
-52496,
-50694,
-48202,
-44981,
-40908,
-36031,
-30778,
-25710,
-21206,
-17363,
-14074,
-11267,
-8944,
-7194,
-6122,
-5802,
-6276,
-7487,
-9362,
-11718,
-14344,
-16974,
-19474,
-21852,
-24273,
-26791,
-29290,
-31514,
-33283,
-34591,
-35583,
-36375,
-37087,
-37749,
-38448,
-39182,
-39919,
-40543,
-40964,
-41117,
-41006,
-40675,
-40253,
-39927,
-39882,
-40192,
-40777,
-41462,
-42175,
-42997,
-44113,
-45623,
-47365,
-49008,
-50262,
-51016,
-51371,
-51385,
-50909,
-49582,
-47070,
-43302,
-38631,
-33584,
-28663,
-24094,
-19953,
-16288,
-13201,
-10740,
-8826,
-7352,
-6372,
-6115,
-6814,
-8452,
-10750,
-13340,
-15992,
-18608,
-21200,
-23736,
-26185,
-28469,
-30546,
-32326,
-33789,
-34884,
-35658,
-36216,
-36741,
-37405,
-38194,
-38949,
-39482,
-39755,
-39898,
-40009,
-40111,
-40159,
-40251,
-40470,
-40881,
-41353,
-41809,
-42298,
-43000,
-44050,
-45456,
-47128,
-48892,
-50533,
-51800,
-52552,
-52755,
-52360,
-51143,
-48836,
-45330,
-40910,
-36026,
-31078,
-26299,
-21851,
-17878,
-14467,
-11595,
-9235,
-7436,
-6345,
-6001,
-6429,
-7579,
-9444,
-11882,
-14599,
-17294,
-19814,
-22241,
-24629,
-26940,
-29047,
-30882,
-32470,
-33864,
-35051,
-36041,
-36810,
-37416,
-37917,
-38464,
-39120,
-39827,
-40353,
-40546,
-40491,
-40439,
-40561,
-40791,
-41032,
-41273,
-41671,
-42259,
-43019,
-43890,
-44935,
-46173,
-47484,
-48650,
-49585,
-50310,
-50839,
-50947,
-50244,
-48428,
-45421,
-41473,
-37011,
-32484,
-28200,
-24190,
-20411,
-16911,
-13875,
-11477,
-9665,
-8330,
-7496,
-7406,
-8248,
-9927,
-12130,
-14544,
-17014,
-19479,
-21875,
-24151,
-26298,
-28335,
-30243,
-32002,
-33580,
-34958,
-36055,
-36829,
-37381,
-37904,
-38507,
-39072,
-39396,
-39407,
-39272,
-39172,
-39217,
-39369,
-39592,
-39841,
-40133,
-40568,
-41315,
-42389,
-43585,
-44567,
-45355,
-46244,
-47506,
-48878,
-49785,
-49878,
-49318,
-48327,
-46761,
-44178,
-40516,
-36315,
-32255,
-28568,
-25030,
-21553,
-18410,
-15978,
-14183,
-12620,
-11039,
-9685,
-9112,
-9604,
-11018,
-12924,
-14983,
-17084,
-19257,
-21535,
-23876,
-26199,
-28469,
-30647,
-32681,
-34422,
-35745,
-36699,
-37475,
-38282,
-39168,
-40007,
-40686,
-41101,
-41187,
-40865,
-40205,
-39487,
-39110,
-39297,
-39973,
-40879,
-41808,
-42688,
-43527,
-44329,
-45121,
-45937,
-46801,
-47632,
-48288,
-48631,
-48547,
-47953,
-46680,
-44585,
-41622,
-37964,
-34017,
-30172,
-26693,
-23536,
-20588,
-17832,
-15414,
-13479,
-11972,
-10762,
-9845,
-9468,
-9855,
-10989,
-12601,
-14442,
-16455,
-18660,
-20973,
-23239,
-25411,
-27588,
-29897,
-32198,
-34229,
-35786,
-36944,
-37914,
-38851,
-39693,
-40339,
-40778,
-41115,
-41411,
-41561,
-41388,
-40870,
-40288,
-39979,
-40134,
-40635,
-41301,
-42113,
-43160,
-44411,
-45623,
-46504,
-47053,
-47499,
-48047,
-48546,
-48606,
-47802,
-46041,
-43457,
-40329,
-36933,
-33427,
-29978,
-26675,
-23609,
-20793,
-18170,
-15700,
-13439,
-11605,
-10406,
-9911,
-9994,
-10497,
-11366,
-12648,
-14342,
-16320,
-18416,
-20489,
-22599,
-24813,
-27223,
-29725,
-32094,
-34106,
-35689,
-37004,
-38266,
-39489,
-40570,
-41347,
-41910,
-42388,
-42816,
-43032,
-42895,
-42486,
-42094,
-41976,
-42213,
-42750,
-43495,
-44348,
-45171,
-45790,
-46152,
-46374,
-46630,
-47001,
-47332,
-47367,
-46831,
-45625,
-43729,
-41208,
-38147,
-34687,
-31082,
-27665,
-24676,
-22180,
-19995,
-17915,
-15839,
-13879,
-12233,
-11086,
-10494,
-10483,
-11025,
-12078,
-13543,
-15208,
-16905,
-18575,
-20335,
-22380,
-24732,
-27171,
-29388,
-31208,
-32757,
-34255,
-35774,
-37217,
-38471,
-39633,
-40879,
-42154,
-43124,
-43409,
-43049,
-42561,
-42489,
-42992,
-43727,
-44333,
-44765,
-45226,
-45800,
-46244,
-46332,
-46137,
-46047,
-46298,
-46680,
-46771,
-46253,
-45154,
-43510,
-41219,
-38177,
-34567,
-30957,
-27840,
-25302,
-23046,
-20777,
-18548,
-16639,
-15244,
-14297,
-13598,
-13052,
-12780,
-12956,
-13660,
-14769,
-16076,
-17404,
-18709,
-20051,
-21561,
-23350,
-25440,
-27715,
-29896,
-31738,
-33157,
-34354,
-35620,
-37128,
-38820,
-40462,
-41862,
-42863,
-43408,
-43523,
-43440,
-43462,
-43858,
-44524,
-45200,
-45655,
-45947,
-46275,
-46706,
-47045,
-47105,
-46865,
-46605,
-46476,
-46403,
-46012,
-44976,
-43182,
-40717,
-37741,
-34429,
-31047,
-27924,
-25298,
-23096,
-21029,
-18886,
-16769,
-15044,
-13906,
-13283,
-12937,
-12817,
-13111,
-13949,
-15223,
-16616,
-17933,
-19166,
-20434,
-21763,
-23159,
-24663,
-26303,
-28014,
-29596,
-31003,
-32339,
-33825,
-35449,
-37062,
-38515,
-39830,
-41022,
-42000,
-42667,
-43174,
-43820,
-44773,
-45787,
-46583,
-47154,
-47778,
-48537,
-49081,
-48979,
-48296,
-47576,
-47302,
-47363,
-47229,
-46462,
-45034,
-43076,
-40671,
-37808,
-34634,
-31415,
-28380,
-25577,
-23008,
-20700,
-18715,
-16999,
-15529,
-14347,
-13606,
-13308,
-13296,
-13458,
-13931,
-14966,
-16548,
-18310,
-19792,
-20923,
-21926,
-23066,
-24344,
-25636,
-26940,
-28399,
-30034,
-31707,
-33188,
-34462,
-35743,
-37217,
-38859,
-40434,
-41682,
-42590,
-43331,
-44198,
-45321,
-46627,
-47934,
-49096,
-50099,
-50856,
-51180,
-50887,
-50097,
-49244,
-48721,
-48458,
-47924,
-46563,
-44221,
-41212,
-37973,
-34863,
-32046,
-29582,
-27343,
-25113,
-22722,
-20306,
-18213,
-16744,
-15906,
-15502,
-15334,
-15330,
-15455,
-15698,
-16103,
-16795,
-17859,
-19188,
-20544,
-21765,
-22851,
-23954,
-25136,
-26382,
-27620,
-28768,
-29821,
-30810,
-31813,
-32891,
-34033,
-35193,
-36433,
-37795,
-39300,
-40758,
-42026,
-43131,
-44221,
-45378,
-46524,
-47613,
-48725,
-49872,
-50769,
-51034,
-50625,
-50007,
-49655,
-49528,
-48988,
-47515,
-45025,
-41889,
-38431,
-34853,
-31350,
-28221,
-25615,
-23414,
-21331,
-19278,
-17415,
-16044,
-15301,
-15119,
-15233,
-15339,
-15328,
-15423,
-16021,
-17321,
-19043,
-20674,
-21950,
-22991,
-24065,
-25232,
-26407,
-27499,
-28576,
-29587,
-30497,
-31353,
-32373,
-33721,
-35181,
-36443,
-37348,
-38124,
-38983,
-39929,
-40838,
-41798,
-43052,
-44700,
-46495,
-48045,
-49140,
-49806,
-50143,
-50245,
-50220,
-50166,
-49995,
-49417,
-48091,
-45913,
-43051,
-39787,
-36461,
-33336,
-30610,
-28158,
-25702,
-23067,
-20480,
-18440,
-17232,
-16755,
-16621,
-16598,
-16646,
-16843,
-17213,
-17782,
-18602,
-19685,
-20940,
-22186,
-23335,
-24409,
-25471,
-26532,
-27502,
-28317,
-28938,
-29466,
-30042,
-30843,
-31912,
-33148,
-34353,
-35390,
-36282,
-37189,
-38279,
-39649,
-41205,
-42792,
-44261,
-45610,
-46869,
-47927,
-48560,
-48617,
-48309,
-48010,
-47923,
-47826,
-47323,
-46190,
-44520,
-42436,
-39970,
-37121,
-34066,
-31134,
-28573,
-26449,
-24675,
-23140,
-21744,
-20465,
-19410,
-18790,
-18687,
-18893,
-19125,
-19310,
-19668,
-20397,
-21360,
-22287,
-23094,
-23960,
-25010,
-26075,
-26915,
-27536,
-28158,
-28898,
-29585,
-30040,
-30336,
-30750,
-31445,
-32360,
-33362,
-34417,
-35497,
-36522,
-37395,
-38249,
-39340,
-40840,
-42633,
-44405,
-45920,
-47085,
-47888,
-48357,
-48571,
-48667,
-48698,
-48507,
-47765,
-46210,
-43816,
-40810,
-37566,
-34434,
-31689,
-29444,
-27651,
-26085,
-24481,
-22681,
-20821,
-19309,
-18534,
-18607,
-19173,
-19812,
-20308,
-20841,
-21628,
-22634,
-23565,
-24228,
-24739,
-25414,
-26357,
-27389,
-28233,
-28879,
-29543,
-30390,
-31281,
-31973,
-32418,
-32870,
-33551,
-34338,
-34904,
-35128,
-35293,
-35809,
-36797,
-38058,
-39426,
-40899,
-42446,
-43804,
-44634,
-44972,
-45183,
-45570,
-46011,
-46173,
-45989,
-45599,
-45024,
-43914,
-41947,
-39227,
-36207,
-33199,
-30232,
-27335,
-24822,
-23023,
-21886,
-21051,
-20287,
-19756,
-19644,
-19873,
-20173,
-20572,
-21370,
-22703,
-24221,
-25401,
-26069,
-26547,
-27180,
-27981,
-28693,
-29129,
-29354,
-29537,
-29832,
-30308,
-30984,
-31795,
-32654,
-33549,
-34538,
-35615,
-36559,
-37123,
-37316,
-37486,
-38043,
-39104,
-40462,
-41866,
-43179,
-44351,
-45207,
-45532,
-45282,
-44734,
-44343,
-44302,
-44341,
-43874,
-42525,
-40431,
-38124,
-35960,
-33835,
-31447,
-28766,
-26223,
-24244,
-22823,
-21614,
-20409,
-19412,
-18944,
-19058,
-19505,
-20120,
-20958,
-22098,
-23420,
-24690,
-25841,
-27030,
-28299,
-29497,
-30365,
-30925,
-31412,
-32002,
-32611,
-32985,
-33021,
-32849,
-32760,
-32998,
-33696,
-34766,
-35993,
-37121,
-38057,
-38887,
-39719,
-40552,
-41343,
-42172,
-43171,
-44311,
-45167,
-45267,
-44502,
-43351,
-42475,
-42124,
-41875,
-41066,
-39329,
-36955,
-34552,
-32516,
-30762,
-28918,
-26836,
-24787,
-23221,
-22306,
-21810,
-21400,
-20986,
-20771,
-20912,
-21363,
-21980,
-22742,
-23766,
-25062,
-26450,
-27699,
-28741,
-29657,
-30502,
-31228,
-31758,
-32135,
-32410,
-32576,
-32593,
-32512,
-32556,
-32894,
-33535,
-34252,
-34857,
-35294,
-35706,
-36303,
-37226,
-38452,
-39804,
-41143,
-42464,
-43861,
-45154,
-45922,
-45787,
-44991,
-44247,
-44067,
-44111,
-43492,
-41626,
-38794,
-35698,
-32785,
-30030,
-27422,
-25230,
-23716,
-22730,
-21804,
-20714,
-19682,
-19085,
-19052,
-19462,
-20294,
-21556,
-23125,
-24597,
-25675,
-26399,
-27115,
-28017,
-29071,
-30134,
-31159,
-32105,
-32896,
-33464,
-33936,
-34430,
-34893,
-35109,
-35054,
-35006,
-35266,
-35742,
-36048,
-35988,
-35829,
-36032,
-36793,
-37920,
-39133,
-40345,
-41596,
-42868,
-43974,
-44722,
-45035,
-45042,
-44976,
-44934,
-44704,
-43824,
-41982,
-39375,
-36555,
-33919,
-31318,
-28443,
-25320,
-22524,
-20568,
-19440,
-18690,
-17983,
-17451,
-17410,
-17963,
-18943,
-20130,
-21454,
-22874,
-24322,
-25675,
-26945,
-28175,
-29378,
-30502,
-31479,
-32324,
-33003,
-33498,
-33835,
-34190,
-34736,
-35479,
-36247,
-36959,
-37680,
-38515,
-39274,
-39624,
-39443,
-39076,
-39084,
-39681,
-40664,
-41655,
-42546,
-43353,
-43953,
-44028,
-43459,
-42580,
-41894,
-41530,
-41105,
-40160,
-38654,
-36864,
-34989,
-32852,
-30211,
-27070,
-23800,
-20894,
-18747,
-17550,
-17205,
-17344,
-17563,
-17749,
-18143,
-19055,
-20451,
-22068,
-23738,
-25484,
-27306,
-28909,
-30055,
-30880,
-31885,
-33260,
-34651,
-35476,
-35608,
-35412,
-35266,
-35190,
-35080,
-35097,
-35528,
-36442,
-37452,
-38209,
-38705,
-39240,
-39980,
-40821,
-41631,
-42440,
-43289,
-44092,
-44609,
-44794,
-44764,
-44615,
-44245,
-43482,
-42366,
-41058,
-39657,
-38006,
-35918,
-33408,
-30676,
-27934,
-25261,
-22743,
-20583,
-18956,
-17856,
-17034,
-16292,
-15734,
-15651,
-16242,
-17336,
-18628,
-19936,
-21389,
-23176,
-25254,
-27359,
-29237,
-30869,
-32410,
-33896,
-35200,
-36138,
-36656,
-36872,
-36851,
-36673,
-36398,
-36296,
-36576,
-37291,
-38197,
-38979,
-39531,
-39948,
-40428,
-41060,
-41858,
-42801,
-43879,
-44957,
-45821,
-46245,
-46143,
-45586,
-44718,
-43670,
-42522,
-41263,
-39726,
-37698,
-35112,
-32162,
-29237,
-26562,
-24121,
-21823,
-19727,
-18044,
-16858,
-16034,
-15396,
-15036,
-15196,
-16045,
-17419,
-19029,
-20683,
-22371,
-24129,
-25909,
-27677,
-29440,
-31228,
-32983,
-34557,
-35763,
-36524,
-36837,
-36867,
-36822,
-36875,
-37082,
-37455,
-38015,
-38831,
-39725,
-40391,
-40584,
-40464,
-40396,
-40581,
-40853,
-41108,
-41574,
-42629,
-44168,
-45516,
-46033,
-45656,
-44863,
-43955,
-42843,
-41353,
-39610,
-37855,
-36046,
-33819,
-30974,
-27728,
-24532,
-21668,
-19257,
-17430,
-16346,
-15909,
-15755,
-15647,
-15739,
-16434,
-17786,
-19419,
-20941,
-22323,
-23863,
-25657,
-27485,
-29074,
-30422,
-31739,
-33093,
-34322,
-35219,
-35853,
-36428,
-37052,
-37539,
-37663,
-37479,
-37317,
-37545,
-38159,
-38929,
-39626,
-40280,
-40993,
-41746,
-42379,
-42877,
-43446,
-44247,
-45129,
-45692,
-45747,
-45507,
-45319,
-45180,
-44659,
-43348,
-41198,
-38557,
-35736,
-32823,
-29801,
-26720,
-23811,
-21251,
-19118,
-17376,
-15994,
-15013,
-14466,
-14373,
-14686,
-15311,
-16186,
-17308,
-18752,
-20579,
-22689,
-24816,
-26672,
-28217,
-29627,
-31151,
-32745,
-34179,
-35241,
-36041,
-36753,
-37406,
-37801,
-37885,
-37981,
-38461,
-39325,
-40149,
-40650,
-41058,
-41745,
-42678,
-43355,
-43500,
-43526,
-44033,
-45074,
-46008,
-46288,
-46069,
-45884,
-45822,
-45346,
-43895,
-41558,
-38941,
-36520,
-34269,
-31848,
-29074,
-26032,
-23048,
-20421,
-18344,
-16804,
-15642,
-14810,
-14396,
-14543,
-15174,
-16039,
-17051,
-18383,
-20257,
-22507,
-24719,
-26526,
-28000,
-29322,
-30561,
-31569,
-32321,
-33033,
-33947,
-35083,
-36167,
-36933,
-37300,
-37441,
-37589,
-37897,
-38360,
-38893,
-39490,
-40204,
-41044,
-41801,
-42273,
-42499,
-42842,
-43573,
-44517,
-45196,
-45339,
-45158,
-45012,
-44959,
-44672,
-43838,
-42363,
-40347,
-37866,
-35084,
-32250,
-29619,
-27171,
-24732,
-22247,
-19944,
-18062,
-16598,
-15430,
-14617,
-14407,
-14928,
-15964,
-17246,
-18705,
-20462,
-22437,
-24312,
-25820,
-26970,
-27988,
-28987,
-29965,
-30935,
-31973,
-33033,
-34014,
-34864,
-35738,
-36730,
-37680,
-38329,
-38715,
-39149,
-39855,
-40682,
-41377,
-41988,
-42766,
-43707,
-44428,
-44599,
-44393,
-44257,
-44381,
-44532,
-44485,
-44297,
-44124,
-43791,
-42908,
-41292,
-39138,
-36803,
-34405,
-31960,
-29513,
-27137,
-24791,
-22339,
-19907,
-17832,
-16399,
-15543,
-15090,
-15088,
-15784,
-17160,
-18792,
-20279,
-21625,
-23187,
-25097,
-27090,
-28791,
-30119,
-31235,
-32285,
-33246,
-34094,
-34810,
-35426,
-35846,
-36104,
-36231,
-36342,
-36413,
-36530,
-36831,
-37471,
-38296,
-39028,
-39556,
-40088,
-40814,
-41612,
-42192,
-42598,
-43115,
-43907,
-44620,
-44825,
-44548,
-44156,
-43862,
-43318,
-42142,
-40348,
-38339,
-36311,
-34113,
-31548,
-28752,
-26020,
-23492,
-21140,
-19024,
-17424,
-16512,
-16227,
-16399,
-16975,
-17955,
-19170,
-20353,
-21462,
-22719,
-24354,
-26180,
-27854,
-29190,
-30328,
-31447,
-32457,
-33211,
-33689,
-34109,
-34596,
-35119,
-35587,
-36014,
-36479,
-36976,
-37449,
-37919,
-38461,
-39088,
-39636,
-39910,
-39925,
-39881,
-40076,
-40652,
-41556,
-42560,
-43377,
-43785,
-43781,
-43489,
-43092,
-42610,
-41992,
-41181,
-40118,
-38733,
-36823,
-34269,
-31155,
-27800,
-24682,
-22151,
-20362,
-19175,
-18342,
-17653,
-17106,
-16861,
-17028,
-17655,
-18685,
-20107,
-21862,
-23778,
-25620,
-27221,
-28563,
-29733,
-30765,
-31678,
-32522,
-33280,
-33924,
-34347,
-34655,
-35069,
-35783,
-36682,
-37527,
-38182,
-38801,
-39510,
-40273,
-40885,
-41329,
-41751,
-42303,
-42922,
-43482,
-43918,
-44237,
-44335,
-44035,
-43307,
-42338,
-41350,
-40327,
-39134,
-37735,
-36306,
-34951,
-33487,
-31616,
-29239,
-26649,
-24271,
-22375,
-20969,
-19931,
-19150,
-18595,
-18329,
-18448,
-18972,
-19771,
-20634,
-21467,
-22372,
-23528,
-24963,
-26544,
-28084,
-29511,
-30805,
-31972,
-32977,
-33842,
-34595,
-35309,
-36047,
-36839,
-37657,
-38360,
-38875,
-39294,
-39809,
-40426,
-40904,
-41010,
-40905,
-41041,
-41603,
-42308,
-42629,
-42455,
-42074,
-41773,
-41450,
-40911,
-40168,
-39475,
-38840,
-37982,
-36664,
-35001,
-33272,
-31490,
-29483,
-27279,
-25256,
-23731,
-22540,
-21323,
-20047,
-19115,
-18875,
-19195,
-19730,
-20419,
-21497,
-23093,
-24912,
-26586,
-27962,
-29178,
-30289,
-31190,
-31845,
-32375,
-32954,
-33553,
-34063,
-34424,
-34747,
-35112,
-35548,
-36088,
-36759,
-37485,
-38047,
-38334,
-38521,
-38876,
-39399,
-39815,
-39946,
-39990,
-40222,
-40534,
-40480,
-39778,
-38699,
-37757,
-37240,
-36987,
-36772,
-36524,
-36287,
-36024,
-35561,
-34813,
-33749,
-32464,
-31028,
-29630,
-28404,
-27374,
-26365,
-25287,
-24314,
-23776,
-23837,
-24300,
-24826,
-25157,
-25317,
-25425,
-25684,
-26231,
-27078,
-28070,
-28941,
-29581,
-29991,
-30215,
-30147,
-29750,
-29215,
-28930,
-29085,
-29509,
-29861,
-30058,
-30358,
-31057,
-32255,
-33755,
-35354,
-36910,
-38403,
-39935,
-41624,
-43490,
-45297,
-46644,
-47289,
-47333,
-47095,
-46801,
-46427,
-45864,
-45025,
-43840,
-42153,
-39793,
-36820,
-33565,
-30482,
-27818,
-25610,
-23736,
-22175,
-20987,
-20276,
-20022,
-20153,
-20453,
-20827,
-21177,
-21526,
-21908,
-22426,
-23207,
-24310,
-25607,
-26823,
-27770,
-28497,
-29189,
-29902,
-30499,
-30881,
-31171,
-31661,
-32448,
-33405,
-34343,
-35263,
-36332,
-37591,
-38878,
-39895,
-40419,
-40405,
-40029,
-39671,
-39719,
-40277,
-41024,
-41490,
-41473,
-41155,
-40823,
-40513,
-40116,
-39668,
-39321,
-39144,
-38796,
-37897,
-36372,
-34602,
-32989,
-31663,
-30448,
-29182,
-27844,
-26502,
-25235,
-24245,
-23787,
-23983,
-24610,
-25167,
-25391,
-25416,
-25681,
-26383,
-27333,
-28109,
-28528,
-28660,
-28710,
-28706,
-28587,
-28363,
-28173,
-28187,
-28399,
-28764,
-29214,
-29739,
-30232,
-30559,
-30750,
-31114,
-31954,
-33285,
-34776,
-36192,
-37628,
-39293,
-41092,
-42642,
-43666,
-44350,
-45026,
-45741,
-46236,
-46352,
-46237,
-46078,
-45682,
-44675,
-42904,
-40666,
-38264,
-35725,
-32888,
-29860,
-27034,
-24746,
-22982,
-21581,
-20557,
-20072,
-20152,
-20502,
-20833,
-21124,
-21584,
-22316,
-23163,
-23879,
-24458,
-25109,
-26078,
-27346,
-28697,
-29872,
-30839,
-31712,
-32639,
-33535,
-34285,
-34829,
-35328,
-35928,
-36610,
-37281,
-37914,
-38607,
-39274,
-39635,
-39451,
-38816,
-38043,
-37270,
-36407,
-35475,
-34896,
-35061,
-35858,
-36639,
-36928,
-36907,
-37078,
-37630,
-38254,
-38627,
-38741,
-38691,
-38338,
-37356,
-35769,
-33922,
-32240,
-30765,
-29426,
-28253,
-27429,
-26959,
-26655,
-26422,
-26414,
-26769,
-27300,
-27666,
-27790,
-27952,
-28335,
-28703,
-28643,
-28107,
-27466,
-27089,
-26929,
-26721,
-26362,
-26085,
-26087,
-26393,
-26838,
-27370,
-28087,
-29071,
-30366,
-31957,
-33809,
-35825,
-37808,
-39571,
-41032,
-42185,
-42988,
-43409,
-43484,
-43465,
-43629,
-44131,
-44823,
-45367,
-45374,
-44686,
-43380,
-41766,
-40014,
-38101,
-35836,
-33272,
-30710,
-28571,
-26911,
-25529,
-24237,
-23191,
-22670,
-22683,
-22869,
-22885,
-22765,
-22900,
-23496,
-24394,
-25233,
-25893,
-26560,
-27402,
-28289,
-28915,
-29133,
-29148,
-29280,
-29683,
-30250,
-30828,
-31409,
-32100,
-32967,
-33920,
-34825,
-35649,
-36498,
-37430,
-38321,
-38869,
-38892,
-38501,
-38028,
-37741,
-37659,
-37685,
-37823,
-38173,
-38731,
-39296,
-39610,
-39647,
-39533,
-39399,
-39185,
-38837,
-38336,
-37678,
-36740,
-35394,
-33761,
-32111,
-30589,
-29074,
-27450,
-26022,
-25227,
-25155,
-25350,
-25360,
-25332,
-25768,
-26803,
-27891,
-28404,
-28322,
-28147,
-28204,
-28299,
-28088,
-27599,
-27130,
-26854,
-26655,
-26450,
-26349,
-26487,
-26866,
-27457,
-28434,
-29956,
-31802,
-33477,
-34696,
-35777,
-37192,
-39012,
-40790,
-42097,
-42942,
-43519,
-43953,
-44191,
-44281,
-44342,
-44298,
-43918,
-43091,
-42038,
-41021,
-39936,
-38452,
-36513,
-34477,
-32720,
-31202,
-29603,
-27897,
-26400,
-25422,
-24863,
-24420,
-23980,
-23694,
-23677,
-23864,
-24127,
-24490,
-25015,
-25625,
-26167,
-26645,
-27251,
-28128,
-29184,
-30168,
-30943,
-31481,
-31796,
-31858,
-31763,
-31736,
-31978,
-32468,
-33008,
-33427,
-33698,
-33841,
-33860,
-33775,
-33718,
-33816,
-34079,
-34383,
-34604,
-34796,
-35055,
-35504,
-36152,
-37018,
-38039,
-39132,
-40141,
-40989,
-41641,
-42074,
-42241,
-42109,
-41767,
-41239,
-40436,
-39118,
-37262,
-35098,
-33048,
-31289,
-29776,
-28401,
-27205,
-26281,
-25640,
-25174,
-24914,
-24954,
-25316,
-25755,
-26004,
-25934,
-25707,
-25421,
-25090,
-24744,
-24503,
-24558,
-24839,
-25161,
-25418,
-25784,
-26454,
-27440,
-28549,
-29695,
-30970,
-32515,
-34300,
-36146,
-37893,
-39420,
-40699,
-41750,
-42727,
-43754,
-44725,
-45282,
-45145,
-44420,
-43551,
-42944,
-42696,
-42653,
-42609,
-42323,
-41540,
-40022,
-37824,
-35262,
-32761,
-30610,
-28857,
-27448,
-26214,
-25025,
-23861,
-22850,
-22137,
-21675,
-21347,
-21154,
-21380,
-22182,
-23429,
-24696,
-25776,
-26783,
-27879,
-28997,
-29896,
-30517,
-30983,
-31419,
-31773,
-32026,
-32325,
-32819,
-33429,
-33959,
-34377,
-34901,
-35587,
-36174,
-36348,
-36186,
-36160,
-36480,
-36875,
-36800,
-36146,
-35313,
-34819,
-34833,
-35170,
-35712,
-36497,
-37675,
-39140,
-40565,
-41574,
-41989,
-41897,
-41514,
-40990,
-40377,
-39621,
-38662,
-37303,
-35353,
-32727,
-29778,
-27106,
-25198,
-24072,
-23426,
-23031,
-22886,
-23015,
-23283,
-23575,
-23977,
-24719,
-25775,
-26788,
-27369,
-27507,
-27471,
-27497,
-27554,
-27545,
-27482,
-27537,
-27805,
-28317,
-28984,
-29738,
-30471,
-31205,
-32070,
-33252,
-34749,
-36354,
-37860,
-39216,
-40429,
-41432,
-42125,
-42631,
-43229,
-44023,
-44739,
-44973,
-44683,
-44194,
-43818,
-43465,
-42812,
-41653,
-40078,
-38275,
-36334,
-34297,
-32227,
-30249,
-28460,
-26925,
-25644,
-24508,
-23313,
-21983,
-20732,
-20015,
-20075,
-20724,
-21534,
-22266,
-23005,
-23920,
-24995,
-26051,
-27029,
-27991,
-28998,
-29978,
-30775,
-31440,
-32168,
-33217,
-34590,
-35988,
-37038,
-37493,
-37490,
-37312,
-37147,
-36959,
-36639,
-36233,
-35917,
-35781,
-35728,
-35631,
-35472,
-35342,
-35244,
-35166,
-35126,
-35278,
-35635,
-36104,
-36603,
-37289,
-38372,
-39695,
-40771,
-41105,
-40725,
-39967,
-39088,
-38031,
-36692,
-35181,
-33671,
-32174,
-30522,
-28772,
-27255,
-26283,
-25793,
-25439,
-25000,
-24559,
-24265,
-24069,
-23876,
-23744,
-23947,
-24590,
-25407,
-25994,
-26166,
-26144,
-26237,
-26571,
-27057,
-27633,
-28412,
-29557,
-31057,
-32622,
-33951,
-34976,
-35986,
-37344,
-39097,
-40887,
-42225,
-42921,
-43181,
-43290,
-43224,
-42738,
-41694,
-40409,
-39354,
-38781,
-38408,
-37842,
-36886,
-35770,
-34810,
-34163,
-33752,
-33428,
-33043,
-32489,
-31704,
-30743,
-29786,
-28977,
-28297,
-27615,
-26886,
-26219,
-25792,
-25595,
-25548,
-25578,
-25816,
-26392,
-27284,
-28253,
-29074,
-29762,
-30493,
-31421,
-32417,
-33185,
-33544,
-33571,
-33526,
-33554,
-33571,
-33436,
-33156,
-32912,
-32820,
-32743,
-32471,
-31909,
-31319,
-30995,
-31076,
-31398,
-31646,
-31607,
-31296,
-30980,
-31076,
-31907,
-33434,
-35280,
-36929,
-38102,
-38851,
-39405,
-39985,
-40693,
-41562,
-42445,
-43095,
-43239,
-42858,
-42098,
-41147,
-39934,
-38370,
-36467,
-34448,
-32456,
-30440,
-28306,
-26162,
-24310,
-22964,
-22075,
-21443,
-20922,
-20507,
-20193,
-19990,
-19969,
-20242,
-20918,
-21864,
-22987,
-24219,
-25713,
-27510,
-29532,
-31582,
-33549,
-35419,
-37143,
-38593,
-39618,
-40172,
-40389,
-40467,
-40657,
-41036,
-41566,
-41973,
-42027,
-41600,
-40797,
-39796,
-38820,
-38097,
-37824,
-38052,
-38547,
-38908,
-38884,
-38496,
-37940,
-37274,
-36362,
-35135,
-33667,
-32208,
-30787,
-29369,
-27918,
-26654,
-25792,
-25303,
-24870,
-24197,
-23341,
-22628,
-22415,
-22752,
-23447,
-24164,
-24693,
-24966,
-25153,
-25418,
-25812,
-26181,
-26377,
-26513,
-26868,
-27586,
-28492,
-29321,
-30141,
-31314,
-33039,
-35042,
-36818,
-38253,
-39698,
-41495,
-43516,
-45232,
-46321,
-46803,
-46842,
-46438,
-45584,
-44496,
-43515,
-42723,
-41855,
-40642,
-39155,
-37691,
-36415,
-35246,
-34176,
-33276,
-32601,
-31867,
-30747,
-29223,
-27697,
-26551,
-25820,
-25281,
-24745,
-24281,
-23959,
-23814,
-23795,
-23902,
-24107,
-24337,
-24533,
-24729,
-25020,
-25417,
-25863,
-26384,
-27101,
-28077,
-29161,
-30077,
-30691,
-31019,
-31207,
-31404,
-31823,
-32680,
-33971,
-35392,
-36639,
-37599,
-38445,
-39116,
-39391,
-39120,
-38704,
-38730,
-39441,
-40414,
-41103,
-41380,
-41555,
-41825,
-42039,
-41953,
-41662,
-41438,
-41345,
-41032,
-40122,
-38609,
-36820,
-35063,
-33399,
-31744,
-30115,
-28552,
-27114,
-25752,
-24567,
-23700,
-23306,
-23297,
-23491,
-23750,
-24080,
-24525,
-25040,
-25513,
-25945,
-26395,
-26864,
-27168,
-27108,
-26685,
-26240,
-26094,
-26358,
-26818,
-27267,
-27644,
-28075,
-28659,
-29454,
-30509,
-31897,
-33564,
-35319,
-36909,
-38332,
-39770,
-41483,
-43423,
-45340,
-46910,
-47980,
-48593,
-48815,
-48733,
-48378,
-47805,
-47036,
-46021,
-44622,
-42661,
-40043,
-36845,
-33390,
-30125,
-27460,
-25520,
-24120,
-22914,
-21696,
-20564,
-19855,
-19803,
-20352,
-21171,
-21945,
-22591,
-23217,
-23960,
-24792,
-25643,
-26416,
-27101,
-27662,
-28037,
-28208,
-28195,
-28150,
-28194,
-28419,
-28820,
-29340,
-29953,
-30685,
-31563,
-32535,
-33442,
-34248,
-35079,
-36173,
-37558,
-38967,
-40135,
-41047,
-42000,
-43143,
-44352,
-45343,
-46033,
-46529,
-46839,
-46784,
-46261,
-45530,
-45021,
-44814,
-44451,
-43296,
-41093,
-38124,
-34862,
-31659,
-28671,
-25998,
-23678,
-21687,
-19965,
-18550,
-17540,
-16963,
-16687,
-16607,
-16838,
-17578,
-18874,
-20409,
-21805,
-22903,
-23893,
-25005,
-26296,
-27613,
-28799,
-29820,
-30706,
-31537,
-32339,
-33236,
-34305,
-35640,
-37217,
-38972,
-40738,
-42328,
-43516,
-44252,
-44652,
-44935,
-45203,
-45338,
-45177,
-44692,
-44027,
-43272,
-42376,
-41196,
-39795,
-38377,
-37069,
-35804,
-34400,
-32935,
-31681,
-30802,
-30133,
-29322,
-28236,
-27079,
-26069,
-25230,
-24409,
-23625,
-23118,
-23082,
-23355,
-23580,
-23499,
-23289,
-23341,
-23943,
-25063,
-26441,
-27861,
-29264,
-30699,
-32145,
-33424,
-34350,
-34884,
-35219,
-35573,
-35992,
-36322,
-36391,
-36199,
-35873,
-35528,
-35175,
-34800,
-34462,
-34338,
-34628,
-35457,
-36740,
-38107,
-39065,
-39256,
-38733,
-37857,
-37024,
-36437,
-36123,
-36070,
-36159,
-36118,
-35645,
-34678,
-33521,
-32536,
-31860,
-31384,
-31019,
-30816,
-30738,
-30570,
-30057,
-29260,
-28474,
-27898,
-27441,
-26947,
-26507,
-26364,
-26502,
-26574,
-26273,
-25775,
-25614,
-26144,
-27213,
-28371,
-29348,
-30199,
-31095,
-32099,
-33154,
-34273,
-35547,
-37007,
-38480,
-39626,
-40156,
-40057,
-39544,
-38964,
-38484,
-38124,
-37807,
-37540,
-37297,
-36937,
-36172,
-34884,
-33319,
-31994,
-31267,
-31030,
-30886,
-30576,
-30230,
-30143,
-30361,
-30625,
-30685,
-30682,
-31065,
-32077,
-33396,
-34335,
-34434,
-33898,
-33352,
-33281,
-33708,
-34298,
-34716,
-34753,
-34292,
-33278,
-31814,
-30161,
-28600,
-27276,
-26279,
-25682,
-25561,
-25838,
-26310,
-26842,
-27446,
-28116,
-28695,
-28987,
-29111,
-29434,
-30295,
-31582,
-32993,
-34324,
-35644,
-36986,
-38160,
-38919,
-39214,
-39212,
-39040,
-38724,
-38358,
-38160,
-38273,
-38530,
-38630,
-38432,
-38103,
-37754,
-37348,
-36729,
-35977,
-35270,
-34720,
-34186,
-33594,
-33025,
-32648,
-32458,
-32268,
-31947,
-31506,
-31004,
-30391,
-29614,
-28746,
-27941,
-27272,
-26685,
-26099,
-25607,
-25317,
-25268,
-25320,
-25250,
-24912,
-24317,
-23665,
-23273,
-23365,
-23982,
-25009,
-26333,
-27887,
-29537,
-31093,
-32487,
-33895,
-35575,
-37539,
-39513,
-41314,
-42973,
-44572,
-45849,
-46348,
-45993,
-45252,
-44734,
-44519,
-44176,
-43309,
-41943,
-40341,
-38572,
-36578,
-34460,
-32561,
-31187,
-30282,
-29674,
-29280,
-29175,
-29256,
-29240,
-28926,
-28403,
-27917,
-27463,
-26894,
-26153,
-25528,
-25337,
-25574,
-25930,
-26128,
-26193,
-26278,
-26436,
-26596,
-26740,
-27019,
-27511,
-28163,
-28796,
-29409,
-30102,
-30979,
-31876,
-32533,
-32755,
-32495,
-31840,
-30864,
-29802,
-28954,
-28661,
-29038,
-29961,
-31258,
-32790,
-34570,
-36590,
-38795,
-41087,
-43285,
-45288,
-47093,
-48910,
-50879,
-52789,
-54057,
-54094,
-52835,
-50637,
-47853,
-44503,
-40492,
-36098,
-31880,
-28281,
-25230,
-22494,
-20125,
-18499,
-17901,
-18131,
-18718,
-19262,
-19608,
-19705,
-19505,
-19111,
-18742,
-18694,
-19058,
-19847,
-20982,
-22367,
-23738,
-24887,
-25794,
-26791,
-28219,
-30216,
-32686,
-35474,
-38399,
-41125,
-43212,
-44362,
-44633,
-44304,
-43654,
-42872,
-42146,
-41629,
-41276,
-40878,
-40381,
-39978,
-39918,
-40113,
-40273,
-40373,
-40761,
-41730,
-42927,
-43567,
-43077,
-41503,
-39282,
-36712,
-33929,
-31081,
-28392,
-25975,
-23784,
-21851,
-20450,
-19821,
-19893,
-20325,
-20922,
-21726,
-22793,
-23889,
-24758,
-25373,
-25961,
-26590,
-27094,
-27309,
-27412,
-27693,
-28238,
-28843,
-29389,
-29958,
-30751,
-31776,
-32964,
-34311,
-35766,
-37123,
-38101,
-38784,
-39656,
-41039,
-42580,
-43465,
-43239,
-42157,
-40811,
-39503,
-38309,
-37506,
-37490,
-38231,
-38969,
-38870,
-37930,
-36938,
-36582,
-36715,
-36730,
-36336,
-35705,
-34924,
-33663,
-31668,
-29342,
-27485,
-26491,
-25923,
-25159,
-24070,
-23072,
-22462,
-22096,
-21704,
-21395,
-21503,
-22240,
-23430,
-24870,
-26452,
-28184,
-29874,
-31319,
-32536,
-33699,
-34954,
-36160,
-37150,
-37973,
-38789,
-39600,
-40176,
-40295,
-40023,
-39580,
-39106,
-38553,
-37836,
-36985,
-36134,
-35420,
-34984,
-34794,
-34645,
-34128,
-33046,
-31595,
-30294,
-29442,
-28957,
-28584,
-28319,
-28379,
-28794,
-29253,
-29416,
-29332,
-29413,
-29994,
-31055,
-32334,
-33666,
-34982,
-36188,
-37061,
-37454,
-37368,
-36971,
-36343,
-35526,
-34548,
-33533,
-32563,
-31726,
-31034,
-30586,
-30412,
-30463,
-30600,
-30758,
-30998,
-31418,
-31959,
-32445,
-32656,
-32592,
-32354,
-32127,
-31954,
-31835,
-31702,
-31526,
-31227,
-30748,
-30066,
-29300,
-28600,
-28124,
-27900,
-27996,
-28420,
-29187,
-30139,
-31123,
-32045,
-32967,
-33889,
-34694,
-35251,
-35647,
-36140,
-36890,
-37790,
-38607,
-39310,
-40019,
-40788,
-41435,
-41694,
-41504,
-40938,
-40097,
-38970,
-37599,
-36086,
-34515,
-32853,
-31137,
-29518,
-28166,
-26958,
-25575,
-23942,
-22416,
-21556,
-21525,
-22030,
-22738,
-23591,
-24785,
-26316,
-27950,
-29377,
-30482,
-31328,
-32032,
-32721,
-33478,
-34325,
-35196,
-36018,
-36757,
-37354,
-37664,
-37616,
-37366,
-37280,
-37544,
-37986,
-38306,
-38369,
-38300,
-38080,
-37557,
-36619,
-35531,
-34595,
-33886,
-33122,
-32188,
-31273,
-30684,
-30445,
-30418,
-30535,
-30910,
-31500,
-31995,
-32097,
-31813,
-31344,
-30813,
-30171,
-29467,
-28962,
-28824,
-28968,
-29139,
-29234,
-29318,
-29414,
-29450,
-29455,
-29653,
-30218,
-31044,
-31896,
-32690,
-33509,
-34295,
-34783,
-34789,
-34518,
-34301,
-34220,
-34090,
-33807,
-33569,
-33556,
-33592,
-33385,
-32879,
-32412,
-32308,
-32528,
-32904,
-33266,
-33651,
-33968,
-34159,
-34258,
-34466,
-34822,
-35185,
-35414,
-35687,
-36268,
-37150,
-37959,
-38395,
-38479,
-38414,
-38230,
-37751,
-36915,
-35829,
-34619,
-33273,
-31749,
-30173,
-28661,
-27184,
-25648,
-24162,
-23040,
-22429,
-22145,
-21957,
-21959,
-22454,
-23489,
-24722,
-25831,
-26796,
-27750,
-28554,
-28896,
-28757,
-28588,
-28935,
-29912,
-31308,
-32843,
-34430,
-35919,
-37144,
-38023,
-38789,
-39653,
-40655,
-41699,
-42825,
-44142,
-45519,
-46506,
-46849,
-46752,
-46601,
-46417,
-45757,
-44411,
-42641,
-40928,
-39333,
-37513,
-35285,
-32873,
-30654,
-28744,
-27022,
-25454,
-24075,
-22842,
-21577,
-20247,
-19048,
-18119,
-17408,
-16828,
-16641,
-17218,
-18503,
-19914,
-20877,
-21510,
-22394,
-23923,
-25884,
-27824,
-29595,
-31328,
-33184,
-35084,
-36934,
-38642,
-40193,
-41476,
-42504,
-43296,
-43850,
-43942,
-43480,
-42717,
-42151,
-42005,
-41943,
-41499,
-40551,
-39464,
-38566,
-37944,
-37507,
-37315,
-37425,
-37756,
-37966,
-37829,
-37326,
-36573,
-35729,
-34913,
-34307,
-33918,
-33466,
-32614,
-31249,
-29694,
-28231,
-26926,
-25640,
-24449,
-23592,
-23203,
-23042,
-22802,
-22429,
-22190,
-22291,
-22688,
-23197,
-23746,
-24377,
-25107,
-25854,
-26606,
-27425,
-28365,
-29297,
-30021,
-30510,
-30995,
-31783,
-32979,
-34391,
-35735,
-36837,
-37703,
-38367,
-38820,
-39057,
-39271,
-39791,
-40801,
-42125,
-43290,
-44016,
-44370,
-44667,
-44999,
-45223,
-45147,
-44805,
-44264,
-43455,
-42181,
-40451,
-38511,
-36599,
-34620,
-32336,
-29723,
-27092,
-24773,
-22788,
-21016,
-19473,
-18436,
-18088,
-18323,
-18799,
-19281,
-19735,
-20240,
-20899,
-21834,
-23144,
-24774,
-26445,
-27848,
-28884,
-29687,
-30438,
-31237,
-32138,
-33228,
-34494,
-35746,
-36713,
-37325,
-37731,
-38081,
-38348,
-38426,
-38377,
-38401,
-38555,
-38679,
-38649,
-38623,
-38902,
-39511,
-40101,
-40266,
-39955,
-39460,
-39064,
-38884,
-38917,
-39198,
-39703,
-40230,
-40440,
-40133,
-39303,
-38075,
-36504,
-34626,
-32505,
-30324,
-28233,
-26394,
-24854,
-23614,
-22531,
-21480,
-20464,
-19667,
-19273,
-19297,
-19637,
-20271,
-21257,
-22633,
-24179,
-25676,
-26981,
-28157,
-29200,
-30014,
-30522,
-30881,
-31338,
-32069,
-33059,
-34242,
-35630,
-37167,
-38689,
-39963,
-40938,
-41753,
-42543,
-43228,
-43590,
-43528,
-43208,
-42886,
-42675,
-42396,
-41828,
-40905,
-39857,
-38906,
-38058,
-37073,
-35814,
-34479,
-33485,
-33002,
-32796,
-32423,
-31684,
-30646,
-29433,
-28047,
-26481,
-24972,
-23798,
-23066,
-22586,
-22128,
-21738,
-21570,
-21731,
-22127,
-22688,
-23474,
-24590,
-26025,
-27596,
-29141,
-30560,
-31838,
-32954,
-33890,
-34658,
-35294,
-35842,
-36269,
-36460,
-36295,
-35779,
-35229,
-35043,
-35468,
-36345,
-37386,
-38427,
-39425,
-40172,
-40238,
-39473,
-38338,
-37673,
-37870,
-38527,
-38971,
-38841,
-38335,
-37593,
-36578,
-35275,
-34015,
-33233,
-33009,
-32941,
-32618,
-31931,
-31057,
-30203,
-29457,
-28899,
-28451,
-27933,
-27129,
-26114,
-25184,
-24523,
-24054,
-23672,
-23566,
-24054,
-25098,
-26259,
-27164,
-27903,
-28804,
-29915,
-30946,
-31748,
-32553,
-33666,
-34999,
-36169,
-36952,
-37484,
-37966,
-38363,
-38525,
-38462,
-38293,
-38013,
-37458,
-36614,
-35789,
-35343,
-35303,
-35393,
-35356,
-35213,
-35045,
-34743,
-34078,
-32955,
-31674,
-30703,
-30384,
-30663,
-31170,
-31497,
-31534,
-31524,
-31743,
-32174,
-32445,
-32357,
-32157,
-32394,
-33247,
-34314,
-34990,
-35051,
-34743,
-34265,
-33564,
-32488,
-31208,
-30123,
-29403,
-28802,
-27969,
-26904,
-25975,
-25533,
-25641,
-26184,
-27038,
-28067,
-29007,
-29607,
-29919,
-30371,
-31311,
-32684,
-34043,
-35123,
-36018,
-36961,
-37929,
-38669,
-39112,
-39408,
-39652,
-39619,
-39064,
-38225,
-37667,
-37693,
-37865,
-37533,
-36541,
-35355,
-34383,
-33491,
-32351,
-31099,
-30307,
-30281,
-30624,
-30692,
-30334,
-29968,
-29981,
-30313,
-30674,
-30998,
-31383,
-31812,
-32005,
-31863,
-31587,
-31509,
-31646,
-31718,
-31491,
-30978,
-30307,
-29541,
-28735,
-28068,
-27752,
-27806,
-27948,
-27882,
-27526,
-27078,
-26859,
-27108,
-27878,
-29011,
-30214,
-31289,
-32183,
-33023,
-33840,
-34663,
-35542,
-36669,
-38136,
-39829,
-41476,
-42873,
-43975,
-44703,
-44917,
-44566,
-43831,
-43012,
-42223,
-41330,
-40162,
-38725,
-37120,
-35439,
-33755,
-32197,
-30882,
-29781,
-28695,
-27560,
-26490,
-25670,
-25130,
-24740,
-24494,
-24357,
-24250,
-23889,
-23216,
-22506,
-22163,
-22296,
-22649,
-23008,
-23470,
-24254,
-25408,
-26773,
-28279,
-30005,
-31940,
-33822,
-35330,
-36386,
-37169,
-37863,
-38489,
-39014,
-39423,
-39676,
-39639,
-39260,
-38650,
-38062,
-37610,
-37261,
-36985,
-36771,
-36531,
-36020,
-35192,
-34421,
-34312,
-35075,
-36302,
-37387,
-38026,
-38309,
-38288,
-37880,
-37169,
-36522,
-36369,
-36575,
-36618,
-35993,
-34737,
-33174,
-31598,
-30116,
-28833,
-27832,
-27086,
-26338,
-25495,
-24709,
-24261,
-24165,
-24135,
-23977,
-23781,
-23760,
-23861,
-23794,
-23381,
-22821,
-22501,
-22622,
-23089,
-23712,
-24489,
-25592,
-27156,
-29083,
-31018,
-32619,
-33768,
-34718,
-35815,
-37224,
-38809,
-40385,
-41985,
-43835,
-45990,
-48157,
-49847,
-50764,
-50922,
-50575,
-50015,
-49547,
-49404,
-49451,
-49185,
-47922,
-45413,
-42037,
-38414,
-34981,
-31717,
-28560,
-25563,
-22929,
-20711,
-18894,
-17511,
-16783,
-16772,
-17198,
-17479,
-17217,
-16520,
-15862,
-15678,
-16025,
-16741,
-17687,
-18935,
-20545,
-22414,
-24273,
-25984,
-27623,
-29396,
-31374,
-33482,
-35699,
-38070,
-40577,
-42974,
-44928,
-46387,
-47516,
-48404,
-48785,
-48390,
-47385,
-46433,
-45990,
-45893,
-45513,
-44561,
-43330,
-42297,
-41619,
-41106,
-40616,
-40194,
-39684,
-38686,
-36721,
-33839,
-30501,
-27254,
-24445,
-22228,
-20801,
-20098,
-19747,
-19263,
-18559,
-18104,
-18374,
-19378,
-20683,
-21958,
-23290,
-24853,
-26562,
-28013,
-28962,
-29527,
-30073,
-30820,
-31687,
-32459,
-32968,
-33304,
-33720,
-34490,
-35678,
-37039,
-38241,
-39127,
-39781,
-40278,
-40459,
-40100,
-39199,
-38083,
-37083,
-36193,
-35222,
-34053,
-32858,
-31829,
-31027,
-30471,
-30372,
-31046,
-32506,
-34326,
-35906,
-37110,
-38220,
-39622,
-41168,
-42302,
-42512,
-41706,
-40217,
-38360,
-36295,
-33995,
-31480,
-28858,
-26326,
-24129,
-22542,
-21721,
-21641,
-22055,
-22639,
-23255,
-23856,
-24471,
-25122,
-25856,
-26866,
-28225,
-29734,
-30946,
-31527,
-31570,
-31464,
-31456,
-31440,
-31241,
-30974,
-31099,
-31938,
-33381,
-35024,
-36590,
-38070,
-39507,
-40737,
-41530,
-41874,
-41969,
-42039,
-41995,
-41690,
-41004,
-40031,
-38797,
-37287,
-35556,
-33898,
-32701,
-32130,
-31996,
-31966,
-31806,
-31502,
-31074,
-30532,
-29877,
-29168,
-28529,
-28055,
-27755,
-27556,
-27320,
-26967,
-26554,
-26281,
-26371,
-26877,
-27697,
-28650,
-29607,
-30490,
-31289,
-32103,
-33120,
-34401,
-35729,
-36652,
-36916,
-36649,
-36195,
-35715,
-35183,
-34563,
-34037,
-33719,
-33380,
-32668,
-31486,
-30249,
-29427,
-29153,
-29169,
-29254,
-29378,
-29592,
-29832,
-30076,
-30474,
-31276,
-32440,
-33702,
-34855,
-36041,
-37485,
-39094,
-40446,
-41273,
-41709,
-42175,
-42749,
-43131,
-42851,
-41758,
-40058,
-38141,
-36272,
-34472,
-32586,
-30411,
-27993,
-25578,
-23541,
-22072,
-21216,
-20982,
-21446,
-22562,
-24034,
-25392,
-26354,
-26977,
-27515,
-28209,
-29118,
-30214,
-31322,
-32169,
-32498,
-32346,
-32029,
-31940,
-32158,
-32516,
-32883,
-33341,
-34038,
-34914,
-35703,
-36216,
-36519,
-36874,
-37426,
-38092,
-38635,
-38878,
-38852,
-38717,
-38635,
-38535,
-38243,
-37591,
-36707,
-35874,
-35313,
-35021,
-34845,
-34715,
-34608,
-34388,
-33810,
-32670,
-31110,
-29477,
-28095,
-27012,
-26147,
-25383,
-24729,
-24165,
-23739,
-23538,
-23738,
-24440,
-25602,
-27032,
-28525,
-29885,
-31021,
-31975,
-32922,
-34025,
-35226,
-36276,
-36953,
-37278,
-37381,
-37292,
-36910,
-36247,
-35598,
-35300,
-35438,
-35798,
-36168,
-36477,
-36723,
-36755,
-36450,
-35909,
-35439,
-35216,
-35079,
-34785,
-34303,
-33859,
-33606,
-33459,
-33310,
-33194,
-33223,
-33367,
-33392,
-33184,
-32774,
-32248,
-31540,
-30570,
-29501,
-28627,
-28079,
-27638,
-27026,
-26283,
-25708,
-25511,
-25623,
-25831,
-26118,
-26574,
-27250,
-28009,
-28700,
-29303,
-29884,
-30510,
-31201,
-31950,
-32707,
-33358,
-33825,
-34246,
-34927,
-36041,
-37474,
-38859,
-40056,
-41120,
-42191,
-43097,
-43514,
-43303,
-42777,
-42411,
-42426,
-42496,
-42071,
-40860,
-39034,
-37082,
-35347,
-33906,
-32639,
-31495,
-30468,
-29528,
-28508,
-27310,
-25986,
-24778,
-23846,
-23221,
-22764,
-22382,
-21981,
-21548,
-21131,
-20893,
-21042,
-21619,
-22475,
-23384,
-24260,
-25217,
-26427,
-27965,
-29769,
-31736,
-33718,
-35591,
-37227,
-38553,
-39632,
-40596,
-41622,
-42756,
-43839,
-44588,
-44730,
-44201,
-43094,
-41532,
-39690,
-37832,
-36346,
-35409,
-34795,
-34015,
-32899,
-31837,
-31460,
-31940,
-32851,
-33584,
-33920,
-34046,
-34174,
-34281,
-34233,
-33975,
-33556,
-32962,
-32134,
-31092,
-30022,
-29142,
-28627,
-28548,
-28890,
-29460,
-29876,
-29780,
-29132,
-28301,
-27732,
-27605,
-27696,
-27669,
-27353,
-26852,
-26363,
-25972,
-25572,
-25030,
-24415,
-24052,
-24297,
-25191,
-26402,
-27537,
-28538,
-29691,
-31296,
-33287,
-35353,
-37175,
-38748,
-40241,
-41894,
-43763,
-45796,
-47708,
-49178,
-49941,
-49984,
-49501,
-48719,
-47729,
-46526,
-45091,
-43445,
-41594,
-39479,
-37081,
-34432,
-31688,
-29010,
-26495,
-24258,
-22346,
-20895,
-19957,
-19540,
-19463,
-19485,
-19409,
-19246,
-19227,
-19588,
-20368,
-21375,
-22318,
-23099,
-23879,
-24925,
-26377,
-28026,
-29519,
-30639,
-31535,
-32553,
-33879,
-35348,
-36612,
-37456,
-37914,
-38107,
-38108,
-37983,
-37886,
-38025,
-38459,
-39068,
-39667,
-40223,
-40807,
-41487,
-42222,
-42918,
-43498,
-43928,
-44201,
-44309,
-44249,
-43995,
-43460,
-42620,
-41388,
-39720,
-37486,
-34696,
-31583,
-28565,
-25971,
-23899,
-22260,
-21038,
-20193,
-19620,
-19059,
-18438,
-17957,
-17984,
-18660,
-19839,
-21247,
-22675,
-23960,
-24971,
-25748,
-26552,
-27630,
-28928,
-30096,
-30934,
-31586,
-32307,
-33168,
-34058,
-35050,
-36369,
-38033,
-39669,
-40840,
-41491,
-41907,
-42240,
-42431,
-42520,
-42836,
-43609,
-44470,
-44773,
-44228,
-43275,
-42398,
-41608,
-40587,
-39334,
-38271,
-37636,
-37060,
-35977,
-34254,
-32310,
-30510,
-28924,
-27462,
-26215,
-25282,
-24473,
-23495,
-22339,
-21353,
-20870,
-20832,
-21037,
-21426,
-22084,
-22925,
-23708,
-24342,
-25093,
-26174,
-27512,
-28797,
-29967,
-31207,
-32627,
-33978,
-34984,
-35614,
-36040,
-36305,
-36264,
-35974,
-35774,
-36017,
-36646,
-37310,
-37770,
-38089,
-38414,
-38722,
-38930,
-38989,
-38928,
-38677,
-38169,
-37531,
-37022,
-36768,
-36580,
-36289,
-35953,
-35825,
-35905,
-35873,
-35504,
-34951,
-34588,
-34542,
-34559,
-34338,
-33851,
-33193,
-32349,
-31193,
-29701,
-28151,
-26831,
-25828,
-25068,
-24472,
-24135,
-24061,
-24194,
-24372,
-24642,
-25167,
-26077,
-27302,
-28580,
-29714,
-30633,
-31433,
-32136,
-32744,
-33190,
-33536,
-33857,
-34155,
-34315,
-34196,
-33835,
-33424,
-33114,
-32850,
-32479,
-31974,
-31568,
-31553,
-32059,
-32896,
-33802,
-34567,
-35181,
-35717,
-36269,
-36884,
-37616,
-38550,
-39705,
-41049,
-42344,
-43387,
-44067,
-44446,
-44566,
-44273,
-43342,
-41699,
-39609,
-37447,
-35448,
-33537,
-31589,
-29492,
-27283,
-24981,
-22717,
-20722,
-19279,
-18528,
-18387,
-18688,
-19272,
-19998,
-20700,
-21279,
-21858,
-22726,
-24032,
-25670,
-27332,
-28808,
-30061,
-31108,
-32019,
-32908,
-33956,
-35165,
-36322,
-37167,
-37698,
-38126,
-38557,
-38861,
-38877,
-38729,
-38650,
-38672,
-38551,
-38103,
-37552,
-37253,
-37353,
-37693,
-38107,
-38649,
-39387,
-40178,
-40782,
-41169,
-41473,
-41782,
-41916,
-41712,
-41257,
-40681,
-39848,
-38347,
-35970,
-33067,
-30251,
-27862,
-25744,
-23603,
-21379,
-19357,
-17866,
-17116,
-17073,
-17548,
-18269,
-19115,
-20140,
-21433,
-22833,
-24013,
-24795,
-25419,
-26217,
-27223,
-28123,
-28786,
-29418,
-30388,
-31649,
-32902,
-34033,
-35315,
-36980,
-38816,
-40309,
-41342,
-42259,
-43492,
-44955,
-46220,
-46983,
-47329,
-47395,
-47147,
-46425,
-45303,
-44047,
-42867,
-41689,
-40371,
-38896,
-37450,
-36170,
-35056,
-34042,
-33075,
-32118,
-31039,
-29680,
-27964,
-26053,
-24231,
-22737,
-21622,
-20741,
-19943,
-19234,
-18759,
-18709,
-19119,
-19882,
-20878,
-22006,
-23251,
-24547,
-25823,
-27082,
-28382,
-29861,
-31515,
-33202,
-34612,
-35526,
-35925,
-36085,
-36266,
-36596,
-36962,
-37279,
-37516,
-37659,
-37569,
-37173,
-36664,
-36440,
-36714,
-37312,
-37871,
-38280,
-38615,
-38909,
-38949,
-38724,
-38563,
-38906,
-39673,
-40346,
-40531,
-40442,
-40492,
-40693,
-40645,
-40097,
-39334,
-38656,
-37943,
-36677,
-34614,
-32015,
-29303,
-26653,
-24146,
-21957,
-20374,
-19365,
-18622,
-17904,
-17321,
-17109,
-17325,
-17888,
-18826,
-20300,
-22237,
-24318,
-26196,
-27889,
-29600,
-31379,
-33061,
-34465,
-35578,
-36419,
-37009,
-37440,
-37967,
-38633,
-39159,
-39106,
-38548,
-37990,
-37854,
-37969,
-37945,
-37864,
-38287,
-39550,
-41148,
-42264,
-42513,
-42293,
-42139,
-42193,
-42199,
-41961,
-41465,
-40748,
-39794,
-38648,
-37457,
-36233,
-34781,
-32874,
-30639,
-28516,
-26825,
-25505,
-24259,
-23001,
-21951,
-21343,
-21130,
-20996,
-20743,
-20467,
-20460,
-20863,
-21535,
-22241,
-22909,
-23711,
-24817,
-26212,
-27757,
-29365,
-31061,
-32806,
-34403,
-35660,
-36595,
-37374,
-38112,
-38756,
-39291,
-39837,
-40497,
-41092,
-41279,
-40905,
-40204,
-39578,
-39192,
-38931,
-38648,
-38346,
-38159,
-38182,
-38381,
-38578,
-38447,
-37706,
-36358,
-34862,
-33789,
-33416,
-33561,
-33878,
-34112,
-34095,
-33556,
-32334,
-30626,
-28955,
-27722,
-26881,
-26135,
-25390,
-24780,
-24378,
-24068,
-23762,
-23627,
-23925,
-24630,
-25500,
-26430,
-27568,
-29065,
-30669,
-31967,
-32778,
-33369,
-34111,
-35108,
-36172,
-37065,
-37636,
-37779,
-37449,
-36712,
-35797,
-34870,
-33961,
-33004,
-32117,
-31573,
-31538,
-31814,
-31974,
-31721,
-31244,
-30970,
-31205,
-31796,
-32427,
-32970,
-33662,
-34730,
-36025,
-37174,
-37991,
-38728,
-39663,
-40704,
-41393,
-41496,
-41143,
-40625,
-39933,
-38921,
-37611,
-36233,
-34821,
-33099,
-30903,
-28578,
-26746,
-25587,
-24696,
-23581,
-22299,
-21313,
-20959,
-21209,
-21908,
-22997,
-24407,
-25881,
-27182,
-28335,
-29564,
-30951,
-32342,
-33572,
-34683,
-35692,
-36479,
-36831,
-36823,
-36667,
-36446,
-35936,
-35019,
-33941,
-33174,
-32922,
-33055,
-33337,
-33689,
-34037,
-34259,
-34358,
-34574,
-35189,
-36073,
-36799,
-37107,
-37254,
-37646,
-38441,
-39437,
-40422,
-41276,
-41691,
-41292,
-39966,
-38176,
-36547,
-35110,
-33394,
-31016,
-28307,
-25901,
-24075,
-22590,
-21255,
-20239,
-19869,
-20121,
-20695,
-21423,
-22396,
-23718,
-25243,
-26785,
-28309,
-29947,
-31610,
-33072,
-34217,
-35224,
-36297,
-37328,
-38009,
-38230,
-38284,
-38501,
-38911,
-39211,
-39179,
-38902,
-38595,
-38429,
-38315,
-38202,
-37990,
-37632,
-37073,
-36353,
-35626,
-35013,
-34475,
-33906,
-33313,
-32894,
-32750,
-32753,
-32637,
-32338,
-32061,
-31925,
-31718,
-31032,
-29768,
-28267,
-26980,
-25989,
-25059,
-24047,
-23096,
-22487,
-22206,
-22156,
-22313,
-22934,
-24128,
-25730,
-27349,
-28897,
-30492,
-32338,
-34332,
-36278,
-38075,
-39804,
-41530,
-43177,
-44613,
-45759,
-46532,
-46793,
-46352,
-45200,
-43527,
-41651,
-39818,
-38109,
-36503,
-34934,
-33349,
-31819,
-30422,
-29285,
-28446,
-27873,
-27516,
-27226,
-26835,
-26254,
-25638,
-25310,
-25454,
-25921,
-26366,
-26649,
-26900,
-27286,
-27797,
-28279,
-28711,
-29182,
-29624,
-29905,
-29972,
-30163,
-30822,
-31917,
-32980,
-33594,
-33782,
-33810,
-33828,
-33664,
-33280,
-32892,
-32901,
-33445,
-34299,
-35124,
-35697,
-36056,
-36344,
-36732,
-37239,
-37723,
-37987,
-38063,
-38252,
-38793,
-39544,
-39970,
-39684,
-38768,
-37580,
-36395,
-35218,
-34147,
-33425,
-33270,
-33457,
-33508,
-33054,
-32133,
-30979,
-29769,
-28581,
-27586,
-26946,
-26674,
-26551,
-26435,
-26359,
-26455,
-26662,
-26813,
-26898,
-27116,
-27572,
-27999,
-28024,
-27532,
-26866,
-26407,
-26309,
-26468,
-26849,
-27501,
-28404,
-29460,
-30555,
-31734,
-33057,
-34387,
-35601,
-36712,
-37935,
-39394,
-40900,
-42232,
-43343,
-44362,
-45295,
-45905,
-46064,
-45931,
-45853,
-45871,
-45674,
-44857,
-43327,
-41271,
-38927,
-36449,
-33964,
-31564,
-29287,
-27023,
-24774,
-22669,
-20987,
-19860,
-19285,
-19213,
-19567,
-20234,
-20950,
-21569,
-22168,
-22984,
-24096,
-25323,
-26399,
-27298,
-28179,
-29211,
-30332,
-31342,
-32002,
-32236,
-32175,
-32197,
-32723,
-33904,
-35437,
-36801,
-37661,
-38121,
-38478,
-38921,
-39449,
-39961,
-40404,
-40610,
-40377,
-39591,
-38448,
-37398,
-36839,
-36973,
-37656,
-38545,
-39154,
-39161,
-38623,
-38000,
-37672,
-37636,
-37492,
-37008,
-36300,
-35592,
-34816,
-33601,
-31834,
-29760,
-27776,
-25984,
-24264,
-22668,
-21511,
-21061,
-21237,
-21752,
-22496,
-23508,
-24744,
-25918,
-26801,
-27520,
-28349,
-29385,
-30358,
-31015,
-31340,
-31488,
-31487,
-31282,
-30891,
-30558,
-30477,
-30689,
-31111,
-31703,
-32467,
-33293,
-34086,
-34960,
-36185,
-37863,
-39710,
-41337,
-42730,
-44156,
-45693,
-46910,
-47268,
-46738,
-45784,
-44854,
-43921,
-42780,
-41443,
-40066,
-38624,
-36726,
-34198,
-31368,
-28867,
-26937,
-25347,
-23767,
-22302,
-21250,
-20705,
-20416,
-20147,
-20000,
-20202,
-20799,
-21562,
-22291,
-23022,
-23909,
-25075,
-26487,
-28144,
-29968,
-31842,
-33570,
-35003,
-36121,
-36906,
-37344,
-37452,
-37392,
-37325,
-37302,
-37251,
-37175,
-37183,
-37308,
-37333,
-37022,
-36409,
-35872,
-35670,
-35687,
-35574,
-35229,
-34914,
-34848,
-34896,
-34721,
-34239,
-33814,
-33807,
-34243,
-34798,
-35232,
-35640,
-36173,
-36772,
-37054,
-36725,
-35850,
-34822,
-34028,
-33505,
-33017,
-32311,
-31362,
-30338,
-29359,
-28383,
-27360,
-26377,
-25675,
-25413,
-25548,
-25962,
-26583,
-27400,
-28297,
-29078,
-29619,
-30010,
-30355,
-30639,
-30663,
-30335,
-29757,
-29159,
-28715,
-28507,
-28575,
-28939,
-29527,
-30264,
-31079,
-31968,
-32844,
-33585,
-34156,
-34734,
-35505,
-36550,
-37783,
-39185,
-40785,
-42410,
-43700,
-44357,
-44506,
-44532,
-44590,
-44508,
-44076,
-43402,
-42620,
-41542,
-39798,
-37383,
-34870,
-32769,
-31026,
-29110,
-26879,
-24749,
-23239,
-22349,
-21732,
-21218,
-20952,
-21033,
-21278,
-21534,
-21973,
-22842,
-24067,
-25289,
-26324,
-27356,
-28521,
-29562,
-30150,
-30386,
-30833,
-31840,
-33161,
-34275,
-35000,
-35526,
-35970,
-36160,
-35945,
-35596,
-35602,
-36180,
-37091,
-37934,
-38488,
-38741,
-38661,
-38259,
-37636,
-37063,
-36687,
-36484,
-36224,
-35798,
-35202,
-34596,
-34167,
-34027,
-34138,
-34324,
-34486,
-34753,
-35329,
-36132,
-36742,
-36776,
-36345,
-35931,
-35848,
-35853,
-35473,
-34537,
-33293,
-32018,
-30719,
-29240,
-27674,
-26288,
-25257,
-24499,
-23878,
-23477,
-23468,
-23854,
-24439,
-25053,
-25724,
-26445,
-27014,
-27194,
-27044,
-26973,
-27294,
-27862,
-28223,
-28147,
-27866,
-27898,
-28561,
-29871,
-31630,
-33631,
-35683,
-37605,
-39245,
-40582,
-41757,
-43005,
-44527,
-46270,
-47924,
-49060,
-49441,
-49117,
-48231,
-46834,
-44963,
-42865,
-40915,
-39307,
-37763,
-35962,
-33901,
-31926,
-30174,
-28360,
-26244,
-24141,
-22716,
-22191,
-22033,
-21585,
-20814,
-20246,
-20196,
-20417,
-20555,
-20668,
-21153,
-22145,
-23421,
-24735,
-26078,
-27512,
-28843,
-29885,
-30715,
-31649,
-32783,
-33890,
-34777,
-35588,
-36550,
-37551,
-38227,
-38398,
-38286,
-38137,
-37947,
-37644,
-37418,
-37556,
-37960,
-38182,
-37926,
-37517,
-37407,
-37589,
-37558,
-37029,
-36362,
-36127,
-36495,
-37129,
-37732,
-38328,
-39031,
-39725,
-40159,
-40186,
-39812,
-38977,
-37561,
-35672,
-33649,
-31812,
-30081,
-28201,
-26117,
-24164,
-22691,
-21744,
-21125,
-20688,
-20447,
-20463,
-20718,
-21210,
-21996,
-23077,
-24316,
-25457,
-26395,
-27140,
-27765,
-28246,
-28539,
-28672,
-28756,
-28889,
-29216,
-29892,
-31044,
-32631,
-34432,
-36213,
-37932,
-39656,
-41461,
-43294,
-45014,
-46504,
-47653,
-48465,
-49004,
-49396,
-49629,
-49558,
-48957,
-47803,
-46151,
-44079,
-41560,
-38698,
-35845,
-33347,
-31232,
-29171,
-26909,
-24593,
-22563,
-20918,
-19442,
-18009,
-16858,
-16320,
-16367,
-16601,
-16801,
-17161,
-18039,
-19418,
-20961,
-22493,
-24228,
-26448,
-28993,
-31394,
-33358,
-34988,
-36496,
-37770,
-38548,
-38831,
-38978,
-39333,
-39799,
-40038,
-39900,
-39607,
-39446,
-39415,
-39244,
-38781,
-38159,
-37697,
-37557,
-37644,
-37721,
-37632,
-37399,
-37079,
-36657,
-36010,
-35091,
-34069,
-33234,
-32725,
-32404,
-32026,
-31555,
-31165,
-31011,
-31001,
-30938,
-30749,
-30543,
-30401,
-30251,
-30001,
-29668,
-29349,
-29004,
-28480,
-27709,
-26857,
-26256,
-26069,
-26328,
-26936,
-27827,
-28905,
-29974,
-30843,
-31439,
-31869,
-32337,
-32978,
-33811,
-34643,
-35259,
-35476,
-35396,
-35207,
-35113,
-35031,
-34835,
-34395,
-33803,
-33230,
-32849,
-32747,
-32861,
-33022,
-33087,
-33154,
-33533,
-34411,
-35607,
-36611,
-37184,
-37496,
-37960,
-38675,
-39329,
-39572,
-39339,
-38828,
-38187,
-37406,
-36398,
-35170,
-33746,
-32182,
-30543,
-28974,
-27564,
-26287,
-25058,
-23931,
-23113,
-22753,
-22803,
-23078,
-23456,
-23954,
-24626,
-25486,
-26588,
-27934,
-29527,
-31181,
-32728,
-34066,
-35208,
-36198,
-37050,
-37838,
-38629,
-39445,
-40158,
-40677,
-40995,
-41177,
-41157,
-40782,
-40018,
-39030,
-38059,
-37144,
-36193,
-35137,
-34047,
-32939,
-31736,
-30380,
-29067,
-28087,
-27556,
-27304,
-27142,
-27168,
-27611,
-28542,
-29680,
-30656,
-31299,
-31683,
-31923,
-32010,
-31883,
-31528,
-31048,
-30636,
-30418,
-30420,
-30482,
-30434,
-30219,
-29988,
-29939,
-30131,
-30492,
-30934,
-31520,
-32332,
-33358,
-34450,
-35403,
-36121,
-36561,
-36798,
-36968,
-37257,
-37722,
-38210,
-38384,
-38020,
-37115,
-35908,
-34656,
-33528,
-32606,
-31935,
-31525,
-31292,
-31113,
-30834,
-30444,
-30007,
-29643,
-29439,
-29442,
-29684,
-30183,
-30895,
-31659,
-32325,
-32794,
-33143,
-33461,
-33808,
-34135,
-34412,
-34591,
-34658,
-34551,
-34280,
-33882,
-33442,
-32958,
-32399,
-31689,
-30820,
-29750,
-28633,
-27726,
-27387,
-27643,
-28129,
-28353,
-28216,
-28055,
-28234,
-28687,
-29067,
-29227,
-29380,
-29810,
-30495,
-31263,
-32119,
-33316,
-35006,
-37000,
-38936,
-40549,
-41737,
-42405,
-42480,
-42100,
-41639,
-41428,
-41504,
-41612,
-41499,
-40991,
-39997,
-38453,
-36469,
-34325,
-32319,
-30625,
-29260,
-28268,
-27639,
-27251,
-26871,
-26406,
-25961,
-25726,
-25707,
-25756,
-25717,
-25509,
-25100,
-24512,
-23928,
-23697,
-24074,
-25072,
-26492,
-28097,
-29660,
-30899,
-31609,
-31960,
-32408,
-33322,
-34547,
-35666,
-36486,
-37129,
-37653,
-37695,
-36896,
-35378,
-33766,
-32535,
-31659,
-30906,
-30294,
-30119,
-30534,
-31423,
-32711,
-34485,
-36857,
-39515,
-42018,
-44082,
-45808,
-47286,
-48332,
-48717,
-48425,
-47693,
-46623,
-45030,
-42690,
-39623,
-36058,
-32295,
-28587,
-25285,
-22730,
-21031,
-20005,
-19357,
-18991,
-18932,
-19103,
-19246,
-19145,
-18816,
-18414,
-18041,
-17688,
-17457,
-17512,
-18036,
-18979,
-20348,
-22236,
-24860,
-28117,
-31573,
-34738,
-37490,
-40075,
-42674,
-45190,
-47400,
-49272,
-50923,
-52264,
-52932,
-52628,
-51467,
-49910,
-48228,
-46421,
-44422,
-42463,
-40880,
-39699,
-38569,
-37204,
-35727,
-34466,
-33483,
-32448,
-31056,
-29372,
-27708,
-26165,
-24640,
-23038,
-21643,
-20777,
-20521,
-20547,
-20525,
-20419,
-20460,
-20816,
-21426,
-22158,
-22998,
-24071,
-25405,
-26753,
-27841,
-28582,
-29264,
-30222,
-31525,
-32891,
-34039,
-34919,
-35679,
-36327,
-36642,
-36445,
-35932,
-35585,
-35810,
-36557,
-37454,
-38133,
-38489,
-38697,
-38885,
-39143,
-39425,
-39799,
-40413,
-41371,
-42529,
-43567,
-44235,
-44609,
-44915,
-45116,
-44848,
-43726,
-41788,
-39407,
-36800,
-33869,
-30490,
-26922,
-23678,
-21095,
-19172,
-17903,
-17438,
-17800,
-18609,
-19257,
-19642,
-20236,
-21523,
-23351,
-25082,
-26318,
-27225,
-28090,
-28844,
-29195,
-29165,
-29157,
-29512,
-30063,
-30415,
-30469,
-30539,
-30971,
-31792,
-32899,
-34344,
-36300,
-38616,
-40695,
-41895,
-42189,
-42148,
-42501,
-43422,
-44621,
-45703,
-46495,
-46943,
-46835,
-45945,
-44375,
-42622,
-41255,
-40365,
-39701,
-38892,
-37775,
-36191,
-33934,
-31015,
-27916,
-25259,
-23241,
-21463,
-19558,
-17823,
-16891,
-16926,
-17360,
-17588,
-17779,
-18588,
-20276,
-22255,
-23798,
-24819,
-25864,
-27335,
-29073,
-30680,
-32059,
-33377,
-34707,
-35869,
-36665,
-37176,
-37592,
-38087,
-38717,
-39483,
-40321,
-41011,
-41310,
-41183,
-40830,
-40457,
-40082,
-39581,
-38900,
-38103,
-37217,
-36307,
-35519,
-35161,
-35339,
-35795,
-36008,
-35705,
-35054,
-34460,
-34160,
-34069,
-33995,
-33815,
-33527,
-33045,
-32215,
-30871,
-29097,
-27250,
-25792,
-24947,
-24524,
-24143,
-23612,
-23162,
-23168,
-23826,
-25000,
-26480,
-28113,
-29829,
-31439,
-32790,
-33803,
-34560,
-35075,
-35333,
-35399,
-35491,
-35762,
-36062,
-36077,
-35684,
-35111,
-34642,
-34280,
-33854,
-33260,
-32603,
-31934,
-31106,
-30064,
-29075,
-28628,
-28934,
-29669,
-30290,
-30511,
-30518,
-30629,
-31123,
-32015,
-33406,
-35270,
-37548,
-39879,
-41874,
-43274,
-44187,
-44869,
-45432,
-45627,
-45030,
-43497,
-41324,
-38966,
-36620,
-34100,
-31261,
-28291,
-25629,
-23548,
-22031,
-20930,
-20290,
-20185,
-20567,
-21191,
-21830,
-22406,
-22950,
-23494,
-24167,
-25173,
-26681,
-28538,
-30381,
-31902,
-33074,
-34045,
-34852,
-35428,
-35753,
-35959,
-36160,
-36337,
-36338,
-36136,
-35832,
-35615,
-35569,
-35670,
-35815,
-35885,
-35860,
-35794,
-35803,
-35892,
-35993,
-36087,
-36330,
-36864,
-37598,
-38260,
-38674,
-39028,
-39534,
-40156,
-40497,
-40253,
-39496,
-38456,
-37231,
-35634,
-33560,
-31154,
-28753,
-26559,
-24638,
-23012,
-21756,
-20955,
-20579,
-20547,
-20769,
-21201,
-21827,
-22678,
-23774,
-25081,
-26441,
-27783,
-29136,
-30619,
-32141,
-33476,
-34478,
-35316,
-36240,
-37247,
-38071,
-38533,
-38764,
-38981,
-39188,
-39219,
-39118,
-39128,
-39418,
-39766,
-39797,
-39419,
-38768,
-37970,
-36921,
-35618,
-34355,
-33558,
-33316,
-33384,
-33480,
-33546,
-33604,
-33564,
-33279,
-32803,
-32259,
-31650,
-30752,
-29527,
-28218,
-27180,
-26418,
-25706,
-24945,
-24395,
-24276,
-24476,
-24623,
-24616,
-24723,
-25279,
-26252,
-27367,
-28457,
-29682,
-31318,
-33432,
-35834,
-38223,
-40380,
-42162,
-43422,
-43977,
-43755,
-42926,
-41924,
-41070,
-40348,
-39436,
-38189,
-36808,
-35618,
-34517,
-33131,
-31361,
-29718,
-28849,
-28724,
-28703,
-28302,
-27826,
-27926,
-28733,
-29708,
-30313,
-30636,
-31057,
-31652,
-32046,
-32008,
-31756,
-31644,
-31678,
-31539,
-31108,
-30629,
-30401,
-30435,
-30506,
-30557,
-30711,
-31039,
-31317,
-31244,
-30768,
-30156,
-29759,
-29717,
-29941,
-30286,
-30675,
-31072,
-31402,
-31535,
-31392,
-31048,
-30711,
-30595,
-30921,
-31903,
-33730,
-36311,
-39128,
-41437,
-42821,
-43414,
-43607,
-43477,
-42826,
-41625,
-40415,
-39756,
-39635,
-39345,
-38292,
-36559,
-34691,
-32990,
-31383,
-29817,
-28583,
-27974,
-27820,
-27668,
-27303,
-26950,
-26811,
-26692,
-26295,
-25656,
-25082,
-24561,
-23613,
-21928,
-19959,
-18628,
-18384,
-18890,
-19615,
-20557,
-22085,
-24154,
-26262,
-27990,
-29736,
-32137,
-35337,
-38667,
-41515,
-43957,
-46574,
-49589,
-52607,
-55039,
-56721,
-57726,
-58020,
-57286,
-55461,
-52905,
-50196,
-47527,
-44652,
-41233,
-37204,
-32815,
-28390,
-24251,
-20718,
-18002,
-16146,
-14949,
-14213,
-13822,
-13734,
-13800,
-13877,
-13955,
-14301,
-15213,
-16742,
-18654,
-20620,
-22539,
-24500,
-26613,
-28797,
-30850,
-32641,
-34281,
-35971,
-37843,
-39763,
-41521,
-42961,
-44101,
-45025,
-45763,
-46265,
-46468,
-46272,
-45630,
-44516,
-43132,
-41779,
-40742,
-39999,
-39334,
-38550,
-37736,
-37082,
-36663,
-36268,
-35688,
-34971,
-34412,
-34229,
-34323,
-34332,
-33919,
-32930,
-31371,
-29323,
-26997,
-24691,
-22717,
-21177,
-19985,
-19072,
-18476,
-18308,
-18552,
-19136,
-20121,
-21672,
-23861,
-26388,
-28801,
-30832,
-32501,
-33911,
-34913,
-35318,
-35107,
-34557,
-33926,
-33296,
-32692,
-32315,
-32467,
-33255,
-34437,
-35667,
-36783,
-37895,
-39153,
-40647,
-42286,
-43939,
-45366,
-46369,
-46820,
-46733,
-46102,
-44917,
-43263,
-41387,
-39589,
-37931,
-36242,
-34371,
-32373,
-30390,
-28463,
-26553,
-24820,
-23533,
-22813,
-22372,
-21830,
-21106,
-20467,
-20169,
-20183,
-20395,
-20832,
-21630,
-22732,
-23891,
-24950,
-26050,
-27471,
-29273,
-31299,
-33323,
-35256,
-37081,
-38739,
-40249,
-41561,
-42628,
-43203,
-43142,
-42523,
-41605,
-40566,
-39338,
-37953,
-36585,
-35533,
-34742,
-33917,
-32860,
-31762,
-30973,
-30595,
-30383,
-30163,
-29972,
-29986,
-30156,
-30261,
-30250,
-30326,
-30804,
-31747,
-32983,
-34321,
-35613,
-36747,
-37490,
-37680,
-37343,
-36686,
-35876,
-34964,
-33911,
-32789,
-31688,
-30672,
-29726,
-28911,
-28301,
-27961,
-27707,
-27412,
-27126,
-27128,
-27624,
-28479,
-29406,
-30261,
-31118,
-31969,
-32591,
-32733,
-32513,
-32287,
-32243,
-32093,
-31536,
-30618,
-29871,
-29621,
-29758,
-29907,
-29955,
-30156,
-30726,
-31660,
-32792,
-34083,
-35567,
-37117,
-38519,
-39617,
-40478,
-41184,
-41687,
-41966,
-42174,
-42519,
-42879,
-42825,
-41998,
-40611,
-39175,
-37988,
-36806,
-35276,
-33411,
-31593,
-30066,
-28621,
-26922,
-24962,
-23155,
-21915,
-21239,
-20921,
-20812,
-21061,
-21765,
-22771,
-23799,
-24762,
-25834,
-27184,
-28656,
-29988,
-31114,
-32301,
-33827,
-35596,
-37253,
-38485,
-39277,
-39744,
-39899,
-39684,
-39111,
-38406,
-37804,
-37387,
-37080,
-36728,
-36261,
-35697,
-35099,
-34535,
-33993,
-33368,
-32614,
-31749,
-30861,
-29935,
-28909,
-27884,
-27208,
-27260,
-28114,
-29522,
-31177,
-32924,
-34569,
-35763,
-36136,
-35741,
-35093,
-34759,
-34849,
-35097,
-35192,
-35094,
-34821,
-34318,
-33458,
-32333,
-31221,
-30405,
-29950,
-29760,
-29742,
-29898,
-30278,
-30865,
-31542,
-32112,
-32461,
-32624,
-32749,
-32816,
-32565,
-31756,
-30515,
-29364,
-28756,
-28680,
-28813,
-28922,
-29027,
-29177,
-29199,
-29009,
-28812,
-29054,
-29915,
-31110,
-32272,
-33316,
-34449,
-35807,
-37221,
-38533,
-39689,
-40761,
-41662,
-42167,
-42196,
-41882,
-41479,
-41084,
-40617,
-39957,
-39022,
-37792,
-36167,
-34091,
-31596,
-29022,
-26837,
-25421,
-24690,
-24229,
-23675,
-23105,
-22822,
-22902,
-23012,
-22875,
-22744,
-23172,
-24403,
-26079,
-27750,
-29402,
-31301,
-33456,
-35398,
-36784,
-37692,
-38463,
-39069,
-39259,
-38973,
-38673,
-38716,
-38952,
-38835,
-38194,
-37358,
-36724,
-36175,
-35409,
-34381,
-33533,
-33217,
-33382,
-33656,
-33872,
-34053,
-34333,
-34670,
-35075,
-35596,
-36213,
-36628,
-36411,
-35414,
-33898,
-32358,
-31055,
-29940,
-28855,
-27810,
-26972,
-26415,
-26014,
-25501,
-24847,
-24252,
-23935,
-23859,
-23739,
-23469,
-23288,
-23614,
-24603,
-26037,
-27644,
-29321,
-31133,
-32968,
-34607,
-35934,
-37079,
-38290,
-39651,
-41166,
-42858,
-44732,
-46520,
-47720,
-47957,
-47288,
-46080,
-44550,
-42633,
-40292,
-37782,
-35504,
-33664,
-32098,
-30612,
-29230,
-28136,
-27441,
-27022,
-26703,
-26361,
-25966,
-25499,
-24975,
-24522,
-24330,
-24529,
-24985,
-25454,
-25783,
-26093,
-26671,
-27590,
-28615,
-29429,
-29967,
-30512,
-31243,
-31999,
-32488,
-32684,
-32987,
-33706,
-34674,
-35489,
-35971,
-36348,
-36737,
-36918,
-36514,
-35629,
-34686,
-34002,
-33417,
-32772,
-32311,
-32483,
-33349,
-34345,
-35007,
-35448,
-36181,
-37358,
-38509,
-39143,
-39305,
-39508,
-40054,
-40735,
-41056,
-40760,
-39856,
-38467,
-36615,
-34359,
-31878,
-29494,
-27509,
-26104,
-25300,
-24898,
-24684,
-24469,
-24322,
-24384,
-24687,
-25081,
-25284,
-25156,
-24741,
-24191,
-23621,
-23067,
-22599,
-22474,
-23033,
-24471,
-26552,
-28751,
-30667,
-32374,
-34240,
-36505,
-38996,
-41449,
-43814,
-46312,
-49009,
-51604,
-53597,
-54656,
-54708,
-53787,
-51917,
-49189,
-45880,
-42360,
-38892,
-35647,
-32663,
-30000,
-27556,
-25225,
-22968,
-20939,
-19316,
-18155,
-17366,
-16929,
-16932,
-17425,
-18308,
-19354,
-20473,
-21682,
-23064,
-24597,
-26249,
-28036,
-30001,
-32068,
-34010,
-35628,
-36847,
-37805,
-38664,
-39427,
-39958,
-40040,
-39727,
-39277,
-38953,
-38703,
-38216,
-37392,
-36597,
-36290,
-36412,
-36261,
-35276,
-33711,
-32392,
-31786,
-31499,
-30951,
-30237,
-30117,
-31109,
-32860,
-34612,
-36028,
-37328,
-38661,
-39682,
-39896,
-39318,
-38423,
-37643,
-36954,
-36131,
-35025,
-33602,
-31674,
-29090,
-26022,
-23085,
-20886,
-19636,
-19183,
-19386,
-20224,
-21594,
-23150,
-24564,
-25827,
-27250,
-29029,
-31026,
-32833,
-34188,
-35119,
-35843,
-36534,
-37161,
-37605,
-37794,
-37888,
-38097,
-38504,
-38867,
-38882,
-38499,
-38004,
-37687,
-37612,
-37582,
-37599,
-37767,
-38144,
-38404,
-38156,
-37301,
-36176,
-35123,
-34166,
-33101,
-31876,
-30782,
-30168,
-30098,
-30316,
-30400,
-30088,
-29349,
-28396,
-27527,
-26938,
-26551,
-26230,
-25906,
-25795,
-25990,
-26401,
-26696,
-26793,
-26912,
-27363,
-28129,
-28951,
-29588,
-30136,
-30865,
-31915,
-33252,
-34704,
-36144,
-37425,
-38453,
-39245,
-39932,
-40632,
-41253,
-41672,
-41863,
-41956,
-41928,
-41529,
-40515,
-39053,
-37599,
-36419,
-35306,
-33887,
-32230,
-30828,
-30079,
-29799,
-29473,
-28806,
-27951,
-27147,
-26430,
-25772,
-25379,
-25576,
-26352,
-27247,
-27800,
-28046,
-28393,
-29045,
-29730,
-30097,
-30212,
-30465,
-31061,
-31701,
-31965,
-31804,
-31552,
-31561,
-31808,
-32137,
-32509,
-33035,
-33728,
-34357,
-34714,
-34876,
-35135,
-35673,
-36369,
-37005,
-37522,
-38048,
-38589,
-38955,
-38935,
-38613,
-38283,
-38135,
-37977,
-37490,
-36524,
-35287,
-34065,
-32975,
-31974,
-30971,
-29987,
-29031,
-28116,
-27240,
-26440,
-25748,
-25189,
-24810,
-24680,
-24807,
-25065,
-25424,
-26064,
-27295,
-29129,
-31113,
-32711,
-33805,
-34726,
-35758,
-36766,
-37495,
-37963,
-38466,
-39067,
-39419,
-39143,
-38327,
-37394,
-36596,
-35812,
-34836,
-33770,
-32809,
-32007,
-31211,
-30428,
-29863,
-29649,
-29601,
-29438,
-29084,
-28704,
-28350,
-28007,
-27715,
-27742,
-28195,
-28837,
-29336,
-29797,
-30688,
-32248,
-34039,
-35442,
-36260,
-36894,
-37615,
-38224,
-38322,
-37962,
-37534,
-37279,
-36962,
-36275,
-35352,
-34560,
-34073,
-33674,
-33184,
-32794,
-32784,
-33112,
-33408,
-33475,
-33539,
-33872,
-34362,
-34532,
-34099,
-33247,
-32300,
-31330,
-30108,
-28558,
-26974,
-25776,
-25173,
-25081,
-25400,
-26127,
-27241,
-28457,
-29400,
-29874,
-30109,
-30546,
-31452,
-32684,
-33853,
-34654,
-35113,
-35401,
-35578,
-35439,
-34791,
-33734,
-32635,
-31774,
-31106,
-30478,
-29990,
-29995,
-30632,
-31557,
-32254,
-32690,
-33368,
-34787,
-36809,
-38838,
-40415,
-41603,
-42595,
-43397,
-43771,
-43746,
-43549,
-43348,
-42870,
-41714,
-39778,
-37392,
-34973,
-32773,
-30860,
-29336,
-28197,
-27255,
-26252,
-25190,
-24364,
-24047,
-24049,
-23976,
-23571,
-23040,
-22581,
-22200,
-21647,
-20957,
-20430,
-20380,
-20706,
-21168,
-21734,
-22776,
-24559,
-26830,
-29004,
-30706,
-32179,
-33868,
-35921,
-38089,
-40114,
-42122,
-44347,
-46739,
-48895,
-50423,
-51301,
-51688,
-51598,
-50884,
-49535,
-47851,
-46168,
-44569,
-42946,
-41295,
-39756,
-38283,
-36501,
-34057,
-31052,
-27988,
-25284,
-22993,
-21039,
-19566,
-18767,
-18508,
-18345,
-17903,
-17335,
-16967,
-16984,
-17246,
-17706,
-18495,
-19724,
-21279,
-22917,
-24643,
-26618,
-28882,
-31230,
-33424,
-35466,
-37441,
-39285,
-40782,
-41814,
-42499,
-42945,
-43194,
-43215,
-43115,
-42946,
-42598,
-41857,
-40731,
-39447,
-38156,
-36770,
-35276,
-33967,
-33315,
-33376,
-33808,
-34299,
-34975,
-36020,
-37187,
-37893,
-37882,
-37537,
-37346,
-37302,
-37012,
-36263,
-35227,
-33983,
-32263,
-29879,
-27219,
-25093,
-23871,
-23286,
-22846,
-22511,
-22505,
-22752,
-22863,
-22619,
-22442,
-22897,
-24116,
-25602,
-26790,
-27454,
-27684,
-27662,
-27604,
-27797,
-28424,
-29355,
-30270,
-31075,
-32071,
-33638,
-35799,
-38180,
-40448,
-42468,
-44288,
-45774,
-46780,
-47290,
-47561,
-47870,
-48234,
-48396,
-48005,
-46888,
-45095,
-42867,
-40467,
-38105,
-35863,
-33757,
-31697,
-29595,
-27418,
-25294,
-23461,
-22073,
-21045,
-20170,
-19364,
-18780,
-18596,
-18791,
-19193,
-19689,
-20330,
-21130,
-22016,
-22916,
-23994,
-25449,
-27296,
-29259,
-31113,
-32869,
-34630,
-36326,
-37740,
-38849,
-39871,
-40997,
-42067,
-42781,
-43039,
-43028,
-42864,
-42418,
-41586,
-40592,
-39883,
-39653,
-39658,
-39521,
-39088,
-38379,
-37330,
-35757,
-33678,
-31436,
-29462,
-27930,
-26706,
-25656,
-24765,
-24113,
-23781,
-23888,
-24619,
-25996,
-27741,
-29403,
-30735,
-31812,
-32802,
-33680,
-34324,
-34756,
-35122,
-35412,
-35343,
-34672,
-33622,
-32667,
-32129,
-31822,
-31432,
-30929,
-30555,
-30513,
-30695,
-31022,
-31582,
-32546,
-33732,
-34689,
-35045,
-34932,
-34666,
-34440,
-34090,
-33518,
-32846,
-32301,
-31948,
-31623,
-31268,
-30942,
-30738,
-30605,
-30494,
-30518,
-30858,
-31525,
-32269,
-32927,
-33485,
-34076,
-34593,
-34818,
-34688,
-34379,
-34141,
-34048,
-34118,
-34523,
-35455,
-36734,
-37771,
-37981,
-37373,
-36447,
-35693,
-35169,
-34717,
-34282,
-33944,
-33630,
-33015,
-31862,
-30299,
-28763,
-27605,
-26910,
-26593,
-26584,
-26823,
-27224,
-27630,
-27983,
-28259,
-28500,
-28737,
-29035,
-29456,
-29948,
-30421,
-30869,
-31486,
-32422,
-33559,
-34525,
-35093,
-35412,
-35764,
-36181,
-36356,
-36077,
-35516,
-35127,
-35135,
-35438,
-35754,
-36008,
-36214,
-36349,
-36272,
-35954,
-35579,
-35362,
-35293,
-35196,
-34927,
-34631,
-34499,
-34604,
-34778,
-34879,
-34860,
-34731,
-34364,
-33520,
-32131,
-30395,
-28726,
-27460,
-26724,
-26522,
-26735,
-27181,
-27514,
-27468,
-26997,
-26363,
-25899,
-25820,
-26196,
-27077,
-28408,
-29931,
-31216,
-32002,
-32450,
-32979,
-33768,
-34599,
-35183,
-35582,
-36167,
-37093,
-38008,
-38437,
-38301,
-38076,
-38245,
-38786,
-39264,
-39279,
-38873,
-38291,
-37729,
-37105,
-36349,
-35475,
-34662,
-34006,
-33534,
-33140,
-32714,
-32168,
-31546,
-30977,
-30629,
-30482,
-30371,
-30103,
-29658,
-29174,
-28731,
-28290,
-27749,
-27141,
-26564,
-26086,
-25640,
-25282,
-25251,
-25809,
-26885,
-28007,
-28708,
-29006,
-29349,
-30190,
-31470,
-32793,
-33802,
-34490,
-35063,
-35638,
-36201,
-36679,
-37055,
-37293,
-37354,
-37255,
-37123,
-37064,
-37101,
-37176,
-37344,
-37662,
-38032,
-38139,
-37769,
-37080,
-36520,
-36295,
-36184,
-35816,
-35157,
-34574,
-34344,
-34344,
-34161,
-33594,
-32806,
-32096,
-31603,
-31243,
-30864,
-30380,
-29694,
-28860,
-27986,
-27378,
-27148,
-27250,
-27366,
-27295,
-26963,
-26495,
-26053,
-25814,
-25903,
-26376,
-27116,
-27969,
-28688,
-29139,
-29210,
-29028,
-28845,
-28941,
-29319,
-29736,
-29934,
-29990,
-30189,
-30773,
-31692,
-32783,
-33983,
-35370,
-37002,
-38830,
-40814,
-42940,
-45179,
-47389,
-49430,
-51214,
-52613,
-53259,
-52757,
-50961,
-48280,
-45196,
-41973,
-38513,
-34825,
-31158,
-27774,
-24689,
-21827,
-19420,
-17934,
-17555,
-17899,
-18363,
-18697,
-19035,
-19379,
-19447,
-19018,
-18469,
-18429,
-19159,
-20292,
-21451,
-22807,
-24883,
-27737,
-30752,
-33154,
-34803,
-36115,
-37553,
-39149,
-40784,
-42434,
-44148,
-45719,
-46695,
-46779,
-46059,
-44918,
-43581,
-42173,
-40774,
-39624,
-38793,
-38110,
-37276,
-36253,
-35258,
-34520,
-34048,
-33759,
-33727,
-34057,
-34593,
-34850,
-34409,
-33348,
-32153,
-31158,
-30228,
-28952,
-27197,
-25254,
-23561,
-22372,
-21725,
-21641,
-22158,
-23184,
-24398,
-25453,
-26153,
-26577,
-26882,
-27208,
-27651,
-28280,
-29122,
-30120,
-31145,
-32092,
-32874,
-33525,
-34113,
-34830,
-35783,
-36943,
-38142,
-39236,
-40282,
-41338,
-42368,
-43133,
-43499,
-43566,
-43534,
-43408,
-42905,
-41788,
-40130,
-38328,
-36716,
-35340,
-34053,
-32728,
-31448,
-30312,
-29383,
-28569,
-27763,
-26850,
-25798,
-24685,
-23700,
-23051,
-22795,
-22817,
-22980,
-23269,
-23777,
-24549,
-25494,
-26551,
-27782,
-29314,
-31099,
-32849,
-34362,
-35681,
-37056,
-38506,
-39679,
-40205,
-40043,
-39524,
-38974,
-38417,
-37783,
-37115,
-36599,
-36264,
-35931,
-35421,
-34777,
-34158,
-33595,
-33027,
-32491,
-32187,
-32184,
-32277,
-32152,
-31759,
-31275,
-30844,
-30379,
-29864,
-29519,
-29651,
-30247,
-30901,
-31259,
-31301,
-31248,
-31222,
-31213,
-31244,
-31426,
-31698,
-31809,
-31538,
-31034,
-30619,
-30391,
-30136,
-29689,
-29198,
-29040,
-29328,
-29935,
-30679,
-31559,
-32631,
-33823,
-35016,
-36160,
-37246,
-38238,
-39020,
-39640,
-40141,
-40441,
-40251,
-39411,
-38176,
-36973,
-35994,
-35069,
-34075,
-33165,
-32496,
-31931,
-31098,
-29978,
-28933,
-28302,
-27999,
-27778,
-27717,
-28120,
-29052,
-30078,
-30844,
-31492,
-32408,
-33565,
-34390,
-34462,
-33996,
-33478,
-33074,
-32445,
-31478,
-30480,
-29902,
-29636,
-29254,
-28475,
-27574,
-26940,
-26675,
-26648,
-26838,
-27369,
-28237,
-29109,
-29673,
-29943,
-30191,
-30657,
-31318,
-32170,
-33315,
-34908,
-36891,
-39022,
-41089,
-43026,
-44819,
-46321,
-47322,
-47681,
-47477,
-46868,
-45965,
-44754,
-43120,
-41021,
-38534,
-35873,
-33264,
-30784,
-28392,
-26035,
-23811,
-21941,
-20608,
-19853,
-19590,
-19722,
-20241,
-21101,
-22229,
-23386,
-24374,
-25063,
-25512,
-25870,
-26254,
-26722,
-27280,
-27995,
-28937,
-30133,
-31502,
-32943,
-34404,
-35822,
-37119,
-38179,
-38971,
-39541,
-39904,
-39997,
-39780,
-39415,
-39140,
-39038,
-38863,
-38226,
-37026,
-35493,
-34090,
-33121,
-32752,
-32993,
-33810,
-35038,
-36395,
-37601,
-38457,
-38908,
-38970,
-38717,
-38267,
-37632,
-36738,
-35410,
-33644,
-31612,
-29596,
-27764,
-26152,
-24802,
-23850,
-23407,
-23473,
-23859,
-24376,
-24945,
-25615,
-26502,
-27667,
-29056,
-30437,
-31526,
-32137,
-32288,
-32149,
-31831,
-31328,
-30621,
-29770,
-28991,
-28502,
-28436,
-28810,
-29514,
-30441,
-31489,
-32622,
-33717,
-34573,
-35031,
-35224,
-35599,
-36474,
-37736,
-38932,
-39817,
-40623,
-41638,
-42732,
-43469,
-43694,
-43857,
-44313,
-44815,
-44631,
-43461,
-41795,
-40187,
-38560,
-36370,
-33576,
-30820,
-28693,
-26902,
-24739,
-22079,
-19698,
-18342,
-17947,
-17915,
-17980,
-18434,
-19486,
-20785,
-21876,
-22721,
-23710,
-25061,
-26631,
-28254,
-29923,
-31574,
-32935,
-33874,
-34734,
-35935,
-37366,
-38429,
-38944,
-39551,
-40927,
-42797,
-44170,
-44498,
-44330,
-44340,
-44413,
-43850,
-42510,
-41085,
-40115,
-39223,
-37682,
-35500,
-33415,
-31852,
-30385,
-28549,
-26667,
-25635,
-25716,
-26309,
-26789,
-27233,
-28062,
-29112,
-29746,
-29647,
-29329,
-29447,
-30012,
-30481,
-30501,
-30247,
-29979,
-29652,
-29145,
-28685,
-28793,
-29683,
-31071,
-32440,
-33584,
-34569,
-35482,
-36252,
-36757,
-37020,
-37116,
-37086,
-36890,
-36402,
-35555,
-34321,
-32883,
-31504,
-30357,
-29358,
-28309,
-27234,
-26420,
-26210,
-26607,
-27435,
-28496,
-29822,
-31401,
-33108,
-34721,
-36169,
-37550,
-38882,
-40058,
-40861,
-41211,
-41144,
-40720,
-40005,
-39081,
-38106,
-37162,
-36212,
-35148,
-33941,
-32650,
-31337,
-30013,
-28703,
-27583,
-26846,
-26577,
-26593,
-26660,
-26623,
-26584,
-26673,
-27009,
-27539,
-28219,
-28966,
-29735,
-30455,
-31118,
-31748,
-32401,
-33039,
-33574,
-33920,
-34121,
-34292,
-34490,
-34686,
-34744,
-34616,
-34292,
-33809,
-33175,
-32421,
-31657,
-31057,
-30706,
-30539,
-30380,
-30177,
-30050,
-30243,
-30823,
-31714,
-32755,
-33951,
-35342,
-36878,
-38413,
-39846,
-41294,
-42804,
-44113,
-44694,
-44276,
-43081,
-41648,
-40185,
-38502,
-36376,
-33954,
-31615,
-29504,
-27482,
-25467,
-23769,
-22755,
-22475,
-22589,
-22825,
-23282,
-24132,
-25290,
-26377,
-27100,
-27499,
-27716,
-27775,
-27570,
-27090,
-26520,
-26067,
-25876,
-26044,
-26669,
-27797,
-29326,
-31046,
-32804,
-34530,
-36203,
-37817,
-39424,
-41088,
-42821,
-44435,
-45685,
-46452,
-46750,
-46717,
-46422,
-45931,
-45274,
-44421,
-43284,
-41816,
-40117,
-38357,
-36637,
-34929,
-33257,
-31743,
-30514,
-29479,
-28329,
-26838,
-24991,
-23063,
-21329,
-19966,
-19034,
-18522,
-18427,
-18715,
-19268,
-19911,
-20524,
-21219,
-22327,
-24066,
-26342,
-28688,
-30767,
-32502,
-33973,
-35138,
-35868,
-36293,
-36835,
-37803,
-39044,
-40104,
-40709,
-40962,
-41063,
-40990,
-40702,
-40293,
-40023,
-39960,
-39922,
-39694,
-39224,
-38502,
-37516,
-36347,
-35318,
-34717,
-34420,
-34000,
-33279,
-32568,
-32289,
-32371,
-32377,
-32096,
-31751,
-31546,
-31258,
-30491,
-29315,
-28214,
-27534,
-27062,
-26397,
-25489,
-24617,
-24012,
-23683,
-23724,
-24417,
-25929,
-27988,
-30051,
-31803,
-33289,
-34626,
-35787,
-36682,
-37390,
-38054,
-38666,
-39037,
-38979,
-38418,
-37374,
-35908,
-34235,
-32643,
-31325,
-30276,
-29429,
-28821,
-28449,
-28123,
-27652,
-27161,
-27160,
-27865,
-28969,
-29882,
-30499,
-31159,
-32174,
-33337,
-34481,
-35789,
-37687,
-40061,
-42165,
-43384,
-43775,
-43909,
-44000,
-43835,
-43110,
-41907,
-40405,
-38597,
-36410,
-33988,
-31731,
-29780,
-28000,
-26163,
-24380,
-22884,
-21792,
-21078,
-20783,
-21025,
-21739,
-22634,
-23520,
-24480,
-25665,
-26942,
-28044,
-28965,
-30035,
-31437,
-32901,
-34019,
-34706,
-35266,
-35869,
-36353,
-36537,
-36534,
-36649,
-36971,
-37341,
-37648,
-37908,
-38135,
-38190,
-38024,
-37844,
-37814,
-37746,
-37271,
-36398,
-35693,
-35642,
-36095,
-36482,
-36562,
-36634,
-36926,
-37117,
-36668,
-35576,
-34395,
-33486,
-32562,
-31108,
-29183,
-27381,
-26107,
-25122,
-24010,
-22842,
-22131,
-22159,
-22579,
-22976,
-23348,
-24123,
-25447,
-26981,
-28303,
-29475,
-30829,
-32471,
-34006,
-35095,
-35857,
-36716,
-37774,
-38632,
-38926,
-38793,
-38756,
-39037,
-39363,
-39378,
-39125,
-38955,
-38943,
-38772,
-38105,
-37111,
-36206,
-35622,
-35119,
-34450,
-33695,
-33125,
-32754,
-32267,
-31432,
-30459,
-29802,
-29632,
-29703,
-29643,
-29386,
-29120,
-28924,
-28624,
-27953,
-26966,
-26007,
-25409,
-25210,
-25138,
-25041,
-24980,
-25194,
-25679,
-26251,
-26759,
-27402,
-28536,
-30222,
-32173,
-33999,
-35697,
-37474,
-39432,
-41330,
-43009,
-44530,
-46087,
-47522,
-48355,
-48269,
-47365,
-45941,
-44085,
-41685,
-38917,
-36212,
-33944,
-31979,
-29996,
-27979,
-26281,
-25154,
-24422,
-23735,
-23051,
-22606,
-22524,
-22656,
-22878,
-23351,
-24321,
-25660,
-26901,
-27692,
-28123,
-28546,
-29185,
-29965,
-30814,
-31700,
-32562,
-33140,
-33177,
-32694,
-32072,
-31727,
-31808,
-32186,
-32641,
-33099,
-33498,
-33766,
-33794,
-33708,
-33860,
-34629,
-35992,
-37536,
-38799,
-39750,
-40691,
-41834,
-43035,
-44025,
-44831,
-45635,
-46382,
-46532,
-45633,
-43720,
-41325,
-38781,
-36057,
-33026,
-29935,
-27114,
-24661,
-22313,
-20034,
-18145,
-17038,
-16710,
-16891,
-17452,
-18424,
-19656,
-20716,
-21339,
-21825,
-22717,
-24153,
-25773,
-27275,
-28778,
-30579,
-32601,
-34508,
-36151,
-37719,
-39302,
-40683,
-41576,
-42138,
-42743,
-43431,
-43805,
-43454,
-42525,
-41434,
-40388,
-39268,
-38001,
-36846,
-36120,
-35841,
-35753,
-35671,
-35659,
-35836,
-36265,
-36862,
-37552,
-38181,
-38549,
-38517,
-38095,
-37321,
-36089,
-34211,
-31673,
-28768,
-25825,
-23005,
-20337,
-18001,
-16384,
-15766,
-16118,
-17127,
-18493,
-20079,
-21801,
-23614,
-25392,
-27047,
-28453,
-29524,
-30271,
-30835,
-31399,
-32107,
-33020,
-34149,
-35438,
-36804,
-38179,
-39586,
-41002,
-42281,
-43248,
-43955,
-44749,
-45882,
-47175,
-48107,
-48304,
-47873,
-47109,
-46099,
-44662,
-42671,
-40237,
-37606,
-34928,
-32343,
-30022,
-28107,
-26506,
-24982,
-23448,
-22086,
-21115,
-20484,
-20013,
-19618,
-19472,
-19673,
-20126,
-20562,
-20890,
-21154,
-21490,
-21984,
-22784,
-24047,
-25844,
-28017,
-30325,
-32630,
-34949,
-37300,
-39597,
-41715,
-43567,
-45136,
-46349,
-47053,
-47135,
-46599,
-45641,
-44527,
-43424,
-42315,
-41018,
-39391,
-37492,
-35497,
-33590,
-31873,
-30376,
-29132,
-28076,
-27075,
-26055,
-25059,
-24192,
-23422,
-22756,
-22425,
-22880,
-24310,
-26291,
-28175,
-29719,
-31329,
-33330,
-35464,
-37032,
-37777,
-38053,
-38337,
-38541,
-38254,
-37367,
-36246,
-35234,
-34294,
-33192,
-32006,
-31050,
-30426,
-29951,
-29462,
-29170,
-29338,
-29894,
-30472,
-30862,
-31228,
-31762,
-32345,
-32748,
-32974,
-33335,
-33920,
-34401,
-34307,
-33543,
-32468,
-31490,
-30731,
-30129,
-29632,
-29317,
-29200,
-29249,
-29475,
-29971,
-30791,
-31830,
-32871,
-33834,
-34777,
-35839,
-37019,
-38256,
-39352,
-40178,
-40526,
-40400,
-39926,
-39428,
-39101,
-38945,
-38760,
-38363,
-37610,
-36442,
-34785,
-32752,
-30645,
-28843,
-27561,
-26658,
-25892,
-25121,
-24468,
-24093,
-24018,
-24084,
-24211,
-24487,
-25102,
-26052,
-27097,
-27966,
-28617,
-29304,
-30197,
-31221,
-32088,
-32711,
-33320,
-34169,
-35184,
-35977,
-36355,
-36532,
-36885,
-37434,
-37821,
-37826,
-37680,
-37742,
-38020,
-38087,
-37773,
-37288,
-37012,
-36795,
-36275,
-35433,
-34827,
-34912,
-35429,
-35689,
-35413,
-34963,
-34686,
-34379,
-33636,
-32550,
-31676,
-31262,
-30853,
-29962,
-28723,
-27807,
-27480,
-27375,
-27087,
-26744,
-26719,
-26959,
-27039,
-26838,
-26839,
-27486,
-28591,
-29609,
-30347,
-31175,
-32326,
-33551,
-34476,
-35165,
-35949,
-36829,
-37330,
-37159,
-36549,
-35962,
-35514,
-34999,
-34401,
-33892,
-33498,
-32834,
-31704,
-30438,
-29642,
-29443,
-29405,
-29238,
-29164,
-29588,
-30362,
-30996,
-31283,
-31613,
-32432,
-33731,
-35239,
-36945,
-38990,
-41188,
-42854,
-43447,
-43138,
-42537,
-41951,
-41180,
-39931,
-38321,
-36579,
-34693,
-32417,
-29741,
-27095,
-24972,
-23539,
-22669,
-22231,
-22205,
-22535,
-22984,
-23382,
-23717,
-24153,
-24831,
-25802,
-27063,
-28562,
-30114,
-31514,
-32673,
-33676,
-34601,
-35386,
-35898,
-36144,
-36264,
-36320,
-36242,
-36002,
-35784,
-35852,
-36257,
-36803,
-37245,
-37605,
-37981,
-38408,
-38707,
-38685,
-38299,
-37703,
-37098,
-36701,
-36538,
-36502,
-36322,
-35893,
-35298,
-34730,
-34167,
-33407,
-32371,
-31281,
-30373,
-29526,
-28309,
-26561,
-24649,
-23119,
-22110,
-21296,
-20506,
-19991,
-20074,
-20710,
-21481,
-22335,
-23651,
-25749,
-28321,
-30752,
-32869,
-35126,
-37867,
-40728,
-42992,
-44410,
-45414,
-46418,
-47276,
-47606,
-47424,
-47106,
-46713,
-45750,
-43799,
-41211,
-38825,
-37051,
-35560,
-33833,
-31950,
-30290,
-28996,
-27721,
-26268,
-24892,
-24016,
-23583,
-23229,
-22762,
-22448,
-22550,
-22922,
-23251,
-23457,
-23828,
-24469,
-25231,
-25871,
-26454,
-27124,
-27824,
-28338,
-28659,
-29100,
-29897,
-30937,
-31926,
-32832,
-33870,
-35165,
-36602,
-38049,
-39562,
-41226,
-42828,
-44036,
-44726,
-45126,
-45512,
-45912,
-46305,
-46716,
-47148,
-47279,
-46591,
-44894,
-42558,
-40092,
-37729,
-35296,
-32729,
-30175,
-27767,
-25452,
-23124,
-20980,
-19351,
-18369,
-17834,
-17495,
-17347,
-17469,
-17828,
-18262,
-18735,
-19441,
-20523,
-21935,
-23462,
-24967,
-26436,
-27864,
-29199,
-30401,
-31522,
-32720,
-34148,
-35935,
-38022,
-40179,
-42086,
-43589,
-44731,
-45646,
-46339,
-46792,
-47022,
-47105,
-46936,
-46354,
-45348,
-44187,
-43063,
-41851,
-40298,
-38547,
-37056,
-36052,
-35158,
-33921,
-32435,
-31240,
-30460,
-29545,
-27989,
-26092,
-24639,
-23868,
-23180,
-21971,
-20464,
-19381,
-19009,
-19013,
-19093,
-19542,
-20747,
-22534,
-24302,
-25758,
-27277,
-29226,
-31416,
-33264,
-34518,
-35437,
-36291,
-36954,
-37079,
-36640,
-35923,
-35280,
-34851,
-34709,
-34957,
-35591,
-36389,
-37100,
-37703,
-38383,
-39161,
-39816,
-40149,
-40340,
-40727,
-41380,
-41908,
-41936,
-41539,
-41086,
-40742,
-40125,
-38853,
-36997,
-35130,
-33631,
-32403,
-31060,
-29630,
-28433,
-27684,
-27049,
-26102,
-24793,
-23542,
-22672,
-22065,
-21505,
-21074,
-21093,
-21630,
-22348,
-22940,
-23536,
-24465,
-25791,
-27237,
-28650,
-30249,
-32290,
-34597,
-36709,
-38343,
-39592,
-40581,
-41164,
-41172,
-40793,
-40411,
-40168,
-39740,
-38863,
-37676,
-36622,
-35869,
-35234,
-34614,
-34175,
-34155,
-34335,
-34205,
-33507,
-32539,
-31815,
-31533,
-31483,
-31482,
-31586,
-31995,
-32713,
-33528,
-34271,
-34913,
-35466,
-35823,
-35766,
-35248,
-34393,
-33407,
-32347,
-31178,
-29957,
-28919,
-28261,
-27926,
-27646,
-27248,
-26879,
-26791,
-27052,
-27472,
-27913,
-28465,
-29317,
-30388,
-31385,
-32088,
-32590,
-33055,
-33502,
-33742,
-33797,
-33800,
-33822,
-33589,
-32791,
-31558,
-30436,
-29915,
-29962,
-30218,
-30460,
-30881,
-31738,
-33042,
-34507,
-35903,
-37176,
-38422,
-39622,
-40689,
-41569,
-42303,
-42958,
-43466,
-43624,
-43240,
-42297,
-40897,
-39203,
-37233,
-35062,
-32842,
-30830,
-29082,
-27414,
-25611,
-23775,
-22305,
-21456,
-21116,
-20969,
-20951,
-21292,
-22116,
-23176,
-24111,
-24882,
-25860,
-27340,
-29205,
-31033,
-32560,
-33812,
-34929,
-35915,
-36699,
-37329,
-37957,
-38643,
-39228,
-39480,
-39322,
-38967,
-38648,
-38502,
-38364,
-38108,
-37674,
-37150,
-36514,
-35646,
-34518,
-33395,
-32623,
-32245,
-31902,
-31278,
-30513,
-30086,
-30190,
-30575,
-30903,
-31297,
-32025,
-32980,
-33569,
-33398,
-32778,
-32334,
-32233,
-32029,
-31440,
-30740,
-30469,
-30627,
-30685,
-30259,
-29544,
-29008,
-28872,
-29073,
-29594,
-30524,
-31727,
-32846,
-33601,
-34180,
-34841,
-35558,
-35958,
-35906,
-35677,
-35576,
-35472,
-35015,
-34134,
-33222,
-32598,
-32119,
-31398,
-30325,
-29229,
-28492,
-28188,
-28169,
-28309,
-28612,
-29085,
-29708,
-30484,
-31497,
-32756,
-34104,
-35321,
-36272,
-36999,
-37659,
-38365,
-39124,
-39748,
-39995,
-39785,
-39315,
-38885,
-38502,
-37852,
-36627,
-34938,
-33160,
-31513,
-29829,
-27966,
-26105,
-24662,
-23814,
-23355,
-23082,
-23058,
-23445,
-24157,
-24959,
-25835,
-27111,
-28974,
-31131,
-33041,
-34499,
-35808,
-37203,
-38535,
-39372,
-39604,
-39486,
-39314,
-39054,
-38608,
-37987,
-37361,
-36707,
-35869,
-34812,
-33810,
-33109,
-32677,
-32266,
-31785,
-31401,
-31201,
-31038,
-30756,
-30489,
-30636,
-31327,
-32279,
-33012,
-33337,
-33411,
-33453,
-33503,
-33433,
-33159,
-32722,
-32299,
-32069,
-32064,
-32057,
-31662,
-30708,
-29408,
-28209,
-27323,
-26589,
-25795,
-24988,
-24450,
-24239,
-24186,
-24076,
-24079,
-24531,
-25623,
-27288,
-29428,
-32103,
-35355,
-38977,
-42555,
-45781,
-48568,
-50847,
-52333,
-52636,
-51583,
-49403,
-46603,
-43642,
-40826,
-38236,
-35902,
-33765,
-31838,
-30105,
-28605,
-27365,
-26436,
-25893,
-25696,
-25649,
-25419,
-24776,
-23766,
-22668,
-21772,
-21212,
-20955,
-20901,
-21005,
-21273,
-21836,
-22806,
-24219,
-25955,
-27834,
-29760,
-31774,
-33861,
-35915,
-37754,
-39369,
-40858,
-42262,
-43319,
-43606,
-42883,
-41337,
-39460,
-37749,
-36412,
-35453,
-34813,
-34517,
-34600,
-35028,
-35652,
-36337,
-37049,
-37800,
-38540,
-39047,
-39064,
-38502,
-37517,
-36392,
-35324,
-34309,
-33286,
-32213,
-31111,
-29990,
-28838,
-27722,
-26799,
-26224,
-25968,
-25880,
-25816,
-25820,
-25997,
-26301,
-26563,
-26618,
-26592,
-26702,
-27039,
-27429,
-27670,
-27770,
-27910,
-28178,
-28396,
-28396,
-28201,
-28149,
-28529,
-29461,
-30841,
-32536,
-34358,
-36082,
-37497,
-38588,
-39528,
-40514,
-41554,
-42575,
-43582,
-44677,
-45860,
-46875,
-47373,
-47226,
-46586,
-45703,
-44611,
-43146,
-41162,
-38694,
-35987,
-33296,
-30762,
-28410,
-26194,
-24115,
-22279,
-20798,
-19761,
-19172,
-19016,
-19330,
-20088,
-21119,
-22148,
-22960,
-23547,
-24051,
-24548,
-25071,
-25657,
-26450,
-27529,
-28841,
-30234,
-31696,
-33263,
-34896,
-36348,
-37442,
-38291,
-39143,
-39994,
-40512,
-40393,
-39801,
-39129,
-38535,
-37752,
-36590,
-35356,
-34640,
-34677,
-35124,
-35525,
-35834,
-36295,
-37020,
-37833,
-38593,
-39441,
-40493,
-41512,
-42037,
-41835,
-41134,
-40247,
-39221,
-37855,
-36059,
-33907,
-31510,
-28909,
-26252,
-23904,
-22164,
-21052,
-20351,
-19913,
-19784,
-19975,
-20344,
-20790,
-21397,
-22315,
-23456,
-24502,
-25257,
-25782,
-26273,
-26704,
-27062,
-27425,
-28084,
-29160,
-30580,
-32252,
-34235,
-36512,
-38761,
-40561,
-41842,
-42989,
-44361,
-45888,
-47242,
-48272,
-49096,
-49695,
-49797,
-49154,
-47950,
-46558,
-45122,
-43383,
-41186,
-38697,
-36284,
-34021,
-31758,
-29470,
-27382,
-25689,
-24176,
-22528,
-20716,
-19141,
-18167,
-17745,
-17534,
-17357,
-17341,
-17735,
-18566,
-19717,
-21059,
-22616,
-24394,
-26343,
-28318,
-30264,
-32173,
-34071,
-35889,
-37493,
-38777,
-39699,
-40371,
-40834,
-41151,
-41246,
-41151,
-40918,
-40635,
-40269,
-39760,
-39105,
-38433,
-37873,
-37414,
-36953,
-36397,
-35801,
-35252,
-34825,
-34557,
-34474,
-34541,
-34604,
-34438,
-33981,
-33349,
-32771,
-32310,
-31879,
-31418,
-30913,
-30405,
-29757,
-28891,
-27878,
-27019,
-26511,
-26226,
-25897,
-25359,
-24826,
-24563,
-24681,
-25096,
-25700,
-26510,
-27555,
-28773,
-30042,
-31342,
-32759,
-34388,
-36169,
-37916,
-39382,
-40415,
-40936,
-41061,
-40993,
-40907,
-40791,
-40396,
-39563,
-38357,
-37124,
-36070,
-35111,
-33928,
-32377,
-30594,
-28908,
-27470,
-26298,
-25373,
-24816,
-24713,
-24961,
-25316,
-25671,
-26210,
-27181,
-28608,
-30230,
-31793,
-33304,
-34863,
-36428,
-37715,
-38551,
-39056,
-39521,
-40004,
-40299,
-40197,
-39779,
-39276,
-38708,
-37830,
-36467,
-34754,
-33087,
-31653,
-30378,
-29083,
-27803,
-26707,
-25904,
-25371,
-25109,
-25212,
-25757,
-26590,
-27455,
-28158,
-28737,
-29289,
-29864,
-30489,
-31263,
-32321,
-33629,
-34950,
-36014,
-36788,
-37426,
-38046,
-38527,
-38661,
-38318,
-37657,
-36890,
-36209,
-35677,
-35271,
-34942,
-34593,
-34129,
-33498,
-32772,
-32091,
-31627,
-31497,
-31657,
-31967,
-32171,
-32084,
-31708,
-31185,
-30728,
-30389,
-30114,
-29768,
-29340,
-28920,
-28680,
-28741,
-29095,
-29607,
-30088,
-30435,
-30632,
-30765,
-30882,
-31052,
-31333,
-31806,
-32469,
-33261,
-34084,
-34885,
-35626,
-36207,
-36527,
-36601,
-36585,
-36606,
-36610,
-36440,
-36045,
-35577,
-35127,
-34644,
-33982,
-33245,
-32673,
-32426,
-32327,
-32171,
-32001,
-32048,
-32385,
-32756,
-32887,
-32803,
-32690,
-32574,
-32265,
-31750,
-31356,
-31426,
-31880,
-32258,
-32251,
-31970,
-31733,
-31622,
-31541,
-31396,
-31267,
-31081,
-30659,
-29862,
-28923,
-28274,
-28139,
-28487,
-29088,
-29834,
-30535,
-30966,
-30999,
-30767,
-30622,
-30670,
-30818,
-30885,
-30938,
-31078,
-31289,
-31450,
-31631,
-32113,
-33121,
-34641,
-36502,
-38549,
-40588,
-42219,
-43092,
-43162,
-42796,
-42345,
-41860,
-41273,
-40685,
-40209,
-39663,
-38543,
-36716,
-34647,
-33049,
-32022,
-31072,
-29802,
-28397,
-27296,
-26501,
-25653,
-24617,
-23747,
-23433,
-23493,
-23438,
-23041,
-22604,
-22437,
-22522,
-22598,
-22685,
-23005,
-23706,
-24633,
-25660,
-26922,
-28643,
-30813,
-33093,
-35183,
-36956,
-38412,
-39524,
-40330,
-41071,
-41973,
-43009,
-43884,
-44354,
-44531,
-44647,
-44847,
-45069,
-45260,
-45413,
-45404,
-44976,
-43930,
-42398,
-40640,
-38764,
-36607,
-34110,
-31523,
-29199,
-27190,
-25216,
-23067,
-20922,
-19120,
-17874,
-17144,
-16921,
-17314,
-18301,
-19622,
-20945,
-22162,
-23438,
-24788,
-26006,
-26854,
-27411,
-27986,
-28802,
-29813,
-30959,
-32297,
-33902,
-35632,
-37169,
-38376,
-39395,
-40462,
-41630,
-42823,
-44023,
-45245,
-46324,
-46846,
-46490,
-45355,
-43940,
-42673,
-41678,
-40806,
-39870,
-38790,
-37507,
-36004,
-34384,
-32784,
-31326,
-29931,
-28538,
-27192,
-26071,
-25254,
-24621,
-23913,
-23048,
-22199,
-21648,
-21518,
-21640,
-21747,
-21831,
-22189,
-23177,
-24765,
-26574,
-28213,
-29673,
-31174,
-32783,
-34284,
-35521,
-36616,
-37850,
-39132,
-40089,
-40423,
-40285,
-39972,
-39541,
-38804,
-37793,
-36897,
-36474,
-36354,
-36078,
-35377,
-34529,
-33913,
-33599,
-33375,
-33099,
-32856,
-32775,
-32775,
-32729,
-32602,
-32531,
-32640,
-32942,
-33406,
-33917,
-34313,
-34391,
-34082,
-33489,
-32827,
-32203,
-31649,
-31106,
-30496,
-29683,
-28638,
-27518,
-26620,
-26092,
-25871,
-25894,
-26282,
-27156,
-28300,
-29256,
-29774,
-30162,
-30803,
-31761,
-32639,
-33273,
-33865,
-34716,
-35742,
-36603,
-37195,
-37701,
-38189,
-38367,
-37956,
-37122,
-36338,
-35810,
-35330,
-34673,
-33973,
-33439,
-32983,
-32349,
-31606,
-31292,
-31800,
-32946,
-34159,
-35104,
-35793,
-36229,
-36194,
-35646,
-35006,
-34798,
-35021,
-35017,
-34237,
-32757,
-31080,
-29541,
-28087,
-26751,
-25806,
-25467,
-25487,
-25359,
-24917,
-24504,
-24495,
-24830,
-25210,
-25598,
-26377,
-27801,
-29659,
-31434,
-32880,
-34179,
-35573,
-37013,
-38311,
-39415,
-40500,
-41596,
-42486,
-42928,
-43015,
-43081,
-43326,
-43515,
-43290,
-42422,
-41053,
-39341,
-37424,
-35386,
-33418,
-31677,
-30179,
-28775,
-27401,
-26154,
-25198,
-24598,
-24299,
-24286,
-24529,
-24996,
-25602,
-26322,
-27193,
-28109,
-28759,
-28865,
-28521,
-28166,
-28201,
-28602,
-29123,
-29623,
-30199,
-30896,
-31565,
-32067,
-32504,
-33132,
-33931,
-34672,
-35158,
-35538,
-35976,
-36378,
-36461,
-36261,
-36174,
-36513,
-37120,
-37592,
-37920,
-38446,
-39430,
-40534,
-41256,
-41405,
-41194,
-40761,
-39946,
-38626,
-37030,
-35456,
-33915,
-32130,
-30132,
-28374,
-27267,
-26633,
-25960,
-25070,
-24316,
-24082,
-24296,
-24624,
-24991,
-25609,
-26567,
-27625,
-28541,
-29411,
-30462,
-31618,
-32491,
-32830,
-32807,
-32727,
-32664,
-32430,
-31976,
-31424,
-30908,
-30446,
-30051,
-29976,
-30398,
-31239,
-32146,
-32879,
-33440,
-33839,
-33975,
-33802,
-33639,
-33968,
-34961,
-36316,
-37631,
-38858,
-40220,
-41803,
-43417,
-44759,
-45741,
-46300,
-46338,
-45704,
-44465,
-42762,
-40671,
-38043,
-34881,
-31512,
-28402,
-25761,
-23467,
-21436,
-19846,
-18947,
-18671,
-18681,
-18744,
-19002,
-19702,
-20832,
-22076,
-23142,
-24057,
-24971,
-25977,
-26946,
-27837,
-28749,
-29885,
-31347,
-33035,
-34797,
-36470,
-37951,
-39169,
-40115,
-40932,
-41784,
-42783,
-43877,
-44895,
-45673,
-46072,
-46018,
-45451,
-44429,
-43020,
-41320,
-39308,
-37017,
-34611,
-32420,
-30701,
-29515,
-28676,
-28094,
-27727,
-27562,
-27400,
-27034,
-26484,
-26056,
-26028,
-26363,
-26776,
-27057,
-27227,
-27379,
-27436,
-27282,
-26988,
-26891,
-27309,
-28241,
-29459,
-30752,
-32101,
-33484,
-34721,
-35571,
-35998,
-36272,
-36697,
-37280,
-37706,
-37607,
-36913,
-35829,
-34609,
-33322,
-31921,
-30445,
-29127,
-28217,
-27814,
-27852,
-28287,
-29141,
-30363,
-31712,
-32907,
-33887,
-34837,
-35889,
-36936,
-37835,
-38631,
-39590,
-40696,
-41599,
-41855,
-41475,
-40779,
-40032,
-39112,
-37859,
-36369,
-34934,
-33644,
-32284,
-30720,
-29092,
-27698,
-26590,
-25642,
-24836,
-24349,
-24253,
-24328,
-24305,
-24243,
-24435,
-25022,
-25845,
-26722,
-27724,
-28937,
-30133,
-30968,
-31380,
-31762,
-32436,
-33207,
-33675,
-33793,
-33949,
-34455,
-35051,
-35303,
-35128,
-34865,
-34788,
-34800,
-34737,
-34731,
-35049,
-35667,
-36210,
-36394,
-36377,
-36490,
-36823,
-37174,
-37368,
-37524,
-37750,
-38018,
-38151,
-38172,
-38248,
-38422,
-38539,
-38400,
-38055,
-37651,
-37139,
-36219,
-34644,
-32507,
-30201,
-28067,
-26259,
-24761,
-23590,
-22763,
-22276,
-22046,
-21999,
-22105,
-22392,
-22899,
-23622,
-24497,
-25347,
-26063,
-26639,
-27220,
-27895,
-28640,
-29388,
-30243,
-31415,
-32912,
-34413,
-35479,
-36031,
-36413,
-37059,
-38063,
-39268,
-40574,
-42073,
-43691,
-45061,
-45671,
-45529,
-45019,
-44576,
-44085,
-43237,
-41982,
-40682,
-39670,
-38768,
-37608,
-36084,
-34521,
-33191,
-31956,
-30496,
-28789,
-27174,
-25927,
-24988,
-24124,
-23311,
-22715,
-22355,
-22056,
-21645,
-21267,
-21166,
-21421,
-21858,
-22372,
-23081,
-24192,
-25705,
-27416,
-29133,
-30803,
-32432,
-33908,
-35133,
-36091,
-36977,
-37880,
-38754,
-39321,
-39480,
-39315,
-39135,
-39072,
-39029,
-38742,
-38172,
-37563,
-37228,
-37166,
-37097,
-36753,
-36204,
-35659,
-35184,
-34652,
-34050,
-33625,
-33654,
-34027,
-34387,
-34529,
-34635,
-35006,
-35587,
-36049,
-36135,
-35898,
-35473,
-34787,
-33696,
-32235,
-30760,
-29550,
-28615,
-27755,
-26880,
-26113,
-25555,
-25152,
-24758,
-24407,
-24315,
-24693,
-25468,
-26362,
-27091,
-27645,
-28208,
-28910,
-29684,
-30286,
-30634,
-30817,
-30963,
-31030,
-30871,
-30539,
-30352,
-30608,
-31335,
-32266,
-33216,
-34210,
-35375,
-36674,
-38011,
-39328,
-40721,
-42228,
-43729,
-45032,
-46004,
-46597,
-46807,
-46659,
-46222,
-45537,
-44490,
-42942,
-40915,
-38661,
-36402,
-34118,
-31695,
-29202,
-26973,
-25166,
-23644,
-22152,
-20730,
-19700,
-19206,
-19047,
-18893,
-18702,
-18688,
-18983,
-19502,
-20168,
-21079,
-22436,
-24238,
-26289,
-28404,
-30503,
-32539,
-34432,
-36102,
-37589,
-38892,
-39943,
-40652,
-41116,
-41560,
-42073,
-42522,
-42731,
-42684,
-42493,
-42137,
-41496,
-40582,
-39603,
-38736,
-37906,
-36884,
-35626,
-34333,
-33165,
-32095,
-31064,
-30169,
-29642,
-29459,
-29415,
-29302,
-29206,
-29311,
-29582,
-29807,
-29789,
-29626,
-29468,
-29400,
-29322,
-29174,
-29012,
-28902,
-28945,
-29138,
-29513,
-30000,
-30504,
-30982,
-31474,
-32042,
-32673,
-33281,
-33853,
-34441,
-35019,
-35454,
-35600,
-35472,
-35198,
-34889,
-34541,
-34148,
-33711,
-33139,
-32302,
-31191,
-30065,
-29266,
-28804,
-28346,
-27678,
-27028,
-26921,
-27518,
-28474,
-29324,
-30072,
-31064,
-32462,
-34013,
-35344,
-36495,
-37810,
-39429,
-41030,
-42134,
-42623,
-42788,
-42919,
-43002,
-42760,
-42077,
-40985,
-39584,
-37817,
-35636,
-33212,
-30898,
-29021,
-27586,
-26418,
-25310,
-24267,
-23403,
-22864,
-22698,
-22889,
-23303,
-23827,
-24383,
-25027,
-25832,
-26807,
-27843,
-28925,
-30109,
-31465,
-32823,
-33862,
-34402,
-34592,
-34752,
-34982,
-35102,
-34933,
-34580,
-34369,
-34459,
-34719,
-34884,
-34899,
-34910,
-35089,
-35492,
-36046,
-36664,
-37220,
-37607,
-37817,
-37977,
-38221,
-38527,
-38731,
-38760,
-38707,
-38632,
-38436,
-37850,
-36872,
-35700,
-34574,
-33383,
-31905,
-30124,
-28392,
-27064,
-26062,
-25073,
-23879,
-22750,
-22037,
-21844,
-21964,
-22198,
-22661,
-23531,
-24788,
-26165,
-27428,
-28663,
-30088,
-31792,
-33577,
-35149,
-36403,
-37473,
-38585,
-39775,
-40897,
-41648,
-41910,
-41789,
-41604,
-41546,
-41534,
-41256,
-40504,
-39341,
-37986,
-36593,
-35197,
-33881,
-32829,
-32137,
-31595,
-30866,
-29807,
-28713,
-27937,
-27583,
-27459,
-27413,
-27549,
-27936,
-28389,
-28577,
-28438,
-28305,
-28479,
-28884,
-29152,
-29090,
-28887,
-28718,
-28611,
-28400,
-28217,
-28323,
-28844,
-29555,
-30194,
-30784,
-31511,
-32354,
-33059,
-33510,
-34045,
-35034,
-36483,
-37926,
-39060,
-40020,
-41165,
-42546,
-43841,
-44729,
-45108,
-45020,
-44391,
-43196,
-41555,
-39712,
-37758,
-35623,
-33379,
-31314,
-29664,
-28283,
-26882,
-25440,
-24320,
-23765,
-23580,
-23363,
-23095,
-23086,
-23501,
-24036,
-24295,
-24341,
-24562,
-25162,
-25853,
-26355,
-26770,
-27432,
-28335,
-29185,
-29803,
-30552,
-31781,
-33395,
-34891,
-36125,
-37436,
-39135,
-40814,
-41678,
-41419,
-40609,
-40052,
-39925,
-39762,
-39115,
-38059,
-36967,
-35985,
-35053,
-34175,
-33608,
-33618,
-34212,
-35182,
-36303,
-37358,
-38112,
-38403,
-38332,
-38155,
-38008,
-37640,
-36695,
-35077,
-32980,
-30671,
-28254,
-25892,
-23860,
-22430,
-21559,
-21037,
-20771,
-20939,
-21597,
-22558,
-23541,
-24631,
-26043,
-27663,
-28883,
-29276,
-29125,
-29174,
-29704,
-30257,
-30293,
-29945,
-29908,
-30611,
-31884,
-33371,
-35027,
-36971,
-39017,
-40761,
-42032,
-43122,
-44267,
-45267,
-45739,
-45661,
-45447,
-45294,
-44950,
-44055,
-42767,
-41553,
-40595,
-39567,
-38110,
-36393,
-34832,
-33584,
-32353,
-30853,
-29101,
-27286,
-25414,
-23445,
-21543,
-20050,
-19153,
-18695,
-18495,
-18631,
-19282,
-20370,
-21524,
-22456,
-23206,
-23976,
-24823,
-25743,
-26808,
-28236,
-30010,
-31855,
-33452,
-34758,
-35962,
-37191,
-38374,
-39446,
-40317,
-40962,
-41256,
-41241,
-41177,
-41329,
-41663,
-41857,
-41670,
-41151,
-40475,
-39693,
-38812,
-38019,
-37618,
-37647,
-37776,
-37669,
-37366,
-37159,
-37107,
-36899,
-36253,
-35285,
-34330,
-33520,
-32682,
-31620,
-30336,
-28815,
-26946,
-24635,
-22220,
-20195,
-18910,
-18242,
-18015,
-18264,
-19138,
-20536,
-22085,
-23570,
-25130,
-26995,
-29069,
-30953,
-32341,
-33218,
-33648,
-33625,
-33172,
-32576,
-32288,
-32494,
-33093,
-33916,
-35054,
-36647,
-38572,
-40407,
-41882,
-43086,
-44322,
-45642,
-46804,
-47599,
-48004,
-48127,
-47819,
-46826,
-45031,
-42714,
-40284,
-37953,
-35675,
-33362,
-31164,
-29254,
-27653,
-26133,
-24569,
-23046,
-21793,
-20810,
-19970,
-19230,
-18848,
-19003,
-19532,
-19951,
-20054,
-20152,
-20742,
-21944,
-23456,
-24968,
-26556,
-28402,
-30497,
-32625,
-34702,
-36893,
-39200,
-41307,
-42736,
-43386,
-43537,
-43512,
-43392,
-43133,
-42802,
-42445,
-41900,
-40924,
-39471,
-37901,
-36517,
-35397,
-34412,
-33604,
-33096,
-32784,
-32302,
-31412,
-30351,
-29573,
-29179,
-28853,
-28319,
-27703,
-27387,
-27491,
-27875,
-28415,
-29184,
-30215,
-31278,
-32035,
-32448,
-32732,
-33107,
-33462,
-33583,
-33424,
-33114,
-32761,
-32329,
-31839,
-31451,
-31419,
-31722,
-32161,
-32494,
-32700,
-32907,
-33185,
-33468,
-33612,
-33583,
-33465,
-33371,
-33300,
-33139,
-32759,
-32206,
-31637,
-31173,
-30688,
-29943,
-28866,
-27768,
-27117,
-27175,
-27755,
-28491,
-29220,
-30059,
-31209,
-32626,
-34051,
-35286,
-36397,
-37570,
-38912,
-40251,
-41366,
-42110,
-42517,
-42592,
-42314,
-41667,
-40785,
-39867,
-38944,
-37818,
-36224,
-34198,
-32076,
-30278,
-28902,
-27717,
-26424,
-24938,
-23495,
-22347,
-21647,
-21317,
-21279,
-21530,
-22190,
-23285,
-24675,
-26113,
-27459,
-28835,
-30453,
-32383,
-34400,
-36180,
-37522,
-38469,
-39169,
-39729,
-40176,
-40485,
-40610,
-40467,
-40000,
-39263,
-38390,
-37525,
-36695,
-35905,
-35175,
-34538,
-33928,
-33159,
-32130,
-30942,
-29867,
-29061,
-28457,
-27873,
-27316,
-27000,
-27192,
-27900,
-28907,
-29937,
-30923,
-31923,
-32987,
-33979,
-34712,
-35078,
-35135,
-34961,
-34603,
-34085,
-33515,
-33035,
-32697,
-32425,
-32131,
-31856,
-31689,
-31647,
-31607,
-31528,
-31520,
-31758,
-32272,
-32918,
-33568,
-34172,
-34677,
-34909,
-34728,
-34207,
-33648,
-33261,
-33037,
-32838,
-32630,
-32481,
-32340,
-32046,
-31480,
-30827,
-30371,
-30251,
-30328,
-30395,
-30361,
-30261,
-30157,
-30120,
-30284,
-30792,
-31659,
-32724,
-33770,
-34627,
-35280,
-35761,
-36245,
-36867,
-37682,
-38453,
-38858,
-38682,
-38019,
-37092,
-36059,
-34964,
-33821,
-32706,
-31604,
-30495,
-29331,
-28233,
-27297,
-26572,
-26011,
-25658,
-25569,
-25747,
-26054,
-26412,
-26916,
-27710,
-28782,
-29965,
-31154,
-32402,
-33761,
-35078,
-36161,
-36948,
-37643,
-38332,
-38934,
-39235,
-39170,
-38819,
-38260,
-37533,
-36770,
-36162,
-35832,
-35617,
-35305,
-34824,
-34305,
-33822,
-33275,
-32598,
-31897,
-31491,
-31455,
-31706,
-31984,
-32234,
-32433,
-32545,
-32440,
-32048,
-31441,
-30715,
-29923,
-29078,
-28265,
-27653,
-27319,
-27170,
-26979,
-26578,
-26005,
-25501,
-25303,
-25520,
-25997,
-26519,
-26893,
-27132,
-27380,
-27783,
-28438,
-29288,
-30268,
-31368,
-32708,
-34494,
-36783,
-39502,
-42470,
-45599,
-48811,
-51831,
-54173,
-55390,
-55381,
-54370,
-52555,
-50003,
-46759,
-43133,
-39479,
-35945,
-32367,
-28677,
-25078,
-21962,
-19478,
-17540,
-16029,
-15026,
-14574,
-14609,
-14918,
-15426,
-16154,
-17039,
-17923,
-18728,
-19619,
-20816,
-22393,
-24266,
-26454,
-29064,
-32076,
-35169,
-37921,
-40106,
-41757,
-43012,
-43983,
-44850,
-45803,
-46855,
-47757,
-48182,
-47996,
-47245,
-45903,
-43875,
-41254,
-38486,
-36074,
-34174,
-32618,
-31304,
-30448,
-30248,
-30542,
-30871,
-30992,
-31074,
-31420,
-32028,
-32638,
-33039,
-33241,
-33240,
-32845,
-31802,
-30178,
-28337,
-26679,
-25333,
-24238,
-23403,
-23003,
-23129,
-23682,
-24425,
-25251,
-26267,
-27507,
-28800,
-29818,
-30402,
-30685,
-30873,
-30995,
-30921,
-30593,
-30231,
-30117,
-30415,
-31133,
-32279,
-33927,
-36009,
-38278,
-40425,
-42410,
-44293,
-46072,
-47430,
-48077,
-48001,
-47389,
-46401,
-44991,
-43197,
-41253,
-39400,
-37655,
-35813,
-33790,
-31725,
-29705,
-27672,
-25534,
-23554,
-22141,
-21421,
-21031,
-20537,
-19955,
-19676,
-19966,
-20669,
-21491,
-22392,
-23532,
-24954,
-26460,
-27963,
-29524,
-31286,
-33065,
-34632,
-35967,
-37324,
-38767,
-39993,
-40622,
-40721,
-40667,
-40677,
-40516,
-39974,
-39225,
-38685,
-38359,
-37775,
-36598,
-35153,
-34118,
-33721,
-33501,
-32878,
-31818,
-30702,
-29814,
-29027,
-28267,
-27720,
-27754,
-28423,
-29470,
-30587,
-31708,
-32833,
-33900,
-34776,
-35431,
-35879,
-36051,
-35882,
-35418,
-34892,
-34356,
-33637,
-32513,
-31126,
-29844,
-28878,
-28085,
-27323,
-26758,
-26739,
-27286,
-28045,
-28693,
-29295,
-30137,
-31197,
-32196,
-32908,
-33481,
-34168,
-34978,
-35745,
-36395,
-37028,
-37616,
-37859,
-37475,
-36575,
-35557,
-34670,
-33826,
-32830,
-31801,
-31053,
-30780,
-30897,
-31207,
-31692,
-32354,
-33045,
-33464,
-33446,
-33192,
-33082,
-33337,
-33876,
-34412,
-34790,
-34964,
-35033,
-34970,
-34711,
-34190,
-33447,
-32639,
-31867,
-31089,
-30203,
-29158,
-28105,
-27224,
-26613,
-26213,
-26008,
-26084,
-26541,
-27384,
-28403,
-29433,
-30376,
-31266,
-32171,
-33146,
-34255,
-35481,
-36664,
-37606,
-38181,
-38463,
-38599,
-38623,
-38494,
-38235,
-37984,
-37877,
-37804,
-37494,
-36784,
-35784,
-34797,
-33971,
-33241,
-32433,
-31545,
-30709,
-30095,
-29710,
-29492,
-29348,
-29250,
-29171,
-29129,
-29198,
-29481,
-29981,
-30528,
-30925,
-31140,
-31380,
-31808,
-32324,
-32563,
-32253,
-31468,
-30566,
-29861,
-29438,
-29193,
-29036,
-28941,
-28892,
-28905,
-29002,
-29236,
-29618,
-30084,
-30605,
-31242,
-32075,
-33095,
-34198,
-35285,
-36329,
-37328,
-38256,
-39143,
-40065,
-41099,
-42105,
-42874,
-43244,
-43263,
-42944,
-42155,
-40785,
-39003,
-37283,
-35923,
-34735,
-33284,
-31363,
-29271,
-27409,
-25972,
-24874,
-24122,
-23792,
-23961,
-24403,
-24848,
-25164,
-25452,
-25813,
-26244,
-26604,
-26871,
-27086,
-27390,
-27813,
-28269,
-28555,
-28537,
-28367,
-28374,
-28855,
-29722,
-30703,
-31579,
-32462,
-33538,
-34896,
-36484,
-38223,
-40001,
-41514,
-42398,
-42552,
-42326,
-42210,
-42365,
-42586,
-42649,
-42570,
-42410,
-41997,
-41101,
-39730,
-38261,
-36983,
-35855,
-34630,
-33229,
-31770,
-30356,
-28952,
-27561,
-26299,
-25270,
-24353,
-23448,
-22681,
-22339,
-22456,
-22687,
-22701,
-22658,
-22997,
-23982,
-25348,
-26773,
-28180,
-29732,
-31391,
-32858,
-33926,
-34756,
-35578,
-36351,
-36707,
-36457,
-35883,
-35396,
-35198,
-35102,
-35008,
-35033,
-35335,
-35738,
-35904,
-35770,
-35699,
-36080,
-36724,
-37092,
-36831,
-36305,
-36072,
-36322,
-36706,
-36947,
-37200,
-37736,
-38389,
-38581,
-38051,
-37110,
-36318,
-35710,
-34899,
-33684,
-32321,
-31202,
-30211,
-29009,
-27538,
-26199,
-25322,
-24706,
-23960,
-23102,
-22566,
-22696,
-23278,
-24003,
-24811,
-25969,
-27440,
-28861,
-29881,
-30626,
-31434,
-32393,
-33253,
-33847,
-34361,
-35052,
-35855,
-36452,
-36703,
-36835,
-37145,
-37578,
-37876,
-37896,
-37822,
-37861,
-37918,
-37728,
-37168,
-36432,
-35794,
-35303,
-34837,
-34319,
-33882,
-33671,
-33714,
-33893,
-34139,
-34440,
-34704,
-34809,
-34691,
-34571,
-34633,
-34800,
-34633,
-33883,
-32722,
-31634,
-30830,
-30074,
-29090,
-27948,
-26986,
-26350,
-25885,
-25402,
-25085,
-25209,
-25834,
-26677,
-27470,
-28221,
-29069,
-29971,
-30747,
-31231,
-31475,
-31527,
-31387,
-31038,
-30644,
-30461,
-30695,
-31369,
-32384,
-33530,
-34552,
-35269,
-35812,
-36539,
-37740,
-39325,
-40945,
-42370,
-43572,
-44534,
-45042,
-44860,
-44042,
-42863,
-41562,
-40170,
-38687,
-37197,
-35747,
-34160,
-32252,
-30112,
-28118,
-26516,
-25223,
-24024,
-22995,
-22376,
-22237,
-22295,
-22308,
-22322,
-22565,
-23052,
-23566,
-23985,
-24478,
-25267,
-26384,
-27702,
-29213,
-30954,
-32855,
-34587,
-35970,
-37096,
-38188,
-39188,
-39818,
-39892,
-39652,
-39372,
-39160,
-38817,
-38288,
-37708,
-37243,
-36856,
-36404,
-35906,
-35496,
-35234,
-34963,
-34550,
-34091,
-33772,
-33613,
-33408,
-33003,
-32586,
-32439,
-32639,
-32877,
-32798,
-32365,
-31849,
-31522,
-31367,
-31222,
-30997,
-30804,
-30697,
-30572,
-30208,
-29627,
-29060,
-28742,
-28622,
-28462,
-28202,
-28057,
-28281,
-28855,
-29492,
-30078,
-30725,
-31624,
-32651,
-33490,
-33978,
-34306,
-34748,
-35293,
-35762,
-36025,
-36200,
-36348,
-36302,
-35825,
-34956,
-33991,
-33129,
-32257,
-31203,
-30020,
-29056,
-28473,
-28209,
-28075,
-28082,
-28294,
-28667,
-29038,
-29501,
-30360,
-31842,
-33712,
-35519,
-37062,
-38490,
-39923,
-41139,
-41826,
-42022,
-42105,
-42304,
-42443,
-42197,
-41517,
-40565,
-39350,
-37683,
-35467,
-33060,
-30852,
-28993,
-27260,
-25564,
-24071,
-22993,
-22250,
-21680,
-21287,
-21305,
-21775,
-22476,
-23178,
-23966,
-24998,
-26222,
-27339,
-28292,
-29336,
-30639,
-31926,
-32692,
-32912,
-33076,
-33708,
-34737,
-35730,
-36432,
-36979,
-37588,
-38198,
-38684,
-39102,
-39596,
-40104,
-40324,
-40113,
-39675,
-39336,
-39105,
-38772,
-38285,
-37842,
-37660,
-37591,
-37402,
-37046,
-36719,
-36491,
-36130,
-35427,
-34481,
-33559,
-32681,
-31545,
-29989,
-28281,
-26908,
-25994,
-25219,
-24274,
-23249,
-22488,
-22117,
-21931,
-21766,
-21779,
-22274,
-23283,
-24481,
-25572,
-26539,
-27607,
-28854,
-30201,
-31567,
-32976,
-34465,
-35848,
-36909,
-37590,
-38084,
-38599,
-39162,
-39713,
-40226,
-40739,
-41189,
-41433,
-41405,
-41212,
-40960,
-40579,
-39952,
-39121,
-38330,
-37725,
-37138,
-36322,
-35249,
-34141,
-33180,
-32279,
-31348,
-30430,
-29732,
-29222,
-28731,
-28106,
-27490,
-27038,
-26690,
-26246,
-25644,
-25104,
-24791,
-24660,
-24574,
-24614,
-24978,
-25711,
-26575,
-27373,
-28176,
-29171,
-30357,
-31554,
-32704,
-33949,
-35373,
-36762,
-37825,
-38528,
-39102,
-39693,
-40167,
-40411,
-40497,
-40607,
-40684,
-40484,
-39921,
-39206,
-38474,
-37588,
-36321,
-34799,
-33482,
-32578,
-31853,
-30895,
-29749,
-28768,
-28210,
-27933,
-27717,
-27610,
-27801,
-28252,
-28747,
-29163,
-29655,
-30302,
-30880,
-31072,
-30927,
-30813,
-30983,
-31243,
-31263,
-30952,
-30599,
-30402,
-30396,
-30484,
-30708,
-31092,
-31578,
-31995,
-32336,
-32727,
-33199,
-33664,
-33975,
-34206,
-34443,
-34691,
-34843,
-34922,
-35123,
-35557,
-36079,
-36501,
-36798,
-37176,
-37703,
-38126,
-38117,
-37581,
-36735,
-35891,
-35155,
-34475,
-33726,
-32867,
-31913,
-30946,
-29985,
-29074,
-28270,
-27736,
-27614,
-27799,
-27954,
-27839,
-27597,
-27686,
-28327,
-29333,
-30351,
-31384,
-32623,
-34044,
-35173,
-35576,
-35380,
-35091,
-34976,
-34775,
-34105,
-33049,
-32025,
-31356,
-30932,
-30516,
-30054,
-29644,
-29297,
-28908,
-28418,
-28004,
-27853,
-28015,
-28365,
-28713,
-29012,
-29341,
-29917,
-30964,
-32516,
-34417,
-36491,
-38752,
-41272,
-43890,
-46122,
-47593,
-48295,
-48469,
-48096,
-46912,
-44841,
-42312,
-39836,
-37482,
-34922,
-32066,
-29403,
-27432,
-26077,
-24803,
-23333,
-21990,
-21214,
-20953,
-20847,
-20732,
-20805,
-21199,
-21635,
-21773,
-21702,
-21814,
-22371,
-23224,
-24181,
-25365,
-26969,
-28899,
-30760,
-32326,
-33801,
-35494,
-37466,
-39479,
-41351,
-43048,
-44513,
-45601,
-46258,
-46638,
-46879,
-46848,
-46310,
-45308,
-44226,
-43330,
-42421,
-41135,
-39458,
-37743,
-36217,
-34691,
-32898,
-31031,
-29532,
-28605,
-27896,
-26982,
-25851,
-24715,
-23703,
-22690,
-21730,
-21155,
-21167,
-21536,
-21878,
-22169,
-22832,
-24084,
-25632,
-27017,
-28149,
-29322,
-30646,
-31820,
-32556,
-32925,
-33281,
-33764,
-34199,
-34492,
-34712,
-35041,
-35401,
-35667,
-35884,
-36194,
-36599,
-36868,
-36839,
-36632,
-36449,
-36369,
-36343,
-36460,
-36842,
-37471,
-38130,
-38689,
-39259,
-39916,
-40475,
-40697,
-40675,
-40747,
-40963,
-40870,
-40057,
-38714,
-37412,
-36333,
-34998,
-32939,
-30268,
-27584,
-25186,
-22979,
-20841,
-19042,
-17904,
-17421,
-17368,
-17663,
-18483,
-19794,
-21276,
-22686,
-24185,
-26038,
-28070,
-29693,
-30562,
-30971,
-31472,
-32236,
-33034,
-33697,
-34436,
-35540,
-36984,
-38454,
-39682,
-40636,
-41417,
-42130,
-42895,
-43809,
-44810,
-45662,
-46127,
-46162,
-45845,
-45128,
-43901,
-42160,
-40214,
-38377,
-36749,
-35201,
-33648,
-32211,
-30962,
-29878,
-28763,
-27567,
-26336,
-25145,
-24022,
-22990,
-22143,
-21511,
-21076,
-20734,
-20487,
-20366,
-20435,
-20746,
-21389,
-22414,
-23749,
-25226,
-26783,
-28545,
-30613,
-32838,
-34878,
-36568,
-38062,
-39531,
-40857,
-41670,
-41866,
-41735,
-41656,
-41634,
-41341,
-40610,
-39701,
-38956,
-38409,
-37724,
-36721,
-35647,
-34950,
-34737,
-34663,
-34291,
-33566,
-32802,
-32351,
-32239,
-32273,
-32261,
-32230,
-32238,
-32301,
-32285,
-32163,
-32025,
-32035,
-32168,
-32238,
-32010,
-31434,
-30636,
-29737,
-28804,
-27891,
-27132,
-26680,
-26541,
-26595,
-26728,
-26989,
-27467,
-28185,
-29012,
-29879,
-30785,
-31773,
-32785,
-33704,
-34442,
-35023,
-35447,
-35739,
-35922,
-36027,
-36010,
-35674,
-34927,
-33907,
-32956,
-32280,
-31805,
-31378,
-30961,
-30688,
-30511,
-30322,
-30095,
-30071,
-30506,
-31316,
-32196,
-33035,
-34068,
-35558,
-37416,
-39237,
-40787,
-42078,
-43119,
-43693,
-43526,
-42728,
-41693,
-40687,
-39586,
-38102,
-36206,
-34117,
-31991,
-29829,
-27662,
-25726,
-24286,
-23290,
-22491,
-21754,
-21263,
-21225,
-21560,
-22007,
-22489,
-23233,
-24467,
-26032,
-27562,
-28797,
-29869,
-30953,
-32057,
-32960,
-33555,
-33903,
-34137,
-34264,
-34307,
-34411,
-34834,
-35595,
-36494,
-37218,
-37733,
-38156,
-38533,
-38740,
-38619,
-38239,
-37777,
-37336,
-36926,
-36587,
-36505,
-36789,
-37340,
-37916,
-38391,
-38765,
-39041,
-39074,
-38773,
-38217,
-37615,
-36987,
-36164,
-34940,
-33297,
-31369,
-29313,
-27291,
-25509,
-24136,
-23143,
-22364,
-21696,
-21258,
-21185,
-21432,
-21835,
-22330,
-23037,
-24003,
-25127,
-26286,
-27556,
-29063,
-30679,
-32118,
-33234,
-34231,
-35341,
-36439,
-37193,
-37517,
-37708,
-38110,
-38703,
-39283,
-39763,
-40249,
-40723,
-40934,
-40750,
-40326,
-39964,
-39618,
-39028,
-38072,
-37038,
-36262,
-35711,
-35109,
-34318,
-33510,
-32841,
-32222,
-31502,
-30827,
-30458,
-30489,
-30576,
-30389,
-29905,
-29349,
-28824,
-28216,
-27404,
-26534,
-25807,
-25281,
-24842,
-24444,
-24285,
-24555,
-25323,
-26430,
-27735,
-29139,
-30573,
-31929,
-33184,
-34421,
-35726,
-37053,
-38151,
-38870,
-39234,
-39454,
-39633,
-39683,
-39476,
-38995,
-38421,
-37846,
-37208,
-36363,
-35308,
-34221,
-33287,
-32466,
-31619,
-30680,
-29755,
-29017,
-28490,
-28146,
-27941,
-27958,
-28182,
-28565,
-29034,
-29613,
-30363,
-31265,
-32233,
-33193,
-34109,
-34874,
-35331,
-35406,
-35268,
-35113,
-34997,
-34723,
-34235,
-33666,
-33249,
-32956,
-32617,
-32200,
-31964,
-32089,
-32422,
-32581,
-32413,
-32153,
-32100,
-32332,
-32736,
-33199,
-33710,
-34054,
-34018,
-33516,
-32831,
-32278,
-31905,
-31525,
-31080,
-30703,
-30508,
-30321,
-29957,
-29491,
-29238,
-29337,
-29577,
-29653,
-29559,
-29481,
-29613,
-29979,
-30662,
-31784,
-33331,
-34988,
-36424,
-37561,
-38581,
-39497,
-40124,
-40295,
-40207,
-40146,
-40142,
-39845,
-39030,
-37787,
-36403,
-34948,
-33309,
-31466,
-29644,
-28004,
-26504,
-25056,
-23849,
-23257,
-23416,
-24005,
-24570,
-24953,
-25373,
-25995,
-26831,
-27731,
-28783,
-30127,
-31782,
-33515,
-35043,
-36262,
-37225,
-37974,
-38506,
-38844,
-39070,
-39233,
-39273,
-39095,
-38744,
-38361,
-38026,
-37668,
-37155,
-36515,
-35877,
-35317,
-34721,
-34002,
-33241,
-32704,
-32492,
-32429,
-32241,
-31863,
-31528,
-31369,
-31293,
-30974,
-30344,
-29549,
-28847,
-28185,
-27419,
-26470,
-25541,
-24840,
-24404,
-24113,
-23914,
-23952,
-24393,
-25259,
-26365,
-27461,
-28394,
-29122,
-29754,
-30453,
-31396,
-32693,
-34339,
-36251,
-38295,
-40252,
-41924,
-43197,
-44149,
-44973,
-45802,
-46611,
-47278,
-47609,
-47420,
-46524,
-44874,
-42676,
-40239,
-37772,
-35256,
-32649,
-30105,
-27899,
-26146,
-24691,
-23321,
-22037,
-21019,
-20364,
-20046,
-19987,
-20273,
-20931,
-21804,
-22603,
-23186,
-23737,
-24512,
-25562,
-26710,
-27732,
-28638,
-29561,
-30684,
-32045,
-33577,
-35082,
-36409,
-37501,
-38485,
-39472,
-40442,
-41242,
-41786,
-42062,
-42039,
-41522,
-40338,
-38618,
-36759,
-35150,
-33891,
-32906,
-32222,
-31978,
-32278,
-32974,
-33948,
-35110,
-36515,
-37974,
-39214,
-40026,
-40462,
-40646,
-40520,
-39862,
-38503,
-36491,
-33979,
-31104,
-28035,
-25090,
-22638,
-20925,
-19918,
-19518,
-19605,
-20170,
-21076,
-22202,
-23451,
-24827,
-26264,
-27585,
-28557,
-29135,
-29394,
-29493,
-29481,
-29415,
-29382,
-29526,
-30017,
-30957,
-32404,
-34263,
-36306,
-38310,
-40199,
-42032,
-43830,
-45443,
-46737,
-47729,
-48522,
-49071,
-49086,
-48388,
-47068,
-45398,
-43491,
-41284,
-38811,
-36366,
-34204,
-32256,
-30269,
-28184,
-26243,
-24599,
-23105,
-21576,
-20227,
-19453,
-19311,
-19267,
-18878,
-18294,
-18145,
-18694,
-19633,
-20534,
-21476,
-22772,
-24467,
-26190,
-27713,
-29271,
-31166,
-33331,
-35428,
-37328,
-39224,
-41166,
-42825,
-43903,
-44525,
-45085,
-45635,
-45830,
-45413,
-44606,
-43770,
-42954,
-41994,
-40902,
-39940,
-39009,
-37676,
-35582,
-33163,
-31127,
-29712,
-28463,
-26985,
-25583,
-24765,
-24500,
-24217,
-23662,
-23330,
-23878,
-25283,
-26944,
-28423,
-29805,
-31222,
-32403,
-32955,
-32906,
-32740,
-32739,
-32730,
-32389,
-31764,
-31162,
-30757,
-30428,
-30080,
-29850,
-29963,
-30461,
-31185,
-32009,
-32845,
-33590,
-34146,
-34555,
-35057,
-35847,
-36856,
-37832,
-38527,
-38863,
-38854,
-38625,
-38361,
-38217,
-38120,
-37834,
-37224,
-36445,
-35758,
-35156,
-34464,
-33569,
-32700,
-32056,
-31616,
-31146,
-30558,
-29956,
-29387,
-28790,
-28156,
-27719,
-27632,
-27700,
-27503,
-26990,
-26533,
-26541,
-26923,
-27308,
-27630,
-28177,
-29156,
-30254,
-31045,
-31431,
-31747,
-32161,
-32488,
-32499,
-32377,
-32514,
-33060,
-33727,
-34231,
-34640,
-35278,
-36295,
-37530,
-38721,
-39714,
-40504,
-41055,
-41372,
-41444,
-41327,
-41055,
-40655,
-40131,
-39430,
-38400,
-36966,
-35258,
-33538,
-31933,
-30340,
-28635,
-26949,
-25565,
-24573,
-23797,
-23036,
-22377,
-22049,
-22171,
-22652,
-23430,
-24533,
-25987,
-27605,
-29168,
-30596,
-31930,
-33134,
-34108,
-34848,
-35589,
-36478,
-37354,
-37853,
-37887,
-37708,
-37672,
-37791,
-37817,
-37595,
-37186,
-36762,
-36325,
-35740,
-34886,
-33786,
-32577,
-31473,
-30597,
-29889,
-29103,
-28053,
-26885,
-25983,
-25682,
-25951,
-26649,
-27712,
-29256,
-31248,
-33399,
-35381,
-37050,
-38456,
-39629,
-40470,
-40936,
-41040,
-40793,
-40129,
-39014,
-37592,
-36103,
-34668,
-33318,
-32105,
-31196,
-30655,
-30361,
-30136,
-29971,
-29926,
-29917,
-29677,
-29123,
-28450,
-27967,
-27714,
-27527,
-27398,
-27415,
-27590,
-27658,
-27479,
-27399,
-27880,
-28974,
-30112,
-30886,
-31456,
-32373,
-33692,
-34910,
-35579,
-35878,
-36239,
-36718,
-36831,
-36299,
-35365,
-34494,
-33717,
-32674,
-31281,
-29981,
-29382,
-29626,
-30354,
-31205,
-32163,
-33383,
-34898,
-36466,
-37813,
-38729,
-39242,
-39541,
-39920,
-40525,
-41176,
-41458,
-41098,
-40152,
-38872,
-37432,
-35850,
-34203,
-32689,
-31455,
-30452,
-29488,
-28519,
-27629,
-26913,
-26296,
-25694,
-25094,
-24588,
-24169,
-23733,
-23230,
-22730,
-22385,
-22266,
-22343,
-22584,
-23052,
-23908,
-25339,
-27389,
-29824,
-32202,
-34118,
-35532,
-36680,
-37767,
-38784,
-39662,
-40630,
-42066,
-44090,
-46253,
-47912,
-48701,
-48766,
-48335,
-47460,
-46106,
-44343,
-42456,
-40560,
-38629,
-36569,
-34430,
-32300,
-30158,
-27966,
-25866,
-24138,
-22969,
-22231,
-21659,
-21154,
-20794,
-20723,
-20952,
-21448,
-22208,
-23217,
-24373,
-25571,
-26774,
-28057,
-29404,
-30664,
-31649,
-32305,
-32772,
-33194,
-33697,
-34278,
-34880,
-35394,
-35730,
-35892,
-36005,
-36157,
-36387,
-36624,
-36802,
-36879,
-36803,
-36635,
-36504,
-36553,
-36738,
-36852,
-36825,
-36859,
-37277,
-38097,
-38935,
-39413,
-39453,
-39280,
-39001,
-38539,
-37801,
-36914,
-35974,
-34887,
-33378,
-31382,
-29183,
-27113,
-25335,
-23809,
-22606,
-21871,
-21642,
-21710,
-21840,
-22009,
-22401,
-23144,
-24222,
-25535,
-27019,
-28599,
-30140,
-31521,
-32765,
-33955,
-35160,
-36328,
-37390,
-38324,
-39046,
-39461,
-39470,
-39192,
-38809,
-38501,
-38277,
-38149,
-38110,
-38161,
-38149,
-37947,
-37517,
-36970,
-36383,
-35770,
-35148,
-34615,
-34211,
-33824,
-33316,
-32712,
-32232,
-31978,
-31786,
-31395,
-30751,
-30032,
-29399,
-28794,
-28096,
-27273,
-26417,
-25556,
-24733,
-24072,
-23832,
-24146,
-24833,
-25601,
-26307,
-27070,
-28047,
-29204,
-30423,
-31623,
-32887,
-34231,
-35590,
-36817,
-37826,
-38621,
-39274,
-39844,
-40422,
-40992,
-41518,
-41882,
-42045,
-41943,
-41585,
-40948,
-40113,
-39121,
-37976,
-36578,
-34982,
-33384,
-31998,
-30823,
-29663,
-28461,
-27427,
-26760,
-26424,
-26097,
-25644,
-25142,
-24783,
-24599,
-24611,
-24981,
-25833,
-26969,
-27924,
-28506,
-29022,
-29881,
-30954,
-31691,
-31780,
-31572,
-31625,
-32007,
-32387,
-32594,
-32966,
-33819,
-34965,
-35909,
-36436,
-36832,
-37363,
-37983,
-38544,
-39124,
-39866,
-40539,
-40647,
-40068,
-39280,
-38837,
-38634,
-38128,
-37052,
-35816,
-34818,
-33918,
-32604,
-30834,
-29173,
-28136,
-27600,
-27057,
-26295,
-25596,
-25222,
-25114,
-25097,
-25207,
-25615,
-26266,
-26928,
-27554,
-28398,
-29657,
-31126,
-32418,
-33428,
-34402,
-35547,
-36703,
-37594,
-38101,
-38358,
-38439,
-38322,
-38053,
-37732,
-37398,
-36841,
-35962,
-34934,
-34061,
-33332,
-32364,
-30979,
-29490,
-28425,
-27836,
-27257,
-26295,
-25151,
-24428,
-24453,
-25063,
-25982,
-27158,
-28785,
-30895,
-33288,
-35717,
-38017,
-40060,
-41683,
-42707,
-43137,
-43075,
-42610,
-41748,
-40499,
-38949,
-37200,
-35335,
-33430,
-31717,
-30432,
-29723,
-29457,
-29417,
-29425,
-29477,
-29600,
-29799,
-30037,
-30290,
-30539,
-30732,
-30813,
-30729,
-30537,
-30257,
-29954,
-29593,
-29241,
-28980,
-28902,
-29030,
-29265,
-29572,
-29968,
-30518,
-31184,
-31786,
-32173,
-32317,
-32312,
-32206,
-31959,
-31560,
-31098,
-30660,
-30214,
-29662,
-29078,
-28713,
-28779,
-29214,
-29883,
-30937,
-32782,
-35669,
-39250,
-42772,
-45663,
-47802,
-49327,
-50256,
-50494,
-50064,
-49121,
-47713,
-45645,
-42702,
-39042,
-35120,
-31438,
-28232,
-25575,
-23469,
-21911,
-20767,
-19914,
-19329,
-19115,
-19265,
-19602,
-19943,
-20267,
-20638,
-21014,
-21218,
-21228,
-21300,
-21751,
-22736,
-24164,
-25978,
-28196,
-30767,
-33416,
-35839,
-37944,
-39856,
-41651,
-43197,
-44324,
-45082,
-45688,
-46266,
-46737,
-46929,
-46823,
-46504,
-46017,
-45284,
-44208,
-42786,
-41157,
-39546,
-38182,
-37152,
-36251,
-35078,
-33329,
-31113,
-28828,
-26847,
-25203,
-23816,
-22668,
-21899,
-21485,
-21212,
-20844,
-20405,
-20128,
-20190,
-20586,
-21250,
-22159,
-23300,
-24578,
-25846,
-27091,
-28297,
-29439,
-30344,
-31079,
-31906,
-33148,
-34701,
-36110,
-36989,
-37451,
-37970,
-38912,
-40228,
-41618,
-42872,
-43922,
-44688,
-45006,
-44766,
-44100,
-43292,
-42560,
-41873,
-41088,
-40129,
-38995,
-37739,
-36291,
-34642,
-32892,
-31264,
-29905,
-28794,
-27831,
-27000,
-26365,
-25871,
-25281,
-24399,
-23330,
-22440,
-22001,
-21993,
-22250,
-22777,
-23696,
-24949,
-26237,
-27324,
-28360,
-29693,
-31367,
-33020,
-34297,
-35228,
-36130,
-37095,
-37903,
-38353,
-38573,
-38803,
-39067,
-39085,
-38654,
-37840,
-36837,
-35768,
-34699,
-33807,
-33317,
-33217,
-33268,
-33147,
-32768,
-32174,
-31431,
-30643,
-30064,
-30033,
-30669,
-31760,
-32933,
-33961,
-34744,
-35214,
-35349,
-35332,
-35481,
-35950,
-36455,
-36617,
-36329,
-35821,
-35295,
-34618,
-33575,
-32208,
-30856,
-29800,
-29049,
-28466,
-27944,
-27481,
-27029,
-26638,
-26485,
-26789,
-27499,
-28290,
-28848,
-29232,
-29643,
-30183,
-30691,
-31103,
-31549,
-32111,
-32565,
-32541,
-32044,
-31528,
-31446,
-31804,
-32268,
-32675,
-33235,
-34187,
-35462,
-36756,
-37826,
-38668,
-39326,
-39815,
-40230,
-40744,
-41427,
-42043,
-42205,
-41798,
-41020,
-40126,
-39024,
-37505,
-35536,
-33470,
-31641,
-30073,
-28589,
-27104,
-25763,
-24688,
-23771,
-22873,
-22094,
-21741,
-22010,
-22682,
-23379,
-23897,
-24406,
-25136,
-26120,
-27187,
-28229,
-29343,
-30674,
-32197,
-33738,
-35131,
-36360,
-37503,
-38545,
-39416,
-40001,
-40263,
-40180,
-39827,
-39327,
-38878,
-38528,
-38188,
-37686,
-37044,
-36400,
-35843,
-35223,
-34393,
-33436,
-32642,
-32193,
-31954,
-31742,
-31583,
-31692,
-32087,
-32459,
-32483,
-32180,
-31852,
-31737,
-31760,
-31773,
-31725,
-31671,
-31506,
-31042,
-30168,
-29065,
-28007,
-27224,
-26752,
-26542,
-26450,
-26357,
-26256,
-26373,
-26905,
-27821,
-28804,
-29688,
-30648,
-32012,
-33784,
-35607,
-37085,
-38192,
-39083,
-39851,
-40444,
-40856,
-41175,
-41397,
-41326,
-40853,
-40097,
-39286,
-38405,
-37236,
-35714,
-34091,
-32636,
-31310,
-29856,
-28242,
-26754,
-25673,
-25018,
-24643,
-24547,
-24854,
-25593,
-26583,
-27684,
-28853,
-30117,
-31347,
-32432,
-33411,
-34404,
-35380,
-36079,
-36324,
-36173,
-35830,
-35366,
-34743,
-34025,
-33424,
-33095,
-32981,
-32891,
-32717,
-32427,
-32016,
-31528,
-31142,
-31051,
-31175,
-31179,
-30775,
-30151,
-29716,
-29761,
-30148,
-30676,
-31327,
-32278,
-33554,
-34954,
-36210,
-37166,
-37796,
-38117,
-38188,
-38085,
-37817,
-37293,
-36476,
-35513,
-34650,
-33907,
-33085,
-32002,
-30801,
-29830,
-29289,
-29147,
-29294,
-29682,
-30255,
-30845,
-31339,
-31870,
-32650,
-33706,
-34719,
-35424,
-35818,
-36060,
-36133,
-35759,
-34841,
-33558,
-32304,
-31183,
-30086,
-28920,
-27807,
-26912,
-26226,
-25593,
-24963,
-24439,
-24117,
-23941,
-23832,
-23833,
-24069,
-24560,
-25135,
-25692,
-26400,
-27617,
-29608,
-32310,
-35496,
-38969,
-42663,
-46408,
-49896,
-52711,
-54601,
-55548,
-55609,
-54828,
-53181,
-50695,
-47498,
-43800,
-39880,
-36038,
-32539,
-29453,
-26758,
-24405,
-22480,
-21046,
-19994,
-19137,
-18412,
-18007,
-18022,
-18281,
-18425,
-18417,
-18558,
-19207,
-20282,
-21504,
-22789,
-24395,
-26478,
-28770,
-30804,
-32452,
-34003,
-35726,
-37532,
-39109,
-40386,
-41493,
-42509,
-43226,
-43397,
-42979,
-42126,
-40963,
-39569,
-38101,
-36804,
-35787,
-34946,
-34159,
-33558,
-33439,
-33903,
-34693,
-35420,
-35887,
-36184,
-36498,
-36941,
-37517,
-38136,
-38601,
-38694,
-38235,
-37169,
-35509,
-33334,
-30873,
-28538,
-26709,
-25438,
-24477,
-23586,
-22842,
-22505,
-22663,
-23154,
-23773,
-24508,
-25341,
-26111,
-26557,
-26633,
-26585,
-26613,
-26669,
-26641,
-26700,
-27284,
-28640,
-30515,
-32461,
-34302,
-36234,
-38387,
-40483,
-42071,
-42989,
-43503,
-43935,
-44347,
-44552,
-44450,
-44073,
-43465,
-42590,
-41400,
-39993,
-38499,
-36984,
-35484,
-34100,
-32986,
-32109,
-31216,
-30102,
-28837,
-27732,
-26926,
-26280,
-25631,
-25022,
-24674,
-24623,
-24684,
-24740,
-24930,
-25490,
-26385,
-27320,
-28049,
-28657,
-29362,
-30227,
-31137,
-31981,
-32884,
-33947,
-35100,
-36073,
-36710,
-37071,
-37351,
-37630,
-37781,
-37684,
-37324,
-36844,
-36305,
-35637,
-34607,
-33184,
-31527,
-30014,
-28863,
-28066,
-27488,
-27060,
-26939,
-27276,
-28176,
-29556,
-31220,
-32898,
-34377,
-35608,
-36790,
-38097,
-39530,
-40828,
-41760,
-42256,
-42323,
-41879,
-40834,
-39327,
-37682,
-36159,
-34665,
-33043,
-31323,
-29800,
-28581,
-27540,
-26473,
-25507,
-24918,
-24753,
-24802,
-24865,
-25061,
-25579,
-26317,
-26983,
-27443,
-27918,
-28644,
-29543,
-30327,
-30845,
-31227,
-31579,
-31848,
-31948,
-32056,
-32490,
-33421,
-34648,
-35793,
-36604,
-37057,
-37262,
-37343,
-37418,
-37537,
-37725,
-37952,
-38188,
-38446,
-38686,
-38862,
-38900,
-38726,
-38330,
-37691,
-36930,
-36210,
-35646,
-35201,
-34737,
-34150,
-33428,
-32538,
-31432,
-30139,
-28857,
-27757,
-26854,
-26000,
-25185,
-24579,
-24310,
-24281,
-24282,
-24310,
-24586,
-25226,
-26119,
-27051,
-28021,
-29109,
-30302,
-31358,
-32212,
-32978,
-33876,
-34853,
-35705,
-36313,
-36734,
-37043,
-37194,
-37171,
-37085,
-37081,
-37130,
-37140,
-37122,
-37191,
-37383,
-37486,
-37405,
-37220,
-37141,
-37086,
-36846,
-36333,
-35822,
-35544,
-35450,
-35278,
-34967,
-34598,
-34190,
-33488,
-32361,
-31016,
-29813,
-28885,
-28057,
-27235,
-26482,
-25889,
-25285,
-24568,
-23884,
-23578,
-23702,
-24027,
-24369,
-24910,
-25845,
-27037,
-28142,
-29091,
-30215,
-31733,
-33406,
-34843,
-35985,
-37168,
-38528,
-39853,
-40848,
-41554,
-42173,
-42641,
-42712,
-42340,
-41786,
-41237,
-40438,
-39087,
-37347,
-35797,
-34750,
-33938,
-32927,
-31793,
-30977,
-30673,
-30518,
-30074,
-29396,
-28933,
-28927,
-29152,
-29245,
-29071,
-28773,
-28373,
-27856,
-27267,
-26833,
-26747,
-26884,
-27042,
-27088,
-27103,
-27148,
-27192,
-27242,
-27432,
-27957,
-28803,
-29832,
-30863,
-31869,
-32825,
-33691,
-34452,
-35273,
-36355,
-37693,
-39045,
-40111,
-40875,
-41520,
-42210,
-42901,
-43450,
-43750,
-43763,
-43374,
-42446,
-40943,
-39013,
-36894,
-34721,
-32566,
-30512,
-28686,
-27151,
-25804,
-24525,
-23356,
-22504,
-22220,
-22527,
-23270,
-24205,
-25179,
-26179,
-27293,
-28593,
-30070,
-31587,
-32987,
-34179,
-35135,
-35808,
-36115,
-36053,
-35795,
-35582,
-35485,
-35359,
-35010,
-34487,
-33952,
-33506,
-33006,
-32299,
-31484,
-30792,
-30428,
-30229,
-29964,
-29428,
-28616,
-27552,
-26328,
-25146,
-24412,
-24452,
-25418,
-27136,
-29449,
-32278,
-35600,
-39333,
-43222,
-46964,
-50155,
-52397,
-53328,
-52876,
-51231,
-48743,
-45651,
-42177,
-38571,
-35176,
-32150,
-29393,
-26722,
-24221,
-22208,
-20960,
-20382,
-20228,
-20358,
-20795,
-21457,
-22021,
-22241,
-22238,
-22423,
-23009,
-23833,
-24625,
-25433,
-26551,
-28110,
-29896,
-31592,
-33140,
-34691,
-36288,
-37768,
-38933,
-39854,
-40651,
-41375,
-41824,
-41838,
-41368,
-40455,
-39111,
-37375,
-35406,
-33457,
-31717,
-30319,
-29407,
-29210,
-29848,
-31162,
-32829,
-34555,
-36225,
-37807,
-39234,
-40473,
-41556,
-42463,
-42986,
-42786,
-41657,
-39707,
-37209,
-34422,
-31541,
-28827,
-26556,
-24847,
-23598,
-22635,
-21946,
-21638,
-21759,
-22222,
-22905,
-23702,
-24427,
-24837,
-24825,
-24600,
-24536,
-24735,
-25003,
-25199,
-25587,
-26652,
-28565,
-31018,
-33625,
-36269,
-39030,
-41721,
-43915,
-45298,
-46086,
-46685,
-47313,
-47788,
-47857,
-47473,
-46675,
-45481,
-43863,
-41935,
-39921,
-37938,
-36006,
-34110,
-32339,
-30717,
-29120,
-27448,
-25822,
-24506,
-23549,
-22734,
-21894,
-21203,
-20963,
-21145,
-21414,
-21576,
-21930,
-22881,
-24428,
-26043,
-27336,
-28347,
-29473,
-30890,
-32451,
-33959,
-35357,
-36689,
-37854,
-38718,
-39235,
-39523,
-39719,
-39926,
-40126,
-40272,
-40105,
-39472,
-38391,
-37254,
-36350,
-35635,
-34746,
-33493,
-32063,
-30777,
-29723,
-28775,
-27902,
-27300,
-27179,
-27512,
-28190,
-29144,
-30430,
-31919,
-33365,
-34577,
-35596,
-36507,
-37200,
-37424,
-37154,
-36601,
-36076,
-35535,
-34831,
-33888,
-32920,
-32151,
-31539,
-30881,
-30032,
-29119,
-28350,
-27855,
-27600,
-27529,
-27662,
-28024,
-28565,
-29153,
-29644,
-30041,
-30425,
-30896,
-31478,
-32137,
-32887,
-33681,
-34425,
-34875,
-34888,
-34529,
-34084,
-33793,
-33662,
-33571,
-33457,
-33452,
-33744,
-34348,
-35136,
-35877,
-36482,
-36952,
-37381,
-37810,
-38134,
-38182,
-37799,
-37079,
-36238,
-35510,
-34905,
-34322,
-33665,
-32938,
-32127,
-31206,
-30161,
-29146,
-28330,
-27767,
-27339,
-26906,
-26474,
-26069,
-25710,
-25357,
-25125,
-25210,
-25749,
-26639,
-27683,
-28771,
-29907,
-31083,
-32198,
-33204,
-34192,
-35260,
-36333,
-37198,
-37784,
-38280,
-38886,
-39555,
-39957,
-39860,
-39325,
-38631,
-37969,
-37350,
-36730,
-36129,
-35630,
-35229,
-34863,
-34404,
-33818,
-33132,
-32499,
-32068,
-31857,
-31721,
-31416,
-30903,
-30363,
-29982,
-29765,
-29514,
-29174,
-28934,
-29036,
-29438,
-29812,
-29782,
-29305,
-28568,
-27897,
-27416,
-27151,
-26990,
-26903,
-26963,
-27306,
-28030,
-29017,
-30059,
-30987,
-31833,
-32683,
-33549,
-34365,
-35124,
-35963,
-36984,
-38153,
-39307,
-40299,
-41094,
-41642,
-41922,
-41916,
-41699,
-41315,
-40740,
-39890,
-38756,
-37362,
-35727,
-33889,
-31994,
-30319,
-29006,
-27969,
-27048,
-26300,
-25927,
-26001,
-26236,
-26423,
-26665,
-27338,
-28497,
-29774,
-30730,
-31364,
-31918,
-32452,
-32660,
-32403,
-31927,
-31703,
-31754,
-31709,
-31302,
-30712,
-30392,
-30466,
-30772,
-31157,
-31665,
-32292,
-32736,
-32697,
-32221,
-31770,
-31665,
-31815,
-31953,
-32009,
-32183,
-32514,
-32782,
-32787,
-32737,
-33038,
-33887,
-35031,
-36105,
-37029,
-37868,
-38589,
-38956,
-38881,
-38639,
-38573,
-38673,
-38537,
-37798,
-36536,
-35103,
-33798,
-32671,
-31764,
-31184,
-31007,
-31037,
-30961,
-30661,
-30307,
-30171,
-30307,
-30594,
-30871,
-31065,
-31080,
-30896,
-30540,
-30237,
-30072,
-29952,
-29658,
-29154,
-28587,
-28102,
-27659,
-27186,
-26821,
-26797,
-27172,
-27717,
-28167,
-28491,
-28819,
-29186,
-29426,
-29456,
-29392,
-29494,
-29924,
-30713,
-31924,
-33648,
-35879,
-38399,
-40893,
-43162,
-45128,
-46761,
-47969,
-48683,
-48899,
-48660,
-47990,
-46942,
-45534,
-43786,
-41643,
-39102,
-36301,
-33443,
-30646,
-27900,
-25247,
-22860,
-20960,
-19590,
-18662,
-18168,
-18206,
-18775,
-19627,
-20431,
-21110,
-21812,
-22644,
-23484,
-24210,
-24945,
-25942,
-27275,
-28747,
-30168,
-31581,
-33096,
-34646,
-35994,
-37055,
-37952,
-38882,
-39840,
-40781,
-41730,
-42783,
-43854,
-44688,
-45045,
-44928,
-44432,
-43597,
-42441,
-41049,
-39633,
-38240,
-36773,
-35168,
-33578,
-32268,
-31270,
-30358,
-29314,
-28205,
-27363,
-27036,
-27196,
-27521,
-27647,
-27412,
-26939,
-26494,
-26187,
-25903,
-25524,
-25213,
-25283,
-25815,
-26475,
-26959,
-27376,
-28139,
-29369,
-30755,
-31990,
-33247,
-34816,
-36581,
-37960,
-38643,
-38971,
-39436,
-40029,
-40265,
-39932,
-39338,
-38824,
-38248,
-37312,
-36108,
-35077,
-34327,
-33445,
-32128,
-30686,
-29732,
-29247,
-28709,
-27776,
-26868,
-26526,
-26704,
-26881,
-26966,
-27447,
-28734,
-30404,
-31750,
-32566,
-33370,
-34510,
-35675,
-36322,
-36471,
-36611,
-36996,
-37285,
-37058,
-36458,
-36016,
-35999,
-36140,
-36062,
-35667,
-35081,
-34280,
-33130,
-31736,
-30505,
-29845,
-29736,
-29852,
-29923,
-29941,
-29970,
-29954,
-29769,
-29456,
-29228,
-29227,
-29371,
-29427,
-29318,
-29174,
-29194,
-29425,
-29825,
-30339,
-31042,
-31904,
-32830,
-33645,
-34357,
-35052,
-35787,
-36425,
-36901,
-37297,
-37835,
-38529,
-39079,
-39209,
-38875,
-38347,
-37767,
-37088,
-36175,
-35092,
-34003,
-32996,
-31971,
-30876,
-29758,
-28733,
-27797,
-26952,
-26356,
-26202,
-26525,
-27032,
-27418,
-27649,
-27915,
-28331,
-28815,
-29242,
-29734,
-30480,
-31556,
-32756,
-33871,
-34833,
-35672,
-36372,
-36854,
-37135,
-37348,
-37547,
-37627,
-37383,
-36793,
-36022,
-35261,
-34584,
-33969,
-33491,
-33231,
-33166,
-33090,
-32848,
-32538,
-32426,
-32643,
-32958,
-33069,
-32917,
-32763,
-32831,
-33006,
-32988,
-32691,
-32350,
-32176,
-32064,
-31676,
-30957,
-30198,
-29765,
-29636,
-29516,
-29190,
-28752,
-28403,
-28165,
-27982,
-27885,
-27993,
-28312,
-28608,
-28743,
-28847,
-29263,
-30126,
-31295,
-32548,
-33806,
-35087,
-36296,
-37263,
-38009,
-38711,
-39582,
-40522,
-41306,
-41713,
-41707,
-41290,
-40425,
-39177,
-37694,
-36201,
-34785,
-33434,
-32219,
-31254,
-30650,
-30256,
-29866,
-29347,
-28778,
-28330,
-28118,
-28174,
-28506,
-29026,
-29601,
-30026,
-30226,
-30263,
-30303,
-30407,
-30530,
-30528,
-30392,
-30200,
-30115,
-30182,
-30338,
-30525,
-30746,
-31121,
-31595,
-32021,
-32212,
-32163,
-32057,
-32012,
-31988,
-31886,
-31672,
-31400,
-31048,
-30553,
-29947,
-29438,
-29242,
-29382,
-29786,
-30469,
-31588,
-33181,
-35058,
-36960,
-38828,
-40726,
-42544,
-43919,
-44548,
-44506,
-44115,
-43542,
-42650,
-41316,
-39719,
-38263,
-37191,
-36357,
-35487,
-34433,
-33308,
-32291,
-31452,
-30672,
-29756,
-28637,
-27454,
-26509,
-25925,
-25491,
-24904,
-24073,
-23274,
-22725,
-22304,
-21723,
-20961,
-20393,
-20324,
-20685,
-21165,
-21763,
-22768,
-24361,
-26235,
-27920,
-29302,
-30686,
-32354,
-34187,
-35956,
-37659,
-39597,
-41949,
-44559,
-47101,
-49390,
-51368,
-52923,
-53849,
-54056,
-53667,
-52897,
-51789,
-50165,
-47862,
-44874,
-41415,
-37763,
-34103,
-30517,
-27032,
-23813,
-21139,
-19214,
-17904,
-16871,
-15896,
-15167,
-15009,
-15453,
-16175,
-16910,
-17733,
-18916,
-20446,
-22021,
-23453,
-24917,
-26699,
-28779,
-30781,
-32471,
-33908,
-35327,
-36804,
-38243,
-39579,
-40817,
-41894,
-42747,
-43386,
-43939,
-44339,
-44264,
-43454,
-42112,
-40751,
-39623,
-38457,
-36864,
-34907,
-33059,
-31663,
-30665,
-29904,
-29472,
-29563,
-30140,
-30888,
-31661,
-32627,
-33913,
-35321,
-36361,
-36865,
-36934,
-36705,
-36022,
-34704,
-32908,
-31063,
-29469,
-28125,
-26956,
-26063,
-25604,
-25502,
-25572,
-25777,
-26326,
-27316,
-28430,
-29272,
-29732,
-30095,
-30529,
-30790,
-30520,
-29783,
-29060,
-28740,
-28709,
-28583,
-28350,
-28471,
-29439,
-31234,
-33355,
-35335,
-37046,
-38621,
-40030,
-41144,
-41865,
-42377,
-42934,
-43580,
-44122,
-44286,
-43982,
-43260,
-42206,
-40849,
-39238,
-37473,
-35676,
-33899,
-32103,
-30237,
-28388,
-26719,
-25454,
-24611,
-24022,
-23444,
-22792,
-22230,
-21991,
-22151,
-22561,
-23076,
-23648,
-24350,
-25124,
-25907,
-26699,
-27720,
-29146,
-30910,
-32752,
-34465,
-36048,
-37573,
-38969,
-40113,
-40948,
-41589,
-42083,
-42353,
-42232,
-41676,
-40787,
-39722,
-38663,
-37780,
-37185,
-36804,
-36384,
-35752,
-34919,
-34039,
-33090,
-31947,
-30594,
-29302,
-28376,
-27813,
-27374,
-26841,
-26341,
-26023,
-25909,
-25878,
-25959,
-26383,
-27278,
-28484,
-29666,
-30666,
-31533,
-32357,
-33110,
-33705,
-34162,
-34510,
-34753,
-34812,
-34712,
-34505,
-34203,
-33736,
-33132,
-32567,
-32277,
-32278,
-32453,
-32727,
-33125,
-33676,
-34267,
-34786,
-35269,
-35737,
-36077,
-36060,
-35711,
-35342,
-35204,
-35114,
-34739,
-34050,
-33505,
-33433,
-33604,
-33459,
-32828,
-32096,
-31744,
-31737,
-31743,
-31591,
-31492,
-31604,
-31747,
-31590,
-31092,
-30567,
-30343,
-30494,
-30935,
-31520,
-32093,
-32455,
-32525,
-32511,
-32687,
-33069,
-33347,
-33273,
-32948,
-32658,
-32448,
-32108,
-31549,
-31009,
-30719,
-30544,
-30063,
-29124,
-28080,
-27365,
-27062,
-26856,
-26565,
-26324,
-26456,
-27073,
-28108,
-29470,
-31153,
-33110,
-35219,
-37320,
-39339,
-41189,
-42798,
-44145,
-45288,
-46212,
-46620,
-46187,
-44861,
-43051,
-41180,
-39318,
-37308,
-35195,
-33386,
-32153,
-31260,
-30258,
-29002,
-27873,
-27128,
-26607,
-25906,
-25028,
-24368,
-24209,
-24349,
-24395,
-24325,
-24391,
-24769,
-25278,
-25727,
-26225,
-26962,
-27892,
-28739,
-29409,
-30155,
-31173,
-32336,
-33273,
-33922,
-34462,
-35007,
-35317,
-35163,
-34627,
-34052,
-33591,
-33125,
-32679,
-32534,
-33008,
-33967,
-35006,
-35905,
-36807,
-37894,
-39061,
-40123,
-41158,
-42394,
-43833,
-45107,
-45872,
-46103,
-45862,
-44991,
-43219,
-40698,
-38012,
-35639,
-33497,
-31207,
-28737,
-26497,
-24750,
-23344,
-22000,
-20849,
-20294,
-20397,
-20743,
-20921,
-20977,
-21223,
-21698,
-22154,
-22520,
-23069,
-24037,
-25212,
-26139,
-26744,
-27356,
-28267,
-29324,
-30229,
-31031,
-32075,
-33520,
-35078,
-36424,
-37545,
-38724,
-40002,
-41157,
-41980,
-42649,
-43497,
-44631,
-45835,
-46783,
-47359,
-47549,
-47373,
-46800,
-45919,
-44874,
-43801,
-42701,
-41438,
-39834,
-37674,
-34906,
-31725,
-28544,
-25736,
-23362,
-21277,
-19436,
-18021,
-17260,
-17108,
-17307,
-17674,
-18292,
-19283,
-20585,
-21856,
-22880,
-23660,
-24385,
-25128,
-25785,
-26357,
-27021,
-28105,
-29669,
-31480,
-33152,
-34567,
-35869,
-37296,
-38876,
-40441,
-41847,
-43095,
-44263,
-45284,
-46004,
-46242,
-46016,
-45432,
-44636,
-43761,
-42929,
-42178,
-41388,
-40362,
-39028,
-37548,
-36137,
-34808,
-33429,
-31927,
-30500,
-29341,
-28417,
-27466,
-26325,
-25135,
-24092,
-23273,
-22532,
-21893,
-21475,
-21384,
-21485,
-21626,
-21919,
-22700,
-24134,
-26002,
-27925,
-29725,
-31479,
-33198,
-34738,
-35952,
-36912,
-37798,
-38544,
-38918,
-38778,
-38330,
-37901,
-37594,
-37246,
-36763,
-36224,
-35783,
-35334,
-34643,
-33669,
-32689,
-32100,
-32033,
-32309,
-32641,
-32818,
-32737,
-32400,
-31896,
-31502,
-31506,
-32045,
-33009,
-34188,
-35400,
-36592,
-37639,
-38376,
-38612,
-38311,
-37629,
-36751,
-35787,
-34707,
-33457,
-32090,
-30715,
-29465,
-28399,
-27538,
-26877,
-26408,
-26090,
-25965,
-26084,
-26488,
-27073,
-27655,
-28198,
-28824,
-29706,
-30755,
-31728,
-32411,
-32833,
-33064,
-33078,
-32766,
-32202,
-31610,
-31191,
-30985,
-31025,
-31495,
-32496,
-33751,
-34761,
-35284,
-35615,
-36137,
-36803,
-37262,
-37526,
-38114,
-39442,
-41054,
-41997,
-41768,
-40868,
-40082,
-39585,
-38884,
-37629,
-36091,
-34761,
-33664,
-32352,
-30533,
-28445,
-26581,
-25223,
-24322,
-23769,
-23519,
-23533,
-23660,
-23793,
-23932,
-24170,
-24564,
-25155,
-26005,
-27149,
-28484,
-29812,
-31065,
-32377,
-33871,
-35441,
-36800,
-37797,
-38570,
-39309,
-39954,
-40224,
-39947,
-39300,
-38641,
-38130,
-37592,
-36786,
-35738,
-34787,
-34251,
-34099,
-33996,
-33655,
-33074,
-32460,
-31963,
-31617,
-31468,
-31637,
-32140,
-32695,
-32994,
-32942,
-32815,
-32784,
-32729,
-32379,
-31834,
-31498,
-31633,
-31960,
-31956,
-31448,
-30743,
-30162,
-29675,
-28997,
-28088,
-27180,
-26522,
-26105,
-25857,
-25855,
-26250,
-27049,
-28042,
-29100,
-30262,
-31683,
-33322,
-35054,
-36749,
-38331,
-39680,
-40643,
-41219,
-41649,
-42087,
-42436,
-42363,
-41761,
-40859,
-39921,
-38869,
-37420,
-35498,
-33492,
-31873,
-30745,
-29775,
-28692,
-27560,
-26707,
-26278,
-26091,
-25932,
-25811,
-25939,
-26398,
-27008,
-27530,
-27956,
-28461,
-29200,
-30023,
-30732,
-31226,
-31637,
-32089,
-32519,
-32772,
-32802,
-32765,
-32915,
-33356,
-34034,
-34713,
-35177,
-35317,
-35216,
-35070,
-34958,
-34774,
-34386,
-33876,
-33565,
-33665,
-34026,
-34295,
-34325,
-34355,
-34683,
-35314,
-35964,
-36443,
-36826,
-37258,
-37628,
-37602,
-36959,
-35777,
-34360,
-32927,
-31578,
-30356,
-29356,
-28655,
-28216,
-27882,
-27543,
-27231,
-27162,
-27542,
-28374,
-29408,
-30355,
-31115,
-31858,
-32718,
-33625,
-34395,
-34942,
-35438,
-35987,
-36474,
-36632,
-36350,
-35786,
-35206,
-34689,
-34146,
-33390,
-32348,
-31036,
-29642,
-28365,
-27312,
-26318,
-25192,
-23969,
-23076,
-22865,
-23259,
-23787,
-24104,
-24352,
-24904,
-25959,
-27466,
-29451,
-32148,
-35754,
-40076,
-44593,
-48745,
-52090,
-54277,
-55045,
-54483,
-53003,
-51076,
-48815,
-46105,
-42950,
-39690,
-36633,
-33820,
-31114,
-28615,
-26648,
-25355,
-24501,
-23680,
-22820,
-22088,
-21547,
-20990,
-20264,
-19528,
-19092,
-18933,
-18769,
-18458,
-18343,
-18907,
-20260,
-22141,
-24246,
-26582,
-29134,
-31625,
-33665,
-35205,
-36631,
-38264,
-39976,
-41351,
-42253,
-42899,
-43531,
-43972,
-43975,
-43636,
-43485,
-43886,
-44605,
-45026,
-44828,
-44198,
-43516,
-42811,
-41818,
-40385,
-38694,
-37028,
-35388,
-33540,
-31308,
-28866,
-26556,
-24589,
-22945,
-21532,
-20366,
-19571,
-19216,
-19266,
-19668,
-20389,
-21451,
-22814,
-24393,
-26103,
-27824,
-29448,
-30848,
-31999,
-33004,
-33947,
-34787,
-35366,
-35620,
-35695,
-35811,
-36000,
-36117,
-36078,
-36031,
-36213,
-36631,
-37063,
-37290,
-37344,
-37309,
-37132,
-36649,
-35883,
-35141,
-34680,
-34414,
-34014,
-33386,
-32768,
-32511,
-32586,
-32744,
-32792,
-32817,
-32966,
-33197,
-33311,
-33170,
-32831,
-32408,
-32040,
-31823,
-31808,
-31908,
-31945,
-31849,
-31789,
-31987,
-32373,
-32662,
-32630,
-32453,
-32408,
-32511,
-32505,
-32205,
-31842,
-31695,
-31791,
-31801,
-31524,
-31057,
-30668,
-30377,
-30068,
-29661,
-29270,
-28970,
-28631,
-28150,
-27610,
-27302,
-27377,
-27725,
-28200,
-28803,
-29671,
-30782,
-31963,
-33073,
-34194,
-35521,
-37112,
-38805,
-40389,
-41725,
-42782,
-43552,
-43966,
-43984,
-43538,
-42648,
-41409,
-39993,
-38567,
-37174,
-35754,
-34269,
-32710,
-31108,
-29459,
-27821,
-26352,
-25236,
-24504,
-23997,
-23589,
-23274,
-23220,
-23491,
-24049,
-24773,
-25626,
-26597,
-27683,
-28834,
-30011,
-31130,
-32140,
-32983,
-33722,
-34354,
-34789,
-34878,
-34649,
-34402,
-34422,
-34751,
-35192,
-35667,
-36315,
-37200,
-38093,
-38600,
-38633,
-38463,
-38390,
-38388,
-38325,
-38205,
-38160,
-38129,
-37770,
-36923,
-35865,
-35010,
-34403,
-33652,
-32495,
-31163,
-30097,
-29392,
-28745,
-27907,
-26992,
-26308,
-25917,
-25615,
-25256,
-24895,
-24753,
-24923,
-25359,
-25967,
-26665,
-27453,
-28368,
-29504,
-30792,
-32068,
-33141,
-34055,
-35018,
-36108,
-37173,
-38031,
-38726,
-39422,
-40093,
-40463,
-40364,
-39951,
-39499,
-39014,
-38296,
-37270,
-36220,
-35407,
-34792,
-34108,
-33315,
-32630,
-32228,
-31943,
-31521,
-30966,
-30538,
-30362,
-30272,
-30038,
-29665,
-29341,
-29103,
-28844,
-28481,
-28175,
-28116,
-28344,
-28703,
-29095,
-29480,
-29818,
-29955,
-29856,
-29687,
-29699,
-29967,
-30278,
-30502,
-30700,
-31086,
-31653,
-32165,
-32456,
-32713,
-33309,
-34403,
-35736,
-36933,
-37933,
-38954,
-40140,
-41244,
-41875,
-41920,
-41649,
-41344,
-40885,
-39981,
-38515,
-36799,
-35182,
-33696,
-32160,
-30490,
-28875,
-27491,
-26279,
-25138,
-24176,
-23710,
-23887,
-24499,
-25241,
-26048,
-27057,
-28350,
-29722,
-30975,
-32067,
-33117,
-34118,
-34924,
-35388,
-35560,
-35537,
-35349,
-34936,
-34313,
-33656,
-33159,
-32928,
-32926,
-33057,
-33239,
-33372,
-33373,
-33158,
-32704,
-32037,
-31257,
-30504,
-29908,
-29561,
-29467,
-29559,
-29682,
-29656,
-29410,
-29134,
-29141,
-29695,
-30747,
-32146,
-33834,
-35856,
-38124,
-40221,
-41689,
-42379,
-42466,
-42223,
-41670,
-40808,
-39718,
-38577,
-37418,
-36147,
-34738,
-33377,
-32227,
-31246,
-30315,
-29462,
-28901,
-28694,
-28617,
-28444,
-28229,
-28216,
-28507,
-28852,
-28986,
-28900,
-28735,
-28600,
-28406,
-28145,
-27928,
-27884,
-27990,
-28138,
-28300,
-28548,
-28866,
-29115,
-29178,
-29060,
-28901,
-28770,
-28639,
-28508,
-28436,
-28569,
-28983,
-29682,
-30566,
-31576,
-32777,
-34429,
-36780,
-39830,
-43257,
-46586,
-49531,
-51939,
-53650,
-54446,
-54203,
-53107,
-51367,
-49067,
-46039,
-42309,
-38162,
-34020,
-30079,
-26419,
-23204,
-20767,
-19273,
-18481,
-17975,
-17535,
-17296,
-17436,
-17911,
-18511,
-19083,
-19623,
-20136,
-20630,
-21127,
-21815,
-22858,
-24295,
-26000,
-27839,
-29789,
-31887,
-34071,
-36207,
-38098,
-39691,
-41049,
-42222,
-43175,
-43715,
-43753,
-43370,
-42803,
-42164,
-41412,
-40488,
-39576,
-38991,
-38876,
-39062,
-39263,
-39375,
-39497,
-39624,
-39650,
-39447,
-39176,
-39000,
-38911,
-38547,
-37573,
-35847,
-33502,
-30709,
-27739,
-24925,
-22630,
-20973,
-19828,
-18964,
-18373,
-18139,
-18362,
-18943,
-19824,
-20990,
-22454,
-24059,
-25493,
-26457,
-26879,
-26968,
-27139,
-27788,
-29038,
-30690,
-32378,
-33975,
-35558,
-37313,
-39134,
-40861,
-42459,
-44089,
-45844,
-47469,
-48656,
-49276,
-49466,
-49240,
-48388,
-46725,
-44437,
-41951,
-39582,
-37305,
-35049,
-32856,
-30853,
-28998,
-27209,
-25551,
-24296,
-23580,
-23218,
-22898,
-22552,
-22289,
-22220,
-22230,
-22264,
-22464,
-23026,
-23890,
-24796,
-25628,
-26540,
-27777,
-29223,
-30618,
-31830,
-33073,
-34579,
-36205,
-37586,
-38495,
-39109,
-39742,
-40392,
-40819,
-40771,
-40348,
-39800,
-39183,
-38336,
-37124,
-35713,
-34449,
-33413,
-32398,
-31150,
-29785,
-28630,
-27875,
-27357,
-26955,
-26843,
-27388,
-28588,
-30017,
-31248,
-32346,
-33650,
-35228,
-36713,
-37802,
-38624,
-39498,
-40300,
-40461,
-39596,
-37973,
-36240,
-34707,
-33258,
-31733,
-30329,
-29286,
-28503,
-27666,
-26687,
-25943,
-25773,
-26088,
-26527,
-26909,
-27436,
-28260,
-29203,
-29888,
-30232,
-30437,
-30785,
-31231,
-31677,
-32089,
-32622,
-33284,
-33918,
-34347,
-34614,
-34865,
-35173,
-35427,
-35551,
-35633,
-35832,
-36160,
-36497,
-36704,
-36843,
-36941,
-36959,
-36725,
-36264,
-35812,
-35657,
-35809,
-35982,
-35920,
-35551,
-35026,
-34373,
-33567,
-32621,
-31720,
-31060,
-30611,
-30188,
-29690,
-29197,
-28827,
-28527,
-28165,
-27761,
-27521,
-27561,
-27735,
-27763,
-27572,
-27371,
-27426,
-27773,
-28299,
-28927,
-29689,
-30631,
-31688,
-32741,
-33727,
-34601,
-35325,
-35875,
-36343,
-36879,
-37497,
-38030,
-38247,
-38071,
-37620,
-36985,
-36216,
-35303,
-34356,
-33544,
-32939,
-32612,
-32535,
-32766,
-33141,
-33415,
-33398,
-33219,
-33266,
-33700,
-34311,
-34616,
-34446,
-34001,
-33618,
-33360,
-33006,
-32442,
-31797,
-31364,
-31233,
-31245,
-31142,
-30779,
-30134,
-29305,
-28423,
-27634,
-27020,
-26544,
-26188,
-26015,
-26168,
-26592,
-27090,
-27453,
-27811,
-28501,
-29724,
-31305,
-32915,
-34408,
-35943,
-37611,
-39275,
-40617,
-41488,
-41999,
-42271,
-42304,
-41974,
-41281,
-40357,
-39336,
-38264,
-37124,
-35941,
-34770,
-33591,
-32388,
-31163,
-30095,
-29332,
-28933,
-28711,
-28495,
-28179,
-27935,
-27923,
-28209,
-28580,
-28835,
-28931,
-29089,
-29490,
-30031,
-30426,
-30477,
-30287,
-30091,
-29971,
-29898,
-29870,
-30080,
-30622,
-31345,
-31948,
-32271,
-32470,
-32704,
-32951,
-33051,
-32983,
-32947,
-33117,
-33408,
-33570,
-33393,
-32946,
-32415,
-32025,
-31923,
-32139,
-32667,
-33435,
-34409,
-35592,
-36863,
-38013,
-38834,
-39325,
-39683,
-40025,
-40209,
-39973,
-39200,
-38047,
-36740,
-35402,
-34080,
-32840,
-31841,
-31148,
-30725,
-30441,
-30222,
-30005,
-29812,
-29685,
-29713,
-29872,
-30031,
-30025,
-29889,
-29767,
-29705,
-29490,
-28962,
-28174,
-27524,
-27164,
-26969,
-26671,
-26277,
-26091,
-26282,
-26718,
-27113,
-27419,
-27845,
-28553,
-29498,
-30458,
-31296,
-31975,
-32530,
-33070,
-33854,
-35130,
-36944,
-38999,
-40949,
-42648,
-44255,
-45866,
-47393,
-48545,
-49121,
-49036,
-48294,
-46878,
-44880,
-42490,
-39937,
-37288,
-34523,
-31675,
-28978,
-26678,
-24793,
-23188,
-21724,
-20549,
-19831,
-19557,
-19470,
-19376,
-19409,
-19828,
-20692,
-21756,
-22790,
-23822,
-25020,
-26302,
-27421,
-28271,
-29176,
-30453,
-32056,
-33530,
-34702,
-35848,
-37399,
-39238,
-40849,
-41838,
-42371,
-42757,
-43017,
-42878,
-42298,
-41552,
-40873,
-40106,
-38985,
-37582,
-36257,
-35181,
-34157,
-33028,
-32017,
-31481,
-31372,
-31257,
-30934,
-30707,
-30950,
-31517,
-31841,
-31695,
-31428,
-31487,
-31776,
-31844,
-31506,
-31052,
-30759,
-30447,
-29783,
-28868,
-28222,
-28247,
-28757,
-29335,
-29787,
-30250,
-30781,
-31207,
-31435,
-31647,
-32124,
-32774,
-33234,
-33218,
-32864,
-32409,
-31863,
-31100,
-30184,
-29466,
-29182,
-29195,
-29200,
-29224,
-29567,
-30427,
-31559,
-32575,
-33374,
-34155,
-35022,
-35839,
-36484,
-37175,
-38242,
-39664,
-40992,
-41780,
-42005,
-41926,
-41652,
-41062,
-40068,
-38871,
-37745,
-36726,
-35630,
-34333,
-32915,
-31475,
-30041,
-28650,
-27496,
-26793,
-26418,
-26089,
-25587,
-25149,
-25036,
-25247,
-25443,
-25417,
-25321,
-25501,
-26057,
-26807,
-27487,
-27997,
-28398,
-28789,
-29311,
-30029,
-30891,
-31727,
-32403,
-33066,
-33864,
-34802,
-35619,
-36119,
-36444,
-36817,
-37364,
-37965,
-38629,
-39477,
-40543,
-41545,
-42144,
-42285,
-42228,
-42098,
-41710,
-40840,
-39626,
-38435,
-37444,
-36400,
-35083,
-33546,
-32109,
-30845,
-29508,
-27934,
-26259,
-24883,
-23960,
-23388,
-22997,
-22793,
-22886,
-23247,
-23777,
-24354,
-25026,
-25815,
-26667,
-27525,
-28343,
-29225,
-30163,
-31152,
-32107,
-33041,
-33962,
-34852,
-35630,
-36217,
-36670,
-37097,
-37599,
-38102,
-38416,
-38425,
-38241,
-38126,
-38267,
-38527,
-38626,
-38366,
-37836,
-37283,
-36855,
-36527,
-36202,
-35824,
-35448,
-35101,
-34771,
-34435,
-34063,
-33679,
-33255,
-32746,
-32028,
-31077,
-29973,
-28940,
-28144,
-27601,
-27133,
-26675,
-26214,
-25856,
-25534,
-25175,
-24831,
-24773,
-25217,
-26091,
-27073,
-27933,
-28730,
-29643,
-30722,
-31790,
-32753,
-33650,
-34660,
-35773,
-36851,
-37725,
-38349,
-38785,
-39040,
-39152,
-39171,
-39182,
-39151,
-38920,
-38349,
-37532,
-36703,
-35988,
-35293,
-34449,
-33602,
-33077,
-33081,
-33364,
-33480,
-33237,
-32837,
-32484,
-32086,
-31412,
-30528,
-29811,
-29501,
-29356,
-29043,
-28586,
-28336,
-28415,
-28451,
-28098,
-27617,
-27605,
-28267,
-29065,
-29402,
-29275,
-29169,
-29341,
-29565,
-29641,
-29773,
-30314,
-31212,
-32098,
-32798,
-33567,
-34629,
-35794,
-36761,
-37573,
-38603,
-39912,
-41055,
-41581,
-41531,
-41292,
-40983,
-40381,
-39369,
-38279,
-37437,
-36733,
-35682,
-34116,
-32335,
-30784,
-29485,
-28276,
-27126,
-26241,
-25700,
-25295,
-24854,
-24547,
-24668,
-25271,
-26038,
-26736,
-27416,
-28275,
-29314,
-30311,
-31210,
-32171,
-33383,
-34763,
-35983,
-36878,
-37483,
-37945,
-38220,
-38157,
-37735,
-37202,
-36827,
-36667,
-36479,
-35985,
-35166,
-34204,
-33307,
-32494,
-31639,
-30646,
-29532,
-28446,
-27554,
-27013,
-26856,
-26993,
-27332,
-27908,
-28888,
-30280,
-31802,
-33066,
-34012,
-34927,
-36047,
-37128,
-37698,
-37580,
-37111,
-36651,
-36195,
-35516,
-34676,
-34046,
-33805,
-33643,
-33148,
-32393,
-31838,
-31764,
-31930,
-31988,
-31941,
-32081,
-32444,
-32777,
-32833,
-32783,
-32884,
-33183,
-33480,
-33700,
-33966,
-34345,
-34637,
-34596,
-34207,
-33630,
-33002,
-32290,
-31584,
-30998,
-30594,
-30165,
-29541,
-28804,
-28200,
-27801,
-27460,
-27057,
-26677,
-26394,
-26058,
-25469,
-24720,
-24179,
-24098,
-24465,
-25143,
-26264,
-27907,
-29914,
-31873,
-33674,
-35673,
-38301,
-41547,
-44938,
-48016,
-50489,
-52179,
-52776,
-52184,
-50606,
-48526,
-46224,
-43809,
-41363,
-39066,
-36975,
-34891,
-32673,
-30458,
-28606,
-27179,
-25937,
-24705,
-23653,
-23009,
-22652,
-22190,
-21498,
-20855,
-20533,
-20394,
-20129,
-19768,
-19697,
-20122,
-20840,
-21556,
-22385,
-23701,
-25576,
-27686,
-29622,
-31372,
-33059,
-34663,
-35991,
-37012,
-37947,
-38967,
-39982,
-40808,
-41511,
-42247,
-43100,
-43896,
-44573,
-45187,
-45762,
-46098,
-46018,
-45667,
-45344,
-45074,
-44479,
-43235,
-41479,
-39545,
-37565,
-35354,
-32951,
-30723,
-28983,
-27527,
-25895,
-23999,
-22356,
-21386,
-20999,
-20675,
-20230,
-19930,
-20079,
-20566,
-21076,
-21561,
-22295,
-23407,
-24643,
-25548,
-26018,
-26355,
-26926,
-27876,
-29061,
-30384,
-31761,
-33192,
-34556,
-35804,
-36950,
-38115,
-39291,
-40364,
-41184,
-41830,
-42548,
-43503,
-44553,
-45307,
-45553,
-45338,
-44877,
-44181,
-43111,
-41690,
-40128,
-38654,
-37148,
-35440,
-33596,
-32010,
-30872,
-29936,
-28831,
-27593,
-26608,
-26022,
-25457,
-24476,
-23188,
-22136,
-21687,
-21660,
-21775,
-22060,
-22740,
-23773,
-24852,
-25833,
-27030,
-28724,
-30796,
-32778,
-34450,
-35940,
-37354,
-38439,
-38930,
-38929,
-38860,
-38896,
-38828,
-38421,
-37839,
-37363,
-36955,
-36254,
-35104,
-33882,
-33017,
-32515,
-31890,
-30895,
-29768,
-29003,
-28713,
-28639,
-28588,
-28787,
-29550,
-30882,
-32309,
-33486,
-34491,
-35730,
-37298,
-38766,
-39512,
-39427,
-38945,
-38588,
-38362,
-37834,
-36768,
-35408,
-34204,
-33215,
-32117,
-30662,
-29102,
-27841,
-27014,
-26374,
-25756,
-25333,
-25357,
-25819,
-26430,
-27056,
-27748,
-28585,
-29397,
-29995,
-30444,
-30972,
-31654,
-32319,
-32859,
-33428,
-34205,
-35049,
-35567,
-35629,
-35526,
-35672,
-36101,
-36555,
-36859,
-37164,
-37645,
-38200,
-38530,
-38408,
-37899,
-37146,
-36327,
-35576,
-35055,
-34764,
-34481,
-33941,
-33093,
-32127,
-31276,
-30585,
-30009,
-29575,
-29286,
-29095,
-28835,
-28461,
-28100,
-27891,
-27853,
-27878,
-27964,
-28161,
-28505,
-28838,
-29036,
-29142,
-29340,
-29811,
-30464,
-31194,
-31917,
-32755,
-33832,
-35079,
-36232,
-36938,
-37133,
-37046,
-37033,
-37252,
-37525,
-37661,
-37645,
-37617,
-37600,
-37394,
-36893,
-36205,
-35612,
-35214,
-34910,
-34641,
-34475,
-34425,
-34260,
-33662,
-32619,
-31408,
-30329,
-29403,
-28568,
-27896,
-27514,
-27373,
-27226,
-26998,
-26930,
-27304,
-28081,
-28899,
-29464,
-29729,
-29782,
-29693,
-29537,
-29466,
-29544,
-29643,
-29633,
-29680,
-30087,
-30901,
-31681,
-32070,
-32239,
-32733,
-33785,
-35031,
-36105,
-37099,
-38426,
-40108,
-41719,
-42857,
-43623,
-44221,
-44507,
-44064,
-42787,
-41142,
-39594,
-38139,
-36437,
-34395,
-32369,
-30716,
-29405,
-28220,
-27038,
-26066,
-25448,
-25247,
-25395,
-25874,
-26497,
-27006,
-27174,
-27139,
-27165,
-27372,
-27584,
-27655,
-27703,
-27972,
-28474,
-28987,
-29322,
-29615,
-30084,
-30792,
-31559,
-32253,
-32939,
-33789,
-34799,
-35776,
-36439,
-36669,
-36532,
-36258,
-36088,
-36095,
-36113,
-35836,
-35126,
-34184,
-33410,
-33061,
-33030,
-33051,
-32969,
-32932,
-33119,
-33564,
-34118,
-34739,
-35544,
-36706,
-38094,
-39339,
-40080,
-40206,
-39827,
-39017,
-37772,
-36203,
-34568,
-33175,
-32065,
-31087,
-30145,
-29343,
-28823,
-28540,
-28290,
-28018,
-27848,
-27945,
-28243,
-28522,
-28652,
-28620,
-28480,
-28164,
-27610,
-26817,
-25872,
-24920,
-24122,
-23696,
-23733,
-24168,
-24840,
-25769,
-27149,
-29011,
-31030,
-32706,
-33956,
-35195,
-36948,
-39277,
-41788,
-44065,
-45971,
-47551,
-48762,
-49454,
-49524,
-49001,
-47967,
-46504,
-44753,
-42830,
-40769,
-38442,
-35796,
-33018,
-30424,
-28236,
-26386,
-24813,
-23497,
-22471,
-21625,
-20784,
-20000,
-19502,
-19494,
-19872,
-20429,
-21099,
-22031,
-23291,
-24726,
-26145,
-27556,
-29130,
-30887,
-32606,
-34038,
-35181,
-36205,
-37217,
-38113,
-38803,
-39316,
-39849,
-40488,
-41158,
-41694,
-41956,
-41886,
-41467,
-40764,
-39906,
-39009,
-38056,
-36895,
-35441,
-33814,
-32250,
-30888,
-29655,
-28492,
-27490,
-26870,
-26678,
-26716,
-26799,
-27009,
-27578,
-28564,
-29648,
-30437,
-30838,
-31060,
-31278,
-31468,
-31499,
-31508,
-31713,
-32286,
-33000,
-33610,
-33952,
-34165,
-34384,
-34717,
-35146,
-35641,
-36100,
-36426,
-36576,
-36627,
-36643,
-36549,
-36175,
-35414,
-34371,
-33254,
-32236,
-31358,
-30578,
-29796,
-28897,
-27858,
-26858,
-26239,
-26272,
-26970,
-28045,
-29199,
-30228,
-31069,
-31707,
-32157,
-32523,
-32990,
-33705,
-34680,
-35717,
-36547,
-36986,
-37035,
-36869,
-36630,
-36360,
-36034,
-35711,
-35435,
-35139,
-34563,
-33568,
-32377,
-31416,
-30899,
-30560,
-30001,
-29144,
-28312,
-27870,
-27856,
-28115,
-28529,
-29109,
-29793,
-30438,
-30946,
-31452,
-32133,
-33058,
-34122,
-35262,
-36425,
-37455,
-38090,
-38152,
-37813,
-37428,
-37213,
-37094,
-36891,
-36528,
-36013,
-35356,
-34544,
-33683,
-32952,
-32420,
-32023,
-31659,
-31354,
-31131,
-30913,
-30570,
-30168,
-29919,
-29945,
-30053,
-29997,
-29789,
-29674,
-29780,
-29931,
-29925,
-29865,
-30012,
-30400,
-30719,
-30709,
-30496,
-30392,
-30446,
-30404,
-30126,
-29833,
-29813,
-30012,
-30082,
-29937,
-29860,
-30182,
-30753,
-31195,
-31386,
-31724,
-32596,
-33988,
-35490,
-36886,
-38225,
-39594,
-40820,
-41669,
-42177,
-42631,
-43150,
-43575,
-43617,
-43218,
-42435,
-41246,
-39542,
-37398,
-35181,
-33263,
-31720,
-30375,
-29066,
-27812,
-26649,
-25567,
-24598,
-23968,
-23867,
-24213,
-24578,
-24632,
-24358,
-24085,
-24012,
-24172,
-24458,
-24894,
-25573,
-26527,
-27634,
-28709,
-29654,
-30503,
-31448,
-32664,
-34153,
-35691,
-36928,
-37702,
-38094,
-38297,
-38403,
-38433,
-38420,
-38432,
-38375,
-37981,
-37069,
-35799,
-34607,
-33772,
-33254,
-32851,
-32547,
-32538,
-33015,
-33955,
-35201,
-36541,
-37745,
-38557,
-38849,
-38741,
-38495,
-38283,
-38028,
-37586,
-36930,
-36079,
-34982,
-33499,
-31684,
-29806,
-28259,
-27152,
-26398,
-25809,
-25320,
-24976,
-24805,
-24869,
-25155,
-25595,
-26031,
-26340,
-26532,
-26610,
-26516,
-26140,
-25636,
-25394,
-25759,
-26675,
-27822,
-29028,
-30363,
-31931,
-33494,
-34804,
-35871,
-37080,
-38668,
-40479,
-42156,
-43542,
-44716,
-45655,
-46164,
-46081,
-45547,
-44812,
-43949,
-42824,
-41395,
-39778,
-38068,
-36201,
-34127,
-32094,
-30497,
-29474,
-28753,
-27959,
-26999,
-26069,
-25351,
-24809,
-24366,
-24000,
-23793,
-23785,
-23974,
-24325,
-24776,
-25224,
-25617,
-26116,
-26913,
-28101,
-29493,
-30829,
-32037,
-33118,
-34092,
-34826,
-35295,
-35573,
-35784,
-35947,
-36050,
-36162,
-36400,
-36737,
-37021,
-37104,
-37036,
-36875,
-36667,
-36381,
-36107,
-35925,
-35711,
-35214,
-34338,
-33354,
-32622,
-32222,
-31929,
-31646,
-31518,
-31726,
-32129,
-32420,
-32516,
-32645,
-32987,
-33396,
-33603,
-33546,
-33391,
-33230,
-32918,
-32377,
-31739,
-31282,
-31042,
-30859,
-30642,
-30462,
-30425,
-30388,
-30200,
-29934,
-29913,
-30358,
-31119,
-31854,
-32357,
-32643,
-32790,
-32755,
-32493,
-32124,
-31915,
-32061,
-32498,
-32970,
-33235,
-33297,
-33364,
-33613,
-33979,
-34153,
-33930,
-33397,
-32915,
-32730,
-32789,
-32902,
-32991,
-33192,
-33630,
-34245,
-34836,
-35227,
-35363,
-35302,
-35163,
-35045,
-34910,
-34577,
-33880,
-32938,
-32100,
-31606,
-31307,
-30852,
-30073,
-29201,
-28507,
-28095,
-27889,
-27895,
-28128,
-28477,
-28663,
-28662,
-28759,
-29257,
-30039,
-30696,
-31115,
-31616,
-32575,
-33857,
-35041,
-35961,
-36887,
-38037,
-39173,
-39826,
-39876,
-39624,
-39361,
-39042,
-38541,
-37995,
-37660,
-37524,
-37208,
-36416,
-35278,
-34163,
-33229,
-32320,
-31289,
-30200,
-29281,
-28581,
-28022,
-27464,
-26912,
-26431,
-26174,
-26247,
-26663,
-27264,
-27838,
-28398,
-29124,
-30076,
-30983,
-31468,
-31513,
-31483,
-31649,
-31843,
-31707,
-31252,
-30921,
-31073,
-31583,
-32060,
-32383,
-32751,
-33330,
-33944,
-34334,
-34509,
-34683,
-34934,
-35130,
-35121,
-35082,
-35154,
-35328,
-35380,
-35344,
-35512,
-36119,
-36939,
-37534,
-37693,
-37639,
-37597,
-37475,
-37014,
-36257,
-35544,
-35102,
-34673,
-33851,
-32640,
-31510,
-30881,
-30650,
-30430,
-30070,
-29851,
-30015,
-30417,
-30702,
-30733,
-30723,
-30797,
-30796,
-30448,
-29816,
-29207,
-28842,
-28601,
-28269,
-27877,
-27633,
-27636,
-27776,
-27883,
-27923,
-27936,
-27841,
-27602,
-27247,
-26975,
-26891,
-27019,
-27388,
-28074,
-29040,
-30011,
-30760,
-31359,
-32187,
-33477,
-35206,
-37279,
-39913,
-43265,
-47020,
-50299,
-52362,
-53196,
-53337,
-53145,
-52530,
-51238,
-49298,
-46884,
-43995,
-40444,
-36307,
-32110,
-28465,
-25609,
-23362,
-21484,
-19980,
-18909,
-18230,
-17806,
-17594,
-17695,
-18122,
-18709,
-19153,
-19216,
-18877,
-18348,
-18009,
-18250,
-19257,
-20985,
-23309,
-26132,
-29339,
-32608,
-35474,
-37719,
-39537,
-41279,
-43100,
-44730,
-46000,
-46959,
-47825,
-48551,
-48785,
-48310,
-47306,
-46210,
-45265,
-44321,
-43094,
-41523,
-39806,
-38229,
-36894,
-35749,
-34632,
-33457,
-32216,
-31008,
-29901,
-28905,
-27947,
-26992,
-26080,
-25240,
-24410,
-23480,
-22430,
-21425,
-20661,
-20201,
-19992,
-19966,
-20265,
-21010,
-22239,
-23724,
-25234,
-26710,
-28237,
-29928,
-31624,
-33141,
-34387,
-35536,
-36778,
-38048,
-39066,
-39627,
-39854,
-40057,
-40388,
-40712,
-40820,
-40736,
-40699,
-40873,
-41201,
-41458,
-41505,
-41346,
-41004,
-40473,
-39718,
-38782,
-37737,
-36680,
-35669,
-34716,
-33755,
-32654,
-31333,
-29904,
-28559,
-27463,
-26537,
-25681,
-24889,
-24271,
-23880,
-23604,
-23317,
-23062,
-23027,
-23318,
-23898,
-24593,
-25322,
-26055,
-26754,
-27375,
-27881,
-28341,
-28843,
-29449,
-30166,
-30944,
-31679,
-32273,
-32711,
-33130,
-33689,
-34407,
-35200,
-36010,
-36995,
-38302,
-39917,
-41564,
-43040,
-44331,
-45582,
-46788,
-47779,
-48409,
-48670,
-48633,
-48198,
-47129,
-45281,
-42762,
-39840,
-36784,
-33736,
-30778,
-28005,
-25418,
-23014,
-20792,
-18849,
-17355,
-16380,
-15940,
-15952,
-16326,
-16875,
-17390,
-17789,
-18244,
-19024,
-20225,
-21666,
-23128,
-24658,
-26435,
-28521,
-30671,
-32658,
-34514,
-36483,
-38620,
-40728,
-42557,
-44159,
-45631,
-46880,
-47555,
-47526,
-47077,
-46628,
-46227,
-45556,
-44417,
-43038,
-41793,
-40740,
-39593,
-38179,
-36604,
-35111,
-33695,
-32261,
-30850,
-29653,
-28707,
-27782,
-26761,
-25834,
-25381,
-25412,
-25562,
-25524,
-25379,
-25429,
-25685,
-25879,
-25799,
-25580,
-25480,
-25582,
-25784,
-26079,
-26586,
-27345,
-28222,
-29051,
-29900,
-30920,
-32132,
-33367,
-34479,
-35462,
-36315,
-36909,
-37123,
-37095,
-37076,
-37184,
-37223,
-36986,
-36571,
-36306,
-36371,
-36636,
-36833,
-36863,
-36827,
-36843,
-36938,
-37065,
-37183,
-37198,
-37012,
-36581,
-35969,
-35273,
-34532,
-33717,
-32899,
-32175,
-31622,
-31202,
-30868,
-30622,
-30409,
-30040,
-29309,
-28280,
-27280,
-26623,
-26262,
-25955,
-25546,
-25171,
-24962,
-24889,
-24822,
-24842,
-25205,
-26059,
-27263,
-28598,
-30036,
-31733,
-33745,
-35901,
-38000,
-39925,
-41639,
-42947,
-43643,
-43730,
-43512,
-43279,
-43056,
-42577,
-41696,
-40430,
-38966,
-37398,
-35803,
-34267,
-32893,
-31676,
-30543,
-29480,
-28473,
-27486,
-26360,
-25083,
-23916,
-23223,
-23124,
-23449,
-23997,
-24853,
-26203,
-28032,
-30018,
-31848,
-33404,
-34731,
-35768,
-36441,
-36783,
-36983,
-37158,
-37226,
-37102,
-36836,
-36586,
-36330,
-35945,
-35366,
-34741,
-34160,
-33488,
-32561,
-31443,
-30393,
-29432,
-28263,
-26653,
-24883,
-23540,
-22872,
-22685,
-22680,
-23041,
-24120,
-25960,
-28170,
-30518,
-33227,
-36630,
-40522,
-44162,
-46951,
-48797,
-49871,
-50115,
-49344,
-47680,
-45603,
-43500,
-41250,
-38664,
-35854,
-33362,
-31462,
-29981,
-28635,
-27509,
-26913,
-26848,
-26863,
-26521,
-25861,
-25227,
-24793,
-24395,
-23846,
-23150,
-22446,
-21799,
-21267,
-21061,
-21410,
-22348,
-23710,
-25390,
-27472,
-29893,
-32326,
-34269,
-35687,
-36834,
-37979,
-38926,
-39460,
-39679,
-40025,
-40631,
-41148,
-41146,
-40702,
-40292,
-40251,
-40364,
-40301,
-39962,
-39570,
-39285,
-39013,
-38637,
-38149,
-37630,
-37092,
-36478,
-35810,
-35115,
-34353,
-33407,
-32264,
-31047,
-29844,
-28564,
-27101,
-25565,
-24265,
-23340,
-22662,
-21993,
-21397,
-21147,
-21414,
-22051,
-22845,
-23780,
-25049,
-26698,
-28421,
-29850,
-30816,
-31527,
-32242,
-33047,
-33870,
-34656,
-35469,
-36358,
-37233,
-37957,
-38533,
-39116,
-39843,
-40562,
-41011,
-41030,
-40800,
-40562,
-40388,
-40089,
-39509,
-38641,
-37592,
-36374,
-34985,
-33556,
-32327,
-31423,
-30752,
-30121,
-29535,
-29049,
-28691,
-28341,
-28021,
-27918,
-28160,
-28586,
-28867,
-28935,
-28989,
-29246,
-29570,
-29720,
-29688,
-29715,
-29986,
-30354,
-30698,
-31135,
-31972,
-33199,
-34418,
-35186,
-35493,
-35651,
-35896,
-36130,
-36128,
-35826,
-35371,
-34876,
-34358,
-33743,
-33082,
-32482,
-32061,
-31822,
-31727,
-31708,
-31752,
-31802,
-31749,
-31438,
-30860,
-30156,
-29594,
-29242,
-29024,
-28885,
-29011,
-29675,
-30837,
-32123,
-33157,
-33971,
-34836,
-35851,
-36746,
-37258,
-37436,
-37553,
-37704,
-37745,
-37557,
-37229,
-36870,
-36400,
-35680,
-34805,
-34022,
-33407,
-32698,
-31673,
-30461,
-29409,
-28666,
-28038,
-27465,
-27159,
-27431,
-28209,
-29077,
-29757,
-30334,
-31025,
-31810,
-32458,
-32884,
-33200,
-33551,
-33811,
-33827,
-33536,
-33126,
-32693,
-32238,
-31712,
-31198,
-30869,
-30823,
-31050,
-31466,
-32009,
-32601,
-33196,
-33771,
-34363,
-34969,
-35565,
-36093,
-36565,
-36997,
-37374,
-37666,
-37835,
-37892,
-37787,
-37473,
-36905,
-36165,
-35313,
-34372,
-33304,
-32121,
-30936,
-29841,
-28843,
-27838,
-26737,
-25581,
-24544,
-23857,
-23586,
-23522,
-23320,
-22833,
-22351,
-22311,
-22884,
-23832,
-24967,
-26553,
-29055,
-32522,
-36334,
-39732,
-42485,
-44852,
-46969,
-48621,
-49464,
-49559,
-49184,
-48441,
-47194,
-45352,
-43148,
-40859,
-38509,
-36041,
-33585,
-31551,
-30121,
-29107,
-28173,
-27226,
-26421,
-25768,
-25153,
-24544,
-24126,
-24038,
-24078,
-23982,
-23759,
-23744,
-24082,
-24531,
-24791,
-24949,
-25372,
-26212,
-27177,
-27986,
-28663,
-29488,
-30520,
-31589,
-32564,
-33523,
-34526,
-35391,
-35929,
-36244,
-36696,
-37400,
-38120,
-38547,
-38748,
-39012,
-39395,
-39626,
-39507,
-39251,
-39280,
-39708,
-40280,
-40714,
-41002,
-41231,
-41285,
-40909,
-40022,
-38843,
-37620,
-36376,
-35008,
-33499,
-31956,
-30374,
-28653,
-26793,
-25056,
-23703,
-22731,
-21918,
-21226,
-20914,
-21162,
-21786,
-22329,
-22672,
-23119,
-24033,
-25346,
-26606,
-27533,
-28227,
-29027,
-30054,
-31181,
-32236,
-33202,
-34121,
-35023,
-35852,
-36619,
-37327,
-38008,
-38630,
-39154,
-39535,
-39691,
-39630,
-39449,
-39355,
-39400,
-39472,
-39360,
-39010,
-38560,
-38139,
-37770,
-37355,
-36850,
-36287,
-35697,
-35054,
-34297,
-33406,
-32429,
-31495,
-30764,
-30301,
-30007,
-29653,
-29173,
-28757,
-28683,
-28975,
-29297,
-29348,
-29134,
-28965,
-29005,
-29120,
-29111,
-29003,
-29030,
-29304,
-29634,
-29782,
-29673,
-29477,
-29278,
-29027,
-28591,
-28033,
-27541,
-27277,
-27196,
-27138,
-27085,
-27208,
-27788,
-28930,
-30459,
-32101,
-33662,
-35202,
-36860,
-38719,
-40682,
-42548,
-44157,
-45453,
-46545,
-47493,
-48199,
-48293,
-47474,
-45772,
-43694,
-41716,
-39966,
-38126,
-36010,
-33744,
-31680,
-29856,
-28100,
-26305,
-24703,
-23558,
-22808,
-22188,
-21593,
-21280,
-21424,
-21881,
-22248,
-22459,
-22779,
-23580,
-24811,
-26183,
-27416,
-28479,
-29450,
-30355,
-31161,
-31829,
-32354,
-32731,
-33094,
-33580,
-34285,
-35027,
-35580,
-35905,
-36244,
-36830,
-37597,
-38305,
-38806,
-39234,
-39722,
-40236,
-40596,
-40715,
-40663,
-40566,
-40448,
-40270,
-39960,
-39390,
-38458,
-37164,
-35693,
-34279,
-32997,
-31815,
-30695,
-29767,
-29050,
-28401,
-27563,
-26515,
-25487,
-24747,
-24339,
-24120,
-24017,
-24116,
-24476,
-25052,
-25679,
-26273,
-26876,
-27578,
-28455,
-29524,
-30759,
-32028,
-33204,
-34190,
-35036,
-35795,
-36427,
-36877,
-37139,
-37372,
-37689,
-38044,
-38265,
-38239,
-38034,
-37773,
-37505,
-37183,
-36804,
-36480,
-36330,
-36353,
-36376,
-36214,
-35766,
-35082,
-34248,
-33367,
-32519,
-31748,
-31052,
-30379,
-29727,
-29190,
-28863,
-28704,
-28541,
-28266,
-28023,
-28027,
-28291,
-28498,
-28336,
-27833,
-27356,
-27204,
-27375,
-27679,
-28030,
-28513,
-29147,
-29820,
-30395,
-30877,
-31350,
-31872,
-32534,
-33536,
-35094,
-37070,
-39046,
-40551,
-41550,
-42245,
-42713,
-42763,
-42258,
-41417,
-40635,
-40054,
-39430,
-38479,
-37191,
-35792,
-34490,
-33370,
-32456,
-31718,
-31032,
-30225,
-29288,
-28365,
-27603,
-26933,
-26269,
-25709,
-25499,
-25694,
-26033,
-26271,
-26438,
-26746,
-27236,
-27669,
-27903,
-28051,
-28352,
-28823,
-29286,
-29690,
-30151,
-30835,
-31655,
-32492,
-33309,
-34182,
-35070,
-35792,
-36202,
-36363,
-36384,
-36357,
-36276,
-36176,
-36068,
-35848,
-35447,
-34929,
-34571,
-34476,
-34535,
-34537,
-34541,
-34799,
-35432,
-36308,
-37264,
-38280,
-39386,
-40314,
-40658,
-40194,
-39146,
-37846,
-36496,
-35068,
-33630,
-32328,
-31256,
-30321,
-29434,
-28579,
-27817,
-27092,
-26402,
-25851,
-25620,
-25628,
-25632,
-25507,
-25471,
-25786,
-26321,
-26649,
-26511,
-26101,
-25702,
-25370,
-24976,
-24625,
-24700,
-25362,
-26435,
-27613,
-28924,
-30615,
-32591,
-34443,
-35854,
-37116,
-38786,
-41087,
-43678,
-46045,
-48012,
-49553,
-50607,
-50996,
-50729,
-50078,
-49208,
-47977,
-46068,
-43441,
-40415,
-37349,
-34369,
-31410,
-28533,
-25956,
-23903,
-22369,
-21181,
-20163,
-19297,
-18680,
-18426,
-18552,
-18960,
-19492,
-20069,
-20706,
-21499,
-22445,
-23553,
-24812,
-26363,
-28285,
-30509,
-32774,
-34743,
-36252,
-37317,
-38120,
-38861,
-39598,
-40265,
-40718,
-40941,
-41059,
-41194,
-41274,
-41118,
-40633,
-40019,
-39503,
-39092,
-38465,
-37344,
-35767,
-34108,
-32664,
-31470,
-30323,
-29130,
-28041,
-27334,
-27190,
-27591,
-28354,
-29349,
-30484,
-31736,
-32952,
-33910,
-34384,
-34387,
-34146,
-33898,
-33680,
-33369,
-32875,
-32360,
-31959,
-31676,
-31268,
-30667,
-30053,
-29811,
-30021,
-30466,
-30831,
-31061,
-31366,
-31862,
-32424,
-32780,
-32795,
-32553,
-32198,
-31859,
-31519,
-31172,
-30722,
-30125,
-29516,
-29209,
-29527,
-30404,
-31478,
-32370,
-33120,
-33965,
-34975,
-35839,
-36274,
-36368,
-36545,
-37025,
-37610,
-37885,
-37691,
-37174,
-36569,
-35975,
-35444,
-34987,
-34605,
-34151,
-33523,
-32800,
-32121,
-31551,
-30952,
-30305,
-29754,
-29411,
-29088,
-28465,
-27563,
-26792,
-26537,
-26706,
-26950,
-27170,
-27676,
-28645,
-29831,
-30809,
-31529,
-32362,
-33557,
-34895,
-36036,
-36866,
-37564,
-38139,
-38394,
-38240,
-37928,
-37689,
-37466,
-36951,
-36186,
-35516,
-35185,
-34948,
-34425,
-33646,
-33013,
-32750,
-32561,
-32107,
-31489,
-31191,
-31428,
-31873,
-32047,
-31792,
-31304,
-30738,
-30136,
-29614,
-29419,
-29677,
-30138,
-30432,
-30466,
-30432,
-30472,
-30444,
-30197,
-29854,
-29754,
-29996,
-30337,
-30455,
-30283,
-30029,
-29841,
-29727,
-29618,
-29507,
-29430,
-29398,
-29441,
-29619,
-29975,
-30482,
-31102,
-31931,
-33083,
-34573,
-36227,
-37977,
-39932,
-42241,
-44708,
-46825,
-48151,
-48648,
-48515,
-47840,
-46448,
-44296,
-41615,
-38875,
-36263,
-33717,
-31081,
-28472,
-26214,
-24576,
-23620,
-23190,
-23052,
-22994,
-22865,
-22669,
-22433,
-22168,
-21830,
-21419,
-21156,
-21254,
-21804,
-22628,
-23569,
-24659,
-26078,
-27881,
-29903,
-31929,
-33887,
-35796,
-37575,
-38999,
-39921,
-40401,
-40647,
-40774,
-40770,
-40611,
-40355,
-40002,
-39405,
-38393,
-37040,
-35737,
-34824,
-34366,
-34125,
-34008,
-34189,
-34889,
-35953,
-36942,
-37480,
-37710,
-37991,
-38480,
-38875,
-38781,
-38082,
-37027,
-35770,
-34268,
-32380,
-30243,
-28242,
-26679,
-25589,
-24784,
-24174,
-23781,
-23654,
-23787,
-24146,
-24739,
-25535,
-26422,
-27253,
-27953,
-28481,
-28745,
-28705,
-28470,
-28368,
-28561,
-28896,
-29056,
-29063,
-29389,
-30461,
-32174,
-33922,
-35225,
-36096,
-36906,
-37805,
-38729,
-39513,
-40227,
-40957,
-41655,
-42146,
-42325,
-42203,
-41799,
-41092,
-40163,
-39245,
-38482,
-37796,
-36929,
-35825,
-34693,
-33744,
-32949,
-32145,
-31311,
-30622,
-30184,
-29801,
-29271,
-28540,
-27831,
-27284,
-26828,
-26382,
-25997,
-25844,
-25943,
-26124,
-26262,
-26381,
-26631,
-27030,
-27534,
-28164,
-28990,
-29962,
-30770,
-31182,
-31276,
-31477,
-32049,
-32841,
-33533,
-34026,
-34604,
-35409,
-36190,
-36466,
-36130,
-35611,
-35445,
-35697,
-36010,
-36054,
-35910,
-35869,
-35989,
-36078,
-35937,
-35693,
-35609,
-35825,
-36188,
-36421,
-36345,
-35924,
-35312,
-34723,
-34367,
-34229,
-34116,
-33801,
-33314,
-32834,
-32479,
-32139,
-31692,
-31189,
-30855,
-30715,
-30611,
-30308,
-29881,
-29527,
-29378,
-29280,
-29076,
-28804,
-28677,
-28848,
-29179,
-29448,
-29465,
-29324,
-29175,
-29190,
-29349,
-29587,
-29798,
-29984,
-30129,
-30253,
-30326,
-30432,
-30684,
-31147,
-31771,
-32455,
-33246,
-34226,
-35366,
-36442,
-37302,
-38078,
-39048,
-40192,
-41132,
-41483,
-41326,
-41029,
-40801,
-40423,
-39613,
-38479,
-37345,
-36391,
-35364,
-34018,
-32415,
-30893,
-29670,
-28703,
-27908,
-27318,
-26979,
-26784,
-26546,
-26260,
-26093,
-26155,
-26371,
-26578,
-26814,
-27187,
-27705,
-28197,
-28522,
-28801,
-29222,
-29890,
-30698,
-31571,
-32496,
-33448,
-34297,
-34939,
-35448,
-36038,
-36748,
-37389,
-37730,
-37815,
-37912,
-38160,
-38416,
-38368,
-37957,
-37405,
-36972,
-36695,
-36350,
-35755,
-34923,
-34030,
-33266,
-32690,
-32294,
-32014,
-31778,
-31537,
-31276,
-31053,
-30868,
-30647,
-30279,
-29781,
-29347,
-29165,
-29187,
-29130,
-28723,
-28021,
-27299,
-26800,
-26483,
-26217,
-26052,
-26258,
-27002,
-28127,
-29266,
-30238,
-31179,
-32307,
-33566,
-34741,
-35739,
-36746,
-38007,
-39382,
-40515,
-41085,
-41188,
-41106,
-40989,
-40755,
-40296,
-39654,
-38963,
-38229,
-37384,
-36405,
-35456,
-34664,
-34045,
-33455,
-32824,
-32107,
-31279,
-30242,
-29041,
-27875,
-26977,
-26375,
-25913,
-25523,
-25386,
-25683,
-26342,
-26991,
-27394,
-27607,
-27950,
-28522,
-29182,
-29705,
-30021,
-30220,
-30376,
-30525,
-30745,
-31165,
-31829,
-32630,
-33387,
-34034,
-34574,
-34977,
-35156,
-35109,
-35014,
-35036,
-35113,
-34997,
-34578,
-34063,
-33822,
-34006,
-34501,
-35115,
-35833,
-36739,
-37787,
-38790,
-39527,
-39974,
-40184,
-40183,
-39892,
-39250,
-38270,
-37032,
-35648,
-34235,
-32940,
-31818,
-30831,
-29883,
-28993,
-28319,
-27929,
-27748,
-27530,
-27217,
-26926,
-26867,
-27015,
-27184,
-27204,
-27115,
-27068,
-27134,
-27248,
-27350,
-27487,
-27744,
-28114,
-28479,
-28749,
-28973,
-29242,
-29648,
-30207,
-30933,
-31828,
-32782,
-33581,
-34071,
-34253,
-34335,
-34444,
-34623,
-34886,
-35399,
-36365,
-37800,
-39425,
-40894,
-42086,
-43113,
-44118,
-45073,
-45834,
-46280,
-46309,
-45757,
-44436,
-42349,
-39766,
-37083,
-34518,
-32076,
-29738,
-27599,
-25802,
-24347,
-23132,
-22130,
-21466,
-21234,
-21340,
-21491,
-21539,
-21497,
-21522,
-21656,
-21878,
-22187,
-22692,
-23449,
-24442,
-25563,
-26790,
-28133,
-29585,
-31086,
-32613,
-34237,
-36013,
-37847,
-39558,
-41012,
-42243,
-43300,
-44120,
-44536,
-44450,
-43964,
-43277,
-42577,
-41911,
-41224,
-40371,
-39262,
-37936,
-36633,
-35578,
-34764,
-33982,
-33035,
-32049,
-31247,
-30723,
-30284,
-29773,
-29304,
-29034,
-28942,
-28705,
-28185,
-27574,
-27204,
-27083,
-26958,
-26698,
-26546,
-26803,
-27406,
-27989,
-28358,
-28711,
-29362,
-30308,
-31265,
-32051,
-32748,
-33457,
-34038,
-34207,
-33932,
-33499,
-33246,
-33186,
-33041,
-32526,
-31672,
-30738,
-30089,
-29892,
-30164,
-30762,
-31577,
-32521,
-33503,
-34379,
-35046,
-35534,
-36088,
-36874,
-37905,
-38979,
-39929,
-40660,
-41090,
-41075,
-40541,
-39632,
-38633,
-37702,
-36746,
-35596,
-34243,
-32889,
-31718,
-30765,
-29948,
-29220,
-28588,
-28085,
-27699,
-27407,
-27157,
-26921,
-26705,
-26610,
-26739,
-27108,
-27630,
-28217,
-28844,
-29472,
-29987,
-30285,
-30447,
-30690,
-31106,
-31536,
-31739,
-31706,
-31677,
-31823,
-32088,
-32278,
-32377,
-32523,
-32821,
-33215,
-33581,
-33931,
-34357,
-34946,
-35731,
-36685,
-37708,
-38609,
-39225,
-39609,
-39934,
-40229,
-40238,
-39762,
-38963,
-38283,
-37860,
-37355,
-36358,
-34971,
-33656,
-32684,
-31780,
-30604,
-29241,
-28117,
-27423,
-26903,
-26269,
-25609,
-25233,
-25242,
-25385,
-25481,
-25584,
-25868,
-26312,
-26796,
-27385,
-28230,
-29364,
-30529,
-31563,
-32553,
-33737,
-35002,
-36019,
-36572,
-36823,
-37085,
-37343,
-37406,
-37203,
-36952,
-36880,
-36902,
-36791,
-36528,
-36378,
-36510,
-36815,
-36940,
-36740,
-36305,
-35796,
-35253,
-34576,
-33755,
-32883,
-32091,
-31466,
-30993,
-30604,
-30251,
-29881,
-29549,
-29316,
-29199,
-29142,
-29044,
-28885,
-28729,
-28662,
-28670,
-28678,
-28590,
-28442,
-28381,
-28539,
-28897,
-29283,
-29538,
-29715,
-30045,
-30683,
-31570,
-32509,
-33411,
-34380,
-35517,
-36733,
-37763,
-38397,
-38652,
-38699,
-38758,
-38900,
-39103,
-39212,
-39096,
-38695,
-38093,
-37419,
-36704,
-35944,
-35150,
-34462,
-33987,
-33629,
-33141,
-32297,
-31113,
-29783,
-28589,
-27705,
-27267,
-27219,
-27427,
-27671,
-27855,
-28017,
-28277,
-28620,
-28972,
-29227,
-29418,
-29582,
-29697,
-29641,
-29277,
-28706,
-28204,
-28207,
-28910,
-30142,
-31419,
-32376,
-32993,
-33517,
-34066,
-34491,
-34627,
-34614,
-34743,
-35151,
-35551,
-35625,
-35290,
-34793,
-34403,
-34311,
-34695,
-35716,
-37241,
-38778,
-39797,
-40243,
-40461,
-40710,
-40719,
-40088,
-38807,
-37366,
-36169,
-35145,
-33941,
-32467,
-31009,
-29869,
-29103,
-28591,
-28278,
-28159,
-28164,
-28164,
-28143,
-28145,
-28140,
-28023,
-27840,
-27871,
-28294,
-28896,
-29223,
-29130,
-28906,
-28867,
-28960,
-28892,
-28687,
-28651,
-28967,
-29379,
-29502,
-29342,
-29188,
-29246,
-29412,
-29603,
-29958,
-30572,
-31197,
-31451,
-31332,
-31305,
-31791,
-32811,
-34238,
-36243,
-39197,
-43036,
-47077,
-50462,
-52758,
-53965,
-54089,
-53080,
-51056,
-48483,
-45755,
-42876,
-39612,
-35943,
-32217,
-28858,
-25991,
-23684,
-21953,
-20952,
-20577,
-20629,
-20867,
-21191,
-21440,
-21488,
-21338,
-21196,
-21190,
-21094,
-20632,
-19915,
-19511,
-19857,
-20820,
-22005,
-23354,
-25247,
-27855,
-30737,
-33237,
-35148,
-36890,
-38829,
-40899,
-42698,
-44069,
-45106,
-45931,
-46445,
-46561,
-46351,
-45977,
-45447,
-44667,
-43685,
-42727,
-42049,
-41659,
-41373,
-40961,
-40184,
-38906,
-37116,
-35071,
-33116,
-31410,
-29883,
-28442,
-27232,
-26444,
-25997,
-25467,
-24544,
-23358,
-22352,
-21796,
-21547,
-21352,
-21187,
-21264,
-21724,
-22454,
-23299,
-24261,
-25427,
-26724,
-27850,
-28532,
-28845,
-29115,
-29646,
-30451,
-31383,
-32350,
-33391,
-34579,
-35853,
-37131,
-38406,
-39741,
-41172,
-42567,
-43776,
-44714,
-45345,
-45630,
-45437,
-44800,
-43916,
-43030,
-42258,
-41439,
-40439,
-39234,
-37902,
-36493,
-34966,
-33330,
-31667,
-30045,
-28489,
-27023,
-25788,
-24897,
-24289,
-23723,
-23063,
-22454,
-22162,
-22293,
-22696,
-23241,
-23977,
-25049,
-26393,
-27733,
-28796,
-29556,
-30220,
-30994,
-31962,
-33065,
-34156,
-35066,
-35718,
-36153,
-36511,
-36843,
-37078,
-37140,
-37052,
-36917,
-36727,
-36393,
-35849,
-35149,
-34326,
-33335,
-32183,
-31099,
-30482,
-30423,
-30673,
-30860,
-31041,
-31564,
-32668,
-34083,
-35408,
-36540,
-37758,
-39211,
-40599,
-41393,
-41375,
-40758,
-39864,
-38783,
-37407,
-35770,
-34091,
-32595,
-31289,
-30038,
-28762,
-27600,
-26724,
-26260,
-26137,
-26202,
-26289,
-26350,
-26466,
-26751,
-27209,
-27628,
-27797,
-27707,
-27599,
-27762,
-28180,
-28590,
-28789,
-28818,
-28963,
-29336,
-29826,
-30327,
-30937,
-31932,
-33320,
-34783,
-35974,
-36901,
-37862,
-38976,
-39970,
-40526,
-40740,
-41051,
-41706,
-42430,
-42765,
-42609,
-42206,
-41711,
-40923,
-39623,
-37995,
-36482,
-35298,
-34213,
-32969,
-31599,
-30320,
-29129,
-27819,
-26445,
-25360,
-24883,
-24740,
-24458,
-23899,
-23489,
-23616,
-24083,
-24421,
-24534,
-24837,
-25714,
-26929,
-27984,
-28714,
-29473,
-30591,
-31928,
-33130,
-34146,
-35268,
-36636,
-37899,
-38560,
-38528,
-38273,
-38248,
-38490,
-38609,
-38310,
-37683,
-37071,
-36732,
-36630,
-36571,
-36403,
-36152,
-35938,
-35778,
-35566,
-35121,
-34436,
-33691,
-33112,
-32746,
-32465,
-32099,
-31629,
-31128,
-30657,
-30201,
-29793,
-29503,
-29413,
-29453,
-29448,
-29281,
-28934,
-28506,
-28040,
-27548,
-27055,
-26633,
-26397,
-26440,
-26825,
-27567,
-28608,
-29766,
-30871,
-31857,
-32867,
-34125,
-35716,
-37520,
-39256,
-40720,
-41818,
-42512,
-42734,
-42383,
-41504,
-40311,
-39106,
-38049,
-37027,
-35842,
-34379,
-32804,
-31358,
-30173,
-29177,
-28324,
-27719,
-27650,
-28107,
-28783,
-29142,
-29049,
-28844,
-29035,
-29761,
-30673,
-31363,
-31747,
-31994,
-32212,
-32273,
-32139,
-31995,
-32060,
-32241,
-32192,
-31793,
-31366,
-31288,
-31535,
-31675,
-31492,
-31221,
-31206,
-31343,
-31176,
-30505,
-29705,
-29360,
-29603,
-30084,
-30395,
-30450,
-30433,
-30463,
-30643,
-31053,
-31823,
-32955,
-34413,
-36255,
-38560,
-41137,
-43471,
-45042,
-45814,
-46071,
-45911,
-45104,
-43413,
-41128,
-38761,
-36571,
-34343,
-31947,
-29658,
-27992,
-27074,
-26602,
-26271,
-26131,
-26350,
-26884,
-27427,
-27795,
-28029,
-28253,
-28418,
-28406,
-28157,
-27654,
-26932,
-26038,
-25263,
-24872,
-24940,
-25273,
-25727,
-26451,
-27576,
-28926,
-30057,
-30744,
-31244,
-31874,
-32658,
-33351,
-33922,
-34614,
-35558,
-36464,
-36980,
-37143,
-37446,
-38223,
-39375,
-40631,
-41941,
-43490,
-45192,
-46630,
-47335,
-47247,
-46569,
-45492,
-43992,
-42091,
-39956,
-37816,
-35677,
-33434,
-31021,
-28627,
-26506,
-24864,
-23707,
-22938,
-22413,
-22020,
-21780,
-21763,
-21949,
-22185,
-22294,
-22291,
-22385,
-22651,
-22960,
-23074,
-23004,
-23036,
-23454,
-24305,
-25450,
-26793,
-28324,
-30037,
-31847,
-33701,
-35633,
-37656,
-39696,
-41611,
-43366,
-45004,
-46479,
-47615,
-48259,
-48492,
-48465,
-48265,
-47689,
-46643,
-45152,
-43463,
-41699,
-39892,
-38081,
-36375,
-34819,
-33300,
-31635,
-29856,
-28122,
-26585,
-25150,
-23728,
-22375,
-21346,
-20742,
-20454,
-20264,
-20161,
-20309,
-20838,
-21698,
-22720,
-23863,
-25165,
-26672,
-28269,
-29780,
-31099,
-32244,
-33265,
-34147,
-34835,
-35299,
-35630,
-35961,
-36336,
-36661,
-36829,
-36852,
-36956,
-37304,
-37804,
-38123,
-37989,
-37467,
-36833,
-36259,
-35607,
-34706,
-33691,
-33049,
-33228,
-34216,
-35552,
-36746,
-37594,
-38221,
-38715,
-39030,
-39052,
-38820,
-38504,
-38140,
-37497,
-36264,
-34361,
-32144,
-30102,
-28499,
-27240,
-26090,
-24988,
-24061,
-23444,
-23123,
-23065,
-23294,
-23895,
-24804,
-25801,
-26700,
-27477,
-28235,
-28986,
-29641,
-30190,
-30770,
-31500,
-32240,
-32654,
-32567,
-32192,
-31982,
-32227,
-32941,
-33962,
-35236,
-36732,
-38328,
-39725,
-40636,
-40967,
-40900,
-40716,
-40706,
-40999,
-41522,
-42047,
-42236,
-41911,
-41046,
-39815,
-38395,
-36961,
-35579,
-34281,
-32985,
-31598,
-30068,
-28420,
-26747,
-25152,
-23753,
-22694,
-22045,
-21766,
-21698,
-21738,
-21901,
-22286,
-22918,
-23752,
-24734,
-25879,
-27182,
-28594,
-30019,
-31428,
-32838,
-34232,
-35490,
-36555,
-37461,
-38353,
-39313,
-40231,
-40928,
-41238,
-41134,
-40712,
-40121,
-39528,
-39039,
-38723,
-38594,
-38625,
-38659,
-38492,
-37956,
-37140,
-36266,
-35398,
-34398,
-33052,
-31576,
-30403,
-29820,
-29554,
-29110,
-28342,
-27545,
-27056,
-26771,
-26341,
-25697,
-25138,
-24953,
-25050,
-25124,
-25089,
-25135,
-25386,
-25687,
-25824,
-25871,
-26129,
-26859,
-28060,
-29617,
-31379,
-33166,
-34756,
-36125,
-37510,
-39150,
-40913,
-42368,
-43344,
-44168,
-45214,
-46239,
-46482,
-45495,
-43749,
-42179,
-41185,
-40365,
-39061,
-37198,
-35225,
-33491,
-31915,
-30197,
-28331,
-26599,
-25279,
-24381,
-23755,
-23286,
-22980,
-22881,
-23067,
-23617,
-24569,
-25810,
-27114,
-28263,
-29175,
-29887,
-30444,
-30849,
-31125,
-31306,
-31492,
-31733,
-32073,
-32502,
-33016,
-33591,
-34217,
-34841,
-35422,
-35860,
-36143,
-36217,
-36093,
-35759,
-35271,
-34727,
-34175,
-33547,
-32754,
-31900,
-31324,
-31413,
-32203,
-33359,
-34430,
-35208,
-35828,
-36540,
-37455,
-38485,
-39407,
-40020,
-40227,
-40015,
-39394,
-38275,
-36596,
-34479,
-32392,
-30825,
-29972,
-29526,
-29101,
-28579,
-28198,
-28136,
-28314,
-28512,
-28692,
-28963,
-29372,
-29723,
-29838,
-29707,
-29446,
-29101,
-28589,
-27942,
-27367,
-27014,
-26867,
-26718,
-26594,
-26672,
-27126,
-27885,
-28724,
-29569,
-30407,
-31198,
-31772,
-32111,
-32498,
-33282,
-34529,
-35929,
-37181,
-38296,
-39491,
-40830,
-42111,
-43138,
-43979,
-44891,
-45958,
-46931,
-47403,
-47100,
-46051,
-44467,
-42575,
-40494,
-38207,
-35652,
-32911,
-30228,
-27925,
-26105,
-24576,
-23112,
-21732,
-20766,
-20443,
-20662,
-20999,
-21195,
-21339,
-21684,
-22295,
-22938,
-23381,
-23681,
-24100,
-24829,
-25749,
-26649,
-27424,
-28260,
-29339,
-30723,
-32279,
-33839,
-35372,
-36881,
-38353,
-39691,
-40779,
-41606,
-42250,
-42825,
-43328,
-43685,
-43790,
-43681,
-43444,
-43140,
-42679,
-41945,
-41017,
-40137,
-39527,
-39088,
-38501,
-37506,
-36176,
-34710,
-33221,
-31602,
-29821,
-28047,
-26568,
-25456,
-24580,
-23773,
-23038,
-22477,
-22094,
-21835,
-21750,
-21999,
-22684,
-23706,
-24823,
-25917,
-26959,
-27959,
-28870,
-29734,
-30671,
-31768,
-32870,
-33759,
-34373,
-34879,
-35329,
-35584,
-35394,
-34929,
-34618,
-34836,
-35470,
-36109,
-36442,
-36468,
-36299,
-36061,
-35825,
-35785,
-36042,
-36558,
-37177,
-37867,
-38717,
-39666,
-40434,
-40765,
-40829,
-41014,
-41466,
-41723,
-41203,
-39762,
-37816,
-35796,
-33721,
-31356,
-28725,
-26253,
-24355,
-23090,
-22183,
-21464,
-21007,
-20971,
-21362,
-22030,
-22887,
-23909,
-25109,
-26347,
-27464,
-28329,
-28901,
-29188,
-29243,
-29191,
-29197,
-29364,
-29637,
-29996,
-30504,
-31391,
-32775,
-34551,
-36394,
-38033,
-39397,
-40608,
-41765,
-42912,
-43934,
-44814,
-45513,
-46061,
-46355,
-46235,
-45500,
-44136,
-42311,
-40326,
-38391,
-36562,
-34797,
-33146,
-31692,
-30443,
-29212,
-27817,
-26269,
-24857,
-23784,
-23032,
-22346,
-21652,
-21110,
-20933,
-21100,
-21358,
-21584,
-21915,
-22612,
-23733,
-25119,
-26612,
-28181,
-29858,
-31522,
-33038,
-34369,
-35642,
-36880,
-37916,
-38540,
-38787,
-38909,
-39068,
-39182,
-39060,
-38731,
-38440,
-38371,
-38491,
-38617,
-38638,
-38553,
-38358,
-38028,
-37607,
-37218,
-36912,
-36609,
-36222,
-35808,
-35475,
-35166,
-34614,
-33720,
-32700,
-31907,
-31354,
-30738,
-29795,
-28647,
-27589,
-26690,
-25826,
-24966,
-24348,
-24109,
-24038,
-23823,
-23537,
-23586,
-24246,
-25214,
-26138,
-27060,
-28398,
-30286,
-32254,
-33814,
-35033,
-36408,
-38111,
-39715,
-40717,
-41176,
-41458,
-41707,
-41590,
-40923,
-39974,
-39149,
-38395,
-37258,
-35582,
-33743,
-32297,
-31288,
-30406,
-29458,
-28642,
-28164,
-27969,
-27871,
-27929,
-28278,
-28832,
-29198,
-29158,
-28941,
-28953,
-29301,
-29841,
-30543,
-31648,
-33225,
-34901,
-36108,
-36682,
-36915,
-37122,
-37260,
-37160,
-36885,
-36650,
-36497,
-36159,
-35464,
-34582,
-33829,
-33259,
-32691,
-32043,
-31495,
-31202,
-31033,
-30742,
-30337,
-30047,
-29990,
-29898,
-29465,
-28711,
-28001,
-27648,
-27657,
-27857,
-28200,
-28749,
-29518,
-30346,
-31081,
-31672,
-32222,
-32788,
-33366,
-33891,
-34331,
-34681,
-35000,
-35332,
-35721,
-36144,
-36597,
-37076,
-37592,
-38027,
-38297,
-38380,
-38395,
-38428,
-38340,
-37987,
-37360,
-36650,
-35955,
-35136,
-34045,
-32831,
-31795,
-31061,
-30398,
-29583,
-28769,
-28219,
-27964,
-27616,
-26982,
-26278,
-25897,
-25838,
-25700,
-25254,
-24744,
-24567,
-24765,
-25046,
-25322,
-25819,
-26808,
-28168,
-29621,
-31108,
-32781,
-34618,
-36272,
-37527,
-38594,
-39899,
-41397,
-42572,
-43012,
-42942,
-42904,
-43081,
-43092,
-42597,
-41713,
-40907,
-40350,
-39776,
-38845,
-37530,
-36064,
-34675,
-33412,
-32328,
-31430,
-30657,
-29804,
-28820,
-27886,
-27259,
-26944,
-26630,
-26088,
-25360,
-24672,
-24031,
-23250,
-22167,
-21009,
-20172,
-19912,
-20182,
-20755,
-21549,
-22632,
-24098,
-25903,
-27834,
-29667,
-31302,
-32864,
-34555,
-36471,
-38453,
-40234,
-41740,
-43109,
-44545,
-45984,
-47121,
-47744,
-47889,
-47790,
-47555,
-47109,
-46348,
-45299,
-44030,
-42479,
-40510,
-38110,
-35566,
-33319,
-31616,
-30420,
-29468,
-28567,
-27641,
-26697,
-25695,
-24591,
-23447,
-22392,
-21590,
-21008,
-20545,
-20070,
-19629,
-19312,
-19187,
-19272,
-19647,
-20461,
-21774,
-23418,
-25100,
-26672,
-28275,
-30049,
-31986,
-33842,
-35576,
-37327,
-39300,
-41373,
-43176,
-44446,
-45233,
-45809,
-46335,
-46727,
-46802,
-46463,
-45767,
-44854,
-43826,
-42685,
-41359,
-39827,
-38237,
-36832,
-35707,
-34697,
-33543,
-32167,
-30740,
-29417,
-28202,
-27004,
-25914,
-25061,
-24492,
-24015,
-23534,
-23156,
-23078,
-23275,
-23574,
-23874,
-24332,
-25049,
-25916,
-26761,
-27575,
-28557,
-29644,
-30558,
-31056,
-31310,
-31690,
-32308,
-32967,
-33496,
-34065,
-34838,
-35696,
-36250,
-36380,
-36330,
-36400,
-36544,
-36608,
-36616,
-36888,
-37535,
-38295,
-38789,
-38926,
-38902,
-38892,
-38899,
-38900,
-38953,
-39016,
-38839,
-38194,
-37167,
-36113,
-35225,
-34340,
-33256,
-32020,
-30940,
-30093,
-29317,
-28459,
-27644,
-27076,
-26690,
-26184,
-25444,
-24709,
-24299,
-24275,
-24446,
-24763,
-25323,
-26178,
-27055,
-27701,
-28164,
-28789,
-29790,
-30953,
-31978,
-32746,
-33438,
-34144,
-34764,
-35187,
-35504,
-35898,
-36403,
-36855,
-37191,
-37530,
-38044,
-38678,
-39264,
-39708,
-40076,
-40375,
-40446,
-40159,
-39619,
-39092,
-38707,
-38289,
-37611,
-36559,
-35234,
-33735,
-32171,
-30672,
-29362,
-28207,
-27053,
-25812,
-24683,
-23901,
-23521,
-23331,
-23221,
-23335,
-23901,
-24858,
-25909,
-26769,
-27493,
-28256,
-29143,
-30085,
-31023,
-32005,
-33086,
-34248,
-35423,
-36577,
-37679,
-38626,
-39313,
-39680,
-39794,
-39714,
-39500,
-39226,
-38938,
-38614,
-38148,
-37508,
-36869,
-36407,
-36054,
-35548,
-34774,
-33987,
-33590,
-33625,
-33759,
-33623,
-33138,
-32462,
-31628,
-30596,
-29407,
-28333,
-27590,
-27118,
-26646,
-26037,
-25427,
-25076,
-25156,
-25671,
-26545,
-27608,
-28613,
-29344,
-29739,
-29899,
-29936,
-29863,
-29738,
-29710,
-29968,
-30520,
-31138,
-31681,
-32261,
-33250,
-34848,
-36870,
-38862,
-40480,
-41745,
-42868,
-43909,
-44662,
-44809,
-44334,
-43457,
-42478,
-41357,
-39893,
-37961,
-35734,
-33552,
-31574,
-29804,
-28214,
-26949,
-26165,
-25853,
-25782,
-25740,
-25660,
-25645,
-25762,
-26003,
-26333,
-26739,
-27274,
-27945,
-28729,
-29548,
-30314,
-31022,
-31677,
-32333,
-32941,
-33399,
-33634,
-33641,
-33516,
-33323,
-33103,
-32906,
-32834,
-32961,
-33250,
-33521,
-33605,
-33423,
-33066,
-32639,
-32222,
-31819,
-31407,
-31038,
-30713,
-30449,
-30161,
-29902,
-29867,
-30385,
-31641,
-33591,
-36004,
-38670,
-41342,
-43671,
-45194,
-45658,
-45198,
-44157,
-42751,
-40964,
-38819,
-36577,
-34489,
-32552,
-30539,
-28535,
-26968,
-26256,
-26316,
-26655,
-26986,
-27366,
-27899,
-28354,
-28358,
-27900,
-27374,
-27137,
-27130,
-27064,
-26827,
-26547,
-26347,
-26201,
-26122,
-26287,
-26865,
-27803,
-28894,
-30068,
-31366,
-32665,
-33579,
-33789,
-33430,
-33018,
-32940,
-33213,
-33660,
-34266,
-35149,
-36377,
-37773,
-39201,
-40553,
-41807,
-42851,
-43573,
-44002,
-44238,
-44311,
-44123,
-43588,
-42731,
-41577,
-40060,
-38099,
-35845,
-33608,
-31679,
-30052,
-28600,
-27270,
-26155,
-25302,
-24617,
-24007,
-23500,
-23257,
-23326,
-23585,
-23877,
-24067,
-24149,
-24077,
-23917,
-23807,
-23930,
-24301,
-24777,
-25232,
-25787,
-26694,
-28033,
-29609,
-31127,
-32509,
-33910,
-35432,
-36998,
-38426,
-39694,
-40912,
-42122,
-43235,
-44111,
-44817,
-45458,
-46024,
-46272,
-46013,
-45282,
-44307,
-43205,
-41934,
-40462,
-38904,
-37408,
-35946,
-34357,
-32584,
-30799,
-29181,
-27702,
-26237,
-24774,
-23548,
-22709,
-22156,
-21661,
-21190,
-20975,
-21231,
-21852,
-22578,
-23226,
-23959,
-24942,
-26241,
-27621,
-28886,
-29927,
-30778,
-31459,
-31966,
-32267,
-32443,
-32624,
-33004,
-33655,
-34581,
-35609,
-36603,
-37407,
-38016,
-38518,
-39092,
-39874,
-40811,
-41691,
-42296,
-42584,
-42615,
-42439,
-41969,
-41201,
-40278,
-39405,
-38593,
-37680,
-36575,
-35411,
-34382,
-33435,
-32361,
-31074,
-29774,
-28673,
-27661,
-26483,
-25090,
-23836,
-23075,
-22830,
-22804,
-22838,
-23047,
-23566,
-24327,
-25073,
-25744,
-26455,
-27355,
-28384,
-29435,
-30482,
-31533,
-32483,
-33092,
-33284,
-33262,
-33331,
-33626,
-34008,
-34327,
-34555,
-34782,
-35072,
-35454,
-36028,
-36880,
-37998,
-39212,
-40351,
-41418,
-42405,
-43199,
-43534,
-43323,
-42822,
-42354,
-41934,
-41199,
-39827,
-37957,
-36033,
-34325,
-32641,
-30691,
-28555,
-26707,
-25540,
-24921,
-24441,
-23819,
-23217,
-22851,
-22759,
-22765,
-22809,
-23035,
-23596,
-24409,
-25261,
-26004,
-26678,
-27404,
-28238,
-29217,
-30385,
-31737,
-33179,
-34537,
-35758,
-36873,
-37918,
-38786,
-39356,
-39638,
-39741,
-39739,
-39547,
-39099,
-38469,
-37842,
-37297,
-36822,
-36384,
-36112,
-36065,
-36116,
-35992,
-35584,
-35062,
-34642,
-34338,
-33959,
-33463,
-32977,
-32658,
-32326,
-31672,
-30567,
-29255,
-28102,
-27253,
-26644,
-26229,
-26142,
-26471,
-27075,
-27627,
-27950,
-28139,
-28430,
-28944,
-29603,
-30330,
-31121,
-32034,
-33056,
-34061,
-34917,
-35562,
-36055,
-36508,
-37003,
-37536,
-37996,
-38260,
-38264,
-38025,
-37578,
-36960,
-36176,
-35280,
-34271,
-33169,
-31969,
-30789,
-29768,
-28987,
-28357,
-27762,
-27195,
-26790,
-26621,
-26620,
-26607,
-26554,
-26598,
-26994,
-27918,
-29421,
-31388,
-33505,
-35353,
-36632,
-37391,
-37980,
-38652,
-39356,
-39816,
-39956,
-39994,
-40106,
-40155,
-39748,
-38732,
-37443,
-36363,
-35662,
-35080,
-34258,
-33145,
-31890,
-30635,
-29366,
-28140,
-27118,
-26446,
-26018,
-25634,
-25246,
-25095,
-25377,
-26013,
-26716,
-27326,
-27942,
-28684,
-29500,
-30225,
-30830,
-31455,
-32151,
-32783,
-33170,
-33307,
-33381,
-33473,
-33552,
-33563,
-33605,
-33814,
-34161,
-34532,
-34953,
-35599,
-36627,
-37826,
-38835,
-39445,
-39805,
-40160,
-40565,
-40839,
-40837,
-40564,
-40154,
-39603,
-38805,
-37639,
-36113,
-34405,
-32759,
-31388,
-30319,
-29437,
-28523,
-27468,
-26267,
-24992,
-23702,
-22507,
-21550,
-20932,
-20570,
-20282,
-20016,
-19965,
-20328,
-21059,
-21874,
-22701,
-23823,
-25691,
-28336,
-31321,
-34059,
-36415,
-38676,
-41166,
-43821,
-46181,
-47794,
-48522,
-48628,
-48439,
-48142,
-47597,
-46599,
-45119,
-43389,
-41779,
-40393,
-39109,
-37705,
-36205,
-34816,
-33713,
-32788,
-31828,
-30700,
-29504,
-28378,
-27324,
-26274,
-25206,
-24248,
-23498,
-22906,
-22333,
-21767,
-21339,
-21220,
-21338,
-21492,
-21586,
-21769,
-22320,
-23292,
-24464,
-25549,
-26467,
-27365,
-28405,
-29564,
-30720,
-31757,
-32694,
-33624,
-34649,
-35841,
-37170,
-38504,
-39718,
-40757,
-41731,
-42681,
-43579,
-44332,
-45029,
-45880,
-47005,
-48234,
-49167,
-49473,
-49015,
-47834,
-46022,
-43732,
-41132,
-38420,
-35699,
-33066,
-30610,
-28371,
-26264,
-24177,
-22170,
-20550,
-19577,
-19209,
-19152,
-19176,
-19296,
-19584,
-19926,
-20155,
-20238,
-20337,
-20561,
-20808,
-20988,
-21138,
-21476,
-22111,
-23157,
-24716,
-26840,
-29211,
-31260,
-32710,
-33959,
-35754,
-38334,
-41233,
-43873,
-46225,
-48657,
-51159,
-53225,
-54330,
-54594,
-54464,
-54111,
-53278,
-51748,
-49706,
-47456,
-44992,
-42171,
-39075,
-36134,
-33567,
-31165,
-28593,
-25916,
-23503,
-21551,
-19865,
-18285,
-16999,
-16297,
-16136,
-16123,
-16090,
-16277,
-16988,
-18071,
-19074,
-19847,
-20698,
-22027,
-23729,
-25359,
-26627,
-27740,
-29061,
-30758,
-32667,
-34567,
-36357,
-37969,
-39319,
-40296,
-40930,
-41334,
-41662,
-41949,
-42175,
-42297,
-42391,
-42624,
-43167,
-43980,
-44800,
-45333,
-45526,
-45566,
-45580,
-45425,
-44850,
-43829,
-42610,
-41353,
-39869,
-37801,
-35063,
-31978,
-28919,
-26036,
-23264,
-20679,
-18522,
-17024,
-16140,
-15737,
-15683,
-15990,
-16621,
-17535,
-18708,
-20121,
-21630,
-23016,
-24173,
-25318,
-26661,
-28147,
-29403,
-30230,
-30858,
-31684,
-32849,
-34146,
-35412,
-36778,
-38393,
-40166,
-41798,
-43187,
-44482,
-45750,
-46812,
-47420,
-47671,
-47883,
-48132,
-48167,
-47683,
-46743,
-45579,
-44187,
-42317,
-39855,
-37101,
-34444,
-31990,
-29598,
-27286,
-25321,
-23855,
-22642,
-21325,
-19956,
-18960,
-18635,
-18788,
-18974,
-19118,
-19482,
-20298,
-21364,
-22319,
-23073,
-23878,
-24976,
-26289,
-27589,
-28851,
-30288,
-32050,
-34001,
-35816,
-37330,
-38669,
-39952,
-41122,
-41915,
-42225,
-42225,
-42203,
-42243,
-42207,
-41957,
-41567,
-41226,
-40997,
-40782,
-40476,
-40096,
-39669,
-39110,
-38343,
-37377,
-36365,
-35291,
-34015,
-32470,
-30889,
-29579,
-28518,
-27372,
-25873,
-24223,
-22884,
-22106,
-21794,
-21726,
-21821,
-22046,
-22293,
-22460,
-22649,
-23086,
-23835,
-24755,
-25782,
-27051,
-28665,
-30399,
-31813,
-32883,
-33977,
-35553,
-37554,
-39649,
-41672,
-43663,
-45594,
-47009,
-47555,
-47300,
-46629,
-45754,
-44496,
-42800,
-40913,
-39159,
-37440,
-35448,
-33194,
-31183,
-29788,
-28811,
-27759,
-26541,
-25586,
-25263,
-25339,
-25398,
-25321,
-25434,
-25974,
-26716,
-27331,
-27718,
-28066,
-28467,
-28847,
-29141,
-29449,
-29850,
-30270,
-30586,
-30864,
-31236,
-31649,
-31917,
-32002,
-32211,
-32797,
-33613,
-34228,
-34509,
-34718,
-35115,
-35513,
-35499,
-35095,
-34763,
-34930,
-35376,
-35584,
-35352,
-35019,
-35014,
-35329,
-35720,
-36065,
-36519,
-37115,
-37583,
-37597,
-37170,
-36537,
-35843,
-34931,
-33701,
-32330,
-31172,
-30306,
-29535,
-28675,
-27867,
-27425,
-27439,
-27746,
-28155,
-28660,
-29339,
-30097,
-30770,
-31311,
-31903,
-32673,
-33531,
-34208,
-34623,
-34862,
-35042,
-35053,
-34767,
-34204,
-33578,
-32985,
-32334,
-31510,
-30630,
-29961,
-29606,
-29339,
-28911,
-28288,
-27677,
-27207,
-26782,
-26268,
-25745,
-25470,
-25594,
-26103,
-26845,
-27833,
-29114,
-30772,
-32819,
-35350,
-38435,
-42016,
-45747,
-49163,
-51834,
-53436,
-53727,
-52606,
-50314,
-47355,
-44211,
-40996,
-37621,
-34122,
-30874,
-28217,
-26233,
-24733,
-23698,
-23289,
-23528,
-24074,
-24414,
-24367,
-24127,
-23862,
-23504,
-22888,
-22184,
-21763,
-21788,
-22056,
-22355,
-22884,
-24047,
-25941,
-28086,
-29968,
-31479,
-32943,
-34518,
-36048,
-37227,
-38117,
-38938,
-39801,
-40458,
-40691,
-40518,
-40263,
-40106,
-40137,
-40267,
-40534,
-40846,
-41025,
-40877,
-40432,
-39917,
-39521,
-39196,
-38767,
-38129,
-37267,
-36183,
-34801,
-33147,
-31396,
-29782,
-28447,
-27339,
-26373,
-25501,
-24701,
-23986,
-23437,
-23176,
-23324,
-23810,
-24511,
-25349,
-26371,
-27523,
-28607,
-29398,
-29955,
-30542,
-31361,
-32218,
-32787,
-32878,
-32665,
-32397,
-32218,
-32148,
-32278,
-32703,
-33428,
-34277,
-35100,
-35864,
-36562,
-37120,
-37461,
-37756,
-38260,
-39041,
-39800,
-40198,
-40296,
-40398,
-40616,
-40613,
-39970,
-38809,
-37596,
-36688,
-35851,
-34671,
-33080,
-31427,
-30050,
-28934,
-27890,
-26854,
-25946,
-25208,
-24604,
-24145,
-23971,
-24141,
-24498,
-24832,
-25178,
-25768,
-26663,
-27635,
-28379,
-28927,
-29531,
-30355,
-31278,
-32112,
-32912,
-33854,
-35047,
-36370,
-37658,
-38837,
-39859,
-40654,
-41116,
-41235,
-41120,
-40887,
-40647,
-40424,
-40173,
-39721,
-38949,
-37904,
-36854,
-35941,
-35080,
-34026,
-32771,
-31542,
-30513,
-29591,
-28632,
-27676,
-26957,
-26483,
-26024,
-25446,
-24939,
-24839,
-25112,
-25438,
-25630,
-25922,
-26608,
-27630,
-28595,
-29314,
-29940,
-30681,
-31454,
-32028,
-32408,
-32849,
-33469,
-34115,
-34587,
-34927,
-35306,
-35678,
-35832,
-35756,
-35746,
-36099,
-36728,
-37303,
-37659,
-37981,
-38424,
-38910,
-39141,
-38982,
-38509,
-37848,
-37068,
-36247,
-35502,
-34899,
-34363,
-33786,
-33223,
-32729,
-32248,
-31575,
-30679,
-29813,
-29270,
-29044,
-28862,
-28528,
-28122,
-27811,
-27672,
-27681,
-27873,
-28340,
-28983,
-29583,
-30043,
-30463,
-31028,
-31665,
-32214,
-32646,
-33096,
-33589,
-33806,
-33532,
-32849,
-32213,
-31845,
-31597,
-31212,
-30682,
-30217,
-29869,
-29519,
-29102,
-28782,
-28692,
-28683,
-28475,
-28041,
-27707,
-27737,
-28109,
-28643,
-29378,
-30609,
-32517,
-35019,
-37869,
-40934,
-44086,
-47108,
-49657,
-51587,
-52853,
-53397,
-52921,
-51252,
-48573,
-45347,
-41905,
-38242,
-34399,
-30717,
-27694,
-25486,
-23801,
-22362,
-21212,
-20610,
-20490,
-20467,
-20238,
-19977,
-20021,
-20396,
-20648,
-20431,
-19888,
-19598,
-19935,
-20858,
-22095,
-23605,
-25491,
-27795,
-30221,
-32502,
-34524,
-36421,
-38188,
-39684,
-40743,
-41429,
-41925,
-42301,
-42515,
-42487,
-42314,
-42037,
-41615,
-40961,
-40204,
-39608,
-39308,
-39124,
-38786,
-38279,
-37841,
-37643,
-37638,
-37634,
-37625,
-37653,
-37672,
-37505,
-37018,
-36237,
-35152,
-33635,
-31679,
-29543,
-27643,
-26031,
-24409,
-22551,
-20749,
-19508,
-19037,
-19047,
-19325,
-19983,
-21282,
-23055,
-24842,
-26339,
-27675,
-29040,
-30329,
-31340,
-32105,
-32907,
-33790,
-34471,
-34743,
-34819,
-35088,
-35566,
-35943,
-36066,
-36233,
-36791,
-37675,
-38515,
-39123,
-39612,
-40042,
-40254,
-40163,
-40028,
-40176,
-40500,
-40524,
-40008,
-39247,
-38635,
-38103,
-37251,
-35966,
-34617,
-33576,
-32746,
-31737,
-30467,
-29195,
-28188,
-27340,
-26415,
-25386,
-24401,
-23554,
-22821,
-22228,
-21991,
-22227,
-22884,
-23815,
-25027,
-26616,
-28538,
-30568,
-32543,
-34439,
-36237,
-37730,
-38692,
-39158,
-39403,
-39572,
-39516,
-39009,
-38112,
-37146,
-36312,
-35569,
-34741,
-33934,
-33384,
-33261,
-33476,
-33757,
-33964,
-34027,
-34003,
-33896,
-33712,
-33476,
-33174,
-32907,
-32780,
-32902,
-33244,
-33554,
-33597,
-33269,
-32741,
-32201,
-31759,
-31301,
-30721,
-30053,
-29480,
-29176,
-29090,
-28961,
-28556,
-27875,
-27139,
-26569,
-26222,
-26066,
-26175,
-26666,
-27579,
-28663,
-29663,
-30532,
-31529,
-32959,
-34815,
-36837,
-38741,
-40492,
-42231,
-43958,
-45411,
-46143,
-45908,
-44870,
-43406,
-41897,
-40317,
-38496,
-36296,
-33913,
-31741,
-30074,
-28935,
-28105,
-27398,
-26790,
-26364,
-26228,
-26327,
-26592,
-26924,
-27303,
-27694,
-28032,
-28269,
-28410,
-28537,
-28686,
-28828,
-28903,
-28951,
-29094,
-29419,
-29901,
-30456,
-31039,
-31659,
-32277,
-32816,
-33227,
-33514,
-33617,
-33413,
-32792,
-31888,
-30956,
-30150,
-29457,
-28876,
-28642,
-29028,
-30019,
-31286,
-32556,
-33915,
-35698,
-38047,
-40910,
-44096,
-47481,
-50704,
-53175,
-54297,
-53876,
-52076,
-49112,
-45145,
-40580,
-36125,
-32394,
-29388,
-26658,
-24009,
-21811,
-20551,
-20166,
-20162,
-20253,
-20624,
-21449,
-22373,
-22703,
-22189,
-21235,
-20428,
-19978,
-19699,
-19526,
-19685,
-20483,
-22022,
-24173,
-26727,
-29448,
-32073,
-34481,
-36673,
-38767,
-40649,
-42220,
-43477,
-44728,
-46062,
-47219,
-47726,
-47519,
-47017,
-46589,
-46124,
-45160,
-43534,
-41594,
-39829,
-38415,
-37210,
-36044,
-34899,
-33705,
-32377,
-30897,
-29463,
-28282,
-27317,
-26432,
-25625,
-25094,
-24927,
-24845,
-24522,
-23979,
-23652,
-23933,
-24762,
-25755,
-26636,
-27440,
-28264,
-29062,
-29676,
-30165,
-30796,
-31721,
-32717,
-33316,
-33273,
-32801,
-32371,
-32249,
-32371,
-32528,
-32689,
-32971,
-33436,
-33936,
-34326,
-34633,
-35052,
-35665,
-36370,
-36966,
-37441,
-37837,
-38168,
-38306,
-38161,
-37840,
-37495,
-37228,
-36983,
-36693,
-36375,
-35996,
-35538,
-34970,
-34376,
-33842,
-33299,
-32657,
-31896,
-31212,
-30741,
-30399,
-30006,
-29518,
-29126,
-28952,
-28910,
-28760,
-28467,
-28183,
-28115,
-28312,
-28703,
-29237,
-29834,
-30383,
-30782,
-31012,
-31164,
-31228,
-31168,
-30995,
-30927,
-31120,
-31459,
-31582,
-31290,
-30768,
-30395,
-30337,
-30467,
-30703,
-31202,
-32272,
-33871,
-35640,
-37143,
-38300,
-39318,
-40330,
-41159,
-41528,
-41358,
-40913,
-40460,
-40015,
-39335,
-38260,
-36843,
-35307,
-33744,
-32196,
-30710,
-29465,
-28540,
-27826,
-27129,
-26381,
-25708,
-25207,
-24896,
-24778,
-24907,
-25282,
-25679,
-25909,
-26100,
-26722,
-28049,
-29850,
-31625,
-33163,
-34676,
-36260,
-37625,
-38310,
-38315,
-38055,
-37886,
-37786,
-37583,
-37392,
-37395,
-37528,
-37443,
-36970,
-36370,
-35936,
-35597,
-35068,
-34343,
-33760,
-33554,
-33491,
-33245,
-32873,
-32669,
-32714,
-32654,
-32285,
-31886,
-31826,
-31992,
-31777,
-30896,
-29743,
-28925,
-28515,
-28095,
-27368,
-26581,
-26099,
-25934,
-25865,
-25864,
-26189,
-26918,
-27709,
-28180,
-28363,
-28657,
-29251,
-29904,
-30317,
-30588,
-31123,
-32177,
-33575,
-35033,
-36423,
-37879,
-39514,
-41350,
-43334,
-45370,
-47210,
-48518,
-49004,
-48630,
-47473,
-45582,
-42969,
-39828,
-36578,
-33671,
-31263,
-29255,
-27519,
-26113,
-25167,
-24727,
-24675,
-24871,
-25219,
-25634,
-25981,
-26100,
-25883,
-25333,
-24573,
-23820,
-23312,
-23199,
-23423,
-23850,
-24384,
-25113,
-26113,
-27345,
-28640,
-29960,
-31412,
-33133,
-34920,
-36417,
-37321,
-37749,
-38050,
-38401,
-38640,
-38467,
-37827,
-37018,
-36413,
-36151,
-36153,
-36341,
-36788,
-37590,
-38671,
-39832,
-40967,
-42183,
-43592,
-45047,
-46120,
-46374,
-45591,
-43806,
-41114,
-37712,
-33927,
-30208,
-26910,
-24107,
-21733,
-19808,
-18478,
-17915,
-18098,
-18971,
-20463,
-22452,
-24605,
-26462,
-27756,
-28573,
-29126,
-29475,
-29511,
-29188,
-28660,
-28062,
-27368,
-26599,
-26054,
-26203,
-27211,
-28723,
-30271,
-31761,
-33441,
-35435,
-37412,
-39013,
-40287,
-41637,
-43330,
-45170,
-46797,
-48088,
-49124,
-49892,
-50190,
-49845,
-48897,
-47426,
-45407,
-42870,
-40104,
-37501,
-35103,
-32536,
-29592,
-26626,
-24326,
-22840,
-21652,
-20196,
-18603,
-17476,
-17045,
-16907,
-16565,
-16191,
-16379,
-17433,
-18968,
-20490,
-21966,
-23757,
-26089,
-28711,
-31308,
-33745,
-36076,
-38178,
-39878,
-41138,
-42179,
-43122,
-43771,
-43860,
-43429,
-42832,
-42342,
-41878,
-41250,
-40506,
-39956,
-39698,
-39422,
-38627,
-37156,
-35342,
-33645,
-32209,
-30876,
-29517,
-28362,
-27787,
-27925,
-28490,
-29070,
-29547,
-30125,
-30974,
-31910,
-32556,
-32710,
-32532,
-32226,
-31786,
-31040,
-29969,
-28797,
-27789,
-26968,
-26279,
-25780,
-25650,
-25974,
-26556,
-27205,
-27904,
-28809,
-29969,
-31215,
-32446,
-33705,
-35102,
-36538,
-37759,
-38636,
-39273,
-39791,
-40079,
-39927,
-39336,
-38595,
-37982,
-37508,
-37006,
-36475,
-36034,
-35771,
-35464,
-34968,
-34324,
-33831,
-33547,
-33259,
-32764,
-32177,
-31817,
-31726,
-31598,
-31137,
-30414,
-29698,
-29017,
-28151,
-27044,
-26097,
-25772,
-26037,
-26377,
-26423,
-26363,
-26607,
-27163,
-27609,
-27645,
-27514,
-27682,
-28268,
-28960,
-29417,
-29635,
-29806,
-30099,
-30597,
-31509,
-32990,
-35022,
-37341,
-39752,
-42231,
-44687,
-46788,
-48144,
-48767,
-49006,
-49045,
-48598,
-47255,
-45043,
-42467,
-39926,
-37367,
-34601,
-31740,
-29254,
-27422,
-26126,
-25037,
-24039,
-23227,
-22680,
-22370,
-22267,
-22379,
-22661,
-22964,
-23212,
-23540,
-24135,
-24952,
-25794,
-26532,
-27369,
-28466,
-29713,
-30751,
-31352,
-31702,
-32142,
-32836,
-33668,
-34428,
-35028,
-35548,
-36080,
-36655,
-37132,
-37303,
-37017,
-36388,
-35785,
-35517,
-35612,
-35839,
-36050,
-36339,
-36805,
-37291,
-37420,
-37038,
-36470,
-36313,
-36905,
-38039,
-39195,
-39909,
-40065,
-39695,
-38818,
-37346,
-35290,
-32909,
-30681,
-28999,
-27930,
-27224,
-26622,
-26149,
-26012,
-26389,
-27083,
-27790,
-28297,
-28669,
-29050,
-29364,
-29396,
-28988,
-28294,
-27663,
-27369,
-27415,
-27607,
-27726,
-27693,
-27568,
-27532,
-27735,
-28233,
-28874,
-29464,
-29904,
-30376,
-31090,
-32123,
-33249,
-34270,
-35221,
-36430,
-38121,
-40172,
-42198,
-43870,
-45207,
-46349,
-47353,
-47990,
-48012,
-47322,
-46114,
-44586,
-42834,
-40707,
-38082,
-35021,
-31880,
-29113,
-26964,
-25334,
-23925,
-22629,
-21630,
-21213,
-21386,
-21789,
-22086,
-22286,
-22777,
-23781,
-25078,
-26127,
-26659,
-26920,
-27338,
-27994,
-28542,
-28696,
-28664,
-28964,
-29859,
-31071,
-32229,
-33299,
-34618,
-36287,
-37922,
-38972,
-39342,
-39433,
-39717,
-40216,
-40689,
-40927,
-40946,
-40817,
-40453,
-39815,
-38950,
-38023,
-37124,
-36324,
-35739,
-35471,
-35371,
-35040,
-34229,
-33138,
-32260,
-31830,
-31618,
-31244,
-30681,
-30124,
-29669,
-29071,
-28121,
-27031,
-26245,
-26035,
-26192,
-26368,
-26489,
-26752,
-27336,
-28119,
-28859,
-29479,
-30174,
-31139,
-32364,
-33582,
-34534,
-35103,
-35346,
-35346,
-35095,
-34583,
-33821,
-32944,
-32116,
-31467,
-31058,
-30795,
-30583,
-30295,
-30010,
-29893,
-30120,
-30672,
-31399,
-32263,
-33397,
-34984,
-36902,
-38759,
-40162,
-41046,
-41568,
-41827,
-41750,
-41238,
-40427,
-39495,
-38530,
-37352,
-35853,
-34090,
-32314,
-30698,
-29310,
-28147,
-27265,
-26650,
-26253,
-25979,
-25861,
-25981,
-26335,
-26805,
-27286,
-27842,
-28573,
-29446,
-30187,
-30604,
-30787,
-31054,
-31619,
-32305,
-32810,
-33008,
-33087,
-33236,
-33358,
-33207,
-32746,
-32225,
-31910,
-31709,
-31432,
-31132,
-31232,
-31977,
-33097,
-34044,
-34627,
-35223,
-36216,
-37486,
-38595,
-39354,
-40027,
-40819,
-41452,
-41475,
-40821,
-39908,
-39015,
-37938,
-36340,
-34383,
-32638,
-31430,
-30456,
-29247,
-27841,
-26776,
-26352,
-26335,
-26211,
-25908,
-25758,
-26032,
-26569,
-27053,
-27367,
-27695,
-28151,
-28689,
-29222,
-29814,
-30571,
-31453,
-32275,
-32948,
-33541,
-34145,
-34738,
-35221,
-35618,
-35993,
-36344,
-36514,
-36405,
-36094,
-35738,
-35363,
-34885,
-34339,
-34001,
-34117,
-34612,
-35093,
-35237,
-35093,
-34914,
-34841,
-34737,
-34479,
-34086,
-33735,
-33442,
-33110,
-32680,
-32271,
-32010,
-31848,
-31554,
-31023,
-30405,
-29991,
-29889,
-29995,
-30037,
-29913,
-29651,
-29396,
-29258,
-29203,
-29133,
-28956,
-28783,
-28827,
-29211,
-29815,
-30415,
-30971,
-31703,
-32782,
-34082,
-35296,
-36261,
-37145,
-38083,
-38951,
-39421,
-39356,
-38954,
-38450,
-37839,
-36993,
-35902,
-34801,
-33834,
-32967,
-32072,
-31215,
-30554,
-30145,
-29860,
-29575,
-29359,
-29331,
-29495,
-29780,
-30138,
-30617,
-31140,
-31578,
-31852,
-32138,
-32545,
-32932,
-32978,
-32635,
-32216,
-32032,
-31996,
-31761,
-31258,
-30822,
-30765,
-31040,
-31331,
-31569,
-31920,
-32415,
-32762,
-32664,
-32301,
-32081,
-32184,
-32307,
-32156,
-31835,
-31684,
-31749,
-31721,
-31419,
-31101,
-31237,
-31950,
-32967,
-34050,
-35216,
-36573,
-37933,
-38923,
-39352,
-39366,
-39193,
-38845,
-38155,
-37049,
-35616,
-34044,
-32522,
-31252,
-30476,
-30212,
-30310,
-30514,
-30796,
-31265,
-31857,
-32336,
-32484,
-32439,
-32506,
-32712,
-32803,
-32519,
-32024,
-31614,
-31305,
-30756,
-29756,
-28607,
-27853,
-27622,
-27509,
-27075,
-26466,
-26219,
-26639,
-27358,
-27783,
-27734,
-27605,
-27918,
-28735,
-29721,
-30570,
-31301,
-32190,
-33424,
-34949,
-36657,
-38452,
-40328,
-42222,
-43957,
-45382,
-46356,
-46860,
-46860,
-46358,
-45358,
-43920,
-42084,
-39938,
-37608,
-35319,
-33281,
-31560,
-30031,
-28607,
-27304,
-26276,
-25543,
-24928,
-24253,
-23569,
-23090,
-22901,
-22829,
-22655,
-22466,
-22524,
-23003,
-23718,
-24492,
-25401,
-26669,
-28237,
-29677,
-30662,
-31426,
-32494,
-34064,
-35714,
-36954,
-37784,
-38595,
-39538,
-40252,
-40390,
-40124,
-39991,
-40203,
-40339,
-39942,
-39057,
-38162,
-37484,
-36702,
-35456,
-33885,
-32587,
-31937,
-31754,
-31624,
-31389,
-31226,
-31284,
-31469,
-31667,
-31911,
-32364,
-32940,
-33396,
-33499,
-33292,
-32948,
-32497,
-31870,
-31067,
-30273,
-29708,
-29434,
-29407,
-29587,
-29979,
-30467,
-30801,
-30845,
-30707,
-30708,
-30983,
-31350,
-31507,
-31345,
-31040,
-30797,
-30606,
-30254,
-29645,
-28924,
-28450,
-28465,
-28942,
-29701,
-30567,
-31560,
-32700,
-33905,
-34998,
-35909,
-36755,
-37711,
-38679,
-39323,
-39397,
-39032,
-38677,
-38606,
-38660,
-38434,
-37755,
-36829,
-35977,
-35306,
-34647,
-33862,
-32989,
-32200,
-31568,
-31048,
-30524,
-29891,
-29115,
-28268,
-27614,
-27444,
-27808,
-28382,
-28718,
-28699,
-28657,
-28954,
-29591,
-30210,
-30595,
-30942,
-31564,
-32424,
-33101,
-33251,
-33012,
-32761,
-32722,
-32757,
-32679,
-32550,
-32492,
-32509,
-32451,
-32305,
-32291,
-32596,
-33154,
-33823,
-34619,
-35696,
-36961,
-37981,
-38397,
-38323,
-38169,
-38083,
-37702,
-36719,
-35319,
-34129,
-33453,
-33037,
-32435,
-31622,
-30969,
-30734,
-30740,
-30620,
-30271,
-29884,
-29659,
-29569,
-29403,
-28964,
-28227,
-27354,
-26701,
-26573,
-26937,
-27384,
-27597,
-27706,
-28267,
-29518,
-31137,
-32567,
-33755,
-35119,
-36916,
-38726,
-39839,
-40046,
-39775,
-39539,
-39342,
-38849,
-37985,
-37049,
-36361,
-35898,
-35418,
-34887,
-34430,
-34145,
-33918,
-33661,
-33416,
-33244,
-32988,
-32427,
-31579,
-30781,
-30292,
-30011,
-29646,
-29136,
-28778,
-28786,
-28979,
-28948,
-28604,
-28283,
-28412,
-28920,
-29420,
-29601,
-29640,
-29846,
-30290,
-30619,
-30600,
-30359,
-30282,
-30548,
-30876,
-30953,
-30771,
-30711,
-31064,
-31730,
-32301,
-32536,
-32508,
-32463,
-32503,
-32536,
-32537,
-32709,
-33419,
-34946,
-37234,
-39901,
-42366,
-44126,
-44968,
-45022,
-44575,
-43829,
-42804,
-41438,
-39816,
-38106,
-36460,
-34843,
-33184,
-31485,
-29982,
-28882,
-28292,
-28115,
-28153,
-28237,
-28175,
-27870,
-27265,
-26515,
-25821,
-25346,
-25017,
-24612,
-23949,
-23067,
-22229,
-21719,
-21666,
-21987,
-22509,
-23111,
-23819,
-24796,
-26184,
-27963,
-29912,
-31742,
-33354,
-34903,
-36647,
-38625,
-40677,
-42574,
-44265,
-45804,
-47121,
-47985,
-48245,
-47997,
-47542,
-47038,
-46444,
-45583,
-44454,
-43078,
-41491,
-39657,
-37681,
-35793,
-34135,
-32628,
-31052,
-29389,
-27792,
-26411,
-25187,
-24027,
-23016,
-22361,
-22077,
-21893,
-21546,
-21102,
-20868,
-21043,
-21433,
-21781,
-21932,
-21995,
-22068,
-22202,
-22524,
-23228,
-24472,
-26136,
-27988,
-29852,
-31739,
-33583,
-35275,
-36710,
-38074,
-39652,
-41493,
-43339,
-44868,
-46019,
-46982,
-47810,
-48351,
-48358,
-47824,
-46948,
-45942,
-44861,
-43670,
-42353,
-40966,
-39554,
-38129,
-36644,
-34989,
-33085,
-30946,
-28852,
-27105,
-25861,
-24903,
-23925,
-22825,
-21781,
-21050,
-20658,
-20493,
-20472,
-20684,
-21229,
-22074,
-23055,
-24033,
-24986,
-25928,
-26860,
-27719,
-28466,
-29096,
-29650,
-30221,
-30951,
-31904,
-33064,
-34217,
-35229,
-36046,
-36761,
-37440,
-38076,
-38677,
-39331,
-40176,
-41183,
-42179,
-42941,
-43461,
-43860,
-44214,
-44390,
-44155,
-43439,
-42356,
-41048,
-39521,
-37747,
-35897,
-34265,
-33052,
-32047,
-30948,
-29615,
-28323,
-27311,
-26591,
-25896,
-25168,
-24589,
-24353,
-24290,
-24047,
-23502,
-23023,
-23039,
-23621,
-24400,
-25100,
-25798,
-26800,
-28127,
-29471,
-30473,
-31116,
-31571,
-31934,
-32109,
-32040,
-31957,
-32156,
-32722,
-33372,
-33811,
-33974,
-34052,
-34219,
-34473,
-34806,
-35296,
-36132,
-37430,
-39123,
-41033,
-42921,
-44516,
-45610,
-46112,
-46108,
-45694,
-44884,
-43611,
-42019,
-40326,
-38723,
-37025,
-34988,
-32587,
-30203,
-28187,
-26556,
-25077,
-23716,
-22742,
-22391,
-22455,
-22504,
-22357,
-22322,
-22763,
-23628,
-24513,
-25084,
-25411,
-25737,
-26135,
-26517,
-26832,
-27245,
-27932,
-28895,
-29963,
-30948,
-31746,
-32334,
-32749,
-33120,
-33584,
-34211,
-34959,
-35829,
-36940,
-38381,
-39992,
-41467,
-42583,
-43478,
-44353,
-45205,
-45763,
-45857,
-45617,
-45280,
-44878,
-44120,
-42812,
-41009,
-38986,
-36883,
-34701,
-32427,
-30237,
-28319,
-26710,
-25276,
-23883,
-22554,
-21412,
-20550,
-20000,
-19728,
-19697,
-19901,
-20370,
-21192,
-22350,
-23674,
-24909,
-25959,
-27006,
-28323,
-29947,
-31611,
-33009,
-34111,
-35112,
-36158,
-37108,
-37704,
-37887,
-37861,
-37863,
-37894,
-37753,
-37317,
-36813,
-36603,
-36897,
-37482,
-37934,
-37975,
-37738,
-37578,
-37729,
-38114,
-38451,
-38537,
-38396,
-38163,
-37920,
-37611,
-37092,
-36280,
-35172,
-33902,
-32596,
-31352,
-30161,
-29006,
-27890,
-26912,
-26153,
-25662,
-25413,
-25347,
-25365,
-25367,
-25299,
-25258,
-25424,
-25927,
-26688,
-27529,
-28348,
-29255,
-30371,
-31693,
-33009,
-34153,
-35071,
-35867,
-36593,
-37257,
-37801,
-38134,
-38157,
-37738,
-36927,
-35904,
-34932,
-34137,
-33505,
-32999,
-32675,
-32547,
-32519,
-32354,
-32001,
-31626,
-31493,
-31613,
-31737,
-31627,
-31355,
-31237,
-31448,
-31814,
-32027,
-32018,
-32051,
-32433,
-33136,
-33890,
-34491,
-35032,
-35682,
-36450,
-37109,
-37486,
-37616,
-37585,
-37401,
-36925,
-36198,
-35394,
-34759,
-34284,
-33806,
-33168,
-32368,
-31504,
-30636,
-29810,
-29074,
-28467,
-27967,
-27474,
-26927,
-26357,
-25844,
-25455,
-25247,
-25239,
-25443,
-25753,
-26111,
-26463,
-26867,
-27303,
-27749,
-28243,
-28993,
-30153,
-31691,
-33357,
-35010,
-36704,
-38486,
-40194,
-41513,
-42398,
-43081,
-43787,
-44366,
-44478,
-44021,
-43272,
-42505,
-41677,
-40546,
-39116,
-37685,
-36517,
-35545,
-34553,
-33458,
-32384,
-31348,
-30231,
-29016,
-27918,
-27158,
-26577,
-25803,
-24704,
-23660,
-23095,
-22988,
-22904,
-22615,
-22394,
-22711,
-23631,
-24796,
-25876,
-26875,
-27985,
-29236,
-30466,
-31610,
-32702,
-33792,
-34737,
-35442,
-35987,
-36568,
-37204,
-37751,
-38116,
-38466,
-39017,
-39750,
-40471,
-40951,
-41195,
-41183,
-40884,
-40280,
-39546,
-38870,
-38253,
-37484,
-36465,
-35366,
-34416,
-33637,
-32888,
-32144,
-31535,
-31031,
-30322,
-29130,
-27625,
-26328,
-25482,
-24811,
-23909,
-22834,
-22125,
-22149,
-22741,
-23476,
-24232,
-25266,
-26703,
-28289,
-29587,
-30546,
-31517,
-32840,
-34461,
-36060,
-37450,
-38699,
-39901,
-40870,
-41263,
-40965,
-40234,
-39542,
-39075,
-38660,
-38003,
-37067,
-36117,
-35437,
-35027,
-34705,
-34300,
-33846,
-33465,
-33245,
-33233,
-33456,
-33851,
-34199,
-34198,
-33780,
-33139,
-32525,
-31867,
-30917,
-29582,
-28207,
-27248,
-26785,
-26538,
-26199,
-25882,
-25851,
-26146,
-26457,
-26482,
-26326,
-26315,
-26604,
-27017,
-27298,
-27482,
-27745,
-28154,
-28510,
-28678,
-28765,
-29013,
-29514,
-30166,
-31076,
-32638,
-35267,
-38922,
-43063,
-47121,
-50792,
-53879,
-55984,
-56619,
-55673,
-53510,
-50642,
-47237,
-43311,
-39143,
-35255,
-31927,
-28942,
-26022,
-23501,
-22041,
-21863,
-22319,
-22588,
-22509,
-22525,
-22763,
-22713,
-21877,
-20493,
-19372,
-18860,
-18649,
-18351,
-18259,
-18947,
-20551,
-22598,
-24693,
-26976,
-29660,
-32549,
-35106,
-37221,
-39248,
-41426,
-43401,
-44680,
-45294,
-45792,
-46417,
-46831,
-46622,
-45959,
-45437,
-45242,
-45020,
-44395,
-43564,
-42979,
-42672,
-42121,
-40893,
-39039,
-36976,
-34872,
-32667,
-30293,
-27884,
-25540,
-23201,
-20845,
-18737,
-17248,
-16472,
-16155,
-16079,
-16378,
-17341,
-18931,
-20761,
-22451,
-24087,
-26043,
-28471,
-31027,
-33108,
-34343,
-34939,
-35357,
-35959,
-36701,
-37301,
-37670,
-37974,
-38488,
-39168,
-39725,
-39940,
-40002,
-40269,
-40834,
-41366,
-41486,
-41197,
-40839,
-40551,
-40124,
-39158,
-37668,
-36063,
-34788,
-33936,
-33267,
-32567,
-31855,
-31280,
-30910,
-30625,
-30240,
-29663,
-28928,
-28208,
-27581,
-27050,
-26454,
-25707,
-24843,
-24009,
-23348,
-22913,
-22759,
-22959,
-23587,
-24641,
-26090,
-27894,
-30003,
-32194,
-34184,
-35802,
-37203,
-38611,
-40008,
-41045,
-41424,
-41250,
-40886,
-40525,
-39946,
-38932,
-37606,
-36483,
-35889,
-35717,
-35539,
-35111,
-34487,
-33880,
-33352,
-32822,
-32183,
-31405,
-30580,
-29873,
-29467,
-29451,
-29702,
-30043,
-30414,
-30959,
-31766,
-32662,
-33304,
-33508,
-33471,
-33484,
-33654,
-33801,
-33702,
-33322,
-32701,
-31852,
-30754,
-29454,
-28192,
-27169,
-26506,
-26184,
-26111,
-26165,
-26168,
-26045,
-25880,
-25891,
-26162,
-26554,
-26929,
-27441,
-28529,
-30515,
-33263,
-36283,
-39189,
-41903,
-44462,
-46678,
-48154,
-48673,
-48445,
-47900,
-47186,
-46045,
-44093,
-41362,
-38337,
-35593,
-33370,
-31517,
-29875,
-28484,
-27611,
-27362,
-27596,
-28002,
-28375,
-28715,
-29078,
-29385,
-29403,
-28959,
-28101,
-27100,
-26201,
-25449,
-24773,
-24170,
-23819,
-23897,
-24392,
-25107,
-25888,
-26786,
-27901,
-29196,
-30422,
-31345,
-31952,
-32388,
-32754,
-32989,
-32949,
-32616,
-32121,
-31686,
-31459,
-31473,
-31733,
-32318,
-33421,
-35166,
-37421,
-39772,
-41884,
-43740,
-45600,
-47566,
-49334,
-50465,
-50801,
-50506,
-49667,
-48051,
-45351,
-41765,
-37968,
-34619,
-31875,
-29485,
-27278,
-25409,
-24079,
-23305,
-22838,
-22474,
-22135,
-21879,
-21752,
-21747,
-21699,
-21402,
-20711,
-19859,
-19268,
-19210,
-19521,
-19865,
-20223,
-20984,
-22511,
-24668,
-27027,
-29287,
-31505,
-33765,
-35906,
-37661,
-39036,
-40273,
-41561,
-42804,
-43867,
-44776,
-45706,
-46594,
-47211,
-47384,
-47261,
-47084,
-46843,
-46269,
-45154,
-43604,
-41931,
-40309,
-38688,
-36931,
-35030,
-33126,
-31319,
-29625,
-28011,
-26569,
-25526,
-25044,
-25038,
-25107,
-24893,
-24324,
-23679,
-23216,
-22966,
-22770,
-22632,
-22740,
-23265,
-24046,
-24846,
-25520,
-26265,
-27201,
-28228,
-29125,
-29802,
-30459,
-31196,
-31981,
-32661,
-33271,
-33977,
-34841,
-35708,
-36389,
-36837,
-37200,
-37558,
-37945,
-38345,
-38843,
-39495,
-40264,
-41060,
-41856,
-42685,
-43458,
-43919,
-43796,
-43031,
-41827,
-40426,
-38918,
-37329,
-35673,
-34063,
-32524,
-30973,
-29359,
-27802,
-26547,
-25731,
-25248,
-24906,
-24615,
-24472,
-24508,
-24657,
-24808,
-25017,
-25451,
-26146,
-26930,
-27593,
-28118,
-28682,
-29388,
-30184,
-30971,
-31741,
-32518,
-33150,
-33438,
-33347,
-33180,
-33269,
-33693,
-34183,
-34519,
-34615,
-34624,
-34536,
-34349,
-34030,
-33706,
-33513,
-33549,
-33882,
-34483,
-35224,
-35811,
-36047,
-35990,
-35889,
-35911,
-36015,
-36125,
-36377,
-36926,
-37758,
-38546,
-39028,
-39201,
-39247,
-39161,
-38734,
-37755,
-36310,
-34718,
-33245,
-31976,
-30810,
-29644,
-28419,
-27197,
-26092,
-25227,
-24643,
-24327,
-24272,
-24479,
-24876,
-25297,
-25633,
-25946,
-26385,
-26985,
-27605,
-28118,
-28542,
-28891,
-29073,
-28986,
-28794,
-28905,
-29550,
-30599,
-31750,
-32980,
-34452,
-36151,
-37716,
-38901,
-39906,
-41177,
-42770,
-44245,
-45223,
-45765,
-46156,
-46293,
-45735,
-44287,
-42399,
-40666,
-39240,
-37731,
-35889,
-33927,
-32232,
-30867,
-29561,
-28198,
-26979,
-26145,
-25638,
-25182,
-24677,
-24219,
-23917,
-23665,
-23399,
-23269,
-23555,
-24269,
-25077,
-25622,
-25922,
-26310,
-27011,
-27910,
-28721,
-29379,
-30126,
-31179,
-32472,
-33647,
-34405,
-34722,
-34818,
-34945,
-35253,
-35758,
-36388,
-37011,
-37583,
-38190,
-38999,
-39979,
-40837,
-41232,
-41164,
-40963,
-40939,
-40978,
-40735,
-40045,
-39133,
-38311,
-37581,
-36707,
-35540,
-34215,
-32949,
-31767,
-30602,
-29443,
-28417,
-27597,
-26922,
-26304,
-25711,
-25124,
-24447,
-23681,
-23027,
-22770,
-22989,
-23467,
-24055,
-24905,
-26294,
-28163,
-30063,
-31607,
-32837,
-34111,
-35511,
-36721,
-37331,
-37347,
-37168,
-37204,
-37478,
-37691,
-37489,
-36857,
-36045,
-35431,
-35089,
-34844,
-34454,
-34039,
-33950,
-34402,
-35097,
-35525,
-35421,
-35058,
-34806,
-34782,
-34744,
-34523,
-34101,
-33561,
-32861,
-31990,
-31076,
-30291,
-29683,
-29151,
-28761,
-28786,
-29368,
-30255,
-30912,
-31027,
-30766,
-30474,
-30317,
-30259,
-30261,
-30453,
-30882,
-31416,
-31857,
-32169,
-32503,
-32975,
-33492,
-33918,
-34206,
-34482,
-34859,
-35340,
-35829,
-36185,
-36283,
-36034,
-35486,
-34827,
-34216,
-33649,
-32952,
-32079,
-31252,
-30787,
-30692,
-30569,
-30017,
-29101,
-28343,
-28161,
-28411,
-28628,
-28641,
-28834,
-29665,
-31086,
-32547,
-33641,
-34522,
-35625,
-37047,
-38427,
-39317,
-39684,
-39716,
-39534,
-38954,
-37846,
-36347,
-34853,
-33691,
-32943,
-32455,
-32018,
-31485,
-30881,
-30307,
-29892,
-29558,
-29189,
-28705,
-28190,
-27725,
-27256,
-26681,
-26050,
-25613,
-25587,
-26018,
-26856,
-28037,
-29532,
-31102,
-32521,
-33707,
-34862,
-36129,
-37333,
-38144,
-38493,
-38645,
-38845,
-38943,
-38614,
-37823,
-37013,
-36603,
-36630,
-36700,
-36595,
-36389,
-36340,
-36430,
-36398,
-36069,
-35522,
-35044,
-34708,
-34422,
-33972,
-33370,
-32676,
-31918,
-30983,
-29821,
-28555,
-27400,
-26369,
-25340,
-24246,
-23339,
-22914,
-22952,
-23090,
-23054,
-23003,
-23297,
-23990,
-24715,
-25184,
-25570,
-26329,
-27642,
-29274,
-30946,
-32668,
-34665,
-36933,
-39292,
-41535,
-43652,
-45657,
-47455,
-48934,
-50051,
-50694,
-50599,
-49472,
-47495,
-45172,
-42931,
-40633,
-37935,
-34899,
-32157,
-30237,
-29068,
-28090,
-27031,
-26138,
-25804,
-25968,
-26140,
-25890,
-25193,
-24337,
-23555,
-22852,
-22133,
-21373,
-20737,
-20447,
-20684,
-21350,
-22265,
-23247,
-24427,
-25976,
-27920,
-29958,
-31755,
-33257,
-34673,
-36122,
-37372,
-38004,
-37878,
-37318,
-36863,
-36812,
-37063,
-37353,
-37663,
-38193,
-39155,
-40476,
-41885,
-43229,
-44536,
-45872,
-47056,
-47788,
-47866,
-47391,
-46496,
-45169,
-43259,
-40722,
-37726,
-34539,
-31305,
-28160,
-25236,
-22701,
-20617,
-18952,
-17749,
-17120,
-17141,
-17671,
-18486,
-19450,
-20517,
-21572,
-22370,
-22761,
-22822,
-22788,
-22845,
-23075,
-23638,
-24678,
-26209,
-27966,
-29753,
-31627,
-33829,
-36318,
-38764,
-40842,
-42655,
-44534,
-46558,
-48443,
-49824,
-50658,
-51086,
-51157,
-50738,
-49757,
-48358,
-46719,
-44850,
-42700,
-40349,
-38062,
-36027,
-34178,
-32352,
-30517,
-28805,
-27327,
-26023,
-24747,
-23418,
-22064,
-20786,
-19684,
-18832,
-18226,
-17767,
-17346,
-16996,
-16885,
-17197,
-17995,
-19252,
-21003,
-23325,
-26217,
-29428,
-32580,
-35296,
-37453,
-39072,
-40280,
-41172,
-41795,
-42176,
-42363,
-42463,
-42569,
-42702,
-42733,
-42541,
-42150,
-41735,
-41448,
-41213,
-40787,
-40018,
-38969,
-37884,
-36856,
-35787,
-34501,
-32973,
-31394,
-30005,
-28924,
-28148,
-27642,
-27418,
-27473,
-27756,
-28140,
-28513,
-28805,
-28940,
-28871,
-28569,
-28121,
-27622,
-27155,
-26687,
-26233,
-25839,
-25620,
-25597,
-25723,
-25998,
-26499,
-27346,
-28490,
-29764,
-31033,
-32328,
-33762,
-35351,
-36952,
-38472,
-39881,
-41223,
-42317,
-42950,
-42968,
-42555,
-41992,
-41442,
-40829,
-40081,
-39214,
-38417,
-37731,
-37063,
-36272,
-35287,
-34222,
-33185,
-32280,
-31531,
-30907,
-30351,
-29819,
-29340,
-28992,
-28791,
-28598,
-28279,
-27767,
-27244,
-26888,
-26724,
-26623,
-26436,
-26197,
-26044,
-26049,
-26125,
-26158,
-26130,
-26169,
-26386,
-26749,
-27160,
-27561,
-28024,
-28591,
-29238,
-29862,
-30509,
-31362,
-32624,
-34334,
-36362,
-38579,
-40918,
-43364,
-45747,
-47870,
-49491,
-50505,
-50820,
-50437,
-49412,
-47896,
-45917,
-43336,
-40025,
-36202,
-32518,
-29596,
-27592,
-26146,
-24907,
-23910,
-23459,
-23608,
-24044,
-24407,
-24649,
-25036,
-25653,
-26302,
-26662,
-26656,
-26440,
-26234,
-26102,
-26060,
-26088,
-26143,
-26141,
-26123,
-26300,
-26910,
-27898,
-28962,
-29836,
-30619,
-31567,
-32745,
-33865,
-34669,
-35166,
-35621,
-36175,
-36759,
-37241,
-37573,
-37769,
-37840,
-37937,
-38449,
-39641,
-41354,
-42922,
-43884,
-44290,
-44573,
-44783,
-44505,
-43398,
-41660,
-39845,
-38174,
-36397,
-34240,
-31906,
-29769,
-28031,
-26521,
-25185,
-24216,
-23789,
-23783,
-23882,
-23960,
-24111,
-24375,
-24651,
-24915,
-25329,
-25971,
-26583,
-26833,
-26826,
-27048,
-27753,
-28555,
-28919,
-28863,
-28981,
-29569,
-30259,
-30430,
-30173,
-30153,
-30856,
-32021,
-33095,
-34003,
-35131,
-36663,
-38209,
-39306,
-40022,
-40920,
-42300,
-43826,
-44914,
-45327,
-45336,
-45167,
-44693,
-43549,
-41683,
-39490,
-37552,
-36104,
-34958,
-33732,
-32304,
-30895,
-29827,
-29169,
-28663,
-27997,
-27127,
-26309,
-25802,
-25577,
-25363,
-24942,
-24425,
-24100,
-24185,
-24548,
-24930,
-25215,
-25595,
-26301,
-27308,
-28228,
-28749,
-28891,
-29048,
-29523,
-30300,
-31107,
-31829,
-32539,
-33382,
-34318,
-35174,
-35851,
-36399,
-36960,
-37687,
-38704,
-40003,
-41414,
-42549,
-43185,
-43349,
-43288,
-43087,
-42619,
-41729,
-40572,
-39411,
-38341,
-37133,
-35589,
-33822,
-32195,
-30972,
-30068,
-29329,
-28643,
-28073,
-27559,
-27010,
-26353,
-25707,
-25222,
-24956,
-24830,
-24783,
-24793,
-24916,
-25203,
-25738,
-26575,
-27661,
-28780,
-29773,
-30628,
-31522,
-32528,
-33497,
-34214,
-34614,
-34875,
-35134,
-35395,
-35547,
-35621,
-35796,
-36174,
-36665,
-37022,
-37138,
-37144,
-37207,
-37410,
-37603,
-37645,
-37472,
-37155,
-36739,
-36268,
-35707,
-35100,
-34488,
-33914,
-33341,
-32663,
-31842,
-30960,
-30215,
-29748,
-29477,
-29213,
-28828,
-28423,
-28197,
-28148,
-28095,
-27783,
-27282,
-26843,
-26775,
-27097,
-27707,
-28464,
-29352,
-30314,
-31244,
-32051,
-32842,
-33823,
-35134,
-36605,
-37945,
-38889,
-39386,
-39503,
-39293,
-38785,
-38046,
-37178,
-36338,
-35600,
-34998,
-34480,
-33935,
-33288,
-32586,
-32065,
-31916,
-32137,
-32426,
-32542,
-32481,
-32449,
-32535,
-32597,
-32502,
-32376,
-32487,
-32828,
-33046,
-32773,
-32070,
-31329,
-30771,
-30254,
-29541,
-28761,
-28258,
-28167,
-28247,
-28170,
-27989,
-27905,
-27933,
-27813,
-27405,
-26979,
-26916,
-27253,
-27709,
-28121,
-28665,
-29518,
-30533,
-31349,
-31986,
-32878,
-34439,
-36597,
-38969,
-41364,
-43911,
-46582,
-48886,
-50133,
-50060,
-49000,
-47484,
-45693,
-43496,
-40772,
-37702,
-34672,
-31982,
-29720,
-27842,
-26320,
-25207,
-24612,
-24521,
-24751,
-25015,
-25122,
-25097,
-25085,
-25114,
-25078,
-24865,
-24575,
-24463,
-24734,
-25364,
-26098,
-26713,
-27150,
-27650,
-28506,
-29805,
-31308,
-32630,
-33618,
-34467,
-35368,
-36206,
-36599,
-36338,
-35698,
-35089,
-34713,
-34373,
-33927,
-33471,
-33308,
-33547,
-34163,
-35057,
-36214,
-37526,
-38806,
-39956,
-41119,
-42456,
-43849,
-44879,
-45220,
-44849,
-43908,
-42368,
-40123,
-37286,
-34321,
-31701,
-29551,
-27682,
-25964,
-24492,
-23461,
-22924,
-22801,
-23029,
-23584,
-24389,
-25265,
-25993,
-26458,
-26643,
-26658,
-26648,
-26733,
-26863,
-26822,
-26466,
-25932,
-25591,
-25747,
-26403,
-27445,
-28798,
-30504,
-32435,
-34304,
-35837,
-37057,
-38146,
-39212,
-40210,
-41100,
-42027,
-43120,
-44286,
-45197,
-45590,
-45476,
-45037,
-44411,
-43591,
-42550,
-41338,
-40053,
-38733,
-37359,
-35867,
-34212,
-32340,
-30290,
-28220,
-26377,
-24896,
-23699,
-22609,
-21587,
-20811,
-20455,
-20499,
-20761,
-21187,
-21943,
-23184,
-24776,
-26339,
-27656,
-28854,
-30215,
-31713,
-33079,
-34066,
-34826,
-35570,
-36303,
-36737,
-36823,
-36831,
-37115,
-37546,
-37662,
-37233,
-36596,
-36281,
-36416,
-36629,
-36583,
-36337,
-36159,
-36061,
-35751,
-35005,
-34006,
-33183,
-32820,
-32902,
-33195,
-33451,
-33507,
-33317,
-32998,
-32768,
-32753,
-32879,
-33008,
-33095,
-33208,
-33363,
-33395,
-33136,
-32644,
-32153,
-31870,
-31729,
-31501,
-31047,
-30469,
-30022,
-29860,
-29915,
-29991,
-29976,
-29933,
-30023,
-30267,
-30548,
-30707,
-30735,
-30729,
-30748,
-30735,
-30614,
-30374,
-30073,
-29806,
-29668,
-29814,
-30282,
-30910,
-31452,
-31896,
-32546,
-33672,
-35056,
-36181,
-36816,
-37384,
-38471,
-40068,
-41451,
-41986,
-41721,
-41271,
-40908,
-40261,
-38824,
-36677,
-34500,
-32928,
-31941,
-31090,
-30025,
-28853,
-27892,
-27302,
-26951,
-26626,
-26232,
-25892,
-25781,
-26035,
-26608,
-27326,
-27967,
-28482,
-29041,
-29870,
-30975,
-32052,
-32759,
-33135,
-33532,
-34276,
-35166,
-35752,
-35817,
-35705,
-35850,
-36237,
-36377,
-35965,
-35254,
-34756,
-34606,
-34502,
-34227,
-33965,
-34044,
-34380,
-34609,
-34535,
-34419,
-34535,
-34805,
-34858,
-34554,
-34077,
-33627,
-33151,
-32550,
-31930,
-31495,
-31181,
-30723,
-30014,
-29349,
-29016,
-28933,
-28748,
-28382,
-28160,
-28329,
-28698,
-28851,
-28707,
-28620,
-28835,
-29167,
-29257,
-29149,
-29321,
-30190,
-31678,
-33364,
-34908,
-36261,
-37497,
-38663,
-39808,
-40957,
-42028,
-42701,
-42660,
-41856,
-40580,
-39096,
-37427,
-35472,
-33307,
-31319,
-29805,
-28796,
-28058,
-27485,
-27174,
-27192,
-27454,
-27775,
-28172,
-28838,
-29778,
-30757,
-31457,
-31925,
-32477,
-33273,
-34046,
-34360,
-34098,
-33587,
-33188,
-32952,
-32707,
-32361,
-32026,
-31774,
-31525,
-31220,
-31004,
-31101,
-31490,
-31855,
-31912,
-31692,
-31423,
-31188,
-30844,
-30286,
-29614,
-29038,
-28586,
-28133,
-27649,
-27248,
-27094,
-27181,
-27486,
-28169,
-29473,
-31523,
-34138,
-37116,
-40360,
-43765,
-46887,
-49023,
-49702,
-49115,
-47787,
-46060,
-43786,
-40821,
-37457,
-34356,
-31923,
-30077,
-28552,
-27430,
-27082,
-27644,
-28728,
-29697,
-30211,
-30341,
-30247,
-29948,
-29362,
-28543,
-27610,
-26564,
-25264,
-23662,
-21971,
-20510,
-19535,
-19164,
-19585,
-20972,
-23295,
-26137,
-28928,
-31287,
-33139,
-34549,
-35572,
-36308,
-37005,
-37912,
-39078,
-40288,
-41317,
-42118,
-42754,
-43244,
-43508,
-43557,
-43503,
-43481,
-43455,
-43276,
-42823,
-42046,
-40924,
-39428,
-37603,
-35657,
-33780,
-32066,
-30386,
-28694,
-27065,
-25749,
-24845,
-24299,
-23850,
-23386,
-22920,
-22686,
-22813,
-23259,
-23771,
-24214,
-24675,
-25448,
-26609,
-27862,
-28810,
-29333,
-29759,
-30401,
-31237,
-31944,
-32442,
-33037,
-34111,
-35577,
-36937,
-37761,
-38119,
-38392,
-38784,
-39181,
-39382,
-39466,
-39672,
-40119,
-40579,
-40674,
-40178,
-39161,
-37934,
-36779,
-35799,
-34892,
-33927,
-32951,
-32168,
-31701,
-31411,
-30997,
-30369,
-29694,
-29216,
-28892,
-28517,
-27968,
-27375,
-26838,
-26268,
-25493,
-24610,
-23962,
-23803,
-24075,
-24613,
-25478,
-26924,
-29001,
-31363,
-33605,
-35623,
-37598,
-39598,
-41316,
-42380,
-42689,
-42485,
-42024,
-41365,
-40466,
-39332,
-38087,
-36792,
-35502,
-34274,
-33255,
-32497,
-31954,
-31527,
-31230,
-31157,
-31225,
-31186,
-30747,
-29970,
-29208,
-28854,
-28948,
-29239,
-29491,
-29721,
-30110,
-30637,
-31090,
-31247,
-31224,
-31332,
-31666,
-32001,
-31943,
-31464,
-30859,
-30384,
-29976,
-29372,
-28543,
-27831,
-27605,
-27945,
-28563,
-29158,
-29636,
-30139,
-30920,
-32117,
-33675,
-35259,
-36526,
-37406,
-38240,
-39395,
-40762,
-41862,
-42309,
-42384,
-42612,
-43086,
-43214,
-42388,
-40720,
-38972,
-37669,
-36564,
-35044,
-32951,
-30817,
-29161,
-27952,
-26683,
-25174,
-23788,
-23107,
-23231,
-23834,
-24543,
-25272,
-26135,
-27090,
-28024,
-28883,
-29728,
-30565,
-31250,
-31704,
-32026,
-32418,
-32822,
-33024,
-32929,
-32767,
-32837,
-33105,
-33300,
-33293,
-33279,
-33443,
-33548,
-33208,
-32319,
-31301,
-30515,
-29913,
-29190,
-28416,
-28010,
-28250,
-28800,
-29159,
-29313,
-29790,
-31043,
-32955,
-35211,
-37889,
-41412,
-45806,
-50273,
-53622,
-55131,
-54853,
-53148,
-50284,
-46442,
-42104,
-37934,
-34428,
-31564,
-29013,
-26587,
-24357,
-22598,
-21514,
-21146,
-21402,
-21999,
-22649,
-23070,
-23134,
-22769,
-21978,
-20920,
-19939,
-19376,
-19297,
-19474,
-19778,
-20479,
-22016,
-24508,
-27484,
-30308,
-32782,
-35111,
-37526,
-39806,
-41586,
-42726,
-43476,
-44109,
-44665,
-45046,
-45258,
-45389,
-45417,
-45154,
-44502,
-43589,
-42635,
-41694,
-40627,
-39373,
-38032,
-36746,
-35536,
-34371,
-33248,
-32209,
-31115,
-29847,
-28493,
-27493,
-27124,
-27173,
-26996,
-26277,
-25343,
-24850,
-24956,
-25143,
-24754,
-23759,
-22792,
-22562,
-23180,
-24198,
-25170,
-26102,
-27335,
-29060,
-30966,
-32574,
-33671,
-34535,
-35492,
-36570,
-37426,
-37894,
-38071,
-38207,
-38237,
-37973,
-37391,
-36798,
-36477,
-36393,
-36340,
-36288,
-36398,
-36658,
-36816,
-36617,
-36202,
-35792,
-35414,
-34861,
-34235,
-33951,
-34225,
-34547,
-34169,
-32962,
-31666,
-30976,
-30728,
-30234,
-29231,
-28287,
-27985,
-28164,
-28131,
-27593,
-26905,
-26550,
-26436,
-26238,
-25916,
-25907,
-26513,
-27599,
-28823,
-30125,
-31674,
-33498,
-35367,
-37107,
-38775,
-40417,
-41802,
-42581,
-42742,
-42596,
-42329,
-41680,
-40311,
-38374,
-36531,
-35299,
-34582,
-33858,
-32808,
-31593,
-30518,
-29723,
-29086,
-28522,
-27991,
-27507,
-27036,
-26624,
-26373,
-26365,
-26569,
-26959,
-27605,
-28557,
-29674,
-30625,
-31219,
-31579,
-31930,
-32308,
-32467,
-32260,
-31834,
-31534,
-31546,
-31828,
-32207,
-32593,
-32913,
-33137,
-33292,
-33508,
-33835,
-34166,
-34275,
-34213,
-34256,
-34624,
-35143,
-35356,
-35110,
-34720,
-34691,
-35153,
-35875,
-36630,
-37565,
-38878,
-40396,
-41545,
-41797,
-41206,
-40181,
-39066,
-37724,
-35876,
-33485,
-30957,
-28792,
-27216,
-26079,
-25155,
-24339,
-23773,
-23641,
-24028,
-24850,
-25809,
-26626,
-27169,
-27633,
-28296,
-29252,
-30237,
-30895,
-31157,
-31277,
-31526,
-31899,
-32158,
-32235,
-32283,
-32542,
-32980,
-33432,
-33787,
-34167,
-34692,
-35287,
-35699,
-35759,
-35546,
-35251,
-35005,
-34744,
-34375,
-33913,
-33547,
-33465,
-33688,
-34035,
-34349,
-34651,
-35199,
-36114,
-37288,
-38409,
-39293,
-39910,
-40230,
-40068,
-39303,
-38066,
-36711,
-35413,
-34035,
-32431,
-30736,
-29339,
-28395,
-27724,
-27035,
-26369,
-25915,
-25762,
-25692,
-25531,
-25348,
-25356,
-25590,
-25899,
-26198,
-26573,
-27132,
-27765,
-28301,
-28721,
-29235,
-29963,
-30795,
-31512,
-32129,
-32845,
-33845,
-34983,
-35983,
-36631,
-37022,
-37369,
-37844,
-38466,
-39086,
-39563,
-39750,
-39639,
-39251,
-38676,
-37972,
-37247,
-36624,
-36204,
-35978,
-35753,
-35366,
-34687,
-33809,
-32837,
-31900,
-31084,
-30508,
-30323,
-30574,
-31151,
-31789,
-32245,
-32458,
-32490,
-32413,
-32221,
-31817,
-31187,
-30394,
-29570,
-28847,
-28285,
-27871,
-27554,
-27282,
-27119,
-27154,
-27401,
-27707,
-27878,
-27888,
-27901,
-28102,
-28530,
-29142,
-29969,
-31058,
-32307,
-33420,
-34231,
-34868,
-35672,
-36717,
-37796,
-38683,
-39463,
-40345,
-41342,
-42109,
-42365,
-42062,
-41400,
-40519,
-39481,
-38357,
-37213,
-36038,
-34757,
-33416,
-32231,
-31228,
-30199,
-28877,
-27439,
-26356,
-25823,
-25531,
-25081,
-24643,
-24734,
-25534,
-26538,
-27236,
-27742,
-28664,
-30207,
-31863,
-32993,
-33598,
-34158,
-34967,
-35753,
-36107,
-35996,
-35699,
-35409,
-35082,
-34670,
-34262,
-33993,
-33849,
-33806,
-33856,
-34019,
-34098,
-33921,
-33527,
-33266,
-33366,
-33671,
-33801,
-33589,
-33231,
-32966,
-32775,
-32412,
-31688,
-30697,
-29736,
-29119,
-29032,
-29369,
-29868,
-30308,
-30710,
-31289,
-32042,
-32717,
-33015,
-33027,
-33092,
-33381,
-33669,
-33660,
-33462,
-33463,
-33909,
-34571,
-35068,
-35278,
-35332,
-35323,
-35169,
-34786,
-34287,
-33884,
-33622,
-33491,
-33464,
-33571,
-33627,
-33289,
-32394,
-31236,
-30348,
-29973,
-29889,
-29784,
-29718,
-29966,
-30614,
-31270,
-31523,
-31354,
-31196,
-31390,
-31891,
-32330,
-32483,
-32440,
-32443,
-32646,
-32969,
-33296,
-33552,
-33832,
-34277,
-34913,
-35560,
-35884,
-35693,
-35120,
-34496,
-34054,
-33732,
-33364,
-32940,
-32577,
-32300,
-31939,
-31361,
-30683,
-30136,
-29781,
-29417,
-28965,
-28565,
-28428,
-28398,
-28113,
-27424,
-26700,
-26421,
-26713,
-27297,
-28002,
-29042,
-30756,
-33163,
-35911,
-38610,
-41090,
-43263,
-44956,
-45980,
-46215,
-45688,
-44396,
-42432,
-40093,
-37800,
-35802,
-34013,
-32316,
-30871,
-29987,
-29718,
-29697,
-29596,
-29454,
-29520,
-29810,
-29971,
-29772,
-29345,
-28967,
-28646,
-28108,
-27255,
-26346,
-25706,
-25455,
-25481,
-25823,
-26517,
-27477,
-28289,
-28717,
-28879,
-29186,
-29798,
-30577,
-31299,
-31991,
-32781,
-33628,
-34330,
-34709,
-34854,
-34926,
-35083,
-35371,
-35818,
-36376,
-36969,
-37523,
-38126,
-38850,
-39585,
-40061,
-40111,
-39896,
-39654,
-39388,
-38870,
-38025,
-37128,
-36480,
-36006,
-35312,
-34240,
-33081,
-32267,
-31830,
-31426,
-30831,
-30194,
-29821,
-29719,
-29657,
-29493,
-29328,
-29254,
-29098,
-28652,
-27934,
-27279,
-26857,
-26540,
-26134,
-25762,
-25782,
-26252,
-26769,
-26852,
-26544,
-26344,
-26647,
-27268,
-27812,
-28177,
-28734,
-29773,
-31108,
-32242,
-32981,
-33633,
-34592,
-35926,
-37306,
-38516,
-39592,
-40679,
-41704,
-42467,
-42940,
-43300,
-43660,
-43850,
-43604,
-42938,
-42184,
-41555,
-40883,
-39824,
-38375,
-36948,
-35949,
-35265,
-34431,
-33157,
-31632,
-30218,
-28976,
-27626,
-25991,
-24301,
-23018,
-22392,
-22255,
-22290,
-22287,
-22289,
-22399,
-22671,
-23050,
-23418,
-23672,
-23814,
-24036,
-24565,
-25480,
-26624,
-27835,
-29142,
-30716,
-32525,
-34258,
-35596,
-36618,
-37687,
-39030,
-40457,
-41644,
-42603,
-43686,
-45043,
-46274,
-46706,
-46069,
-44792,
-43534,
-42570,
-41641,
-40407,
-38922,
-37546,
-36562,
-35835,
-34977,
-33760,
-32256,
-30799,
-29611,
-28743,
-28059,
-27471,
-26905,
-26344,
-25733,
-25031,
-24321,
-23764,
-23522,
-23609,
-23875,
-24138,
-24344,
-24583,
-25036,
-25786,
-26774,
-27856,
-28879,
-29826,
-30708,
-31528,
-32214,
-32716,
-33128,
-33623,
-34296,
-35057,
-35759,
-36399,
-37094,
-37869,
-38504,
-38744,
-38665,
-38665,
-39074,
-39812,
-40434,
-40677,
-40614,
-40502,
-40343,
-39927,
-39110,
-38028,
-36957,
-35991,
-35060,
-34054,
-32967,
-31813,
-30566,
-29289,
-28180,
-27431,
-27004,
-26667,
-26307,
-26092,
-26242,
-26690,
-27080,
-27158,
-27061,
-27077,
-27340,
-27609,
-27727,
-27767,
-28079,
-28789,
-29772,
-30734,
-31563,
-32374,
-33256,
-34168,
-34920,
-35400,
-35724,
-36116,
-36707,
-37369,
-37811,
-37898,
-37737,
-37609,
-37558,
-37426,
-37024,
-36476,
-36070,
-35911,
-35730,
-35157,
-34143,
-33015,
-32134,
-31591,
-31211,
-30864,
-30527,
-30251,
-30011,
-29811,
-29697,
-29762,
-29985,
-30295,
-30638,
-31039,
-31440,
-31725,
-31756,
-31556,
-31278,
-31033,
-30920,
-31023,
-31464,
-32177,
-32926,
-33457,
-33818,
-34229,
-34752,
-35133,
-35137,
-34919,
-34923,
-35299,
-35649,
-35423,
-34510,
-33321,
-32293,
-31493,
-30799,
-30262,
-30102,
-30339,
-30671,
-30763,
-30654,
-30623,
-30786,
-30960,
-30962,
-30881,
-30971,
-31232,
-31454,
-31514,
-31618,
-32054,
-32801,
-33565,
-34156,
-34707,
-35391,
-36119,
-36561,
-36629,
-36579,
-36749,
-37122,
-37386,
-37294,
-36914,
-36406,
-35791,
-34917,
-33769,
-32500,
-31299,
-30170,
-29070,
-27983,
-27046,
-26247,
-25573,
-25025,
-24781,
-24944,
-25427,
-26039,
-26798,
-27884,
-29343,
-30812,
-31905,
-32620,
-33405,
-34597,
-35968,
-37031,
-37579,
-37932,
-38449,
-39074,
-39428,
-39303,
-38886,
-38505,
-38267,
-38072,
-37814,
-37479,
-37005,
-36293,
-35364,
-34419,
-33644,
-32953,
-32119,
-31149,
-30390,
-30141,
-30331,
-30507,
-30414,
-30163,
-30075,
-30214,
-30350,
-30252,
-29939,
-29593,
-29283,
-28946,
-28423,
-27749,
-26986,
-26238,
-25554,
-24998,
-24626,
-24479,
-24511,
-24707,
-25084,
-25722,
-26634,
-27767,
-28962,
-30157,
-31350,
-32725,
-34392,
-36442,
-38769,
-41270,
-43820,
-46325,
-48626,
-50488,
-51692,
-52082,
-51649,
-50434,
-48551,
-46161,
-43482,
-40678,
-37835,
-34997,
-32255,
-29851,
-27953,
-26636,
-25739,
-25073,
-24494,
-23886,
-23199,
-22327,
-21335,
-20362,
-19640,
-19268,
-19211,
-19383,
-19790,
-20544,
-21723,
-23213,
-24780,
-26241,
-27616,
-29086,
-30750,
-32543,
-34234,
-35673,
-36813,
-37708,
-38353,
-38637,
-38504,
-38035,
-37573,
-37488,
-37930,
-38703,
-39428,
-39901,
-40255,
-40771,
-41503,
-42239,
-42692,
-42912,
-43155,
-43582,
-43971,
-43899,
-43128,
-41775,
-40133,
-38387,
-36504,
-34399,
-32016,
-29458,
-26904,
-24605,
-22739,
-21338,
-20314,
-19663,
-19477,
-19828,
-20521,
-21155,
-21505,
-21707,
-22090,
-22740,
-23377,
-23736,
-23969,
-24624,
-26062,
-28090,
-30045,
-31487,
-32511,
-33617,
-35060,
-36621,
-37882,
-38773,
-39668,
-40932,
-42394,
-43498,
-43807,
-43535,
-43234,
-43250,
-43508,
-43695,
-43745,
-43699,
-43535,
-43036,
-42017,
-40490,
-38588,
-36497,
-34409,
-32625,
-31251,
-30093,
-28729,
-27080,
-25505,
-24470,
-23965,
-23606,
-23163,
-22885,
-23091,
-23692,
-24222,
-24393,
-24363,
-24403,
-24512,
-24521,
-24485,
-24745,
-25551,
-26755,
-28005,
-29161,
-30334,
-31660,
-33057,
-34361,
-35501,
-36531,
-37510,
-38462,
-39414,
-40366,
-41266,
-41975,
-42456,
-42766,
-42972,
-43050,
-42904,
-42477,
-41795,
-40870,
-39791,
-38698,
-37751,
-36883,
-35813,
-34311,
-32500,
-30767,
-29370,
-28202,
-27051,
-25860,
-24870,
-24263,
-23996,
-23842,
-23616,
-23294,
-23024,
-22995,
-23355,
-24044,
-24859,
-25556,
-26092,
-26513,
-26873,
-27089,
-27194,
-27401,
-28011,
-29192,
-30916,
-33136,
-35852,
-38921,
-41940,
-44428,
-46108,
-47074,
-47569,
-47810,
-47911,
-47862,
-47547,
-46716,
-45284,
-43406,
-41368,
-39286,
-37086,
-34848,
-32913,
-31526,
-30496,
-29286,
-27769,
-26304,
-25339,
-24732,
-23990,
-22970,
-22099,
-21852,
-22035,
-22097,
-21801,
-21535,
-21820,
-22634,
-23623,
-24527,
-25445,
-26475,
-27482,
-28282,
-28944,
-29684,
-30596,
-31566,
-32587,
-33793,
-35248,
-36710,
-37871,
-38677,
-39343,
-39920,
-40211,
-40064,
-39688,
-39503,
-39627,
-39879,
-40080,
-40369,
-40876,
-41426,
-41629,
-41374,
-40965,
-40706,
-40506,
-40017,
-39117,
-37989,
-36837,
-35541,
-33922,
-32008,
-30096,
-28394,
-26893,
-25519,
-24339,
-23459,
-22869,
-22470,
-22275,
-22380,
-22781,
-23231,
-23495,
-23553,
-23554,
-23555,
-23464,
-23297,
-23285,
-23661,
-24379,
-25222,
-26102,
-27263,
-28855,
-30759,
-32632,
-34364,
-36198,
-38323,
-40633,
-42759,
-44568,
-46173,
-47696,
-48921,
-49490,
-49298,
-48596,
-47689,
-46588,
-45124,
-43232,
-41096,
-38925,
-36721,
-34423,
-32117,
-30064,
-28424,
-27077,
-25827,
-24699,
-23979,
-23829,
-24105,
-24458,
-24760,
-25142,
-25746,
-26469,
-27032,
-27316,
-27448,
-27619,
-27886,
-28159,
-28404,
-28682,
-29033,
-29429,
-29797,
-30156,
-30597,
-31148,
-31764,
-32352,
-32866,
-33261,
-33451,
-33347,
-32950,
-32437,
-32005,
-31786,
-31742,
-31835,
-32093,
-32667,
-33630,
-34934,
-36474,
-38194,
-40142,
-42250,
-44283,
-45918,
-46985,
-47446,
-47291,
-46347,
-44560,
-42146,
-39538,
-37014,
-34433,
-31646,
-28774,
-26323,
-24621,
-23552,
-22786,
-22214,
-22054,
-22457,
-23241,
-24048,
-24728,
-25360,
-26060,
-26772,
-27383,
-27874,
-28320,
-28765,
-29230,
-29767,
-30364,
-30914,
-31216,
-31261,
-31240,
-31369,
-31612,
-31855,
-32141,
-32741,
-33742,
-34846,
-35605,
-35896,
-36050,
-36425,
-37111,
-37952,
-38886,
-39979,
-41197,
-42294,
-42929,
-42982,
-42530,
-41760,
-40835,
-39883,
-38976,
-38039,
-36915,
-35491,
-33831,
-32056,
-30268,
-28537,
-27044,
-25918,
-25148,
-24526,
-23950,
-23557,
-23492,
-23621,
-23632,
-23526,
-23688,
-24521,
-25793,
-26900,
-27519,
-28033,
-29004,
-30467,
-31885,
-32869,
-33673,
-34804,
-36329,
-37706,
-38450,
-38612,
-38657,
-38824,
-38921,
-38691,
-38137,
-37546,
-37088,
-36683,
-36239,
-35713,
-35222,
-34779,
-34403,
-34078,
-33844,
-33609,
-33267,
-32765,
-32249,
-31883,
-31669,
-31469,
-31183,
-30881,
-30713,
-30641,
-30512,
-30195,
-29800,
-29558,
-29599,
-29813,
-29963,
-29900,
-29674,
-29417,
-29196,
-28937,
-28563,
-28217,
-28206,
-28782,
-29831,
-30949,
-31830,
-32567,
-33537,
-34912,
-36455,
-37722,
-38572,
-39167,
-39776,
-40306,
-40514,
-40215,
-39505,
-38580,
-37535,
-36390,
-35189,
-34058,
-33046,
-32144,
-31320,
-30658,
-30197,
-29871,
-29499,
-29017,
-28561,
-28256,
-28147,
-28113,
-28163,
-28370,
-28797,
-29325,
-29799,
-30163,
-30505,
-30854,
-31125,
-31257,
-31322,
-31495,
-31779,
-31991,
-31971,
-31790,
-31673,
-31711,
-31760,
-31631,
-31417,
-31410,
-31852,
-32651,
-33526,
-34289,
-34950,
-35607,
-36184,
-36565,
-36760,
-37003,
-37555,
-38401,
-39301,
-39998,
-40456,
-40691,
-40618,
-39948,
-38574,
-36682,
-34713,
-32954,
-31382,
-29848,
-28341,
-27040,
-26076,
-25390,
-24886,
-24581,
-24701,
-25318,
-26332,
-27459,
-28530,
-29514,
-30389,
-31058,
-31475,
-31745,
-32103,
-32642,
-33246,
-33691,
-33923,
-34015,
-34036,
-33950,
-33736,
-33527,
-33539,
-33791,
-34046,
-34023,
-33652,
-33106,
-32525,
-31896,
-31162,
-30431,
-29910,
-29677,
-29511,
-29150,
-28552,
-27973,
-27733,
-27967,
-28711,
-30051,
-32197,
-35219,
-38873,
-42577,
-45778,
-48083,
-49376,
-49596,
-48707,
-46730,
-43928,
-40691,
-37506,
-34579,
-31966,
-29557,
-27425,
-25732,
-24682,
-24306,
-24516,
-25138,
-26049,
-27011,
-27748,
-28016,
-27763,
-27188,
-26445,
-25591,
-24546,
-23383,
-22371,
-21861,
-22061,
-22977,
-24447,
-26298,
-28319,
-30372,
-32373,
-34328,
-36196,
-37853,
-39190,
-40245,
-41167,
-41989,
-42535,
-42604,
-42377,
-42276,
-42639,
-43232,
-43515,
-43137,
-42325,
-41469,
-40686,
-39613,
-37988,
-35995,
-34178,
-32800,
-31602,
-30128,
-28301,
-26585,
-25493,
-25110,
-25003,
-24730,
-24215,
-23825,
-23945,
-24660,
-25677,
-26601,
-27199,
-27553,
-27889,
-28393,
-29039,
-29685,
-30248,
-30848,
-31669,
-32736,
-33772,
-34425,
-34587,
-34559,
-34743,
-35268,
-35891,
-36286,
-36435,
-36534,
-36726,
-36877,
-36793,
-36533,
-36335,
-36328,
-36344,
-36123,
-35668,
-35208,
-34888,
-34628,
-34271,
-33865,
-33598,
-33501,
-33368,
-32961,
-32283,
-31503,
-30769,
-30108,
-29513,
-29054,
-28724,
-28511,
-28421,
-28599,
-29020,
-29365,
-29167,
-28465,
-27886,
-28220,
-29518,
-31169,
-32507,
-33541,
-34705,
-36173,
-37510,
-38171,
-38129,
-37925,
-38061,
-38543,
-38838,
-38487,
-37399,
-35982,
-34716,
-33824,
-33093,
-32177,
-31040,
-30081,
-29742,
-29910,
-29974,
-29394,
-28354,
-27498,
-27268,
-27423,
-27498,
-27428,
-27626,
-28440,
-29699,
-30907,
-31847,
-32696,
-33743,
-34892,
-35838,
-36366,
-36653,
-36924,
-37213,
-37229,
-36814,
-36089,
-35456,
-35106,
-34882,
-34451,
-33729,
-33003,
-32587,
-32424,
-32131,
-31419,
-30475,
-29687,
-29214,
-28822,
-28278,
-27739,
-27572,
-27894,
-28408,
-28830,
-29277,
-30155,
-31625,
-33409,
-35108,
-36623,
-38035,
-39291,
-40054,
-40079,
-39480,
-38636,
-37781,
-36942,
-36092,
-35354,
-34816,
-34365,
-33782,
-33045,
-32417,
-32185,
-32341,
-32637,
-32826,
-32839,
-32731,
-32481,
-32054,
-31414,
-30635,
-29845,
-29168,
-28687,
-28337,
-27991,
-27533,
-27046,
-26715,
-26603,
-26564,
-26407,
-26218,
-26262,
-26679,
-27217,
-27511,
-27463,
-27359,
-27532,
-28012,
-28609,
-29168,
-29757,
-30552,
-31668,
-33148,
-35024,
-37288,
-39938,
-42948,
-46271,
-49652,
-52494,
-54138,
-54297,
-53300,
-51671,
-49605,
-46910,
-43537,
-39916,
-36659,
-33940,
-31418,
-28787,
-26269,
-24391,
-23369,
-22868,
-22430,
-21942,
-21587,
-21428,
-21255,
-20816,
-20194,
-19627,
-19309,
-19206,
-19274,
-19597,
-20334,
-21501,
-22994,
-24652,
-26393,
-28163,
-29940,
-31704,
-33450,
-35100,
-36514,
-37655,
-38651,
-39707,
-40797,
-41676,
-42117,
-42298,
-42572,
-43161,
-43838,
-44295,
-44462,
-44533,
-44598,
-44428,
-43791,
-42769,
-41736,
-40919,
-40194,
-39309,
-38225,
-37086,
-35858,
-34297,
-32204,
-29861,
-27766,
-26240,
-25129,
-24136,
-23152,
-22314,
-21691,
-21217,
-20841,
-20721,
-20994,
-21598,
-22249,
-22795,
-23359,
-24086,
-24894,
-25530,
-25906,
-26264,
-26927,
-27954,
-29236,
-30634,
-32239,
-33989,
-35662,
-36870,
-37581,
-38072,
-38701,
-39535,
-40383,
-41218,
-42189,
-43470,
-44812,
-45705,
-45830,
-45361,
-44797,
-44371,
-43903,
-42999,
-41558,
-39811,
-38059,
-36407,
-34732,
-32988,
-31229,
-29599,
-28161,
-26911,
-25844,
-24937,
-24174,
-23509,
-22981,
-22590,
-22322,
-22073,
-21866,
-21871,
-22320,
-23243,
-24449,
-25735,
-27097,
-28644,
-30392,
-32115,
-33546,
-34602,
-35343,
-35882,
-36232,
-36424,
-36529,
-36627,
-36684,
-36596,
-36356,
-36107,
-36066,
-36270,
-36553,
-36656,
-36474,
-36094,
-35685,
-35255,
-34689,
-33885,
-33005,
-32375,
-32237,
-32509,
-32898,
-33233,
-33572,
-34044,
-34561,
-34875,
-34896,
-34812,
-34876,
-35062,
-35070,
-34689,
-34051,
-33466,
-33008,
-32464,
-31579,
-30461,
-29479,
-28910,
-28659,
-28396,
-27954,
-27493,
-27348,
-27674,
-28335,
-29054,
-29652,
-30101,
-30468,
-30777,
-31094,
-31488,
-32029,
-32664,
-33296,
-33860,
-34387,
-34883,
-35194,
-35217,
-34982,
-34801,
-34835,
-35013,
-35068,
-34937,
-34822,
-34921,
-35204,
-35472,
-35694,
-35984,
-36380,
-36628,
-36439,
-35793,
-34953,
-34128,
-33278,
-32305,
-31291,
-30476,
-29938,
-29506,
-28996,
-28460,
-28104,
-28052,
-28168,
-28300,
-28382,
-28533,
-28806,
-29219,
-29693,
-30147,
-30527,
-30817,
-31111,
-31533,
-32102,
-32749,
-33395,
-34104,
-34959,
-35961,
-36935,
-37745,
-38348,
-38760,
-38957,
-38896,
-38609,
-38207,
-37717,
-37096,
-36318,
-35473,
-34688,
-33914,
-33076,
-32167,
-31408,
-30941,
-30691,
-30437,
-30088,
-29768,
-29578,
-29469,
-29279,
-29037,
-28939,
-29125,
-29553,
-29973,
-30255,
-30375,
-30435,
-30529,
-30688,
-30917,
-31135,
-31298,
-31417,
-31581,
-31820,
-32016,
-32001,
-31737,
-31388,
-31222,
-31382,
-31835,
-32430,
-33017,
-33542,
-34014,
-34449,
-34751,
-34804,
-34584,
-34302,
-34201,
-34292,
-34294,
-33967,
-33460,
-33212,
-33463,
-33999,
-34357,
-34390,
-34311,
-34441,
-34773,
-35108,
-35307,
-35457,
-35695,
-36007,
-36289,
-36370,
-36200,
-35671,
-34887,
-34023,
-33386,
-33037,
-32800,
-32424,
-31888,
-31389,
-31083,
-30889,
-30629,
-30250,
-29887,
-29641,
-29457,
-29167,
-28748,
-28311,
-27996,
-27791,
-27553,
-27214,
-26839,
-26578,
-26511,
-26639,
-26916,
-27358,
-27926,
-28528,
-29040,
-29493,
-30020,
-30745,
-31533,
-32175,
-32592,
-32974,
-33567,
-34358,
-35217,
-36075,
-37190,
-38797,
-40879,
-43126,
-45268,
-47226,
-48994,
-50342,
-50912,
-50455,
-49012,
-46832,
-44130,
-41114,
-37967,
-34887,
-32014,
-29373,
-27060,
-25139,
-23684,
-22601,
-21816,
-21334,
-21215,
-21410,
-21684,
-21802,
-21683,
-21338,
-20796,
-20069,
-19344,
-18924,
-19083,
-19828,
-21051,
-22675,
-24726,
-27149,
-29730,
-32216,
-34499,
-36567,
-38420,
-40017,
-41418,
-42749,
-44058,
-45164,
-45893,
-46245,
-46477,
-46724,
-46886,
-46757,
-46324,
-45801,
-45337,
-44828,
-44050,
-42887,
-41409,
-39711,
-37769,
-35558,
-33138,
-30713,
-28459,
-26502,
-24815,
-23333,
-21934,
-20611,
-19497,
-18857,
-18778,
-19108,
-19510,
-19836,
-20198,
-20819,
-21734,
-22769,
-23791,
-24826,
-26049,
-27541,
-29233,
-31009,
-32698,
-34186,
-35364,
-36364,
-37461,
-38898,
-40558,
-42042,
-43061,
-43664,
-44122,
-44440,
-44379,
-43712,
-42628,
-41520,
-40591,
-39664,
-38485,
-37081,
-35686,
-34444,
-33285,
-32079,
-30922,
-29951,
-29273,
-28831,
-28645,
-28714,
-28937,
-29074,
-28952,
-28707,
-28504,
-28303,
-27820,
-26960,
-26057,
-25552,
-25506,
-25570,
-25467,
-25367,
-25644,
-26354,
-27186,
-27886,
-28611,
-29721,
-31317,
-33136,
-34930,
-36712,
-38653,
-40691,
-42530,
-43849,
-44619,
-44919,
-44815,
-44224,
-43162,
-41758,
-40259,
-38738,
-37214,
-35628,
-34068,
-32593,
-31233,
-29926,
-28682,
-27617,
-26913,
-26619,
-26613,
-26665,
-26639,
-26574,
-26593,
-26769,
-27062,
-27381,
-27712,
-28126,
-28716,
-29498,
-30365,
-31067,
-31370,
-31244,
-30946,
-30919,
-31395,
-32225,
-33018,
-33560,
-33994,
-34572,
-35294,
-35809,
-35802,
-35291,
-34601,
-33988,
-33419,
-32713,
-31850,
-31034,
-30551,
-30470,
-30615,
-30738,
-30719,
-30725,
-31091,
-32093,
-33769,
-35911,
-38375,
-41109,
-44088,
-46836,
-48573,
-48602,
-46975,
-44424,
-41725,
-39126,
-36362,
-33283,
-30187,
-27565,
-25634,
-24208,
-23095,
-22374,
-22291,
-22874,
-23835,
-24783,
-25511,
-26017,
-26324,
-26408,
-26247,
-25877,
-25387,
-24895,
-24505,
-24374,
-24591,
-25206,
-26219,
-27675,
-29561,
-31765,
-34030,
-36191,
-38185,
-40035,
-41570,
-42656,
-43281,
-43765,
-44308,
-44767,
-44739,
-44093,
-43182,
-42487,
-42066,
-41473,
-40287,
-38618,
-36967,
-35735,
-34859,
-34023,
-33038,
-31953,
-30892,
-29858,
-28807,
-27748,
-26760,
-25931,
-25279,
-24821,
-24541,
-24338,
-24075,
-23685,
-23309,
-23201,
-23488,
-24089,
-24848,
-25729,
-26816,
-28108,
-29420,
-30527,
-31359,
-32008,
-32573,
-33053,
-33509,
-34106,
-35017,
-36147,
-37191,
-37975,
-38676,
-39582,
-40644,
-41401,
-41493,
-41099,
-40827,
-41013,
-41356,
-41252,
-40447,
-39318,
-38406,
-37873,
-37421,
-36647,
-35514,
-34228,
-33027,
-31886,
-30655,
-29260,
-27863,
-26664,
-25785,
-25146,
-24647,
-24308,
-24247,
-24477,
-24891,
-25312,
-25764,
-26360,
-27161,
-27995,
-28682,
-29183,
-29696,
-30336,
-31027,
-31544,
-31771,
-31768,
-31713,
-31712,
-31839,
-32109,
-32519,
-33004,
-33447,
-33788,
-34044,
-34377,
-34953,
-35850,
-36941,
-38002,
-38915,
-39828,
-40892,
-41996,
-42723,
-42773,
-42354,
-41953,
-41778,
-41501,
-40674,
-39274,
-37697,
-36221,
-34759,
-33130,
-31472,
-30056,
-28919,
-27740,
-26352,
-25034,
-24164,
-23750,
-23393,
-22874,
-22491,
-22628,
-23311,
-24117,
-24755,
-25332,
-26069,
-26974,
-27807,
-28500,
-29167,
-29939,
-30698,
-31324,
-31842,
-32481,
-33244,
-33939,
-34389,
-34671,
-35081,
-35705,
-36395,
-36982,
-37516,
-38240,
-39265,
-40404,
-41391,
-42089,
-42617,
-43107,
-43472,
-43412,
-42712,
-41485,
-40129,
-38954,
-37886,
-36574,
-34811,
-32814,
-31055,
-29776,
-28798,
-27753,
-26519,
-25389,
-24648,
-24310,
-24012,
-23483,
-22806,
-22363,
-22447,
-22960,
-23593,
-24087,
-24517,
-25138,
-26142,
-27503,
-29042,
-30571,
-32028,
-33401,
-34687,
-35819,
-36706,
-37368,
-37964,
-38665,
-39441,
-39955,
-39871,
-39204,
-38380,
-37856,
-37655,
-37493,
-37206,
-37039,
-37326,
-37956,
-38408,
-38303,
-37786,
-37334,
-37058,
-36638,
-35704,
-34363,
-33030,
-31917,
-30789,
-29366,
-27715,
-26293,
-25459,
-25154,
-25081,
-24970,
-24849,
-24829,
-24996,
-25334,
-25828,
-26529,
-27448,
-28557,
-29669,
-30641,
-31444,
-32244,
-33269,
-34590,
-36024,
-37266,
-38130,
-38691,
-39156,
-39627,
-39994,
-40018,
-39646,
-39078,
-38638,
-38454,
-38261,
-37679,
-36588,
-35315,
-34272,
-33545,
-32773,
-31669,
-30329,
-29156,
-28345,
-27691,
-26923,
-26101,
-25527,
-25335,
-25249,
-24939,
-24428,
-24123,
-24371,
-25214,
-26401,
-27786,
-29358,
-31159,
-33129,
-35051,
-36681,
-37789,
-38325,
-38434,
-38397,
-38364,
-38255,
-37944,
-37520,
-37331,
-37563,
-38025,
-38260,
-38079,
-37722,
-37576,
-37692,
-37726,
-37314,
-36453,
-35464,
-34640,
-33974,
-33213,
-32134,
-30763,
-29285,
-27962,
-26859,
-26000,
-25373,
-25073,
-25146,
-25530,
-26016,
-26464,
-26846,
-27225,
-27543,
-27775,
-27937,
-28305,
-29042,
-30142,
-31384,
-32653,
-33977,
-35380,
-36662,
-37589,
-38151,
-38593,
-39080,
-39475,
-39502,
-39160,
-38728,
-38421,
-38081,
-37416,
-36411,
-35421,
-34768,
-34364,
-33855,
-33046,
-32084,
-31228,
-30487,
-29672,
-28621,
-27412,
-26248,
-25314,
-24721,
-24517,
-24727,
-25301,
-26213,
-27526,
-29285,
-31351,
-33354,
-34970,
-36201,
-37372,
-38660,
-39895,
-40631,
-40644,
-40052,
-39142,
-38069,
-36828,
-35531,
-34396,
-33652,
-33281,
-33106,
-33031,
-33086,
-33355,
-33756,
-34138,
-34331,
-34270,
-33894,
-33226,
-32365,
-31498,
-30676,
-29791,
-28738,
-27666,
-26945,
-26769,
-26951,
-27042,
-26854,
-26587,
-26601,
-27010,
-27603,
-28141,
-28633,
-29243,
-30124,
-31132,
-32024,
-32578,
-32819,
-32945,
-33163,
-33485,
-33772,
-33933,
-34084,
-34459,
-35092,
-35733,
-36068,
-36047,
-35891,
-35813,
-35794,
-35759,
-35793,
-36185,
-37119,
-38481,
-39974,
-41348,
-42474,
-43277,
-43603,
-43355,
-42503,
-41109,
-39308,
-37279,
-35295,
-33500,
-31860,
-30151,
-28328,
-26592,
-25285,
-24534,
-24137,
-23802,
-23409,
-23009,
-22703,
-22381,
-21914,
-21258,
-20613,
-20206,
-20116,
-20193,
-20373,
-20841,
-21979,
-23912,
-26279,
-28554,
-30587,
-32701,
-35228,
-37961,
-40393,
-42315,
-44085,
-46051,
-47983,
-49197,
-49340,
-48729,
-47907,
-47062,
-46016,
-44774,
-43634,
-42765,
-41909,
-40650,
-39016,
-37389,
-35980,
-34570,
-32914,
-31209,
-29884,
-28958,
-27961,
-26535,
-24933,
-23718,
-23083,
-22735,
-22403,
-22283,
-22623,
-23290,
-23764,
-23845,
-23867,
-24334,
-25217,
-26085,
-26607,
-26971,
-27520,
-28325,
-29143,
-29795,
-30391,
-31113,
-31941,
-32762,
-33503,
-34256,
-34994,
-35590,
-35960,
-36278,
-36790,
-37524,
-38246,
-38754,
-39115,
-39510,
-39928,
-40157,
-40098,
-39965,
-40080,
-40487,
-40926,
-41177,
-41273,
-41397,
-41431,
-41085,
-40133,
-38737,
-37260,
-35819,
-34298,
-32507,
-30566,
-28692,
-27069,
-25631,
-24378,
-23371,
-22765,
-22545,
-22579,
-22734,
-22952,
-23223,
-23473,
-23690,
-23885,
-24140,
-24418,
-24646,
-24843,
-25172,
-25828,
-26788,
-27891,
-28987,
-30177,
-31649,
-33438,
-35307,
-36920,
-38172,
-39262,
-40521,
-42044,
-43617,
-44892,
-45670,
-46031,
-46128,
-45960,
-45414,
-44367,
-42973,
-41470,
-40040,
-38653,
-37181,
-35609,
-34063,
-32691,
-31504,
-30344,
-29085,
-27742,
-26582,
-25839,
-25582,
-25584,
-25611,
-25571,
-25574,
-25654,
-25669,
-25453,
-25041,
-24710,
-24670,
-24925,
-25333,
-25871,
-26612,
-27542,
-28520,
-29412,
-30323,
-31425,
-32699,
-33904,
-34811,
-35434,
-35953,
-36495,
-37090,
-37711,
-38326,
-38780,
-38917,
-38773,
-38639,
-38786,
-39059,
-39120,
-38793,
-38388,
-38206,
-38136,
-37689,
-36682,
-35444,
-34536,
-34013,
-33508,
-32659,
-31636,
-30799,
-30315,
-29950,
-29484,
-28969,
-28609,
-28461,
-28361,
-28212,
-28106,
-28222,
-28563,
-28941,
-29204,
-29337,
-29452,
-29567,
-29665,
-29780,
-30053,
-30591,
-31326,
-32038,
-32556,
-32840,
-32968,
-33012,
-33071,
-33270,
-33681,
-34179,
-34510,
-34579,
-34621,
-34951,
-35557,
-36046,
-36088,
-35864,
-35820,
-36117,
-36373,
-36159,
-35508,
-34917,
-34644,
-34506,
-34047,
-33171,
-32105,
-31122,
-30319,
-29665,
-29236,
-28996,
-28845,
-28673,
-28630,
-28926,
-29499,
-29988,
-30199,
-30416,
-31116,
-32292,
-33414,
-34030,
-34275,
-34694,
-35435,
-36170,
-36440,
-36334,
-36229,
-36338,
-36420,
-36120,
-35425,
-34617,
-34006,
-33656,
-33434,
-33174,
-32729,
-32072,
-31243,
-30389,
-29529,
-28637,
-27704,
-26936,
-26597,
-26733,
-27064,
-27257,
-27302,
-27488,
-28069,
-28932,
-29716,
-30225,
-30647,
-31409,
-32719,
-34369,
-35890,
-37012,
-37810,
-38615,
-39498,
-40228,
-40447,
-40144,
-39667,
-39357,
-39195,
-38870,
-38176,
-37271,
-36440,
-35771,
-35111,
-34284,
-33318,
-32371,
-31516,
-30759,
-30036,
-29329,
-28532,
-27570,
-26479,
-25498,
-24807,
-24371,
-23979,
-23610,
-23546,
-24100,
-25240,
-26585,
-27825,
-28978,
-30311,
-31906,
-33575,
-35053,
-36191,
-37033,
-37573,
-37871,
-38001,
-38144,
-38315,
-38392,
-38264,
-38003,
-37881,
-37973,
-38179,
-38251,
-38146,
-37922,
-37621,
-37170,
-36532,
-35794,
-35071,
-34352,
-33543,
-32676,
-31910,
-31333,
-30821,
-30172,
-29457,
-28934,
-28808,
-28915,
-28983,
-28933,
-28908,
-28966,
-28868,
-28345,
-27443,
-26535,
-25862,
-25369,
-24896,
-24509,
-24488,
-24905,
-25526,
-26130,
-26778,
-27732,
-28945,
-30071,
-30775,
-31217,
-31841,
-32958,
-34505,
-36326,
-38397,
-40772,
-43306,
-45645,
-47504,
-48776,
-49434,
-49405,
-48738,
-47741,
-46824,
-46031,
-44980,
-43278,
-40987,
-38572,
-36320,
-34145,
-31813,
-29432,
-27369,
-25812,
-24560,
-23267,
-21900,
-20691,
-19875,
-19404,
-19155,
-19067,
-19222,
-19618,
-20206,
-20863,
-21585,
-22293,
-23012,
-23790,
-24834,
-26166,
-27565,
-28645,
-29340,
-29983,
-30987,
-32355,
-33722,
-34793,
-35703,
-36784,
-38099,
-39328,
-40179,
-40723,
-41360,
-42323,
-43510,
-44610,
-45450,
-46093,
-46652,
-47153,
-47512,
-47672,
-47663,
-47582,
-47436,
-47036,
-46048,
-44171,
-41437,
-38180,
-34815,
-31537,
-28343,
-25251,
-22477,
-20250,
-18605,
-17355,
-16334,
-15560,
-15127,
-15059,
-15255,
-15675,
-16289,
-17039,
-17764,
-18379,
-19013,
-19882,
-21078,
-22514,
-24179,
-26198,
-28705,
-31506,
-34193,
-36514,
-38574,
-40673,
-42861,
-44883,
-46491,
-47658,
-48579,
-49386,
-50047,
-50463,
-50533,
-50143,
-49207,
-47740,
-45968,
-44136,
-42367,
-40617,
-38895,
-37309,
-35917,
-34519,
-32830,
-30757,
-28586,
-26666,
-25088,
-23687,
-22305,
-21088,
-20227,
-19774,
-19503,
-19260,
-19148,
-19449,
-20320,
-21628,
-23058,
-24435,
-25717,
-27019,
-28396,
-29833,
-31296,
-32695,
-33947,
-34961,
-35738,
-36324,
-36773,
-37043,
-37113,
-37068,
-37135,
-37441,
-37839,
-37963,
-37583,
-36881,
-36262,
-35994,
-35931,
-35765,
-35395,
-35015,
-34900,
-35074,
-35362,
-35553,
-35578,
-35422,
-35167,
-34895,
-34773,
-34805,
-34802,
-34532,
-33982,
-33417,
-33052,
-32801,
-32397,
-31758,
-31157,
-30866,
-30907,
-30985,
-30901,
-30670,
-30363,
-29929,
-29274,
-28510,
-28016,
-28038,
-28506,
-29013,
-29277,
-29258,
-29149,
-29109,
-29203,
-29477,
-29940,
-30538,
-31126,
-31534,
-31723,
-31762,
-31755,
-31712,
-31607,
-31459,
-31437,
-31787,
-32645,
-33933,
-35344,
-36578,
-37489,
-38156,
-38729,
-39308,
-39878,
-40394,
-40785,
-40996,
-40936,
-40501,
-39612,
-38282,
-36637,
-34941,
-33428,
-32227,
-31273,
-30437,
-29636,
-28830,
-28006,
-27142,
-26377,
-25911,
-25879,
-26045,
-26069,
-25795,
-25543,
-25681,
-26266,
-26943,
-27446,
-27949,
-28798,
-30076,
-31434,
-32531,
-33391,
-34270,
-35265,
-36172,
-36793,
-37160,
-37431,
-37655,
-37733,
-37636,
-37451,
-37228,
-36913,
-36517,
-36216,
-36225,
-36436,
-36515,
-36293,
-35969,
-35854,
-35887,
-35679,
-34999,
-34115,
-33427,
-33016,
-32496,
-31578,
-30448,
-29557,
-29163,
-29062,
-28953,
-28722,
-28471,
-28272,
-28037,
-27717,
-27349,
-27021,
-26694,
-26275,
-25823,
-25605,
-25912,
-26710,
-27679,
-28466,
-29082,
-29859,
-31134,
-32834,
-34569,
-36021,
-37260,
-38672,
-40380,
-42061,
-43122,
-43322,
-42960,
-42533,
-42205,
-41691,
-40611,
-39038,
-37350,
-35988,
-34999,
-34166,
-33312,
-32448,
-31732,
-31197,
-30797,
-30416,
-30046,
-29710,
-29416,
-29161,
-28891,
-28603,
-28252,
-27888,
-27647,
-27675,
-27986,
-28337,
-28466,
-28337,
-28170,
-28195,
-28351,
-28399,
-28260,
-28155,
-28408,
-29079,
-29946,
-30790,
-31555,
-32281,
-32882,
-33206,
-33286,
-33328,
-33511,
-33689,
-33620,
-33267,
-33010,
-33182,
-33724,
-34142,
-34085,
-33747,
-33757,
-34540,
-35999,
-37622,
-39140,
-40628,
-42289,
-43913,
-44914,
-44784,
-43563,
-41797,
-40022,
-38434,
-36929,
-35401,
-33903,
-32541,
-31368,
-30419,
-29732,
-29346,
-29190,
-29144,
-29097,
-28945,
-28544,
-27743,
-26560,
-25244,
-24039,
-22983,
-21944,
-20870,
-19991,
-19494,
-19442,
-19686,
-20253,
-21246,
-22704,
-24422,
-26230,
-28206,
-30562,
-33207,
-35787,
-38005,
-40038,
-42198,
-44487,
-46500,
-47976,
-49109,
-50233,
-51233,
-51542,
-50780,
-49200,
-47422,
-45727,
-43880,
-41581,
-38897,
-36196,
-33721,
-31393,
-29129,
-27021,
-25313,
-24108,
-23270,
-22586,
-21934,
-21287,
-20722,
-20324,
-20226,
-20469,
-20986,
-21675,
-22519,
-23568,
-24850,
-26213,
-27548,
-28822,
-30163,
-31614,
-33050,
-34304,
-35315,
-36212,
-37097,
-37964,
-38671,
-39152,
-39464,
-39726,
-39960,
-40071,
-39951,
-39639,
-39284,
-38985,
-38640,
-38010,
-36974,
-35663,
-34389,
-33380,
-32635,
-32028,
-31480,
-31025,
-30764,
-30714,
-30802,
-30921,
-30968,
-30971,
-31021,
-31222,
-31486,
-31585,
-31290,
-30683,
-30056,
-29679,
-29517,
-29358,
-29089,
-28801,
-28596,
-28382,
-28027,
-27614,
-27510,
-28052,
-29216,
-30721,
-32224,
-33655,
-34984,
-36178,
-37111,
-37766,
-38229,
-38612,
-38879,
-38945,
-38745,
-38355,
-37830,
-37193,
-36379,
-35440,
-34538,
-33878,
-33518,
-33278,
-32960,
-32527,
-32168,
-32031,
-31981,
-31710,
-31070,
-30312,
-29848,
-29814,
-29956,
-29930,
-29704,
-29537,
-29643,
-29937,
-30175,
-30273,
-30350,
-30603,
-30991,
-31323,
-31384,
-31187,
-30961,
-30971,
-31303,
-31683,
-31774,
-31428,
-30936,
-30695,
-30786,
-30872,
-30610,
-30078,
-29680,
-29632,
-29696,
-29486,
-29043,
-28820,
-29272,
-30329,
-31655,
-33063,
-34778,
-37114,
-40015,
-43078,
-45839,
-48071,
-49745,
-50775,
-51002,
-50210,
-48365,
-45570,
-42162,
-38550,
-35129,
-32070,
-29301,
-26725,
-24473,
-22863,
-22109,
-22038,
-22208,
-22271,
-22253,
-22300,
-22462,
-22517,
-22287,
-21810,
-21384,
-21225,
-21395,
-21786,
-22335,
-23120,
-24300,
-26049,
-28386,
-31101,
-33833,
-36202,
-38126,
-39691,
-41062,
-42171,
-42857,
-43023,
-42784,
-42358,
-41887,
-41405,
-40865,
-40229,
-39454,
-38595,
-37757,
-37084,
-36573,
-36111,
-35646,
-35335,
-35371,
-35740,
-36115,
-36222,
-36110,
-36028,
-36093,
-36015,
-35492,
-34474,
-33262,
-32112,
-30989,
-29683,
-28092,
-26363,
-24757,
-23472,
-22539,
-21926,
-21551,
-21431,
-21648,
-22317,
-23413,
-24725,
-25994,
-27094,
-28118,
-29113,
-30027,
-30646,
-30935,
-31042,
-31240,
-31711,
-32502,
-33557,
-34826,
-36169,
-37457,
-38550,
-39402,
-40040,
-40490,
-40823,
-41120,
-41474,
-41863,
-42171,
-42220,
-41987,
-41472,
-40713,
-39637,
-38276,
-36831,
-35610,
-34708,
-33890,
-32778,
-31307,
-29831,
-28822,
-28396,
-28192,
-27793,
-27052,
-26229,
-25567,
-25150,
-24894,
-24775,
-24871,
-25220,
-25757,
-26368,
-26990,
-27604,
-28201,
-28734,
-29270,
-29888,
-30670,
-31587,
-32564,
-33539,
-34501,
-35362,
-36056,
-36532,
-36845,
-37122,
-37452,
-37895,
-38411,
-38888,
-39150,
-39087,
-38779,
-38382,
-38019,
-37636,
-37139,
-36531,
-35900,
-35299,
-34693,
-34007,
-33234,
-32390,
-31542,
-30841,
-30468,
-30437,
-30468,
-30159,
-29445,
-28670,
-28223,
-28135,
-28050,
-27812,
-27593,
-27686,
-28062,
-28406,
-28571,
-28651,
-28774,
-28756,
-28380,
-27724,
-27201,
-27063,
-27155,
-27179,
-27146,
-27382,
-28080,
-29087,
-30184,
-31481,
-33421,
-36328,
-40055,
-44109,
-47894,
-51029,
-53214,
-54311,
-54212,
-52969,
-50745,
-47851,
-44633,
-41317,
-37893,
-34262,
-30525,
-27102,
-24462,
-22761,
-21793,
-21294,
-21198,
-21512,
-22079,
-22580,
-22778,
-22702,
-22488,
-22213,
-21918,
-21730,
-21829,
-22245,
-22858,
-23570,
-24524,
-25903,
-27696,
-29704,
-31753,
-33874,
-36063,
-38115,
-39704,
-40726,
-41409,
-41969,
-42409,
-42473,
-42075,
-41369,
-40631,
-39959,
-39299,
-38553,
-37792,
-37114,
-36705,
-36600,
-36775,
-37032,
-37171,
-37156,
-37130,
-37245,
-37391,
-37314,
-36808,
-36015,
-35138,
-34247,
-33137,
-31613,
-29770,
-27886,
-26236,
-24845,
-23635,
-22580,
-21747,
-21246,
-21065,
-21200,
-21648,
-22443,
-23579,
-24905,
-26272,
-27563,
-28813,
-30012,
-31124,
-32043,
-32746,
-33289,
-33716,
-34017,
-34219,
-34476,
-34951,
-35650,
-36381,
-37021,
-37655,
-38479,
-39398,
-40143,
-40491,
-40654,
-40919,
-41332,
-41536,
-41302,
-40726,
-40048,
-39237,
-38002,
-36319,
-34564,
-33193,
-32214,
-31306,
-30318,
-29461,
-29004,
-28817,
-28587,
-28194,
-27861,
-27798,
-27907,
-27974,
-27911,
-27817,
-27716,
-27552,
-27391,
-27433,
-27802,
-28297,
-28657,
-28933,
-29445,
-30375,
-31463,
-32314,
-32848,
-33318,
-33858,
-34256,
-34192,
-33716,
-33239,
-33170,
-33511,
-33973,
-34297,
-34474,
-34677,
-35061,
-35585,
-36106,
-36449,
-36615,
-36732,
-36922,
-37121,
-37102,
-36664,
-35833,
-34810,
-33851,
-33052,
-32398,
-31737,
-31021,
-30259,
-29619,
-29178,
-28894,
-28676,
-28580,
-28799,
-29401,
-30152,
-30745,
-31174,
-31719,
-32552,
-33422,
-33991,
-34302,
-34782,
-35669,
-36668,
-37281,
-37377,
-37240,
-37007,
-36488,
-35467,
-34200,
-33210,
-32663,
-32257,
-31629,
-30895,
-30399,
-30221,
-30071,
-29717,
-29326,
-29142,
-29153,
-29051,
-28675,
-28165,
-27666,
-27158,
-26567,
-26103,
-26112,
-26716,
-27714,
-28892,
-30379,
-32340,
-34614,
-36645,
-38052,
-38982,
-39872,
-40900,
-41787,
-42197,
-42127,
-41795,
-41356,
-40645,
-39493,
-37928,
-36222,
-34682,
-33483,
-32644,
-32020,
-31368,
-30520,
-29515,
-28644,
-28075,
-27739,
-27344,
-26832,
-26408,
-26383,
-26723,
-27176,
-27521,
-27843,
-28392,
-29233,
-30229,
-31123,
-31790,
-32245,
-32579,
-32957,
-33428,
-33910,
-34160,
-34117,
-34050,
-34344,
-35013,
-35572,
-35563,
-35106,
-34807,
-35042,
-35509,
-35666,
-35425,
-35278,
-35669,
-36410,
-36989,
-37097,
-36963,
-36871,
-36844,
-36645,
-36135,
-35352,
-34429,
-33453,
-32578,
-31884,
-31291,
-30527,
-29514,
-28516,
-27919,
-27659,
-27255,
-26361,
-25207,
-24374,
-24083,
-24035,
-23919,
-23801,
-24027,
-24642,
-25338,
-25833,
-26204,
-26707,
-27454,
-28432,
-29725,
-31574,
-34075,
-37019,
-40096,
-43179,
-46195,
-48881,
-50770,
-51600,
-51573,
-51077,
-50255,
-48875,
-46784,
-44129,
-41283,
-38478,
-35731,
-33078,
-30671,
-28735,
-27322,
-26378,
-25753,
-25316,
-24884,
-24315,
-23605,
-22875,
-22211,
-21606,
-21035,
-20598,
-20462,
-20643,
-21034,
-21571,
-22359,
-23552,
-25076,
-26708,
-28250,
-29749,
-31287,
-32817,
-34125,
-35089,
-35768,
-36337,
-36874,
-37358,
-37749,
-38015,
-38153,
-38162,
-38147,
-38252,
-38571,
-39007,
-39496,
-40025,
-40740,
-41599,
-42380,
-42842,
-42982,
-43002,
-42999,
-42798,
-42104,
-40848,
-39208,
-37432,
-35556,
-33550,
-31444,
-29483,
-27877,
-26632,
-25555,
-24487,
-23444,
-22660,
-22286,
-22302,
-22479,
-22568,
-22532,
-22530,
-22805,
-23415,
-24176,
-24798,
-25139,
-25321,
-25589,
-26099,
-26776,
-27506,
-28267,
-29243,
-30559,
-32137,
-33672,
-34892,
-35749,
-36427,
-37167,
-38105,
-39299,
-40725,
-42307,
-43837,
-45104,
-45922,
-46322,
-46352,
-46111,
-45636,
-45007,
-44300,
-43519,
-42566,
-41296,
-39692,
-37807,
-35790,
-33755,
-31820,
-30032,
-28413,
-26920,
-25564,
-24449,
-23579,
-22896,
-22230,
-21597,
-21187,
-21183,
-21529,
-21950,
-22251,
-22497,
-22883,
-23502,
-24243,
-24964,
-25650,
-26401,
-27310,
-28370,
-29531,
-30735,
-31982,
-33306,
-34757,
-36327,
-37890,
-39302,
-40457,
-41409,
-42225,
-42880,
-43296,
-43404,
-43283,
-42996,
-42595,
-42078,
-41473,
-40833,
-40128,
-39308,
-38374,
-37401,
-36467,
-35508,
-34471,
-33399,
-32407,
-31496,
-30489,
-29275,
-27997,
-26920,
-26074,
-25211,
-24098,
-22900,
-22009,
-21659,
-21727,
-21998,
-22516,
-23448,
-24806,
-26313,
-27721,
-29097,
-30667,
-32479,
-34285,
-35771,
-36879,
-37721,
-38365,
-38813,
-38993,
-38989,
-38818,
-38496,
-38026,
-37532,
-37086,
-36617,
-35935,
-35096,
-34407,
-34217,
-34425,
-34680,
-34761,
-34883,
-35322,
-35940,
-36220,
-35836,
-35059,
-34386,
-33991,
-33532,
-32680,
-31548,
-30536,
-29835,
-29274,
-28592,
-27812,
-27119,
-26651,
-26343,
-26139,
-26051,
-26081,
-26173,
-26269,
-26452,
-26803,
-27242,
-27544,
-27639,
-27734,
-28100,
-28792,
-29658,
-30658,
-31978,
-33799,
-36057,
-38440,
-40736,
-42855,
-44713,
-46061,
-46677,
-46653,
-46331,
-45968,
-45429,
-44379,
-42658,
-40495,
-38277,
-36248,
-34369,
-32549,
-30817,
-29370,
-28357,
-27694,
-27135,
-26470,
-25733,
-25149,
-24870,
-24821,
-24774,
-24565,
-24279,
-24070,
-24066,
-24244,
-24527,
-24881,
-25333,
-25901,
-26635,
-27458,
-28293,
-29019,
-29685,
-30461,
-31512,
-32803,
-34115,
-35246,
-36172,
-36942,
-37570,
-37973,
-38213,
-38428,
-38757,
-39140,
-39425,
-39627,
-39889,
-40279,
-40612,
-40626,
-40276,
-39784,
-39326,
-38834,
-38109,
-37088,
-35986,
-35021,
-34262,
-33579,
-32877,
-32135,
-31411,
-30771,
-30259,
-29908,
-29677,
-29436,
-29124,
-28750,
-28394,
-28043,
-27619,
-27129,
-26736,
-26584,
-26635,
-26675,
-26632,
-26680,
-27072,
-27796,
-28539,
-28956,
-28985,
-28786,
-28561,
-28351,
-28191,
-28151,
-28395,
-28966,
-29822,
-30810,
-31823,
-32762,
-33600,
-34380,
-35264,
-36423,
-37919,
-39657,
-41462,
-43133,
-44535,
-45516,
-46017,
-46027,
-45604,
-44770,
-43545,
-42033,
-40395,
-38755,
-37046,
-35121,
-32996,
-30911,
-29189,
-27899,
-26935,
-26156,
-25610,
-25357,
-25312,
-25244,
-25073,
-24943,
-25069,
-25444,
-25831,
-26080,
-26258,
-26590,
-27120,
-27677,
-28034,
-28155,
-28157,
-28190,
-28334,
-28633,
-29193,
-30023,
-31019,
-31935,
-32637,
-33203,
-33868,
-34688,
-35504,
-36048,
-36398,
-36980,
-38231,
-40017,
-41674,
-42516,
-42570,
-42417,
-42577,
-42823,
-42550,
-41451,
-40005,
-38897,
-38319,
-37757,
-36642,
-34926,
-33095,
-31583,
-30473,
-29551,
-28627,
-27683,
-26767,
-25973,
-25352,
-24930,
-24637,
-24449,
-24458,
-24846,
-25606,
-26507,
-27228,
-27753,
-28284,
-29007,
-29849,
-30628,
-31279,
-31869,
-32371,
-32681,
-32783,
-32870,
-33201,
-33770,
-34395,
-34910,
-35356,
-35816,
-36261,
-36607,
-36827,
-36986,
-37081,
-37089,
-37078,
-37198,
-37460,
-37615,
-37396,
-36908,
-36494,
-36352,
-36208,
-35683,
-34749,
-33754,
-32948,
-32189,
-31249,
-30196,
-29389,
-28973,
-28712,
-28302,
-27771,
-27425,
-27370,
-27395,
-27265,
-27087,
-27204,
-27782,
-28630,
-29446,
-30149,
-30838,
-31630,
-32481,
-33324,
-34139,
-34902,
-35532,
-35957,
-36190,
-36356,
-36511,
-36621,
-36625,
-36598,
-36596,
-36636,
-36567,
-36298,
-35905,
-35544,
-35302,
-35076,
-34771,
-34386,
-34094,
-33998,
-34020,
-33949,
-33578,
-32942,
-32180,
-31477,
-30815,
-30100,
-29246,
-28388,
-27737,
-27443,
-27396,
-27393,
-27277,
-27167,
-27223,
-27551,
-28008,
-28438,
-28729,
-28942,
-29141,
-29319,
-29449,
-29550,
-29762,
-30228,
-30976,
-31920,
-32933,
-34020,
-35263,
-36725,
-38292,
-39745,
-40899,
-41780,
-42539,
-43212,
-43704,
-43767,
-43358,
-42551,
-41503,
-40230,
-38697,
-36935,
-35113,
-33386,
-31806,
-30326,
-29002,
-27936,
-27235,
-26799,
-26444,
-26040,
-25630,
-25373,
-25405,
-25720,
-26217,
-26711,
-27135,
-27558,
-28154,
-28987,
-29914,
-30692,
-31238,
-31702,
-32192,
-32683,
-32970,
-33066,
-33170,
-33457,
-33852,
-34104,
-34127,
-34027,
-33938,
-33794,
-33510,
-33098,
-32679,
-32217,
-31562,
-30684,
-29840,
-29339,
-29162,
-29071,
-28898,
-28829,
-29154,
-29938,
-31113,
-32751,
-35106,
-38239,
-41752,
-44939,
-47366,
-48923,
-49643,
-49357,
-47904,
-45456,
-42506,
-39548,
-36687,
-33879,
-31167,
-28846,
-27144,
-26007,
-25251,
-24801,
-24823,
-25379,
-26212,
-26849,
-26968,
-26618,
-26008,
-25199,
-24071,
-22647,
-21274,
-20410,
-20227,
-20461,
-20907,
-21681,
-23248,
-25809,
-28998,
-32121,
-34683,
-36709,
-38568,
-40479,
-42259,
-43415,
-43606,
-43007,
-42323,
-42181,
-42579,
-42885,
-42525,
-41623,
-40819,
-40454,
-40179,
-39410,
-38127,
-36855,
-36010,
-35351,
-34358,
-32916,
-31371,
-30030,
-28825,
-27615,
-26586,
-26127,
-26295,
-26742,
-27096,
-27357,
-27695,
-28083,
-28252,
-28092,
-27785,
-27601,
-27595,
-27670,
-27856,
-28305,
-29052,
-29942,
-30767,
-31558,
-32459,
-33529,
-34678,
-35761,
-36734,
-37542,
-38130,
-38436,
-38435,
-38128,
-37457,
-36515,
-35529,
-34798,
-34334,
-33925,
-33359,
-32728,
-32199,
-31776,
-31265,
-30627,
-30162,
-30096,
-30356,
-30508,
-30419,
-30304,
-30531,
-31026,
-31509,
-31755,
-31954,
-32276,
-32673,
-32906,
-32972,
-33110,
-33486,
-33918,
-34089,
-34035,
-34089,
-34540,
-35177,
-35554,
-35513,
-35335,
-35424,
-35724,
-35826,
-35394,
-34609,
-33901,
-33515,
-33256,
-32825,
-32197,
-31614,
-31235,
-30917,
-30398,
-29663,
-28948,
-28530,
-28400,
-28403,
-28421,
-28486,
-28637,
-28809,
-28913,
-28961,
-29066,
-29329,
-29778,
-30436,
-31322,
-32398,
-33505,
-34518,
-35438,
-36389,
-37352,
-38165,
-38646,
-38852,
-38946,
-38996,
-38841,
-38350,
-37576,
-36737,
-35921,
-35074,
-34091,
-33036,
-31967,
-30908,
-29842,
-28858,
-28094,
-27545,
-27006,
-26379,
-25812,
-25582,
-25694,
-25854,
-25858,
-25894,
-26438,
-27703,
-29536,
-31528,
-33492,
-35343,
-37063,
-38525,
-39681,
-40536,
-41106,
-41354,
-41292,
-41086,
-40819,
-40331,
-39327,
-37738,
-35959,
-34484,
-33472,
-32699,
-31883,
-31081,
-30491,
-30226,
-30136,
-30073,
-29984,
-29918,
-29907,
-29911,
-29986,
-30099,
-30168,
-30052,
-29699,
-29330,
-29121,
-29158,
-29249,
-29224,
-29061,
-28881,
-28837,
-28943,
-29064,
-28990,
-28640,
-28158,
-27892,
-28038,
-28472,
-28843,
-28979,
-29092,
-29557,
-30494,
-31687,
-32853,
-33959,
-35179,
-36639,
-38228,
-39766,
-41141,
-42381,
-43551,
-44647,
-45626,
-46393,
-46829,
-46817,
-46289,
-45243,
-43687,
-41634,
-39185,
-36547,
-33992,
-31660,
-29546,
-27573,
-25750,
-24152,
-22889,
-22034,
-21633,
-21617,
-21835,
-22066,
-22268,
-22538,
-22982,
-23518,
-23952,
-24255,
-24591,
-25164,
-25899,
-26574,
-27048,
-27466,
-28055,
-28920,
-29950,
-31028,
-32069,
-33142,
-34277,
-35575,
-36999,
-38373,
-39428,
-40063,
-40474,
-40939,
-41455,
-41718,
-41552,
-41156,
-40959,
-41057,
-41103,
-40739,
-40002,
-39321,
-39044,
-39155,
-39432,
-39673,
-39798,
-39728,
-39408,
-38817,
-37910,
-36562,
-34572,
-32028,
-29292,
-26784,
-24604,
-22559,
-20596,
-18980,
-18050,
-17871,
-18161,
-18725,
-19584,
-20854,
-22425,
-23949,
-25168,
-26041,
-26709,
-27263,
-27753,
-28196,
-28718,
-29398,
-30371,
-31704,
-33403,
-35255,
-36911,
-38149,
-39045,
-39951,
-41064,
-42339,
-43518,
-44508,
-45332,
-46025,
-46403,
-46289,
-45613,
-44569,
-43346,
-42013,
-40570,
-39005,
-37393,
-35751,
-34069,
-32386,
-30845,
-29588,
-28589,
-27674,
-26709,
-25763,
-24996,
-24442,
-23999,
-23587,
-23312,
-23346,
-23686,
-24170,
-24625,
-25093,
-25713,
-26502,
-27356,
-28152,
-28924,
-29765,
-30688,
-31624,
-32522,
-33383,
-34167,
-34752,
-35046,
-35102,
-35089,
-35138,
-35250,
-35391,
-35535,
-35646,
-35656,
-35507,
-35272,
-35086,
-34963,
-34811,
-34591,
-34529,
-34932,
-35838,
-36898,
-37659,
-38005,
-38175,
-38433,
-38701,
-38676,
-38139,
-37246,
-36328,
-35579,
-34866,
-33893,
-32567,
-31103,
-29906,
-29197,
-28870,
-28604,
-28203,
-27729,
-27407,
-27326,
-27394,
-27419,
-27376,
-27402,
-27628,
-28031,
-28429,
-28660,
-28770,
-28917,
-29274,
-29775,
-30311,
-30776,
-31284,
-31971,
-32804,
-33596,
-34154,
-34497,
-34800,
-35170,
-35547,
-35827,
-36015,
-36212,
-36487,
-36739,
-36861,
-36813,
-36702,
-36621,
-36613,
-36588,
-36416,
-35991,
-35359,
-34730,
-34331,
-34153,
-33983,
-33608,
-33148,
-32856,
-32789,
-32634,
-32064,
-31152,
-30378,
-30042,
-29989,
-29757,
-29164,
-28453,
-27993,
-27876,
-27909,
-27930,
-27956,
-28094,
-28387,
-28789,
-29283,
-29860,
-30478,
-31083,
-31704,
-32457,
-33375,
-34320,
-35057,
-35509,
-35762,
-36012,
-36268,
-36484,
-36576,
-36589,
-36600,
-36633,
-36652,
-36582,
-36348,
-35919,
-35323,
-34708,
-34211,
-33904,
-33701,
-33468,
-33146,
-32785,
-32473,
-32223,
-31990,
-31689,
-31313,
-30912,
-30559,
-30289,
-30079,
-29844,
-29592,
-29382,
-29326,
-29477,
-29713,
-29935,
-30070,
-30184,
-30325,
-30437,
-30429,
-30301,
-30177,
-30158,
-30206,
-30156,
-29947,
-29661,
-29446,
-29360,
-29404,
-29654,
-30262,
-31300,
-32632,
-34029,
-35412,
-36846,
-38404,
-39935,
-41262,
-42309,
-43186,
-43875,
-44160,
-43762,
-42682,
-41253,
-39792,
-38405,
-36943,
-35328,
-33658,
-32095,
-30751,
-29625,
-28729,
-28071,
-27611,
-27239,
-26879,
-26570,
-26393,
-26362,
-26339,
-26153,
-25786,
-25418,
-25280,
-25452,
-25759,
-26001,
-26180,
-26531,
-27280,
-28352,
-29433,
-30316,
-31070,
-31924,
-32924,
-33872,
-34551,
-34961,
-35213,
-35381,
-35409,
-35291,
-35088,
-34859,
-34534,
-34127,
-33807,
-33889,
-34443,
-35289,
-36140,
-36942,
-37888,
-39073,
-40481,
-41940,
-43365,
-44613,
-45422,
-45498,
-44709,
-43243,
-41334,
-39152,
-36725,
-34196,
-31786,
-29706,
-27951,
-26427,
-25041,
-23882,
-23048,
-22621,
-22573,
-22788,
-23097,
-23305,
-23307,
-23115,
-22789,
-22427,
-22093,
-21969,
-22238,
-22990,
-24094,
-25332,
-26583,
-27933,
-29506,
-31305,
-33248,
-35274,
-37436,
-39720,
-41949,
-43809,
-45132,
-45965,
-46478,
-46702,
-46535,
-45932,
-45082,
-44231,
-43444,
-42422,
-40908,
-38944,
-37001,
-35498,
-34473,
-33517,
-32307,
-30846,
-29494,
-28488,
-27715,
-26881,
-25860,
-24890,
-24323,
-24240,
-24360,
-24311,
-23986,
-23628,
-23548,
-23866,
-24472,
-25258,
-26239,
-27482,
-28945,
-30444,
-31862,
-33161,
-34393,
-35484,
-36309,
-36833,
-37190,
-37560,
-37987,
-38309,
-38400,
-38272,
-38091,
-37965,
-37809,
-37453,
-36834,
-36069,
-35358,
-34772,
-34233,
-33636,
-33010,
-32419,
-31893,
-31263,
-30434,
-29473,
-28654,
-28189,
-28056,
-28106,
-28280,
-28724,
-29589,
-30796,
-32040,
-32946,
-33418,
-33605,
-33791,
-34141,
-34573,
-34861,
-34832,
-34542,
-34180,
-33956,
-33833,
-33687,
-33377,
-32920,
-32412,
-31948,
-31619,
-31499,
-31666,
-32089,
-32672,
-33274,
-33845,
-34334,
-34637,
-34616,
-34192,
-33493,
-32764,
-32193,
-31786,
-31460,
-31101,
-30779,
-30518,
-30408,
-30405,
-30545,
-30826,
-31268,
-31776,
-32265,
-32705,
-33139,
-33603,
-33984,
-34156,
-34100,
-33933,
-33841,
-33840,
-33911,
-34011,
-34163,
-34331,
-34450,
-34498,
-34577,
-34759,
-34955,
-34938,
-34621,
-34089,
-33460,
-32688,
-31690,
-30578,
-29618,
-28903,
-28175,
-27158,
-25945,
-24985,
-24579,
-24544,
-24490,
-24338,
-24395,
-25006,
-26153,
-27576,
-29167,
-31064,
-33462,
-36346,
-39460,
-42486,
-45104,
-47046,
-48179,
-48576,
-48425,
-47810,
-46575,
-44600,
-42008,
-39261,
-36754,
-34573,
-32565,
-30670,
-29106,
-28139,
-27771,
-27679,
-27575,
-27408,
-27337,
-27398,
-27393,
-27152,
-26714,
-26327,
-26130,
-26020,
-25839,
-25534,
-25200,
-24887,
-24619,
-24499,
-24748,
-25471,
-26519,
-27597,
-28575,
-29521,
-30508,
-31365,
-31932,
-32216,
-32477,
-32943,
-33659,
-34604,
-35788,
-37175,
-38620,
-40017,
-41476,
-43235,
-45202,
-46885,
-47772,
-47870,
-47573,
-47102,
-46185,
-44496,
-42227,
-39959,
-38050,
-36225,
-34054,
-31579,
-29310,
-27661,
-26486,
-25448,
-24473,
-23874,
-23830,
-24116,
-24342,
-24338,
-24304,
-24382,
-24552,
-24665,
-24748,
-24911,
-25179,
-25454,
-25730,
-26184,
-26958,
-27914,
-28734,
-29314,
-29893,
-30674,
-31507,
-31961,
-31894,
-31704,
-31859,
-32434,
-33056,
-33505,
-34018,
-34904,
-36059,
-36989,
-37493,
-37932,
-38844,
-40244,
-41658,
-42713,
-43579,
-44567,
-45588,
-46095,
-45720,
-44656,
-43405,
-42151,
-40717,
-38918,
-36973,
-35251,
-33859,
-32546,
-30986,
-29208,
-27465,
-26030,
-24918,
-23972,
-23052,
-22159,
-21479,
-21193,
-21374,
-21827,
-22320,
-22723,
-23193,
-23877,
-24709,
-25389,
-25709,
-25795,
-25986,
-26420,
-26961,
-27429,
-27953,
-28911,
-30437,
-32213,
-33704,
-34745,
-35710,
-37074,
-38904,
-40841,
-42591,
-44256,
-46118,
-48104,
-49705,
-50391,
-50084,
-49128,
-47842,
-46289,
-44415,
-42298,
-40181,
-38159,
-36141,
-33925,
-31479,
-28962,
-26639,
-24759,
-23448,
-22712,
-22359,
-22206,
-22092,
-22020,
-21987,
-22004,
-22119,
-22460,
-23117,
-24004,
-24918,
-25731,
-26505,
-27317,
-28171,
-28986,
-29825,
-30802,
-31960,
-33120,
-34123,
-34913,
-35600,
-36191,
-36657,
-37004,
-37342,
-37741,
-38125,
-38418,
-38648,
-38890,
-39100,
-39166,
-39161,
-39291,
-39612,
-39799,
-39507,
-38857,
-38321,
-38131,
-37879,
-37019,
-35568,
-34111,
-33061,
-32154,
-30828,
-29023,
-27260,
-26080,
-25458,
-25012,
-24517,
-24082,
-23976,
-24210,
-24686,
-25191,
-25565,
-25748,
-25948,
-26544,
-27775,
-29382,
-30783,
-31659,
-32218,
-32926,
-33961,
-35110,
-36178,
-37173,
-38226,
-39245,
-39954,
-40236,
-40159,
-39911,
-39529,
-39025,
-38466,
-37996,
-37654,
-37335,
-36913,
-36326,
-35582,
-34745,
-33971,
-33455,
-33272,
-33200,
-32890,
-32252,
-31485,
-30904,
-30477,
-29971,
-29256,
-28497,
-27954,
-27624,
-27313,
-26927,
-26615,
-26573,
-26778,
-27043,
-27266,
-27584,
-28097,
-28752,
-29275,
-29493,
-29418,
-29250,
-29186,
-29405,
-29944,
-30662,
-31293,
-31636,
-31799,
-32101,
-32757,
-33675,
-34612,
-35513,
-36535,
-37834,
-39295,
-40687,
-41874,
-42942,
-43948,
-44827,
-45386,
-45497,
-45020,
-43859,
-41972,
-39574,
-37071,
-34748,
-32661,
-30728,
-29043,
-27768,
-26917,
-26248,
-25595,
-25087,
-24989,
-25280,
-25600,
-25646,
-25468,
-25341,
-25391,
-25509,
-25626,
-25824,
-26169,
-26551,
-26850,
-27167,
-27742,
-28538,
-29233,
-29599,
-29895,
-30565,
-31658,
-32691,
-33198,
-33310,
-33537,
-34180,
-34973,
-35515,
-35764,
-36072,
-36700,
-37592,
-38450,
-39153,
-39750,
-40360,
-40980,
-41579,
-42117,
-42591,
-42952,
-43106,
-42956,
-42421,
-41434,
-40047,
-38380,
-36645,
-34925,
-33176,
-31310,
-29362,
-27552,
-26101,
-25100,
-24397,
-23785,
-23192,
-22736,
-22664,
-23032,
-23676,
-24288,
-24691,
-24970,
-25283,
-25688,
-26076,
-26290,
-26331,
-26314,
-26443,
-26908,
-27851,
-29262,
-30941,
-32600,
-34043,
-35302,
-36510,
-37686,
-38754,
-39595,
-40321,
-41084,
-41984,
-42900,
-43625,
-44028,
-44101,
-43901,
-43422,
-42642,
-41581,
-40352,
-39113,
-37897,
-36591,
-35051,
-33236,
-31352,
-29679,
-28379,
-27454,
-26760,
-26202,
-25771,
-25457,
-25282,
-25181,
-25129,
-25125,
-25246,
-25642,
-26340,
-27221,
-28029,
-28615,
-29094,
-29636,
-30317,
-31004,
-31614,
-32234,
-32942,
-33632,
-33984,
-33936,
-33659,
-33515,
-33527,
-33568,
-33557,
-33672,
-34045,
-34518,
-34822,
-34835,
-34794,
-34862,
-35023,
-35130,
-35212,
-35383,
-35663,
-35870,
-35966,
-36075,
-36352,
-36597,
-36508,
-36042,
-35547,
-35345,
-35320,
-35140,
-34667,
-34142,
-33766,
-33401,
-32834,
-32063,
-31377,
-30895,
-30444,
-29878,
-29350,
-29152,
-29306,
-29453,
-29376,
-29171,
-29168,
-29398,
-29680,
-29882,
-30120,
-30508,
-30904,
-31046,
-30907,
-30733,
-30738,
-30871,
-30968,
-30970,
-30978,
-31002,
-30990,
-30949,
-31053,
-31440,
-32033,
-32669,
-33324,
-34125,
-35088,
-36014,
-36700,
-37234,
-37831,
-38581,
-39250,
-39621,
-39678,
-39573,
-39368,
-38986,
-38388,
-37638,
-36759,
-35659,
-34290,
-32807,
-31520,
-30506,
-29600,
-28609,
-27588,
-26793,
-26265,
-25875,
-25456,
-25122,
-25092,
-25414,
-25901,
-26363,
-26839,
-27491,
-28413,
-29487,
-30535,
-31497,
-32416,
-33404,
-34497,
-35629,
-36704,
-37559,
-38159,
-38490,
-38635,
-38656,
-38572,
-38390,
-38096,
-37705,
-37295,
-36945,
-36691,
-36362,
-35789,
-34917,
-34046,
-33479,
-33277,
-33140,
-32779,
-32242,
-31811,
-31650,
-31557,
-31264,
-30769,
-30305,
-30052,
-29890,
-29609,
-29164,
-28737,
-28420,
-28208,
-27982,
-27775,
-27652,
-27628,
-27634,
-27692,
-27874,
-28215,
-28541,
-28684,
-28693,
-28855,
-29373,
-30177,
-31017,
-31810,
-32687,
-33755,
-34902,
-35902,
-36694,
-37451,
-38346,
-39381,
-40456,
-41525,
-42596,
-43521,
-44036,
-43896,
-43132,
-41904,
-40351,
-38551,
-36674,
-34977,
-33590,
-32374,
-31123,
-29901,
-29000,
-28568,
-28365,
-28029,
-27539,
-27179,
-27163,
-27269,
-27161,
-26790,
-26447,
-26394,
-26528,
-26622,
-26626,
-26684,
-26889,
-27132,
-27336,
-27652,
-28271,
-29181,
-30091,
-30779,
-31302,
-31856,
-32484,
-33037,
-33358,
-33545,
-33785,
-34164,
-34547,
-34724,
-34615,
-34305,
-33953,
-33695,
-33642,
-33912,
-34638,
-35828,
-37336,
-38883,
-40334,
-41729,
-43201,
-44612,
-45609,
-45805,
-45210,
-44052,
-42530,
-40577,
-38111,
-35334,
-32680,
-30437,
-28579,
-26933,
-25551,
-24610,
-24161,
-24026,
-23990,
-24121,
-24525,
-25109,
-25486,
-25400,
-24934,
-24437,
-24067,
-23744,
-23357,
-23057,
-23093,
-23597,
-24502,
-25670,
-27103,
-28785,
-30624,
-32510,
-34371,
-36244,
-38036,
-39585,
-40781,
-41699,
-42537,
-43350,
-44102,
-44747,
-45320,
-45762,
-45829,
-45252,
-44035,
-42464,
-40830,
-39193,
-37519,
-35895,
-34506,
-33367,
-32185,
-30686,
-28950,
-27324,
-26087,
-25166,
-24431,
-23920,
-23839,
-24130,
-24491,
-24560,
-24447,
-24522,
-25069,
-25985,
-26937,
-27757,
-28535,
-29429,
-30484,
-31589,
-32625,
-33518,
-34231,
-34781,
-35234,
-35682,
-36147,
-36528,
-36785,
-36947,
-37154,
-37401,
-37532,
-37390,
-37019,
-36633,
-36338,
-36017,
-35419,
-34527,
-33522,
-32598,
-31737,
-30861,
-30092,
-29751,
-29956,
-30422,
-30695,
-30653,
-30646,
-31005,
-31659,
-32176,
-32313,
-32247,
-32291,
-32533,
-32751,
-32782,
-32601,
-32333,
-32059,
-31946,
-32189,
-32815,
-33539,
-33955,
-34053,
-34167,
-34584,
-35041,
-35103,
-34702,
-34340,
-34420,
-34739,
-34735,
-34233,
-33632,
-33360,
-33236,
-32770,
-31795,
-30776,
-30239,
-30150,
-30075,
-29715,
-29292,
-29158,
-29328,
-29465,
-29285,
-28877,
-28584,
-28660,
-29098,
-29747,
-30448,
-31163,
-31949,
-32867,
-33924,
-35028,
-36044,
-36975,
-37887,
-38831,
-39606,
-39930,
-39617,
-38882,
-38032,
-37293,
-36505,
-35462,
-34166,
-32875,
-31835,
-30992,
-30113,
-29147,
-28332,
-27927,
-27877,
-27812,
-27510,
-27073,
-26821,
-26818,
-26907,
-27000,
-27310,
-28119,
-29343,
-30645,
-31750,
-32835,
-34152,
-35640,
-36927,
-37717,
-38200,
-38687,
-39270,
-39631,
-39507,
-38932,
-38187,
-37463,
-36732,
-35933,
-35102,
-34337,
-33684,
-33171,
-32806,
-32614,
-32508,
-32391,
-32290,
-32335,
-32578,
-32827,
-32791,
-32425,
-31967,
-31712,
-31655,
-31541,
-31114,
-30416,
-29627,
-28958,
-28409,
-27932,
-27460,
-26985,
-26572,
-26262,
-26097,
-25964,
-25677,
-25188,
-24674,
-24528,
-24947,
-25769,
-26628,
-27328,
-28048,
-29078,
-30508,
-32163,
-33860,
-35655,
-37677,
-39981,
-42389,
-44751,
-46990,
-49061,
-50806,
-51992,
-52482,
-52277,
-51358,
-49662,
-47177,
-44141,
-40919,
-37769,
-34700,
-31728,
-29003,
-26794,
-25118,
-23808,
-22682,
-21857,
-21533,
-21659,
-21906,
-21889,
-21594,
-21200,
-20932,
-20781,
-20732,
-20844,
-21219,
-21854,
-22597,
-23341,
-24177,
-25258,
-26694,
-28297,
-29886,
-31303,
-32676,
-34111,
-35622,
-36993,
-37978,
-38536,
-38813,
-39054,
-39356,
-39699,
-40016,
-40285,
-40508,
-40755,
-41186,
-41971,
-43080,
-44132,
-44714,
-44736,
-44595,
-44592,
-44586,
-44009,
-42622,
-40784,
-39117,
-37696,
-36057,
-33721,
-30871,
-28117,
-25882,
-24064,
-22421,
-20984,
-20040,
-19706,
-19738,
-19835,
-19924,
-20164,
-20597,
-21107,
-21554,
-21945,
-22424,
-23005,
-23691,
-24432,
-25310,
-26359,
-27626,
-29119,
-30839,
-32647,
-34301,
-35674,
-36923,
-38304,
-39857,
-41271,
-42338,
-43265,
-44434,
-45850,
-46960,
-47202,
-46659,
-45901,
-45354,
-44845,
-43983,
-42683,
-41251,
-39896,
-38506,
-36838,
-34900,
-32888,
-30969,
-29185,
-27660,
-26580,
-25970,
-25530,
-24964,
-24291,
-23837,
-23734,
-23783,
-23749,
-23752,
-24104,
-24867,
-25639,
-26053,
-26147,
-26344,
-26931,
-27856,
-28860,
-29868,
-30925,
-32062,
-33148,
-33984,
-34443,
-34552,
-34420,
-34304,
-34341,
-34559,
-34764,
-34827,
-34774,
-34776,
-34933,
-35192,
-35464,
-35692,
-35910,
-36193,
-36706,
-37617,
-38876,
-40111,
-40876,
-41065,
-40992,
-40933,
-40749,
-40049,
-38757,
-37245,
-35908,
-34699,
-33233,
-31412,
-29533,
-27982,
-26787,
-25777,
-24873,
-24262,
-23976,
-23875,
-23814,
-23892,
-24324,
-25044,
-25772,
-26383,
-27076,
-28113,
-29367,
-30480,
-31259,
-31969,
-32963,
-34259,
-35491,
-36315,
-36685,
-36851,
-37037,
-37280,
-37399,
-37189,
-36577,
-35780,
-35192,
-35016,
-35101,
-35079,
-34821,
-34595,
-34730,
-35214,
-35690,
-35881,
-35863,
-35892,
-36022,
-36057,
-35754,
-35074,
-34161,
-33153,
-32212,
-31453,
-30917,
-30458,
-29880,
-29153,
-28522,
-28197,
-28139,
-28023,
-27687,
-27267,
-27098,
-27329,
-27757,
-28118,
-28306,
-28487,
-28835,
-29330,
-29818,
-30222,
-30682,
-31406,
-32421,
-33500,
-34426,
-35215,
-36097,
-37173,
-38255,
-39059,
-39487,
-39738,
-39927,
-40004,
-39758,
-39181,
-38414,
-37577,
-36641,
-35567,
-34464,
-33522,
-32800,
-32180,
-31568,
-30995,
-30554,
-30262,
-30072,
-29961,
-29949,
-29961,
-29939,
-29898,
-29983,
-30245,
-30478,
-30467,
-30224,
-30057,
-30148,
-30385,
-30485,
-30376,
-30236,
-30239,
-30344,
-30477,
-30593,
-30731,
-30806,
-30727,
-30609,
-30657,
-30905,
-31040,
-30791,
-30265,
-29887,
-29856,
-29944,
-29860,
-29711,
-29878,
-30514,
-31349,
-32021,
-32642,
-33531,
-34921,
-36591,
-38301,
-40017,
-41832,
-43611,
-44946,
-45585,
-45619,
-45356,
-44882,
-44026,
-42627,
-40790,
-38784,
-36752,
-34749,
-32772,
-30963,
-29420,
-28125,
-26995,
-26040,
-25334,
-24893,
-24576,
-24225,
-23823,
-23506,
-23340,
-23319,
-23349,
-23481,
-23756,
-24167,
-24570,
-24887,
-25202,
-25655,
-26295,
-26990,
-27658,
-28373,
-29324,
-30600,
-32049,
-33450,
-34617,
-35567,
-36365,
-37083,
-37793,
-38558,
-39519,
-40665,
-41945,
-43093,
-43987,
-44598,
-45070,
-45451,
-45631,
-45426,
-44843,
-44121,
-43466,
-42806,
-41800,
-40230,
-38182,
-35946,
-33705,
-31453,
-29207,
-27088,
-25258,
-23742,
-22470,
-21471,
-20805,
-20499,
-20406,
-20439,
-20660,
-21165,
-21896,
-22625,
-23233,
-23790,
-24435,
-25145,
-25848,
-26520,
-27249,
-27996,
-28690,
-29363,
-30292,
-31639,
-33235,
-34673,
-35840,
-36987,
-38374,
-39838,
-40967,
-41613,
-42023,
-42514,
-43082,
-43555,
-43889,
-44152,
-44309,
-44108,
-43478,
-42630,
-41843,
-41028,
-39874,
-38278,
-36589,
-35173,
-34038,
-32844,
-31442,
-30009,
-28822,
-27909,
-27087,
-26280,
-25548,
-24995,
-24560,
-24221,
-23992,
-23961,
-24104,
-24333,
-24614,
-25002,
-25542,
-26206,
-26941,
-27732,
-28562,
-29374,
-30085,
-30686,
-31182,
-31546,
-31719,
-31742,
-31836,
-32182,
-32775,
-33376,
-33778,
-33973,
-34151,
-34478,
-34993,
-35597,
-36193,
-36797,
-37602,
-38734,
-40165,
-41493,
-42338,
-42558,
-42381,
-42146,
-41931,
-41617,
-41023,
-40098,
-38906,
-37504,
-35984,
-34450,
-32943,
-31416,
-29843,
-28386,
-27265,
-26550,
-26010,
-25421,
-24801,
-24394,
-24318,
-24485,
-24719,
-25046,
-25552,
-26224,
-26932,
-27558,
-28162,
-28791,
-29452,
-30146,
-30998,
-32052,
-33125,
-33861,
-34106,
-34088,
-34120,
-34236,
-34239,
-34025,
-33832,
-33954,
-34451,
-35118,
-35737,
-36245,
-36653,
-37000,
-37380,
-37892,
-38501,
-38907,
-38860,
-38441,
-38029,
-37861,
-37649,
-37006,
-35825,
-34552,
-33565,
-32839,
-32011,
-30907,
-29767,
-28923,
-28470,
-28200,
-27932,
-27617,
-27293,
-26985,
-26699,
-26548,
-26567,
-26679,
-26758,
-26870,
-27266,
-28081,
-29056,
-29795,
-30226,
-30796,
-31977,
-33705,
-35358,
-36416,
-36958,
-37525,
-38409,
-39310,
-39685,
-39388,
-38813,
-38479,
-38426,
-38274,
-37615,
-36504,
-35326,
-34459,
-33938,
-33562,
-33186,
-32814,
-32600,
-32527,
-32506,
-32373,
-32128,
-31874,
-31737,
-31730,
-31725,
-31546,
-31058,
-30299,
-29412,
-28606,
-27931,
-27357,
-26854,
-26528,
-26563,
-26989,
-27606,
-28153,
-28547,
-28869,
-29243,
-29594,
-29828,
-29924,
-29971,
-29987,
-29922,
-29763,
-29696,
-29968,
-30680,
-31715,
-32961,
-34362,
-35939,
-37635,
-39370,
-41212,
-43219,
-45310,
-47090,
-48139,
-48263,
-47526,
-46011,
-43758,
-40922,
-37940,
-35322,
-33292,
-31667,
-30170,
-28724,
-27474,
-26584,
-26008,
-25688,
-25535,
-25529,
-25598,
-25651,
-25626,
-25480,
-25190,
-24749,
-24335,
-24194,
-24482,
-25145,
-25959,
-26868,
-27887,
-29033,
-30163,
-31184,
-32158,
-33215,
-34230,
-34900,
-35068,
-35013,
-35106,
-35347,
-35308,
-34683,
-33757,
-33152,
-33129,
-33381,
-33483,
-33478,
-33846,
-34846,
-36286,
-37681,
-38842,
-39872,
-40892,
-41845,
-42618,
-43205,
-43623,
-43718,
-43243,
-42124,
-40508,
-38609,
-36454,
-34080,
-31716,
-29764,
-28428,
-27531,
-26723,
-25919,
-25293,
-25044,
-25099,
-25214,
-25302,
-25387,
-25551,
-25656,
-25546,
-25179,
-24697,
-24275,
-23973,
-23797,
-23768,
-23990,
-24590,
-25622,
-27034,
-28613,
-30084,
-31269,
-32276,
-33430,
-34997,
-36890,
-38781,
-40412,
-41871,
-43355,
-44803,
-45805,
-46021,
-45616,
-45169,
-45069,
-45121,
-44761,
-43706,
-42208,
-40664,
-39154,
-37414,
-35348,
-33302,
-31715,
-30645,
-29688,
-28472,
-27078,
-25864,
-25032,
-24436,
-23895,
-23409,
-23170,
-23198,
-23415,
-23722,
-24210,
-24903,
-25678,
-26388,
-27062,
-27956,
-29119,
-30324,
-31215,
-31748,
-32176,
-32770,
-33499,
-34176,
-34686,
-35084,
-35452,
-35793,
-36087,
-36303,
-36368,
-36110,
-35492,
-34709,
-34167,
-34005,
-34062,
-34003,
-33788,
-33679,
-33947,
-34618,
-35491,
-36354,
-37066,
-37596,
-37932,
-38204,
-38476,
-38673,
-38547,
-37946,
-37024,
-36079,
-35265,
-34444,
-33463,
-32379,
-31414,
-30676,
-30073,
-29489,
-28923,
-28486,
-28183,
-27950,
-27728,
-27531,
-27415,
-27365,
-27368,
-27426,
-27521,
-27663,
-27846,
-28153,
-28603,
-29086,
-29437,
-29634,
-29841,
-30208,
-30650,
-31011,
-31320,
-31876,
-32859,
-34118,
-35236,
-36002,
-36494,
-36900,
-37244,
-37512,
-37827,
-38402,
-39245,
-40075,
-40582,
-40706,
-40587,
-40265,
-39605,
-38559,
-37301,
-36117,
-35090,
-34058,
-32912,
-31699,
-30571,
-29511,
-28460,
-27454,
-26727,
-26414,
-26370,
-26327,
-26174,
-26114,
-26315,
-26731,
-27126,
-27416,
-27761,
-28334,
-29086,
-29789,
-30360,
-30924,
-31610,
-32361,
-32992,
-33531,
-34175,
-35092,
-36121,
-36974,
-37545,
-37981,
-38487,
-39013,
-39357,
-39365,
-39042,
-38478,
-37757,
-37011,
-36372,
-35878,
-35376,
-34717,
-33935,
-33259,
-32759,
-32311,
-31707,
-30982,
-30336,
-29838,
-29396,
-28909,
-28464,
-28178,
-27966,
-27657,
-27279,
-27069,
-27196,
-27493,
-27740,
-27955,
-28362,
-28925,
-29302,
-29228,
-28970,
-29042,
-29574,
-30220,
-30622,
-30999,
-31785,
-33013,
-34157,
-34769,
-35061,
-35640,
-36793,
-38167,
-39321,
-40180,
-41095,
-42174,
-43141,
-43573,
-43353,
-42695,
-41767,
-40617,
-39174,
-37577,
-35997,
-34499,
-33003,
-31444,
-29933,
-28688,
-27777,
-27127,
-26611,
-26237,
-26114,
-26262,
-26533,
-26704,
-26692,
-26578,
-26551,
-26664,
-26892,
-27178,
-27503,
-27875,
-28248,
-28595,
-28951,
-29443,
-30090,
-30830,
-31482,
-31979,
-32323,
-32577,
-32775,
-32983,
-33245,
-33547,
-33763,
-33764,
-33614,
-33490,
-33491,
-33550,
-33607,
-33874,
-34685,
-36075,
-37610,
-38766,
-39493,
-40291,
-41585,
-43227,
-44610,
-45272,
-45227,
-44687,
-43643,
-41868,
-39348,
-36440,
-33658,
-31287,
-29356,
-27827,
-26779,
-26197,
-25945,
-25820,
-25773,
-25878,
-26121,
-26341,
-26324,
-26015,
-25461,
-24722,
-23834,
-22869,
-22015,
-21427,
-21236,
-21495,
-22266,
-23498,
-25026,
-26681,
-28465,
-30554,
-32955,
-35364,
-37338,
-38755,
-39960,
-41372,
-43067,
-44694,
-45871,
-46500,
-46733,
-46691,
-46362,
-45664,
-44594,
-43204,
-41630,
-40026,
-38609,
-37408,
-36263,
-34858,
-33108,
-31234,
-29587,
-28310,
-27270,
-26327,
-25525,
-25023,
-24796,
-24587,
-24181,
-23637,
-23291,
-23396,
-23954,
-24797,
-25803,
-26968,
-28282,
-29619,
-30813,
-31752,
-32470,
-33062,
-33629,
-34235,
-34840,
-35331,
-35568,
-35541,
-35413,
-35317,
-35254,
-35053,
-34689,
-34342,
-34227,
-34288,
-34221,
-33820,
-33260,
-32856,
-32752,
-32688,
-32474,
-32204,
-32246,
-32731,
-33415,
-33913,
-34200,
-34538,
-35166,
-35892,
-36343,
-36294,
-35937,
-35551,
-35230,
-34859,
-34356,
-33885,
-33623,
-33568,
-33449,
-33091,
-32558,
-32150,
-31985,
-31938,
-31732,
-31293,
-30786,
-30421,
-30244,
-30135,
-30014,
-29907,
-29904,
-29976,
-30016,
-29929,
-29784,
-29695,
-29763,
-29916,
-30025,
-29994,
-29888,
-29862,
-30064,
-30440,
-30804,
-30960,
-30973,
-31108,
-31668,
-32705,
-33957,
-35118,
-36013,
-36768,
-37572,
-38481,
-39300,
-39730,
-39620,
-39149,
-38673,
-38426,
-38284,
-37867,
-36964,
-35723,
-34504,
-33461,
-32412,
-31146,
-29782,
-28716,
-28164,
-27904,
-27517,
-26914,
-26432,
-26405,
-26720,
-26939,
-26806,
-26580,
-26741,
-27460,
-28529,
-29587,
-30592,
-31664,
-32913,
-34240,
-35468,
-36532,
-37426,
-38175,
-38757,
-39179,
-39418,
-39390,
-39016,
-38341,
-37592,
-36968,
-36420,
-35767,
-34913,
-34029,
-33382,
-32996,
-32765,
-32500,
-32254,
-32055,
-31884,
-31609,
-31228,
-30872,
-30695,
-30675,
-30692,
-30629,
-30478,
-30258,
-29954,
-29612,
-29284,
-29079,
-28952,
-28812,
-28593,
-28377,
-28304,
-28414,
-28602,
-28703,
-28683,
-28637,
-28695,
-28882,
-29102,
-29304,
-29527,
-29881,
-30413,
-31055,
-31817,
-32777,
-34005,
-35317,
-36390,
-37095,
-37776,
-38940,
-40752,
-42789,
-44467,
-45543,
-46196,
-46583,
-46526,
-45736,
-44196,
-42285,
-40319,
-38365,
-36244,
-33965,
-31719,
-29683,
-27867,
-26209,
-24815,
-23906,
-23569,
-23673,
-23944,
-24232,
-24471,
-24673,
-24785,
-24830,
-24828,
-24845,
-24842,
-24826,
-24842,
-25018,
-25430,
-26059,
-26814,
-27641,
-28546,
-29574,
-30740,
-31958,
-33086,
-33935,
-34506,
-34882,
-35227,
-35558,
-35781,
-35869,
-35951,
-36224,
-36769,
-37504,
-38372,
-39416,
-40724,
-42208,
-43708,
-45095,
-46398,
-47592,
-48458,
-48710,
-48149,
-46823,
-44790,
-42107,
-38894,
-35486,
-32226,
-29257,
-26476,
-23907,
-21827,
-20582,
-20098,
-19961,
-19790,
-19697,
-20016,
-20880,
-21910,
-22645,
-22875,
-22839,
-22804,
-22907,
-23076,
-23296,
-23649,
-24290,
-25299,
-26679,
-28351,
-30244,
-32256,
-34235,
-36035,
-37549,
-38910,
-40313,
-41815,
-43150,
-43972,
-44253,
-44377,
-44708,
-45138,
-45201,
-44645,
-43769,
-43020,
-42486,
-41777,
-40668,
-39390,
-38383,
-37707,
-36915,
-35611,
-33803,
-31876,
-30060,
-28315,
-26552,
-24892,
-23650,
-22978,
-22783,
-22792,
-22789,
-22781,
-22905,
-23367,
-24228,
-25376,
-26584,
-27649,
-28526,
-29263,
-29954,
-30652,
-31312,
-31890,
-32339,
-32779,
-33362,
-34117,
-34825,
-35212,
-35327,
-35534,
-36138,
-36932,
-37358,
-37072,
-36346,
-35706,
-35412,
-35186,
-34643,
-33732,
-32774,
-32199,
-32223,
-32748,
-33456,
-33981,
-34189,
-34248,
-34456,
-34863,
-35193,
-35208,
-35006,
-34925,
-35104,
-35286,
-35090,
-34489,
-33732,
-33153,
-32825,
-32672,
-32594,
-32493,
-32350,
-32203,
-32177,
-32290,
-32325,
-32043,
-31460,
-30887,
-30553,
-30336,
-29953,
-29349,
-28815,
-28592,
-28662,
-28807,
-28952,
-29133,
-29368,
-29552,
-29669,
-29828,
-30068,
-30231,
-30139,
-29922,
-29978,
-30505,
-31290,
-31958,
-32455,
-33054,
-33948,
-34943,
-35723,
-36260,
-36864,
-37773,
-38860,
-39744,
-40206,
-40312,
-40206,
-39893,
-39230,
-38239,
-37107,
-36132,
-35347,
-34598,
-33679,
-32580,
-31475,
-30531,
-29803,
-29246,
-28834,
-28540,
-28343,
-28180,
-28091,
-28112,
-28235,
-28275,
-28093,
-27798,
-27678,
-27956,
-28474,
-28967,
-29315,
-29733,
-30397,
-31250,
-32043,
-32660,
-33265,
-34016,
-34913,
-35760,
-36387,
-36760,
-36877,
-36765,
-36503,
-36225,
-35994,
-35724,
-35290,
-34801,
-34535,
-34670,
-35025,
-35222,
-35127,
-34984,
-35126,
-35517,
-35749,
-35437,
-34637,
-33745,
-33082,
-32561,
-31911,
-30997,
-30069,
-29386,
-29005,
-28678,
-28242,
-27816,
-27651,
-27830,
-28150,
-28370,
-28424,
-28431,
-28423,
-28310,
-28061,
-27833,
-27889,
-28288,
-28815,
-29250,
-29608,
-30144,
-31088,
-32438,
-34021,
-35656,
-37296,
-38955,
-40688,
-42370,
-43785,
-44559,
-44552,
-43914,
-43070,
-42305,
-41525,
-40425,
-38906,
-37219,
-35698,
-34404,
-33119,
-31712,
-30325,
-29216,
-28470,
-27952,
-27504,
-27070,
-26614,
-26108,
-25579,
-25210,
-25126,
-25236,
-25312,
-25343,
-25605,
-26291,
-27175,
-27766,
-27921,
-28035,
-28588,
-29574,
-30522,
-31120,
-31574,
-32265,
-33270,
-34238,
-34884,
-35219,
-35433,
-35586,
-35623,
-35575,
-35538,
-35501,
-35321,
-34976,
-34780,
-35052,
-35743,
-36378,
-36587,
-36488,
-36491,
-36858,
-37430,
-38005,
-38578,
-39294,
-40158,
-40876,
-41172,
-40886,
-40124,
-38946,
-37469,
-35834,
-34229,
-32776,
-31383,
-29932,
-28380,
-26911,
-25688,
-24807,
-24229,
-23923,
-23922,
-24190,
-24611,
-24984,
-25202,
-25325,
-25447,
-25638,
-25830,
-26033,
-26303,
-26723,
-27262,
-27821,
-28399,
-29093,
-29992,
-30957,
-31793,
-32412,
-32999,
-33729,
-34583,
-35381,
-36067,
-36827,
-37868,
-39176,
-40520,
-41732,
-42817,
-43803,
-44602,
-45034,
-45069,
-44878,
-44609,
-44275,
-43696,
-42784,
-41539,
-40057,
-38373,
-36534,
-34607,
-32692,
-30821,
-28950,
-27070,
-25275,
-23730,
-22525,
-21591,
-20804,
-20125,
-19665,
-19533,
-19705,
-20019,
-20361,
-20819,
-21580,
-22720,
-24141,
-25672,
-27305,
-29070,
-30902,
-32546,
-33842,
-34926,
-36141,
-37626,
-39149,
-40328,
-40990,
-41325,
-41512,
-41592,
-41438,
-41077,
-40703,
-40512,
-40457,
-40376,
-40094,
-39599,
-38889,
-37968,
-36883,
-35833,
-35027,
-34523,
-34122,
-33595,
-32853,
-31985,
-31028,
-29967,
-28775,
-27673,
-26864,
-26409,
-26033,
-25497,
-24802,
-24205,
-23847,
-23697,
-23718,
-24151,
-25281,
-27065,
-29024,
-30679,
-31979,
-33217,
-34542,
-35793,
-36743,
-37487,
-38268,
-39125,
-39739,
-39849,
-39500,
-39009,
-38518,
-37976,
-37330,
-36680,
-36135,
-35615,
-35007,
-34336,
-33759,
-33238,
-32560,
-31651,
-30815,
-30418,
-30382,
-30205,
-29563,
-28756,
-28423,
-28738,
-29313,
-29632,
-29732,
-30021,
-30728,
-31539,
-32031,
-32090,
-32009,
-32055,
-32213,
-32317,
-32293,
-32214,
-32097,
-31871,
-31429,
-30824,
-30175,
-29655,
-29367,
-29427,
-29837,
-30507,
-31227,
-31937,
-32703,
-33641,
-34656,
-35464,
-35917,
-36169,
-36597,
-37370,
-38281,
-38980,
-39338,
-39506,
-39662,
-39662,
-39242,
-38310,
-37183,
-36275,
-35671,
-35087,
-34191,
-33042,
-32012,
-31372,
-31005,
-30575,
-29945,
-29372,
-29148,
-29298,
-29460,
-29341,
-28960,
-28550,
-28254,
-27936,
-27414,
-26776,
-26265,
-26114,
-26309,
-26687,
-27155,
-27663,
-28155,
-28592,
-29007,
-29501,
-30092,
-30569,
-30769,
-30737,
-30740,
-30882,
-30972,
-30789,
-30472,
-30510,
-31230,
-32507,
-33965,
-35427,
-37057,
-38971,
-40938,
-42580,
-43723,
-44605,
-45492,
-46474,
-47369,
-48016,
-48276,
-47987,
-46946,
-45081,
-42610,
-39868,
-37142,
-34514,
-32012,
-29725,
-27700,
-25946,
-24354,
-22889,
-21575,
-20513,
-19771,
-19403,
-19351,
-19449,
-19446,
-19235,
-18958,
-18889,
-19174,
-19717,
-20397,
-21286,
-22592,
-24359,
-26319,
-28146,
-29768,
-31417,
-33300,
-35364,
-37330,
-39045,
-40538,
-41980,
-43402,
-44704,
-45744,
-46436,
-46792,
-46838,
-46626,
-46191,
-45539,
-44658,
-43536,
-42223,
-40831,
-39502,
-38342,
-37373,
-36518,
-35631,
-34633,
-33544,
-32498,
-31540,
-30621,
-29614,
-28537,
-27496,
-26562,
-25650,
-24612,
-23494,
-22492,
-21824,
-21515,
-21465,
-21656,
-22170,
-22995,
-23968,
-24849,
-25643,
-26538,
-27678,
-28896,
-29921,
-30613,
-31216,
-31935,
-32769,
-33387,
-33570,
-33416,
-33235,
-33217,
-33293,
-33364,
-33508,
-33918,
-34622,
-35402,
-36072,
-36758,
-37790,
-39303,
-41026,
-42532,
-43665,
-44575,
-45426,
-46030,
-46080,
-45388,
-44173,
-42720,
-41219,
-39685,
-38129,
-36606,
-35100,
-33500,
-31771,
-30011,
-28453,
-27139,
-25996,
-24918,
-23982,
-23293,
-22827,
-22374,
-21811,
-21219,
-20817,
-20705,
-20837,
-21150,
-21749,
-22729,
-24011,
-25266,
-26206,
-26853,
-27520,
-28493,
-29777,
-31112,
-32314,
-33435,
-34670,
-36081,
-37493,
-38646,
-39494,
-40206,
-41055,
-42115,
-43274,
-44300,
-45044,
-45477,
-45624,
-45488,
-45003,
-44122,
-42928,
-41635,
-40431,
-39291,
-37981,
-36279,
-34267,
-32219,
-30373,
-28702,
-27080,
-25616,
-24601,
-24206,
-24165,
-24043,
-23645,
-23264,
-23274,
-23743,
-24365,
-24910,
-25400,
-26023,
-26753,
-27366,
-27713,
-27913,
-28233,
-28830,
-29651,
-30589,
-31547,
-32507,
-33427,
-34355,
-35307,
-36222,
-36893,
-37144,
-37106,
-37130,
-37487,
-38089,
-38614,
-38875,
-38934,
-38939,
-38865,
-38630,
-38224,
-37850,
-37606,
-37496,
-37352,
-37111,
-36703,
-36076,
-35160,
-34019,
-32850,
-31746,
-30692,
-29575,
-28468,
-27565,
-26970,
-26617,
-26345,
-26156,
-26129,
-26267,
-26453,
-26574,
-26729,
-27115,
-27836,
-28788,
-29791,
-30735,
-31634,
-32505,
-33342,
-34057,
-34609,
-34976,
-35222,
-35406,
-35535,
-35567,
-35476,
-35336,
-35266,
-35305,
-35364,
-35355,
-35300,
-35291,
-35352,
-35380,
-35297,
-35155,
-35057,
-34997,
-34828,
-34490,
-34113,
-33918,
-33986,
-34129,
-34148,
-33930,
-33574,
-33185,
-32834,
-32490,
-32082,
-31551,
-30883,
-30156,
-29487,
-28909,
-28387,
-27909,
-27545,
-27470,
-27702,
-28168,
-28676,
-29174,
-29613,
-29985,
-30187,
-30225,
-30189,
-30239,
-30469,
-30861,
-31406,
-32077,
-32818,
-33513,
-34048,
-34459,
-34869,
-35374,
-35910,
-36365,
-36752,
-37187,
-37810,
-38470,
-38913,
-38895,
-38480,
-37886,
-37281,
-36628,
-35799,
-34807,
-33817,
-32987,
-32305,
-31642,
-30981,
-30439,
-30186,
-30205,
-30376,
-30598,
-30919,
-31430,
-32084,
-32708,
-33067,
-33063,
-32748,
-32254,
-31751,
-31270,
-30847,
-30460,
-30214,
-30204,
-30381,
-30533,
-30426,
-30095,
-29788,
-29726,
-29791,
-29703,
-29311,
-28815,
-28528,
-28567,
-28733,
-28781,
-28618,
-28342,
-28103,
-27962,
-27920,
-27970,
-28103,
-28387,
-28917,
-29838,
-31263,
-33207,
-35645,
-38484,
-41554,
-44607,
-47335,
-49537,
-51091,
-51901,
-51811,
-50683,
-48608,
-45851,
-42798,
-39686,
-36720,
-34060,
-31928,
-30370,
-29279,
-28503,
-27998,
-27882,
-28043,
-28157,
-27761,
-26761,
-25417,
-24081,
-22780,
-21298,
-19566,
-17899,
-16775,
-16391,
-16604,
-17176,
-18108,
-19489,
-21304,
-23364,
-25544,
-27844,
-30308,
-32764,
-35034,
-37018,
-38768,
-40269,
-41418,
-42283,
-43165,
-44324,
-45620,
-46609,
-47032,
-47111,
-47158,
-47159,
-46780,
-45882,
-44698,
-43536,
-42327,
-40784,
-38839,
-36776,
-34862,
-33037,
-31102,
-29106,
-27401,
-26243,
-25573,
-25143,
-24804,
-24537,
-24297,
-23996,
-23644,
-23348,
-23220,
-23230,
-23390,
-23812,
-24576,
-25527,
-26359,
-26969,
-27586,
-28501,
-29688,
-30881,
-31916,
-32870,
-33909,
-34952,
-35817,
-36430,
-36856,
-37132,
-37143,
-36862,
-36487,
-36297,
-36347,
-36411,
-36303,
-36105,
-35983,
-35951,
-35787,
-35394,
-34895,
-34537,
-34332,
-34116,
-33779,
-33491,
-33505,
-33880,
-34361,
-34627,
-34531,
-34194,
-33794,
-33433,
-33102,
-32784,
-32560,
-32479,
-32536,
-32556,
-32413,
-32126,
-31873,
-31769,
-31745,
-31564,
-31154,
-30623,
-30224,
-30024,
-29964,
-29916,
-29917,
-30045,
-30296,
-30597,
-30839,
-30994,
-31051,
-30979,
-30825,
-30704,
-30754,
-30937,
-31118,
-31192,
-31240,
-31374,
-31604,
-31814,
-32016,
-32317,
-32807,
-33344,
-33718,
-33966,
-34370,
-35157,
-36138,
-36886,
-37148,
-37151,
-37276,
-37656,
-37993,
-37937,
-37418,
-36723,
-36096,
-35580,
-34982,
-34230,
-33414,
-32704,
-32166,
-31678,
-31161,
-30585,
-30035,
-29532,
-29041,
-28518,
-27937,
-27350,
-26733,
-26118,
-25520,
-25027,
-24754,
-24817,
-25302,
-26203,
-27389,
-28701,
-30131,
-31787,
-33766,
-35828,
-37600,
-38862,
-39803,
-40733,
-41677,
-42351,
-42520,
-42335,
-42079,
-41797,
-41233,
-40235,
-39005,
-37894,
-36969,
-36024,
-34884,
-33661,
-32592,
-31711,
-30921,
-30091,
-29238,
-28401,
-27641,
-27075,
-26878,
-26991,
-27136,
-26995,
-26672,
-26563,
-26922,
-27549,
-28030,
-28226,
-28317,
-28460,
-28543,
-28382,
-28021,
-27663,
-27408,
-27190,
-26987,
-27014,
-27437,
-28193,
-29001,
-29778,
-30714,
-32025,
-33639,
-35263,
-36703,
-38047,
-39490,
-41060,
-42610,
-43904,
-44860,
-45531,
-46026,
-46375,
-46444,
-46087,
-45336,
-44432,
-43580,
-42663,
-41311,
-39345,
-37034,
-34869,
-33045,
-31335,
-29447,
-27455,
-25712,
-24437,
-23482,
-22585,
-21639,
-20802,
-20186,
-19822,
-19676,
-19787,
-20161,
-20747,
-21424,
-22196,
-23084,
-24028,
-24843,
-25405,
-25872,
-26512,
-27478,
-28583,
-29636,
-30604,
-31715,
-33038,
-34366,
-35342,
-35912,
-36418,
-37257,
-38537,
-39969,
-41314,
-42584,
-43943,
-45344,
-46518,
-47230,
-47574,
-47755,
-47866,
-47800,
-47533,
-47266,
-47077,
-46731,
-45743,
-43925,
-41548,
-38992,
-36317,
-33267,
-29830,
-26357,
-23377,
-21017,
-19065,
-17335,
-15949,
-15179,
-15087,
-15464,
-16023,
-16655,
-17362,
-18169,
-19019,
-19829,
-20539,
-21132,
-21684,
-22371,
-23345,
-24705,
-26361,
-28204,
-30141,
-32134,
-34196,
-36333,
-38491,
-40565,
-42319,
-43701,
-44855,
-46114,
-47648,
-49219,
-50438,
-51046,
-51208,
-51154,
-50977,
-50467,
-49426,
-47855,
-45918,
-43814,
-41641,
-39373,
-36961,
-34310,
-31504,
-28764,
-26391,
-24477,
-22866,
-21385,
-20133,
-19367,
-19185,
-19283,
-19256,
-19030,
-18885,
-19105,
-19629,
-20189,
-20713,
-21412,
-22491,
-23868,
-25293,
-26668,
-28108,
-29700,
-31286,
-32673,
-33835,
-34914,
-35889,
-36579,
-36882,
-37036,
-37371,
-37857,
-38142,
-37941,
-37509,
-37305,
-37586,
-38155,
-38830,
-39681,
-40902,
-42366,
-43665,
-44490,
-44939,
-45248,
-45403,
-45127,
-44201,
-42772,
-41055,
-39125,
-36885,
-34317,
-31684,
-29248,
-27154,
-25384,
-23949,
-22894,
-22233,
-21836,
-21601,
-21494,
-21559,
-21795,
-22129,
-22523,
-22956,
-23441,
-23924,
-24396,
-24907,
-25596,
-26566,
-27836,
-29333,
-30893,
-32369,
-33636,
-34721,
-35700,
-36631,
-37423,
-37979,
-38287,
-38498,
-38777,
-39137,
-39474,
-39667,
-39684,
-39590,
-39437,
-39294,
-39194,
-39167,
-39167,
-39114,
-38911,
-38532,
-37975,
-37250,
-36375,
-35384,
-34382,
-33452,
-32584,
-31661,
-30564,
-29331,
-28187,
-27333,
-26777,
-26313,
-25793,
-25324,
-25110,
-25188,
-25311,
-25287,
-25260,
-25650,
-26603,
-27801,
-28739,
-29296,
-29824,
-30714,
-31876,
-32911,
-33576,
-34072,
-34801,
-35821,
-36827,
-37448,
-37633,
-37628,
-37660,
-37713,
-37624,
-37269,
-36742,
-36282,
-36076,
-36129,
-36186,
-35983,
-35477,
-34941,
-34717,
-34844,
-35005,
-34844,
-34360,
-33885,
-33701,
-33636,
-33253,
-32302,
-31041,
-30061,
-29649,
-29620,
-29445,
-28846,
-28025,
-27433,
-27331,
-27590,
-27831,
-27918,
-27972,
-28303,
-28907,
-29487,
-29673,
-29459,
-29268,
-29544,
-30336,
-31219,
-31743,
-31900,
-32141,
-32884,
-34109,
-35396,
-36399,
-37243,
-38257,
-39595,
-40912,
-41690,
-41699,
-41104,
-40273,
-39331,
-38221,
-36864,
-35394,
-34046,
-32967,
-32128,
-31450,
-30887,
-30453,
-30105,
-29821,
-29568,
-29402,
-29287,
-29164,
-28942,
-28690,
-28501,
-28428,
-28357,
-28218,
-28124,
-28334,
-28991,
-29956,
-30932,
-31770,
-32557,
-33447,
-34439,
-35345,
-35976,
-36258,
-36214,
-35896,
-35411,
-34909,
-34537,
-34249,
-33876,
-33290,
-32557,
-31857,
-31222,
-30518,
-29614,
-28625,
-27814,
-27337,
-27078,
-26766,
-26303,
-25825,
-25611,
-25815,
-26414,
-27344,
-28696,
-30718,
-33553,
-36978,
-40344,
-43037,
-44866,
-46115,
-47071,
-47613,
-47333,
-46080,
-44227,
-42332,
-40621,
-38889,
-36914,
-34838,
-33037,
-31760,
-30962,
-30500,
-30252,
-30136,
-30004,
-29789,
-29554,
-29381,
-29099,
-28405,
-27179,
-25726,
-24429,
-23361,
-22260,
-21044,
-20019,
-19641,
-19943,
-20592,
-21269,
-22097,
-23348,
-25073,
-26961,
-28705,
-30252,
-31756,
-33307,
-34846,
-36248,
-37438,
-38372,
-39181,
-40114,
-41453,
-43152,
-44766,
-45881,
-46495,
-47024,
-47665,
-48032,
-47552,
-46106,
-44251,
-42582,
-41141,
-39512,
-37457,
-35240,
-33264,
-31628,
-30136,
-28706,
-27548,
-26850,
-26540,
-26404,
-26365,
-26479,
-26630,
-26507,
-25957,
-25222,
-24685,
-24390,
-24051,
-23540,
-23206,
-23444,
-24194,
-24921,
-25302,
-25583,
-26204,
-27189,
-28114,
-28728,
-29276,
-30125,
-31210,
-32023,
-32250,
-32091,
-32020,
-32200,
-32478,
-32670,
-32925,
-33527,
-34648,
-36273,
-38303,
-40579,
-42867,
-44914,
-46656,
-48188,
-49508,
-50348,
-50404,
-49741,
-48743,
-47696,
-46337,
-44211,
-41248,
-38020,
-35192,
-32927,
-30817,
-28529,
-26267,
-24487,
-23379,
-22571,
-21615,
-20475,
-19548,
-19175,
-19266,
-19450,
-19489,
-19466,
-19579,
-19862,
-20206,
-20549,
-21050,
-21845,
-22975,
-24263,
-25620,
-27066,
-28703,
-30535,
-32464,
-34387,
-36255,
-38054,
-39691,
-41092,
-42265,
-43360,
-44525,
-45711,
-46718,
-47351,
-47660,
-47826,
-47930,
-47806,
-47193,
-46067,
-44703,
-43400,
-42220,
-40904,
-39272,
-37329,
-35300,
-33283,
-31271,
-29214,
-27225,
-25473,
-24039,
-22869,
-21816,
-20827,
-19912,
-19173,
-18731,
-18679,
-18977,
-19500,
-20095,
-20808,
-21762,
-23039,
-24507,
-25963,
-27316,
-28679,
-30127,
-31582,
-32802,
-33674,
-34302,
-34973,
-35805,
-36749,
-37603,
-38307,
-38966,
-39734,
-40592,
-41403,
-41999,
-42398,
-42691,
-42933,
-43089,
-43183,
-43304,
-43486,
-43505,
-42977,
-41703,
-39891,
-37960,
-36173,
-34416,
-32481,
-30323,
-28234,
-26505,
-25253,
-24315,
-23457,
-22639,
-22021,
-21870,
-22170,
-22656,
-22960,
-23109,
-23421,
-24188,
-25202,
-25998,
-26432,
-26927,
-28041,
-29738,
-31417,
-32532,
-33269,
-34194,
-35644,
-37260,
-38520,
-39248,
-39789,
-40448,
-41205,
-41727,
-41783,
-41385,
-40711,
-39881,
-38953,
-37926,
-36829,
-35782,
-34966,
-34559,
-34508,
-34542,
-34296,
-33727,
-33066,
-32613,
-32301,
-31787,
-30802,
-29528,
-28423,
-27772,
-27405,
-26917,
-26182,
-25443,
-25114,
-25300,
-25807,
-26386,
-26978,
-27677,
-28478,
-29292,
-29964,
-30487,
-30869,
-31160,
-31438,
-31824,
-32426,
-33152,
-33791,
-34268,
-34714,
-35433,
-36460,
-37604,
-38604,
-39429,
-40236,
-41086,
-41799,
-42074,
-41720,
-40770,
-39393,
-37760,
-36072,
-34494,
-33170,
-32110,
-31235,
-30441,
-29760,
-29286,
-29117,
-29162,
-29193,
-29002,
-28571,
-28076,
-27672,
-27340,
-26946,
-26473,
-26157,
-26263,
-26885,
-27818,
-28883,
-30068,
-31513,
-33173,
-34729,
-35806,
-36308,
-36531,
-36820,
-37240,
-37500,
-37263,
-36489,
-35490,
-34688,
-34250,
-34026,
-33708,
-33123,
-32413,
-31846,
-31608,
-31547,
-31350,
-30770,
-29909,
-29088,
-28622,
-28535,
-28680,
-28870,
-29111,
-29489,
-30155,
-31142,
-32447,
-33935,
-35406,
-36714,
-37793,
-38703,
-39391,
-39714,
-39511,
-38840,
-37908,
-36869,
-35740,
-34493,
-33307,
-32444,
-31977,
-31726,
-31417,
-31097,
-31006,
-31355,
-31985,
-32590,
-32959,
-33198,
-33484,
-33850,
-34121,
-34074,
-33657,
-32985,
-32214,
-31448,
-30681,
-29921,
-29197,
-28544,
-27971,
-27437,
-26957,
-26532,
-26128,
-25647,
-25085,
-24636,
-24565,
-24905,
-25391,
-25692,
-25804,
-26000,
-26511,
-27261,
-28082,
-28984,
-30266,
-32152,
-34603,
-37444,
-40502,
-43699,
-46805,
-49491,
-51535,
-52954,
-53848,
-54131,
-53542,
-51944,
-49493,
-46518,
-43280,
-39882,
-36447,
-33191,
-30374,
-28134,
-26474,
-25276,
-24433,
-23833,
-23415,
-23133,
-22868,
-22489,
-21890,
-21174,
-20559,
-20170,
-19874,
-19468,
-18962,
-18705,
-19051,
-20043,
-21347,
-22636,
-23864,
-25274,
-27040,
-29113,
-31244,
-33261,
-35111,
-36824,
-38361,
-39660,
-40695,
-41493,
-42088,
-42528,
-42878,
-43333,
-43972,
-44810,
-45601,
-46158,
-46350,
-46186,
-45723,
-45064,
-44355,
-43675,
-42897,
-41746,
-40055,
-38006,
-35941,
-34014,
-32036,
-29826,
-27530,
-25598,
-24294,
-23433,
-22656,
-21790,
-21049,
-20613,
-20473,
-20434,
-20470,
-20777,
-21526,
-22672,
-23883,
-24868,
-25539,
-26091,
-26757,
-27608,
-28426,
-28952,
-29169,
-29392,
-30015,
-31116,
-32458,
-33748,
-34909,
-35981,
-36935,
-37667,
-38243,
-38933,
-39949,
-41169,
-42318,
-43269,
-44203,
-45216,
-46075,
-46391,
-46050,
-45359,
-44653,
-43917,
-42813,
-41080,
-38830,
-36383,
-34030,
-31838,
-29790,
-27886,
-26200,
-24852,
-23877,
-23235,
-22738,
-22265,
-21813,
-21569,
-21655,
-22041,
-22551,
-23084,
-23745,
-24672,
-25945,
-27413,
-28882,
-30193,
-31320,
-32342,
-33384,
-34439,
-35407,
-36112,
-36529,
-36758,
-36863,
-36754,
-36294,
-35564,
-34836,
-34326,
-33911,
-33384,
-32734,
-32274,
-32298,
-32736,
-33329,
-33917,
-34635,
-35663,
-36939,
-38237,
-39352,
-40236,
-40907,
-41346,
-41502,
-41326,
-40693,
-39500,
-37823,
-35986,
-34327,
-32852,
-31283,
-29459,
-27686,
-26392,
-25646,
-25034,
-24209,
-23337,
-22885,
-23078,
-23584,
-24051,
-24449,
-25109,
-26171,
-27421,
-28501,
-29290,
-29952,
-30722,
-31755,
-33085,
-34627,
-36114,
-37267,
-37999,
-38503,
-38978,
-39363,
-39386,
-39008,
-38471,
-38106,
-37844,
-37404,
-36612,
-35691,
-34933,
-34410,
-33953,
-33515,
-33264,
-33389,
-33769,
-34120,
-34192,
-34028,
-33719,
-33309,
-32786,
-32160,
-31535,
-30949,
-30415,
-29942,
-29561,
-29224,
-28826,
-28329,
-27893,
-27740,
-27874,
-28025,
-27969,
-27772,
-27766,
-28124,
-28660,
-29009,
-29029,
-28909,
-28995,
-29429,
-30121,
-30842,
-31460,
-32019,
-32727,
-33789,
-35265,
-36946,
-38561,
-39918,
-41066,
-42025,
-42713,
-42920,
-42631,
-42057,
-41462,
-40867,
-40085,
-38941,
-37523,
-36038,
-34687,
-33504,
-32434,
-31380,
-30248,
-29051,
-27975,
-27289,
-27052,
-27008,
-26786,
-26372,
-26080,
-26212,
-26625,
-26896,
-26884,
-26895,
-27354,
-28238,
-29104,
-29588,
-29792,
-30057,
-30533,
-30991,
-31214,
-31244,
-31338,
-31632,
-31991,
-32225,
-32285,
-32254,
-32238,
-32232,
-32289,
-32446,
-32767,
-33162,
-33503,
-33737,
-33949,
-34277,
-34780,
-35398,
-36088,
-36857,
-37776,
-38812,
-39839,
-40675,
-41252,
-41656,
-41987,
-42215,
-42140,
-41542,
-40410,
-38978,
-37521,
-36136,
-34686,
-32999,
-31159,
-29444,
-28163,
-27313,
-26670,
-26008,
-25367,
-24965,
-24936,
-25154,
-25331,
-25323,
-25188,
-25111,
-25159,
-25282,
-25393,
-25530,
-25740,
-26072,
-26469,
-26939,
-27504,
-28241,
-29116,
-30019,
-30844,
-31561,
-32220,
-32871,
-33495,
-34058,
-34594,
-35203,
-36003,
-36972,
-38020,
-39027,
-40041,
-41160,
-42441,
-43729,
-44782,
-45411,
-45655,
-45648,
-45489,
-45089,
-44306,
-43067,
-41467,
-39676,
-37801,
-35852,
-33816,
-31737,
-29732,
-27903,
-26296,
-24891,
-23664,
-22594,
-21718,
-21074,
-20735,
-20693,
-20899,
-21241,
-21691,
-22265,
-22981,
-23786,
-24625,
-25509,
-26520,
-27565,
-28465,
-29086,
-29625,
-30451,
-31661,
-32950,
-33863,
-34385,
-34918,
-35850,
-37091,
-38232,
-39045,
-39695,
-40459,
-41319,
-42015,
-42389,
-42533,
-42646,
-42753,
-42743,
-42523,
-42075,
-41401,
-40472,
-39380,
-38266,
-37222,
-36131,
-34852,
-33478,
-32284,
-31437,
-30728,
-29827,
-28639,
-27435,
-26516,
-25868,
-25294,
-24667,
-24169,
-23977,
-24102,
-24340,
-24575,
-24849,
-25255,
-25789,
-26394,
-27085,
-27913,
-28859,
-29733,
-30370,
-30748,
-30997,
-31223,
-31478,
-31807,
-32337,
-33141,
-34138,
-35159,
-36090,
-36923,
-37602,
-37936,
-37867,
-37604,
-37608,
-38070,
-38776,
-39310,
-39574,
-39791,
-40136,
-40341,
-39959,
-38842,
-37400,
-36232,
-35572,
-35208,
-34700,
-33834,
-32685,
-31491,
-30446,
-29569,
-28745,
-27920,
-27206,
-26872,
-27005,
-27361,
-27561,
-27443,
-27288,
-27446,
-28010,
-28755,
-29457,
-30134,
-30903,
-31758,
-32545,
-33129,
-33502,
-33694,
-33775,
-33856,
-34109,
-34531,
-34836,
-34722,
-34215,
-33731,
-33563,
-33538,
-33195,
-32429,
-31615,
-31252,
-31264,
-31204,
-30681,
-29901,
-29326,
-29223,
-29472,
-29804,
-30176,
-30748,
-31690,
-33035,
-34630,
-36227,
-37548,
-38435,
-38938,
-39222,
-39334,
-39144,
-38505,
-37522,
-36539,
-35769,
-35157,
-34462,
-33613,
-32845,
-32393,
-32280,
-32257,
-32085,
-31739,
-31352,
-31044,
-30767,
-30389,
-29800,
-29075,
-28410,
-28003,
-27871,
-27889,
-27923,
-28035,
-28360,
-28926,
-29567,
-30076,
-30502,
-31007,
-31642,
-32212,
-32473,
-32490,
-32539,
-32796,
-33111,
-33259,
-33261,
-33427,
-33946,
-34700,
-35365,
-35838,
-36252,
-36725,
-37160,
-37309,
-37141,
-36827,
-36623,
-36545,
-36449,
-36129,
-35513,
-34679,
-33814,
-33126,
-32720,
-32489,
-32222,
-31786,
-31313,
-31010,
-30937,
-30843,
-30445,
-29701,
-28900,
-28347,
-28130,
-28040,
-27910,
-27718,
-27635,
-27750,
-28046,
-28448,
-28912,
-29445,
-30034,
-30703,
-31544,
-32676,
-34032,
-35307,
-36154,
-36546,
-36774,
-37182,
-37730,
-38105,
-38052,
-37682,
-37305,
-37054,
-36828,
-36438,
-35909,
-35366,
-34912,
-34521,
-34184,
-33944,
-33823,
-33753,
-33642,
-33525,
-33488,
-33527,
-33467,
-33112,
-32472,
-31722,
-31049,
-30478,
-29943,
-29358,
-28729,
-28106,
-27582,
-27257,
-27145,
-27102,
-26931,
-26588,
-26217,
-26046,
-26065,
-26101,
-25996,
-25838,
-25763,
-25848,
-26016,
-26338,
-27036,
-28242,
-29751,
-31182,
-32455,
-33966,
-36248,
-39378,
-42953,
-46466,
-49677,
-52478,
-54569,
-55479,
-54967,
-53272,
-50859,
-48003,
-44715,
-41078,
-37439,
-34194,
-31451,
-29013,
-26731,
-24724,
-23289,
-22586,
-22547,
-22850,
-23178,
-23213,
-22925,
-22452,
-22004,
-21577,
-21040,
-20453,
-20189,
-20630,
-21690,
-22895,
-23929,
-25010,
-26541,
-28535,
-30492,
-32013,
-33171,
-34346,
-35601,
-36629,
-37121,
-37173,
-37066,
-36969,
-36795,
-36538,
-36342,
-36364,
-36583,
-36939,
-37468,
-38346,
-39598,
-41074,
-42624,
-44163,
-45638,
-46822,
-47428,
-47344,
-46644,
-45472,
-43819,
-41685,
-39100,
-36228,
-33173,
-30073,
-27188,
-24794,
-23017,
-21653,
-20485,
-19515,
-18984,
-18957,
-19304,
-19781,
-20479,
-21544,
-22892,
-24128,
-24917,
-25400,
-25983,
-26818,
-27637,
-28108,
-28307,
-28655,
-29406,
-30407,
-31358,
-32229,
-33283,
-34672,
-36189,
-37498,
-38524,
-39497,
-40617,
-41782,
-42690,
-43236,
-43564,
-43927,
-44308,
-44546,
-44462,
-44051,
-43425,
-42629,
-41714,
-40639,
-39375,
-37812,
-35947,
-33921,
-32011,
-30317,
-28729,
-27084,
-25463,
-24191,
-23396,
-22945,
-22498,
-22026,
-21738,
-21804,
-22167,
-22678,
-23443,
-24617,
-26121,
-27513,
-28491,
-29185,
-30051,
-31197,
-32291,
-32997,
-33383,
-33904,
-34723,
-35575,
-36077,
-36167,
-36112,
-36144,
-36275,
-36463,
-36713,
-37003,
-37172,
-37045,
-36681,
-36325,
-36102,
-35861,
-35402,
-34725,
-34101,
-33671,
-33369,
-33014,
-32598,
-32298,
-32291,
-32587,
-33027,
-33453,
-33767,
-34045,
-34401,
-34871,
-35268,
-35314,
-34935,
-34331,
-33845,
-33511,
-33129,
-32497,
-31725,
-31096,
-30745,
-30526,
-30222,
-29761,
-29246,
-28811,
-28608,
-28682,
-29000,
-29313,
-29404,
-29327,
-29398,
-29847,
-30472,
-30819,
-30695,
-30396,
-30388,
-30794,
-31276,
-31528,
-31544,
-31673,
-32118,
-32818,
-33512,
-34053,
-34496,
-34973,
-35548,
-36142,
-36655,
-37050,
-37382,
-37728,
-38071,
-38286,
-38251,
-37898,
-37283,
-36498,
-35660,
-34874,
-34157,
-33479,
-32754,
-32053,
-31474,
-31079,
-30710,
-30210,
-29584,
-29101,
-28907,
-28928,
-28883,
-28677,
-28434,
-28276,
-28153,
-27990,
-27896,
-28142,
-28757,
-29539,
-30254,
-31020,
-32095,
-33438,
-34640,
-35349,
-35700,
-36173,
-36955,
-37736,
-38042,
-37818,
-37434,
-37218,
-37132,
-36856,
-36253,
-35443,
-34663,
-34050,
-33594,
-33259,
-32954,
-32599,
-32191,
-31859,
-31750,
-31785,
-31740,
-31443,
-31049,
-30778,
-30633,
-30344,
-29736,
-29002,
-28504,
-28379,
-28382,
-28297,
-28178,
-28273,
-28630,
-29002,
-29193,
-29264,
-29503,
-30011,
-30646,
-31230,
-31685,
-32079,
-32439,
-32814,
-33299,
-33956,
-34678,
-35224,
-35588,
-36021,
-36822,
-37858,
-38638,
-38905,
-38906,
-39216,
-39955,
-40663,
-40753,
-40132,
-39218,
-38391,
-37599,
-36574,
-35259,
-33918,
-32804,
-31872,
-30889,
-29760,
-28607,
-27583,
-26746,
-26070,
-25639,
-25524,
-25678,
-25925,
-26188,
-26573,
-27173,
-27867,
-28381,
-28679,
-29018,
-29696,
-30595,
-31339,
-31670,
-31764,
-31963,
-32336,
-32661,
-32759,
-32718,
-32759,
-32893,
-33004,
-33017,
-33014,
-33040,
-32946,
-32656,
-32256,
-31982,
-31800,
-31506,
-31026,
-30721,
-31022,
-31995,
-33290,
-34660,
-36359,
-38718,
-41689,
-44641,
-46970,
-48505,
-49353,
-49425,
-48409,
-46168,
-43052,
-39674,
-36372,
-33190,
-30132,
-27477,
-25529,
-24319,
-23589,
-23096,
-22897,
-23118,
-23703,
-24336,
-24697,
-24722,
-24490,
-24089,
-23464,
-22647,
-21808,
-21198,
-20980,
-21186,
-21839,
-23055,
-24840,
-27038,
-29391,
-31795,
-34341,
-37007,
-39463,
-41295,
-42484,
-43459,
-44588,
-45702,
-46309,
-46261,
-46006,
-45990,
-46070,
-45666,
-44558,
-43152,
-41924,
-40756,
-39134,
-37003,
-34922,
-33417,
-32252,
-30752,
-28703,
-26668,
-25245,
-24386,
-23588,
-22702,
-22135,
-22297,
-22968,
-23579,
-23866,
-24052,
-24461,
-25042,
-25596,
-26104,
-26796,
-27818,
-29033,
-30215,
-31280,
-32311,
-33339,
-34346,
-35314,
-36299,
-37333,
-38347,
-39210,
-39876,
-40341,
-40609,
-40664,
-40463,
-39985,
-39247,
-38355,
-37509,
-36850,
-36305,
-35601,
-34576,
-33365,
-32281,
-31479,
-30799,
-30021,
-29122,
-28302,
-27776,
-27606,
-27692,
-27904,
-28099,
-28265,
-28561,
-29149,
-30014,
-30794,
-31196,
-31274,
-31405,
-31788,
-32179,
-32281,
-32193,
-32390,
-33073,
-33865,
-34226,
-34114,
-34022,
-34282,
-34660,
-34671,
-34237,
-33752,
-33554,
-33506,
-33339,
-33095,
-33130,
-33585,
-34113,
-34334,
-34273,
-34358,
-34730,
-35073,
-34934,
-34392,
-33955,
-33968,
-34177,
-34055,
-33444,
-32752,
-32474,
-32627,
-32775,
-32544,
-32007,
-31566,
-31474,
-31602,
-31575,
-31220,
-30691,
-30384,
-30463,
-30801,
-31024,
-30977,
-30830,
-30931,
-31421,
-32104,
-32658,
-32940,
-33066,
-33199,
-33354,
-33389,
-33199,
-32775,
-32269,
-31811,
-31499,
-31257,
-30913,
-30310,
-29539,
-28832,
-28382,
-28100,
-27755,
-27298,
-26936,
-26902,
-27164,
-27538,
-27986,
-28760,
-30109,
-32024,
-34249,
-36686,
-39425,
-42548,
-45804,
-48638,
-50579,
-51452,
-51359,
-50412,
-48670,
-46160,
-43059,
-39664,
-36310,
-33219,
-30410,
-27844,
-25558,
-23774,
-22733,
-22474,
-22759,
-23273,
-23812,
-24297,
-24681,
-24868,
-24800,
-24522,
-24091,
-23582,
-23112,
-22845,
-22932,
-23316,
-23890,
-24680,
-25900,
-27625,
-29577,
-31333,
-32761,
-34173,
-35803,
-37464,
-38670,
-39279,
-39674,
-40337,
-41294,
-42139,
-42575,
-42754,
-42981,
-43327,
-43544,
-43412,
-42937,
-42235,
-41313,
-40131,
-38782,
-37468,
-36318,
-35211,
-33964,
-32545,
-31151,
-29959,
-29013,
-28185,
-27410,
-26716,
-26228,
-26028,
-26123,
-26391,
-26674,
-26831,
-26848,
-26829,
-26884,
-27001,
-27094,
-27086,
-27082,
-27269,
-27781,
-28527,
-29312,
-29988,
-30607,
-31321,
-32172,
-33044,
-33730,
-34145,
-34354,
-34493,
-34630,
-34745,
-34786,
-34725,
-34591,
-34487,
-34498,
-34698,
-34980,
-35240,
-35438,
-35668,
-36044,
-36468,
-36766,
-36843,
-36819,
-36870,
-37003,
-37094,
-37095,
-37101,
-37182,
-37217,
-36988,
-36449,
-35706,
-34848,
-33785,
-32443,
-30978,
-29641,
-28533,
-27449,
-26250,
-25072,
-24283,
-24053,
-24240,
-24625,
-25165,
-26055,
-27323,
-28824,
-30228,
-31368,
-32226,
-32916,
-33495,
-34006,
-34389,
-34655,
-34808,
-34932,
-35069,
-35196,
-35291,
-35376,
-35505,
-35710,
-35924,
-36175,
-36511,
-36952,
-37313,
-37362,
-37088,
-36687,
-36316,
-35828,
-34995,
-33884,
-32838,
-32112,
-31591,
-31021,
-30405,
-29960,
-29703,
-29387,
-28821,
-28299,
-28253,
-28740,
-29290,
-29447,
-29288,
-29181,
-29301,
-29438,
-29428,
-29427,
-29709,
-30268,
-30847,
-31292,
-31736,
-32319,
-32983,
-33578,
-34160,
-34965,
-36068,
-37263,
-38254,
-38936,
-39341,
-39420,
-39047,
-38277,
-37391,
-36675,
-36129,
-35521,
-34731,
-33846,
-33010,
-32214,
-31374,
-30518,
-29849,
-29498,
-29461,
-29576,
-29711,
-29775,
-29697,
-29465,
-29202,
-29117,
-29331,
-29732,
-30092,
-30269,
-30360,
-30558,
-30980,
-31583,
-32277,
-33011,
-33814,
-34650,
-35373,
-35790,
-35831,
-35661,
-35548,
-35576,
-35561,
-35201,
-34475,
-33714,
-33301,
-33232,
-33116,
-32551,
-31634,
-30826,
-30492,
-30435,
-30122,
-29203,
-27921,
-26845,
-26367,
-26359,
-26437,
-26393,
-26342,
-26597,
-27293,
-28439,
-29983,
-31978,
-34450,
-37325,
-40357,
-43260,
-45675,
-47297,
-47900,
-47544,
-46546,
-45207,
-43625,
-41678,
-39359,
-36912,
-34646,
-32671,
-30845,
-29106,
-27646,
-26776,
-26591,
-26881,
-27299,
-27668,
-27946,
-28129,
-28168,
-28005,
-27695,
-27322,
-26987,
-26710,
-26473,
-26235,
-25996,
-25830,
-25863,
-26154,
-26619,
-27136,
-27654,
-28253,
-28975,
-29711,
-30318,
-30748,
-31115,
-31495,
-31846,
-32088,
-32247,
-32436,
-32752,
-33244,
-34005,
-35173,
-36810,
-38765,
-40876,
-43010,
-45112,
-46943,
-48166,
-48608,
-48503,
-48205,
-47842,
-47163,
-45914,
-44110,
-41936,
-39483,
-36693,
-33629,
-30612,
-27984,
-25904,
-24273,
-23030,
-22168,
-21630,
-21265,
-20928,
-20665,
-20610,
-20764,
-21023,
-21288,
-21655,
-22188,
-22831,
-23428,
-23920,
-24493,
-25269,
-26260,
-27242,
-28083,
-28788,
-29537,
-30491,
-31690,
-33045,
-34397,
-35685,
-36908,
-38088,
-39112,
-39843,
-40341,
-40826,
-41580,
-42533,
-43486,
-44308,
-45109,
-45982,
-46697,
-46895,
-46481,
-45754,
-45066,
-44359,
-43271,
-41588,
-39496,
-37352,
-35291,
-33153,
-30793,
-28285,
-25884,
-23836,
-22264,
-21149,
-20364,
-19721,
-19183,
-18918,
-19127,
-19759,
-20494,
-21111,
-21783,
-22871,
-24437,
-26025,
-27146,
-27710,
-28173,
-28864,
-29723,
-30379,
-30708,
-31004,
-31661,
-32775,
-34114,
-35426,
-36601,
-37639,
-38458,
-38993,
-39367,
-39818,
-40496,
-41230,
-41789,
-42155,
-42607,
-43270,
-43903,
-43976,
-43318,
-42243,
-41330,
-40770,
-40310,
-39544,
-38364,
-36906,
-35356,
-33727,
-31997,
-30207,
-28480,
-26927,
-25662,
-24771,
-24184,
-23650,
-22902,
-21987,
-21336,
-21342,
-21939,
-22683,
-23259,
-23858,
-24824,
-26192,
-27462,
-28273,
-28742,
-29425,
-30649,
-32143,
-33428,
-34274,
-34915,
-35625,
-36352,
-36824,
-36878,
-36707,
-36605,
-36683,
-36815,
-36867,
-36848,
-36895,
-37004,
-37124,
-37213,
-37361,
-37670,
-38050,
-38362,
-38568,
-38820,
-39211,
-39494,
-39287,
-38409,
-37186,
-36047,
-35083,
-33966,
-32394,
-30516,
-28790,
-27430,
-26293,
-25102,
-23963,
-23211,
-23041,
-23254,
-23555,
-23884,
-24429,
-25271,
-26273,
-27229,
-28141,
-29123,
-30195,
-31289,
-32398,
-33663,
-35119,
-36529,
-37534,
-38055,
-38311,
-38564,
-38775,
-38770,
-38527,
-38267,
-38137,
-38004,
-37594,
-36793,
-35748,
-34645,
-33585,
-32603,
-31809,
-31243,
-30881,
-30638,
-30565,
-30784,
-31267,
-31723,
-31941,
-31990,
-32180,
-32593,
-32954,
-32942,
-32607,
-32309,
-32248,
-32240,
-31970,
-31382,
-30755,
-30314,
-30025,
-29755,
-29490,
-29433,
-29687,
-30144,
-30542,
-30735,
-30744,
-30725,
-30802,
-30941,
-31060,
-31022,
-30887,
-30866,
-31166,
-31792,
-32470,
-32968,
-33330,
-33858,
-34794,
-36016,
-37173,
-37980,
-38496,
-38941,
-39433,
-39805,
-39778,
-39240,
-38403,
-37554,
-36864,
-36165,
-35264,
-34110,
-32909,
-31876,
-31059,
-30353,
-29715,
-29194,
-28880,
-28741,
-28664,
-28630,
-28657,
-28805,
-29073,
-29452,
-29938,
-30462,
-30857,
-30986,
-30876,
-30692,
-30558,
-30473,
-30403,
-30432,
-30620,
-30899,
-31052,
-31020,
-30946,
-31064,
-31302,
-31490,
-31465,
-31358,
-31254,
-31062,
-30620,
-29963,
-29376,
-29053,
-28941,
-28912,
-29049,
-29602,
-30594,
-31754,
-32798,
-33864,
-35398,
-37720,
-40628,
-43644,
-46320,
-48501,
-50067,
-50846,
-50595,
-49299,
-47190,
-44680,
-42047,
-39408,
-36683,
-33848,
-30992,
-28356,
-26143,
-24453,
-23244,
-22484,
-22171,
-22248,
-22533,
-22753,
-22758,
-22607,
-22476,
-22473,
-22554,
-22658,
-22841,
-23213,
-23805,
-24457,
-25020,
-25534,
-26265,
-27417,
-28905,
-30442,
-31827,
-33169,
-34593,
-36033,
-37104,
-37602,
-37706,
-37840,
-38231,
-38720,
-39098,
-39426,
-39966,
-40791,
-41643,
-42214,
-42535,
-42886,
-43435,
-44001,
-44290,
-44221,
-43925,
-43530,
-42885,
-41803,
-40210,
-38270,
-36177,
-34045,
-31895,
-29783,
-27774,
-25942,
-24305,
-22898,
-21760,
-20919,
-20328,
-19926,
-19692,
-19672,
-19945,
-20505,
-21298,
-22246,
-23327,
-24535,
-25852,
-27162,
-28365,
-29419,
-30373,
-31294,
-32111,
-32710,
-33026,
-33210,
-33576,
-34323,
-35409,
-36524,
-37402,
-37997,
-38471,
-38967,
-39435,
-39733,
-39895,
-40177,
-40881,
-41926,
-42921,
-43401,
-43303,
-42873,
-42332,
-41624,
-40571,
-39256,
-38012,
-37053,
-36187,
-34973,
-33234,
-31279,
-29545,
-28232,
-27149,
-26075,
-25039,
-24180,
-23609,
-23207,
-22878,
-22605,
-22488,
-22647,
-23202,
-24216,
-25623,
-27115,
-28415,
-29439,
-30428,
-31523,
-32571,
-33198,
-33315,
-33238,
-33354,
-33663,
-33812,
-33600,
-33227,
-33090,
-33278,
-33553,
-33733,
-33958,
-34497,
-35355,
-36210,
-36766,
-37011,
-37185,
-37466,
-37886,
-38393,
-38875,
-39202,
-39213,
-38890,
-38401,
-37931,
-37466,
-36871,
-36077,
-35207,
-34377,
-33530,
-32486,
-31244,
-29992,
-28965,
-28173,
-27501,
-26876,
-26356,
-26021,
-25874,
-25877,
-26027,
-26323,
-26741,
-27256,
-27919,
-28766,
-29711,
-30558,
-31248,
-31972,
-33016,
-34356,
-35638,
-36483,
-36825,
-36950,
-37075,
-37224,
-37211,
-36930,
-36359,
-35559,
-34595,
-33645,
-32861,
-32271,
-31719,
-31089,
-30580,
-30556,
-31192,
-32212,
-33151,
-33842,
-34506,
-35416,
-36435,
-37125,
-37147,
-36646,
-35986,
-35427,
-34857,
-34113,
-33141,
-32111,
-31143,
-30299,
-29551,
-28903,
-28304,
-27732,
-27224,
-26920,
-26842,
-26768,
-26382,
-25713,
-25247,
-25456,
-26246,
-26964,
-27137,
-27033,
-27443,
-28836,
-30908,
-33047,
-34991,
-37036,
-39491,
-42185,
-44560,
-46180,
-47032,
-47354,
-47350,
-47000,
-46194,
-44827,
-42915,
-40626,
-38264,
-36106,
-34202,
-32425,
-30651,
-29029,
-27806,
-27056,
-26529,
-25910,
-25172,
-24639,
-24588,
-24935,
-25214,
-25063,
-24530,
-24048,
-23963,
-24268,
-24648,
-24951,
-25277,
-25900,
-26830,
-27811,
-28543,
-29020,
-29521,
-30288,
-31349,
-32493,
-33550,
-34515,
-35419,
-36250,
-36878,
-37274,
-37559,
-37950,
-38475,
-38948,
-39144,
-39139,
-39260,
-39750,
-40352,
-40567,
-40153,
-39495,
-39125,
-39077,
-38819,
-37910,
-36677,
-35856,
-35781,
-35901,
-35475,
-34362,
-33199,
-32534,
-32289,
-31870,
-30979,
-29851,
-28955,
-28467,
-28181,
-27784,
-27126,
-26269,
-25445,
-24919,
-24830,
-25084,
-25427,
-25726,
-26096,
-26708,
-27533,
-28307,
-28806,
-29007,
-29006,
-28866,
-28591,
-28318,
-28245,
-28490,
-28937,
-29393,
-29755,
-30140,
-30681,
-31532,
-32718,
-34188,
-35775,
-37279,
-38719,
-40279,
-42159,
-44174,
-45897,
-46930,
-47344,
-47484,
-47579,
-47472,
-46750,
-45215,
-43055,
-40775,
-38713,
-36886,
-34993,
-32855,
-30675,
-28906,
-27802,
-27167,
-26502,
-25579,
-24577,
-23860,
-23488,
-23229,
-22835,
-22355,
-22028,
-21983,
-22180,
-22476,
-22819,
-23164,
-23521,
-23933,
-24529,
-25393,
-26388,
-27306,
-28075,
-28888,
-29994,
-31353,
-32685,
-33746,
-34592,
-35478,
-36551,
-37745,
-38915,
-40037,
-41233,
-42625,
-44223,
-45865,
-47300,
-48197,
-48406,
-47957,
-47153,
-46203,
-45112,
-43645,
-41644,
-39235,
-36741,
-34446,
-32351,
-30346,
-28355,
-26525,
-25076,
-24107,
-23496,
-22985,
-22377,
-21726,
-21277,
-21270,
-21724,
-22416,
-23100,
-23760,
-24548,
-25546,
-26588,
-27359,
-27834,
-28312,
-29224,
-30635,
-32187,
-33387,
-34074,
-34482,
-34946,
-35564,
-36174,
-36589,
-36829,
-37084,
-37513,
-38104,
-38701,
-39093,
-39219,
-39128,
-38978,
-38882,
-38813,
-38653,
-38338,
-37928,
-37572,
-37242,
-36752,
-35869,
-34697,
-33573,
-32810,
-32287,
-31608,
-30494,
-29203,
-28189,
-27701,
-27460,
-27076,
-26512,
-26127,
-26219,
-26634,
-26913,
-26839,
-26612,
-26651,
-27077,
-27747,
-28484,
-29343,
-30434,
-31672,
-32775,
-33573,
-34213,
-34994,
-36046,
-37177,
-38084,
-38601,
-38760,
-38718,
-38561,
-38438,
-38338,
-38272,
-38074,
-37715,
-37300,
-37013,
-36885,
-36631,
-36003,
-35009,
-34065,
-33527,
-33352,
-33124,
-32474,
-31470,
-30515,
-29892,
-29503,
-28991,
-28198,
-27314,
-26731,
-26591,
-26709,
-26726,
-26502,
-26206,
-26136,
-26480,
-27154,
-27925,
-28595,
-29106,
-29547,
-30021,
-30517,
-30865,
-30885,
-30613,
-30358,
-30526,
-31226,
-32231,
-33163,
-33906,
-34614,
-35475,
-36438,
-37266,
-37871,
-38397,
-39147,
-40243,
-41590,
-42962,
-44196,
-45198,
-45934,
-46305,
-46135,
-45206,
-43433,
-40998,
-38351,
-35870,
-33629,
-31421,
-29127,
-26925,
-25146,
-23877,
-22929,
-22106,
-21521,
-21454,
-21969,
-22753,
-23364,
-23657,
-23797,
-24052,
-24476,
-24963,
-25418,
-25896,
-26482,
-27214,
-28030,
-28905,
-29898,
-31080,
-32404,
-33680,
-34701,
-35425,
-35961,
-36428,
-36779,
-36904,
-36819,
-36749,
-36916,
-37304,
-37635,
-37666,
-37425,
-37146,
-37083,
-37278,
-37659,
-38110,
-38585,
-39065,
-39550,
-39985,
-40240,
-40206,
-39889,
-39495,
-39186,
-38858,
-38205,
-36985,
-35370,
-33696,
-32127,
-30534,
-28788,
-27066,
-25710,
-24886,
-24411,
-24086,
-23854,
-23818,
-23937,
-24140,
-24420,
-24967,
-25783,
-26626,
-27171,
-27373,
-27523,
-27788,
-28082,
-28182,
-28135,
-28198,
-28549,
-29133,
-29780,
-30534,
-31439,
-32434,
-33350,
-34167,
-35115,
-36362,
-37712,
-38823,
-39615,
-40405,
-41525,
-42838,
-43869,
-44278,
-44173,
-43875,
-43493,
-42889,
-41953,
-40859,
-39848,
-38943,
-37939,
-36615,
-35068,
-33475,
-31989,
-30542,
-29141,
-27882,
-26964,
-26366,
-25923,
-25465,
-25040,
-24807,
-24863,
-25080,
-25325,
-25532,
-25808,
-26186,
-26668,
-27124,
-27544,
-27911,
-28255,
-28589,
-28929,
-29312,
-29674,
-29917,
-29951,
-29867,
-29879,
-30163,
-30740,
-31484,
-32308,
-33214,
-34233,
-35305,
-36268,
-37029,
-37642,
-38336,
-39258,
-40378,
-41492,
-42438,
-43184,
-43759,
-44069,
-43940,
-43295,
-42307,
-41235,
-40124,
-38795,
-37072,
-35148,
-33391,
-32053,
-30969,
-29845,
-28623,
-27551,
-26914,
-26655,
-26470,
-26085,
-25555,
-25166,
-25158,
-25492,
-25909,
-26120,
-26121,
-26117,
-26336,
-26788,
-27240,
-27553,
-27855,
-28443,
-29422,
-30551,
-31441,
-31963,
-32299,
-32711,
-33233,
-33705,
-34006,
-34218,
-34575,
-35202,
-36072,
-36971,
-37712,
-38228,
-38594,
-38945,
-39316,
-39631,
-39811,
-39921,
-40052,
-40184,
-40046,
-39391,
-38247,
-36899,
-35617,
-34384,
-33063,
-31656,
-30389,
-29482,
-28877,
-28356,
-27731,
-27082,
-26580,
-26353,
-26323,
-26347,
-26276,
-26140,
-26128,
-26455,
-27145,
-27914,
-28438,
-28709,
-29111,
-30001,
-31285,
-32481,
-33285,
-33945,
-34916,
-36295,
-37579,
-38249,
-38255,
-38070,
-38057,
-38151,
-38034,
-37547,
-36901,
-36344,
-35981,
-35665,
-35234,
-34583,
-33783,
-33043,
-32664,
-32753,
-33122,
-33349,
-33269,
-33046,
-33013,
-33144,
-33112,
-32619,
-31834,
-31082,
-30542,
-29963,
-29154,
-28226,
-27500,
-27130,
-26959,
-26879,
-27025,
-27615,
-28594,
-29572,
-30258,
-30692,
-31114,
-31551,
-31753,
-31521,
-30982,
-30495,
-30242,
-30133,
-30000,
-29875,
-29988,
-30486,
-31299,
-32245,
-33250,
-34430,
-35980,
-37941,
-40148,
-42260,
-43974,
-45175,
-45924,
-46314,
-46267,
-45593,
-44191,
-42245,
-40149,
-38189,
-36358,
-34425,
-32249,
-29971,
-27951,
-26454,
-25517,
-24939,
-24546,
-24276,
-24202,
-24322,
-24554,
-24783,
-24975,
-25227,
-25574,
-25945,
-26190,
-26299,
-26417,
-26787,
-27447,
-28286,
-29109,
-29891,
-30727,
-31681,
-32644,
-33403,
-33865,
-34150,
-34479,
-34892,
-35244,
-35327,
-35205,
-35072,
-35051,
-34927,
-34484,
-33799,
-33403,
-33706,
-34643,
-35678,
-36425,
-37023,
-37852,
-39037,
-40226,
-41006,
-41379,
-41672,
-42164,
-42694,
-42849,
-42289,
-41021,
-39268,
-37368,
-35516,
-33806,
-32181,
-30588,
-29064,
-27728,
-26657,
-25810,
-25079,
-24486,
-24120,
-24060,
-24186,
-24311,
-24345,
-24315,
-24318,
-24324,
-24316,
-24283,
-24353,
-24551,
-24882,
-25235,
-25580,
-25959,
-26479,
-27219,
-28212,
-29415,
-30824,
-32477,
-34436,
-36650,
-38873,
-40823,
-42371,
-43642,
-44854,
-46024,
-46990,
-47527,
-47604,
-47362,
-46929,
-46309,
-45360,
-43921,
-41968,
-39700,
-37463,
-35578,
-34039,
-32567,
-30894,
-29096,
-27592,
-26672,
-26215,
-25785,
-25177,
-24604,
-24448,
-24731,
-25056,
-24992,
-24551,
-24126,
-24097,
-24467,
-24954,
-25327,
-25600,
-25967,
-26556,
-27345,
-28169,
-28894,
-29465,
-30003,
-30659,
-31557,
-32638,
-33746,
-34726,
-35558,
-36315,
-37022,
-37641,
-38038,
-38172,
-38042,
-37778,
-37487,
-37312,
-37225,
-37129,
-36901,
-36595,
-36438,
-36574,
-36839,
-36919,
-36628,
-36242,
-36126,
-36370,
-36611,
-36493,
-36102,
-35914,
-36256,
-36866,
-37180,
-36829,
-35997,
-35101,
-34325,
-33509,
-32396,
-30944,
-29363,
-27936,
-26804,
-25968,
-25274,
-24585,
-23936,
-23543,
-23648,
-24167,
-24733,
-25010,
-25080,
-25304,
-25828,
-26331,
-26412,
-26115,
-25992,
-26495,
-27500,
-28554,
-29442,
-30485,
-32055,
-34149,
-36368,
-38411,
-40296,
-42167,
-44030,
-45671,
-46933,
-47691,
-47846,
-47301,
-46104,
-44514,
-42773,
-40959,
-39027,
-37090,
-35365,
-33960,
-32706,
-31374,
-30022,
-28920,
-28251,
-27864,
-27525,
-27158,
-26922,
-26875,
-26870,
-26732,
-26461,
-26200,
-26081,
-26069,
-26129,
-26307,
-26641,
-27100,
-27582,
-28030,
-28507,
-29093,
-29814,
-30620,
-31463,
-32265,
-32999,
-33616,
-34131,
-34559,
-34924,
-35258,
-35554,
-35797,
-35889,
-35852,
-35852,
-36151,
-36835,
-37622,
-38167,
-38345,
-38405,
-38549,
-38663,
-38410,
-37738,
-36976,
-36499,
-36238,
-35782,
-34852,
-33624,
-32461,
-31460,
-30390,
-29089,
-27749,
-26777,
-26392,
-26433,
-26575,
-26605,
-26490,
-26365,
-26355,
-26606,
-27075,
-27574,
-27884,
-28054,
-28432,
-29297,
-30501,
-31541,
-32098,
-32445,
-33105,
-34320,
-35718,
-36855,
-37678,
-38552,
-39674,
-40750,
-41265,
-41078,
-40545,
-40126,
-39910,
-39673,
-39189,
-38505,
-37788,
-37095,
-36341,
-35386,
-34195,
-32873,
-31620,
-30611,
-29852,
-29114,
-28199,
-27140,
-26250,
-25734,
-25455,
-25128,
-24714,
-24568,
-24983,
-25848,
-26736,
-27439,
-28129,
-29084,
-30232,
-31257,
-31973,
-32523,
-33104,
-33724,
-34191,
-34451,
-34588,
-34714,
-34810,
-34882,
-35035,
-35370,
-35741,
-35902,
-35732,
-35461,
-35330,
-35311,
-35096,
-34453,
-33493,
-32538,
-31825,
-31327,
-30920,
-30563,
-30380,
-30613,
-31372,
-32558,
-33842,
-34888,
-35637,
-36292,
-37038,
-37746,
-38130,
-38045,
-37754,
-37506,
-37239,
-36534,
-35170,
-33467,
-32037,
-31224,
-30854,
-30521,
-30137,
-29931,
-30142,
-30683,
-31198,
-31452,
-31491,
-31551,
-31782,
-32098,
-32253,
-32050,
-31414,
-30511,
-29539,
-28704,
-28015,
-27368,
-26667,
-25943,
-25375,
-25072,
-24963,
-24852,
-24656,
-24547,
-24791,
-25455,
-26344,
-27168,
-27910,
-28770,
-29937,
-31400,
-33033,
-34839,
-36971,
-39516,
-42290,
-45020,
-47480,
-49615,
-51340,
-52492,
-52922,
-52679,
-51876,
-50518,
-48485,
-45764,
-42613,
-39409,
-36344,
-33406,
-30623,
-28245,
-26530,
-25497,
-24791,
-24123,
-23370,
-22696,
-22156,
-21701,
-21229,
-20696,
-20115,
-19495,
-18863,
-18349,
-18098,
-18182,
-18570,
-19284,
-20433,
-22095,
-24142,
-26285,
-28330,
-30305,
-32365,
-34517,
-36567,
-38301,
-39610,
-40597,
-41319,
-41846,
-42151,
-42349,
-42556,
-42917,
-43409,
-43867,
-44092,
-44020,
-43779,
-43545,
-43325,
-42934,
-42196,
-41196,
-40199,
-39391,
-38640,
-37667,
-36368,
-34900,
-33551,
-32356,
-31198,
-29922,
-28611,
-27442,
-26525,
-25760,
-24963,
-24058,
-23160,
-22460,
-22087,
-22013,
-22157,
-22439,
-22827,
-23321,
-23902,
-24598,
-25439,
-26392,
-27344,
-28122,
-28694,
-29150,
-29630,
-30172,
-30779,
-31465,
-32310,
-33272,
-34234,
-35108,
-36003,
-37039,
-38104,
-38909,
-39304,
-39590,
-40223,
-41297,
-42416,
-43106,
-43295,
-43278,
-43268,
-43138,
-42677,
-41907,
-41035,
-40166,
-39188,
-37939,
-36502,
-34987,
-33466,
-31845,
-30167,
-28632,
-27439,
-26580,
-25863,
-25194,
-24588,
-24156,
-23850,
-23641,
-23540,
-23725,
-24268,
-25107,
-26006,
-26772,
-27365,
-27901,
-28545,
-29319,
-30164,
-30881,
-31474,
-31993,
-32570,
-33166,
-33612,
-33817,
-33811,
-33778,
-33836,
-34003,
-34229,
-34461,
-34645,
-34765,
-34871,
-35059,
-35402,
-35786,
-36115,
-36376,
-36778,
-37470,
-38369,
-39215,
-39769,
-40020,
-40041,
-39855,
-39442,
-38795,
-37955,
-36900,
-35591,
-34092,
-32675,
-31563,
-30751,
-29946,
-29010,
-28096,
-27552,
-27412,
-27382,
-27103,
-26662,
-26442,
-26733,
-27334,
-27808,
-27942,
-27992,
-28346,
-29065,
-29837,
-30286,
-30471,
-30724,
-31360,
-32265,
-33082,
-33581,
-33874,
-34262,
-34877,
-35517,
-35875,
-35804,
-35442,
-35088,
-34892,
-34828,
-34704,
-34433,
-34124,
-33983,
-34153,
-34528,
-34907,
-35165,
-35335,
-35490,
-35582,
-35544,
-35370,
-35217,
-35118,
-34982,
-34616,
-34098,
-33592,
-33211,
-32748,
-31977,
-30965,
-30061,
-29530,
-29260,
-28984,
-28597,
-28285,
-28170,
-28147,
-28039,
-27890,
-27967,
-28394,
-28965,
-29384,
-29578,
-29797,
-30288,
-31025,
-31817,
-32522,
-33198,
-33987,
-34878,
-35786,
-36538,
-37116,
-37531,
-37846,
-38067,
-38217,
-38322,
-38446,
-38507,
-38340,
-37764,
-36852,
-35890,
-35165,
-34630,
-34044,
-33262,
-32516,
-32104,
-32040,
-31952,
-31523,
-30889,
-30459,
-30466,
-30634,
-30537,
-30027,
-29395,
-29003,
-28913,
-28896,
-28699,
-28336,
-27996,
-27886,
-28050,
-28394,
-28776,
-29092,
-29297,
-29421,
-29507,
-29606,
-29704,
-29750,
-29708,
-29631,
-29673,
-29931,
-30400,
-30942,
-31508,
-32150,
-32898,
-33651,
-34220,
-34673,
-35330,
-36566,
-38344,
-40319,
-42122,
-43704,
-45174,
-46433,
-47194,
-47188,
-46534,
-45484,
-44187,
-42502,
-40319,
-37745,
-35097,
-32618,
-30341,
-28240,
-26349,
-24850,
-23887,
-23468,
-23440,
-23568,
-23697,
-23813,
-23997,
-24265,
-24507,
-24591,
-24530,
-24513,
-24675,
-25033,
-25485,
-26100,
-27005,
-28248,
-29615,
-30763,
-31590,
-32238,
-32947,
-33729,
-34359,
-34624,
-34500,
-34238,
-34055,
-34061,
-34110,
-34054,
-33887,
-33788,
-33932,
-34330,
-34790,
-35244,
-35831,
-36779,
-38124,
-39602,
-40959,
-42236,
-43712,
-45517,
-47336,
-48564,
-48748,
-47825,
-46100,
-43882,
-41355,
-38594,
-35663,
-32718,
-29920,
-27428,
-25292,
-23478,
-21916,
-20585,
-19632,
-19265,
-19598,
-20488,
-21540,
-22363,
-22768,
-22845,
-22790,
-22745,
-22756,
-22872,
-23186,
-23770,
-24586,
-25506,
-26427,
-27365,
-28420,
-29691,
-31237,
-33057,
-35067,
-37101,
-38991,
-40647,
-42102,
-43368,
-44387,
-45094,
-45531,
-45827,
-46053,
-46127,
-45959,
-45557,
-44993,
-44211,
-43097,
-41634,
-40131,
-38873,
-37878,
-36779,
-35259,
-33378,
-31495,
-29877,
-28495,
-27195,
-25985,
-25051,
-24514,
-24216,
-23813,
-23101,
-22185,
-21492,
-21373,
-21864,
-22645,
-23328,
-23873,
-24512,
-25504,
-26758,
-27943,
-28851,
-29566,
-30285,
-31014,
-31567,
-31868,
-32072,
-32451,
-33032,
-33628,
-33984,
-34065,
-34064,
-34232,
-34737,
-35557,
-36535,
-37580,
-38718,
-40137,
-41785,
-43365,
-44367,
-44603,
-44316,
-43960,
-43785,
-43616,
-43102,
-42032,
-40442,
-38549,
-36557,
-34552,
-32539,
-30537,
-28689,
-27246,
-26321,
-25734,
-25151,
-24407,
-23692,
-23307,
-23355,
-23684,
-24177,
-24890,
-25884,
-27037,
-28032,
-28705,
-29093,
-29350,
-29577,
-29817,
-30161,
-30629,
-31136,
-31526,
-31783,
-31999,
-32201,
-32263,
-32125,
-31988,
-32153,
-32669,
-33269,
-33745,
-34173,
-34803,
-35650,
-36519,
-37308,
-38138,
-39135,
-40138,
-40942,
-41533,
-42136,
-42652,
-42659,
-41728,
-40088,
-38360,
-36995,
-35787,
-34339,
-32585,
-30913,
-29667,
-28776,
-27976,
-27120,
-26348,
-25796,
-25481,
-25341,
-25364,
-25546,
-25840,
-26201,
-26650,
-27259,
-27947,
-28562,
-29033,
-29526,
-30282,
-31325,
-32400,
-33263,
-33887,
-34512,
-35235,
-35930,
-36321,
-36330,
-36170,
-36070,
-36051,
-35845,
-35318,
-34641,
-34214,
-34239,
-34491,
-34603,
-34439,
-34270,
-34401,
-34854,
-35372,
-35703,
-35855,
-35894,
-35853,
-35647,
-35274,
-34788,
-34203,
-33405,
-32361,
-31238,
-30291,
-29648,
-29112,
-28504,
-27805,
-27231,
-26973,
-27038,
-27311,
-27666,
-28011,
-28275,
-28451,
-28634,
-28926,
-29267,
-29445,
-29301,
-29001,
-28915,
-29306,
-30110,
-31057,
-32058,
-33231,
-34761,
-36548,
-38323,
-39797,
-40969,
-41923,
-42748,
-43339,
-43570,
-43356,
-42729,
-41740,
-40482,
-39052,
-37606,
-36265,
-35091,
-34048,
-33093,
-32184,
-31321,
-30473,
-29603,
-28691,
-27783,
-26973,
-26330,
-25836,
-25445,
-25143,
-25026,
-25181,
-25607,
-26165,
-26721,
-27248,
-27841,
-28546,
-29276,
-29878,
-30249,
-30469,
-30642,
-30839,
-31060,
-31325,
-31713,
-32252,
-32860,
-33332,
-33592,
-33673,
-33739,
-33814,
-33841,
-33806,
-33870,
-34261,
-35018,
-35944,
-36774,
-37444,
-38060,
-38682,
-39241,
-39601,
-39796,
-39923,
-40000,
-39870,
-39380,
-38581,
-37631,
-36682,
-35713,
-34748,
-33856,
-33159,
-32619,
-32142,
-31672,
-31270,
-30941,
-30531,
-29864,
-28971,
-28144,
-27637,
-27467,
-27395,
-27222,
-26968,
-26783,
-26797,
-26945,
-27108,
-27166,
-27143,
-27103,
-27116,
-27162,
-27188,
-27125,
-26973,
-26745,
-26523,
-26470,
-26796,
-27622,
-28796,
-30011,
-31032,
-31938,
-32974,
-34291,
-35881,
-37708,
-39909,
-42568,
-45450,
-47982,
-49633,
-50277,
-50168,
-49600,
-48613,
-47127,
-45096,
-42723,
-40300,
-38107,
-36214,
-34463,
-32617,
-30595,
-28672,
-27287,
-26607,
-26357,
-25986,
-25259,
-24349,
-23640,
-23219,
-22909,
-22540,
-22177,
-21995,
-22029,
-22133,
-22255,
-22529,
-23097,
-23911,
-24747,
-25534,
-26433,
-27631,
-29074,
-30504,
-31808,
-33054,
-34333,
-35461,
-36216,
-36690,
-37324,
-38467,
-39916,
-41154,
-41918,
-42450,
-43141,
-43954,
-44520,
-44593,
-44353,
-44125,
-43904,
-43386,
-42310,
-40746,
-38957,
-37145,
-35438,
-33934,
-32689,
-31580,
-30378,
-29036,
-27748,
-26729,
-25932,
-25124,
-24242,
-23545,
-23278,
-23462,
-23817,
-24162,
-24521,
-24948,
-25437,
-25930,
-26509,
-27324,
-28404,
-29518,
-30442,
-31051,
-31466,
-31725,
-31799,
-31580,
-31127,
-30746,
-30860,
-31731,
-33211,
-34733,
-35784,
-36267,
-36665,
-37425,
-38537,
-39481,
-39903,
-40057,
-40539,
-41562,
-42548,
-42659,
-41569,
-39834,
-38298,
-37365,
-36718,
-35770,
-34335,
-32731,
-31483,
-30736,
-30181,
-29401,
-28319,
-27319,
-26857,
-27001,
-27378,
-27540,
-27428,
-27364,
-27674,
-28289,
-28801,
-28948,
-28854,
-29007,
-29695,
-30820,
-31923,
-32699,
-33182,
-33642,
-34257,
-34858,
-35198,
-35184,
-35029,
-34987,
-35076,
-35080,
-34823,
-34409,
-34070,
-33892,
-33673,
-33213,
-32560,
-31996,
-31666,
-31411,
-30980,
-30369,
-29866,
-29705,
-29815,
-29929,
-29959,
-30083,
-30524,
-31258,
-32072,
-32795,
-33441,
-34048,
-34587,
-34982,
-35300,
-35638,
-36003,
-36233,
-36183,
-35981,
-35834,
-35864,
-35914,
-35800,
-35543,
-35330,
-35297,
-35324,
-35192,
-34772,
-34128,
-33400,
-32666,
-31967,
-31307,
-30708,
-30117,
-29473,
-28729,
-27946,
-27247,
-26812,
-26776,
-27195,
-27926,
-28710,
-29341,
-29828,
-30351,
-30996,
-31612,
-31992,
-32165,
-32376,
-32840,
-33372,
-33663,
-33606,
-33491,
-33672,
-34169,
-34766,
-35304,
-35921,
-36725,
-37566,
-38062,
-38087,
-37812,
-37513,
-37191,
-36660,
-35863,
-34991,
-34228,
-33561,
-32868,
-32160,
-31615,
-31304,
-31110,
-30880,
-30631,
-30498,
-30441,
-30227,
-29657,
-28826,
-27995,
-27294,
-26598,
-25770,
-24904,
-24342,
-24303,
-24778,
-25549,
-26572,
-27987,
-29927,
-32229,
-34454,
-36265,
-37672,
-38934,
-40149,
-41106,
-41605,
-41735,
-41842,
-42008,
-41924,
-41268,
-40215,
-39323,
-38892,
-38605,
-37933,
-36818,
-35677,
-34846,
-34117,
-33063,
-31687,
-30382,
-29519,
-28944,
-28364,
-27719,
-27258,
-27049,
-26863,
-26468,
-26015,
-25862,
-26080,
-26362,
-26368,
-26157,
-26017,
-26064,
-26150,
-26126,
-26163,
-26563,
-27387,
-28395,
-29274,
-29983,
-30652,
-31383,
-32100,
-32724,
-33270,
-33882,
-34602,
-35414,
-36213,
-37025,
-37857,
-38705,
-39476,
-40099,
-40603,
-41075,
-41603,
-42184,
-42770,
-43285,
-43624,
-43701,
-43436,
-42860,
-42017,
-40960,
-39685,
-38220,
-36686,
-35163,
-33643,
-31979,
-30107,
-28166,
-26391,
-24955,
-23796,
-22864,
-22164,
-21792,
-21712,
-21750,
-21789,
-21868,
-22134,
-22534,
-22835,
-22801,
-22508,
-22241,
-22247,
-22562,
-23082,
-23803,
-24775,
-25973,
-27278,
-28584,
-30025,
-31775,
-33859,
-36028,
-38124,
-40239,
-42695,
-45503,
-48217,
-50244,
-51313,
-51679,
-51679,
-51372,
-50605,
-49318,
-47751,
-46142,
-44502,
-42667,
-40609,
-38505,
-36517,
-34615,
-32698,
-30863,
-29325,
-28142,
-27070,
-25797,
-24295,
-22760,
-21354,
-20061,
-18873,
-17985,
-17629,
-17798,
-18221,
-18740,
-19440,
-20536,
-21942,
-23370,
-24633,
-25889,
-27302,
-28743,
-29799,
-30327,
-30643,
-31280,
-32336,
-33466,
-34279,
-34870,
-35675,
-36962,
-38510,
-39830,
-40704,
-41357,
-42203,
-43409,
-44804,
-46059,
-47013,
-47618,
-47868,
-47620,
-46765,
-45360,
-43661,
-41944,
-40310,
-38715,
-37067,
-35378,
-33655,
-31898,
-30090,
-28298,
-26666,
-25278,
-24117,
-23130,
-22332,
-21797,
-21500,
-21347,
-21241,
-21235,
-21426,
-21804,
-22285,
-22820,
-23508,
-24445,
-25608,
-26856,
-28140,
-29461,
-30764,
-31854,
-32583,
-33101,
-33704,
-34574,
-35517,
-36258,
-36730,
-37140,
-37724,
-38456,
-39136,
-39554,
-39687,
-39647,
-39638,
-39778,
-40053,
-40269,
-40292,
-40140,
-40013,
-39933,
-39690,
-39005,
-37950,
-36866,
-36073,
-35420,
-34553,
-33246,
-31687,
-30197,
-28981,
-27983,
-27131,
-26371,
-25706,
-25132,
-24682,
-24439,
-24466,
-24739,
-25197,
-25769,
-26386,
-26958,
-27416,
-27864,
-28454,
-29255,
-30117,
-30912,
-31672,
-32634,
-33798,
-34932,
-35702,
-36098,
-36396,
-36881,
-37529,
-38104,
-38401,
-38402,
-38227,
-37970,
-37658,
-37243,
-36661,
-35928,
-35168,
-34588,
-34311,
-34269,
-34300,
-34326,
-34364,
-34471,
-34566,
-34504,
-34227,
-33754,
-33186,
-32543,
-31810,
-31003,
-30135,
-29279,
-28478,
-27801,
-27312,
-27023,
-26905,
-26902,
-26981,
-27132,
-27355,
-27622,
-27854,
-27924,
-27761,
-27486,
-27379,
-27720,
-28432,
-29223,
-29761,
-30091,
-30466,
-31069,
-31840,
-32692,
-33792,
-35478,
-37899,
-40738,
-43454,
-45631,
-47186,
-48191,
-48630,
-48442,
-47642,
-46399,
-44920,
-43274,
-41416,
-39279,
-36859,
-34285,
-31720,
-29417,
-27533,
-26167,
-25215,
-24576,
-24130,
-23849,
-23667,
-23485,
-23218,
-22892,
-22642,
-22563,
-22627,
-22745,
-22902,
-23237,
-23872,
-24728,
-25551,
-26145,
-26632,
-27329,
-28497,
-30033,
-31696,
-33233,
-34679,
-36056,
-37363,
-38477,
-39351,
-39975,
-40369,
-40503,
-40456,
-40422,
-40543,
-40736,
-40707,
-40254,
-39490,
-38654,
-37955,
-37366,
-36833,
-36370,
-35997,
-35735,
-35545,
-35433,
-35343,
-35071,
-34457,
-33597,
-32911,
-32697,
-32784,
-32638,
-31958,
-30954,
-30135,
-29659,
-29302,
-28725,
-27955,
-27266,
-26915,
-26851,
-26897,
-26900,
-26888,
-26952,
-27191,
-27555,
-27926,
-28190,
-28375,
-28596,
-28865,
-29038,
-28991,
-28841,
-28828,
-29011,
-29182,
-29153,
-29072,
-29187,
-29530,
-29879,
-30232,
-31006,
-32525,
-34524,
-36300,
-37648,
-39100,
-41314,
-44003,
-46166,
-47077,
-47089,
-47059,
-47281,
-47183,
-46090,
-44021,
-41563,
-39266,
-37218,
-35314,
-33500,
-31792,
-30166,
-28670,
-27453,
-26692,
-26269,
-25888,
-25411,
-25015,
-24934,
-25082,
-25119,
-24871,
-24512,
-24302,
-24289,
-24329,
-24419,
-24735,
-25359,
-26137,
-26817,
-27439,
-28195,
-29179,
-30158,
-30906,
-31524,
-32311,
-33359,
-34308,
-34762,
-34749,
-34756,
-35247,
-36158,
-37107,
-37786,
-38335,
-39063,
-40068,
-41039,
-41517,
-41327,
-40749,
-40345,
-40512,
-41056,
-41336,
-40727,
-39237,
-37482,
-36107,
-35160,
-34145,
-32696,
-31092,
-29987,
-29663,
-29701,
-29406,
-28534,
-27480,
-26772,
-26611,
-26733,
-26857,
-26892,
-26978,
-27274,
-27751,
-28241,
-28483,
-28411,
-28247,
-28357,
-28880,
-29521,
-29884,
-29927,
-30069,
-30647,
-31468,
-31983,
-31988,
-31884,
-32217,
-32993,
-33698,
-33987,
-34137,
-34713,
-35857,
-37129,
-38018,
-38473,
-38816,
-39201,
-39492,
-39432,
-39105,
-38745,
-38511,
-38289,
-37875,
-37186,
-36273,
-35207,
-34081,
-32988,
-32007,
-31135,
-30325,
-29602,
-29071,
-28744,
-28402,
-27844,
-27095,
-26493,
-26293,
-26368,
-26353,
-26138,
-26025,
-26424,
-27396,
-28520,
-29460,
-30211,
-31128,
-32403,
-33908,
-35291,
-36402,
-37288,
-38070,
-38711,
-39105,
-39184,
-39042,
-38760,
-38405,
-37975,
-37516,
-37041,
-36516,
-35832,
-34952,
-33972,
-33034,
-32249,
-31565,
-30989,
-30527,
-30283,
-30183,
-30114,
-29925,
-29654,
-29443,
-29430,
-29625,
-29961,
-30320,
-30636,
-30864,
-31050,
-31266,
-31560,
-31857,
-31999,
-31934,
-31763,
-31671,
-31715,
-31786,
-31786,
-31692,
-31576,
-31423,
-31196,
-30940,
-30774,
-30712,
-30561,
-30077,
-29356,
-28761,
-28664,
-28978,
-29332,
-29445,
-29438,
-29654,
-30308,
-31401,
-32897,
-34851,
-37256,
-39890,
-42349,
-44332,
-45752,
-46633,
-46974,
-46737,
-45956,
-44740,
-43149,
-41227,
-39035,
-36780,
-34603,
-32497,
-30394,
-28427,
-26997,
-26458,
-26688,
-27179,
-27390,
-27281,
-27135,
-27210,
-27378,
-27299,
-26787,
-25975,
-25128,
-24375,
-23670,
-22969,
-22369,
-22022,
-22037,
-22389,
-23062,
-24054,
-25334,
-26777,
-28206,
-29520,
-30701,
-31728,
-32546,
-33202,
-33920,
-35004,
-36566,
-38415,
-40303,
-42149,
-44036,
-45946,
-47613,
-48778,
-49390,
-49671,
-49676,
-49291,
-48299,
-46758,
-44889,
-42774,
-40291,
-37347,
-34252,
-31538,
-29526,
-28050,
-26735,
-25466,
-24486,
-24037,
-24031,
-24084,
-23952,
-23717,
-23646,
-23881,
-24280,
-24582,
-24600,
-24365,
-24073,
-24003,
-24333,
-24982,
-25676,
-26157,
-26469,
-26859,
-27495,
-28193,
-28664,
-28907,
-29296,
-30210,
-31513,
-32658,
-33201,
-33284,
-33420,
-33997,
-34922,
-35921,
-36880,
-38031,
-39643,
-41834,
-44389,
-46909,
-48898,
-50072,
-50547,
-50766,
-50988,
-50920,
-49866,
-47504,
-44277,
-41062,
-38239,
-35520,
-32409,
-29070,
-26199,
-24359,
-23384,
-22681,
-21915,
-21263,
-21037,
-21195,
-21377,
-21327,
-21118,
-20981,
-21026,
-21149,
-21290,
-21473,
-21783,
-22218,
-22737,
-23388,
-24275,
-25418,
-26632,
-27727,
-28721,
-29924,
-31625,
-33714,
-35781,
-37388,
-38538,
-39531,
-40608,
-41662,
-42469,
-43009,
-43593,
-44499,
-45670,
-46749,
-47446,
-47694,
-47608,
-47225,
-46537,
-45601,
-44491,
-43210,
-41595,
-39516,
-37039,
-34375,
-31684,
-29002,
-26446,
-24236,
-22608,
-21511,
-20692,
-19977,
-19419,
-19194,
-19284,
-19581,
-20057,
-20857,
-22055,
-23428,
-24643,
-25594,
-26535,
-27694,
-29026,
-30221,
-31160,
-32051,
-33154,
-34455,
-35611,
-36346,
-36670,
-36816,
-36955,
-37094,
-37183,
-37276,
-37441,
-37718,
-37949,
-38013,
-37854,
-37586,
-37406,
-37399,
-37556,
-37769,
-38015,
-38365,
-38840,
-39292,
-39427,
-39089,
-38393,
-37609,
-36810,
-35809,
-34391,
-32618,
-30822,
-29211,
-27729,
-26180,
-24616,
-23375,
-22764,
-22739,
-23008,
-23311,
-23701,
-24363,
-25358,
-26563,
-27767,
-28880,
-29926,
-30947,
-31998,
-33109,
-34283,
-35446,
-36400,
-37028,
-37296,
-37365,
-37338,
-37246,
-37055,
-36788,
-36561,
-36432,
-36366,
-36218,
-35902,
-35411,
-34799,
-34150,
-33541,
-33064,
-32715,
-32440,
-32173,
-31976,
-31993,
-32239,
-32560,
-32744,
-32797,
-32909,
-33244,
-33641,
-33826,
-33704,
-33493,
-33461,
-33541,
-33353,
-32629,
-31512,
-30461,
-29783,
-29369,
-28912,
-28295,
-27767,
-27640,
-27963,
-28417,
-28687,
-28748,
-28859,
-29240,
-29788,
-30225,
-30404,
-30486,
-30801,
-31485,
-32425,
-33348,
-34114,
-34794,
-35573,
-36567,
-37678,
-38640,
-39217,
-39395,
-39389,
-39417,
-39442,
-39226,
-38591,
-37656,
-36736,
-36035,
-35482,
-34848,
-34015,
-33054,
-32174,
-31542,
-31181,
-30957,
-30650,
-30203,
-29774,
-29680,
-29961,
-30367,
-30500,
-30334,
-30150,
-30258,
-30539,
-30665,
-30421,
-29991,
-29711,
-29719,
-29897,
-30030,
-30012,
-29881,
-29732,
-29662,
-29695,
-29709,
-29607,
-29407,
-29319,
-29438,
-29558,
-29322,
-28694,
-28078,
-27923,
-28191,
-28434,
-28415,
-28494,
-29287,
-30901,
-32788,
-34337,
-35603,
-37257,
-39847,
-43194,
-46536,
-49214,
-51095,
-52368,
-53063,
-52835,
-51346,
-48638,
-45230,
-41741,
-38453,
-35345,
-32294,
-29406,
-26902,
-24950,
-23522,
-22527,
-21928,
-21728,
-21881,
-22193,
-22460,
-22547,
-22424,
-22195,
-21968,
-21909,
-22025,
-22276,
-22530,
-22846,
-23384,
-24309,
-25579,
-27027,
-28543,
-30174,
-31949,
-33747,
-35280,
-36439,
-37310,
-38076,
-38745,
-39130,
-39150,
-38971,
-38884,
-39023,
-39266,
-39484,
-39737,
-40216,
-40990,
-41875,
-42643,
-43227,
-43665,
-43956,
-43935,
-43490,
-42679,
-41642,
-40342,
-38625,
-36394,
-33890,
-31462,
-29327,
-27444,
-25716,
-24208,
-23026,
-22183,
-21585,
-21177,
-21056,
-21262,
-21641,
-22001,
-22322,
-22826,
-23696,
-24830,
-25975,
-27000,
-28032,
-29203,
-30470,
-31616,
-32515,
-33186,
-33729,
-34160,
-34463,
-34697,
-34936,
-35242,
-35576,
-35945,
-36393,
-36962,
-37512,
-37866,
-37935,
-37898,
-38021,
-38422,
-38984,
-39483,
-39820,
-40034,
-40218,
-40316,
-40188,
-39723,
-38977,
-38146,
-37353,
-36530,
-35434,
-33923,
-32122,
-30385,
-29001,
-27960,
-27062,
-26111,
-25223,
-24615,
-24431,
-24545,
-24653,
-24616,
-24531,
-24697,
-25365,
-26479,
-27806,
-29047,
-30170,
-31325,
-32687,
-34120,
-35283,
-35888,
-36049,
-36134,
-36393,
-36664,
-36585,
-36038,
-35274,
-34630,
-34112,
-33496,
-32642,
-31792,
-31270,
-31167,
-31266,
-31375,
-31536,
-31903,
-32511,
-33215,
-33927,
-34689,
-35534,
-36372,
-37077,
-37631,
-38118,
-38479,
-38510,
-38070,
-37283,
-36394,
-35469,
-34353,
-32964,
-31500,
-30312,
-29528,
-28964,
-28386,
-27743,
-27192,
-26878,
-26788,
-26859,
-26986,
-27111,
-27232,
-27449,
-27938,
-28779,
-29835,
-30899,
-31909,
-33002,
-34320,
-35720,
-36934,
-37748,
-38267,
-38672,
-39036,
-39177,
-38896,
-38162,
-37185,
-36232,
-35414,
-34625,
-33720,
-32721,
-31870,
-31360,
-31131,
-30910,
-30537,
-30223,
-30277,
-30801,
-31513,
-32085,
-32480,
-32872,
-33373,
-33832,
-34051,
-34006,
-33874,
-33735,
-33562,
-33209,
-32675,
-32000,
-31225,
-30369,
-29521,
-28849,
-28445,
-28241,
-28083,
-27942,
-27925,
-28120,
-28444,
-28665,
-28690,
-28590,
-28622,
-28868,
-29283,
-29671,
-30002,
-30335,
-30798,
-31386,
-31992,
-32516,
-32968,
-33475,
-34224,
-35369,
-36991,
-38955,
-41010,
-42887,
-44564,
-46136,
-47602,
-48572,
-48626,
-47676,
-46155,
-44514,
-42733,
-40406,
-37387,
-34154,
-31430,
-29433,
-27740,
-25939,
-24186,
-23074,
-22829,
-23018,
-23006,
-22672,
-22400,
-22558,
-22940,
-23148,
-22970,
-22671,
-22526,
-22599,
-22755,
-23027,
-23556,
-24473,
-25693,
-27129,
-28747,
-30563,
-32405,
-34036,
-35373,
-36567,
-37788,
-38978,
-39883,
-40356,
-40450,
-40341,
-40084,
-39710,
-39287,
-38988,
-38945,
-39177,
-39605,
-40144,
-40631,
-40928,
-40963,
-40867,
-40779,
-40691,
-40385,
-39736,
-38829,
-37890,
-36979,
-35968,
-34723,
-33284,
-31777,
-30339,
-29012,
-27862,
-26841,
-25802,
-24614,
-23422,
-22570,
-22266,
-22248,
-22128,
-21849,
-21832,
-22442,
-23518,
-24557,
-25272,
-25872,
-26689,
-27697,
-28622,
-29272,
-29790,
-30397,
-31147,
-31954,
-32758,
-33585,
-34417,
-35257,
-36128,
-37142,
-38195,
-39080,
-39611,
-40021,
-40632,
-41541,
-42353,
-42729,
-42728,
-42786,
-43057,
-43143,
-42527,
-41179,
-39699,
-38633,
-37918,
-37016,
-35554,
-33804,
-32294,
-31236,
-30297,
-29082,
-27632,
-26440,
-25883,
-25848,
-25859,
-25564,
-25007,
-24508,
-24296,
-24461,
-24929,
-25617,
-26398,
-27187,
-28005,
-28964,
-30091,
-31220,
-32126,
-32813,
-33492,
-34351,
-35255,
-35878,
-36042,
-35867,
-35608,
-35362,
-35085,
-34722,
-34371,
-34113,
-33987,
-33884,
-33779,
-33647,
-33509,
-33331,
-33066,
-32725,
-32342,
-32018,
-31799,
-31727,
-31729,
-31733,
-31726,
-31761,
-31948,
-32252,
-32621,
-32967,
-33319,
-33670,
-34016,
-34360,
-34766,
-35261,
-35702,
-35895,
-35817,
-35712,
-35834,
-36131,
-36336,
-36282,
-36135,
-36109,
-36147,
-35959,
-35393,
-34645,
-34004,
-33485,
-32894,
-32104,
-31279,
-30614,
-30046,
-29352,
-28411,
-27400,
-26625,
-26222,
-26122,
-26207,
-26351,
-26507,
-26625,
-26704,
-26818,
-26967,
-27107,
-27175,
-27234,
-27478,
-28006,
-28791,
-29690,
-30651,
-31726,
-32976,
-34398,
-35935,
-37571,
-39245,
-40851,
-42201,
-43198,
-43887,
-44318,
-44445,
-44098,
-43183,
-41890,
-40541,
-39379,
-38363,
-37232,
-35839,
-34264,
-32758,
-31501,
-30475,
-29580,
-28785,
-28162,
-27759,
-27507,
-27265,
-26993,
-26740,
-26612,
-26591,
-26616,
-26672,
-26874,
-27317,
-27980,
-28642,
-29095,
-29276,
-29351,
-29510,
-29867,
-30331,
-30803,
-31242,
-31700,
-32210,
-32674,
-32969,
-33037,
-33016,
-33114,
-33444,
-33979,
-34582,
-35187,
-35834,
-36587,
-37455,
-38285,
-38836,
-38960,
-38694,
-38316,
-38067,
-37970,
-37804,
-37316,
-36527,
-35631,
-34852,
-34175,
-33480,
-32681,
-31829,
-30993,
-30177,
-29410,
-28755,
-28328,
-28087,
-27909,
-27669,
-27410,
-27219,
-27154,
-27169,
-27275,
-27523,
-27899,
-28311,
-28631,
-28983,
-29550,
-30467,
-31547,
-32572,
-33510,
-34598,
-36048,
-37743,
-39307,
-40344,
-40792,
-40813,
-40666,
-40429,
-39994,
-39244,
-38165,
-36989,
-35962,
-35179,
-34500,
-33679,
-32635,
-31527,
-30578,
-29909,
-29441,
-29008,
-28491,
-27851,
-27130,
-26434,
-25851,
-25465,
-25300,
-25436,
-25991,
-27015,
-28370,
-29778,
-31023,
-32108,
-33138,
-34134,
-34974,
-35594,
-36045,
-36435,
-36759,
-36875,
-36793,
-36603,
-36435,
-36199,
-35763,
-35108,
-34401,
-33730,
-32989,
-32043,
-31001,
-30161,
-29703,
-29468,
-29212,
-28921,
-28874,
-29235,
-29865,
-30502,
-31145,
-32154,
-33780,
-35898,
-37991,
-39660,
-40774,
-41392,
-41458,
-40864,
-39661,
-38175,
-36749,
-35492,
-34226,
-32811,
-31349,
-30101,
-29256,
-28756,
-28459,
-28286,
-28317,
-28671,
-29377,
-30300,
-31210,
-31860,
-32165,
-32247,
-32320,
-32490,
-32614,
-32413,
-31765,
-30890,
-30132,
-29765,
-29676,
-29629,
-29397,
-29034,
-28677,
-28430,
-28222,
-27875,
-27363,
-26799,
-26443,
-26362,
-26403,
-26332,
-26060,
-25847,
-26012,
-26783,
-28076,
-29724,
-31548,
-33570,
-35903,
-38792,
-42371,
-46523,
-50728,
-54330,
-56859,
-58277,
-58662,
-57947,
-55818,
-52217,
-47568,
-42709,
-38275,
-34415,
-30946,
-27755,
-24983,
-22844,
-21406,
-20597,
-20321,
-20533,
-21095,
-21749,
-22149,
-22093,
-21586,
-20800,
-19909,
-19038,
-18234,
-17634,
-17388,
-17695,
-18595,
-20036,
-21916,
-24171,
-26743,
-29429,
-31944,
-34078,
-35890,
-37602,
-39304,
-40813,
-41803,
-42199,
-42240,
-42318,
-42601,
-42988,
-43297,
-43506,
-43757,
-44126,
-44497,
-44584,
-44257,
-43636,
-43028,
-42593,
-42184,
-41519,
-40510,
-39359,
-38296,
-37235,
-35826,
-33907,
-31777,
-30026,
-28874,
-28045,
-26972,
-25534,
-24046,
-22958,
-22289,
-21686,
-20871,
-19975,
-19483,
-19734,
-20638,
-21735,
-22621,
-23235,
-23910,
-24953,
-26393,
-27860,
-29000,
-29763,
-30464,
-31357,
-32364,
-33078,
-33256,
-33085,
-33107,
-33712,
-34861,
-36156,
-37291,
-38279,
-39315,
-40456,
-41432,
-41996,
-42150,
-42269,
-42624,
-43121,
-43394,
-43233,
-42797,
-42344,
-41856,
-41068,
-39820,
-38256,
-36641,
-35002,
-33239,
-31399,
-29813,
-28699,
-27936,
-27116,
-26110,
-25184,
-24649,
-24535,
-24560,
-24603,
-24764,
-25215,
-25834,
-26394,
-26820,
-27312,
-28101,
-29116,
-30123,
-30924,
-31561,
-32149,
-32664,
-32984,
-33027,
-32885,
-32754,
-32723,
-32771,
-32845,
-32948,
-33118,
-33268,
-33278,
-33112,
-32990,
-33160,
-33607,
-34010,
-34041,
-33723,
-33369,
-33138,
-32907,
-32480,
-32067,
-32122,
-32887,
-34036,
-35075,
-35890,
-36856,
-38197,
-39550,
-40204,
-39878,
-39020,
-38359,
-38070,
-37734,
-36879,
-35630,
-34559,
-34049,
-33855,
-33420,
-32528,
-31516,
-30893,
-30736,
-30685,
-30356,
-29765,
-29233,
-28914,
-28662,
-28187,
-27477,
-26779,
-26368,
-26302,
-26452,
-26718,
-27025,
-27370,
-27691,
-28035,
-28455,
-29016,
-29597,
-30063,
-30387,
-30750,
-31345,
-32139,
-32908,
-33458,
-33876,
-34372,
-35084,
-35840,
-36472,
-36991,
-37642,
-38551,
-39522,
-40214,
-40555,
-40761,
-41050,
-41225,
-40893,
-39946,
-38746,
-37777,
-37051,
-36208,
-34945,
-33449,
-32125,
-31155,
-30346,
-29498,
-28621,
-27897,
-27372,
-26920,
-26468,
-26012,
-25612,
-25237,
-24902,
-24768,
-24962,
-25424,
-25884,
-26218,
-26642,
-27494,
-28829,
-30382,
-31795,
-33086,
-34437,
-35987,
-37522,
-38709,
-39385,
-39645,
-39717,
-39726,
-39664,
-39459,
-39073,
-38495,
-37772,
-37006,
-36310,
-35747,
-35283,
-34858,
-34506,
-34325,
-34336,
-34366,
-34153,
-33598,
-32880,
-32283,
-31904,
-31603,
-31200,
-30676,
-30152,
-29681,
-29174,
-28583,
-27960,
-27499,
-27202,
-27014,
-26828,
-26763,
-26920,
-27235,
-27415,
-27205,
-26664,
-26092,
-25688,
-25411,
-25024,
-24574,
-24379,
-24856,
-26071,
-27725,
-29407,
-31019,
-32710,
-34723,
-37075,
-39744,
-42761,
-46217,
-49987,
-53566,
-56262,
-57602,
-57507,
-56194,
-53869,
-50720,
-46942,
-42931,
-39059,
-35561,
-32417,
-29472,
-26708,
-24267,
-22451,
-21453,
-21218,
-21472,
-21868,
-22197,
-22380,
-22371,
-22084,
-21474,
-20689,
-20006,
-19702,
-19806,
-20217,
-20809,
-21620,
-22708,
-24058,
-25548,
-27090,
-28744,
-30604,
-32577,
-34392,
-35752,
-36665,
-37323,
-37869,
-38162,
-37981,
-37374,
-36743,
-36521,
-36800,
-37368,
-38035,
-38937,
-40329,
-42242,
-44310,
-45992,
-46969,
-47350,
-47498,
-47734,
-47954,
-47716,
-46603,
-44628,
-42275,
-39936,
-37513,
-34596,
-31107,
-27657,
-25066,
-23553,
-22597,
-21572,
-20396,
-19505,
-19184,
-19280,
-19446,
-19637,
-20068,
-20881,
-21883,
-22747,
-23321,
-23713,
-24135,
-24723,
-25434,
-26166,
-26789,
-27320,
-27859,
-28484,
-29196,
-29992,
-31059,
-32589,
-34513,
-36380,
-37837,
-39024,
-40469,
-42357,
-44241,
-45521,
-46172,
-46756,
-47623,
-48438,
-48564,
-47890,
-46883,
-45951,
-44933,
-43396,
-41330,
-39130,
-37128,
-35187,
-33022,
-30713,
-28613,
-27037,
-25896,
-25001,
-24265,
-23669,
-23125,
-22552,
-22079,
-21976,
-22307,
-22788,
-23115,
-23398,
-23985,
-25051,
-26242,
-27118,
-27601,
-28056,
-28829,
-29839,
-30746,
-31312,
-31623,
-31936,
-32397,
-32991,
-33607,
-34134,
-34533,
-34843,
-35210,
-35785,
-36539,
-37244,
-37623,
-37562,
-37287,
-37099,
-37167,
-37387,
-37489,
-37402,
-37257,
-37305,
-37576,
-37844,
-37863,
-37596,
-37259,
-37015,
-36843,
-36561,
-36091,
-35468,
-34730,
-33817,
-32684,
-31498,
-30559,
-30033,
-29810,
-29618,
-29366,
-29197,
-29236,
-29409,
-29412,
-29079,
-28551,
-28172,
-28202,
-28511,
-28766,
-28670,
-28297,
-28034,
-28206,
-28781,
-29355,
-29564,
-29490,
-29567,
-30191,
-31269,
-32321,
-32958,
-33155,
-33274,
-33584,
-34070,
-34477,
-34547,
-34331,
-34091,
-34211,
-34816,
-35693,
-36392,
-36679,
-36780,
-37139,
-37910,
-38644,
-38754,
-38101,
-37170,
-36528,
-36241,
-35913,
-35272,
-34418,
-33670,
-33076,
-32469,
-31819,
-31296,
-31043,
-30828,
-30301,
-29406,
-28521,
-28019,
-27861,
-27637,
-27019,
-26112,
-25355,
-25179,
-25683,
-26624,
-27592,
-28365,
-29127,
-30252,
-31912,
-33767,
-35322,
-36425,
-37464,
-38791,
-40270,
-41307,
-41558,
-41205,
-40680,
-40121,
-39307,
-38148,
-36891,
-35925,
-35290,
-34727,
-33947,
-32978,
-32013,
-31186,
-30515,
-29974,
-29588,
-29365,
-29248,
-29198,
-29172,
-29170,
-29157,
-29181,
-29343,
-29742,
-30255,
-30639,
-30744,
-30681,
-30751,
-31010,
-31250,
-31105,
-30525,
-29837,
-29458,
-29530,
-29701,
-29546,
-28913,
-28144,
-27767,
-27991,
-28609,
-29189,
-29509,
-29671,
-29930,
-30465,
-31308,
-32405,
-33654,
-34945,
-36242,
-37678,
-39437,
-41484,
-43441,
-44828,
-45499,
-45755,
-45973,
-46179,
-45999,
-45080,
-43459,
-41457,
-39369,
-37216,
-34964,
-32724,
-30760,
-29267,
-28198,
-27427,
-26839,
-26482,
-26337,
-26338,
-26379,
-26391,
-26362,
-26225,
-25926,
-25480,
-24984,
-24521,
-24064,
-23585,
-23171,
-23015,
-23208,
-23625,
-24014,
-24297,
-24549,
-24979,
-25658,
-26638,
-27917,
-29396,
-30766,
-31670,
-32028,
-32247,
-32848,
-34059,
-35638,
-37295,
-39109,
-41422,
-44345,
-47432,
-49923,
-51357,
-51858,
-51953,
-52007,
-51994,
-51498,
-50205,
-48088,
-45502,
-42830,
-40249,
-37615,
-34817,
-31939,
-29380,
-27417,
-26045,
-24912,
-23741,
-22518,
-21463,
-20720,
-20217,
-19743,
-19215,
-18713,
-18386,
-18233,
-18161,
-18094,
-18164,
-18561,
-19388,
-20526,
-21734,
-22880,
-24018,
-25301,
-26816,
-28459,
-30048,
-31483,
-32820,
-34285,
-36001,
-37948,
-39901,
-41664,
-43196,
-44590,
-45960,
-47285,
-48527,
-49647,
-50628,
-51369,
-51713,
-51529,
-50848,
-49697,
-48071,
-45906,
-43311,
-40588,
-38036,
-35721,
-33496,
-31242,
-29068,
-27141,
-25528,
-24148,
-22929,
-21960,
-21333,
-21052,
-20980,
-20999,
-20992,
-20930,
-20765,
-20599,
-20638,
-21050,
-21796,
-22677,
-23505,
-24288,
-25114,
-25934,
-26648,
-27105,
-27430,
-27779,
-28397,
-29390,
-30847,
-32657,
-34512,
-35949,
-36726,
-37033,
-37408,
-38173,
-39277,
-40362,
-41400,
-42637,
-44365,
-46279,
-47721,
-48178,
-47819,
-47268,
-46926,
-46612,
-45827,
-44356,
-42478,
-40605,
-38830,
-36843,
-34370,
-31494,
-28738,
-26585,
-25214,
-24351,
-23632,
-22857,
-22134,
-21677,
-21524,
-21563,
-21637,
-21836,
-22356,
-23306,
-24496,
-25608,
-26458,
-27082,
-27663,
-28216,
-28709,
-29061,
-29380,
-29791,
-30401,
-31143,
-31880,
-32497,
-32987,
-33442,
-33963,
-34545,
-35111,
-35596,
-36072,
-36659,
-37363,
-38030,
-38465,
-38689,
-38930,
-39358,
-39930,
-40389,
-40583,
-40646,
-40795,
-41085,
-41259,
-41002,
-40238,
-39206,
-38110,
-36972,
-35554,
-33773,
-31830,
-30077,
-28716,
-27643,
-26704,
-25842,
-25196,
-24784,
-24530,
-24320,
-24193,
-24277,
-24612,
-25118,
-25715,
-26424,
-27288,
-28242,
-29143,
-29893,
-30527,
-31113,
-31682,
-32247,
-32858,
-33550,
-34270,
-34841,
-35202,
-35411,
-35632,
-35874,
-36062,
-36107,
-36072,
-36078,
-36163,
-36315,
-36455,
-36563,
-36611,
-36604,
-36646,
-36824,
-37162,
-37428,
-37397,
-36990,
-36451,
-36008,
-35720,
-35329,
-34613,
-33533,
-32328,
-31233,
-30363,
-29627,
-28919,
-28230,
-27684,
-27412,
-27373,
-27414,
-27347,
-27206,
-27099,
-27107,
-27154,
-27136,
-27129,
-27270,
-27600,
-27900,
-27944,
-27764,
-27739,
-28233,
-29299,
-30610,
-31833,
-32924,
-34156,
-35759,
-37622,
-39371,
-40628,
-41458,
-42126,
-42865,
-43521,
-43742,
-43365,
-42563,
-41672,
-40779,
-39791,
-38562,
-37232,
-36000,
-34978,
-34053,
-33120,
-32174,
-31315,
-30584,
-29967,
-29438,
-28975,
-28496,
-27900,
-27148,
-26395,
-25805,
-25447,
-25214,
-25044,
-24974,
-25115,
-25457,
-25837,
-26139,
-26327,
-26508,
-26760,
-27080,
-27433,
-27812,
-28251,
-28825,
-29520,
-30256,
-30894,
-31432,
-32004,
-32768,
-33685,
-34509,
-35111,
-35631,
-36435,
-37683,
-39193,
-40669,
-41990,
-43242,
-44376,
-45126,
-45191,
-44623,
-43741,
-42844,
-41936,
-40871,
-39586,
-38241,
-36927,
-35657,
-34281,
-32842,
-31528,
-30652,
-30362,
-30536,
-30834,
-30902,
-30623,
-30074,
-29394,
-28572,
-27519,
-26347,
-25313,
-24695,
-24413,
-24187,
-23821,
-23422,
-23231,
-23331,
-23572,
-23807,
-24011,
-24266,
-24601,
-24958,
-25314,
-25664,
-26036,
-26476,
-27075,
-27951,
-29066,
-30266,
-31408,
-32662,
-34333,
-36597,
-39287,
-42064,
-44781,
-47396,
-49860,
-51848,
-53086,
-53513,
-53305,
-52596,
-51354,
-49544,
-47270,
-44762,
-42103,
-39290,
-36363,
-33547,
-31097,
-29080,
-27404,
-26011,
-24974,
-24340,
-23948,
-23512,
-22898,
-22222,
-21720,
-21441,
-21236,
-20959,
-20643,
-20479,
-20576,
-20899,
-21312,
-21783,
-22376,
-23208,
-24258,
-25445,
-26615,
-27712,
-28727,
-29729,
-30815,
-32052,
-33395,
-34664,
-35685,
-36479,
-37366,
-38647,
-40322,
-41949,
-43106,
-43782,
-44468,
-45556,
-46870,
-47772,
-47808,
-47199,
-46584,
-46286,
-45969,
-44965,
-43006,
-40421,
-37835,
-35555,
-33510,
-31487,
-29487,
-27734,
-26413,
-25522,
-24856,
-24187,
-23445,
-22735,
-22292,
-22264,
-22601,
-23116,
-23615,
-24092,
-24617,
-25196,
-25764,
-26238,
-26723,
-27333,
-28130,
-28936,
-29603,
-30097,
-30535,
-30994,
-31368,
-31558,
-31611,
-31820,
-32426,
-33389,
-34420,
-35258,
-35934,
-36656,
-37525,
-38363,
-38929,
-39240,
-39588,
-40257,
-41148,
-41908,
-42239,
-42210,
-42020,
-41699,
-41024,
-39836,
-38352,
-36992,
-35947,
-34987,
-33696,
-31993,
-30196,
-28694,
-27567,
-26586,
-25558,
-24596,
-23984,
-23909,
-24286,
-24875,
-25488,
-26075,
-26697,
-27435,
-28313,
-29288,
-30237,
-31136,
-32045,
-33100,
-34219,
-35136,
-35562,
-35538,
-35377,
-35347,
-35356,
-35122,
-34545,
-33942,
-33697,
-33879,
-34144,
-34079,
-33635,
-33066,
-32722,
-32745,
-33018,
-33402,
-33715,
-33973,
-34205,
-34513,
-34860,
-35197,
-35441,
-35648,
-35885,
-36096,
-36135,
-35890,
-35385,
-34746,
-33975,
-33013,
-31885,
-30778,
-29908,
-29308,
-28848,
-28449,
-28145,
-28008,
-27927,
-27756,
-27468,
-27272,
-27306,
-27489,
-27526,
-27282,
-26953,
-26910,
-27350,
-28119,
-28849,
-29364,
-29786,
-30522,
-31833,
-33664,
-35703,
-37686,
-39663,
-41839,
-44225,
-46401,
-47779,
-48037,
-47393,
-46329,
-45129,
-43712,
-41860,
-39607,
-37286,
-35185,
-33326,
-31478,
-29582,
-27862,
-26700,
-26193,
-26074,
-25957,
-25707,
-25545,
-25705,
-26110,
-26355,
-26081,
-25400,
-24799,
-24742,
-25207,
-25741,
-25951,
-25867,
-25878,
-26227,
-26770,
-27175,
-27394,
-27736,
-28562,
-29861,
-31334,
-32668,
-33819,
-34860,
-35807,
-36619,
-37237,
-37714,
-38079,
-38401,
-38771,
-39317,
-39974,
-40561,
-40903,
-41101,
-41324,
-41525,
-41383,
-40722,
-39818,
-39120,
-38687,
-38098,
-36931,
-35387,
-33982,
-33045,
-32267,
-31275,
-30036,
-28993,
-28466,
-28403,
-28456,
-28439,
-28408,
-28561,
-28971,
-29498,
-29864,
-29759,
-29175,
-28388,
-27853,
-27746,
-27895,
-27978,
-27922,
-27931,
-28233,
-28798,
-29432,
-29870,
-30017,
-29896,
-29712,
-29708,
-29954,
-30201,
-30106,
-29582,
-29013,
-28839,
-29200,
-29823,
-30440,
-30999,
-31670,
-32594,
-33856,
-35492,
-37401,
-39329,
-41004,
-42477,
-44015,
-45701,
-47118,
-47668,
-47203,
-46154,
-45017,
-43771,
-42039,
-39660,
-37030,
-34730,
-32974,
-31513,
-30012,
-28433,
-27022,
-26058,
-25561,
-25340,
-25110,
-24794,
-24571,
-24728,
-25308,
-25993,
-26349,
-26289,
-26099,
-26183,
-26619,
-27130,
-27484,
-27651,
-27859,
-28238,
-28723,
-29104,
-29283,
-29340,
-29462,
-29808,
-30341,
-31058,
-31940,
-33079,
-34357,
-35527,
-36346,
-36900,
-37494,
-38348,
-39294,
-40094,
-40695,
-41326,
-42077,
-42680,
-42798,
-42413,
-41865,
-41385,
-40842,
-39943,
-38664,
-37299,
-36064,
-34877,
-33499,
-31907,
-30374,
-29178,
-28375,
-27780,
-27188,
-26509,
-25793,
-25158,
-24729,
-24560,
-24609,
-24826,
-25241,
-25938,
-26926,
-28023,
-28974,
-29657,
-30209,
-30862,
-31723,
-32635,
-33354,
-33757,
-34009,
-34317,
-34741,
-35030,
-34945,
-34532,
-34145,
-34108,
-34351,
-34551,
-34496,
-34331,
-34322,
-34494,
-34646,
-34613,
-34584,
-34804,
-35323,
-35878,
-36204,
-36299,
-36322,
-36315,
-36138,
-35648,
-34933,
-34238,
-33728,
-33314,
-32831,
-32174,
-31473,
-30849,
-30355,
-29881,
-29344,
-28747,
-28183,
-27722,
-27398,
-27201,
-27133,
-27127,
-27093,
-26969,
-26897,
-27084,
-27649,
-28466,
-29322,
-30244,
-31475,
-33215,
-35312,
-37328,
-38997,
-40327,
-41555,
-42640,
-43366,
-43516,
-43183,
-42629,
-41982,
-41124,
-39902,
-38327,
-36653,
-35088,
-33696,
-32398,
-31132,
-29966,
-29003,
-28294,
-27774,
-27338,
-26987,
-26816,
-26937,
-27273,
-27579,
-27637,
-27478,
-27391,
-27609,
-28085,
-28503,
-28668,
-28661,
-28781,
-29111,
-29423,
-29369,
-28895,
-28360,
-28219,
-28643,
-29376,
-30083,
-30628,
-31209,
-31980,
-32847,
-33536,
-33886,
-34111,
-34551,
-35406,
-36493,
-37539,
-38388,
-39181,
-40116,
-41219,
-42288,
-43033,
-43307,
-43209,
-42961,
-42675,
-42227,
-41348,
-39944,
-38296,
-36776,
-35592,
-34466,
-33080,
-31377,
-29727,
-28523,
-27852,
-27468,
-27139,
-26830,
-26653,
-26626,
-26629,
-26535,
-26295,
-25999,
-25722,
-25558,
-25523,
-25628,
-25813,
-26070,
-26341,
-26591,
-26702,
-26664,
-26548,
-26547,
-26717,
-26947,
-27162,
-27403,
-27926,
-28778,
-29776,
-30624,
-31272,
-32018,
-33200,
-34890,
-36823,
-38703,
-40505,
-42494,
-44877,
-47487,
-49728,
-51045,
-51349,
-51090,
-50741,
-50229,
-49057,
-46808,
-43789,
-40692,
-37988,
-35516,
-32835,
-29932,
-27269,
-25397,
-24365,
-23755,
-23181,
-22597,
-22251,
-22298,
-22591,
-22794,
-22672,
-22325,
-22055,
-22158,
-22593,
-23086,
-23407,
-23598,
-23961,
-24687,
-25710,
-26817,
-27852,
-28870,
-29930,
-31038,
-32102,
-33095,
-34020,
-34895,
-35657,
-36214,
-36502,
-36600,
-36748,
-37282,
-38352,
-39761,
-41078,
-42087,
-42988,
-44157,
-45511,
-46490,
-46532,
-45751,
-44802,
-44125,
-43445,
-42103,
-39863,
-37182,
-34698,
-32601,
-30634,
-28601,
-26691,
-25202,
-24232,
-23586,
-23173,
-23024,
-23166,
-23449,
-23692,
-23996,
-24608,
-25572,
-26581,
-27268,
-27658,
-28100,
-28827,
-29626,
-30130,
-30265,
-30346,
-30676,
-31182,
-31602,
-31826,
-32050,
-32403,
-32763,
-32865,
-32786,
-32837,
-33287,
-33982,
-34573,
-35006,
-35519,
-36360,
-37293,
-37932,
-38150,
-38370,
-39051,
-40155,
-41152,
-41511,
-41305,
-40897,
-40575,
-40117,
-39168,
-37624,
-35754,
-33910,
-32227,
-30641,
-29120,
-27722,
-26581,
-25715,
-25100,
-24722,
-24560,
-24605,
-24778,
-25068,
-25526,
-26214,
-27110,
-28060,
-28942,
-29746,
-30645,
-31784,
-33128,
-34432,
-35412,
-36055,
-36554,
-37093,
-37569,
-37676,
-37338,
-36835,
-36589,
-36672,
-36759,
-36515,
-35954,
-35310,
-34681,
-33912,
-32947,
-31995,
-31336,
-30917,
-30477,
-29944,
-29655,
-29918,
-30565,
-31083,
-31233,
-31282,
-31633,
-32205,
-32529,
-32312,
-31761,
-31341,
-31221,
-31227,
-31135,
-30964,
-30876,
-30955,
-31172,
-31425,
-31637,
-31731,
-31750,
-31933,
-32561,
-33636,
-34761,
-35448,
-35586,
-35501,
-35561,
-35691,
-35517,
-34741,
-33586,
-32568,
-32064,
-32011,
-32048,
-31991,
-31958,
-32237,
-32841,
-33445,
-33710,
-33604,
-33449,
-33464,
-33593,
-33606,
-33503,
-33457,
-33548,
-33512,
-33086,
-32315,
-31621,
-31292,
-31235,
-31202,
-31158,
-31345,
-31918,
-32649,
-33163,
-33277,
-33137,
-33030,
-33081,
-33225,
-33340,
-33328,
-33237,
-33191,
-33343,
-33705,
-34105,
-34327,
-34293,
-34108,
-33866,
-33542,
-33022,
-32264,
-31327,
-30283,
-29193,
-28136,
-27183,
-26327,
-25428,
-24399,
-23431,
-22859,
-22888,
-23308,
-23743,
-24073,
-24582,
-25637,
-27154,
-28649,
-29737,
-30778,
-32776,
-36481,
-41670,
-47033,
-51340,
-54168,
-55981,
-57130,
-57336,
-56040,
-53268,
-49849,
-46592,
-43656,
-40560,
-37062,
-33459,
-30254,
-27607,
-25402,
-23725,
-22906,
-23071,
-23782,
-24293,
-24228,
-23731,
-23106,
-22410,
-21457,
-20253,
-19064,
-18231,
-17873,
-17890,
-18199,
-18835,
-19963,
-21625,
-23776,
-26199,
-28673,
-31024,
-33181,
-35162,
-36971,
-38551,
-39740,
-40453,
-40732,
-40885,
-41203,
-41766,
-42296,
-42500,
-42438,
-42578,
-43225,
-44119,
-44516,
-44074,
-43123,
-42412,
-42062,
-41538,
-40140,
-37958,
-35697,
-34051,
-33008,
-32083,
-30940,
-29687,
-28765,
-28415,
-28569,
-28867,
-28938,
-28660,
-28181,
-27802,
-27610,
-27364,
-26782,
-25891,
-25132,
-24912,
-25222,
-25639,
-25845,
-25918,
-26221,
-26949,
-27945,
-28899,
-29706,
-30486,
-31357,
-32195,
-32673,
-32611,
-32099,
-31495,
-31048,
-30799,
-30658,
-30599,
-30802,
-31412,
-32488,
-33812,
-35126,
-36204,
-37061,
-37945,
-39139,
-40703,
-42325,
-43534,
-44145,
-44298,
-44224,
-43818,
-42752,
-40965,
-38852,
-36995,
-35567,
-34322,
-32985,
-31629,
-30487,
-29564,
-28623,
-27523,
-26478,
-25863,
-25785,
-26072,
-26456,
-26809,
-27152,
-27510,
-27947,
-28531,
-29239,
-29935,
-30458,
-30898,
-31460,
-32219,
-32900,
-33128,
-32869,
-32438,
-32208,
-32213,
-32273,
-32253,
-32242,
-32333,
-32490,
-32575,
-32533,
-32459,
-32451,
-32604,
-32911,
-33379,
-33909,
-34326,
-34484,
-34330,
-33956,
-33458,
-32917,
-32426,
-32121,
-32108,
-32383,
-32766,
-33037,
-32970,
-32536,
-31923,
-31505,
-31563,
-32043,
-32630,
-33174,
-33899,
-35161,
-36818,
-38193,
-38645,
-38284,
-37910,
-38123,
-38757,
-39091,
-38735,
-37948,
-37222,
-36600,
-35686,
-34222,
-32454,
-30918,
-29899,
-29272,
-28772,
-28295,
-27837,
-27395,
-26887,
-26376,
-25995,
-25853,
-25883,
-25969,
-26090,
-26258,
-26381,
-26295,
-25966,
-25688,
-25820,
-26488,
-27524,
-28726,
-30084,
-31655,
-33285,
-34682,
-35771,
-36816,
-38174,
-39759,
-41135,
-41973,
-42404,
-42755,
-43002,
-42746,
-41721,
-40259,
-39022,
-38306,
-37851,
-37172,
-36258,
-35439,
-35000,
-34781,
-34386,
-33624,
-32612,
-31555,
-30571,
-29605,
-28617,
-27582,
-26546,
-25659,
-25124,
-25023,
-25173,
-25295,
-25302,
-25468,
-26070,
-27066,
-28122,
-28985,
-29813,
-30872,
-32191,
-33392,
-34117,
-34363,
-34490,
-34788,
-35233,
-35583,
-35715,
-35769,
-35943,
-36241,
-36466,
-36445,
-36263,
-36117,
-36127,
-36161,
-36085,
-35873,
-35646,
-35431,
-35171,
-34903,
-34777,
-34893,
-34986,
-34685,
-33882,
-32964,
-32295,
-31806,
-31035,
-29817,
-28523,
-27774,
-27651,
-27725,
-27513,
-27017,
-26572,
-26399,
-26351,
-26150,
-25702,
-25175,
-24843,
-24899,
-25323,
-25890,
-26352,
-26729,
-27354,
-28643,
-30608,
-32900,
-35137,
-37369,
-39941,
-43122,
-46687,
-50081,
-52700,
-54176,
-54508,
-53912,
-52627,
-50639,
-47740,
-43888,
-39586,
-35659,
-32634,
-30293,
-28087,
-25777,
-23802,
-22673,
-22408,
-22502,
-22461,
-22317,
-22390,
-22816,
-23291,
-23318,
-22737,
-21891,
-21363,
-21512,
-22151,
-22822,
-23229,
-23582,
-24352,
-25787,
-27615,
-29344,
-30660,
-31714,
-32787,
-34045,
-35354,
-36467,
-37213,
-37554,
-37599,
-37474,
-37314,
-37137,
-37000,
-36993,
-37355,
-38246,
-39648,
-41285,
-42791,
-43984,
-44869,
-45651,
-46384,
-46984,
-47176,
-46857,
-46068,
-45001,
-43614,
-41708,
-39060,
-35813,
-32352,
-29119,
-26291,
-23902,
-21981,
-20559,
-19651,
-19130,
-18912,
-18951,
-19230,
-19703,
-20370,
-21280,
-22433,
-23623,
-24531,
-25016,
-25233,
-25454,
-25776,
-26151,
-26572,
-27158,
-27940,
-28762,
-29462,
-30176,
-31194,
-32640,
-34242,
-35692,
-37022,
-38540,
-40370,
-42122,
-43248,
-43560,
-43488,
-43679,
-44402,
-45402,
-46137,
-46322,
-46093,
-45772,
-45429,
-44736,
-43274,
-41038,
-38542,
-36383,
-34708,
-33124,
-31243,
-29149,
-27351,
-26190,
-25500,
-24783,
-23824,
-22912,
-22514,
-22785,
-23366,
-23802,
-23975,
-24167,
-24725,
-25626,
-26546,
-27165,
-27519,
-27884,
-28483,
-29233,
-29906,
-30345,
-30649,
-30965,
-31380,
-31782,
-32072,
-32260,
-32504,
-32928,
-33480,
-33964,
-34231,
-34384,
-34632,
-35090,
-35578,
-35901,
-36088,
-36452,
-37255,
-38352,
-39392,
-40103,
-40580,
-41030,
-41447,
-41605,
-41280,
-40553,
-39683,
-38880,
-38077,
-37003,
-35462,
-33540,
-31663,
-30270,
-29436,
-28816,
-28000,
-27039,
-26391,
-26409,
-26865,
-27146,
-26975,
-26635,
-26674,
-27192,
-27812,
-28128,
-28111,
-28068,
-28276,
-28796,
-29549,
-30405,
-31223,
-31929,
-32602,
-33401,
-34273,
-34940,
-35122,
-34978,
-34934,
-35160,
-35335,
-35001,
-34236,
-33582,
-33477,
-33717,
-33812,
-33622,
-33579,
-34149,
-35253,
-36349,
-36957,
-37102,
-37099,
-37168,
-37160,
-36801,
-35933,
-34737,
-33544,
-32622,
-31929,
-31228,
-30317,
-29323,
-28532,
-28148,
-28043,
-27948,
-27805,
-27801,
-28123,
-28667,
-29099,
-29213,
-29151,
-29203,
-29486,
-29738,
-29703,
-29416,
-29363,
-29996,
-31299,
-32790,
-33983,
-34925,
-36065,
-37720,
-39644,
-41260,
-42226,
-42683,
-42948,
-43066,
-42773,
-41868,
-40451,
-38806,
-37130,
-35462,
-33798,
-32219,
-30799,
-29576,
-28577,
-27817,
-27311,
-26970,
-26710,
-26542,
-26533,
-26702,
-26940,
-27119,
-27240,
-27396,
-27662,
-28027,
-28412,
-28786,
-29152,
-29585,
-30163,
-30903,
-31630,
-32114,
-32236,
-32198,
-32244,
-32422,
-32513,
-32428,
-32398,
-32741,
-33383,
-33906,
-33971,
-33765,
-33669,
-33786,
-33831,
-33602,
-33350,
-33545,
-34342,
-35447,
-36515,
-37455,
-38387,
-39226,
-39669,
-39533,
-38998,
-38508,
-38363,
-38449,
-38497,
-38274,
-37779,
-37050,
-36007,
-34551,
-32801,
-31184,
-30201,
-29970,
-30150,
-30217,
-29985,
-29633,
-29363,
-29147,
-28739,
-28154,
-27636,
-27469,
-27601,
-27753,
-27720,
-27508,
-27228,
-26912,
-26562,
-26316,
-26351,
-26702,
-27077,
-27147,
-26871,
-26612,
-26799,
-27440,
-28110,
-28396,
-28419,
-28798,
-29924,
-31566,
-32977,
-33833,
-34552,
-35864,
-37982,
-40416,
-42576,
-44395,
-46164,
-47944,
-49361,
-49983,
-49803,
-49072,
-47967,
-46411,
-44435,
-42272,
-40175,
-38179,
-36142,
-34144,
-32389,
-31038,
-29915,
-28794,
-27623,
-26557,
-25664,
-24824,
-23891,
-22861,
-21888,
-21061,
-20481,
-20196,
-20246,
-20497,
-20691,
-20763,
-20935,
-21558,
-22689,
-23945,
-24901,
-25517,
-26189,
-27329,
-28895,
-30445,
-31581,
-32377,
-33214,
-34337,
-35564,
-36585,
-37455,
-38623,
-40424,
-42635,
-44641,
-46087,
-47157,
-48195,
-49159,
-49641,
-49344,
-48473,
-47388,
-46214,
-44699,
-42629,
-40080,
-37323,
-34613,
-32111,
-30004,
-28419,
-27289,
-26390,
-25606,
-25083,
-24974,
-25153,
-25232,
-25040,
-24775,
-24832,
-25224,
-25610,
-25642,
-25387,
-25189,
-25273,
-25503,
-25716,
-25943,
-26471,
-27376,
-28411,
-29189,
-29568,
-29698,
-29760,
-29721,
-29547,
-29405,
-29628,
-30347,
-31269,
-32039,
-32607,
-33285,
-34273,
-35366,
-36225,
-36856,
-37688,
-39079,
-40941,
-42782,
-44261,
-45291,
-46006,
-46353,
-46249,
-45635,
-44565,
-43171,
-41510,
-39713,
-37833,
-35866,
-33706,
-31421,
-29251,
-27542,
-26344,
-25518,
-24888,
-24482,
-24341,
-24348,
-24329,
-24292,
-24492,
-25090,
-25924,
-26705,
-27374,
-28162,
-29197,
-30260,
-30915,
-31052,
-30913,
-30868,
-31038,
-31307,
-31607,
-31993,
-32525,
-33114,
-33545,
-33701,
-33562,
-33261,
-32924,
-32708,
-32677,
-32763,
-32810,
-32814,
-32964,
-33519,
-34400,
-35263,
-35798,
-36160,
-36796,
-37966,
-39403,
-40522,
-41011,
-40966,
-40690,
-40240,
-39432,
-38070,
-36274,
-34377,
-32746,
-31545,
-30672,
-29871,
-28918,
-27877,
-27024,
-26623,
-26603,
-26614,
-26473,
-26355,
-26615,
-27290,
-28014,
-28373,
-28421,
-28540,
-29065,
-29901,
-30732,
-31356,
-31911,
-32631,
-33651,
-34837,
-35932,
-36673,
-37025,
-37128,
-37240,
-37411,
-37450,
-37127,
-36451,
-35724,
-35271,
-35097,
-34942,
-34488,
-33690,
-32766,
-32119,
-31980,
-32303,
-32747,
-32990,
-33100,
-33393,
-34082,
-34846,
-35107,
-34612,
-33731,
-33048,
-32699,
-32311,
-31483,
-30325,
-29301,
-28723,
-28482,
-28283,
-28025,
-27819,
-27808,
-27964,
-28209,
-28440,
-28621,
-28665,
-28593,
-28446,
-28340,
-28223,
-27992,
-27614,
-27290,
-27310,
-27792,
-28531,
-29240,
-29886,
-30816,
-32533,
-35199,
-38540,
-41982,
-45173,
-48029,
-50536,
-52436,
-53288,
-52884,
-51469,
-49443,
-47031,
-44105,
-40692,
-37131,
-33942,
-31271,
-28867,
-26426,
-24169,
-22622,
-22152,
-22520,
-23120,
-23478,
-23609,
-23733,
-24015,
-24264,
-24224,
-23790,
-23184,
-22772,
-22765,
-23095,
-23531,
-23969,
-24563,
-25536,
-26932,
-28536,
-30063,
-31390,
-32605,
-33769,
-34887,
-35806,
-36454,
-36848,
-37085,
-37283,
-37430,
-37476,
-37301,
-37003,
-36798,
-37024,
-37774,
-38901,
-40085,
-41144,
-42066,
-42902,
-43564,
-43852,
-43644,
-42990,
-42130,
-41228,
-40281,
-39131,
-37617,
-35790,
-33841,
-32015,
-30447,
-29153,
-28162,
-27463,
-27036,
-26685,
-26262,
-25696,
-25112,
-24647,
-24338,
-24163,
-24080,
-24112,
-24230,
-24366,
-24491,
-24631,
-24846,
-25109,
-25358,
-25585,
-25873,
-26258,
-26710,
-27171,
-27741,
-28543,
-29672,
-30964,
-32288,
-33567,
-34888,
-36283,
-37703,
-39047,
-40329,
-41585,
-42884,
-44171,
-45383,
-46411,
-47112,
-47351,
-47068,
-46357,
-45392,
-44259,
-42894,
-41182,
-39104,
-36828,
-34552,
-32412,
-30453,
-28701,
-27261,
-26237,
-25626,
-25319,
-25129,
-24978,
-24853,
-24815,
-24928,
-25261,
-25812,
-26507,
-27158,
-27687,
-28137,
-28583,
-28993,
-29194,
-29200,
-29261,
-29658,
-30338,
-30904,
-31067,
-30900,
-30757,
-30761,
-30788,
-30697,
-30600,
-30685,
-30936,
-31133,
-31187,
-31201,
-31335,
-31532,
-31702,
-31997,
-32730,
-34129,
-36023,
-38067,
-39991,
-41679,
-43061,
-44055,
-44642,
-44875,
-44750,
-44207,
-43244,
-41976,
-40499,
-38738,
-36612,
-34354,
-32417,
-31081,
-30128,
-29212,
-28338,
-27904,
-28118,
-28591,
-28740,
-28382,
-27960,
-27900,
-28224,
-28565,
-28691,
-28629,
-28453,
-28133,
-27642,
-27167,
-26913,
-26874,
-26868,
-26839,
-27054,
-27755,
-28837,
-29890,
-30589,
-31037,
-31482,
-32017,
-32484,
-32741,
-32919,
-33231,
-33774,
-34361,
-34822,
-35126,
-35455,
-35960,
-36697,
-37560,
-38423,
-39094,
-39490,
-39624,
-39656,
-39707,
-39692,
-39386,
-38637,
-37596,
-36567,
-35770,
-35095,
-34326,
-33345,
-32324,
-31482,
-30892,
-30377,
-29709,
-28852,
-27959,
-27282,
-26906,
-26736,
-26618,
-26475,
-26395,
-26450,
-26678,
-27067,
-27643,
-28467,
-29491,
-30596,
-31662,
-32740,
-33895,
-35072,
-36059,
-36700,
-37095,
-37433,
-37741,
-37829,
-37523,
-36937,
-36299,
-35734,
-35140,
-34473,
-33903,
-33617,
-33568,
-33437,
-33065,
-32620,
-32433,
-32538,
-32654,
-32513,
-32191,
-32002,
-32069,
-32235,
-32243,
-32086,
-31922,
-31835,
-31685,
-31358,
-30912,
-30591,
-30469,
-30418,
-30259,
-29987,
-29762,
-29636,
-29536,
-29343,
-29097,
-28880,
-28687,
-28389,
-27937,
-27441,
-27029,
-26701,
-26466,
-26452,
-26996,
-28179,
-29788,
-31432,
-33077,
-34979,
-37400,
-40198,
-43039,
-45741,
-48309,
-50638,
-52289,
-52825,
-52182,
-50701,
-48641,
-45951,
-42534,
-38625,
-34834,
-31612,
-28985,
-26724,
-24746,
-23278,
-22573,
-22635,
-23229,
-23978,
-24587,
-24866,
-24865,
-24740,
-24607,
-24341,
-23720,
-22836,
-22116,
-22057,
-22653,
-23452,
-24052,
-24548,
-25406,
-26853,
-28640,
-30232,
-31394,
-32290,
-33298,
-34569,
-35952,
-37084,
-37697,
-37795,
-37616,
-37461,
-37409,
-37344,
-37172,
-37033,
-37257,
-38050,
-39316,
-40754,
-42066,
-43076,
-43703,
-43990,
-44106,
-44259,
-44400,
-44271,
-43568,
-42385,
-41008,
-39559,
-37786,
-35381,
-32551,
-29889,
-27919,
-26541,
-25316,
-23983,
-22759,
-21948,
-21617,
-21476,
-21339,
-21234,
-21348,
-21729,
-22286,
-22893,
-23485,
-24076,
-24649,
-25241,
-25848,
-26456,
-26983,
-27435,
-27937,
-28699,
-29784,
-31040,
-32209,
-33150,
-33923,
-34709,
-35645,
-36761,
-37937,
-39078,
-40125,
-41218,
-42458,
-43775,
-44874,
-45479,
-45673,
-45739,
-45853,
-45747,
-45075,
-43803,
-42330,
-40900,
-39327,
-37164,
-34469,
-31867,
-30008,
-28862,
-27851,
-26598,
-25388,
-24786,
-24927,
-25341,
-25511,
-25375,
-25330,
-25658,
-26304,
-26920,
-27315,
-27509,
-27719,
-28061,
-28488,
-28812,
-28922,
-28931,
-29110,
-29620,
-30255,
-30691,
-30763,
-30694,
-30782,
-31058,
-31346,
-31494,
-31640,
-31964,
-32467,
-32934,
-33163,
-33109,
-32896,
-32723,
-32885,
-33601,
-34856,
-36328,
-37671,
-38840,
-40013,
-41254,
-42280,
-42740,
-42648,
-42332,
-42108,
-41911,
-41450,
-40522,
-39142,
-37437,
-35588,
-33839,
-32457,
-31526,
-30833,
-30112,
-29331,
-28712,
-28372,
-28100,
-27554,
-26702,
-25937,
-25683,
-25961,
-26353,
-26463,
-26296,
-26215,
-26457,
-26911,
-27219,
-27276,
-27348,
-27822,
-28805,
-30013,
-31127,
-32002,
-32737,
-33392,
-33945,
-34374,
-34677,
-34897,
-34992,
-35016,
-35091,
-35323,
-35593,
-35763,
-35836,
-36104,
-36688,
-37323,
-37612,
-37516,
-37423,
-37610,
-37837,
-37673,
-37079,
-36521,
-36331,
-36248,
-35734,
-34653,
-33453,
-32606,
-32088,
-31496,
-30590,
-29566,
-28793,
-28460,
-28444,
-28464,
-28275,
-27808,
-27217,
-26779,
-26605,
-26547,
-26376,
-26208,
-26470,
-27487,
-29053,
-30567,
-31606,
-32271,
-33013,
-34081,
-35422,
-36706,
-37754,
-38569,
-39292,
-40018,
-40591,
-40650,
-39965,
-38702,
-37514,
-36908,
-36859,
-36754,
-36103,
-34908,
-33691,
-32841,
-32387,
-32035,
-31545,
-30877,
-30157,
-29535,
-29131,
-28884,
-28696,
-28437,
-28243,
-28328,
-28797,
-29462,
-30006,
-30317,
-30558,
-30916,
-31342,
-31585,
-31451,
-31017,
-30521,
-30180,
-29980,
-29815,
-29575,
-29322,
-29177,
-29180,
-29143,
-28871,
-28342,
-27889,
-27849,
-28314,
-29066,
-29885,
-30827,
-32026,
-33517,
-35061,
-36498,
-37859,
-39386,
-41166,
-43140,
-45079,
-46779,
-48061,
-48764,
-48862,
-48396,
-47410,
-45771,
-43379,
-40363,
-37203,
-34366,
-31983,
-29838,
-27739,
-25832,
-24446,
-23793,
-23714,
-23891,
-24106,
-24364,
-24714,
-25095,
-25287,
-25146,
-24710,
-24216,
-23844,
-23631,
-23494,
-23452,
-23635,
-24154,
-24932,
-25773,
-26571,
-27405,
-28412,
-29576,
-30762,
-31833,
-32777,
-33624,
-34344,
-34927,
-35407,
-35877,
-36317,
-36573,
-36603,
-36574,
-36919,
-37926,
-39544,
-41391,
-43047,
-44370,
-45480,
-46565,
-47623,
-48454,
-48856,
-48808,
-48383,
-47560,
-46130,
-43920,
-40996,
-37715,
-34373,
-31132,
-28034,
-25268,
-23061,
-21535,
-20493,
-19728,
-19165,
-18912,
-19023,
-19377,
-19811,
-20265,
-20761,
-21277,
-21713,
-21996,
-22208,
-22482,
-22969,
-23695,
-24647,
-25724,
-26878,
-28105,
-29535,
-31216,
-32986,
-34552,
-35748,
-36747,
-37858,
-39186,
-40503,
-41511,
-42138,
-42580,
-43048,
-43578,
-44015,
-44202,
-44090,
-43794,
-43567,
-43532,
-43589,
-43373,
-42623,
-41464,
-40237,
-39116,
-37839,
-36115,
-34054,
-32204,
-30938,
-30102,
-29219,
-28111,
-27080,
-26430,
-26055,
-25572,
-24848,
-24213,
-24042,
-24247,
-24368,
-24115,
-23682,
-23552,
-23893,
-24481,
-24986,
-25382,
-25933,
-26797,
-27840,
-28750,
-29307,
-29602,
-29829,
-30175,
-30675,
-31260,
-31874,
-32521,
-33310,
-34304,
-35429,
-36434,
-37181,
-37796,
-38621,
-39794,
-41053,
-41976,
-42459,
-42808,
-43302,
-43768,
-43732,
-42969,
-41824,
-40768,
-39958,
-39061,
-37778,
-36125,
-34337,
-32565,
-30827,
-29222,
-27983,
-27259,
-26937,
-26766,
-26637,
-26644,
-26889,
-27326,
-27805,
-28228,
-28597,
-28950,
-29353,
-29851,
-30419,
-30889,
-31100,
-31026,
-30902,
-30906,
-31047,
-31162,
-31217,
-31301,
-31505,
-31709,
-31739,
-31570,
-31335,
-31158,
-31025,
-30880,
-30684,
-30405,
-29966,
-29358,
-28775,
-28455,
-28460,
-28604,
-28762,
-29132,
-30071,
-31724,
-33795,
-35876,
-37753,
-39504,
-41227,
-42847,
-44148,
-44927,
-45105,
-44747,
-44009,
-43023,
-41766,
-40131,
-38146,
-36094,
-34362,
-33064,
-31991,
-30948,
-29990,
-29340,
-29001,
-28690,
-28161,
-27515,
-27051,
-26891,
-26873,
-26780,
-26641,
-26624,
-26803,
-27029,
-27143,
-27137,
-27209,
-27540,
-28218,
-29119,
-30022,
-30710,
-31142,
-31453,
-31791,
-32146,
-32349,
-32338,
-32208,
-32172,
-32289,
-32521,
-32833,
-33300,
-33996,
-34820,
-35676,
-36504,
-37446,
-38547,
-39661,
-40520,
-40924,
-40908,
-40622,
-40167,
-39563,
-38743,
-37738,
-36665,
-35651,
-34727,
-33749,
-32581,
-31287,
-30115,
-29311,
-28823,
-28424,
-27937,
-27453,
-27127,
-26951,
-26700,
-26192,
-25531,
-24993,
-24836,
-25107,
-25671,
-26375,
-27102,
-27846,
-28699,
-29742,
-30969,
-32261,
-33540,
-34854,
-36268,
-37716,
-38928,
-39709,
-40059,
-40187,
-40242,
-40221,
-40038,
-39660,
-39131,
-38535,
-37933,
-37355,
-36748,
-35999,
-35072,
-34115,
-33376,
-32935,
-32627,
-32275,
-31882,
-31664,
-31579,
-31420,
-30964,
-30398,
-30042,
-29961,
-29821,
-29335,
-28655,
-28224,
-28187,
-28249,
-28000,
-27480,
-27092,
-27118,
-27391,
-27497,
-27207,
-26677,
-26195,
-25940,
-25868,
-25893,
-25969,
-26195,
-26626,
-27275,
-27981,
-28648,
-29328,
-30267,
-31633,
-33359,
-35239,
-37236,
-39529,
-42232,
-45054,
-47521,
-49341,
-50702,
-51871,
-52795,
-53083,
-52428,
-50953,
-48955,
-46641,
-43945,
-40874,
-37663,
-34626,
-31894,
-29408,
-27132,
-25221,
-23871,
-23049,
-22509,
-21948,
-21254,
-20498,
-19846,
-19374,
-19109,
-18961,
-18828,
-18696,
-18639,
-18818,
-19279,
-19880,
-20468,
-21006,
-21771,
-23008,
-24758,
-26720,
-28551,
-30188,
-31815,
-33589,
-35387,
-36973,
-38331,
-39752,
-41493,
-43429,
-45138,
-46373,
-47304,
-48242,
-49258,
-50023,
-50327,
-50253,
-50096,
-49916,
-49460,
-48433,
-46817,
-44788,
-42542,
-40201,
-37832,
-35508,
-33155,
-30729,
-28327,
-26272,
-24723,
-23473,
-22114,
-20591,
-19315,
-18711,
-18665,
-18710,
-18548,
-18401,
-18592,
-19106,
-19657,
-20191,
-20918,
-22044,
-23337,
-24480,
-25455,
-26564,
-27957,
-29336,
-30355,
-31039,
-31810,
-32910,
-34163,
-35193,
-35928,
-36597,
-37436,
-38432,
-39479,
-40545,
-41669,
-42741,
-43586,
-44175,
-44711,
-45396,
-46122,
-46516,
-46386,
-45895,
-45411,
-44956,
-44147,
-42502,
-40070,
-37372,
-35038,
-33205,
-31582,
-29894,
-28192,
-26808,
-25872,
-25261,
-24689,
-24096,
-23583,
-23309,
-23324,
-23540,
-23857,
-24130,
-24313,
-24474,
-24748,
-25185,
-25686,
-26116,
-26557,
-27167,
-28011,
-28907,
-29653,
-30237,
-30758,
-31215,
-31454,
-31473,
-31508,
-31800,
-32325,
-32790,
-33101,
-33416,
-33937,
-34562,
-35050,
-35361,
-35777,
-36559,
-37692,
-38968,
-40287,
-41691,
-43125,
-44333,
-45016,
-45055,
-44518,
-43539,
-42236,
-40795,
-39356,
-37935,
-36385,
-34625,
-32768,
-31050,
-29580,
-28350,
-27346,
-26664,
-26363,
-26336,
-26377,
-26375,
-26354,
-26360,
-26373,
-26382,
-26451,
-26672,
-27032,
-27395,
-27677,
-27876,
-28066,
-28309,
-28644,
-29123,
-29792,
-30611,
-31491,
-32354,
-33128,
-33726,
-34024,
-34020,
-33841,
-33728,
-33744,
-33808,
-33816,
-33823,
-34001,
-34397,
-34917,
-35371,
-35776,
-36267,
-36955,
-37715,
-38265,
-38417,
-38296,
-38161,
-38180,
-38149,
-37763,
-36912,
-35844,
-34906,
-34154,
-33378,
-32386,
-31324,
-30487,
-30009,
-29694,
-29322,
-28913,
-28645,
-28569,
-28433,
-27990,
-27294,
-26711,
-26557,
-26805,
-27187,
-27532,
-27927,
-28607,
-29614,
-30797,
-31972,
-33133,
-34387,
-35725,
-36941,
-37836,
-38397,
-38767,
-38963,
-38835,
-38258,
-37405,
-36617,
-36081,
-35652,
-35130,
-34515,
-34007,
-33680,
-33358,
-32897,
-32383,
-32065,
-31982,
-31946,
-31766,
-31549,
-31466,
-31532,
-31543,
-31400,
-31246,
-31229,
-31292,
-31201,
-30939,
-30697,
-30662,
-30729,
-30679,
-30499,
-30395,
-30450,
-30441,
-30084,
-29453,
-28982,
-28971,
-29212,
-29171,
-28544,
-27585,
-26775,
-26403,
-26302,
-26204,
-26080,
-26192,
-26860,
-28179,
-29914,
-31740,
-33404,
-34959,
-36663,
-38797,
-41337,
-43996,
-46391,
-48405,
-50098,
-51423,
-52002,
-51426,
-49707,
-47386,
-45037,
-42746,
-40209,
-37275,
-34306,
-31802,
-29894,
-28230,
-26591,
-25144,
-24354,
-24281,
-24521,
-24512,
-24070,
-23394,
-22774,
-22308,
-21879,
-21369,
-20811,
-20444,
-20553,
-21196,
-22056,
-22679,
-22957,
-23274,
-24121,
-25488,
-26878,
-27854,
-28574,
-29563,
-31045,
-32678,
-33913,
-34617,
-35137,
-35925,
-37149,
-38667,
-40236,
-41721,
-43169,
-44796,
-46751,
-48879,
-50662,
-51605,
-51696,
-51365,
-50999,
-50441,
-49246,
-47191,
-44628,
-42062,
-39677,
-37259,
-34567,
-31702,
-29012,
-26766,
-25004,
-23580,
-22369,
-21368,
-20618,
-20189,
-20011,
-19936,
-19787,
-19521,
-19259,
-19162,
-19285,
-19569,
-19898,
-20236,
-20579,
-21004,
-21626,
-22548,
-23763,
-25098,
-26378,
-27618,
-29052,
-30856,
-32920,
-34870,
-36432,
-37714,
-39019,
-40587,
-42231,
-43682,
-44795,
-45788,
-46894,
-48140,
-49232,
-49937,
-50221,
-50269,
-50162,
-49764,
-48833,
-47261,
-45167,
-42822,
-40424,
-38046,
-35603,
-33055,
-30507,
-28206,
-26357,
-24930,
-23704,
-22537,
-21525,
-20849,
-20563,
-20471,
-20427,
-20437,
-20585,
-20823,
-21009,
-21186,
-21567,
-22296,
-23201,
-23940,
-24461,
-25000,
-25866,
-27012,
-28226,
-29345,
-30388,
-31428,
-32413,
-33302,
-34086,
-34730,
-35130,
-35291,
-35478,
-36086,
-37212,
-38562,
-39776,
-40813,
-41882,
-43082,
-44240,
-45181,
-45934,
-46579,
-47028,
-47068,
-46678,
-46051,
-45211,
-43879,
-41734,
-38952,
-36135,
-33747,
-31737,
-29750,
-27731,
-25965,
-24756,
-23973,
-23292,
-22540,
-21928,
-21733,
-22015,
-22575,
-23200,
-23842,
-24560,
-25343,
-26073,
-26603,
-26942,
-27208,
-27553,
-27968,
-28418,
-28888,
-29491,
-30284,
-31156,
-31956,
-32645,
-33351,
-34153,
-34898,
-35409,
-35660,
-35874,
-36195,
-36557,
-36790,
-36866,
-36915,
-37026,
-37218,
-37555,
-38154,
-39003,
-39789,
-40175,
-40202,
-40224,
-40410,
-40383,
-39628,
-38168,
-36667,
-35713,
-35126,
-34220,
-32624,
-30757,
-29303,
-28451,
-27768,
-26865,
-25883,
-25354,
-25508,
-26065,
-26538,
-26752,
-26927,
-27320,
-27956,
-28614,
-29125,
-29490,
-29839,
-30311,
-30907,
-31570,
-32183,
-32692,
-33132,
-33616,
-34207,
-34827,
-35306,
-35546,
-35643,
-35779,
-36000,
-36132,
-35951,
-35472,
-34944,
-34645,
-34536,
-34341,
-33836,
-33186,
-32776,
-32893,
-33348,
-33743,
-33822,
-33773,
-33951,
-34428,
-34863,
-34789,
-34167,
-33364,
-32829,
-32579,
-32270,
-31629,
-30786,
-30141,
-29925,
-29960,
-29923,
-29685,
-29449,
-29496,
-29856,
-30291,
-30487,
-30352,
-30055,
-29896,
-30019,
-30301,
-30412,
-30145,
-29605,
-29209,
-29334,
-29984,
-30828,
-31525,
-32080,
-32838,
-34079,
-35781,
-37500,
-38860,
-39689,
-40144,
-40436,
-40634,
-40703,
-40568,
-40206,
-39621,
-38789,
-37763,
-36666,
-35715,
-34961,
-34299,
-33492,
-32474,
-31436,
-30648,
-30203,
-29902,
-29503,
-28987,
-28571,
-28420,
-28421,
-28289,
-27934,
-27536,
-27389,
-27489,
-27626,
-27630,
-27598,
-27719,
-27993,
-28183,
-28126,
-27886,
-27697,
-27647,
-27703,
-27834,
-28108,
-28624,
-29283,
-29988,
-30696,
-31502,
-32409,
-33289,
-34025,
-34671,
-35424,
-36368,
-37454,
-38599,
-39781,
-40998,
-42104,
-42934,
-43395,
-43527,
-43341,
-42808,
-41938,
-40950,
-40093,
-39439,
-38770,
-37847,
-36614,
-35262,
-34080,
-33242,
-32747,
-32435,
-32069,
-31576,
-31088,
-30781,
-30610,
-30245,
-29419,
-28271,
-27226,
-26564,
-26131,
-25597,
-24874,
-24194,
-23783,
-23589,
-23406,
-23174,
-23009,
-22990,
-23013,
-22929,
-22806,
-22849,
-23223,
-23815,
-24444,
-25065,
-25862,
-27062,
-28638,
-30399,
-32118,
-33883,
-35945,
-38501,
-41422,
-44351,
-47037,
-49454,
-51667,
-53543,
-54723,
-54944,
-54238,
-52898,
-51168,
-49106,
-46694,
-44020,
-41261,
-38587,
-36027,
-33644,
-31502,
-29741,
-28402,
-27428,
-26683,
-26065,
-25478,
-24886,
-24246,
-23520,
-22667,
-21695,
-20690,
-19851,
-19298,
-19042,
-18902,
-18774,
-18702,
-18923,
-19557,
-20502,
-21474,
-22371,
-23378,
-24800,
-26635,
-28462,
-29789,
-30513,
-31013,
-31728,
-32780,
-34006,
-35316,
-36897,
-38992,
-41611,
-44470,
-47181,
-49424,
-51014,
-52007,
-52696,
-53442,
-54187,
-54389,
-53439,
-51357,
-48758,
-46187,
-43492,
-40221,
-36387,
-32777,
-30165,
-28537,
-27142,
-25431,
-23580,
-22177,
-21453,
-21110,
-20742,
-20369,
-20240,
-20552,
-21145,
-21726,
-22097,
-22257,
-22371,
-22605,
-23085,
-23704,
-24331,
-24888,
-25490,
-26289,
-27211,
-28033,
-28603,
-29070,
-29718,
-30716,
-31924,
-33108,
-34082,
-34826,
-35384,
-35923,
-36622,
-37668,
-39011,
-40435,
-41779,
-43068,
-44519,
-46068,
-47364,
-47961,
-47797,
-47252,
-46756,
-46286,
-45417,
-43783,
-41491,
-39002,
-36601,
-34171,
-31515,
-28801,
-26548,
-25127,
-24346,
-23721,
-22981,
-22367,
-22224,
-22576,
-23102,
-23475,
-23740,
-24124,
-24794,
-25671,
-26573,
-27383,
-28112,
-28773,
-29388,
-29905,
-30302,
-30613,
-30985,
-31614,
-32520,
-33511,
-34251,
-34632,
-34818,
-35017,
-35157,
-34966,
-34384,
-33829,
-33884,
-34712,
-35780,
-36456,
-36569,
-36643,
-37195,
-38144,
-38839,
-38819,
-38308,
-38028,
-38341,
-38919,
-39030,
-38370,
-37243,
-36160,
-35282,
-34331,
-33043,
-31496,
-30042,
-28970,
-28308,
-27863,
-27391,
-26722,
-25883,
-25138,
-24801,
-24967,
-25334,
-25588,
-25765,
-26269,
-27355,
-28672,
-29640,
-30067,
-30496,
-31548,
-33229,
-34869,
-35921,
-36539,
-37314,
-38509,
-39679,
-40234,
-40013,
-39465,
-39034,
-38746,
-38322,
-37553,
-36613,
-35724,
-34969,
-34167,
-33165,
-32048,
-31090,
-30531,
-30398,
-30485,
-30613,
-30745,
-30998,
-31441,
-31970,
-32429,
-32762,
-33103,
-33500,
-33803,
-33693,
-33035,
-32007,
-30984,
-30188,
-29638,
-29220,
-28910,
-28713,
-28636,
-28638,
-28710,
-28834,
-28977,
-29010,
-28893,
-28663,
-28425,
-28200,
-27953,
-27675,
-27454,
-27336,
-27343,
-27464,
-27863,
-28688,
-29936,
-31371,
-32756,
-34174,
-35966,
-38418,
-41523,
-44890,
-48073,
-50608,
-52218,
-52759,
-52298,
-50965,
-48817,
-45857,
-42256,
-38515,
-35219,
-32618,
-30461,
-28360,
-26289,
-24645,
-23828,
-23828,
-24279,
-24837,
-25396,
-25974,
-26475,
-26681,
-26448,
-25797,
-24903,
-23944,
-23135,
-22629,
-22499,
-22669,
-23027,
-23640,
-24682,
-26256,
-28136,
-29938,
-31423,
-32686,
-33918,
-35068,
-35859,
-36051,
-35786,
-35413,
-35180,
-35065,
-34964,
-34986,
-35349,
-36140,
-37151,
-38126,
-39105,
-40316,
-41886,
-43493,
-44679,
-45215,
-45301,
-45163,
-44773,
-43849,
-42316,
-40408,
-38448,
-36487,
-34390,
-32166,
-30113,
-28537,
-27449,
-26634,
-26011,
-25664,
-25671,
-25813,
-25793,
-25574,
-25373,
-25396,
-25545,
-25629,
-25623,
-25697,
-25935,
-26204,
-26348,
-26424,
-26667,
-27197,
-27928,
-28667,
-29302,
-29834,
-30249,
-30603,
-30965,
-31428,
-31951,
-32439,
-32909,
-33509,
-34362,
-35294,
-36049,
-36523,
-36953,
-37635,
-38642,
-39837,
-41020,
-42090,
-42897,
-43318,
-43294,
-43000,
-42543,
-41880,
-40779,
-39235,
-37527,
-36010,
-34734,
-33473,
-32065,
-30576,
-29293,
-28333,
-27674,
-27213,
-26918,
-26803,
-26838,
-26959,
-27081,
-27161,
-27254,
-27465,
-27964,
-28722,
-29540,
-30165,
-30539,
-30857,
-31297,
-31805,
-32179,
-32276,
-32211,
-32103,
-31988,
-31777,
-31469,
-31175,
-31006,
-30964,
-30955,
-30949,
-30963,
-31052,
-31251,
-31571,
-31967,
-32314,
-32487,
-32487,
-32498,
-32709,
-33133,
-33591,
-33995,
-34447,
-35212,
-36352,
-37643,
-38680,
-39218,
-39298,
-39154,
-38973,
-38764,
-38458,
-38051,
-37647,
-37337,
-37039,
-36601,
-35927,
-35125,
-34335,
-33600,
-32869,
-32129,
-31469,
-30902,
-30305,
-29542,
-28699,
-28015,
-27618,
-27326,
-26929,
-26415,
-26073,
-26049,
-26268,
-26526,
-26840,
-27404,
-28275,
-29276,
-30146,
-30854,
-31513,
-32179,
-32719,
-33049,
-33228,
-33391,
-33524,
-33498,
-33334,
-33310,
-33685,
-34440,
-35245,
-35839,
-36328,
-36961,
-37845,
-38699,
-39146,
-39080,
-38719,
-38358,
-38074,
-37683,
-37017,
-36113,
-35147,
-34268,
-33460,
-32655,
-31831,
-31071,
-30364,
-29629,
-28728,
-27670,
-26633,
-25812,
-25265,
-24884,
-24555,
-24333,
-24387,
-24804,
-25413,
-25918,
-26176,
-26471,
-27339,
-29193,
-31958,
-35138,
-38127,
-40663,
-42806,
-44696,
-46255,
-47121,
-47001,
-46011,
-44642,
-43382,
-42260,
-40852,
-38795,
-36222,
-33727,
-31849,
-30620,
-29698,
-28803,
-28019,
-27641,
-27758,
-28148,
-28376,
-28243,
-27808,
-27431,
-27312,
-27404,
-27378,
-26995,
-26378,
-25921,
-25920,
-26261,
-26582,
-26712,
-26852,
-27346,
-28244,
-29283,
-30134,
-30750,
-31280,
-31886,
-32538,
-33098,
-33429,
-33506,
-33469,
-33513,
-33778,
-34146,
-34379,
-34366,
-34342,
-34675,
-35519,
-36636,
-37682,
-38532,
-39296,
-40070,
-40780,
-41326,
-41751,
-42214,
-42720,
-43122,
-43206,
-42939,
-42371,
-41506,
-40241,
-38533,
-36519,
-34505,
-32736,
-31243,
-29833,
-28325,
-26706,
-25255,
-24254,
-23770,
-23566,
-23348,
-23094,
-22993,
-23175,
-23402,
-23325,
-22814,
-22222,
-22009,
-22316,
-22803,
-23007,
-22821,
-22586,
-22826,
-23727,
-25103,
-26576,
-28066,
-29793,
-32037,
-34674,
-37259,
-39371,
-41083,
-42839,
-44951,
-47282,
-49357,
-50858,
-51768,
-52143,
-51816,
-50567,
-48417,
-45884,
-43485,
-41473,
-39638,
-37815,
-36059,
-34562,
-33301,
-31946,
-30247,
-28318,
-26631,
-25558,
-25083,
-24887,
-24675,
-24393,
-24085,
-23772,
-23383,
-22974,
-22686,
-22729,
-23152,
-23867,
-24761,
-25730,
-26709,
-27608,
-28378,
-28992,
-29494,
-29891,
-30208,
-30507,
-30847,
-31309,
-31841,
-32419,
-32997,
-33633,
-34385,
-35327,
-36397,
-37422,
-38129,
-38381,
-38363,
-38396,
-38693,
-39045,
-39154,
-38956,
-38724,
-38654,
-38569,
-38055,
-37010,
-35727,
-34595,
-33653,
-32721,
-31803,
-31188,
-31152,
-31560,
-32085,
-32534,
-33079,
-33917,
-35009,
-36106,
-36931,
-37383,
-37390,
-36952,
-36086,
-34925,
-33542,
-31993,
-30376,
-28904,
-27796,
-27066,
-26545,
-26118,
-25844,
-25849,
-26073,
-26341,
-26547,
-26755,
-27028,
-27199,
-27015,
-26382,
-25590,
-25064,
-25084,
-25549,
-26166,
-26757,
-27473,
-28711,
-30646,
-33001,
-35164,
-36801,
-38217,
-39961,
-42143,
-44087,
-45006,
-44800,
-44193,
-43893,
-43862,
-43419,
-42134,
-40349,
-38842,
-38009,
-37488,
-36637,
-35230,
-33729,
-32804,
-32710,
-32962,
-32843,
-32013,
-30865,
-30070,
-29899,
-29907,
-29484,
-28507,
-27579,
-27308,
-27720,
-28150,
-28042,
-27449,
-26953,
-26940,
-27228,
-27334,
-27094,
-26856,
-27087,
-27848,
-28700,
-29227,
-29398,
-29582,
-30035,
-30655,
-31115,
-31254,
-31211,
-31214,
-31360,
-31680,
-32233,
-33118,
-34292,
-35504,
-36599,
-37596,
-38726,
-39966,
-41077,
-41760,
-41962,
-41917,
-41782,
-41549,
-41026,
-40104,
-38805,
-37269,
-35687,
-34237,
-33007,
-31970,
-30992,
-30056,
-29207,
-28581,
-28175,
-27948,
-27851,
-27866,
-27955,
-28051,
-28162,
-28365,
-28687,
-28994,
-29147,
-29239,
-29521,
-30121,
-30746,
-31021,
-30878,
-30723,
-30956,
-31525,
-32058,
-32266,
-32351,
-32622,
-33197,
-33840,
-34297,
-34505,
-34533,
-34453,
-34282,
-34116,
-34027,
-33969,
-33839,
-33643,
-33675,
-34158,
-34971,
-35637,
-35851,
-35813,
-36057,
-36750,
-37484,
-37624,
-36989,
-36034,
-35266,
-34754,
-34071,
-32870,
-31275,
-29758,
-28662,
-28015,
-27627,
-27421,
-27379,
-27462,
-27617,
-27820,
-28195,
-28696,
-29108,
-29170,
-28985,
-28943,
-29344,
-29978,
-30352,
-30241,
-29978,
-30069,
-30653,
-31405,
-32037,
-32669,
-33669,
-35162,
-36851,
-38307,
-39405,
-40222,
-40860,
-41218,
-41261,
-41119,
-41010,
-40891,
-40517,
-39662,
-38467,
-37281,
-36310,
-35411,
-34294,
-32900,
-31511,
-30498,
-29935,
-29528,
-28919,
-28044,
-27253,
-26935,
-27152,
-27539,
-27655,
-27423,
-27165,
-27244,
-27657,
-28080,
-28212,
-28143,
-28156,
-28463,
-28901,
-29191,
-29220,
-29159,
-29308,
-29739,
-30330,
-30784,
-31056,
-31255,
-31624,
-32206,
-32784,
-33099,
-33060,
-32872,
-32750,
-32752,
-32782,
-32823,
-33013,
-33433,
-33966,
-34406,
-34764,
-35312,
-36301,
-37678,
-39256,
-41026,
-43202,
-45796,
-48294,
-49873,
-50036,
-48951,
-47113,
-44905,
-42313,
-39368,
-36268,
-33421,
-31015,
-28946,
-26989,
-25097,
-23520,
-22589,
-22440,
-22858,
-23410,
-23758,
-23852,
-23849,
-23760,
-23366,
-22430,
-21078,
-19854,
-19218,
-19201,
-19381,
-19482,
-19686,
-20497,
-22186,
-24516,
-26990,
-29298,
-31520,
-33875,
-36367,
-38715,
-40657,
-42205,
-43712,
-45475,
-47429,
-49166,
-50231,
-50554,
-50365,
-49995,
-49481,
-48663,
-47382,
-45689,
-43833,
-41935,
-39979,
-37782,
-35381,
-32993,
-30980,
-29449,
-28261,
-27188,
-26205,
-25475,
-25080,
-24828,
-24420,
-23788,
-23182,
-22866,
-22810,
-22735,
-22478,
-22196,
-22199,
-22601,
-23271,
-24012,
-24826,
-25841,
-27143,
-28594,
-29948,
-31008,
-31810,
-32573,
-33512,
-34611,
-35654,
-36438,
-37038,
-37687,
-38447,
-39112,
-39397,
-39370,
-39344,
-39521,
-39716,
-39617,
-39179,
-38673,
-38289,
-37952,
-37409,
-36662,
-35835,
-35012,
-34087,
-33013,
-32000,
-31298,
-30924,
-30692,
-30484,
-30482,
-30837,
-31379,
-31737,
-31670,
-31369,
-31159,
-31169,
-31262,
-31210,
-30945,
-30500,
-30019,
-29631,
-29455,
-29398,
-29293,
-29063,
-28970,
-29404,
-30435,
-31700,
-32739,
-33527,
-34406,
-35600,
-36833,
-37551,
-37554,
-37115,
-36672,
-36269,
-35603,
-34403,
-32847,
-31417,
-30506,
-30129,
-29975,
-29822,
-29690,
-29825,
-30317,
-30966,
-31400,
-31494,
-31425,
-31487,
-31628,
-31540,
-30996,
-30177,
-29510,
-29215,
-29226,
-29413,
-29895,
-30861,
-32254,
-33749,
-35041,
-36146,
-37189,
-38175,
-38946,
-39440,
-39792,
-40040,
-40012,
-39458,
-38443,
-37265,
-36074,
-34668,
-32909,
-31101,
-29926,
-29635,
-29765,
-29570,
-28882,
-28256,
-28188,
-28487,
-28399,
-27628,
-26703,
-26516,
-27289,
-28421,
-29205,
-29674,
-30499,
-32098,
-34061,
-35486,
-35952,
-35842,
-35815,
-36055,
-36125,
-35642,
-34721,
-33858,
-33367,
-33148,
-32962,
-32713,
-32503,
-32406,
-32485,
-32846,
-33562,
-34505,
-35324,
-35813,
-36123,
-36544,
-37085,
-37397,
-37257,
-36855,
-36572,
-36385,
-35849,
-34584,
-32827,
-31138,
-29872,
-28861,
-27807,
-26687,
-25723,
-24992,
-24348,
-23572,
-22701,
-21870,
-21201,
-20736,
-20592,
-20981,
-21987,
-23463,
-25112,
-26767,
-28445,
-30291,
-32412,
-34868,
-37679,
-40796,
-44096,
-47420,
-50566,
-53241,
-55072,
-55743,
-55271,
-53933,
-52037,
-49633,
-46653,
-43222,
-39758,
-36665,
-33980,
-31443,
-28897,
-26581,
-24916,
-24079,
-23797,
-23611,
-23243,
-22725,
-22233,
-21778,
-21258,
-20554,
-19770,
-19158,
-18946,
-19107,
-19424,
-19671,
-19882,
-20368,
-21506,
-23387,
-25705,
-27934,
-29743,
-31269,
-32910,
-34862,
-36769,
-38025,
-38395,
-38361,
-38714,
-39761,
-41066,
-41961,
-42322,
-42642,
-43385,
-44445,
-45292,
-45654,
-45774,
-46081,
-46634,
-47107,
-47111,
-46497,
-45289,
-43564,
-41473,
-39243,
-37044,
-34808,
-32386,
-29850,
-27564,
-25777,
-24327,
-22796,
-21143,
-19764,
-19170,
-19301,
-19702,
-19975,
-20190,
-20607,
-21254,
-21896,
-22349,
-22738,
-23285,
-24032,
-24871,
-25731,
-26756,
-28074,
-29581,
-30978,
-32024,
-32747,
-33427,
-34378,
-35667,
-37129,
-38406,
-39336,
-39993,
-40596,
-41149,
-41393,
-41128,
-40580,
-40324,
-40731,
-41549,
-42163,
-42202,
-41911,
-41726,
-41743,
-41577,
-40864,
-39693,
-38508,
-37598,
-36822,
-35791,
-34299,
-32475,
-30635,
-28980,
-27528,
-26195,
-24922,
-23771,
-22893,
-22381,
-22221,
-22230,
-22288,
-22460,
-22946,
-23887,
-25163,
-26564,
-27996,
-29541,
-31235,
-32881,
-34150,
-34895,
-35229,
-35345,
-35288,
-35012,
-34595,
-34305,
-34255,
-34310,
-34156,
-33719,
-33223,
-32888,
-32655,
-32318,
-31873,
-31613,
-31780,
-32275,
-32746,
-33057,
-33403,
-34088,
-35110,
-36253,
-37297,
-38279,
-39246,
-40127,
-40735,
-40950,
-40804,
-40286,
-39375,
-38065,
-36541,
-35013,
-33557,
-32143,
-30746,
-29521,
-28523,
-27698,
-26872,
-26125,
-25644,
-25591,
-25776,
-25934,
-26024,
-26278,
-26942,
-27947,
-28963,
-29784,
-30362,
-30933,
-31621,
-32524,
-33583,
-34653,
-35555,
-36141,
-36453,
-36587,
-36589,
-36361,
-35808,
-35003,
-34143,
-33434,
-32901,
-32504,
-32155,
-31825,
-31472,
-31113,
-30824,
-30715,
-30856,
-31224,
-31801,
-32587,
-33586,
-34678,
-35719,
-36640,
-37510,
-38374,
-39080,
-39371,
-39113,
-38467,
-37699,
-36882,
-35884,
-34531,
-32944,
-31425,
-30238,
-29372,
-28681,
-28034,
-27487,
-27107,
-26884,
-26679,
-26332,
-25785,
-25092,
-24393,
-23800,
-23315,
-22864,
-22454,
-22309,
-22781,
-23998,
-25731,
-27575,
-29447,
-31701,
-34714,
-38386,
-42135,
-45362,
-47977,
-50142,
-51898,
-52896,
-52750,
-51446,
-49319,
-46766,
-43970,
-41027,
-38094,
-35399,
-33049,
-31032,
-29296,
-27918,
-27014,
-26590,
-26531,
-26637,
-26762,
-26826,
-26789,
-26620,
-26306,
-25823,
-25179,
-24425,
-23626,
-22893,
-22306,
-21981,
-21985,
-22289,
-22845,
-23623,
-24769,
-26370,
-28264,
-30047,
-31410,
-32466,
-33582,
-34923,
-36187,
-36978,
-37310,
-37664,
-38477,
-39641,
-40651,
-41125,
-41182,
-41211,
-41447,
-41824,
-42135,
-42330,
-42463,
-42559,
-42476,
-42011,
-40992,
-39460,
-37569,
-35625,
-33855,
-32324,
-30900,
-29463,
-28094,
-27150,
-26853,
-27105,
-27442,
-27520,
-27404,
-27444,
-27833,
-28359,
-28670,
-28643,
-28466,
-28314,
-28127,
-27773,
-27330,
-27095,
-27250,
-27684,
-28136,
-28576,
-29133,
-29937,
-30820,
-31502,
-31824,
-31844,
-31738,
-31669,
-31731,
-31881,
-32031,
-32041,
-31976,
-32019,
-32341,
-32911,
-33601,
-34338,
-35172,
-36118,
-37134,
-38189,
-39374,
-40610,
-41603,
-41975,
-41740,
-41356,
-41171,
-41015,
-40347,
-38986,
-37351,
-36014,
-35036,
-33992,
-32541,
-30883,
-29505,
-28715,
-28446,
-28448,
-28566,
-28710,
-28909,
-29243,
-29850,
-30673,
-31422,
-31736,
-31610,
-31324,
-31144,
-30950,
-30446,
-29597,
-28760,
-28371,
-28405,
-28495,
-28223,
-27675,
-27183,
-27082,
-27289,
-27529,
-27615,
-27639,
-27836,
-28280,
-28795,
-29157,
-29315,
-29431,
-29724,
-30224,
-30859,
-31578,
-32515,
-33933,
-35975,
-38494,
-41020,
-43066,
-44460,
-45405,
-46195,
-46771,
-46786,
-46058,
-44917,
-43950,
-43302,
-42489,
-40959,
-38781,
-36622,
-34964,
-33652,
-32210,
-30621,
-29320,
-28632,
-28264,
-27618,
-26537,
-25431,
-24767,
-24570,
-24507,
-24361,
-24184,
-24075,
-24003,
-23875,
-23800,
-23883,
-24124,
-24372,
-24630,
-25125,
-26025,
-27136,
-28036,
-28492,
-28758,
-29211,
-29987,
-30802,
-31391,
-31821,
-32486,
-33636,
-35109,
-36442,
-37376,
-38142,
-39304,
-41150,
-43392,
-45294,
-46395,
-46834,
-47129,
-47520,
-47644,
-46962,
-45379,
-43433,
-41741,
-40432,
-39054,
-37167,
-34793,
-32392,
-30446,
-29021,
-27886,
-26728,
-25477,
-24296,
-23381,
-22766,
-22246,
-21624,
-20995,
-20730,
-21173,
-22206,
-23321,
-24093,
-24535,
-25078,
-26001,
-27179,
-28264,
-29083,
-29835,
-30822,
-32126,
-33508,
-34627,
-35309,
-35671,
-36023,
-36559,
-37177,
-37561,
-37517,
-37285,
-37309,
-37790,
-38411,
-38668,
-38437,
-38140,
-38290,
-38972,
-39752,
-40171,
-40064,
-39688,
-39283,
-38955,
-38528,
-37777,
-36559,
-35017,
-33460,
-32166,
-31078,
-29888,
-28414,
-26852,
-25624,
-24919,
-24558,
-24256,
-24023,
-24070,
-24484,
-24991,
-25280,
-25336,
-25463,
-25840,
-26270,
-26342,
-26016,
-25733,
-26188,
-27581,
-29547,
-31415,
-32910,
-34338,
-36166,
-38477,
-40797,
-42573,
-43684,
-44452,
-45195,
-45825,
-45994,
-45452,
-44296,
-42765,
-41048,
-39273,
-37578,
-36139,
-34951,
-33905,
-32878,
-31949,
-31239,
-30752,
-30314,
-29780,
-29157,
-28548,
-27978,
-27386,
-26768,
-26237,
-25941,
-25860,
-25806,
-25615,
-25351,
-25300,
-25664,
-26332,
-26879,
-26993,
-26813,
-26796,
-27254,
-27963,
-28433,
-28455,
-28390,
-28724,
-29609,
-30708,
-31631,
-32270,
-32745,
-33179,
-33688,
-34410,
-35480,
-36835,
-38233,
-39613,
-41161,
-43034,
-44910,
-46103,
-46255,
-45637,
-44903,
-44316,
-43690,
-42762,
-41610,
-40445,
-39249,
-37775,
-35959,
-34082,
-32499,
-31305,
-30362,
-29583,
-29017,
-28634,
-28273,
-27764,
-27160,
-26538,
-25912,
-25224,
-24549,
-24134,
-24023,
-23991,
-23804,
-23538,
-23510,
-23844,
-24276,
-24509,
-24538,
-24583,
-24755,
-24939,
-25102,
-25413,
-25995,
-26709,
-27290,
-27804,
-28646,
-30036,
-31706,
-33188,
-34415,
-35891,
-38018,
-40732,
-43477,
-45947,
-48187,
-50394,
-52414,
-53845,
-54347,
-53948,
-52904,
-51441,
-49637,
-47440,
-44808,
-41804,
-38681,
-35744,
-33186,
-30919,
-28788,
-26821,
-25288,
-24359,
-23844,
-23329,
-22625,
-21910,
-21457,
-21197,
-20822,
-20142,
-19370,
-18805,
-18533,
-18369,
-18304,
-18568,
-19437,
-20752,
-22128,
-23283,
-24418,
-25846,
-27598,
-29379,
-30891,
-32161,
-33330,
-34418,
-35296,
-35986,
-36719,
-37695,
-38835,
-39973,
-41167,
-42713,
-44695,
-46735,
-48296,
-49246,
-49987,
-50915,
-51869,
-52232,
-51471,
-49650,
-47260,
-44769,
-42301,
-39691,
-36826,
-33841,
-31110,
-28962,
-27368,
-26014,
-24601,
-23249,
-22334,
-22041,
-22061,
-21917,
-21469,
-21040,
-20935,
-21072,
-21112,
-20923,
-20779,
-21004,
-21666,
-22530,
-23364,
-24084,
-24763,
-25527,
-26477,
-27606,
-28700,
-29556,
-30189,
-30908,
-31910,
-33016,
-33832,
-34289,
-34763,
-35647,
-36930,
-38313,
-39700,
-41309,
-43249,
-45252,
-46870,
-48009,
-48833,
-49475,
-49715,
-49358,
-48479,
-47301,
-45843,
-43909,
-41477,
-38830,
-36237,
-33660,
-30916,
-28195,
-25989,
-24648,
-23923,
-23316,
-22648,
-22194,
-22207,
-22557,
-22869,
-23018,
-23202,
-23634,
-24242,
-24839,
-25346,
-25915,
-26613,
-27361,
-28007,
-28567,
-29162,
-29871,
-30599,
-31241,
-31791,
-32321,
-32819,
-33175,
-33286,
-33244,
-33217,
-33312,
-33440,
-33517,
-33558,
-33734,
-34112,
-34594,
-35048,
-35496,
-36157,
-37154,
-38407,
-39660,
-40761,
-41729,
-42620,
-43372,
-43775,
-43609,
-42817,
-41506,
-39957,
-38433,
-37019,
-35591,
-33927,
-32049,
-30267,
-28878,
-27888,
-26991,
-26007,
-25126,
-24713,
-24838,
-25182,
-25356,
-25334,
-25355,
-25577,
-25877,
-26070,
-26234,
-26608,
-27321,
-28180,
-28947,
-29614,
-30393,
-31424,
-32543,
-33499,
-34217,
-34858,
-35596,
-36320,
-36788,
-36838,
-36575,
-36248,
-36000,
-35814,
-35603,
-35332,
-35048,
-34847,
-34788,
-34954,
-35314,
-35812,
-36320,
-36789,
-37232,
-37628,
-37913,
-37925,
-37666,
-37169,
-36549,
-35769,
-34791,
-33635,
-32443,
-31352,
-30398,
-29502,
-28660,
-27891,
-27303,
-26908,
-26707,
-26641,
-26620,
-26498,
-26151,
-25572,
-24873,
-24225,
-23737,
-23489,
-23561,
-23957,
-24650,
-25528,
-26636,
-28089,
-29985,
-32219,
-34579,
-37002,
-39604,
-42463,
-45328,
-47704,
-49201,
-49847,
-49888,
-49495,
-48601,
-47065,
-44978,
-42609,
-40264,
-38086,
-36042,
-34048,
-32061,
-30169,
-28582,
-27459,
-26830,
-26489,
-26248,
-26046,
-25930,
-25846,
-25611,
-25104,
-24499,
-24103,
-24072,
-24243,
-24416,
-24619,
-25057,
-25795,
-26533,
-26987,
-27139,
-27395,
-28064,
-29125,
-30202,
-31001,
-31534,
-32023,
-32618,
-33229,
-33654,
-33814,
-33858,
-34039,
-34558,
-35422,
-36567,
-37905,
-39348,
-40787,
-42081,
-43152,
-44004,
-44582,
-44818,
-44607,
-44055,
-43283,
-42270,
-40812,
-38798,
-36485,
-34341,
-32592,
-31076,
-29584,
-28221,
-27359,
-27146,
-27355,
-27673,
-28027,
-28554,
-29183,
-29656,
-29770,
-29625,
-29410,
-29123,
-28608,
-27891,
-27242,
-26913,
-26858,
-26877,
-26851,
-26855,
-26935,
-27053,
-27154,
-27270,
-27422,
-27552,
-27633,
-27768,
-28075,
-28489,
-28833,
-29020,
-29238,
-29634,
-30197,
-30904,
-31957,
-33660,
-35954,
-38389,
-40616,
-42821,
-45314,
-47893,
-49747,
-50334,
-49982,
-49489,
-49083,
-48159,
-46055,
-43000,
-39926,
-37545,
-35690,
-33746,
-31465,
-29254,
-27705,
-26936,
-26573,
-26080,
-25312,
-24565,
-24261,
-24511,
-24973,
-25124,
-24788,
-24283,
-24105,
-24405,
-24878,
-25127,
-25144,
-25307,
-25943,
-26940,
-27792,
-28151,
-28117,
-28166,
-28580,
-29182,
-29575,
-29646,
-29745,
-30251,
-31092,
-31851,
-32308,
-32781,
-33772,
-35351,
-37137,
-38798,
-40458,
-42393,
-44482,
-46187,
-47088,
-47334,
-47344,
-47303,
-46930,
-45944,
-44364,
-42494,
-40524,
-38415,
-36103,
-33685,
-31449,
-29620,
-28294,
-27379,
-26704,
-26107,
-25545,
-25068,
-24793,
-24721,
-24823,
-25038,
-25380,
-25798,
-26248,
-26650,
-27039,
-27419,
-27741,
-27914,
-27934,
-27978,
-28208,
-28678,
-29288,
-29956,
-30622,
-31282,
-31871,
-32374,
-32785,
-33104,
-33282,
-33317,
-33340,
-33543,
-34030,
-34665,
-35294,
-35839,
-36383,
-36990,
-37624,
-38224,
-38776,
-39307,
-39820,
-40292,
-40685,
-40928,
-40874,
-40369,
-39440,
-38294,
-37163,
-36031,
-34731,
-33174,
-31556,
-30166,
-29106,
-28190,
-27210,
-26167,
-25275,
-24701,
-24409,
-24200,
-23959,
-23728,
-23663,
-23879,
-24384,
-25107,
-26036,
-27206,
-28706,
-30567,
-32680,
-34842,
-36790,
-38346,
-39487,
-40347,
-41076,
-41669,
-41968,
-41775,
-41144,
-40296,
-39462,
-38613,
-37575,
-36295,
-35020,
-34077,
-33575,
-33273,
-32875,
-32285,
-31699,
-31313,
-31151,
-31034,
-30808,
-30455,
-30103,
-29839,
-29627,
-29345,
-28935,
-28545,
-28390,
-28550,
-28860,
-29069,
-29134,
-29227,
-29491,
-29799,
-29882,
-29624,
-29228,
-28947,
-28874,
-28907,
-28944,
-28954,
-28872,
-28616,
-28244,
-28045,
-28266,
-28846,
-29482,
-30066,
-30871,
-32268,
-34230,
-36373,
-38343,
-40143,
-41918,
-43639,
-45122,
-46275,
-47197,
-47891,
-48148,
-47727,
-46705,
-45319,
-43697,
-41667,
-39138,
-36380,
-33810,
-31632,
-29672,
-27805,
-26184,
-25120,
-24617,
-24358,
-24002,
-23556,
-23274,
-23360,
-23740,
-24189,
-24486,
-24552,
-24453,
-24340,
-24369,
-24510,
-24641,
-24621,
-24578,
-24752,
-25329,
-26180,
-27048,
-27762,
-28412,
-29210,
-30281,
-31508,
-32673,
-33599,
-34382,
-35308,
-36666,
-38469,
-40426,
-42200,
-43665,
-44993,
-46326,
-47617,
-48593,
-49093,
-49132,
-48885,
-48395,
-47553,
-46222,
-44349,
-42068,
-39536,
-36906,
-34256,
-31675,
-29278,
-27199,
-25535,
-24238,
-23168,
-22212,
-21381,
-20844,
-20722,
-20980,
-21435,
-21903,
-22353,
-22850,
-23469,
-24142,
-24747,
-25190,
-25521,
-25930,
-26535,
-27334,
-28137,
-28803,
-29384,
-30088,
-31059,
-32169,
-33156,
-33863,
-34428,
-35019,
-35623,
-36009,
-36087,
-36156,
-36624,
-37604,
-38730,
-39545,
-40072,
-40726,
-41853,
-43248,
-44341,
-44799,
-44809,
-44795,
-44822,
-44552,
-43536,
-41799,
-39719,
-37706,
-35783,
-33751,
-31474,
-29177,
-27230,
-25869,
-24996,
-24362,
-23771,
-23275,
-23022,
-23136,
-23581,
-24211,
-24847,
-25369,
-25811,
-26295,
-26940,
-27685,
-28355,
-28783,
-29063,
-29393,
-29878,
-30406,
-30763,
-30916,
-30975,
-31062,
-31199,
-31415,
-31802,
-32394,
-33022,
-33442,
-33636,
-33880,
-34418,
-35158,
-35812,
-36313,
-36915,
-37874,
-39037,
-40085,
-40868,
-41565,
-42262,
-42739,
-42676,
-42134,
-41447,
-40826,
-40055,
-38821,
-37160,
-35407,
-33781,
-32162,
-30396,
-28604,
-27153,
-26244,
-25796,
-25607,
-25614,
-25798,
-26073,
-26311,
-26478,
-26701,
-27048,
-27512,
-28086,
-28830,
-29797,
-30755,
-31462,
-31785,
-31952,
-32159,
-32427,
-32595,
-32685,
-32853,
-33216,
-33615,
-33818,
-33785,
-33657,
-33553,
-33400,
-33128,
-32796,
-32561,
-32503,
-32609,
-32875,
-33331,
-33872,
-34312,
-34554,
-34829,
-35416,
-36325,
-37160,
-37593,
-37645,
-37622,
-37568,
-37242,
-36393,
-35207,
-34123,
-33336,
-32647,
-31756,
-30683,
-29745,
-29149,
-28829,
-28568,
-28309,
-28135,
-28102,
-28160,
-28250,
-28390,
-28615,
-28860,
-29022,
-29118,
-29305,
-29748,
-30460,
-31296,
-32122,
-32913,
-33768,
-34760,
-35870,
-36913,
-37689,
-38108,
-38309,
-38478,
-38649,
-38611,
-38136,
-37293,
-36380,
-35640,
-35016,
-34271,
-33377,
-32540,
-31992,
-31664,
-31357,
-30974,
-30681,
-30616,
-30717,
-30775,
-30732,
-30733,
-30886,
-31126,
-31250,
-31190,
-31044,
-30945,
-30925,
-31000,
-31184,
-31465,
-31716,
-31770,
-31640,
-31505,
-31453,
-31387,
-31074,
-30561,
-30093,
-29857,
-29692,
-29257,
-28484,
-27673,
-27203,
-27119,
-27141,
-27057,
-27010,
-27343,
-28293,
-29729,
-31388,
-33073,
-34831,
-36776,
-38917,
-41074,
-42975,
-44451,
-45493,
-46147,
-46374,
-46048,
-45134,
-43809,
-42322,
-40769,
-39043,
-37073,
-35058,
-33334,
-32047,
-31054,
-30114,
-29275,
-28751,
-28649,
-28746,
-28714,
-28467,
-28185,
-28054,
-27993,
-27784,
-27285,
-26583,
-25861,
-25270,
-24840,
-24549,
-24265,
-23905,
-23452,
-23080,
-23013,
-23313,
-23851,
-24420,
-24982,
-25645,
-26514,
-27549,
-28601,
-29563,
-30513,
-31660,
-33237,
-35354,
-37890,
-40576,
-43187,
-45616,
-47848,
-49801,
-51274,
-52151,
-52454,
-52342,
-51829,
-50826,
-49235,
-47121,
-44660,
-41976,
-39140,
-36263,
-33522,
-31085,
-28989,
-27225,
-25773,
-24632,
-23724,
-22923,
-22193,
-21597,
-21203,
-20973,
-20821,
-20732,
-20725,
-20750,
-20679,
-20524,
-20459,
-20709,
-21254,
-21946,
-22709,
-23670,
-24927,
-26357,
-27744,
-28973,
-30134,
-31299,
-32458,
-33665,
-35062,
-36710,
-38420,
-39912,
-41251,
-42759,
-44585,
-46332,
-47429,
-47813,
-48046,
-48671,
-49556,
-49975,
-49374,
-47825,
-45844,
-43846,
-41849,
-39678,
-37227,
-34619,
-32144,
-30075,
-28470,
-27105,
-25697,
-24237,
-23072,
-22524,
-22563,
-22748,
-22806,
-22777,
-22940,
-23330,
-23728,
-23969,
-24156,
-24543,
-25194,
-25948,
-26635,
-27284,
-27997,
-28791,
-29509,
-29978,
-30173,
-30183,
-30176,
-30262,
-30538,
-31021,
-31700,
-32471,
-33230,
-33889,
-34469,
-35056,
-35754,
-36575,
-37488,
-38497,
-39734,
-41293,
-43091,
-44788,
-45973,
-46448,
-46248,
-45567,
-44582,
-43378,
-41995,
-40400,
-38565,
-36504,
-34360,
-32293,
-30365,
-28498,
-26667,
-25057,
-24012,
-23707,
-23927,
-24240,
-24344,
-24361,
-24593,
-25225,
-26066,
-26850,
-27472,
-28135,
-29017,
-30050,
-30901,
-31322,
-31343,
-31225,
-31175,
-31215,
-31309,
-31466,
-31803,
-32318,
-32860,
-33213,
-33323,
-33385,
-33645,
-34146,
-34623,
-34765,
-34560,
-34409,
-34694,
-35395,
-35997,
-36101,
-35877,
-35913,
-36527,
-37327,
-37641,
-37315,
-36856,
-36861,
-37207,
-37221,
-36433,
-35136,
-33993,
-33312,
-32765,
-31903,
-30761,
-29733,
-29139,
-28827,
-28511,
-28074,
-27703,
-27464,
-27286,
-27052,
-26942,
-27263,
-28073,
-29124,
-30075,
-30913,
-31827,
-32853,
-33771,
-34366,
-34755,
-35249,
-35939,
-36572,
-36870,
-36896,
-36900,
-36966,
-36859,
-36362,
-35570,
-34806,
-34229,
-33771,
-33319,
-32889,
-32532,
-32148,
-31605,
-30975,
-30518,
-30433,
-30634,
-30902,
-31159,
-31498,
-32008,
-32623,
-33204,
-33694,
-34097,
-34396,
-34563,
-34540,
-34363,
-34022,
-33514,
-32867,
-32147,
-31448,
-30829,
-30355,
-30071,
-29947,
-29862,
-29706,
-29546,
-29454,
-29366,
-28985,
-28174,
-27158,
-26376,
-26006,
-25820,
-25572,
-25332,
-25478,
-26215,
-27396,
-28729,
-30052,
-31453,
-33168,
-35501,
-38723,
-42722,
-46902,
-50381,
-52645,
-53782,
-54079,
-53513,
-51725,
-48681,
-44935,
-41239,
-37925,
-34743,
-31534,
-28495,
-26083,
-24416,
-23274,
-22463,
-22138,
-22562,
-23646,
-24850,
-25565,
-25604,
-25215,
-24757,
-24356,
-23899,
-23348,
-22871,
-22750,
-23110,
-23824,
-24754,
-25913,
-27408,
-29178,
-30895,
-32258,
-33264,
-34156,
-35093,
-35952,
-36506,
-36734,
-36807,
-36873,
-36908,
-36862,
-36796,
-36862,
-37074,
-37356,
-37666,
-38177,
-39083,
-40339,
-41648,
-42622,
-43141,
-43295,
-43239,
-42944,
-42233,
-41018,
-39443,
-37822,
-36341,
-34885,
-33223,
-31329,
-29487,
-28042,
-27041,
-26269,
-25531,
-24867,
-24449,
-24311,
-24360,
-24499,
-24740,
-25103,
-25498,
-25859,
-26202,
-26635,
-27163,
-27687,
-28115,
-28521,
-29013,
-29616,
-30226,
-30686,
-30930,
-30968,
-30928,
-31007,
-31375,
-31997,
-32704,
-33409,
-34204,
-35205,
-36226,
-36931,
-37220,
-37483,
-38120,
-39132,
-40017,
-40473,
-40681,
-41060,
-41618,
-41914,
-41546,
-40615,
-39534,
-38501,
-37390,
-35992,
-34421,
-32963,
-31795,
-30823,
-29831,
-28755,
-27735,
-27034,
-26795,
-26960,
-27257,
-27481,
-27661,
-28020,
-28693,
-29489,
-30103,
-30417,
-30632,
-31028,
-31628,
-32238,
-32652,
-32823,
-32820,
-32726,
-32609,
-32541,
-32538,
-32501,
-32362,
-32121,
-31923,
-31797,
-31635,
-31329,
-30907,
-30571,
-30435,
-30449,
-30486,
-30481,
-30450,
-30424,
-30439,
-30586,
-31003,
-31765,
-32801,
-34015,
-35289,
-36580,
-37720,
-38553,
-38991,
-39141,
-39163,
-39069,
-38710,
-37999,
-37135,
-36515,
-36356,
-36408,
-36142,
-35253,
-34062,
-33198,
-32983,
-33085,
-32882,
-32193,
-31380,
-30914,
-30742,
-30438,
-29778,
-29019,
-28559,
-28432,
-28313,
-28049,
-27820,
-27921,
-28290,
-28685,
-28979,
-29342,
-29933,
-30607,
-31159,
-31521,
-31857,
-32210,
-32469,
-32530,
-32594,
-32852,
-33282,
-33554,
-33497,
-33284,
-33240,
-33464,
-33788,
-34122,
-34578,
-35313,
-36183,
-36858,
-37134,
-37138,
-37138,
-37183,
-37134,
-36818,
-36297,
-35710,
-35117,
-34438,
-33628,
-32767,
-32013,
-31372,
-30731,
-29999,
-29216,
-28525,
-27887,
-27206,
-26397,
-25637,
-25134,
-24923,
-24843,
-24770,
-24812,
-25115,
-25585,
-26026,
-26437,
-27245,
-28928,
-31547,
-34742,
-38129,
-41573,
-45010,
-48049,
-50186,
-51167,
-51269,
-50836,
-49862,
-48053,
-45369,
-42234,
-39231,
-36480,
-33755,
-30832,
-28036,
-25880,
-24715,
-24355,
-24395,
-24508,
-24624,
-24770,
-24901,
-24924,
-24748,
-24423,
-24048,
-23739,
-23549,
-23486,
-23533,
-23670,
-23906,
-24300,
-24987,
-26043,
-27438,
-28968,
-30506,
-32031,
-33666,
-35330,
-36774,
-37705,
-38095,
-38163,
-38103,
-37899,
-37468,
-36848,
-36292,
-36007,
-36084,
-36477,
-37188,
-38157,
-39261,
-40268,
-41079,
-41756,
-42443,
-43203,
-43964,
-44576,
-44870,
-44606,
-43656,
-42018,
-39902,
-37512,
-34927,
-32202,
-29467,
-27009,
-25008,
-23459,
-22249,
-21326,
-20795,
-20715,
-21050,
-21652,
-22396,
-23177,
-23899,
-24445,
-24761,
-24852,
-24760,
-24567,
-24361,
-24319,
-24543,
-25057,
-25742,
-26478,
-27224,
-28090,
-29204,
-30671,
-32403,
-34200,
-35894,
-37471,
-39012,
-40500,
-41758,
-42646,
-43333,
-44105,
-45072,
-45927,
-46341,
-46359,
-46369,
-46538,
-46524,
-45786,
-44280,
-42523,
-41055,
-39853,
-38476,
-36635,
-34540,
-32559,
-30828,
-29182,
-27503,
-25900,
-24545,
-23481,
-22642,
-22038,
-21760,
-21807,
-22031,
-22273,
-22551,
-22991,
-23578,
-24167,
-24609,
-25064,
-25786,
-26871,
-28026,
-28856,
-29235,
-29472,
-29940,
-30701,
-31407,
-31720,
-31729,
-31871,
-32525,
-33499,
-34315,
-34568,
-34491,
-34605,
-35321,
-36520,
-37805,
-38923,
-40000,
-41333,
-42938,
-44448,
-45305,
-45283,
-44608,
-43816,
-43243,
-42795,
-42098,
-40878,
-39202,
-37375,
-35618,
-33925,
-32176,
-30339,
-28591,
-27180,
-26291,
-25856,
-25655,
-25404,
-25021,
-24658,
-24530,
-24697,
-24931,
-25056,
-25112,
-25360,
-25931,
-26611,
-27111,
-27397,
-27763,
-28486,
-29501,
-30523,
-31342,
-31993,
-32584,
-33142,
-33628,
-34069,
-34482,
-34790,
-34880,
-34820,
-34898,
-35301,
-35880,
-36271,
-36357,
-36396,
-36669,
-37108,
-37372,
-37356,
-37345,
-37670,
-38230,
-38535,
-38257,
-37525,
-36773,
-36207,
-35695,
-34988,
-34058,
-33088,
-32274,
-31637,
-31043,
-30321,
-29401,
-28414,
-27654,
-27347,
-27419,
-27523,
-27387,
-27120,
-27100,
-27486,
-28032,
-28340,
-28374,
-28546,
-29227,
-30356,
-31426,
-32058,
-32354,
-32762,
-33621,
-34819,
-35955,
-36697,
-37083,
-37388,
-37851,
-38391,
-38713,
-38578,
-38080,
-37524,
-37154,
-36889,
-36490,
-35805,
-34947,
-34118,
-33402,
-32771,
-32176,
-31654,
-31265,
-30946,
-30644,
-30273,
-29892,
-29521,
-29253,
-29159,
-29291,
-29549,
-29704,
-29622,
-29434,
-29417,
-29670,
-29953,
-29994,
-29840,
-29840,
-30182,
-30625,
-30710,
-30325,
-29817,
-29609,
-29726,
-29844,
-29699,
-29438,
-29398,
-29764,
-30408,
-31042,
-31522,
-31907,
-32405,
-33195,
-34266,
-35370,
-36206,
-36775,
-37423,
-38643,
-40450,
-42403,
-43951,
-44999,
-45845,
-46660,
-47114,
-46657,
-45134,
-42939,
-40653,
-38443,
-36087,
-33375,
-30474,
-27830,
-25741,
-24238,
-23170,
-22481,
-22251,
-22486,
-23038,
-23658,
-24145,
-24471,
-24677,
-24800,
-24835,
-24819,
-24843,
-25015,
-25353,
-25797,
-26285,
-26813,
-27424,
-28138,
-28972,
-29914,
-30971,
-32106,
-33276,
-34465,
-35677,
-36818,
-37687,
-38110,
-38161,
-38128,
-38195,
-38243,
-37988,
-37461,
-37053,
-37226,
-37952,
-38816,
-39377,
-39681,
-40039,
-40715,
-41596,
-42359,
-42744,
-42694,
-42356,
-41878,
-41311,
-40439,
-38956,
-36756,
-34155,
-31709,
-29727,
-28021,
-26250,
-24405,
-22920,
-22154,
-22004,
-21980,
-21783,
-21558,
-21659,
-22210,
-22995,
-23724,
-24283,
-24768,
-25340,
-26056,
-26897,
-27679,
-28267,
-28646,
-29048,
-29699,
-30586,
-31435,
-32078,
-32703,
-33669,
-35013,
-36317,
-37160,
-37620,
-38264,
-39441,
-40916,
-42009,
-42402,
-42306,
-42247,
-42376,
-42500,
-42350,
-41935,
-41447,
-40973,
-40420,
-39645,
-38636,
-37405,
-35995,
-34449,
-32940,
-31699,
-30763,
-29979,
-29139,
-28294,
-27685,
-27438,
-27420,
-27301,
-27011,
-26766,
-26867,
-27345,
-27891,
-28168,
-28109,
-27915,
-27825,
-27875,
-27938,
-27933,
-27908,
-28016,
-28295,
-28689,
-29031,
-29286,
-29435,
-29559,
-29703,
-29894,
-30132,
-30374,
-30617,
-30950,
-31519,
-32339,
-33241,
-33943,
-34477,
-35096,
-36121,
-37476,
-38801,
-39887,
-40883,
-42108,
-43478,
-44529,
-44770,
-44252,
-43372,
-42466,
-41469,
-40156,
-38480,
-36663,
-34900,
-33246,
-31598,
-29984,
-28514,
-27353,
-26629,
-26353,
-26496,
-26854,
-27248,
-27570,
-27871,
-28250,
-28662,
-29018,
-29258,
-29477,
-29787,
-30168,
-30455,
-30502,
-30270,
-29878,
-29507,
-29304,
-29355,
-29613,
-29964,
-30286,
-30552,
-30778,
-30997,
-31209,
-31374,
-31501,
-31535,
-31489,
-31438,
-31559,
-32028,
-32839,
-33764,
-34562,
-35148,
-35712,
-36513,
-37631,
-38893,
-39937,
-40557,
-40778,
-40883,
-41050,
-41152,
-40814,
-39750,
-38079,
-36264,
-34730,
-33528,
-32396,
-31069,
-29605,
-28302,
-27447,
-27038,
-26838,
-26573,
-26185,
-25854,
-25838,
-26253,
-26953,
-27667,
-28205,
-28648,
-29245,
-30159,
-31256,
-32206,
-32834,
-33367,
-34195,
-35425,
-36647,
-37301,
-37245,
-36887,
-36675,
-36594,
-36225,
-35331,
-34178,
-33288,
-32816,
-32536,
-32094,
-31470,
-30836,
-30354,
-30061,
-30046,
-30382,
-31059,
-31832,
-32549,
-33277,
-34226,
-35338,
-36301,
-36807,
-36914,
-36875,
-36802,
-36530,
-35915,
-35065,
-34215,
-33454,
-32604,
-31566,
-30465,
-29587,
-29074,
-28792,
-28564,
-28325,
-28180,
-28161,
-28147,
-27889,
-27299,
-26484,
-25734,
-25209,
-24899,
-24665,
-24506,
-24570,
-25036,
-25908,
-27040,
-28293,
-29654,
-31255,
-33279,
-35947,
-39420,
-43576,
-47917,
-51703,
-54393,
-55803,
-56059,
-55168,
-53115,
-50005,
-46285,
-42468,
-38870,
-35494,
-32360,
-29606,
-27391,
-25680,
-24343,
-23450,
-23302,
-24009,
-25171,
-26011,
-26021,
-25384,
-24629,
-24039,
-23318,
-22083,
-20428,
-19050,
-18625,
-19171,
-20104,
-20850,
-21478,
-22606,
-24689,
-27519,
-30307,
-32426,
-33877,
-35181,
-36714,
-38292,
-39376,
-39625,
-39286,
-38863,
-38689,
-38650,
-38510,
-38329,
-38433,
-39097,
-40236,
-41469,
-42536,
-43399,
-44186,
-44859,
-45275,
-45257,
-44789,
-43967,
-42907,
-41662,
-40273,
-38638,
-36703,
-34425,
-32021,
-29800,
-28000,
-26557,
-25290,
-24079,
-23072,
-22392,
-22018,
-21744,
-21442,
-21253,
-21371,
-21843,
-22438,
-22894,
-23189,
-23504,
-24006,
-24631,
-25178,
-25556,
-25852,
-26230,
-26778,
-27506,
-28495,
-29832,
-31422,
-32972,
-34161,
-35070,
-36094,
-37594,
-39436,
-41130,
-42295,
-43092,
-43981,
-45237,
-46611,
-47500,
-47510,
-46692,
-45543,
-44520,
-43735,
-42837,
-41419,
-39406,
-37205,
-35338,
-33903,
-32510,
-30748,
-28728,
-27076,
-26300,
-26279,
-26363,
-26053,
-25448,
-25054,
-25183,
-25660,
-26037,
-26138,
-26169,
-26497,
-27198,
-27999,
-28528,
-28657,
-28595,
-28635,
-28948,
-29448,
-29999,
-30477,
-30899,
-31253,
-31524,
-31690,
-31761,
-31777,
-31740,
-31593,
-31335,
-31066,
-30942,
-31023,
-31180,
-31258,
-31293,
-31545,
-32240,
-33285,
-34376,
-35381,
-36544,
-38201,
-40272,
-42214,
-43491,
-44092,
-44354,
-44474,
-44225,
-43314,
-41843,
-40227,
-38739,
-37309,
-35756,
-34158,
-32731,
-31539,
-30465,
-29497,
-28849,
-28675,
-28746,
-28701,
-28412,
-28180,
-28217,
-28390,
-28365,
-28099,
-27825,
-27727,
-27616,
-27305,
-26881,
-26690,
-26830,
-27069,
-27140,
-27144,
-27382,
-27929,
-28562,
-29035,
-29371,
-29746,
-30142,
-30443,
-30608,
-30874,
-31426,
-32183,
-32884,
-33448,
-34078,
-35067,
-36387,
-37779,
-38968,
-39930,
-40823,
-41737,
-42565,
-43040,
-42970,
-42387,
-41534,
-40717,
-40021,
-39277,
-38198,
-36658,
-34832,
-33070,
-31595,
-30387,
-29271,
-28176,
-27252,
-26727,
-26655,
-26887,
-27141,
-27357,
-27630,
-28098,
-28747,
-29367,
-29832,
-30085,
-30192,
-30176,
-30054,
-29950,
-30051,
-30473,
-31101,
-31687,
-32037,
-32207,
-32363,
-32626,
-32903,
-33051,
-32972,
-32818,
-32778,
-32973,
-33266,
-33424,
-33327,
-33105,
-33000,
-33117,
-33375,
-33678,
-34087,
-34770,
-35717,
-36690,
-37356,
-37622,
-37601,
-37444,
-37113,
-36481,
-35525,
-34435,
-33436,
-32606,
-31835,
-31018,
-30191,
-29538,
-29202,
-29133,
-29186,
-29187,
-29171,
-29205,
-29343,
-29489,
-29522,
-29402,
-29184,
-28947,
-28748,
-28657,
-28746,
-29047,
-29456,
-29907,
-30455,
-31341,
-32643,
-34212,
-35671,
-36849,
-37818,
-38756,
-39683,
-40463,
-41038,
-41446,
-41699,
-41624,
-41034,
-39982,
-38748,
-37588,
-36427,
-35078,
-33489,
-31922,
-30682,
-29821,
-29132,
-28399,
-27652,
-27094,
-26904,
-27048,
-27346,
-27647,
-27880,
-28107,
-28305,
-28488,
-28625,
-28769,
-28975,
-29206,
-29396,
-29475,
-29515,
-29640,
-29926,
-30368,
-30847,
-31283,
-31619,
-31866,
-32161,
-32574,
-33073,
-33401,
-33315,
-32853,
-32291,
-31863,
-31460,
-30801,
-29866,
-29055,
-28874,
-29495,
-30678,
-32159,
-33900,
-36028,
-38553,
-41310,
-44082,
-46697,
-48952,
-50591,
-51370,
-51212,
-50123,
-48132,
-45314,
-41903,
-38313,
-34881,
-31764,
-29009,
-26730,
-25102,
-24136,
-23629,
-23376,
-23335,
-23586,
-24038,
-24454,
-24601,
-24485,
-24191,
-23678,
-22850,
-21741,
-20697,
-20087,
-20022,
-20269,
-20577,
-20955,
-21712,
-23128,
-25171,
-27495,
-29683,
-31644,
-33591,
-35793,
-38221,
-40508,
-42326,
-43690,
-44916,
-46244,
-47540,
-48432,
-48714,
-48499,
-48120,
-47693,
-47030,
-45839,
-44039,
-41968,
-40092,
-38641,
-37390,
-35934,
-34055,
-32006,
-30192,
-28850,
-27891,
-27156,
-26579,
-26230,
-26101,
-26096,
-26122,
-26108,
-25973,
-25582,
-24970,
-24351,
-24039,
-24099,
-24347,
-24594,
-24849,
-25273,
-25901,
-26649,
-27451,
-28395,
-29573,
-30896,
-32164,
-33255,
-34201,
-35079,
-35829,
-36359,
-36597,
-36554,
-36255,
-35763,
-35260,
-34984,
-34983,
-35099,
-35111,
-35075,
-35193,
-35558,
-35890,
-35893,
-35618,
-35492,
-35855,
-36522,
-36993,
-36927,
-36509,
-36098,
-35816,
-35441,
-34688,
-33632,
-32536,
-31678,
-31138,
-30917,
-31009,
-31346,
-31741,
-32066,
-32410,
-32990,
-33851,
-34704,
-35256,
-35491,
-35682,
-35866,
-35742,
-34958,
-33612,
-32225,
-31171,
-30363,
-29481,
-28462,
-27587,
-27092,
-26895,
-26780,
-26664,
-26689,
-26888,
-27162,
-27339,
-27426,
-27441,
-27385,
-27189,
-26959,
-26863,
-26989,
-27257,
-27591,
-28154,
-29172,
-30712,
-32568,
-34540,
-36573,
-38724,
-40855,
-42712,
-44042,
-44822,
-45136,
-45071,
-44666,
-44005,
-43173,
-42206,
-41063,
-39730,
-38267,
-36796,
-35389,
-34112,
-33042,
-32232,
-31636,
-31114,
-30544,
-29939,
-29396,
-28966,
-28637,
-28289,
-27880,
-27375,
-26882,
-26517,
-26341,
-26250,
-26056,
-25764,
-25610,
-25915,
-26678,
-27574,
-28246,
-28675,
-29107,
-29715,
-30375,
-30820,
-30960,
-30962,
-31034,
-31223,
-31411,
-31474,
-31469,
-31587,
-32105,
-33148,
-34645,
-36329,
-37965,
-39496,
-40991,
-42390,
-43427,
-43788,
-43462,
-42768,
-42059,
-41401,
-40515,
-39207,
-37529,
-35883,
-34547,
-33560,
-32683,
-31711,
-30663,
-29724,
-29070,
-28644,
-28210,
-27545,
-26621,
-25625,
-24776,
-24130,
-23599,
-23032,
-22434,
-21924,
-21712,
-21937,
-22640,
-23763,
-25226,
-26991,
-29098,
-31544,
-34199,
-36746,
-38885,
-40511,
-41769,
-42816,
-43599,
-43908,
-43637,
-43027,
-42418,
-41981,
-41498,
-40711,
-39656,
-38672,
-38043,
-37688,
-37247,
-36503,
-35532,
-34590,
-33763,
-32967,
-32058,
-31077,
-30095,
-29184,
-28272,
-27317,
-26355,
-25513,
-24901,
-24612,
-24571,
-24707,
-24838,
-24946,
-25051,
-25240,
-25518,
-25788,
-26010,
-26168,
-26307,
-26412,
-26487,
-26634,
-26999,
-27634,
-28379,
-29034,
-29575,
-30177,
-31022,
-32079,
-33243,
-34489,
-36018,
-37992,
-40329,
-42734,
-44865,
-46626,
-48017,
-49081,
-49769,
-50040,
-49904,
-49425,
-48583,
-47401,
-45840,
-43991,
-41897,
-39596,
-37178,
-34797,
-32664,
-30839,
-29218,
-27663,
-26164,
-24830,
-23698,
-22643,
-21544,
-20464,
-19623,
-19113,
-18799,
-18453,
-18085,
-17896,
-18067,
-18552,
-19209,
-20042,
-21105,
-22367,
-23580,
-24576,
-25511,
-26681,
-28256,
-29967,
-31481,
-32652,
-33726,
-35007,
-36614,
-38358,
-39937,
-41209,
-42326,
-43667,
-45478,
-47570,
-49371,
-50388,
-50663,
-50688,
-50839,
-50954,
-50519,
-49280,
-47530,
-45749,
-44094,
-42257,
-39957,
-37305,
-34784,
-32750,
-31146,
-29600,
-27875,
-26067,
-24467,
-23211,
-22090,
-20788,
-19213,
-17666,
-16562,
-16093,
-16046,
-16127,
-16214,
-16541,
-17326,
-18645,
-20223,
-21778,
-23134,
-24394,
-25752,
-27278,
-28833,
-30146,
-31175,
-32109,
-33229,
-34475,
-35537,
-36144,
-36525,
-37191,
-38524,
-40390,
-42355,
-44095,
-45588,
-46949,
-48183,
-49169,
-49737,
-49812,
-49442,
-48803,
-48146,
-47529,
-46703,
-45252,
-43018,
-40305,
-37623,
-35230,
-33024,
-30872,
-28865,
-27256,
-26058,
-25019,
-23892,
-22696,
-21675,
-20995,
-20648,
-20517,
-20536,
-20642,
-20782,
-20912,
-21128,
-21511,
-22137,
-22936,
-23881,
-24969,
-26165,
-27364,
-28409,
-29297,
-30070,
-30789,
-31413,
-31946,
-32472,
-33102,
-33764,
-34321,
-34725,
-35180,
-35930,
-36982,
-38070,
-38976,
-39745,
-40661,
-41833,
-43086,
-44089,
-44697,
-45049,
-45338,
-45534,
-45419,
-44760,
-43593,
-42137,
-40595,
-39002,
-37264,
-35372,
-33454,
-31708,
-30174,
-28742,
-27317,
-25967,
-24932,
-24358,
-24132,
-23998,
-23779,
-23535,
-23443,
-23529,
-23687,
-23800,
-23951,
-24323,
-25046,
-26031,
-27129,
-28185,
-29155,
-30020,
-30805,
-31582,
-32414,
-33294,
-34124,
-34818,
-35370,
-35753,
-35917,
-35772,
-35390,
-34971,
-34693,
-34580,
-34588,
-34751,
-35134,
-35684,
-36181,
-36478,
-36696,
-37047,
-37579,
-38081,
-38415,
-38646,
-38926,
-39136,
-38987,
-38317,
-37302,
-36233,
-35170,
-34018,
-32725,
-31442,
-30314,
-29345,
-28532,
-27956,
-27714,
-27655,
-27489,
-27092,
-26690,
-26556,
-26664,
-26717,
-26604,
-26544,
-26887,
-27640,
-28546,
-29329,
-29990,
-30645,
-31362,
-32121,
-32937,
-33817,
-34769,
-35707,
-36589,
-37348,
-37851,
-37926,
-37610,
-37215,
-37094,
-37265,
-37395,
-37199,
-36745,
-36333,
-36071,
-35760,
-35160,
-34294,
-33457,
-32925,
-32754,
-32841,
-32972,
-33013,
-32907,
-32747,
-32689,
-32761,
-32794,
-32584,
-32119,
-31613,
-31275,
-31083,
-30867,
-30513,
-30048,
-29583,
-29139,
-28737,
-28417,
-28227,
-28177,
-28165,
-28153,
-28143,
-28158,
-28172,
-28067,
-27814,
-27449,
-27134,
-27003,
-27093,
-27338,
-27597,
-27846,
-28169,
-28729,
-29572,
-30631,
-31918,
-33608,
-35960,
-38958,
-42242,
-45321,
-47889,
-49899,
-51302,
-51952,
-51709,
-50697,
-49225,
-47522,
-45525,
-43046,
-40137,
-37110,
-34346,
-31932,
-29785,
-27857,
-26375,
-25576,
-25384,
-25359,
-25008,
-24225,
-23322,
-22620,
-22166,
-21657,
-20919,
-20076,
-19476,
-19328,
-19509,
-19779,
-20051,
-20523,
-21475,
-23024,
-24999,
-27079,
-29025,
-30818,
-32593,
-34413,
-36116,
-37428,
-38241,
-38718,
-39217,
-39872,
-40595,
-41135,
-41433,
-41613,
-41917,
-42404,
-43002,
-43512,
-43823,
-43961,
-44037,
-44111,
-44061,
-43617,
-42630,
-41205,
-39633,
-38154,
-36756,
-35330,
-33894,
-32564,
-31444,
-30461,
-29457,
-28377,
-27257,
-26201,
-25250,
-24438,
-23809,
-23324,
-22905,
-22449,
-21980,
-21622,
-21486,
-21647,
-22116,
-22931,
-24035,
-25307,
-26603,
-27961,
-29463,
-31063,
-32456,
-33313,
-33646,
-33759,
-33975,
-34251,
-34353,
-34181,
-33900,
-33777,
-33824,
-33946,
-34065,
-34324,
-34808,
-35443,
-36005,
-36404,
-36723,
-37148,
-37746,
-38507,
-39339,
-40151,
-40797,
-41261,
-41598,
-41957,
-42220,
-42111,
-41412,
-40370,
-39440,
-38909,
-38469,
-37729,
-36586,
-35440,
-34535,
-33683,
-32453,
-30782,
-29124,
-27891,
-27032,
-26108,
-24918,
-23684,
-22759,
-22185,
-21742,
-21268,
-20870,
-20714,
-20866,
-21292,
-21969,
-22816,
-23613,
-24130,
-24399,
-24816,
-25688,
-26982,
-28327,
-29498,
-30635,
-31997,
-33604,
-35205,
-36602,
-37825,
-39096,
-40523,
-42130,
-43813,
-45431,
-46723,
-47457,
-47625,
-47477,
-47257,
-46925,
-46254,
-45147,
-43839,
-42592,
-41399,
-39960,
-38100,
-36018,
-34101,
-32517,
-31125,
-29725,
-28366,
-27235,
-26399,
-25645,
-24771,
-23814,
-23066,
-22728,
-22766,
-22950,
-23164,
-23432,
-23812,
-24264,
-24705,
-25161,
-25718,
-26410,
-27144,
-27785,
-28376,
-28990,
-29653,
-30229,
-30593,
-30831,
-31092,
-31448,
-31756,
-31968,
-32261,
-32932,
-34025,
-35240,
-36275,
-37167,
-38203,
-39454,
-40631,
-41377,
-41777,
-42283,
-43124,
-43984,
-44256,
-43750,
-42800,
-41876,
-40954,
-39705,
-37944,
-35976,
-34251,
-32905,
-31721,
-30452,
-29127,
-27908,
-26914,
-26128,
-25548,
-25179,
-24964,
-24784,
-24615,
-24565,
-24752,
-25090,
-25419,
-25745,
-26287,
-27218,
-28402,
-29574,
-30631,
-31776,
-33163,
-34651,
-35890,
-36674,
-37114,
-37402,
-37591,
-37522,
-37148,
-36568,
-36042,
-35716,
-35527,
-35302,
-34864,
-34266,
-33692,
-33340,
-33201,
-33062,
-32825,
-32579,
-32570,
-32823,
-33036,
-32927,
-32463,
-31977,
-31728,
-31670,
-31554,
-31286,
-31005,
-30973,
-31140,
-31281,
-31160,
-30908,
-30858,
-31283,
-32037,
-32708,
-33003,
-33022,
-33106,
-33390,
-33642,
-33534,
-33108,
-32749,
-32817,
-33211,
-33530,
-33483,
-33108,
-32633,
-32154,
-31672,
-31197,
-30828,
-30583,
-30393,
-30231,
-30240,
-30577,
-31181,
-31778,
-32191,
-32559,
-33169,
-34099,
-35110,
-35882,
-36349,
-36659,
-36944,
-37142,
-37074,
-36658,
-35995,
-35279,
-34671,
-34212,
-33846,
-33511,
-33174,
-32905,
-32732,
-32642,
-32522,
-32303,
-32034,
-31832,
-31760,
-31725,
-31601,
-31354,
-31091,
-30956,
-30957,
-30970,
-30889,
-30728,
-30630,
-30689,
-30822,
-30803,
-30509,
-29999,
-29519,
-29172,
-28827,
-28233,
-27348,
-26444,
-25883,
-25758,
-25850,
-25844,
-25681,
-25509,
-25506,
-25702,
-26104,
-26735,
-27735,
-29187,
-31244,
-34155,
-38082,
-42808,
-47537,
-51404,
-54060,
-55845,
-57201,
-58026,
-57729,
-55937,
-52984,
-49588,
-46151,
-42476,
-38278,
-33745,
-29511,
-26124,
-23678,
-21966,
-20881,
-20448,
-20582,
-20974,
-21238,
-21257,
-21106,
-20898,
-20578,
-20077,
-19482,
-18986,
-18674,
-18440,
-18152,
-17948,
-18294,
-19622,
-21975,
-24860,
-27630,
-29978,
-32113,
-34443,
-37020,
-39418,
-41080,
-41912,
-42340,
-42875,
-43551,
-43984,
-43846,
-43317,
-42949,
-43088,
-43606,
-44099,
-44326,
-44409,
-44486,
-44533,
-44251,
-43499,
-42326,
-41001,
-39631,
-38207,
-36573,
-34733,
-32749,
-30803,
-28990,
-27381,
-26012,
-24931,
-24214,
-23850,
-23716,
-23561,
-23237,
-22776,
-22463,
-22485,
-22802,
-23127,
-23245,
-23241,
-23402,
-23979,
-24907,
-25953,
-26938,
-27909,
-29059,
-30464,
-32003,
-33402,
-34508,
-35317,
-35956,
-36462,
-36790,
-36878,
-36767,
-36635,
-36676,
-36997,
-37571,
-38187,
-38637,
-38856,
-39021,
-39366,
-39815,
-39980,
-39505,
-38646,
-38075,
-38211,
-38628,
-38437,
-37265,
-35716,
-34611,
-34041,
-33226,
-31560,
-29427,
-27847,
-27346,
-27392,
-27143,
-26344,
-25634,
-25682,
-26523,
-27649,
-28559,
-29244,
-30004,
-31136,
-32645,
-34264,
-35519,
-36091,
-36054,
-35857,
-35867,
-35923,
-35473,
-34217,
-32559,
-31240,
-30605,
-30256,
-29635,
-28676,
-27937,
-27902,
-28483,
-29123,
-29408,
-29438,
-29528,
-29829,
-30130,
-30187,
-29971,
-29699,
-29569,
-29658,
-29940,
-30466,
-31398,
-32849,
-34771,
-36840,
-38676,
-40064,
-41081,
-41956,
-42728,
-43142,
-42900,
-42007,
-40866,
-39872,
-38995,
-37845,
-36119,
-34025,
-32146,
-30908,
-30303,
-29975,
-29682,
-29463,
-29525,
-29936,
-30521,
-30929,
-30927,
-30554,
-30139,
-30007,
-30218,
-30483,
-30492,
-30184,
-29804,
-29547,
-29340,
-28964,
-28344,
-27750,
-27491,
-27689,
-28170,
-28655,
-28983,
-29150,
-29286,
-29544,
-29979,
-30477,
-30847,
-31053,
-31321,
-31919,
-32833,
-33709,
-34260,
-34631,
-35286,
-36540,
-38169,
-39671,
-40739,
-41451,
-42064,
-42565,
-42774,
-42495,
-41799,
-40870,
-39806,
-38601,
-37274,
-35954,
-34783,
-33755,
-32706,
-31529,
-30308,
-29252,
-28462,
-27817,
-27063,
-26143,
-25179,
-24442,
-23974,
-23677,
-23352,
-22954,
-22551,
-22240,
-22109,
-22247,
-22796,
-23880,
-25517,
-27600,
-29964,
-32442,
-34884,
-37191,
-39276,
-41081,
-42479,
-43367,
-43757,
-43878,
-43973,
-44061,
-43860,
-43103,
-41880,
-40584,
-39582,
-38846,
-38100,
-37170,
-36147,
-35259,
-34590,
-34031,
-33390,
-32582,
-31584,
-30496,
-29457,
-28586,
-27878,
-27186,
-26450,
-25779,
-25397,
-25330,
-25366,
-25268,
-25107,
-25136,
-25485,
-25915,
-26070,
-25858,
-25570,
-25559,
-25888,
-26278,
-26412,
-26244,
-26044,
-26197,
-26851,
-27834,
-28765,
-29470,
-30146,
-31236,
-33011,
-35332,
-37841,
-40354,
-42923,
-45673,
-48364,
-50608,
-52061,
-52763,
-52955,
-52773,
-52160,
-50946,
-49076,
-46634,
-43793,
-40725,
-37614,
-34596,
-31811,
-29306,
-27173,
-25472,
-24239,
-23397,
-22758,
-22149,
-21534,
-21037,
-20775,
-20751,
-20784,
-20715,
-20562,
-20481,
-20617,
-20909,
-21198,
-21407,
-21687,
-22260,
-23178,
-24272,
-25297,
-26202,
-27185,
-28442,
-29986,
-31525,
-32741,
-33545,
-34191,
-35000,
-36081,
-37265,
-38387,
-39630,
-41358,
-43733,
-46402,
-48746,
-50463,
-51771,
-53040,
-54273,
-54991,
-54773,
-53659,
-52072,
-50222,
-47879,
-44613,
-40436,
-35925,
-31808,
-28432,
-25596,
-22993,
-20599,
-18685,
-17487,
-16899,
-16615,
-16424,
-16378,
-16687,
-17367,
-18268,
-19114,
-19785,
-20345,
-20916,
-21614,
-22407,
-23228,
-24029,
-24867,
-25886,
-27159,
-28614,
-30043,
-31339,
-32542,
-33809,
-35171,
-36530,
-37737,
-38756,
-39601,
-40331,
-41024,
-41850,
-42944,
-44248,
-45479,
-46400,
-47075,
-47750,
-48471,
-48909,
-48673,
-47773,
-46638,
-45636,
-44583,
-42925,
-40284,
-36925,
-33513,
-30565,
-28061,
-25714,
-23382,
-21364,
-20103,
-19730,
-19896,
-20054,
-19992,
-19990,
-20495,
-21585,
-22864,
-23857,
-24465,
-25046,
-25858,
-26863,
-27701,
-28242,
-28694,
-29359,
-30307,
-31316,
-32174,
-32865,
-33528,
-34250,
-34982,
-35620,
-36005,
-36095,
-35944,
-35833,
-36014,
-36486,
-36880,
-36859,
-36519,
-36323,
-36584,
-37062,
-37296,
-37302,
-37630,
-38776,
-40405,
-41646,
-41957,
-41680,
-41490,
-41481,
-41038,
-39609,
-37487,
-35482,
-34059,
-32833,
-31130,
-28807,
-26393,
-24519,
-23322,
-22529,
-21902,
-21517,
-21601,
-22219,
-23246,
-24452,
-25652,
-26727,
-27676,
-28648,
-29873,
-31391,
-32952,
-34185,
-34949,
-35474,
-36071,
-36741,
-37147,
-36985,
-36352,
-35688,
-35363,
-35340,
-35331,
-35091,
-34710,
-34383,
-34213,
-34107,
-33896,
-33553,
-33159,
-32870,
-32730,
-32738,
-32789,
-32858,
-32968,
-33219,
-33643,
-34141,
-34601,
-34951,
-35314,
-35739,
-36151,
-36335,
-36144,
-35643,
-34914,
-34018,
-32867,
-31544,
-30258,
-29292,
-28706,
-28385,
-28108,
-27839,
-27619,
-27553,
-27641,
-27848,
-28080,
-28277,
-28390,
-28466,
-28562,
-28724,
-28875,
-28939,
-28969,
-29172,
-29831,
-30986,
-32479,
-34022,
-35516,
-37035,
-38663,
-40268,
-41534,
-42251,
-42506,
-42561,
-42509,
-42161,
-41253,
-39830,
-38248,
-36864,
-35715,
-34594,
-33399,
-32287,
-31540,
-31207,
-31120,
-31004,
-30796,
-30525,
-30281,
-30064,
-29855,
-29617,
-29303,
-28872,
-28338,
-27788,
-27381,
-27156,
-27141,
-27270,
-27514,
-27857,
-28233,
-28587,
-28829,
-28915,
-28849,
-28667,
-28423,
-28159,
-27935,
-27885,
-28176,
-28823,
-29639,
-30364,
-30994,
-31814,
-33063,
-34506,
-35646,
-36244,
-36748,
-37828,
-39609,
-41467,
-42683,
-43181,
-43493,
-43966,
-44285,
-43890,
-42692,
-41256,
-40066,
-39101,
-37871,
-36243,
-34554,
-33265,
-32376,
-31505,
-30409,
-29294,
-28619,
-28563,
-28908,
-29269,
-29423,
-29390,
-29262,
-29084,
-28838,
-28538,
-28194,
-27832,
-27454,
-27116,
-26907,
-26874,
-26981,
-27097,
-27192,
-27300,
-27520,
-27777,
-27929,
-27844,
-27609,
-27416,
-27389,
-27486,
-27617,
-27794,
-28044,
-28342,
-28574,
-28765,
-29233,
-30323,
-32178,
-34538,
-37153,
-39947,
-43047,
-46297,
-49155,
-51018,
-51742,
-51781,
-51666,
-51460,
-50714,
-49009,
-46502,
-43776,
-41293,
-38934,
-36272,
-33235,
-30334,
-28281,
-27239,
-26732,
-26104,
-25194,
-24322,
-23820,
-23623,
-23376,
-22821,
-22063,
-21340,
-20875,
-20665,
-20680,
-20768,
-20883,
-20989,
-21293,
-21947,
-22961,
-24043,
-24946,
-25733,
-26723,
-28145,
-29807,
-31321,
-32481,
-33470,
-34576,
-35892,
-37206,
-38331,
-39325,
-40452,
-41915,
-43640,
-45331,
-46722,
-47744,
-48490,
-48999,
-49142,
-48748,
-47856,
-46746,
-45695,
-44621,
-43141,
-40958,
-38198,
-35373,
-32896,
-30832,
-28989,
-27277,
-25817,
-24791,
-24168,
-23739,
-23262,
-22678,
-22062,
-21619,
-21497,
-21764,
-22297,
-22845,
-23237,
-23509,
-23890,
-24546,
-25400,
-26240,
-26944,
-27624,
-28496,
-29583,
-30671,
-31474,
-31908,
-32180,
-32545,
-33075,
-33578,
-33914,
-34141,
-34554,
-35289,
-36184,
-36900,
-37358,
-37824,
-38699,
-40026,
-41486,
-42632,
-43351,
-43789,
-44165,
-44468,
-44525,
-44145,
-43246,
-41880,
-40218,
-38499,
-36883,
-35309,
-33547,
-31469,
-29282,
-27371,
-25973,
-24965,
-24101,
-23331,
-22845,
-22744,
-22938,
-23187,
-23518,
-24082,
-24967,
-25969,
-26828,
-27499,
-28201,
-29075,
-30112,
-31151,
-32198,
-33245,
-34219,
-34894,
-35218,
-35351,
-35499,
-35605,
-35470,
-35051,
-34654,
-34561,
-34681,
-34647,
-34241,
-33727,
-33493,
-33636,
-33798,
-33660,
-33238,
-32930,
-32989,
-33371,
-33741,
-33925,
-33977,
-34203,
-34803,
-35767,
-36776,
-37497,
-37728,
-37632,
-37459,
-37379,
-37244,
-36816,
-35973,
-34854,
-33694,
-32638,
-31650,
-30621,
-29495,
-28360,
-27381,
-26729,
-26406,
-26280,
-26155,
-25987,
-25869,
-25910,
-26038,
-26093,
-26052,
-26166,
-26735,
-27804,
-29075,
-30240,
-31274,
-32431,
-33869,
-35481,
-36952,
-38138,
-39077,
-39879,
-40514,
-40879,
-40936,
-40699,
-40189,
-39372,
-38345,
-37336,
-36546,
-35927,
-35246,
-34352,
-33437,
-32815,
-32626,
-32709,
-32743,
-32625,
-32442,
-32410,
-32557,
-32767,
-32781,
-32462,
-31892,
-31335,
-31026,
-30928,
-30764,
-30294,
-29549,
-28807,
-28301,
-28041,
-27855,
-27621,
-27333,
-27099,
-27017,
-27135,
-27382,
-27590,
-27618,
-27485,
-27361,
-27354,
-27368,
-27269,
-27143,
-27289,
-27875,
-28694,
-29356,
-29805,
-30374,
-31468,
-33078,
-34886,
-36713,
-38734,
-41225,
-44077,
-46831,
-49008,
-50511,
-51530,
-52132,
-52187,
-51399,
-49741,
-47415,
-44723,
-41852,
-38825,
-35721,
-32705,
-30017,
-27803,
-26060,
-24755,
-23852,
-23293,
-22972,
-22703,
-22457,
-22226,
-22036,
-21778,
-21357,
-20826,
-20363,
-20056,
-19866,
-19721,
-19742,
-20148,
-21033,
-22268,
-23678,
-25228,
-26994,
-28958,
-30968,
-32874,
-34625,
-36207,
-37514,
-38447,
-39053,
-39534,
-40082,
-40715,
-41396,
-42133,
-42991,
-43967,
-44920,
-45748,
-46382,
-46879,
-47171,
-47245,
-47062,
-46618,
-45854,
-44623,
-42898,
-40787,
-38514,
-36224,
-33977,
-31814,
-29789,
-27968,
-26345,
-24962,
-23812,
-22881,
-22025,
-21186,
-20452,
-20048,
-20001,
-20139,
-20222,
-20301,
-20590,
-21219,
-22009,
-22751,
-23459,
-24375,
-25623,
-27044,
-28372,
-29494,
-30521,
-31510,
-32426,
-33142,
-33713,
-34249,
-34865,
-35489,
-36025,
-36425,
-36839,
-37437,
-38351,
-39420,
-40381,
-41038,
-41543,
-42271,
-43372,
-44549,
-45262,
-45324,
-45090,
-45042,
-45160,
-44891,
-43733,
-41799,
-39692,
-37875,
-36292,
-34577,
-32591,
-30582,
-28894,
-27647,
-26636,
-25613,
-24488,
-23434,
-22695,
-22437,
-22533,
-22653,
-22565,
-22354,
-22389,
-22896,
-23661,
-24286,
-24608,
-24949,
-25736,
-26972,
-28252,
-29120,
-29608,
-30048,
-30703,
-31458,
-31976,
-32080,
-31949,
-31939,
-32374,
-33260,
-34321,
-35203,
-35760,
-36230,
-37010,
-38229,
-39587,
-40631,
-41302,
-41974,
-43059,
-44457,
-45625,
-46086,
-45846,
-45207,
-44394,
-43306,
-41831,
-40009,
-38087,
-36203,
-34389,
-32597,
-30842,
-29104,
-27344,
-25600,
-24123,
-23193,
-22843,
-22768,
-22640,
-22454,
-22484,
-22900,
-23523,
-24054,
-24435,
-24969,
-25955,
-27364,
-28842,
-30016,
-30809,
-31361,
-31906,
-32496,
-33104,
-33611,
-34024,
-34373,
-34737,
-35077,
-35291,
-35313,
-35170,
-35009,
-34878,
-34799,
-34754,
-34819,
-35090,
-35530,
-36023,
-36474,
-36911,
-37404,
-37895,
-38258,
-38428,
-38540,
-38700,
-38900,
-38891,
-38526,
-37804,
-36858,
-35750,
-34422,
-32880,
-31272,
-29803,
-28563,
-27488,
-26547,
-25860,
-25580,
-25665,
-25849,
-25900,
-25828,
-25912,
-26301,
-26895,
-27396,
-27672,
-27845,
-28212,
-28888,
-29815,
-30762,
-31561,
-32169,
-32712,
-33392,
-34353,
-35483,
-36504,
-37201,
-37659,
-38151,
-38793,
-39346,
-39485,
-39121,
-38539,
-38061,
-37751,
-37437,
-36971,
-36373,
-35778,
-35261,
-34839,
-34482,
-34143,
-33738,
-33237,
-32732,
-32386,
-32207,
-32027,
-31611,
-30929,
-30195,
-29586,
-29213,
-28944,
-28750,
-28575,
-28438,
-28367,
-28367,
-28488,
-28615,
-28641,
-28518,
-28443,
-28624,
-29067,
-29467,
-29532,
-29283,
-28986,
-28865,
-28820,
-28619,
-28211,
-27847,
-27881,
-28386,
-29188,
-29988,
-30737,
-31577,
-32717,
-34136,
-35624,
-36961,
-38178,
-39528,
-41277,
-43334,
-45347,
-46865,
-47711,
-47983,
-47840,
-47311,
-46289,
-44707,
-42659,
-40348,
-37970,
-35617,
-33329,
-31145,
-29134,
-27422,
-26079,
-25167,
-24656,
-24503,
-24625,
-24888,
-25101,
-25099,
-24859,
-24535,
-24339,
-24313,
-24342,
-24268,
-24114,
-24054,
-24256,
-24692,
-25261,
-25863,
-26526,
-27286,
-28161,
-29106,
-30094,
-31061,
-31924,
-32614,
-33174,
-33668,
-34137,
-34511,
-34785,
-35101,
-35701,
-36627,
-37712,
-38746,
-39791,
-41112,
-42848,
-44751,
-46371,
-47467,
-48193,
-48811,
-49307,
-49316,
-48464,
-46740,
-44515,
-42179,
-39832,
-37303,
-34424,
-31323,
-28373,
-25914,
-24021,
-22506,
-21165,
-20034,
-19312,
-19168,
-19461,
-19857,
-20097,
-20213,
-20451,
-20994,
-21778,
-22597,
-23325,
-24035,
-24890,
-25951,
-27098,
-28102,
-28867,
-29491,
-30269,
-31357,
-32663,
-33820,
-34637,
-35225,
-35948,
-36922,
-37915,
-38607,
-39029,
-39561,
-40439,
-41487,
-42288,
-42710,
-42990,
-43371,
-43784,
-44011,
-44021,
-44008,
-44031,
-43843,
-43128,
-41866,
-40263,
-38441,
-36337,
-33990,
-31743,
-29962,
-28621,
-27333,
-25878,
-24529,
-23732,
-23556,
-23552,
-23330,
-22972,
-22945,
-23511,
-24430,
-25198,
-25547,
-25630,
-25780,
-26202,
-26810,
-27413,
-27890,
-28320,
-28883,
-29660,
-30577,
-31395,
-31965,
-32321,
-32635,
-33060,
-33584,
-34045,
-34324,
-34409,
-34498,
-34738,
-35168,
-35616,
-35935,
-36169,
-36575,
-37389,
-38615,
-39993,
-41301,
-42409,
-43372,
-44108,
-44443,
-44158,
-43240,
-41883,
-40391,
-38902,
-37361,
-35579,
-33492,
-31287,
-29262,
-27603,
-26258,
-25080,
-24148,
-23684,
-23876,
-24515,
-25204,
-25660,
-25956,
-26329,
-26831,
-27314,
-27646,
-27967,
-28517,
-29383,
-30346,
-31111,
-31570,
-31818,
-32009,
-32219,
-32479,
-32850,
-33358,
-33931,
-34413,
-34693,
-34799,
-34785,
-34617,
-34235,
-33637,
-33006,
-32532,
-32294,
-32262,
-32392,
-32720,
-33236,
-33866,
-34539,
-35264,
-36097,
-37000,
-37833,
-38582,
-39314,
-40070,
-40568,
-40435,
-39582,
-38368,
-37216,
-36094,
-34660,
-32704,
-30656,
-29081,
-28203,
-27619,
-26911,
-26071,
-25451,
-25251,
-25314,
-25418,
-25549,
-25897,
-26418,
-26912,
-27222,
-27529,
-28142,
-29096,
-30097,
-30869,
-31489,
-32373,
-33755,
-35461,
-36972,
-37931,
-38406,
-38765,
-39261,
-39752,
-39846,
-39342,
-38414,
-37540,
-36954,
-36532,
-35931,
-34997,
-33945,
-33124,
-32691,
-32531,
-32385,
-32150,
-31898,
-31845,
-32107,
-32619,
-33100,
-33256,
-33012,
-32646,
-32500,
-32717,
-32983,
-32917,
-32387,
-31700,
-31188,
-30897,
-30530,
-29875,
-29061,
-28447,
-28208,
-28168,
-28049,
-27770,
-27540,
-27548,
-27706,
-27779,
-27598,
-27225,
-26854,
-26624,
-26619,
-26888,
-27426,
-28090,
-28695,
-29203,
-29830,
-30815,
-32132,
-33513,
-34758,
-36038,
-37683,
-39776,
-42028,
-44077,
-45852,
-47519,
-49105,
-50292,
-50650,
-50072,
-48787,
-47141,
-45192,
-42825,
-39987,
-36940,
-34082,
-31707,
-29764,
-28065,
-26445,
-25039,
-24035,
-23588,
-23504,
-23526,
-23396,
-23158,
-22931,
-22800,
-22673,
-22380,
-21863,
-21282,
-20930,
-21025,
-21517,
-22138,
-22659,
-23152,
-23927,
-25178,
-26751,
-28266,
-29561,
-30845,
-32398,
-34187,
-35845,
-37051,
-37880,
-38656,
-39654,
-40885,
-42260,
-43674,
-45035,
-46182,
-46995,
-47518,
-47871,
-48068,
-47931,
-47344,
-46406,
-45395,
-44365,
-43088,
-41253,
-38881,
-36324,
-33992,
-31945,
-30020,
-28052,
-26204,
-24748,
-23822,
-23174,
-22478,
-21640,
-20950,
-20737,
-20974,
-21257,
-21236,
-21014,
-21020,
-21533,
-22405,
-23239,
-23919,
-24676,
-25821,
-27362,
-28987,
-30382,
-31505,
-32522,
-33617,
-34769,
-35806,
-36542,
-36975,
-37266,
-37609,
-37997,
-38220,
-38116,
-37814,
-37619,
-37725,
-37883,
-37776,
-37310,
-36880,
-36891,
-37370,
-37913,
-38164,
-38137,
-38164,
-38387,
-38634,
-38595,
-38263,
-37931,
-37847,
-37898,
-37718,
-37132,
-36345,
-35729,
-35335,
-34819,
-33852,
-32473,
-31099,
-30026,
-29116,
-28047,
-26697,
-25342,
-24338,
-23787,
-23498,
-23275,
-23069,
-22952,
-22989,
-23192,
-23605,
-24219,
-24931,
-25574,
-26070,
-26488,
-26946,
-27396,
-27787,
-28131,
-28679,
-29597,
-30852,
-32188,
-33455,
-34710,
-36075,
-37526,
-38916,
-40175,
-41467,
-42952,
-44552,
-45909,
-46708,
-46916,
-46764,
-46399,
-45762,
-44671,
-43172,
-41534,
-40043,
-38727,
-37354,
-35738,
-33916,
-32150,
-30620,
-29336,
-28214,
-27224,
-26483,
-26045,
-25835,
-25656,
-25387,
-25126,
-25037,
-25252,
-25660,
-26095,
-26427,
-26699,
-26952,
-27190,
-27335,
-27369,
-27418,
-27614,
-28001,
-28480,
-28927,
-29288,
-29619,
-29945,
-30275,
-30556,
-30766,
-30938,
-31184,
-31637,
-32345,
-33162,
-33824,
-34222,
-34533,
-35154,
-36269,
-37677,
-38987,
-40016,
-40947,
-42053,
-43355,
-44547,
-45293,
-45415,
-45004,
-44204,
-43175,
-42017,
-40682,
-39024,
-36907,
-34478,
-32107,
-30132,
-28500,
-26898,
-25188,
-23599,
-22592,
-22267,
-22371,
-22505,
-22650,
-23029,
-23809,
-24819,
-25711,
-26386,
-27071,
-28090,
-29500,
-31014,
-32276,
-33153,
-33796,
-34404,
-35025,
-35484,
-35595,
-35369,
-34991,
-34718,
-34594,
-34491,
-34213,
-33720,
-33176,
-32750,
-32496,
-32312,
-32110,
-31986,
-32061,
-32348,
-32654,
-32850,
-33111,
-33777,
-34966,
-36250,
-37080,
-37266,
-37320,
-37806,
-38760,
-39540,
-39551,
-38840,
-38030,
-37551,
-37175,
-36301,
-34629,
-32534,
-30686,
-29452,
-28697,
-28021,
-27236,
-26477,
-25983,
-25843,
-25862,
-25797,
-25598,
-25486,
-25757,
-26448,
-27335,
-28082,
-28646,
-29204,
-29995,
-30992,
-32000,
-32852,
-33610,
-34469,
-35564,
-36809,
-37950,
-38725,
-38997,
-38856,
-38527,
-38165,
-37799,
-37284,
-36589,
-35816,
-35152,
-34593,
-34011,
-33289,
-32550,
-32038,
-31896,
-32094,
-32512,
-33130,
-33917,
-34787,
-35595,
-36244,
-36720,
-36900,
-36601,
-35731,
-34543,
-33428,
-32527,
-31604,
-30353,
-28844,
-27474,
-26549,
-25996,
-25560,
-25177,
-25001,
-25150,
-25529,
-25979,
-26432,
-26872,
-27171,
-27158,
-26898,
-26636,
-26619,
-26757,
-26836,
-26869,
-27160,
-28032,
-29476,
-31185,
-32826,
-34295,
-35753,
-37617,
-40322,
-44003,
-48163,
-51871,
-54401,
-55693,
-56160,
-55915,
-54584,
-51769,
-47801,
-43615,
-40007,
-36950,
-33964,
-30741,
-27576,
-24910,
-22936,
-21554,
-20693,
-20461,
-20868,
-21649,
-22373,
-22730,
-22733,
-22479,
-22052,
-21456,
-20770,
-20205,
-19957,
-20151,
-20705,
-21527,
-22529,
-23774,
-25373,
-27386,
-29655,
-31898,
-33842,
-35481,
-36987,
-38488,
-39885,
-40908,
-41404,
-41467,
-41356,
-41270,
-41229,
-41203,
-41170,
-41179,
-41279,
-41460,
-41694,
-41904,
-42017,
-41979,
-41786,
-41439,
-40884,
-40045,
-38939,
-37733,
-36587,
-35474,
-34240,
-32800,
-31316,
-29999,
-28870,
-27796,
-26710,
-25782,
-25138,
-24690,
-24134,
-23411,
-22780,
-22543,
-22734,
-23025,
-23257,
-23523,
-24134,
-25154,
-26390,
-27538,
-28492,
-29325,
-30154,
-30987,
-31704,
-32195,
-32440,
-32497,
-32511,
-32508,
-32535,
-32621,
-32840,
-33266,
-33887,
-34730,
-35757,
-36916,
-37956,
-38727,
-39352,
-40224,
-41483,
-42731,
-43330,
-43151,
-42777,
-42786,
-42989,
-42592,
-41111,
-39018,
-37162,
-35854,
-34628,
-33000,
-31077,
-29399,
-28226,
-27324,
-26378,
-25394,
-24662,
-24312,
-24287,
-24446,
-24808,
-25379,
-26102,
-26826,
-27524,
-28255,
-29128,
-30130,
-31172,
-32085,
-32747,
-33146,
-33407,
-33664,
-33891,
-33929,
-33693,
-33305,
-33039,
-33041,
-33220,
-33438,
-33546,
-33566,
-33518,
-33515,
-33651,
-33924,
-34185,
-34273,
-34252,
-34336,
-34587,
-34781,
-34631,
-34224,
-33912,
-33938,
-34059,
-33897,
-33409,
-32993,
-33026,
-33441,
-33803,
-33758,
-33379,
-32945,
-32767,
-32879,
-33149,
-33297,
-33119,
-32661,
-32253,
-32262,
-32727,
-33235,
-33329,
-32934,
-32456,
-32373,
-32716,
-33063,
-32911,
-32204,
-31343,
-30816,
-30736,
-30828,
-30740,
-30457,
-30243,
-30309,
-30575,
-30738,
-30643,
-30446,
-30412,
-30739,
-31314,
-31989,
-32592,
-33127,
-33574,
-33962,
-34207,
-34295,
-34225,
-34117,
-34091,
-34168,
-34267,
-34316,
-34334,
-34407,
-34501,
-34516,
-34395,
-34327,
-34499,
-34943,
-35395,
-35641,
-35651,
-35552,
-35351,
-34954,
-34354,
-33715,
-33183,
-32651,
-31933,
-31035,
-30243,
-29757,
-29435,
-29002,
-28433,
-28005,
-27911,
-27986,
-27946,
-27798,
-27807,
-28008,
-28026,
-27454,
-26439,
-25598,
-25374,
-25553,
-25629,
-25430,
-25324,
-25820,
-27096,
-29153,
-32016,
-35751,
-40075,
-44360,
-48043,
-51008,
-53359,
-54913,
-55126,
-53754,
-51226,
-48441,
-45783,
-42988,
-39595,
-35758,
-32167,
-29380,
-27389,
-25924,
-24947,
-24689,
-25141,
-25837,
-26206,
-26091,
-25774,
-25479,
-25092,
-24279,
-22982,
-21511,
-20287,
-19539,
-19216,
-19203,
-19516,
-20317,
-21769,
-23852,
-26262,
-28628,
-30711,
-32607,
-34422,
-36098,
-37327,
-37955,
-38185,
-38409,
-38803,
-39211,
-39387,
-39390,
-39440,
-39737,
-40250,
-40883,
-41640,
-42516,
-43445,
-44300,
-44967,
-45408,
-45406,
-44748,
-43351,
-41542,
-39734,
-38126,
-36508,
-34631,
-32507,
-30423,
-28636,
-27179,
-25987,
-25023,
-24323,
-23824,
-23413,
-22970,
-22610,
-22454,
-22613,
-22948,
-23217,
-23283,
-23215,
-23327,
-23839,
-24727,
-25676,
-26450,
-27087,
-27909,
-29121,
-30586,
-31959,
-32962,
-33656,
-34220,
-34822,
-35440,
-36012,
-36509,
-36959,
-37423,
-37903,
-38361,
-38727,
-38970,
-39171,
-39478,
-39989,
-40665,
-41345,
-41887,
-42257,
-42455,
-42484,
-42266,
-41697,
-40705,
-39302,
-37653,
-35985,
-34444,
-32939,
-31243,
-29264,
-27214,
-25477,
-24213,
-23299,
-22498,
-21807,
-21493,
-21756,
-22526,
-23493,
-24432,
-25349,
-26438,
-27762,
-29229,
-30580,
-31661,
-32453,
-33066,
-33617,
-34111,
-34526,
-34817,
-35041,
-35259,
-35482,
-35650,
-35669,
-35525,
-35266,
-34987,
-34744,
-34573,
-34485,
-34525,
-34705,
-35000,
-35309,
-35510,
-35580,
-35579,
-35643,
-35758,
-35809,
-35601,
-35094,
-34443,
-33848,
-33441,
-33145,
-32852,
-32459,
-32017,
-31562,
-31134,
-30666,
-30110,
-29495,
-28979,
-28739,
-28836,
-29162,
-29557,
-29962,
-30394,
-30902,
-31412,
-31876,
-32312,
-32760,
-33209,
-33536,
-33700,
-33746,
-33767,
-33676,
-33392,
-32951,
-32677,
-32763,
-33119,
-33352,
-33248,
-32964,
-32801,
-32834,
-32809,
-32505,
-32002,
-31653,
-31698,
-32111,
-32648,
-33093,
-33366,
-33501,
-33588,
-33754,
-34088,
-34567,
-35075,
-35462,
-35674,
-35774,
-35826,
-35798,
-35591,
-35091,
-34380,
-33672,
-33155,
-32823,
-32461,
-31963,
-31451,
-31205,
-31302,
-31495,
-31484,
-31248,
-31068,
-31170,
-31443,
-31551,
-31286,
-30764,
-30212,
-29760,
-29319,
-28777,
-28074,
-27256,
-26430,
-25745,
-25374,
-25381,
-25684,
-26094,
-26447,
-26727,
-27039,
-27512,
-28120,
-28692,
-29139,
-29800,
-31469,
-34744,
-39375,
-44117,
-47736,
-49934,
-51405,
-52802,
-53872,
-53875,
-52516,
-50403,
-48277,
-46155,
-43468,
-39948,
-36058,
-32549,
-29678,
-27298,
-25378,
-24253,
-24111,
-24542,
-24790,
-24469,
-23825,
-23244,
-22773,
-22091,
-21072,
-19929,
-19054,
-18582,
-18425,
-18443,
-18643,
-19140,
-20067,
-21518,
-23473,
-25759,
-28129,
-30426,
-32675,
-34898,
-36900,
-38359,
-39102,
-39392,
-39704,
-40357,
-41263,
-42127,
-42769,
-43301,
-43950,
-44794,
-45652,
-46223,
-46328,
-46066,
-45683,
-45323,
-44848,
-43957,
-42444,
-40418,
-38149,
-35872,
-33638,
-31448,
-29384,
-27602,
-26238,
-25313,
-24830,
-24739,
-24917,
-25105,
-25062,
-24784,
-24534,
-24563,
-24843,
-25036,
-24888,
-24469,
-24128,
-24116,
-24377,
-24691,
-25014,
-25526,
-26450,
-27744,
-29135,
-30372,
-31435,
-32462,
-33529,
-34486,
-35147,
-35463,
-35637,
-35948,
-36482,
-37119,
-37625,
-37930,
-38126,
-38332,
-38572,
-38765,
-38879,
-38964,
-39064,
-39205,
-39401,
-39750,
-40248,
-40687,
-40634,
-39922,
-38781,
-37714,
-36871,
-35890,
-34330,
-32253,
-30248,
-28816,
-27842,
-26819,
-25481,
-24149,
-23376,
-23393,
-23971,
-24731,
-25547,
-26494,
-27724,
-29215,
-30827,
-32279,
-33353,
-33966,
-34332,
-34685,
-35070,
-35192,
-34816,
-34052,
-33364,
-33064,
-33009,
-32809,
-32287,
-31725,
-31480,
-31600,
-31752,
-31628,
-31228,
-30817,
-30568,
-30428,
-30235,
-29930,
-29630,
-29443,
-29428,
-29598,
-30091,
-31074,
-32657,
-34698,
-36885,
-38869,
-40431,
-41533,
-42254,
-42683,
-42770,
-42331,
-41238,
-39617,
-37907,
-36455,
-35241,
-33869,
-32111,
-30229,
-28825,
-28188,
-28067,
-27939,
-27650,
-27414,
-27499,
-27767,
-27912,
-27794,
-27643,
-27741,
-28178,
-28789,
-29392,
-29895,
-30324,
-30777,
-31393,
-32213,
-33075,
-33702,
-33975,
-34080,
-34276,
-34549,
-34586,
-34173,
-33469,
-32882,
-32633,
-32571,
-32436,
-32163,
-31949,
-31989,
-32309,
-32777,
-33247,
-33680,
-34166,
-34866,
-35863,
-37050,
-38146,
-38940,
-39432,
-39733,
-39858,
-39659,
-39017,
-38019,
-36881,
-35695,
-34420,
-32976,
-31453,
-30013,
-28789,
-27794,
-27013,
-26392,
-25858,
-25410,
-25102,
-25096,
-25278,
-25379,
-25104,
-24578,
-24242,
-24431,
-24967,
-25364,
-25319,
-25100,
-25242,
-26071,
-27378,
-28704,
-29792,
-30970,
-32914,
-36145,
-40447,
-44899,
-48528,
-50904,
-52340,
-53238,
-53576,
-52940,
-51126,
-48498,
-45728,
-43204,
-40794,
-38212,
-35447,
-32806,
-30612,
-28938,
-27637,
-26658,
-26027,
-25822,
-25892,
-25871,
-25438,
-24528,
-23428,
-22487,
-21815,
-21256,
-20625,
-20022,
-19705,
-19914,
-20607,
-21705,
-23172,
-25024,
-27081,
-28980,
-30462,
-31613,
-32731,
-33924,
-34961,
-35520,
-35599,
-35526,
-35618,
-35820,
-35838,
-35504,
-35057,
-34954,
-35436,
-36416,
-37628,
-39024,
-40692,
-42630,
-44501,
-45856,
-46563,
-46881,
-47142,
-47346,
-47180,
-46386,
-45042,
-43327,
-41296,
-38839,
-35983,
-33066,
-30465,
-28338,
-26565,
-25021,
-23714,
-22712,
-21957,
-21366,
-20903,
-20627,
-20519,
-20440,
-20314,
-20230,
-20360,
-20711,
-21122,
-21453,
-21812,
-22435,
-23421,
-24658,
-25897,
-27056,
-28196,
-29523,
-31148,
-33077,
-35126,
-37083,
-38779,
-40227,
-41472,
-42511,
-43253,
-43660,
-43868,
-44048,
-44237,
-44310,
-44144,
-43806,
-43458,
-43140,
-42745,
-42115,
-41252,
-40316,
-39428,
-38612,
-37728,
-36613,
-35146,
-33405,
-31577,
-29906,
-28449,
-27113,
-25786,
-24549,
-23561,
-22926,
-22520,
-22232,
-22086,
-22247,
-22836,
-23758,
-24846,
-25923,
-26907,
-27721,
-28377,
-28952,
-29582,
-30284,
-30980,
-31598,
-32169,
-32772,
-33366,
-33789,
-33998,
-34102,
-34309,
-34697,
-35168,
-35648,
-36103,
-36594,
-37085,
-37540,
-37891,
-38111,
-38152,
-38007,
-37778,
-37632,
-37668,
-37809,
-37871,
-37752,
-37428,
-36943,
-36288,
-35505,
-34676,
-33915,
-33204,
-32477,
-31671,
-30832,
-30062,
-29415,
-28898,
-28493,
-28129,
-27767,
-27392,
-27154,
-27229,
-27595,
-27996,
-28098,
-27873,
-27599,
-27630,
-28019,
-28561,
-29035,
-29478,
-30101,
-31061,
-32270,
-33495,
-34542,
-35386,
-36141,
-36876,
-37571,
-38097,
-38363,
-38376,
-38237,
-38061,
-37827,
-37456,
-36818,
-35937,
-35013,
-34277,
-33851,
-33598,
-33304,
-32886,
-32529,
-32440,
-32681,
-33040,
-33326,
-33550,
-33866,
-34326,
-34772,
-34925,
-34692,
-34168,
-33525,
-32829,
-32042,
-31118,
-30131,
-29202,
-28454,
-27904,
-27491,
-27146,
-26855,
-26671,
-26649,
-26766,
-26959,
-27118,
-27152,
-27033,
-26822,
-26712,
-26898,
-27402,
-28034,
-28580,
-29023,
-29586,
-30421,
-31466,
-32529,
-33626,
-34991,
-36836,
-39018,
-41102,
-42737,
-43824,
-44537,
-44959,
-45113,
-44977,
-44649,
-44292,
-43949,
-43496,
-42695,
-41394,
-39654,
-37722,
-35854,
-34166,
-32656,
-31327,
-30248,
-29445,
-28774,
-28016,
-27080,
-26118,
-25363,
-24891,
-24606,
-24392,
-24194,
-23973,
-23626,
-23141,
-22660,
-22446,
-22553,
-22813,
-23024,
-23231,
-23656,
-24414,
-25411,
-26452,
-27506,
-28625,
-29815,
-30958,
-32028,
-33084,
-34229,
-35422,
-36578,
-37757,
-39152,
-40846,
-42619,
-44100,
-45102,
-45792,
-46427,
-47108,
-47621,
-47754,
-47443,
-46814,
-45961,
-44821,
-43258,
-41280,
-39123,
-37116,
-35412,
-33875,
-32285,
-30602,
-29053,
-27867,
-27027,
-26245,
-25320,
-24319,
-23509,
-23020,
-22749,
-22499,
-22248,
-22084,
-22031,
-21974,
-21808,
-21630,
-21652,
-21969,
-22450,
-22917,
-23360,
-23925,
-24750,
-25817,
-27047,
-28400,
-29884,
-31419,
-32885,
-34174,
-35349,
-36493,
-37691,
-38959,
-40346,
-41861,
-43388,
-44651,
-45453,
-45827,
-46000,
-46134,
-46169,
-46006,
-45639,
-45195,
-44695,
-44027,
-43018,
-41673,
-40043,
-38254,
-36375,
-34580,
-33011,
-31654,
-30275,
-28733,
-27134,
-25821,
-24875,
-24095,
-23208,
-22312,
-21814,
-21926,
-22456,
-22953,
-23209,
-23368,
-23650,
-24075,
-24554,
-25061,
-25726,
-26601,
-27554,
-28390,
-29037,
-29589,
-30137,
-30653,
-31074,
-31401,
-31730,
-32157,
-32698,
-33332,
-34041,
-34797,
-35529,
-36138,
-36585,
-36981,
-37494,
-38288,
-39308,
-40402,
-41363,
-42113,
-42689,
-43132,
-43375,
-43266,
-42723,
-41877,
-40999,
-40282,
-39617,
-38698,
-37282,
-35491,
-33705,
-32260,
-31161,
-30202,
-29220,
-28374,
-27833,
-27641,
-27487,
-27107,
-26493,
-25938,
-25702,
-25776,
-25929,
-25941,
-25796,
-25629,
-25565,
-25682,
-25922,
-26242,
-26577,
-26960,
-27526,
-28373,
-29465,
-30563,
-31420,
-32013,
-32526,
-33153,
-33851,
-34371,
-34557,
-34519,
-34580,
-34961,
-35566,
-36130,
-36455,
-36684,
-37100,
-37867,
-38773,
-39459,
-39723,
-39756,
-39854,
-40116,
-40263,
-40013,
-39319,
-38432,
-37544,
-36596,
-35445,
-34079,
-32727,
-31573,
-30647,
-29829,
-29080,
-28421,
-27900,
-27509,
-27287,
-27283,
-27485,
-27737,
-27876,
-27958,
-28151,
-28524,
-28851,
-28914,
-28748,
-28710,
-29047,
-29645,
-30193,
-30528,
-30864,
-31481,
-32422,
-33403,
-34062,
-34286,
-34290,
-34399,
-34761,
-35189,
-35316,
-35008,
-34499,
-34216,
-34298,
-34462,
-34364,
-34043,
-33944,
-34382,
-35171,
-35765,
-35909,
-35844,
-36045,
-36638,
-37240,
-37408,
-37049,
-36480,
-36059,
-35775,
-35303,
-34369,
-33009,
-31628,
-30583,
-29998,
-29677,
-29389,
-29012,
-28612,
-28247,
-27981,
-27768,
-27550,
-27214,
-26699,
-26076,
-25565,
-25325,
-25330,
-25372,
-25360,
-25391,
-25659,
-26163,
-26770,
-27421,
-28342,
-29845,
-32042,
-34716,
-37503,
-40136,
-42510,
-44533,
-46097,
-47093,
-47502,
-47403,
-46879,
-46003,
-44840,
-43478,
-41994,
-40417,
-38723,
-36919,
-35144,
-33646,
-32619,
-32014,
-31586,
-31066,
-30470,
-29888,
-29380,
-28728,
-27734,
-26439,
-25148,
-24138,
-23425,
-22858,
-22301,
-21810,
-21435,
-21246,
-21246,
-21492,
-21949,
-22512,
-23098,
-23812,
-24908,
-26444,
-28159,
-29636,
-30721,
-31648,
-32724,
-34026,
-35326,
-36429,
-37343,
-38276,
-39351,
-40557,
-41759,
-42848,
-43742,
-44403,
-44835,
-45055,
-45063,
-44806,
-44218,
-43399,
-42556,
-41884,
-41335,
-40647,
-39632,
-38387,
-37222,
-36307,
-35494,
-34474,
-33188,
-31853,
-30728,
-29732,
-28550,
-27000,
-25265,
-23740,
-22665,
-21969,
-21493,
-21153,
-21010,
-21137,
-21532,
-22118,
-22751,
-23288,
-23715,
-24179,
-24865,
-25705,
-26365,
-26603,
-26511,
-26577,
-27038,
-27805,
-28512,
-29085,
-29761,
-30830,
-32314,
-34056,
-35929,
-37935,
-40104,
-42406,
-44813,
-47216,
-49344,
-50744,
-51158,
-50783,
-50151,
-49555,
-48795,
-47420,
-45343,
-42956,
-40754,
-38848,
-36997,
-34966,
-32860,
-31008,
-29648,
-28768,
-28091,
-27377,
-26457,
-25438,
-24515,
-23870,
-23461,
-23062,
-22473,
-21721,
-21049,
-20691,
-20651,
-20737,
-20816,
-20942,
-21412,
-22365,
-23739,
-25185,
-26446,
-27490,
-28487,
-29551,
-30604,
-31503,
-32235,
-32954,
-33839,
-34873,
-35949,
-36977,
-38017,
-39178,
-40475,
-41817,
-43053,
-44110,
-44932,
-45529,
-45844,
-45875,
-45589,
-45078,
-44432,
-43745,
-42940,
-41867,
-40372,
-38530,
-36573,
-34720,
-33023,
-31366,
-29719,
-28205,
-27050,
-26288,
-25750,
-25138,
-24402,
-23724,
-23409,
-23544,
-23928,
-24260,
-24453,
-24675,
-25197,
-26054,
-27026,
-27795,
-28255,
-28557,
-28959,
-29603,
-30387,
-31111,
-31626,
-31988,
-32331,
-32746,
-33126,
-33320,
-33302,
-33296,
-33532,
-34056,
-34627,
-35024,
-35287,
-35652,
-36280,
-37031,
-37635,
-37981,
-38218,
-38539,
-38968,
-39312,
-39430,
-39289,
-38991,
-38589,
-38110,
-37533,
-36836,
-35938,
-34785,
-33467,
-32198,
-31167,
-30341,
-29535,
-28648,
-27837,
-27304,
-27142,
-27154,
-27161,
-27115,
-27097,
-27150,
-27246,
-27391,
-27705,
-28294,
-29086,
-29931,
-30719,
-31526,
-32455,
-33425,
-34286,
-34906,
-35375,
-35843,
-36328,
-36731,
-36864,
-36701,
-36295,
-35814,
-35325,
-34878,
-34421,
-33941,
-33526,
-33255,
-33155,
-33055,
-32789,
-32366,
-32012,
-31946,
-32122,
-32268,
-32179,
-31913,
-31750,
-31868,
-32240,
-32660,
-32993,
-33230,
-33443,
-33649,
-33798,
-33769,
-33529,
-33144,
-32767,
-32502,
-32306,
-32005,
-31504,
-30878,
-30342,
-30025,
-29817,
-29493,
-28960,
-28401,
-28118,
-28207,
-28434,
-28451,
-28190,
-27981,
-28234,
-28999,
-29885,
-30433,
-30622,
-30821,
-31435,
-32444,
-33555,
-34549,
-35555,
-36847,
-38477,
-40164,
-41460,
-42137,
-42252,
-42104,
-41918,
-41677,
-41151,
-40134,
-38739,
-37355,
-36309,
-35566,
-34735,
-33556,
-32199,
-31165,
-30808,
-31030,
-31394,
-31509,
-31313,
-30986,
-30732,
-30562,
-30254,
-29611,
-28597,
-27507,
-26663,
-26155,
-25751,
-25155,
-24363,
-23648,
-23288,
-23288,
-23487,
-23786,
-24226,
-24837,
-25481,
-26028,
-26455,
-26893,
-27401,
-27902,
-28326,
-28760,
-29405,
-30428,
-31926,
-33981,
-36704,
-40017,
-43543,
-46729,
-49207,
-50939,
-52130,
-52854,
-53039,
-52553,
-51440,
-49871,
-47986,
-45790,
-43210,
-40248,
-37103,
-34074,
-31482,
-29513,
-28233,
-27513,
-27201,
-27015,
-26778,
-26319,
-25618,
-24716,
-23734,
-22815,
-22049,
-21447,
-20898,
-20325,
-19824,
-19658,
-20024,
-20854,
-21811,
-22694,
-23625,
-24893,
-26545,
-28193,
-29403,
-30063,
-30535,
-31117,
-31847,
-32471,
-32896,
-33301,
-33890,
-34692,
-35565,
-36433,
-37412,
-38578,
-39920,
-41305,
-42721,
-44160,
-45532,
-46552,
-46973,
-46821,
-46363,
-45865,
-45322,
-44567,
-43379,
-41775,
-39856,
-37834,
-35898,
-34185,
-32740,
-31506,
-30443,
-29639,
-29205,
-29103,
-29023,
-28614,
-27833,
-26971,
-26364,
-26023,
-25632,
-24971,
-24107,
-23323,
-22761,
-22345,
-21992,
-21774,
-21845,
-22219,
-22791,
-23473,
-24285,
-25243,
-26183,
-26964,
-27587,
-28232,
-28985,
-29672,
-30094,
-30315,
-30727,
-31655,
-33058,
-34587,
-35998,
-37418,
-39218,
-41561,
-44187,
-46497,
-48096,
-49029,
-49734,
-50492,
-51106,
-51021,
-49961,
-48154,
-46180,
-44272,
-42216,
-39669,
-36756,
-33958,
-31728,
-30003,
-28502,
-27063,
-25838,
-25022,
-24525,
-24127,
-23688,
-23331,
-23248,
-23439,
-23719,
-23833,
-23726,
-23477,
-23288,
-23228,
-23279,
-23369,
-23527,
-23886,
-24538,
-25395,
-26246,
-26972,
-27637,
-28391,
-29244,
-30062,
-30773,
-31435,
-32218,
-33092,
-33920,
-34579,
-35145,
-35836,
-36809,
-38072,
-39521,
-41069,
-42607,
-44082,
-45422,
-46572,
-47446,
-47889,
-47813,
-47270,
-46444,
-45449,
-44161,
-42375,
-40013,
-37365,
-34808,
-32599,
-30647,
-28798,
-27004,
-25471,
-24359,
-23661,
-23146,
-22660,
-22227,
-22060,
-22250,
-22701,
-23194,
-23622,
-24080,
-24720,
-25571,
-26501,
-27342,
-28060,
-28744,
-29495,
-30325,
-31132,
-31824,
-32373,
-32882,
-33458,
-34170,
-34919,
-35526,
-35818,
-35806,
-35662,
-35598,
-35694,
-35809,
-35789,
-35644,
-35616,
-35972,
-36709,
-37507,
-38012,
-38139,
-38122,
-38211,
-38412,
-38520,
-38424,
-38204,
-38000,
-37734,
-37153,
-36094,
-34682,
-33237,
-31989,
-30891,
-29790,
-28587,
-27420,
-26535,
-26056,
-25911,
-25826,
-25678,
-25560,
-25718,
-26235,
-26871,
-27379,
-27744,
-28290,
-29206,
-30332,
-31262,
-31814,
-32168,
-32610,
-33186,
-33716,
-34087,
-34381,
-34782,
-35328,
-35945,
-36527,
-36983,
-37234,
-37226,
-37020,
-36766,
-36574,
-36372,
-36076,
-35624,
-35142,
-34704,
-34377,
-34135,
-33920,
-33643,
-33259,
-32921,
-32921,
-33392,
-34081,
-34547,
-34614,
-34563,
-34683,
-34839,
-34558,
-33654,
-32532,
-31753,
-31408,
-30996,
-30094,
-28817,
-27708,
-27116,
-26910,
-26754,
-26488,
-26250,
-26236,
-26490,
-26879,
-27190,
-27203,
-26852,
-26299,
-25891,
-25889,
-26231,
-26600,
-26809,
-27026,
-27652,
-28865,
-30436,
-31994,
-33527,
-35518,
-38496,
-42440,
-46632,
-50153,
-52537,
-53882,
-54453,
-54253,
-53051,
-50806,
-47840,
-44644,
-41458,
-38288,
-35115,
-32133,
-29596,
-27596,
-26069,
-24994,
-24492,
-24653,
-25260,
-25879,
-26105,
-25905,
-25481,
-25001,
-24413,
-23566,
-22467,
-21362,
-20472,
-19851,
-19405,
-19174,
-19431,
-20440,
-22135,
-24150,
-26135,
-28061,
-30067,
-32176,
-34122,
-35685,
-36899,
-37999,
-39120,
-40099,
-40733,
-40962,
-40968,
-40932,
-40973,
-41105,
-41327,
-41567,
-41729,
-41827,
-42009,
-42433,
-42927,
-43085,
-42567,
-41487,
-40244,
-39106,
-37903,
-36326,
-34389,
-32505,
-31113,
-30250,
-29564,
-28821,
-28105,
-27710,
-27668,
-27706,
-27518,
-27135,
-26839,
-26797,
-26869,
-26773,
-26421,
-25974,
-25649,
-25502,
-25538,
-25760,
-26222,
-26871,
-27583,
-28317,
-29112,
-29961,
-30653,
-30974,
-30917,
-30755,
-30657,
-30561,
-30358,
-30158,
-30287,
-30783,
-31289,
-31472,
-31472,
-31911,
-33175,
-34992,
-36761,
-38218,
-39687,
-41594,
-43812,
-45705,
-46646,
-46569,
-45900,
-45121,
-44352,
-43372,
-41904,
-39908,
-37683,
-35647,
-34029,
-32736,
-31480,
-30150,
-28926,
-28138,
-27888,
-27950,
-27966,
-27762,
-27475,
-27347,
-27478,
-27745,
-27910,
-27872,
-27727,
-27662,
-27756,
-27880,
-27817,
-27538,
-27253,
-27230,
-27532,
-27937,
-28232,
-28419,
-28681,
-29076,
-29425,
-29530,
-29447,
-29469,
-29770,
-30160,
-30302,
-30102,
-29869,
-30026,
-30707,
-31747,
-32986,
-34513,
-36525,
-39021,
-41622,
-43868,
-45491,
-46569,
-47298,
-47760,
-47850,
-47409,
-46408,
-45008,
-43387,
-41624,
-39602,
-37200,
-34543,
-31998,
-30006,
-28682,
-27820,
-27069,
-26317,
-25675,
-25297,
-25110,
-24937,
-24690,
-24550,
-24736,
-25292,
-25963,
-26459,
-26634,
-26598,
-26495,
-26402,
-26373,
-26488,
-26909,
-27677,
-28654,
-29605,
-30396,
-31026,
-31571,
-31994,
-32222,
-32257,
-32255,
-32458,
-32964,
-33712,
-34459,
-35057,
-35478,
-35944,
-36660,
-37713,
-38926,
-40046,
-41013,
-41949,
-42994,
-43960,
-44433,
-44122,
-43142,
-41920,
-40752,
-39595,
-38158,
-36365,
-34389,
-32603,
-31169,
-29986,
-28821,
-27561,
-26319,
-25380,
-24908,
-24833,
-24823,
-24605,
-24164,
-23833,
-23931,
-24511,
-25262,
-25854,
-26282,
-26880,
-27916,
-29283,
-30515,
-31321,
-31911,
-32773,
-34104,
-35525,
-36431,
-36643,
-36564,
-36691,
-37096,
-37399,
-37292,
-36867,
-36482,
-36355,
-36387,
-36387,
-36234,
-35986,
-35748,
-35699,
-35922,
-36337,
-36629,
-36524,
-36119,
-35800,
-35811,
-35913,
-35622,
-34782,
-33771,
-33067,
-32749,
-32391,
-31620,
-30421,
-29182,
-28243,
-27678,
-27279,
-26799,
-26155,
-25579,
-25400,
-25799,
-26468,
-26905,
-26790,
-26385,
-26162,
-26311,
-26500,
-26314,
-25710,
-25178,
-25161,
-25830,
-26965,
-28346,
-29839,
-31434,
-33131,
-35058,
-37430,
-40427,
-43952,
-47631,
-50991,
-53696,
-55555,
-56393,
-56052,
-54461,
-51847,
-48603,
-45130,
-41596,
-38027,
-34468,
-31087,
-28108,
-25631,
-23705,
-22347,
-21699,
-21763,
-22369,
-23131,
-23737,
-24043,
-24058,
-23799,
-23265,
-22568,
-21850,
-21230,
-20669,
-20130,
-19745,
-19795,
-20441,
-21636,
-23115,
-24762,
-26602,
-28736,
-31108,
-33520,
-35680,
-37404,
-38595,
-39350,
-39854,
-40296,
-40701,
-40946,
-40924,
-40760,
-40711,
-41000,
-41565,
-42191,
-42733,
-43238,
-43881,
-44652,
-45377,
-45714,
-45462,
-44625,
-43363,
-41822,
-40036,
-37953,
-35642,
-33250,
-30995,
-28939,
-27038,
-25293,
-23812,
-22729,
-22035,
-21557,
-21204,
-21047,
-21241,
-21771,
-22438,
-23059,
-23604,
-24179,
-24790,
-25388,
-25949,
-26550,
-27258,
-28024,
-28804,
-29641,
-30612,
-31576,
-32244,
-32469,
-32572,
-33034,
-34022,
-35162,
-35995,
-36456,
-36920,
-37600,
-38333,
-38713,
-38695,
-38636,
-38899,
-39547,
-40287,
-40917,
-41400,
-41793,
-42040,
-41978,
-41496,
-40618,
-39505,
-38294,
-37076,
-35796,
-34354,
-32695,
-30951,
-29329,
-28018,
-26983,
-26138,
-25466,
-25114,
-25240,
-25800,
-26549,
-27168,
-27526,
-27714,
-27965,
-28408,
-28985,
-29511,
-29900,
-30216,
-30613,
-31052,
-31396,
-31493,
-31467,
-31576,
-31991,
-32612,
-33183,
-33555,
-33774,
-33991,
-34230,
-34346,
-34144,
-33610,
-32960,
-32472,
-32202,
-31926,
-31392,
-30695,
-30228,
-30325,
-30828,
-31339,
-31632,
-32020,
-32941,
-34480,
-36222,
-37692,
-38716,
-39460,
-40045,
-40426,
-40469,
-40105,
-39392,
-38408,
-37292,
-36202,
-35266,
-34443,
-33661,
-32886,
-32249,
-31825,
-31540,
-31239,
-30854,
-30464,
-30125,
-29809,
-29448,
-29061,
-28705,
-28393,
-28057,
-27653,
-27256,
-26946,
-26799,
-26809,
-26984,
-27350,
-27929,
-28706,
-29645,
-30639,
-31556,
-32304,
-32922,
-33539,
-34162,
-34639,
-34801,
-34744,
-34739,
-34925,
-35112,
-34990,
-34539,
-34083,
-33951,
-34200,
-34632,
-35151,
-35795,
-36615,
-37470,
-38137,
-38512,
-38642,
-38612,
-38397,
-37959,
-37303,
-36523,
-35672,
-34751,
-33730,
-32626,
-31550,
-30587,
-29821,
-29204,
-28616,
-27967,
-27246,
-26569,
-25996,
-25479,
-24901,
-24257,
-23724,
-23507,
-23607,
-23857,
-24078,
-24309,
-24761,
-25641,
-26973,
-28711,
-30811,
-33305,
-36138,
-39131,
-41985,
-44487,
-46512,
-48004,
-48864,
-49038,
-48574,
-47621,
-46274,
-44525,
-42384,
-39993,
-37605,
-35378,
-33306,
-31406,
-29829,
-28779,
-28249,
-27978,
-27681,
-27310,
-26995,
-26771,
-26519,
-26090,
-25507,
-24896,
-24328,
-23799,
-23364,
-23137,
-23213,
-23484,
-23835,
-24272,
-24934,
-25897,
-27055,
-28261,
-29511,
-30874,
-32291,
-33515,
-34361,
-34886,
-35380,
-35961,
-36527,
-36834,
-36891,
-36974,
-37363,
-38082,
-38847,
-39406,
-39778,
-40241,
-41019,
-42023,
-42889,
-43296,
-43170,
-42711,
-42054,
-41202,
-40020,
-38523,
-36870,
-35313,
-33949,
-32713,
-31507,
-30269,
-29099,
-28106,
-27380,
-26908,
-26603,
-26372,
-26192,
-26080,
-26068,
-26067,
-26001,
-25812,
-25627,
-25564,
-25689,
-25892,
-26094,
-26300,
-26597,
-27020,
-27444,
-27765,
-27976,
-28213,
-28563,
-29019,
-29487,
-29956,
-30460,
-31014,
-31606,
-32230,
-32960,
-33845,
-34801,
-35698,
-36505,
-37354,
-38449,
-39796,
-41318,
-42851,
-44356,
-45742,
-46897,
-47663,
-47968,
-47766,
-47031,
-45703,
-43881,
-41788,
-39654,
-37547,
-35396,
-33164,
-30942,
-28864,
-26976,
-25282,
-23850,
-22769,
-22083,
-21693,
-21504,
-21521,
-21816,
-22364,
-23015,
-23615,
-24151,
-24711,
-25341,
-25977,
-26508,
-26956,
-27407,
-27980,
-28621,
-29202,
-29593,
-29879,
-30234,
-30838,
-31672,
-32574,
-33418,
-34203,
-34997,
-35849,
-36700,
-37504,
-38257,
-38944,
-39576,
-40140,
-40743,
-41448,
-42228,
-42895,
-43283,
-43386,
-43282,
-43046,
-42611,
-41909,
-40922,
-39725,
-38405,
-37031,
-35653,
-34214,
-32630,
-30826,
-28955,
-27311,
-26109,
-25275,
-24520,
-23696,
-22940,
-22527,
-22558,
-22837,
-23104,
-23285,
-23525,
-24064,
-24935,
-26007,
-27044,
-27926,
-28745,
-29672,
-30832,
-32098,
-33262,
-34166,
-34870,
-35527,
-36201,
-36777,
-37104,
-37140,
-37024,
-36913,
-36862,
-36767,
-36515,
-36140,
-35840,
-35817,
-36051,
-36307,
-36375,
-36313,
-36419,
-36898,
-37564,
-37993,
-37856,
-37238,
-36480,
-35842,
-35311,
-34685,
-33855,
-32869,
-31873,
-30940,
-30042,
-29102,
-28130,
-27228,
-26564,
-26214,
-26109,
-26113,
-26115,
-26108,
-26111,
-26101,
-26091,
-26167,
-26461,
-27024,
-27733,
-28458,
-29201,
-30076,
-31168,
-32400,
-33647,
-34927,
-36347,
-38013,
-39792,
-41436,
-42656,
-43339,
-43529,
-43385,
-43076,
-42596,
-41849,
-40690,
-39225,
-37705,
-36387,
-35289,
-34252,
-33152,
-32041,
-31039,
-30224,
-29575,
-29049,
-28596,
-28162,
-27687,
-27204,
-26812,
-26579,
-26456,
-26373,
-26304,
-26345,
-26524,
-26801,
-27085,
-27302,
-27425,
-27429,
-27411,
-27547,
-27969,
-28590,
-29199,
-29722,
-30307,
-31054,
-31801,
-32330,
-32711,
-33320,
-34317,
-35374,
-36035,
-36347,
-36831,
-37831,
-39029,
-39799,
-40018,
-40105,
-40480,
-40996,
-41206,
-40998,
-40680,
-40526,
-40404,
-39956,
-39086,
-38003,
-36908,
-35827,
-34660,
-33477,
-32375,
-31400,
-30467,
-29591,
-28874,
-28400,
-28081,
-27742,
-27327,
-26956,
-26783,
-26827,
-26934,
-26945,
-26839,
-26769,
-26906,
-27253,
-27621,
-27838,
-27895,
-27913,
-27931,
-27838,
-27573,
-27272,
-27121,
-27173,
-27335,
-27644,
-28292,
-29298,
-30345,
-31056,
-31513,
-32224,
-33502,
-35082,
-36505,
-37795,
-39493,
-41868,
-44453,
-46383,
-47298,
-47551,
-47596,
-47488,
-46921,
-45807,
-44374,
-42814,
-41076,
-38989,
-36614,
-34233,
-32059,
-30171,
-28557,
-27301,
-26419,
-25862,
-25482,
-25214,
-25052,
-24953,
-24830,
-24685,
-24575,
-24612,
-24767,
-24970,
-25209,
-25500,
-25854,
-26222,
-26563,
-26950,
-27452,
-28122,
-28927,
-29789,
-30586,
-31252,
-31804,
-32400,
-33100,
-33735,
-34079,
-34161,
-34357,
-34958,
-35745,
-36211,
-36165,
-36105,
-36624,
-37772,
-38943,
-39665,
-40037,
-40535,
-41238,
-41769,
-41740,
-41266,
-40744,
-40356,
-39906,
-39139,
-38057,
-36802,
-35435,
-33898,
-32244,
-30716,
-29520,
-28669,
-27997,
-27388,
-26842,
-26439,
-26169,
-26010,
-25916,
-25906,
-26024,
-26358,
-26917,
-27621,
-28282,
-28770,
-29144,
-29531,
-30001,
-30448,
-30785,
-31040,
-31336,
-31681,
-31962,
-32063,
-32045,
-32048,
-32160,
-32329,
-32481,
-32626,
-32899,
-33439,
-34279,
-35226,
-35972,
-36311,
-36374,
-36555,
-37061,
-37689,
-37950,
-37684,
-37216,
-37025,
-37123,
-37097,
-36580,
-35757,
-35095,
-34823,
-34665,
-34220,
-33420,
-32562,
-31968,
-31674,
-31475,
-31144,
-30607,
-29957,
-29372,
-28968,
-28695,
-28334,
-27794,
-27255,
-27166,
-27730,
-28735,
-29661,
-30264,
-30797,
-31680,
-33002,
-34315,
-35111,
-35315,
-35380,
-35735,
-36360,
-36737,
-36485,
-35751,
-35034,
-34701,
-34576,
-34283,
-33719,
-33177,
-32987,
-33096,
-33159,
-32892,
-32398,
-31920,
-31634,
-31495,
-31391,
-31256,
-31051,
-30804,
-30642,
-30761,
-31208,
-31749,
-32071,
-32134,
-32279,
-32846,
-33747,
-34472,
-34609,
-34233,
-33854,
-33858,
-34155,
-34300,
-33926,
-33065,
-32122,
-31439,
-31155,
-31010,
-30726,
-30154,
-29397,
-28701,
-28189,
-27853,
-27495,
-27044,
-26570,
-26361,
-26601,
-27206,
-27828,
-28245,
-28662,
-29576,
-31311,
-33667,
-36162,
-38538,
-40881,
-43286,
-45419,
-46777,
-47123,
-46760,
-46057,
-45082,
-43595,
-41566,
-39292,
-37127,
-35125,
-33137,
-31154,
-29437,
-28251,
-27673,
-27597,
-27931,
-28566,
-29274,
-29788,
-30007,
-30023,
-29912,
-29523,
-28697,
-27500,
-26309,
-25362,
-24608,
-23800,
-22934,
-22265,
-22089,
-22399,
-22977,
-23616,
-24324,
-25261,
-26531,
-28033,
-29475,
-30592,
-31449,
-32440,
-33941,
-35873,
-37753,
-39223,
-40506,
-42131,
-44235,
-46309,
-47644,
-48118,
-48139,
-48097,
-47849,
-46995,
-45415,
-43453,
-41465,
-39473,
-37267,
-34798,
-32308,
-30141,
-28435,
-27157,
-26254,
-25730,
-25614,
-25813,
-26133,
-26354,
-26381,
-26300,
-26324,
-26528,
-26805,
-26944,
-26902,
-26870,
-26982,
-27187,
-27312,
-27385,
-27651,
-28304,
-29239,
-30180,
-30981,
-31675,
-32328,
-32830,
-33053,
-32984,
-32727,
-32373,
-32006,
-31745,
-31725,
-31873,
-31996,
-31978,
-32064,
-32500,
-33260,
-33945,
-34402,
-34866,
-35758,
-37006,
-38140,
-38795,
-39192,
-39804,
-40752,
-41658,
-42052,
-41872,
-41363,
-40782,
-40163,
-39438,
-38555,
-37526,
-36434,
-35426,
-34641,
-33994,
-33216,
-32120,
-30865,
-29839,
-29181,
-28682,
-28000,
-27082,
-26200,
-25530,
-25059,
-24606,
-24102,
-23610,
-23192,
-22909,
-22780,
-22782,
-22784,
-22709,
-22718,
-23169,
-24226,
-25609,
-26921,
-28077,
-29482,
-31391,
-33557,
-35345,
-36527,
-37469,
-38778,
-40572,
-42378,
-43657,
-44289,
-44576,
-44895,
-45227,
-45313,
-44829,
-43805,
-42610,
-41648,
-41004,
-40302,
-39149,
-37558,
-35999,
-34874,
-34090,
-33185,
-31921,
-30598,
-29724,
-29420,
-29289,
-28839,
-28017,
-27229,
-26875,
-26972,
-27155,
-27065,
-26721,
-26385,
-26360,
-26561,
-26693,
-26513,
-26144,
-25987,
-26302,
-26962,
-27573,
-27853,
-27879,
-27926,
-28162,
-28527,
-28850,
-29083,
-29322,
-29718,
-30304,
-31001,
-31718,
-32462,
-33386,
-34639,
-36232,
-37969,
-39621,
-41073,
-42373,
-43557,
-44535,
-45147,
-45298,
-45039,
-44415,
-43460,
-42218,
-40824,
-39413,
-37994,
-36424,
-34659,
-32867,
-31308,
-30112,
-29161,
-28320,
-27571,
-27004,
-26634,
-26366,
-26156,
-26037,
-26073,
-26156,
-26165,
-26077,
-26115,
-26489,
-27169,
-27952,
-28654,
-29353,
-30202,
-31194,
-32100,
-32646,
-32838,
-32907,
-33117,
-33494,
-33847,
-33953,
-33786,
-33445,
-33096,
-32747,
-32387,
-31990,
-31632,
-31417,
-31379,
-31548,
-31864,
-32325,
-32873,
-33483,
-34151,
-34891,
-35709,
-36527,
-37289,
-37986,
-38712,
-39446,
-40030,
-40217,
-39919,
-39339,
-38720,
-38084,
-37219,
-35908,
-34289,
-32757,
-31581,
-30688,
-29781,
-28735,
-27762,
-27148,
-26935,
-26888,
-26738,
-26470,
-26256,
-26259,
-26492,
-26847,
-27261,
-27710,
-28214,
-28780,
-29398,
-30022,
-30588,
-31101,
-31683,
-32521,
-33620,
-34723,
-35508,
-35902,
-36181,
-36635,
-37231,
-37612,
-37506,
-37028,
-36569,
-36376,
-36300,
-36007,
-35314,
-34426,
-33684,
-33322,
-33287,
-33385,
-33497,
-33694,
-34100,
-34743,
-35474,
-36077,
-36465,
-36658,
-36708,
-36567,
-36140,
-35408,
-34434,
-33310,
-32074,
-30782,
-29503,
-28313,
-27188,
-26112,
-25185,
-24642,
-24553,
-24753,
-24859,
-24702,
-24387,
-24147,
-24081,
-24110,
-24194,
-24363,
-24693,
-25211,
-25968,
-27080,
-28559,
-30186,
-31650,
-32965,
-34595,
-37116,
-40610,
-44572,
-48280,
-51352,
-53733,
-55392,
-56034,
-55311,
-53230,
-50224,
-46954,
-43722,
-40504,
-37075,
-33545,
-30312,
-27813,
-26092,
-24862,
-23892,
-23309,
-23399,
-24129,
-25013,
-25476,
-25373,
-24964,
-24506,
-23945,
-23103,
-22061,
-21177,
-20752,
-20732,
-20904,
-21240,
-22020,
-23553,
-25794,
-28317,
-30601,
-32390,
-33827,
-35202,
-36628,
-37890,
-38626,
-38745,
-38483,
-38232,
-38122,
-38037,
-37817,
-37547,
-37387,
-37427,
-37582,
-37830,
-38233,
-38861,
-39580,
-40197,
-40581,
-40758,
-40710,
-40352,
-39637,
-38709,
-37800,
-36996,
-36240,
-35424,
-34568,
-33735,
-32873,
-31963,
-31010,
-30140,
-29351,
-28564,
-27743,
-27060,
-26660,
-26469,
-26128,
-25495,
-24800,
-24518,
-24843,
-25496,
-26047,
-26355,
-26604,
-27066,
-27689,
-28265,
-28576,
-28672,
-28710,
-28802,
-28971,
-29184,
-29510,
-29990,
-30675,
-31523,
-32541,
-33698,
-34880,
-35888,
-36574,
-37110,
-37832,
-38956,
-40258,
-41288,
-41849,
-42183,
-42653,
-43183,
-43278,
-42541,
-41188,
-39833,
-38879,
-38134,
-37132,
-35753,
-34299,
-33178,
-32361,
-31518,
-30398,
-29157,
-28185,
-27723,
-27652,
-27664,
-27546,
-27346,
-27246,
-27403,
-27738,
-28083,
-28264,
-28370,
-28626,
-29210,
-30024,
-30717,
-31039,
-31015,
-30952,
-31045,
-31237,
-31323,
-31241,
-31152,
-31195,
-31315,
-31315,
-31125,
-30869,
-30724,
-30695,
-30700,
-30735,
-30931,
-31394,
-32028,
-32589,
-32927,
-33122,
-33413,
-33992,
-34899,
-35981,
-37074,
-38088,
-39042,
-39987,
-40794,
-41209,
-41047,
-40400,
-39605,
-38897,
-38241,
-37455,
-36547,
-35715,
-35139,
-34662,
-34024,
-33111,
-32144,
-31401,
-30941,
-30566,
-30043,
-29318,
-28451,
-27634,
-26948,
-26460,
-26074,
-25709,
-25380,
-25269,
-25539,
-26130,
-26791,
-27375,
-28007,
-28920,
-30109,
-31278,
-32122,
-32691,
-33239,
-33938,
-34593,
-34903,
-34780,
-34476,
-34303,
-34320,
-34315,
-34082,
-33656,
-33331,
-33346,
-33754,
-34381,
-35094,
-35874,
-36794,
-37793,
-38661,
-39173,
-39233,
-38980,
-38561,
-38079,
-37512,
-36807,
-35916,
-34865,
-33709,
-32605,
-31654,
-30891,
-30244,
-29623,
-29063,
-28612,
-28275,
-27950,
-27486,
-26906,
-26280,
-25725,
-25236,
-24832,
-24558,
-24546,
-24780,
-25209,
-25760,
-26577,
-27832,
-29615,
-31738,
-33967,
-36180,
-38429,
-40692,
-42765,
-44309,
-45143,
-45363,
-45169,
-44676,
-43839,
-42599,
-41026,
-39258,
-37426,
-35612,
-33924,
-32509,
-31434,
-30637,
-29970,
-29396,
-29017,
-28894,
-28943,
-28916,
-28712,
-28390,
-28124,
-27937,
-27732,
-27468,
-27237,
-27145,
-27133,
-27024,
-26792,
-26598,
-26655,
-26896,
-27131,
-27280,
-27554,
-28183,
-29095,
-29945,
-30506,
-30888,
-31432,
-32244,
-33154,
-33835,
-34181,
-34300,
-34456,
-34888,
-35720,
-36859,
-38023,
-38960,
-39688,
-40463,
-41442,
-42414,
-43008,
-43116,
-43024,
-43039,
-43060,
-42650,
-41512,
-39815,
-38000,
-36319,
-34722,
-33027,
-31282,
-29723,
-28601,
-27993,
-27705,
-27495,
-27160,
-26785,
-26573,
-26674,
-26943,
-27050,
-26863,
-26533,
-26366,
-26395,
-26409,
-26183,
-25777,
-25396,
-25172,
-25059,
-25024,
-25110,
-25403,
-25878,
-26484,
-27254,
-28226,
-29343,
-30395,
-31303,
-32189,
-33250,
-34429,
-35531,
-36478,
-37565,
-39114,
-41054,
-42925,
-44262,
-45078,
-45681,
-46283,
-46756,
-46842,
-46459,
-45716,
-44696,
-43347,
-41660,
-39750,
-37862,
-36079,
-34336,
-32570,
-30884,
-29432,
-28260,
-27189,
-26103,
-25058,
-24271,
-23856,
-23690,
-23584,
-23462,
-23467,
-23720,
-24195,
-24727,
-25201,
-25680,
-26310,
-27088,
-27855,
-28356,
-28556,
-28621,
-28770,
-29042,
-29282,
-29375,
-29467,
-29816,
-30537,
-31422,
-32184,
-32744,
-33344,
-34156,
-35128,
-36086,
-36992,
-38063,
-39363,
-40668,
-41649,
-42253,
-42771,
-43403,
-43976,
-44118,
-43729,
-43077,
-42451,
-41818,
-40894,
-39555,
-37913,
-36180,
-34395,
-32570,
-30816,
-29347,
-28258,
-27449,
-26745,
-26085,
-25489,
-24981,
-24645,
-24571,
-24834,
-25300,
-25721,
-26017,
-26385,
-27022,
-27842,
-28463,
-28716,
-28773,
-28997,
-29458,
-29947,
-30311,
-30651,
-31156,
-31786,
-32331,
-32655,
-32866,
-33100,
-33346,
-33490,
-33539,
-33678,
-34022,
-34528,
-34981,
-35284,
-35492,
-35770,
-36234,
-36890,
-37632,
-38298,
-38799,
-39175,
-39545,
-39914,
-40088,
-39832,
-39102,
-38122,
-37136,
-36206,
-35177,
-33928,
-32543,
-31238,
-30184,
-29348,
-28575,
-27792,
-27060,
-26571,
-26388,
-26426,
-26523,
-26640,
-26922,
-27499,
-28313,
-29112,
-29711,
-30135,
-30582,
-31181,
-31863,
-32494,
-32963,
-33300,
-33575,
-33832,
-34080,
-34254,
-34287,
-34197,
-34080,
-34080,
-34211,
-34355,
-34380,
-34266,
-34115,
-34028,
-34015,
-34059,
-34088,
-34058,
-33931,
-33805,
-33872,
-34255,
-34818,
-35235,
-35325,
-35263,
-35349,
-35642,
-35837,
-35606,
-34993,
-34336,
-33906,
-33623,
-33188,
-32433,
-31459,
-30509,
-29748,
-29171,
-28679,
-28209,
-27763,
-27462,
-27353,
-27377,
-27320,
-26999,
-26432,
-25870,
-25552,
-25525,
-25618,
-25628,
-25581,
-25711,
-26298,
-27354,
-28567,
-29600,
-30438,
-31688,
-34045,
-37790,
-42308,
-46589,
-49856,
-52043,
-53413,
-54051,
-53695,
-52124,
-49571,
-46612,
-43687,
-40799,
-37729,
-34419,
-31168,
-28334,
-26132,
-24541,
-23568,
-23256,
-23581,
-24281,
-24973,
-25433,
-25685,
-25815,
-25751,
-25271,
-24372,
-23336,
-22562,
-22173,
-21968,
-21782,
-21745,
-22239,
-23486,
-25345,
-27438,
-29456,
-31319,
-33085,
-34811,
-36462,
-37943,
-39094,
-39836,
-40205,
-40382,
-40487,
-40490,
-40217,
-39638,
-38908,
-38301,
-37948,
-37786,
-37703,
-37657,
-37715,
-37885,
-38100,
-38170,
-37971,
-37475,
-36809,
-36113,
-35456,
-34740,
-33889,
-32933,
-32059,
-31396,
-30926,
-30490,
-30008,
-29489,
-29028,
-28666,
-28456,
-28425,
-28562,
-28726,
-28760,
-28633,
-28468,
-28426,
-28505,
-28641,
-28796,
-29071,
-29527,
-30131,
-30745,
-31249,
-31596,
-31748,
-31703,
-31523,
-31262,
-30954,
-30540,
-30035,
-29589,
-29339,
-29236,
-29054,
-28695,
-28392,
-28528,
-29230,
-30224,
-31173,
-32088,
-33326,
-35168,
-37417,
-39550,
-41180,
-42382,
-43449,
-44506,
-45246,
-45289,
-44510,
-43239,
-41884,
-40608,
-39244,
-37580,
-35662,
-33818,
-32352,
-31359,
-30628,
-29939,
-29212,
-28575,
-28197,
-28109,
-28154,
-28139,
-27992,
-27841,
-27827,
-27951,
-28016,
-27870,
-27576,
-27409,
-27576,
-28007,
-28434,
-28650,
-28735,
-28925,
-29325,
-29784,
-29983,
-29813,
-29403,
-29064,
-28954,
-29026,
-29128,
-29195,
-29327,
-29671,
-30326,
-31251,
-32329,
-33458,
-34641,
-35995,
-37592,
-39329,
-40909,
-42102,
-42934,
-43649,
-44341,
-44807,
-44669,
-43871,
-42691,
-41548,
-40532,
-39446,
-38088,
-36517,
-34956,
-33549,
-32277,
-31081,
-29974,
-29001,
-28158,
-27396,
-26723,
-26179,
-25780,
-25458,
-25146,
-24898,
-24827,
-25047,
-25492,
-25998,
-26412,
-26741,
-27104,
-27634,
-28273,
-28860,
-29282,
-29667,
-30252,
-31110,
-32007,
-32601,
-32784,
-32781,
-32899,
-33216,
-33611,
-33966,
-34325,
-34793,
-35366,
-35975,
-36596,
-37264,
-37996,
-38672,
-39186,
-39558,
-39857,
-40123,
-40233,
-40091,
-39695,
-39094,
-38325,
-37351,
-36259,
-35184,
-34245,
-33358,
-32373,
-31232,
-30069,
-29058,
-28231,
-27519,
-26841,
-26241,
-25789,
-25498,
-25314,
-25127,
-24888,
-24583,
-24335,
-24339,
-24756,
-25576,
-26630,
-27790,
-29120,
-30788,
-32778,
-34788,
-36463,
-37702,
-38730,
-39791,
-40836,
-41563,
-41753,
-41495,
-41093,
-40766,
-40405,
-39768,
-38733,
-37471,
-36328,
-35526,
-35006,
-34525,
-33930,
-33282,
-32769,
-32453,
-32177,
-31711,
-31020,
-30294,
-29775,
-29494,
-29272,
-28903,
-28425,
-28025,
-27873,
-27899,
-27904,
-27778,
-27641,
-27662,
-27871,
-28040,
-27982,
-27707,
-27454,
-27408,
-27538,
-27661,
-27685,
-27653,
-27702,
-27869,
-28222,
-28761,
-29516,
-30356,
-31172,
-32068,
-33348,
-35275,
-37639,
-39944,
-41800,
-43320,
-44834,
-46399,
-47630,
-48127,
-47884,
-47278,
-46502,
-45400,
-43655,
-41342,
-38870,
-36649,
-34715,
-32873,
-31058,
-29431,
-28220,
-27436,
-26937,
-26579,
-26289,
-26050,
-25843,
-25681,
-25597,
-25551,
-25412,
-25110,
-24716,
-24411,
-24199,
-23969,
-23586,
-23227,
-23110,
-23316,
-23603,
-23779,
-23967,
-24534,
-25680,
-27170,
-28555,
-29611,
-30518,
-31607,
-32972,
-34387,
-35559,
-36564,
-37804,
-39721,
-42249,
-44838,
-46832,
-48090,
-48983,
-49929,
-50834,
-51193,
-50622,
-49290,
-47680,
-46028,
-44137,
-41702,
-38766,
-35763,
-33078,
-30809,
-28774,
-26837,
-25044,
-23594,
-22616,
-22157,
-22029,
-22004,
-21865,
-21628,
-21469,
-21582,
-21918,
-22312,
-22646,
-23036,
-23677,
-24605,
-25597,
-26399,
-26959,
-27496,
-28255,
-29229,
-30203,
-30947,
-31519,
-32141,
-32952,
-33806,
-34429,
-34753,
-34952,
-35308,
-35887,
-36633,
-37532,
-38647,
-39962,
-41229,
-42215,
-42914,
-43569,
-44304,
-44918,
-45137,
-44892,
-44418,
-43829,
-42950,
-41486,
-39450,
-37211,
-35170,
-33386,
-31668,
-29884,
-28202,
-26889,
-26046,
-25490,
-24958,
-24337,
-23756,
-23437,
-23539,
-23997,
-24636,
-25225,
-25698,
-26094,
-26527,
-27060,
-27676,
-28305,
-28892,
-29416,
-29909,
-30411,
-30914,
-31345,
-31605,
-31733,
-31834,
-32038,
-32298,
-32485,
-32553,
-32640,
-32962,
-33594,
-34409,
-35207,
-35841,
-36344,
-36813,
-37458,
-38343,
-39387,
-40263,
-40763,
-40945,
-41151,
-41472,
-41586,
-40997,
-39636,
-38022,
-36728,
-35818,
-34850,
-33484,
-31871,
-30482,
-29516,
-28778,
-27952,
-26978,
-26072,
-25478,
-25282,
-25410,
-25708,
-26041,
-26410,
-26969,
-27852,
-28958,
-29999,
-30817,
-31606,
-32659,
-33911,
-34928,
-35335,
-35286,
-35221,
-35351,
-35435,
-35115,
-34436,
-33722,
-33245,
-32911,
-32505,
-31922,
-31304,
-30848,
-30680,
-30782,
-31009,
-31161,
-31194,
-31297,
-31767,
-32625,
-33583,
-34322,
-34889,
-35610,
-36637,
-37701,
-38359,
-38444,
-38204,
-37910,
-37626,
-37178,
-36420,
-35426,
-34330,
-33289,
-32330,
-31464,
-30644,
-29890,
-29277,
-28873,
-28681,
-28552,
-28340,
-27976,
-27489,
-26893,
-26209,
-25507,
-24918,
-24562,
-24426,
-24540,
-24991,
-25912,
-27235,
-28701,
-30062,
-31406,
-33004,
-35123,
-37669,
-40366,
-42846,
-44882,
-46329,
-47168,
-47423,
-47106,
-46171,
-44613,
-42608,
-40497,
-38553,
-36770,
-35028,
-33249,
-31620,
-30283,
-29274,
-28474,
-27897,
-27631,
-27687,
-27869,
-27895,
-27700,
-27387,
-27087,
-26718,
-26148,
-25376,
-24626,
-24165,
-24055,
-24180,
-24376,
-24650,
-25157,
-26048,
-27287,
-28666,
-29925,
-30963,
-31869,
-32804,
-33867,
-35011,
-36104,
-37058,
-37823,
-38418,
-38848,
-39143,
-39309,
-39405,
-39443,
-39445,
-39390,
-39274,
-39103,
-38892,
-38604,
-38129,
-37392,
-36443,
-35495,
-34758,
-34226,
-33704,
-32986,
-32111,
-31349,
-30881,
-30667,
-30431,
-30002,
-29484,
-29134,
-29131,
-29375,
-29636,
-29738,
-29708,
-29690,
-29800,
-30005,
-30179,
-30193,
-30065,
-29961,
-30095,
-30522,
-31109,
-31589,
-31878,
-32075,
-32338,
-32645,
-32784,
-32616,
-32249,
-31933,
-31778,
-31662,
-31384,
-30887,
-30292,
-29722,
-29225,
-28814,
-28530,
-28425,
-28532,
-28874,
-29499,
-30439,
-31610,
-32914,
-34342,
-35995,
-37837,
-39595,
-40926,
-41808,
-42518,
-43251,
-43750,
-43538,
-42461,
-40933,
-39517,
-38353,
-37137,
-35535,
-33693,
-32058,
-31003,
-30469,
-30099,
-29586,
-28898,
-28292,
-28055,
-28233,
-28574,
-28734,
-28600,
-28411,
-28447,
-28714,
-28906,
-28742,
-28302,
-27951,
-27982,
-28406,
-28939,
-29316,
-29436,
-29408,
-29467,
-29725,
-30070,
-30198,
-29946,
-29546,
-29472,
-30002,
-30888,
-31674,
-32147,
-32593,
-33390,
-34586,
-35811,
-36766,
-37459,
-38217,
-39234,
-40435,
-41509,
-42200,
-42392,
-42171,
-41712,
-41152,
-40490,
-39552,
-38259,
-36748,
-35357,
-34245,
-33268,
-32097,
-30686,
-29295,
-28262,
-27546,
-26862,
-26010,
-25194,
-24798,
-24940,
-25404,
-25882,
-26351,
-27010,
-27962,
-29062,
-30073,
-30922,
-31708,
-32476,
-33153,
-33634,
-33946,
-34183,
-34314,
-34233,
-33873,
-33443,
-33133,
-33017,
-32872,
-32559,
-32166,
-31982,
-32158,
-32574,
-32962,
-33189,
-33320,
-33529,
-33867,
-34321,
-34812,
-35303,
-35774,
-36172,
-36508,
-36766,
-37012,
-37216,
-37356,
-37349,
-37177,
-36816,
-36288,
-35619,
-34835,
-33996,
-33146,
-32319,
-31521,
-30704,
-29861,
-29003,
-28235,
-27623,
-27112,
-26572,
-25926,
-25289,
-24893,
-24833,
-24996,
-25149,
-25254,
-25441,
-25866,
-26470,
-27089,
-27656,
-28275,
-29024,
-29891,
-30843,
-32114,
-34008,
-36608,
-39520,
-42236,
-44527,
-46547,
-48350,
-49626,
-49925,
-49170,
-47805,
-46253,
-44556,
-42431,
-39851,
-37190,
-34832,
-32806,
-30849,
-28972,
-27533,
-26873,
-26828,
-26893,
-26750,
-26549,
-26542,
-26613,
-26320,
-25432,
-24232,
-23284,
-22806,
-22590,
-22314,
-22030,
-22096,
-22752,
-23861,
-25054,
-26136,
-27240,
-28601,
-30229,
-31877,
-33212,
-34144,
-34830,
-35509,
-36249,
-36895,
-37225,
-37205,
-37079,
-37179,
-37685,
-38469,
-39302,
-40083,
-40936,
-41988,
-43195,
-44291,
-45054,
-45410,
-45373,
-44929,
-43975,
-42541,
-40798,
-38984,
-37125,
-35126,
-32887,
-30590,
-28517,
-26854,
-25537,
-24407,
-23440,
-22776,
-22552,
-22697,
-22960,
-23108,
-23090,
-23045,
-23126,
-23395,
-23759,
-24190,
-24683,
-25346,
-26173,
-27049,
-27821,
-28453,
-29093,
-29951,
-31137,
-32550,
-33957,
-35126,
-35986,
-36662,
-37331,
-38038,
-38611,
-38830,
-38705,
-38517,
-38563,
-38805,
-38961,
-38807,
-38536,
-38432,
-38577,
-38632,
-38323,
-37792,
-37434,
-37497,
-37726,
-37784,
-37544,
-37184,
-36711,
-35963,
-34804,
-33519,
-32575,
-32087,
-31705,
-30976,
-29922,
-28969,
-28402,
-28093,
-27651,
-27003,
-26402,
-26143,
-26197,
-26321,
-26357,
-26365,
-26488,
-26707,
-26962,
-27195,
-27519,
-28020,
-28714,
-29481,
-30176,
-30712,
-31108,
-31505,
-32006,
-32629,
-33221,
-33668,
-34011,
-34413,
-34985,
-35580,
-35986,
-36101,
-36151,
-36424,
-37059,
-37825,
-38374,
-38503,
-38320,
-38148,
-38154,
-38260,
-38150,
-37687,
-36997,
-36432,
-36157,
-35992,
-35547,
-34581,
-33251,
-31954,
-30999,
-30416,
-29972,
-29503,
-29016,
-28688,
-28688,
-28999,
-29469,
-29932,
-30325,
-30695,
-31074,
-31438,
-31720,
-31910,
-32017,
-32053,
-32002,
-31895,
-31803,
-31746,
-31638,
-31340,
-30871,
-30452,
-30302,
-30421,
-30567,
-30526,
-30380,
-30359,
-30598,
-30916,
-31012,
-30838,
-30662,
-30867,
-31596,
-32631,
-33660,
-34494,
-35181,
-35838,
-36518,
-37190,
-37823,
-38360,
-38744,
-38884,
-38756,
-38430,
-37933,
-37232,
-36226,
-35010,
-33851,
-33020,
-32523,
-32125,
-31595,
-30964,
-30356,
-29821,
-29243,
-28583,
-27980,
-27619,
-27470,
-27307,
-27017,
-26777,
-26853,
-27293,
-27803,
-28152,
-28390,
-28872,
-29849,
-31268,
-32869,
-34418,
-35843,
-37126,
-38245,
-39147,
-39800,
-40162,
-40172,
-39777,
-39073,
-38219,
-37383,
-36556,
-35632,
-34566,
-33444,
-32495,
-31839,
-31469,
-31229,
-30972,
-30696,
-30499,
-30488,
-30637,
-30781,
-30786,
-30689,
-30637,
-30745,
-30914,
-30982,
-30938,
-30946,
-31213,
-31632,
-31938,
-31872,
-31546,
-31269,
-31268,
-31436,
-31468,
-31180,
-30723,
-30416,
-30430,
-30606,
-30570,
-30143,
-29484,
-28996,
-28873,
-28941,
-28817,
-28350,
-27815,
-27640,
-28000,
-28738,
-29575,
-30513,
-31726,
-33386,
-35453,
-37866,
-40582,
-43572,
-46488,
-48814,
-50084,
-50284,
-49699,
-48601,
-47023,
-44860,
-42149,
-39150,
-36135,
-33318,
-30728,
-28445,
-26519,
-25040,
-24048,
-23589,
-23698,
-24333,
-25267,
-26182,
-26755,
-26861,
-26564,
-26028,
-25400,
-24729,
-23984,
-23175,
-22344,
-21660,
-21264,
-21308,
-21817,
-22803,
-24182,
-25930,
-28018,
-30412,
-32954,
-35386,
-37522,
-39362,
-41115,
-42887,
-44549,
-45859,
-46725,
-47279,
-47596,
-47470,
-46607,
-45020,
-43140,
-41430,
-39967,
-38500,
-36918,
-35436,
-34321,
-33467,
-32522,
-31304,
-30112,
-29317,
-28987,
-28777,
-28439,
-28064,
-27883,
-27913,
-27842,
-27469,
-26876,
-26369,
-26111,
-25999,
-25912,
-25832,
-25942,
-26313,
-26932,
-27666,
-28456,
-29296,
-30230,
-31232,
-32233,
-33109,
-33763,
-34205,
-34495,
-34713,
-34828,
-34756,
-34495,
-34164,
-34031,
-34242,
-34783,
-35437,
-35974,
-36273,
-36370,
-36346,
-36218,
-35961,
-35594,
-35296,
-35213,
-35317,
-35303,
-34919,
-34198,
-33464,
-32901,
-32375,
-31550,
-30419,
-29396,
-28983,
-29271,
-29840,
-30196,
-30153,
-29979,
-30054,
-30628,
-31616,
-32728,
-33668,
-34356,
-34984,
-35782,
-36688,
-37386,
-37627,
-37568,
-37590,
-37785,
-37810,
-37215,
-36092,
-34891,
-33957,
-33089,
-31903,
-30418,
-29138,
-28464,
-28277,
-28041,
-27497,
-26854,
-26512,
-26536,
-26629,
-26468,
-26053,
-25665,
-25587,
-25857,
-26287,
-26666,
-26967,
-27490,
-28547,
-30262,
-32309,
-34258,
-35930,
-37516,
-39261,
-41054,
-42420,
-42998,
-42851,
-42418,
-42036,
-41623,
-40884,
-39634,
-38091,
-36647,
-35564,
-34746,
-33936,
-32979,
-32015,
-31308,
-31017,
-30982,
-30920,
-30553,
-29882,
-29095,
-28520,
-28395,
-28739,
-29330,
-29840,
-30117,
-30303,
-30663,
-31294,
-31942,
-32266,
-32120,
-31744,
-31471,
-31449,
-31511,
-31361,
-30889,
-30214,
-29616,
-29280,
-29225,
-29310,
-29426,
-29542,
-29733,
-30079,
-30586,
-31224,
-31995,
-32935,
-34107,
-35433,
-36795,
-38023,
-39087,
-40013,
-40838,
-41479,
-41819,
-41759,
-41333,
-40595,
-39592,
-38376,
-37021,
-35641,
-34238,
-32726,
-31097,
-29515,
-28285,
-27517,
-27008,
-26411,
-25558,
-24573,
-23707,
-23087,
-22715,
-22512,
-22468,
-22516,
-22666,
-22968,
-23556,
-24458,
-25542,
-26611,
-27615,
-28732,
-30172,
-32118,
-34644,
-37701,
-41039,
-44155,
-46634,
-48409,
-49734,
-50695,
-50995,
-50222,
-48476,
-46348,
-44337,
-42363,
-39984,
-37200,
-34556,
-32658,
-31423,
-30296,
-29007,
-27933,
-27637,
-28054,
-28453,
-28208,
-27388,
-26589,
-26165,
-25846,
-25176,
-24113,
-23121,
-22622,
-22552,
-22484,
-22211,
-22012,
-22373,
-23468,
-25002,
-26537,
-27889,
-29158,
-30481,
-31800,
-32930,
-33703,
-34128,
-34266,
-34298,
-34352,
-34540,
-34798,
-35011,
-35172,
-35524,
-36374,
-37792,
-39491,
-41090,
-42486,
-43833,
-45281,
-46653,
-47544,
-47728,
-47317,
-46609,
-45712,
-44391,
-42343,
-39581,
-36551,
-33794,
-31533,
-29548,
-27546,
-25556,
-23948,
-22985,
-22542,
-22240,
-21922,
-21789,
-22095,
-22731,
-23348,
-23721,
-23993,
-24403,
-24952,
-25436,
-25731,
-25909,
-26068,
-26165,
-26215,
-26383,
-26887,
-27665,
-28467,
-29241,
-30325,
-32041,
-34131,
-35916,
-36974,
-37604,
-38455,
-39728,
-41052,
-42028,
-42723,
-43526,
-44525,
-45379,
-45670,
-45328,
-44569,
-43610,
-42478,
-41212,
-39872,
-38587,
-37315,
-36045,
-34680,
-33234,
-31644,
-29983,
-28462,
-27341,
-26684,
-26254,
-25794,
-25251,
-24825,
-24622,
-24593,
-24573,
-24547,
-24655,
-25028,
-25675,
-26498,
-27351,
-28186,
-29020,
-29987,
-31121,
-32270,
-33138,
-33575,
-33717,
-33890,
-34160,
-34372,
-34286,
-33949,
-33578,
-33286,
-32984,
-32567,
-32092,
-31796,
-31805,
-32184,
-32887,
-33856,
-34924,
-35898,
-36698,
-37486,
-38392,
-39347,
-40066,
-40413,
-40474,
-40429,
-40200,
-39570,
-38452,
-36994,
-35446,
-33885,
-32321,
-30862,
-29679,
-28835,
-28149,
-27465,
-26821,
-26424,
-26338,
-26386,
-26384,
-26314,
-26348,
-26554,
-26859,
-27155,
-27485,
-27983,
-28740,
-29715,
-30857,
-32151,
-33578,
-35044,
-36329,
-37327,
-38034,
-38576,
-38990,
-39169,
-38998,
-38502,
-37908,
-37413,
-36985,
-36398,
-35519,
-34487,
-33589,
-32954,
-32424,
-31820,
-31188,
-30768,
-30683,
-30767,
-30779,
-30688,
-30704,
-30994,
-31483,
-31929,
-32235,
-32443,
-32683,
-32918,
-33076,
-33090,
-32989,
-32784,
-32449,
-31996,
-31514,
-31102,
-30781,
-30467,
-30101,
-29748,
-29507,
-29404,
-29321,
-29116,
-28763,
-28390,
-28173,
-28147,
-28261,
-28379,
-28524,
-28751,
-29178,
-29773,
-30484,
-31263,
-32183,
-33343,
-34856,
-36649,
-38591,
-40392,
-41856,
-42889,
-43539,
-43895,
-43949,
-43672,
-43105,
-42376,
-41553,
-40528,
-39098,
-37278,
-35348,
-33641,
-32232,
-30939,
-29634,
-28498,
-27814,
-27632,
-27614,
-27397,
-26956,
-26635,
-26740,
-27193,
-27603,
-27652,
-27365,
-26964,
-26628,
-26346,
-26065,
-25826,
-25687,
-25630,
-25612,
-25721,
-26187,
-27090,
-28185,
-29041,
-29549,
-30006,
-30872,
-32143,
-33461,
-34436,
-35163,
-36035,
-37286,
-38754,
-40094,
-41069,
-41777,
-42380,
-43055,
-43823,
-44568,
-45036,
-45001,
-44492,
-43728,
-42926,
-41954,
-40567,
-38718,
-36749,
-35081,
-33759,
-32496,
-30965,
-29254,
-27652,
-26438,
-25535,
-24757,
-23981,
-23314,
-22950,
-23002,
-23371,
-23854,
-24269,
-24619,
-25001,
-25511,
-26098,
-26667,
-27158,
-27580,
-27936,
-28181,
-28325,
-28442,
-28685,
-29099,
-29663,
-30288,
-30937,
-31623,
-32425,
-33467,
-34819,
-36368,
-37855,
-39095,
-40198,
-41404,
-42759,
-43911,
-44496,
-44507,
-44334,
-44265,
-44135,
-43540,
-42336,
-40784,
-39308,
-37973,
-36596,
-34989,
-33228,
-31579,
-30231,
-29192,
-28365,
-27631,
-26994,
-26470,
-26108,
-25849,
-25621,
-25400,
-25323,
-25543,
-26057,
-26662,
-27149,
-27536,
-28034,
-28803,
-29768,
-30720,
-31507,
-32134,
-32674,
-33138,
-33518,
-33734,
-33763,
-33559,
-33167,
-32689,
-32191,
-31655,
-31035,
-30413,
-29989,
-29923,
-30111,
-30349,
-30543,
-30867,
-31518,
-32497,
-33572,
-34591,
-35642,
-36931,
-38439,
-39836,
-40730,
-40989,
-40893,
-40757,
-40655,
-40338,
-39520,
-38253,
-36888,
-35714,
-34757,
-33723,
-32492,
-31198,
-30124,
-29421,
-28946,
-28578,
-28274,
-28154,
-28296,
-28639,
-29104,
-29573,
-29980,
-30330,
-30682,
-31146,
-31679,
-32120,
-32279,
-32172,
-31977,
-31789,
-31552,
-31184,
-30789,
-30592,
-30664,
-30812,
-30804,
-30625,
-30477,
-30508,
-30638,
-30688,
-30592,
-30497,
-30602,
-30993,
-31553,
-32078,
-32418,
-32681,
-33147,
-34031,
-35214,
-36315,
-37033,
-37487,
-38002,
-38735,
-39454,
-39721,
-39390,
-38630,
-37841,
-37233,
-36747,
-36106,
-35073,
-33718,
-32393,
-31467,
-30909,
-30337,
-29443,
-28423,
-27786,
-27736,
-27900,
-27734,
-27167,
-26653,
-26580,
-26812,
-26922,
-26762,
-26691,
-27180,
-28329,
-29835,
-31317,
-32622,
-33798,
-34948,
-36081,
-37134,
-38008,
-38666,
-39116,
-39392,
-39420,
-39124,
-38483,
-37670,
-36876,
-36145,
-35418,
-34658,
-33995,
-33558,
-33330,
-33170,
-32965,
-32714,
-32455,
-32189,
-31952,
-31776,
-31666,
-31512,
-31214,
-30859,
-30638,
-30650,
-30715,
-30652,
-30414,
-30235,
-30185,
-30245,
-30223,
-30131,
-29985,
-29781,
-29414,
-28900,
-28399,
-28045,
-27822,
-27603,
-27412,
-27396,
-27654,
-28083,
-28483,
-28816,
-29219,
-29811,
-30580,
-31402,
-32308,
-33461,
-35023,
-36919,
-38842,
-40481,
-41726,
-42697,
-43514,
-44130,
-44366,
-44086,
-43422,
-42552,
-41636,
-40606,
-39339,
-37831,
-36193,
-34669,
-33447,
-32586,
-31934,
-31241,
-30374,
-29478,
-28862,
-28586,
-28398,
-27955,
-27263,
-26705,
-26567,
-26736,
-26763,
-26426,
-25885,
-25516,
-25477,
-25620,
-25702,
-25607,
-25421,
-25332,
-25486,
-25905,
-26426,
-26897,
-27291,
-27744,
-28305,
-28832,
-29196,
-29553,
-30339,
-31793,
-33713,
-35662,
-37504,
-39514,
-41884,
-44365,
-46343,
-47522,
-48128,
-48631,
-49171,
-49428,
-48992,
-47712,
-45825,
-43668,
-41467,
-39247,
-36939,
-34549,
-32265,
-30369,
-28994,
-27999,
-27100,
-26165,
-25341,
-24840,
-24642,
-24506,
-24176,
-23697,
-23248,
-23033,
-23006,
-23043,
-23034,
-23018,
-23145,
-23531,
-24174,
-24899,
-25546,
-26092,
-26767,
-27718,
-28913,
-30038,
-30864,
-31438,
-32004,
-32733,
-33589,
-34455,
-35355,
-36409,
-37695,
-39066,
-40341,
-41396,
-42287,
-43089,
-43794,
-44350,
-44737,
-44980,
-45085,
-44933,
-44363,
-43316,
-41920,
-40394,
-38850,
-37222,
-35410,
-33485,
-31705,
-30275,
-29140,
-28036,
-26842,
-25669,
-24809,
-24332,
-24070,
-23848,
-23659,
-23709,
-24096,
-24719,
-25376,
-25963,
-26536,
-27195,
-27986,
-28833,
-29645,
-30316,
-30845,
-31359,
-31961,
-32649,
-33157,
-33261,
-33004,
-32730,
-32752,
-33032,
-33278,
-33292,
-33198,
-33226,
-33436,
-33690,
-33891,
-34104,
-34414,
-34782,
-35129,
-35505,
-36081,
-36827,
-37525,
-37966,
-38266,
-38679,
-39212,
-39489,
-39184,
-38429,
-37646,
-37070,
-36448,
-35427,
-34075,
-32782,
-31849,
-31086,
-30173,
-29053,
-28074,
-27529,
-27383,
-27373,
-27390,
-27573,
-28068,
-28792,
-29503,
-30035,
-30484,
-31010,
-31710,
-32515,
-33271,
-33877,
-34292,
-34548,
-34662,
-34605,
-34316,
-33774,
-33108,
-32511,
-32116,
-31891,
-31662,
-31340,
-30954,
-30637,
-30463,
-30368,
-30264,
-30086,
-29952,
-29999,
-30368,
-30991,
-31715,
-32364,
-32930,
-33574,
-34415,
-35418,
-36344,
-36996,
-37337,
-37530,
-37703,
-37864,
-37891,
-37697,
-37285,
-36752,
-36132,
-35452,
-34700,
-33954,
-33274,
-32692,
-32101,
-31402,
-30583,
-29766,
-29112,
-28617,
-28134,
-27482,
-26636,
-25789,
-25151,
-24868,
-24895,
-25120,
-25476,
-25993,
-26838,
-28173,
-29976,
-31989,
-33800,
-35288,
-36625,
-38166,
-39890,
-41370,
-42143,
-42189,
-41923,
-41710,
-41437,
-40738,
-39472,
-37950,
-36632,
-35657,
-34811,
-33870,
-32843,
-31952,
-31375,
-31089,
-30966,
-30810,
-30512,
-30040,
-29552,
-29197,
-29007,
-28818,
-28452,
-27981,
-27659,
-27686,
-27947,
-28152,
-28116,
-27937,
-27869,
-28046,
-28363,
-28616,
-28713,
-28778,
-29017,
-29489,
-30025,
-30424,
-30695,
-31098,
-31810,
-32691,
-33363,
-33693,
-33981,
-34649,
-35748,
-36846,
-37545,
-37909,
-38403,
-39309,
-40388,
-41122,
-41209,
-40884,
-40563,
-40471,
-40376,
-39852,
-38656,
-36982,
-35303,
-33970,
-32949,
-31913,
-30654,
-29354,
-28426,
-28098,
-28228,
-28453,
-28580,
-28724,
-29063,
-29635,
-30198,
-30485,
-30384,
-30057,
-29772,
-29696,
-29756,
-29765,
-29616,
-29458,
-29479,
-29764,
-30130,
-30399,
-30490,
-30497,
-30460,
-30364,
-30148,
-29902,
-29721,
-29652,
-29615,
-29468,
-29218,
-28930,
-28790,
-28863,
-29204,
-29768,
-30619,
-31872,
-33602,
-35703,
-37845,
-39756,
-41398,
-42943,
-44447,
-45674,
-46304,
-46243,
-45724,
-44960,
-43902,
-42358,
-40291,
-38011,
-35863,
-34009,
-32374,
-30870,
-29566,
-28538,
-27826,
-27351,
-27036,
-26805,
-26586,
-26333,
-26112,
-26027,
-26094,
-26142,
-25976,
-25612,
-25343,
-25444,
-25942,
-26525,
-26922,
-27159,
-27547,
-28350,
-29470,
-30517,
-31148,
-31415,
-31640,
-32119,
-32774,
-33316,
-33574,
-33718,
-34070,
-34728,
-35498,
-36091,
-36494,
-36907,
-37522,
-38294,
-39025,
-39604,
-40074,
-40513,
-40864,
-40967,
-40688,
-40072,
-39274,
-38444,
-37650,
-36826,
-35903,
-34853,
-33756,
-32758,
-31900,
-31133,
-30288,
-29336,
-28363,
-27571,
-27050,
-26739,
-26495,
-26253,
-26094,
-26180,
-26562,
-27135,
-27684,
-28130,
-28568,
-29178,
-29962,
-30719,
-31229,
-31534,
-31818,
-32215,
-32593,
-32759,
-32735,
-32763,
-32989,
-33314,
-33487,
-33487,
-33494,
-33663,
-33906,
-34030,
-34029,
-34096,
-34365,
-34752,
-35070,
-35299,
-35591,
-36077,
-36623,
-37024,
-37192,
-37254,
-37382,
-37503,
-37392,
-36849,
-35953,
-35004,
-34260,
-33709,
-33119,
-32308,
-31345,
-30481,
-29846,
-29349,
-28802,
-28187,
-27681,
-27412,
-27276,
-27043,
-26577,
-26059,
-25761,
-25848,
-26237,
-26720,
-27168,
-27659,
-28334,
-29348,
-30609,
-31998,
-33406,
-34904,
-36662,
-38685,
-40769,
-42559,
-43762,
-44297,
-44267,
-43854,
-43207,
-42334,
-41149,
-39567,
-37698,
-35777,
-34029,
-32467,
-31029,
-29717,
-28699,
-28117,
-27910,
-27933,
-28074,
-28319,
-28579,
-28694,
-28567,
-28368,
-28310,
-28434,
-28534,
-28426,
-28171,
-27948,
-27858,
-27867,
-27953,
-28191,
-28595,
-29062,
-29514,
-30027,
-30752,
-31631,
-32403,
-32867,
-33179,
-33613,
-34236,
-34763,
-34921,
-34774,
-34657,
-34841,
-35291,
-35839,
-36377,
-36963,
-37632,
-38386,
-39103,
-39686,
-40025,
-40079,
-39890,
-39554,
-39111,
-38468,
-37511,
-36258,
-34900,
-33676,
-32674,
-31815,
-30981,
-30141,
-29384,
-28873,
-28714,
-28915,
-29313,
-29671,
-29812,
-29730,
-29583,
-29478,
-29431,
-29313,
-29094,
-28826,
-28677,
-28706,
-28904,
-29162,
-29407,
-29575,
-29667,
-29691,
-29698,
-29717,
-29722,
-29660,
-29535,
-29453,
-29501,
-29670,
-29765,
-29738,
-29688,
-29935,
-30602,
-31597,
-32648,
-33668,
-34755,
-36075,
-37663,
-39402,
-41159,
-42799,
-44176,
-45153,
-45683,
-45816,
-45552,
-44790,
-43382,
-41448,
-39297,
-37249,
-35352,
-33445,
-31482,
-29620,
-28121,
-27061,
-26308,
-25728,
-25281,
-25058,
-25064,
-25261,
-25584,
-26005,
-26466,
-26863,
-27095,
-27224,
-27413,
-27760,
-28188,
-28473,
-28569,
-28648,
-28976,
-29589,
-30281,
-30805,
-31206,
-31681,
-32354,
-33094,
-33661,
-34036,
-34354,
-34718,
-35045,
-35220,
-35307,
-35496,
-35887,
-36384,
-36858,
-37308,
-37784,
-38235,
-38545,
-38656,
-38671,
-38662,
-38560,
-38267,
-37811,
-37336,
-36883,
-36322,
-35534,
-34592,
-33635,
-32730,
-31737,
-30662,
-29618,
-28780,
-28117,
-27499,
-26895,
-26465,
-26307,
-26404,
-26611,
-26932,
-27429,
-28101,
-28828,
-29529,
-30269,
-31105,
-31974,
-32693,
-33224,
-33682,
-34141,
-34494,
-34561,
-34344,
-34075,
-33907,
-33834,
-33667,
-33405,
-33180,
-33167,
-33361,
-33617,
-33820,
-33945,
-34044,
-34161,
-34279,
-34397,
-34507,
-34665,
-34904,
-35224,
-35495,
-35573,
-35393,
-35031,
-34661,
-34324,
-33954,
-33435,
-32800,
-32198,
-31793,
-31573,
-31431,
-31213,
-30898,
-30530,
-30193,
-29936,
-29721,
-29483,
-29091,
-28492,
-27749,
-27071,
-26675,
-26650,
-26871,
-27193,
-27576,
-28136,
-28975,
-29999,
-31069,
-32101,
-33231,
-34653,
-36439,
-38547,
-40794,
-42957,
-44692,
-45681,
-45832,
-45348,
-44536,
-43526,
-42178,
-40413,
-38383,
-36361,
-34477,
-32615,
-30690,
-28885,
-27492,
-26687,
-26319,
-26156,
-26075,
-26064,
-26155,
-26284,
-26424,
-26543,
-26615,
-26571,
-26382,
-26168,
-26087,
-26237,
-26520,
-26795,
-27000,
-27262,
-27783,
-28706,
-29975,
-31342,
-32536,
-33465,
-34304,
-35285,
-36435,
-37517,
-38238,
-38581,
-38673,
-38701,
-38632,
-38429,
-38136,
-37857,
-37658,
-37491,
-37386,
-37421,
-37570,
-37620,
-37297,
-36633,
-35949,
-35537,
-35351,
-35087,
-34577,
-33922,
-33308,
-32752,
-32113,
-31384,
-30668,
-30086,
-29567,
-29057,
-28636,
-28514,
-28657,
-28777,
-28537,
-27987,
-27496,
-27410,
-27676,
-28004,
-28228,
-28493,
-29070,
-29958,
-30919,
-31660,
-32170,
-32604,
-33069,
-33447,
-33550,
-33320,
-32851,
-32289,
-31662,
-31023,
-30475,
-30131,
-29981,
-29891,
-29889,
-30155,
-30906,
-31962,
-32955,
-33707,
-34547,
-35977,
-37999,
-40012,
-41341,
-41902,
-42184,
-42564,
-42886,
-42602,
-41483,
-39798,
-38092,
-36617,
-35312,
-33945,
-32496,
-31101,
-29985,
-29251,
-28831,
-28532,
-28178,
-27781,
-27485,
-27394,
-27420,
-27388,
-27289,
-27341,
-27741,
-28395,
-29004,
-29340,
-29520,
-29823,
-30340,
-30909,
-31247,
-31360,
-31456,
-31802,
-32356,
-32821,
-32892,
-32527,
-32001,
-31652,
-31624,
-31773,
-31909,
-32001,
-32201,
-32667,
-33346,
-34069,
-34700,
-35275,
-35897,
-36602,
-37321,
-37959,
-38461,
-38796,
-38900,
-38730,
-38287,
-37657,
-36916,
-36109,
-35288,
-34533,
-33923,
-33385,
-32772,
-31968,
-31064,
-30266,
-29650,
-29121,
-28513,
-27878,
-27399,
-27189,
-27160,
-27131,
-27111,
-27260,
-27668,
-28296,
-29012,
-29897,
-31045,
-32406,
-33705,
-34703,
-35424,
-36040,
-36588,
-36843,
-36672,
-36152,
-35590,
-35142,
-34747,
-34287,
-33752,
-33249,
-32862,
-32612,
-32524,
-32594,
-32764,
-32915,
-33019,
-33171,
-33434,
-33716,
-33822,
-33731,
-33581,
-33516,
-33455,
-33229,
-32848,
-32514,
-32356,
-32278,
-32092,
-31822,
-31673,
-31702,
-31733,
-31511,
-31130,
-30893,
-30992,
-31222,
-31255,
-30959,
-30548,
-30197,
-29880,
-29415,
-28780,
-28182,
-27787,
-27647,
-27606,
-27639,
-27772,
-28115,
-28676,
-29427,
-30273,
-31109,
-31937,
-32998,
-34715,
-37313,
-40473,
-43475,
-45783,
-47430,
-48698,
-49553,
-49484,
-48153,
-45893,
-43470,
-41276,
-38992,
-36169,
-32961,
-30078,
-28019,
-26570,
-25194,
-23810,
-22898,
-22892,
-23588,
-24315,
-24609,
-24549,
-24491,
-24578,
-24674,
-24600,
-24373,
-24121,
-23975,
-23977,
-24228,
-24786,
-25664,
-26783,
-28134,
-29837,
-31951,
-34258,
-36281,
-37675,
-38591,
-39520,
-40752,
-41985,
-42601,
-42361,
-41673,
-41186,
-41022,
-40753,
-39920,
-38703,
-37679,
-37206,
-37036,
-36696,
-36096,
-35552,
-35302,
-35176,
-34786,
-34024,
-33151,
-32441,
-31898,
-31329,
-30611,
-29830,
-29090,
-28463,
-27954,
-27629,
-27472,
-27378,
-27196,
-26940,
-26816,
-26971,
-27403,
-27901,
-28400,
-28935,
-29609,
-30361,
-31053,
-31632,
-32178,
-32836,
-33604,
-34373,
-35044,
-35609,
-36108,
-36506,
-36679,
-36527,
-36115,
-35588,
-35098,
-34616,
-34030,
-33301,
-32531,
-31932,
-31578,
-31383,
-31175,
-30910,
-30675,
-30553,
-30484,
-30299,
-30003,
-29793,
-30002,
-30706,
-31699,
-32621,
-33331,
-33974,
-34751,
-35648,
-36359,
-36611,
-36478,
-36336,
-36516,
-36956,
-37218,
-36987,
-36338,
-35671,
-35270,
-34995,
-34550,
-33830,
-33113,
-32683,
-32547,
-32400,
-32015,
-31461,
-30958,
-30643,
-30416,
-30167,
-29823,
-29461,
-29127,
-28940,
-28957,
-29119,
-29227,
-29089,
-28811,
-28726,
-29039,
-29580,
-29972,
-30085,
-30184,
-30534,
-31092,
-31525,
-31697,
-31813,
-32168,
-32745,
-33276,
-33558,
-33733,
-34065,
-34683,
-35442,
-36155,
-36713,
-37187,
-37629,
-38084,
-38488,
-38723,
-38672,
-38316,
-37768,
-37175,
-36546,
-35763,
-34734,
-33533,
-32374,
-31408,
-30634,
-29951,
-29331,
-28854,
-28630,
-28636,
-28703,
-28650,
-28444,
-28265,
-28322,
-28660,
-29132,
-29539,
-29896,
-30332,
-30975,
-31717,
-32345,
-32748,
-33018,
-33354,
-33836,
-34354,
-34754,
-34959,
-35079,
-35217,
-35363,
-35362,
-35073,
-34577,
-34132,
-33962,
-34011,
-34011,
-33778,
-33377,
-33076,
-33022,
-33148,
-33292,
-33398,
-33509,
-33713,
-33972,
-34204,
-34313,
-34244,
-34002,
-33661,
-33307,
-32968,
-32551,
-31995,
-31344,
-30805,
-30470,
-30273,
-30014,
-29648,
-29310,
-29165,
-29178,
-29148,
-28900,
-28498,
-28156,
-28056,
-28144,
-28240,
-28186,
-28097,
-28193,
-28672,
-29384,
-30081,
-30569,
-31021,
-31725,
-32845,
-34249,
-35690,
-37074,
-38455,
-39948,
-41509,
-43012,
-44286,
-45153,
-45512,
-45327,
-44693,
-43725,
-42396,
-40668,
-38581,
-36414,
-34439,
-32696,
-31005,
-29282,
-27752,
-26753,
-26383,
-26320,
-26178,
-25846,
-25598,
-25741,
-26260,
-26823,
-27028,
-26800,
-26379,
-26105,
-26082,
-26114,
-25975,
-25683,
-25513,
-25675,
-26062,
-26432,
-26741,
-27300,
-28359,
-29756,
-30969,
-31690,
-32147,
-32825,
-33891,
-34972,
-35645,
-35945,
-36402,
-37522,
-39263,
-41123,
-42561,
-43482,
-44180,
-45039,
-46108,
-47093,
-47561,
-47295,
-46434,
-45201,
-43692,
-41760,
-39292,
-36465,
-33658,
-31183,
-29026,
-27035,
-25162,
-23601,
-22584,
-22167,
-22158,
-22325,
-22518,
-22754,
-23125,
-23697,
-24417,
-25110,
-25584,
-25807,
-25949,
-26244,
-26754,
-27299,
-27703,
-27970,
-28350,
-29034,
-29976,
-30922,
-31692,
-32333,
-33044,
-33905,
-34778,
-35407,
-35715,
-35865,
-36157,
-36737,
-37510,
-38229,
-38763,
-39176,
-39676,
-40398,
-41266,
-42048,
-42521,
-42632,
-42520,
-42331,
-42048,
-41484,
-40459,
-39032,
-37450,
-35927,
-34457,
-32846,
-31061,
-29271,
-27786,
-26718,
-25937,
-25247,
-24617,
-24177,
-24042,
-24170,
-24386,
-24626,
-24914,
-25407,
-26119,
-26967,
-27800,
-28533,
-29208,
-29895,
-30617,
-31345,
-32042,
-32714,
-33340,
-33865,
-34190,
-34292,
-34244,
-34087,
-33886,
-33628,
-33398,
-33287,
-33300,
-33417,
-33588,
-33896,
-34336,
-34799,
-35062,
-35124,
-35236,
-35694,
-36493,
-37283,
-37755,
-37911,
-38008,
-38201,
-38330,
-38116,
-37459,
-36517,
-35591,
-34776,
-34056,
-33248,
-32324,
-31326,
-30429,
-29698,
-29146,
-28636,
-28151,
-27759,
-27653,
-27911,
-28421,
-28948,
-29314,
-29589,
-29974,
-30613,
-31401,
-32074,
-32476,
-32709,
-33009,
-33444,
-33811,
-33858,
-33579,
-33218,
-32990,
-32861,
-32703,
-32464,
-32280,
-32226,
-32234,
-32182,
-32067,
-31933,
-31807,
-31640,
-31509,
-31533,
-31762,
-32013,
-32143,
-32254,
-32639,
-33345,
-34088,
-34497,
-34614,
-34809,
-35326,
-35997,
-36411,
-36389,
-36072,
-35709,
-35355,
-34966,
-34470,
-33898,
-33287,
-32703,
-32230,
-31919,
-31704,
-31399,
-30959,
-30477,
-30140,
-29955,
-29796,
-29553,
-29277,
-29023,
-28800,
-28560,
-28415,
-28522,
-28977,
-29656,
-30440,
-31337,
-32457,
-33747,
-34945,
-35813,
-36338,
-36767,
-37254,
-37763,
-38089,
-38119,
-37875,
-37447,
-36909,
-36278,
-35587,
-34895,
-34216,
-33615,
-33100,
-32733,
-32481,
-32266,
-31993,
-31645,
-31293,
-31008,
-30789,
-30574,
-30334,
-30113,
-29979,
-29952,
-29960,
-29946,
-29915,
-29947,
-30113,
-30385,
-30679,
-30911,
-31061,
-31174,
-31255,
-31281,
-31215,
-31071,
-30968,
-30943,
-30984,
-30944,
-30776,
-30565,
-30462,
-30521,
-30642,
-30738,
-30825,
-31033,
-31367,
-31730,
-32046,
-32423,
-33091,
-34117,
-35346,
-36548,
-37595,
-38542,
-39387,
-40049,
-40498,
-40752,
-40943,
-41014,
-40813,
-40243,
-39343,
-38268,
-37102,
-35842,
-34523,
-33256,
-32140,
-31194,
-30396,
-29757,
-29309,
-29015,
-28751,
-28501,
-28362,
-28484,
-28790,
-29077,
-29182,
-29176,
-29193,
-29188,
-28989,
-28535,
-28045,
-27772,
-27700,
-27528,
-27067,
-26474,
-26111,
-26114,
-26292,
-26379,
-26371,
-26524,
-27007,
-27793,
-28695,
-29621,
-30578,
-31625,
-32793,
-34191,
-35897,
-37893,
-39945,
-41775,
-43320,
-44687,
-46010,
-47161,
-47914,
-48113,
-47854,
-47270,
-46381,
-45064,
-43276,
-41159,
-38967,
-36849,
-34774,
-32669,
-30593,
-28734,
-27264,
-26174,
-25281,
-24502,
-23823,
-23382,
-23111,
-22899,
-22619,
-22400,
-22400,
-22681,
-23043,
-23326,
-23520,
-23844,
-24418,
-25205,
-26053,
-26882,
-27739,
-28669,
-29698,
-30771,
-31843,
-32822,
-33636,
-34268,
-34809,
-35346,
-35965,
-36627,
-37348,
-38097,
-38810,
-39429,
-39983,
-40635,
-41466,
-42310,
-42865,
-43000,
-42947,
-42980,
-43104,
-42968,
-42284,
-41073,
-39655,
-38237,
-36806,
-35234,
-33499,
-31748,
-30154,
-28820,
-27730,
-26763,
-25811,
-24869,
-24117,
-23755,
-23817,
-24091,
-24349,
-24580,
-24969,
-25666,
-26552,
-27390,
-28027,
-28571,
-29225,
-30053,
-30957,
-31727,
-32285,
-32683,
-33002,
-33242,
-33297,
-33135,
-32868,
-32698,
-32699,
-32807,
-32923,
-33059,
-33276,
-33536,
-33713,
-33786,
-33894,
-34173,
-34562,
-34917,
-35244,
-35783,
-36646,
-37671,
-38496,
-39030,
-39396,
-39755,
-39945,
-39758,
-39183,
-38463,
-37779,
-37067,
-36151,
-35007,
-33738,
-32430,
-31095,
-29802,
-28688,
-27860,
-27239,
-26766,
-26468,
-26484,
-26781,
-27143,
-27404,
-27610,
-27940,
-28456,
-29053,
-29638,
-30264,
-30998,
-31818,
-32553,
-33088,
-33390,
-33493,
-33493,
-33476,
-33572,
-33766,
-33972,
-34075,
-34091,
-34090,
-34062,
-33927,
-33625,
-33219,
-32808,
-32445,
-32161,
-32042,
-32142,
-32399,
-32617,
-32747,
-32923,
-33352,
-33997,
-34662,
-35198,
-35712,
-36319,
-36966,
-37374,
-37378,
-37014,
-36444,
-35766,
-34949,
-33992,
-32927,
-31855,
-30894,
-30152,
-29695,
-29387,
-29047,
-28594,
-28214,
-28135,
-28323,
-28462,
-28250,
-27763,
-27307,
-27150,
-27232,
-27365,
-27450,
-27586,
-27948,
-28687,
-29820,
-31267,
-32807,
-34233,
-35551,
-36959,
-38666,
-40562,
-42245,
-43325,
-43756,
-43734,
-43480,
-42982,
-42106,
-40800,
-39173,
-37416,
-35714,
-34146,
-32744,
-31501,
-30398,
-29499,
-28846,
-28500,
-28377,
-28387,
-28438,
-28528,
-28669,
-28831,
-28931,
-28906,
-28730,
-28485,
-28247,
-28101,
-27994,
-27812,
-27485,
-27078,
-26834,
-26864,
-27113,
-27363,
-27574,
-27935,
-28655,
-29663,
-30647,
-31351,
-31885,
-32521,
-33392,
-34309,
-35025,
-35501,
-35968,
-36616,
-37485,
-38431,
-39386,
-40307,
-41165,
-41857,
-42303,
-42502,
-42506,
-42284,
-41754,
-40813,
-39496,
-37927,
-36247,
-34591,
-33003,
-31563,
-30266,
-29134,
-28168,
-27407,
-26941,
-26804,
-26995,
-27402,
-27900,
-28382,
-28745,
-28958,
-28995,
-28934,
-28882,
-28907,
-28958,
-28956,
-28918,
-29032,
-29437,
-30088,
-30703,
-31082,
-31236,
-31346,
-31514,
-31671,
-31727,
-31674,
-31557,
-31353,
-30954,
-30414,
-29912,
-29664,
-29648,
-29676,
-29635,
-29712,
-30225,
-31418,
-33163,
-35134,
-37007,
-38722,
-40463,
-42367,
-44291,
-45747,
-46339,
-46019,
-45151,
-44036,
-42659,
-40800,
-38465,
-36004,
-33852,
-32149,
-30733,
-29431,
-28265,
-27362,
-26829,
-26629,
-26673,
-26831,
-26967,
-27071,
-27233,
-27592,
-28056,
-28381,
-28395,
-28226,
-28161,
-28330,
-28612,
-28851,
-29076,
-29418,
-29913,
-30417,
-30795,
-31030,
-31162,
-31236,
-31252,
-31231,
-31180,
-31030,
-30811,
-30680,
-30865,
-31377,
-31955,
-32412,
-32873,
-33740,
-35119,
-36750,
-38196,
-39358,
-40378,
-41388,
-42206,
-42637,
-42664,
-42403,
-41903,
-41049,
-39843,
-38466,
-37135,
-35844,
-34432,
-32881,
-31389,
-30202,
-29308,
-28524,
-27720,
-27018,
-26570,
-26426,
-26392,
-26353,
-26323,
-26469,
-26895,
-27532,
-28232,
-28878,
-29483,
-30102,
-30778,
-31474,
-32145,
-32714,
-33112,
-33260,
-33194,
-33069,
-33058,
-33192,
-33259,
-33105,
-32725,
-32387,
-32239,
-32267,
-32271,
-32223,
-32205,
-32353,
-32613,
-32892,
-33203,
-33669,
-34356,
-35132,
-35789,
-36302,
-36811,
-37443,
-38072,
-38405,
-38265,
-37760,
-37151,
-36587,
-35969,
-35114,
-34025,
-32937,
-32110,
-31580,
-31142,
-30567,
-29833,
-29122,
-28617,
-28336,
-28144,
-27867,
-27433,
-26898,
-26408,
-26136,
-26179,
-26472,
-26815,
-27049,
-27222,
-27590,
-28393,
-29631,
-31081,
-32556,
-34113,
-35983,
-38236,
-40557,
-42418,
-43455,
-43782,
-43745,
-43580,
-43148,
-42199,
-40690,
-38907,
-37149,
-35501,
-33855,
-32208,
-30779,
-29821,
-29341,
-29130,
-28992,
-28930,
-29072,
-29413,
-29774,
-29951,
-29899,
-29747,
-29626,
-29537,
-29339,
-28907,
-28231,
-27478,
-26855,
-26500,
-26364,
-26335,
-26348,
-26514,
-27015,
-27895,
-28999,
-30057,
-30895,
-31605,
-32357,
-33290,
-34303,
-35191,
-35770,
-36054,
-36191,
-36403,
-36819,
-37422,
-38093,
-38697,
-39210,
-39760,
-40413,
-41084,
-41446,
-41263,
-40572,
-39672,
-38851,
-38048,
-37076,
-35792,
-34334,
-32933,
-31694,
-30608,
-29645,
-28854,
-28244,
-27809,
-27581,
-27654,
-28041,
-28494,
-28704,
-28577,
-28396,
-28427,
-28656,
-28791,
-28700,
-28592,
-28743,
-29170,
-29651,
-30023,
-30372,
-30791,
-31208,
-31454,
-31509,
-31506,
-31533,
-31510,
-31361,
-31128,
-30919,
-30695,
-30350,
-29944,
-29710,
-29878,
-30362,
-30998,
-31740,
-32789,
-34243,
-35944,
-37619,
-39210,
-40821,
-42496,
-43933,
-44807,
-44980,
-44636,
-43975,
-42975,
-41525,
-39583,
-37367,
-35202,
-33297,
-31709,
-30324,
-29074,
-27974,
-27150,
-26688,
-26547,
-26587,
-26665,
-26776,
-26980,
-27314,
-27735,
-28136,
-28432,
-28591,
-28656,
-28721,
-28871,
-29100,
-29334,
-29519,
-29733,
-30112,
-30690,
-31312,
-31776,
-32005,
-32108,
-32218,
-32368,
-32495,
-32534,
-32517,
-32502,
-32603,
-32865,
-33307,
-33835,
-34327,
-34786,
-35324,
-36106,
-37087,
-38054,
-38773,
-39223,
-39534,
-39801,
-39948,
-39763,
-39140,
-38155,
-37015,
-35965,
-35072,
-34298,
-33474,
-32508,
-31438,
-30405,
-29537,
-28815,
-28125,
-27426,
-26784,
-26391,
-26367,
-26703,
-27245,
-27831,
-28381,
-28950,
-29671,
-30571,
-31550,
-32395,
-33004,
-33452,
-33891,
-34382,
-34759,
-34843,
-34565,
-34078,
-33607,
-33243,
-32983,
-32728,
-32482,
-32310,
-32228,
-32228,
-32191,
-32100,
-31976,
-31926,
-32003,
-32233,
-32615,
-33127,
-33730,
-34310,
-34777,
-35118,
-35419,
-35742,
-36035,
-36163,
-36036,
-35695,
-35254,
-34826,
-34432,
-34040,
-33586,
-32989,
-32305,
-31663,
-31253,
-31078,
-30965,
-30722,
-30343,
-30002,
-29726,
-29378,
-28758,
-27913,
-27121,
-26604,
-26382,
-26327,
-26449,
-26783,
-27343,
-27957,
-28479,
-28932,
-29499,
-30426,
-31944,
-34226,
-37255,
-40638,
-43717,
-45908,
-47057,
-47362,
-47051,
-46177,
-44726,
-42829,
-40771,
-38723,
-36739,
-34749,
-32746,
-30782,
-28932,
-27376,
-26367,
-26129,
-26558,
-27266,
-27826,
-28113,
-28302,
-28537,
-28710,
-28547,
-27969,
-27173,
-26535,
-26162,
-25898,
-25477,
-24917,
-24562,
-24813,
-25747,
-27075,
-28439,
-29735,
-31095,
-32610,
-34111,
-35364,
-36292,
-37079,
-37879,
-38646,
-39119,
-39169,
-38872,
-38498,
-38246,
-38168,
-38164,
-38114,
-37946,
-37700,
-37477,
-37368,
-37334,
-37255,
-36983,
-36499,
-35886,
-35292,
-34776,
-34263,
-33564,
-32538,
-31286,
-30116,
-29346,
-29005,
-28832,
-28548,
-28146,
-27832,
-27790,
-27921,
-28070,
-28134,
-28267,
-28559,
-29016,
-29487,
-29884,
-30237,
-30612,
-31067,
-31568,
-32067,
-32519,
-32951,
-33427,
-34018,
-34634,
-35082,
-35167,
-34912,
-34535,
-34230,
-33951,
-33447,
-32604,
-31552,
-30693,
-30247,
-30137,
-30049,
-29759,
-29355,
-29125,
-29294,
-29856,
-30637,
-31538,
-32591,
-33877,
-35328,
-36741,
-37884,
-38663,
-39114,
-39342,
-39455,
-39482,
-39390,
-39052,
-38410,
-37520,
-36531,
-35516,
-34456,
-33346,
-32373,
-31764,
-31551,
-31467,
-31176,
-30642,
-30076,
-29727,
-29578,
-29462,
-29268,
-29031,
-28844,
-28715,
-28609,
-28508,
-28418,
-28360,
-28399,
-28629,
-29128,
-29807,
-30500,
-31113,
-31710,
-32371,
-32979,
-33338,
-33381,
-33289,
-33261,
-33254,
-33062,
-32635,
-32175,
-31972,
-32046,
-32207,
-32338,
-32590,
-33224,
-34285,
-35462,
-36359,
-36823,
-37064,
-37491,
-38255,
-39129,
-39594,
-39358,
-38594,
-37795,
-37263,
-36746,
-35804,
-34303,
-32694,
-31526,
-30887,
-30329,
-29452,
-28370,
-27585,
-27396,
-27574,
-27629,
-27330,
-26888,
-26665,
-26817,
-27195,
-27546,
-27766,
-27967,
-28413,
-29289,
-30578,
-31960,
-33133,
-33985,
-34737,
-35624,
-36628,
-37492,
-38005,
-38230,
-38360,
-38429,
-38264,
-37724,
-36914,
-36086,
-35367,
-34648,
-33829,
-33008,
-32443,
-32238,
-32240,
-32162,
-31938,
-31725,
-31740,
-31984,
-32274,
-32430,
-32480,
-32552,
-32720,
-32874,
-32858,
-32611,
-32258,
-31949,
-31785,
-31717,
-31668,
-31522,
-31247,
-30827,
-30343,
-29892,
-29499,
-29148,
-28761,
-28393,
-28132,
-28070,
-28150,
-28231,
-28187,
-28033,
-27896,
-27989,
-28378,
-28995,
-29596,
-30109,
-30757,
-31960,
-33919,
-36268,
-38398,
-39926,
-41081,
-42263,
-43505,
-44382,
-44485,
-43975,
-43395,
-43056,
-42704,
-41793,
-40130,
-38046,
-36061,
-34394,
-32916,
-31461,
-30102,
-29128,
-28709,
-28687,
-28684,
-28400,
-27879,
-27438,
-27349,
-27554,
-27747,
-27609,
-27124,
-26495,
-25956,
-25575,
-25316,
-25141,
-25082,
-25204,
-25508,
-25989,
-26600,
-27334,
-28167,
-29053,
-29909,
-30625,
-31140,
-31514,
-31905,
-32443,
-33142,
-33848,
-34543,
-35349,
-36563,
-38237,
-40089,
-41641,
-42656,
-43388,
-44297,
-45545,
-46713,
-47167,
-46669,
-45566,
-44384,
-43164,
-41524,
-39127,
-36307,
-33752,
-31906,
-30525,
-29109,
-27489,
-26047,
-25221,
-25063,
-25227,
-25401,
-25502,
-25654,
-25877,
-26118,
-26293,
-26377,
-26339,
-26170,
-25901,
-25668,
-25603,
-25711,
-25918,
-26147,
-26450,
-26934,
-27636,
-28470,
-29320,
-30118,
-30928,
-31770,
-32631,
-33378,
-33969,
-34400,
-34780,
-35131,
-35522,
-36041,
-36827,
-37893,
-39047,
-40066,
-40939,
-41872,
-42987,
-44038,
-44602,
-44508,
-44006,
-43509,
-43050,
-42373,
-41167,
-39473,
-37533,
-35540,
-33544,
-31568,
-29737,
-28150,
-26864,
-25856,
-25181,
-24856,
-24798,
-24826,
-24841,
-24952,
-25263,
-25757,
-26235,
-26602,
-26923,
-27352,
-27862,
-28325,
-28623,
-28862,
-29222,
-29773,
-30404,
-30914,
-31252,
-31560,
-31984,
-32554,
-33043,
-33262,
-33249,
-33244,
-33474,
-33865,
-34175,
-34294,
-34331,
-34520,
-34874,
-35267,
-35590,
-35890,
-36265,
-36712,
-37192,
-37757,
-38476,
-39259,
-39823,
-39913,
-39603,
-39104,
-38525,
-37703,
-36516,
-35137,
-33934,
-33072,
-32340,
-31406,
-30229,
-29080,
-28271,
-27841,
-27640,
-27552,
-27621,
-27941,
-28476,
-29118,
-29699,
-30187,
-30540,
-30798,
-31015,
-31279,
-31640,
-31996,
-32165,
-32045,
-31759,
-31523,
-31477,
-31499,
-31446,
-31296,
-31235,
-31421,
-31778,
-32111,
-32249,
-32261,
-32248,
-32273,
-32272,
-32229,
-32212,
-32307,
-32534,
-32841,
-33178,
-33548,
-33977,
-34477,
-35111,
-35841,
-36638,
-37343,
-37888,
-38243,
-38443,
-38413,
-38071,
-37425,
-36616,
-35806,
-34987,
-34095,
-33121,
-32195,
-31388,
-30656,
-29919,
-29273,
-28853,
-28668,
-28503,
-28182,
-27773,
-27456,
-27265,
-27015,
-26659,
-26380,
-26452,
-26818,
-27188,
-27464,
-27935,
-29031,
-30701,
-32481,
-33928,
-35097,
-36365,
-37908,
-39426,
-40477,
-40908,
-40938,
-40861,
-40722,
-40353,
-39607,
-38530,
-37326,
-36197,
-35253,
-34469,
-33774,
-33128,
-32577,
-32219,
-32079,
-32021,
-31824,
-31370,
-30785,
-30333,
-30149,
-30070,
-29793,
-29206,
-28573,
-28272,
-28409,
-28674,
-28707,
-28496,
-28366,
-28595,
-29018,
-29297,
-29262,
-29140,
-29216,
-29497,
-29782,
-29935,
-30040,
-30186,
-30305,
-30251,
-30101,
-30084,
-30398,
-30972,
-31659,
-32424,
-33380,
-34520,
-35718,
-36825,
-37869,
-38938,
-40000,
-40899,
-41502,
-41833,
-41895,
-41633,
-40958,
-39919,
-38728,
-37542,
-36427,
-35396,
-34514,
-33829,
-33248,
-32658,
-32103,
-31766,
-31748,
-31846,
-31754,
-31421,
-31033,
-30800,
-30590,
-30189,
-29551,
-28938,
-28563,
-28378,
-28170,
-27879,
-27661,
-27638,
-27722,
-27691,
-27482,
-27223,
-27057,
-26962,
-26817,
-26567,
-26326,
-26244,
-26374,
-26624,
-26842,
-27007,
-27255,
-27810,
-28797,
-30068,
-31476,
-33028,
-35053,
-37748,
-40846,
-43672,
-45662,
-46879,
-47778,
-48626,
-49166,
-48931,
-47796,
-46138,
-44388,
-42675,
-40810,
-38665,
-36359,
-34150,
-32218,
-30627,
-29394,
-28506,
-27910,
-27500,
-27247,
-27141,
-27159,
-27118,
-26876,
-26456,
-26074,
-25874,
-25777,
-25556,
-25143,
-24713,
-24551,
-24741,
-25153,
-25620,
-26065,
-26605,
-27236,
-27960,
-28647,
-29281,
-29880,
-30457,
-31041,
-31611,
-32210,
-32812,
-33349,
-33747,
-34038,
-34412,
-35066,
-36057,
-37235,
-38428,
-39580,
-40749,
-41922,
-42930,
-43522,
-43660,
-43540,
-43419,
-43340,
-43017,
-42165,
-40737,
-39054,
-37438,
-35950,
-34358,
-32492,
-30580,
-29069,
-28259,
-27940,
-27615,
-26995,
-26211,
-25687,
-25635,
-25951,
-26340,
-26631,
-26840,
-27104,
-27491,
-27996,
-28495,
-28846,
-28990,
-29054,
-29280,
-29755,
-30303,
-30640,
-30706,
-30780,
-31142,
-31736,
-32185,
-32199,
-31905,
-31689,
-31786,
-32068,
-32251,
-32268,
-32338,
-32714,
-33401,
-34154,
-34735,
-35142,
-35595,
-36314,
-37287,
-38290,
-39034,
-39448,
-39705,
-40023,
-40400,
-40502,
-39988,
-38831,
-37448,
-36324,
-35548,
-34798,
-33677,
-32277,
-31001,
-30221,
-29787,
-29304,
-28571,
-27833,
-27490,
-27670,
-28121,
-28513,
-28704,
-28791,
-28958,
-29323,
-29900,
-30504,
-30930,
-31060,
-31129,
-31451,
-32109,
-32734,
-32928,
-32682,
-32432,
-32537,
-32871,
-33020,
-32781,
-32371,
-32139,
-32175,
-32305,
-32337,
-32211,
-31965,
-31690,
-31554,
-31747,
-32280,
-32902,
-33361,
-33668,
-34102,
-34839,
-35697,
-36346,
-36682,
-36880,
-37140,
-37391,
-37393,
-37048,
-36494,
-35969,
-35521,
-35027,
-34326,
-33438,
-32554,
-31871,
-31402,
-30962,
-30404,
-29766,
-29318,
-29180,
-29222,
-29103,
-28644,
-27925,
-27147,
-26423,
-25748,
-25188,
-24845,
-24798,
-25013,
-25424,
-26067,
-26948,
-28023,
-29196,
-30531,
-32254,
-34566,
-37378,
-40351,
-43048,
-45170,
-46592,
-47330,
-47471,
-47039,
-46010,
-44383,
-42358,
-40272,
-38374,
-36568,
-34698,
-32765,
-31108,
-29974,
-29300,
-28838,
-28508,
-28494,
-28835,
-29271,
-29401,
-29147,
-28718,
-28288,
-27759,
-26959,
-25994,
-25142,
-24544,
-24084,
-23611,
-23281,
-23396,
-24102,
-25177,
-26303,
-27333,
-28337,
-29468,
-30697,
-31951,
-33106,
-34120,
-34994,
-35760,
-36455,
-37102,
-37664,
-38116,
-38451,
-38767,
-39155,
-39669,
-40235,
-40709,
-41015,
-41167,
-41237,
-41216,
-40958,
-40352,
-39414,
-38292,
-37095,
-35796,
-34382,
-32923,
-31591,
-30439,
-29452,
-28618,
-28076,
-27902,
-27990,
-28130,
-28243,
-28483,
-28954,
-29478,
-29748,
-29649,
-29394,
-29240,
-29179,
-29025,
-28728,
-28489,
-28564,
-28951,
-29456,
-29909,
-30345,
-30910,
-31615,
-32343,
-32913,
-33268,
-33459,
-33535,
-33436,
-33032,
-32297,
-31417,
-30707,
-30334,
-30186,
-29989,
-29666,
-29374,
-29420,
-29893,
-30700,
-31666,
-32740,
-33989,
-35492,
-37251,
-39095,
-40733,
-41873,
-42483,
-42778,
-42991,
-43050,
-42565,
-41339,
-39594,
-37899,
-36580,
-35508,
-34383,
-33142,
-32087,
-31493,
-31328,
-31277,
-31017,
-30476,
-29785,
-29187,
-28803,
-28595,
-28327,
-27821,
-27091,
-26381,
-25893,
-25617,
-25406,
-25214,
-25215,
-25601,
-26326,
-27174,
-27897,
-28529,
-29190,
-29948,
-30666,
-31174,
-31445,
-31647,
-31944,
-32328,
-32658,
-32864,
-33106,
-33601,
-34413,
-35378,
-36288,
-37170,
-38146,
-39260,
-40330,
-41118,
-41574,
-41805,
-41945,
-41981,
-41841,
-41437,
-40696,
-39587,
-38198,
-36746,
-35466,
-34340,
-33174,
-31845,
-30521,
-29484,
-28869,
-28419,
-27890,
-27172,
-26494,
-26087,
-26037,
-26208,
-26370,
-26377,
-26308,
-26393,
-26818,
-27504,
-28151,
-28610,
-29041,
-29757,
-30800,
-31860,
-32581,
-32928,
-33160,
-33471,
-33828,
-34046,
-34088,
-34026,
-34008,
-34079,
-34267,
-34514,
-34725,
-34803,
-34808,
-34900,
-35209,
-35614,
-35936,
-36121,
-36350,
-36746,
-37197,
-37417,
-37252,
-36834,
-36394,
-36067,
-35770,
-35353,
-34727,
-33923,
-33096,
-32393,
-31850,
-31366,
-30764,
-30066,
-29433,
-29069,
-28961,
-28916,
-28734,
-28399,
-28013,
-27691,
-27384,
-27024,
-26533,
-26037,
-25744,
-25837,
-26297,
-26907,
-27468,
-28016,
-28654,
-29418,
-30089,
-30620,
-31318,
-32765,
-35200,
-38271,
-41225,
-43581,
-45265,
-46423,
-47016,
-46886,
-46074,
-44871,
-43613,
-42337,
-40832,
-38948,
-36776,
-34601,
-32617,
-30882,
-29404,
-28282,
-27681,
-27599,
-27836,
-28030,
-27988,
-27767,
-27534,
-27339,
-27047,
-26512,
-25812,
-25117,
-24569,
-24131,
-23755,
-23561,
-23718,
-24315,
-25273,
-26447,
-27769,
-29177,
-30567,
-31812,
-32943,
-34066,
-35260,
-36358,
-37164,
-37582,
-37781,
-37933,
-38094,
-38156,
-38055,
-37870,
-37764,
-37867,
-38159,
-38529,
-38853,
-39086,
-39257,
-39385,
-39400,
-39149,
-38559,
-37662,
-36639,
-35584,
-34533,
-33467,
-32396,
-31377,
-30437,
-29615,
-28990,
-28580,
-28351,
-28142,
-27950,
-27888,
-28126,
-28554,
-28905,
-28970,
-28860,
-28842,
-29000,
-29170,
-29170,
-29093,
-29185,
-29582,
-30125,
-30586,
-30883,
-31167,
-31522,
-31957,
-32323,
-32575,
-32716,
-32771,
-32716,
-32519,
-32196,
-31826,
-31498,
-31276,
-31186,
-31199,
-31273,
-31370,
-31533,
-31812,
-32308,
-33017,
-33938,
-35026,
-36253,
-37567,
-38869,
-40004,
-40856,
-41378,
-41651,
-41718,
-41533,
-40955,
-39931,
-38614,
-37269,
-36011,
-34737,
-33295,
-31782,
-30531,
-29780,
-29444,
-29125,
-28597,
-27934,
-27472,
-27365,
-27504,
-27635,
-27640,
-27615,
-27705,
-27937,
-28227,
-28482,
-28685,
-28903,
-29152,
-29399,
-29639,
-29882,
-30250,
-30722,
-31232,
-31614,
-31855,
-32017,
-32171,
-32274,
-32207,
-32019,
-31865,
-31941,
-32217,
-32568,
-32909,
-33361,
-34052,
-34970,
-35921,
-36796,
-37612,
-38507,
-39435,
-40261,
-40835,
-41157,
-41248,
-41050,
-40441,
-39465,
-38336,
-37268,
-36228,
-35019,
-33563,
-32085,
-30890,
-30059,
-29392,
-28639,
-27821,
-27100,
-26601,
-26289,
-26055,
-25918,
-25901,
-25976,
-26043,
-26084,
-26243,
-26648,
-27313,
-28066,
-28821,
-29586,
-30503,
-31615,
-32863,
-34090,
-35112,
-35837,
-36262,
-36525,
-36751,
-36973,
-37075,
-36961,
-36634,
-36218,
-35838,
-35507,
-35211,
-34895,
-34620,
-34449,
-34478,
-34681,
-34930,
-35035,
-34965,
-34852,
-34878,
-35019,
-35028,
-34755,
-34277,
-33886,
-33692,
-33535,
-33177,
-32567,
-31907,
-31368,
-31023,
-30766,
-30513,
-30175,
-29694,
-29128,
-28608,
-28293,
-28105,
-27849,
-27391,
-26833,
-26400,
-26153,
-25990,
-25860,
-25865,
-26149,
-26678,
-27259,
-27823,
-28478,
-29359,
-30409,
-31459,
-32456,
-33561,
-34978,
-36684,
-38531,
-40316,
-41954,
-43391,
-44575,
-45475,
-46157,
-46634,
-46838,
-46540,
-45647,
-44212,
-42496,
-40646,
-38669,
-36517,
-34223,
-32052,
-30237,
-28894,
-27873,
-26985,
-26154,
-25502,
-25149,
-25073,
-25073,
-24973,
-24765,
-24514,
-24275,
-23960,
-23567,
-23194,
-23034,
-23139,
-23430,
-23786,
-24247,
-24884,
-25713,
-26616,
-27524,
-28520,
-29717,
-31113,
-32506,
-33754,
-34882,
-36052,
-37344,
-38660,
-39897,
-41053,
-42224,
-43377,
-44323,
-44873,
-45040,
-45003,
-44879,
-44587,
-43960,
-42960,
-41780,
-40600,
-39453,
-38174,
-36619,
-34888,
-33185,
-31734,
-30498,
-29377,
-28274,
-27294,
-26582,
-26226,
-26127,
-26120,
-26076,
-25982,
-25892,
-25846,
-25830,
-25791,
-25688,
-25559,
-25504,
-25652,
-26021,
-26497,
-26949,
-27371,
-27932,
-28803,
-29936,
-31109,
-32097,
-32912,
-33727,
-34651,
-35580,
-36294,
-36671,
-36795,
-36834,
-36882,
-36902,
-36780,
-36479,
-36069,
-35723,
-35567,
-35572,
-35532,
-35252,
-34803,
-34466,
-34517,
-34841,
-35085,
-34990,
-34800,
-34938,
-35598,
-36381,
-36739,
-36519,
-36081,
-35849,
-35767,
-35420,
-34544,
-33388,
-32445,
-31915,
-31557,
-31006,
-30198,
-29397,
-28875,
-28681,
-28672,
-28692,
-28675,
-28652,
-28649,
-28724,
-28852,
-28974,
-28990,
-28893,
-28750,
-28671,
-28708,
-28900,
-29257,
-29791,
-30391,
-30982,
-31522,
-32107,
-32755,
-33389,
-33867,
-34221,
-34559,
-34958,
-35293,
-35417,
-35361,
-35273,
-35295,
-35373,
-35476,
-35643,
-35965,
-36419,
-36833,
-37102,
-37261,
-37364,
-37398,
-37232,
-36866,
-36392,
-35892,
-35342,
-34598,
-33693,
-32711,
-31828,
-31040,
-30316,
-29632,
-29067,
-28730,
-28627,
-28655,
-28696,
-28676,
-28658,
-28676,
-28682,
-28597,
-28428,
-28327,
-28384,
-28489,
-28466,
-28369,
-28526,
-29181,
-30165,
-31065,
-31734,
-32463,
-33601,
-35007,
-36218,
-36934,
-37355,
-37826,
-38356,
-38672,
-38606,
-38350,
-38139,
-37977,
-37674,
-37148,
-36536,
-35973,
-35507,
-35132,
-34906,
-34792,
-34611,
-34203,
-33660,
-33297,
-33186,
-33064,
-32581,
-31789,
-31054,
-30612,
-30285,
-29739,
-28958,
-28242,
-27865,
-27764,
-27669,
-27439,
-27172,
-27040,
-27097,
-27207,
-27216,
-27034,
-26764,
-26615,
-26755,
-27162,
-27592,
-27881,
-28079,
-28474,
-29302,
-30553,
-31986,
-33417,
-34784,
-36240,
-37930,
-39836,
-41724,
-43241,
-44164,
-44594,
-44775,
-44826,
-44596,
-43869,
-42701,
-41362,
-40069,
-38739,
-37192,
-35468,
-33822,
-32511,
-31474,
-30583,
-29796,
-29291,
-29139,
-29195,
-29186,
-28978,
-28632,
-28276,
-27961,
-27679,
-27441,
-27231,
-27016,
-26757,
-26483,
-26310,
-26288,
-26408,
-26604,
-26861,
-27202,
-27583,
-27951,
-28287,
-28630,
-28994,
-29330,
-29566,
-29738,
-29877,
-29951,
-29870,
-29706,
-29752,
-30254,
-31181,
-32279,
-33494,
-35080,
-37276,
-39857,
-42204,
-43906,
-45080,
-46097,
-47022,
-47509,
-47284,
-46500,
-45548,
-44565,
-43324,
-41563,
-39366,
-37046,
-34899,
-33029,
-31460,
-30194,
-29203,
-28392,
-27739,
-27302,
-27100,
-26991,
-26769,
-26423,
-26122,
-25973,
-25842,
-25512,
-24996,
-24541,
-24324,
-24263,
-24177,
-24046,
-24064,
-24386,
-24965,
-25649,
-26330,
-27012,
-27747,
-28633,
-29701,
-30908,
-31951,
-32598,
-32845,
-33061,
-33630,
-34556,
-35577,
-36478,
-37396,
-38597,
-40115,
-41661,
-42947,
-43878,
-44611,
-45217,
-45668,
-45803,
-45551,
-44887,
-43879,
-42598,
-41128,
-39467,
-37600,
-35565,
-33532,
-31704,
-30190,
-28924,
-27869,
-27023,
-26445,
-26062,
-25713,
-25312,
-24952,
-24802,
-24911,
-25162,
-25415,
-25642,
-25946,
-26336,
-26766,
-27094,
-27314,
-27524,
-27852,
-28356,
-28948,
-29544,
-30063,
-30547,
-31033,
-31519,
-31943,
-32262,
-32476,
-32671,
-32893,
-33147,
-33407,
-33634,
-33852,
-34075,
-34387,
-34845,
-35478,
-36213,
-36956,
-37665,
-38411,
-39231,
-40050,
-40685,
-41078,
-41300,
-41472,
-41453,
-41013,
-40002,
-38679,
-37382,
-36279,
-35170,
-33853,
-32368,
-31023,
-29992,
-29166,
-28337,
-27440,
-26698,
-26309,
-26306,
-26528,
-26785,
-27003,
-27208,
-27511,
-27972,
-28525,
-28981,
-29178,
-29216,
-29387,
-29871,
-30526,
-30971,
-31038,
-30925,
-30992,
-31374,
-31889,
-32294,
-32547,
-32759,
-33053,
-33438,
-33848,
-34207,
-34402,
-34380,
-34230,
-34178,
-34389,
-34754,
-35082,
-35279,
-35551,
-36056,
-36691,
-37157,
-37341,
-37465,
-37809,
-38311,
-38579,
-38321,
-37700,
-37108,
-36708,
-36226,
-35267,
-33821,
-32296,
-31136,
-30434,
-29887,
-29211,
-28355,
-27567,
-27065,
-26884,
-26830,
-26683,
-26358,
-25976,
-25761,
-25773,
-25897,
-25910,
-25862,
-26017,
-26665,
-27718,
-28825,
-29752,
-30645,
-31864,
-33490,
-35241,
-36773,
-38035,
-39228,
-40418,
-41417,
-41956,
-42017,
-41808,
-41496,
-41106,
-40554,
-39861,
-39083,
-38248,
-37310,
-36281,
-35244,
-34319,
-33545,
-32903,
-32396,
-31984,
-31629,
-31176,
-30612,
-29989,
-29468,
-29066,
-28669,
-28158,
-27576,
-27143,
-27011,
-27119,
-27220,
-27167,
-27075,
-27180,
-27566,
-27979,
-28152,
-28037,
-27914,
-28039,
-28353,
-28559,
-28498,
-28286,
-28276,
-28623,
-29234,
-29855,
-30342,
-30782,
-31410,
-32417,
-33762,
-35251,
-36649,
-38021,
-39553,
-41373,
-43260,
-44785,
-45681,
-45973,
-45844,
-45335,
-44409,
-43064,
-41496,
-39858,
-38173,
-36420,
-34653,
-33062,
-31688,
-30493,
-29441,
-28719,
-28525,
-28801,
-29226,
-29456,
-29468,
-29413,
-29379,
-29241,
-28820,
-28182,
-27548,
-27144,
-26931,
-26729,
-26420,
-26079,
-25894,
-25952,
-26179,
-26431,
-26678,
-26983,
-27420,
-27898,
-28258,
-28429,
-28485,
-28590,
-28819,
-29084,
-29291,
-29376,
-29463,
-29728,
-30341,
-31357,
-32725,
-34449,
-36628,
-39380,
-42560,
-45686,
-48169,
-49761,
-50601,
-51027,
-51089,
-50611,
-49406,
-47534,
-45224,
-42672,
-39942,
-37102,
-34223,
-31491,
-29051,
-27147,
-25913,
-25315,
-25080,
-24871,
-24612,
-24446,
-24509,
-24727,
-24852,
-24759,
-24503,
-24237,
-23988,
-23779,
-23596,
-23557,
-23680,
-23983,
-24428,
-25060,
-25876,
-26833,
-27820,
-28767,
-29691,
-30610,
-31567,
-32529,
-33469,
-34286,
-34927,
-35371,
-35713,
-36026,
-36357,
-36769,
-37387,
-38399,
-39760,
-41243,
-42495,
-43423,
-44101,
-44647,
-44978,
-44961,
-44595,
-43992,
-43243,
-42209,
-40737,
-38818,
-36666,
-34503,
-32436,
-30492,
-28740,
-27311,
-26283,
-25625,
-25237,
-25032,
-24921,
-24836,
-24772,
-24802,
-25049,
-25483,
-25937,
-26251,
-26477,
-26814,
-27388,
-28028,
-28461,
-28599,
-28687,
-29066,
-29804,
-30658,
-31333,
-31778,
-32223,
-32805,
-33454,
-33913,
-34067,
-34027,
-33989,
-34057,
-34159,
-34271,
-34409,
-34682,
-35084,
-35562,
-36025,
-36493,
-37011,
-37593,
-38170,
-38636,
-38899,
-39030,
-39118,
-39280,
-39429,
-39334,
-38761,
-37696,
-36374,
-35109,
-34012,
-33003,
-31896,
-30676,
-29464,
-28440,
-27681,
-27136,
-26655,
-26173,
-25721,
-25495,
-25652,
-26173,
-26841,
-27409,
-27824,
-28245,
-28858,
-29710,
-30681,
-31627,
-32470,
-33177,
-33791,
-34347,
-34870,
-35285,
-35464,
-35382,
-35228,
-35234,
-35454,
-35626,
-35511,
-35119,
-34756,
-34601,
-34569,
-34408,
-34096,
-33825,
-33774,
-33860,
-33861,
-33672,
-33420,
-33253,
-33226,
-33276,
-33392,
-33535,
-33641,
-33566,
-33328,
-33085,
-33017,
-33046,
-32926,
-32481,
-31870,
-31389,
-31215,
-31178,
-31021,
-30664,
-30272,
-30089,
-30145,
-30309,
-30424,
-30451,
-30461,
-30484,
-30493,
-30447,
-30350,
-30241,
-30128,
-29987,
-29841,
-29726,
-29726,
-29822,
-29988,
-30201,
-30526,
-31015,
-31684,
-32464,
-33333,
-34289,
-35355,
-36493,
-37576,
-38518,
-39246,
-39765,
-40088,
-40206,
-40098,
-39727,
-39123,
-38385,
-37639,
-36937,
-36183,
-35260,
-34197,
-33175,
-32384,
-31788,
-31249,
-30682,
-30250,
-30101,
-30182,
-30229,
-30071,
-29852,
-29821,
-30031,
-30234,
-30180,
-29922,
-29706,
-29691,
-29706,
-29531,
-29122,
-28700,
-28465,
-28391,
-28311,
-28109,
-27835,
-27641,
-27573,
-27639,
-27752,
-27873,
-27965,
-28079,
-28283,
-28642,
-29070,
-29452,
-29743,
-30160,
-30958,
-32266,
-33953,
-35868,
-38026,
-40557,
-43333,
-45906,
-47692,
-48528,
-48700,
-48625,
-48389,
-47691,
-46295,
-44315,
-42161,
-40065,
-37911,
-35445,
-32689,
-30069,
-28038,
-26783,
-26089,
-25665,
-25373,
-25237,
-25295,
-25472,
-25594,
-25547,
-25309,
-24975,
-24699,
-24563,
-24557,
-24577,
-24550,
-24554,
-24768,
-25312,
-26151,
-27113,
-28071,
-29011,
-29953,
-30919,
-31823,
-32614,
-33236,
-33687,
-33985,
-34180,
-34286,
-34291,
-34163,
-33983,
-33996,
-34441,
-35385,
-36650,
-38031,
-39470,
-41000,
-42547,
-43843,
-44626,
-44860,
-44736,
-44417,
-43925,
-43119,
-41974,
-40483,
-38737,
-36771,
-34738,
-32869,
-31374,
-30233,
-29298,
-28441,
-27732,
-27318,
-27123,
-26906,
-26415,
-25741,
-25179,
-24990,
-25053,
-25057,
-24806,
-24463,
-24362,
-24652,
-25159,
-25619,
-25992,
-26509,
-27378,
-28546,
-29698,
-30612,
-31271,
-31859,
-32456,
-32987,
-33294,
-33344,
-33294,
-33361,
-33685,
-34178,
-34664,
-35065,
-35494,
-36143,
-37003,
-37842,
-38450,
-38946,
-39621,
-40613,
-41602,
-42175,
-42221,
-42052,
-41935,
-41767,
-41180,
-40053,
-38630,
-37277,
-36066,
-34844,
-33496,
-32125,
-30855,
-29712,
-28657,
-27718,
-27006,
-26473,
-26009,
-25530,
-25168,
-25093,
-25283,
-25544,
-25701,
-25803,
-26035,
-26501,
-27163,
-27893,
-28608,
-29300,
-29984,
-30701,
-31430,
-32112,
-32638,
-32969,
-33193,
-33452,
-33796,
-34142,
-34326,
-34309,
-34156,
-34026,
-33990,
-34054,
-34154,
-34243,
-34374,
-34628,
-35075,
-35659,
-36248,
-36749,
-37194,
-37658,
-38104,
-38408,
-38443,
-38251,
-37982,
-37705,
-37390,
-36903,
-36208,
-35351,
-34426,
-33482,
-32539,
-31579,
-30623,
-29697,
-28868,
-28171,
-27606,
-27143,
-26756,
-26481,
-26347,
-26334,
-26370,
-26432,
-26581,
-26908,
-27432,
-28079,
-28783,
-29575,
-30505,
-31545,
-32545,
-33374,
-34055,
-34770,
-35653,
-36645,
-37508,
-38031,
-38211,
-38192,
-38100,
-37903,
-37518,
-36937,
-36320,
-35790,
-35372,
-34947,
-34459,
-33937,
-33475,
-33066,
-32718,
-32419,
-32267,
-32261,
-32301,
-32256,
-32111,
-32002,
-32051,
-32207,
-32286,
-32147,
-31854,
-31582,
-31471,
-31485,
-31482,
-31386,
-31236,
-31163,
-31211,
-31296,
-31283,
-31108,
-30858,
-30648,
-30525,
-30440,
-30330,
-30201,
-30084,
-29967,
-29788,
-29533,
-29236,
-29003,
-28871,
-28859,
-28998,
-29308,
-29781,
-30286,
-30719,
-31059,
-31411,
-31851,
-32337,
-32818,
-33366,
-34269,
-35735,
-37723,
-39839,
-41642,
-42913,
-43728,
-44306,
-44725,
-44890,
-44580,
-43726,
-42397,
-40817,
-39088,
-37177,
-35014,
-32654,
-30412,
-28602,
-27363,
-26559,
-26008,
-25663,
-25607,
-25866,
-26241,
-26531,
-26621,
-26625,
-26626,
-26605,
-26419,
-26031,
-25524,
-25090,
-24853,
-24859,
-25076,
-25478,
-26089,
-26980,
-28180,
-29590,
-31000,
-32226,
-33301,
-34348,
-35439,
-36415,
-37079,
-37433,
-37696,
-38106,
-38681,
-39237,
-39644,
-39852,
-39928,
-39930,
-39915,
-39981,
-40118,
-40197,
-40035,
-39596,
-39019,
-38414,
-37681,
-36610,
-35153,
-33571,
-32233,
-31322,
-30741,
-30281,
-29830,
-29431,
-29164,
-29029,
-28938,
-28762,
-28495,
-28228,
-28133,
-28238,
-28391,
-28389,
-28153,
-27836,
-27639,
-27659,
-27832,
-28108,
-28471,
-28997,
-29655,
-30376,
-31012,
-31518,
-31851,
-32082,
-32262,
-32431,
-32529,
-32488,
-32281,
-32061,
-31989,
-32134,
-32370,
-32554,
-32665,
-32867,
-33341,
-34090,
-34973,
-35801,
-36559,
-37359,
-38312,
-39316,
-40110,
-40441,
-40330,
-39981,
-39654,
-39333,
-38861,
-38080,
-37059,
-36004,
-35063,
-34206,
-33300,
-32292,
-31281,
-30441,
-29839,
-29421,
-29035,
-28653,
-28332,
-28196,
-28235,
-28352,
-28417,
-28428,
-28474,
-28664,
-29001,
-29408,
-29736,
-29904,
-29933,
-29967,
-30148,
-30448,
-30675,
-30675,
-30529,
-30483,
-30703,
-31023,
-31231,
-31230,
-31251,
-31436,
-31753,
-31969,
-32000,
-31974,
-32082,
-32416,
-32943,
-33636,
-34417,
-35183,
-35807,
-36342,
-36968,
-37777,
-38618,
-39238,
-39567,
-39787,
-40027,
-40200,
-40007,
-39383,
-38447,
-37460,
-36473,
-35404,
-34224,
-33014,
-31920,
-30997,
-30193,
-29469,
-28784,
-28162,
-27654,
-27367,
-27352,
-27569,
-27833,
-28049,
-28253,
-28590,
-29079,
-29601,
-29976,
-30230,
-30512,
-30955,
-31502,
-31928,
-32104,
-32046,
-31947,
-31942,
-32056,
-32193,
-32262,
-32261,
-32260,
-32332,
-32490,
-32653,
-32757,
-32787,
-32767,
-32756,
-32748,
-32806,
-32986,
-33350,
-33840,
-34316,
-34694,
-35002,
-35347,
-35729,
-36045,
-36247,
-36442,
-36798,
-37276,
-37624,
-37588,
-37196,
-36650,
-36111,
-35478,
-34658,
-33684,
-32777,
-32070,
-31493,
-30937,
-30333,
-29740,
-29124,
-28509,
-27965,
-27707,
-27806,
-28111,
-28359,
-28496,
-28682,
-29073,
-29592,
-30036,
-30350,
-30700,
-31241,
-31900,
-32487,
-32890,
-33212,
-33585,
-34009,
-34368,
-34592,
-34713,
-34856,
-35062,
-35295,
-35434,
-35388,
-35159,
-34891,
-34702,
-34627,
-34524,
-34290,
-33947,
-33668,
-33550,
-33543,
-33525,
-33433,
-33325,
-33256,
-33242,
-33302,
-33431,
-33618,
-33755,
-33767,
-33675,
-33553,
-33390,
-33088,
-32572,
-31963,
-31453,
-31108,
-30830,
-30492,
-30115,
-29826,
-29669,
-29578,
-29464,
-29316,
-29189,
-29135,
-29163,
-29255,
-29386,
-29427,
-29345,
-29150,
-28977,
-28917,
-28918,
-28936,
-29010,
-29284,
-29844,
-30604,
-31385,
-32090,
-32698,
-33356,
-34225,
-35539,
-37332,
-39420,
-41402,
-42999,
-44176,
-45038,
-45533,
-45478,
-44795,
-43677,
-42411,
-41094,
-39572,
-37760,
-35763,
-33780,
-31905,
-30131,
-28550,
-27359,
-26701,
-26434,
-26322,
-26213,
-26133,
-26121,
-26098,
-25956,
-25704,
-25470,
-25345,
-25303,
-25217,
-25046,
-24846,
-24826,
-25144,
-25863,
-26794,
-27716,
-28518,
-29348,
-30427,
-31740,
-33067,
-34173,
-35070,
-35973,
-36927,
-37811,
-38386,
-38673,
-38839,
-39063,
-39331,
-39570,
-39778,
-40015,
-40300,
-40489,
-40453,
-40160,
-39723,
-39251,
-38748,
-38108,
-37301,
-36344,
-35352,
-34295,
-33114,
-31727,
-30265,
-28937,
-27908,
-27192,
-26706,
-26472,
-26519,
-26790,
-27064,
-27187,
-27228,
-27469,
-28017,
-28756,
-29418,
-29893,
-30282,
-30640,
-30965,
-31159,
-31262,
-31388,
-31603,
-31924,
-32321,
-32795,
-33314,
-33806,
-34220,
-34605,
-34984,
-35278,
-35356,
-35203,
-34973,
-34790,
-34584,
-34209,
-33641,
-33068,
-32639,
-32299,
-31909,
-31437,
-31021,
-30772,
-30636,
-30540,
-30496,
-30624,
-30979,
-31521,
-32216,
-33060,
-34009,
-34914,
-35623,
-36144,
-36578,
-36956,
-37174,
-37123,
-36876,
-36562,
-36266,
-35933,
-35545,
-35158,
-34787,
-34356,
-33801,
-33250,
-32909,
-32839,
-32787,
-32507,
-31982,
-31452,
-31079,
-30783,
-30373,
-29817,
-29247,
-28784,
-28402,
-28019,
-27659,
-27423,
-27399,
-27577,
-27897,
-28327,
-28829,
-29388,
-29977,
-30611,
-31251,
-31838,
-32283,
-32579,
-32818,
-33085,
-33429,
-33819,
-34217,
-34584,
-34894,
-35144,
-35406,
-35738,
-36172,
-36616,
-37033,
-37395,
-37760,
-38052,
-38181,
-38047,
-37689,
-37177,
-36536,
-35761,
-34899,
-34097,
-33458,
-32936,
-32361,
-31653,
-30882,
-30252,
-29845,
-29634,
-29487,
-29363,
-29257,
-29213,
-29191,
-29150,
-29060,
-28968,
-28955,
-29073,
-29346,
-29733,
-30228,
-30789,
-31375,
-31914,
-32325,
-32587,
-32731,
-32847,
-33003,
-33224,
-33441,
-33567,
-33581,
-33556,
-33631,
-33811,
-34011,
-34070,
-34030,
-34012,
-34165,
-34482,
-34837,
-35163,
-35450,
-35714,
-35934,
-36058,
-36062,
-35925,
-35607,
-35129,
-34618,
-34216,
-33930,
-33548,
-32914,
-32098,
-31367,
-30876,
-30525,
-30137,
-29720,
-29465,
-29480,
-29642,
-29742,
-29725,
-29716,
-29824,
-30016,
-30169,
-30228,
-30221,
-30193,
-30126,
-29984,
-29760,
-29502,
-29319,
-29338,
-29625,
-30112,
-30643,
-31108,
-31568,
-32122,
-32771,
-33338,
-33727,
-34042,
-34548,
-35445,
-36648,
-37972,
-39190,
-40225,
-41003,
-41490,
-41648,
-41506,
-41143,
-40586,
-39849,
-38893,
-37721,
-36392,
-34994,
-33604,
-32229,
-30878,
-29610,
-28601,
-27979,
-27724,
-27640,
-27560,
-27448,
-27415,
-27509,
-27684,
-27839,
-27946,
-28024,
-28136,
-28260,
-28415,
-28545,
-28635,
-28655,
-28658,
-28749,
-28961,
-29242,
-29498,
-29741,
-30039,
-30420,
-30754,
-30956,
-31086,
-31325,
-31709,
-32106,
-32331,
-32504,
-32869,
-33620,
-34603,
-35572,
-36481,
-37533,
-38926,
-40527,
-41959,
-42939,
-43502,
-43885,
-44193,
-44289,
-43984,
-43269,
-42301,
-41211,
-39916,
-38306,
-36389,
-34375,
-32447,
-30659,
-28975,
-27467,
-26290,
-25540,
-25095,
-24758,
-24424,
-24145,
-24037,
-24090,
-24235,
-24413,
-24613,
-24868,
-25204,
-25632,
-26179,
-26771,
-27330,
-27785,
-28236,
-28810,
-29551,
-30307,
-30913,
-31348,
-31801,
-32448,
-33274,
-34084,
-34699,
-35138,
-35624,
-36308,
-37162,
-37927,
-38429,
-38757,
-39211,
-40005,
-40965,
-41698,
-41931,
-41771,
-41578,
-41507,
-41395,
-40939,
-40063,
-38986,
-37949,
-36950,
-35792,
-34355,
-32753,
-31269,
-30028,
-29026,
-28099,
-27238,
-26495,
-25952,
-25593,
-25306,
-25043,
-24832,
-24795,
-25009,
-25481,
-26107,
-26758,
-27349,
-27874,
-28441,
-29110,
-29846,
-30514,
-31006,
-31449,
-32012,
-32792,
-33594,
-34165,
-34410,
-34500,
-34585,
-34651,
-34526,
-34170,
-33770,
-33553,
-33542,
-33586,
-33544,
-33468,
-33485,
-33652,
-33871,
-34098,
-34395,
-34931,
-35776,
-36796,
-37719,
-38342,
-38643,
-38818,
-38976,
-39050,
-38759,
-37948,
-36776,
-35638,
-34800,
-34150,
-33344,
-32184,
-30852,
-29726,
-29057,
-28753,
-28577,
-28387,
-28283,
-28426,
-28811,
-29230,
-29430,
-29412,
-29386,
-29598,
-30050,
-30510,
-30793,
-30908,
-31080,
-31394,
-31751,
-31902,
-31785,
-31548,
-31447,
-31600,
-31906,
-32160,
-32247,
-32213,
-32208,
-32306,
-32445,
-32494,
-32412,
-32282,
-32204,
-32221,
-32337,
-32588,
-33043,
-33647,
-34253,
-34728,
-35151,
-35684,
-36357,
-36991,
-37337,
-37409,
-37382,
-37414,
-37433,
-37224,
-36669,
-35842,
-34881,
-33915,
-32964,
-32065,
-31250,
-30582,
-30049,
-29626,
-29221,
-28841,
-28546,
-28417,
-28454,
-28558,
-28656,
-28826,
-29147,
-29630,
-30072,
-30425,
-30764,
-31313,
-32040,
-32706,
-33112,
-33331,
-33607,
-34033,
-34481,
-34790,
-34950,
-35047,
-35054,
-34934,
-34722,
-34573,
-34559,
-34512,
-34265,
-33859,
-33546,
-33482,
-33534,
-33451,
-33165,
-32857,
-32730,
-32816,
-32962,
-33037,
-33029,
-33011,
-33095,
-33263,
-33450,
-33532,
-33462,
-33339,
-33266,
-33278,
-33235,
-33046,
-32719,
-32432,
-32241,
-32085,
-31819,
-31440,
-31065,
-30836,
-30748,
-30707,
-30592,
-30389,
-30143,
-29940,
-29817,
-29696,
-29465,
-29051,
-28573,
-28222,
-28127,
-28160,
-28133,
-27985,
-27902,
-28141,
-28697,
-29372,
-29899,
-30286,
-30768,
-31572,
-32806,
-34428,
-36407,
-38671,
-41001,
-43069,
-44580,
-45548,
-46108,
-46350,
-46117,
-45257,
-43831,
-42155,
-40461,
-38728,
-36792,
-34664,
-32582,
-30843,
-29503,
-28508,
-27796,
-27412,
-27343,
-27417,
-27452,
-27369,
-27234,
-27075,
-26812,
-26368,
-25762,
-25148,
-24610,
-24195,
-23895,
-23767,
-23866,
-24219,
-24828,
-25695,
-26780,
-27988,
-29178,
-30339,
-31490,
-32624,
-33556,
-34127,
-34404,
-34680,
-35150,
-35781,
-36351,
-36901,
-37661,
-38819,
-40212,
-41451,
-42295,
-42835,
-43260,
-43615,
-43805,
-43742,
-43457,
-42899,
-41926,
-40402,
-38458,
-36378,
-34389,
-32485,
-30611,
-28854,
-27485,
-26656,
-26282,
-26099,
-25941,
-25845,
-25940,
-26286,
-26772,
-27236,
-27573,
-27796,
-28014,
-28246,
-28449,
-28505,
-28413,
-28311,
-28388,
-28724,
-29282,
-29945,
-30649,
-31366,
-32080,
-32791,
-33495,
-34168,
-34726,
-35090,
-35253,
-35315,
-35304,
-35171,
-34821,
-34305,
-33801,
-33444,
-33228,
-33080,
-33014,
-33090,
-33281,
-33439,
-33511,
-33652,
-34067,
-34752,
-35486,
-36057,
-36527,
-36992,
-37431,
-37626,
-37492,
-37161,
-36820,
-36465,
-35936,
-35187,
-34385,
-33669,
-33038,
-32340,
-31607,
-31018,
-30709,
-30599,
-30490,
-30332,
-30216,
-30214,
-30239,
-30139,
-29884,
-29619,
-29459,
-29449,
-29469,
-29443,
-29281,
-29002,
-28670,
-28445,
-28448,
-28708,
-29116,
-29581,
-30078,
-30653,
-31277,
-31903,
-32452,
-32964,
-33420,
-33794,
-33996,
-34081,
-34178,
-34403,
-34672,
-34825,
-34820,
-34821,
-35046,
-35492,
-35969,
-36288,
-36476,
-36700,
-37010,
-37301,
-37379,
-37194,
-36789,
-36250,
-35628,
-34987,
-34415,
-33874,
-33300,
-32635,
-32004,
-31571,
-31271,
-30870,
-30177,
-29370,
-28809,
-28683,
-28818,
-28905,
-28876,
-28876,
-29087,
-29440,
-29792,
-30050,
-30270,
-30553,
-30956,
-31514,
-32162,
-32774,
-33176,
-33352,
-33467,
-33660,
-33920,
-34043,
-33973,
-33779,
-33633,
-33526,
-33409,
-33300,
-33316,
-33456,
-33596,
-33584,
-33525,
-33595,
-33862,
-34148,
-34315,
-34389,
-34535,
-34738,
-34832,
-34689,
-34422,
-34211,
-34119,
-33974,
-33655,
-33206,
-32797,
-32500,
-32225,
-31839,
-31330,
-30841,
-30534,
-30458,
-30507,
-30513,
-30405,
-30257,
-30235,
-30402,
-30686,
-30900,
-30993,
-31013,
-31123,
-31366,
-31647,
-31806,
-31701,
-31377,
-30981,
-30733,
-30731,
-30919,
-31186,
-31427,
-31714,
-32051,
-32421,
-32692,
-32817,
-32882,
-33042,
-33420,
-34063,
-34963,
-36106,
-37372,
-38567,
-39445,
-39867,
-39885,
-39649,
-39355,
-39019,
-38586,
-37907,
-36950,
-35799,
-34581,
-33399,
-32233,
-31119,
-30142,
-29441,
-29064,
-28918,
-28889,
-28918,
-29028,
-29177,
-29266,
-29213,
-29064,
-28952,
-28942,
-28957,
-28876,
-28651,
-28383,
-28190,
-28152,
-28232,
-28391,
-28581,
-28820,
-29110,
-29487,
-29885,
-30253,
-30520,
-30736,
-31021,
-31446,
-31950,
-32396,
-32704,
-33011,
-33493,
-34226,
-35088,
-35907,
-36682,
-37581,
-38723,
-39998,
-41064,
-41674,
-41829,
-41770,
-41661,
-41423,
-40870,
-39923,
-38804,
-37792,
-36991,
-36251,
-35361,
-34291,
-33210,
-32278,
-31510,
-30800,
-30076,
-29376,
-28780,
-28312,
-27938,
-27602,
-27272,
-26922,
-26552,
-26182,
-25880,
-25671,
-25560,
-25535,
-25653,
-25983,
-26500,
-27101,
-27647,
-28138,
-28614,
-29104,
-29558,
-29923,
-30284,
-30693,
-31177,
-31602,
-31955,
-32332,
-32921,
-33756,
-34707,
-35662,
-36610,
-37691,
-38887,
-40100,
-41151,
-41992,
-42640,
-43091,
-43273,
-43161,
-42789,
-42221,
-41461,
-40459,
-39241,
-37890,
-36480,
-35018,
-33480,
-31951,
-30562,
-29407,
-28484,
-27746,
-27217,
-26926,
-26797,
-26709,
-26544,
-26391,
-26371,
-26576,
-26953,
-27410,
-27875,
-28291,
-28632,
-28875,
-29083,
-29306,
-29562,
-29834,
-30150,
-30556,
-31065,
-31542,
-31921,
-32200,
-32532,
-32935,
-33308,
-33493,
-33485,
-33379,
-33262,
-33124,
-32963,
-32829,
-32797,
-32853,
-32972,
-33162,
-33448,
-33796,
-34113,
-34456,
-35005,
-35944,
-37133,
-38255,
-39090,
-39681,
-40149,
-40422,
-40244,
-39560,
-38574,
-37604,
-36736,
-35840,
-34820,
-33718,
-32682,
-31722,
-30819,
-29987,
-29317,
-28894,
-28702,
-28691,
-28808,
-28992,
-29138,
-29188,
-29168,
-29184,
-29279,
-29419,
-29538,
-29653,
-29793,
-29916,
-29941,
-29820,
-29653,
-29586,
-29720,
-30027,
-30447,
-30913,
-31378,
-31816,
-32151,
-32378,
-32482,
-32514,
-32519,
-32510,
-32508,
-32510,
-32574,
-32740,
-33026,
-33407,
-33893,
-34489,
-35214,
-35939,
-36560,
-37024,
-37451,
-37932,
-38408,
-38700,
-38677,
-38408,
-38037,
-37612,
-37017,
-36128,
-34957,
-33688,
-32537,
-31628,
-30904,
-30263,
-29614,
-29025,
-28611,
-28444,
-28465,
-28570,
-28718,
-28951,
-29296,
-29732,
-30215,
-30725,
-31202,
-31551,
-31704,
-31764,
-31903,
-32167,
-32410,
-32517,
-32593,
-32842,
-33253,
-33523,
-33426,
-33087,
-32878,
-32949,
-33117,
-33113,
-32934,
-32784,
-32773,
-32804,
-32756,
-32644,
-32519,
-32404,
-32275,
-32220,
-32385,
-32749,
-33121,
-33333,
-33431,
-33599,
-33927,
-34308,
-34614,
-34816,
-34941,
-35035,
-35080,
-35104,
-35048,
-34818,
-34352,
-33746,
-33226,
-32856,
-32488,
-31966,
-31353,
-30914,
-30723,
-30628,
-30399,
-30092,
-29917,
-29952,
-30032,
-29956,
-29771,
-29671,
-29769,
-29935,
-30026,
-29973,
-29860,
-29754,
-29706,
-29771,
-29999,
-30353,
-30757,
-31160,
-31656,
-32297,
-33062,
-33805,
-34474,
-35184,
-36117,
-37294,
-38550,
-39543,
-40094,
-40201,
-40094,
-39950,
-39776,
-39395,
-38707,
-37829,
-37012,
-36341,
-35629,
-34643,
-33396,
-32176,
-31295,
-30732,
-30315,
-29845,
-29369,
-28994,
-28769,
-28592,
-28381,
-28105,
-27834,
-27634,
-27504,
-27413,
-27296,
-27165,
-27075,
-27093,
-27208,
-27329,
-27407,
-27485,
-27698,
-28104,
-28656,
-29246,
-29838,
-30457,
-31184,
-32033,
-32986,
-33983,
-34935,
-35817,
-36638,
-37448,
-38222,
-38869,
-39359,
-39801,
-40351,
-40986,
-41430,
-41437,
-41003,
-40401,
-39826,
-39209,
-38354,
-37222,
-36017,
-34914,
-33873,
-32716,
-31391,
-30112,
-29114,
-28485,
-28112,
-27898,
-27873,
-28129,
-28661,
-29326,
-29925,
-30339,
-30562,
-30682,
-30790,
-30900,
-30961,
-30897,
-30721,
-30533,
-30445,
-30455,
-30487,
-30460,
-30428,
-30509,
-30766,
-31146,
-31519,
-31757,
-31834,
-31756,
-31613,
-31484,
-31408,
-31305,
-31060,
-30660,
-30281,
-30144,
-30284,
-30548,
-30726,
-30894,
-31217,
-31880,
-32800,
-33871,
-35069,
-36464,
-38029,
-39554,
-40798,
-41652,
-42123,
-42240,
-41955,
-41292,
-40341,
-39237,
-38026,
-36713,
-35301,
-33892,
-32537,
-31316,
-30260,
-29461,
-28929,
-28615,
-28424,
-28336,
-28392,
-28524,
-28645,
-28647,
-28638,
-28729,
-28958,
-29197,
-29359,
-29449,
-29544,
-29654,
-29770,
-29895,
-30093,
-30325,
-30530,
-30640,
-30772,
-30975,
-31242,
-31417,
-31494,
-31550,
-31689,
-31861,
-31971,
-32043,
-32151,
-32307,
-32439,
-32535,
-32774,
-33288,
-34001,
-34710,
-35342,
-36058,
-36985,
-37957,
-38729,
-39188,
-39534,
-39902,
-40213,
-40252,
-39965,
-39459,
-38813,
-37970,
-36864,
-35579,
-34269,
-32980,
-31685,
-30441,
-29384,
-28612,
-28018,
-27464,
-26970,
-26649,
-26570,
-26605,
-26694,
-26882,
-27288,
-27897,
-28554,
-29226,
-29930,
-30713,
-31409,
-31882,
-32153,
-32387,
-32671,
-32862,
-32851,
-32690,
-32558,
-32539,
-32539,
-32485,
-32442,
-32502,
-32692,
-32906,
-33121,
-33381,
-33705,
-34050,
-34337,
-34594,
-34857,
-35120,
-35285,
-35349,
-35349,
-35361,
-35332,
-35249,
-35134,
-35092,
-35087,
-35027,
-34831,
-34583,
-34404,
-34296,
-34169,
-33923,
-33585,
-33215,
-32811,
-32361,
-31872,
-31377,
-30908,
-30440,
-29990,
-29584,
-29245,
-28959,
-28734,
-28655,
-28770,
-29041,
-29305,
-29473,
-29575,
-29700,
-29907,
-30168,
-30490,
-30859,
-31252,
-31598,
-31891,
-32226,
-32693,
-33280,
-33886,
-34475,
-35072,
-35703,
-36260,
-36626,
-36819,
-36977,
-37221,
-37481,
-37636,
-37617,
-37505,
-37351,
-37100,
-36649,
-35988,
-35243,
-34576,
-34009,
-33484,
-32893,
-32258,
-31646,
-31115,
-30642,
-30196,
-29770,
-29464,
-29282,
-29208,
-29176,
-29160,
-29186,
-29206,
-29188,
-29132,
-29187,
-29407,
-29711,
-29903,
-29931,
-29955,
-30132,
-30393,
-30500,
-30334,
-30073,
-29978,
-30154,
-30472,
-30758,
-30986,
-31230,
-31602,
-32118,
-32766,
-33419,
-33981,
-34467,
-35016,
-35802,
-36750,
-37636,
-38309,
-38860,
-39449,
-40033,
-40332,
-40177,
-39669,
-39050,
-38423,
-37658,
-36727,
-35720,
-34815,
-34022,
-33208,
-32292,
-31325,
-30384,
-29566,
-28949,
-28658,
-28707,
-28957,
-29207,
-29411,
-29663,
-30039,
-30398,
-30564,
-30516,
-30411,
-30414,
-30493,
-30523,
-30439,
-30305,
-30199,
-30169,
-30202,
-30289,
-30414,
-30551,
-30665,
-30783,
-30902,
-30994,
-31016,
-30972,
-30930,
-30971,
-31077,
-31213,
-31324,
-31441,
-31560,
-31688,
-31788,
-31876,
-32065,
-32516,
-33372,
-34606,
-35975,
-37201,
-38173,
-39006,
-39837,
-40583,
-40967,
-40869,
-40476,
-40134,
-39957,
-39664,
-38912,
-37603,
-36019,
-34497,
-33192,
-32041,
-30955,
-29977,
-29237,
-28816,
-28656,
-28573,
-28424,
-28228,
-28142,
-28323,
-28742,
-29215,
-29562,
-29762,
-29880,
-29982,
-30015,
-29930,
-29724,
-29471,
-29266,
-29172,
-29219,
-29376,
-29539,
-29642,
-29704,
-29810,
-30014,
-30245,
-30447,
-30704,
-31155,
-31836,
-32545,
-33073,
-33403,
-33725,
-34184,
-34688,
-35092,
-35391,
-35816,
-36548,
-37522,
-38495,
-39241,
-39756,
-40122,
-40382,
-40494,
-40389,
-40069,
-39545,
-38882,
-38085,
-37197,
-36178,
-34960,
-33508,
-31920,
-30429,
-29251,
-28414,
-27803,
-27283,
-26857,
-26639,
-26650,
-26829,
-27058,
-27301,
-27639,
-28111,
-28699,
-29303,
-29872,
-30356,
-30759,
-31047,
-31230,
-31347,
-31457,
-31577,
-31698,
-31814,
-31924,
-32052,
-32173,
-32282,
-32387,
-32519,
-32730,
-32987,
-33268,
-33484,
-33637,
-33741,
-33851,
-33977,
-34077,
-34090,
-34033,
-33994,
-34050,
-34182,
-34295,
-34308,
-34295,
-34371,
-34627,
-34998,
-35375,
-35660,
-35889,
-36125,
-36394,
-36603,
-36577,
-36225,
-35591,
-34850,
-34142,
-33456,
-32701,
-31861,
-31043,
-30390,
-29935,
-29567,
-29217,
-28900,
-28699,
-28687,
-28810,
-29067,
-29413,
-29885,
-30448,
-31075,
-31704,
-32268,
-32702,
-32976,
-33130,
-33247,
-33380,
-33493,
-33520,
-33423,
-33227,
-32982,
-32723,
-32487,
-32275,
-32114,
-32003,
-31966,
-31989,
-32038,
-32021,
-31959,
-31929,
-32052,
-32294,
-32512,
-32576,
-32529,
-32480,
-32495,
-32516,
-32518,
-32536,
-32644,
-32834,
-33049,
-33344,
-33761,
-34298,
-34766,
-35045,
-35195,
-35451,
-35853,
-36250,
-36354,
-36130,
-35712,
-35257,
-34754,
-34118,
-33338,
-32493,
-31680,
-30912,
-30220,
-29625,
-29155,
-28790,
-28517,
-28413,
-28553,
-28951,
-29454,
-29899,
-30256,
-30596,
-31024,
-31516,
-31962,
-32320,
-32612,
-32946,
-33342,
-33747,
-34046,
-34210,
-34285,
-34369,
-34507,
-34659,
-34777,
-34823,
-34827,
-34820,
-34818,
-34805,
-34740,
-34581,
-34350,
-34095,
-33876,
-33659,
-33363,
-32981,
-32638,
-32493,
-32540,
-32593,
-32497,
-32306,
-32253,
-32433,
-32698,
-32801,
-32641,
-32397,
-32248,
-32271,
-32302,
-32241,
-32021,
-31750,
-31489,
-31268,
-31064,
-30819,
-30557,
-30301,
-30146,
-30134,
-30262,
-30490,
-30729,
-30902,
-30986,
-31030,
-31163,
-31407,
-31680,
-31818,
-31777,
-31694,
-31700,
-31782,
-31817,
-31707,
-31566,
-31513,
-31580,
-31683,
-31776,
-31917,
-32175,
-32505,
-32840,
-33184,
-33655,
-34354,
-35264,
-36263,
-37231,
-38061,
-38696,
-39084,
-39226,
-39141,
-38873,
-38526,
-38254,
-38182,
-38227,
-38137,
-37630,
-36686,
-35500,
-34283,
-33105,
-31953,
-30861,
-29963,
-29288,
-28739,
-28170,
-27533,
-26938,
-26469,
-26191,
-26065,
-26062,
-26138,
-26262,
-26457,
-26758,
-27188,
-27679,
-28158,
-28601,
-29068,
-29574,
-30052,
-30443,
-30764,
-31147,
-31630,
-32125,
-32514,
-32783,
-33067,
-33496,
-34000,
-34464,
-34750,
-34957,
-35275,
-35849,
-36684,
-37640,
-38580,
-39436,
-40204,
-40879,
-41403,
-41727,
-41769,
-41540,
-41037,
-40347,
-39531,
-38601,
-37504,
-36158,
-34622,
-33079,
-31688,
-30473,
-29296,
-28099,
-26988,
-26164,
-25711,
-25477,
-25279,
-25017,
-24838,
-24908,
-25278,
-25801,
-26277,
-26616,
-26939,
-27387,
-28008,
-28671,
-29248,
-29784,
-30423,
-31263,
-32206,
-33120,
-33964,
-34801,
-35636,
-36324,
-36768,
-37009,
-37194,
-37351,
-37337,
-37079,
-36641,
-36241,
-35894,
-35527,
-35039,
-34535,
-34163,
-33969,
-33856,
-33797,
-33834,
-34057,
-34409,
-34789,
-35137,
-35480,
-35775,
-35893,
-35705,
-35215,
-34566,
-33864,
-33150,
-32428,
-31734,
-31121,
-30556,
-29994,
-29390,
-28814,
-28342,
-28027,
-27896,
-27938,
-28146,
-28448,
-28798,
-29166,
-29594,
-30082,
-30586,
-31061,
-31498,
-31958,
-32454,
-32951,
-33389,
-33747,
-34053,
-34312,
-34551,
-34764,
-34994,
-35199,
-35333,
-35313,
-35180,
-34982,
-34779,
-34525,
-34184,
-33772,
-33392,
-33085,
-32845,
-32587,
-32315,
-32090,
-31987,
-31977,
-31971,
-31886,
-31750,
-31658,
-31716,
-31917,
-32210,
-32473,
-32686,
-32822,
-32960,
-33110,
-33320,
-33575,
-33846,
-34079,
-34228,
-34282,
-34249,
-34125,
-33885,
-33492,
-32974,
-32391,
-31830,
-31323,
-30891,
-30514,
-30230,
-30027,
-29939,
-29966,
-30134,
-30418,
-30767,
-31120,
-31480,
-31882,
-32334,
-32799,
-33203,
-33533,
-33803,
-33992,
-34093,
-34080,
-34042,
-34031,
-34017,
-33944,
-33760,
-33596,
-33516,
-33534,
-33554,
-33529,
-33514,
-33545,
-33565,
-33509,
-33356,
-33227,
-33130,
-33012,
-32783,
-32500,
-32306,
-32267,
-32283,
-32270,
-32199,
-32218,
-32339,
-32569,
-32829,
-33092,
-33311,
-33378,
-33280,
-33116,
-33035,
-33030,
-32889,
-32506,
-32000,
-31642,
-31523,
-31454,
-31254,
-30979,
-30839,
-30940,
-31118,
-31232,
-31271,
-31387,
-31575,
-31729,
-31752,
-31721,
-31733,
-31788,
-31755,
-31626,
-31485,
-31460,
-31496,
-31479,
-31326,
-31127,
-30990,
-31020,
-31196,
-31504,
-31862,
-32247,
-32607,
-32931,
-33164,
-33272,
-33358,
-33642,
-34356,
-35439,
-36614,
-37604,
-38400,
-39146,
-39872,
-40370,
-40468,
-40238,
-39885,
-39504,
-38941,
-38035,
-36804,
-35392,
-33877,
-32270,
-30651,
-29208,
-28122,
-27341,
-26760,
-26309,
-26055,
-26031,
-26102,
-26141,
-26143,
-26243,
-26564,
-26999,
-27357,
-27488,
-27414,
-27338,
-27457,
-27845,
-28427,
-29026,
-29599,
-30245,
-31083,
-32085,
-33063,
-33843,
-34465,
-35028,
-35594,
-36090,
-36468,
-36800,
-37167,
-37559,
-37885,
-38113,
-38344,
-38618,
-38863,
-38921,
-38777,
-38566,
-38446,
-38373,
-38221,
-37851,
-37314,
-36667,
-35939,
-35083,
-34074,
-32994,
-31912,
-30861,
-29837,
-28844,
-27998,
-27352,
-26880,
-26484,
-26142,
-25992,
-26215,
-26804,
-27547,
-28180,
-28644,
-29083,
-29640,
-30288,
-30848,
-31229,
-31468,
-31683,
-31930,
-32170,
-32398,
-32614,
-32880,
-33218,
-33664,
-34226,
-34860,
-35426,
-35817,
-36002,
-36081,
-36118,
-36126,
-36027,
-35798,
-35440,
-34989,
-34447,
-33871,
-33271,
-32680,
-32092,
-31536,
-31095,
-30800,
-30578,
-30330,
-30060,
-29961,
-30198,
-30806,
-31616,
-32479,
-33329,
-34127,
-34789,
-35231,
-35449,
-35543,
-35577,
-35499,
-35271,
-34911,
-34517,
-34110,
-33612,
-32963,
-32199,
-31476,
-30921,
-30583,
-30445,
-30466,
-30586,
-30777,
-30996,
-31211,
-31384,
-31491,
-31609,
-31854,
-32251,
-32653,
-32852,
-32818,
-32717,
-32725,
-32799,
-32809,
-32745,
-32769,
-32985,
-33242,
-33302,
-33126,
-32890,
-32745,
-32634,
-32422,
-32169,
-32020,
-32018,
-31988,
-31796,
-31556,
-31493,
-31634,
-31785,
-31797,
-31764,
-31926,
-32311,
-32745,
-33043,
-33235,
-33461,
-33802,
-34185,
-34558,
-34882,
-35196,
-35453,
-35649,
-35779,
-35820,
-35706,
-35368,
-34880,
-34397,
-33975,
-33527,
-32900,
-32161,
-31475,
-30994,
-30654,
-30308,
-29926,
-29607,
-29449,
-29432,
-29440,
-29419,
-29412,
-29506,
-29739,
-30073,
-30434,
-30775,
-31108,
-31487,
-31938,
-32427,
-32847,
-33177,
-33471,
-33820,
-34246,
-34623,
-34873,
-34989,
-35080,
-35209,
-35325,
-35315,
-35136,
-34850,
-34618,
-34533,
-34554,
-34528,
-34320,
-33968,
-33650,
-33532,
-33565,
-33552,
-33361,
-33086,
-32941,
-32982,
-33051,
-32937,
-32661,
-32382,
-32241,
-32162,
-31997,
-31756,
-31516,
-31387,
-31277,
-31131,
-30999,
-30999,
-31136,
-31248,
-31170,
-30953,
-30763,
-30719,
-30743,
-30732,
-30674,
-30685,
-30792,
-30933,
-30978,
-30970,
-30989,
-31108,
-31229,
-31275,
-31235,
-31256,
-31404,
-31670,
-31909,
-32078,
-32180,
-32292,
-32415,
-32533,
-32636,
-32760,
-32904,
-33017,
-33055,
-33160,
-33631,
-34737,
-36352,
-38007,
-39144,
-39621,
-39682,
-39637,
-39445,
-38877,
-37904,
-36974,
-36573,
-36735,
-36851,
-36292,
-34912,
-33152,
-31511,
-30175,
-29081,
-28243,
-27810,
-27831,
-28113,
-28351,
-28432,
-28422,
-28420,
-28405,
-28421,
-28622,
-29172,
-29905,
-30421,
-30379,
-29901,
-29441,
-29332,
-29563,
-29823,
-29989,
-30151,
-30505,
-31008,
-31462,
-31664,
-31726,
-31876,
-32276,
-32802,
-33184,
-33299,
-33255,
-33295,
-33509,
-33805,
-34096,
-34473,
-35150,
-36208,
-37481,
-38655,
-39586,
-40301,
-40888,
-41330,
-41449,
-41170,
-40488,
-39526,
-38391,
-37103,
-35679,
-34105,
-32426,
-30760,
-29297,
-28174,
-27403,
-26820,
-26302,
-25897,
-25806,
-26181,
-26896,
-27650,
-28169,
-28472,
-28801,
-29361,
-30118,
-30813,
-31224,
-31378,
-31475,
-31671,
-31923,
-32064,
-32046,
-31989,
-32075,
-32347,
-32718,
-33081,
-33417,
-33771,
-34092,
-34298,
-34287,
-34119,
-33929,
-33820,
-33783,
-33685,
-33462,
-33189,
-33020,
-33078,
-33254,
-33368,
-33316,
-33227,
-33358,
-33832,
-34579,
-35344,
-35979,
-36418,
-36706,
-36872,
-36872,
-36670,
-36159,
-35385,
-34462,
-33630,
-32987,
-32443,
-31777,
-30940,
-30107,
-29512,
-29201,
-28975,
-28727,
-28520,
-28568,
-28917,
-29416,
-29866,
-30214,
-30560,
-30985,
-31522,
-32112,
-32710,
-33253,
-33684,
-33992,
-34219,
-34408,
-34527,
-34544,
-34427,
-34289,
-34156,
-34040,
-33850,
-33593,
-33316,
-33085,
-32885,
-32652,
-32391,
-32131,
-31945,
-31826,
-31738,
-31638,
-31489,
-31288,
-31034,
-30818,
-30707,
-30767,
-30903,
-31011,
-31006,
-30967,
-31025,
-31249,
-31592,
-31953,
-32341,
-32835,
-33554,
-34407,
-35237,
-35839,
-36192,
-36333,
-36348,
-36248,
-36094,
-35951,
-35859,
-35737,
-35470,
-34996,
-34397,
-33733,
-33033,
-32294,
-31619,
-31205,
-31114,
-31223,
-31292,
-31249,
-31217,
-31371,
-31669,
-31932,
-32010,
-31982,
-32021,
-32238,
-32523,
-32732,
-32770,
-32696,
-32555,
-32378,
-32137,
-31853,
-31604,
-31432,
-31330,
-31210,
-31073,
-30967,
-31009,
-31196,
-31412,
-31488,
-31412,
-31270,
-31257,
-31365,
-31508,
-31540,
-31499,
-31517,
-31709,
-32009,
-32239,
-32302,
-32250,
-32250,
-32382,
-32648,
-32970,
-33351,
-33802,
-34350,
-35001,
-35720,
-36446,
-37023,
-37284,
-37214,
-36960,
-36734,
-36569,
-36280,
-35704,
-34892,
-34078,
-33421,
-32859,
-32230,
-31515,
-30836,
-30359,
-30089,
-29981,
-29976,
-30065,
-30209,
-30339,
-30468,
-30683,
-31092,
-31619,
-32108,
-32430,
-32634,
-32850,
-33113,
-33321,
-33368,
-33267,
-33128,
-33040,
-32963,
-32827,
-32602,
-32361,
-32166,
-32046,
-31988,
-31972,
-32004,
-32033,
-32003,
-31892,
-31755,
-31697,
-31724,
-31788,
-31776,
-31685,
-31561,
-31483,
-31460,
-31483,
-31489,
-31502,
-31517,
-31672,
-31999,
-32529,
-33093,
-33560,
-33910,
-34241,
-34666,
-35080,
-35324,
-35294,
-35106,
-34937,
-34836,
-34719,
-34476,
-34123,
-33760,
-33420,
-33088,
-32710,
-32329,
-32005,
-31805,
-31742,
-31789,
-31940,
-32103,
-32235,
-32237,
-32129,
-31960,
-31811,
-31730,
-31709,
-31747,
-31881,
-32149,
-32531,
-32910,
-33146,
-33237,
-33289,
-33416,
-33584,
-33636,
-33514,
-33278,
-33071,
-32888,
-32614,
-32188,
-31706,
-31362,
-31219,
-31214,
-31233,
-31257,
-31332,
-31459,
-31605,
-31736,
-31894,
-32125,
-32410,
-32680,
-32849,
-32943,
-33028,
-33160,
-33314,
-33366,
-33277,
-33103,
-33028,
-33152,
-33404,
-33628,
-33745,
-33858,
-34066,
-34343,
-34460,
-34313,
-33946,
-33574,
-33305,
-33101,
-32880,
-32628,
-32391,
-32164,
-31928,
-31672,
-31460,
-31328,
-31235,
-31124,
-30998,
-30931,
-30948,
-31001,
-31000,
-30963,
-30945,
-30980,
-31014,
-30975,
-30926,
-30949,
-31148,
-31422,
-31650,
-31730,
-31715,
-31713,
-31805,
-32008,
-32304,
-32727,
-33303,
-34001,
-34699,
-35232,
-35547,
-35663,
-35757,
-35916,
-36269,
-36812,
-37512,
-38208,
-38664,
-38687,
-38207,
-37336,
-36229,
-35046,
-33907,
-32936,
-32232,
-31771,
-31418,
-30979,
-30405,
-29767,
-29246,
-28945,
-28887,
-29037,
-29304,
-29620,
-29858,
-29949,
-29873,
-29662,
-29410,
-29165,
-29007,
-28937,
-28981,
-29104,
-29317,
-29569,
-29820,
-30038,
-30284,
-30697,
-31323,
-32006,
-32488,
-32664,
-32738,
-33008,
-33543,
-34098,
-34441,
-34656,
-35040,
-35783,
-36683,
-37416,
-37837,
-38111,
-38423,
-38813,
-39111,
-39204,
-39057,
-38720,
-38199,
-37530,
-36698,
-35727,
-34559,
-33262,
-31953,
-30836,
-29964,
-29239,
-28530,
-27847,
-27325,
-27108,
-27173,
-27423,
-27744,
-28137,
-28634,
-29269,
-29991,
-30711,
-31319,
-31783,
-32119,
-32370,
-32555,
-32671,
-32767,
-32883,
-33016,
-33084,
-33042,
-32966,
-32976,
-33107,
-33238,
-33274,
-33255,
-33297,
-33432,
-33531,
-33483,
-33316,
-33155,
-33048,
-32961,
-32840,
-32713,
-32594,
-32474,
-32326,
-32254,
-32332,
-32502,
-32583,
-32525,
-32551,
-32970,
-33793,
-34682,
-35236,
-35382,
-35306,
-35215,
-35056,
-34694,
-34132,
-33540,
-33108,
-32860,
-32647,
-32336,
-31863,
-31271,
-30663,
-30138,
-29796,
-29687,
-29818,
-30139,
-30574,
-31047,
-31525,
-32001,
-32485,
-32945,
-33397,
-33847,
-34370,
-34893,
-35299,
-35448,
-35373,
-35229,
-35114,
-34957,
-34622,
-34079,
-33458,
-32906,
-32424,
-31996,
-31578,
-31261,
-31023,
-30802,
-30551,
-30295,
-30121,
-30025,
-29920,
-29791,
-29669,
-29648,
-29703,
-29792,
-29911,
-30099,
-30371,
-30637,
-30854,
-31064,
-31409,
-31899,
-32488,
-33060,
-33702,
-34498,
-35461,
-36386,
-37047,
-37344,
-37409,
-37386,
-37326,
-37153,
-36788,
-36304,
-35800,
-35368,
-34905,
-34316,
-33533,
-32660,
-31849,
-31221,
-30829,
-30667,
-30669,
-30756,
-30843,
-30950,
-31143,
-31442,
-31751,
-31938,
-32025,
-32137,
-32421,
-32782,
-33056,
-33121,
-33029,
-32903,
-32761,
-32580,
-32342,
-32085,
-31837,
-31589,
-31352,
-31203,
-31179,
-31229,
-31253,
-31241,
-31287,
-31446,
-31642,
-31747,
-31740,
-31724,
-31755,
-31788,
-31715,
-31577,
-31468,
-31463,
-31492,
-31490,
-31476,
-31539,
-31683,
-31837,
-31934,
-32063,
-32368,
-32947,
-33741,
-34629,
-35497,
-36288,
-36917,
-37316,
-37416,
-37255,
-36934,
-36563,
-36221,
-35884,
-35508,
-34991,
-34280,
-33385,
-32412,
-31531,
-30870,
-30467,
-30261,
-30211,
-30306,
-30526,
-30806,
-31010,
-31123,
-31208,
-31393,
-31687,
-32028,
-32357,
-32709,
-33092,
-33426,
-33569,
-33467,
-33241,
-33037,
-32896,
-32760,
-32561,
-32338,
-32154,
-32022,
-31911,
-31819,
-31752,
-31736,
-31703,
-31624,
-31521,
-31443,
-31453,
-31490,
-31522,
-31501,
-31467,
-31453,
-31487,
-31530,
-31529,
-31440,
-31312,
-31264,
-31376,
-31645,
-31940,
-32196,
-32427,
-32754,
-33188,
-33706,
-34189,
-34642,
-35073,
-35490,
-35836,
-36042,
-36086,
-35983,
-35750,
-35418,
-35033,
-34659,
-34334,
-34005,
-33650,
-33256,
-32888,
-32576,
-32313,
-32061,
-31853,
-31753,
-31794,
-31914,
-32005,
-32014,
-32016,
-32082,
-32237,
-32399,
-32499,
-32576,
-32693,
-32863,
-33005,
-33016,
-32898,
-32719,
-32507,
-32241,
-31892,
-31524,
-31227,
-31031,
-30834,
-30594,
-30334,
-30200,
-30233,
-30365,
-30487,
-30580,
-30713,
-30933,
-31191,
-31432,
-31649,
-31917,
-32288,
-32737,
-33215,
-33646,
-34022,
-34347,
-34672,
-35039,
-35433,
-35784,
-35995,
-36078,
-36093,
-36103,
-36094,
-35992,
-35767,
-35450,
-35054,
-34603,
-34100,
-33609,
-33157,
-32726,
-32239,
-31715,
-31233,
-30867,
-30626,
-30427,
-30286,
-30208,
-30205,
-30208,
-30188,
-30187,
-30272,
-30404,
-30492,
-30488,
-30456,
-30454,
-30465,
-30459,
-30456,
-30537,
-30686,
-30824,
-30919,
-31064,
-31319,
-31598,
-31734,
-31733,
-31776,
-32024,
-32388,
-32722,
-33042,
-33573,
-34415,
-35392,
-36243,
-36938,
-37627,
-38381,
-38975,
-39224,
-39174,
-39121,
-39149,
-39095,
-38661,
-37867,
-36883,
-35895,
-34855,
-33734,
-32604,
-31653,
-30906,
-30256,
-29618,
-29040,
-28664,
-28466,
-28346,
-28215,
-28153,
-28245,
-28462,
-28641,
-28673,
-28633,
-28649,
-28781,
-28912,
-28953,
-28913,
-28955,
-29190,
-29602,
-30080,
-30510,
-30880,
-31243,
-31656,
-32144,
-32609,
-32956,
-33128,
-33200,
-33340,
-33588,
-33887,
-34116,
-34305,
-34583,
-35047,
-35614,
-36188,
-36782,
-37523,
-38423,
-39278,
-39831,
-40010,
-39913,
-39641,
-39133,
-38323,
-37287,
-36193,
-35141,
-34069,
-32881,
-31628,
-30418,
-29370,
-28493,
-27817,
-27368,
-27139,
-27068,
-27108,
-27298,
-27705,
-28278,
-28879,
-29391,
-29850,
-30362,
-30945,
-31524,
-31973,
-32249,
-32393,
-32474,
-32571,
-32710,
-32873,
-32980,
-33009,
-33008,
-33057,
-33168,
-33260,
-33288,
-33294,
-33357,
-33479,
-33572,
-33575,
-33527,
-33507,
-33527,
-33554,
-33549,
-33536,
-33517,
-33465,
-33327,
-33154,
-33023,
-33037,
-33174,
-33383,
-33610,
-33844,
-34099,
-34325,
-34431,
-34320,
-34008,
-33631,
-33330,
-33125,
-32860,
-32389,
-31748,
-31116,
-30645,
-30297,
-29933,
-29535,
-29219,
-29153,
-29327,
-29651,
-30018,
-30427,
-30884,
-31364,
-31846,
-32344,
-32901,
-33490,
-34032,
-34491,
-34912,
-35372,
-35840,
-36227,
-36451,
-36551,
-36588,
-36551,
-36355,
-35940,
-35365,
-34756,
-34213,
-33725,
-33236,
-32699,
-32128,
-31567,
-31046,
-30624,
-30334,
-30235,
-30290,
-30423,
-30497,
-30501,
-30479,
-30586,
-30830,
-31117,
-31285,
-31276,
-31202,
-31195,
-31246,
-31232,
-31021,
-30714,
-30502,
-30510,
-30643,
-30726,
-30715,
-30758,
-31019,
-31518,
-32108,
-32710,
-33341,
-34069,
-34870,
-35572,
-36098,
-36438,
-36686,
-36837,
-36853,
-36733,
-36610,
-36587,
-36610,
-36472,
-36053,
-35423,
-34823,
-34326,
-33893,
-33386,
-32867,
-32461,
-32221,
-32024,
-31714,
-31311,
-30964,
-30773,
-30682,
-30548,
-30375,
-30236,
-30237,
-30326,
-30457,
-30577,
-30725,
-30846,
-30941,
-31004,
-31148,
-31387,
-31632,
-31745,
-31744,
-31780,
-31961,
-32238,
-32438,
-32525,
-32572,
-32691,
-32856,
-32997,
-33074,
-33167,
-33304,
-33469,
-33555,
-33564,
-33519,
-33505,
-33534,
-33610,
-33727,
-33852,
-33989,
-34106,
-34221,
-34309,
-34341,
-34310,
-34273,
-34288,
-34347,
-34338,
-34185,
-33918,
-33652,
-33430,
-33192,
-32852,
-32438,
-32042,
-31748,
-31510,
-31279,
-31022,
-30793,
-30608,
-30503,
-30449,
-30447,
-30462,
-30461,
-30474,
-30544,
-30698,
-30871,
-30971,
-31016,
-31126,
-31398,
-31784,
-32144,
-32380,
-32530,
-32659,
-32784,
-32889,
-32990,
-33171,
-33448,
-33783,
-34126,
-34468,
-34841,
-35206,
-35462,
-35576,
-35595,
-35596,
-35610,
-35580,
-35492,
-35383,
-35275,
-35154,
-34947,
-34618,
-34190,
-33711,
-33213,
-32742,
-32297,
-31905,
-31554,
-31265,
-31052,
-30909,
-30791,
-30657,
-30534,
-30457,
-30452,
-30458,
-30452,
-30461,
-30532,
-30672,
-30816,
-30924,
-31027,
-31144,
-31278,
-31397,
-31495,
-31618,
-31745,
-31863,
-31965,
-32128,
-32403,
-32718,
-32946,
-33033,
-33032,
-33047,
-33050,
-32997,
-32885,
-32788,
-32768,
-32756,
-32693,
-32576,
-32490,
-32480,
-32494,
-32508,
-32548,
-32713,
-33014,
-33387,
-33764,
-34110,
-34443,
-34703,
-34833,
-34805,
-34664,
-34473,
-34258,
-34033,
-33852,
-33772,
-33800,
-33816,
-33696,
-33402,
-33050,
-32821,
-32790,
-32904,
-33050,
-33172,
-33300,
-33442,
-33529,
-33434,
-33135,
-32720,
-32370,
-32146,
-32039,
-31982,
-31970,
-32014,
-32056,
-31987,
-31783,
-31524,
-31395,
-31437,
-31547,
-31556,
-31423,
-31266,
-31211,
-31246,
-31240,
-31119,
-30962,
-30905,
-30973,
-31046,
-31004,
-30861,
-30755,
-30758,
-30862,
-30983,
-31107,
-31270,
-31479,
-31702,
-31877,
-32000,
-32076,
-32169,
-32350,
-32709,
-33281,
-33973,
-34671,
-35291,
-35877,
-36399,
-36801,
-36966,
-36923,
-36794,
-36670,
-36484,
-36167,
-35698,
-35208,
-34738,
-34221,
-33581,
-32829,
-32125,
-31557,
-31128,
-30789,
-30540,
-30417,
-30423,
-30492,
-30593,
-30724,
-30927,
-31206,
-31531,
-31892,
-32262,
-32622,
-32930,
-33159,
-33336,
-33458,
-33554,
-33588,
-33529,
-33354,
-33073,
-32777,
-32559,
-32446,
-32339,
-32150,
-31887,
-31703,
-31678,
-31755,
-31782,
-31746,
-31759,
-31939,
-32225,
-32459,
-32550,
-32535,
-32487,
-32387,
-32205,
-31951,
-31728,
-31584,
-31499,
-31413,
-31276,
-31080,
-30842,
-30598,
-30456,
-30495,
-30709,
-31051,
-31461,
-32003,
-32670,
-33421,
-34098,
-34648,
-35075,
-35439,
-35704,
-35830,
-35813,
-35712,
-35574,
-35379,
-35080,
-34665,
-34181,
-33656,
-33186,
-32802,
-32590,
-32498,
-32497,
-32496,
-32513,
-32523,
-32522,
-32496,
-32528,
-32700,
-33016,
-33384,
-33643,
-33777,
-33809,
-33811,
-33765,
-33676,
-33545,
-33421,
-33293,
-33127,
-32882,
-32562,
-32192,
-31815,
-31459,
-31154,
-30900,
-30694,
-30542,
-30471,
-30456,
-30463,
-30450,
-30444,
-30512,
-30634,
-30777,
-30883,
-31004,
-31143,
-31238,
-31176,
-30994,
-30857,
-30931,
-31126,
-31239,
-31163,
-31011,
-31007,
-31210,
-31534,
-31889,
-32259,
-32750,
-33387,
-34171,
-35030,
-35861,
-36554,
-37067,
-37432,
-37714,
-37890,
-37859,
-37592,
-37158,
-36698,
-36213,
-35638,
-34911,
-34078,
-33246,
-32446,
-31721,
-31113,
-30690,
-30458,
-30310,
-30217,
-30209,
-30379,
-30705,
-31070,
-31368,
-31603,
-31833,
-32064,
-32280,
-32425,
-32524,
-32553,
-32515,
-32408,
-32300,
-32242,
-32242,
-32223,
-32130,
-31971,
-31808,
-31717,
-31714,
-31761,
-31783,
-31738,
-31677,
-31709,
-31881,
-32123,
-32273,
-32295,
-32280,
-32347,
-32497,
-32583,
-32547,
-32455,
-32459,
-32593,
-32743,
-32801,
-32771,
-32751,
-32772,
-32777,
-32676,
-32501,
-32348,
-32274,
-32249,
-32238,
-32299,
-32545,
-32992,
-33492,
-33872,
-34117,
-34325,
-34594,
-34804,
-34816,
-34621,
-34393,
-34310,
-34306,
-34215,
-33886,
-33426,
-32928,
-32467,
-31968,
-31449,
-31033,
-30850,
-30911,
-31076,
-31206,
-31281,
-31364,
-31537,
-31789,
-32057,
-32281,
-32489,
-32715,
-32992,
-33208,
-33280,
-33191,
-33068,
-33054,
-33163,
-33287,
-33333,
-33289,
-33250,
-33256,
-33300,
-33305,
-33235,
-33087,
-32912,
-32800,
-32784,
-32803,
-32728,
-32508,
-32259,
-32155,
-32230,
-32331,
-32304,
-32148,
-32022,
-31991,
-32023,
-31975,
-31865,
-31720,
-31606,
-31492,
-31371,
-31253,
-31155,
-31025,
-30881,
-30747,
-30732,
-30833,
-31025,
-31328,
-31794,
-32462,
-33200,
-33877,
-34425,
-34927,
-35392,
-35747,
-35874,
-35806,
-35672,
-35551,
-35390,
-35072,
-34562,
-33898,
-33117,
-32285,
-31494,
-30911,
-30584,
-30480,
-30477,
-30561,
-30744,
-30992,
-31228,
-31423,
-31660,
-32064,
-32572,
-33046,
-33385,
-33628,
-33883,
-34099,
-34162,
-34026,
-33841,
-33789,
-33901,
-34029,
-34016,
-33878,
-33709,
-33602,
-33475,
-33273,
-32964,
-32674,
-32509,
-32480,
-32514,
-32478,
-32327,
-32090,
-31847,
-31670,
-31546,
-31462,
-31343,
-31220,
-31074,
-30978,
-30938,
-30966,
-31009,
-31000,
-30915,
-30778,
-30690,
-30683,
-30733,
-30748,
-30718,
-30730,
-30935,
-31409,
-32055,
-32722,
-33293,
-33825,
-34403,
-35040,
-35581,
-35874,
-35906,
-35836,
-35818,
-35844,
-35770,
-35473,
-34982,
-34386,
-33741,
-33028,
-32281,
-31625,
-31204,
-31020,
-30968,
-30943,
-30966,
-31103,
-31361,
-31633,
-31880,
-32117,
-32448,
-32850,
-33253,
-33565,
-33814,
-34011,
-34128,
-34100,
-33947,
-33804,
-33772,
-33807,
-33793,
-33656,
-33489,
-33378,
-33296,
-33132,
-32815,
-32429,
-32102,
-31904,
-31777,
-31673,
-31564,
-31492,
-31461,
-31470,
-31491,
-31506,
-31502,
-31474,
-31450,
-31481,
-31558,
-31672,
-31754,
-31784,
-31744,
-31626,
-31463,
-31312,
-31252,
-31250,
-31238,
-31143,
-31017,
-30987,
-31097,
-31294,
-31517,
-31810,
-32303,
-33009,
-33802,
-34466,
-34914,
-35228,
-35490,
-35748,
-35892,
-35903,
-35803,
-35694,
-35567,
-35325,
-34856,
-34176,
-33443,
-32833,
-32394,
-32092,
-31843,
-31694,
-31672,
-31781,
-31916,
-31996,
-32003,
-32007,
-32044,
-32186,
-32438,
-32832,
-33231,
-33492,
-33507,
-33380,
-33275,
-33273,
-33271,
-33188,
-33052,
-32982,
-33003,
-33010,
-32886,
-32668,
-32415,
-32182,
-31940,
-31733,
-31655,
-31728,
-31827,
-31781,
-31618,
-31484,
-31528,
-31672,
-31773,
-31766,
-31737,
-31747,
-31742,
-31651,
-31505,
-31424,
-31463,
-31531,
-31522,
-31446,
-31432,
-31530,
-31678,
-31746,
-31731,
-31741,
-31888,
-32182,
-32588,
-33071,
-33646,
-34252,
-34783,
-35142,
-35388,
-35613,
-35865,
-35991,
-35861,
-35499,
-35144,
-34955,
-34875,
-34664,
-34180,
-33542,
-32916,
-32408,
-31932,
-31476,
-31128,
-30973,
-30980,
-30990,
-30949,
-30938,
-31029,
-31168,
-31258,
-31320,
-31525,
-31966,
-32502,
-32889,
-33017,
-32997,
-33000,
-33090,
-33212,
-33326,
-33450,
-33566,
-33601,
-33520,
-33373,
-33287,
-33284,
-33289,
-33206,
-33077,
-32988,
-32994,
-33035,
-33050,
-33018,
-33004,
-33021,
-33046,
-33035,
-32953,
-32826,
-32626,
-32392,
-32122,
-31874,
-31694,
-31563,
-31479,
-31369,
-31235,
-31093,
-30985,
-30955,
-30968,
-30986,
-30970,
-30985,
-31087,
-31296,
-31549,
-31749,
-31943,
-32223,
-32702,
-33346,
-33980,
-34441,
-34670,
-34757,
-34842,
-34974,
-35102,
-35134,
-35055,
-34944,
-34841,
-34716,
-34429,
-33939,
-33335,
-32787,
-32408,
-32177,
-32052,
-32021,
-32102,
-32227,
-32302,
-32282,
-32280,
-32399,
-32651,
-32919,
-33134,
-33336,
-33568,
-33768,
-33814,
-33693,
-33524,
-33411,
-33338,
-33203,
-33046,
-32972,
-33017,
-33053,
-32926,
-32695,
-32535,
-32539,
-32587,
-32507,
-32308,
-32084,
-31932,
-31793,
-31644,
-31535,
-31513,
-31518,
-31447,
-31318,
-31255,
-31328,
-31444,
-31493,
-31497,
-31556,
-31678,
-31724,
-31629,
-31469,
-31418,
-31472,
-31534,
-31508,
-31461,
-31463,
-31495,
-31508,
-31505,
-31598,
-31828,
-32177,
-32613,
-33152,
-33784,
-34379,
-34779,
-34970,
-35036,
-35098,
-35105,
-35039,
-34901,
-34760,
-34580,
-34268,
-33811,
-33295,
-32814,
-32371,
-31929,
-31573,
-31400,
-31432,
-31553,
-31655,
-31756,
-31884,
-32025,
-32108,
-32221,
-32476,
-32909,
-33319,
-33513,
-33475,
-33363,
-33267,
-33146,
-32968,
-32809,
-32794,
-32888,
-32989,
-33023,
-33038,
-33068,
-33043,
-32940,
-32816,
-32804,
-32902,
-33005,
-33044,
-33045,
-33063,
-33020,
-32870,
-32625,
-32435,
-32301,
-32168,
-31941,
-31725,
-31568,
-31460,
-31263,
-31025,
-30887,
-30927,
-30982,
-30861,
-30594,
-30427,
-30491,
-30666,
-30736,
-30687,
-30707,
-30896,
-31194,
-31446,
-31649,
-31908,
-32286,
-32731,
-33193,
-33664,
-34156,
-34611,
-34924,
-35061,
-35081,
-35078,
-35079,
-35080,
-35033,
-34918,
-34742,
-34503,
-34236,
-33907,
-33519,
-33104,
-32792,
-32683,
-32739,
-32819,
-32796,
-32734,
-32723,
-32798,
-32832,
-32739,
-32586,
-32514,
-32598,
-32738,
-32819,
-32795,
-32739,
-32731,
-32800,
-32925,
-33073,
-33199,
-33272,
-33299,
-33287,
-33288,
-33271,
-33226,
-33109,
-32920,
-32664,
-32391,
-32146,
-31987,
-31864,
-31724,
-31493,
-31278,
-31151,
-31192,
-31264,
-31280,
-31208,
-31174,
-31255,
-31407,
-31512,
-31512,
-31473,
-31477,
-31502,
-31455,
-31295,
-31094,
-30989,
-31016,
-31131,
-31247,
-31368,
-31514,
-31729,
-31965,
-32208,
-32455,
-32737,
-33092,
-33516,
-34009,
-34494,
-34886,
-35086,
-35121,
-35074,
-35068,
-35062,
-35014,
-34872,
-34721,
-34601,
-34488,
-34275,
-33929,
-33554,
-33227,
-32989,
-32779,
-32605,
-32511,
-32507,
-32529,
-32473,
-32339,
-32181,
-32061,
-31993,
-31964,
-31999,
-32099,
-32250,
-32389,
-32487,
-32532,
-32529,
-32504,
-32480,
-32535,
-32647,
-32811,
-32934,
-33013,
-33058,
-33037,
-32960,
-32802,
-32662,
-32561,
-32479,
-32360,
-32185,
-32061,
-32005,
-32014,
-31989,
-31904,
-31786,
-31645,
-31517,
-31436,
-31442,
-31555,
-31671,
-31744,
-31753,
-31756,
-31761,
-31735,
-31703,
-31729,
-31841,
-31962,
-31998,
-31985,
-32039,
-32176,
-32251,
-32165,
-31999,
-31991,
-32204,
-32503,
-32714,
-32879,
-33110,
-33445,
-33711,
-33802,
-33780,
-33802,
-33912,
-34039,
-34138,
-34275,
-34445,
-34560,
-34479,
-34227,
-33934,
-33692,
-33465,
-33222,
-33021,
-32964,
-33009,
-33002,
-32850,
-32575,
-32334,
-32159,
-32049,
-32003,
-32080,
-32292,
-32567,
-32781,
-32901,
-32998,
-33108,
-33251,
-33363,
-33466,
-33586,
-33722,
-33825,
-33841,
-33768,
-33667,
-33553,
-33375,
-33096,
-32717,
-32371,
-32151,
-32047,
-31933,
-31709,
-31429,
-31241,
-31230,
-31280,
-31252,
-31098,
-30980,
-31010,
-31170,
-31285,
-31274,
-31202,
-31190,
-31246,
-31286,
-31224,
-31101,
-30992,
-30947,
-30954,
-31020,
-31149,
-31318,
-31446,
-31483,
-31461,
-31508,
-31677,
-31979,
-32315,
-32688,
-33100,
-33583,
-34057,
-34431,
-34628,
-34732,
-34837,
-35061,
-35354,
-35638,
-35813,
-35881,
-35860,
-35805,
-35664,
-35433,
-35084,
-34683,
-34301,
-33983,
-33752,
-33541,
-33333,
-33062,
-32749,
-32388,
-32056,
-31805,
-31703,
-31713,
-31765,
-31771,
-31727,
-31704,
-31745,
-31850,
-31965,
-32077,
-32200,
-32349,
-32466,
-32519,
-32518,
-32516,
-32530,
-32505,
-32399,
-32272,
-32202,
-32236,
-32294,
-32289,
-32197,
-32079,
-31960,
-31850,
-31716,
-31585,
-31492,
-31463,
-31474,
-31498,
-31496,
-31489,
-31473,
-31486,
-31497,
-31494,
-31471,
-31480,
-31579,
-31743,
-31890,
-31972,
-32045,
-32185,
-32379,
-32492,
-32482,
-32457,
-32559,
-32803,
-33017,
-33142,
-33263,
-33541,
-33926,
-34221,
-34318,
-34314,
-34416,
-34622,
-34793,
-34826,
-34786,
-34804,
-34866,
-34846,
-34671,
-34395,
-34127,
-33913,
-33704,
-33471,
-33182,
-32842,
-32489,
-32185,
-31996,
-31901,
-31785,
-31634,
-31492,
-31499,
-31643,
-31823,
-31933,
-32001,
-32101,
-32276,
-32503,
-32720,
-32916,
-33022,
-33037,
-33005,
-33036,
-33184,
-33340,
-33363,
-33238,
-33086,
-33042,
-33058,
-33030,
-32867,
-32630,
-32364,
-32110,
-31890,
-31771,
-31771,
-31793,
-31710,
-31486,
-31267,
-31168,
-31198,
-31241,
-31246,
-31274,
-31371,
-31531,
-31673,
-31787,
-31887,
-31982,
-32032,
-32023,
-31991,
-31978,
-31985,
-32001,
-32047,
-32152,
-32274,
-32322,
-32254,
-32182,
-32232,
-32455,
-32728,
-32965,
-33168,
-33454,
-33835,
-34223,
-34476,
-34549,
-34552,
-34572,
-34677,
-34794,
-34867,
-34842,
-34754,
-34618,
-34446,
-34225,
-33946,
-33685,
-33497,
-33387,
-33286,
-33085,
-32809,
-32516,
-32313,
-32175,
-32062,
-31926,
-31801,
-31730,
-31723,
-31742,
-31753,
-31747,
-31729,
-31738,
-31791,
-31925,
-32136,
-32383,
-32595,
-32729,
-32773,
-32775,
-32765,
-32768,
-32764,
-32764,
-32764,
-32777,
-32784,
-32725,
-32609,
-32454,
-32327,
-32238,
-32137,
-31997,
-31847,
-31748,
-31730,
-31743,
-31742,
-31739,
-31750,
-31769,
-31718,
-31598,
-31470,
-31439,
-31484,
-31525,
-31499,
-31450,
-31459,
-31548,
-31676,
-31796,
-31912,
-32024,
-32139,
-32269,
-32467,
-32731,
-33012,
-33235,
-33414,
-33652,
-33955,
-34221,
-34330,
-34304,
-34301,
-34420,
-34570,
-34622,
-34565,
-34506,
-34544,
-34618,
-34601,
-34467,
-34233,
-33983,
-33733,
-33491,
-33267,
-33050,
-32809,
-32552,
-32309,
-32096,
-31882,
-31622,
-31375,
-31241,
-31266,
-31375,
-31478,
-31570,
-31740,
-31969,
-32192,
-32333,
-32451,
-32634,
-32870,
-33076,
-33207,
-33312,
-33438,
-33522,
-33480,
-33324,
-33148,
-33042,
-32961,
-32849,
-32706,
-32574,
-32479,
-32373,
-32241,
-32109,
-32000,
-31906,
-31774,
-31630,
-31517,
-31473,
-31473,
-31481,
-31491,
-31497,
-31499,
-31471,
-31461,
-31491,
-31580,
-31692,
-31814,
-31947,
-32097,
-32200,
-32243,
-32244,
-32291,
-32388,
-32489,
-32524,
-32535,
-32579,
-32693,
-32833,
-32968,
-33131,
-33344,
-33575,
-33738,
-33824,
-33885,
-34017,
-34182,
-34313,
-34334,
-34298,
-34272,
-34297,
-34337,
-34331,
-34263,
-34166,
-34057,
-33946,
-33795,
-33603,
-33365,
-33119,
-32873,
-32624,
-32400,
-32199,
-32074,
-31975,
-31886,
-31746,
-31589,
-31491,
-31520,
-31671,
-31862,
-31981,
-32001,
-31980,
-32011,
-32126,
-32283,
-32406,
-32496,
-32592,
-32739,
-32897,
-33003,
-32987,
-32882,
-32713,
-32569,
-32479,
-32485,
-32530,
-32559,
-32502,
-32393,
-32297,
-32246,
-32242,
-32224,
-32247,
-32298,
-32414,
-32499,
-32541,
-32529,
-32520,
-32497,
-32440,
-32324,
-32183,
-32050,
-31926,
-31822,
-31741,
-31720,
-31730,
-31742,
-31755,
-31805,
-31948,
-32120,
-32243,
-32262,
-32242,
-32270,
-32396,
-32546,
-32678,
-32768,
-32870,
-33002,
-33140,
-33255,
-33345,
-33462,
-33606,
-33746,
-33811,
-33805,
-33778,
-33781,
-33801,
-33803,
-33779,
-33783,
-33798,
-33789,
-33638,
-33410,
-33161,
-33008,
-32884,
-32735,
-32510,
-32291,
-32120,
-32008,
-31897,
-31802,
-31730,
-31719,
-31728,
-31740,
-31772,
-31853,
-31987,
-32129,
-32258,
-32361,
-32463,
-32567,
-32701,
-32879,
-33108,
-33335,
-33486,
-33556,
-33555,
-33525,
-33448,
-33318,
-33167,
-33050,
-32973,
-32863,
-32678,
-32420,
-32205,
-32065,
-31994,
-31897,
-31762,
-31608,
-31502,
-31451,
-31471,
-31542,
-31664,
-31767,
-31795,
-31741,
-31682,
-31735,
-31873,
-32003,
-32027,
-31987,
-32015,
-32173,
-32363,
-32481,
-32482,
-32485,
-32543,
-32660,
-32744,
-32779,
-32787,
-32783,
-32758,
-32731,
-32743,
-32836,
-32950,
-33010,
-33019,
-33049,
-33142,
-33255,
-33294,
-33297,
-33340,
-33455,
-33571,
-33583,
-33532,
-33496,
-33526,
-33566,
-33550,
-33514,
-33515,
-33556,
-33565,
-33483,
-33340,
-33204,
-33100,
-33001,
-32873,
-32741,
-32624,
-32524,
-32413,
-32280,
-32136,
-32036,
-31983,
-31982,
-31998,
-32006,
-32004,
-32002,
-31991,
-31988,
-31999,
-32072,
-32207,
-32358,
-32477,
-32558,
-32669,
-32823,
-32969,
-33034,
-33024,
-33018,
-33046,
-33034,
-32939,
-32796,
-32734,
-32756,
-32762,
-32641,
-32447,
-32296,
-32262,
-32266,
-32251,
-32229,
-32252,
-32288,
-32274,
-32213,
-32207,
-32320,
-32462,
-32500,
-32391,
-32258,
-32204,
-32245,
-32281,
-32270,
-32237,
-32235,
-32272,
-32281,
-32232,
-32105,
-31976,
-31934,
-31995,
-32145,
-32241,
-32265,
-32248,
-32296,
-32432,
-32582,
-32704,
-32789,
-32906,
-33047,
-33172,
-33265,
-33369,
-33507,
-33657,
-33759,
-33794,
-33802,
-33809,
-33792,
-33772,
-33767,
-33810,
-33849,
-33788,
-33599,
-33362,
-33178,
-33057,
-32920,
-32703,
-32446,
-32269,
-32234,
-32280,
-32281,
-32163,
-31997,
-31913,
-31978,
-32117,
-32214,
-32225,
-32241,
-32308,
-32423,
-32486,
-32503,
-32532,
-32626,
-32726,
-32769,
-32776,
-32835,
-32951,
-33008,
-32916,
-32753,
-32679,
-32756,
-32843,
-32800,
-32641,
-32512,
-32494,
-32530,
-32494,
-32351,
-32191,
-32060,
-32003,
-31982,
-31994,
-32010,
-32008,
-31984,
-31980,
-32052,
-32176,
-32316,
-32432,
-32550,
-32674,
-32770,
-32794,
-32777,
-32766,
-32758,
-32711,
-32577,
-32467,
-32450,
-32538,
-32579,
-32501,
-32336,
-32233,
-32231,
-32271,
-32277,
-32240,
-32234,
-32254,
-32308,
-32385,
-32559,
-32817,
-33088,
-33240,
-33251,
-33229,
-33282,
-33449,
-33682,
-33887,
-34041,
-34084,
-34061,
-34003,
-34017,
-34079,
-34123,
-34030,
-33828,
-33609,
-33450,
-33318,
-33142,
-32920,
-32727,
-32585,
-32449,
-32252,
-32017,
-31833,
-31725,
-31652,
-31547,
-31450,
-31425,
-31521,
-31675,
-31808,
-31901,
-31990,
-32120,
-32275,
-32414,
-32480,
-32498,
-32512,
-32585,
-32691,
-32775,
-32791,
-32793,
-32866,
-33018,
-33111,
-33061,
-32872,
-32756,
-32798,
-32978,
-33097,
-33073,
-32954,
-32835,
-32778,
-32756,
-32745,
-32762,
-32785,
-32787,
-32760,
-32734,
-32763,
-32804,
-32804,
-32708,
-32597,
-32525,
-32515,
-32492,
-32408,
-32295,
-32220,
-32222,
-32263,
-32279,
-32264,
-32235,
-32241,
-32261,
-32274,
-32261,
-32235,
-32243,
-32266,
-32280,
-32253,
-32219,
-32228,
-32316,
-32427,
-32503,
-32519,
-32529,
-32594,
-32728,
-32884,
-33007,
-33096,
-33201,
-33336,
-33484,
-33566,
-33561,
-33516,
-33505,
-33544,
-33577,
-33543,
-33443,
-33330,
-33223,
-33099,
-32947,
-32821,
-32767,
-32779,
-32755,
-32653,
-32524,
-32468,
-32494,
-32535,
-32529,
-32495,
-32498,
-32521,
-32530,
-32503,
-32490,
-32513,
-32537,
-32515,
-32471,
-32493,
-32591,
-32719,
-32787,
-32784,
-32770,
-32760,
-32760,
-32758,
-32774,
-32791,
-32778,
-32682,
-32559,
-32481,
-32483,
-32521,
-32529,
-32510,
-32495,
-32510,
-32518,
-32519,
-32502,
-32507,
-32517,
-32512,
-32514,
-32503,
-32518,
-32510,
-32512,
-32504,
-32517,
-32518,
-32507,
-32500,
-32511,
-32525,
-32517,
-32492,
-32496,
-32533,
-32548,
-32489,
-32363,
-32271,
-32250,
-32249,
-32184,
-32065,
-31960,
-31954,
-32008,
-32033,
-32010,
-31965,
-31985,
-32083,
-32253,
-32464,
-32686,
-32884,
-33007,
-33074,
-33157,
-33336,
-33598,
-33855,
-33993,
-34025,
-34029,
-34059,
-34096,
-34058,
-33944,
-33840,
-33810,
-33807,
-33737,
-33521,
-33275,
-33090,
-33002,
-32941,
-32819,
-32668,
-32535,
-32438,
-32348,
-32215,
-32080,
-31951,
-31843,
-31763,
-31705,
-31726,
-31756,
-31770,
-31731,
-31706,
-31777,
-31913,
-32064,
-32166,
-32258,
-32382,
-32521,
-32647,
-32737,
-32843,
-32981,
-33123,
-33232,
-33297,
-33313,
-33264,
-33141,
-33004,
-32956,
-33025,
-33089,
-33051,
-32904,
-32785,
-32777,
-32789,
-32727,
-32591,
-32497,
-32500,
-32510,
-32422,
-32270,
-32187,
-32232,
-32310,
-32298,
-32179,
-32051,
-31993,
-31990,
-31993,
-31995,
-32005,
-32014,
-31998,
-31967,
-31983,
-32072,
-32197,
-32273,
-32281,
-32258,
-32242,
-32249,
-32249,
-32263,
-32323,
-32464,
-32626,
-32755,
-32777,
-32760,
-32778,
-32900,
-33067,
-33200,
-33276,
-33358,
-33518,
-33690,
-33784,
-33769,
-33763,
-33858,
-34000,
-34039,
-33920,
-33773,
-33742,
-33787,
-33775,
-33579,
-33314,
-33084,
-32946,
-32830,
-32704,
-32583,
-32496,
-32381,
-32229,
-32080,
-32007,
-32020,
-31999,
-31918,
-31789,
-31731,
-31716,
-31737,
-31734,
-31772,
-31858,
-31991,
-32124,
-32252,
-32383,
-32473,
-32516,
-32512,
-32562,
-32668,
-32781,
-32816,
-32774,
-32739,
-32750,
-32776,
-32788,
-32777,
-32762,
-32716,
-32600,
-32475,
-32433,
-32536,
-32690,
-32788,
-32780,
-32757,
-32755,
-32778,
-32775,
-32755,
-32761,
-32778,
-32773,
-32747,
-32765,
-32888,
-33036,
-33106,
-33031,
-32892,
-32791,
-32765,
-32759,
-32760,
-32755,
-32782,
-32794,
-32751,
-32647,
-32520,
-32396,
-32282,
-32143,
-32035,
-31969,
-31981,
-32012,
-32018,
-31990,
-31970,
-32005,
-32107,
-32242,
-32372,
-32484,
-32589,
-32712,
-32835,
-32961,
-33061,
-33176,
-33306,
-33444,
-33538,
-33560,
-33538,
-33518,
-33527,
-33555,
-33551,
-33502,
-33379,
-33233,
-33088,
-33017,
-33018,
-33022,
-32955,
-32805,
-32644,
-32539,
-32466,
-32348,
-32178,
-32039,
-31994,
-32020,
-31994,
-31887,
-31748,
-31689,
-31724,
-31824,
-31938,
-32065,
-32188,
-32301,
-32403,
-32534,
-32673,
-32779,
-32782,
-32762,
-32802,
-32966,
-33150,
-33258,
-33270,
-33275,
-33293,
-33299,
-33269,
-33243,
-33283,
-33331,
-33294,
-33168,
-33049,
-33026,
-33034,
-32983,
-32853,
-32756,
-32756,
-32755,
-32682,
-32526,
-32446,
-32480,
-32567,
-32554,
-32441,
-32306,
-32242,
-32240,
-32253,
-32257,
-32258,
-32262,
-32250,
-32245,
-32253,
-32279,
-32274,
-32199,
-32082,
-31992,
-31963,
-31990,
-32015,
-32015,
-31999,
-31981,
-31982,
-31999,
-32059,
-32155,
-32294,
-32440,
-32561,
-32655,
-32751,
-32875,
-33033,
-33172,
-33241,
-33267,
-33279,
-33347,
-33449,
-33533,
-33572,
-33555,
-33523,
-33511,
-33525,
-33557,
-33569,
-33530,
-33462,
-33355,
-33250,
-33104,
-32959,
-32834,
-32788,
-32782,
-32750,
-32655,
-32548,
-32499,
-32496,
-32467,
-32348,
-32227,
-32179,
-32277,
-32420,
-32526,
-32545,
-32505,
-32474,
-32498,
-32589,
-32715,
-32792,
-32802,
-32756,
-32743,
-32772,
-32787,
-32774,
-32738,
-32759,
-32802,
-32792,
-32693,
-32561,
-32489,
-32493,
-32514,
-32520,
-32512,
-32517,
-32506,
-32490,
-32498,
-32591,
-32718,
-32802,
-32797,
-32752,
-32748,
-32767,
-32786,
-32764,
-32768,
-32765,
-32719,
-32568,
-32384,
-32267,
-32265,
-32279,
-32226,
-32099,
-31984,
-31957,
-31996,
-32035,
-32017,
-31916,
-31782,
-31685,
-31697,
-31810,
-31939,
-32001,
-32000,
-32008,
-32097,
-32237,
-32382,
-32494,
-32595,
-32706,
-32833,
-32957,
-33076,
-33189,
-33294,
-33415,
-33550,
-33688,
-33777,
-33795,
-33790,
-33844,
-33974,
-34093,
-34109,
-34016,
-33878,
-33767,
-33665,
-33543,
-33412,
-33292,
-33189,
-33077,
-32941,
-32821,
-32715,
-32612,
-32476,
-32332,
-32249,
-32233,
-32259,
-32265,
-32253,
-32249,
-32253,
-32262,
-32255,
-32255,
-32260,
-32251,
-32235,
-32259,
-32359,
-32493,
-32566,
-32536,
-32468,
-32469,
-32566,
-32707,
-32793,
-32811,
-32745,
-32634,
-32521,
-32459,
-32493,
-32554,
-32548,
-32447,
-32296,
-32226,
-32232,
-32275,
-32273,
-32241,
-32221,
-32262,
-32357,
-32473,
-32547,
-32547,
-32492,
-32463,
-32538,
-32684,
-32797,
-32811,
-32745,
-32732,
-32772,
-32818,
-32781,
-32672,
-32562,
-32507,
-32490,
-32499,
-32514,
-32530,
-32523,
-32493,
-32486,
-32519,
-32557,
-32528,
-32419,
-32312,
-32256,
-32248,
-32235,
-32225,
-32279,
-32389,
-32494,
-32518,
-32518,
-32565,
-32689,
-32837,
-32961,
-33078,
-33200,
-33284,
-33290,
-33288,
-33351,
-33509,
-33622,
-33583,
-33428,
-33302,
-33278,
-33296,
-33254,
-33140,
-33008,
-32893,
-32766,
-32626,
-32531,
-32503,
-32515,
-32458,
-32340,
-32219,
-32204,
-32258,
-32309,
-32262,
-32130,
-31996,
-31937,
-31985,
-32103,
-32209,
-32256,
-32260,
-32294,
-32390,
-32515,
-32568,
-32529,
-32461,
-32483,
-32601,
-32756,
-32811,
-32784,
-32724,
-32746,
-32803,
-32824,
-32730,
-32595,
-32524,
-32594,
-32724,
-32811,
-32803,
-32755,
-32741,
-32763,
-32786,
-32775,
-32754,
-32758,
-32771,
-32778,
-32770,
-32752,
-32766,
-32770,
-32782,
-32763,
-32755,
-32758,
-32782,
-32794,
-32756,
-32657,
-32536,
-32462,
-32487,
-32542,
-32557,
-32462,
-32326,
-32226,
-32222,
-32269,
-32293,
-32252,
-32143,
-32029,
-31961,
-31974,
-32020,
-32030,
-31981,
-31952,
-32017,
-32160,
-32270,
-32273,
-32245,
-32306,
-32466,
-32635,
-32730,
-32798,
-32924,
-33094,
-33228,
-33270,
-33275,
-33288,
-33301,
-33276,
-33245,
-33268,
-33324,
-33319,
-33209,
-33077,
-33023,
-33040,
-33005,
-32895,
-32773,
-32752,
-32761,
-32715,
-32570,
-32460,
-32464,
-32541,
-32570,
-32481,
-32348,
-32251,
-32229,
-32247,
-32275,
-32264,
-32239,
-32228,
-32293,
-32435,
-32546,
-32565,
-32483,
-32455,
-32518,
-32657,
-32748,
-32773,
-32775,
-32778,
-32771,
-32747,
-32748,
-32792,
-32817,
-32738,
-32602,
-32519,
-32590,
-32723,
-32816,
-32794,
-32759,
-32738,
-32772,
-32775,
-32774,
-32763,
-32757,
-32765,
-32767,
-32795,
-32774,
-32702,
-32562,
-32479,
-32474,
-32528,
-32540,
-32501,
-32480,
-32516,
-32554,
-32526,
-32407,
-32292,
-32233,
-32233,
-32257,
-32265,
-32266,
-32249,
-32245,
-32247,
-32269,
-32270,
-32249,
-32233,
-32250,
-32286,
-32270,
-32220,
-32210,
-32294,
-32429,
-32496,
-32499,
-32519,
-32613,
-32730,
-32775,
-32772,
-32813,
-32929,
-33041,
-33064,
-33028,
-33003,
-33014,
-33018,
-33026,
-33088,
-33225,
-33329,
-33325,
-33252,
-33231,
-33300,
-33338,
-33270,
-33121,
-33032,
-33010,
-33023,
-33007,
-33018,
-33048,
-33058,
-32968,
-32842,
-32772,
-32768,
-32754,
-32653,
-32539,
-32492,
-32495,
-32459,
-32336,
-32223,
-32205,
-32253,
-32293,
-32269,
-32237,
-32232,
-32246,
-32271,
-32333,
-32442,
-32543,
-32563,
-32511,
-32471,
-32496,
-32538,
-32535,
-32496,
-32481,
-32517,
-32540,
-32518,
-32486,
-32491,
-32528,
-32538,
-32504,
-32481,
-32504,
-32540,
-32535,
-32488,
-32467,
-32511,
-32608,
-32701,
-32772,
-32793,
-32789,
-32754,
-32741,
-32761,
-32796,
-32786,
-32749,
-32730,
-32771,
-32819,
-32795,
-32687,
-32579,
-32528,
-32523,
-32480,
-32390,
-32279,
-32228,
-32227,
-32255,
-32276,
-32266,
-32251,
-32233,
-32250,
-32275,
-32279,
-32236,
-32209,
-32254,
-32378,
-32478,
-32507,
-32504,
-32565,
-32686,
-32779,
-32781,
-32778,
-32861,
-33012,
-33098,
-33047,
-32963,
-32978,
-33108,
-33242,
-33289,
-33284,
-33279,
-33288,
-33274,
-33259,
-33281,
-33317,
-33299,
-33184,
-33059,
-33017,
-33026,
-32997,
-32872,
-32758,
-32730,
-32759,
-32716,
-32551,
-32364,
-32254,
-32252,
-32265,
-32255,
-32241,
-32248,
-32271,
-32262,
-32244,
-32244,
-32265,
-32267,
-32240,
-32227,
-32309,
-32444,
-32553,
-32556,
-32485,
-32458,
-32519,
-32652,
-32757,
-32791,
-32775,
-32757,
-32763,
-32771,
-32771,
-32762,
-32764,
-32773,
-32776,
-32759,
-32756,
-32767,
-32796,
-32777,
-32700,
-32570,
-32491,
-32472,
-32514,
-32536,
-32517,
-32496,
-32496,
-32520,
-32529,
-32508,
-32494,
-32504,
-32527,
-32523,
-32506,
-32489,
-32513,
-32526,
-32521,
-32494,
-32495,
-32522,
-32534,
-32509,
-32480,
-32497,
-32548,
-32551,
-32475,
-32355,
-32270,
-32246,
-32239,
-32229,
-32253,
-32330,
-32446,
-32530,
-32544,
-32511,
-32484,
-32506,
-32608,
-32768,
-32924,
-33009,
-33012,
-33010,
-33084,
-33208,
-33307,
-33309,
-33276,
-33257,
-33280,
-33285,
-33280,
-33286,
-33286,
-33230,
-33089,
-32966,
-32971,
-33059,
-33098,
-32990,
-32840,
-32771,
-32790,
-32776,
-32665,
-32544,
-32501,
-32513,
-32474,
-32350,
-32238,
-32213,
-32253,
-32278,
-32263,
-32241,
-32248,
-32261,
-32257,
-32259,
-32255,
-32248,
-32234,
-32273,
-32382,
-32522,
-32569,
-32516,
-32453,
-32487,
-32609,
-32729,
-32772,
-32778,
-32778,
-32775,
-32748,
-32737,
-32777,
-32893,
-32990,
-33042,
-33042,
-33040,
-33027,
-32969,
-32862,
-32770,
-32725,
-32752,
-32773,
-32792,
-32785,
-32753,
-32686,
-32579,
-32490,
-32472,
-32500,
-32542,
-32530,
-32499,
-32487,
-32510,
-32535,
-32523,
-32491,
-32489,
-32515,
-32547,
-32514,
-32482,
-32479,
-32543,
-32570,
-32496,
-32351,
-32270,
-32324,
-32459,
-32544,
-32544,
-32501,
-32494,
-32508,
-32519,
-32515,
-32513,
-32511,
-32493,
-32498,
-32573,
-32716,
-32821,
-32808,
-32729,
-32704,
-32810,
-32942,
-33013,
-33011,
-33029,
-33121,
-33231,
-33301,
-33307,
-33288,
-33268,
-33255,
-33273,
-33305,
-33319,
-33257,
-33143,
-33056,
-33034,
-33016,
-32950,
-32833,
-32772,
-32755,
-32730,
-32633,
-32526,
-32488,
-32488,
-32442,
-32309,
-32204,
-32205,
-32275,
-32299,
-32252,
-32216,
-32250,
-32293,
-32268,
-32212,
-32229,
-32357,
-32492,
-32544,
-32515,
-32499,
-32511,
-32514,
-32496,
-32513,
-32625,
-32766,
-32836,
-32778,
-32717,
-32723,
-32854,
-32975,
-33044,
-33035,
-33016,
-33017,
-33028,
-33030,
-33018,
-33011,
-33026,
-33047,
-33037,
-32967,
-32846,
-32745,
-32719,
-32771,
-32816,
-32778,
-32647,
-32514,
-32461,
-32504,
-32554,
-32543,
-32440,
-32326,
-32248,
-32233,
-32246,
-32256,
-32268,
-32272,
-32254,
-32179,
-32058,
-31952,
-31945,
-32039,
-32185,
-32283,
-32292,
-32238,
-32213,
-32251,
-32374,
-32479,
-32534,
-32516,
-32537,
-32648,
-32833,
-32988,
-33024,
-33003,
-33021,
-33132,
-33270,
-33321,
-33297,
-33248,
-33263,
-33298,
-33297,
-33271,
-33256,
-33283,
-33305,
-33279,
-33254,
-33265,
-33323,
-33309,
-33202,
-33066,
-33011,
-33029,
-33011,
-32893,
-32758,
-32724,
-32763,
-32742,
-32574,
-32356,
-32259,
-32273,
-32301,
-32206,
-32074,
-31989,
-32000,
-31995,
-31979,
-31983,
-32094,
-32221,
-32283,
-32253,
-32280,
-32402,
-32552,
-32579,
-32498,
-32437,
-32505,
-32652,
-32751,
-32777,
-32768,
-32779,
-32778,
-32750,
-32734,
-32793,
-32919,
-33020,
-33052,
-33030,
-33016,
-33017,
-33020,
-33022,
-33034,
-33043,
-32991,
-32874,
-32752,
-32718,
-32761,
-32819,
-32784,
-32668,
-32541,
-32472,
-32489,
-32539,
-32546,
-32481,
-32351,
-32251,
-32217,
-32252,
-32273,
-32268,
-32240,
-32246,
-32263,
-32265,
-32249,
-32238,
-32263,
-32274,
-32256,
-32220,
-32243,
-32353,
-32481,
-32556,
-32533,
-32482,
-32475,
-32546,
-32676,
-32778,
-32811,
-32771,
-32718,
-32755,
-32860,
-32995,
-33052,
-33041,
-33009,
-33012,
-33030,
-33034,
-33017,
-33011,
-33024,
-33035,
-33023,
-33013,
-33018,
-33034,
-33033,
-33008,
-33007,
-33037,
-33056,
-33017,
-32900,
-32785,
-32723,
-32750,
-32794,
-32805,
-32716,
-32583,
-32480,
-32466,
-32531,
-32563,
-32507,
-32380,
-32273,
-32233,
-32247,
-32256,
-32257,
-32258,
-32264,
-32244,
-32231,
-32264,
-32373,
-32506,
-32560,
-32528,
-32469,
-32483,
-32574,
-32708,
-32787,
-32803,
-32761,
-32723,
-32768,
-32882,
-33017,
-33070,
-33035,
-32989,
-33004,
-33060,
-33064,
-32970,
-32855,
-32763,
-32759,
-32748,
-32765,
-32771,
-32801,
-32776,
-32694,
-32570,
-32500,
-32483,
-32503,
-32517,
-32524,
-32534,
-32502,
-32413,
-32291,
-32221,
-32224,
-32266,
-32276,
-32256,
-32238,
-32249,
-32262,
-32264,
-32254,
-32245,
-32256,
-32260,
-32263,
-32259,
-32236,
-32237,
-32280,
-32400,
-32526,
-32569,
-32516,
-32448,
-32491,
-32621,
-32744,
-32772,
-32754,
-32808,
-32925,
-33047,
-33065,
-33026,
-32993,
-33013,
-33039,
-33038,
-33014,
-33008,
-33026,
-33037,
-33028,
-33012,
-33016,
-33027,
-33037,
-33019,
-33015,
-33014,
-33036,
-33035,
-33018,
-33004,
-33013,
-33051,
-33056,
-32993,
-32878,
-32786,
-32756,
-32760,
-32700,
-32576,
-32465,
-32457,
-32534,
-32574,
-32492,
-32342,
-32236,
-32230,
-32264,
-32276,
-32243,
-32241,
-32253,
-32281,
-32262,
-32230,
-32226,
-32284,
-32396,
-32496,
-32556,
-32527,
-32485,
-32477,
-32573,
-32719,
-32814,
-32804,
-32731,
-32714,
-32797,
-32921,
-33009,
-33037,
-33034,
-33032,
-33018,
-33004,
-33015,
-33046,
-33059,
-32987,
-32870,
-32766,
-32743,
-32756,
-32772,
-32771,
-32786,
-32778,
-32719,
-32590,
-32484,
-32466,
-32517,
-32547,
-32514,
-32478,
-32498,
-32550,
-32541,
-32431,
-32302,
-32227,
-32240,
-32261,
-32268,
-32250,
-32251,
-32254,
-32257,
-32255,
-32257,
-32259,
-32240,
-32235,
-32292,
-32411,
-32535,
-32563,
-32509,
-32457,
-32500,
-32622,
-32750,
-32801,
-32780,
-32743,
-32737,
-32805,
-32922,
-33038,
-33074,
-33030,
-32968,
-33003,
-33125,
-33258,
-33304,
-33286,
-33276,
-33292,
-33266,
-33145,
-33005,
-32958,
-33023,
-33091,
-33044,
-32911,
-32792,
-32760,
-32764,
-32760,
-32754,
-32778,
-32801,
-32760,
-32639,
-32522,
-32480,
-32505,
-32516,
-32518,
-32511,
-32527,
-32485,
-32365,
-32238,
-32196,
-32258,
-32306,
-32265,
-32206,
-32217,
-32347,
-32467,
-32528,
-32514,
-32517,
-32518,
-32507,
-32480,
-32510,
-32616,
-32744,
-32800,
-32783,
-32755,
-32755,
-32772,
-32775,
-32767,
-32769,
-32765,
-32751,
-32762,
-32849,
-32985,
-33074,
-33059,
-32989,
-32987,
-33045,
-33081,
-33005,
-32861,
-32767,
-32748,
-32770,
-32765,
-32761,
-32779,
-32791,
-32729,
-32599,
-32479,
-32463,
-32522,
-32564,
-32515,
-32392,
-32279,
-32226,
-32240,
-32264,
-32271,
-32250,
-32243,
-32252,
-32272,
-32259,
-32226,
-32245,
-32340,
-32485,
-32561,
-32538,
-32470,
-32466,
-32562,
-32683,
-32772,
-32784,
-32776,
-32760,
-32760,
-32763,
-32771,
-32776,
-32765,
-32758,
-32761,
-32779,
-32777,
-32761,
-32743,
-32775,
-32794,
-32775,
-32722,
-32735,
-32850,
-32988,
-33005,
-32886,
-32749,
-32713,
-32763,
-32803,
-32774,
-32745,
-32750,
-32787,
-32780,
-32758,
-32747,
-32773,
-32788,
-32762,
-32744,
-32765,
-32806,
-32780,
-32671,
-32547,
-32483,
-32494,
-32519,
-32521,
-32509,
-32507,
-32508,
-32516,
-32512,
-32513,
-32509,
-32504,
-32509,
-32523,
-32521,
-32496,
-32483,
-32532,
-32654,
-32768,
-32806,
-32774,
-32744,
-32753,
-32783,
-32779,
-32759,
-32755,
-32769,
-32782,
-32767,
-32756,
-32764,
-32779,
-32773,
-32756,
-32762,
-32773,
-32784,
-32753,
-32749,
-32777,
-32804,
-32759,
-32637,
-32519,
-32474,
-32502,
-32529,
-32518,
-32503,
-32499,
-32518,
-32518,
-32511,
-32501,
-32512,
-32514,
-32513,
-32505,
-32510,
-32516,
-32514,
-32508,
-32508,
-32510,
-32514,
-32510,
-32505,
-32517,
-32510,
-32516,
-32504,
-32512,
-32516,
-32513,
-32507,
-32509,
-32515,
-32516,
-32510,
-32500,
-32517,
-32517,
-32517,
-32496,
-32507,
-32522,
-32528,
-32494,
-32478,
-32533,
-32652,
-32768,
-32802,
-32776,
-32752,
-32755,
-32777,
-32776,
-32758,
-32760,
-32767,
-32776,
-32768,
-32763,
-32763,
-32774,
-32769,
-32765,
-32765,
-32768,
-32771,
-32765,
-32763,
-32770,
-32768,
-32769,
-32761,
-32769,
-32769,
-32771,
-32759,
-32765,
-32772,
-32769,
-32765,
-32758,
-32772,
-32783,
-32759,
-32755,
-32757,
-32800,
-32787,
-32695,
-32566,
-32481,
-32483,
-32521,
-32531,
-32508,
-32499,
-32508,
-32524,
-32513,
-32500,
-32504,
-32522,
-32518,
-32503,
-32500,
-32519,
-32531,
-32503,
-32477,
-32507,
-32615,
-32738,
-32797,
-32790,
-32751,
-32754,
-32764,
-32785,
-32771,
-32758,
-32761,
-32768,
-32777,
-32766,
-32760,
-32759,
-32776,
-32776,
-32770,
-32751,
-32758,
-32782,
-32800,
-32758,
-32657,
-32545,
-32478,
-32485,
-32519,
-32530,
-32515,
-32497,
-32502,
-32522,
-32523,
-32509,
-32501,
-32505,
-32521,
-32519,
-32504,
-32502,
-32512,
-32524,
-32516,
-32498,
-32499,
-32517,
-32533,
-32506,
-32481,
-32494,
-32582,
-32711,
-32788,
-32801,
-32761,
-32741,
-32768,
-32796,
-32776,
-32672,
-32535,
-32451,
-32469,
-32592,
-32715,
-32788,
-32786,
-32762,
-32757,
-32769,
-32772,
-32768,
-32757,
-32771,
-32772,
-32769,
-32756,
-32764,
-32777,
-32780,
-32753,
-32753,
-32770,
-32804,
-32772,
-32668,
-32553,
-32484,
-32488,
-32516,
-32529,
-32516,
-32502,
-32504,
-32510,
-32522,
-32513,
-32504,
-32500,
-32513,
-32526,
-32520,
-32491,
-32484,
-32540,
-32652,
-32766,
-32801,
-32781,
-32750,
-32750,
-32779,
-32778,
-32768,
-32753,
-32768,
-32770,
-32774,
-32758,
-32764,
-32773,
-32771,
-32766,
-32758,
-32769,
-32774,
-32766,
-32762,
-32770,
-32775,
-32768,
-32750,
-32765,
-32793,
-32782,
-32690,
-32555,
-32476,
-32483,
-32525,
-32536,
-32503,
-32494,
-32506,
-32533,
-32513,
-32495,
-32499,
-32531,
-32530,
-32491,
-32474,
-32539,
-32679,
-32780,
-32803,
-32761,
-32744,
-32763,
-32790,
-32773,
-32747,
-32752,
-32789,
-32801,
-32740,
-32612,
-32506,
-32470,
-32506,
-32540,
-32524,
-32482,
-32479,
-32572,
-32703,
-32797,
-32797,
-32760,
-32737,
-32773,
-32790,
-32770,
-32746,
-32747,
-32803,
-32800,
-32711,
-32581,
-32485,
-32487,
-32518,
-32528,
-32510,
-32497,
-32511,
-32523,
-32513,
-32503,
-32504,
-32522,
-32517,
-32502,
-32498,
-32519,
-32533,
-32508,
-32476,
-32501,
-32594,
-32722,
-32789,
-32794,
-32763,
-32750,
-32766,
-32774,
-32777,
-32759,
-32761,
-32767,
-32776,
-32770,
-32763,
-32758,
-32769,
-32774,
-32770,
-32760,
-32759,
-32774,
-32777,
-32767,
-32749,
-32761,
-32795,
-32790,
-32718,
-32592,
-32501,
-32477,
-32512,
-32526,
-32519,
-32500,
-32503,
-32519,
-32516,
-32512,
-32503,
-32513,
-32516,
-32509,
-32506,
-32510,
-32515,
-32515,
-32504,
-32511,
-32515,
-32516,
-32508,
-32502,
-32518,
-32516,
-32510,
-32496,
-32514,
-32529,
-32519,
-32484,
-32483,
-32578,
-32706,
-32796,
-32794,
-32759,
-32744,
-32772,
-32778,
-32771,
-32753,
-32763,
-32776,
-32773,
-32759,
-32762,
-32769,
-32779,
-32760,
-32760,
-32767,
-32778,
-32770,
-32755,
-32762,
-32779,
-32775,
-32755,
-32749,
-32782,
-32806,
-32752,
-32631,
-32513,
-32478,
-32503,
-32529,
-32519,
-32504,
-32499,
-32518,
-32514,
-32511,
-32506,
-32510,
-32516,
-32509,
-32509,
-32510,
-32518,
-32510,
-32508,
-32508,
-32514,
-32515,
-32506,
-32509,
-32513,
-32516,
-32509,
-32505,
-32512,
-32520,
-32514,
-32498,
-32506,
-32523,
-32531,
-32499,
-32475,
-32513,
-32621,
-32742,
-32796,
-32789,
-32757,
-32749,
-32771,
-32775,
-32776,
-32759,
-32762,
-32766,
-32778,
-32768,
-32764,
-32755,
-32771,
-32775,
-32777,
-32752,
-32753,
-32779,
-32798,
-32766,
-32647,
-32533,
-32474,
-32494,
-32529,
-32524,
-32504,
-32497,
-32514,
-32525,
-32508,
-32501,
-32506,
-32525,
-32514,
-32500,
-32502,
-32527,
-32526,
-32497,
-32472,
-32535,
-32657,
-32770,
-32801,
-32774,
-32748,
-32758,
-32779,
-32775,
-32765,
-32758,
-32768,
-32774,
-32767,
-32760,
-32763,
-32770,
-32771,
-32766,
-32764,
-32768,
-32767,
-32771,
-32761,
-32771,
-32764,
-32772,
-32765,
-32768,
-32768,
-32765,
-32767,
-32767,
-32767,
-32769,
-32768,
-32768,
-32770,
-32765,
-32763,
-32766,
-32770,
-32774,
-32763,
-32760,
-32767,
-32774,
-32773,
-32754,
-32756,
-32777,
-32800,
-32759,
-32655,
-32537,
-32477,
-32487,
-32524,
-32530,
-32510,
-32497,
-32505,
-32523,
-32519,
-32504,
-32500,
-32512,
-32522,
-32516,
-32501,
-32502,
-32517,
-32520,
-32512,
-32497,
-32506,
-32522,
-32523,
-32506,
-32491,
-32512,
-32532,
-32523,
-32482,
-32479,
-32552,
-32679,
-32771,
-32786,
-32777,
-32771,
-32769,
-32701,
-32568,
-32451,
-32453,
-32569,
-32709,
-32784,
-32782,
-32765,
-32757,
-32772,
-32770,
-32765,
-32764,
-32765,
-32771,
-32766,
-32767,
-32765,
-32769,
-32767,
-32768,
-32768,
-32768,
-32768,
-32765,
-32771,
-32766,
-32765,
-32763,
-32770,
-32772,
-32764,
-32755,
-32769,
-32795,
-32774,
-32689,
-32550,
-32474,
-32477,
-32534,
-32542,
-32498,
-32463,
-32519,
-32650,
-32762,
-32797,
-32776,
-32744,
-32765,
-32776,
-32781,
-32753,
-32753,
-32776,
-32802,
-32760,
-32653,
-32525,
-32471,
-32489,
-32541,
-32533,
-32489,
-32468,
-32541,
-32677,
-32777,
-32800,
-32766,
-32748,
-32763,
-32780,
-32772,
-32762,
-32758,
-32775,
-32772,
-32766,
-32757,
-32771,
-32771,
-32770,
-32757,
-32764,
-32776,
-32770,
-32762,
-32759,
-32773,
-32781,
-32757,
-32751,
-32765,
-32803,
-32777,
-32672,
-32545,
-32476,
-32490,
-32527,
-32523,
-32508,
-32495,
-32516,
-32525,
-32509,
-32501,
-32507,
-32522,
-32518,
-32496,
-32501,
-32524,
-32529,
-32502,
-32472,
-32521,
-32637,
-32757,
-32802,
-32779,
-32753,
-32753,
-32777,
-32777,
-32764,
-32757,
-32764,
-32778,
-32770,
-32763,
-32759,
-32770,
-32774,
-32768,
-32760,
-32765,
-32769,
-32772,
-32766,
-32762,
-32769,
-32770,
-32767,
-32765,
-32764,
-32771,
-32768,
-32767,
-32762,
-32770,
-32770,
-32769,
-32762,
-32765,
-32768,
-32776,
-32761,
-32763,
-32766,
-32774,
-32771,
-32762,
-32759,
-32773,
-32775,
-32766,
-32748,
-32770,
-32791,
-32790,
-32694,
-32570,
-32478,
-32481,
-32520,
-32540,
-32504,
-32493,
-32503,
-32539,
-32518,
-32479,
-32484,
-32577,
-32707,
-32795,
-32788,
-32761,
-32750,
-32768,
-32782,
-32770,
-32758,
-32763,
-32773,
-32774,
-32761,
-32762,
-32768,
-32773,
-32767,
-32759,
-32767,
-32774,
-32772,
-32758,
-32764,
-32770,
-32781,
-32756,
-32754,
-32773,
-32799,
-32760,
-32641,
-32513,
-32463,
-32499,
-32549,
-32525,
-32482,
-32470,
-32560,
-32690,
-32778,
-32794,
-32769,
-32755,
-32760,
-32774,
-32772,
-32763,
-32764,
-32764,
-32770,
-32768,
-32764,
-32768,
-32765,
-32772,
-32763,
-32768,
-32766,
-32768,
-32768,
-32764,
-32767,
-32764,
-32770,
-32768,
-32764,
-32770,
-32763,
-32774,
-32764,
-32769,
-32764,
-32770,
-32768,
-32767,
-32761,
-32772,
-32768,
-32769,
-32753,
-32768,
-32783,
-32784,
-32702,
-32574,
-32460,
-32457,
-32557,
-32691,
-32774,
-32787,
-32767,
-32762,
-32760,
-32778,
-32763,
-32772,
-32761,
-32768,
-32768,
-32768,
-32767,
-32768,
-32765,
-32766,
-32767,
-32765,
-32768,
-32766,
-32769,
-32770,
-32765,
-32765,
-32765,
-32769,
-32771,
-32764,
-32765,
-32765,
-32772,
-32767,
-32766,
-32766,
-32771,
-32769,
-32764,
-32762,
-32766,
-32778,
-32762,
-32770,
-32756,
-32776,
-32771,
-32764,
-32758,
-32767,
-32778,
-32770,
-32757,
-32754,
-32779,
-32783,
-32766,
-32740,
-32761,
-32800,
-32798,
-32714,
-32589,
-32514,
-32494,
-32501,
-32495,
-32513,
-32603,
-32720,
-32804,
-32797,
-32755,
-32743,
-32766,
-32785,
-32775,
-32753,
-32761,
-32771,
-32782,
-32761,
-32761,
-32761,
-32776,
-32772,
-32758,
-32765,
-32766,
-32777,
-32763,
-32765,
-32761,
-32776,
-32767,
-32765,
-32763,
-32768,
-32775,
-32765,
-32762,
-32765,
-32771,
-32772,
-32765,
-32762,
-32766,
-32771,
-32768,
-32762,
-32767,
-32768,
-32770,
-32766,
-32765,
-32764,
-32774,
-32765,
-32765,
-32766,
-32765,
-32772,
-32767,
-32762,
-32771,
-32763,
-32770,
-32766,
-32764,
-32772,
-32766,
-32768,
-32765,
-32770,
-32768,
-32767,
-32764,
-32767,
-32772,
-32764,
-32765,
-32762,
-32776,
-32767,
-32759,
-32758,
-32782,
-32792,
-32739,
-32615,
-32503,
-32467,
-32504,
-32543,
-32519,
-32491,
-32489,
-32533,
-32535,
-32498,
-32464,
-32533,
-32666,
-32782,
-32799,
-32763,
-32745,
-32765,
-32788,
-32768,
-32752,
-32758,
-32786,
-32781,
-32753,
-32742,
-32778,
-32808,
-32771,
-32663,
-32544,
-32492,
-32489,
-32517,
-32520,
-32517,
-32502,
-32504,
-32511,
-32517,
-32521,
-32503,
-32500,
-32510,
-32529,
-32522,
-32491,
-32476,
-32543,
-32655,
-32773,
-32796,
-32780,
-32749,
-32760,
-32774,
-32775,
-32761,
-32760,
-32770,
-32772,
-32767,
-32762,
-32768,
-32772,
-32768,
-32758,
-32769,
-32773,
-32770,
-32758,
-32763,
-32776,
-32779,
-32757,
-32746,
-32772,
-32803,
-32778,
-32677,
-32551,
-32487,
-32488,
-32515,
-32527,
-32512,
-32505,
-32503,
-32509,
-32521,
-32517,
-32514,
-32480,
-32497,
-32565,
-32690,
-32787,
-32802,
-32772,
-32740,
-32763,
-32780,
-32780,
-32760,
-32753,
-32773,
-32775,
-32767,
-32758,
-32762,
-32778,
-32770,
-32765,
-32757,
-32775,
-32770,
-32768,
-32758,
-32768,
-32775,
-32767,
-32758,
-32766,
-32774,
-32774,
-32751,
-32764,
-32788,
-32787,
-32697,
-32559,
-32474,
-32478,
-32531,
-32538,
-32503,
-32485,
-32512,
-32541,
-32520,
-32469,
-32487,
-32584,
-32718,
-32789,
-32788,
-32764,
-32755,
-32768,
-32772,
-32769,
-32764,
-32764,
-32767,
-32766,
-32769,
-32765,
-32767,
-32763,
-32772,
-32774,
-32765,
-32754,
-32765,
-32792,
-32781,
-32698,
-32563,
-32479,
-32478,
-32524,
-32538,
-32508,
-32485,
-32512,
-32537,
-32521,
-32475,
-32484,
-32583,
-32718,
-32792,
-32789,
-32757,
-32755,
-32767,
-32778,
-32767,
-32759,
-32767,
-32771,
-32768,
-32763,
-32767,
-32769,
-32771,
-32761,
-32763,
-32770,
-32772,
-32768,
-32759,
-32768,
-32768,
-32773,
-32761,
-32766,
-32767,
-32773,
-32764,
-32764,
-32768,
-32772,
-32766,
-32761,
-32762,
-32776,
-32770,
-32763,
-32757,
-32775,
-32779,
-32765,
-32747,
-32765,
-32798,
-32787,
-32686,
-32553,
-32476,
-32487,
-32526,
-32531,
-32504,
-32494,
-32513,
-32527,
-32512,
-32493,
-32509,
-32531,
-32527,
-32485,
-32477,
-32548,
-32675,
-32772,
-32798,
-32771,
-32752,
-32759,
-32776,
-32772,
-32768,
-32757,
-32765,
-32775,
-32769,
-32769,
-32760,
-32764,
-32772,
-32771,
-32765,
-32760,
-32766,
-32779,
-32771,
-32756,
-32752,
-32779,
-32801,
-32759,
-32649,
-32527,
-32479,
-32492,
-32530,
-32521,
-32503,
-32496,
-32516,
-32526,
-32510,
-32500,
-32506,
-32521,
-32517,
-32499,
-32505,
-32523,
-32527,
-32493,
-32478,
-32535,
-32660,
-32773,
-32803,
-32774,
-32746,
-32758,
-32778,
-32779,
-32759,
-32759,
-32766,
-32779,
-32768,
-32758,
-32761,
-32774,
-32770,
-32767,
-32759,
-32766,
-32776,
-32766,
-32765,
-32759,
-32775,
-32768,
-32770,
-32756,
-32767,
-32773,
-32768,
-32767,
-32758,
-32772,
-32771,
-32767,
-32763,
-32763,
-32775,
-32771,
-32763,
-32762,
-32766,
-32778,
-32765,
-32762,
-32760,
-32776,
-32775,
-32762,
-32758,
-32768,
-32782,
-32769,
-32749,
-32757,
-32791,
-32797,
-32715,
-32588,
-32487,
-32484,
-32514,
-32533,
-32508,
-32494,
-32510,
-32526,
-32520,
-32493,
-32501,
-32525,
-32531,
-32496,
-32471,
-32524,
-32640,
-32757,
-32792,
-32784,
-32752,
-32762,
-32766,
-32777,
-32766,
-32765,
-32763,
-32766,
-32774,
-32770,
-32765,
-32753,
-32765,
-32790,
-32788,
-32716,
-32593,
-32494,
-32473,
-32512,
-32535,
-32517,
-32494,
-32503,
-32522,
-32526,
-32498,
-32496,
-32520,
-32533,
-32502,
-32476,
-32512,
-32639,
-32754,
-32807,
-32777,
-32752,
-32753,
-32777,
-32774,
-32765,
-32755,
-32769,
-32778,
-32765,
-32762,
-32760,
-32773,
-32772,
-32765,
-32758,
-32770,
-32775,
-32768,
-32762,
-32761,
-32772,
-32773,
-32765,
-32761,
-32764,
-32776,
-32767,
-32768,
-32759,
-32775,
-32769,
-32767,
-32762,
-32764,
-32775,
-32769,
-32761,
-32757,
-32773,
-32771,
-32773,
-32754,
-32767,
-32774,
-32778,
-32758,
-32745,
-32773,
-32797,
-32784,
-32691,
-32573,
-32490,
-32482,
-32512,
-32529,
-32521,
-32499,
-32498,
-32515,
-32520,
-32520,
-32501,
-32500,
-32515,
-32525,
-32518,
-32492,
-32482,
-32529,
-32633,
-32742,
-32802,
-32790,
-32757,
-32745,
-32769,
-32784,
-32775,
-32754,
-32756,
-32772,
-32781,
-32765,
-32754,
-32760,
-32781,
-32775,
-32763,
-32752,
-32770,
-32783,
-32769,
-32754,
-32752,
-32782,
-32786,
-32760,
-32741,
-32760,
-32801,
-32800,
-32711,
-32594,
-32509,
-32486,
-32506,
-32514,
-32524,
-32512,
-32507,
-32500,
-32512,
-32524,
-32526,
-32489,
-32480,
-32527,
-32653,
-32761,
-32804,
-32775,
-32750,
-32759,
-32775,
-32777,
-32757,
-32760,
-32769,
-32776,
-32765,
-32758,
-32769,
-32775,
-32765,
-32760,
-32763,
-32781,
-32772,
-32756,
-32757,
-32775,
-32786,
-32759,
-32738,
-32770,
-32804,
-32791,
-32677,
-32557,
-32496,
-32504,
-32502,
-32497,
-32523,
-32638,
-32757,
-32813,
-32780,
-32744,
-32752,
-32780,
-32782,
-32762,
-32755,
-32770,
-32778,
-32765,
-32757,
-32763,
-32781,
-32767,
-32759,
-32760,
-32778,
-32775,
-32759,
-32751,
-32778,
-32785,
-32764,
-32740,
-32764,
-32806,
-32791,
-32680,
-32560,
-32493,
-32503,
-32502,
-32494,
-32526,
-32632,
-32761,
-32810,
-32785,
-32742,
-32754,
-32775,
-32787,
-32755,
-32756,
-32767,
-32780,
-32770,
-32757,
-32763,
-32773,
-32772,
-32757,
-32764,
-32775,
-32774,
-32763,
-32756,
-32774,
-32779,
-32765,
-32745,
-32765,
-32799,
-32783,
-32691,
-32565,
-32488,
-32488,
-32512,
-32524,
-32517,
-32503,
-32504,
-32508,
-32517,
-32519,
-32517,
-32484,
-32497,
-32555,
-32678,
-32780,
-32803,
-32773,
-32746,
-32754,
-32781,
-32780,
-32760,
-32755,
-32770,
-32772,
-32773,
-32757,
-32761,
-32774,
-32772,
-32765,
-32763,
-32767,
-32772,
-32767,
-32762,
-32766,
-32771,
-32771,
-32762,
-32764,
-32768,
-32770,
-32770,
-32761,
-32769,
-32768,
-32769,
-32763,
-32769,
-32765,
-32773,
-32760,
-32770,
-32770,
-32770,
-32757,
-32762,
-32780,
-32789,
-32721,
-32594,
-32471,
-32449,
-32537,
-32668,
-32768,
-32787,
-32776,
-32759,
-32756,
-32774,
-32769,
-32773,
-32758,
-32766,
-32767,
-32774,
-32769,
-32757,
-32766,
-32769,
-32776,
-32766,
-32754,
-32771,
-32777,
-32773,
-32754,
-32748,
-32781,
-32804,
-32762,
-32664,
-32545,
-32485,
-32488,
-32512,
-32525,
-32520,
-32503,
-32503,
-32506,
-32526,
-32521,
-32508,
-32478,
-32501,
-32582,
-32706,
-32787,
-32800,
-32766,
-32747,
-32759,
-32780,
-32778,
-32758,
-32762,
-32762,
-32779,
-32769,
-32762,
-32767,
-32765,
-32775,
-32762,
-32766,
-32767,
-32768,
-32770,
-32763,
-32768,
-32766,
-32769,
-32765,
-32768,
-32765,
-32768,
-32768,
-32768,
-32767,
-32767,
-32764,
-32768,
-32771,
-32766,
-32763,
-32766,
-32770,
-32774,
-32762,
-32761,
-32767,
-32780,
-32766,
-32755,
-32754,
-32792,
-32796,
-32729,
-32599,
-32496,
-32474,
-32511,
-32532,
-32517,
-32494,
-32506,
-32523,
-32519,
-32503,
-32498,
-32519,
-32526,
-32507,
-32492,
-32510,
-32531,
-32518,
-32481,
-32487,
-32581,
-32713,
-32792,
-32791,
-32761,
-32748,
-32771,
-32778,
-32770,
-32759,
-32762,
-32770,
-32772,
-32764,
-32767,
-32765,
-32771,
-32768,
-32768,
-32765,
-32761,
-32766,
-32782,
-32779,
-32708,
-32579,
-32462,
-32449,
-32557,
-32693,
-32774,
-32786,
-32763,
-32762,
-32768,
-32768,
-32769,
-32766,
-32771,
-32764,
-32763,
-32767,
-32775,
-32767,
-32756,
-32761,
-32794,
-32781,
-32698,
-32556,
-32470,
-32475,
-32536,
-32547,
-32499,
-32461,
-32517,
-32642,
-32755,
-32794,
-32775,
-32758,
-32761,
-32771,
-32773,
-32764,
-32763,
-32769,
-32768,
-32772,
-32762,
-32768,
-32765,
-32770,
-32768,
-32764,
-32769,
-32763,
-32773,
-32765,
-32766,
-32766,
-32764,
-32773,
-32765,
-32765,
-32768,
-32769,
-32771,
-32765,
-32759,
-32773,
-32772,
-32767,
-32753,
-32765,
-32794,
-32783,
-32698,
-32567,
-32479,
-32480,
-32523,
-32539,
-32504,
-32490,
-32508,
-32541,
-32520,
-32475,
-32482,
-32584,
-32712,
-32795,
-32784,
-32763,
-32750,
-32772,
-32775,
-32766,
-32762,
-32767,
-32772,
-32769,
-32761,
-32764,
-32773,
-32767,
-32766,
-32762,
-32773,
-32771,
-32763,
-32762,
-32768,
-32775,
-32768,
-32757,
-32764,
-32779,
-32776,
-32759,
-32746,
-32774,
-32799,
-32777,
-32676,
-32555,
-32483,
-32485,
-32516,
-32531,
-32514,
-32500,
-32503,
-32515,
-32522,
-32512,
-32501,
-32506,
-32514,
-32523,
-32508,
-32501,
-32504,
-32525,
-32528,
-32502,
-32476,
-32506,
-32609,
-32727,
-32797,
-32790,
-32760,
-32749,
-32768,
-32777,
-32774,
-32756,
-32764,
-32769,
-32774,
-32766,
-32762,
-32766,
-32768,
-32771,
-32763,
-32767,
-32768,
-32768,
-32766,
-32768,
-32768,
-32771,
-32765,
-32764,
-32767,
-32768,
-32766,
-32768,
-32766,
-32772,
-32766,
-32763,
-32767,
-32771,
-32768,
-32761,
-32762,
-32773,
-32777,
-32762,
-32751,
-32773,
-32796,
-32770,
-32662,
-32534,
-32471,
-32493,
-32533,
-32529,
-32498,
-32487,
-32525,
-32533,
-32511,
-32466,
-32506,
-32618,
-32740,
-32798,
-32784,
-32757,
-32754,
-32770,
-32775,
-32769,
-32758,
-32762,
-32771,
-32772,
-32769,
-32760,
-32764,
-32770,
-32774,
-32766,
-32760,
-32761,
-32777,
-32775,
-32764,
-32747,
-32765,
-32797,
-32787,
-32705,
-32576,
-32486,
-32481,
-32513,
-32534,
-32512,
-32497,
-32503,
-32522,
-32518,
-32507,
-32500,
-32518,
-32521,
-32507,
-32501,
-32510,
-32531,
-32510,
-32482,
-32497,
-32598,
-32728,
-32806,
-32791,
-32755,
-32743,
-32772,
-32786,
-32768,
-32755,
-32758,
-32781,
-32775,
-32760,
-32756,
-32771,
-32782,
-32766,
-32754,
-32763,
-32779,
-32778,
-32749,
-32754,
-32788,
-32790,
-32708,
-32555,
-32466,
-32475,
-32547,
-32545,
-32490,
-32454,
-32523,
-32653,
-32747,
-32767,
-32778,
-32789,
-32788,
-32710,
-32588,
-32508,
-32488,
-32499,
-32501,
-32517,
-32609,
-32723,
-32812,
-32792,
-32758,
-32736,
-32772,
-32787,
-32773,
-32751,
-32756,
-32781,
-32779,
-32764,
-32752,
-32766,
-32779,
-32771,
-32760,
-32759,
-32775,
-32774,
-32766,
-32754,
-32769,
-32774,
-32773,
-32759,
-32759,
-32773,
-32773,
-32767,
-32757,
-32768,
-32775,
-32772,
-32757,
-32760,
-32770,
-32779,
-32767,
-32757,
-32766,
-32776,
-32771,
-32761,
-32758,
-32772,
-32778,
-32765,
-32753,
-32767,
-32776,
-32778,
-32751,
-32758,
-32776,
-32783,
-32762,
-32739,
-32769,
-32807,
-32783,
-32666,
-32543,
-32491,
-32504,
-32509,
-32494,
-32525,
-32648,
-32779,
-32821,
-32772,
-32723,
-32759,
-32798,
-32789,
-32734,
-32734,
-32796,
-32829,
-32731,
-32582,
-32515,
-32604,
-32745,
-32817,
-32787,
-32746,
-32744,
-32778,
-32783,
-32770,
-32752,
-32764,
-32774,
-32776,
-32761,
-32761,
-32766,
-32772,
-32771,
-32761,
-32762,
-32767,
-32774,
-32774,
-32757,
-32757,
-32769,
-32798,
-32776,
-32690,
-32563,
-32478,
-32482,
-32520,
-32538,
-32506,
-32486,
-32509,
-32536,
-32524,
-32476,
-32486,
-32583,
-32719,
-32796,
-32792,
-32755,
-32753,
-32768,
-32780,
-32767,
-32760,
-32764,
-32773,
-32771,
-32759,
-32767,
-32770,
-32773,
-32766,
-32757,
-32771,
-32768,
-32771,
-32761,
-32763,
-32771,
-32770,
-32763,
-32765,
-32766,
-32776,
-32765,
-32762,
-32766,
-32771,
-32771,
-32762,
-32761,
-32777,
-32772,
-32760,
-32751,
-32776,
-32799,
-32756,
-32642,
-32512,
-32469,
-32499,
-32536,
-32528,
-32492,
-32493,
-32525,
-32538,
-32497,
-32472,
-32517,
-32643,
-32758,
-32798,
-32778,
-32751,
-32761,
-32774,
-32776,
-32761,
-32759,
-32769,
-32773,
-32771,
-32760,
-32769,
-32767,
-32771,
-32762,
-32765,
-32770,
-32770,
-32766,
-32760,
-32767,
-32770,
-32769,
-32765,
-32761,
-32772,
-32771,
-32767,
-32764,
-32764,
-32772,
-32770,
-32764,
-32765,
-32766,
-32773,
-32763,
-32764,
-32765,
-32773,
-32769,
-32763,
-32762,
-32771,
-32774,
-32767,
-32758,
-32765,
-32773,
-32772,
-32764,
-32759,
-32772,
-32778,
-32765,
-32758,
-32759,
-32781,
-32777,
-32759,
-32751,
-32770,
-32790,
-32769,
-32743,
-32748,
-32799,
-32816,
-32721,
-32586,
-32525,
-32598,
-32746,
-32812,
-32795,
-32744,
-32743,
-32775,
-32789,
-32765,
-32753,
-32759,
-32781,
-32776,
-32760,
-32756,
-32771,
-32776,
-32770,
-32759,
-32760,
-32776,
-32770,
-32768,
-32757,
-32772,
-32768,
-32773,
-32757,
-32766,
-32769,
-32773,
-32767,
-32761,
-32767,
-32768,
-32771,
-32763,
-32766,
-32766,
-32769,
-32767,
-32764,
-32767,
-32769,
-32767,
-32765,
-32765,
-32769,
-32770,
-32765,
-32764,
-32767,
-32767,
-32772,
-32762,
-32768,
-32766,
-32769,
-32768,
-32765,
-32768,
-32769,
-32765,
-32769,
-32762,
-32773,
-32764,
-32769,
-32764,
-32769,
-32766,
-32768,
-32762,
-32770,
-32767,
-32768,
-32766,
-32767,
-32767,
-32772,
-32761,
-32769,
-32765,
-32772,
-32765,
-32765,
-32766,
-32769,
-32772,
-32761,
-32764,
-32769,
-32772,
-32771,
-32761,
-32763,
-32770,
-32772,
-32770,
-32759,
-32769,
-32769,
-32769,
-32761,
-32763,
-32768,
-32777,
-32763,
-32762,
-32764,
-32774,
-32770,
-32759,
-32760,
-32771,
-32780,
-32763,
-32752,
-32765,
-32781,
-32782,
-32751,
-32745,
-32776,
-32813,
-32769,
-32665,
-32545,
-32501,
-32495,
-32500,
-32496,
-32541,
-32652,
-32763,
-32813,
-32780,
-32747,
-32749,
-32778,
-32783,
-32766,
-32751,
-32765,
-32778,
-32775,
-32760,
-32757,
-32771,
-32775,
-32768,
-32759,
-32764,
-32772,
-32774,
-32763,
-32762,
-32768,
-32772,
-32768,
-32764,
-32763,
-32772,
-32771,
-32766,
-32764,
-32765,
-32771,
-32768,
-32765,
-32762,
-32771,
-32768,
-32769,
-32763,
-32766,
-32769,
-32769,
-32766,
-32764,
-32768,
-32769,
-32766,
-32764,
-32766,
-32768,
-32772,
-32765,
-32769,
-32764,
-32770,
-32765,
-32764,
-32766,
-32769,
-32771,
-32766,
-32767,
-32762,
-32773,
-32766,
-32767,
-32762,
-32768,
-32770,
-32771,
-32763,
-32763,
-32768,
-32772,
-32764,
-32765,
-32763,
-32781,
-32768,
-32760,
-32751,
-32784,
-32793,
-32753,
-32629,
-32513,
-32463,
-32505,
-32542,
-32529,
-32474,
-32477,
-32565,
-32698,
-32784,
-32790,
-32767,
-32752,
-32767,
-32775,
-32768,
-32762,
-32761,
-32773,
-32771,
-32767,
-32760,
-32767,
-32769,
-32769,
-32764,
-32764,
-32768,
-32768,
-32767,
-32766,
-32765,
-32770,
-32766,
-32768,
-32764,
-32769,
-32764,
-32770,
-32766,
-32769,
-32769,
-32763,
-32768,
-32766,
-32767,
-32770,
-32765,
-32765,
-32770,
-32765,
-32769,
-32768,
-32765,
-32769,
-32765,
-32768,
-32767,
-32768,
-32766,
-32764,
-32766,
-32769,
-32767,
-32769,
-32764,
-32769,
-32766,
-32770,
-32763,
-32769,
-32767,
-32769,
-32768,
-32762,
-32771,
-32763,
-32772,
-32760,
-32770,
-32766,
-32770,
-32766,
-32764,
-32768,
-32768,
-32771,
-32763,
-32768,
-32766,
-32770,
-32765,
-32767,
-32766,
-32772,
-32767,
-32765,
-32766,
-32767,
-32772,
-32762,
-32766,
-32763,
-32774,
-32767,
-32765,
-32761,
-32773,
-32769,
-32770,
-32759,
-32768,
-32773,
-32771,
-32754,
-32763,
-32782,
-32792,
-32727,
-32599,
-32481,
-32448,
-32530,
-32657,
-32760,
-32793,
-32776,
-32758,
-32755,
-32769,
-32777,
-32768,
-32759,
-32761,
-32771,
-32774,
-32767,
-32758,
-32764,
-32776,
-32772,
-32763,
-32756,
-32769,
-32780,
-32769,
-32753,
-32757,
-32778,
-32784,
-32760,
-32741,
-32759,
-32810,
-32791,
-32707,
-32581,
-32510,
-32496,
-32501,
-32493,
-32519,
-32607,
-32729,
-32803,
-32799,
-32755,
-32746,
-32764,
-32785,
-32772,
-32758,
-32758,
-32774,
-32773,
-32769,
-32756,
-32768,
-32772,
-32771,
-32760,
-32765,
-32766,
-32776,
-32764,
-32764,
-32764,
-32773,
-32770,
-32766,
-32763,
-32766,
-32769,
-32770,
-32763,
-32769,
-32763,
-32771,
-32765,
-32767,
-32766,
-32766,
-32771,
-32768,
-32766,
-32764,
-32766,
-32771,
-32771,
-32762,
-32761,
-32768,
-32777,
-32769,
-32756,
-32756,
-32789,
-32792,
-32736,
-32611,
-32498,
-32474,
-32504,
-32539,
-32519,
-32492,
-32498,
-32529,
-32533,
-32491,
-32475,
-32534,
-32666,
-32774,
-32801,
-32771,
-32748,
-32758,
-32778,
-32774,
-32761,
-32757,
-32771,
-32775,
-32769,
-32757,
-32765,
-32772,
-32775,
-32765,
-32759,
-32767,
-32772,
-32768,
-32762,
-32761,
-32772,
-32773,
-32765,
-32758,
-32766,
-32775,
-32776,
-32757,
-32759,
-32767,
-32784,
-32771,
-32752,
-32750,
-32782,
-32800,
-32763,
-32663,
-32545,
-32482,
-32486,
-32519,
-32536,
-32508,
-32480,
-32514,
-32637,
-32778,
-32854,
-32772,
-32625,
-32524,
-32563,
-32695,
-32798,
-32807,
-32767,
-32737,
-32763,
-32779,
-32781,
-32757,
-32757,
-32770,
-32779,
-32769,
-32755,
-32764,
-32770,
-32776,
-32764,
-32758,
-32770,
-32770,
-32772,
-32762,
-32761,
-32773,
-32768,
-32770,
-32759,
-32767,
-32772,
-32768,
-32766,
-32762,
-32768,
-32772,
-32767,
-32764,
-32764,
-32774,
-32767,
-32769,
-32759,
-32768,
-32770,
-32769,
-32763,
-32764,
-32770,
-32773,
-32765,
-32765,
-32762,
-32774,
-32768,
-32765,
-32761,
-32769,
-32770,
-32772,
-32760,
-32767,
-32767,
-32773,
-32765,
-32762,
-32768,
-32772,
-32771,
-32764,
-32759,
-32771,
-32771,
-32770,
-32758,
-32767,
-32770,
-32774,
-32764,
-32762,
-32767,
-32774,
-32769,
-32759,
-32763,
-32771,
-32774,
-32766,
-32758,
-32768,
-32773,
-32770,
-32761,
-32760,
-32772,
-32777,
-32763,
-32756,
-32766,
-32774,
-32776,
-32757,
-32757,
-32772,
-32781,
-32767,
-32752,
-32764,
-32779,
-32782,
-32751,
-32752,
-32768,
-32793,
-32768,
-32740,
-32755,
-32790,
-32797,
-32750,
-32719,
-32776,
-32835,
-32797,
-32650,
-32531,
-32570,
-32689,
-32744,
-32655,
-32526,
-32471,
-32484,
-32502,
-32520,
-32591,
-32710,
-32752,
-32649,
-32472,
-32413,
-32518,
-32695,
-32783,
-32780,
-32747,
-32761,
-32784,
-32772,
-32762,
-32749,
-32776,
-32779,
-32764,
-32758,
-32760,
-32780,
-32769,
-32766,
-32757,
-32773,
-32773,
-32764,
-32761,
-32762,
-32775,
-32771,
-32761,
-32765,
-32768,
-32773,
-32769,
-32761,
-32764,
-32770,
-32768,
-32764,
-32766,
-32766,
-32773,
-32764,
-32766,
-32766,
-32769,
-32769,
-32764,
-32766,
-32767,
-32767,
-32768,
-32764,
-32769,
-32767,
-32768,
-32764,
-32768,
-32766,
-32769,
-32767,
-32767,
-32767,
-32765,
-32763,
-32771,
-32768,
-32773,
-32761,
-32767,
-32768,
-32770,
-32767,
-32759,
-32768,
-32773,
-32771,
-32761,
-32761,
-32770,
-32779,
-32763,
-32756,
-32759,
-32788,
-32772,
-32752,
-32742,
-32787,
-32818,
-32751,
-32610,
-32517,
-32571,
-32730,
-32823,
-32806,
-32733,
-32732,
-32786,
-32805,
-32760,
-32721,
-32766,
-32830,
-32787,
-32633,
-32514,
-32556,
-32717,
-32778,
-32652,
-32449,
-32395,
-32542,
-32734,
-32767,
-32639,
-32513,
-32561,
-32710,
-32831,
-32805,
-32734,
-32724,
-32790,
-32828,
-32751,
-32616,
-32517,
-32499,
-32510,
-32497,
-32502,
-32556,
-32689,
-32796,
-32824,
-32747,
-32621,
-32504,
-32457,
-32500,
-32616,
-32739,
-32796,
-32787,
-32752,
-32753,
-32770,
-32783,
-32763,
-32758,
-32766,
-32778,
-32772,
-32754,
-32763,
-32776,
-32779,
-32752,
-32750,
-32778,
-32804,
-32760,
-32636,
-32523,
-32471,
-32502,
-32526,
-32525,
-32501,
-32501,
-32514,
-32524,
-32512,
-32503,
-32505,
-32518,
-32518,
-32509,
-32507,
-32510,
-32516,
-32510,
-32508,
-32507,
-32516,
-32515,
-32509,
-32508,
-32507,
-32516,
-32512,
-32511,
-32509,
-32510,
-32514,
-32512,
-32509,
-32508,
-32513,
-32509,
-32517,
-32507,
-32511,
-32512,
-32511,
-32513,
-32509,
-32512,
-32510,
-32512,
-32509,
-32509,
-32513,
-32509,
-32514,
-32506,
-32512,
-32512,
-32513,
-32508,
-32510,
-32509,
-32518,
-32511,
-32510,
-32507,
-32510,
-32518,
-32507,
-32512,
-32504,
-32517,
-32510,
-32513,
-32504,
-32515,
-32515,
-32513,
-32506,
-32507,
-32512,
-32518,
-32508,
-32506,
-32510,
-32516,
-32516,
-32505,
-32508,
-32513,
-32519,
-32509,
-32503,
-32509,
-32521,
-32514,
-32506,
-32499,
-32516,
-32525,
-32513,
-32497,
-32500,
-32526,
-32527,
-32506,
-32489,
-32505,
-32542,
-32529,
-32479,
-32464,
-32538,
-32673,
-32743,
-32695,
-32567,
-32475,
-32468,
-32513,
-32542,
-32522,
-32491,
-32489,
-32516,
-32537,
-32520,
-32490,
-32488,
-32523,
-32546,
-32518,
-32460,
-32472,
-32574,
-32711,
-32734,
-32645,
-32536,
-32563,
-32703,
-32840,
-32831,
-32702,
-32550,
-32464,
-32480,
-32550,
-32662,
-32751,
-32802,
-32785,
-32755,
-32747,
-32768,
-32782,
-32775,
-32753,
-32760,
-32772,
-32780,
-32765,
-32758,
-32764,
-32775,
-32773,
-32759,
-32762,
-32766,
-32780,
-32764,
-32765,
-32759,
-32776,
-32768,
-32766,
-32759,
-32768,
-32771,
-32773,
-32757,
-32768,
-32767,
-32773,
-32765,
-32763,
-32767,
-32774,
-32768,
-32767,
-32761,
-32771,
-32769,
-32765,
-32763,
-32765,
-32770,
-32771,
-32764,
-32767,
-32765,
-32774,
-32764,
-32767,
-32764,
-32768,
-32773,
-32763,
-32768,
-32764,
-32769,
-32766,
-32768,
-32762,
-32774,
-32765,
-32770,
-32763,
-32767,
-32766,
-32770,
-32765,
-32770,
-32766,
-32770,
-32763,
-32769,
-32765,
-32771,
-32764,
-32765,
-32765,
-32767,
-32770,
-32766,
-32766,
-32763,
-32772,
-32765,
-32773,
-32763,
-32768,
-32768,
-32766,
-32768,
-32763,
-32768,
-32765,
-32767,
-32768,
-32765,
-32768,
-32769,
-32764,
-32769,
-32765,
-32769,
-32767,
-32768,
-32767,
-32765,
-32769,
-32763,
-32770,
-32765,
-32769,
-32769,
-32767,
-32768,
-32767,
-32764,
-32769,
-32765,
-32768,
-32769,
-32765,
-32770,
-32766,
-32767,
-32767,
-32767,
-32766,
-32769,
-32765,
-32768,
-32767,
-32769,
-32766,
-32767,
-32765,
-32767,
-32769,
-32765,
-32769,
-32763,
-32771,
-32766,
-32769,
-32767,
-32766,
-32769,
-32765,
-32769,
-32764,
-32767,
-32766,
-32768,
-32767,
-32767,
-32766,
-32766,
-32767,
-32768,
-32768,
-32768,
-32769,
-32765,
-32769,
-32766,
-32767,
-32767,
-32767,
-32767,
-32765,
-32768,
-32766,
-32770,
-32766,
-32767,
-32767,
-32764,
-32769,
-32768,
-32768,
-32766,
-32768,
-32762,
-32772,
-32767,
-32767,
-32768,
-32763,
-32769,
-32767,
-32767,
-32766,
-32767,
-32768,
-32767,
-32768,
-32763,
-32771,
-32765,
-32769,
-32765,
-32767,
-32768,
-32768,
-32767,
-32768,
-32766,
-32770,
-32766,
-32767,
-32766,
-32766,
-32768,
-32768,
-32768,
-32767,
-32764,
-32769,
-32764,
-32771,
-32765,
-32768,
-32768,
-32766,
-32767,
-32768,
-32764,
-32771,
-32764,
-32768,
-32764,
-32765,
-32768,
-32766,
-32770,
-32766,
-32768,
-32768,
-32765,
-32771,
-32764,
-32770,
-32762,
-32770,
-32765,
-32768,
-32768,
-32765,
-32769,
-32766,
-32767,
-32767,
-32767,
-32768,
-32769,
-32770,
-32765,
-32768,
-32764,
-32768,
-32767,
-32769,
-32765,
-32768,
-32763,
-32768,
-32766,
-32769,
-32767,
-32769,
-32763,
-32770,
-32762,
-32771,
-32766,
-32768,
-32765,
-32768,
-32766,
-32770,
-32768,
-32766,
-32769,
-32763,
-32768,
-32767,
-32767,
-32768,
-32765,
-32767,
-32766,
-32768,
-32769,
-32766,
-32768,
-32765,
-32766,
-32768,
-32768,
-32767,
-32766,
-32766,
-32766,
-32769,
-32767,
-32764,
-32769,
-32764,
-32771,
-32765,
-32766,
-32768,
-32766,
-32769,
-32767,
-32767,
-32767,
-32767,
-32766,
-32768,
-32767,
-32767,
-32766,
-32768,
-32766,
-32767,
-32767,
-32763,
-32771,
-32765,
-32771,
-32768,
-32766,
-32766,
-32766,
-32768,
-32768,
-32768,
-32766,
-32767,
-32766,
-32767,
-32766,
-32768,
-32769,
-32765,
-32771,
-32762,
-32770,
-32766,
-32768,
-32766,
-32765,
-32767,
-32768,
-32769,
-32768,
-32766,
-32768,
-32765,
-32766,
-32766,
-32766,
-32771,
-32765,
-32770,
-32763,
-32767,
-32769,
-32765,
-32769,
-32765,
-32764,
-32771,
-32766,
-32769,
-32766,
-32765,
-32770,
-32765,
-32770,
-32763,
-32767,
-32767,
-32767,
-32769,
-32766,
-32768,
-32768,
-32766,
-32769,
-32765,
-32767,
-32767,
-32766,
-32767,
-32768,
-32768,
-32770,
-32766,
-32767,
-32765,
-32769,
-32769,
-32767,
-32766,
-32764,
-32770,
-32765,
-32770,
-32766,
-32764,
-32770,
-32763,
-32770,
-32763,
-32769,
-32765,
-32768,
-32767,
-32766,
-32769,
-32767,
-32769,
-32765,
-32768,
-32766,
-32769,
-32768,
-32766,
-32769,
-32764,
-32772,
-32765,
-32769,
-32766,
-32766,
-32766,
-32768,
-32767,
-32768,
-32766,
-32766,
-32766,
-32768,
-32771,
-32766,
-32767,
-32767,
-32766,
-32769,
-32767,
-32764,
-32765,
-32768,
-32765,
-32772,
-32764,
-32769,
-32765,
-32766,
-32767,
-32769,
-32766,
-32770,
-32765,
-32769,
-32764,
-32771,
-32763,
-32770,
-32764,
-32767,
-32768,
-32767,
-32768,
-32764,
-32768,
-32767,
-32770,
-32766,
-32766,
-32767,
-32765,
-32768,
-32765,
-32765,
-32770,
-32764,
-32770,
-32766,
-32764,
-32773,
-32762,
-32772,
-32766,
-32766,
-32768,
-32767,
-32766,
-32771,
-32764,
-32771,
-32764,
-32767,
-32769,
-32764,
-32771,
-32763,
-32766,
-32769,
-32763,
-32772,
-32765,
-32769,
-32767,
-32767,
-32766,
-32768,
-32765,
-32767,
-32766,
-32767,
-32768,
-32766,
-32768,
-32766,
-32767,
-32769,
-32764,
-32768,
-32766,
-32767,
-32769,
-32766,
-32768,
-32767,
-32769,
-32766,
-32769,
-32765,
-32767,
-32769,
-32766,
-32770,
-32763,
-32769,
-32766,
-32769,
-32765,
-32766,
-32765,
-32769,
-32767,
-32768,
-32766,
-32767,
-32768,
-32765,
-32767,
-32765,
-32766,
-32767,
-32766,
-32769,
-32769,
-32767,
-32767,
-32764,
-32767,
-32769,
-32766,
-32770,
-32763,
-32769,
-32767,
-32767,
-32766,
-32765,
-32765,
-32770,
-32767,
-32770,
-32766,
-32765,
-32768,
-32765,
-32769,
-32763,
-32771,
-32761,
-32774,
-32762,
-32771,
-32766,
-32766,
-32769,
-32765,
-32770,
-32767,
-32769,
-32767,
-32768,
-32766,
-32767,
-32767,
-32768,
-32768,
-32768,
-32766,
-32768,
-32766,
-32767,
-32767,
-32768,
-32766,
-32768,
-32765,
-32766,
-32767,
-32767,
-32767,
-32767,
-32769,
-32767,
-32770,
-32766,
-32765,
-32769,
-32766,
-32771,
-32764,
-32766,
-32767,
-32767,
-32772,
-32763,
-32771,
-32761,
-32774,
-32763,
-32770,
-32763,
-32767,
-32769,
-32766,
-32767,
-32766,
-32765,
-32769,
-32765,
-32768,
-32767,
-32769,
-32768,
-32768,
-32766,
-32766,
-32767,
-32766,
-32769,
-32767,
-32768,
-32766,
-32765,
-32768,
-32767,
-32770,
-32767,
-32767,
-32768,
-32764,
-32769,
-32765,
-32765,
-32771,
-32762,
-32772,
-32764,
-32766,
-32770,
-32764,
-32771,
-32765,
-32768,
-32766,
-32767,
-32766,
-32766,
-32768,
-32765,
-32770,
-32767,
-32769,
-32767,
-32768,
-32763,
-32771,
-32764,
-32772,
-32763,
-32771,
-32762,
-32772,
-32764,
-32768,
-32766,
-32766,
-32767,
-32767,
-32766,
-32768,
-32767,
-32766,
-32769,
-32765,
-32768,
-32768,
-32764,
-32769,
-32762,
-32769,
-32766,
-32769,
-32765,
-32766,
-32768,
-32765,
-32770,
-32765,
-32767,
-32767,
-32769,
-32766,
-32770,
-32764,
-32766,
-32767,
-32767,
-32771,
-32767,
-32767,
-32766,
-32767,
-32767,
-32770,
-32762,
-32770,
-32763,
-32771,
-32767,
-32767,
-32764,
-32768,
-32765,
-32769,
-32766,
-32767,
-32765,
-32770,
-32762,
-32772,
-32763,
-32772,
-32765,
-32766,
-32766,
-32765,
-32767,
-32768,
-32763,
-32771,
-32764,
-32771,
-32763,
-32769,
-32764,
-32768,
-32769,
-32764,
-32769,
-32764,
-32766,
-32769,
-32766,
-32768,
-32769,
-32766,
-32767,
-32767,
-32764,
-32769,
-32765,
-32769,
-32769,
-32765,
-32768,
-32764,
-32768,
-32767,
-32770,
-32765,
-32769,
-32766,
-32768,
-32767,
-32765,
-32767,
-32767,
-32768,
-32767,
-32766,
-32767,
-32767,
-32768,
-32765,
-32767,
-32764,
-32770,
-32766,
-32769,
-32766,
-32767,
-32766,
-32769,
-32765,
-32768,
-32766,
-32769,
-32765,
-32768,
-32766,
-32768,
-32768,
-32769,
-32765,
-32768,
-32765,
-32767,
-32767,
-32769,
-32766,
-32770,
-32762,
-32770,
-32763,
-32768,
-32770,
-32765,
-32769,
-32765,
-32767,
-32768,
-32767,
-32766,
-32767,
-32763,
-32768,
-32767,
-32768,
-32767,
-32767,
-32765,
-32771,
-32765,
-32771,
-32766,
-32768,
-32765,
-32766,
-32766,
-32765,
-32771,
-32766,
-32768,
-32767,
-32766,
-32767,
-32768,
-32764,
-32767,
-32767,
-32768,
-32767,
-32765,
-32768,
-32767,
-32770,
-32765,
-32768,
-32764,
-32770,
-32766,
-32769,
-32764,
-32768,
-32765,
-32769,
-32766,
-32768,
-32766,
-32770,
-32766,
-32768,
-32766,
-32767,
-32767,
-32765,
-32768,
-32765,
-32768,
-32769,
-32766,
-32768,
-32764,
-32770,
-32765,
-32771,
-32765,
-32766,
-32767,
-32766,
-32767,
-32768,
-32766,
-32767,
-32767,
-32767,
-32769,
-32767,
-32768,
-32763,
-32771,
-32763,
-32773,
-32763,
-32771,
-32762,
-32772,
-32760,
-32773,
-32762,
-32769,
-32765,
-32767,
-32767,
-32766,
-32768,
-32765,
-32769,
-32768,
-32767,
-32767,
-32763,
-32768,
-32764,
-32771,
-32766,
-32769,
-32766,
-32767,
-32767,
-32764,
-32771,
-32763,
-32773,
-32764,
-32767,
-32766,
-32766,
-32767,
-32769,
-32763,
-32769,
-32764,
-32769,
-32767,
-32767,
-32766,
-32768,
-32766,
-32768,
-32766,
-32767,
-32768,
-32767,
-32769,
-32768,
-32767,
-32767,
-32765,
-32769,
-32766,
-32770,
-32763,
-32769,
-32763,
-32771,
-32765,
-32769,
-32764,
-32769,
-32767,
-32770,
-32764,
-32768,
-32764,
-32770,
-32765,
-32766,
-32767,
-32765,
-32769,
-32769,
-32767,
-32770,
-32763,
-32770,
-32761,
-32774,
-32763,
-32772,
-32764,
-32768,
-32767,
-32767,
-32766,
-32767,
-32764,
-32773,
-32763,
-32770,
-32762,
-32769,
-32767,
-32770,
-32765,
-32767,
-32764,
-32767,
-32769,
-32767,
-32767,
-32767,
-32768,
-32768,
-32769,
-32767,
-32766,
-32767,
-32765,
-32765,
-32769,
-32765,
-32769,
-32767,
-32768,
-32769,
-32767,
-32767,
-32768,
-32765,
-32767,
-32766,
-32766,
-32770,
-32767,
-32767,
-32765,
-32765,
-32766,
-32769,
-32767,
-32768,
-32769,
-32763,
-32772,
-32762,
-32770,
-32764,
-32768,
-32765,
-32768,
-32767,
-32766,
-32769,
-32765,
-32768,
-32767,
-32766,
-32769,
-32764,
-32769,
-32763,
-32771,
-32766,
-32769,
-32766,
-32767,
-32767,
-32767,
-32767,
-32768,
-32765,
-32769,
-32763,
-32770,
-32765,
-32770,
-32765,
-32769,
-32765,
-32769,
-32766,
-32768,
-32765,
-32767,
-32765,
-32769,
-32766,
-32767,
-32767,
-32766,
-32765,
-32770,
-32765,
-32770,
-32766,
-32767,
-32764,
-32769,
-32764,
-32771,
-32763,
-32771,
-32763,
-32769,
-32769,
-32764,
-32773,
-32763,
-32768,
-32768,
-32764,
-32770,
-32763,
-32769,
-32765,
-32769,
-32765,
-32769,
-32765,
-32770,
-32767,
-32766,
-32770,
-32764,
-32770,
-32764,
-32768,
-32765,
-32768,
-32766,
-32767,
-32767,
-32769,
-32765,
-32771,
-32763,
-32768,
-32767,
-32767,
-32770,
-32765,
-32766,
-32763,
-32769,
-32767,
-32768,
-32768,
-32765,
-32768,
-32768,
-32765,
-32769,
-32765,
-32768,
-32768,
-32767,
-32770,
-32763,
-32771,
-32761,
-32771,
-32764,
-32768,
-32766,
-32766,
-32768,
-32766,
-32770,
-32765,
-32769,
-32766,
-32766,
-32767,
-32766,
-32766,
-32768,
-32768,
-32768,
-32767,
-32765,
-32767,
-32768,
-32768,
-32767,
-32764,
-32766,
-32767,
-32769,
-32766,
-32767,
-32767,
-32767,
-32769,
-32769,
-32763,
-32770,
-32763,
-32769,
-32768,
-32764,
-32770,
-32764,
-32770,
-32765,
-32767,
-32766,
-32766,
-32768,
-32765,
-32771,
-32766,
-32770,
-32766,
-32767,
-32767,
-32765,
-32770,
-32766,
-32770,
-32764,
-32767,
-32765,
-32769,
-32767,
-32770,
-32767,
-32768,
-32768,
-32767,
-32765,
-32767,
-32767,
-32766,
-32770,
-32764,
-32766,
-32769,
-32765,
-32772,
-32765,
-32767,
-32767,
-32767,
-32769,
-32765,
-32767,
-32767,
-32768,
-32768,
-32767,
-32765,
-32767,
-32765,
-32770,
-32763,
-32771,
-32764,
-32771,
-32769,
-32766,
-32769,
-32763,
-32770,
-32767,
-32766,
-32767,
-32765,
-32768,
-32769,
-32764,
-32771,
-32761,
-32771,
-32764,
-32769,
-32766,
-32768,
-32765,
-32769,
-32765,
-32770,
-32767,
-32771,
-32763,
-32769,
-32763,
-32770,
-32767,
-32766,
-32767,
-32766,
-32770,
-32767,
-32767,
-32764,
-32766,
-32768,
-32768,
-32768,
-32766,
-32767,
-32765,
-32767,
-32764,
-32770,
-32765,
-32770,
-32765,
-32765,
-32770,
-32765,
-32773,
-32761,
-32769,
-32764,
-32770,
-32769,
-32766,
-32766,
-32765,
-32768,
-32768,
-32765,
-32768,
-32768,
-32767,
-32771,
-32763,
-32767,
-32766,
-32769,
-32767,
-32770,
-32765,
-32767,
-32765,
-32765,
-32767,
-32766,
-32768,
-32766,
-32769,
-32767,
-32766,
-32769,
-32763,
-32771,
-32765,
-32767,
-32768,
-32767,
-32768,
-32769,
-32765,
-32767,
-32767,
-32765,
-32771,
-32764,
-32768,
-32766,
-32767,
-32769,
-32766,
-32769,
-32766,
-32768,
-32768,
-32765,
-32769,
-32764,
-32768,
-32765,
-32767,
-32770,
-32766,
-32769,
-32764,
-32766,
-32768,
-32766,
-32769,
-32765,
-32768,
-32767,
-32768,
-32767,
-32768,
-32764,
-32768,
-32767,
-32766,
-32770,
-32766,
-32768,
-32767,
-32766,
-32765,
-32769,
-32767,
-32769,
-32767,
-32769,
-32763,
-32769,
-32762,
-32770,
-32763,
-32772,
-32763,
-32772,
-32765,
-32768,
-32766,
-32765,
-32768,
-32766,
-32769,
-32766,
-32769,
-32765,
-32767,
-32768,
-32767,
-32768,
-32767,
-32767,
-32766,
-32768,
-32767,
-32767,
-32768,
-32765,
-32767,
-32766,
-32767,
-32768,
-32764,
-32770,
-32766,
-32768,
-32769,
-32767,
-32767,
-32770,
-32763,
-32770,
-32765,
-32769,
-32763,
-32768,
-32763,
-32772,
-32765,
-32771,
-32764,
-32768,
-32767,
-32767,
-32769,
-32769,
-32766,
-32768,
-32765,
-32764,
-32769,
-32765,
-32769,
-32770,
-32764,
-32772,
-32763,
-32769,
-32765,
-32769,
-32766,
-32768,
-32766,
-32767,
-32769,
-32768,
-32767,
-32766,
-32768,
-32766,
-32769,
-32768,
-32765,
-32771,
-32764,
-32772,
-32761,
-32770,
-32763,
-32771,
-32766,
-32770,
-32762,
-32770,
-32764,
-32768,
-32766,
-32767,
-32769,
-32768,
-32766,
-32769,
-32763,
-32771,
-32766,
-32767,
-32764,
-32767,
-32766,
-32772,
-32766,
-32768,
-32763,
-32768,
-32765,
-32770,
-32765,
-32769,
-32767,
-32767,
-32767,
-32766,
-32768,
-32766,
-32768,
-32767,
-32766,
-32768,
-32768,
-32766,
-32770,
-32766,
-32767,
-32766,
-32765,
-32767,
-32769,
-32767,
-32766,
-32766,
-32765,
-32770,
-32766,
-32768,
-32762,
-32769,
-32766,
-32769,
-32768,
-32764,
-32769,
-32766,
-32770,
-32769,
-32766,
-32769,
-32764,
-32768,
-32765,
-32769,
-32768,
-32769,
-32766,
-32768,
-32764,
-32770,
-32763,
-32770,
-32763,
-32769,
-32768,
-32767,
-32767,
-32764,
-32769,
-32768,
-32770,
-32766,
-32766,
-32764,
-32767,
-32770,
-32765,
-32770,
-32765,
-32767,
-32767,
-32769,
-32764,
-32768,
-32765,
-32767,
-32767,
-32769,
-32765,
-32771,
-32766,
-32769,
-32766,
-32765,
-32767,
-32765,
-32767,
-32768,
-32767,
-32768,
-32769,
-32765,
-32768,
-32764,
-32769,
-32766,
-32769,
-32765,
-32768,
-32766,
-32767,
-32770,
-32764,
-32771,
-32760,
-32772,
-32763,
-32772,
-32766,
-32766,
-32767,
-32764,
-32771,
-32764,
-32772,
-32760,
-32771,
-32763,
-32771,
-32765,
-32770,
-32767,
-32768,
-32767,
-32765,
-32766,
-32769,
-32766,
-32770,
-32765,
-32768,
-32765,
-32767,
-32768,
-32766,
-32768,
-32767,
-32768,
-32768,
-32767,
-32766,
-32767,
-32764,
-32768,
-32764,
-32772,
-32764,
-32769,
-32764,
-32767,
-32769,
-32764,
-32771,
-32763,
-32769,
-32767,
-32768,
-32768,
-32768,
-32765,
-32767,
-32766,
-32767,
-32768,
-32768,
-32765,
-32766,
-32765,
-32768,
-32767,
-32768,
-32768,
-32769,
-32766,
-32769,
-32764,
-32766,
-32769,
-32765,
-32771,
-32763,
-32769,
-32765,
-32770,
-32767,
-32767,
-32766,
-32767,
-32768,
-32766,
-32769,
-32764,
-32769,
-32766,
-32767,
-32766,
-32767,
-32766,
-32769,
-32767,
-32768,
-32766,
-32767,
-32768,
-32764,
-32772,
-32764,
-32770,
-32766,
-32768,
-32766,
-32769,
-32763,
-32769,
-32765,
-32768,
-32770,
-32763,
-32769,
-32763,
-32770,
-32769,
-32769,
-32765,
-32768,
-32765,
-32769,
-32765,
-32767,
-32764,
-32772,
-32764,
-32769,
-32766,
-32766,
-32771,
-32767,
-32768,
-32766,
-32767,
-32767,
-32766,
-32766,
-32765,
-32767,
-32768,
-32768,
-32768,
-32764,
-32772,
-32764,
-32772,
-32763,
-32769,
-32764,
-32769,
-32763,
-32767,
-32767,
-32769,
-32768,
-32767,
-32764,
-32769,
-32768,
-32768,
-32767,
-32764,
-32767,
-32767,
-32767,
-32768,
-32765,
-32769,
-32768,
-32767,
-32768,
-32765,
-32767,
-32771,
-32763,
-32772,
-32761,
-32772,
-32764,
-32770,
-32763,
-32766,
-32766,
-32768,
-32769,
-32767,
-32765,
-32767,
-32766,
-32769,
-32767,
-32766,
-32767,
-32767,
-32767,
-32770,
-32765,
-32768,
-32766,
-32764,
-32770,
-32764,
-32771,
-32765,
-32768,
-32766,
-32766,
-32767,
-32768,
-32765,
-32769,
-32765,
-32769,
-32766,
-32767,
-32767,
-32766,
-32770,
-32766,
-32768,
-32768,
-32765,
-32769,
-32766,
-32765,
-32769,
-32763,
-32770,
-32765,
-32771,
-32766,
-32768,
-32765,
-32765,
-32767,
-32766,
-32769,
-32766,
-32767,
-32765,
-32768,
-32767,
-32767,
-32767,
-32769,
-32767,
-32768,
-32766,
-32766,
-32769,
-32768,
-32766,
-32769,
-32765,
-32769,
-32766,
-32767,
-32765,
-32768,
-32766,
-32769,
-32766,
-32766,
-32766,
-32767,
-32770,
-32767,
-32770,
-32763,
-32769,
-32764,
-32770,
-32765,
-32769,
-32764,
-32767,
-32768,
-32767,
-32768,
-32767,
-32768,
-32766,
-32771,
-32761,
-32772,
-32763,
-32771,
-32766,
-32767,
-32767,
-32766,
-32770,
-32766,
-32769,
-32764,
-32767,
-32766,
-32769,
-32767,
-32769,
-32765,
-32769,
-32766,
-32767,
-32767,
-32767,
-32767,
-32768,
-32765,
-32768,
-32764,
-32768,
-32767,
-32768,
-32768,
-32768,
-32766,
-32767,
-32768,
-32765,
-32769,
-32766,
-32769,
-32766,
-32769,
-32763,
-32768,
-32767,
-32768,
-32768,
-32767,
-32764,
-32770,
-32767,
-32769,
-32766,
-32768,
-32764,
-32772,
-32764,
-32769,
-32767,
-32765,
-32771,
-32764,
-32771,
-32766,
-32767,
-32766,
-32765,
-32768,
-32766,
-32769,
-32764,
-32770,
-32764,
-32770,
-32767,
-32766,
-32771,
-32763,
-32771,
-32766,
-32768,
-32767,
-32768,
-32765,
-32768,
-32767,
-32767,
-32768,
-32764,
-32769,
-32763,
-32772,
-32764,
-32768,
-32766,
-32767,
-32767,
-32770,
-32764,
-32767,
-32765,
-32769,
-32768,
-32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32766,
-32766,
-32766,
-32768,
-32767,
-32767,
-32766,
-32768,
-32766,
-32769,
-32764,
-32767,
-32767,
-32767,
-32769,
-32765,
-32767,
-32766,
-32767,
-32767,
-32768,
-32767,
-32766,
-32768,
-32764,
-32769,
-32766,
-32769,
-32767,
-32767,
-32767,
-32766,
-32769,
-32765,
-32769,
-32765,
-32769,
-32765,
-32769,
-32764,
-32771,
-32764,
-32769,
-32765,
-32768,
-32767,
-32770,
-32764,
-32767,
-32765,
-32766,
-32771,
-32766,
-32770,
-32765,
-32769,
-32765,
-32769,
-32766,
-32766,
-32770,
-32763,
-32772,
-32762,
-32771,
-32765,
-32770,
-32766,
-32768,
-32766,
-32768,
-32766,
-32766,
-32766,
-32766,
-32770,
-32766,
-32769,
-32764,
-32769,
-32764,
-32769,
-32765,
-32766,
-32768,
-32765,
-32768,
-32766,
-32768,
-32770,
-32767,
-32768,
-32763,
-32766,
-32768,
-32768,
-32768,
-32767,
-32765,
-32768,
-32765,
-32769,
-32763,
-32770,
-32763,
-32769,
-32766,
-32767,
-32769,
-32768,
-32769,
-32768,
-32765,
-32766,
-32765,
-32766,
-32767,
-32768,
-32766,
-32768,
-32767,
-32764,
-32770,
-32762,
-32772,
-32765,
-32770,
-32765,
-32766,
-32766,
-32770,
-32767,
-32770,
-32764,
-32770,
-32765,
-32768,
-32765,
-32767,
-32765,
-32769,
-32766,
-32770,
-32766,
-32768,
-32765,
-32767,
-32766,
-32767,
-32767,
-32765,
-32768,
-32766,
-32768,
-32769,
-32766,
-32766,
-32770,
-32762,
-32771,
-32763,
-32769,
-32768,
-32768,
-32768,
-32768,
-32766,
-32766,
-32767,
-32766,
-32768,
-32769,
-32765,
-32771,
-32762,
-32771,
-32764,
-32770,
-32764,
-32769,
-32766,
-32766,
-32766,
-32765,
-32768,
-32767,
-32769,
-32764,
-32770,
-32762,
-32771,
-32766,
-32767,
-32771,
-32762,
-32773,
-32759,
-32773,
-32762,
-32772,
-32767,
-32765,
-32768,
-32764,
-32770,
-32766,
-32768,
-32766,
-32765,
-32770,
-32763,
-32771,
-32764,
-32769,
-32767,
-32765,
-32769,
-32766,
-32771,
-32763,
-32768,
-32764,
-32767,
-32771,
-32765,
-32768,
-32765,
-32766,
-32768,
-32769,
-32765,
-32769,
-32762,
-32770,
-32766,
-32769,
-32767,
-32768,
-32767,
-32766,
-32771,
-32763,
-32770,
-32764,
-32765,
-32768,
-32768,
-32767,
-32769,
-32766,
-32766,
-32769,
-32765,
-32769,
-32767,
-32768,
-32767,
-32766,
-32767,
-32765,
-32770,
-32763,
-32771,
-32766,
-32768,
-32767,
-32766,
-32766,
-32769,
-32767,
-32769,
-32765,
-32768,
-32765,
-32770,
-32766,
-32766,
-32769,
-32763,
-32770,
-32764,
-32769,
-32768,
-32766,
-32769,
-32763,
-32768,
-32766,
-32767,
-32769,
-32767,
-32768,
-32767,
-32767,
-32765,
-32767,
-32766,
-32768,
-32768,
-32768,
-32766,
-32766,
-32767,
-32766,
-32768,
-32766,
-32768,
-32766,
-32768,
-32764,
-32768,
-32766,
-32769,
-32769,
-32766,
-32769,
-32767,
-32764,
-32770,
-32762,
-32771,
-32764,
-32769,
-32766,
-32767,
-32767,
-32768,
-32765,
-32770,
-32763,
-32771,
-32764,
-32769,
-32766,
-32766,
-32771,
-32765,
-32769,
-32764,
-32767,
-32768,
-32766,
-32768,
-32765,
-32769,
-32767,
-32766,
-32768,
-32765,
-32769,
-32767,
-32768,
-32768,
-32766,
-32768,
-32764,
-32768,
-32764,
-32771,
-32766,
-32768,
-32767,
-32764,
-32770,
-32766,
-32768,
-32766,
-32767,
-32767,
-32768,
-32767,
-32764,
-32769,
-32765,
-32770,
-32767,
-32768,
-32769,
-32764,
-32770,
-32764,
-32769,
-32768,
-32764,
-32770,
-32764,
-32770,
-32766,
-32766,
-32767,
-32767,
-32771,
-32763,
-32770,
-32762,
-32769,
-32770,
-32767,
-32767,
-32767,
-32764,
-32769,
-32766,
-32767,
-32764,
-32768,
-32764,
-32770,
-32767,
-32769,
-32768,
-32765,
-32768,
-32765,
-32767,
-32769,
-32765,
-32768,
-32767,
-32766,
-32770,
-32766,
-32769,
-32766,
-32766,
-32769,
-32763,
-32769,
-32767,
-32766,
-32769,
-32765,
-32768,
-32766,
-32769,
-32767,
-32768,
-32765,
-32767,
-32765,
-32768,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32767,
-32765,
-32769,
-32764,
-32771,
-32765,
-32766,
-32768,
-32765,
-32768,
-32768,
-32765,
-32768,
-32767,
-32767,
-32767,
-32768,
-32766,
-32770,
-32766,
-32767,
-32766,
-32765,
-32768,
-32766,
-32769,
-32765,
-32769,
-32765,
-32768,
-32764,
-32765,
-32767,
-32768,
-32769,
-32766,
-32768,
-32766,
-32768,
-32767,
-32765,
-32767,
-32767,
-32767,
-32769,
-32766,
-32768,
-32765,
-32766,
-32767,
-32764,
-32770,
-32766,
-32769,
-32766,
-32767,
-32767,
-32768,
-32768,
-32767,
-32766,
-32767,
-32766,
-32768,
-32766,
-32771,
-32765,
-32771,
-32765,
-32768,
-32764,
-32770,
-32762,
-32772,
-32762,
-32768,
-32766,
-32769,
-32768,
-32766,
-32767,
-32765,
-32770,
-32765,
-32771,
-32764,
-32768,
-32765,
-32767,
-32768,
-32770,
-32764,
-32770,
-32762,
-32769,
-32768,
-32767,
-32767,
-32765,
-32768,
-32765,
-32772,
-32764,
-32774,
-32762,
-32770,
-32762,
-32770,
-32768,
-32768,
-32768,
-32765,
-32766,
-32768,
-32767,
-32766,
-32770,
-32762,
-32772,
-32764,
-32767,
-32769,
-32765,
-32770,
-32766,
-32769,
-32765,
-32771,
-32764,
-32770,
-32765,
-32767,
-32767,
-32768,
-32766,
-32768,
-32765,
-32769,
-32768,
-32764,
-32769,
-32762,
-32773,
-32765,
-32770
-};
@@ -17,7 +17,7 @@ typedef uint32_t sound_status_t;
 #define SOUND_STATUS_OK 0
 #define SOUND_STATUS_FAIL 1
 
-// Sound levels.
+// Sound levels. sound_playSoundAtVolume() also uses them as Q15 gains.
 #define SOUND_VOLUME_0 (INT16_MAX / 64) // Min volume.
 #define SOUND_VOLUME_1 (INT16_MAX / 32)
 #define SOUND_VOLUME_2 (INT16_MAX / 8)
@@ -45,15 +45,28 @@ typedef enum {
   sound_maximumVolume_e = SOUND_VOLUME_3     // Really loud.
 } sound_volume_t;
 
-// Must be called before using the sound state machine.
+// Must be called before using the sound state machine. Starts the audio CODEC
+// bring-up and returns without waiting for it; see sound_pollInit().
 sound_status_t sound_init();
 
+// Advances the audio CODEC bring-up started by sound_init(). Call it from the
+// main loop until it returns true; each call takes at most one IIC register
+// write. Sounds started before then play once the CODEC is ready.
+bool sound_pollInit();
+
+// Returns true if the audio CODEC bring-up failed. No sounds play after that.
+bool sound_hasFailed();
+
 // Standard tick function.
 void sound_tick();
 
 // Sets the sound and starts playing it immediately.
 void sound_playSound(sound_sounds_t sound);
 
+// Sets the sound and starts playing it immediately at volume, relative to
+// the overall volume set by sound_setVolume().
+void sound_playSoundAtVolume(sound_sounds_t sound, sound_volume_t volume);
+
 // Returns true if the sound is still playing.
 bool sound_isBusy();
 
@@ -61,16 +74,23 @@ bool sound_isBusy();
 bool sound_isSoundComplete();
 
 // Use this to set the base address for the array containing sound data.
-// Allow sounds to be interrupted.
+// Sounds that are already playing keep playing; the mixer sums them.
 void sound_setSound(sound_sounds_t sound);
 
 // Used to set the volume. Use one of the provided values.
 void sound_setVolume(sound_volume_t);
 
-// Tell the state machine to start playing the sound.
+// Returns the most CPU cycles spent in one call to sound_tick() while playing.
+uint32_t sound_getMaxTickCycles();
+
+// Clears the value returned by sound_getMaxTickCycles().
+void sound_resetMaxTickCycles();
+
+// Tell the state machine to start playing the sound, on top of any sounds
+// that are already playing.
 void sound_startSound();
 
-// Stops playing the sound and resets the state-machine to the wait state.
+// Stops playing all sounds and resets the state-machine to the wait state.
 void sound_stopSound();
 
 // Plays several sounds.
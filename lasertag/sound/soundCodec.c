@@ -0,0 +1,120 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "soundCodec.h"
+#include "soundSink.h"
+
+typedef struct {
+  uint8_t reg;
+  uint16_t value;
+  uint32_t delayAfterUs; // Wait this long before the next step.
+} soundCodec_write_t;
+
+// The register settings from the original Digilent demo. Refer to the
+// SSM2603 Audio Codec data sheet for what these writes do.
+static const soundCodec_write_t initSequence[] = {
+    // Perform Reset
+    {SOUND_CODEC_RESET_REG, 0b000000000, SOUND_CODEC_SETTLE_US},
+    // Power up everything but the output.
+    {SOUND_CODEC_POWER_REG, 0b000110000, 0},
+    // Left and right-channel ADC input volume.
+    {SOUND_CODEC_LEFT_ADC_VOLUME_REG, 0b000010111, 0},
+    {SOUND_CODEC_RIGHT_ADC_VOLUME_REG, 0b000010111, 0},
+    // Left-channel DAC volume. Also sets the right volume to the same value.
+    {SOUND_CODEC_LEFT_DAC_VOLUME_REG, 0b101111001, 0},
+    {SOUND_CODEC_ANALOG_PATH_REG, 0b000010000, 0},
+    {SOUND_CODEC_DIGITAL_PATH_REG, 0b000000000, 0},
+    // Word length is 24 bits.
+    {SOUND_CODEC_INTERFACE_REG, 0b000001010, 0},
+    // No CLKDIV2. Wait for things to settle down.
+    {SOUND_CODEC_SAMPLING_REG, 0b000000000, SOUND_CODEC_SETTLE_US},
+    // Make things active.
+    {SOUND_CODEC_ACTIVE_REG, 0b000000001, 0},
+    // Power-up the output (OSC is left disabled as MCLK pin provides clock).
+    {SOUND_CODEC_POWER_REG, 0b000100000, 0},
+};
+#define INIT_SEQUENCE_LENGTH (sizeof(initSequence) / sizeof(initSequence[0]))
+
+// Bring-up states.
+typedef enum {
+  soundCodec_idle_st,      // soundCodec_startInit() has not been called.
+  soundCodec_openBus_st,   // Setting up the IIC controller.
+  soundCodec_write_st,     // Writing the next register in initSequence.
+  soundCodec_settle_st,    // Waiting out the delay after a write.
+  soundCodec_startClk_st,  // Starting the I2S clocks.
+  soundCodec_ready_st,     // All done.
+  soundCodec_failed_st     // An IIC transfer failed.
+} soundCodec_st_t;
+
+volatile static soundCodec_st_t currentState = soundCodec_idle_st;
+static uint8_t writeIndex; // Next entry in initSequence.
+static uint32_t settleStartUs;
+
+// Starts the bring-up from the beginning.
+void soundCodec_startInit() {
+  writeIndex = 0;
+  currentState = soundCodec_openBus_st;
+}
+
+// Advances the bring-up by at most one register write. Returns true once
+// there is nothing left to do: the CODEC is ready, bring-up failed, or it was
+// never started.
+bool soundCodec_pollInit() {
+  switch (currentState) {
+  case soundCodec_openBus_st:
+    if (!soundSink_openCodecBus()) {
+      printf("ERROR, soundCodec_pollInit: cannot set up the IIC bus.\n");
+      currentState = soundCodec_failed_st;
+      break;
+    }
+    currentState = soundCodec_write_st;
+    break;
+  case soundCodec_write_st: {
+    const soundCodec_write_t *write = &initSequence[writeIndex];
+    if (!soundSink_writeCodecRegister(write->reg, write->value)) {
+      printf("ERROR, soundCodec_pollInit: IIC write to register %d failed.\n",
+             write->reg);
+      currentState = soundCodec_failed_st;
+      break;
+    }
+    // Steps without a delay go straight on to the next write.
+    settleStartUs = soundSink_getMicroseconds();
+    currentState = soundCodec_settle_st;
+  }
+    // Fall through.
+  case soundCodec_settle_st:
+    // Unsigned subtraction is correct across wrap-around.
+    if (soundSink_getMicroseconds() - settleStartUs <
+        initSequence[writeIndex].delayAfterUs)
+      break;
+    writeIndex++;
+    currentState = writeIndex < INIT_SEQUENCE_LENGTH ? soundCodec_write_st
+                                                     : soundCodec_startClk_st;
+    break;
+  case soundCodec_startClk_st:
+    soundSink_startClocks();
+    currentState = soundCodec_ready_st;
+    break;
+  default:
+    break;
+  }
+  return currentState == soundCodec_idle_st ||
+         currentState == soundCodec_ready_st ||
+         currentState == soundCodec_failed_st;
+}
+
+// Returns true once the CODEC is ready to play.
+bool soundCodec_isReady() { return currentState == soundCodec_ready_st; }
+
+// Returns true if an IIC transfer failed during bring-up.
+bool soundCodec_hasFailed() { return currentState == soundCodec_failed_st; }
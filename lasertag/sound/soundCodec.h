@@ -0,0 +1,58 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Brings up the SSM2603 audio CODEC without blocking. The register writes
+// and settling delays that used to run back to back inside sound_init() are
+// a table walked by a state machine: each call to soundCodec_pollInit() does
+// at most one IIC register write, and returns straight away while a delay is
+// still running, so the rest of start-up can run in the meantime. The IIC
+// bus, the I2S clocks and the time come from soundSink.h, so the sequence
+// can also be checked on the host.
+
+#ifndef SOUNDCODEC_H_
+#define SOUNDCODEC_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// SSM2603 registers. Each holds 9 bits.
+#define SOUND_CODEC_LEFT_ADC_VOLUME_REG 0
+#define SOUND_CODEC_RIGHT_ADC_VOLUME_REG 1
+#define SOUND_CODEC_LEFT_DAC_VOLUME_REG 2
+#define SOUND_CODEC_RIGHT_DAC_VOLUME_REG 3
+#define SOUND_CODEC_ANALOG_PATH_REG 4
+#define SOUND_CODEC_DIGITAL_PATH_REG 5
+#define SOUND_CODEC_POWER_REG 6
+#define SOUND_CODEC_INTERFACE_REG 7
+#define SOUND_CODEC_SAMPLING_REG 8
+#define SOUND_CODEC_ACTIVE_REG 9
+#define SOUND_CODEC_RESET_REG 15
+#define SOUND_CODEC_REGISTER_COUNT 16
+
+// Power register bit that, when set, powers the output stage down.
+#define SOUND_CODEC_POWER_OUT_OFF 0b000010000
+
+// Time to wait after the reset and again before making the CODEC active.
+#define SOUND_CODEC_SETTLE_US 75000
+
+// Starts the bring-up from the beginning.
+void soundCodec_startInit();
+
+// Advances the bring-up by at most one register write. Returns true once
+// there is nothing left to do: the CODEC is ready, bring-up failed, or it was
+// never started.
+bool soundCodec_pollInit();
+
+// Returns true once the CODEC is ready to play.
+bool soundCodec_isReady();
+
+// Returns true if an IIC transfer failed during bring-up.
+bool soundCodec_hasFailed();
+
+#endif /* SOUNDCODEC_H_ */
@@ -0,0 +1,199 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "adpcm.h"
+#include "soundMixer.h"
+#include "soundResampler.h"
+
+typedef struct {
+  // soundMixer_mix() runs in the timer ISR and skips voices that are not
+  // active, so the main loop clears this while it sets a voice up.
+  volatile bool active;
+  bool silent;         // No data, just counts out samples.
+  bool resampled;      // Stored below the output rate.
+  uint32_t remaining;  // Output samples left to render.
+  uint32_t startOrder; // Used to pick the voice to replace.
+  int32_t gain;        // Q15.
+  adpcm_decoder_t decoder;
+  soundResampler_t resampler;
+  // Decoded input waiting to be upsampled.
+  int16_t source[SOUND_MIXER_BLOCK_SAMPLES];
+  uint8_t sourceIndex;
+  uint8_t sourceCount;
+} soundMixer_voiceState_t;
+
+static soundMixer_voiceState_t voices[SOUND_MIXER_VOICE_COUNT];
+static uint32_t nextStartOrder;
+
+// Keeps the compiler from moving voice set-up past the writes to active.
+// One core, so the CPU itself needs no barrier.
+static inline void soundMixer_compilerBarrier() {
+  __asm__ volatile("" ::: "memory");
+}
+
+// Stops all voices.
+void soundMixer_init() {
+  soundMixer_stopAll();
+  nextStartOrder = 0;
+}
+
+// Returns a free voice, or the one that started first if none are free.
+static soundMixer_voice_t findVoice() {
+  soundMixer_voice_t oldest = 0;
+  for (soundMixer_voice_t v = 0; v < SOUND_MIXER_VOICE_COUNT; v++) {
+    if (!voices[v].active)
+      return v;
+    if (voices[v].startOrder < voices[oldest].startOrder)
+      oldest = v;
+  }
+  return oldest;
+}
+
+// Starts playing sampleCount samples of ADPCM data recorded at sampleRateHz
+// at gain on a free voice. NULL data plays silence, which keeps the mixer
+// busy for sampleCount samples. If every voice is busy the one that started
+// first is replaced. Returns the voice used, or SOUND_MIXER_NO_VOICE if
+// sampleRateHz cannot be upsampled to SOUND_MIXER_OUTPUT_RATE_HZ.
+soundMixer_voice_t soundMixer_play(const uint8_t *data, uint32_t sampleCount,
+                                   uint32_t sampleRateHz, uint16_t gain) {
+  soundResampler_t resampler;
+  if (!soundResampler_init(&resampler, sampleRateHz,
+                           SOUND_MIXER_OUTPUT_RATE_HZ))
+    return SOUND_MIXER_NO_VOICE;
+  soundMixer_voice_t v = findVoice();
+  soundMixer_voiceState_t *voice = &voices[v];
+  voice->active = false; // Keep the mixer off it while it is set up.
+  soundMixer_compilerBarrier();
+  voice->silent = (data == NULL);
+  voice->resampled = (resampler.factor > 1 && data != NULL);
+  voice->remaining = sampleCount * resampler.factor;
+  // Let the interpolator's delay line drain so the end is not cut off.
+  if (voice->resampled)
+    voice->remaining += resampler.factor * SOUND_RESAMPLER_TAPS / 2 - 1;
+  voice->startOrder = nextStartOrder++;
+  voice->gain = gain;
+  adpcm_initDecoder(&voice->decoder, data, data ? sampleCount : 0);
+  voice->resampler = resampler;
+  voice->sourceIndex = 0;
+  voice->sourceCount = 0;
+  soundMixer_compilerBarrier();
+  voice->active = (sampleCount > 0);
+  return v;
+}
+
+// Changes the gain of a playing voice.
+void soundMixer_setVoiceGain(soundMixer_voice_t voice, uint16_t gain) {
+  if (voice >= 0 && voice < SOUND_MIXER_VOICE_COUNT)
+    voices[voice].gain = gain;
+}
+
+// Stops one voice.
+void soundMixer_stopVoice(soundMixer_voice_t voice) {
+  if (voice >= 0 && voice < SOUND_MIXER_VOICE_COUNT)
+    voices[voice].active = false;
+}
+
+// Stops all voices.
+void soundMixer_stopAll() {
+  for (soundMixer_voice_t v = 0; v < SOUND_MIXER_VOICE_COUNT; v++)
+    voices[v].active = false;
+}
+
+// Returns true if voice is still playing.
+bool soundMixer_isVoiceActive(soundMixer_voice_t voice) {
+  return voice >= 0 && voice < SOUND_MIXER_VOICE_COUNT && voices[voice].active;
+}
+
+// Returns the number of voices still playing.
+uint8_t soundMixer_getActiveVoiceCount() {
+  uint8_t count = 0;
+  for (soundMixer_voice_t v = 0; v < SOUND_MIXER_VOICE_COUNT; v++)
+    count += voices[v].active;
+  return count;
+}
+
+// Adds gain-scaled samples into sum. Kept to a plain loop over restrict
+// pointers so the compiler can vectorize it.
+static void accumulate(int32_t *restrict sum, const int16_t *restrict samples,
+                       uint32_t count, int32_t gain) {
+  for (uint32_t i = 0; i < count; i++)
+    sum[i] += (samples[i] * gain) >> SOUND_MIXER_GAIN_SHIFT;
+}
+
+// Clamps each sum to +/-SOUND_MIXER_MAX_SAMPLE, written so the compiler can
+// vectorize it too.
+static void saturate(int16_t *restrict out, const int32_t *restrict sum,
+                     uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    int32_t value = sum[i];
+    if (value > SOUND_MIXER_MAX_SAMPLE)
+      value = SOUND_MIXER_MAX_SAMPLE;
+    if (value < -SOUND_MIXER_MAX_SAMPLE)
+      value = -SOUND_MIXER_MAX_SAMPLE;
+    out[i] = (int16_t)value;
+  }
+}
+
+// Renders count samples of a voice stored below the output rate into out,
+// decoding its input a block at a time as the interpolator asks for it.
+// Zeros are fed in once the input runs out, to drain the delay line.
+static void resample(soundMixer_voiceState_t *voice, int16_t out[],
+                     uint32_t count) {
+  for (uint32_t i = 0; i < count; i++) {
+    if (soundResampler_needsInput(&voice->resampler)) {
+      if (voice->sourceIndex == voice->sourceCount) {
+        voice->sourceCount = adpcm_decode(&voice->decoder, voice->source,
+                                          SOUND_MIXER_BLOCK_SAMPLES);
+        voice->sourceIndex = 0;
+      }
+      int16_t sample = voice->sourceIndex < voice->sourceCount
+                           ? voice->source[voice->sourceIndex++]
+                           : 0;
+      soundResampler_push(&voice->resampler, sample);
+    }
+    out[i] = soundResampler_next(&voice->resampler);
+  }
+}
+
+// Renders up to count (at most SOUND_MIXER_BLOCK_SAMPLES) mixed samples into
+// out. Returns the number rendered: count while any voice is playing, fewer as
+// the last voice ends, 0 once all voices are done.
+uint32_t soundMixer_mix(int16_t out[], uint32_t count) {
+  int32_t sum[SOUND_MIXER_BLOCK_SAMPLES];
+  int16_t decoded[SOUND_MIXER_BLOCK_SAMPLES];
+  if (count > SOUND_MIXER_BLOCK_SAMPLES)
+    count = SOUND_MIXER_BLOCK_SAMPLES;
+  for (uint32_t i = 0; i < count; i++)
+    sum[i] = 0;
+
+  uint32_t rendered = 0; // Longest run from any voice.
+  for (soundMixer_voice_t v = 0; v < SOUND_MIXER_VOICE_COUNT; v++) {
+    soundMixer_voiceState_t *voice = &voices[v];
+    if (!voice->active)
+      continue;
+    uint32_t n = voice->remaining < count ? voice->remaining : count;
+    if (voice->resampled) {
+      resample(voice, decoded, n);
+      accumulate(sum, decoded, n, voice->gain);
+    } else if (!voice->silent) {
+      n = adpcm_decode(&voice->decoder, decoded, n);
+      accumulate(sum, decoded, n, voice->gain);
+    }
+    voice->remaining -= n;
+    voice->active = (voice->remaining > 0 && n > 0);
+    if (n > rendered)
+      rendered = n;
+  }
+  saturate(out, sum, rendered);
+  return rendered;
+}
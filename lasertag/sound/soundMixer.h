@@ -0,0 +1,69 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Software mixer for the sound state machine. A fixed pool of voices each
+// stream one ADPCM sound (see adpcm.h) at its own gain. Sounds stored below
+// SOUND_MIXER_OUTPUT_RATE_HZ are upsampled as they play (see
+// soundResampler.h). soundMixer_mix() renders the sum of all voices a block
+// at a time, saturated to +/-SOUND_MIXER_MAX_SAMPLE. Nothing here touches
+// hardware, so it also builds on the host.
+
+#ifndef SOUNDMIXER_H_
+#define SOUNDMIXER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SOUND_MIXER_VOICE_COUNT 4
+#define SOUND_MIXER_OUTPUT_RATE_HZ 48000
+// Largest block soundMixer_mix() renders in one call.
+#define SOUND_MIXER_BLOCK_SAMPLES 32
+// Gains are Q15: SOUND_MIXER_UNITY_GAIN plays a voice at its recorded level.
+#define SOUND_MIXER_GAIN_SHIFT 15
+#define SOUND_MIXER_UNITY_GAIN INT16_MAX
+#define SOUND_MIXER_NO_VOICE -1
+// Mixed samples stay within +/- this, so that sound.c can offset them by
+// INT16_MAX into an unsigned 16-bit CODEC sample. INT16_MIN would wrap to the
+// top of the range.
+#define SOUND_MIXER_MAX_SAMPLE INT16_MAX
+
+typedef int8_t soundMixer_voice_t;
+
+// Stops all voices.
+void soundMixer_init();
+
+// Starts playing sampleCount samples of ADPCM data recorded at sampleRateHz
+// at gain on a free voice. NULL data plays silence, which keeps the mixer
+// busy for sampleCount samples. If every voice is busy the one that started
+// first is replaced. Returns the voice used, or SOUND_MIXER_NO_VOICE if
+// sampleRateHz cannot be upsampled to SOUND_MIXER_OUTPUT_RATE_HZ.
+soundMixer_voice_t soundMixer_play(const uint8_t *data, uint32_t sampleCount,
+                                   uint32_t sampleRateHz, uint16_t gain);
+
+// Changes the gain of a playing voice.
+void soundMixer_setVoiceGain(soundMixer_voice_t voice, uint16_t gain);
+
+// Stops one voice.
+void soundMixer_stopVoice(soundMixer_voice_t voice);
+
+// Stops all voices.
+void soundMixer_stopAll();
+
+// Returns true if voice is still playing.
+bool soundMixer_isVoiceActive(soundMixer_voice_t voice);
+
+// Returns the number of voices still playing.
+uint8_t soundMixer_getActiveVoiceCount();
+
+// Renders up to count (at most SOUND_MIXER_BLOCK_SAMPLES) mixed samples into
+// out. Returns the number rendered: count while any voice is playing, fewer as
+// the last voice ends, 0 once all voices are done.
+uint32_t soundMixer_mix(int16_t out[], uint32_t count);
+
+#endif /* SOUNDMIXER_H_ */
@@ -0,0 +1,64 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "soundPack.h"
+
+// The pack is 4-byte aligned, so the header and entries are read in place.
+static const soundPack_header_t *getHeader(const uint8_t *pack) {
+  return (const soundPack_header_t *)pack;
+}
+
+static const soundPack_entry_t *getEntries(const uint8_t *pack) {
+  return (const soundPack_entry_t *)(pack + sizeof(soundPack_header_t));
+}
+
+// Returns true if pack has a valid header and every entry lies within it.
+bool soundPack_isValid(const uint8_t *pack) {
+  const soundPack_header_t *header = getHeader(pack);
+  if (memcmp(header->magic, SOUND_PACK_MAGIC, SOUND_PACK_MAGIC_BYTES) ||
+      header->version != SOUND_PACK_VERSION)
+    return false;
+  uint32_t dataStart = sizeof(soundPack_header_t) +
+                       header->assetCount * sizeof(soundPack_entry_t);
+  if (dataStart > header->byteCount)
+    return false;
+  const soundPack_entry_t *entries = getEntries(pack);
+  for (uint16_t i = 0; i < header->assetCount; i++) {
+    const soundPack_entry_t *entry = &entries[i];
+    if (entry->offset < dataStart || entry->offset > header->byteCount ||
+        entry->byteCount > header->byteCount - entry->offset ||
+        entry->offset % SOUND_PACK_ALIGNMENT)
+      return false;
+  }
+  return true;
+}
+
+// Returns the number of assets in pack.
+uint16_t soundPack_getAssetCount(const uint8_t *pack) {
+  return getHeader(pack)->assetCount;
+}
+
+// Fills in asset with the asset at index in pack. Returns false if there is
+// no such asset.
+bool soundPack_getAsset(const uint8_t *pack, uint16_t index,
+                        soundPack_asset_t *asset) {
+  if (index >= getHeader(pack)->assetCount)
+    return false;
+  const soundPack_entry_t *entry = &getEntries(pack)[index];
+  asset->data = pack + entry->offset;
+  asset->byteCount = entry->byteCount;
+  asset->sampleCount = entry->sampleCount;
+  asset->sampleRateHz = entry->sampleRateHz;
+  asset->format = entry->format;
+  return true;
+}
@@ -0,0 +1,70 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Indexed pack of sound assets, built by wav2pack from soundPack.txt and
+// linked in by soundPack.S. The pack starts with a header, then one entry
+// per asset, then the asset data, each asset starting on a 4-byte boundary.
+// All fields are little-endian. Assets are looked up by index, which is
+// their position in soundPack.txt.
+
+#ifndef SOUNDPACK_H_
+#define SOUNDPACK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SOUND_PACK_MAGIC "LTSP"
+#define SOUND_PACK_MAGIC_BYTES 4
+#define SOUND_PACK_VERSION 1
+#define SOUND_PACK_ALIGNMENT 4
+
+// Asset encodings.
+#define SOUND_PACK_FORMAT_IMA_ADPCM 1 // See adpcm.h.
+
+typedef struct {
+  char magic[SOUND_PACK_MAGIC_BYTES];
+  uint16_t version;
+  uint16_t assetCount;
+  uint32_t byteCount; // Whole pack, header included.
+  uint32_t reserved;
+} soundPack_header_t;
+
+typedef struct {
+  uint32_t offset;    // From the start of the pack.
+  uint32_t byteCount;
+  uint32_t sampleCount;
+  uint16_t sampleRateHz;
+  uint8_t format;
+  uint8_t reserved;
+} soundPack_entry_t;
+
+// An asset, ready to hand to the mixer.
+typedef struct {
+  const uint8_t *data;
+  uint32_t byteCount;
+  uint32_t sampleCount;
+  uint32_t sampleRateHz;
+  uint8_t format;
+} soundPack_asset_t;
+
+// The pack linked into the program by soundPack.S.
+extern const uint8_t soundPack_data[];
+
+// Returns true if pack has a valid header and every entry lies within it.
+bool soundPack_isValid(const uint8_t *pack);
+
+// Returns the number of assets in pack.
+uint16_t soundPack_getAssetCount(const uint8_t *pack);
+
+// Fills in asset with the asset at index in pack. Returns false if there is
+// no such asset.
+bool soundPack_getAsset(const uint8_t *pack, uint16_t index,
+                        soundPack_asset_t *asset);
+
+#endif /* SOUNDPACK_H_ */
@@ -0,0 +1,15 @@
+// This file was generated by executing this statement: wav2pack soundPack.txt
+#ifndef SOUNDPACKINDEX_H_
+#define SOUNDPACKINDEX_H_
+
+#define SOUND_PACK_GAMESTART 0
+#define SOUND_PACK_GUNFIRE 1
+#define SOUND_PACK_HIT 2
+#define SOUND_PACK_GUNCLICK 3
+#define SOUND_PACK_GUNRELOAD 4
+#define SOUND_PACK_LOSELIFE 5
+#define SOUND_PACK_GAMEOVER 6
+#define SOUND_PACK_RETURNTOBASE 7
+#define SOUND_PACK_ASSET_COUNT 8
+
+#endif /* SOUNDPACKINDEX_H_ */
@@ -0,0 +1,79 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+#include "soundResampler.h"
+
+#define COEFFICIENT_SHIFT 15 // Coefficients are Q15.
+
+// Polyphase coefficients for each factor. The prototype is a Hann-windowed
+// sinc with its cutoff at the input Nyquist frequency; each phase is scaled
+// to unity gain at DC so constant input comes out unchanged. The last phase
+// falls on an input sample and simply passes it through.
+static const int16_t passThrough[1][SOUND_RESAMPLER_TAPS] = {
+    {0, 0, 0, 32767, 0, 0, 0, 0}};
+static const int16_t factor2[2][SOUND_RESAMPLER_TAPS] = {
+    {-113, 1284, -4793, 20005, 20005, -4793, 1284, -113},
+    {0, 0, 0, 32767, 0, 0, 0, 0}};
+static const int16_t factor3[3][SOUND_RESAMPLER_TAPS] = {
+    {-42, 845, -3403, 12612, 26574, -5069, 1431, -181},
+    {-181, 1431, -5069, 26574, 12612, -3403, 845, -42},
+    {0, 0, 0, 32767, 0, 0, 0, 0}};
+static const int16_t factor4[4][SOUND_RESAMPLER_TAPS] = {
+    {-19, 595, -2514, 8990, 29170, -4582, 1317, -191},
+    {-113, 1284, -4793, 20005, 20005, -4793, 1284, -113},
+    {-191, 1317, -4582, 29170, 8990, -2514, 595, -19},
+    {0, 0, 0, 32767, 0, 0, 0, 0}};
+
+static const int16_t (*const coefficientTables[SOUND_RESAMPLER_MAX_FACTOR + 1])
+    [SOUND_RESAMPLER_TAPS] = {NULL, passThrough, factor2, factor3, factor4};
+
+// Sets up resampler to convert inputRateHz to outputRateHz and clears its
+// history. Returns false if outputRateHz is not 1 to
+// SOUND_RESAMPLER_MAX_FACTOR times inputRateHz.
+bool soundResampler_init(soundResampler_t *resampler, uint32_t inputRateHz,
+                         uint32_t outputRateHz) {
+  if (inputRateHz == 0 || outputRateHz % inputRateHz)
+    return false;
+  uint32_t factor = outputRateHz / inputRateHz;
+  if (factor < 1 || factor > SOUND_RESAMPLER_MAX_FACTOR)
+    return false;
+  resampler->coefficients = coefficientTables[factor];
+  resampler->factor = factor;
+  resampler->phase = 0;
+  for (uint8_t i = 0; i < SOUND_RESAMPLER_TAPS; i++)
+    resampler->history[i] = 0;
+  return true;
+}
+
+// Adds the next input sample.
+void soundResampler_push(soundResampler_t *resampler, int16_t sample) {
+  for (uint8_t i = SOUND_RESAMPLER_TAPS - 1; i > 0; i--)
+    resampler->history[i] = resampler->history[i - 1];
+  resampler->history[0] = sample;
+}
+
+// Returns the next output sample.
+int16_t soundResampler_next(soundResampler_t *resampler) {
+  const int16_t *taps = resampler->coefficients[resampler->phase];
+  int32_t sum = 0;
+  for (uint8_t i = 0; i < SOUND_RESAMPLER_TAPS; i++)
+    sum += taps[i] * resampler->history[i];
+  sum >>= COEFFICIENT_SHIFT;
+  if (sum > INT16_MAX)
+    sum = INT16_MAX;
+  else if (sum < INT16_MIN)
+    sum = INT16_MIN;
+  if (++resampler->phase == resampler->factor)
+    resampler->phase = 0;
+  return (int16_t)sum;
+}
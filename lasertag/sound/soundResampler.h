@@ -0,0 +1,54 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Polyphase interpolator that upsamples a sound stored at a lower rate to the
+// CODEC rate by an integer factor. Each output sample is an 8-tap FIR over the
+// most recent input samples, using the coefficient phase for its position
+// between inputs. Output lags input by 4 * factor - 1 output samples.
+//
+// Typical use, one output sample at a time:
+//   if (soundResampler_needsInput(&r))
+//     soundResampler_push(&r, nextInputSample);
+//   out = soundResampler_next(&r);
+
+#ifndef SOUNDRESAMPLER_H_
+#define SOUNDRESAMPLER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SOUND_RESAMPLER_TAPS 8
+#define SOUND_RESAMPLER_MAX_FACTOR 4
+
+typedef struct {
+  const int16_t (*coefficients)[SOUND_RESAMPLER_TAPS]; // One row per phase.
+  uint8_t factor;                        // Output samples per input sample.
+  uint8_t phase;                         // Position between input samples.
+  int16_t history[SOUND_RESAMPLER_TAPS]; // history[0] is the newest input.
+} soundResampler_t;
+
+// Sets up resampler to convert inputRateHz to outputRateHz and clears its
+// history. Returns false if outputRateHz is not 1 to
+// SOUND_RESAMPLER_MAX_FACTOR times inputRateHz.
+bool soundResampler_init(soundResampler_t *resampler, uint32_t inputRateHz,
+                         uint32_t outputRateHz);
+
+// Returns true if the next output sample needs a new input sample first.
+static inline bool
+soundResampler_needsInput(const soundResampler_t *resampler) {
+  return resampler->phase == 0;
+}
+
+// Adds the next input sample.
+void soundResampler_push(soundResampler_t *resampler, int16_t sample);
+
+// Returns the next output sample.
+int16_t soundResampler_next(soundResampler_t *resampler);
+
+#endif /* SOUNDRESAMPLER_H_ */
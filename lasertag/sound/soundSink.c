@@ -0,0 +1,257 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdio.h>
+
+#include "soundSink.h"
+#include "xiicps.h"
+#include "xil_io.h"
+#include "xil_types.h"
+#include "xparameters.h"
+#include "xtime_l.h"
+
+/***************************************************************
+ * Quite a bit of this code was obtained from digilent.com
+ * so it does not necessarily meet the coding standard.
+ ****************************************************************/
+
+/* I2S Register offsets */
+#define I2S_RESET_REG 0x00
+#define I2S_CTRL_REG 0x04
+#define I2S_CLK_CTRL_REG 0x08
+#define I2S_FIFO_STS_REG 0x20
+#define I2S_RX_FIFO_REG 0x28
+#define I2S_TX_FIFO_REG 0x2C
+
+/* IIC address of the SSM2603 device and the desired IIC clock speed */
+#define IIC_SLAVE_ADDR 0b0011010
+#define IIC_SCLK_RATE 100000
+
+/* Redefine the XPAR constants */
+#define IIC_DEVICE_ID XPAR_XIICPS_0_DEVICE_ID
+#define I2S_ADDRESS XPAR_AXI_I2S_ADI_0_BASEADDR
+#define TIMER_DEVICE_ID XPAR_SCUTIMER_DEVICE_ID
+#define AUDIO_IIC_ID XPAR_XIICPS_0_DEVICE_ID
+#define AUDIO_CTRL_BASEADDR XPAR_AXI_I2S_ADI_1_S_AXI_BASEADDR
+#define SCU_TIMER_ID XPAR_SCUTIMER_DEVICE_ID
+#define UART_BASEADDR XPAR_PS7_UART_1_BASEADDR
+
+#define I2S_FIFO_STS_TX_FULL 0b0010
+
+// The global timer runs at a fraction of the CPU clock.
+#define CPU_CYCLES_PER_GLOBAL_TIMER_COUNT                                      \
+  (XPAR_CPU_CORTEXA9_0_CPU_CLK_FREQ_HZ / COUNTS_PER_SECOND)
+
+// The global timer counts this many times a microsecond.
+#define GLOBAL_TIMER_COUNTS_PER_US (COUNTS_PER_SECOND / 1000000)
+
+static XIicPs Iic; /* Instance of the IIC Device */
+
+// Declared below the sink functions.
+static int AudioRegSet(XIicPs *IIcPtr, u8 regAddr, u16 regData);
+
+// Sets up the IIC controller connected to the CODEC. Returns false if it
+// could not be set up.
+bool soundSink_openCodecBus() {
+  /*
+   * Initialize the IIC driver so that it's ready to use
+   * Look up the configuration in the config table,
+   * then initialize it.
+   */
+  XIicPs_Config *Config = XIicPs_LookupConfig(AUDIO_IIC_ID);
+  if (NULL == Config)
+    return false;
+  if (XIicPs_CfgInitialize(&Iic, Config, Config->BaseAddress) != XST_SUCCESS)
+    return false;
+  /*
+   * Perform a self-test to ensure that the hardware was built correctly.
+   */
+  if (XIicPs_SelfTest(&Iic) != XST_SUCCESS)
+    return false;
+  /*
+   * Set the IIC serial clock rate.
+   */
+  return XIicPs_SetSClk(&Iic, IIC_SCLK_RATE) == XST_SUCCESS;
+}
+
+// Writes the low 9 bits of value to a CODEC register over IIC, waiting until
+// the transfer is done. Returns false if it failed.
+bool soundSink_writeCodecRegister(uint8_t reg, uint16_t value) {
+  return AudioRegSet(&Iic, reg, value) == XST_SUCCESS;
+}
+
+// Starts the I2S clocks that pace the CODEC at 48 kHz.
+void soundSink_startClocks() {
+  u32 i2sClkDiv; // Used to help compute the sampling frequency.
+  // BLH: This is the original value used by Digilent.
+  // i2sClkDiv = 1; // Set the BCLK to be MCLK / 4
+  // BLH: This value makes things sound correct.
+  // Not sure what the problem is, perhaps the DLL is not running at the correct
+  // frequency? or, there is a bug in the IP that drives the CODEC. In any case,
+  // the sampling rate is 48k.
+  i2sClkDiv = 3;
+  // Set the LRCLK's to be BCLK / 64
+  i2sClkDiv = i2sClkDiv | (31 << 16);
+  // Write clock div register
+  Xil_Out32(AUDIO_CTRL_BASEADDR + I2S_CLK_CTRL_REG, i2sClkDiv);
+}
+
+// Empties the FIFO and starts sending its frames to the output.
+void soundSink_start() {
+  Xil_Out32(AUDIO_CTRL_BASEADDR + I2S_RESET_REG, 0b010); // Reset TX Fifo
+  Xil_Out32(AUDIO_CTRL_BASEADDR + I2S_CTRL_REG,
+            0b001); // Enable TX Fifo, disable mute
+}
+
+// Stops sending frames to the output.
+void soundSink_stop() {
+  Xil_Out32(AUDIO_CTRL_BASEADDR + I2S_CTRL_REG, 0b00); // Disable TX FIFO.
+}
+
+// Returns true if the FIFO has no room for another frame.
+bool soundSink_isFull() {
+  return Xil_In32(AUDIO_CTRL_BASEADDR + I2S_FIFO_STS_REG) &
+         I2S_FIFO_STS_TX_FULL;
+}
+
+// Adds a frame to the FIFO with sample on both the left and right channels.
+void soundSink_write(uint32_t sample) {
+  Xil_Out32(AUDIO_CTRL_BASEADDR + I2S_TX_FIFO_REG,
+            sample); // add to left Channel.
+  Xil_Out32(AUDIO_CTRL_BASEADDR + I2S_TX_FIFO_REG,
+            sample); // add to right Channel.
+}
+
+// Returns a free-running count of CPU cycles, used to time sound_tick().
+// Differences are correct across wrap-around.
+uint32_t soundSink_getCycleCount() {
+  XTime now;
+  XTime_GetTime(&now);
+  return (uint32_t)(now * CPU_CYCLES_PER_GLOBAL_TIMER_COUNT);
+}
+
+// Returns a free-running count of microseconds, used to time CODEC bring-up.
+// Differences are correct across wrap-around.
+uint32_t soundSink_getMicroseconds() {
+  XTime now;
+  XTime_GetTime(&now);
+  return (uint32_t)(now / GLOBAL_TIMER_COUNTS_PER_US);
+}
+
+/**********************************************************************************
+ * Note from BLH: Most of this code was re-purposed from the original Digilent
+ * demonstration code. The code initializes the IIC controller that is
+ * connected to the audio CODEC. It also provides functions to initialize the
+ * audio CODEC and to send/received to/from CODEC.
+ **********************************************************************************/
+
+// The CODEC register settings now live in soundCodec.c, which sends them one
+// at a time through soundSink_writeCodecRegister().
+
+#define SEND_BUFFER_SIZE 2
+
+/***************************************************************************
+ * Procedural definitions from the original audio_demo files from Digilent.
+ ***************************************************************************/
+
+/***  AudioRegSet(XIicPs *IIcPtr, u8 regAddr, u16 regData)
+**
+**  Parameters:
+**    IIcPtr - Pointer to the initialized XIicPs struct
+**    regAddr - Register in the SSM2603 to write to
+**    regData - Data to write to the register (lower 9 bits are used)
+**
+**  Return Value: int
+**    XST_SUCCESS if successful
+**
+**  Errors:
+**
+**  Description:
+**    Writes a value to a register in the SSM2603 device over IIC.
+**
+*/
+static int AudioRegSet(XIicPs *IIcPtr, u8 regAddr, u16 regData) {
+  int Status;
+  //  u8 SendBuffer[2];
+  u8 SendBuffer[SEND_BUFFER_SIZE]; // We will send 2 bytes at a time.
+  // Register address is stored in bits 7 - 1.
+  SendBuffer[0] = regAddr << 1;
+  // Store data bit 9 in bit 7 of 0th word.
+  SendBuffer[0] = SendBuffer[0] | ((regData >> 8) & 0b1);
+  // Bits 7-0 of data are stored in 8 bits of 1th word.
+  SendBuffer[1] = regData & 0xFF;
+  // Send 2 bytes to the IIC controller attached to the audio CODEC.
+  Status = XIicPs_MasterSendPolled(IIcPtr, SendBuffer, 2, IIC_SLAVE_ADDR);
+  // Always check for success.
+  if (Status != XST_SUCCESS) {
+    printf("IIC send failed\n");
+    return XST_FAILURE;
+  }
+  // This function blocks until the IIC is idle.
+  /*
+   * Wait until bus is idle to start another transfer.
+   */
+  volatile int no_op;
+  while (1) {
+    no_op = XIicPs_BusIsBusy(IIcPtr);
+    if (!no_op)
+      break;
+  }
+
+  // while (XIicPs_BusIsBusy(IIcPtr)) {
+  //   /* NOP */
+  // }
+  return XST_SUCCESS;
+}
+
+/* ------------------------------------------------------------ */
+
+/***  I2SFifoWrite (u32 i2sBaseAddr, u32 audioData)
+**
+**  Parameters:
+**    i2sBaseAddr - Physical Base address of the I2S controller
+**    audioData - Audio data to be written to FIFO
+**
+**  Return Value: none
+**
+**  Errors:
+**
+**  Description:
+**    Blocks execution until space is available in the I2S TX fifo, then
+**    writes data to it.
+**
+*/
+static void I2SFifoWrite(u32 i2sBaseAddr, u32 audioData) {
+  while ((Xil_In32(i2sBaseAddr + I2S_FIFO_STS_REG)) & 0b0010) {
+  }
+  Xil_Out32(i2sBaseAddr + I2S_TX_FIFO_REG, audioData);
+}
+/* ------------------------------------------------------------ */
+
+/***  I2SFifoRead (u32 i2sBaseAddr)
+**
+**  Parameters:
+**    i2sBaseAddr - Physical Base address of the I2S controller
+**
+**  Return Value: u32
+**    Audio data from the I2S RX FIFO
+**
+**  Errors:
+**
+**  Description:
+**    Blocks execution until data is available in the I2S RX fifo, then
+**    reads it out.
+**
+*/
+static u32 I2SFifoRead(u32 i2sBaseAddr) {
+  while ((Xil_In32(i2sBaseAddr + I2S_FIFO_STS_REG)) & 0b0100) {
+  }
+  return Xil_In32(i2sBaseAddr + I2S_RX_FIFO_REG);
+}
+/* ------------------------------------------------------------ */
@@ -0,0 +1,53 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Where sound.c sends its samples. On the board this is the SSM2603 CODEC,
+// configured over IIC (see soundCodec.h) and fed through the TX FIFO of the
+// I2S controller (soundSink.c). On the host,
+// tools/soundSinkHost.c provides the same functions over a simulated FIFO so
+// that sound.c can be run and measured off-board.
+
+#ifndef SOUNDSINK_H_
+#define SOUNDSINK_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Sets up the IIC controller connected to the CODEC. Returns false if it
+// could not be set up.
+bool soundSink_openCodecBus();
+
+// Writes the low 9 bits of value to a CODEC register over IIC, waiting until
+// the transfer is done. Returns false if it failed.
+bool soundSink_writeCodecRegister(uint8_t reg, uint16_t value);
+
+// Starts the I2S clocks that pace the CODEC at 48 kHz.
+void soundSink_startClocks();
+
+// Empties the FIFO and starts sending its frames to the output.
+void soundSink_start();
+
+// Stops sending frames to the output.
+void soundSink_stop();
+
+// Returns true if the FIFO has no room for another frame.
+bool soundSink_isFull();
+
+// Adds a frame to the FIFO with sample on both the left and right channels.
+void soundSink_write(uint32_t sample);
+
+// Returns a free-running count of CPU cycles, used to time sound_tick().
+// Differences are correct across wrap-around.
+uint32_t soundSink_getCycleCount();
+
+// Returns a free-running count of microseconds, used to time CODEC bring-up.
+// Differences are correct across wrap-around.
+uint32_t soundSink_getMicroseconds();
+
+#endif /* SOUNDSINK_H_ */
@@ -5,16 +5,36 @@
 #include <string.h>
 #include <ctype.h>
 
+#include "adpcm.h"
+
 
 // Leave the following line uncommented unless you want to generate a simple tone.
 //#define GENERATE_TONE
 
+// By default the data are written as IMA-ADPCM (see adpcm.h), a quarter of the
+// size of 16-bit PCM, to a binary .adpcm file. A small .S file links it into
+// .rodata with .incbin and the .h file declares it and gives its metadata.
+// Build with:
+//   gcc wav2c.c adpcm.c -o wav2c
+// Usage: wav2c [-c | -p] filename.wav
+// -c writes the ADPCM data as a const uint8_t array in a .c file instead.
+// -p writes the old uncompressed, offset-binary uint16_t array in a .c file.
+// The generated files are written to the current directory.
+
 #define MAX_FILENAME_LENGTH 512 // Max size for buffers.
 #define WAV_SUFFIX "wav"        // The file must end in .wav
 #define H_FILE_SUFFIX ".h"      // .h files have this suffix.
 #define C_FILE_SUFFIX ".c"      // .c files have this suffix.
+#define S_FILE_SUFFIX ".S"      // Assembly files that link in a blob have this suffix.
+#define BLOB_FILE_SUFFIX ".adpcm"  // Binary ADPCM files have this suffix.
+#define BLOB_ALIGNMENT 4        // Keeps the blobs word-aligned.
 #define EXTERN_STATEMENT "extern"  // Just the C extern statement.
 #define C_DATA_TYPE "uint16_t"  // Type for data in the .c file
+#define C_ADPCM_DATA_TYPE "const uint8_t"  // Type for ADPCM data in the .c file
+#define ADPCM_BITS_PER_SAMPLE 4
+#define ADPCM_BYTES_PER_LINE 16  // Keeps the generated .c file short.
+#define PCM_OPTION "-p"
+#define C_ARRAY_OPTION "-c"
 #define SUPPORTED_WAVE_DATA_BIT_SIZE 16  // Program can only handle this size of data for now.
 
 // Header-specific defines. All sizes are numbered in bytes.
@@ -126,12 +146,18 @@ const char *get_filename_extension(const char* fileName) {
 
 int main(int argc, char* argv[]) {
   // Print a helpful error message and exit if a file-name was not provided on the command line.
-  if (argc != 2) {
-    fprintf(stderr, "Usage: wav2c filename.wav\n");
+  bool writePcm = (argc == 3 && !strcmp(argv[1], PCM_OPTION));  // Uncompressed output requested.
+  bool writeCArray = (argc == 3 && !strcmp(argv[1], C_ARRAY_OPTION));  // ADPCM as a C array requested.
+  if (argc != 2 && !writePcm && !writeCArray) {
+    fprintf(stderr, "Usage: wav2c [%s | %s] filename.wav\n", C_ARRAY_OPTION, PCM_OPTION);
     exit(-1);
   }
+  bool writeBlob = (argc == 2);  // Default: binary blob linked with .incbin.
+  const char* inputPath = argv[argc - 1];
   char inputFileName[MAX_FILENAME_LENGTH];         // Create a working buffer.
-  strncpy(inputFileName, argv[1], MAX_FILENAME_LENGTH);  // Copy the argv[1] filename into the working buffer.
+  // Generated names come from the file-name without its directory.
+  const char* slash = strrchr(inputPath, '/');
+  strncpy(inputFileName, slash ? slash + 1 : inputPath, MAX_FILENAME_LENGTH);
   // Make sure that the file-name has a .wav suffix.
   const char* extension = get_filename_extension(inputFileName);  // Get the suffix.
   // Compare the suffix and generate an error message if it is incorrect.
@@ -141,9 +167,9 @@ int main(int argc, char* argv[]) {
   }
   
   // Try to open the file.
-  FILE* inputFileFp = fopen(inputFileName, "rb");
+  FILE* inputFileFp = fopen(inputPath, "rb");
   if (inputFileFp == NULL) {
-    printf("unable to find file:%s\n", argv[1]);
+    printf("unable to find file:%s\n", inputPath);
     exit(-1);
   }
   // File is present and has correct extension if you get this far.
@@ -171,9 +197,12 @@ int main(int argc, char* argv[]) {
   char hFileName[MAX_FILENAME_LENGTH];                     // .h file-name.
   strncpy(hFileName, inputFileName, MAX_FILENAME_LENGTH);  // Basename is just the input-file-name.
   strncat(hFileName, H_FILE_SUFFIX, MAX_FILENAME_LENGTH);  // Add the suffix.
-  char cFileName[MAX_FILENAME_LENGTH];                     // .c file-name. 
+  char cFileName[MAX_FILENAME_LENGTH];                     // .c (or .S) file-name. 
   strncpy(cFileName, inputFileName, MAX_FILENAME_LENGTH);  // Basename is just the input-file-name.
-  strncat(cFileName, C_FILE_SUFFIX, MAX_FILENAME_LENGTH);  // Add the suffix.
+  strncat(cFileName, writeBlob ? S_FILE_SUFFIX : C_FILE_SUFFIX, MAX_FILENAME_LENGTH);  // Add the suffix.
+  char blobFileName[MAX_FILENAME_LENGTH];                     // .adpcm file-name.
+  strncpy(blobFileName, inputFileName, MAX_FILENAME_LENGTH);  // Basename is just the input-file-name.
+  strncat(blobFileName, BLOB_FILE_SUFFIX, MAX_FILENAME_LENGTH);  // Add the suffix.
 
   FILE* hFileFp = fopen(hFileName, "r");
   FILE* cFileFp = fopen(cFileName, "r");
@@ -204,25 +233,83 @@ int main(int argc, char* argv[]) {
   for (i=0; arrayName[i] != '\0'; i++) {
     arrayNameUpperCase[i] = toupper(arrayName[i]);
   }
-  arrayNameUpperCase[i+1] = '\0';  // Make sure to terminate the string.
+  arrayNameUpperCase[i] = '\0';  // Make sure to terminate the string.
  
+  // Read all of the samples. Program only handles 16-bit PCM data for now. PCM data is signed.
+  uint32_t sampleCount = header.subchunk2Size/2;  // Wave file is counted by bytes.
+  int16_t* samples = malloc(sampleCount * sizeof(int16_t));
+  if (!samples || fread(samples, sizeof(int16_t), sampleCount, inputFileFp) != sampleCount) {
+    fprintf(stderr, "ERROR: unable to read %d samples from %s.\n", sampleCount, inputPath);
+    exit(-1);
+  }
+  fclose(inputFileFp);  // Close the input file.
+
+  if (!writePcm) {
+    // Encode, then write the .h file and either the blob and its .S file or a .c file for the ADPCM data.
+    uint32_t byteCount = adpcm_getEncodedByteCount(sampleCount);
+    uint8_t* encoded = malloc(byteCount);
+    adpcm_encode(samples, sampleCount, encoded);
+    const char* option = writeBlob ? "" : C_ARRAY_OPTION " ";  // Recorded in the generated comments.
+    fprintf(hFileFp, "// This file was generated by executing this statement: wav2c %s%s\n", option, inputFileName);
+    fprintf(hFileFp, "// IMA-ADPCM data, decode with adpcm.h.\n");
+    fprintf(hFileFp, "%s %s %s[];\n", EXTERN_STATEMENT, C_ADPCM_DATA_TYPE, arrayName);
+    fprintf(hFileFp, "#define %s_SAMPLE_RATE %d\n", arrayNameUpperCase, header.sampleRate);
+    fprintf(hFileFp, "#define %s_BITS_PER_SAMPLE %d\n", arrayNameUpperCase, ADPCM_BITS_PER_SAMPLE);
+    fprintf(hFileFp, "#define %s_NUMBER_OF_SAMPLES %d\n", arrayNameUpperCase, sampleCount);
+    fprintf(hFileFp, "#define %s_NUMBER_OF_BYTES %d\n", arrayNameUpperCase, byteCount);
+    fclose(hFileFp);
+    fprintf(cFileFp, "// This file was generated by executing this statement: wav2c %s%s\n", option, inputFileName);
+    if (writeBlob) {
+      // The blob goes in its own .rodata section so the linker can drop it if unused.
+      FILE* blobFileFp = fopen(blobFileName, "wb");
+      if (!blobFileFp || fwrite(encoded, 1, byteCount, blobFileFp) != byteCount || fclose(blobFileFp)) {
+        fprintf(stderr, "Unable to write file: %s.\n", blobFileName);
+        exit(-1);
+      }
+      fprintf(cFileFp, "// Links the IMA-ADPCM data in %s into read-only memory.\n\n", blobFileName);
+      fprintf(cFileFp, "  .section .rodata.%s, \"a\"\n", arrayName);
+      fprintf(cFileFp, "  .balign %d\n", BLOB_ALIGNMENT);
+      fprintf(cFileFp, "  .global %s\n", arrayName);
+      fprintf(cFileFp, "  .type %s, %%object\n", arrayName);
+      fprintf(cFileFp, "%s:\n", arrayName);
+      fprintf(cFileFp, "  .incbin \"%s\"\n", blobFileName);
+      fprintf(cFileFp, "  .size %s, . - %s\n", arrayName, arrayName);
+      // Host builds (tools) would otherwise get an executable stack.
+      fprintf(cFileFp, "\n#if defined(__linux__) && defined(__ELF__)\n");
+      fprintf(cFileFp, "  .section .note.GNU-stack, \"\", %%progbits\n");
+      fprintf(cFileFp, "#endif\n");
+    } else {
+      fprintf(cFileFp, "\n#include <stdint.h>\n\n");
+      fprintf(cFileFp, "%s %s[%d] = {\n", C_ADPCM_DATA_TYPE, arrayName, byteCount);
+      for (i=0; i<byteCount; i++) {
+        fprintf(cFileFp, "%s0x%02x,", (i % ADPCM_BYTES_PER_LINE) ? " " : "", encoded[i]);
+        if ((i % ADPCM_BYTES_PER_LINE) == ADPCM_BYTES_PER_LINE - 1 || i == byteCount - 1)
+          fprintf(cFileFp, "\n");
+      }
+      fprintf(cFileFp, "};\n");  // Close the array.
+    }
+    fclose(cFileFp);
+    fprintf(stderr, "%d samples, %d bytes of PCM encoded as %d bytes of IMA-ADPCM.\n", sampleCount, sampleCount * 2, byteCount);
+    free(encoded);
+    free(samples);
+    return 0;
+  }
+
   // .h file just needs a comment and an extern statement.
-  fprintf(hFileFp, "// This file was generated by executing this statement: wav2c %s\n", inputFileName);
+  fprintf(hFileFp, "// This file was generated by executing this statement: wav2c %s %s\n", PCM_OPTION, inputFileName);
   fprintf(hFileFp, "%s uint16_t %s[];\n", EXTERN_STATEMENT, arrayName);
-  fprintf(hFileFp, "#define %s_SAMPLE_RATE %d\n", arrayNameUpperCase, header.sampleRate*10);
+  fprintf(hFileFp, "#define %s_SAMPLE_RATE %d\n", arrayNameUpperCase, header.sampleRate);
   fprintf(hFileFp, "#define %s_BITS_PER_SAMPLE %d\n", arrayNameUpperCase, header.bitsPerSample);
   fprintf(hFileFp, "#define %s_NUMBER_OF_SAMPLES %d\n", arrayNameUpperCase, header.subchunk2Size/2);
   fclose(hFileFp);
   // .c file will contain the data in array form as follows.
   uint32_t arraySize = header.subchunk2Size/2;  // Wave file is counted by bytes, output file is counted in 16-bit words.
   // Write some helpful comments to the .c file.
-  fprintf(cFileFp, "// This file was generated by executing this statement: wav2c %s\n", inputFileName);
+  fprintf(cFileFp, "// This file was generated by executing this statement: wav2c %s %s\n", PCM_OPTION, inputFileName);
   fprintf(cFileFp, "\n#include <stdint.h>\n\n");
   fprintf(cFileFp, "%s %s[%d] = {\n", C_DATA_TYPE, arrayName, arraySize);
-  // File pointer to the input file should be pointing at the first value after the header is read, so just start from there.
-  for (i=0; i<header.subchunk2Size/2; i++) {
-    int16_t data;  // Program only handles 16-bit PCM data for now. PCM data is signed.
-    fread(&data, header.blockAlign, 1, inputFileFp);  // Read 2 bytes into a signed 16-bit variable.
+  for (i=0; i<sampleCount; i++) {
+    int16_t data = samples[i];                        // Samples were read in above.
     uint16_t unsignedData = data + INT16_MAX;         // Offset to unsigned for the sound CODEC.
     fprintf(cFileFp, "%d", unsignedData);             // Write the unsiged data.
     if (i != (header.subchunk2Size/2)-1)              // Don't place the last comma.
@@ -230,5 +317,5 @@ int main(int argc, char* argv[]) {
   }
   fprintf(cFileFp, "\n};\n");  // Close the array.
   fclose(cFileFp);             // Close the .h file.
-  fclose(inputFileFp);         // Close the input file.
+  free(samples);
 }
@@ -0,0 +1,365 @@
+// Builds the indexed sound pack (see soundPack.h) from a manifest.
+//
+// Each manifest line names an asset, its 16-bit mono WAV file (relative to the
+// manifest) and the rate to store it at, which must divide the WAV's rate by
+// 1 to SOUND_RESAMPLER_MAX_FACTOR. Assets are low-pass filtered and decimated
+// to that rate, encoded as IMA-ADPCM and packed in manifest order. Blank lines
+// and lines starting with # are ignored.
+//
+// Writes soundPack.bin and soundPackIndex.h (one SOUND_PACK_<NAME> index per
+// asset) to the current directory. For each asset it prints the sizes and the
+// signal-to-noise ratio after decoding and upsampling with soundResampler, the
+// same path the mixer uses, against the original WAV.
+//
+// Build with:
+//   gcc wav2pack.c adpcm.c soundResampler.c -lm -o wav2pack
+// Usage: wav2pack soundPack.txt
+
+#include <ctype.h>
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "adpcm.h"
+#include "soundPack.h"
+#include "soundResampler.h"
+
+#define PACK_FILE_NAME "soundPack.bin"
+#define INDEX_FILE_NAME "soundPackIndex.h"
+#define MAX_ASSETS 64
+#define MAX_LINE_LENGTH 512
+#define MAX_NAME_LENGTH 64
+
+// Decimation filter: Blackman-windowed sinc with this many taps per side for
+// each unit of the decimation factor, cut off a little below the new Nyquist.
+#define DECIMATION_TAPS_PER_FACTOR 32
+#define DECIMATION_CUTOFF 0.45 // Fraction of the output rate.
+
+typedef struct {
+  char name[MAX_NAME_LENGTH];
+  uint32_t sampleRateHz;
+  uint32_t sampleCount;
+  uint8_t *encoded;
+  uint32_t byteCount;
+  uint32_t sourceRateHz;
+  uint32_t sourceSampleCount;
+  double snrDb;
+} asset_t;
+
+static uint32_t getLittleEndian(const uint8_t *data, uint16_t byteCount) {
+  uint32_t value = 0;
+  for (uint16_t i = 0; i < byteCount; i++)
+    value |= (uint32_t)data[i] << (i * 8);
+  return value;
+}
+
+static void putLittleEndian(uint8_t *data, uint32_t value, uint16_t byteCount) {
+  for (uint16_t i = 0; i < byteCount; i++)
+    data[i] = (value >> (i * 8)) & 0xFF;
+}
+
+// Reads a 16-bit mono PCM WAV file into a malloc'd buffer. Returns NULL and
+// prints why if the file cannot be used.
+static int16_t *readWav(const char *fileName, uint32_t *sampleCount,
+                        uint32_t *sampleRateHz) {
+  FILE *fp = fopen(fileName, "rb");
+  if (!fp) {
+    fprintf(stderr, "ERROR: cannot open %s.\n", fileName);
+    return NULL;
+  }
+  uint8_t riff[12], chunk[8], format[16];
+  bool haveFormat = false;
+  int16_t *samples = NULL;
+  if (fread(riff, 1, sizeof(riff), fp) != sizeof(riff) ||
+      memcmp(riff, "RIFF", 4) || memcmp(&riff[8], "WAVE", 4)) {
+    fprintf(stderr, "ERROR: %s is not a WAV file.\n", fileName);
+    fclose(fp);
+    return NULL;
+  }
+  while (fread(chunk, 1, sizeof(chunk), fp) == sizeof(chunk)) {
+    uint32_t size = getLittleEndian(&chunk[4], 4);
+    if (!memcmp(chunk, "fmt ", 4) && size >= sizeof(format)) {
+      if (fread(format, 1, sizeof(format), fp) != sizeof(format))
+        break;
+      fseek(fp, size - sizeof(format), SEEK_CUR);
+      haveFormat = true;
+    } else if (!memcmp(chunk, "data", 4) && haveFormat) {
+      if (getLittleEndian(&format[0], 2) != 1 ||
+          getLittleEndian(&format[2], 2) != 1 ||
+          getLittleEndian(&format[14], 2) != 16) {
+        fprintf(stderr, "ERROR: %s is not 16-bit mono PCM.\n", fileName);
+        break;
+      }
+      *sampleRateHz = getLittleEndian(&format[4], 4);
+      *sampleCount = size / sizeof(int16_t);
+      samples = malloc(*sampleCount * sizeof(int16_t));
+      if (samples &&
+          fread(samples, sizeof(int16_t), *sampleCount, fp) != *sampleCount) {
+        free(samples);
+        samples = NULL;
+      }
+      break;
+    } else {
+      fseek(fp, size + (size & 1), SEEK_CUR); // Chunks are word-aligned.
+    }
+  }
+  fclose(fp);
+  if (!samples)
+    fprintf(stderr, "ERROR: no usable data in %s.\n", fileName);
+  return samples;
+}
+
+static int16_t clampToSample(double value) {
+  long rounded = lround(value);
+  if (rounded > INT16_MAX)
+    return INT16_MAX;
+  if (rounded < INT16_MIN)
+    return INT16_MIN;
+  return (int16_t)rounded;
+}
+
+// Low-pass filters and keeps every factor-th sample. Returns the number of
+// samples written to out, which must hold ceil(count / factor).
+static uint32_t decimate(const int16_t in[], uint32_t count, uint32_t factor,
+                         int16_t out[]) {
+  if (factor == 1) {
+    memcpy(out, in, count * sizeof(int16_t));
+    return count;
+  }
+  int32_t half = DECIMATION_TAPS_PER_FACTOR * factor;
+  uint32_t length = 2 * half + 1;
+  double *taps = malloc(length * sizeof(double));
+  double cutoff = DECIMATION_CUTOFF / factor; // Cycles per input sample.
+  for (uint32_t k = 0; k < length; k++) {
+    double m = (double)k - half;
+    double sinc =
+        m == 0 ? 2 * cutoff : sin(2 * M_PI * cutoff * m) / (M_PI * m);
+    double window = 0.42 - 0.5 * cos(2 * M_PI * k / (length - 1)) +
+                    0.08 * cos(4 * M_PI * k / (length - 1));
+    taps[k] = sinc * window;
+  }
+  uint32_t outCount = (count + factor - 1) / factor;
+  for (uint32_t o = 0; o < outCount; o++) {
+    int64_t center = (int64_t)o * factor;
+    double sum = 0.0;
+    for (uint32_t k = 0; k < length; k++) {
+      int64_t i = center + k - half;
+      if (i >= 0 && i < count)
+        sum += taps[k] * in[i];
+    }
+    out[o] = clampToSample(sum);
+  }
+  free(taps);
+  return outCount;
+}
+
+// Decodes and upsamples the asset the way the mixer does and compares the
+// result with the original samples.
+static double measureSnrDb(const asset_t *asset, const int16_t original[]) {
+  int16_t *decoded = malloc(asset->sampleCount * sizeof(int16_t));
+  adpcm_decoder_t decoder;
+  adpcm_initDecoder(&decoder, asset->encoded, asset->sampleCount);
+  adpcm_decode(&decoder, decoded, asset->sampleCount);
+
+  uint32_t factor = asset->sourceRateHz / asset->sampleRateHz;
+  // The interpolator delays its output by factor * TAPS / 2 - 1 samples. The
+  // mixer bypasses it at factor 1.
+  uint32_t delay =
+      factor == 1 ? 0 : factor * SOUND_RESAMPLER_TAPS / 2 - 1;
+  soundResampler_t resampler;
+  soundResampler_init(&resampler, asset->sampleRateHz, asset->sourceRateHz);
+  double signal = 0.0, noise = 0.0;
+  uint32_t in = 0;
+  for (uint32_t o = 0; o < asset->sourceSampleCount + delay; o++) {
+    int16_t value;
+    if (factor == 1) {
+      value = decoded[o < asset->sampleCount ? o : asset->sampleCount - 1];
+    } else {
+      if (soundResampler_needsInput(&resampler))
+        soundResampler_push(&resampler,
+                            in < asset->sampleCount ? decoded[in++] : 0);
+      value = soundResampler_next(&resampler);
+    }
+    if (o < delay || o - delay >= asset->sourceSampleCount)
+      continue;
+    double error = (double)original[o - delay] - value;
+    signal += (double)original[o - delay] * original[o - delay];
+    noise += error * error;
+  }
+  free(decoded);
+  return noise > 0.0 ? 10.0 * log10(signal / noise) : INFINITY;
+}
+
+// Reads the WAV named on a manifest line and encodes it into asset.
+static bool buildAsset(asset_t *asset, const char *directory,
+                       const char *fileName, uint32_t sampleRateHz) {
+  char path[MAX_LINE_LENGTH * 2];
+  if (fileName[0] == '/')
+    snprintf(path, sizeof(path), "%s", fileName);
+  else
+    snprintf(path, sizeof(path), "%s%s", directory, fileName);
+  int16_t *original =
+      readWav(path, &asset->sourceSampleCount, &asset->sourceRateHz);
+  if (!original)
+    return false;
+  if (sampleRateHz == 0 || sampleRateHz > UINT16_MAX ||
+      asset->sourceRateHz % sampleRateHz ||
+      asset->sourceRateHz / sampleRateHz > SOUND_RESAMPLER_MAX_FACTOR) {
+    fprintf(stderr, "ERROR: %s cannot be stored at %u Hz from %u Hz.\n", path,
+            sampleRateHz, asset->sourceRateHz);
+    free(original);
+    return false;
+  }
+  uint32_t factor = asset->sourceRateHz / sampleRateHz;
+  int16_t *samples =
+      malloc((asset->sourceSampleCount / factor + 1) * sizeof(int16_t));
+  asset->sampleRateHz = sampleRateHz;
+  asset->sampleCount =
+      decimate(original, asset->sourceSampleCount, factor, samples);
+  asset->byteCount = adpcm_getEncodedByteCount(asset->sampleCount);
+  asset->encoded = malloc(asset->byteCount);
+  adpcm_encode(samples, asset->sampleCount, asset->encoded);
+  asset->snrDb = measureSnrDb(asset, original);
+  free(samples);
+  free(original);
+  return true;
+}
+
+// Parses the manifest into assets. Returns the number of assets, or -1 on an
+// error.
+static int readManifest(const char *manifestName, asset_t assets[]) {
+  FILE *fp = fopen(manifestName, "r");
+  if (!fp) {
+    fprintf(stderr, "ERROR: cannot open %s.\n", manifestName);
+    return -1;
+  }
+  // Asset files are named relative to the manifest.
+  char directory[MAX_LINE_LENGTH] = "";
+  const char *slash = strrchr(manifestName, '/');
+  if (slash && slash - manifestName + 1 < MAX_LINE_LENGTH) {
+    memcpy(directory, manifestName, slash - manifestName + 1);
+    directory[slash - manifestName + 1] = '\0';
+  }
+  char line[MAX_LINE_LENGTH];
+  int count = 0;
+  uint32_t lineNumber = 0;
+  while (fgets(line, sizeof(line), fp)) {
+    lineNumber++;
+    char name[MAX_NAME_LENGTH], fileName[MAX_LINE_LENGTH];
+    unsigned rate;
+    char *start = line;
+    while (isspace((unsigned char)*start))
+      start++;
+    if (*start == '\0' || *start == '#')
+      continue;
+    if (sscanf(start, "%63s %511s %u", name, fileName, &rate) != 3 ||
+        count == MAX_ASSETS) {
+      fprintf(stderr, "ERROR: %s:%u: expected \"name file.wav rateHz\".\n",
+              manifestName, lineNumber);
+      count = -1;
+      break;
+    }
+    strcpy(assets[count].name, name);
+    if (!buildAsset(&assets[count], directory, fileName, rate)) {
+      count = -1;
+      break;
+    }
+    count++;
+  }
+  fclose(fp);
+  return count;
+}
+
+static uint32_t alignUp(uint32_t value) {
+  return (value + SOUND_PACK_ALIGNMENT - 1) & ~(SOUND_PACK_ALIGNMENT - 1);
+}
+
+static bool writePack(const asset_t assets[], uint16_t count) {
+  uint32_t offset =
+      sizeof(soundPack_header_t) + count * sizeof(soundPack_entry_t);
+  uint32_t offsets[MAX_ASSETS];
+  for (uint16_t i = 0; i < count; i++) {
+    offset = alignUp(offset);
+    offsets[i] = offset;
+    offset += assets[i].byteCount;
+  }
+  uint32_t byteCount = alignUp(offset);
+  uint8_t *pack = calloc(byteCount, 1);
+  // Header.
+  memcpy(pack, SOUND_PACK_MAGIC, SOUND_PACK_MAGIC_BYTES);
+  putLittleEndian(&pack[4], SOUND_PACK_VERSION, 2);
+  putLittleEndian(&pack[6], count, 2);
+  putLittleEndian(&pack[8], byteCount, 4);
+  // Entries, then data.
+  for (uint16_t i = 0; i < count; i++) {
+    uint8_t *entry =
+        &pack[sizeof(soundPack_header_t) + i * sizeof(soundPack_entry_t)];
+    putLittleEndian(&entry[0], offsets[i], 4);
+    putLittleEndian(&entry[4], assets[i].byteCount, 4);
+    putLittleEndian(&entry[8], assets[i].sampleCount, 4);
+    putLittleEndian(&entry[12], assets[i].sampleRateHz, 2);
+    entry[14] = SOUND_PACK_FORMAT_IMA_ADPCM;
+    memcpy(&pack[offsets[i]], assets[i].encoded, assets[i].byteCount);
+  }
+  FILE *fp = fopen(PACK_FILE_NAME, "wb");
+  bool ok = fp && fwrite(pack, 1, byteCount, fp) == byteCount;
+  if (fp && fclose(fp))
+    ok = false;
+  free(pack);
+  return ok;
+}
+
+static bool writeIndex(const asset_t assets[], uint16_t count,
+                       const char *manifestName) {
+  FILE *fp = fopen(INDEX_FILE_NAME, "w");
+  if (!fp)
+    return false;
+  fprintf(fp, "// This file was generated by executing this statement: "
+              "wav2pack %s\n",
+          manifestName);
+  fprintf(fp, "#ifndef SOUNDPACKINDEX_H_\n#define SOUNDPACKINDEX_H_\n\n");
+  for (uint16_t i = 0; i < count; i++) {
+    fprintf(fp, "#define SOUND_PACK_");
+    for (const char *c = assets[i].name; *c; c++)
+      fputc(toupper((unsigned char)*c), fp);
+    fprintf(fp, " %u\n", i);
+  }
+  fprintf(fp, "#define SOUND_PACK_ASSET_COUNT %u\n", count);
+  fprintf(fp, "\n#endif /* SOUNDPACKINDEX_H_ */\n");
+  return fclose(fp) == 0;
+}
+
+int main(int argc, char *argv[]) {
+  if (argc != 2) {
+    fprintf(stderr, "Usage: %s soundPack.txt\n", argv[0]);
+    exit(-1);
+  }
+  static asset_t assets[MAX_ASSETS];
+  int count = readManifest(argv[1], assets);
+  if (count < 0)
+    exit(-1);
+  if (!writePack(assets, count) || !writeIndex(assets, count, argv[1])) {
+    fprintf(stderr, "ERROR: cannot write %s or %s.\n", PACK_FILE_NAME,
+            INDEX_FILE_NAME);
+    exit(-1);
+  }
+
+  uint64_t pcmBytes = 0, packBytes = 0;
+  printf("%-14s %7s %9s %9s %8s\n", "asset", "rateHz", "pcmBytes", "bytes",
+         "snrDb");
+  for (int i = 0; i < count; i++) {
+    const asset_t *asset = &assets[i];
+    uint32_t sourceBytes = asset->sourceSampleCount * sizeof(int16_t);
+    printf("%-14s %7u %9u %9u %8.1f\n", asset->name, asset->sampleRateHz,
+           sourceBytes, asset->byteCount, asset->snrDb);
+    pcmBytes += sourceBytes;
+    packBytes += asset->byteCount;
+    free(asset->encoded);
+  }
+  printf("%-14s %7s %9llu %9llu\n", "total", "", (unsigned long long)pcmBytes,
+         (unsigned long long)packBytes);
+  return 0;
+}
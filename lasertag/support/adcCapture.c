@@ -0,0 +1,153 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "adcCapture.h"
+#include "crc16.h"
+
+#define ADC_SIGN_BIT 0x800
+#define ADC_SIGN_EXTENSION 0xF000
+#define ADC_VALUE_MASK 0x0FFF
+
+#define BYTE_MASK 0xFF
+#define BITS_PER_BYTE 8
+
+// Frame field offsets, see adcCapture.h.
+#define FRAME_VERSION_OFFSET 4
+#define FRAME_FLAGS_OFFSET 5
+#define FRAME_COUNT_OFFSET 6
+#define FRAME_SEQUENCE_OFFSET 8
+
+typedef struct {
+  uint32_t sequence;    // Block number since the start of the capture.
+  uint16_t sampleCount; // Less than a full block only for the last one.
+  adcCapture_sample_t samples[ADC_CAPTURE_BLOCK_SAMPLES];
+} adcCapture_block_t;
+
+static adcCapture_block_t blocks[ADC_CAPTURE_BLOCK_COUNT];
+static uint32_t fillIndex;  // Block being filled.
+static uint32_t takeIndex;  // Oldest block waiting to be taken.
+static uint32_t fullCount;  // Blocks waiting to be taken.
+static uint16_t fillOffset; // Samples so far in the block being filled.
+static uint32_t nextSequence;
+static bool droppingBlock; // No room when this block started.
+static bool bipolarMode;
+static uint32_t sampleCount;
+static uint32_t droppedSampleCount;
+
+// Empties the ring and starts a new capture. bipolar selects how raw ADC
+// values are interpreted, see interrupts_getAdcInputMode().
+void adcCapture_init(bool bipolar) {
+  fillIndex = 0;
+  takeIndex = 0;
+  fullCount = 0;
+  fillOffset = 0;
+  nextSequence = 0;
+  droppingBlock = false;
+  bipolarMode = bipolar;
+  sampleCount = 0;
+  droppedSampleCount = 0;
+}
+
+// Marks the block being filled as full and moves on to the next one.
+static void closeBlock(void) {
+  blocks[fillIndex].sampleCount = fillOffset;
+  fillIndex = (fillIndex + 1) % ADC_CAPTURE_BLOCK_COUNT;
+  fullCount++;
+}
+
+// Adds one raw 12-bit ADC value, sign-extending it in bipolar mode. If the
+// ring is full when a block starts, that whole block is dropped. Returns false
+// if the sample was dropped.
+bool adcCapture_addSample(uint16_t rawValue) {
+  sampleCount++;
+  // Decide at each block boundary whether this block can be kept.
+  if (fillOffset == 0) {
+    droppingBlock = (fullCount == ADC_CAPTURE_BLOCK_COUNT);
+    if (!droppingBlock)
+      blocks[fillIndex].sequence = nextSequence;
+    nextSequence++;
+  }
+  bool kept = !droppingBlock;
+  if (kept) {
+    uint16_t value = rawValue & ADC_VALUE_MASK;
+    if (bipolarMode && (value & ADC_SIGN_BIT))
+      value |= ADC_SIGN_EXTENSION;
+    blocks[fillIndex].samples[fillOffset] = (adcCapture_sample_t)value;
+  } else {
+    droppedSampleCount++;
+  }
+  fillOffset++;
+  if (fillOffset == ADC_CAPTURE_BLOCK_SAMPLES) {
+    if (!droppingBlock)
+      closeBlock();
+    fillOffset = 0;
+  }
+  return kept;
+}
+
+// Closes the block being filled, even if it is partial, so it can be taken.
+// Call once at the end of a capture.
+void adcCapture_finish(void) {
+  if (fillOffset && !droppingBlock)
+    closeBlock();
+  fillOffset = 0;
+}
+
+// Returns true if every block in the ring is waiting to be taken.
+bool adcCapture_isFull(void) { return fullCount == ADC_CAPTURE_BLOCK_COUNT; }
+
+// Returns the number of blocks waiting to be taken.
+uint32_t adcCapture_getFullBlockCount(void) { return fullCount; }
+
+// Returns the number of samples added since adcCapture_init().
+uint32_t adcCapture_getSampleCount(void) { return sampleCount; }
+
+// Returns the number of samples dropped since adcCapture_init().
+uint32_t adcCapture_getDroppedSampleCount(void) { return droppedSampleCount; }
+
+// Stores value little-endian in byteCount bytes starting at data.
+static void putLittleEndian(uint8_t *data, uint32_t value, uint16_t byteCount) {
+  for (uint16_t i = 0; i < byteCount; i++)
+    data[i] = (value >> (i * BITS_PER_BYTE)) & BYTE_MASK;
+}
+
+// Encodes the oldest waiting block into frame, which must hold
+// ADC_CAPTURE_MAX_FRAME_BYTES, and frees the block. Returns the frame length
+// in bytes, or 0 if no block is waiting.
+uint32_t adcCapture_takeFrame(uint8_t frame[]) {
+  if (fullCount == 0)
+    return 0;
+  const adcCapture_block_t *block = &blocks[takeIndex];
+  putLittleEndian(frame, ADC_CAPTURE_SYNC_WORD, ADC_CAPTURE_SYNC_BYTES);
+  frame[FRAME_VERSION_OFFSET] = ADC_CAPTURE_FORMAT_VERSION;
+  frame[FRAME_FLAGS_OFFSET] = bipolarMode ? ADC_CAPTURE_FLAG_BIPOLAR : 0;
+  putLittleEndian(&frame[FRAME_COUNT_OFFSET], block->sampleCount,
+                  sizeof(uint16_t));
+  putLittleEndian(&frame[FRAME_SEQUENCE_OFFSET], block->sequence,
+                  sizeof(uint32_t));
+  uint32_t length = ADC_CAPTURE_FRAME_HEADER_BYTES;
+  for (uint16_t i = 0; i < block->sampleCount; i++) {
+    putLittleEndian(&frame[length], (uint16_t)block->samples[i],
+                    sizeof(adcCapture_sample_t));
+    length += sizeof(adcCapture_sample_t);
+  }
+  // The sync word is left out of the CRC so a frame can be checked after
+  // resynchronizing on it.
+  uint16_t crc = crc16_compute(&frame[ADC_CAPTURE_SYNC_BYTES],
+                               length - ADC_CAPTURE_SYNC_BYTES);
+  putLittleEndian(&frame[length], crc, ADC_CAPTURE_FRAME_CRC_BYTES);
+  length += ADC_CAPTURE_FRAME_CRC_BYTES;
+
+  takeIndex = (takeIndex + 1) % ADC_CAPTURE_BLOCK_COUNT;
+  fullCount--;
+  return length;
+}
@@ -0,0 +1,79 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Records raw ADC samples at the full sample rate into a RAM ring of blocks
+// and encodes each block as a framed binary packet for streaming to a host.
+// tools/adcCaptureDecode turns the stream back into a trace file.
+//
+// Frame layout, multi-byte fields little-endian:
+//   offset  size  field
+//        0     4  sync word ADC_CAPTURE_SYNC_WORD (bytes A5 5A C3 3C)
+//        4     1  format version ADC_CAPTURE_FORMAT_VERSION
+//        5     1  flags (ADC_CAPTURE_FLAG_BIPOLAR)
+//        6     2  sample count n (1..ADC_CAPTURE_BLOCK_SAMPLES)
+//        8     4  block sequence number
+//       12    2n  samples, int16
+//    12+2n     2  CRC-16/CCITT-FALSE of bytes 4 .. 12+2n-1
+// The sequence number counts blocks from the start of the capture, including
+// blocks that were dropped because the ring was full, so a gap in the sequence
+// shows exactly how many samples are missing.
+
+#ifndef ADCCAPTURE_H_
+#define ADCCAPTURE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// 256 samples is 2.56 ms at 100 kHz; 4096 blocks hold about 10 s (2 MB).
+#define ADC_CAPTURE_BLOCK_SAMPLES 256
+#define ADC_CAPTURE_BLOCK_COUNT 4096
+
+#define ADC_CAPTURE_SYNC_WORD 0x3CC35AA5
+#define ADC_CAPTURE_SYNC_BYTES 4
+#define ADC_CAPTURE_FORMAT_VERSION 1
+#define ADC_CAPTURE_FLAG_BIPOLAR 0x01 // Samples are signed (bipolar ADC mode).
+#define ADC_CAPTURE_FRAME_HEADER_BYTES 12
+#define ADC_CAPTURE_FRAME_CRC_BYTES 2
+#define ADC_CAPTURE_MAX_FRAME_BYTES                                            \
+  (ADC_CAPTURE_FRAME_HEADER_BYTES +                                            \
+   ADC_CAPTURE_BLOCK_SAMPLES * sizeof(adcCapture_sample_t) +                   \
+   ADC_CAPTURE_FRAME_CRC_BYTES)
+
+// Samples are stored sign-extended in bipolar mode and as is in unipolar mode.
+typedef int16_t adcCapture_sample_t;
+
+// Empties the ring and starts a new capture. bipolar selects how raw ADC
+// values are interpreted, see interrupts_getAdcInputMode().
+void adcCapture_init(bool bipolar);
+
+// Adds one raw 12-bit ADC value, sign-extending it in bipolar mode. If the
+// ring is full when a block starts, that whole block is dropped. Returns false
+// if the sample was dropped.
+bool adcCapture_addSample(uint16_t rawValue);
+
+// Closes the block being filled, even if it is partial, so it can be taken.
+// Call once at the end of a capture.
+void adcCapture_finish(void);
+
+// Returns true if every block in the ring is waiting to be taken.
+bool adcCapture_isFull(void);
+
+// Returns the number of blocks waiting to be taken.
+uint32_t adcCapture_getFullBlockCount(void);
+
+// Returns the number of samples added and dropped since adcCapture_init().
+uint32_t adcCapture_getSampleCount(void);
+uint32_t adcCapture_getDroppedSampleCount(void);
+
+// Encodes the oldest waiting block into frame, which must hold
+// ADC_CAPTURE_MAX_FRAME_BYTES, and frees the block. Returns the frame length
+// in bytes, or 0 if no block is waiting.
+uint32_t adcCapture_takeFrame(uint8_t frame[]);
+
+#endif /* ADCCAPTURE_H_ */
@@ -0,0 +1,61 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cobs.h"
+
+// A code byte of n means n - 1 data bytes follow, then a zero, except that
+// the longest run, 254 data bytes, has no zero after it.
+#define COBS_MAX_CODE 0xFF
+
+// Encodes length bytes of packet into encoded, which must hold
+// COBS_MAX_ENCODED_LENGTH(length) bytes. Returns the encoded length. The
+// delimiter is not added.
+uint32_t cobs_encode(const uint8_t *packet, uint32_t length, uint8_t *encoded) {
+  uint32_t codeIndex = 0; // Where the current run's code byte goes.
+  uint32_t out = 1;
+  uint8_t code = 1;
+  for (uint32_t i = 0; i < length; i++) {
+    if (packet[i] != 0) {
+      encoded[out++] = packet[i];
+      code++;
+    }
+    if (packet[i] == 0 || code == COBS_MAX_CODE) {
+      encoded[codeIndex] = code;
+      codeIndex = out++;
+      code = 1;
+    }
+  }
+  encoded[codeIndex] = code;
+  return out;
+}
+
+// Decodes length bytes of encoded, without the delimiter, into packet, which
+// must hold length bytes. Sets decodedLength and returns true, or returns
+// false if encoded is not a valid COBS encoding.
+bool cobs_decode(const uint8_t *encoded, uint32_t length, uint8_t *packet,
+                 uint32_t *decodedLength) {
+  uint32_t in = 0, out = 0;
+  while (in < length) {
+    uint8_t code = encoded[in++];
+    if (code == 0 || in + code - 1 > length)
+      return false;
+    for (uint8_t i = 1; i < code; i++) {
+      if (encoded[in] == 0)
+        return false;
+      packet[out++] = encoded[in++];
+    }
+    // Every run but the last and the longest ends in a zero.
+    if (code != COBS_MAX_CODE && in < length)
+      packet[out++] = 0;
+  }
+  *decodedLength = out;
+  return true;
+}
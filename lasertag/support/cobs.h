@@ -0,0 +1,36 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+// Consistent Overhead Byte Stuffing. Encodes a packet so that it contains no
+// zero bytes, which leaves 0x00 free to mark the end of each frame on a byte
+// stream. A receiver that joins mid-stream or sees corrupted bytes resyncs at
+// the next zero. Encoding adds one byte per 254 bytes of packet, plus one.
+
+#ifndef COBS_H_
+#define COBS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define COBS_DELIMITER 0x00
+
+// Largest encoding of a length-byte packet, not counting the delimiter.
+#define COBS_MAX_ENCODED_LENGTH(length) ((length) + (length) / 254 + 1)
+
+// Encodes length bytes of packet into encoded, which must hold
+// COBS_MAX_ENCODED_LENGTH(length) bytes. Returns the encoded length. The
+// delimiter is not added.
+uint32_t cobs_encode(const uint8_t *packet, uint32_t length, uint8_t *encoded);
+
+// Decodes length bytes of encoded, without the delimiter, into packet, which
+// must hold length bytes. Sets decodedLength and returns true, or returns
+// false if encoded is not a valid COBS encoding.
+bool cobs_decode(const uint8_t *encoded, uint32_t length, uint8_t *packet,
+                 uint32_t *decodedLength);
+
+#endif /* COBS_H_ */
@@ -0,0 +1,28 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// CRC-16/CCITT-FALSE (polynomial 0x1021, initial value 0xFFFF, no reflection,
+// no final XOR). Used to check binary frames sent from the board. The check
+// value of the ASCII string "123456789" is 0x29B1.
+
+#ifndef CRC16_H_
+#define CRC16_H_
+
+#include <stdint.h>
+
+#define CRC16_INITIAL_VALUE 0xFFFF
+
+// Returns the CRC of length bytes of data.
+uint16_t crc16_compute(const uint8_t *data, uint32_t length);
+
+// Continues a CRC over more data. Start with CRC16_INITIAL_VALUE; the result
+// after the last piece equals crc16_compute() over all pieces together.
+uint16_t crc16_update(uint16_t crc, const uint8_t *data, uint32_t length);
+
+#endif /* CRC16_H_ */
@@ -0,0 +1,34 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// The 5x7 font the TFT driver draws text with, for code that renders text
+// itself. Printable ASCII only. Each glyph is five columns, left to right; bit
+// 0 of a column is the top row and bit 7 the bottom, which only descenders
+// use. A character cell is DISPLAY_CHAR_WIDTH by DISPLAY_CHAR_HEIGHT pixels,
+// the sixth column left blank as the gap to the next character.
+
+#ifndef DISPLAYFONT_H_
+#define DISPLAYFONT_H_
+
+#include <stdint.h>
+
+#define DISPLAY_FONT_FIRST_CHAR ' '
+#define DISPLAY_FONT_LAST_CHAR '~'
+#define DISPLAY_FONT_GLYPH_COUNT                                               \
+  (DISPLAY_FONT_LAST_CHAR - DISPLAY_FONT_FIRST_CHAR + 1)
+#define DISPLAY_FONT_GLYPH_COLUMNS 5
+
+extern const uint8_t displayFont_glyphs[DISPLAY_FONT_GLYPH_COUNT]
+                                       [DISPLAY_FONT_GLYPH_COLUMNS];
+
+// Returns the columns of c's glyph, or of a blank for characters the font
+// does not have.
+const uint8_t *displayFont_getGlyph(unsigned char c);
+
+#endif /* DISPLAYFONT_H_ */
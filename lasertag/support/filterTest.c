@@ -28,6 +28,7 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 #include "queue.h"
 #include "filter.h"
+#include "format.h"
 #include "histogram.h"
 #include "utils.h"
 
@@ -491,12 +492,10 @@ void filterTest_plotIirFrequencyResponse(double iirPowerValues[],
     char label[HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS]; // Get a buffer for
                                                             // the label.
     // Create the top-label, based upon the actual power value. Use floor() +0.5
-    // to round the number instead of truncate.
-    if (snprintf(label, HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS, "%0.0e",
-                 floor(iirPowerValues[barIndex]) + ONE_HALF_FP(1.0)) == -1)
-      printf("Error: snprintf encountered an error during conversion.\n");
-    // Pull out the 'e' from the exponent to make better use of your characters.
-    trimLabel(label);
+    // to round the number instead of truncate. The 'e' of the exponent is left
+    // out to make better use of your characters.
+    format_compactExponent(label, HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS,
+                           floor(iirPowerValues[barIndex]) + ONE_HALF_FP(1.0));
     histogram_setBarData(barIndex,
                          normalizedPowerValue[barIndex] *
                              HISTOGRAM_MAX_BAR_DATA_IN_PIXELS,
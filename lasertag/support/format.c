@@ -0,0 +1,194 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// The floating point formats scale the value by a power of ten and round it
+// to an integer, which is then written with integer arithmetic. Powers of ten
+// up to 1e22 are exact doubles, so the scaling is off by less than an ulp,
+// and fma() gives that error exactly. The error can only change the rounding
+// when the scaled value lands exactly halfway, so fma() is only called then
+// and the result always matches printf's rounding of the exact value, ties to
+// even.
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "format.h"
+
+#define FORMAT_MAX_EXACT_POWER 22
+#define FORMAT_UNSIGNED_DIGITS 10 // Digits in the largest uint32_t.
+#define FORMAT_FIXED_LIMIT 2147483648.0 // 2^31, so rounding up still fits.
+#define FORMAT_EXPONENT_DIGITS 2
+#define FORMAT_RADIX 10
+#define FORMAT_HALF 0.5
+#define FORMAT_LOG10_2 0.30102999566398120
+
+static const double format_powersOfTen[FORMAT_MAX_EXACT_POWER + 1] = {
+    1e0,  1e1,  1e2,  1e3,  1e4,  1e5,  1e6,  1e7,  1e8,  1e9,  1e10, 1e11,
+    1e12, 1e13, 1e14, 1e15, 1e16, 1e17, 1e18, 1e19, 1e20, 1e21, 1e22};
+
+// Copies length characters of text into buffer, truncated to fit, and
+// terminates it. Returns the length copied.
+static uint16_t format_copy(char *buffer, uint16_t size, const char *text,
+                            uint16_t length) {
+  if (size == 0)
+    return 0;
+  if (length > size - 1)
+    length = size - 1;
+  memcpy(buffer, text, length);
+  buffer[length] = '\0';
+  return length;
+}
+
+// Writes at least minDigits digits of value to text, zero-padded. Returns the
+// number written.
+static uint16_t format_digits(char *text, uint32_t value, uint16_t minDigits) {
+  char reversed[FORMAT_UNSIGNED_DIGITS];
+  uint16_t count = 0;
+  do {
+    reversed[count++] = '0' + value % FORMAT_RADIX;
+    value /= FORMAT_RADIX;
+  } while (value > 0);
+  while (count < minDigits)
+    reversed[count++] = '0';
+  for (uint16_t i = 0; i < count; i++)
+    text[i] = reversed[count - 1 - i];
+  return count;
+}
+
+// Returns the length snprintf() left in a buffer of size bytes, given what it
+// returned.
+static uint16_t format_snprintfLength(int length, uint16_t size) {
+  if (length < 0 || size == 0)
+    return 0;
+  return (length < size) ? length : size - 1;
+}
+
+// Returns value * 10^power, off by less than an ulp. power is at most
+// FORMAT_MAX_EXACT_POWER either way.
+static double format_scale(double value, int16_t power) {
+  return (power >= 0) ? value * format_powersOfTen[power]
+                      : value / format_powersOfTen[-power];
+}
+
+// Returns value * 10^power rounded to an integer as printf would round the
+// exact product, ties to even. power is at most FORMAT_MAX_EXACT_POWER either
+// way.
+static double format_scaleAndRound(double value, int16_t power) {
+  double scaled = format_scale(value, power);
+  double rounded = rint(scaled);
+  if (fabs(rounded - scaled) != FORMAT_HALF)
+    return rounded;
+  // Halfway, so the sign of the scaling error decides. Both residuals are
+  // exact; value - scaled * scale has the sign of the quotient's error.
+  double error = (power >= 0)
+                     ? fma(value, format_powersOfTen[power], -scaled)
+                     : fma(-scaled, format_powersOfTen[-power], value);
+  if (error == 0.0)
+    return rounded;
+  return (error > 0.0) ? ceil(scaled) : floor(scaled);
+}
+
+// "%u".
+uint16_t format_unsigned(char *buffer, uint16_t size, uint32_t value) {
+  char text[FORMAT_UNSIGNED_DIGITS];
+  return format_copy(buffer, size, text, format_digits(text, value, 1));
+}
+
+// "%d".
+uint16_t format_int(char *buffer, uint16_t size, int32_t value) {
+  char text[FORMAT_UNSIGNED_DIGITS + 1];
+  uint16_t length = 0;
+  uint32_t magnitude = value;
+  if (value < 0) {
+    text[length++] = '-';
+    magnitude = -magnitude;
+  }
+  length += format_digits(&text[length], magnitude, 1);
+  return format_copy(buffer, size, text, length);
+}
+
+// "%.<decimals>f", for example "%.2f". Values of 2^31 and over, infinities
+// and NaN are passed to snprintf().
+uint16_t format_fixed(char *buffer, uint16_t size, double value,
+                      uint8_t decimals) {
+  if (decimals > FORMAT_MAX_DECIMALS)
+    decimals = FORMAT_MAX_DECIMALS;
+  double magnitude = fabs(value);
+  if (!(magnitude < FORMAT_FIXED_LIMIT))
+    return format_snprintfLength(
+        snprintf(buffer, size, "%.*f", decimals, value), size);
+  // The whole part and the fraction left over are exact, so only the
+  // fraction needs scaling. With no decimals, a tie goes to the even whole.
+  double whole = (decimals == 0) ? rint(magnitude) : floor(magnitude);
+  uint32_t integer = whole;
+  uint32_t fraction =
+      (decimals == 0) ? 0 : format_scaleAndRound(magnitude - whole, decimals);
+  if (fraction == format_powersOfTen[decimals]) { // Rounded up to a whole.
+    fraction = 0;
+    integer++;
+  }
+  char text[FORMAT_BUFFER_SIZE];
+  uint16_t length = 0;
+  if (signbit(value))
+    text[length++] = '-';
+  length += format_digits(&text[length], integer, 1);
+  if (decimals > 0) {
+    text[length++] = '.';
+    length += format_digits(&text[length], fraction, decimals);
+  }
+  return format_copy(buffer, size, text, length);
+}
+
+// "%.0e" with the 'e' left out, as the histogram labels use it: 2.4e3 gives
+// "2+03". Exponents past about +/-21, infinities and NaN are passed to
+// snprintf().
+uint16_t format_compactExponent(char *buffer, uint16_t size, double value) {
+  char text[FORMAT_BUFFER_SIZE];
+  uint16_t length = 0;
+  double magnitude = fabs(value);
+  int16_t exponent = 0;
+  uint32_t digit = 0;
+  if (magnitude != 0.0) {
+    // magnitude is in [2^(b-1), 2^b), so this is the decimal exponent or one
+    // less. It saves calling log10().
+    int binaryExponent;
+    frexp(magnitude, &binaryExponent);
+    double estimate = floor((binaryExponent - 1) * FORMAT_LOG10_2);
+    if (!isfinite(magnitude) || !(fabs(estimate) < FORMAT_MAX_EXACT_POWER)) {
+      snprintf(text, sizeof(text), "%.0e", value);
+      for (const char *c = text; *c; c++)
+        if (*c != 'e')
+          text[length++] = *c;
+      return format_copy(buffer, size, text, length);
+    }
+    // Where the scaled value is off next to a power of ten, it rounds to the
+    // same digit either way.
+    exponent = estimate;
+    double scaled = format_scale(magnitude, -exponent);
+    if (scaled < 1.0)
+      exponent--;
+    else if (scaled >= FORMAT_RADIX)
+      exponent++;
+    digit = format_scaleAndRound(magnitude, -exponent);
+    if (digit == FORMAT_RADIX) { // Rounded up to the next power of ten.
+      digit = 1;
+      exponent++;
+    }
+  }
+  if (signbit(value))
+    text[length++] = '-';
+  text[length++] = '0' + digit;
+  text[length++] = (exponent < 0) ? '-' : '+';
+  length += format_digits(&text[length], (exponent < 0) ? -exponent : exponent,
+                          FORMAT_EXPONENT_DIGITS);
+  return format_copy(buffer, size, text, length);
+}
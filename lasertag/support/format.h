@@ -0,0 +1,44 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Number formatting for the TFT labels and statistics, without printf. Each
+// function writes a NUL-terminated string into the caller's buffer of size
+// bytes, truncating if it does not fit, and returns the length written. The
+// output is what snprintf() gives for the format named with each function.
+// Nothing is allocated, the stack use is a few dozen bytes, and the floating
+// point formats cost a handful of multiplies.
+
+#ifndef FORMAT_H_
+#define FORMAT_H_
+
+#include <stdint.h>
+
+// Decimals format_fixed() takes.
+#define FORMAT_MAX_DECIMALS 9
+
+// Long enough for anything these functions write.
+#define FORMAT_BUFFER_SIZE 32
+
+// "%u".
+uint16_t format_unsigned(char *buffer, uint16_t size, uint32_t value);
+
+// "%d".
+uint16_t format_int(char *buffer, uint16_t size, int32_t value);
+
+// "%.<decimals>f", for example "%.2f". Values of 2^31 and over, infinities
+// and NaN are passed to snprintf().
+uint16_t format_fixed(char *buffer, uint16_t size, double value,
+                      uint8_t decimals);
+
+// "%.0e" with the 'e' left out, as the histogram labels use it: 2.4e3 gives
+// "2+03". Exponents past about +/-21, infinities and NaN are passed to
+// snprintf().
+uint16_t format_compactExponent(char *buffer, uint16_t size, double value);
+
+#endif /* FORMAT_H_ */
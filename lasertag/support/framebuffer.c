@@ -0,0 +1,411 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "display.h"
+#include "displayFont.h"
+#include "framebuffer.h"
+
+// Merging two dirty rectangles is worth sending this many unchanged pixels,
+// about what the TFT spends setting up one more transfer.
+#define FRAMEBUFFER_MERGE_SLACK_PIXELS 32
+#define FRAMEBUFFER_DEFAULT_TEXT_COLOR DISPLAY_WHITE
+#define FRAMEBUFFER_PPM_MAX_VALUE 255
+#define FRAMEBUFFER_RED_SHIFT 11
+#define FRAMEBUFFER_GREEN_SHIFT 5
+#define FRAMEBUFFER_FIVE_BIT_MASK 0x1F
+#define FRAMEBUFFER_SIX_BIT_MASK 0x3F
+
+static display_pixel_t framebuffer_pixels[FRAMEBUFFER_HEIGHT]
+                                         [FRAMEBUFFER_WIDTH];
+// What the TFT shows, as of the last flush. Not known until the first flush
+// after framebuffer_init(), which sends everything.
+static display_pixel_t framebuffer_shownPixels[FRAMEBUFFER_HEIGHT]
+                                              [FRAMEBUFFER_WIDTH];
+static bool framebuffer_shownKnown;
+static framebuffer_rect_t framebuffer_dirtyRects[FRAMEBUFFER_MAX_DIRTY_RECTS];
+static uint16_t framebuffer_dirtyRectCount;
+// Bounds of the pixels changed by the primitive being drawn. Empty when
+// maxX < minX.
+static int16_t framebuffer_changeMinX, framebuffer_changeMaxX;
+static int16_t framebuffer_changeMinY, framebuffer_changeMaxY;
+static framebuffer_stats_t framebuffer_stats;
+
+static int16_t framebuffer_cursorX, framebuffer_cursorY;
+static uint16_t framebuffer_textColor, framebuffer_textBgColor;
+static uint8_t framebuffer_textSize;
+static bool framebuffer_textWrap;
+
+static int32_t framebuffer_rectArea(const framebuffer_rect_t *r) {
+  return (int32_t)r->w * r->h;
+}
+
+// Returns the smallest rectangle holding both a and b.
+static framebuffer_rect_t framebuffer_rectUnion(const framebuffer_rect_t *a,
+                                                const framebuffer_rect_t *b) {
+  int16_t left = a->x < b->x ? a->x : b->x;
+  int16_t top = a->y < b->y ? a->y : b->y;
+  int16_t right = (a->x + a->w > b->x + b->w) ? a->x + a->w : b->x + b->w;
+  int16_t bottom = (a->y + a->h > b->y + b->h) ? a->y + a->h : b->y + b->h;
+  return (framebuffer_rect_t){left, top, right - left, bottom - top};
+}
+
+// Pixels a merge of a and b would send that neither needs. Negative when they
+// overlap.
+static int32_t framebuffer_mergeWaste(const framebuffer_rect_t *a,
+                                      const framebuffer_rect_t *b) {
+  framebuffer_rect_t merged = framebuffer_rectUnion(a, b);
+  return framebuffer_rectArea(&merged) - framebuffer_rectArea(a) -
+         framebuffer_rectArea(b);
+}
+
+// Adds r to the dirty rectangles, merging it with any it overlaps, touches or
+// nearly touches. When the list is full, r is merged with the rectangle that
+// wastes the least.
+static void framebuffer_addDirtyRect(framebuffer_rect_t r) {
+  for (;;) {
+    int16_t best = -1;
+    int32_t bestWaste = FRAMEBUFFER_MERGE_SLACK_PIXELS;
+    for (uint16_t i = 0; i < framebuffer_dirtyRectCount; i++) {
+      int32_t waste = framebuffer_mergeWaste(&r, &framebuffer_dirtyRects[i]);
+      if (waste <= bestWaste ||
+          (best < 0 &&
+           framebuffer_dirtyRectCount == FRAMEBUFFER_MAX_DIRTY_RECTS)) {
+        best = i;
+        bestWaste = waste;
+      }
+    }
+    if (best < 0)
+      break;
+    // Take the merged rectangle out and try again with the union, which may
+    // now reach others.
+    r = framebuffer_rectUnion(&r, &framebuffer_dirtyRects[best]);
+    framebuffer_dirtyRects[best] =
+        framebuffer_dirtyRects[--framebuffer_dirtyRectCount];
+  }
+  framebuffer_dirtyRects[framebuffer_dirtyRectCount++] = r;
+}
+
+static void framebuffer_beginChange() {
+  framebuffer_changeMinX = FRAMEBUFFER_WIDTH;
+  framebuffer_changeMaxX = -1;
+  framebuffer_changeMinY = FRAMEBUFFER_HEIGHT;
+  framebuffer_changeMaxY = -1;
+}
+
+static void framebuffer_endChange() {
+  if (framebuffer_changeMaxX < framebuffer_changeMinX)
+    return;
+  framebuffer_addDirtyRect((framebuffer_rect_t){
+      framebuffer_changeMinX, framebuffer_changeMinY,
+      framebuffer_changeMaxX - framebuffer_changeMinX + 1,
+      framebuffer_changeMaxY - framebuffer_changeMinY + 1});
+}
+
+// Fills the part of the rectangle on the screen, noting the bounds of the
+// pixels that change.
+static void framebuffer_fillClipped(int16_t x, int16_t y, int16_t w, int16_t h,
+                                    uint16_t color) {
+  int16_t left = x < 0 ? 0 : x;
+  int16_t top = y < 0 ? 0 : y;
+  int32_t right = (int32_t)x + w; // One past the end.
+  int32_t bottom = (int32_t)y + h;
+  if (right > FRAMEBUFFER_WIDTH)
+    right = FRAMEBUFFER_WIDTH;
+  if (bottom > FRAMEBUFFER_HEIGHT)
+    bottom = FRAMEBUFFER_HEIGHT;
+  for (int16_t row = top; row < bottom; row++) {
+    display_pixel_t *pixels = framebuffer_pixels[row];
+    int16_t first = -1, last = -1;
+    for (int16_t column = left; column < right; column++) {
+      if (pixels[column] == color)
+        continue;
+      pixels[column] = color;
+      if (first < 0)
+        first = column;
+      last = column;
+      framebuffer_stats.pixelsChanged++;
+    }
+    if (first < 0)
+      continue;
+    if (first < framebuffer_changeMinX)
+      framebuffer_changeMinX = first;
+    if (last > framebuffer_changeMaxX)
+      framebuffer_changeMaxX = last;
+    if (row < framebuffer_changeMinY)
+      framebuffer_changeMinY = row;
+    if (row > framebuffer_changeMaxY)
+      framebuffer_changeMaxY = row;
+  }
+}
+
+// Sets the whole copy to color and marks it all dirty, so the first flush
+// paints the TFT to match. Clears the statistics. Call after display_init().
+void framebuffer_init(uint16_t color) {
+  for (int16_t row = 0; row < FRAMEBUFFER_HEIGHT; row++)
+    for (int16_t column = 0; column < FRAMEBUFFER_WIDTH; column++)
+      framebuffer_pixels[row][column] = color;
+  framebuffer_shownKnown = false;
+  framebuffer_dirtyRects[0] =
+      (framebuffer_rect_t){0, 0, FRAMEBUFFER_WIDTH, FRAMEBUFFER_HEIGHT};
+  framebuffer_dirtyRectCount = 1;
+  memset(&framebuffer_stats, 0, sizeof(framebuffer_stats));
+  framebuffer_cursorX = framebuffer_cursorY = 0;
+  framebuffer_textColor = framebuffer_textBgColor =
+      FRAMEBUFFER_DEFAULT_TEXT_COLOR;
+  framebuffer_textSize = 1;
+  framebuffer_textWrap = true;
+}
+
+void framebuffer_drawPixel(int16_t x, int16_t y, uint16_t color) {
+  framebuffer_fillRect(x, y, 1, 1, color);
+}
+
+void framebuffer_drawFastHLine(int16_t x, int16_t y, int16_t w,
+                               uint16_t color) {
+  framebuffer_fillRect(x, y, w, 1, color);
+}
+
+void framebuffer_drawFastVLine(int16_t x, int16_t y, int16_t h,
+                               uint16_t color) {
+  framebuffer_fillRect(x, y, 1, h, color);
+}
+
+// Each side is its own change, so the inside is not marked dirty.
+void framebuffer_drawRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                          uint16_t color) {
+  framebuffer_drawFastHLine(x, y, w, color);
+  framebuffer_drawFastHLine(x, y + h - 1, w, color);
+  framebuffer_drawFastVLine(x, y, h, color);
+  framebuffer_drawFastVLine(x + w - 1, y, h, color);
+}
+
+void framebuffer_fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                          uint16_t color) {
+  framebuffer_beginChange();
+  framebuffer_fillClipped(x, y, w, h, color);
+  framebuffer_endChange();
+}
+
+void framebuffer_fillScreen(uint16_t color) {
+  framebuffer_fillRect(0, 0, FRAMEBUFFER_WIDTH, FRAMEBUFFER_HEIGHT, color);
+}
+
+// As with display_drawChar(), bg == color leaves the background untouched.
+void framebuffer_drawChar(int16_t x, int16_t y, unsigned char c,
+                          uint16_t color, uint16_t bg, uint8_t size) {
+  const uint8_t *glyph = displayFont_getGlyph(c);
+  framebuffer_beginChange();
+  for (int16_t i = 0; i < DISPLAY_CHAR_WIDTH; i++) {
+    // The last column is the gap between characters.
+    uint8_t line = (i < DISPLAY_FONT_GLYPH_COLUMNS) ? glyph[i] : 0;
+    for (int16_t j = 0; j < DISPLAY_CHAR_HEIGHT; j++, line >>= 1) {
+      if (line & 1)
+        framebuffer_fillClipped(x + i * size, y + j * size, size, size, color);
+      else if (bg != color)
+        framebuffer_fillClipped(x + i * size, y + j * size, size, size, bg);
+    }
+  }
+  framebuffer_endChange();
+}
+
+void framebuffer_setCursor(int16_t x, int16_t y) {
+  framebuffer_cursorX = x;
+  framebuffer_cursorY = y;
+}
+
+void framebuffer_setTextColor(uint16_t c) {
+  framebuffer_textColor = framebuffer_textBgColor = c;
+}
+
+void framebuffer_setTextColorBg(uint16_t c, uint16_t bg) {
+  framebuffer_textColor = c;
+  framebuffer_textBgColor = bg;
+}
+
+void framebuffer_setTextSize(uint8_t s) { framebuffer_textSize = s ? s : 1; }
+
+void framebuffer_setTextWrap(bool w) { framebuffer_textWrap = w; }
+
+// Draws c at the cursor and moves the cursor on, the way the TFT driver
+// does: wrapping once the next character would not fit.
+static void framebuffer_writeChar(char c) {
+  if (c == '\n') {
+    framebuffer_cursorY += framebuffer_textSize * DISPLAY_CHAR_HEIGHT;
+    framebuffer_cursorX = 0;
+  } else if (c != '\r') {
+    framebuffer_drawChar(framebuffer_cursorX, framebuffer_cursorY, c,
+                         framebuffer_textColor, framebuffer_textBgColor,
+                         framebuffer_textSize);
+    framebuffer_cursorX += framebuffer_textSize * DISPLAY_CHAR_WIDTH;
+    if (framebuffer_textWrap &&
+        framebuffer_cursorX >
+            FRAMEBUFFER_WIDTH - framebuffer_textSize * DISPLAY_CHAR_WIDTH) {
+      framebuffer_cursorY += framebuffer_textSize * DISPLAY_CHAR_HEIGHT;
+      framebuffer_cursorX = 0;
+    }
+  }
+}
+
+size_t framebuffer_print(const char str[]) {
+  size_t count = 0;
+  for (; str[count]; count++)
+    framebuffer_writeChar(str[count]);
+  return count;
+}
+
+size_t framebuffer_println(const char str[]) {
+  size_t count = framebuffer_print(str);
+  framebuffer_writeChar('\n');
+  return count + 1;
+}
+
+// Returns the pixel at (x, y), or black outside the screen.
+uint16_t framebuffer_getPixel(int16_t x, int16_t y) {
+  if (x < 0 || y < 0 || x >= FRAMEBUFFER_WIDTH || y >= FRAMEBUFFER_HEIGHT)
+    return DISPLAY_BLACK;
+  return framebuffer_pixels[y][x];
+}
+
+// Returns the rows of the copy, FRAMEBUFFER_WIDTH pixels each.
+const display_pixel_t *framebuffer_getPixels() {
+  return &framebuffer_pixels[0][0];
+}
+
+// Returns true if anything has changed since the last flush.
+bool framebuffer_isDirty() { return framebuffer_dirtyRectCount > 0; }
+
+// Sends rows of one color, stacked, as one transfer.
+static void framebuffer_sendBlock(int16_t x, int16_t y, int16_t w, int16_t h,
+                                  uint16_t color) {
+  if (h == 0)
+    return;
+  display_fillRect(x, y, w, h, color);
+  framebuffer_stats.transfers++;
+  framebuffer_stats.pixelsSent += (uint32_t)w * h;
+}
+
+// Returns true if the TFT does not already show the run of color from start
+// up to end on row, and records that it will once the run is sent.
+static bool framebuffer_runNeedsSending(int16_t row, int16_t start,
+                                        int16_t end, uint16_t color) {
+  bool differs = !framebuffer_shownKnown;
+  display_pixel_t *shown = framebuffer_shownPixels[row];
+  for (int16_t column = start; column < end; column++) {
+    differs |= (shown[column] != color);
+    shown[column] = color;
+  }
+  return differs;
+}
+
+// Sends one dirty rectangle a row at a time, as the runs of one color that
+// differ from what the TFT shows. Consecutive rows that are each a single run
+// of the same color are held back and sent as one block.
+static void framebuffer_sendRect(const framebuffer_rect_t *r) {
+  int16_t blockTop = r->y, blockRows = 0;
+  uint16_t blockColor = 0;
+  int16_t right = r->x + r->w;
+  for (int16_t row = r->y; row < r->y + r->h; row++) {
+    const display_pixel_t *pixels = framebuffer_pixels[row];
+    int16_t runEnd = r->x + 1;
+    while (runEnd < right && pixels[runEnd] == pixels[r->x])
+      runEnd++;
+    if (runEnd == right) {
+      bool differs =
+          framebuffer_runNeedsSending(row, r->x, right, pixels[r->x]);
+      if (differs && blockRows > 0 && pixels[r->x] == blockColor) {
+        blockRows++;
+        continue;
+      }
+      framebuffer_sendBlock(r->x, blockTop, r->w, blockRows, blockColor);
+      blockTop = row;
+      blockRows = differs ? 1 : 0;
+      blockColor = pixels[r->x];
+      continue;
+    }
+    framebuffer_sendBlock(r->x, blockTop, r->w, blockRows, blockColor);
+    blockRows = 0;
+    for (int16_t runStart = r->x; runStart < right; runStart = runEnd) {
+      for (runEnd = runStart + 1;
+           runEnd < right && pixels[runEnd] == pixels[runStart]; runEnd++)
+        ;
+      if (!framebuffer_runNeedsSending(row, runStart, runEnd,
+                                       pixels[runStart]))
+        continue;
+      display_drawFastHLine(runStart, row, runEnd - runStart, pixels[runStart]);
+      framebuffer_stats.transfers++;
+      framebuffer_stats.pixelsSent += runEnd - runStart;
+    }
+  }
+  framebuffer_sendBlock(r->x, blockTop, r->w, blockRows, blockColor);
+}
+
+// Sends the changed areas to the TFT and clears them. Each row of a dirty
+// rectangle goes as one display_drawFastHLine() per run of one color, and
+// rows that are a single run of the same color are sent together as one
+// display_fillRect().
+void framebuffer_flush() {
+  if (framebuffer_dirtyRectCount == 0)
+    return;
+  for (uint16_t i = 0; i < framebuffer_dirtyRectCount; i++)
+    framebuffer_sendRect(&framebuffer_dirtyRects[i]);
+  framebuffer_stats.rects += framebuffer_dirtyRectCount;
+  framebuffer_stats.flushes++;
+  framebuffer_dirtyRectCount = 0;
+  framebuffer_shownKnown = true;
+}
+
+// Forgets the changed areas without sending them, for when the TFT already
+// matches.
+void framebuffer_discardChanges() {
+  for (uint16_t i = 0; i < framebuffer_dirtyRectCount; i++) {
+    const framebuffer_rect_t *r = &framebuffer_dirtyRects[i];
+    for (int16_t row = r->y; row < r->y + r->h; row++)
+      memcpy(&framebuffer_shownPixels[row][r->x],
+             &framebuffer_pixels[row][r->x], r->w * sizeof(display_pixel_t));
+  }
+  framebuffer_dirtyRectCount = 0;
+  framebuffer_shownKnown = true;
+}
+
+// Writes the copy to fileName as a binary PPM (P6) image. Returns false if
+// the file cannot be written.
+bool framebuffer_writePpm(const char *fileName) {
+  FILE *out = fopen(fileName, "wb");
+  if (!out)
+    return false;
+  fprintf(out, "P6\n%d %d\n%d\n", FRAMEBUFFER_WIDTH, FRAMEBUFFER_HEIGHT,
+          FRAMEBUFFER_PPM_MAX_VALUE);
+  for (int16_t row = 0; row < FRAMEBUFFER_HEIGHT; row++) {
+    uint8_t rgb[FRAMEBUFFER_WIDTH * 3];
+    for (int16_t column = 0; column < FRAMEBUFFER_WIDTH; column++) {
+      display_pixel_t pixel = framebuffer_pixels[row][column];
+      uint8_t red =
+          (pixel >> FRAMEBUFFER_RED_SHIFT) & FRAMEBUFFER_FIVE_BIT_MASK;
+      uint8_t green =
+          (pixel >> FRAMEBUFFER_GREEN_SHIFT) & FRAMEBUFFER_SIX_BIT_MASK;
+      uint8_t blue = pixel & FRAMEBUFFER_FIVE_BIT_MASK;
+      // Widen to 8 bits by repeating the top bits, so full scale stays 255.
+      rgb[column * 3] = (red << 3) | (red >> 2);
+      rgb[column * 3 + 1] = (green << 2) | (green >> 4);
+      rgb[column * 3 + 2] = (blue << 3) | (blue >> 2);
+    }
+    fwrite(rgb, 1, sizeof(rgb), out);
+  }
+  return fclose(out) == 0;
+}
+
+// Returns the statistics since framebuffer_init().
+const framebuffer_stats_t *framebuffer_getStats() {
+  return &framebuffer_stats;
+}
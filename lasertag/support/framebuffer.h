@@ -0,0 +1,106 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// An off-screen copy of the TFT in RAM. Drawing goes into the copy, which
+// records the areas whose pixels actually changed; framebuffer_flush() then
+// sends just those areas to the TFT. A frame's worth of drawing that erases
+// and redraws overlapping shapes reaches the TFT as a few transfers of the
+// difference, instead of as every primitive. The drawing calls take the same
+// arguments as their display_ counterparts and draw the same pixels.
+//
+// The copy is 320x240 RGB565, 150 kB, and a second copy of what the TFT
+// shows, to find what changed, takes another 150 kB. That 300 kB of BSS is in
+// lasertag.elf whenever histogram.c is, even while
+// histogram_setFramebufferEnabled() is off. Pixels are only written through
+// the display_ calls, so the TFT must not be drawn on directly while the
+// framebuffer is in use, or the two will disagree.
+
+#ifndef FRAMEBUFFER_H_
+#define FRAMEBUFFER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "display.h"
+
+#define FRAMEBUFFER_WIDTH DISPLAY_WIDTH
+#define FRAMEBUFFER_HEIGHT DISPLAY_HEIGHT
+
+// Changed areas are kept as at most this many rectangles. Past that, the two
+// that waste the fewest pixels together are merged.
+#define FRAMEBUFFER_MAX_DIRTY_RECTS 16
+
+typedef struct {
+  int16_t x;
+  int16_t y;
+  int16_t w;
+  int16_t h;
+} framebuffer_rect_t;
+
+typedef struct {
+  uint32_t flushes;       // framebuffer_flush() calls that sent anything.
+  uint32_t rects;         // Dirty rectangles sent.
+  uint32_t transfers;     // display_ calls made to send them.
+  uint32_t pixelsSent;    // Pixels those calls wrote.
+  uint32_t pixelsChanged; // Pixel writes that changed a pixel.
+} framebuffer_stats_t;
+
+// Sets the whole copy to color and marks it all dirty, so the first flush
+// paints the TFT to match. Clears the statistics. Call after display_init().
+void framebuffer_init(uint16_t color);
+
+// Drawing, as the display_ calls of the same name.
+void framebuffer_drawPixel(int16_t x, int16_t y, uint16_t color);
+void framebuffer_drawFastHLine(int16_t x, int16_t y, int16_t w,
+                               uint16_t color);
+void framebuffer_drawFastVLine(int16_t x, int16_t y, int16_t h,
+                               uint16_t color);
+void framebuffer_drawRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                          uint16_t color);
+void framebuffer_fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                          uint16_t color);
+void framebuffer_fillScreen(uint16_t color);
+// As with display_drawChar(), bg == color leaves the background untouched.
+void framebuffer_drawChar(int16_t x, int16_t y, unsigned char c,
+                          uint16_t color, uint16_t bg, uint8_t size);
+void framebuffer_setCursor(int16_t x, int16_t y);
+void framebuffer_setTextColor(uint16_t c);
+void framebuffer_setTextColorBg(uint16_t c, uint16_t bg);
+void framebuffer_setTextSize(uint8_t s);
+void framebuffer_setTextWrap(bool w);
+size_t framebuffer_print(const char str[]);
+size_t framebuffer_println(const char str[]);
+
+// Returns the pixel at (x, y), or black outside the screen.
+uint16_t framebuffer_getPixel(int16_t x, int16_t y);
+
+// Returns the rows of the copy, FRAMEBUFFER_WIDTH pixels each.
+const display_pixel_t *framebuffer_getPixels();
+
+// Returns true if anything has changed since the last flush.
+bool framebuffer_isDirty();
+
+// Sends the changed areas to the TFT and clears them. Each row of a dirty
+// rectangle goes as one display_drawFastHLine() per run of one color, and
+// rows that are a single run of the same color are sent together as one
+// display_fillRect().
+void framebuffer_flush();
+
+// Forgets the changed areas without sending them, for when the TFT already
+// matches.
+void framebuffer_discardChanges();
+
+// Writes the copy to fileName as a binary PPM (P6) image. Returns false if
+// the file cannot be written.
+bool framebuffer_writePpm(const char *fileName);
+
+// Returns the statistics since framebuffer_init().
+const framebuffer_stats_t *framebuffer_getStats();
+
+#endif /* FRAMEBUFFER_H_ */
@@ -14,10 +14,16 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 
 #include "display.h"
 #include "filter.h"
+#include "format.h"
+#include "framebuffer.h"
 #include "histogram.h"
+#include "textRenderer.h"
 #include "utils.h"
 
 #define TOP_LABEL_TEXT_SIZE 1
+// What histogram_updateDisplayStep() charges for drawing a top label, in rows
+// of a bar: the label and the row under it.
+#define HISTOGRAM_LABEL_ROWS (DISPLAY_CHAR_HEIGHT + 1)
 #define HISTOGRAM_DEFAULT_BAR_COUNT 10
 static uint16_t histogram_barCount = HISTOGRAM_DEFAULT_BAR_COUNT;
 static uint16_t
@@ -26,17 +32,21 @@ static uint16_t topLabelMaxWidthInChars; // How many chars will be printed.
 static histogram_data_t
     currentBarData[HISTOGRAM_MAX_BAR_COUNT]; // Current histogram data.
 static histogram_data_t
-    previousBarData[HISTOGRAM_MAX_BAR_COUNT]; // Keep the old stuff around so
-                                              // you can erase things properly.
+    previousBarData[HISTOGRAM_MAX_BAR_COUNT]; // The heights on the screen, so
+                                              // only what changed is drawn.
 static char
     topLabel[HISTOGRAM_MAX_BAR_COUNT]
             [HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS]; // Labels at top of
                                                           // histogram bars.
 static char
     oldTopLabel[HISTOGRAM_MAX_BAR_COUNT]
-               [HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS]; // Old label so you
-                                                             // only update as
-                                                             // necessary.
+               [HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS]; // Label on the
+                                                             // screen, empty
+                                                             // for no label.
+// The color each bar was last drawn in, so a color change redraws the bar.
+static uint16_t histogram_drawnBarColors[HISTOGRAM_MAX_BAR_COUNT];
+// The bar histogram_updateDisplayStep() carries on from.
+static uint16_t histogram_nextBar;
 
 #define ONE_HALF(x) ((x) / 2) // Integer divide by 2.
 
@@ -74,21 +84,83 @@ const static char histogram_defaultLabel[HISTOGRAM_MAX_BAR_COUNT]
                                             {"K"}, {"L"}, {"M"}, {"N"}, {"O"}};
 static char histogram_label[HISTOGRAM_MAX_BAR_COUNT]
                            [HISTOGRAM_MAX_BAR_LABEL_WIDTH];
+// Draw into the framebuffer and flush once per update instead of drawing on
+// the TFT directly.
+static bool histogram_useFramebuffer = false;
+
+// Drawing goes through these so that it can go to either the TFT or the
+// framebuffer. Text for the TFT goes through the glyph-run renderer.
+static void histogram_fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                               uint16_t color) {
+  if (histogram_useFramebuffer)
+    framebuffer_fillRect(x, y, w, h, color);
+  else
+    display_fillRect(x, y, w, h, color);
+}
+
+static void histogram_setCursor(int16_t x, int16_t y) {
+  if (histogram_useFramebuffer)
+    framebuffer_setCursor(x, y);
+  else
+    textRenderer_setCursor(x, y);
+}
+
+static void histogram_setTextSize(uint8_t size) {
+  if (histogram_useFramebuffer)
+    framebuffer_setTextSize(size);
+  else
+    textRenderer_setTextSize(size);
+}
+
+static void histogram_setTextColor(uint16_t color) {
+  if (histogram_useFramebuffer)
+    framebuffer_setTextColor(color);
+  else
+    textRenderer_setTextColor(color);
+}
+
+static void histogram_print(const char str[]) {
+  if (histogram_useFramebuffer)
+    framebuffer_print(str);
+  else
+    textRenderer_print(str);
+}
+
+static void histogram_drawChar(int16_t x, int16_t y, unsigned char c,
+                               uint16_t color, uint16_t bg, uint8_t size) {
+  if (histogram_useFramebuffer)
+    framebuffer_drawChar(x, y, c, color, bg, size);
+  else
+    textRenderer_drawChar(x, y, c, color, bg, size);
+}
+
+// Sends what has changed to the TFT. Drawing on the TFT directly needs
+// nothing more.
+static void histogram_flush() {
+  if (histogram_useFramebuffer)
+    framebuffer_flush();
+}
+
+// Draws the histogram into the framebuffer when enabled. Call before
+// histogram_init().
+void histogram_setFramebufferEnabled(bool enabled) {
+  histogram_useFramebuffer = enabled;
+}
 
 // The bottom labels are drawn at the bottom of the bar and are static.
 void histogram_drawBottomLabels() {
   uint16_t labelOffset =
       ONE_HALF(histogram_barWidth -
                (DISPLAY_CHAR_WIDTH *
-                HISTOGRAM_BOTTOM_LABEL_TEXT_SIZE));      // Center the label.
-  display_setTextSize(HISTOGRAM_BOTTOM_LABEL_TEXT_SIZE); // Set the text-size.
-  for (int i = 0; i < histogram_barCount; i++) {         //
-    display_setCursor(
+                HISTOGRAM_BOTTOM_LABEL_TEXT_SIZE));        // Center the label.
+  histogram_setTextSize(HISTOGRAM_BOTTOM_LABEL_TEXT_SIZE); // Set the text-size.
+  for (int i = 0; i < histogram_barCount; i++) {           //
+    histogram_setCursor(
         i * (histogram_barWidth + HISTOGRAM_BAR_X_GAP) + labelOffset,
         display_height() -
             (DISPLAY_CHAR_HEIGHT * HISTOGRAM_BOTTOM_LABEL_TEXT_SIZE));
-    display_setTextColor(histogram_barColors[i]);
-    display_print(histogram_label[i]);
+    histogram_setTextColor(histogram_barColors[i]);
+    histogram_print(histogram_label[i]);
   }
 }
 
@@ -120,25 +192,33 @@ void histogram_init(uint16_t barCount) {
     topLabel[i][0] = 0;    // Start out with empty strings.
     oldTopLabel[i][0] = 0; // Start out with empty strings.
   }
+  histogram_nextBar = 0;
   for (int i = 0; i < HISTOGRAM_MAX_BAR_COUNT; i++) {
     strncpy(histogram_label[i], histogram_defaultLabel[i],
             HISTOGRAM_MAX_BAR_LABEL_WIDTH);
     histogram_barColors[i] = histogram_defaultBarColors[i];
+    histogram_drawnBarColors[i] = histogram_defaultBarColors[i];
     histogram_barTopLabelColors[i] = histogram_defaultBarTopLabelColors[i];
   }
-  display_fillScreen(DISPLAY_BLACK);
+  if (histogram_useFramebuffer)
+    framebuffer_init(DISPLAY_BLACK);
+  else
+    display_fillScreen(DISPLAY_BLACK);
+  textRenderer_init();
   histogram_drawBottomLabels();
+  histogram_flush();
   initFlag = true;
 }
 
 // Simply erases all of the pixels in the label area under the histogram bars
 // and redraws the labels.
 void histogram_redrawBottomLabels() {
-  display_fillRect(0,
-                   display_height() -
-                       (DISPLAY_CHAR_HEIGHT * HISTOGRAM_BOTTOM_LABEL_TEXT_SIZE),
-                   display_width(), display_height(), DISPLAY_BLACK);
+  histogram_fillRect(0,
+                     display_height() - (DISPLAY_CHAR_HEIGHT *
+                                         HISTOGRAM_BOTTOM_LABEL_TEXT_SIZE),
+                     display_width(), display_height(), DISPLAY_BLACK);
   histogram_drawBottomLabels();
+  histogram_flush();
 }
 
 // This function only updates the data for the histogram.
@@ -167,26 +247,14 @@ bool histogram_setBarData(histogram_index_t barIndex, histogram_data_t data,
            data, HISTOGRAM_MAX_BAR_DATA_IN_PIXELS - 1, barIndex);
     return false;
   }
-  // If it has changed, update the data in the array but don't render anything
-  // on the display.
-  if (data !=
-      currentBarData[barIndex]) { // Only modify the data if it has changed.
-    previousBarData[barIndex] =
-        currentBarData[barIndex]; // Save the old data so you render things
-                                  // properly.
-    // Copy the old string so that you can render things properly.
-    currentBarData[barIndex] = data; // Store the data because it changed.
-  }
-  // If the label has changed, move the previous data to old, new data to
-  // current. Labels are handled separately from data because the label may
-  // change even if the underlying bar data does not. This allows the top label
-  // to change and to be redrawn even if the bars stay the same height.
+  // Only store the data; histogram_updateDisplay() works out what to redraw
+  // by comparing it with what is on the screen.
+  currentBarData[barIndex] = data;
+  // Labels are handled separately from data because the label may change even
+  // if the underlying bar data does not. This allows the top label to change
+  // and to be redrawn even if the bars stay the same height.
   if (strncmp(barTopLabel, topLabel[barIndex],
               HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS)) {
-    // If you get here, the new label is different from the last one.
-    strncpy(oldTopLabel[barIndex], topLabel[barIndex],
-            HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS);
-    // Copy the current label to become the new old label.
     strncpy(topLabel[barIndex], barTopLabel,
             HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS);
     // Copy the new label to become the current label.
@@ -213,76 +281,179 @@ void histogram_drawTopLabel(uint16_t barIndex, histogram_data_t data,
   if (eraseOldLabel) {
     // Erase with a fillRect because the rect is small and should be faster than
     // hitting individual label pixels.
-    display_fillRect(barIndex * (histogram_barWidth + HISTOGRAM_BAR_X_GAP),
-                     display_height() - data - HISTOGRAM_BAR_Y_GAP -
-                         DISPLAY_CHAR_HEIGHT - 1,
-                     histogram_barWidth, DISPLAY_CHAR_HEIGHT, DISPLAY_BLACK);
+    histogram_fillRect(barIndex * (histogram_barWidth + HISTOGRAM_BAR_X_GAP),
+                       display_height() - data - HISTOGRAM_BAR_Y_GAP -
+                           DISPLAY_CHAR_HEIGHT - 1,
+                       histogram_barWidth, DISPLAY_CHAR_HEIGHT, DISPLAY_BLACK);
   }
   uint16_t topLabelXOffset = ONE_HALF(
       histogram_barWidth -
       (strlen(topLabel) *
        DISPLAY_CHAR_WIDTH)); // This helps to center the label over the bar.
-  display_setCursor(
+  histogram_setCursor(
       barIndex * (histogram_barWidth + HISTOGRAM_BAR_X_GAP) +
           topLabelXOffset, // This is the location of the top label.
       display_height() - data - HISTOGRAM_BAR_Y_GAP - DISPLAY_CHAR_HEIGHT - 1);
-  display_setTextSize(TOP_LABEL_TEXT_SIZE); // Use tiny text to pack more
-                                            // characters into the label.
-  display_setTextColor(
+  histogram_setTextSize(TOP_LABEL_TEXT_SIZE); // Use tiny text to pack more
+                                              // characters into the label.
+  histogram_setTextColor(
       histogram_barTopLabelColors[barIndex]); // Set the color of the label.
-  display_print(topLabel);                    // Draw the label.
+  histogram_print(topLabel);                  // Draw the label.
+}
+
+// A bar of height data is drawn data - 1 pixels tall, from
+// histogram_barTop(data) down to just above histogram_barEnd(). Its top label
+// sits on the row above that, with a blank row between them.
+static int16_t histogram_barX(uint16_t barIndex) {
+  return barIndex * (histogram_barWidth + HISTOGRAM_BAR_X_GAP);
+}
+
+static int16_t histogram_barTop(histogram_data_t data) {
+  return display_height() - data - HISTOGRAM_BAR_Y_GAP;
+}
+
+// The row below the bottom of every bar.
+static int16_t histogram_barEnd() {
+  return display_height() - HISTOGRAM_BAR_Y_GAP - 1;
+}
+
+static int16_t histogram_topLabelY(histogram_data_t data) {
+  return histogram_barTop(data) - DISPLAY_CHAR_HEIGHT - 1;
+}
+
+// The first row of the bar, or histogram_barEnd() if it has no pixels.
+static int16_t histogram_barStart(histogram_data_t data) {
+  return (data > 1) ? histogram_barTop(data) : histogram_barEnd();
+}
+
+// Redraws a bar that changed height or color. Only the strip between the old
+// and new tops is drawn: a growing bar gets the strip added in its color and a
+// shrinking one has it erased, along with the old label where the bar no
+// longer covers it. The whole bar is drawn again only if its color changed.
+static void histogram_redrawBar(uint16_t barIndex, histogram_data_t oldData,
+                                histogram_data_t data, const char label[]) {
+  int16_t x = histogram_barX(barIndex);
+  int16_t newStart = histogram_barStart(data);
+  int16_t oldStart = histogram_barStart(oldData);
+  if (histogram_drawnBarColors[barIndex] != histogram_barColors[barIndex])
+    oldStart = histogram_barEnd();
+  if (oldData != 0) {
+    // Everything the old bar and label covered that the new bar does not.
+    int16_t eraseY = histogram_topLabelY(oldData);
+    if (eraseY < newStart)
+      histogram_fillRect(x, eraseY, histogram_barWidth, newStart - eraseY,
+                         DISPLAY_BLACK);
+  }
+  if (newStart < oldStart)
+    histogram_fillRect(x, newStart, histogram_barWidth, oldStart - newStart,
+                       histogram_barColors[barIndex]);
+  if (data != 0) // Only draw the top label if the bar-data != 0.
+    histogram_drawTopLabel(barIndex, data, label, false);
+}
+
+// Redraws the top label of a bar that kept its height. If the label kept its
+// length, only the characters that changed are erased and drawn again.
+static void histogram_redrawTopLabel(uint16_t barIndex, histogram_data_t data,
+                                     const char oldLabel[],
+                                     const char label[]) {
+  uint16_t length = strlen(label);
+  if (strlen(oldLabel) != length) {
+    histogram_drawTopLabel(barIndex, data, label, true);
+    return;
+  }
+  int16_t x = histogram_barX(barIndex) +
+              ONE_HALF(histogram_barWidth - length * DISPLAY_CHAR_WIDTH);
+  int16_t y = histogram_topLabelY(data);
+  uint16_t color = histogram_barTopLabelColors[barIndex];
+  for (uint16_t i = 0; i < length; i++, x += DISPLAY_CHAR_WIDTH) {
+    if (label[i] == oldLabel[i])
+      continue;
+    histogram_fillRect(x, y, DISPLAY_CHAR_WIDTH, DISPLAY_CHAR_HEIGHT,
+                       DISPLAY_BLACK);
+    // A background the same as the color leaves the background alone.
+    histogram_drawChar(x, y, label[i], color, color, TOP_LABEL_TEXT_SIZE);
+  }
+}
+
+// Brings one bar up to date with the data, or moves it part of the way if
+// that takes more than maxRowCount rows of drawing. The label goes with the
+// bar. Returns the rows drawn, counting a label as HISTOGRAM_LABEL_ROWS, or 0
+// if the bar was already up to date.
+static uint16_t histogram_updateBar(uint16_t barIndex, uint16_t maxRowCount) {
+  histogram_data_t oldData = previousBarData[barIndex]; // Height on screen.
+  histogram_data_t data = currentBarData[barIndex]; // Get the current data.
+  uint16_t rowCount;
+  if (histogram_drawnBarColors[barIndex] != histogram_barColors[barIndex]) {
+    rowCount = data + HISTOGRAM_LABEL_ROWS; // The whole bar is redrawn.
+  } else if (oldData != data) {
+    uint16_t maxMove = (maxRowCount > HISTOGRAM_LABEL_ROWS)
+                           ? maxRowCount - HISTOGRAM_LABEL_ROWS
+                           : 1;
+    if (data > oldData + maxMove)
+      data = oldData + maxMove;
+    else if (oldData > data + maxMove)
+      data = oldData - maxMove;
+    rowCount = abs(data - oldData) + HISTOGRAM_LABEL_ROWS;
+  } else {
+    rowCount = HISTOGRAM_LABEL_ROWS;
+  }
+  // A bar of height 0 shows no label.
+  const char *label = (data != 0) ? topLabel[barIndex] : "";
+  if (oldData != data ||
+      histogram_drawnBarColors[barIndex] != histogram_barColors[barIndex])
+    histogram_redrawBar(barIndex, oldData, data, label);
+  else if (strncmp(label, oldTopLabel[barIndex],
+                   HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS))
+    histogram_redrawTopLabel(barIndex, data, oldTopLabel[barIndex], label);
+  else
+    return 0; // Nothing to draw.
+  // The screen now shows this data.
+  previousBarData[barIndex] = data;
+  histogram_drawnBarColors[barIndex] = histogram_barColors[barIndex];
+  strncpy(oldTopLabel[barIndex], label,
+          HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS);
+  return rowCount;
+}
+
+// Draws about maxRowCount rows of changes, carrying on from where the last
+// call stopped. Returns true once every bar is up to date. When drawing into
+// the framebuffer, the flush comes with the last step.
+bool histogram_updateDisplayStep(uint16_t maxRowCount) {
+  if (!initFlag) {
+    printf("Error! histogram_updateDisplayStep(): must call histogram_init() "
+           "before calling this function.\n");
+    return true;
+  }
+  uint16_t rowCount = 0;
+  while (histogram_nextBar < histogram_barCount && rowCount < maxRowCount) {
+    uint16_t rows =
+        histogram_updateBar(histogram_nextBar, maxRowCount - rowCount);
+    if (rows == 0)
+      histogram_nextBar++; // This bar is up to date.
+    rowCount += rows;
+  }
+  if (histogram_nextBar < histogram_barCount)
+    return false;
+  histogram_nextBar = 0;
+  histogram_flush(); // Send the whole update at once.
+  return true;
 }
 
 // This updates the display.
-// It loops across all bars, checking:
-// If the height of the bar has changed, redraw both the bar and the top label.
-// If the height of the bar has not changed, but the top label has changed,
-// update the label.
+// Compares each bar with what was last drawn for it:
+// If the height (or color) of the bar has changed, draw the part of the bar
+// that changed and move the top label.
+// If only the top label has changed, redraw the characters that changed.
+// Everything is drawn in one pass, so set all the bars with
+// histogram_setBarData() first and call this once per frame.
 void histogram_updateDisplay() {
   if (!initFlag) {
     printf("Error! histogram_displayUpdate(): must call histogram_init() "
            "before calling this function.\n");
     return;
   }
-  for (int i = 0; i < histogram_barCount; i++) {
-    histogram_data_t oldData = previousBarData[i]; // Get the previous data.
-    histogram_data_t data = currentBarData[i];     // Get the current bar data.
-    if (oldData !=
-        data) { // If the are not equal, redraw the bar and the top-label.
-      // Erase the old bar and extend the erase rectangle to include the
-      // top-label so that everything is erased at once. Also, redraw the top
-      // label.
-      display_fillRect(i * (histogram_barWidth + HISTOGRAM_BAR_X_GAP),
-                       display_height() - oldData - HISTOGRAM_BAR_Y_GAP -
-                           DISPLAY_CHAR_HEIGHT - 1,
-                       histogram_barWidth, oldData + DISPLAY_CHAR_HEIGHT + 1,
-                       DISPLAY_BLACK);
-      // Draw the new bar.
-      display_fillRect(i * (histogram_barWidth + HISTOGRAM_BAR_X_GAP),
-                       display_height() - data - HISTOGRAM_BAR_Y_GAP,
-                       histogram_barWidth, data - 1, histogram_barColors[i]);
-      if (data != 0) { // Only draw the top label if the bar-data != 0.
-        histogram_drawTopLabel(i, data, topLabel[i],
-                               false); // false means that the old label does
-                                       // not need to be erased.
-        previousBarData[i] = currentBarData[i]; // Old data and new data are the
-                                                // same after the update.
-        // Old label and new label are the same after the update.
-        strncpy(oldTopLabel[i], topLabel[i],
-                HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS);
-      }
-    } else if ((data != 0) &&
-               strncmp(topLabel[i], oldTopLabel[i],
-                       HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS)) {
-      histogram_drawTopLabel(
-          i, data, topLabel[i],
-          true); // True means that the old label needs to be erased.
-      // After the update, copy the label to old data so that it won't reupdate
-      // until the next change.
-      strncpy(oldTopLabel[i], topLabel[i],
-              HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS);
-    }
-  }
+  // No bar needs more than this, so it is all drawn in one step.
+  histogram_updateDisplayStep(UINT16_MAX);
 }
 
 // Set the bar-color for each bar. This overwrites the defaults. Call
@@ -370,8 +541,9 @@ void histogram_normalizePowerValues(double normalizedValues[],
     normalizedValues[i] = origValues[i] / maxValue;
 }
 
-// Used to plot the power response for user frequencies 0-9.
-void histogram_plotUserFrequencyPower(double powerValues[]) {
+// Sets the bars to the power response for user frequencies 0-9 without
+// drawing them.
+void histogram_setUserFrequencyPower(double powerValues[]) {
   double normalizedPowerValues[FILTER_FREQUENCY_COUNT];
   histogram_normalizePowerValues(normalizedPowerValues, powerValues,
                                  FILTER_FREQUENCY_COUNT);
@@ -383,12 +555,10 @@ void histogram_plotUserFrequencyPower(double powerValues[]) {
     // You can have a dynamic label at the top of the bar.
     char label[HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS]; // Get a buffer for
                                                             // the label.
-    // Create the label, based upon the actual power value.
-    if (snprintf(label, HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS, "%0.0e",
-                 powerValues[i]) == -1)
-      printf("Error: snprintf encountered an error during conversion.\n");
-    // Pull out the 'e' from the exponent to make better use of your characters.
-    trimLabel(label);
+    // Create the label, based upon the actual power value. The 'e' of the
+    // exponent is left out to make better use of your characters.
+    format_compactExponent(label, HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS,
+                           powerValues[i]);
     // Have the bar value and the label, send the data to the histogram.
     if (!histogram_setBarData(i, histogramBarValue, label)) {
       // If returns false, histogram_setBarData() is not happy. Print out some
@@ -407,6 +577,11 @@ void histogram_plotUserFrequencyPower(double powerValues[]) {
       }
     }
   }
+}
+
+// Used to plot the power response for user frequencies 0-9.
+void histogram_plotUserFrequencyPower(double powerValues[]) {
+  histogram_setUserFrequencyPower(powerValues);
   histogram_updateDisplay();
 }
 
@@ -436,14 +611,13 @@ void histogram_plotUserHits(uint16_t hitCounts[]) {
        i++) { // Iterate through the results for each channel.
     char label[HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS]; // Get a buffer for
                                                             // the label.
-    // Create the label, based upon the actual power value.
-    if (snprintf(label, HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS, "%d",
-                 hitCounts[i]) == -1)
-      printf("Error: snprintf encountered an error during conversion.\n");
+    // Create the label, based upon the actual hit count.
+    format_unsigned(label, HISTOGRAM_BAR_TOP_MAX_LABEL_WIDTH_IN_CHARS,
+                    hitCounts[i]);
     histogram_setBarData(
         i, normalizedHitValues[i] * HISTOGRAM_MAX_BAR_DATA_IN_PIXELS, label);
-    histogram_updateDisplay(); // Redraw the histogram.
   }
+  histogram_updateDisplay(); // Redraw the histogram once all bars are set.
 }
 
 // Normalizes the values in the array argument.
@@ -64,6 +64,12 @@ typedef uint16_t histogram_data_t;  // The data associated with each bar.
 // Must call this before using the histogram functions.
 void histogram_init(uint16_t barCount);
 
+// When enabled, the histogram is drawn into the RAM framebuffer
+// (framebuffer.h) and each histogram_updateDisplay() sends only the pixels it
+// changed to the TFT, in a few transfers. Call before histogram_init(), which
+// then takes over the whole screen. Disabled by default.
+void histogram_setFramebufferEnabled(bool enabled);
+
 // Sets the height (data) of the bar (barIndex).
 // Also places a small label (barTopLabel) at the top of the bar. Does NOT
 // render the histogram onto the TFT. Returns false if there is something wrong
@@ -84,7 +90,20 @@ void histogram_redrawBottomLabels();
 void histogram_setBottomLabelTextSize(uint16_t);
 
 // Call this to draw the histogram with the data from histogram_setBarData().
+// Only what changed since the last call is drawn: the strip a bar grew or
+// shrank by and the label characters that changed. Set every bar for the frame
+// first, then call this once.
 void histogram_updateDisplay();
+// Does the drawing of histogram_updateDisplay() a piece at a time, so it can be
+// spread over several passes of a main loop: draws about maxRowCount rows of
+// bar (a label counts as a few rows) and returns true once the whole histogram
+// is up to date. A bar with further to go is moved part of the way, so the
+// screen always shows a whole histogram. Don't change the bars until it has
+// returned true.
+bool histogram_updateDisplayStep(uint16_t maxRowCount);
+// Sets the bars to the power response for user frequencies 0-9, to be drawn
+// by histogram_updateDisplay() or histogram_updateDisplayStep().
+void histogram_setUserFrequencyPower(double powerValue[]);
 
 // Used to plot the power response for user frequencies 0-9.
 void histogram_plotUserFrequencyPower(double powerValue[]);
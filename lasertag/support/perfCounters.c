@@ -0,0 +1,220 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "perfCounters.h"
+
+#if PERF_COUNTERS_ENABLED
+
+#ifdef ZYBO_BOARD
+#include "xpm_counter.h"
+#include "xpseudo_asm.h"
+#include "xreg_cortexa9.h"
+// The PMU event counters are 32 bits and wrap; differences are taken modulo.
+#define PERF_COUNTERS_COUNTER_MASK 0xFFFFFFFFull
+#define PERF_COUNTERS_PMCR_ENABLE 0x1       // PMCR.E: all counters on.
+#define PERF_COUNTERS_PMCR_RESET_EVENTS 0x2 // PMCR.P: event counters to 0.
+#else
+#include <linux/perf_event.h>
+#include <string.h>
+#include <sys/ioctl.h>
+#include <sys/syscall.h>
+#include <unistd.h>
+#define PERF_COUNTERS_COUNTER_MASK UINT64_MAX
+#define PERF_COUNTERS_NO_FD -1
+#endif
+
+#define PERF_COUNTERS_NAME_COLUMN_WIDTH 12
+
+static const char *perfCounters_eventNames[PERF_COUNTERS_EVENT_COUNT] = {
+    "cycles", "instructions", "L1D misses", "branch misses"};
+
+static perfCounters_stage_t *perfCounters_firstStage;
+static perfCounters_stage_t *perfCounters_lastStage;
+static bool perfCounters_started;
+static bool perfCounters_available[PERF_COUNTERS_EVENT_COUNT];
+
+#ifdef ZYBO_BOARD
+
+// PMU event counter i counts perfCounters_events[i].
+static const uint32_t perfCounters_events[PERF_COUNTERS_EVENT_COUNT] = {
+    XPM_EVENT_CLOCKCYCLES, XPM_EVENT_INSTRRENAME, XPM_EVENT_DATA_CACHEREFILL,
+    XPM_EVENT_BRANCHMISS};
+#define PERF_COUNTERS_COUNTER_BITS ((1u << PERF_COUNTERS_EVENT_COUNT) - 1)
+
+// Programs event counters 0 to 3 and starts them. The cycle counter's enable
+// bit (31) and reset bit (PMCR.C) are left alone.
+static void perfCounters_start() {
+  mtcp(XREG_CP15_COUNT_ENABLE_CLR, PERF_COUNTERS_COUNTER_BITS);
+  for (uint32_t i = 0; i < PERF_COUNTERS_EVENT_COUNT; i++) {
+    mtcp(XREG_CP15_EVENT_CNTR_SEL, i);
+    isb();
+    mtcp(XREG_CP15_EVENT_TYPE_SEL, perfCounters_events[i]);
+    perfCounters_available[i] = true;
+  }
+  uint32_t pmcr = mfcp(XREG_CP15_PERF_MONITOR_CTRL);
+  mtcp(XREG_CP15_PERF_MONITOR_CTRL, pmcr | PERF_COUNTERS_PMCR_ENABLE |
+                                        PERF_COUNTERS_PMCR_RESET_EVENTS);
+  mtcp(XREG_CP15_COUNT_ENABLE_SET, PERF_COUNTERS_COUNTER_BITS);
+  isb();
+}
+
+static void perfCounters_read(uint64_t counts[]) {
+  for (uint32_t i = 0; i < PERF_COUNTERS_EVENT_COUNT; i++) {
+    mtcp(XREG_CP15_EVENT_CNTR_SEL, i);
+    isb();
+    counts[i] = mfcp(XREG_CP15_PERF_MONITOR_COUNT);
+  }
+}
+
+#else
+
+// The events as perf_event_open() types and configs.
+static const uint32_t perfCounters_types[PERF_COUNTERS_EVENT_COUNT] = {
+    PERF_TYPE_HARDWARE, PERF_TYPE_HARDWARE, PERF_TYPE_HW_CACHE,
+    PERF_TYPE_HARDWARE};
+static const uint64_t perfCounters_configs[PERF_COUNTERS_EVENT_COUNT] = {
+    PERF_COUNT_HW_CPU_CYCLES, PERF_COUNT_HW_INSTRUCTIONS,
+    PERF_COUNT_HW_CACHE_L1D | (PERF_COUNT_HW_CACHE_OP_READ << 8) |
+        (PERF_COUNT_HW_CACHE_RESULT_MISS << 16),
+    PERF_COUNT_HW_BRANCH_MISSES};
+
+static int perfCounters_groupFd = PERF_COUNTERS_NO_FD; // The group leader.
+// Where each available event comes in a read of the group.
+static uint32_t perfCounters_groupIndex[PERF_COUNTERS_EVENT_COUNT];
+static uint32_t perfCounters_groupSize;
+
+// Opens the events that the host can count as one group, so that one read()
+// returns them all from the same instant, and starts it.
+static void perfCounters_start() {
+  for (uint32_t i = 0; i < PERF_COUNTERS_EVENT_COUNT; i++) {
+    struct perf_event_attr attr;
+    memset(&attr, 0, sizeof(attr));
+    attr.size = sizeof(attr);
+    attr.type = perfCounters_types[i];
+    attr.config = perfCounters_configs[i];
+    attr.read_format = PERF_FORMAT_GROUP;
+    attr.disabled = perfCounters_groupFd == PERF_COUNTERS_NO_FD;
+    attr.exclude_kernel = 1;
+    attr.exclude_hv = 1;
+    int fd = syscall(SYS_perf_event_open, &attr, 0, -1, perfCounters_groupFd,
+                     0);
+    if (fd < 0)
+      continue;
+    if (perfCounters_groupFd == PERF_COUNTERS_NO_FD)
+      perfCounters_groupFd = fd;
+    perfCounters_available[i] = true;
+    perfCounters_groupIndex[i] = perfCounters_groupSize++;
+  }
+  if (perfCounters_groupFd == PERF_COUNTERS_NO_FD)
+    return;
+  ioctl(perfCounters_groupFd, PERF_EVENT_IOC_RESET, PERF_IOC_FLAG_GROUP);
+  ioctl(perfCounters_groupFd, PERF_EVENT_IOC_ENABLE, PERF_IOC_FLAG_GROUP);
+}
+
+static void perfCounters_read(uint64_t counts[]) {
+  uint64_t values[PERF_COUNTERS_EVENT_COUNT + 1]; // The count, then each.
+  if (perfCounters_groupFd == PERF_COUNTERS_NO_FD ||
+      read(perfCounters_groupFd, values, sizeof(values)) <= 0)
+    values[0] = 0;
+  for (uint32_t i = 0; i < PERF_COUNTERS_EVENT_COUNT; i++)
+    counts[i] = perfCounters_available[i] &&
+                        perfCounters_groupIndex[i] < values[0]
+                    ? values[perfCounters_groupIndex[i] + 1]
+                    : 0;
+}
+
+#endif /* ZYBO_BOARD */
+
+void perfCounters_begin(perfCounters_stage_t *stage) {
+  if (!stage->registered) {
+    stage->registered = true;
+    stage->next = NULL;
+    if (perfCounters_lastStage)
+      perfCounters_lastStage->next = stage;
+    else
+      perfCounters_firstStage = stage;
+    perfCounters_lastStage = stage;
+  }
+  perfCounters_read(stage->startCounts);
+}
+
+void perfCounters_end(perfCounters_stage_t *stage) {
+  uint64_t counts[PERF_COUNTERS_EVENT_COUNT];
+  perfCounters_read(counts);
+  stage->calls++;
+  for (uint32_t i = 0; i < PERF_COUNTERS_EVENT_COUNT; i++)
+    stage->counts[i] +=
+        (counts[i] - stage->startCounts[i]) & PERF_COUNTERS_COUNTER_MASK;
+}
+
+// Programs and starts the counters the first time it is called, and clears
+// every stage's counts. The stages stay in the report.
+void perfCounters_reset() {
+  if (!perfCounters_started) {
+    perfCounters_start();
+    perfCounters_started = true;
+  }
+  for (perfCounters_stage_t *stage = perfCounters_firstStage; stage;
+       stage = stage->next) {
+    stage->calls = 0;
+    for (uint32_t i = 0; i < PERF_COUNTERS_EVENT_COUNT; i++)
+      stage->counts[i] = 0;
+  }
+}
+
+// Returns true if event is being counted. False until perfCounters_reset().
+bool perfCounters_isAvailable(perfCounters_event_t event) {
+  return event < PERF_COUNTERS_EVENT_COUNT && perfCounters_available[event];
+}
+
+// Prints a count per sample, or a dash if the event is not counted.
+static void perfCounters_printPerSample(const perfCounters_stage_t *stage,
+                                        perfCounters_event_t event,
+                                        uint32_t samples) {
+  if (perfCounters_available[event] && samples)
+    printf(" %13.3f", (double)stage->counts[event] / samples);
+  else
+    printf(" %13s", "-");
+}
+
+// Prints the stages on the console with their counts per ADC sample, for the
+// given number of samples processed since perfCounters_reset().
+void perfCounters_printReport(uint32_t samples) {
+  printf("%-*s %10s %13s %13s %13s %13s %6s\n",
+         PERF_COUNTERS_NAME_COLUMN_WIDTH, "stage", "calls", "cycles/smp",
+         "instrs/smp", "L1D miss/smp", "br miss/smp", "IPC");
+  for (const perfCounters_stage_t *stage = perfCounters_firstStage; stage;
+       stage = stage->next) {
+    printf("%-*s %10lu", PERF_COUNTERS_NAME_COLUMN_WIDTH, stage->name,
+           (unsigned long)stage->calls);
+    for (uint32_t i = 0; i < PERF_COUNTERS_EVENT_COUNT; i++)
+      perfCounters_printPerSample(stage, i, samples);
+    if (perfCounters_available[PERF_COUNTERS_CYCLES] &&
+        perfCounters_available[PERF_COUNTERS_INSTRUCTIONS] &&
+        stage->counts[PERF_COUNTERS_CYCLES])
+      printf(" %6.2f\n", (double)stage->counts[PERF_COUNTERS_INSTRUCTIONS] /
+                             stage->counts[PERF_COUNTERS_CYCLES]);
+    else
+      printf(" %6s\n", "-");
+  }
+  for (uint32_t i = 0; i < PERF_COUNTERS_EVENT_COUNT; i++)
+    if (!perfCounters_available[i])
+      printf("%s: not available.\n", perfCounters_eventNames[i]);
+}
+
+// Returns the stages, linked by next, in the order they were first begun.
+const perfCounters_stage_t *perfCounters_getStages() {
+  return perfCounters_firstStage;
+}
+
+#endif /* PERF_COUNTERS_ENABLED */
@@ -0,0 +1,100 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Hardware event counts for the filter stages: cycles, instructions, L1 data
+// cache misses and branch mispredicts, read before and after each stage and
+// added up per stage. A stage is a static variable declared with
+// PERF_COUNTERS_STAGE(); PERF_COUNTERS_BEGIN() and PERF_COUNTERS_END()
+// bracket the code it counts:
+//
+//   PERF_COUNTERS_STAGE(detector_firStage, "fir");
+//   ...
+//   PERF_COUNTERS_BEGIN(detector_firStage);
+//   filter_firFilter();
+//   PERF_COUNTERS_END(detector_firStage);
+//
+// Stages do not nest. perfCounters_printReport() prints each stage's
+// instructions per cycle and its counts per ADC sample.
+//
+// On the board the counters are four of the Cortex-A9 PMU event counters,
+// programmed through CP15; the cycle counter is left to the BSP. The A9 does
+// not implement the architectural instructions-executed event, so
+// instructions are those leaving register rename (XPM_EVENT_INSTRRENAME), the
+// nearest it has. On the host they are a perf_event_open() group on the
+// calling thread, user space only. An event the host cannot count (most
+// virtual machines count none) is reported as unavailable.
+//
+// The counters cost a few CP15 accesses per read on the board but a system
+// call on the host, so they are off unless built with
+// -DPERF_COUNTERS_ENABLED=1; otherwise the stage macros compile to nothing.
+
+#ifndef PERFCOUNTERS_H_
+#define PERFCOUNTERS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef PERF_COUNTERS_ENABLED
+#define PERF_COUNTERS_ENABLED 0
+#endif
+
+typedef enum {
+  PERF_COUNTERS_CYCLES,
+  PERF_COUNTERS_INSTRUCTIONS,
+  PERF_COUNTERS_L1D_MISSES,
+  PERF_COUNTERS_BRANCH_MISSES,
+  PERF_COUNTERS_EVENT_COUNT
+} perfCounters_event_t;
+
+typedef struct perfCounters_stage {
+  const char *name;
+  struct perfCounters_stage *next; // In the order stages were first begun.
+  bool registered;
+  uint32_t calls;
+  uint64_t counts[PERF_COUNTERS_EVENT_COUNT];
+  uint64_t startCounts[PERF_COUNTERS_EVENT_COUNT]; // At PERF_COUNTERS_BEGIN().
+} perfCounters_stage_t;
+
+#if PERF_COUNTERS_ENABLED
+
+#define PERF_COUNTERS_STAGE(stage, stageName)                                  \
+  static perfCounters_stage_t stage = {.name = (stageName)}
+#define PERF_COUNTERS_BEGIN(stage) perfCounters_begin(&(stage))
+#define PERF_COUNTERS_END(stage) perfCounters_end(&(stage))
+
+void perfCounters_begin(perfCounters_stage_t *stage);
+void perfCounters_end(perfCounters_stage_t *stage);
+
+// Programs and starts the counters the first time it is called, and clears
+// every stage's counts. The stages stay in the report.
+void perfCounters_reset();
+
+// Returns true if event is being counted. False until perfCounters_reset().
+bool perfCounters_isAvailable(perfCounters_event_t event);
+
+// Prints the stages on the console with their counts per ADC sample, for the
+// given number of samples processed since perfCounters_reset().
+void perfCounters_printReport(uint32_t samples);
+
+// Returns the stages, linked by next, in the order they were first begun.
+const perfCounters_stage_t *perfCounters_getStages();
+
+#else
+
+// A declaration of nothing, so that the ';' after it stays legal.
+#define PERF_COUNTERS_STAGE(stage, stageName)                                  \
+  struct perfCounters_disabledStage
+#define PERF_COUNTERS_BEGIN(stage) ((void)0)
+#define PERF_COUNTERS_END(stage) ((void)0)
+#define perfCounters_reset() ((void)0)
+#define perfCounters_printReport(samples) ((void)(samples))
+
+#endif /* PERF_COUNTERS_ENABLED */
+
+#endif /* PERFCOUNTERS_H_ */
@@ -0,0 +1,193 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+
+#include "profiler.h"
+
+#ifdef ZYBO_BOARD
+#include "xtime_l.h"
+#define PROFILER_TICKS_PER_SECOND ((uint64_t)COUNTS_PER_SECOND)
+#else
+#include <time.h>
+#define PROFILER_TICKS_PER_SECOND 1000000000ull
+#endif
+
+#define PROFILER_MS_PER_SECOND 1e3
+#define PROFILER_US_PER_SECOND 1e6
+#define PROFILER_PERCENT 100.0
+#define PROFILER_NAME_COLUMN_WIDTH 24
+#define PROFILER_INDENT 2 // Spaces per level of nesting.
+
+// Reads the free-running counter.
+profiler_ticks_t profiler_getTicks() {
+#ifdef ZYBO_BOARD
+  XTime now;
+  XTime_GetTime(&now);
+  return now;
+#else
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (profiler_ticks_t)now.tv_sec * PROFILER_TICKS_PER_SECOND + now.tv_nsec;
+#endif
+}
+
+// Counter ticks a second.
+uint64_t profiler_getTicksPerSecond() { return PROFILER_TICKS_PER_SECOND; }
+
+double profiler_ticksToSeconds(profiler_ticks_t ticks) {
+  return (double)ticks / PROFILER_TICKS_PER_SECOND;
+}
+
+// Seconds since the counter read startTicks.
+double profiler_getSecondsSince(profiler_ticks_t startTicks) {
+  return profiler_ticksToSeconds(profiler_getTicks() - startTicks);
+}
+
+#if PROFILER_ENABLED
+
+// A scope that has been begun and not yet ended.
+typedef struct {
+  profiler_scope_t *scope;
+  profiler_ticks_t startTicks;
+  profiler_ticks_t childTicks; // Inclusive time of the scopes begun inside.
+} profiler_openScope_t;
+
+static profiler_scope_t *profiler_firstScope;
+static profiler_scope_t *profiler_lastScope;
+static profiler_openScope_t profiler_openScopes[PROFILER_MAX_DEPTH];
+static uint16_t profiler_depth;
+// Scopes begun past PROFILER_MAX_DEPTH, which are not timed.
+static uint16_t profiler_overflowDepth;
+static bool profiler_mismatchReported;
+
+// Adds scope to the report, under the innermost open scope.
+static void profiler_register(profiler_scope_t *scope) {
+  scope->registered = true;
+  scope->parent =
+      profiler_depth ? profiler_openScopes[profiler_depth - 1].scope : NULL;
+  scope->next = NULL;
+  if (profiler_lastScope)
+    profiler_lastScope->next = scope;
+  else
+    profiler_firstScope = scope;
+  profiler_lastScope = scope;
+}
+
+void profiler_begin(profiler_scope_t *scope) {
+  if (!scope->registered)
+    profiler_register(scope);
+  if (profiler_depth == PROFILER_MAX_DEPTH || profiler_overflowDepth) {
+    profiler_overflowDepth++;
+    return;
+  }
+  profiler_openScope_t *open = &profiler_openScopes[profiler_depth++];
+  open->scope = scope;
+  open->childTicks = 0;
+  open->startTicks = profiler_getTicks(); // Last, to leave out the above.
+}
+
+void profiler_end(profiler_scope_t *scope) {
+  profiler_ticks_t now = profiler_getTicks(); // First, for the same reason.
+  if (profiler_overflowDepth) {
+    profiler_overflowDepth--;
+    return;
+  }
+  if (profiler_depth == 0)
+    return;
+  profiler_openScope_t *open = &profiler_openScopes[--profiler_depth];
+  if (open->scope != scope && !profiler_mismatchReported) {
+    printf("profiler_end(): \"%s\" ended while \"%s\" was open.\n",
+           scope->name, open->scope->name);
+    profiler_mismatchReported = true;
+  }
+  profiler_scope_t *ended = open->scope;
+  profiler_ticks_t elapsed = now - open->startTicks;
+  ended->calls++;
+  ended->inclusiveTicks += elapsed;
+  ended->exclusiveTicks += elapsed - open->childTicks;
+  if (elapsed > ended->maxTicks)
+    ended->maxTicks = elapsed;
+  if (profiler_depth)
+    profiler_openScopes[profiler_depth - 1].childTicks += elapsed;
+}
+
+// Clears every scope's statistics. The scopes stay in the report.
+void profiler_reset() {
+  for (profiler_scope_t *scope = profiler_firstScope; scope;
+       scope = scope->next)
+    scope->calls = scope->inclusiveTicks = scope->exclusiveTicks =
+        scope->maxTicks = 0;
+  profiler_depth = profiler_overflowDepth = 0;
+}
+
+// Sorts the list of scopes, the most inclusive time first. Insertion sort,
+// which keeps equal scopes in order; there are only a handful.
+static void profiler_sortScopes() {
+  profiler_scope_t *sorted = NULL;
+  profiler_scope_t *scope = profiler_firstScope;
+  while (scope) {
+    profiler_scope_t *next = scope->next;
+    profiler_scope_t **link = &sorted;
+    while (*link && (*link)->inclusiveTicks >= scope->inclusiveTicks)
+      link = &(*link)->next;
+    scope->next = *link;
+    *link = scope;
+    scope = next;
+  }
+  profiler_firstScope = sorted;
+  for (profiler_lastScope = sorted;
+       profiler_lastScope && profiler_lastScope->next;
+       profiler_lastScope = profiler_lastScope->next)
+    ;
+}
+
+// Prints the scopes under parent, and theirs in turn, indented by depth.
+static void profiler_printScopes(const profiler_scope_t *parent, uint16_t depth,
+                                double totalSeconds) {
+  for (const profiler_scope_t *scope = profiler_firstScope; scope;
+       scope = scope->next) {
+    if (scope->parent != parent)
+      continue;
+    double inclusive = profiler_ticksToSeconds(scope->inclusiveTicks);
+    double exclusive = profiler_ticksToSeconds(scope->exclusiveTicks);
+    printf("%*s%-*s %10lu %10.2f %10.2f %9.2f %9.2f %6.1f %6.1f\n",
+           depth * PROFILER_INDENT, "",
+           PROFILER_NAME_COLUMN_WIDTH - depth * PROFILER_INDENT, scope->name,
+           (unsigned long)scope->calls, inclusive * PROFILER_MS_PER_SECOND,
+           exclusive * PROFILER_MS_PER_SECOND,
+           scope->calls ? inclusive / scope->calls * PROFILER_US_PER_SECOND
+                        : 0.0,
+           profiler_ticksToSeconds(scope->maxTicks) * PROFILER_US_PER_SECOND,
+           totalSeconds > 0.0 ? inclusive / totalSeconds * PROFILER_PERCENT
+                              : 0.0,
+           totalSeconds > 0.0 ? exclusive / totalSeconds * PROFILER_PERCENT
+                              : 0.0);
+    if (depth + 1 < PROFILER_MAX_DEPTH)
+      profiler_printScopes(scope, depth + 1, totalSeconds);
+  }
+}
+
+// Prints the scopes on the console, the most inclusive time first, with
+// each one's share of totalSeconds (the run time the scopes fall within).
+void profiler_printReport(double totalSeconds) {
+  profiler_sortScopes();
+  printf("%-*s %10s %10s %10s %9s %9s %6s %6s\n", PROFILER_NAME_COLUMN_WIDTH,
+         "scope", "calls", "incl ms", "excl ms", "mean us", "max us",
+         "incl %", "excl %");
+  profiler_printScopes(NULL, 0, totalSeconds);
+}
+
+// Returns the scopes, linked by next: in the order they were first begun,
+// or after profiler_printReport(), the most inclusive time first.
+const profiler_scope_t *profiler_getScopes() { return profiler_firstScope; }
+
+#endif /* PROFILER_ENABLED */
@@ -0,0 +1,106 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Named, nestable profiling scopes on one free-running counter. A scope is a
+// static variable declared with PROFILER_SCOPE(); PROFILER_BEGIN() and
+// PROFILER_END() bracket the code it times and must pair up, innermost first:
+//
+//   PROFILER_SCOPE(detector_firScope, "fir");
+//   ...
+//   PROFILER_BEGIN(detector_firScope);
+//   filter_firFilter();
+//   PROFILER_END(detector_firScope);
+//
+// Each scope keeps its call count, its inclusive time, its exclusive time
+// (less the scopes begun inside it) and its longest call. A scope joins the
+// report the first time it is begun, under the scope that was open then, so
+// the report shows detector > fir > ... as the code nests them. Scopes are for
+// the main loop; the ISR is timed by the interrupts library on interval timer
+// 0.
+//
+// Build with -DPROFILER_ENABLED=0 and the scope macros compile to nothing:
+// no variables, no calls. profiler_getTicks() and the conversions stay, for
+// code that needs a clock either way.
+//
+// The counter is the Cortex-A9 global timer (XTime_GetTime()) on the board,
+// CLOCK_MONOTONIC on the host.
+//
+// Not profile.h: the BSP has one for its gprof support, and its include
+// directory is searched before support/.
+
+#ifndef PROFILER_H_
+#define PROFILER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef PROFILER_ENABLED
+#define PROFILER_ENABLED 1
+#endif
+
+// Most scopes that can be open at once.
+#define PROFILER_MAX_DEPTH 16
+
+typedef uint64_t profiler_ticks_t;
+
+typedef struct profiler_scope {
+  const char *name;
+  struct profiler_scope *parent; // Open when this one was first begun.
+  struct profiler_scope *next;   // In the order scopes were first begun.
+  bool registered;
+  uint32_t calls;
+  profiler_ticks_t inclusiveTicks;
+  profiler_ticks_t exclusiveTicks;
+  profiler_ticks_t maxTicks; // Longest call, inclusive.
+} profiler_scope_t;
+
+// Reads the free-running counter.
+profiler_ticks_t profiler_getTicks();
+
+// Counter ticks a second.
+uint64_t profiler_getTicksPerSecond();
+
+double profiler_ticksToSeconds(profiler_ticks_t ticks);
+
+// Seconds since the counter read startTicks.
+double profiler_getSecondsSince(profiler_ticks_t startTicks);
+
+#if PROFILER_ENABLED
+
+#define PROFILER_SCOPE(scope, scopeName)                                       \
+  static profiler_scope_t scope = {.name = (scopeName)}
+#define PROFILER_BEGIN(scope) profiler_begin(&(scope))
+#define PROFILER_END(scope) profiler_end(&(scope))
+
+void profiler_begin(profiler_scope_t *scope);
+void profiler_end(profiler_scope_t *scope);
+
+// Clears every scope's statistics. The scopes stay in the report.
+void profiler_reset();
+
+// Prints the scopes on the console, the most inclusive time first, with
+// each one's share of totalSeconds (the run time the scopes fall within).
+void profiler_printReport(double totalSeconds);
+
+// Returns the scopes, linked by next: in the order they were first begun,
+// or after profiler_printReport(), the most inclusive time first.
+const profiler_scope_t *profiler_getScopes();
+
+#else
+
+// A declaration of nothing, so that the ';' after it stays legal.
+#define PROFILER_SCOPE(scope, scopeName) struct profiler_disabledScope
+#define PROFILER_BEGIN(scope) ((void)0)
+#define PROFILER_END(scope) ((void)0)
+#define profiler_reset() ((void)0)
+#define profiler_printReport(totalSeconds) ((void)(totalSeconds))
+
+#endif /* PROFILER_ENABLED */
+
+#endif /* PROFILER_H_ */
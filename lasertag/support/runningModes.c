@@ -13,22 +13,33 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #include <stdlib.h>
 #include <string.h>
 
+#include "adcCapture.h"
 #include "buffer.h"
 #include "buttons.h"
 #include "detector.h"
 #include "display.h"
 #include "filter.h"
+#include "format.h"
 #include "histogram.h"
 #include "hitLedTimer.h"
 #include "interrupts.h"
 #include "intervalTimer.h"
 #include "isr.h"
 #include "lockoutTimer.h"
+#include "perfCounters.h"
+#include "profiler.h"
 #include "runningModes.h"
+#include "sampleRateStress.h"
+#include "sampler.h"
+#include "sound.h"
 #include "switches.h"
+#include "textRenderer.h"
+#include "trace.h"
 #include "transmitter.h"
 #include "trigger.h"
+#include "uiScheduler.h"
 #include "utils.h"
+#include "xil_printf.h"
 #include "xparameters.h"
 
 // Uncomment this code so that the code in the various modes will
@@ -46,14 +57,11 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 #define HISTOGRAM_BAR_COUNT                                                    \
   FILTER_FREQUENCY_COUNT // As many histogram bars as user filter frequencies.
 
+// The interrupts library times the ISR on interval timer 0. The run time and
+// the main-loop time are taken from the profiling counter (see profiler.h).
 #define ISR_CUMULATIVE_TIMER INTERVAL_TIMER_TIMER_0 // Used by the ISR.
-#define TOTAL_RUNTIME_TIMER                                                    \
-  INTERVAL_TIMER_TIMER_1 // Used to compute total run-time.
-#define MAIN_CUMULATIVE_TIMER                                                  \
-  INTERVAL_TIMER_TIMER_2 // Used to compute cumulative run-time in main.
-
-#define SYSTEM_TICKS_PER_HISTOGRAM_UPDATE                                      \
-  30000 // Update the histogram about 3 times per second.
+// Only used while the sample-rate stress test calibrates, before the ISR runs.
+#define CALIBRATION_TIMER INTERVAL_TIMER_TIMER_1
 
 #define RUNNING_MODE_WARNING_TEXT_SIZE 2 // Upsize the text for visibility.
 #define RUNNING_MODE_WARNING_TEXT_COLOR DISPLAY_RED // Red for more visibility.
@@ -68,119 +76,260 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 // good performance.
 #define SUGGESTED_REMAINING_ELEMENT_COUNT 500
 
+// Update the histogram about 3 times per second, 16 rows of bar at a time, and
+// only while the ADC backlog is well below SUGGESTED_REMAINING_ELEMENT_COUNT.
+// A slice lets about 200 more samples pile up at 100 kHz.
+#define RUNNING_MODE_UI_FRAME_SECONDS (1.0 / 3)
+#define RUNNING_MODE_UI_SLICE_SECONDS 0.002
+#define RUNNING_MODE_UI_MAX_BACKLOG (SUGGESTED_REMAINING_ELEMENT_COUNT / 4)
+#define RUNNING_MODE_UI_ROWS_PER_CHUNK 16
+
+// The private timer runs at half the CPU clock (prescaler 0). Used to turn a
+// sample rate into a load value for the stress test.
+#define RUNNING_MODE_PRIVATE_TIMER_CLOCK_HZ                                    \
+  (XPAR_CPU_CORTEXA9_0_CPU_CLK_FREQ_HZ / 2)
+#define RUNNING_MODE_NOMINAL_SAMPLE_RATE_HZ                                    \
+  (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000)
+#define RUNNING_MODE_NANOSECONDS_PER_SECOND 1e9
+
 // Defined to make things more readable.
 #define INTERRUPTS_CURRENTLY_ENABLED true
 #define INTERRUPTS_CURRENTLY_DISABLE false
 
+static profiler_ticks_t runningModes_startTicks; // When the mode started.
+static profiler_ticks_t runningModes_mainTicks;  // Spent in the main loop.
+static uint32_t runningModes_startSamples;       // Processed before the mode.
+
+PROFILER_SCOPE(runningModes_histogramProfileScope, "histogram");
+
+// Starts timing a mode: the run time, the main loop, the ISR, the profiling
+// scopes, the filter stages' event counts, the trace and the PC samples.
+static void runningModes_startTiming() {
+  intervalTimer_reset(ISR_CUMULATIVE_TIMER);
+  profiler_reset();
+  perfCounters_reset();
+  trace_start(TRACE_ALL_IDS);
+  sampler_start();
+  runningModes_startSamples = detector_getSampleCount();
+  runningModes_mainTicks = 0;
+  runningModes_startTicks = profiler_getTicks();
+}
+
+// Stops the trace and streams it to the console UART as binary frames (see
+// trace.h). Decode it on the host with tools/traceToChrome.
+static void runningModes_dumpTrace() {
+#if TRACE_ENABLED
+  trace_stop();
+  printf("\nStreaming %lu trace events.\n",
+         (unsigned long)trace_getEventCount());
+  // outbyte() sends the frames untouched; printf would translate newlines.
+  uint8_t frame[TRACE_MAX_FRAME_BYTES];
+  uint32_t frameLength;
+  while ((frameLength = trace_takeFrame(frame))) {
+    for (uint32_t i = 0; i < frameLength; i++)
+      outbyte(frame[i]);
+  }
+  printf("\nTrace done.\n");
+#endif
+}
+
+// Streams the PC samples taken since the mode started to the console UART as
+// binary frames (see sampler.h). Make a flat profile of them on the host with
+// tools/samplerReport and lasertag.elf.
+static void runningModes_dumpSamples() {
+#if SAMPLER_ENABLED
+  printf("\nStreaming %lu PC samples (%lu dropped).\n",
+         (unsigned long)sampler_getSampleCount(),
+         (unsigned long)sampler_getDroppedCount());
+  uint8_t frame[SAMPLER_MAX_FRAME_BYTES];
+  uint32_t frameLength;
+  while ((frameLength = sampler_takeFrame(frame))) {
+    for (uint32_t i = 0; i < frameLength; i++)
+      outbyte(frame[i]);
+  }
+  printf("\nSamples done.\n");
+#endif
+}
+
+static double runningModes_getRunSeconds() {
+  return profiler_getSecondsSince(runningModes_startTicks);
+}
+
 // Prints out various run-time statistics on the TFT display.
 // Assumes the following:
 // detected interrupts is retrieved with interrupts_isrInvocationCount(),
 // interval_timer(0) is the cumulative run time of the ISR,
-// interval_timer(1) is the total run time,
-// interval_timer(2) is the time spent in main running the filters, updating the
-// display, and so forth. No comments in the code, the print statements are
-// self-explanatory.
+// the total run time and the time spent in main running the filters,
+// updating the display, and so forth are read off the profiling counter since
+// the mode started. Also prints the profiling scopes, and the filter stages'
+// event counts if built with them, on the console, then streams the trace and
+// the PC samples if built with them. No comments in the code, the print
+// statements are self-explanatory.
 void runningModes_printRunTimeStatistics(void) {
-  char sprintfBuffer[MAX_BUFFER_SIZE]; // Generic message buffer.
+  sampler_stop(); // Printing the statistics is not part of the mode.
+  char textBuffer[MAX_BUFFER_SIZE]; // Generic message buffer.
   // Setup the screen.
-  display_setTextSize(RUNNING_MODE_NORMAL_TEXT_SIZE);
-  display_setTextColor(RUNNING_MODE_NORMAL_TEXT_COLOR);
-  display_setCursor(RUNNING_MODE_SCREEN_X_ORIGIN, RUNNING_MODE_SCREEN_Y_ORIGIN);
+  textRenderer_setTextSize(RUNNING_MODE_NORMAL_TEXT_SIZE);
+  textRenderer_setTextColor(RUNNING_MODE_NORMAL_TEXT_COLOR);
+  textRenderer_setCursor(RUNNING_MODE_SCREEN_X_ORIGIN,
+                         RUNNING_MODE_SCREEN_Y_ORIGIN);
   display_fillScreen(DISPLAY_BLACK);
+  textRenderer_clearCache();
 
   // Print out the ADC mode.
   if (interrupts_getAdcInputMode() == INTERRUPTS_ADC_UNIPOLAR_MODE) {
-    display_print("ADC mode: unipolar\n\n");
+    textRenderer_print("ADC mode: unipolar\n\n");
   } else if (interrupts_getAdcInputMode() == INTERRUPTS_ADC_BIPOLAR_MODE) {
-    display_print("ADC mode: bipolar\n\n");
+    textRenderer_print("ADC mode: bipolar\n\n");
   }
 
   // Print out the number of unprocessed elements in ADC buffer.
-  display_print("Unprocessed elements in ADC buffer: ");
+  textRenderer_print("Unprocessed elements in ADC buffer: ");
   uint32_t remainingElementCount = buffer_elements();
-  display_printDecimalInt(remainingElementCount);
-  display_print("\n\n");
+  textRenderer_printDecimalInt(remainingElementCount);
+  textRenderer_print("\n\n");
 
   // Print out total running time in seconds.
-  double runningSeconds = intervalTimer_getTotalDurationInSeconds(TOTAL_RUNTIME_TIMER);
-  display_print("Measured run time in seconds: ");
-  sprintf(sprintfBuffer, "%.2f", runningSeconds);
-  display_print(sprintfBuffer);
-  display_print("\n\n");
+  double runningSeconds = runningModes_getRunSeconds();
+  textRenderer_print("Measured run time in seconds: ");
+  format_fixed(textBuffer, MAX_BUFFER_SIZE, runningSeconds, 2);
+  textRenderer_print(textBuffer);
+  textRenderer_print("\n\n");
 
   // Print out cumulative time spent in timer ISR.
   double isrRunningSeconds =
       intervalTimer_getTotalDurationInSeconds(ISR_CUMULATIVE_TIMER);
-  display_print("Cumulative run time in timer ISR: ");
-  sprintf(sprintfBuffer, "%.2f", isrRunningSeconds);
-  display_print(sprintfBuffer);
-  display_print(" (");
-  sprintf(sprintfBuffer, "%.2f", isrRunningSeconds / runningSeconds * 100);
-  display_print(sprintfBuffer);
-  display_print("%)\n\n");
+  textRenderer_print("Cumulative run time in timer ISR: ");
+  format_fixed(textBuffer, MAX_BUFFER_SIZE, isrRunningSeconds, 2);
+  textRenderer_print(textBuffer);
+  textRenderer_print(" (");
+  format_fixed(textBuffer, MAX_BUFFER_SIZE,
+               isrRunningSeconds / runningSeconds * 100, 2);
+  textRenderer_print(textBuffer);
+  textRenderer_print("%)\n\n");
 
   // Print out cumulative time spent in detector.
   double mainLoopRunningSeconds =
-      intervalTimer_getTotalDurationInSeconds(MAIN_CUMULATIVE_TIMER);
-  display_print("Cumulative run time in detector: ");
-  sprintf(sprintfBuffer, "%.2f", mainLoopRunningSeconds);
-  display_print(sprintfBuffer);
-  sprintf(sprintfBuffer, "%.2f",
-          mainLoopRunningSeconds / runningSeconds * 100);
-  display_print(" (");
-  display_print(sprintfBuffer);
-  display_print("%)\n\n");
+      profiler_ticksToSeconds(runningModes_mainTicks);
+  textRenderer_print("Cumulative run time in detector: ");
+  format_fixed(textBuffer, MAX_BUFFER_SIZE, mainLoopRunningSeconds, 2);
+  textRenderer_print(textBuffer);
+  format_fixed(textBuffer, MAX_BUFFER_SIZE,
+               mainLoopRunningSeconds / runningSeconds * 100, 2);
+  textRenderer_print(" (");
+  textRenderer_print(textBuffer);
+  textRenderer_print("%)\n\n");
 
   // Print out total interrupt count.
   uint32_t interruptCount = interrupts_isrInvocationCount();
-  display_print("Total interrupts: ");
-  display_printDecimalInt(interruptCount);
-  display_print("\n\n");
+  textRenderer_print("Total interrupts: ");
+  textRenderer_printDecimalInt(interruptCount);
+  textRenderer_print("\n\n");
 
   // Print out detector invocation statistics.
   uint32_t detectorInvocationCount = detector_getInvocationCount();
-  display_print("Detector invocation count: ");
-  display_printDecimalInt(detectorInvocationCount);
-  display_print("\n\n");
-
-  display_print("Detector invocations per second: ");
-  sprintf(sprintfBuffer, "%.0f", detectorInvocationCount / runningSeconds);
-  display_print(sprintfBuffer);
-  display_print("\n\n");
+  textRenderer_print("Detector invocation count: ");
+  textRenderer_printDecimalInt(detectorInvocationCount);
+  textRenderer_print("\n\n");
+
+  textRenderer_print("Detector invocations per second: ");
+  format_fixed(textBuffer, MAX_BUFFER_SIZE,
+               detectorInvocationCount / runningSeconds, 0);
+  textRenderer_print(textBuffer);
+  textRenderer_print("\n\n");
+
+  // Print out how the display kept up, if the UI scheduler drew it.
+  const uiScheduler_stats_t *uiStats = uiScheduler_getStats();
+  if (uiStats->frames > 0) {
+    textRenderer_print("UI frames per second: ");
+    format_fixed(textBuffer, MAX_BUFFER_SIZE,
+                 uiScheduler_getFramesPerSecond(), 1);
+    textRenderer_print(textBuffer);
+    textRenderer_print("\n\n");
+    textRenderer_print("Max ADC backlog: ");
+    textRenderer_printDecimalInt(uiStats->maxBacklog);
+    textRenderer_print(" (UI deferred ");
+    textRenderer_printDecimalInt(uiStats->deferrals);
+    textRenderer_print(" times)\n\n");
+  }
 
   // If the detector invocation rate is too low, inform the user.
   if (detectorInvocationCount / runningSeconds <
       SUGGESTED_DETECTOR_INVOCATIONS_PER_SECOND) {
-    display_setTextColor(RUNNING_MODE_WARNING_TEXT_COLOR);
-    display_setTextSize(RUNNING_MODE_WARNING_TEXT_SIZE);
-    display_print("Detector should be called\nat least ");
-    display_printDecimalInt(SUGGESTED_DETECTOR_INVOCATIONS_PER_SECOND);
-    display_print(" times per\nsecond.\n\n");
+    textRenderer_setTextColor(RUNNING_MODE_WARNING_TEXT_COLOR);
+    textRenderer_setTextSize(RUNNING_MODE_WARNING_TEXT_SIZE);
+    textRenderer_print("Detector should be called\nat least ");
+    textRenderer_printDecimalInt(SUGGESTED_DETECTOR_INVOCATIONS_PER_SECOND);
+    textRenderer_print(" times per\nsecond.\n\n");
   }
 
   // If the unprocessed element count is too high, inform the user.
   if (remainingElementCount >= SUGGESTED_REMAINING_ELEMENT_COUNT) {
-    display_setTextColor(RUNNING_MODE_WARNING_TEXT_COLOR);
-    display_setTextSize(RUNNING_MODE_WARNING_TEXT_SIZE);
-    display_print("ADC buffer should contain\nless than ");
-    display_printDecimalInt(SUGGESTED_REMAINING_ELEMENT_COUNT);
-    display_print(" elements.\n\n");
+    textRenderer_setTextColor(RUNNING_MODE_WARNING_TEXT_COLOR);
+    textRenderer_setTextSize(RUNNING_MODE_WARNING_TEXT_SIZE);
+    textRenderer_print("ADC buffer should contain\nless than ");
+    textRenderer_printDecimalInt(SUGGESTED_REMAINING_ELEMENT_COUNT);
+    textRenderer_print(" elements.\n\n");
   }
+
+  // Break the run time down by profiling scope on the console.
+  profiler_printReport(runningSeconds);
+  perfCounters_printReport(detector_getSampleCount() -
+                           runningModes_startSamples);
+  runningModes_dumpTrace();
+  runningModes_dumpSamples();
+}
+
+// The histogram as drawn by the UI scheduler in continuous mode.
+static void runningModes_beginHistogramFrame() {
+  double powerValues[FILTER_FREQUENCY_COUNT];
+  filter_getCurrentPowerValues(powerValues);
+  histogram_setUserFrequencyPower(powerValues);
+}
+
+static bool runningModes_drawHistogramChunk() {
+  PROFILER_BEGIN(runningModes_histogramProfileScope);
+  TRACE_BEGIN(TRACE_ID_HISTOGRAM, RUNNING_MODE_UI_ROWS_PER_CHUNK);
+  bool done = histogram_updateDisplayStep(RUNNING_MODE_UI_ROWS_PER_CHUNK);
+  TRACE_END(TRACE_ID_HISTOGRAM, done);
+  PROFILER_END(runningModes_histogramProfileScope);
+  return done;
 }
 
+static const uiScheduler_config_t runningModes_histogramUi = {
+    .periodSeconds = RUNNING_MODE_UI_FRAME_SECONDS,
+    .sliceSeconds = RUNNING_MODE_UI_SLICE_SECONDS,
+    .maxBacklog = RUNNING_MODE_UI_MAX_BACKLOG,
+    .clock = runningModes_getRunSeconds,
+    .beginFrame = runningModes_beginHistogramFrame,
+    .drawChunk = runningModes_drawHistogramChunk};
+
 // Group all of the inits together to reduce visual clutter.
 void runningModes_initAll(void) {
   // Assume mio, leds, buttons, switches, & display initialized previously
-  histogram_init(HISTOGRAM_BAR_COUNT);
-  filter_init();
-  detector_init();
   // isr_init() should include calls to: transmitter, trigger,
   // hitLedTimer, lockoutTimer, sound, and buffer init
+  // It goes first: sound_init() only starts the audio CODEC bring-up, which
+  // is advanced between the other inits while the CODEC settles.
   isr_init();
+  histogram_init(HISTOGRAM_BAR_COUNT);
+  sound_pollInit();
+  filter_init();
+  sound_pollInit();
+  detector_init();
+  sound_pollInit();
   intervalTimer_initAll();
+  sound_pollInit();
   // Init all interrupts (but does not enable the interrupts at the devices).
   // Call last
   interrupts_initAll(false); // A true argument enables error messages
+  // Finish the CODEC bring-up; this only waits out what is left of its
+  // settling time.
+  while (!sound_pollInit())
+    ;
+  if (sound_hasFailed())
+    printf("ERROR, runningModes_initAll: the audio CODEC failed to start; "
+           "continuing without sound.\n");
 }
 
 // Returns the current switch-setting
@@ -210,18 +359,11 @@ void runningModes_continuous(void) {
 #endif
   detector_setIgnoredFrequencies(ignoredFrequencies);
 
-  uint16_t histogramSystemTicks =
-      0; // Only update the histogram display every so many ticks.
+  // The histogram is redrawn by wall time, in slices between detector() calls.
+  uiScheduler_init(&runningModes_histogramUi);
   interrupts_enableTimerGlobalInts(); // Allow timer interrupts.
   interrupts_startArmPrivateTimer();  // Start the private ARM timer running.
-  intervalTimer_reset(
-      ISR_CUMULATIVE_TIMER); // Used to measure ISR execution time.
-  intervalTimer_reset(
-      TOTAL_RUNTIME_TIMER); // Used to measure total program execution time.
-  intervalTimer_reset(
-      MAIN_CUMULATIVE_TIMER); // Used to measure main-loop execution time.
-  intervalTimer_start(
-      TOTAL_RUNTIME_TIMER);   // Start measuring total execution time.
+  runningModes_startTiming();         // Start measuring execution time.
   interrupts_enableArmInts(); // ARM will now see interrupts after this.
 
   transmitter_setContinuousMode(true); // Run the transmitter continuously.
@@ -229,24 +371,13 @@ void runningModes_continuous(void) {
   while (!(buttons_read() &
            BUTTONS_BTN3_MASK)) { // Run until you detect BTN3 pressed.
     transmitter_setFrequencyNumber(runningModes_getFrequencySetting());
-    histogramSystemTicks++;    // Keep track of ticks so you know when to update
-                               // the histogram.
     // Run filters, compute power, etc.
-    intervalTimer_start(MAIN_CUMULATIVE_TIMER); // Measure run-time when you are
-                                                // doing something.
+    // Measure run-time when you are doing something.
+    profiler_ticks_t mainStartTicks = profiler_getTicks();
     detector(INTERRUPTS_CURRENTLY_ENABLED); // Interrupts are currently enabled.
-    intervalTimer_stop(MAIN_CUMULATIVE_TIMER);
-    // If enough ticks have transpired, update the histogram.
-    if (histogramSystemTicks >= SYSTEM_TICKS_PER_HISTOGRAM_UPDATE) {
-      double powerValues[FILTER_FREQUENCY_COUNT]; // Copy the current power
-                                                  // values to here.
-      filter_getCurrentPowerValues(
-          powerValues); // Copy the current power values.
-      histogram_plotUserFrequencyPower(
-          powerValues); // Plot the power values on the TFT.
-      histogramSystemTicks =
-          0; // Reset the tick count and wait for the next update time.
-    }
+    runningModes_mainTicks += profiler_getTicks() - mainStartTicks;
+    // Update the histogram if it is time and the detector is keeping up.
+    uiScheduler_service(buffer_elements());
   }
   interrupts_disableArmInts();           // Stop interrupts.
   hitLedTimer_turnLedOff();              // Save power :-)
@@ -276,14 +407,7 @@ void runningModes_shooter(void) {
   trigger_enable(); // Makes the state machine responsive to the trigger.
   interrupts_enableTimerGlobalInts(); // Allow timer interrupts.
   interrupts_startArmPrivateTimer();  // Start the private ARM timer running.
-  intervalTimer_reset(
-      ISR_CUMULATIVE_TIMER); // Used to measure ISR execution time.
-  intervalTimer_reset(
-      TOTAL_RUNTIME_TIMER); // Used to measure total program execution time.
-  intervalTimer_reset(
-      MAIN_CUMULATIVE_TIMER); // Used to measure main-loop execution time.
-  intervalTimer_start(
-      TOTAL_RUNTIME_TIMER);   // Start measuring total execution time.
+  runningModes_startTiming();         // Start measuring execution time.
   interrupts_enableArmInts(); // ARM will now see interrupts after this.
   lockoutTimer_start(); // Ignore erroneous hits at startup (when all power
                         // values are essentially 0).
@@ -293,8 +417,8 @@ void runningModes_shooter(void) {
     transmitter_setFrequencyNumber(
         runningModes_getFrequencySetting());    // Read the switches and switch
                                                 // frequency as required.
-    intervalTimer_start(MAIN_CUMULATIVE_TIMER); // Measure run-time when you are
-                                                // doing something.
+    // Measure run-time when you are doing something.
+    profiler_ticks_t mainStartTicks = profiler_getTicks();
     // Run filters, compute power, run hit-detection.
     detector(INTERRUPTS_CURRENTLY_ENABLED); // Interrupts are currently enabled.
     if (detector_hitDetected()) {           // Hit detected
@@ -303,10 +427,14 @@ void runningModes_shooter(void) {
       detector_hitCount_t
           hitCounts[DETECTOR_HIT_ARRAY_SIZE]; // Store the hit-counts here.
       detector_getHitCounts(hitCounts);       // Get the current hit counts.
-      histogram_plotUserHits(hitCounts);      // Plot the hit counts on the TFT.
+      PROFILER_BEGIN(runningModes_histogramProfileScope);
+      TRACE_BEGIN(TRACE_ID_HISTOGRAM, 0);
+      histogram_plotUserHits(hitCounts); // Plot the hit counts on the TFT.
+      TRACE_END(TRACE_ID_HISTOGRAM, 0);
+      PROFILER_END(runningModes_histogramProfileScope);
     }
-    intervalTimer_stop(
-        MAIN_CUMULATIVE_TIMER); // All done with actual processing.
+    // All done with actual processing.
+    runningModes_mainTicks += profiler_getTicks() - mainStartTicks;
   }
   interrupts_disableArmInts(); // Done with loop, disable the interrupts.
   hitLedTimer_turnLedOff();    // Save power :-)
@@ -317,6 +445,8 @@ void runningModes_shooter(void) {
 // This mode simply dumps raw ADC values to the console.
 // It can be used to determine if bipolar mode is working for the ADC.
 // Will loop forever. Stop the program with an external reset or Ctl-C.
+// printf() is far too slow to keep up with the sample rate; use
+// runningModes_captureRawAdcValues() to record the signal itself.
 void runningModes_dumpRawAdcValues(void) {
   runningModes_initAll();
 
@@ -332,3 +462,131 @@ void runningModes_dumpRawAdcValues(void) {
     printf("raw ADC value: %d\n", signExtendedValue);
   }
 }
+
+// Programs the private timer so the ISR samples the ADC at rateHz.
+static void runningModes_setSampleRate(uint32_t rateHz) {
+  interrupts_setPrivateTimerLoadValue(
+      RUNNING_MODE_PRIVATE_TIMER_CLOCK_HZ / rateHz - 1);
+}
+
+// One step of the sample-rate stress test: run the ISR at rateHz and call the
+// detector as fast as possible for the given number of seconds.
+static void runningModes_sampleRateStressStep(uint32_t rateHz, double seconds,
+                                              sampleRateStress_step_t *step) {
+  interrupts_disableArmInts(); // Change the rate with the ISR quiet.
+  runningModes_setSampleRate(rateHz);
+  buffer_init(); // Start each step with an empty ADC buffer.
+  uint32_t startIsrCount = interrupts_isrInvocationCount();
+  runningModes_startTiming();
+  interrupts_enableArmInts();
+
+  double elapsed = 0;
+  while (elapsed < seconds) {
+    profiler_ticks_t mainStartTicks = profiler_getTicks();
+    detector(INTERRUPTS_CURRENTLY_ENABLED);
+    runningModes_mainTicks += profiler_getTicks() - mainStartTicks;
+    elapsed = runningModes_getRunSeconds();
+    sampleRateStress_recordBacklog(step, buffer_elements(),
+                                   elapsed >= seconds / 2);
+  }
+
+  interrupts_disableArmInts();
+  step->seconds = runningModes_getRunSeconds();
+  step->measuredRateHz =
+      (interrupts_isrInvocationCount() - startIsrCount) / step->seconds;
+  step->producerUtilization =
+      intervalTimer_getTotalDurationInSeconds(ISR_CUMULATIVE_TIMER) /
+      step->seconds;
+  step->detectorUtilization =
+      profiler_ticksToSeconds(runningModes_mainTicks) / step->seconds;
+}
+
+// Ramps the ADC sample rate from well below 100 kHz until the detector can no
+// longer keep up and the ADC buffer grows without bound. Prints each step, the
+// maximum sustainable sample rate and the CPU utilization of each pipeline
+// stage to the console, and the maximum rate to the TFT. The transmitter is
+// not run. Restores the nominal sample rate before returning.
+void runningModes_sampleRateStress(void) {
+  char textBuffer[MAX_BUFFER_SIZE]; // Generic message buffer.
+  runningModes_initAll();
+
+  // Time each stage before the ISR starts touching the buffer.
+  sampleRateStress_stageCosts_t costs;
+  sampleRateStress_measureStageCosts(&costs, CALIBRATION_TIMER);
+  detector_init(); // Forget the calibration data.
+  detector_ignoreAllHits(true); // Only the processing load matters here.
+  sampleRateStress_printStageCosts(&costs, RUNNING_MODE_NOMINAL_SAMPLE_RATE_HZ);
+
+  interrupts_enableTimerGlobalInts(); // Allow timer interrupts.
+  interrupts_startArmPrivateTimer();  // Start the private ARM timer running.
+  uint32_t maxRateHz =
+      sampleRateStress_run(runningModes_sampleRateStressStep, &costs,
+                           SAMPLE_RATE_STRESS_MAX_RATE_HZ);
+  interrupts_disableArmInts();
+  runningModes_setSampleRate(RUNNING_MODE_NOMINAL_SAMPLE_RATE_HZ);
+  sampleRateStress_printStageCosts(&costs, maxRateHz);
+
+  textRenderer_setTextSize(RUNNING_MODE_NORMAL_TEXT_SIZE);
+  textRenderer_setTextColor(RUNNING_MODE_NORMAL_TEXT_COLOR);
+  textRenderer_setCursor(RUNNING_MODE_SCREEN_X_ORIGIN,
+                         RUNNING_MODE_SCREEN_Y_ORIGIN);
+  display_fillScreen(DISPLAY_BLACK);
+  textRenderer_clearCache();
+  textRenderer_print("Max sustainable sample rate (Hz): ");
+  textRenderer_printDecimalInt(maxRateHz);
+  textRenderer_print("\n\n");
+  format_fixed(textBuffer, MAX_BUFFER_SIZE,
+               costs.detectorSeconds * RUNNING_MODE_NANOSECONDS_PER_SECOND, 2);
+  textRenderer_print("Detector cost per sample (ns): ");
+  textRenderer_print(textBuffer);
+  textRenderer_print("\n\n");
+  printf("Sample-rate stress mode terminated.\n");
+}
+
+// Captures raw ADC samples at the full sample rate into RAM until the capture
+// ring is full or BTN3 is pressed, then streams them to the console UART as
+// binary frames (see adcCapture.h). Decode the stream on the host with
+// tools/adcCaptureDecode. The transmitter is not run.
+void runningModes_captureRawAdcValues(void) {
+  runningModes_initAll();
+  adcCapture_init(interrupts_getAdcInputMode() == INTERRUPTS_ADC_BIPOLAR_MODE);
+
+  textRenderer_setTextSize(RUNNING_MODE_NORMAL_TEXT_SIZE);
+  textRenderer_setTextColor(RUNNING_MODE_NORMAL_TEXT_COLOR);
+  textRenderer_setCursor(RUNNING_MODE_SCREEN_X_ORIGIN,
+                         RUNNING_MODE_SCREEN_Y_ORIGIN);
+  display_fillScreen(DISPLAY_BLACK);
+  textRenderer_clearCache();
+  textRenderer_print("Capturing ADC samples.\nPress BTN3 to stop early.\n\n");
+
+  interrupts_enableTimerGlobalInts(); // Allow timer interrupts.
+  interrupts_startArmPrivateTimer();  // Start the private ARM timer running.
+  interrupts_enableArmInts();         // The ISR fills the ADC buffer.
+  while (!(buttons_read() & BUTTONS_BTN3_MASK) && !adcCapture_isFull()) {
+    // Move everything the ISR has buffered into the capture ring.
+    uint32_t elementCount = buffer_elements();
+    for (uint32_t i = 0; i < elementCount; i++) {
+      interrupts_disableArmInts();
+      buffer_data_t rawAdcValue = buffer_pop();
+      interrupts_enableArmInts();
+      adcCapture_addSample(rawAdcValue);
+    }
+  }
+  interrupts_disableArmInts();
+  adcCapture_finish();
+
+  textRenderer_print("Streaming ");
+  textRenderer_printDecimalInt(adcCapture_getSampleCount());
+  textRenderer_print(" samples.\n\n");
+  // outbyte() sends the frames untouched; printf would translate newlines.
+  uint8_t frame[ADC_CAPTURE_MAX_FRAME_BYTES];
+  uint32_t frameLength;
+  while ((frameLength = adcCapture_takeFrame(frame))) {
+    for (uint32_t i = 0; i < frameLength; i++)
+      outbyte(frame[i]);
+  }
+  textRenderer_print("Done.\n");
+  printf("\nADC capture complete: %lu samples, %lu dropped.\n",
+         (unsigned long)adcCapture_getSampleCount(),
+         (unsigned long)adcCapture_getDroppedSampleCount());
+}
@@ -16,10 +16,10 @@ For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
 // Assumes the following:
 // detected interrupts is retrieved with interrupts_isrInvocationCount(),
 // interval_timer(0) is the cumulative run-time of the ISR,
-// interval_timer(1) is the total run-time,
-// interval_timer(2) is the time spent in main running the filters, updating the
-// display, and so forth. No comments in the code, the print statements are
-// self-explanatory.
+// the total run-time and the time spent in main running the filters,
+// updating the display, and so forth are read off the profiling counter since
+// the mode started. Also prints the profiling scopes on the console. No
+// comments in the code, the print statements are self-explanatory.
 void runningModes_printRunTimeStatistics(void);
 
 // Group all of the inits together to reduce visual clutter.
@@ -46,4 +46,16 @@ void runningModes_shooter(void);
 // Will loop forever. Stop the program with an external reset or Ctl-C.
 void runningModes_dumpRawAdcValues(void);
 
+// Captures raw ADC samples at the full sample rate into RAM until the capture
+// ring is full (about 10 s) or BTN3 is pressed, then streams them to the
+// console UART as CRC-checked binary frames. Decode the stream on the host with
+// tools/adcCaptureDecode to get a trace file for offline replay.
+void runningModes_captureRawAdcValues(void);
+
+// Ramps the ADC sample rate until the detector can no longer keep up and the
+// ADC buffer grows without bound. Reports the maximum sustainable sample rate
+// and the CPU utilization of each pipeline stage on the console, and the
+// maximum rate on the TFT. Restores the nominal 100 kHz rate when done.
+void runningModes_sampleRateStress(void);
+
 #endif /* RUNNINGMODES_H_ */
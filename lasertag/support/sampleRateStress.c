@@ -0,0 +1,254 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "buffer.h"
+#include "detector.h"
+#include "filter.h"
+#include "intervalTimer.h"
+#include "sampleRateStress.h"
+
+// 2000 decimated samples: one full power window.
+#define CALIBRATION_SAMPLES 20000
+#define CALIBRATION_DECIMATED_SAMPLES                                          \
+  (CALIBRATION_SAMPLES / FILTER_FIR_DECIMATION_FACTOR)
+#define CALIBRATION_PASSES 5
+
+// Synthetic calibration input: a +/-0.5 square wave, and the same thing as
+// 12-bit ADC values for the whole-detector run.
+#define CALIBRATION_HALF_PERIOD 16
+#define CALIBRATION_AMPLITUDE 0.5
+#define CALIBRATION_ADC_MIDSCALE 2048
+#define CALIBRATION_ADC_AMPLITUDE 1000
+
+// The backlog may grow by this many elements between the middle and the end
+// of a step before the step is considered unsustainable. This is the same
+// limit runningModes.c warns about, and it absorbs the jitter from samples
+// arriving while detector() runs.
+#define SUSTAINABLE_BACKLOG_GROWTH 500
+
+#define PERCENT 100.0
+#define NANOSECONDS_PER_SECOND 1e9
+#define NOMINAL_SAMPLE_RATE_HZ (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000.0)
+
+static double calibrationInput(uint32_t i) {
+  return ((i / CALIBRATION_HALF_PERIOD) % 2) ? -CALIBRATION_AMPLITUDE
+                                             : CALIBRATION_AMPLITUDE;
+}
+
+static buffer_data_t calibrationAdcValue(uint32_t i) {
+  return ((i / CALIBRATION_HALF_PERIOD) % 2)
+             ? CALIBRATION_ADC_MIDSCALE - CALIBRATION_ADC_AMPLITUDE
+             : CALIBRATION_ADC_MIDSCALE + CALIBRATION_ADC_AMPLITUDE;
+}
+
+// Returns the seconds accumulated on timerNumber and resets it.
+static double takeSeconds(uint32_t timerNumber) {
+  double seconds = intervalTimer_getTotalDurationInSeconds(timerNumber);
+  intervalTimer_reset(timerNumber);
+  return seconds;
+}
+
+// Times each stage once over CALIBRATION_SAMPLES.
+static void measurePass(sampleRateStress_stageCosts_t *costs,
+                        uint32_t timerNumber) {
+  intervalTimer_reset(timerNumber);
+
+  // Each stage is timed as a whole loop so the timer overhead is paid once.
+  intervalTimer_start(timerNumber);
+  for (uint32_t i = 0; i < CALIBRATION_SAMPLES; i++)
+    filter_addNewInput(calibrationInput(i));
+  intervalTimer_stop(timerNumber);
+  costs->inputSeconds = takeSeconds(timerNumber) / CALIBRATION_SAMPLES;
+
+  intervalTimer_start(timerNumber);
+  for (uint32_t i = 0; i < CALIBRATION_DECIMATED_SAMPLES; i++)
+    filter_firFilter();
+  intervalTimer_stop(timerNumber);
+  costs->firSeconds = takeSeconds(timerNumber) / CALIBRATION_SAMPLES;
+
+  intervalTimer_start(timerNumber);
+  for (uint32_t i = 0; i < CALIBRATION_DECIMATED_SAMPLES; i++)
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+      filter_iirFilter(f);
+  intervalTimer_stop(timerNumber);
+  costs->iirSeconds = takeSeconds(timerNumber) / CALIBRATION_SAMPLES;
+
+  // The detector only forces a power computation once, so time the
+  // incremental version.
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+    filter_computePower(f, true, false);
+  intervalTimer_start(timerNumber);
+  for (uint32_t i = 0; i < CALIBRATION_DECIMATED_SAMPLES; i++)
+    for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+      filter_computePower(f, false, false);
+  intervalTimer_stop(timerNumber);
+  costs->powerSeconds = takeSeconds(timerNumber) / CALIBRATION_SAMPLES;
+
+  // The whole detector, draining a buffer of calibration samples.
+  buffer_init();
+  for (uint32_t i = 0; i < CALIBRATION_SAMPLES; i++)
+    buffer_pushover(calibrationAdcValue(i));
+  detector_init();
+  intervalTimer_start(timerNumber);
+  detector(false);
+  intervalTimer_stop(timerNumber);
+  costs->detectorSeconds = takeSeconds(timerNumber) / CALIBRATION_SAMPLES;
+}
+
+static double minDouble(double a, double b) { return a < b ? a : b; }
+
+// Times each detector stage on synthetic input using interval timer
+// timerNumber. Nothing else may touch the buffer, filter or that timer while
+// this runs, so call it before interrupts are enabled. Leaves the filter full
+// of calibration data; call detector_init() afterwards.
+void sampleRateStress_measureStageCosts(sampleRateStress_stageCosts_t *costs,
+                                        uint32_t timerNumber) {
+  // Keep the fastest of several passes so a stray interrupt or cache miss
+  // does not get charged to a stage.
+  measurePass(costs, timerNumber);
+  for (uint16_t i = 1; i < CALIBRATION_PASSES; i++) {
+    sampleRateStress_stageCosts_t pass;
+    measurePass(&pass, timerNumber);
+    costs->inputSeconds = minDouble(costs->inputSeconds, pass.inputSeconds);
+    costs->firSeconds = minDouble(costs->firSeconds, pass.firSeconds);
+    costs->iirSeconds = minDouble(costs->iirSeconds, pass.iirSeconds);
+    costs->powerSeconds = minDouble(costs->powerSeconds, pass.powerSeconds);
+    costs->detectorSeconds =
+        minDouble(costs->detectorSeconds, pass.detectorSeconds);
+  }
+}
+
+// Clears step and records the requested rate. Call at the start of a step.
+void sampleRateStress_beginStep(sampleRateStress_step_t *step,
+                                uint32_t rateHz) {
+  memset(step, 0, sizeof(*step));
+  step->requestedRateHz = rateHz;
+}
+
+// Records the current ADC buffer backlog. secondHalf is true once the step is
+// half over, so the growth between the middle and the end can be judged.
+void sampleRateStress_recordBacklog(sampleRateStress_step_t *step,
+                                    uint32_t backlog, bool secondHalf) {
+  if (backlog > step->maxBacklog)
+    step->maxBacklog = backlog;
+  if (backlog >= buffer_size())
+    step->overflowed = true;
+  if (!secondHalf)
+    step->midBacklog = backlog;
+  step->endBacklog = backlog;
+}
+
+// Returns true if the detector kept up during the step: the buffer never
+// overflowed and the backlog did not keep growing in the second half.
+bool sampleRateStress_isSustainable(const sampleRateStress_step_t *step) {
+  if (step->overflowed)
+    return false;
+  return step->endBacklog <= step->midBacklog + SUSTAINABLE_BACKLOG_GROWTH;
+}
+
+static void printStepHeader(void) {
+  printf("%10s %12s %9s %9s %9s %9s %9s %9s  %s\n", "rate(Hz)", "actual(Hz)",
+         "producer%", "detector%", "predict%", "midQueue", "endQueue",
+         "maxQueue", "result");
+}
+
+static void printStep(const sampleRateStress_step_t *step,
+                      const sampleRateStress_stageCosts_t *costs) {
+  printf("%10u %12.0f %9.1f %9.1f %9.1f %9u %9u %9u  %s\n",
+         step->requestedRateHz, step->measuredRateHz,
+         step->producerUtilization * PERCENT,
+         step->detectorUtilization * PERCENT,
+         step->measuredRateHz * costs->detectorSeconds * PERCENT,
+         step->midBacklog, step->endBacklog, step->maxBacklog,
+         sampleRateStress_isSustainable(step)
+             ? "ok"
+             : (step->overflowed ? "OVERFLOW" : "GROWING"));
+}
+
+// Runs a step, prints it and returns whether it was sustainable.
+static bool runStep(sampleRateStress_stepFunction_t stepFunction,
+                    const sampleRateStress_stageCosts_t *costs,
+                    uint32_t rateHz) {
+  sampleRateStress_step_t step;
+  sampleRateStress_beginStep(&step, rateHz);
+  stepFunction(rateHz, SAMPLE_RATE_STRESS_STEP_SECONDS, &step);
+  printStep(&step, costs);
+  fflush(stdout); // Steps are slow; show progress as it happens.
+  return sampleRateStress_isSustainable(&step);
+}
+
+// Ramps the rate with stepFunction up to maxRateHz, printing each step, and
+// returns the highest sustainable rate found (0 if even the start rate is too
+// fast).
+uint32_t sampleRateStress_run(sampleRateStress_stepFunction_t stepFunction,
+                              const sampleRateStress_stageCosts_t *costs,
+                              uint32_t maxRateHz) {
+  uint32_t goodRate = 0;
+  uint32_t badRate = 0;
+  printStepHeader();
+  // Coarse ramp until the backlog starts to grow.
+  for (uint32_t rate = SAMPLE_RATE_STRESS_START_RATE_HZ;
+       rate <= maxRateHz;
+       rate += rate * SAMPLE_RATE_STRESS_RAMP_PERCENT / 100) {
+    if (!runStep(stepFunction, costs, rate)) {
+      badRate = rate;
+      break;
+    }
+    goodRate = rate;
+  }
+  if (!badRate) {
+    printf("Sustained every rate up to %u Hz.\n", goodRate);
+  } else if (goodRate) {
+    // Refine by bisection between the last good and first bad rate.
+    for (uint16_t i = 0; i < SAMPLE_RATE_STRESS_REFINE_STEPS; i++) {
+      uint32_t rate = goodRate + (badRate - goodRate) / 2;
+      if (runStep(stepFunction, costs, rate))
+        goodRate = rate;
+      else
+        badRate = rate;
+    }
+  }
+  printf("Maximum sustainable sample rate: %u Hz (%.2fx the nominal %.0f "
+         "Hz)\n",
+         goodRate, goodRate / NOMINAL_SAMPLE_RATE_HZ, NOMINAL_SAMPLE_RATE_HZ);
+  return goodRate;
+}
+
+static void printStageCost(const char *name, double seconds, uint32_t rateHz) {
+  printf("%-10s %10.1f %11.2f\n", name, seconds * NANOSECONDS_PER_SECOND,
+         seconds * rateHz * PERCENT);
+}
+
+// Prints the calibrated cost and the predicted utilization of each stage at
+// rateHz.
+void sampleRateStress_printStageCosts(const sampleRateStress_stageCosts_t *costs,
+                                      uint32_t rateHz) {
+  // Buffer pops, ADC scaling and hit detection are whatever is left over.
+  double otherSeconds = costs->detectorSeconds - costs->inputSeconds -
+                        costs->firSeconds - costs->iirSeconds -
+                        costs->powerSeconds;
+  if (otherSeconds < 0)
+    otherSeconds = 0;
+  printf("Per-stage cost, and CPU utilization at %u Hz:\n", rateHz);
+  printf("%-10s %10s %11s\n", "stage", "ns/sample", "cpu%");
+  printStageCost("input", costs->inputSeconds, rateHz);
+  printStageCost("fir", costs->firSeconds, rateHz);
+  printStageCost("iir", costs->iirSeconds, rateHz);
+  printStageCost("power", costs->powerSeconds, rateHz);
+  printStageCost("other", otherSeconds, rateHz);
+  printStageCost("detector", costs->detectorSeconds, rateHz);
+  if (costs->detectorSeconds > 0)
+    printf("The detector alone could sustain %.0f Hz.\n",
+           1.0 / costs->detectorSeconds);
+}
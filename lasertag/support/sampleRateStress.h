@@ -0,0 +1,94 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Finds how much sample-rate headroom the detection pipeline has.
+// The sample rate is ramped up until the ADC buffer grows without bound, then
+// refined by bisection. Each step is run by a platform-specific step function:
+// runningModes_sampleRateStress() reprograms the private timer on the board
+// and tools/sampleRateStress.c paces a synthetic producer by wall time on the
+// host. The calibration, ramp and reporting code here is shared.
+
+#ifndef SAMPLERATESTRESS_H_
+#define SAMPLERATESTRESS_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#define SAMPLE_RATE_STRESS_START_RATE_HZ 50000
+// The XADC cannot convert faster than 1 MSPS. Past that the board's ISR reads
+// the same conversion again, so a rate it sustains says nothing. The host
+// tool raises the limit.
+#define SAMPLE_RATE_STRESS_MAX_RATE_HZ 1000000
+// Each coarse step raises the rate by this many percent.
+#define SAMPLE_RATE_STRESS_RAMP_PERCENT 25
+// Bisection steps between the last good and first bad coarse rates.
+#define SAMPLE_RATE_STRESS_REFINE_STEPS 4
+#define SAMPLE_RATE_STRESS_STEP_SECONDS 1.0
+
+// Seconds spent per input sample in each stage of the detector, measured by
+// sampleRateStress_measureStageCosts(). Stages that run once per decimated
+// sample are already divided by the decimation factor.
+typedef struct {
+  double inputSeconds;    // filter_addNewInput().
+  double firSeconds;      // filter_firFilter().
+  double iirSeconds;      // filter_iirFilter(), all frequencies.
+  double powerSeconds;    // filter_computePower(), all frequencies.
+  double detectorSeconds; // All of detector(), including the above.
+} sampleRateStress_stageCosts_t;
+
+// What happened during one step of the ramp.
+typedef struct {
+  uint32_t requestedRateHz;
+  double measuredRateHz;      // Samples actually produced per second.
+  double seconds;             // Wall time of the step.
+  double producerUtilization; // Fraction of time in the ISR or producer.
+  double detectorUtilization; // Fraction of time in detector().
+  uint32_t midBacklog;        // ADC buffer elements halfway through.
+  uint32_t endBacklog;        // ADC buffer elements at the end.
+  uint32_t maxBacklog;        // Largest backlog seen.
+  bool overflowed;            // The ADC buffer filled and dropped samples.
+} sampleRateStress_step_t;
+
+// Runs one step at rateHz for about seconds and fills in step.
+typedef void (*sampleRateStress_stepFunction_t)(uint32_t rateHz, double seconds,
+                                               sampleRateStress_step_t *step);
+
+// Times each detector stage on synthetic input using interval timer
+// timerNumber. Nothing else may touch the buffer, filter or that timer while
+// this runs, so call it before interrupts are enabled. Leaves the filter full
+// of calibration data; call detector_init() afterwards.
+void sampleRateStress_measureStageCosts(sampleRateStress_stageCosts_t *costs,
+                                        uint32_t timerNumber);
+
+// Clears step and records the requested rate. Call at the start of a step.
+void sampleRateStress_beginStep(sampleRateStress_step_t *step,
+                                uint32_t rateHz);
+
+// Records the current ADC buffer backlog. secondHalf is true once the step is
+// half over, so the growth between the middle and the end can be judged.
+void sampleRateStress_recordBacklog(sampleRateStress_step_t *step,
+                                    uint32_t backlog, bool secondHalf);
+
+// Returns true if the detector kept up during the step: the buffer never
+// overflowed and the backlog did not keep growing in the second half.
+bool sampleRateStress_isSustainable(const sampleRateStress_step_t *step);
+
+// Ramps the rate with stepFunction up to maxRateHz, printing each step, and
+// returns the highest sustainable rate found (0 if even the start rate is too
+// fast).
+uint32_t sampleRateStress_run(sampleRateStress_stepFunction_t stepFunction,
+                              const sampleRateStress_stageCosts_t *costs,
+                              uint32_t maxRateHz);
+
+// Prints the calibrated cost and the predicted utilization of each stage at
+// rateHz.
+void sampleRateStress_printStageCosts(const sampleRateStress_stageCosts_t *costs,
+                                      uint32_t rateHz);
+
+#endif /* SAMPLERATESTRESS_H_ */
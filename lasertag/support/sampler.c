@@ -0,0 +1,282 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef ZYBO_BOARD
+#define _GNU_SOURCE // For the register names in ucontext.h.
+#endif
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "sampler.h"
+
+#if SAMPLER_ENABLED
+
+#include "crc16.h"
+
+#ifdef ZYBO_BOARD
+#include "interrupts.h"
+#include "xil_exception.h"
+// IRQHandler in the BSP's asm_vectors.S starts with stmdb sp!, {r0-r3, r12,
+// lr} on the empty IRQ stack, so the word just below __irq_stack (lscript.ld)
+// is lr_irq: the interrupted instruction plus 4.
+#define SAMPLER_IRQ_LR_OFFSET 4
+extern uint32_t __irq_stack[];
+#else
+#include <signal.h>
+#include <sys/time.h>
+#include <time.h>
+#include <ucontext.h>
+#define SAMPLER_US_PER_SECOND 1000000
+#define SAMPLER_NS_PER_SECOND 1e9
+#endif
+
+#define SAMPLER_MAX_PROBES 32
+#define SAMPLER_HASH_MULTIPLIER 2654435761u // Knuth's, 2^32 / golden ratio.
+#define SAMPLER_INSTRUCTION_BYTES 4
+#define BYTE_MASK 0xFF
+#define BITS_PER_BYTE 8
+
+// Frame field offsets, see sampler.h.
+#define FRAME_VERSION_OFFSET 4
+#define FRAME_TYPE_OFFSET 5
+#define FRAME_LENGTH_OFFSET 6
+#define FRAME_SEQUENCE_OFFSET 8
+
+typedef struct {
+  uintptr_t pc;
+  uint32_t count; // 0 for a free entry.
+} sampler_entry_t;
+
+static sampler_entry_t sampler_table[SAMPLER_TABLE_ENTRIES];
+static volatile bool sampler_running;
+static volatile uint32_t sampler_samples;
+static volatile uint32_t sampler_dropped;
+
+// Dump position, set by sampler_stop().
+static bool sampler_dumpReady;
+static uint32_t sampler_takeSequence; // Next frame; 0 is the header.
+static uint32_t sampler_takeIndex;    // Next table entry to look at.
+static uint32_t sampler_usedEntries;
+
+#ifdef ZYBO_BOARD
+static Xil_ExceptionHandler sampler_gicHandler;
+
+// Takes the IRQ exception in place of the GIC handler, which it then calls.
+static void sampler_irqHandler(void *data) {
+  if (sampler_running)
+    sampler_record(__irq_stack[-1] - SAMPLER_IRQ_LR_OFFSET);
+  sampler_gicHandler(data);
+}
+
+// Puts sampler_irqHandler() in front of the registered IRQ handler, unless
+// it already is. It stays there when sampling stops, at the cost of a test.
+static void sampler_installHandler() {
+  Xil_ExceptionHandler handler;
+  void *data;
+  Xil_GetExceptionRegisterHandler(XIL_EXCEPTION_ID_IRQ_INT, &handler, &data);
+  if (handler == sampler_irqHandler)
+    return;
+  sampler_gicHandler = handler;
+  // The data is the GIC's, unchanged, so an interrupt in the middle of the
+  // update calls either handler correctly.
+  Xil_ExceptionRegisterHandler(XIL_EXCEPTION_ID_IRQ_INT, sampler_irqHandler,
+                               data);
+}
+
+static uint32_t sampler_getRate() {
+  return interrupts_getPrivateTimerTicksPerSecond();
+}
+#else
+// Returns the program counter the signal interrupted, or 0 on a processor
+// this does not know.
+static uintptr_t sampler_getSignalPc(const ucontext_t *context) {
+#if defined(__x86_64__)
+  return context->uc_mcontext.gregs[REG_RIP];
+#elif defined(__i386__)
+  return context->uc_mcontext.gregs[REG_EIP];
+#elif defined(__aarch64__)
+  return context->uc_mcontext.pc;
+#elif defined(__arm__)
+  return context->uc_mcontext.arm_pc;
+#else
+  (void)context;
+  return 0;
+#endif
+}
+
+static void sampler_handleSignal(int signal, siginfo_t *info, void *context) {
+  (void)signal;
+  (void)info;
+  if (sampler_running)
+    sampler_record(sampler_getSignalPc(context));
+}
+
+// Sends SIGPROF every 1 / SAMPLER_HOST_RATE_HZ s of CPU time, or stops it.
+static void sampler_setTimer(bool on) {
+  struct itimerval timer;
+  memset(&timer, 0, sizeof(timer));
+  if (on) {
+    timer.it_interval.tv_usec = SAMPLER_US_PER_SECOND / SAMPLER_HOST_RATE_HZ;
+    timer.it_value = timer.it_interval;
+  }
+  setitimer(ITIMER_PROF, &timer, NULL);
+}
+
+static void sampler_installHandler() {
+  struct sigaction action;
+  memset(&action, 0, sizeof(action));
+  action.sa_sigaction = sampler_handleSignal;
+  action.sa_flags = SA_SIGINFO | SA_RESTART;
+  sigemptyset(&action.sa_mask);
+  sigaction(SIGPROF, &action, NULL);
+}
+
+static double sampler_getCpuSeconds() {
+  struct timespec now;
+  clock_gettime(CLOCK_PROCESS_CPUTIME_ID, &now);
+  return now.tv_sec + now.tv_nsec / SAMPLER_NS_PER_SECOND;
+}
+
+static double sampler_cpuSeconds; // From sampler_start() to sampler_stop().
+
+// The kernel delivers SIGPROF on its scheduler tick, which is often slower
+// than SAMPLER_HOST_RATE_HZ, so this is the rate that was achieved.
+static uint32_t sampler_getRate() {
+  if (sampler_cpuSeconds <= 0.0 || sampler_samples == 0)
+    return SAMPLER_HOST_RATE_HZ;
+  return (uint32_t)(sampler_samples / sampler_cpuSeconds + 0.5);
+}
+#endif
+
+// Empties the table and starts sampling. On the board, call it after
+// interrupts_initAll().
+void sampler_start() {
+  sampler_running = false;
+  memset(sampler_table, 0, sizeof(sampler_table));
+  sampler_samples = 0;
+  sampler_dropped = 0;
+  sampler_dumpReady = false;
+  sampler_installHandler();
+  sampler_running = true;
+#ifndef ZYBO_BOARD
+  sampler_cpuSeconds = sampler_getCpuSeconds();
+  sampler_setTimer(true);
+#endif
+}
+
+// Stops sampling and readies the table to be taken by sampler_takeFrame().
+void sampler_stop() {
+#ifndef ZYBO_BOARD
+  sampler_setTimer(false);
+  sampler_cpuSeconds = sampler_getCpuSeconds() - sampler_cpuSeconds;
+#endif
+  sampler_running = false;
+  sampler_usedEntries = 0;
+  for (uint32_t i = 0; i < SAMPLER_TABLE_ENTRIES; i++)
+    sampler_usedEntries += sampler_table[i].count ? 1 : 0;
+  sampler_takeIndex = 0;
+  sampler_takeSequence = 0;
+  sampler_dumpReady = true;
+}
+
+// Counts a sample at pc. Called by the interrupt or signal handler; public
+// for tests.
+void sampler_record(uintptr_t pc) {
+  sampler_samples++;
+  uint32_t index =
+      (uint32_t)(pc / SAMPLER_INSTRUCTION_BYTES) * SAMPLER_HASH_MULTIPLIER;
+  for (uint16_t probe = 0; probe < SAMPLER_MAX_PROBES; probe++) {
+    sampler_entry_t *entry =
+        &sampler_table[(index + probe) & (SAMPLER_TABLE_ENTRIES - 1)];
+    if (entry->count == 0)
+      entry->pc = pc;
+    if (entry->pc == pc) {
+      entry->count++;
+      return;
+    }
+  }
+  sampler_dropped++;
+}
+
+// Returns the number of samples taken since sampler_start(), including those
+// dropped.
+uint32_t sampler_getSampleCount() { return sampler_samples; }
+
+// Returns the number of samples dropped because their address found no room
+// in the table.
+uint32_t sampler_getDroppedCount() { return sampler_dropped; }
+
+// Stores value little-endian in byteCount bytes starting at data.
+static void putLittleEndian(uint8_t *data, uint64_t value, uint16_t byteCount) {
+  for (uint16_t i = 0; i < byteCount; i++)
+    data[i] = (value >> (i * BITS_PER_BYTE)) & BYTE_MASK;
+}
+
+// Writes the header payload at payload and returns its length.
+static uint32_t sampler_putHeader(uint8_t *payload) {
+  putLittleEndian(&payload[0], sampler_getRate(), sizeof(uint32_t));
+  putLittleEndian(&payload[4], sampler_samples, sizeof(uint32_t));
+  putLittleEndian(&payload[8], sampler_dropped, sizeof(uint32_t));
+  putLittleEndian(&payload[12], sampler_usedEntries, sizeof(uint32_t));
+  putLittleEndian(&payload[16], (uintptr_t)sampler_start, sizeof(uint64_t));
+  return SAMPLER_HEADER_PAYLOAD_BYTES;
+}
+
+// Writes up to SAMPLER_FRAME_ENTRIES used entries at payload and returns the
+// length.
+static uint32_t sampler_putEntries(uint8_t *payload) {
+  uint32_t length = 0;
+  for (uint16_t i = 0; i < SAMPLER_FRAME_ENTRIES &&
+                       sampler_takeIndex < SAMPLER_TABLE_ENTRIES;
+       sampler_takeIndex++) {
+    const sampler_entry_t *entry = &sampler_table[sampler_takeIndex];
+    if (entry->count == 0)
+      continue;
+    putLittleEndian(&payload[length], entry->pc, sizeof(uint64_t));
+    putLittleEndian(&payload[length + 8], entry->count, sizeof(uint32_t));
+    length += SAMPLER_ENTRY_BYTES;
+    i++;
+  }
+  return length;
+}
+
+// Encodes the next frame of the dump into frame, which must hold
+// SAMPLER_MAX_FRAME_BYTES: the header first, then the table. Returns the
+// frame length in bytes, or 0 once the dump is done. Call sampler_stop()
+// first.
+uint32_t sampler_takeFrame(uint8_t frame[]) {
+  if (!sampler_dumpReady)
+    return 0;
+  bool header = sampler_takeSequence == 0;
+  uint32_t payloadLength =
+      header ? sampler_putHeader(&frame[SAMPLER_FRAME_HEADER_BYTES])
+             : sampler_putEntries(&frame[SAMPLER_FRAME_HEADER_BYTES]);
+  if (payloadLength == 0) {
+    sampler_dumpReady = false;
+    return 0;
+  }
+  putLittleEndian(frame, SAMPLER_SYNC_WORD, SAMPLER_SYNC_BYTES);
+  frame[FRAME_VERSION_OFFSET] = SAMPLER_FORMAT_VERSION;
+  frame[FRAME_TYPE_OFFSET] =
+      header ? SAMPLER_HEADER_FRAME : SAMPLER_SAMPLES_FRAME;
+  putLittleEndian(&frame[FRAME_LENGTH_OFFSET], payloadLength,
+                  sizeof(uint16_t));
+  putLittleEndian(&frame[FRAME_SEQUENCE_OFFSET], sampler_takeSequence++,
+                  sizeof(uint32_t));
+  uint32_t length = SAMPLER_FRAME_HEADER_BYTES + payloadLength;
+  // The sync word is left out of the CRC, as in adcCapture.c.
+  uint16_t crc =
+      crc16_compute(&frame[SAMPLER_SYNC_BYTES], length - SAMPLER_SYNC_BYTES);
+  putLittleEndian(&frame[length], crc, SAMPLER_FRAME_CRC_BYTES);
+  return length + SAMPLER_FRAME_CRC_BYTES;
+}
+
+#endif /* SAMPLER_ENABLED */
@@ -0,0 +1,109 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// A statistical profiler: every timer interrupt records where the main loop
+// was interrupted, and the count for each program counter is kept in a RAM
+// table. That covers what no profiler scope brackets, such as printf, the
+// display driver and the soft-float helpers. The table is streamed to a host
+// afterwards and tools/samplerReport turns it into a flat profile by
+// looking the addresses up in lasertag.elf.
+//
+// On the board the timer ISR itself is in the prebuilt libzybo, so
+// sampler_start() wraps the IRQ handler registered by interrupts_initAll():
+// the wrapper records the interrupted program counter, which the BSP's
+// IRQHandler has just saved at the top of the IRQ stack, and then calls the
+// GIC handler as before. The timer is the only interrupt source, so samples
+// come at its 100 kHz. Code that runs with interrupts masked is charged to
+// the instruction that unmasks them. On the host the samples come from a
+// SIGPROF timer instead, asked for every 1 / SAMPLER_HOST_RATE_HZ s of CPU
+// time; the kernel may send fewer, so the dump gives the rate achieved.
+//
+// Frame layout, as in trace.h:
+//   offset  size  field
+//        0     4  sync word SAMPLER_SYNC_WORD (bytes 50 53 C3 3C)
+//        4     1  format version SAMPLER_FORMAT_VERSION
+//        5     1  frame type (SAMPLER_*_FRAME)
+//        6     2  payload length n
+//        8     4  frame sequence number, from 0 for the header
+//       12     n  payload
+//     12+n     2  CRC-16/CCITT-FALSE of bytes 4 .. 12+n-1
+// Payloads, little-endian:
+//   header   samples per second (4), samples taken (4), samples dropped
+//            because the table was full (4), addresses in this dump (4), the
+//            run-time address of sampler_start() (8), which lets the report
+//            line up a position-independent host executable with its symbols
+//   samples  up to SAMPLER_FRAME_ENTRIES entries of address (8) and sample
+//            count (4)
+//
+// Sampling is off unless built with -DSAMPLER_ENABLED=1; otherwise the calls
+// compile to nothing and the table takes no RAM.
+
+#ifndef SAMPLER_H_
+#define SAMPLER_H_
+
+#include <stdint.h>
+
+#ifndef SAMPLER_ENABLED
+#define SAMPLER_ENABLED 0
+#endif
+
+// Distinct program counters the table can hold, a power of two. A run
+// touches a few hundred; the rest keeps the probes short.
+#define SAMPLER_TABLE_ENTRIES 4096
+#define SAMPLER_HOST_RATE_HZ 1000
+
+#define SAMPLER_SYNC_WORD 0x3CC35350
+#define SAMPLER_SYNC_BYTES 4
+#define SAMPLER_FORMAT_VERSION 1
+#define SAMPLER_HEADER_FRAME 1
+#define SAMPLER_SAMPLES_FRAME 2
+#define SAMPLER_FRAME_HEADER_BYTES 12
+#define SAMPLER_FRAME_CRC_BYTES 2
+#define SAMPLER_HEADER_PAYLOAD_BYTES 24
+#define SAMPLER_ENTRY_BYTES 12
+#define SAMPLER_FRAME_ENTRIES 128
+#define SAMPLER_MAX_FRAME_BYTES                                                \
+  (SAMPLER_FRAME_HEADER_BYTES + SAMPLER_FRAME_ENTRIES * SAMPLER_ENTRY_BYTES +  \
+   SAMPLER_FRAME_CRC_BYTES)
+
+#if SAMPLER_ENABLED
+
+// Empties the table and starts sampling. On the board, call it after
+// interrupts_initAll().
+void sampler_start();
+
+// Stops sampling and readies the table to be taken by sampler_takeFrame().
+void sampler_stop();
+
+// Counts a sample at pc. Called by the interrupt or signal handler; public
+// for tests.
+void sampler_record(uintptr_t pc);
+
+// Returns the number of samples taken since sampler_start(), including those
+// dropped.
+uint32_t sampler_getSampleCount();
+
+// Returns the number of samples dropped because their address found no room
+// in the table.
+uint32_t sampler_getDroppedCount();
+
+// Encodes the next frame of the dump into frame, which must hold
+// SAMPLER_MAX_FRAME_BYTES: the header first, then the table. Returns the
+// frame length in bytes, or 0 once the dump is done. Call sampler_stop()
+// first.
+uint32_t sampler_takeFrame(uint8_t frame[]);
+
+#else
+
+#define sampler_start() ((void)0)
+#define sampler_stop() ((void)0)
+
+#endif /* SAMPLER_ENABLED */
+
+#endif /* SAMPLER_H_ */
@@ -0,0 +1,145 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "bluetooth.h"
+#include "cobs.h"
+#include "crc16.h"
+#include "telemetry.h"
+
+#define VARINT_PAYLOAD_BITS 7
+#define VARINT_PAYLOAD_MASK 0x7F
+#define VARINT_CONTINUE 0x80
+#define BYTE_MASK 0xFF
+#define BITS_PER_BYTE 8
+
+static uint8_t nextSequence;
+static bool keyDue;            // The next powers packet must be a key.
+static uint8_t powersSinceKey; // Powers packets sent since the last key.
+// Codes in the last powers packet, the base for the next delta.
+static uint32_t sentCodes[FILTER_FREQUENCY_COUNT];
+static uint32_t droppedFrameCount;
+
+// Restarts the sequence numbers and makes the next powers packet a key.
+void telemetry_init() {
+  nextSequence = 0;
+  keyDue = true;
+  powersSinceKey = 0;
+  droppedFrameCount = 0;
+}
+
+// Makes the next powers packet a key, e.g. after a frame could not be queued.
+void telemetry_requestKey() { keyDue = true; }
+
+// Converts a power to its log-scale code. Negative powers are sent as 0.
+uint32_t telemetry_powerToCode(double power) {
+  if (!(power > 0.0))
+    return 0;
+  return (uint32_t)lround(log2(1.0 + power) * TELEMETRY_POWER_STEPS_PER_OCTAVE);
+}
+
+// Converts a code back to the power it stands for.
+double telemetry_codeToPower(uint32_t code) {
+  return exp2((double)code / TELEMETRY_POWER_STEPS_PER_OCTAVE) - 1.0;
+}
+
+// Appends value to packet at offset as a varint. Returns the new offset.
+static uint32_t putVarint(uint8_t packet[], uint32_t offset, uint32_t value) {
+  while (value > VARINT_PAYLOAD_MASK) {
+    packet[offset++] = (value & VARINT_PAYLOAD_MASK) | VARINT_CONTINUE;
+    value >>= VARINT_PAYLOAD_BITS;
+  }
+  packet[offset++] = value;
+  return offset;
+}
+
+// Maps small signed values to small unsigned ones: 0, -1, 1, -2 ... become
+// 0, 1, 2, 3 ...
+static uint32_t zigzag(int32_t value) {
+  return ((uint32_t)value << 1) ^ (uint32_t)(value >> 31);
+}
+
+// Writes the header of a packet of the given type. Returns the payload offset.
+static uint32_t startPacket(uint8_t packet[], uint8_t type) {
+  packet[0] = type;
+  packet[1] = nextSequence++;
+  return TELEMETRY_HEADER_BYTES;
+}
+
+// Appends the CRC to the length-byte packet and frames it into frame. Returns
+// the frame length.
+static uint32_t finishPacket(uint8_t packet[], uint32_t length,
+                             uint8_t frame[]) {
+  uint16_t crc = crc16_compute(packet, length);
+  packet[length++] = crc & BYTE_MASK;
+  packet[length++] = crc >> BITS_PER_BYTE;
+  uint32_t frameLength = cobs_encode(packet, length, frame);
+  frame[frameLength++] = COBS_DELIMITER;
+  return frameLength;
+}
+
+// Encodes the FILTER_FREQUENCY_COUNT powers as a key or delta packet. Deltas
+// are taken against the codes last sent, not the powers, so rounding does not
+// build up at the receiver. Returns the frame length.
+uint32_t telemetry_encodePowers(const double powers[], uint8_t frame[]) {
+  uint8_t packet[TELEMETRY_MAX_PACKET_BYTES];
+  bool key = keyDue || powersSinceKey >= TELEMETRY_KEY_INTERVAL - 1;
+  uint32_t length = startPacket(packet, key ? TELEMETRY_POWERS_KEY_MESSAGE
+                                            : TELEMETRY_POWERS_DELTA_MESSAGE);
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    uint32_t code = telemetry_powerToCode(powers[i]);
+    length = putVarint(packet, length,
+                       key ? code : zigzag((int32_t)(code - sentCodes[i])));
+    sentCodes[i] = code;
+  }
+  powersSinceKey = key ? 0 : powersSinceKey + 1;
+  keyDue = false;
+  return finishPacket(packet, length, frame);
+}
+
+// Encodes one hit event. Returns the frame length.
+uint32_t telemetry_encodeHit(const detector_hitEvent_t *hit, uint8_t frame[]) {
+  uint8_t packet[TELEMETRY_MAX_PACKET_BYTES];
+  uint32_t length = startPacket(packet, TELEMETRY_HIT_MESSAGE);
+  length = putVarint(packet, length, hit->sampleIndex);
+  length = putVarint(packet, length, hit->frequencyNumber);
+  length = putVarint(packet, length, telemetry_powerToCode(hit->peakPower));
+  length = putVarint(packet, length, telemetry_powerToCode(hit->powerRatio));
+  return finishPacket(packet, length, frame);
+}
+
+// Encodes the counters in stats. Returns the frame length.
+uint32_t telemetry_encodeStats(const telemetry_stats_t *stats,
+                               uint8_t frame[]) {
+  uint8_t packet[TELEMETRY_MAX_PACKET_BYTES];
+  uint32_t length = startPacket(packet, TELEMETRY_STATS_MESSAGE);
+  length = putVarint(packet, length, stats->uptimeMs);
+  length = putVarint(packet, length, stats->sampleCount);
+  length = putVarint(packet, length, stats->hitCount);
+  length = putVarint(packet, length, stats->droppedHits);
+  length = putVarint(packet, length, stats->droppedFrames);
+  return finishPacket(packet, length, frame);
+}
+
+// Queues a frame on the bluetooth UART if all of it fits. Returns false if it
+// did not, in which case it is dropped and the next powers packet is a key.
+// Part of a frame would run into the next one and spoil both.
+bool telemetry_sendFrame(uint8_t frame[], uint32_t length) {
+  if (bluetooth_transmitQueueSpace() >= length &&
+      bluetooth_transmitQueueWrite(frame, length) == length)
+    return true;
+  droppedFrameCount++;
+  keyDue = true;
+  return false;
+}
+
+// Returns the number of frames telemetry_sendFrame() has dropped.
+uint32_t telemetry_getDroppedFrameCount() { return droppedFrameCount; }
@@ -0,0 +1,115 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+// Compact binary telemetry for the bluetooth UART, which only carries about
+// 960 bytes a second at 9600 baud. The encoder (telemetry.c) runs on the
+// board and builds one frame per message, and telemetry_sendFrame() queues
+// it on the bluetooth UART (see bluetooth.h). The decoder (telemetryDecoder.c)
+// turns the received byte stream back into messages and also builds on the
+// host.
+//
+// Packet layout, before framing:
+//   offset  size  field
+//        0     1  message type (TELEMETRY_*_MESSAGE)
+//        1     1  sequence number, +1 for every packet sent
+//        2     n  payload, a series of varints
+//      2+n     2  CRC-16/CCITT-FALSE of bytes 0 .. 2+n-1, little-endian
+// Each packet is COBS-encoded and followed by a 0x00 delimiter (see cobs.h).
+// Varints are unsigned LEB128: 7 bits a byte, low bits first, top bit set on
+// every byte but the last. Signed values are zigzag-encoded first.
+//
+// Powers are sent as log-scale codes, TELEMETRY_POWER_STEPS_PER_OCTAVE codes
+// per doubling of 1 + power (about 0.14% resolution). A key packet holds the
+// codes of all FILTER_FREQUENCY_COUNT powers; a delta packet holds only the
+// change in each code since the previous powers packet, which is usually a
+// single byte. Every TELEMETRY_KEY_INTERVAL-th powers packet is a key, so a
+// receiver that missed a packet (a gap in the sequence) picks up again at the
+// next key.
+//
+// Payloads:
+//   powers key    FILTER_FREQUENCY_COUNT power codes
+//   powers delta  FILTER_FREQUENCY_COUNT zigzag code changes
+//   hit           sampleIndex, frequencyNumber, peakPower code,
+//                 powerRatio code
+//   stats         the fields of telemetry_stats_t in order
+
+#ifndef TELEMETRY_H_
+#define TELEMETRY_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "cobs.h"
+#include "detector.h"
+#include "filter.h"
+
+#define TELEMETRY_POWERS_KEY_MESSAGE 1
+#define TELEMETRY_POWERS_DELTA_MESSAGE 2
+#define TELEMETRY_HIT_MESSAGE 3
+#define TELEMETRY_STATS_MESSAGE 4
+
+#define TELEMETRY_POWER_STEPS_PER_OCTAVE 256
+#define TELEMETRY_KEY_INTERVAL 16
+
+#define TELEMETRY_HEADER_BYTES 2
+#define TELEMETRY_CRC_BYTES 2
+#define TELEMETRY_MAX_VARINT_BYTES 5 // Enough for 32 bits.
+#define TELEMETRY_MAX_PAYLOAD_BYTES                                            \
+  (FILTER_FREQUENCY_COUNT * TELEMETRY_MAX_VARINT_BYTES)
+#define TELEMETRY_MAX_PACKET_BYTES                                             \
+  (TELEMETRY_HEADER_BYTES + TELEMETRY_MAX_PAYLOAD_BYTES + TELEMETRY_CRC_BYTES)
+// Largest frame, delimiter included.
+#define TELEMETRY_MAX_FRAME_BYTES                                              \
+  (COBS_MAX_ENCODED_LENGTH(TELEMETRY_MAX_PACKET_BYTES) + 1)
+
+// Counters sent in a stats message.
+typedef struct {
+  uint32_t uptimeMs;
+  uint32_t sampleCount;   // ADC samples processed by the detector.
+  uint32_t hitCount;
+  uint32_t droppedHits;   // Lost to a full hit-event queue.
+  uint32_t droppedFrames; // Telemetry frames that did not fit in the queue.
+} telemetry_stats_t;
+
+// A decoded message.
+typedef struct {
+  uint8_t type;
+  uint8_t sequence;
+  union {
+    double powers[FILTER_FREQUENCY_COUNT]; // For both powers messages.
+    detector_hitEvent_t hit;
+    telemetry_stats_t stats;
+  };
+} telemetry_message_t;
+
+// Restarts the sequence numbers and makes the next powers packet a key.
+void telemetry_init();
+
+// Makes the next powers packet a key, e.g. after a frame could not be queued.
+void telemetry_requestKey();
+
+// Each of these encodes one message into frame, which must hold
+// TELEMETRY_MAX_FRAME_BYTES, and returns the frame length in bytes.
+uint32_t telemetry_encodePowers(const double powers[], uint8_t frame[]);
+uint32_t telemetry_encodeHit(const detector_hitEvent_t *hit, uint8_t frame[]);
+uint32_t telemetry_encodeStats(const telemetry_stats_t *stats,
+                               uint8_t frame[]);
+
+// Queues a frame on the bluetooth UART if all of it fits. Returns false if it
+// did not, in which case it is dropped and the next powers packet is a key.
+bool telemetry_sendFrame(uint8_t frame[], uint32_t length);
+
+// Returns the number of frames telemetry_sendFrame() has dropped.
+uint32_t telemetry_getDroppedFrameCount();
+
+// Converts between powers and the log-scale codes sent for them. Negative
+// powers are sent as 0.
+uint32_t telemetry_powerToCode(double power);
+double telemetry_codeToPower(uint32_t code);
+
+#endif /* TELEMETRY_H_ */
@@ -0,0 +1,163 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "cobs.h"
+#include "crc16.h"
+#include "telemetryDecoder.h"
+
+#define VARINT_PAYLOAD_BITS 7
+#define VARINT_PAYLOAD_MASK 0x7F
+#define VARINT_CONTINUE 0x80
+#define BITS_PER_BYTE 8
+#define MIN_PACKET_BYTES (TELEMETRY_HEADER_BYTES + TELEMETRY_CRC_BYTES)
+
+// Clears decoder, which then waits for a key before accepting deltas.
+void telemetryDecoder_init(telemetryDecoder_t *decoder) {
+  memset(decoder, 0, sizeof(*decoder));
+}
+
+// Reads a varint from payload at *offset, advancing it. Returns false if the
+// varint runs past length or past 32 bits.
+static bool getVarint(const uint8_t payload[], uint32_t length,
+                      uint32_t *offset, uint32_t *value) {
+  *value = 0;
+  for (uint32_t shift = 0; shift < 32; shift += VARINT_PAYLOAD_BITS) {
+    if (*offset >= length)
+      return false;
+    uint8_t byte = payload[(*offset)++];
+    *value |= (uint32_t)(byte & VARINT_PAYLOAD_MASK) << shift;
+    if (!(byte & VARINT_CONTINUE))
+      return true;
+  }
+  return false;
+}
+
+static int32_t unzigzag(uint32_t value) {
+  return (int32_t)(value >> 1) ^ -(int32_t)(value & 1);
+}
+
+// Reads count varints from the payload, which must hold exactly that many.
+static bool getVarints(const uint8_t payload[], uint32_t length,
+                       uint32_t values[], uint16_t count) {
+  uint32_t offset = 0;
+  for (uint16_t i = 0; i < count; i++)
+    if (!getVarint(payload, length, &offset, &values[i]))
+      return false;
+  return offset == length;
+}
+
+// Counts a payload that does not match its type. Returns false.
+static bool malformed(telemetryDecoder_t *decoder) {
+  decoder->stats.framingErrors++;
+  return false;
+}
+
+// Parses a payload whose CRC has been checked. Returns false, after counting
+// why, if it is malformed or is a delta with nothing to apply it to.
+static bool parsePayload(telemetryDecoder_t *decoder, uint8_t type,
+                         const uint8_t payload[], uint32_t length,
+                         telemetry_message_t *message) {
+  uint32_t values[FILTER_FREQUENCY_COUNT];
+  switch (type) {
+  case TELEMETRY_POWERS_KEY_MESSAGE:
+  case TELEMETRY_POWERS_DELTA_MESSAGE:
+    if (!getVarints(payload, length, values, FILTER_FREQUENCY_COUNT))
+      return malformed(decoder);
+    if (type == TELEMETRY_POWERS_DELTA_MESSAGE && !decoder->haveCodes) {
+      decoder->stats.unbasedDeltas++;
+      return false;
+    }
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+      if (type == TELEMETRY_POWERS_KEY_MESSAGE)
+        decoder->codes[i] = values[i];
+      else
+        decoder->codes[i] += unzigzag(values[i]);
+      message->powers[i] = telemetry_codeToPower(decoder->codes[i]);
+    }
+    decoder->haveCodes = true;
+    return true;
+  case TELEMETRY_HIT_MESSAGE:
+    if (!getVarints(payload, length, values, 4))
+      return malformed(decoder);
+    message->hit.sampleIndex = values[0];
+    message->hit.frequencyNumber = values[1];
+    message->hit.peakPower = telemetry_codeToPower(values[2]);
+    message->hit.powerRatio = telemetry_codeToPower(values[3]);
+    return true;
+  case TELEMETRY_STATS_MESSAGE:
+    if (!getVarints(payload, length, values, 5))
+      return malformed(decoder);
+    message->stats.uptimeMs = values[0];
+    message->stats.sampleCount = values[1];
+    message->stats.hitCount = values[2];
+    message->stats.droppedHits = values[3];
+    message->stats.droppedFrames = values[4];
+    return true;
+  default:
+    return malformed(decoder);
+  }
+}
+
+// Decodes the frame collected so far. Returns true if it holds a valid
+// message.
+static bool decodeFrame(telemetryDecoder_t *decoder,
+                        telemetry_message_t *message) {
+  uint8_t packet[TELEMETRY_MAX_FRAME_BYTES];
+  uint32_t length;
+  if (!cobs_decode(decoder->frame, decoder->frameLength, packet, &length) ||
+      length < MIN_PACKET_BYTES) {
+    decoder->stats.framingErrors++;
+    return false;
+  }
+  length -= TELEMETRY_CRC_BYTES;
+  uint16_t crc = packet[length] | (packet[length + 1] << BITS_PER_BYTE);
+  if (crc16_compute(packet, length) != crc) {
+    decoder->stats.crcErrors++;
+    return false;
+  }
+  // A missing packet may have been a delta, so the codes can't be trusted.
+  uint8_t sequence = packet[1];
+  if (decoder->synced && sequence != (uint8_t)(decoder->sequence + 1)) {
+    decoder->stats.sequenceGaps++;
+    decoder->haveCodes = false;
+  }
+  decoder->synced = true;
+  decoder->sequence = sequence;
+  message->type = packet[0];
+  message->sequence = sequence;
+  if (!parsePayload(decoder, packet[0], &packet[TELEMETRY_HEADER_BYTES],
+                    length - TELEMETRY_HEADER_BYTES, message))
+    return false;
+  decoder->stats.frameCount++;
+  return true;
+}
+
+// Adds one received byte. Returns true and fills in message when the byte
+// completes a valid message.
+bool telemetryDecoder_addByte(telemetryDecoder_t *decoder, uint8_t byte,
+                              telemetry_message_t *message) {
+  if (byte != COBS_DELIMITER) {
+    if (decoder->frameLength < TELEMETRY_MAX_FRAME_BYTES)
+      decoder->frame[decoder->frameLength++] = byte;
+    else
+      decoder->overflowed = true;
+    return false;
+  }
+  bool decoded = false;
+  if (decoder->overflowed)
+    decoder->stats.framingErrors++;
+  else if (decoder->frameLength > 0) // Back-to-back delimiters are harmless.
+    decoded = decodeFrame(decoder, message);
+  decoder->frameLength = 0;
+  decoder->overflowed = false;
+  return decoded;
+}
@@ -0,0 +1,50 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+// Receiver side of the telemetry protocol in telemetry.h. Feed it the bytes
+// read from the link one at a time; it reassembles frames, drops any that fail
+// COBS decoding or the CRC, and tracks the power codes that delta packets are
+// applied to. After a gap in the sequence numbers delta packets are dropped
+// until the next key. Uses no hardware, so it also builds on the host.
+
+#ifndef TELEMETRYDECODER_H_
+#define TELEMETRYDECODER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "telemetry.h"
+
+typedef struct {
+  uint32_t frameCount;    // Messages decoded.
+  uint32_t framingErrors; // Bad COBS, overlong frames, bad payloads.
+  uint32_t crcErrors;
+  uint32_t sequenceGaps;  // Times one or more packets went missing.
+  uint32_t unbasedDeltas; // Delta packets dropped for want of a key.
+} telemetryDecoder_stats_t;
+
+typedef struct {
+  uint8_t frame[TELEMETRY_MAX_FRAME_BYTES]; // Bytes since the last delimiter.
+  uint32_t frameLength;
+  bool overflowed;  // The frame outgrew the buffer; drop it.
+  bool synced;      // A packet has been seen, so sequence is meaningful.
+  uint8_t sequence; // Of the last packet.
+  bool haveCodes;   // codes holds a key and the deltas since.
+  uint32_t codes[FILTER_FREQUENCY_COUNT];
+  telemetryDecoder_stats_t stats;
+} telemetryDecoder_t;
+
+// Clears decoder, which then waits for a key before accepting deltas.
+void telemetryDecoder_init(telemetryDecoder_t *decoder);
+
+// Adds one received byte. Returns true and fills in message when the byte
+// completes a valid message.
+bool telemetryDecoder_addByte(telemetryDecoder_t *decoder, uint8_t byte,
+                              telemetry_message_t *message);
+
+#endif /* TELEMETRYDECODER_H_ */
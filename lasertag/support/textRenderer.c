@@ -0,0 +1,355 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "display.h"
+#include "displayFont.h"
+#include "format.h"
+#include "textRenderer.h"
+
+#define TEXT_RENDERER_DEFAULT_TEXT_COLOR DISPLAY_WHITE
+// Bits of a glyph mask per column; column c is bits 8c to 8c + 7.
+#define TEXT_RENDERER_COLUMN_BITS 8
+
+// A solid part of a glyph, in size 1 pixels from the top left of the cell.
+typedef struct {
+  uint8_t x, y, w, h;
+} textRenderer_rect_t;
+
+typedef struct {
+  uint8_t rectCount;
+  textRenderer_rect_t rects[TEXT_RENDERER_MAX_GLYPH_RECTS];
+} textRenderer_glyph_t;
+
+// A line of opaque text known to be on the TFT.
+typedef struct {
+  bool used;
+  int16_t x, y;
+  uint8_t size;
+  uint16_t color, bg;
+  uint8_t length;
+  uint32_t lastUse; // For replacing the least recently used entry.
+  char text[TEXT_RENDERER_LINE_SIZE];
+} textRenderer_cacheEntry_t;
+
+static textRenderer_glyph_t textRenderer_glyphs[DISPLAY_FONT_GLYPH_COUNT];
+static bool textRenderer_fontBrokenUp;
+static textRenderer_cacheEntry_t
+    textRenderer_cache[TEXT_RENDERER_CACHE_ENTRIES];
+static uint32_t textRenderer_useCount;
+static textRenderer_stats_t textRenderer_stats;
+
+static int16_t textRenderer_cursorX, textRenderer_cursorY;
+static uint16_t textRenderer_textColor, textRenderer_textBgColor;
+static uint8_t textRenderer_textSize;
+static bool textRenderer_textWrap;
+
+// The glyph's pixels, one bit each.
+static uint64_t textRenderer_glyphMask(const uint8_t *columns) {
+  uint64_t mask = 0;
+  for (uint8_t c = 0; c < DISPLAY_FONT_GLYPH_COLUMNS; c++)
+    mask |= (uint64_t)columns[c] << (c * TEXT_RENDERER_COLUMN_BITS);
+  return mask;
+}
+
+static uint64_t textRenderer_rectMask(textRenderer_rect_t rect) {
+  uint64_t column = ((1u << rect.h) - 1) << rect.y;
+  uint64_t mask = 0;
+  for (uint8_t c = rect.x; c < rect.x + rect.w; c++)
+    mask |= column << (c * TEXT_RENDERER_COLUMN_BITS);
+  return mask;
+}
+
+// Covers the glyph with solid rectangles, greedily: each one is the rectangle
+// inside the glyph that covers the most pixels not yet covered, the smallest
+// such. Rectangles may overlap, since they are all one color, and every fill
+// saved is worth more on the bus than a few pixels drawn twice.
+static void textRenderer_breakUpGlyph(const uint8_t *columns,
+                                      textRenderer_glyph_t *glyph) {
+  uint64_t mask = textRenderer_glyphMask(columns);
+  uint64_t uncovered = mask;
+  glyph->rectCount = 0;
+  while (uncovered && glyph->rectCount < TEXT_RENDERER_MAX_GLYPH_RECTS) {
+    textRenderer_rect_t best = {0, 0, 0, 0};
+    int bestGain = 0, bestArea = 0;
+    textRenderer_rect_t rect;
+    for (rect.x = 0; rect.x < DISPLAY_FONT_GLYPH_COLUMNS; rect.x++)
+      for (rect.w = 1; rect.x + rect.w <= DISPLAY_FONT_GLYPH_COLUMNS; rect.w++)
+        for (rect.y = 0; rect.y < DISPLAY_CHAR_HEIGHT; rect.y++)
+          for (rect.h = 1; rect.y + rect.h <= DISPLAY_CHAR_HEIGHT; rect.h++) {
+            uint64_t rectMask = textRenderer_rectMask(rect);
+            if (rectMask & ~mask)
+              break; // Taller ones stick out of the glyph too.
+            int gain = __builtin_popcountll(rectMask & uncovered);
+            int area = rect.w * rect.h;
+            if (gain > bestGain || (gain == bestGain && area < bestArea)) {
+              best = rect;
+              bestGain = gain;
+              bestArea = area;
+            }
+          }
+    glyph->rects[glyph->rectCount++] = best;
+    uncovered &= ~textRenderer_rectMask(best);
+  }
+  if (uncovered)
+    printf("textRenderer_breakUpGlyph(): glyph needs more than %d "
+           "rectangles.\n",
+           TEXT_RENDERER_MAX_GLYPH_RECTS);
+}
+
+static void textRenderer_fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                                  uint16_t color) {
+  display_fillRect(x, y, w, h, color);
+  textRenderer_stats.fills++;
+}
+
+// Draws c's rectangles, leaving the background untouched.
+static void textRenderer_drawGlyph(int16_t x, int16_t y, unsigned char c,
+                                   uint16_t color, uint8_t size) {
+  if (c < DISPLAY_FONT_FIRST_CHAR || c > DISPLAY_FONT_LAST_CHAR)
+    return; // Blank.
+  const textRenderer_glyph_t *glyph =
+      &textRenderer_glyphs[c - DISPLAY_FONT_FIRST_CHAR];
+  for (uint8_t i = 0; i < glyph->rectCount; i++) {
+    textRenderer_rect_t rect = glyph->rects[i];
+    textRenderer_fillRect(x + rect.x * size, y + rect.y * size, rect.w * size,
+                          rect.h * size, color);
+  }
+}
+
+// Draws length characters of text in a row from (x, y), on one background
+// fill if bg != color. Characters wholly off the TFT are skipped, as the TFT
+// driver skips them.
+static void textRenderer_drawRun(int16_t x, int16_t y, const char *text,
+                                 uint8_t length, uint16_t color, uint16_t bg,
+                                 uint8_t size) {
+  int16_t cellWidth = DISPLAY_CHAR_WIDTH * size;
+  int16_t cellHeight = DISPLAY_CHAR_HEIGHT * size;
+  if (y >= display_height() || y + cellHeight <= 0)
+    return;
+  if (bg != color)
+    textRenderer_fillRect(x, y, length * cellWidth, cellHeight, bg);
+  for (uint8_t i = 0; i < length; i++, x += cellWidth)
+    if (x < display_width() && x + cellWidth > 0)
+      textRenderer_drawGlyph(x, y, text[i], color, size);
+  textRenderer_stats.characters += length;
+}
+
+// Forgets the cached lines that overlap the given area, except keep.
+static void textRenderer_forget(int16_t x, int16_t y, int16_t w, int16_t h,
+                                const textRenderer_cacheEntry_t *keep) {
+  for (uint8_t i = 0; i < TEXT_RENDERER_CACHE_ENTRIES; i++) {
+    textRenderer_cacheEntry_t *entry = &textRenderer_cache[i];
+    if (!entry->used || entry == keep)
+      continue;
+    int16_t entryWidth = entry->length * DISPLAY_CHAR_WIDTH * entry->size;
+    int16_t entryHeight = DISPLAY_CHAR_HEIGHT * entry->size;
+    if (x < entry->x + entryWidth && entry->x < x + w &&
+        y < entry->y + entryHeight && entry->y < y + h)
+      entry->used = false;
+  }
+}
+
+// Returns the cached line at (x, y) in the current size and colors, if any.
+static textRenderer_cacheEntry_t *textRenderer_find(int16_t x, int16_t y) {
+  for (uint8_t i = 0; i < TEXT_RENDERER_CACHE_ENTRIES; i++) {
+    textRenderer_cacheEntry_t *entry = &textRenderer_cache[i];
+    if (entry->used && entry->x == x && entry->y == y &&
+        entry->size == textRenderer_textSize &&
+        entry->color == textRenderer_textColor &&
+        entry->bg == textRenderer_textBgColor)
+      return entry;
+  }
+  return NULL;
+}
+
+// Returns an unused entry, or else the least recently used one.
+static textRenderer_cacheEntry_t *textRenderer_allocate() {
+  textRenderer_cacheEntry_t *oldest = &textRenderer_cache[0];
+  for (uint8_t i = 0; i < TEXT_RENDERER_CACHE_ENTRIES; i++) {
+    textRenderer_cacheEntry_t *entry = &textRenderer_cache[i];
+    if (!entry->used)
+      return entry;
+    if (entry->lastUse < oldest->lastUse)
+      oldest = entry;
+  }
+  return oldest;
+}
+
+// Draws a line of text from one print call at (x, y) in the current size and
+// colors. Opaque text goes through the cache.
+static void textRenderer_drawLine(int16_t x, int16_t y, const char *text,
+                                  uint8_t length) {
+  uint16_t color = textRenderer_textColor, bg = textRenderer_textBgColor;
+  uint8_t size = textRenderer_textSize;
+  int16_t cellWidth = DISPLAY_CHAR_WIDTH * size;
+  int16_t lineWidth = length * cellWidth;
+  int16_t lineHeight = DISPLAY_CHAR_HEIGHT * size;
+  textRenderer_cacheEntry_t *entry =
+      (bg != color) ? textRenderer_find(x, y) : NULL;
+  if (entry && entry->length == length) {
+    // Only the characters that changed, each run of them on one background.
+    textRenderer_forget(x, y, lineWidth, lineHeight, entry);
+    uint8_t changed = 0;
+    for (uint8_t i = 0; i < length;) {
+      if (text[i] == entry->text[i]) {
+        i++;
+        continue;
+      }
+      uint8_t end = i + 1;
+      while (end < length && text[end] != entry->text[end])
+        end++;
+      textRenderer_drawRun(x + i * cellWidth, y, &text[i], end - i, color, bg,
+                           size);
+      changed += end - i;
+      i = end;
+    }
+    if (changed == 0)
+      textRenderer_stats.cacheHits++;
+    textRenderer_stats.cachedCharacters += length - changed;
+  } else {
+    textRenderer_forget(x, y, lineWidth, lineHeight, NULL);
+    textRenderer_drawRun(x, y, text, length, color, bg, size);
+    if (bg == color)
+      return;
+    entry = textRenderer_allocate();
+    entry->used = true;
+    entry->x = x;
+    entry->y = y;
+    entry->size = size;
+    entry->color = color;
+    entry->bg = bg;
+    entry->length = length;
+  }
+  memcpy(entry->text, text, length);
+  entry->lastUse = ++textRenderer_useCount;
+}
+
+// Breaks up the font the first time, empties the cache, clears the statistics
+// and resets the text settings to the TFT driver's defaults. Call before the
+// others, and again after clearing the screen.
+void textRenderer_init() {
+  if (!textRenderer_fontBrokenUp) {
+    for (uint8_t i = 0; i < DISPLAY_FONT_GLYPH_COUNT; i++)
+      textRenderer_breakUpGlyph(displayFont_glyphs[i],
+                                &textRenderer_glyphs[i]);
+    textRenderer_fontBrokenUp = true;
+  }
+  textRenderer_clearCache();
+  memset(&textRenderer_stats, 0, sizeof(textRenderer_stats));
+  textRenderer_cursorX = textRenderer_cursorY = 0;
+  textRenderer_textColor = textRenderer_textBgColor =
+      TEXT_RENDERER_DEFAULT_TEXT_COLOR;
+  textRenderer_textSize = 1;
+  textRenderer_textWrap = true;
+}
+
+void textRenderer_setCursor(int16_t x, int16_t y) {
+  textRenderer_cursorX = x;
+  textRenderer_cursorY = y;
+}
+
+void textRenderer_setTextColor(uint16_t c) {
+  textRenderer_textColor = textRenderer_textBgColor = c;
+}
+
+void textRenderer_setTextColorBg(uint16_t c, uint16_t bg) {
+  textRenderer_textColor = c;
+  textRenderer_textBgColor = bg;
+}
+
+void textRenderer_setTextSize(uint8_t s) { textRenderer_textSize = s ? s : 1; }
+
+void textRenderer_setTextWrap(bool w) { textRenderer_textWrap = w; }
+
+// Collects the characters that land side by side on one row and draws them
+// together, moving the cursor the way the TFT driver does: wrapping once the
+// next character would not fit.
+size_t textRenderer_print(const char str[]) {
+  int16_t cellWidth = DISPLAY_CHAR_WIDTH * textRenderer_textSize;
+  int16_t cellHeight = DISPLAY_CHAR_HEIGHT * textRenderer_textSize;
+  int16_t wrapX = display_width() - cellWidth;
+  char line[TEXT_RENDERER_LINE_SIZE];
+  uint8_t length = 0;
+  int16_t lineX = 0, lineY = 0;
+  size_t count = 0;
+  for (; str[count]; count++) {
+    char c = str[count];
+    if (c == '\r')
+      continue;
+    if (c != '\n') {
+      if (length == 0) {
+        lineX = textRenderer_cursorX;
+        lineY = textRenderer_cursorY;
+      }
+      line[length++] = c;
+      textRenderer_cursorX += cellWidth;
+      if (!textRenderer_textWrap || textRenderer_cursorX <= wrapX) {
+        if (length == TEXT_RENDERER_LINE_SIZE) {
+          textRenderer_drawLine(lineX, lineY, line, length);
+          length = 0;
+        }
+        continue;
+      }
+    }
+    // A new line, asked for or wrapped.
+    if (length > 0)
+      textRenderer_drawLine(lineX, lineY, line, length);
+    length = 0;
+    textRenderer_cursorY += cellHeight;
+    textRenderer_cursorX = 0;
+  }
+  if (length > 0)
+    textRenderer_drawLine(lineX, lineY, line, length);
+  return count;
+}
+
+size_t textRenderer_println(const char str[]) {
+  size_t count = textRenderer_print(str);
+  textRenderer_print("\n");
+  return count + 1;
+}
+
+size_t textRenderer_printDecimalInt(int num) {
+  char text[FORMAT_BUFFER_SIZE];
+  format_int(text, sizeof(text), num);
+  return textRenderer_print(text);
+}
+
+// As with display_drawChar(), bg == color leaves the background untouched.
+void textRenderer_drawChar(int16_t x, int16_t y, unsigned char c,
+                           uint16_t color, uint16_t bg, uint8_t size) {
+  char text = c;
+  textRenderer_forget(x, y, DISPLAY_CHAR_WIDTH * size,
+                      DISPLAY_CHAR_HEIGHT * size, NULL);
+  textRenderer_drawRun(x, y, &text, 1, color, bg, size);
+}
+
+// Forgets all cached text. Call after drawing over cached text other than
+// with this renderer.
+void textRenderer_clearCache() {
+  for (uint8_t i = 0; i < TEXT_RENDERER_CACHE_ENTRIES; i++)
+    textRenderer_cache[i].used = false;
+}
+
+// Returns the number of rectangles c is drawn with, 0 for a blank.
+uint8_t textRenderer_getGlyphRectCount(unsigned char c) {
+  if (c < DISPLAY_FONT_FIRST_CHAR || c > DISPLAY_FONT_LAST_CHAR)
+    return 0;
+  return textRenderer_glyphs[c - DISPLAY_FONT_FIRST_CHAR].rectCount;
+}
+
+// Returns the statistics since textRenderer_init().
+const textRenderer_stats_t *textRenderer_getStats() {
+  return &textRenderer_stats;
+}
@@ -0,0 +1,82 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Draws text on the TFT with far fewer transfers than display_print(). The
+// TFT driver draws a character a dot at a time, each dot its own transfer
+// (and for opaque text, each background dot too). textRenderer_init() breaks
+// each glyph of the font into a few solid rectangles, once; a character is
+// then drawn as one display_fillRect() per rectangle, scaled to the text
+// size, and the background of opaque text as a single fillRect under each
+// line of text rather than under each dot.
+//
+// Opaque text is cached: printing the same text at the same place, size and
+// colors again draws nothing, and text of the same length draws only the
+// characters that changed. Drawing text over cached text forgets it, but the
+// cache cannot see other drawing, so call textRenderer_clearCache() after
+// drawing over cached text by other means (display_fillScreen(), say).
+// Transparent text is never cached.
+//
+// The text calls follow display.h, with the cursor, colors, size and wrapping
+// kept here, apart from the TFT driver's.
+
+#ifndef TEXTRENDERER_H_
+#define TEXTRENDERER_H_
+
+#include <stdbool.h>
+#include <stddef.h>
+#include <stdint.h>
+
+// Most rectangles a glyph of displayFont.h breaks into.
+#define TEXT_RENDERER_MAX_GLYPH_RECTS 12
+#define TEXT_RENDERER_CACHE_ENTRIES 32
+// Longest line kept in the cache: a full row of size 1 text.
+#define TEXT_RENDERER_LINE_SIZE 53
+
+typedef struct {
+  uint32_t characters;       // Characters drawn, not counting cache hits.
+  uint32_t fills;            // display_fillRect() calls.
+  uint32_t cacheHits;        // Lines the cache found already on the TFT.
+  uint32_t cachedCharacters; // Characters the cache saved drawing.
+} textRenderer_stats_t;
+
+// Breaks up the font the first time, empties the cache, clears the statistics
+// and resets the text settings to the TFT driver's defaults. Call before the
+// others, and again after clearing the screen. histogram_init() calls it.
+void textRenderer_init();
+
+void textRenderer_setCursor(int16_t x, int16_t y);
+// The background is left untouched.
+void textRenderer_setTextColor(uint16_t c);
+void textRenderer_setTextColorBg(uint16_t c, uint16_t bg);
+void textRenderer_setTextSize(uint8_t s);
+void textRenderer_setTextWrap(bool w);
+
+// Draws str at the cursor and moves the cursor on, as display_print() does,
+// wrapping and taking "\n" and "\r" the same way. Returns the number of
+// characters taken.
+size_t textRenderer_print(const char str[]);
+size_t textRenderer_println(const char str[]);
+size_t textRenderer_printDecimalInt(int num);
+
+// Draws one character, as display_drawChar() does: bg == color leaves the
+// background untouched.
+void textRenderer_drawChar(int16_t x, int16_t y, unsigned char c,
+                           uint16_t color, uint16_t bg, uint8_t size);
+
+// Forgets all cached text. Call after drawing over cached text other than
+// with this renderer.
+void textRenderer_clearCache();
+
+// Returns the number of rectangles c is drawn with, 0 for a blank.
+uint8_t textRenderer_getGlyphRectCount(unsigned char c);
+
+// Returns the statistics since textRenderer_init().
+const textRenderer_stats_t *textRenderer_getStats();
+
+#endif /* TEXTRENDERER_H_ */
@@ -0,0 +1,187 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "trace.h"
+
+#if TRACE_ENABLED
+
+#include "crc16.h"
+#include "profiler.h"
+
+#ifdef ZYBO_BOARD
+#include "xpseudo_asm.h"
+#include "xreg_cortexa9.h"
+#endif
+
+#define BYTE_MASK 0xFF
+#define BITS_PER_BYTE 8
+
+// Frame field offsets, see trace.h.
+#define FRAME_VERSION_OFFSET 4
+#define FRAME_TYPE_OFFSET 5
+#define FRAME_LENGTH_OFFSET 6
+#define FRAME_SEQUENCE_OFFSET 8
+
+typedef struct {
+  uint32_t timestamp;
+  uint8_t id;
+  uint8_t flags; // Phase and TRACE_FLAG_ISR.
+  uint16_t arg;
+} trace_event_t;
+
+static const char *trace_names[TRACE_ID_COUNT] = {
+    "adcPush", "sound", "detector", "fir",
+    "iir",     "power", "hit",      "histogram"};
+
+static trace_event_t trace_ring[TRACE_BUFFER_EVENTS];
+static volatile uint32_t trace_nextIndex; // Events recorded, and the next slot.
+static volatile uint32_t trace_idMask;    // 0 when stopped.
+#ifndef ZYBO_BOARD
+static volatile bool trace_hostIsr;
+#endif
+
+// Dump position, set by trace_stop().
+static bool trace_dumpReady;
+static uint32_t trace_takeSequence; // Next frame; 0 is the header.
+static uint32_t trace_takeIndex;    // Next event to dump.
+static uint32_t trace_takeEnd;      // One past the last event to dump.
+
+// Returns true if the caller is the ISR.
+static bool trace_inIsr() {
+#ifdef ZYBO_BOARD
+  return (mfcpsr() & XREG_CPSR_MODE_BITS) == XREG_CPSR_IRQ_MODE;
+#else
+  return trace_hostIsr;
+#endif
+}
+
+// Records an event if tracing is on and id is in the started mask.
+void trace_record(trace_id_t id, uint8_t phase, uint16_t arg) {
+  if (!(trace_idMask & (1u << id)))
+    return;
+  uint32_t timestamp = (uint32_t)profiler_getTicks();
+  // Claim the slot before filling it: if the ISR records in between, it
+  // takes the next one.
+  uint32_t index = __atomic_fetch_add(&trace_nextIndex, 1, __ATOMIC_RELAXED);
+  trace_event_t *event = &trace_ring[index % TRACE_BUFFER_EVENTS];
+  event->timestamp = timestamp;
+  event->id = id;
+  event->flags = phase | (trace_inIsr() ? TRACE_FLAG_ISR : 0);
+  event->arg = arg;
+}
+
+// Empties the ring and starts recording the ids whose bits are set in
+// idMask (1 << id; TRACE_ALL_IDS for everything).
+void trace_start(uint32_t idMask) {
+  trace_idMask = 0;
+  trace_nextIndex = 0;
+  trace_dumpReady = false;
+  trace_idMask = idMask & TRACE_ALL_IDS;
+}
+
+// Stops recording and readies the ring to be taken by trace_takeFrame().
+void trace_stop() {
+  trace_idMask = 0;
+  trace_takeEnd = trace_nextIndex;
+  trace_takeIndex = trace_takeEnd > TRACE_BUFFER_EVENTS
+                        ? trace_takeEnd - TRACE_BUFFER_EVENTS
+                        : 0;
+  trace_takeSequence = 0;
+  trace_dumpReady = true;
+}
+
+// Returns the number of events recorded since trace_start(), including those
+// the ring has since overwritten.
+uint32_t trace_getEventCount() { return trace_nextIndex; }
+
+// Stores value little-endian in byteCount bytes starting at data.
+static void putLittleEndian(uint8_t *data, uint32_t value, uint16_t byteCount) {
+  for (uint16_t i = 0; i < byteCount; i++)
+    data[i] = (value >> (i * BITS_PER_BYTE)) & BYTE_MASK;
+}
+
+// Writes the header payload at payload and returns its length.
+static uint32_t trace_putHeader(uint8_t *payload) {
+  uint32_t length = 0;
+  putLittleEndian(&payload[length], profiler_getTicksPerSecond(),
+                  sizeof(uint32_t));
+  length += sizeof(uint32_t);
+  putLittleEndian(&payload[length], trace_takeEnd, sizeof(uint32_t));
+  length += sizeof(uint32_t);
+  putLittleEndian(&payload[length], trace_takeEnd - trace_takeIndex,
+                  sizeof(uint32_t));
+  length += sizeof(uint32_t);
+  payload[length++] = TRACE_ID_COUNT;
+  for (uint16_t id = 0; id < TRACE_ID_COUNT; id++) {
+    uint32_t nameBytes = strnlen(trace_names[id], TRACE_MAX_NAME_BYTES - 1);
+    memcpy(&payload[length], trace_names[id], nameBytes);
+    length += nameBytes;
+    payload[length++] = '\0';
+  }
+  return length;
+}
+
+// Writes up to TRACE_FRAME_EVENTS events at payload and returns the length.
+static uint32_t trace_putEvents(uint8_t *payload) {
+  uint32_t length = 0;
+  for (uint16_t i = 0;
+       i < TRACE_FRAME_EVENTS && trace_takeIndex != trace_takeEnd; i++) {
+    const trace_event_t *event =
+        &trace_ring[trace_takeIndex++ % TRACE_BUFFER_EVENTS];
+    putLittleEndian(&payload[length], event->timestamp, sizeof(uint32_t));
+    payload[length + 4] = event->id;
+    payload[length + 5] = event->flags;
+    putLittleEndian(&payload[length + 6], event->arg, sizeof(uint16_t));
+    length += TRACE_EVENT_BYTES;
+  }
+  return length;
+}
+
+// Encodes the next frame of the dump into frame, which must hold
+// TRACE_MAX_FRAME_BYTES: the header first, then the events oldest first.
+// Returns the frame length in bytes, or 0 once the dump is done. Call
+// trace_stop() first.
+uint32_t trace_takeFrame(uint8_t frame[]) {
+  if (!trace_dumpReady ||
+      (trace_takeSequence > 0 && trace_takeIndex == trace_takeEnd))
+    return 0;
+  bool header = trace_takeSequence == 0;
+  uint32_t payloadLength =
+      header ? trace_putHeader(&frame[TRACE_FRAME_HEADER_BYTES])
+             : trace_putEvents(&frame[TRACE_FRAME_HEADER_BYTES]);
+  putLittleEndian(frame, TRACE_SYNC_WORD, TRACE_SYNC_BYTES);
+  frame[FRAME_VERSION_OFFSET] = TRACE_FORMAT_VERSION;
+  frame[FRAME_TYPE_OFFSET] = header ? TRACE_HEADER_FRAME : TRACE_EVENTS_FRAME;
+  putLittleEndian(&frame[FRAME_LENGTH_OFFSET], payloadLength,
+                  sizeof(uint16_t));
+  putLittleEndian(&frame[FRAME_SEQUENCE_OFFSET], trace_takeSequence++,
+                  sizeof(uint32_t));
+  uint32_t length = TRACE_FRAME_HEADER_BYTES + payloadLength;
+  // The sync word is left out of the CRC, as in adcCapture.c.
+  uint16_t crc =
+      crc16_compute(&frame[TRACE_SYNC_BYTES], length - TRACE_SYNC_BYTES);
+  putLittleEndian(&frame[length], crc, TRACE_FRAME_CRC_BYTES);
+  return length + TRACE_FRAME_CRC_BYTES;
+}
+
+// Marks the events recorded from now on as the ISR's, or not. For host
+// simulations; on the board the processor mode says.
+void trace_setHostIsrContext(bool isr) {
+#ifdef ZYBO_BOARD
+  (void)isr;
+#else
+  trace_hostIsr = isr;
+#endif
+}
+
+#endif /* TRACE_ENABLED */
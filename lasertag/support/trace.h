@@ -0,0 +1,142 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// A timeline of what the ISR and the main loop are doing, recorded as 8-byte
+// binary events in a RAM ring and streamed to a host afterwards.
+// tools/traceToChrome turns the stream into Chrome trace_event JSON for
+// chrome://tracing or Perfetto.
+//
+//   TRACE_BEGIN(TRACE_ID_FIR, 0);
+//   filter_firFilter();
+//   TRACE_END(TRACE_ID_FIR, 0);
+//
+// Recording takes no lock: each event claims its slot with one atomic
+// increment and then fills it, so the ISR can record in the middle of a
+// main-loop event. The ring keeps the latest TRACE_BUFFER_EVENTS events.
+// Events recorded in IRQ mode are marked as the ISR's; on the host, where
+// there is no IRQ mode, simulations mark them with trace_setHostIsrContext().
+//
+// Event record, little-endian:
+//   offset  size  field
+//        0     4  timestamp, the low 32 bits of profiler_getTicks()
+//        4     1  event id (TRACE_ID_*)
+//        5     1  phase (TRACE_PHASE_*), TRACE_FLAG_ISR if recorded by the ISR
+//        6     2  argument
+// The timestamp wraps every 13 s on the board; the decoder unwraps it, which
+// works as long as the ISR records something more often than that.
+//
+// Frame layout, as in adcCapture.h:
+//   offset  size  field
+//        0     4  sync word TRACE_SYNC_WORD (bytes 54 52 C3 3C)
+//        4     1  format version TRACE_FORMAT_VERSION
+//        5     1  frame type (TRACE_*_FRAME)
+//        6     2  payload length n
+//        8     4  frame sequence number, from 0 for the header
+//       12     n  payload
+//     12+n     2  CRC-16/CCITT-FALSE of bytes 4 .. 12+n-1
+// Payloads:
+//   header  ticks per second (4), events recorded since trace_start() (4),
+//           events in this dump (4), id count (1), then the name of each id
+//           in order, NUL-terminated
+//   events  up to TRACE_FRAME_EVENTS event records, oldest first
+//
+// Tracing is off unless built with -DTRACE_ENABLED=1; otherwise the macros
+// compile to nothing and the ring takes no RAM.
+
+#ifndef TRACE_H_
+#define TRACE_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+#ifndef TRACE_ENABLED
+#define TRACE_ENABLED 0
+#endif
+
+// 16384 events is 128 KB; with the ISR's ADC event at 100 kHz, about 0.15 s.
+#define TRACE_BUFFER_EVENTS 16384
+#define TRACE_EVENT_BYTES 8
+#define TRACE_FRAME_EVENTS 256
+
+#define TRACE_SYNC_WORD 0x3CC35254
+#define TRACE_SYNC_BYTES 4
+#define TRACE_FORMAT_VERSION 1
+#define TRACE_HEADER_FRAME 1
+#define TRACE_EVENTS_FRAME 2
+#define TRACE_FRAME_HEADER_BYTES 12
+#define TRACE_FRAME_CRC_BYTES 2
+#define TRACE_MAX_NAME_BYTES 16 // Including the NUL.
+#define TRACE_MAX_FRAME_BYTES                                                  \
+  (TRACE_FRAME_HEADER_BYTES + TRACE_FRAME_EVENTS * TRACE_EVENT_BYTES +         \
+   TRACE_FRAME_CRC_BYTES)
+
+#define TRACE_PHASE_BEGIN 0
+#define TRACE_PHASE_END 1
+#define TRACE_PHASE_INSTANT 2
+#define TRACE_PHASE_MASK 0x03
+#define TRACE_FLAG_ISR 0x80
+
+// What can be traced. Add new ids before TRACE_ID_COUNT and their names to
+// trace_names in trace.c; the names travel in the header frame, so the
+// decoder needs no changes.
+typedef enum {
+  TRACE_ID_ADC_PUSH,  // ISR: a sample into the ADC buffer, arg = backlog.
+  TRACE_ID_SOUND,     // ISR: sound_tick() refilling the CODEC FIFO.
+  TRACE_ID_DETECTOR,  // detector(), arg = samples it will process.
+  TRACE_ID_FIR,       // filter_firFilter().
+  TRACE_ID_IIR,       // All the IIR filters.
+  TRACE_ID_POWER,     // All the power computations.
+  TRACE_ID_HIT,       // A hit, arg = frequency number.
+  TRACE_ID_HISTOGRAM, // Drawing the histogram.
+  TRACE_ID_COUNT
+} trace_id_t;
+
+#define TRACE_ALL_IDS ((1u << TRACE_ID_COUNT) - 1)
+
+#if TRACE_ENABLED
+
+#define TRACE_BEGIN(id, arg) trace_record((id), TRACE_PHASE_BEGIN, (arg))
+#define TRACE_END(id, arg) trace_record((id), TRACE_PHASE_END, (arg))
+#define TRACE_INSTANT(id, arg) trace_record((id), TRACE_PHASE_INSTANT, (arg))
+
+// Records an event if tracing is on and id is in the started mask.
+void trace_record(trace_id_t id, uint8_t phase, uint16_t arg);
+
+// Empties the ring and starts recording the ids whose bits are set in
+// idMask (1 << id; TRACE_ALL_IDS for everything).
+void trace_start(uint32_t idMask);
+
+// Stops recording and readies the ring to be taken by trace_takeFrame().
+void trace_stop();
+
+// Returns the number of events recorded since trace_start(), including those
+// the ring has since overwritten.
+uint32_t trace_getEventCount();
+
+// Encodes the next frame of the dump into frame, which must hold
+// TRACE_MAX_FRAME_BYTES: the header first, then the events oldest first.
+// Returns the frame length in bytes, or 0 once the dump is done. Call
+// trace_stop() first.
+uint32_t trace_takeFrame(uint8_t frame[]);
+
+// Marks the events recorded from now on as the ISR's, or not. For host
+// simulations; on the board the processor mode says.
+void trace_setHostIsrContext(bool isr);
+
+#else
+
+#define TRACE_BEGIN(id, arg) ((void)0)
+#define TRACE_END(id, arg) ((void)0)
+#define TRACE_INSTANT(id, arg) ((void)0)
+#define trace_start(idMask) ((void)(idMask))
+#define trace_stop() ((void)0)
+
+#endif /* TRACE_ENABLED */
+
+#endif /* TRACE_H_ */
@@ -0,0 +1,95 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <string.h>
+
+#include "uiScheduler.h"
+
+static const uiScheduler_config_t *uiScheduler_config;
+static uiScheduler_stats_t uiScheduler_stats;
+static bool uiScheduler_started;             // Serviced at least once.
+static bool uiScheduler_inFrame;             // A frame is started, not ended.
+static double uiScheduler_startSeconds;      // Time of the first service call.
+static double uiScheduler_lastFrameSeconds;  // Time the last frame ended.
+static double uiScheduler_nextFrameSeconds;  // Time the next frame is due.
+static double uiScheduler_frameStartSeconds; // Time this frame was started.
+
+// Takes the configuration, which must stay valid, and clears the statistics.
+// The first frame is due at the first call to uiScheduler_service().
+void uiScheduler_init(const uiScheduler_config_t *config) {
+  uiScheduler_config = config;
+  memset(&uiScheduler_stats, 0, sizeof(uiScheduler_stats));
+  uiScheduler_started = false;
+  uiScheduler_inFrame = false;
+}
+
+// Call from the main loop with the number of ADC samples waiting. Starts a
+// frame if one is due and draws for up to a slice, unless the backlog is too
+// large. Returns true if it drew anything.
+bool uiScheduler_service(uint32_t backlog) {
+  const uiScheduler_config_t *config = uiScheduler_config;
+  if (backlog > uiScheduler_stats.maxBacklog)
+    uiScheduler_stats.maxBacklog = backlog;
+  double now = config->clock();
+  if (!uiScheduler_started) {
+    uiScheduler_started = true;
+    uiScheduler_startSeconds = uiScheduler_lastFrameSeconds = now;
+    uiScheduler_nextFrameSeconds = now;
+  }
+  if (!uiScheduler_inFrame && now < uiScheduler_nextFrameSeconds)
+    return false;
+  if (backlog >= config->maxBacklog) {
+    uiScheduler_stats.deferrals++;
+    return false;
+  }
+  if (!uiScheduler_inFrame) {
+    config->beginFrame();
+    uiScheduler_inFrame = true;
+    uiScheduler_frameStartSeconds = now;
+    // Keep to the period, but don't try to catch up on frames already missed.
+    uiScheduler_nextFrameSeconds += config->periodSeconds;
+    if (uiScheduler_nextFrameSeconds < now)
+      uiScheduler_nextFrameSeconds = now + config->periodSeconds;
+  }
+  // Stop before a chunk that would likely run past the end of the slice.
+  double sliceStart = now;
+  double chunkSeconds;
+  bool frameDone;
+  do {
+    double chunkStart = now;
+    frameDone = config->drawChunk();
+    uiScheduler_stats.chunks++;
+    now = config->clock();
+    chunkSeconds = now - chunkStart;
+  } while (!frameDone &&
+           now - sliceStart + chunkSeconds <= config->sliceSeconds);
+  double sliceSeconds = now - sliceStart;
+  if (sliceSeconds > uiScheduler_stats.maxSliceSeconds)
+    uiScheduler_stats.maxSliceSeconds = sliceSeconds;
+  if (frameDone) {
+    uiScheduler_inFrame = false;
+    uiScheduler_stats.frames++;
+    uiScheduler_lastFrameSeconds = now;
+    double frameSeconds = now - uiScheduler_frameStartSeconds;
+    if (frameSeconds > uiScheduler_stats.maxFrameSeconds)
+      uiScheduler_stats.maxFrameSeconds = frameSeconds;
+  }
+  return true;
+}
+
+// Returns the statistics since uiScheduler_init().
+const uiScheduler_stats_t *uiScheduler_getStats() { return &uiScheduler_stats; }
+
+// Returns the frames drawn per second since the first service call.
+double uiScheduler_getFramesPerSecond() {
+  double seconds = uiScheduler_lastFrameSeconds - uiScheduler_startSeconds;
+  return (seconds > 0.0) ? uiScheduler_stats.frames / seconds : 0.0;
+}
@@ -0,0 +1,67 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+// Cooperative scheduling of display work from a main loop that must keep up
+// with the ADC. Redrawing the TFT takes long enough to let the ADC buffer back
+// up, so the main loop hands the redraw to uiScheduler_service() after each
+// detector() call, and the scheduler decides how much of it to do:
+// - a new frame is started every periodSeconds of wall time, however fast the
+//   loop runs;
+// - nothing is drawn while the ADC backlog is at or above maxBacklog;
+// - a frame is drawn a chunk at a time, and one service call stops drawing
+//   before a chunk that would take it past sliceSeconds, as judged by the
+//   last one, so the detector runs between slices.
+
+#ifndef UISCHEDULER_H_
+#define UISCHEDULER_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Returns the time in seconds from a clock that only moves forward.
+typedef double (*uiScheduler_clock_t)();
+// Takes a snapshot of the data for a new frame.
+typedef void (*uiScheduler_beginFrame_t)();
+// Draws the next bounded piece of the frame. Returns true when it is done.
+typedef bool (*uiScheduler_drawChunk_t)();
+
+typedef struct {
+  double periodSeconds; // A frame is started this often.
+  double sliceSeconds;  // Drawing time per service call, at least a chunk.
+  uint32_t maxBacklog;  // Draw only while the backlog is below this.
+  uiScheduler_clock_t clock;
+  uiScheduler_beginFrame_t beginFrame;
+  uiScheduler_drawChunk_t drawChunk;
+} uiScheduler_config_t;
+
+typedef struct {
+  uint32_t frames;        // Frames drawn to the end.
+  uint32_t chunks;        // Calls to drawChunk.
+  uint32_t deferrals;     // Service calls that held drawing back.
+  uint32_t maxBacklog;    // Largest backlog passed to uiScheduler_service().
+  double maxSliceSeconds; // Longest time spent drawing in one service call.
+  double maxFrameSeconds; // Longest time from starting a frame to its end.
+} uiScheduler_stats_t;
+
+// Takes the configuration, which must stay valid, and clears the statistics.
+// The first frame is due at the first call to uiScheduler_service().
+void uiScheduler_init(const uiScheduler_config_t *config);
+
+// Call from the main loop with the number of ADC samples waiting. Starts a
+// frame if one is due and draws for up to a slice, unless the backlog is too
+// large. Returns true if it drew anything.
+bool uiScheduler_service(uint32_t backlog);
+
+// Returns the statistics since uiScheduler_init().
+const uiScheduler_stats_t *uiScheduler_getStats();
+
+// Returns the frames drawn per second since the first service call.
+double uiScheduler_getFramesPerSecond();
+
+#endif /* UISCHEDULER_H_ */
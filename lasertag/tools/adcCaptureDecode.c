@@ -0,0 +1,230 @@
+// Decodes the binary frame stream sent by runningModes_captureRawAdcValues()
+// into an ADC trace file (see adcTrace.h) for offline replay.
+//
+// The stream may contain console text before and after the frames, and bytes
+// may be lost or corrupted on the serial link: the decoder resynchronizes on
+// the sync word, rejects frames whose CRC does not match, and uses the block
+// sequence numbers to fill missing blocks with mid-scale samples so the trace
+// keeps its timing. A summary is printed on stderr.
+//
+// Capture the stream from the board's console UART, for example:
+//   stty -F /dev/ttyUSB1 115200 raw && cat /dev/ttyUSB1 > capture.bin
+// Build from lasertag/tools:
+//   gcc -O2 -I. -I../support adcCaptureDecode.c ../support/crc16.c
+//       -o adcCaptureDecode
+// Usage: adcCaptureDecode [-r sampleRateHz] -o out.trace [capture.bin]
+// Reads stdin if no capture file is given.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "adcCapture.h"
+#include "adcTrace.h"
+#include "crc16.h"
+
+#define DEFAULT_SAMPLE_RATE_HZ 100000
+#define READ_CHUNK_BYTES 65536
+
+// Frame field offsets, see adcCapture.h.
+#define FRAME_VERSION_OFFSET 4
+#define FRAME_FLAGS_OFFSET 5
+#define FRAME_COUNT_OFFSET 6
+#define FRAME_SEQUENCE_OFFSET 8
+
+typedef struct {
+  uint32_t frames;
+  uint32_t crcErrors;
+  uint32_t badHeaders;
+  uint32_t outOfOrderFrames;
+  uint32_t skippedBytes;
+  uint32_t missingBlocks;
+  uint32_t sampleCount;
+  uint32_t filledSampleCount;
+} decodeStats_t;
+
+static uint32_t getLittleEndian(const uint8_t *data, uint16_t byteCount) {
+  uint32_t value = 0;
+  for (uint16_t i = 0; i < byteCount; i++)
+    value |= (uint32_t)data[i] << (i * 8);
+  return value;
+}
+
+static void writeSample(FILE *out, adcTrace_sample_t sample) {
+  uint16_t bits = (uint16_t)sample;
+  fputc(bits & 0xFF, out);
+  fputc(bits >> 8, out);
+}
+
+// Reads all of input into a malloc'd buffer.
+static uint8_t *readAll(FILE *input, size_t *length) {
+  size_t capacity = READ_CHUNK_BYTES;
+  uint8_t *data = malloc(capacity);
+  *length = 0;
+  while (data) {
+    size_t n = fread(data + *length, 1, capacity - *length, input);
+    *length += n;
+    if (*length < capacity)
+      break;
+    capacity *= 2;
+    uint8_t *bigger = realloc(data, capacity);
+    if (!bigger)
+      free(data);
+    data = bigger;
+  }
+  return data;
+}
+
+static bool isSync(const uint8_t *data) {
+  return getLittleEndian(data, ADC_CAPTURE_SYNC_BYTES) == ADC_CAPTURE_SYNC_WORD;
+}
+
+// Decodes every good frame in data[0..length) into out and returns the
+// trace flags taken from the first frame.
+static uint32_t decode(const uint8_t *data, size_t length, FILE *out,
+                       decodeStats_t *stats) {
+  uint32_t flags = 0;
+  uint32_t expectedSequence = 0;
+  bool haveFrame = false;
+  size_t i = 0;
+  while (i + ADC_CAPTURE_FRAME_HEADER_BYTES <= length) {
+    if (!isSync(&data[i])) {
+      stats->skippedBytes++;
+      i++;
+      continue;
+    }
+    const uint8_t *frame = &data[i];
+    uint32_t count = getLittleEndian(&frame[FRAME_COUNT_OFFSET], 2);
+    if (frame[FRAME_VERSION_OFFSET] != ADC_CAPTURE_FORMAT_VERSION ||
+        count == 0 || count > ADC_CAPTURE_BLOCK_SAMPLES) {
+      stats->badHeaders++;
+      stats->skippedBytes++;
+      i++;
+      continue;
+    }
+    size_t payloadEnd =
+        ADC_CAPTURE_FRAME_HEADER_BYTES + count * sizeof(adcCapture_sample_t);
+    size_t frameLength = payloadEnd + ADC_CAPTURE_FRAME_CRC_BYTES;
+    if (i + frameLength > length)
+      break; // Truncated at the end of the stream.
+    uint16_t crc = crc16_compute(&frame[ADC_CAPTURE_SYNC_BYTES],
+                                 payloadEnd - ADC_CAPTURE_SYNC_BYTES);
+    if (crc != getLittleEndian(&frame[payloadEnd], ADC_CAPTURE_FRAME_CRC_BYTES)) {
+      // Could be a sync word inside sample data; keep scanning byte by byte.
+      stats->crcErrors++;
+      stats->skippedBytes++;
+      i++;
+      continue;
+    }
+
+    uint32_t sequence = getLittleEndian(&frame[FRAME_SEQUENCE_OFFSET], 4);
+    if (!haveFrame) {
+      flags = frame[FRAME_FLAGS_OFFSET] & ADC_CAPTURE_FLAG_BIPOLAR
+                  ? ADC_TRACE_FLAG_BIPOLAR
+                  : 0;
+      haveFrame = true;
+    }
+    if (sequence < expectedSequence) {
+      stats->outOfOrderFrames++;
+      i += frameLength;
+      continue;
+    }
+    // Fill blocks lost on the board or on the link with mid-scale samples.
+    adcTrace_sample_t fill = (flags & ADC_TRACE_FLAG_BIPOLAR)
+                                 ? ADC_TRACE_BIPOLAR_MIDSCALE
+                                 : ADC_TRACE_UNIPOLAR_MIDSCALE;
+    for (; expectedSequence < sequence; expectedSequence++) {
+      stats->missingBlocks++;
+      for (uint32_t s = 0; s < ADC_CAPTURE_BLOCK_SAMPLES; s++)
+        writeSample(out, fill);
+      stats->sampleCount += ADC_CAPTURE_BLOCK_SAMPLES;
+      stats->filledSampleCount += ADC_CAPTURE_BLOCK_SAMPLES;
+    }
+    for (uint32_t s = 0; s < count; s++)
+      writeSample(out, (adcTrace_sample_t)getLittleEndian(
+                           &frame[ADC_CAPTURE_FRAME_HEADER_BYTES +
+                                  s * sizeof(adcCapture_sample_t)],
+                           sizeof(adcCapture_sample_t)));
+    stats->sampleCount += count;
+    stats->frames++;
+    expectedSequence = sequence + 1;
+    i += frameLength;
+  }
+  stats->skippedBytes += length - i;
+  return flags;
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t sampleRateHz = DEFAULT_SAMPLE_RATE_HZ;
+  const char *outputName = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:o:")) != -1) {
+    switch (opt) {
+    case 'r':
+      sampleRateHz = strtoul(optarg, NULL, 0);
+      break;
+    case 'o':
+      outputName = optarg;
+      break;
+    default:
+      outputName = NULL;
+      optind = argc + 1;
+      break;
+    }
+  }
+  if (!outputName || optind + 1 < argc) {
+    fprintf(stderr,
+            "Usage: %s [-r sampleRateHz] -o out.trace [capture.bin]\n",
+            argv[0]);
+    exit(-1);
+  }
+
+  FILE *input = stdin;
+  if (optind < argc && !(input = fopen(argv[optind], "rb"))) {
+    fprintf(stderr, "ERROR: cannot open %s.\n", argv[optind]);
+    exit(-1);
+  }
+  size_t length;
+  uint8_t *data = readAll(input, &length);
+  if (!data) {
+    fprintf(stderr, "ERROR: unable to allocate input buffer.\n");
+    exit(-1);
+  }
+  FILE *out = fopen(outputName, "wb");
+  if (!out) {
+    fprintf(stderr, "ERROR: cannot create %s.\n", outputName);
+    exit(-1);
+  }
+
+  // Write a placeholder header, decode, then fill the header in.
+  adcTrace_header_t header;
+  memset(&header, 0, sizeof(header));
+  fwrite(&header, sizeof(header), 1, out);
+  decodeStats_t stats;
+  memset(&stats, 0, sizeof(stats));
+  uint32_t flags = decode(data, length, out, &stats);
+  memcpy(header.magic, ADC_TRACE_MAGIC, ADC_TRACE_MAGIC_BYTES);
+  header.version = ADC_TRACE_VERSION;
+  header.sampleRateHz = sampleRateHz;
+  header.flags = flags;
+  header.sampleCount = stats.sampleCount;
+  header.droppedSampleCount = stats.filledSampleCount;
+  fseek(out, 0, SEEK_SET);
+  fwrite(&header, sizeof(header), 1, out);
+  fclose(out);
+  free(data);
+
+  fprintf(stderr,
+          "%u frames, %u samples (%.3f s, %s), %u missing blocks filled, "
+          "%u CRC errors, %u bad headers, %u out-of-order frames, "
+          "%u bytes skipped.\n",
+          stats.frames, stats.sampleCount,
+          (double)stats.sampleCount / sampleRateHz,
+          (flags & ADC_TRACE_FLAG_BIPOLAR) ? "bipolar" : "unipolar",
+          stats.missingBlocks, stats.crcErrors, stats.badHeaders,
+          stats.outOfOrderFrames, stats.skippedBytes);
+  return stats.frames ? 0 : -1;
+}
@@ -0,0 +1,195 @@
+// Checks the raw ADC capture path end to end on the host: support/adcCapture.c
+// encodes a synthetic capture as the board would stream it, and
+// tools/adcCaptureDecode turns it back into a trace, which must hold the same
+// samples.
+//
+// With -o, -n pseudo-random 12-bit ADC values are captured and the frames are
+// written with console text around them, as runningModes prints it. The
+// serial link is made to lose one frame and corrupt a byte of another, which
+// the decoder must fill in with mid-scale samples. With -c, the trace that
+// adcCaptureDecode made of that stream is compared with the same values. -b
+// captures in bipolar mode, where the values are sign-extended, and -S
+// changes the values; give the same -n, -b and -S to both. A JSON summary is
+// printed on stdout, and with -c the exit status is non-zero on any mismatch.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I. -I../support adcCaptureLoopback.c ../support/adcCapture.c
+//       ../support/crc16.c -o adcCaptureLoopback
+// Usage: adcCaptureLoopback [-n samples] [-b] [-S seed] -o capture.bin
+//        adcCaptureLoopback [-n samples] [-b] [-S seed] -c capture.trace
+// Then: adcCaptureDecode -o capture.trace capture.bin
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "adcCapture.h"
+#include "adcTrace.h"
+
+// Ends in a partial block, as a capture stopped by the user does.
+#define DEFAULT_SAMPLE_COUNT (40 * ADC_CAPTURE_BLOCK_SAMPLES + 100)
+#define DEFAULT_SEED 29
+#define ADC_VALUE_MASK 0x0FFF
+#define ADC_SIGN_BIT 0x0800
+#define ADC_SIGN_EXTEND 0xF000
+// Frames the link loses and corrupts, as fractions of the capture.
+#define LOST_FRAME_DIVISOR 3
+#define CORRUPTED_FRAME_DIVISOR 2
+#define CORRUPTED_BYTE_OFFSET (ADC_CAPTURE_FRAME_HEADER_BYTES + 10)
+
+static uint32_t randomState;
+
+static uint32_t nextRandom(void) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static uint32_t blockCount(uint32_t sampleCount) {
+  return (sampleCount + ADC_CAPTURE_BLOCK_SAMPLES - 1) /
+         ADC_CAPTURE_BLOCK_SAMPLES;
+}
+
+// Blocks the link loses or corrupts. Both are whole blocks, not the last one.
+static bool isDamagedBlock(uint32_t block, uint32_t sampleCount) {
+  uint32_t blocks = blockCount(sampleCount);
+  return block == blocks / LOST_FRAME_DIVISOR ||
+         block == blocks / CORRUPTED_FRAME_DIVISOR;
+}
+
+// The sample the trace should hold for raw ADC value raw.
+static adcTrace_sample_t expectedSample(uint16_t raw, bool bipolar) {
+  if (bipolar && (raw & ADC_SIGN_BIT))
+    return (adcTrace_sample_t)(raw | ADC_SIGN_EXTEND);
+  return (adcTrace_sample_t)raw;
+}
+
+// Captures sampleCount values and writes the damaged stream to out.
+static void encode(FILE *out, uint32_t sampleCount, bool bipolar) {
+  adcCapture_init(bipolar);
+  for (uint32_t i = 0; i < sampleCount; i++)
+    adcCapture_addSample(nextRandom() & ADC_VALUE_MASK);
+  adcCapture_finish();
+
+  uint32_t blocks = blockCount(sampleCount);
+  fprintf(out, "Capturing raw ADC values.\n");
+  uint8_t frame[ADC_CAPTURE_MAX_FRAME_BYTES];
+  uint32_t frameLength, frames = 0, bytes = 0;
+  for (uint32_t block = 0; (frameLength = adcCapture_takeFrame(frame));
+       block++) {
+    if (block == blocks / LOST_FRAME_DIVISOR)
+      continue;
+    if (block == blocks / CORRUPTED_FRAME_DIVISOR)
+      frame[CORRUPTED_BYTE_OFFSET] ^= 1;
+    fwrite(frame, 1, frameLength, out);
+    frames++;
+    bytes += frameLength;
+  }
+  fprintf(out, "Capture done.\n");
+  printf("{\"samples\": %u, \"blocks\": %u, \"framesWritten\": %u, "
+         "\"bytes\": %u, \"dropped\": %u}\n",
+         sampleCount, blocks, frames, bytes,
+         adcCapture_getDroppedSampleCount());
+}
+
+// Compares the decoded trace in input with the captured values. Returns true
+// if they match.
+static bool check(FILE *input, uint32_t sampleCount, bool bipolar) {
+  adcTrace_header_t header;
+  if (fread(&header, sizeof(header), 1, input) != 1 ||
+      memcmp(header.magic, ADC_TRACE_MAGIC, ADC_TRACE_MAGIC_BYTES) != 0) {
+    fprintf(stderr, "ERROR: not a trace.\n");
+    return false;
+  }
+  adcTrace_sample_t fill =
+      bipolar ? ADC_TRACE_BIPOLAR_MIDSCALE : ADC_TRACE_UNIPOLAR_MIDSCALE;
+  uint32_t mismatches = 0, filled = 0;
+  for (uint32_t i = 0; i < sampleCount; i++) {
+    uint16_t raw = nextRandom() & ADC_VALUE_MASK;
+    adcTrace_sample_t expected = expectedSample(raw, bipolar);
+    if (isDamagedBlock(i / ADC_CAPTURE_BLOCK_SAMPLES, sampleCount)) {
+      expected = fill;
+      filled++;
+    }
+    uint8_t bytes[sizeof(adcTrace_sample_t)];
+    if (fread(bytes, 1, sizeof(bytes), input) != sizeof(bytes)) {
+      fprintf(stderr, "ERROR: the trace ends at sample %u.\n", i);
+      return false;
+    }
+    adcTrace_sample_t sample = (adcTrace_sample_t)(bytes[0] | bytes[1] << 8);
+    if (sample != expected && mismatches++ == 0)
+      fprintf(stderr, "Sample %u is %d, expected %d.\n", i, sample, expected);
+  }
+  bool flagsMatch = !(header.flags & ADC_TRACE_FLAG_BIPOLAR) == !bipolar;
+  bool passed = mismatches == 0 && flagsMatch &&
+                header.sampleCount == sampleCount &&
+                header.droppedSampleCount == filled && fgetc(input) == EOF;
+  printf("{\"samples\": %u, \"traceSamples\": %u, \"filled\": %u, "
+         "\"traceFilled\": %u, \"mismatches\": %u, \"bipolar\": %s, "
+         "\"passed\": %s}\n",
+         sampleCount, header.sampleCount, filled, header.droppedSampleCount,
+         mismatches, bipolar ? "true" : "false", passed ? "true" : "false");
+  return passed;
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t sampleCount = DEFAULT_SAMPLE_COUNT;
+  uint32_t seed = DEFAULT_SEED;
+  bool bipolar = false;
+  const char *outputName = NULL;
+  const char *checkName = NULL;
+  bool usage = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:bS:o:c:")) != -1) {
+    switch (opt) {
+    case 'n':
+      sampleCount = strtoul(optarg, NULL, 0);
+      break;
+    case 'b':
+      bipolar = true;
+      break;
+    case 'S':
+      seed = strtoul(optarg, NULL, 0);
+      break;
+    case 'o':
+      outputName = optarg;
+      break;
+    case 'c':
+      checkName = optarg;
+      break;
+    default:
+      usage = true;
+      break;
+    }
+  }
+  // The capture must fit in the ring and reach both damaged blocks.
+  uint32_t maxSamples = ADC_CAPTURE_BLOCK_COUNT * ADC_CAPTURE_BLOCK_SAMPLES;
+  if (usage || !outputName == !checkName ||
+      sampleCount < 3 * ADC_CAPTURE_BLOCK_SAMPLES || sampleCount > maxSamples) {
+    fprintf(stderr,
+            "Usage: %s [-n samples] [-b] [-S seed] -o capture.bin\n"
+            "       %s [-n samples] [-b] [-S seed] -c capture.trace\n"
+            "samples is %u to %u.\n",
+            argv[0], argv[0], 3 * ADC_CAPTURE_BLOCK_SAMPLES, maxSamples);
+    exit(-1);
+  }
+  randomState = seed ? seed : 1;
+
+  const char *name = outputName ? outputName : checkName;
+  FILE *file = fopen(name, outputName ? "wb" : "rb");
+  if (!file) {
+    fprintf(stderr, "ERROR: cannot open %s.\n", name);
+    exit(-1);
+  }
+  bool passed = true;
+  if (outputName)
+    encode(file, sampleCount, bipolar);
+  else
+    passed = check(file, sampleCount, bipolar);
+  fclose(file);
+  return passed ? 0 : -1;
+}
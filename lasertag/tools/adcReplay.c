@@ -0,0 +1,329 @@
+// Replays recorded ADC traces (see adcTrace.h) through the real buffer, filter
+// and detector code as fast as the host allows.
+//
+// For every trace a JSON-lines file is written next to the trace (or into the
+// -o directory) named <trace>.replay.jsonl. It holds one "power" record per
+// window of -w input samples with the ten current power values, and one "hit"
+// record per detector hit event. A summary line per trace, with the replay
+// speed as a multiple of real time, is printed on stdout.
+//
+// filter.c and detector.c keep their state in static variables, so traces are
+// replayed in parallel by forking one worker process per trace, up to -j at a
+// time (default: one per online CPU).
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I. -I.. -I../support -I../../include -I../../drivers
+//       -I../../platforms/zybo/xil_arm_toolchain/bsp/ps7_cortexa9_0/include
+//       adcReplay.c pipelineSim.c ../../platforms/host/interrupts.c
+//       ../detector.c ../filter.c ../queue.c ../buffer.c ../support/profiler.c
+//       -pthread -lm -o adcReplay
+// Usage: adcReplay [-j jobs] [-w windowSamples] [-f fudgeFactorIndex]
+//                  [-o outputDirectory] trace...
+
+#include <errno.h>
+#include <fcntl.h>
+#include <libgen.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <sys/wait.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "adcTrace.h"
+#include "buffer.h"
+#include "detector.h"
+#include "filter.h"
+#include "lockoutTimer.h"
+#include "pipelineSim.h"
+
+#define DEFAULT_WINDOW_SAMPLES 1000 // 10 ms at 100 kHz.
+#define DEFAULT_FUDGE_FACTOR_INDEX 2
+#define NOMINAL_SAMPLE_RATE_HZ (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000)
+#define NANOSECONDS_PER_SECOND 1e9
+#define MAX_PATH_LENGTH 4096
+
+// Bipolar samples are shifted by this to look like the unipolar values the
+// detector scales.
+#define BIPOLAR_TO_UNIPOLAR_OFFSET 2048
+
+#define MAX_EVENTS_PER_DRAIN DETECTOR_HIT_EVENT_QUEUE_SIZE
+
+typedef struct {
+  uint32_t windowSamples;
+  uint32_t fudgeFactorIndex;
+  const char *outputDirectory; // NULL: next to the trace.
+} replayOptions_t;
+
+// Sent from each worker to the parent through a pipe.
+typedef struct {
+  bool ok;
+  uint32_t sampleCount;
+  uint32_t sampleRateHz;
+  uint32_t hitCount;
+  uint32_t hitEventOverflowCount;
+  double traceSeconds;
+  double wallSeconds;
+} replayResult_t;
+
+static double monotonicSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / NANOSECONDS_PER_SECOND;
+}
+
+// Maps tracePath read-only and checks its header. Returns NULL on error.
+static const adcTrace_header_t *mapTrace(const char *tracePath,
+                                         size_t *mappedBytes) {
+  int fd = open(tracePath, O_RDONLY);
+  if (fd < 0) {
+    fprintf(stderr, "ERROR: cannot open %s: %s.\n", tracePath,
+            strerror(errno));
+    return NULL;
+  }
+  struct stat status;
+  if (fstat(fd, &status) ||
+      (size_t)status.st_size < sizeof(adcTrace_header_t)) {
+    fprintf(stderr, "ERROR: %s is too short to be a trace.\n", tracePath);
+    close(fd);
+    return NULL;
+  }
+  *mappedBytes = status.st_size;
+  void *map = mmap(NULL, *mappedBytes, PROT_READ, MAP_PRIVATE, fd, 0);
+  close(fd);
+  if (map == MAP_FAILED) {
+    fprintf(stderr, "ERROR: cannot map %s: %s.\n", tracePath,
+            strerror(errno));
+    return NULL;
+  }
+  // The samples are read once, front to back.
+  madvise(map, *mappedBytes, MADV_SEQUENTIAL);
+  const adcTrace_header_t *header = map;
+  size_t neededBytes = sizeof(adcTrace_header_t) +
+                       (size_t)header->sampleCount * sizeof(adcTrace_sample_t);
+  if (memcmp(header->magic, ADC_TRACE_MAGIC, ADC_TRACE_MAGIC_BYTES) ||
+      header->version != ADC_TRACE_VERSION || neededBytes > *mappedBytes) {
+    fprintf(stderr, "ERROR: %s is not a valid version %d trace.\n", tracePath,
+            ADC_TRACE_VERSION);
+    munmap(map, *mappedBytes);
+    return NULL;
+  }
+  return header;
+}
+
+// Builds the output path for tracePath into outputPath.
+static void outputPathFor(const char *tracePath, const replayOptions_t *options,
+                          char outputPath[MAX_PATH_LENGTH]) {
+  if (options->outputDirectory) {
+    char base[MAX_PATH_LENGTH];
+    snprintf(base, sizeof(base), "%s", tracePath);
+    snprintf(outputPath, MAX_PATH_LENGTH, "%s/%s.replay.jsonl",
+             options->outputDirectory, basename(base));
+  } else {
+    snprintf(outputPath, MAX_PATH_LENGTH, "%s.replay.jsonl", tracePath);
+  }
+}
+
+static void writeHitEvents(FILE *out, uint32_t sampleRateHz,
+                           replayResult_t *result) {
+  detector_hitEvent_t events[MAX_EVENTS_PER_DRAIN];
+  uint16_t count;
+  while ((count = detector_getHitEvents(events, MAX_EVENTS_PER_DRAIN))) {
+    for (uint16_t i = 0; i < count; i++) {
+      fprintf(out,
+              "{\"type\": \"hit\", \"sample\": %u, \"time\": %.5f, "
+              "\"frequency\": %u, \"peakPower\": %.6g, \"ratio\": %.3f}\n",
+              events[i].sampleIndex,
+              (double)events[i].sampleIndex / sampleRateHz,
+              events[i].frequencyNumber, events[i].peakPower,
+              events[i].powerRatio);
+      result->hitCount++;
+    }
+  }
+}
+
+static void writePowerValues(FILE *out, uint32_t sampleIndex,
+                             uint32_t sampleRateHz) {
+  double power[FILTER_FREQUENCY_COUNT];
+  filter_getCurrentPowerValues(power);
+  fprintf(out, "{\"type\": \"power\", \"sample\": %u, \"time\": %.5f, "
+               "\"power\": [",
+          sampleIndex, (double)sampleIndex / sampleRateHz);
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+    fprintf(out, "%s%.6g", f ? ", " : "", power[f]);
+  fprintf(out, "]}\n");
+}
+
+// Replays one trace. Runs in a worker process.
+static replayResult_t replayTrace(const char *tracePath,
+                                  const replayOptions_t *options) {
+  replayResult_t result;
+  memset(&result, 0, sizeof(result));
+  size_t mappedBytes;
+  const adcTrace_header_t *header = mapTrace(tracePath, &mappedBytes);
+  if (!header)
+    return result;
+  char outputPath[MAX_PATH_LENGTH];
+  outputPathFor(tracePath, options, outputPath);
+  FILE *out = fopen(outputPath, "w");
+  if (!out) {
+    fprintf(stderr, "ERROR: cannot create %s.\n", outputPath);
+    munmap((void *)header, mappedBytes);
+    return result;
+  }
+  if (header->sampleRateHz != NOMINAL_SAMPLE_RATE_HZ)
+    fprintf(stderr,
+            "WARNING: %s was recorded at %u Hz; the filters are designed for "
+            "%d Hz.\n",
+            tracePath, header->sampleRateHz, NOMINAL_SAMPLE_RATE_HZ);
+
+  const adcTrace_sample_t *samples = (const adcTrace_sample_t *)(header + 1);
+  int16_t offset =
+      (header->flags & ADC_TRACE_FLAG_BIPOLAR) ? BIPOLAR_TO_UNIPOLAR_OFFSET : 0;
+  double start = monotonicSeconds();
+  pipelineSim_init();
+  detector_setFudgeFactorIndex(options->fudgeFactorIndex);
+  // Like shooter mode, ignore the hits the empty power windows cause at
+  // start-up.
+  lockoutTimer_start();
+  // Each window fits in the ADC buffer, so nothing is overwritten.
+  for (uint32_t i = 0; i < header->sampleCount;) {
+    uint32_t windowEnd = i + options->windowSamples;
+    if (windowEnd > header->sampleCount)
+      windowEnd = header->sampleCount;
+    for (; i < windowEnd; i++)
+      pipelineSim_tick(pipelineSim_toAdcValue(samples[i] + offset -
+                                              PIPELINE_SIM_ADC_MIDSCALE));
+    detector(false);
+    writeHitEvents(out, header->sampleRateHz, &result);
+    writePowerValues(out, i, header->sampleRateHz);
+  }
+  result.wallSeconds = monotonicSeconds() - start;
+  result.ok = true;
+  result.sampleCount = header->sampleCount;
+  result.sampleRateHz = header->sampleRateHz;
+  result.traceSeconds = (double)header->sampleCount / header->sampleRateHz;
+  result.hitEventOverflowCount = detector_getHitEventOverflowCount();
+  fclose(out);
+  munmap((void *)header, mappedBytes);
+  return result;
+}
+
+typedef struct {
+  pid_t pid;
+  int readFd;
+  const char *tracePath;
+} worker_t;
+
+static void printResult(const char *tracePath, const replayResult_t *result) {
+  if (!result->ok) {
+    printf("{\"trace\": \"%s\", \"ok\": false}\n", tracePath);
+    return;
+  }
+  printf("{\"trace\": \"%s\", \"ok\": true, \"samples\": %u, "
+         "\"traceSeconds\": %.3f, \"wallSeconds\": %.3f, "
+         "\"realTimeMultiple\": %.1f, \"hits\": %u, \"hitsDropped\": %u}\n",
+         tracePath, result->sampleCount, result->traceSeconds,
+         result->wallSeconds, result->traceSeconds / result->wallSeconds,
+         result->hitCount, result->hitEventOverflowCount);
+  fflush(stdout);
+}
+
+// Waits for any worker to finish, prints its result and frees its slot.
+// Returns the trace seconds it replayed.
+static double reapWorker(worker_t workers[], uint32_t *running,
+                         bool *allOk) {
+  pid_t pid = wait(NULL);
+  for (uint32_t w = 0; w < *running; w++) {
+    if (workers[w].pid != pid)
+      continue;
+    replayResult_t result;
+    if (read(workers[w].readFd, &result, sizeof(result)) != sizeof(result))
+      result.ok = false;
+    close(workers[w].readFd);
+    printResult(workers[w].tracePath, &result);
+    *allOk = *allOk && result.ok;
+    workers[w] = workers[--(*running)];
+    return result.ok ? result.traceSeconds : 0;
+  }
+  return 0;
+}
+
+int main(int argc, char *argv[]) {
+  replayOptions_t options = {DEFAULT_WINDOW_SAMPLES, DEFAULT_FUDGE_FACTOR_INDEX,
+                             NULL};
+  long jobs = sysconf(_SC_NPROCESSORS_ONLN);
+  int opt;
+  while ((opt = getopt(argc, argv, "j:w:f:o:")) != -1) {
+    switch (opt) {
+    case 'j':
+      jobs = strtol(optarg, NULL, 0);
+      break;
+    case 'w':
+      options.windowSamples = strtoul(optarg, NULL, 0);
+      break;
+    case 'f':
+      options.fudgeFactorIndex = strtoul(optarg, NULL, 0);
+      break;
+    case 'o':
+      options.outputDirectory = optarg;
+      break;
+    default:
+      optind = argc;
+      break;
+    }
+  }
+  if (optind >= argc || options.windowSamples == 0 ||
+      options.windowSamples > buffer_size()) {
+    fprintf(stderr,
+            "Usage: %s [-j jobs] [-w windowSamples (1..%u)] "
+            "[-f fudgeFactorIndex] [-o outputDirectory] trace...\n",
+            argv[0], buffer_size());
+    exit(-1);
+  }
+  if (jobs < 1)
+    jobs = 1;
+
+  worker_t *workers = calloc(jobs, sizeof(worker_t));
+  uint32_t running = 0;
+  bool allOk = true;
+  double totalTraceSeconds = 0;
+  double start = monotonicSeconds();
+  for (int t = optind; t < argc; t++) {
+    if (running == jobs)
+      totalTraceSeconds += reapWorker(workers, &running, &allOk);
+    int fds[2];
+    if (pipe(fds)) {
+      perror("pipe");
+      exit(-1);
+    }
+    fflush(stdout); // Don't let the child inherit buffered output.
+    pid_t pid = fork();
+    if (pid < 0) {
+      perror("fork");
+      exit(-1);
+    }
+    if (pid == 0) {
+      close(fds[0]);
+      replayResult_t result = replayTrace(argv[t], &options);
+      ssize_t written = write(fds[1], &result, sizeof(result));
+      _exit(written == sizeof(result) && result.ok ? 0 : 1);
+    }
+    close(fds[1]);
+    workers[running++] = (worker_t){pid, fds[0], argv[t]};
+  }
+  while (running)
+    totalTraceSeconds += reapWorker(workers, &running, &allOk);
+  double wallSeconds = monotonicSeconds() - start;
+  printf("{\"summary\": true, \"traces\": %d, \"jobs\": %ld, "
+         "\"traceSeconds\": %.3f, \"wallSeconds\": %.3f, "
+         "\"realTimeMultiple\": %.1f}\n",
+         argc - optind, jobs, totalTraceSeconds, wallSeconds,
+         totalTraceSeconds / wallSeconds);
+  free(workers);
+  return allOk ? 0 : -1;
+}
@@ -0,0 +1,228 @@
+// Checks tools/adcReplay against a trace whose answer is known: one shot at
+// frequency -f in quiet noise.
+//
+// With -o, a unipolar trace (see adcTrace.h) is written: LEAD_SAMPLES of
+// noise, long enough for the start-up lockout to run out and the power
+// windows to fill, then a TRANSMITTER_PULSE_WIDTH square-wave pulse at the
+// frequency, then TAIL_SAMPLES of noise. With -c, the replay adcReplay wrote
+// for it is checked:
+//   - exactly one hit, at the frequency, between the start of the pulse and
+//     one power window after its end;
+//   - a power record every window, the window being the first record's
+//     sample, through the end of the trace;
+//   - at the end of the pulse the frequency has the most power, by
+//     MIN_POWER_RATIO over the next, and before the pulse it had less than
+//     1 / MIN_POWER_RATIO of that.
+// Give the same -f to both. A JSON summary is printed on stdout, and with -c
+// the exit status is non-zero if a check fails.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I. -I.. adcReplayCheck.c -lm -o adcReplayCheck
+// Usage: adcReplayCheck [-f frequencyNumber] -o replay.trace
+//        adcReplayCheck [-f frequencyNumber] -c replay.trace.replay.jsonl
+// Between them: adcReplay replay.trace
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "adcTrace.h"
+#include "filter.h"
+#include "lockoutTimer.h"
+#include "transmitter.h"
+
+#define SAMPLE_RATE_HZ (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000)
+#define POWER_WINDOW_SAMPLES                                                   \
+  (FILTER_INPUT_PULSE_WIDTH * FILTER_FIR_DECIMATION_FACTOR)
+#define LEAD_SAMPLES (LOCKOUT_TIMER_EXPIRE_VALUE + POWER_WINDOW_SAMPLES)
+// Short enough that the lockout after the hit outlasts the trace.
+#define TAIL_SAMPLES (LOCKOUT_TIMER_EXPIRE_VALUE / 2)
+#define TRACE_SAMPLES (LEAD_SAMPLES + TRANSMITTER_PULSE_WIDTH + TAIL_SAMPLES)
+#define DEFAULT_FREQUENCY_NUMBER 3
+#define PULSE_AMPLITUDE 200.0 // ADC counts either side of mid-scale.
+#define NOISE_SIGMA 20.0      // 20 dB below the pulse.
+#define SEED 30
+#define MIN_POWER_RATIO 10.0
+#define MAX_LINE_LENGTH 1024
+#define TWO_PI 6.283185307179586
+
+static uint32_t randomState = SEED;
+
+static uint32_t nextRandom(void) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+// Box-Muller, one value per call.
+static double gaussian(void) {
+  double u1 = (nextRandom() + 1.0) / 4294967297.0;
+  double u2 = nextRandom() / 4294967296.0;
+  return sqrt(-2.0 * log(u1)) * cos(TWO_PI * u2);
+}
+
+static void writeTrace(FILE *out, uint16_t frequencyNumber) {
+  adcTrace_header_t header;
+  memset(&header, 0, sizeof(header));
+  memcpy(header.magic, ADC_TRACE_MAGIC, ADC_TRACE_MAGIC_BYTES);
+  header.version = ADC_TRACE_VERSION;
+  header.sampleRateHz = SAMPLE_RATE_HZ;
+  header.sampleCount = TRACE_SAMPLES;
+  fwrite(&header, sizeof(header), 1, out);
+  uint16_t halfPeriod = filter_frequencyTickTable[frequencyNumber] / 2;
+  for (uint32_t i = 0; i < TRACE_SAMPLES; i++) {
+    double value = NOISE_SIGMA * gaussian();
+    uint32_t pulseOffset = i - LEAD_SAMPLES;
+    if (i >= LEAD_SAMPLES && pulseOffset < TRANSMITTER_PULSE_WIDTH)
+      value += ((pulseOffset / halfPeriod) % 2) ? -PULSE_AMPLITUDE
+                                                : PULSE_AMPLITUDE;
+    int32_t sample = ADC_TRACE_UNIPOLAR_MIDSCALE + lround(value);
+    uint16_t bits = (uint16_t)sample;
+    fputc(bits & 0xFF, out);
+    fputc(bits >> 8, out);
+  }
+  printf("{\"samples\": %u, \"pulseStart\": %u, \"pulseSamples\": %u, "
+         "\"frequency\": %u}\n",
+         TRACE_SAMPLES, LEAD_SAMPLES, TRANSMITTER_PULSE_WIDTH, frequencyNumber);
+}
+
+// Reads the power array of a power record into power. Returns false if it
+// does not hold FILTER_FREQUENCY_COUNT values.
+static bool parsePowers(const char *line, double power[]) {
+  const char *p = strchr(line, '[');
+  for (uint16_t f = 0; p && f < FILTER_FREQUENCY_COUNT; f++) {
+    char *end;
+    power[f] = strtod(p + 1, &end);
+    if (end == p + 1)
+      return false;
+    p = end;
+  }
+  return p && *p == ']';
+}
+
+// Returns the frequency with the most power and sets runnerUp to the power
+// of the one after it.
+static uint16_t strongest(const double power[], double *runnerUp) {
+  uint16_t best = 0;
+  for (uint16_t f = 1; f < FILTER_FREQUENCY_COUNT; f++)
+    if (power[f] > power[best])
+      best = f;
+  *runnerUp = 0.0;
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++)
+    if (f != best && power[f] > *runnerUp)
+      *runnerUp = power[f];
+  return best;
+}
+
+static bool checkReplay(FILE *input, uint16_t frequencyNumber) {
+  const uint32_t pulseEnd = LEAD_SAMPLES + TRANSMITTER_PULSE_WIDTH;
+  uint32_t hits = 0, goodHits = 0, records = 0, window = 0;
+  uint32_t hitSample = 0, hitFrequency = 0;
+  bool recordsInStep = true, havePulsePower = false;
+  double before[FILTER_FREQUENCY_COUNT] = {0};
+  double during[FILTER_FREQUENCY_COUNT] = {0};
+  char line[MAX_LINE_LENGTH];
+  while (fgets(line, sizeof(line), input)) {
+    uint32_t sample, frequency;
+    double time;
+    if (sscanf(line, "{\"type\": \"hit\", \"sample\": %u, \"time\": %lf, "
+                     "\"frequency\": %u",
+               &sample, &time, &frequency) == 3) {
+      hits++;
+      hitSample = sample;
+      hitFrequency = frequency;
+      if (frequency == frequencyNumber && sample >= LEAD_SAMPLES &&
+          sample < pulseEnd + POWER_WINDOW_SAMPLES)
+        goodHits++;
+    } else if (sscanf(line, "{\"type\": \"power\", \"sample\": %u", &sample) ==
+               1) {
+      double power[FILTER_FREQUENCY_COUNT];
+      if (!parsePowers(line, power)) {
+        fprintf(stderr, "ERROR: bad power record: %s", line);
+        return false;
+      }
+      if (!window)
+        window = sample;
+      records++;
+      uint32_t expected = records * window;
+      if (expected > TRACE_SAMPLES)
+        expected = TRACE_SAMPLES;
+      recordsInStep = recordsInStep && sample == expected;
+      if (sample <= LEAD_SAMPLES)
+        memcpy(before, power, sizeof(before));
+      if (sample == pulseEnd) {
+        memcpy(during, power, sizeof(during));
+        havePulsePower = true;
+      }
+    }
+  }
+  uint32_t expectedRecords = window ? (TRACE_SAMPLES + window - 1) / window : 0;
+  double runnerUp;
+  uint16_t strongestDuring = strongest(during, &runnerUp);
+  double ratio = runnerUp > 0.0 ? during[frequencyNumber] / runnerUp : 0.0;
+  double riseRatio = before[frequencyNumber] > 0.0
+                         ? during[frequencyNumber] / before[frequencyNumber]
+                         : 0.0;
+  bool passed = hits == 1 && goodHits == 1 && recordsInStep &&
+                records == expectedRecords && havePulsePower &&
+                strongestDuring == frequencyNumber &&
+                ratio >= MIN_POWER_RATIO && riseRatio >= MIN_POWER_RATIO;
+  printf("{\"hits\": %u, \"hitSample\": %u, \"hitFrequency\": %u, "
+         "\"powerRecords\": %u, \"expectedPowerRecords\": %u, "
+         "\"strongestAtPulseEnd\": %u, \"powerRatio\": %.1f, "
+         "\"riseRatio\": %.1f, \"passed\": %s}\n",
+         hits, hitSample, hitFrequency, records, expectedRecords,
+         strongestDuring, ratio, riseRatio, passed ? "true" : "false");
+  return passed;
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t frequencyNumber = DEFAULT_FREQUENCY_NUMBER;
+  const char *outputName = NULL;
+  const char *checkName = NULL;
+  bool usage = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "f:o:c:")) != -1) {
+    switch (opt) {
+    case 'f':
+      frequencyNumber = strtoul(optarg, NULL, 0);
+      break;
+    case 'o':
+      outputName = optarg;
+      break;
+    case 'c':
+      checkName = optarg;
+      break;
+    default:
+      usage = true;
+      break;
+    }
+  }
+  if (usage || !outputName == !checkName ||
+      frequencyNumber >= FILTER_FREQUENCY_COUNT) {
+    fprintf(stderr,
+            "Usage: %s [-f frequencyNumber] -o replay.trace\n"
+            "       %s [-f frequencyNumber] -c replay.trace.replay.jsonl\n",
+            argv[0], argv[0]);
+    exit(-1);
+  }
+
+  const char *name = outputName ? outputName : checkName;
+  FILE *file = fopen(name, outputName ? "wb" : "r");
+  if (!file) {
+    fprintf(stderr, "ERROR: cannot open %s.\n", name);
+    exit(-1);
+  }
+  bool passed = true;
+  if (outputName)
+    writeTrace(file, frequencyNumber);
+  else
+    passed = checkReplay(file, frequencyNumber);
+  fclose(file);
+  return passed ? 0 : -1;
+}
@@ -0,0 +1,33 @@
+#ifndef ADCTRACE_H_
+#define ADCTRACE_H_
+
+#include <stdint.h>
+
+// On-disk format of a recorded ADC trace, written by adcCaptureDecode and
+// read by the replay tools. A 32-byte header is followed by sampleCount
+// little-endian int16 samples, one per ADC sample period, with dropped blocks
+// filled in at mid-scale so timing is preserved. Samples are sign-extended
+// when ADC_TRACE_FLAG_BIPOLAR is set and unipolar 0..4095 otherwise.
+
+#define ADC_TRACE_MAGIC "LTADCTRC"
+#define ADC_TRACE_MAGIC_BYTES 8
+#define ADC_TRACE_VERSION 1
+#define ADC_TRACE_FLAG_BIPOLAR 0x01
+
+// Mid-scale value used to fill dropped blocks.
+#define ADC_TRACE_UNIPOLAR_MIDSCALE 2048
+#define ADC_TRACE_BIPOLAR_MIDSCALE 0
+
+typedef struct {
+  char magic[ADC_TRACE_MAGIC_BYTES];
+  uint32_t version;
+  uint32_t sampleRateHz;
+  uint32_t flags;
+  uint32_t sampleCount;
+  uint32_t droppedSampleCount; // Filled-in samples included in sampleCount.
+  uint32_t reserved;
+} adcTrace_header_t;
+
+typedef int16_t adcTrace_sample_t;
+
+#endif /* ADCTRACE_H_ */
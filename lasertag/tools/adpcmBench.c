@@ -0,0 +1,147 @@
+// Measures the cost of decoding the IMA-ADPCM sound assets on the host and
+// checks that encoding round-trips with sensible quality.
+//
+// Each WAV file (48 kHz, 16-bit mono, as in lasertag/sound/wav) is encoded
+// with adpcm_encode() and then decoded repeatedly the way sound_tick() does
+// it: SOUND_DECODE_CHUNK_SAMPLES at a time. The tool reports the PCM and ADPCM
+// sizes, the signal-to-noise ratio of the decoded sound, the decode time per
+// sample and the decode time per tick, where a tick refills the samples that
+// played since the last tick. Results are printed as JSON on stdout.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I../sound adpcmBench.c ../sound/adpcm.c -lm -o adpcmBench
+// Usage: adpcmBench [-t tickPeriodMs] [-r repetitions] file.wav...
+
+#include <math.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "adpcm.h"
+
+#define WAV_HEADER_BYTES 44
+#define SOUND_SAMPLE_RATE_HZ 48000
+#define SOUND_DECODE_CHUNK_SAMPLES 32 // Matches SOUND_MIXER_BLOCK_SAMPLES.
+#define DEFAULT_TICK_PERIOD_MS 10.0
+#define DEFAULT_REPETITIONS 20
+#define MS_PER_SECOND 1000.0
+#define NS_PER_SECOND 1e9
+
+static double monotonicSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / NS_PER_SECOND;
+}
+
+// Reads the samples of a canonical 16-bit mono WAV file into a malloc'd
+// buffer. Returns NULL if the file cannot be read.
+static int16_t *readWav(const char *fileName, uint32_t *sampleCount) {
+  FILE *fp = fopen(fileName, "rb");
+  if (!fp)
+    return NULL;
+  fseek(fp, 0, SEEK_END);
+  long bytes = ftell(fp) - WAV_HEADER_BYTES;
+  fseek(fp, WAV_HEADER_BYTES, SEEK_SET);
+  int16_t *samples = bytes > 0 ? malloc(bytes) : NULL;
+  *sampleCount = bytes / sizeof(int16_t);
+  if (samples &&
+      fread(samples, sizeof(int16_t), *sampleCount, fp) != *sampleCount) {
+    free(samples);
+    samples = NULL;
+  }
+  fclose(fp);
+  return samples;
+}
+
+// Decodes the whole stream in sound_tick()-sized chunks into decoded.
+static void decodeAll(const uint8_t *encoded, uint32_t sampleCount,
+                      int16_t decoded[]) {
+  adpcm_decoder_t decoder;
+  adpcm_initDecoder(&decoder, encoded, sampleCount);
+  uint32_t offset = 0;
+  while (!adpcm_isDone(&decoder))
+    offset += adpcm_decode(&decoder, &decoded[offset],
+                           SOUND_DECODE_CHUNK_SAMPLES);
+}
+
+static double getSnrDb(const int16_t original[], const int16_t decoded[],
+                       uint32_t sampleCount) {
+  double signal = 0.0, noise = 0.0;
+  for (uint32_t i = 0; i < sampleCount; i++) {
+    double error = (double)original[i] - decoded[i];
+    signal += (double)original[i] * original[i];
+    noise += error * error;
+  }
+  return noise > 0.0 ? 10.0 * log10(signal / noise) : INFINITY;
+}
+
+int main(int argc, char *argv[]) {
+  double tickPeriodMs = DEFAULT_TICK_PERIOD_MS;
+  uint32_t repetitions = DEFAULT_REPETITIONS;
+  int opt;
+  while ((opt = getopt(argc, argv, "t:r:")) != -1) {
+    switch (opt) {
+    case 't':
+      tickPeriodMs = atof(optarg);
+      break;
+    case 'r':
+      repetitions = strtoul(optarg, NULL, 0);
+      break;
+    default:
+      optind = argc;
+      break;
+    }
+  }
+  if (optind >= argc || repetitions == 0) {
+    fprintf(stderr,
+            "Usage: %s [-t tickPeriodMs] [-r repetitions] file.wav...\n",
+            argv[0]);
+    exit(-1);
+  }
+  double samplesPerTick = SOUND_SAMPLE_RATE_HZ * tickPeriodMs / MS_PER_SECOND;
+
+  printf("{\"tickPeriodMs\": %g, \"samplesPerTick\": %g, \"sounds\": [\n",
+         tickPeriodMs, samplesPerTick);
+  uint64_t totalPcmBytes = 0, totalAdpcmBytes = 0;
+  for (int f = optind; f < argc; f++) {
+    uint32_t sampleCount;
+    int16_t *samples = readWav(argv[f], &sampleCount);
+    if (!samples) {
+      fprintf(stderr, "ERROR: cannot read %s.\n", argv[f]);
+      exit(-1);
+    }
+    uint32_t byteCount = adpcm_getEncodedByteCount(sampleCount);
+    uint8_t *encoded = malloc(byteCount);
+    int16_t *decoded = malloc(sampleCount * sizeof(int16_t));
+    adpcm_encode(samples, sampleCount, encoded);
+
+    // Keep the best pass; the others include scheduling noise.
+    double bestSeconds = INFINITY;
+    for (uint32_t r = 0; r < repetitions; r++) {
+      double start = monotonicSeconds();
+      decodeAll(encoded, sampleCount, decoded);
+      double seconds = monotonicSeconds() - start;
+      if (seconds < bestSeconds)
+        bestSeconds = seconds;
+    }
+    double nsPerSample = bestSeconds * NS_PER_SECOND / sampleCount;
+    printf("  {\"file\": \"%s\", \"samples\": %u, \"pcmBytes\": %u, "
+           "\"adpcmBytes\": %u, \"snrDb\": %.1f, \"nsPerSample\": %.2f, "
+           "\"usPerTick\": %.2f}%s\n",
+           argv[f], sampleCount, sampleCount * (uint32_t)sizeof(int16_t),
+           byteCount, getSnrDb(samples, decoded, sampleCount), nsPerSample,
+           nsPerSample * samplesPerTick / 1000.0, f + 1 < argc ? "," : "");
+    totalPcmBytes += sampleCount * sizeof(int16_t);
+    totalAdpcmBytes += byteCount;
+    free(samples);
+    free(encoded);
+    free(decoded);
+  }
+  printf("], \"pcmBytes\": %llu, \"adpcmBytes\": %llu}\n",
+         (unsigned long long)totalPcmBytes,
+         (unsigned long long)totalAdpcmBytes);
+  return 0;
+}
@@ -0,0 +1,236 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "bluetooth.h"
+#include "bluetoothHost.h"
+#include "xscugic.h"
+#include "xuartlite.h"
+
+#define LINK_BYTES 4096 // Buffers at the far end of the link.
+#define BITS_PER_BYTE 8
+
+// A byte ring.
+typedef struct {
+  uint8_t *data;
+  uint32_t size;
+  uint32_t head; // Next byte to read.
+  uint32_t count;
+} ring_t;
+
+static uint8_t transmitFifoData[BLUETOOTH_HOST_FIFO_BYTES];
+static uint8_t receiveFifoData[BLUETOOTH_HOST_FIFO_BYTES];
+static uint8_t wireData[LINK_BYTES];
+static uint8_t farEndData[LINK_BYTES];
+static ring_t transmitFifo = {.data = transmitFifoData,
+                              .size = BLUETOOTH_HOST_FIFO_BYTES};
+static ring_t receiveFifo = {.data = receiveFifoData,
+                             .size = BLUETOOTH_HOST_FIFO_BYTES};
+static ring_t wire = {.data = wireData, .size = LINK_BYTES};
+static ring_t farEnd = {.data = farEndData, .size = LINK_BYTES};
+
+static bool uartInterruptEnabled;
+static Xil_InterruptHandler gicHandler;
+static void *gicCallBackRef;
+static bool gicEnabled;
+
+static bluetoothHost_stats_t stats;
+static double errorRate;
+static uint32_t randomState;
+static double byteCredit; // Byte times not yet used up.
+
+static bool ringPut(ring_t *ring, uint8_t byte) {
+  if (ring->count == ring->size)
+    return false;
+  ring->data[(ring->head + ring->count++) % ring->size] = byte;
+  return true;
+}
+
+static uint8_t ringGet(ring_t *ring) {
+  uint8_t byte = ring->data[ring->head];
+  ring->head = (ring->head + 1) % ring->size;
+  ring->count--;
+  return byte;
+}
+
+// xorshift32, so runs repeat for a given seed on any host.
+static uint32_t nextRandom(void) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static double nextUniform(void) { return nextRandom() / 4294967296.0; }
+
+// Empties the FIFOs and the link, clears the statistics and sets the chance of
+// each byte going out having one bit flipped. Call before bluetooth_init().
+void bluetoothHost_init(double byteErrorRate, uint32_t seed) {
+  transmitFifo.head = transmitFifo.count = 0;
+  receiveFifo.head = receiveFifo.count = 0;
+  wire.head = wire.count = 0;
+  farEnd.head = farEnd.count = 0;
+  uartInterruptEnabled = false;
+  gicHandler = NULL;
+  gicEnabled = false;
+  memset(&stats, 0, sizeof(stats));
+  errorRate = byteErrorRate;
+  randomState = seed ? seed : 1;
+  byteCredit = 0.0;
+}
+
+// Changes the chance of a byte going out being corrupted.
+void bluetoothHost_setByteErrorRate(double byteErrorRate) {
+  errorRate = byteErrorRate;
+}
+
+// Delivers an interrupt raised by the UART, or counts it as lost.
+static void raiseInterrupt(void) {
+  if (!gicHandler || !gicEnabled)
+    return;
+  if (!uartInterruptEnabled) {
+    stats.lostInterrupts++;
+    return;
+  }
+  stats.interrupts++;
+  gicHandler(gicCallBackRef);
+}
+
+// Moves time forward a byte time at a time.
+void bluetoothHost_advance(double seconds) {
+  byteCredit += seconds * BLUETOOTH_HOST_BYTES_PER_SECOND;
+  for (; byteCredit >= 1.0; byteCredit -= 1.0) {
+    bool interrupt = false;
+    if (transmitFifo.count > 0) {
+      uint8_t byte = ringGet(&transmitFifo);
+      if (errorRate > 0.0 && nextUniform() < errorRate) {
+        byte ^= 1 << (nextRandom() % BITS_PER_BYTE);
+        stats.bytesCorrupted++;
+      }
+      stats.bytesSent++;
+      if (!ringPut(&wire, byte))
+        fprintf(stderr, "bluetoothHost: link buffer overflow.\n");
+      interrupt = (transmitFifo.count == 0);
+    } else if (bluetooth_transmitQueueElementCount() > 0) {
+      stats.idleByteTimes++;
+    }
+    if (farEnd.count > 0) {
+      uint8_t byte = ringGet(&farEnd);
+      if (ringPut(&receiveFifo, byte)) {
+        stats.bytesReceived++;
+        interrupt |= (receiveFifo.count == 1);
+      } else {
+        stats.receiveOverruns++;
+      }
+    }
+    if (interrupt)
+      raiseInterrupt();
+    uint32_t fill = bluetooth_transmitQueueElementCount();
+    if (fill > stats.maxQueueFill)
+      stats.maxQueueFill = fill;
+  }
+}
+
+// Reads up to maxSize bytes that have arrived at the far end of the link.
+// Returns the number read.
+uint32_t bluetoothHost_readWire(uint8_t *data, uint32_t maxSize) {
+  uint32_t count = 0;
+  while (count < maxSize && wire.count > 0)
+    data[count++] = ringGet(&wire);
+  return count;
+}
+
+// Queues size bytes at the far end to be sent to the device at the link
+// rate. Returns the number queued.
+uint32_t bluetoothHost_sendToDevice(const uint8_t *data, uint32_t size) {
+  uint32_t count = 0;
+  while (count < size && ringPut(&farEnd, data[count]))
+    count++;
+  return count;
+}
+
+// Returns the number of bytes still in the transmit queue and FIFO.
+uint32_t bluetoothHost_getPendingBytes(void) {
+  return bluetooth_transmitQueueElementCount() + transmitFifo.count;
+}
+
+// Returns the statistics since bluetoothHost_init().
+const bluetoothHost_stats_t *bluetoothHost_getStats(void) { return &stats; }
+
+// The parts of the UARTLite driver bluetooth.c uses.
+
+int XUartLite_Initialize(XUartLite *InstancePtr, u16 DeviceId) {
+  (void)DeviceId;
+  memset(InstancePtr, 0, sizeof(*InstancePtr));
+  return XST_SUCCESS;
+}
+
+void XUartLite_ResetFifos(XUartLite *InstancePtr) {
+  (void)InstancePtr;
+  transmitFifo.head = transmitFifo.count = 0;
+  receiveFifo.head = receiveFifo.count = 0;
+}
+
+// Fills the transmit FIFO as far as it goes.
+unsigned int XUartLite_Send(XUartLite *InstancePtr, u8 *DataBufferPtr,
+                            unsigned int NumBytes) {
+  (void)InstancePtr;
+  unsigned int count = 0;
+  while (count < NumBytes && ringPut(&transmitFifo, DataBufferPtr[count]))
+    count++;
+  stats.sendCalls += (count > 0);
+  return count;
+}
+
+// Empties the receive FIFO as far as asked.
+unsigned int XUartLite_Recv(XUartLite *InstancePtr, u8 *DataBufferPtr,
+                            unsigned int NumBytes) {
+  (void)InstancePtr;
+  unsigned int count = 0;
+  while (count < NumBytes && receiveFifo.count > 0)
+    DataBufferPtr[count++] = ringGet(&receiveFifo);
+  stats.recvCalls += (count > 0);
+  return count;
+}
+
+int XUartLite_IsSending(XUartLite *InstancePtr) {
+  (void)InstancePtr;
+  return transmitFifo.count > 0;
+}
+
+void XUartLite_EnableInterrupt(XUartLite *InstancePtr) {
+  (void)InstancePtr;
+  uartInterruptEnabled = true;
+}
+
+void XUartLite_DisableInterrupt(XUartLite *InstancePtr) {
+  (void)InstancePtr;
+  uartInterruptEnabled = false;
+}
+
+// The parts of the GIC driver bluetooth.c uses. There is only the one
+// interrupt, so the ID is not checked.
+
+void XScuGic_RegisterHandler(u32 BaseAddress, s32 InterruptID,
+                             Xil_InterruptHandler IntrHandler,
+                             void *CallBackRef) {
+  (void)BaseAddress;
+  (void)InterruptID;
+  gicHandler = IntrHandler;
+  gicCallBackRef = CallBackRef;
+}
+
+void XScuGic_SetPriTrigTypeByDistAddr(u32 DistBaseAddress, u32 Int_Id,
+                                      u8 Priority, u8 Trigger) {
+  (void)DistBaseAddress;
+  (void)Int_Id;
+  (void)Priority;
+  (void)Trigger;
+}
+
+void XScuGic_EnableIntr(u32 DistBaseAddress, u32 Int_Id) {
+  (void)DistBaseAddress;
+  (void)Int_Id;
+  gicEnabled = true;
+}
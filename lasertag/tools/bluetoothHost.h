@@ -0,0 +1,63 @@
+#ifndef BLUETOOTHHOST_H_
+#define BLUETOOTHHOST_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Host-side stand-in for the UARTLite and GIC behind bluetooth/bluetooth.c,
+// so the real driver runs on the host. The UART has 16-byte transmit and
+// receive FIFOs and moves one byte each way per byte time of a simulated
+// 9600 baud link as bluetoothHost_advance() moves time forward. Like the real
+// UARTLite, it raises its interrupt when the receive FIFO stops being empty
+// and when the transmit FIFO empties, and the interrupt is lost if the UART
+// has it disabled at that moment. If the driver registered a GIC handler, the
+// handler is called for each interrupt; otherwise the caller has to call
+// bluetooth_poll(). The far end reads the link with bluetoothHost_readWire()
+// and sends with bluetoothHost_sendToDevice(). Bytes going out can be
+// corrupted at random to exercise the receiver.
+//
+// Build the driver for the host with the BSP headers on the include path, and
+// with -DBLUETOOTH_UART_INTERRUPT_ID=<any id> to use the interrupt.
+
+#define BLUETOOTH_HOST_FIFO_BYTES 16
+// 8N1 framing: ten bit times a byte.
+#define BLUETOOTH_HOST_BYTES_PER_SECOND (9600 / 10)
+
+typedef struct {
+  uint32_t bytesSent;       // Out of the transmit FIFO onto the link.
+  uint32_t bytesCorrupted;
+  uint32_t idleByteTimes;   // Link idle with bytes waiting in the queue.
+  uint32_t bytesReceived;   // Into the receive FIFO.
+  uint32_t receiveOverruns; // Lost to a full receive FIFO.
+  uint32_t interrupts;      // Handler calls.
+  uint32_t lostInterrupts;  // Raised while the UART had them disabled.
+  uint32_t sendCalls;       // XUartLite_Send() calls that moved data.
+  uint32_t recvCalls;       // XUartLite_Recv() calls that moved data.
+  uint32_t maxQueueFill;    // Most bytes in the transmit queue.
+} bluetoothHost_stats_t;
+
+// Empties the FIFOs and the link, clears the statistics and sets the chance of
+// each byte going out having one bit flipped. Call before bluetooth_init().
+void bluetoothHost_init(double byteErrorRate, uint32_t seed);
+
+// Changes the chance of a byte going out being corrupted.
+void bluetoothHost_setByteErrorRate(double byteErrorRate);
+
+// Moves time forward a byte time at a time.
+void bluetoothHost_advance(double seconds);
+
+// Reads up to maxSize bytes that have arrived at the far end of the link.
+// Returns the number read.
+uint32_t bluetoothHost_readWire(uint8_t *data, uint32_t maxSize);
+
+// Queues size bytes at the far end to be sent to the device at the link
+// rate. Returns the number queued.
+uint32_t bluetoothHost_sendToDevice(const uint8_t *data, uint32_t size);
+
+// Returns the number of bytes still in the transmit queue and FIFO.
+uint32_t bluetoothHost_getPendingBytes(void);
+
+// Returns the statistics since bluetoothHost_init().
+const bluetoothHost_stats_t *bluetoothHost_getStats(void);
+
+#endif /* BLUETOOTHHOST_H_ */
@@ -0,0 +1,161 @@
+// Runs the bluetooth driver (lasertag/bluetooth/bluetooth.c) on the host
+// against a simulated UARTLite (bluetoothHost.c) with the link busy in both
+// directions, the way bluetooth/main.c uses it: the far end sends at -r bytes
+// a second and the device echoes every byte back in upper case from a main
+// loop that only runs every -m milliseconds. A driver built without the UART
+// interrupt is polled every -p milliseconds, as from the timer ISR.
+//
+// The echo must come back complete and in order, with nothing lost to a full
+// receive FIFO or queue. The tool reports how much each interrupt or poll
+// moved and how many XUartLite calls it took. A JSON summary is printed on
+// stdout and the exit status is non-zero if any byte is lost or changed.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I../bluetooth
+//       -I../../platforms/zybo/xil_arm_toolchain/bsp/ps7_cortexa9_0/include
+//       bluetoothLoad.c bluetoothHost.c ../bluetooth/bluetooth.c
+//       -o bluetoothLoad
+// Add -DBLUETOOTH_UART_INTERRUPT_ID=0 to run the driver from the interrupt.
+// Usage: bluetoothLoad [-r bytesPerSecond] [-s seconds] [-m mainLoopMs]
+//                      [-p pollPeriodMs]
+
+#include <ctype.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "bluetooth.h"
+#include "bluetoothHost.h"
+
+#define DEFAULT_SECONDS 10.0
+#define DEFAULT_MAIN_LOOP_MS 5.0
+#define DEFAULT_POLL_PERIOD_MS 1.0
+#define STEP_S 0.0001 // Simulation step, a tenth of a byte time.
+#define DRAIN_LIMIT_S 5.0
+#define MS_PER_SECOND 1000.0
+#define FIRST_CHARACTER ' '
+#define CHARACTER_COUNT 95 // Printable ASCII.
+#define MAX_TRANSFER 256
+
+static uint32_t randomState = 1;
+
+static uint32_t nextRandom(void) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+// The byte sent at a given position in the stream, so the echo can be checked
+// without keeping a copy of it.
+static uint8_t streamByte(uint32_t position) {
+  randomState = position * 2654435761u + 1;
+  return FIRST_CHARACTER + nextRandom() % CHARACTER_COUNT;
+}
+
+int main(int argc, char *argv[]) {
+  double bytesPerSecond = BLUETOOTH_HOST_BYTES_PER_SECOND;
+  double seconds = DEFAULT_SECONDS;
+  double mainLoopMs = DEFAULT_MAIN_LOOP_MS;
+  double pollPeriodMs = DEFAULT_POLL_PERIOD_MS;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:s:m:p:")) != -1) {
+    switch (opt) {
+    case 'r':
+      bytesPerSecond = atof(optarg);
+      break;
+    case 's':
+      seconds = atof(optarg);
+      break;
+    case 'm':
+      mainLoopMs = atof(optarg);
+      break;
+    case 'p':
+      pollPeriodMs = atof(optarg);
+      break;
+    default:
+      seconds = 0.0;
+      break;
+    }
+  }
+  if (bytesPerSecond <= 0.0 || seconds <= 0.0 || mainLoopMs <= 0.0 ||
+      pollPeriodMs <= 0.0) {
+    fprintf(stderr,
+            "Usage: %s [-r bytesPerSecond] [-s seconds] [-m mainLoopMs] "
+            "[-p pollPeriodMs]\n",
+            argv[0]);
+    exit(-1);
+  }
+  bluetoothHost_init(0.0, 1);
+  if (bluetooth_init() != BLUETOOTH_INIT_STATUS_OK) {
+    fprintf(stderr, "ERROR: bluetooth_init() failed.\n");
+    exit(-1);
+  }
+
+  uint32_t sentCount = 0, echoedCount = 0, returnedCount = 0;
+  uint32_t mismatches = 0, queueFullBytes = 0, polls = 0;
+  double sendCredit = 0.0, nextMainLoop = 0.0, nextPoll = 0.0;
+  double now = 0.0;
+  for (; now < seconds + DRAIN_LIMIT_S; now += STEP_S) {
+    bool sending = now < seconds;
+    if (!sending && returnedCount == sentCount)
+      break;
+    // The far end.
+    for (sendCredit += sending ? bytesPerSecond * STEP_S : 0.0;
+         sendCredit >= 1.0; sendCredit -= 1.0) {
+      uint8_t byte = streamByte(sentCount);
+      sentCount += bluetoothHost_sendToDevice(&byte, 1);
+    }
+    // The timer ISR.
+    if (now >= nextPoll) {
+      bluetooth_poll();
+      polls++;
+      nextPoll += pollPeriodMs / MS_PER_SECOND;
+    }
+    // The device's main loop echoes everything that has come in.
+    for (; now >= nextMainLoop; nextMainLoop += mainLoopMs / MS_PER_SECOND) {
+      uint8_t data[MAX_TRANSFER];
+      uint16_t count;
+      while ((count = bluetooth_receiveQueueRead(data, sizeof(data))) > 0) {
+        for (uint16_t i = 0; i < count; i++)
+          data[i] = toupper(data[i]);
+        uint16_t written = bluetooth_transmitQueueWrite(data, count);
+        queueFullBytes += count - written;
+        echoedCount += written;
+      }
+    }
+    bluetoothHost_advance(STEP_S);
+    uint8_t returned[MAX_TRANSFER];
+    uint32_t count = bluetoothHost_readWire(returned, sizeof(returned));
+    for (uint32_t i = 0; i < count; i++, returnedCount++)
+      if (returned[i] != toupper(streamByte(returnedCount))) {
+        if (mismatches == 0)
+          fprintf(stderr, "Echo differs at byte %u.\n", returnedCount);
+        mismatches++;
+      }
+  }
+
+  const bluetoothHost_stats_t *uart = bluetoothHost_getStats();
+  bool interruptDriven = bluetooth_isInterruptDriven();
+  uint32_t services = interruptDriven ? uart->interrupts : polls;
+  uint32_t moved = uart->bytesSent + uart->bytesReceived;
+  bool passed = mismatches == 0 && queueFullBytes == 0 &&
+                uart->receiveOverruns == 0 && returnedCount == sentCount;
+  printf("{\"interruptDriven\": %s, \"bytesPerSecond\": %g, \"seconds\": %g, "
+         "\"mainLoopMs\": %g, \"bytesSent\": %u, \"bytesEchoed\": %u, "
+         "\"bytesReturned\": %u, \"mismatches\": %u, \"queueFullBytes\": %u, "
+         "\"receiveOverruns\": %u, \"lostInterrupts\": %u, "
+         "\"services\": %u, \"bytesPerService\": %.2f, "
+         "\"bytesPerSendCall\": %.2f, \"bytesPerRecvCall\": %.2f, "
+         "\"maxQueueFill\": %u, \"passed\": %s}\n",
+         interruptDriven ? "true" : "false", bytesPerSecond, seconds,
+         mainLoopMs, sentCount, echoedCount, returnedCount, mismatches,
+         queueFullBytes, uart->receiveOverruns, uart->lostInterrupts,
+         services, services ? (double)moved / services : 0.0,
+         uart->sendCalls ? (double)uart->bytesSent / uart->sendCalls : 0.0,
+         uart->recvCalls ? (double)uart->bytesReceived / uart->recvCalls : 0.0,
+         uart->maxQueueFill, passed ? "true" : "false");
+  return passed ? 0 : -1;
+}
@@ -0,0 +1,223 @@
+// Measures end-to-end hit-detection latency of the buffer->filter->detector
+// chain on the host.
+//
+// For every user frequency and every SNR level, a stream of noise with
+// periodic 200 ms square-wave pulses (the transmitter's shot) is fed through
+// pipelineSim_tick() while detector() drains the ADC buffer. For each pulse the
+// tool records how many samples elapse between the first sample of the pulse
+// and the sample at which the detector queued the hit. Results are printed as
+// JSON on stdout so runs can be diffed or plotted.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I. -I.. -I../support -I../../include -I../../drivers
+//       -I../../platforms/zybo/xil_arm_toolchain/bsp/ps7_cortexa9_0/include
+//       detectorLatency.c pipelineSim.c ../../platforms/host/interrupts.c
+//       ../detector.c ../filter.c ../queue.c ../buffer.c ../support/profiler.c
+//       -pthread -lm -o detectorLatency
+// Usage: detectorLatency [-t trials] [-f fudgeFactorIndex] [-s seed]
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "detector.h"
+#include "filter.h"
+#include "lockoutTimer.h"
+#include "pipelineSim.h"
+#include "transmitter.h"
+
+#define DEFAULT_TRIAL_COUNT 10
+#define DEFAULT_FUDGE_FACTOR_INDEX 2
+#define DEFAULT_SEED 390
+
+// Square-wave amplitude in ADC counts (peak, either side of mid-scale).
+#define PULSE_AMPLITUDE 200.0
+
+// Signal-to-noise ratios that are swept, in dB.
+static const double snrLevelsDb[] = {-10.0, -5.0, 0.0, 10.0, 20.0};
+#define SNR_LEVEL_COUNT (sizeof(snrLevelsDb) / sizeof(snrLevelsDb[0]))
+
+// Let the power windows fill with noise before the first pulse.
+#define WARMUP_SAMPLES (FILTER_INPUT_PULSE_WIDTH * FILTER_FIR_DECIMATION_FACTOR)
+// A hit this long after the pulse starts still counts as a detection: the
+// pulse plus one full power window.
+#define DETECTION_WINDOW_SAMPLES                                               \
+  (TRANSMITTER_PULSE_WIDTH +                                                   \
+   FILTER_INPUT_PULSE_WIDTH * FILTER_FIR_DECIMATION_FACTOR)
+// Noise between pulses. Long enough for a lockout started at the end of the
+// previous detection window to expire before the next pulse.
+#define GAP_SAMPLES (LOCKOUT_TIMER_EXPIRE_VALUE + TRANSMITTER_PULSE_WIDTH)
+#define TRIAL_SAMPLES (GAP_SAMPLES + DETECTION_WINDOW_SAMPLES)
+
+// detector() is called this often, like a main loop that keeps up.
+#define DETECTOR_CALL_INTERVAL 10
+
+#define MAX_EVENTS_PER_DRAIN DETECTOR_HIT_EVENT_QUEUE_SIZE
+
+#define SAMPLE_RATE_HZ (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000)
+
+typedef struct {
+  uint32_t trials;
+  uint32_t detected;
+  uint32_t missed;
+  uint32_t wrongFrequency;
+  uint32_t falseHits;
+  uint32_t latencyCount;
+  uint32_t latency[]; // One entry per detection, in samples.
+} latencyResult_t;
+
+static int compareUint32(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a;
+  uint32_t y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of a sorted array.
+static uint32_t percentile(const uint32_t sorted[], uint32_t count,
+                           double fraction) {
+  uint32_t rank = (uint32_t)(fraction * count + 0.999999);
+  if (rank == 0)
+    rank = 1;
+  return sorted[rank - 1];
+}
+
+// Drains the detector's event queue and classifies each hit relative to the
+// current pulse.
+static void classifyEvents(latencyResult_t *result, uint16_t frequencyNumber,
+                           uint32_t pulseStart, bool *pulseResolved) {
+  detector_hitEvent_t events[MAX_EVENTS_PER_DRAIN];
+  uint16_t count = detector_getHitEvents(events, MAX_EVENTS_PER_DRAIN);
+  for (uint16_t i = 0; i < count; i++) {
+    uint32_t index = events[i].sampleIndex;
+    bool inWindow =
+        index >= pulseStart && index < pulseStart + DETECTION_WINDOW_SAMPLES;
+    if (!inWindow || *pulseResolved) {
+      result->falseHits++;
+    } else if (events[i].frequencyNumber != frequencyNumber) {
+      result->wrongFrequency++;
+      *pulseResolved = true;
+    } else {
+      result->detected++;
+      result->latency[result->latencyCount++] = index - pulseStart;
+      *pulseResolved = true;
+    }
+  }
+}
+
+// Runs all trials for one frequency at one SNR.
+static void runPoint(latencyResult_t *result, uint16_t frequencyNumber,
+                     double snrDb, uint32_t trials, uint32_t fudgeFactorIndex) {
+  double noiseSigma = PULSE_AMPLITUDE / pow(10.0, snrDb / 20.0);
+  uint16_t halfPeriod = filter_frequencyTickTable[frequencyNumber] / 2;
+  pipelineSim_init();
+  detector_setFudgeFactorIndex(fudgeFactorIndex);
+  for (uint32_t i = 0; i < WARMUP_SAMPLES; i++) {
+    pipelineSim_tick(pipelineSim_toAdcValue(noiseSigma * pipelineSim_gaussian()));
+    if (i % DETECTOR_CALL_INTERVAL == 0)
+      detector(false);
+  }
+  detector(false);
+  // Start-up transients are not counted.
+  detector_hitEvent_t discard[MAX_EVENTS_PER_DRAIN];
+  while (detector_getHitEvents(discard, MAX_EVENTS_PER_DRAIN))
+    ;
+
+  for (uint32_t t = 0; t < trials; t++) {
+    uint32_t pulseStart = detector_getSampleCount() + GAP_SAMPLES;
+    bool pulseResolved = false;
+    for (uint32_t i = 0; i < TRIAL_SAMPLES; i++) {
+      double value = noiseSigma * pipelineSim_gaussian();
+      uint32_t pulseOffset = i - GAP_SAMPLES;
+      if (i >= GAP_SAMPLES && pulseOffset < TRANSMITTER_PULSE_WIDTH)
+        value += ((pulseOffset / halfPeriod) % 2) ? -PULSE_AMPLITUDE
+                                                  : PULSE_AMPLITUDE;
+      pipelineSim_tick(pipelineSim_toAdcValue(value));
+      if (i % DETECTOR_CALL_INTERVAL == 0) {
+        detector(false);
+        classifyEvents(result, frequencyNumber, pulseStart, &pulseResolved);
+      }
+    }
+    detector(false);
+    classifyEvents(result, frequencyNumber, pulseStart, &pulseResolved);
+    if (!pulseResolved)
+      result->missed++;
+    result->trials++;
+  }
+}
+
+static void printResult(const latencyResult_t *result, uint16_t frequencyNumber,
+                        double snrDb, bool last) {
+  printf("    {\"frequency\": %d, \"snrDb\": %.1f, \"trials\": %u, "
+         "\"detected\": %u, \"missed\": %u, \"wrongFrequency\": %u, "
+         "\"falseHits\": %u",
+         frequencyNumber, snrDb, result->trials, result->detected,
+         result->missed, result->wrongFrequency, result->falseHits);
+  if (result->latencyCount) {
+    uint32_t n = result->latencyCount;
+    double sum = 0;
+    for (uint32_t i = 0; i < n; i++)
+      sum += result->latency[i];
+    printf(", \"latencySamples\": {\"min\": %u, \"median\": %u, \"p90\": %u, "
+           "\"max\": %u, \"mean\": %.1f}",
+           result->latency[0], percentile(result->latency, n, 0.5),
+           percentile(result->latency, n, 0.9), result->latency[n - 1],
+           sum / n);
+  }
+  printf("}%s\n", last ? "" : ",");
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t trials = DEFAULT_TRIAL_COUNT;
+  uint32_t fudgeFactorIndex = DEFAULT_FUDGE_FACTOR_INDEX;
+  uint32_t seed = DEFAULT_SEED;
+  int opt;
+  while ((opt = getopt(argc, argv, "t:f:s:")) != -1) {
+    switch (opt) {
+    case 't':
+      trials = strtoul(optarg, NULL, 0);
+      break;
+    case 'f':
+      fudgeFactorIndex = strtoul(optarg, NULL, 0);
+      break;
+    case 's':
+      seed = strtoul(optarg, NULL, 0);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-t trials] [-f fudgeFactorIndex] [-s seed]\n",
+              argv[0]);
+      exit(-1);
+    }
+  }
+  latencyResult_t *result =
+      malloc(sizeof(latencyResult_t) + trials * sizeof(uint32_t));
+  if (!result) {
+    fprintf(stderr, "ERROR: unable to allocate results.\n");
+    exit(-1);
+  }
+  pipelineSim_seedRandom(seed);
+
+  printf("{\n  \"benchmark\": \"detectorLatency\",\n");
+  printf("  \"sampleRateHz\": %d,\n  \"pulseAmplitude\": %.1f,\n",
+         SAMPLE_RATE_HZ, PULSE_AMPLITUDE);
+  printf("  \"trialsPerPoint\": %u,\n  \"fudgeFactorIndex\": %u,\n", trials,
+         fudgeFactorIndex);
+  printf("  \"results\": [\n");
+  for (uint16_t f = 0; f < FILTER_FREQUENCY_COUNT; f++) {
+    for (uint16_t s = 0; s < SNR_LEVEL_COUNT; s++) {
+      memset(result, 0, sizeof(latencyResult_t));
+      runPoint(result, f, snrLevelsDb[s], trials, fudgeFactorIndex);
+      qsort(result->latency, result->latencyCount, sizeof(uint32_t),
+            compareUint32);
+      printResult(result, f, snrLevelsDb[s],
+                  f == FILTER_FREQUENCY_COUNT - 1 && s == SNR_LEVEL_COUNT - 1);
+      fflush(stdout);
+    }
+  }
+  printf("  ]\n}\n");
+  free(result);
+  return 0;
+}
@@ -0,0 +1,214 @@
+// Checks the number formatting in lasertag/support/format.c against
+// snprintf() and compares their speed on the host.
+//
+// Each format gets -n values: integers of every length, fixed-point values
+// from 1e-4 to 1e9 with two decimals and with none, as the statistics screen
+// prints them, and exponent labels from 1e-20 to 1e20, as the histogram
+// draws them. Halfway cases, values next to powers of ten, zero and negative
+// values are mixed in, since that is where rounding goes wrong. Every string
+// must match snprintf() exactly. The time per call of each is reported as
+// JSON on stdout, and the exit status is non-zero on any mismatch.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I../support formatBench.c ../support/format.c -lm -o formatBench
+// Usage: formatBench [-n valuesPerFormat] [-S seed]
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "format.h"
+
+#define DEFAULT_VALUE_COUNT 100000
+#define NS_PER_SECOND 1e9
+#define SPECIAL_EVERY 4 // One value in this many is a hard case.
+
+typedef enum { UNSIGNED, INT, FIXED_2, FIXED_0, EXPONENT, FORMAT_COUNT } kind_t;
+
+static const char *kindNames[FORMAT_COUNT] = {"%u", "%d", "%.2f", "%.0f",
+                                              "%.0e"};
+
+static uint32_t randomState = 1;
+
+static uint32_t nextRandom(void) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static double nextUniform(void) { return nextRandom() / 4294967296.0; }
+
+static double monotonicSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / NS_PER_SECOND;
+}
+
+// A value spread evenly over the decades from 10^low to 10^high.
+static double logUniform(double low, double high) {
+  return pow(10.0, low + (high - low) * nextUniform());
+}
+
+// A value exactly halfway between two outputs of the format, or a double
+// either side of one, or next to a power of ten.
+static double hardValue(kind_t kind) {
+  double value;
+  int16_t exponent = (int16_t)(nextRandom() % 41) - 20;
+  switch (nextRandom() % 3) {
+  case 0: // Halfway, as far as the decimal value goes.
+    if (kind == EXPONENT)
+      value = (nextRandom() % 9 + 1.5) * pow(10.0, exponent);
+    else if (kind == FIXED_2)
+      value = (nextRandom() % 100000 + 0.5) / 100.0;
+    else
+      value = nextRandom() % 100000 + 0.5;
+    break;
+  case 1: // Exactly halfway in binary: k/8 has an exact tie at two decimals.
+    value = (nextRandom() % 800000) / 8.0;
+    if (kind == EXPONENT)
+      value = (nextRandom() % 10 * 2 + 1) / 2.0 * pow(2.0, nextRandom() % 40);
+    break;
+  default: // Next to a power of ten.
+    value = pow(10.0, kind == EXPONENT ? exponent : exponent % 9);
+    break;
+  }
+  switch (nextRandom() % 3) {
+  case 0:
+    value = nextafter(value, 0.0);
+    break;
+  case 1:
+    value = nextafter(value, INFINITY);
+    break;
+  }
+  return value;
+}
+
+static double randomValue(kind_t kind) {
+  if (nextRandom() % SPECIAL_EVERY == 0)
+    return (nextRandom() % 8 == 0) ? 0.0 : hardValue(kind);
+  return (kind == EXPONENT) ? logUniform(-20.0, 20.0) : logUniform(-4.0, 9.0);
+}
+
+// Formats value with the library.
+static uint16_t formatFast(kind_t kind, char *buffer, uint16_t size,
+                           double value, uint32_t integer) {
+  switch (kind) {
+  case UNSIGNED:
+    return format_unsigned(buffer, size, integer);
+  case INT:
+    return format_int(buffer, size, (int32_t)integer);
+  case FIXED_2:
+    return format_fixed(buffer, size, value, 2);
+  case FIXED_0:
+    return format_fixed(buffer, size, value, 0);
+  default:
+    return format_compactExponent(buffer, size, value);
+  }
+}
+
+// Formats value the way the code did before, with snprintf() and, for the
+// labels, dropping the 'e' as trimLabel() does.
+static uint16_t formatReference(kind_t kind, char *buffer, uint16_t size,
+                                double value, uint32_t integer) {
+  int length;
+  switch (kind) {
+  case UNSIGNED:
+    return snprintf(buffer, size, "%u", integer);
+  case INT:
+    return snprintf(buffer, size, "%d", (int32_t)integer);
+  case FIXED_2:
+    return snprintf(buffer, size, "%.2f", value);
+  case FIXED_0:
+    return snprintf(buffer, size, "%.0f", value);
+  default:
+    length = snprintf(buffer, size, "%0.0e", value);
+    char *e = strchr(buffer, 'e');
+    if (e) {
+      memmove(e, e + 1, strlen(e));
+      length--;
+    }
+    return length;
+  }
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t valueCount = DEFAULT_VALUE_COUNT;
+  uint32_t seed = 1;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:S:")) != -1) {
+    switch (opt) {
+    case 'n':
+      valueCount = atoi(optarg);
+      break;
+    case 'S':
+      seed = atoi(optarg);
+      break;
+    default:
+      valueCount = 0;
+      break;
+    }
+  }
+  if (valueCount == 0) {
+    fprintf(stderr, "Usage: %s [-n valuesPerFormat] [-S seed]\n", argv[0]);
+    exit(-1);
+  }
+  randomState = seed ? seed : 1;
+
+  double *values = malloc(valueCount * sizeof(double));
+  uint32_t *integers = malloc(valueCount * sizeof(uint32_t));
+  uint32_t totalMismatches = 0;
+  printf("{\"valuesPerFormat\": %u, \"formats\": [", valueCount);
+  for (kind_t kind = 0; kind < FORMAT_COUNT; kind++) {
+    for (uint32_t i = 0; i < valueCount; i++) {
+      values[i] = randomValue(kind);
+      if (nextRandom() % 2)
+        values[i] = -values[i];
+      integers[i] = nextRandom() >> (nextRandom() % 32);
+    }
+    uint32_t mismatches = 0;
+    for (uint32_t i = 0; i < valueCount; i++) {
+      char fast[FORMAT_BUFFER_SIZE], reference[FORMAT_BUFFER_SIZE * 2];
+      uint16_t fastLength =
+          formatFast(kind, fast, sizeof(fast), values[i], integers[i]);
+      uint16_t referenceLength = formatReference(
+          kind, reference, sizeof(reference), values[i], integers[i]);
+      if (fastLength == referenceLength && strcmp(fast, reference) == 0)
+        continue;
+      if (mismatches++ == 0)
+        fprintf(stderr, "%s of %.17g (%u): \"%s\", snprintf gives \"%s\".\n",
+                kindNames[kind], values[i], integers[i], fast, reference);
+    }
+    totalMismatches += mismatches;
+
+    // Time each over the same values.
+    double nsPerCall[2];
+    volatile uint32_t sink = 0;
+    for (int16_t reference = 0; reference < 2; reference++) {
+      char buffer[FORMAT_BUFFER_SIZE * 2];
+      double start = monotonicSeconds();
+      for (uint32_t i = 0; i < valueCount; i++)
+        sink += reference ? formatReference(kind, buffer, sizeof(buffer),
+                                            values[i], integers[i])
+                          : formatFast(kind, buffer, sizeof(buffer), values[i],
+                                       integers[i]);
+      nsPerCall[reference] =
+          (monotonicSeconds() - start) * NS_PER_SECOND / valueCount;
+    }
+    printf("%s{\"format\": \"%s\", \"nsPerCall\": %.1f, "
+           "\"snprintfNsPerCall\": %.1f, \"speedup\": %.2f, "
+           "\"mismatches\": %u}",
+           kind ? ", " : "", kindNames[kind], nsPerCall[0], nsPerCall[1],
+           nsPerCall[0] > 0.0 ? nsPerCall[1] / nsPerCall[0] : 0.0,
+           mismatches);
+  }
+  printf("], \"mismatches\": %u}\n", totalMismatches);
+  free(values);
+  free(integers);
+  return totalMismatches == 0 ? 0 : -1;
+}
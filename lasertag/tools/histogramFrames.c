@@ -0,0 +1,194 @@
+// Draws a run of histogram frames the way runningModes.c plots detector
+// powers, first straight onto the TFT and then through the RAM framebuffer
+// (lasertag/support/framebuffer.c), against a host stand-in for the TFT
+// (displayHost.c) that counts what the prebuilt driver would send.
+//
+// The bar powers follow a random walk with one channel well above the rest,
+// so bars and their labels change a little every frame. Each frame is first
+// drawn from scratch on a cleared screen, and the TFT must look the same after
+// histogram_updateDisplay() has drawn just the changes, whether directly or
+// through the framebuffer, which must itself match. The tool reports
+// transfers, pixels and bus bytes per frame for each way of drawing and writes
+// the last frame as a PPM image. A JSON summary is printed on stdout and the
+// exit status is non-zero on any mismatch.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I.. -I../support -I../../include -I../../platforms/host
+//       histogramFrames.c ../../platforms/host/display.c ../support/histogram.c
+//       ../support/framebuffer.c ../support/textRenderer.c
+//       ../support/displayFont.c ../support/format.c -lm -o histogramFrames
+// Usage: histogramFrames [-f frames] [-S seed] [-o out.ppm]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "displayHost.h"
+#include "filter.h"
+#include "framebuffer.h"
+#include "histogram.h"
+
+#define DEFAULT_FRAMES 200
+#define DEFAULT_OUTPUT_NAME "histogramFrames.ppm"
+#define PIXEL_COUNT (DISPLAY_WIDTH * DISPLAY_HEIGHT)
+#define LOUD_CHANNEL 3
+#define LOUD_POWER 5.0e4
+#define QUIET_POWER 2.0e3
+#define WALK_STEP 0.08 // Largest change of a power per frame, as a fraction.
+#define UNDRAWN_COLOR 0x1234 // The TFT before anything is drawn.
+#define FNV_OFFSET_BASIS 2166136261u
+#define FNV_PRIME 16777619u
+
+static uint32_t randomState = 1;
+
+static uint32_t nextRandom(void) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static double nextUniform(void) { return nextRandom() / 4294967296.0; }
+
+// histogram.c only asks the filter for powers when reporting an error.
+double filter_getCurrentPowerValue(uint16_t filterNumber) {
+  (void)filterNumber;
+  return 0.0;
+}
+
+void utils_msDelay(long ms) { (void)ms; }
+
+// FNV-1a over the screen, to compare frames without keeping them.
+static uint32_t hashScreen(const display_pixel_t *pixels) {
+  uint32_t hash = FNV_OFFSET_BASIS;
+  for (uint32_t i = 0; i < PIXEL_COUNT; i++) {
+    hash = (hash ^ (pixels[i] & 0xFF)) * FNV_PRIME;
+    hash = (hash ^ (pixels[i] >> 8)) * FNV_PRIME;
+  }
+  return hash;
+}
+
+// Moves each power a random step, keeping one channel loud.
+static void walkPowers(double powers[]) {
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    powers[i] *= 1.0 + WALK_STEP * (2.0 * nextUniform() - 1.0);
+}
+
+static void initPowers(double powers[]) {
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    powers[i] = (i == LOUD_CHANNEL) ? LOUD_POWER
+                                    : QUIET_POWER * (0.5 + nextUniform());
+}
+
+typedef struct {
+  uint32_t transfers;
+  uint32_t pixels;
+  uint64_t busBytes;
+} cost_t;
+
+typedef enum {
+  DRAW_FROM_SCRATCH, // Clear the screen and draw the whole frame.
+  DRAW_DIRECT,       // Update the TFT directly.
+  DRAW_FRAMEBUFFER,  // Update the framebuffer and flush it.
+} drawing_t;
+
+// Draws frameCount frames one way. Drawing from scratch fills in the screen
+// hash after each frame; the other ways check it. Returns the number of frames
+// that did not match. The cost covers the frames only, not histogram_init().
+static uint32_t run(drawing_t drawing, uint32_t frameCount, uint32_t seed,
+                    uint32_t hashes[], cost_t *cost) {
+  double powers[FILTER_FREQUENCY_COUNT];
+  uint32_t mismatches = 0;
+  randomState = seed;
+  displayHost_init(UNDRAWN_COLOR);
+  histogram_setFramebufferEnabled(drawing == DRAW_FRAMEBUFFER);
+  histogram_init(FILTER_FREQUENCY_COUNT);
+  const displayHost_stats_t *tft = displayHost_getStats();
+  uint32_t startTransfers = tft->transfers, startPixels = tft->pixels;
+  uint64_t startBusBytes = displayHost_getBusBytes();
+  initPowers(powers);
+  for (uint32_t frame = 0; frame < frameCount; frame++) {
+    walkPowers(powers);
+    if (drawing == DRAW_FROM_SCRATCH)
+      histogram_init(FILTER_FREQUENCY_COUNT);
+    histogram_plotUserFrequencyPower(powers);
+    const display_pixel_t *screen = displayHost_getPixels();
+    uint32_t hash = hashScreen(screen);
+    if (drawing == DRAW_FROM_SCRATCH) {
+      hashes[frame] = hash;
+      continue;
+    }
+    bool matches = hash == hashes[frame] &&
+                   (drawing != DRAW_FRAMEBUFFER ||
+                    memcmp(screen, framebuffer_getPixels(),
+                           PIXEL_COUNT * sizeof(display_pixel_t)) == 0);
+    if (!matches && mismatches++ == 0)
+      fprintf(stderr, "Frame %u drawn %s differs from the one drawn from "
+              "scratch.\n", frame,
+              drawing == DRAW_DIRECT ? "directly" : "through the framebuffer");
+  }
+  cost->transfers = tft->transfers - startTransfers;
+  cost->pixels = tft->pixels - startPixels;
+  cost->busBytes = displayHost_getBusBytes() - startBusBytes;
+  return mismatches;
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t frameCount = DEFAULT_FRAMES;
+  uint32_t seed = 1;
+  const char *outputName = DEFAULT_OUTPUT_NAME;
+  int opt;
+  while ((opt = getopt(argc, argv, "f:S:o:")) != -1) {
+    switch (opt) {
+    case 'f':
+      frameCount = atoi(optarg);
+      break;
+    case 'S':
+      seed = atoi(optarg);
+      break;
+    case 'o':
+      outputName = optarg;
+      break;
+    default:
+      frameCount = 0;
+      break;
+    }
+  }
+  if (frameCount == 0) {
+    fprintf(stderr, "Usage: %s [-f frames] [-S seed] [-o out.ppm]\n", argv[0]);
+    exit(-1);
+  }
+  seed = seed ? seed : 1;
+
+  uint32_t *hashes = malloc(frameCount * sizeof(uint32_t));
+  cost_t fromScratch, direct, buffered;
+  run(DRAW_FROM_SCRATCH, frameCount, seed, hashes, &fromScratch);
+  uint32_t mismatches = run(DRAW_DIRECT, frameCount, seed, hashes, &direct);
+  mismatches += run(DRAW_FRAMEBUFFER, frameCount, seed, hashes, &buffered);
+  const framebuffer_stats_t *fb = framebuffer_getStats();
+  bool written = framebuffer_writePpm(outputName);
+  if (!written)
+    fprintf(stderr, "ERROR: cannot write %s.\n", outputName);
+
+  printf("{\"output\": \"%s\", \"frames\": %u, "
+         "\"direct\": {\"transfersPerFrame\": %.1f, \"pixelsPerFrame\": %.0f, "
+         "\"busBytesPerFrame\": %.0f}, "
+         "\"framebuffer\": {\"transfersPerFrame\": %.1f, "
+         "\"pixelsPerFrame\": %.0f, \"busBytesPerFrame\": %.0f, "
+         "\"dirtyRectsPerFlush\": %.2f}, "
+         "\"busBytesRatio\": %.3f, \"mismatches\": %u}\n",
+         outputName, frameCount, (double)direct.transfers / frameCount,
+         (double)direct.pixels / frameCount,
+         (double)direct.busBytes / frameCount,
+         (double)buffered.transfers / frameCount,
+         (double)buffered.pixels / frameCount,
+         (double)buffered.busBytes / frameCount,
+         fb->flushes ? (double)fb->rects / fb->flushes : 0.0,
+         direct.busBytes ? (double)buffered.busBytes / direct.busBytes : 0.0,
+         mismatches);
+  free(hashes);
+  return (mismatches == 0 && written) ? 0 : -1;
+}
@@ -0,0 +1,293 @@
+// Microbenchmarks of the detection pipeline on the host, for comparing the
+// cost of queue.c, filter.c and the whole pipeline between changes.
+//
+// Each benchmark runs -w warm-up batches, which are not counted, and then -r
+// timed batches of a fixed number of operations. The time per operation of
+// each batch is kept, and the median, 99th percentile, minimum and mean over
+// the batches are reported. The median is the figure to compare between runs;
+// a p99 far above it means the machine was busy. The benchmarks are:
+//   queue_overwritePush  push into a full queue, at sizes from the z queues
+//                        to well past the power queues
+//   queue_readElementAt  read every element of a full queue in turn
+//   filter_firFilter     one FIR output over the 81 x queue entries
+//   filter_iirFilter     one IIR output, for each channel
+//   filter_computePower  power of one channel, from scratch (forced) and by
+//                        the incremental update
+//   pipeline             one ADC sample through pipelineSim_tick() and
+//                        detector(), called every -c samples, over batches of
+//                        PIPELINE_BATCH_SAMPLES samples of noise
+// Each FIR and IIR call is given a new noise input first, as in the detector:
+// on a constant input the outputs of some channels decay into subnormal
+// numbers, which are many times slower. The push is included in the time; see
+// queue_overwritePush for what it costs.
+// -f runs only the benchmarks whose name contains the given text. The
+// results are printed as JSON on stdout, or written to -o out.json, with the
+// compiler version so that runs from different builds can be told apart. The
+// exit status is non-zero if -f matches no benchmark.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I. -I.. -I../support -I../../include -I../../drivers
+//       -I../../platforms/zybo/xil_arm_toolchain/bsp/ps7_cortexa9_0/include
+//       microBench.c pipelineSim.c ../../platforms/host/interrupts.c
+//       ../detector.c ../filter.c ../queue.c ../buffer.c ../support/profiler.c
+//       -pthread -lm -o microBench
+// Usage: microBench [-r batches] [-w warmupBatches] [-c samplesPerDetectorCall]
+//                   [-f nameFilter] [-o out.json]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "detector.h"
+#include "filter.h"
+#include "pipelineSim.h"
+#include "queue.h"
+
+#define DEFAULT_BATCHES 200
+#define DEFAULT_WARMUP_BATCHES 20
+#define DEFAULT_SAMPLES_PER_CALL 10
+#define PIPELINE_BATCH_SAMPLES 100000
+#define NOISE_SIGMA 100.0
+#define SEED 50
+#define NS_PER_SECOND 1e9
+#define P99 0.99
+
+// Operations per batch, chosen so a batch takes tens of microseconds or more
+// and the clock's resolution does not matter.
+#define QUEUE_BATCH_OPS 10000
+#define FILTER_BATCH_OPS 2000
+#define FORCED_POWER_BATCH_OPS 50
+
+// Queue sizes: the z queues, the x queue, the power queues and one that does
+// not fit in the L1 cache.
+static const queue_size_t queueSizes[] = {10, 81, FILTER_INPUT_PULSE_WIDTH,
+                                          20000};
+#define QUEUE_SIZE_COUNT (sizeof(queueSizes) / sizeof(queueSizes[0]))
+
+static const char *nameFilter = "";
+static uint32_t batches = DEFAULT_BATCHES;
+static uint32_t warmupBatches = DEFAULT_WARMUP_BATCHES;
+static uint32_t samplesPerCall = DEFAULT_SAMPLES_PER_CALL;
+static FILE *out;
+static uint32_t benchmarkCount;
+
+// What the benchmarks work on, set up before each one.
+static queue_t benchQueue;
+static queue_index_t benchReadIndex;
+static uint16_t benchChannel;
+static buffer_data_t benchAdcValues[PIPELINE_BATCH_SAMPLES];
+static double benchInputs[FILTER_BATCH_OPS];
+static volatile double benchSink; // Keeps results from being optimized out.
+
+static double monotonicSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / NS_PER_SECOND;
+}
+
+static int compareDouble(const void *a, const void *b) {
+  double x = *(const double *)a;
+  double y = *(const double *)b;
+  return (x > y) - (x < y);
+}
+
+// Nearest-rank percentile of a sorted array.
+static double percentile(const double sorted[], uint32_t count,
+                         double fraction) {
+  uint32_t rank = (uint32_t)(fraction * count + 0.999999);
+  if (rank == 0)
+    rank = 1;
+  return sorted[rank - 1];
+}
+
+static void queuePush(uint32_t ops) {
+  for (uint32_t i = 0; i < ops; i++)
+    queue_overwritePush(&benchQueue, (queue_data_t)i);
+}
+
+static void queueRead(uint32_t ops) {
+  double sum = 0.0;
+  queue_index_t index = benchReadIndex;
+  queue_size_t count = queue_elementCount(&benchQueue);
+  for (uint32_t i = 0; i < ops; i++) {
+    sum += queue_readElementAt(&benchQueue, index);
+    if (++index == count)
+      index = 0;
+  }
+  benchReadIndex = index;
+  benchSink = sum;
+}
+
+// ops is at most FILTER_BATCH_OPS, like the pipeline benchmark's.
+static void firFilter(uint32_t ops) {
+  for (uint32_t i = 0; i < ops; i++) {
+    filter_addNewInput(benchInputs[i]);
+    benchSink = filter_firFilter();
+  }
+}
+
+static void iirFilter(uint32_t ops) {
+  queue_t *yQueue = filter_getYQueue();
+  for (uint32_t i = 0; i < ops; i++) {
+    queue_overwritePush(yQueue, benchInputs[i]);
+    benchSink = filter_iirFilter(benchChannel);
+  }
+}
+
+static void forcedPower(uint32_t ops) {
+  for (uint32_t i = 0; i < ops; i++)
+    benchSink = filter_computePower(benchChannel, true, false);
+}
+
+static void incrementalPower(uint32_t ops) {
+  for (uint32_t i = 0; i < ops; i++)
+    benchSink = filter_computePower(benchChannel, false, false);
+}
+
+// ops is at most PIPELINE_BATCH_SAMPLES.
+static void pipeline(uint32_t ops) {
+  for (uint32_t i = 0; i < ops; i++) {
+    pipelineSim_tick(benchAdcValues[i]);
+    if ((i + 1) % samplesPerCall == 0)
+      detector(false);
+  }
+}
+
+// Times run() over the warm-up and the timed batches and prints the result.
+// parameterName is the JSON name of parameter, or NULL if there is none.
+static void benchmark(const char *name, const char *variant,
+                      const char *parameterName, uint32_t parameter,
+                      void (*run)(uint32_t), uint32_t opsPerBatch) {
+  if (!strstr(name, nameFilter))
+    return;
+  for (uint32_t i = 0; i < warmupBatches; i++)
+    run(opsPerBatch);
+  double *nsPerOp = malloc(batches * sizeof(double));
+  double total = 0.0;
+  for (uint32_t i = 0; i < batches; i++) {
+    double start = monotonicSeconds();
+    run(opsPerBatch);
+    nsPerOp[i] = (monotonicSeconds() - start) * NS_PER_SECOND / opsPerBatch;
+    total += nsPerOp[i];
+  }
+  qsort(nsPerOp, batches, sizeof(double), compareDouble);
+
+  fprintf(out, "%s\n  {\"name\": \"%s\"", benchmarkCount++ ? "," : "", name);
+  if (variant)
+    fprintf(out, ", \"variant\": \"%s\"", variant);
+  if (parameterName)
+    fprintf(out, ", \"%s\": %u", parameterName, parameter);
+  fprintf(out,
+          ", \"opsPerBatch\": %u, \"medianNsPerOp\": %.2f, "
+          "\"p99NsPerOp\": %.2f, \"minNsPerOp\": %.2f, \"meanNsPerOp\": %.2f}",
+          opsPerBatch, percentile(nsPerOp, batches, 0.5),
+          percentile(nsPerOp, batches, P99), nsPerOp[0], total / batches);
+  free(nsPerOp);
+}
+
+static void benchmarkQueues(void) {
+  for (uint32_t i = 0; i < QUEUE_SIZE_COUNT; i++) {
+    queue_size_t size = queueSizes[i];
+    queue_init(&benchQueue, size, "benchQueue");
+    for (queue_size_t j = 0; j < size; j++)
+      queue_overwritePush(&benchQueue, (queue_data_t)j);
+    benchReadIndex = 0;
+    benchmark("queue_overwritePush", NULL, "size", size, queuePush,
+              QUEUE_BATCH_OPS);
+    benchmark("queue_readElementAt", NULL, "size", size, queueRead,
+              QUEUE_BATCH_OPS);
+    queue_garbageCollect(&benchQueue);
+  }
+}
+
+// The filters run on queues full of noise, as once the power windows have
+// filled.
+static void benchmarkFilters(void) {
+  for (uint32_t i = 0; i < FILTER_BATCH_OPS; i++)
+    benchInputs[i] =
+        NOISE_SIGMA / PIPELINE_SIM_ADC_MIDSCALE * pipelineSim_gaussian();
+  pipelineSim_init();
+  for (uint32_t i = 0; i < FILTER_INPUT_PULSE_WIDTH; i++) {
+    for (uint16_t j = 0; j < FILTER_FIR_DECIMATION_FACTOR; j++)
+      filter_addNewInput(benchInputs[(i + j) % FILTER_BATCH_OPS]);
+    filter_firFilter();
+    for (uint16_t channel = 0; channel < FILTER_FREQUENCY_COUNT; channel++)
+      filter_iirFilter(channel);
+  }
+  benchmark("filter_firFilter", NULL, NULL, 0, firFilter, FILTER_BATCH_OPS);
+  for (benchChannel = 0; benchChannel < FILTER_FREQUENCY_COUNT; benchChannel++)
+    benchmark("filter_iirFilter", NULL, "channel", benchChannel, iirFilter,
+              FILTER_BATCH_OPS);
+  benchChannel = 0;
+  benchmark("filter_computePower", "forced", "channel", benchChannel,
+            forcedPower, FORCED_POWER_BATCH_OPS);
+  filter_computePower(benchChannel, true, false);
+  benchmark("filter_computePower", "incremental", "channel", benchChannel,
+            incrementalPower, FILTER_BATCH_OPS);
+}
+
+static void benchmarkPipeline(void) {
+  pipelineSim_init();
+  for (uint32_t i = 0; i < PIPELINE_BATCH_SAMPLES; i++)
+    benchAdcValues[i] =
+        pipelineSim_toAdcValue(NOISE_SIGMA * pipelineSim_gaussian());
+  benchmark("pipeline", NULL, "samplesPerDetectorCall", samplesPerCall,
+            pipeline, PIPELINE_BATCH_SAMPLES);
+}
+
+int main(int argc, char *argv[]) {
+  const char *outputName = NULL;
+  bool usage = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:w:c:f:o:")) != -1) {
+    switch (opt) {
+    case 'r':
+      batches = atoi(optarg);
+      break;
+    case 'w':
+      warmupBatches = atoi(optarg);
+      break;
+    case 'c':
+      samplesPerCall = atoi(optarg);
+      break;
+    case 'f':
+      nameFilter = optarg;
+      break;
+    case 'o':
+      outputName = optarg;
+      break;
+    default:
+      usage = true;
+      break;
+    }
+  }
+  if (usage || batches == 0 || samplesPerCall == 0) {
+    fprintf(stderr,
+            "Usage: %s [-r batches] [-w warmupBatches] "
+            "[-c samplesPerDetectorCall] [-f nameFilter] [-o out.json]\n",
+            argv[0]);
+    exit(-1);
+  }
+  out = outputName ? fopen(outputName, "w") : stdout;
+  if (!out) {
+    fprintf(stderr, "ERROR: cannot create %s.\n", outputName);
+    exit(-1);
+  }
+
+  pipelineSim_seedRandom(SEED);
+  fprintf(out,
+          "{\"compiler\": \"%s\", \"batches\": %u, \"warmupBatches\": %u, "
+          "\"benchmarks\": [",
+          __VERSION__, batches, warmupBatches);
+  benchmarkQueues();
+  benchmarkFilters();
+  benchmarkPipeline();
+  fprintf(out, "\n]}\n");
+  if (out != stdout)
+    fclose(out);
+  return benchmarkCount > 0 ? 0 : -1;
+}
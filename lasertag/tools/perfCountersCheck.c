@@ -0,0 +1,136 @@
+// Runs the detector (lasertag/detector.c) on the host with its filter stages
+// counted by support/perfCounters.c, and prints the same report the board
+// prints after a run: cycles, instructions, L1 data cache misses and branch
+// mispredicts per ADC sample for the FIR, IIR and power stages, and each
+// stage's instructions per cycle. -s seconds of noise are fed through
+// pipelineSim_tick() and detector() drains the ADC buffer every -c samples.
+//
+// Each stage must be counted once per decimated sample. Where the host
+// counts an event, every stage must have counted some of it, and a stage
+// cannot retire more instructions than PERF_COUNTERS_MAX_IPC a cycle. Events
+// the host cannot count (perf_event_open() fails for hardware events in most
+// virtual machines) are reported as unavailable and not checked. A JSON
+// summary is printed on the last line of stdout and the exit status is
+// non-zero if a check fails.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -DPERF_COUNTERS_ENABLED=1 -I. -I.. -I../support -I../../include
+//       -I../../drivers
+//       -I../../platforms/zybo/xil_arm_toolchain/bsp/ps7_cortexa9_0/include
+//       perfCountersCheck.c pipelineSim.c ../../platforms/host/interrupts.c
+//       ../support/perfCounters.c ../support/profiler.c ../detector.c
+//       ../filter.c ../queue.c ../buffer.c -pthread -lm -o perfCountersCheck
+// Usage: perfCountersCheck [-s seconds] [-c samplesPerDetectorCall]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "detector.h"
+#include "filter.h"
+#include "perfCounters.h"
+#include "pipelineSim.h"
+
+#define SAMPLE_RATE_HZ (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000)
+#define DEFAULT_SECONDS 2.0
+#define DEFAULT_SAMPLES_PER_CALL 10
+#define NOISE_SIGMA 100.0
+#define SEED 46
+// More than any core this runs on retires a cycle.
+#define PERF_COUNTERS_MAX_IPC 8
+
+#if !PERF_COUNTERS_ENABLED
+#error "perfCountersCheck needs -DPERF_COUNTERS_ENABLED=1."
+#endif
+
+static const char *stageNames[] = {"fir", "iir", "power"};
+#define STAGE_COUNT (sizeof(stageNames) / sizeof(stageNames[0]))
+
+static uint32_t failures;
+
+static void fail(const char *message, const char *name) {
+  if (failures == 0)
+    fprintf(stderr, "%s: %s\n", name, message);
+  failures++;
+}
+
+static const perfCounters_stage_t *findStage(const char *name) {
+  for (const perfCounters_stage_t *stage = perfCounters_getStages(); stage;
+       stage = stage->next)
+    if (strcmp(stage->name, name) == 0)
+      return stage;
+  fail("stage never begun", name);
+  return NULL;
+}
+
+static void checkStage(const char *name, uint32_t decimated) {
+  const perfCounters_stage_t *stage = findStage(name);
+  if (!stage)
+    return;
+  if (stage->calls != decimated)
+    fail("wrong call count", name);
+  for (uint32_t i = 0; i < PERF_COUNTERS_EVENT_COUNT; i++)
+    if (perfCounters_isAvailable(i) && i != PERF_COUNTERS_L1D_MISSES &&
+        i != PERF_COUNTERS_BRANCH_MISSES && stage->counts[i] == 0)
+      fail("counted nothing", name);
+  if (perfCounters_isAvailable(PERF_COUNTERS_CYCLES) &&
+      perfCounters_isAvailable(PERF_COUNTERS_INSTRUCTIONS) &&
+      stage->counts[PERF_COUNTERS_INSTRUCTIONS] >
+          stage->counts[PERF_COUNTERS_CYCLES] * PERF_COUNTERS_MAX_IPC)
+    fail("more instructions than cycles allow", name);
+}
+
+int main(int argc, char *argv[]) {
+  double seconds = DEFAULT_SECONDS;
+  uint32_t samplesPerCall = DEFAULT_SAMPLES_PER_CALL;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:c:")) != -1) {
+    switch (opt) {
+    case 's':
+      seconds = atof(optarg);
+      break;
+    case 'c':
+      samplesPerCall = atoi(optarg);
+      break;
+    default:
+      seconds = 0.0;
+      break;
+    }
+  }
+  if (seconds <= 0.0 || samplesPerCall == 0) {
+    fprintf(stderr, "Usage: %s [-s seconds] [-c samplesPerDetectorCall]\n",
+            argv[0]);
+    exit(-1);
+  }
+
+  pipelineSim_init();
+  pipelineSim_seedRandom(SEED);
+  perfCounters_reset();
+  uint32_t samples = (uint32_t)(seconds * SAMPLE_RATE_HZ);
+  samples -= samples % (samplesPerCall * FILTER_FIR_DECIMATION_FACTOR);
+  for (uint32_t i = 1; i <= samples; i++) {
+    pipelineSim_tick(
+        pipelineSim_toAdcValue(NOISE_SIGMA * pipelineSim_gaussian()));
+    if (i % samplesPerCall == 0)
+      detector(false);
+  }
+
+  uint32_t decimated = samples / FILTER_FIR_DECIMATION_FACTOR;
+  for (uint32_t i = 0; i < STAGE_COUNT; i++)
+    checkStage(stageNames[i], decimated);
+  if (detector_getSampleCount() != samples)
+    fail("wrong sample count", "detector");
+  perfCounters_printReport(samples);
+
+  uint32_t available = 0;
+  for (uint32_t i = 0; i < PERF_COUNTERS_EVENT_COUNT; i++)
+    available += perfCounters_isAvailable(i);
+  printf("{\"samples\": %u, \"decimatedSamples\": %u, \"stages\": %u, "
+         "\"eventsAvailable\": %u, \"failures\": %u, \"passed\": %s}\n",
+         samples, decimated, (unsigned)STAGE_COUNT, available, failures,
+         failures == 0 ? "true" : "false");
+  return failures == 0 ? 0 : -1;
+}
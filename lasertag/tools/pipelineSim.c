@@ -0,0 +1,95 @@
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "buffer.h"
+#include "detector.h"
+#include "filter.h"
+#include "hitLedTimer.h"
+#include "lockoutTimer.h"
+#include "pipelineSim.h"
+
+#define PI 3.14159265358979323846
+#define RANDOM_DEFAULT_SEED 390
+
+static uint32_t tickCount;
+static uint32_t lockoutTicksRemaining;
+static uint32_t hitLedTicksRemaining;
+static uint32_t randomState = RANDOM_DEFAULT_SEED;
+
+// Resets the buffer, filter and detector and the simulated timers.
+void pipelineSim_init(void) {
+  buffer_init();
+  filter_init();
+  detector_init();
+  lockoutTimer_init();
+  hitLedTimer_init();
+  tickCount = 0;
+}
+
+// Performs one simulated 100 kHz timer tick with adcValue as the new sample.
+void pipelineSim_tick(buffer_data_t adcValue) {
+  lockoutTimer_tick();
+  hitLedTimer_tick();
+  buffer_pushover(adcValue);
+  tickCount++;
+}
+
+// Returns the number of ticks since pipelineSim_init().
+uint32_t pipelineSim_getTickCount(void) { return tickCount; }
+
+// Converts a value in ADC-relative units (0.0 is mid-scale) to a clipped
+// 12-bit unipolar ADC value.
+buffer_data_t pipelineSim_toAdcValue(double value) {
+  double adc = value + PIPELINE_SIM_ADC_MIDSCALE;
+  if (adc < 0)
+    return 0;
+  if (adc > PIPELINE_SIM_ADC_MAX_VALUE)
+    return PIPELINE_SIM_ADC_MAX_VALUE;
+  return (buffer_data_t)lround(adc);
+}
+
+void pipelineSim_seedRandom(uint32_t seed) {
+  randomState = seed ? seed : RANDOM_DEFAULT_SEED; // xorshift must not be 0.
+}
+
+// xorshift32, uniform in (0, 1].
+static double pipelineSim_uniform(void) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return (randomState + 1.0) / 4294967296.0;
+}
+
+// Box-Muller transform, zero mean and unit variance.
+double pipelineSim_gaussian(void) {
+  double u1 = pipelineSim_uniform();
+  double u2 = pipelineSim_uniform();
+  return sqrt(-2.0 * log(u1)) * cos(2.0 * PI * u2);
+}
+
+/*********************************************************************
+ * Host versions of the timers detector.c expects from the board.    *
+ *********************************************************************/
+
+void lockoutTimer_init() { lockoutTicksRemaining = 0; }
+
+void lockoutTimer_tick() {
+  if (lockoutTicksRemaining)
+    lockoutTicksRemaining--;
+}
+
+void lockoutTimer_start() { lockoutTicksRemaining = LOCKOUT_TIMER_EXPIRE_VALUE; }
+
+bool lockoutTimer_running() { return lockoutTicksRemaining != 0; }
+
+void hitLedTimer_init() { hitLedTicksRemaining = 0; }
+
+void hitLedTimer_tick() {
+  if (hitLedTicksRemaining)
+    hitLedTicksRemaining--;
+}
+
+void hitLedTimer_start() { hitLedTicksRemaining = HIT_LED_TIMER_EXPIRE_VALUE; }
+
+bool hitLedTimer_running() { return hitLedTicksRemaining != 0; }
@@ -0,0 +1,38 @@
+#ifndef PIPELINESIM_H_
+#define PIPELINESIM_H_
+
+#include <stdint.h>
+
+#include "buffer.h"
+
+// Host-side stand-in for the interrupt half of the detection pipeline.
+// Each call to pipelineSim_tick() does what isr_function() does on the board
+// at 100 kHz: push one ADC sample into the ADC buffer and tick the timers the
+// detector depends on. The main loop half (detector()) is called by the tool.
+// Also provides host versions of the lockout and hit-LED timers that
+// detector.c calls; with the interrupt and interval timer functions from
+// platforms/host, the real buffer, filter, detector and support code can be
+// linked unchanged.
+
+// ADC value that corresponds to 0.0 after detector scaling.
+#define PIPELINE_SIM_ADC_MIDSCALE 2047.5
+#define PIPELINE_SIM_ADC_MAX_VALUE 4095
+
+// Resets the buffer, filter and detector and the simulated timers.
+void pipelineSim_init(void);
+
+// Performs one simulated 100 kHz timer tick with adcValue as the new sample.
+void pipelineSim_tick(buffer_data_t adcValue);
+
+// Returns the number of ticks since pipelineSim_init().
+uint32_t pipelineSim_getTickCount(void);
+
+// Converts a value in ADC-relative units (0.0 is mid-scale) to a clipped
+// 12-bit unipolar ADC value.
+buffer_data_t pipelineSim_toAdcValue(double value);
+
+// Deterministic pseudo-random numbers so runs are repeatable.
+void pipelineSim_seedRandom(uint32_t seed);
+double pipelineSim_gaussian(void);
+
+#endif /* PIPELINESIM_H_ */
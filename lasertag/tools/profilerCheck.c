@@ -0,0 +1,186 @@
+// Runs the detector (lasertag/detector.c) on the host with its profiling
+// scopes (lasertag/support/profiler.c) and checks what they add up to. -s
+// seconds of noise are fed through pipelineSim_tick() and detector() drains
+// the ADC buffer every -c samples, as a main loop would.
+//
+// The scopes must nest exactly: every scope's inclusive time is its own
+// exclusive time plus the inclusive time of the scopes begun inside it, to
+// the tick. The call counts must match the samples: one FIR, one IIR and one
+// power call per decimated sample. The tool also times -n empty begin/end
+// pairs to estimate what the profiling costs the detector. The profile report
+// is printed on stdout, then a JSON summary on the last line, and the exit
+// status is non-zero if a check fails.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I. -I.. -I../support -I../../include -I../../drivers
+//       -I../../platforms/zybo/xil_arm_toolchain/bsp/ps7_cortexa9_0/include
+//       profilerCheck.c pipelineSim.c ../../platforms/host/interrupts.c
+//       ../support/profiler.c ../detector.c ../filter.c ../queue.c ../buffer.c
+//       -pthread -lm -o profilerCheck
+// Usage: profilerCheck [-s seconds] [-c samplesPerDetectorCall] [-n pairs]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "detector.h"
+#include "filter.h"
+#include "pipelineSim.h"
+#include "profiler.h"
+
+#define SAMPLE_RATE_HZ (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000)
+#define DEFAULT_SECONDS 5.0
+#define DEFAULT_SAMPLES_PER_CALL 10
+#define DEFAULT_PAIRS 1000000
+#define NOISE_SIGMA 100.0
+#define SEED 45
+#define NS_PER_SECOND 1e9
+#define PERCENT 100.0
+
+#if !PROFILER_ENABLED
+#error "profilerCheck needs PROFILER_ENABLED."
+#endif
+
+PROFILER_SCOPE(emptyScope, "empty");
+
+static uint32_t failures;
+
+static void fail(const char *message, const char *name) {
+  if (failures == 0)
+    fprintf(stderr, "%s: %s\n", name, message);
+  failures++;
+}
+
+static const profiler_scope_t *findScope(const char *name) {
+  for (const profiler_scope_t *scope = profiler_getScopes(); scope;
+       scope = scope->next)
+    if (strcmp(scope->name, name) == 0)
+      return scope;
+  fail("scope never begun", name);
+  return NULL;
+}
+
+// Each scope's inclusive time must be its exclusive time plus its children's
+// inclusive time.
+static void checkNesting(void) {
+  for (const profiler_scope_t *scope = profiler_getScopes(); scope;
+       scope = scope->next) {
+    profiler_ticks_t childTicks = 0;
+    for (const profiler_scope_t *child = profiler_getScopes(); child;
+         child = child->next)
+      if (child->parent == scope)
+        childTicks += child->inclusiveTicks;
+    if (scope->exclusiveTicks + childTicks != scope->inclusiveTicks)
+      fail("inclusive time is not exclusive plus children", scope->name);
+    if (scope->calls && scope->maxTicks * scope->calls < scope->inclusiveTicks)
+      fail("longest call is shorter than the mean", scope->name);
+  }
+}
+
+static void checkCalls(const char *name, uint32_t expected) {
+  const profiler_scope_t *scope = findScope(name);
+  if (scope && scope->calls != expected)
+    fail("wrong call count", name);
+}
+
+static void checkParent(const char *name, const char *parentName) {
+  const profiler_scope_t *scope = findScope(name);
+  if (scope && (!scope->parent || strcmp(scope->parent->name, parentName)))
+    fail("wrong parent", name);
+}
+
+int main(int argc, char *argv[]) {
+  double seconds = DEFAULT_SECONDS;
+  uint32_t samplesPerCall = DEFAULT_SAMPLES_PER_CALL;
+  uint32_t pairs = DEFAULT_PAIRS;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:c:n:")) != -1) {
+    switch (opt) {
+    case 's':
+      seconds = atof(optarg);
+      break;
+    case 'c':
+      samplesPerCall = atoi(optarg);
+      break;
+    case 'n':
+      pairs = atoi(optarg);
+      break;
+    default:
+      seconds = 0.0;
+      break;
+    }
+  }
+  if (seconds <= 0.0 || samplesPerCall == 0 || pairs == 0) {
+    fprintf(stderr,
+            "Usage: %s [-s seconds] [-c samplesPerDetectorCall] [-n pairs]\n",
+            argv[0]);
+    exit(-1);
+  }
+
+  pipelineSim_init();
+  pipelineSim_seedRandom(SEED);
+  profiler_reset();
+  uint32_t samples = (uint32_t)(seconds * SAMPLE_RATE_HZ);
+  samples -= samples % (samplesPerCall * FILTER_FIR_DECIMATION_FACTOR);
+  uint32_t detectorCalls = 0;
+  profiler_ticks_t startTicks = profiler_getTicks();
+  for (uint32_t i = 1; i <= samples; i++) {
+    pipelineSim_tick(
+        pipelineSim_toAdcValue(NOISE_SIGMA * pipelineSim_gaussian()));
+    if (i % samplesPerCall == 0) {
+      detector(false);
+      detectorCalls++;
+    }
+  }
+  double runSeconds = profiler_getSecondsSince(startTicks);
+
+  uint32_t decimated = samples / FILTER_FIR_DECIMATION_FACTOR;
+  checkNesting();
+  checkCalls("detector", detectorCalls);
+  checkCalls("fir", decimated);
+  checkCalls("iir", decimated);
+  checkCalls("power", decimated);
+  checkParent("fir", "detector");
+  checkParent("iir", "detector");
+  checkParent("power", "detector");
+  checkParent("hitCheck", "detector");
+
+  uint32_t scopeCount = 0;
+  for (const profiler_scope_t *scope = profiler_getScopes(); scope;
+       scope = scope->next)
+    scopeCount++;
+  profiler_printReport(runSeconds);
+
+  // After the report, which is of the detector alone.
+  profiler_ticks_t pairStartTicks = profiler_getTicks();
+  for (uint32_t i = 0; i < pairs; i++) {
+    PROFILER_BEGIN(emptyScope);
+    PROFILER_END(emptyScope);
+  }
+  double pairSeconds = profiler_getSecondsSince(pairStartTicks) / pairs;
+
+  const profiler_scope_t *detectorScope = findScope("detector");
+  const profiler_scope_t *hitCheckScope = findScope("hitCheck");
+  double detectorSeconds =
+      detectorScope ? profiler_ticksToSeconds(detectorScope->inclusiveTicks)
+                    : 0.0;
+  // Every pair inside detector() is charged the cost of an empty one.
+  uint32_t detectorPairs = detectorCalls + 3 * decimated +
+                           (hitCheckScope ? hitCheckScope->calls : 0);
+  double overheadPercent =
+      detectorSeconds > 0.0
+          ? detectorPairs * pairSeconds / detectorSeconds * PERCENT
+          : 0.0;
+
+  printf("{\"samples\": %u, \"detectorCalls\": %u, \"scopes\": %u, "
+         "\"runSeconds\": %.3f, \"detectorSeconds\": %.3f, "
+         "\"nsPerPair\": %.1f, \"detectorPairs\": %u, "
+         "\"overheadPercent\": %.1f, \"failures\": %u, \"passed\": %s}\n",
+         samples, detectorCalls, scopeCount, runSeconds, detectorSeconds,
+         pairSeconds * NS_PER_SECOND, detectorPairs, overheadPercent,
+         failures, failures == 0 ? "true" : "false");
+  return failures == 0 ? 0 : -1;
+}
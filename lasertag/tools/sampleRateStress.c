@@ -0,0 +1,118 @@
+// Finds the maximum sample rate the buffer->filter->detector chain can sustain
+// on the host.
+//
+// The board version (runningModes_sampleRateStress()) speeds up the timer ISR.
+// Here a producer paced by wall time stands in for the ISR: each time round the
+// main loop it pushes however many noise samples the requested rate says are
+// due, then calls detector() like the board's main loop does. Both share the
+// ramp, calibration and reporting in support/sampleRateStress.c.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I. -I.. -I../support -I../../include -I../../drivers
+//       -I../../platforms/zybo/xil_arm_toolchain/bsp/ps7_cortexa9_0/include
+//       sampleRateStress.c pipelineSim.c ../../platforms/host/interrupts.c
+//       ../../platforms/host/intervalTimer.c ../support/sampleRateStress.c
+//       ../detector.c ../filter.c ../queue.c ../buffer.c ../support/profiler.c
+//       -pthread -lm -o sampleRateStress
+// Usage: sampleRateStress [-m maxRateHz] [-s seed]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "buffer.h"
+#include "detector.h"
+#include "filter.h"
+#include "intervalTimer.h"
+#include "pipelineSim.h"
+#include "sampleRateStress.h"
+
+#define DEFAULT_SEED 390
+// A host CPU is much faster than the board, so ramp further by default.
+#define DEFAULT_MAX_RATE_HZ 20000000
+
+#define PRODUCER_TIMER INTERVAL_TIMER_TIMER_0
+#define TOTAL_RUNTIME_TIMER INTERVAL_TIMER_TIMER_1
+#define DETECTOR_TIMER INTERVAL_TIMER_TIMER_2
+
+// Noise level in ADC counts. The value does not change the processing cost.
+#define NOISE_SIGMA 100.0
+
+#define NOMINAL_SAMPLE_RATE_HZ (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000)
+
+// Pushes the samples that are due at rateHz after elapsed seconds.
+static void produce(uint32_t rateHz, double elapsed, uint64_t *produced,
+                    sampleRateStress_step_t *step) {
+  uint64_t due = (uint64_t)(rateHz * elapsed);
+  // Pushing more than the buffer holds would only overwrite the same slots.
+  if (due - *produced > buffer_size()) {
+    *produced = due - buffer_size();
+    step->overflowed = true;
+  }
+  intervalTimer_start(PRODUCER_TIMER);
+  for (; *produced < due; (*produced)++)
+    pipelineSim_tick(
+        pipelineSim_toAdcValue(NOISE_SIGMA * pipelineSim_gaussian()));
+  intervalTimer_stop(PRODUCER_TIMER);
+}
+
+static void hostStep(uint32_t rateHz, double seconds,
+                     sampleRateStress_step_t *step) {
+  uint64_t produced = 0;
+  pipelineSim_init();
+  detector_ignoreAllHits(true); // Only the processing load matters here.
+  intervalTimer_resetAll();
+  intervalTimer_start(TOTAL_RUNTIME_TIMER);
+
+  double elapsed = 0;
+  while (elapsed < seconds) {
+    produce(rateHz, elapsed, &produced, step);
+    sampleRateStress_recordBacklog(step, buffer_elements(),
+                                   elapsed >= seconds / 2);
+    intervalTimer_start(DETECTOR_TIMER);
+    detector(false);
+    intervalTimer_stop(DETECTOR_TIMER);
+    elapsed = intervalTimer_getTotalDurationInSeconds(TOTAL_RUNTIME_TIMER);
+  }
+
+  intervalTimer_stop(TOTAL_RUNTIME_TIMER);
+  step->seconds = intervalTimer_getTotalDurationInSeconds(TOTAL_RUNTIME_TIMER);
+  step->measuredRateHz = produced / step->seconds;
+  step->producerUtilization =
+      intervalTimer_getTotalDurationInSeconds(PRODUCER_TIMER) / step->seconds;
+  step->detectorUtilization =
+      intervalTimer_getTotalDurationInSeconds(DETECTOR_TIMER) / step->seconds;
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t seed = DEFAULT_SEED;
+  uint32_t maxRateHz = DEFAULT_MAX_RATE_HZ;
+  int opt;
+  while ((opt = getopt(argc, argv, "m:s:")) != -1) {
+    switch (opt) {
+    case 'm':
+      maxRateHz = strtoul(optarg, NULL, 0);
+      break;
+    case 's':
+      seed = strtoul(optarg, NULL, 0);
+      break;
+    default:
+      fprintf(stderr, "Usage: %s [-m maxRateHz] [-s seed]\n", argv[0]);
+      exit(-1);
+    }
+  }
+  pipelineSim_seedRandom(seed);
+  pipelineSim_init();
+
+  sampleRateStress_stageCosts_t costs;
+  sampleRateStress_measureStageCosts(&costs, TOTAL_RUNTIME_TIMER);
+  sampleRateStress_printStageCosts(&costs, NOMINAL_SAMPLE_RATE_HZ);
+  printf("\n");
+  uint32_t sustainableRateHz =
+      sampleRateStress_run(hostStep, &costs, maxRateHz);
+  printf("\n");
+  sampleRateStress_printStageCosts(&costs, sustainableRateHz);
+  return 0;
+}
@@ -0,0 +1,112 @@
+// Runs the detector (lasertag/detector.c) on the host with the PC sampler on
+// and writes the sample stream (see support/sampler.h) the board would send,
+// for trying out tools/samplerReport without a board. -s seconds of noise are
+// fed through pipelineSim_tick() and detector() drains the buffer every -c
+// samples, while SIGPROF samples where the process spends its CPU time.
+//
+// A JSON summary is printed on stdout and the exit status is non-zero if no
+// samples were taken, any were dropped, or the dump is not the header plus
+// every address in the table.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -g -DSAMPLER_ENABLED=1 -I. -I.. -I../support -I../../include
+//       -I../../drivers
+//       -I../../platforms/zybo/xil_arm_toolchain/bsp/ps7_cortexa9_0/include
+//       samplerCapture.c pipelineSim.c ../../platforms/host/interrupts.c
+//       ../support/sampler.c ../support/crc16.c ../support/profiler.c
+//       ../detector.c ../filter.c ../queue.c ../buffer.c -pthread
+//       -lm -o samplerCapture
+// Usage: samplerCapture [-s seconds] [-c samplesPerDetectorCall] -o out.bin
+// Then: samplerReport -e samplerCapture -n nm out.bin
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "detector.h"
+#include "filter.h"
+#include "pipelineSim.h"
+#include "sampler.h"
+
+#define SAMPLE_RATE_HZ (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000)
+#define DEFAULT_SECONDS 10.0
+#define DEFAULT_SAMPLES_PER_CALL 50
+#define NOISE_SIGMA 100.0
+#define SEED 48
+
+#if !SAMPLER_ENABLED
+#error "samplerCapture needs -DSAMPLER_ENABLED=1."
+#endif
+
+int main(int argc, char *argv[]) {
+  double seconds = DEFAULT_SECONDS;
+  uint32_t samplesPerCall = DEFAULT_SAMPLES_PER_CALL;
+  const char *outputName = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:c:o:")) != -1) {
+    switch (opt) {
+    case 's':
+      seconds = atof(optarg);
+      break;
+    case 'c':
+      samplesPerCall = atoi(optarg);
+      break;
+    case 'o':
+      outputName = optarg;
+      break;
+    default:
+      seconds = 0.0;
+      break;
+    }
+  }
+  if (seconds <= 0.0 || samplesPerCall == 0 || !outputName) {
+    fprintf(stderr,
+            "Usage: %s [-s seconds] [-c samplesPerDetectorCall] -o out.bin\n",
+            argv[0]);
+    exit(-1);
+  }
+  FILE *out = fopen(outputName, "wb");
+  if (!out) {
+    fprintf(stderr, "ERROR: cannot create %s.\n", outputName);
+    exit(-1);
+  }
+
+  pipelineSim_init();
+  pipelineSim_seedRandom(SEED);
+  sampler_start();
+  uint32_t adcSamples = (uint32_t)(seconds * SAMPLE_RATE_HZ);
+  for (uint32_t i = 1; i <= adcSamples; i++) {
+    pipelineSim_tick(
+        pipelineSim_toAdcValue(NOISE_SIGMA * pipelineSim_gaussian()));
+    if (i % samplesPerCall == 0)
+      detector(false);
+  }
+  sampler_stop();
+
+  uint8_t frame[SAMPLER_MAX_FRAME_BYTES];
+  uint32_t frameLength, frames = 0, bytes = 0, addresses = 0;
+  while ((frameLength = sampler_takeFrame(frame))) {
+    fwrite(frame, 1, frameLength, out);
+    if (frames++ > 0)
+      addresses += (frameLength - SAMPLER_FRAME_HEADER_BYTES -
+                    SAMPLER_FRAME_CRC_BYTES) /
+                   SAMPLER_ENTRY_BYTES;
+    bytes += frameLength;
+  }
+  fclose(out);
+
+  uint32_t samples = sampler_getSampleCount();
+  uint32_t dropped = sampler_getDroppedCount();
+  uint32_t expectedFrames =
+      1 + (addresses + SAMPLER_FRAME_ENTRIES - 1) / SAMPLER_FRAME_ENTRIES;
+  bool passed = samples > 0 && dropped == 0 && addresses > 0 &&
+                frames == expectedFrames;
+  printf("{\"adcSamples\": %u, \"pcSamples\": %u, \"dropped\": %u, "
+         "\"addresses\": %u, \"frames\": %u, \"bytes\": %u, "
+         "\"passed\": %s}\n",
+         adcSamples, samples, dropped, addresses, frames, bytes,
+         passed ? "true" : "false");
+  return passed ? 0 : -1;
+}
@@ -0,0 +1,386 @@
+// Turns the PC samples sent at the end of a running mode built with
+// -DSAMPLER_ENABLED=1 (see support/sampler.h) into a flat profile: the share
+// of samples, and so of run time, that landed in each function of the
+// executable they were taken from. Functions come from nm; samples that fall
+// outside its text symbols (shared libraries on the host, or the wrong ELF)
+// are counted as [unknown].
+//
+// As with traceToChrome, the stream may contain console text around the
+// frames: the decoder resynchronizes on the sync word, rejects frames whose
+// CRC does not match and counts frames missing from the sequence. A summary
+// is printed on stderr.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I. -I../support samplerReport.c ../support/crc16.c
+//       -o samplerReport
+// Usage: samplerReport -e lasertag.elf [-n nm] [capture.bin]
+// Reads stdin if no capture file is given. nm defaults to arm-none-eabi-nm;
+// use -n nm for a dump taken on the host.
+
+#include <inttypes.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "crc16.h"
+#include "sampler.h"
+
+#define READ_CHUNK_BYTES 65536
+#define COMMAND_BYTES 1024
+#define LINE_BYTES 1024
+#define DEFAULT_NM "arm-none-eabi-nm"
+#define ANCHOR_SYMBOL "sampler_start"
+#define UNKNOWN_FUNCTION "[unknown]"
+#define PERCENT 100.0
+
+// Frame field offsets, see sampler.h.
+#define FRAME_VERSION_OFFSET 4
+#define FRAME_TYPE_OFFSET 5
+#define FRAME_LENGTH_OFFSET 6
+#define FRAME_SEQUENCE_OFFSET 8
+#define MAX_PAYLOAD_BYTES (SAMPLER_FRAME_ENTRIES * SAMPLER_ENTRY_BYTES)
+// Header payload offsets.
+#define HEADER_RATE_OFFSET 0
+#define HEADER_SAMPLES_OFFSET 4
+#define HEADER_DROPPED_OFFSET 8
+#define HEADER_ENTRIES_OFFSET 12
+#define HEADER_ANCHOR_OFFSET 16
+
+typedef struct {
+  uint64_t pc;
+  uint32_t count;
+} entry_t;
+
+typedef struct {
+  uint64_t address;
+  uint64_t size; // 0 if nm gave none.
+  char *name;
+  bool text; // Others are kept only to end the sizeless ones before them.
+  uint32_t samples;
+} symbol_t;
+
+typedef struct {
+  uint32_t frames;
+  uint32_t crcErrors;
+  uint32_t badHeaders;
+  uint32_t missingFrames;
+  uint32_t skippedBytes;
+  uint32_t samples;
+  uint32_t droppedSamples;
+  uint32_t dumpedEntries;
+  uint32_t decodedEntries;
+} decodeStats_t;
+
+static uint32_t sampleRate;
+static uint64_t anchorAddress;
+static bool haveHeader;
+static entry_t *entries;
+static uint32_t entryCount;
+static uint32_t entryCapacity;
+static symbol_t *symbols;
+static uint32_t symbolCount;
+static uint32_t symbolCapacity;
+
+static uint64_t getLittleEndian(const uint8_t *data, uint16_t byteCount) {
+  uint64_t value = 0;
+  for (uint16_t i = 0; i < byteCount; i++)
+    value |= (uint64_t)data[i] << (i * 8);
+  return value;
+}
+
+// Reads all of input into a malloc'd buffer.
+static uint8_t *readAll(FILE *input, size_t *length) {
+  size_t capacity = READ_CHUNK_BYTES;
+  uint8_t *data = malloc(capacity);
+  *length = 0;
+  while (data) {
+    size_t n = fread(data + *length, 1, capacity - *length, input);
+    *length += n;
+    if (*length < capacity)
+      break;
+    capacity *= 2;
+    uint8_t *bigger = realloc(data, capacity);
+    if (!bigger)
+      free(data);
+    data = bigger;
+  }
+  return data;
+}
+
+static bool isSync(const uint8_t *data) {
+  return getLittleEndian(data, SAMPLER_SYNC_BYTES) == SAMPLER_SYNC_WORD;
+}
+
+static void readHeader(const uint8_t *payload, decodeStats_t *stats) {
+  sampleRate = getLittleEndian(&payload[HEADER_RATE_OFFSET], 4);
+  stats->samples = getLittleEndian(&payload[HEADER_SAMPLES_OFFSET], 4);
+  stats->droppedSamples = getLittleEndian(&payload[HEADER_DROPPED_OFFSET], 4);
+  stats->dumpedEntries = getLittleEndian(&payload[HEADER_ENTRIES_OFFSET], 4);
+  anchorAddress = getLittleEndian(&payload[HEADER_ANCHOR_OFFSET], 8);
+  haveHeader = true;
+}
+
+static void readEntries(const uint8_t *payload, uint32_t length) {
+  for (uint32_t offset = 0; offset + SAMPLER_ENTRY_BYTES <= length;
+       offset += SAMPLER_ENTRY_BYTES) {
+    if (entryCount == entryCapacity) {
+      entryCapacity = entryCapacity ? entryCapacity * 2 : SAMPLER_TABLE_ENTRIES;
+      entry_t *bigger = realloc(entries, entryCapacity * sizeof(entry_t));
+      if (!bigger) {
+        fprintf(stderr, "ERROR: out of memory.\n");
+        exit(-1);
+      }
+      entries = bigger;
+    }
+    entries[entryCount].pc = getLittleEndian(&payload[offset], 8);
+    entries[entryCount].count = getLittleEndian(&payload[offset + 8], 4);
+    entryCount++;
+  }
+}
+
+// Decodes every good frame in data[0..length) into entries.
+static void decode(const uint8_t *data, size_t length, decodeStats_t *stats) {
+  uint32_t expectedSequence = 0;
+  size_t i = 0;
+  while (i + SAMPLER_FRAME_HEADER_BYTES <= length) {
+    if (!isSync(&data[i])) {
+      stats->skippedBytes++;
+      i++;
+      continue;
+    }
+    const uint8_t *frame = &data[i];
+    uint32_t payloadLength = getLittleEndian(&frame[FRAME_LENGTH_OFFSET], 2);
+    uint8_t type = frame[FRAME_TYPE_OFFSET];
+    if (frame[FRAME_VERSION_OFFSET] != SAMPLER_FORMAT_VERSION ||
+        (type == SAMPLER_HEADER_FRAME &&
+         payloadLength != SAMPLER_HEADER_PAYLOAD_BYTES) ||
+        (type != SAMPLER_HEADER_FRAME && type != SAMPLER_SAMPLES_FRAME) ||
+        payloadLength > MAX_PAYLOAD_BYTES) {
+      stats->badHeaders++;
+      stats->skippedBytes++;
+      i++;
+      continue;
+    }
+    size_t payloadEnd = SAMPLER_FRAME_HEADER_BYTES + payloadLength;
+    size_t frameLength = payloadEnd + SAMPLER_FRAME_CRC_BYTES;
+    if (i + frameLength > length)
+      break; // Truncated at the end of the stream.
+    uint16_t crc = crc16_compute(&frame[SAMPLER_SYNC_BYTES],
+                                 payloadEnd - SAMPLER_SYNC_BYTES);
+    if (crc != getLittleEndian(&frame[payloadEnd], SAMPLER_FRAME_CRC_BYTES)) {
+      stats->crcErrors++;
+      stats->skippedBytes++;
+      i++;
+      continue;
+    }
+
+    const uint8_t *payload = &frame[SAMPLER_FRAME_HEADER_BYTES];
+    uint32_t sequence = getLittleEndian(&frame[FRAME_SEQUENCE_OFFSET], 4);
+    if (type == SAMPLER_HEADER_FRAME) {
+      // A new dump: keep only the last one in the stream.
+      entryCount = 0;
+      expectedSequence = 1;
+      stats->missingFrames = 0;
+      readHeader(payload, stats);
+    } else if (haveHeader && sequence >= expectedSequence) {
+      stats->missingFrames += sequence - expectedSequence;
+      readEntries(payload, payloadLength);
+      expectedSequence = sequence + 1;
+    }
+    stats->frames++;
+    i += frameLength;
+  }
+  stats->skippedBytes += length - i;
+}
+
+static void addSymbol(uint64_t address, uint64_t size, const char *name,
+                      bool text) {
+  if (symbolCount == symbolCapacity) {
+    symbolCapacity = symbolCapacity ? symbolCapacity * 2 : READ_CHUNK_BYTES;
+    symbol_t *bigger = realloc(symbols, symbolCapacity * sizeof(symbol_t));
+    if (!bigger) {
+      fprintf(stderr, "ERROR: out of memory.\n");
+      exit(-1);
+    }
+    symbols = bigger;
+  }
+  symbols[symbolCount++] =
+      (symbol_t){.address = address, .size = size, .name = strdup(name),
+                 .text = text};
+}
+
+// Reads the symbols of elfName, sorted by address, from nm. The last one is
+// [unknown], for samples that land in no function.
+static void readSymbols(const char *nm, const char *elfName) {
+  char command[COMMAND_BYTES];
+  snprintf(command, sizeof(command), "%s -n -S --defined-only '%s'", nm,
+           elfName);
+  FILE *pipe = popen(command, "r");
+  if (!pipe) {
+    fprintf(stderr, "ERROR: cannot run %s.\n", nm);
+    exit(-1);
+  }
+  char line[LINE_BYTES];
+  while (fgets(line, sizeof(line), pipe)) {
+    // "address [size] type name", in hex.
+    char fields[4][LINE_BYTES / 4];
+    int fieldCount = sscanf(line, "%255s %255s %255s %255s", fields[0],
+                            fields[1], fields[2], fields[3]);
+    const char *type = fieldCount == 4 ? fields[2] : fields[1];
+    const char *name = fieldCount == 4 ? fields[3] : fields[2];
+    if (fieldCount < 3 || strlen(type) != 1)
+      continue;
+    addSymbol(strtoull(fields[0], NULL, 16),
+              fieldCount == 4 ? strtoull(fields[1], NULL, 16) : 0, name,
+              strchr("TtWw", type[0]) != NULL);
+  }
+  if (pclose(pipe) != 0 || symbolCount == 0) {
+    fprintf(stderr, "ERROR: %s found no symbols in %s.\n", nm, elfName);
+    exit(-1);
+  }
+  addSymbol(0, 0, UNKNOWN_FUNCTION, true);
+}
+
+// Returns the function containing address: the last symbol at or below it,
+// if that is a function and address is within its size, or, for a function
+// nm gives no size, before the next symbol. Otherwise returns [unknown].
+static symbol_t *findSymbol(uint64_t address) {
+  symbol_t *unknown = &symbols[symbolCount - 1];
+  uint32_t low = 0, high = symbolCount - 1; // Search [low, high).
+  while (low < high) {
+    uint32_t middle = low + (high - low) / 2;
+    if (symbols[middle].address <= address)
+      low = middle + 1;
+    else
+      high = middle;
+  }
+  if (low == 0)
+    return unknown;
+  symbol_t *symbol = &symbols[low - 1];
+  if (!symbol->text || (symbol->size
+                            ? address >= symbol->address + symbol->size
+                            : low == symbolCount - 1))
+    return unknown;
+  return symbol;
+}
+
+// Returns the load offset of the executable: where the dump says
+// sampler_start() was, less where nm says it is. 0 on the board.
+static uint64_t getSlide() {
+  for (uint32_t i = 0; i < symbolCount; i++)
+    if (strcmp(symbols[i].name, ANCHOR_SYMBOL) == 0)
+      return anchorAddress - symbols[i].address;
+  fprintf(stderr,
+          "WARNING: no %s in the ELF; assuming it is loaded as linked.\n",
+          ANCHOR_SYMBOL);
+  return 0;
+}
+
+static int compareSamples(const void *a, const void *b) {
+  const symbol_t *x = *(symbol_t *const *)a, *y = *(symbol_t *const *)b;
+  if (x->samples != y->samples)
+    return x->samples > y->samples ? -1 : 1;
+  return strcmp(x->name, y->name);
+}
+
+// Prints one line per function that has samples, most first, gprof style.
+static void printFlatProfile(uint32_t total) {
+  symbol_t **sorted = malloc(symbolCount * sizeof(symbol_t *));
+  if (!sorted) {
+    fprintf(stderr, "ERROR: out of memory.\n");
+    exit(-1);
+  }
+  uint32_t functionCount = 0;
+  for (uint32_t i = 0; i < symbolCount; i++)
+    if (symbols[i].samples)
+      sorted[functionCount++] = &symbols[i];
+  qsort(sorted, functionCount, sizeof(symbol_t *), compareSamples);
+
+  printf("Flat profile: %u samples at %u Hz (%.3f s).\n\n", total, sampleRate,
+         (double)total / sampleRate);
+  printf("  %%time  cumulative  self s   samples  function\n");
+  uint32_t cumulative = 0;
+  for (uint32_t i = 0; i < functionCount; i++) {
+    cumulative += sorted[i]->samples;
+    printf("%7.2f %11.2f %7.4f %9u  %s\n",
+           PERCENT * sorted[i]->samples / total, PERCENT * cumulative / total,
+           (double)sorted[i]->samples / sampleRate, sorted[i]->samples,
+           sorted[i]->name);
+  }
+  free(sorted);
+}
+
+int main(int argc, char *argv[]) {
+  const char *elfName = NULL;
+  const char *nm = DEFAULT_NM;
+  int opt;
+  while ((opt = getopt(argc, argv, "e:n:")) != -1) {
+    switch (opt) {
+    case 'e':
+      elfName = optarg;
+      break;
+    case 'n':
+      nm = optarg;
+      break;
+    default:
+      elfName = NULL;
+      optind = argc + 1;
+      break;
+    }
+  }
+  if (!elfName || optind + 1 < argc) {
+    fprintf(stderr, "Usage: %s -e lasertag.elf [-n nm] [capture.bin]\n",
+            argv[0]);
+    exit(-1);
+  }
+
+  FILE *input = stdin;
+  if (optind < argc && !(input = fopen(argv[optind], "rb"))) {
+    fprintf(stderr, "ERROR: cannot open %s.\n", argv[optind]);
+    exit(-1);
+  }
+  size_t length;
+  uint8_t *data = readAll(input, &length);
+  if (!data) {
+    fprintf(stderr, "ERROR: unable to allocate input buffer.\n");
+    exit(-1);
+  }
+  decodeStats_t stats;
+  memset(&stats, 0, sizeof(stats));
+  decode(data, length, &stats);
+  free(data);
+  if (!haveHeader || sampleRate == 0) {
+    fprintf(stderr, "ERROR: no sampler header found.\n");
+    exit(-1);
+  }
+
+  readSymbols(nm, elfName);
+  uint64_t slide = getSlide();
+  uint32_t total = 0;
+  for (uint32_t i = 0; i < entryCount; i++) {
+    findSymbol(entries[i].pc - slide)->samples += entries[i].count;
+    total += entries[i].count;
+  }
+  stats.decodedEntries = entryCount;
+  if (total)
+    printFlatProfile(total);
+  uint32_t unknown = symbols[symbolCount - 1].samples;
+
+  fprintf(stderr,
+          "%u frames, %u of %u addresses decoded, %u of %u samples "
+          "(%u dropped), %u outside the ELF, load offset "
+          "0x%" PRIx64 ", %u missing frames, %u CRC errors, %u bad headers, "
+          "%u bytes skipped.\n",
+          stats.frames, stats.decodedEntries, stats.dumpedEntries, total,
+          stats.samples, stats.droppedSamples, unknown, slide,
+          stats.missingFrames, stats.crcErrors, stats.badHeaders,
+          stats.skippedBytes);
+  for (uint32_t i = 0; i < symbolCount; i++)
+    free(symbols[i].name);
+  free(symbols);
+  free(entries);
+  return 0;
+}
@@ -0,0 +1,146 @@
+// Checks the non-blocking audio CODEC bring-up (lasertag/sound/soundCodec.c)
+// against the SSM2603 model in soundSinkHost.c.
+//
+// The bring-up is polled from a simulated main loop, one poll every -p
+// microseconds, and must finish without breaking any of the model's rules,
+// leave the registers as the original Digilent sequence did, start the I2S
+// clocks, and never spend more than one register write in a single poll.
+// It is then run again with an IIC write made to fail, which must stop it
+// without the CODEC ever reporting ready. Last, the model itself is checked
+// by making the CODEC active straight after a reset, which it must reject.
+// A JSON summary is printed on stdout and the exit status is non-zero if any
+// check fails.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I../sound soundCodecInitTest.c soundSinkHost.c
+//       ../sound/soundCodec.c -o soundCodecInitTest
+// Usage: soundCodecInitTest [-p pollPeriodUs]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "soundCodec.h"
+#include "soundSink.h"
+#include "soundSinkHost.h"
+
+#define DEFAULT_POLL_PERIOD_US 1000
+#define FAILING_WRITE 5
+#define MAX_POLLS 100000
+#define MICROSECONDS_PER_SECOND 1e6
+#define MS_PER_SECOND 1000.0
+
+typedef struct {
+  uint8_t reg;
+  uint16_t value;
+} registerValue_t;
+
+// What the blocking AudioInitialize() left in the CODEC.
+static const registerValue_t expectedRegisters[] = {
+    {SOUND_CODEC_LEFT_ADC_VOLUME_REG, 0b000010111},
+    {SOUND_CODEC_RIGHT_ADC_VOLUME_REG, 0b000010111},
+    {SOUND_CODEC_LEFT_DAC_VOLUME_REG, 0b101111001},
+    {SOUND_CODEC_RIGHT_DAC_VOLUME_REG, 0b101111001},
+    {SOUND_CODEC_ANALOG_PATH_REG, 0b000010000},
+    {SOUND_CODEC_DIGITAL_PATH_REG, 0b000000000},
+    {SOUND_CODEC_POWER_REG, 0b000100000},
+    {SOUND_CODEC_INTERFACE_REG, 0b000001010},
+    {SOUND_CODEC_SAMPLING_REG, 0b000000000},
+    {SOUND_CODEC_ACTIVE_REG, 0b000000001},
+};
+#define EXPECTED_REGISTER_COUNT                                                \
+  (sizeof(expectedRegisters) / sizeof(expectedRegisters[0]))
+#define SEQUENCE_WRITE_COUNT 11
+
+typedef struct {
+  uint32_t polls;
+  double readyMs;         // Simulated time to finish.
+  uint32_t longestPollUs; // Most simulated time spent inside one poll.
+} run_t;
+
+// Polls the bring-up to completion with pollPeriodUs of other work between
+// polls.
+static run_t runBringUp(uint32_t pollPeriodUs) {
+  run_t run = {0, 0.0, 0};
+  soundCodec_startInit();
+  bool done = false;
+  while (!done && run.polls < MAX_POLLS) {
+    uint32_t before = soundSink_getMicroseconds();
+    done = soundCodec_pollInit();
+    uint32_t pollUs = soundSink_getMicroseconds() - before;
+    if (pollUs > run.longestPollUs)
+      run.longestPollUs = pollUs;
+    run.polls++;
+    if (!done)
+      soundSinkHost_advance(pollPeriodUs / MICROSECONDS_PER_SECOND);
+  }
+  run.readyMs = soundSinkHost_getSeconds() * MS_PER_SECOND;
+  return run;
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t pollPeriodUs = DEFAULT_POLL_PERIOD_US;
+  int opt;
+  while ((opt = getopt(argc, argv, "p:")) != -1) {
+    if (opt == 'p') {
+      pollPeriodUs = strtoul(optarg, NULL, 0);
+    } else {
+      fprintf(stderr, "Usage: %s [-p pollPeriodUs]\n", argv[0]);
+      exit(-1);
+    }
+  }
+
+  // A normal bring-up.
+  soundSinkHost_init(SOUND_SINK_HOST_DEFAULT_FIFO_FRAMES,
+                     SOUND_SINK_HOST_DEFAULT_DRAIN_RATE_HZ);
+  run_t run = runBringUp(pollPeriodUs);
+  const char *codecError = soundSinkHost_getCodecError();
+  uint32_t wrongRegisters = 0;
+  for (uint32_t r = 0; r < EXPECTED_REGISTER_COUNT; r++) {
+    uint16_t value = soundSinkHost_getCodecRegister(expectedRegisters[r].reg);
+    if (value != expectedRegisters[r].value) {
+      fprintf(stderr, "Register %u is 0x%03x, expected 0x%03x.\n",
+              expectedRegisters[r].reg, value, expectedRegisters[r].value);
+      wrongRegisters++;
+    }
+  }
+  uint32_t writes = soundSinkHost_getCodecWriteCount();
+  bool passed = soundCodec_isReady() && !codecError && wrongRegisters == 0 &&
+                writes == SEQUENCE_WRITE_COUNT &&
+                soundSinkHost_areClocksStarted() &&
+                run.longestPollUs <= SOUND_SINK_HOST_IIC_WRITE_US;
+  // The blocking version spent all of this inside sound_init().
+  double blockingMs = 2 * SOUND_CODEC_SETTLE_US / MS_PER_SECOND +
+                      SEQUENCE_WRITE_COUNT * SOUND_SINK_HOST_IIC_WRITE_US /
+                          MS_PER_SECOND;
+
+  // A bring-up with a failed IIC write.
+  soundSinkHost_init(SOUND_SINK_HOST_DEFAULT_FIFO_FRAMES,
+                     SOUND_SINK_HOST_DEFAULT_DRAIN_RATE_HZ);
+  soundSinkHost_failCodecWrite(FAILING_WRITE);
+  run_t failedRun = runBringUp(pollPeriodUs);
+  bool failureHandled = soundCodec_hasFailed() && !soundCodec_isReady() &&
+                        !soundSinkHost_areClocksStarted() &&
+                        soundSinkHost_getCodecWriteCount() == FAILING_WRITE;
+
+  // The model must catch a CODEC made active without settling.
+  soundSinkHost_init(SOUND_SINK_HOST_DEFAULT_FIFO_FRAMES,
+                     SOUND_SINK_HOST_DEFAULT_DRAIN_RATE_HZ);
+  soundSink_writeCodecRegister(SOUND_CODEC_RESET_REG, 0);
+  soundSink_writeCodecRegister(SOUND_CODEC_ACTIVE_REG, 1);
+  bool modelChecks = soundSinkHost_getCodecError() != NULL;
+
+  printf("{\"pollPeriodUs\": %u, \"polls\": %u, \"writes\": %u, "
+         "\"readyMs\": %.1f, \"longestPollUs\": %u, \"blockingMs\": %.1f, "
+         "\"codecError\": \"%s\", \"wrongRegisters\": %u,\n",
+         pollPeriodUs, run.polls, writes, run.readyMs, run.longestPollUs,
+         blockingMs, codecError ? codecError : "", wrongRegisters);
+  printf(" \"failedRunPolls\": %u, \"failureHandled\": %s, "
+         "\"modelChecks\": %s, \"passed\": %s}\n",
+         failedRun.polls, failureHandled ? "true" : "false",
+         modelChecks ? "true" : "false",
+         passed && failureHandled && modelChecks ? "true" : "false");
+  return (passed && failureHandled && modelChecks) ? 0 : -1;
+}
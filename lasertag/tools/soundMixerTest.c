@@ -0,0 +1,245 @@
+// Renders a scripted sequence of overlapping sounds through the software mixer
+// (lasertag/sound/soundMixer.c) and writes the result to a WAV file so it can
+// be listened to or compared in an audio editor.
+//
+// Sounds are started at block boundaries, the way sound_tick() sees them, and
+// the script starts more sounds than there are voices so that voice stealing
+// is exercised, and stacks loud sounds at unity gain so that saturation is.
+// Sounds come from the sound pack, so those stored below 48 kHz go through the
+// mixer's resampler. Every rendered sample is checked against a reference mix
+// computed from fully decoded and upsampled copies of the sounds. A JSON
+// summary is printed on stdout and the exit status is non-zero on any
+// mismatch.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I../sound soundMixerTest.c ../sound/soundMixer.c
+//       ../sound/adpcm.c ../sound/soundPack.c ../sound/soundResampler.c
+//       ../sound/soundPack.S -o soundMixerTest
+// Usage: soundMixerTest [-o out.wav]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "adpcm.h"
+#include "soundMixer.h"
+#include "soundPack.h"
+#include "soundPackIndex.h"
+#include "soundResampler.h"
+
+#define SAMPLE_RATE_HZ SOUND_MIXER_OUTPUT_RATE_HZ
+#define DEFAULT_OUTPUT_NAME "soundMixerTest.wav"
+#define MS_TO_SAMPLES(ms) ((ms) * (SAMPLE_RATE_HZ / 1000))
+
+typedef struct {
+  uint16_t packIndex;
+  soundPack_asset_t packed; // Filled in by decodeAssets().
+  uint32_t outputCount;     // Samples the mixer plays at SAMPLE_RATE_HZ.
+  int16_t *decoded;         // Reference copy at SAMPLE_RATE_HZ.
+} asset_t;
+
+static asset_t assets[] = {
+    {.packIndex = SOUND_PACK_GUNFIRE},   {.packIndex = SOUND_PACK_HIT},
+    {.packIndex = SOUND_PACK_GUNCLICK},  {.packIndex = SOUND_PACK_GUNRELOAD},
+    {.packIndex = SOUND_PACK_LOSELIFE},
+};
+enum { GUN_FIRE, HIT, GUN_CLICK, GUN_RELOAD, LOSE_LIFE };
+
+typedef struct {
+  uint32_t startMs;
+  uint8_t asset;
+  uint16_t gain;
+  // Filled in while rendering.
+  uint32_t start; // Sample the sound started at.
+  uint32_t end;   // Sample it ended at, early if its voice was stolen.
+} event_t;
+
+// A shot is hit mid-flight, then a burst of shots and clicks needs more voices
+// than there are, then four loud sounds stack at unity gain.
+static event_t script[] = {
+    {.startMs = 0, .asset = GUN_FIRE, .gain = SOUND_MIXER_UNITY_GAIN},
+    {.startMs = 150, .asset = HIT, .gain = SOUND_MIXER_UNITY_GAIN / 2},
+    {.startMs = 1500, .asset = GUN_FIRE, .gain = SOUND_MIXER_UNITY_GAIN / 2},
+    {.startMs = 1550, .asset = GUN_FIRE, .gain = SOUND_MIXER_UNITY_GAIN / 2},
+    {.startMs = 1600, .asset = GUN_CLICK, .gain = SOUND_MIXER_UNITY_GAIN},
+    {.startMs = 1650, .asset = GUN_RELOAD, .gain = SOUND_MIXER_UNITY_GAIN / 4},
+    {.startMs = 1700, .asset = HIT, .gain = SOUND_MIXER_UNITY_GAIN / 2},
+    {.startMs = 1750, .asset = GUN_CLICK, .gain = SOUND_MIXER_UNITY_GAIN},
+    {.startMs = 4000, .asset = LOSE_LIFE, .gain = SOUND_MIXER_UNITY_GAIN},
+    {.startMs = 4000, .asset = LOSE_LIFE, .gain = SOUND_MIXER_UNITY_GAIN},
+    {.startMs = 4010, .asset = HIT, .gain = SOUND_MIXER_UNITY_GAIN},
+    {.startMs = 4020, .asset = GUN_FIRE, .gain = SOUND_MIXER_UNITY_GAIN},
+};
+#define EVENT_COUNT (sizeof(script) / sizeof(script[0]))
+
+// Looks each asset up in the pack, decodes it in one go and, if it is stored
+// below SAMPLE_RATE_HZ, upsamples it with its own resampler, draining the
+// delay line with zeros the way the mixer does. Returns false if the pack or
+// an asset is unusable.
+static bool decodeAssets(void) {
+  if (!soundPack_isValid(soundPack_data))
+    return false;
+  for (uint32_t a = 0; a < sizeof(assets) / sizeof(assets[0]); a++) {
+    asset_t *asset = &assets[a];
+    soundResampler_t resampler;
+    if (!soundPack_getAsset(soundPack_data, asset->packIndex,
+                            &asset->packed) ||
+        !soundResampler_init(&resampler, asset->packed.sampleRateHz,
+                             SAMPLE_RATE_HZ))
+      return false;
+    uint32_t sampleCount = asset->packed.sampleCount;
+    int16_t *samples = malloc(sampleCount * sizeof(int16_t));
+    adpcm_decoder_t decoder;
+    adpcm_initDecoder(&decoder, asset->packed.data, sampleCount);
+    adpcm_decode(&decoder, samples, sampleCount);
+    if (resampler.factor == 1) {
+      asset->outputCount = sampleCount;
+      asset->decoded = samples;
+      continue;
+    }
+    asset->outputCount = sampleCount * resampler.factor +
+                         resampler.factor * SOUND_RESAMPLER_TAPS / 2 - 1;
+    asset->decoded = malloc(asset->outputCount * sizeof(int16_t));
+    uint32_t in = 0;
+    for (uint32_t o = 0; o < asset->outputCount; o++) {
+      if (soundResampler_needsInput(&resampler))
+        soundResampler_push(&resampler,
+                            in < sampleCount ? samples[in++] : 0);
+      asset->decoded[o] = soundResampler_next(&resampler);
+    }
+    free(samples);
+  }
+  return true;
+}
+
+static void putLittleEndian(FILE *out, uint32_t value, uint16_t byteCount) {
+  for (uint16_t i = 0; i < byteCount; i++)
+    fputc((value >> (i * 8)) & 0xFF, out);
+}
+
+// Writes a canonical 16-bit mono WAV file.
+static bool writeWav(const char *fileName, const int16_t samples[],
+                     uint32_t sampleCount) {
+  FILE *out = fopen(fileName, "wb");
+  if (!out)
+    return false;
+  uint32_t dataBytes = sampleCount * sizeof(int16_t);
+  fputs("RIFF", out);
+  putLittleEndian(out, 36 + dataBytes, 4);
+  fputs("WAVEfmt ", out);
+  putLittleEndian(out, 16, 4);                  // fmt chunk size.
+  putLittleEndian(out, 1, 2);                   // PCM.
+  putLittleEndian(out, 1, 2);                   // Mono.
+  putLittleEndian(out, SAMPLE_RATE_HZ, 4);      // Sample rate.
+  putLittleEndian(out, SAMPLE_RATE_HZ * 2, 4);  // Byte rate.
+  putLittleEndian(out, sizeof(int16_t), 2);     // Block align.
+  putLittleEndian(out, 16, 2);                  // Bits per sample.
+  fputs("data", out);
+  putLittleEndian(out, dataBytes, 4);
+  for (uint32_t i = 0; i < sampleCount; i++)
+    putLittleEndian(out, (uint16_t)samples[i], sizeof(int16_t));
+  return fclose(out) == 0;
+}
+
+// Renders the script a block at a time, recording which sample each event
+// started at and, when its voice is stolen, ended at. Returns the number of
+// samples rendered into out.
+static uint32_t render(int16_t out[], uint32_t capacity) {
+  soundMixer_voice_t voiceOf[EVENT_COUNT];
+  uint32_t position = 0;
+  uint32_t nextEvent = 0;
+  soundMixer_init();
+  while (position + SOUND_MIXER_BLOCK_SAMPLES <= capacity) {
+    for (; nextEvent < EVENT_COUNT &&
+           MS_TO_SAMPLES(script[nextEvent].startMs) <= position;
+         nextEvent++) {
+      event_t *event = &script[nextEvent];
+      const asset_t *asset = &assets[event->asset];
+      voiceOf[nextEvent] =
+          soundMixer_play(asset->packed.data, asset->packed.sampleCount,
+                          asset->packed.sampleRateHz, event->gain);
+      event->start = position;
+      event->end = position + asset->outputCount;
+      // A voice that was still playing has been stolen.
+      for (uint32_t e = 0; e < nextEvent; e++)
+        if (voiceOf[e] == voiceOf[nextEvent] && script[e].end > position)
+          script[e].end = position;
+    }
+    uint32_t count = soundMixer_mix(&out[position], SOUND_MIXER_BLOCK_SAMPLES);
+    if (count == 0) {
+      if (nextEvent == EVENT_COUNT)
+        break;
+      count = SOUND_MIXER_BLOCK_SAMPLES; // Idle until the next event.
+      memset(&out[position], 0, count * sizeof(int16_t));
+    }
+    position += count;
+  }
+  return position;
+}
+
+int main(int argc, char *argv[]) {
+  const char *outputName = DEFAULT_OUTPUT_NAME;
+  int opt;
+  while ((opt = getopt(argc, argv, "o:")) != -1) {
+    if (opt == 'o') {
+      outputName = optarg;
+    } else {
+      fprintf(stderr, "Usage: %s [-o out.wav]\n", argv[0]);
+      exit(-1);
+    }
+  }
+  if (!decodeAssets()) {
+    fprintf(stderr, "ERROR: the sound pack is unusable.\n");
+    exit(-1);
+  }
+
+  uint32_t capacity = 0;
+  for (uint32_t e = 0; e < EVENT_COUNT; e++) {
+    uint32_t end = MS_TO_SAMPLES(script[e].startMs) +
+                   assets[script[e].asset].outputCount +
+                   SOUND_MIXER_BLOCK_SAMPLES;
+    if (end > capacity)
+      capacity = end;
+  }
+  int16_t *out = malloc(capacity * sizeof(int16_t));
+  uint32_t sampleCount = render(out, capacity);
+
+  // Compare with a reference mix built from the fully decoded sounds.
+  uint32_t mismatches = 0, saturated = 0, stolen = 0;
+  for (uint32_t e = 0; e < EVENT_COUNT; e++)
+    stolen += script[e].end < script[e].start +
+                                  assets[script[e].asset].outputCount;
+  for (uint32_t i = 0; i < sampleCount; i++) {
+    int32_t sum = 0;
+    for (uint32_t e = 0; e < EVENT_COUNT; e++) {
+      const event_t *event = &script[e];
+      if (i >= event->start && i < event->end)
+        sum += (assets[event->asset].decoded[i - event->start] * event->gain) >>
+               SOUND_MIXER_GAIN_SHIFT;
+    }
+    if (sum > SOUND_MIXER_MAX_SAMPLE || sum < -SOUND_MIXER_MAX_SAMPLE) {
+      saturated++;
+      sum = sum > 0 ? SOUND_MIXER_MAX_SAMPLE : -SOUND_MIXER_MAX_SAMPLE;
+    }
+    if (out[i] != sum) {
+      if (mismatches == 0)
+        fprintf(stderr, "Mismatch at sample %u: mixed %d, expected %d.\n", i,
+                out[i], sum);
+      mismatches++;
+    }
+  }
+  bool written = writeWav(outputName, out, sampleCount);
+  if (!written)
+    fprintf(stderr, "ERROR: cannot write %s.\n", outputName);
+
+  printf("{\"output\": \"%s\", \"samples\": %u, \"seconds\": %.3f, "
+         "\"events\": %u, \"stolenVoices\": %u, \"saturatedSamples\": %u, "
+         "\"mismatches\": %u}\n",
+         outputName, sampleCount, (double)sampleCount / SAMPLE_RATE_HZ,
+         (uint32_t)EVENT_COUNT, stolen, saturated, mismatches);
+  free(out);
+  return (mismatches == 0 && stolen > 0 && saturated > 0 && written) ? 0 : -1;
+}
@@ -0,0 +1,262 @@
+// Runs the real sound state machine (lasertag/sound/sound.c) on the host
+// against a simulated audio output (soundSinkHost.c), so that changes to the
+// sound path can be measured and regression-tested without a board.
+//
+// sound_tick() is called at the timer ISR rate and simulated time advances by
+// one tick period after each call, during which the simulated CODEC drains
+// frames from the FIFO at its own rate. sound_pollInit() is called alongside
+// it until the CODEC is up, as the main loop would. Sounds are started from a
+// script of name@milliseconds arguments (names as in sound_sounds_t, without
+// the sound_ prefix and _e suffix). The frames the CODEC played are written
+// to a WAV file. A JSON summary with the time the CODEC became ready, the
+// wall-clock time of each sound_tick() call while playing (percentiles and
+// maximum), FIFO statistics and underruns is printed on stdout. The exit
+// status is non-zero if CODEC bring-up went wrong or the FIFO ever ran dry
+// while playing. With -F, the writeNumber'th CODEC register write (counting
+// from 1) fails instead, and the exit status is non-zero unless sound.c
+// reports the failure, plays nothing and stops being busy.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I../sound -I../support soundPlaybackSim.c soundSinkHost.c
+//       ../sound/sound.c ../sound/soundCodec.c ../sound/soundMixer.c
+//       ../sound/adpcm.c ../sound/soundPack.c ../sound/soundResampler.c
+//       ../sound/soundPack.S -o soundPlaybackSim
+// Usage: soundPlaybackSim [-t tickRateHz] [-d drainRateHz] [-f fifoFrames]
+//                         [-v volume0to3] [-F writeNumber] [-o out.wav]
+//                         [name@ms ...]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "sound.h"
+#include "soundSinkHost.h"
+
+#define DEFAULT_TICK_RATE_HZ 100000.0 // The timer ISR rate.
+#define DEFAULT_OUTPUT_NAME "soundPlaybackSim.wav"
+#define WAV_SAMPLE_RATE_HZ 48000
+#define MAX_EVENTS 64
+#define TAIL_SECONDS 0.05 // Keep running briefly after the last sound ends.
+#define MS_PER_SECOND 1000.0
+#define NANOSECONDS_PER_SECOND 1e9
+
+static const char *soundNames[] = {
+    "gameStart", "gunFire",  "hit",          "gunClick", "gunReload",
+    "loseLife",  "gameOver", "returnToBase", "oneSecondSilence"};
+#define SOUND_NAME_COUNT (sizeof(soundNames) / sizeof(soundNames[0]))
+
+static const sound_volume_t volumes[] = {
+    sound_minimumVolume_e, sound_mediumLowVolume_e, sound_mediumHighVolume_e,
+    sound_maximumVolume_e};
+#define VOLUME_COUNT (sizeof(volumes) / sizeof(volumes[0]))
+
+typedef struct {
+  double startSeconds;
+  sound_sounds_t sound;
+} event_t;
+
+// A game start, then a burst of overlapping effects.
+static const char *defaultScript[] = {"gameStart@0",  "gunFire@1200",
+                                      "hit@1300",     "gunFire@1350",
+                                      "gunClick@1400", "loseLife@1500"};
+
+static event_t events[MAX_EVENTS];
+static uint32_t eventCount;
+
+// Parses name@ms into the next event. Returns false if it is malformed.
+static bool parseEvent(const char *text) {
+  const char *at = strchr(text, '@');
+  if (!at || eventCount == MAX_EVENTS)
+    return false;
+  for (uint32_t s = 0; s < SOUND_NAME_COUNT; s++) {
+    if (strlen(soundNames[s]) == (size_t)(at - text) &&
+        strncmp(text, soundNames[s], at - text) == 0) {
+      events[eventCount].sound = (sound_sounds_t)s;
+      events[eventCount].startSeconds = atof(at + 1) / MS_PER_SECOND;
+      eventCount++;
+      return true;
+    }
+  }
+  return false;
+}
+
+static int compareEvents(const void *a, const void *b) {
+  double difference = ((const event_t *)a)->startSeconds -
+                      ((const event_t *)b)->startSeconds;
+  return (difference > 0) - (difference < 0);
+}
+
+static int compareTimes(const void *a, const void *b) {
+  uint32_t x = *(const uint32_t *)a, y = *(const uint32_t *)b;
+  return (x > y) - (x < y);
+}
+
+static uint32_t nanosecondsSince(const struct timespec *start) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (now.tv_sec - start->tv_sec) * NANOSECONDS_PER_SECOND +
+         (now.tv_nsec - start->tv_nsec);
+}
+
+static void putLittleEndian(FILE *out, uint32_t value, uint16_t byteCount) {
+  for (uint16_t i = 0; i < byteCount; i++)
+    fputc((value >> (i * 8)) & 0xFF, out);
+}
+
+// Writes the captured frames to a canonical 16-bit mono WAV file, undoing the
+// offset and volume scaling sound.c applies before writing to the FIFO.
+static bool writeWav(const char *fileName, const uint32_t frames[],
+                     uint32_t frameCount, uint32_t volume) {
+  FILE *out = fopen(fileName, "wb");
+  if (!out)
+    return false;
+  uint32_t dataBytes = frameCount * sizeof(int16_t);
+  fputs("RIFF", out);
+  putLittleEndian(out, 36 + dataBytes, 4);
+  fputs("WAVEfmt ", out);
+  putLittleEndian(out, 16, 4);                     // fmt chunk size.
+  putLittleEndian(out, 1, 2);                      // PCM.
+  putLittleEndian(out, 1, 2);                      // Mono.
+  putLittleEndian(out, WAV_SAMPLE_RATE_HZ, 4);     // Sample rate.
+  putLittleEndian(out, WAV_SAMPLE_RATE_HZ * 2, 4); // Byte rate.
+  putLittleEndian(out, sizeof(int16_t), 2);        // Block align.
+  putLittleEndian(out, 16, 2);                     // Bits per sample.
+  fputs("data", out);
+  putLittleEndian(out, dataBytes, 4);
+  for (uint32_t i = 0; i < frameCount; i++) {
+    int32_t sample = frames[i] == SOUND_SINK_HOST_SILENCE
+                         ? 0
+                         : (int32_t)(frames[i] / volume) - INT16_MAX;
+    putLittleEndian(out, (uint16_t)(int16_t)sample, sizeof(int16_t));
+  }
+  return fclose(out) == 0;
+}
+
+int main(int argc, char *argv[]) {
+  double tickRateHz = DEFAULT_TICK_RATE_HZ;
+  double drainRateHz = SOUND_SINK_HOST_DEFAULT_DRAIN_RATE_HZ;
+  uint32_t fifoFrames = SOUND_SINK_HOST_DEFAULT_FIFO_FRAMES;
+  uint32_t volumeIndex = VOLUME_COUNT - 1;
+  uint32_t failingWrite = 0;
+  const char *outputName = DEFAULT_OUTPUT_NAME;
+  bool usage = false;
+  int opt;
+  while ((opt = getopt(argc, argv, "t:d:f:v:F:o:")) != -1) {
+    switch (opt) {
+    case 't':
+      tickRateHz = atof(optarg);
+      break;
+    case 'd':
+      drainRateHz = atof(optarg);
+      break;
+    case 'f':
+      fifoFrames = strtoul(optarg, NULL, 0);
+      break;
+    case 'v':
+      volumeIndex = strtoul(optarg, NULL, 0);
+      break;
+    case 'F':
+      failingWrite = strtoul(optarg, NULL, 0);
+      break;
+    case 'o':
+      outputName = optarg;
+      break;
+    default:
+      usage = true;
+      break;
+    }
+  }
+  if (optind == argc)
+    for (uint32_t e = 0; e < sizeof(defaultScript) / sizeof(char *); e++)
+      parseEvent(defaultScript[e]);
+  for (int a = optind; a < argc; a++)
+    usage |= !parseEvent(argv[a]);
+  if (usage || tickRateHz <= 0 || drainRateHz <= 0 || fifoFrames == 0 ||
+      volumeIndex >= VOLUME_COUNT) {
+    fprintf(stderr,
+            "Usage: %s [-t tickRateHz] [-d drainRateHz] [-f fifoFrames] "
+            "[-v volume0to3] [-F writeNumber] [-o out.wav] [name@ms ...]\n",
+            argv[0]);
+    exit(-1);
+  }
+  qsort(events, eventCount, sizeof(event_t), compareEvents);
+
+  soundSinkHost_init(fifoFrames, drainRateHz);
+  soundSinkHost_failCodecWrite(failingWrite);
+  if (sound_init() != SOUND_STATUS_OK) {
+    fprintf(stderr, "ERROR: sound_init() failed.\n");
+    exit(-1);
+  }
+  sound_setVolume(volumes[volumeIndex]);
+
+  // Wall-clock time of each sound_tick() call made while playing.
+  uint32_t timeCapacity = 1 << 16, timeCount = 0;
+  uint32_t *tickTimes = malloc(timeCapacity * sizeof(uint32_t));
+  double tickSeconds = 1.0 / tickRateHz;
+  double now = 0.0, idleSince = 0.0, readySeconds = -1.0;
+  uint32_t ticks = 0, nextEvent = 0;
+  while (nextEvent < eventCount || sound_isBusy() ||
+         now - idleSince < TAIL_SECONDS) {
+    if (readySeconds < 0.0 && sound_pollInit())
+      readySeconds = soundSinkHost_getSeconds();
+    for (; nextEvent < eventCount && events[nextEvent].startSeconds <= now;
+         nextEvent++)
+      sound_playSound(events[nextEvent].sound);
+    bool playing = soundSinkHost_isStarted();
+    struct timespec start;
+    clock_gettime(CLOCK_MONOTONIC, &start);
+    sound_tick();
+    uint32_t elapsed = nanosecondsSince(&start);
+    if (playing) {
+      if (timeCount == timeCapacity) {
+        timeCapacity *= 2;
+        tickTimes = realloc(tickTimes, timeCapacity * sizeof(uint32_t));
+      }
+      tickTimes[timeCount++] = elapsed;
+    }
+    soundSinkHost_advance(tickSeconds);
+    now = ++ticks * tickSeconds;
+    if (sound_isBusy())
+      idleSince = now;
+  }
+
+  qsort(tickTimes, timeCount, sizeof(uint32_t), compareTimes);
+  const soundSinkHost_stats_t *stats = soundSinkHost_getStats();
+  uint32_t frameCount;
+  const uint32_t *frames = soundSinkHost_getCapture(&frameCount);
+  bool written =
+      writeWav(outputName, frames, frameCount, volumes[volumeIndex]);
+  if (!written)
+    fprintf(stderr, "ERROR: cannot write %s.\n", outputName);
+
+  const char *codecError = soundSinkHost_getCodecError();
+  printf("{\"output\": \"%s\", \"tickRateHz\": %g, \"drainRateHz\": %g, "
+         "\"fifoFrames\": %u, \"events\": %u, \"seconds\": %.3f,\n",
+         outputName, tickRateHz, drainRateHz, fifoFrames, eventCount, now);
+  printf(" \"codecReadyMs\": %.1f, \"codecFailed\": %s, "
+         "\"codecError\": \"%s\",\n",
+         readySeconds * MS_PER_SECOND, sound_hasFailed() ? "true" : "false",
+         codecError ? codecError : "");
+  printf(" \"playingTicks\": %u, \"tickNs\": {\"p50\": %u, \"p99\": %u, "
+         "\"p999\": %u, \"max\": %u}, \"maxRefillNs\": %u,\n",
+         timeCount, timeCount ? tickTimes[timeCount / 2] : 0,
+         timeCount ? tickTimes[(uint32_t)(timeCount * 0.99)] : 0,
+         timeCount ? tickTimes[(uint32_t)(timeCount * 0.999)] : 0,
+         timeCount ? tickTimes[timeCount - 1] : 0,
+         sound_getMaxTickCycles()); // Counts nanoseconds on the host.
+  printf(" \"framesWritten\": %u, \"framesPlayed\": %u, \"maxFifoFill\": %u, "
+         "\"discardedFrames\": %u, \"underrunFrames\": %u, "
+         "\"underrunEvents\": %u}\n",
+         stats->framesWritten, stats->framesPlayed, stats->maxFill,
+         stats->discardedFrames, stats->underrunFrames, stats->underrunEvents);
+  free(tickTimes);
+  bool passed = failingWrite ? sound_hasFailed() && !sound_isBusy() &&
+                                   stats->framesWritten == 0
+                             : stats->underrunFrames == 0 &&
+                                   readySeconds >= 0.0 && !sound_hasFailed();
+  return (passed && !codecError && written) ? 0 : -1;
+}
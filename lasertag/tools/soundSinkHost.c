@@ -0,0 +1,257 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "soundCodec.h"
+#include "soundSink.h"
+#include "soundSinkHost.h"
+
+#define MAX_FIFO_FRAMES 4096
+#define INITIAL_CAPTURE_FRAMES 65536
+#define NANOSECONDS_PER_SECOND 1000000000ull
+#define MICROSECONDS_PER_SECOND 1e6
+#define NANOSECONDS_PER_MICROSECOND 1000
+#define CODEC_REGISTER_BITS 0x1FF
+#define CODEC_POWER_RESET_VALUE 0b010011111 // Everything powered down.
+#define CODEC_ACTIVE 0b000000001
+#define CODEC_DAC_VOLUME_BOTH 0b100000000 // Left DAC volume sets both.
+
+static uint32_t fifo[MAX_FIFO_FRAMES];
+static uint32_t fifoFrames = SOUND_SINK_HOST_DEFAULT_FIFO_FRAMES;
+static uint32_t fifoHead; // Next frame to play.
+static uint32_t fifoFill;
+static bool started;
+static bool underrunning;
+
+static double drainRateHz = SOUND_SINK_HOST_DEFAULT_DRAIN_RATE_HZ;
+static double pendingFrames; // Fraction of a frame carried between advances.
+
+static uint32_t *capture;
+static uint32_t captureCount;
+static uint32_t captureCapacity;
+
+static soundSinkHost_stats_t stats;
+static uint64_t nowNs; // Simulated time, kept whole so it does not drift.
+
+// The SSM2603 model.
+static uint16_t codecRegisters[SOUND_CODEC_REGISTER_COUNT];
+static bool codecWasReset;
+static bool codecWasPoweredUp;
+static uint32_t codecResetUs;   // When it was last reset.
+static uint32_t codecPowerUpUs; // When it was first powered up.
+static uint32_t codecWriteCount;
+static uint32_t codecFailingWrite;
+static bool clocksStarted;
+static const char *codecError;
+
+// Sets the FIFO depth (at most 4096 frames) and the rate the CODEC drains it
+// at, and clears the FIFO, the capture, the statistics, the CODEC model and
+// simulated time.
+void soundSinkHost_init(uint32_t frames, double rateHz) {
+  fifoFrames = frames > MAX_FIFO_FRAMES ? MAX_FIFO_FRAMES : frames;
+  drainRateHz = rateHz;
+  fifoHead = 0;
+  fifoFill = 0;
+  started = false;
+  underrunning = false;
+  pendingFrames = 0.0;
+  captureCount = 0;
+  stats = (soundSinkHost_stats_t){0};
+  nowNs = 0;
+  for (uint8_t reg = 0; reg < SOUND_CODEC_REGISTER_COUNT; reg++)
+    codecRegisters[reg] = 0;
+  codecWasReset = false;
+  codecWasPoweredUp = false;
+  codecPowerUpUs = 0;
+  codecWriteCount = 0;
+  codecFailingWrite = 0;
+  clocksStarted = false;
+  codecError = NULL;
+}
+
+static void captureFrame(uint32_t sample) {
+  if (captureCount == captureCapacity) {
+    captureCapacity =
+        captureCapacity ? captureCapacity * 2 : INITIAL_CAPTURE_FRAMES;
+    capture = realloc(capture, captureCapacity * sizeof(uint32_t));
+  }
+  capture[captureCount++] = sample;
+}
+
+// Plays one frame period: the next frame in the FIFO, or silence.
+static void playFrame(void) {
+  uint32_t sample = SOUND_SINK_HOST_SILENCE;
+  if (started && fifoFill > 0) {
+    sample = fifo[fifoHead];
+    fifoHead = (fifoHead + 1) % fifoFrames;
+    fifoFill--;
+    stats.framesPlayed++;
+    underrunning = false;
+  } else if (started) {
+    stats.underrunFrames++;
+    stats.underrunEvents += !underrunning;
+    underrunning = true;
+  }
+  captureFrame(sample);
+}
+
+// Moves simulated time forward, draining the frames the CODEC plays in that
+// time into the capture.
+void soundSinkHost_advance(double seconds) {
+  nowNs += (uint64_t)(seconds * NANOSECONDS_PER_SECOND + 0.5);
+  pendingFrames += seconds * drainRateHz;
+  for (; pendingFrames >= 1.0; pendingFrames -= 1.0)
+    playFrame();
+}
+
+// Returns true between soundSink_start() and soundSink_stop().
+bool soundSinkHost_isStarted(void) { return started; }
+
+// Returns the statistics since soundSinkHost_init().
+const soundSinkHost_stats_t *soundSinkHost_getStats(void) { return &stats; }
+
+// Returns the captured frames, one per drain period since
+// soundSinkHost_init(), with SOUND_SINK_HOST_SILENCE for underruns and while
+// stopped, so the capture lines up with simulated time.
+const uint32_t *soundSinkHost_getCapture(uint32_t *frameCount) {
+  *frameCount = captureCount;
+  return capture;
+}
+
+// Returns the simulated time since soundSinkHost_init().
+double soundSinkHost_getSeconds(void) {
+  return (double)nowNs / NANOSECONDS_PER_SECOND;
+}
+
+// Makes the writeNumber'th CODEC register write (counting from 1) fail, as a
+// NACK on the bus would. 0 makes every write succeed.
+void soundSinkHost_failCodecWrite(uint32_t writeNumber) {
+  codecFailingWrite = writeNumber;
+}
+
+// Returns the value last written to a CODEC register in the model.
+uint16_t soundSinkHost_getCodecRegister(uint8_t reg) {
+  return reg < SOUND_CODEC_REGISTER_COUNT ? codecRegisters[reg] : 0;
+}
+
+// Returns the number of CODEC register writes, including failed ones.
+uint32_t soundSinkHost_getCodecWriteCount(void) { return codecWriteCount; }
+
+// Returns true once soundSink_startClocks() has been called.
+bool soundSinkHost_areClocksStarted(void) { return clocksStarted; }
+
+// Returns the first bring-up rule broken, or NULL if none has been.
+const char *soundSinkHost_getCodecError(void) { return codecError; }
+
+static void breakRule(const char *rule) {
+  if (!codecError)
+    codecError = rule;
+}
+
+// Checks a register write against the bring-up rules, then applies it.
+static void writeCodecModel(uint8_t reg, uint16_t value) {
+  // Compare times the way soundCodec.c sees them.
+  uint32_t nowUs = soundSink_getMicroseconds();
+  bool active = codecRegisters[SOUND_CODEC_ACTIVE_REG] & CODEC_ACTIVE;
+  if (reg >= SOUND_CODEC_REGISTER_COUNT ||
+      (reg > SOUND_CODEC_ACTIVE_REG && reg != SOUND_CODEC_RESET_REG))
+    breakRule("write to a register that does not exist");
+  else if (value & ~CODEC_REGISTER_BITS)
+    breakRule("value wider than 9 bits");
+  else if (reg != SOUND_CODEC_RESET_REG && !codecWasReset)
+    breakRule("register written before reset");
+  else if (reg != SOUND_CODEC_RESET_REG &&
+           nowUs - codecResetUs < SOUND_CODEC_SETTLE_US)
+    breakRule("register written before the reset settled");
+  else if ((reg == SOUND_CODEC_INTERFACE_REG ||
+            reg == SOUND_CODEC_SAMPLING_REG) &&
+           active)
+    breakRule("interface changed while active");
+  else if (reg == SOUND_CODEC_ACTIVE_REG && (value & CODEC_ACTIVE) &&
+           (!codecWasPoweredUp ||
+            nowUs - codecPowerUpUs < SOUND_CODEC_SETTLE_US))
+    breakRule("made active before power-up settled");
+  else if (reg == SOUND_CODEC_POWER_REG &&
+           !(value & SOUND_CODEC_POWER_OUT_OFF) && !active)
+    breakRule("output powered up before active");
+  if (reg >= SOUND_CODEC_REGISTER_COUNT)
+    return;
+
+  if (reg == SOUND_CODEC_RESET_REG) {
+    for (uint8_t r = 0; r < SOUND_CODEC_REGISTER_COUNT; r++)
+      codecRegisters[r] = 0;
+    codecRegisters[SOUND_CODEC_POWER_REG] = CODEC_POWER_RESET_VALUE;
+    codecWasReset = true;
+    codecWasPoweredUp = false;
+    codecResetUs = nowUs;
+    return;
+  }
+  if (reg == SOUND_CODEC_POWER_REG && !codecWasPoweredUp) {
+    codecWasPoweredUp = true;
+    codecPowerUpUs = nowUs;
+  }
+  codecRegisters[reg] = value;
+  if (reg == SOUND_CODEC_LEFT_DAC_VOLUME_REG &&
+      (value & CODEC_DAC_VOLUME_BOTH))
+    codecRegisters[SOUND_CODEC_RIGHT_DAC_VOLUME_REG] = value;
+}
+
+// Host versions of the functions in soundSink.h.
+
+bool soundSink_openCodecBus() { return true; }
+
+bool soundSink_writeCodecRegister(uint8_t reg, uint16_t value) {
+  soundSinkHost_advance(SOUND_SINK_HOST_IIC_WRITE_US /
+                        MICROSECONDS_PER_SECOND);
+  if (++codecWriteCount == codecFailingWrite)
+    return false;
+  writeCodecModel(reg, value);
+  return true;
+}
+
+void soundSink_startClocks() { clocksStarted = true; }
+
+void soundSink_start() {
+  stats.discardedFrames += fifoFill;
+  fifoFill = 0;
+  started = true;
+  underrunning = false;
+}
+
+void soundSink_stop() {
+  stats.discardedFrames += fifoFill;
+  fifoFill = 0;
+  started = false;
+}
+
+bool soundSink_isFull() { return fifoFill == fifoFrames; }
+
+void soundSink_write(uint32_t sample) {
+  stats.framesWritten++;
+  if (fifoFill == fifoFrames)
+    return; // The hardware drops writes to a full FIFO.
+  fifo[(fifoHead + fifoFill) % fifoFrames] = sample;
+  fifoFill++;
+  if (fifoFill > stats.maxFill)
+    stats.maxFill = fifoFill;
+}
+
+uint32_t soundSink_getCycleCount() {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return (uint32_t)(now.tv_sec * NANOSECONDS_PER_SECOND + now.tv_nsec);
+}
+
+uint32_t soundSink_getMicroseconds() {
+  return (uint32_t)(nowNs / NANOSECONDS_PER_MICROSECOND);
+}
@@ -0,0 +1,87 @@
+/*
+This software is provided for student assignment use in the Department of
+Electrical and Computer Engineering, Brigham Young University, Utah, USA.
+Users agree to not re-host, or redistribute the software, in source or binary
+form, to other persons or other institutions. Users may modify and use the
+source code for personal or educational use.
+For questions, contact Brad Hutchings or Jeff Goeders, https://ece.byu.edu/
+*/
+
+#ifndef SOUNDSINKHOST_H_
+#define SOUNDSINKHOST_H_
+
+#include <stdbool.h>
+#include <stdint.h>
+
+// Host-side stand-in for the audio output behind sound.c (see
+// sound/soundSink.h). Frames written by sound_tick() go into a simulated
+// TX FIFO that the simulated CODEC drains at a fixed frame rate as
+// soundSinkHost_advance() moves time forward. Drained frames are captured so
+// they can be written out, and a frame the CODEC wants while the FIFO is
+// empty counts as an underrun. soundSink_getCycleCount() counts
+// CLOCK_MONOTONIC nanoseconds instead of CPU cycles.
+//
+// The CODEC registers written over IIC go to a model of the SSM2603 that
+// checks the bring-up rules: reset first, let each step settle, only change
+// the interface while inactive, and only power the output once active.
+// Each register write takes SOUND_SINK_HOST_IIC_WRITE_US of simulated time,
+// and soundSink_getMicroseconds() returns simulated time.
+
+#define SOUND_SINK_HOST_DEFAULT_FIFO_FRAMES 16
+#define SOUND_SINK_HOST_DEFAULT_DRAIN_RATE_HZ 48000.0
+
+// The CODEC plays this after an underrun, and when stopped.
+#define SOUND_SINK_HOST_SILENCE 0
+
+// A 3-byte IIC transfer at 100 kHz, 9 clocks a byte.
+#define SOUND_SINK_HOST_IIC_WRITE_US 270
+
+typedef struct {
+  uint32_t framesWritten;
+  uint32_t framesPlayed;   // Drained from the FIFO while started.
+  uint32_t underrunFrames; // Wanted while started, with the FIFO empty.
+  uint32_t underrunEvents; // Runs of consecutive underrun frames.
+  uint32_t discardedFrames; // Still in the FIFO when stopped or restarted.
+  uint32_t maxFill;         // Most frames in the FIFO at once.
+} soundSinkHost_stats_t;
+
+// Sets the FIFO depth (at most 4096 frames) and the rate the CODEC drains it
+// at, and clears the FIFO, the capture, the statistics, the CODEC model and
+// simulated time.
+void soundSinkHost_init(uint32_t fifoFrames, double drainRateHz);
+
+// Moves simulated time forward, draining the frames the CODEC plays in that
+// time into the capture.
+void soundSinkHost_advance(double seconds);
+
+// Returns true between soundSink_start() and soundSink_stop().
+bool soundSinkHost_isStarted(void);
+
+// Returns the statistics since soundSinkHost_init().
+const soundSinkHost_stats_t *soundSinkHost_getStats(void);
+
+// Returns the captured frames, one per drain period since
+// soundSinkHost_init(), with SOUND_SINK_HOST_SILENCE for underruns and while
+// stopped, so the capture lines up with simulated time.
+const uint32_t *soundSinkHost_getCapture(uint32_t *frameCount);
+
+// Returns the simulated time since soundSinkHost_init().
+double soundSinkHost_getSeconds(void);
+
+// Makes the writeNumber'th CODEC register write (counting from 1) fail, as a
+// NACK on the bus would. 0 makes every write succeed.
+void soundSinkHost_failCodecWrite(uint32_t writeNumber);
+
+// Returns the value last written to a CODEC register in the model.
+uint16_t soundSinkHost_getCodecRegister(uint8_t reg);
+
+// Returns the number of CODEC register writes, including failed ones.
+uint32_t soundSinkHost_getCodecWriteCount(void);
+
+// Returns true once soundSink_startClocks() has been called.
+bool soundSinkHost_areClocksStarted(void);
+
+// Returns the first bring-up rule broken, or NULL if none has been.
+const char *soundSinkHost_getCodecError(void);
+
+#endif /* SOUNDSINKHOST_H_ */
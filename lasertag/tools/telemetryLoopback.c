@@ -0,0 +1,289 @@
+// Sends synthetic detector telemetry (lasertag/support/telemetry.c) through
+// the bluetooth driver (lasertag/bluetooth/bluetooth.c) and a simulated
+// 9600 baud UART (bluetoothHost.c), and decodes it at the far end with
+// lasertag/support/telemetryDecoder.c.
+//
+// Powers are a random walk sent -r times a second, with a hit every 250 ms
+// and stats once a second, for -s seconds. bluetooth_poll() is called every
+// millisecond, as the timer ISR would, for a driver built without the UART
+// interrupt. Every decoded message is checked against what was sent: powers
+// and hit powers to within half a code, everything else exactly. With -e, that
+// fraction of bytes on the wire has a bit flipped; no corrupted message may
+// get through, and once the errors stop the receiver must pick the powers up
+// again at the next key. The tool reports the frame sizes, how busy the link
+// was and how many powers updates a second the link could carry. A JSON
+// summary is printed on stdout and the exit status is non-zero if any check
+// fails.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I.. -I../support -I../bluetooth
+//       -I../../platforms/zybo/xil_arm_toolchain/bsp/ps7_cortexa9_0/include
+//       telemetryLoopback.c bluetoothHost.c ../bluetooth/bluetooth.c
+//       ../support/telemetry.c ../support/telemetryDecoder.c
+//       ../support/cobs.c ../support/crc16.c -lm -o telemetryLoopback
+// Add -DBLUETOOTH_UART_INTERRUPT_ID=0 to run the driver from the interrupt.
+// Usage: telemetryLoopback [-r powersRateHz] [-s seconds] [-e byteErrorRate]
+//                          [-S seed]
+
+#include <math.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "bluetooth.h"
+#include "bluetoothHost.h"
+#include "telemetry.h"
+#include "telemetryDecoder.h"
+
+#define DEFAULT_POWERS_RATE_HZ 50.0
+#define DEFAULT_SECONDS 10.0
+#define DEFAULT_SEED 1
+#define POLL_PERIOD_S 0.001
+#define HIT_PERIOD_S 0.25
+#define STATS_PERIOD_S 1.0
+#define DRAIN_LIMIT_S 5.0 // Longest wait for the queue to empty at the end.
+#define MS_PER_SECOND 1000.0
+#define SEQUENCE_COUNT 256
+#define WALK_STEP 0.02 // Standard deviation of each power's step, in ln.
+#define MIN_POWER 1.0
+#define MAX_POWER 1e9
+#define ADC_RATE_HZ 100000
+
+typedef struct {
+  uint32_t frames;
+  uint64_t bytes;
+} frameTally_t;
+
+// What was sent under each sequence number, to check the decoder against.
+static telemetry_message_t sent[SEQUENCE_COUNT];
+static frameTally_t tally[TELEMETRY_STATS_MESSAGE + 1];
+static uint32_t randomState = DEFAULT_SEED;
+
+static uint32_t nextRandom(void) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static double nextUniform(void) { return (nextRandom() + 0.5) / 4294967296.0; }
+
+static double nextGaussian(void) {
+  return sqrt(-2.0 * log(nextUniform())) * cos(2.0 * M_PI * nextUniform());
+}
+
+// Queues a frame with telemetry_sendFrame(), remembering what it holds.
+// Returns false if it was dropped.
+static bool sendFrame(telemetry_message_t *message, uint8_t frame[],
+                      uint32_t length) {
+  uint8_t packet[TELEMETRY_MAX_FRAME_BYTES];
+  uint32_t packetLength;
+  cobs_decode(frame, length - 1, packet, &packetLength);
+  message->type = packet[0];
+  message->sequence = packet[1];
+  sent[message->sequence] = *message;
+  tally[message->type].frames++;
+  tally[message->type].bytes += length;
+  return telemetry_sendFrame(frame, length);
+}
+
+// Takes each power a random step, staying within MIN_POWER .. MAX_POWER.
+static void walkPowers(double powers[]) {
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++) {
+    powers[i] *= exp(WALK_STEP * nextGaussian());
+    powers[i] = fmin(fmax(powers[i], MIN_POWER), MAX_POWER);
+  }
+}
+
+// Returns true if two powers are within half a code of each other.
+static bool isPowerClose(double decoded, double original) {
+  double codes = fabs(log2(1.0 + decoded) - log2(1.0 + original)) *
+                 TELEMETRY_POWER_STEPS_PER_OCTAVE;
+  return codes <= 0.5 + 1e-9;
+}
+
+// Returns true if a decoded message matches the one sent with its sequence.
+static bool matchesSent(const telemetry_message_t *message) {
+  const telemetry_message_t *original = &sent[message->sequence];
+  bool isPowers = message->type == TELEMETRY_POWERS_KEY_MESSAGE ||
+                  message->type == TELEMETRY_POWERS_DELTA_MESSAGE;
+  if (message->type != original->type)
+    return false;
+  if (isPowers) {
+    for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+      if (!isPowerClose(message->powers[i], original->powers[i]))
+        return false;
+    return true;
+  }
+  if (message->type == TELEMETRY_HIT_MESSAGE)
+    return message->hit.sampleIndex == original->hit.sampleIndex &&
+           message->hit.frequencyNumber == original->hit.frequencyNumber &&
+           isPowerClose(message->hit.peakPower, original->hit.peakPower) &&
+           isPowerClose(message->hit.powerRatio, original->hit.powerRatio);
+  return memcmp(&message->stats, &original->stats, sizeof(message->stats)) == 0;
+}
+
+static double averageBytes(const frameTally_t *t) {
+  return t->frames ? (double)t->bytes / t->frames : 0.0;
+}
+
+int main(int argc, char *argv[]) {
+  double powersRateHz = DEFAULT_POWERS_RATE_HZ;
+  double seconds = DEFAULT_SECONDS;
+  double errorRate = 0.0;
+  uint32_t seed = DEFAULT_SEED;
+  int opt;
+  while ((opt = getopt(argc, argv, "r:s:e:S:")) != -1) {
+    switch (opt) {
+    case 'r':
+      powersRateHz = atof(optarg);
+      break;
+    case 's':
+      seconds = atof(optarg);
+      break;
+    case 'e':
+      errorRate = atof(optarg);
+      break;
+    case 'S':
+      seed = strtoul(optarg, NULL, 0);
+      break;
+    default:
+      powersRateHz = 0.0;
+      break;
+    }
+  }
+  if (powersRateHz <= 0.0 || seconds <= 0.0 || errorRate < 0.0) {
+    fprintf(stderr,
+            "Usage: %s [-r powersRateHz] [-s seconds] [-e byteErrorRate] "
+            "[-S seed]\n",
+            argv[0]);
+    exit(-1);
+  }
+  randomState = seed ? seed : DEFAULT_SEED;
+  bluetoothHost_init(errorRate, seed);
+  bluetooth_init();
+  telemetry_init();
+  telemetryDecoder_t decoder;
+  telemetryDecoder_init(&decoder);
+
+  double powers[FILTER_FREQUENCY_COUNT];
+  for (uint16_t i = 0; i < FILTER_FREQUENCY_COUNT; i++)
+    powers[i] = exp(nextUniform() * log(MAX_POWER / 1000.0));
+  telemetry_stats_t stats = {0};
+  uint32_t mismatches = 0, decodedCount = 0;
+  int32_t lastPowersSequence = -1; // Last powers queued.
+  int32_t lastPowersDecoded = -1;  // Last powers decoded correctly.
+  double nextPowers = 0.0, nextHit = HIT_PERIOD_S, nextStats = STATS_PERIOD_S;
+  // Errors stop for the last STATS_PERIOD_S of sending, so the receiver has to
+  // pick up again from the next key.
+  double cleanTailStart = seconds - STATS_PERIOD_S;
+  double end = seconds;
+  for (uint32_t tick = 0;; tick++) {
+    double now = tick * POLL_PERIOD_S;
+    bool sending = now < seconds;
+    if (!sending && (bluetoothHost_getPendingBytes() == 0 ||
+                     now > seconds + DRAIN_LIMIT_S)) {
+      end = now;
+      break;
+    }
+    if (now >= cleanTailStart)
+      bluetoothHost_setByteErrorRate(0.0);
+    uint8_t frame[TELEMETRY_MAX_FRAME_BYTES];
+    telemetry_message_t message;
+    for (; sending && nextPowers <= now; nextPowers += 1.0 / powersRateHz) {
+      walkPowers(powers);
+      memcpy(message.powers, powers, sizeof(powers));
+      if (sendFrame(&message, frame, telemetry_encodePowers(powers, frame)))
+        lastPowersSequence = message.sequence;
+    }
+    if (sending && nextHit <= now) {
+      message.hit.sampleIndex = (uint32_t)(now * ADC_RATE_HZ);
+      message.hit.frequencyNumber = nextRandom() % FILTER_FREQUENCY_COUNT;
+      message.hit.peakPower = powers[message.hit.frequencyNumber];
+      message.hit.powerRatio = 10.0 + 100.0 * nextUniform();
+      sendFrame(&message, frame, telemetry_encodeHit(&message.hit, frame));
+      stats.hitCount++;
+      nextHit += HIT_PERIOD_S;
+    }
+    if (sending && nextStats <= now) {
+      stats.uptimeMs = (uint32_t)(now * MS_PER_SECOND);
+      stats.sampleCount = (uint32_t)(now * ADC_RATE_HZ);
+      stats.droppedFrames = telemetry_getDroppedFrameCount();
+      message.stats = stats;
+      sendFrame(&message, frame, telemetry_encodeStats(&stats, frame));
+      nextStats += STATS_PERIOD_S;
+    }
+
+    bluetooth_poll();
+    bluetoothHost_advance(POLL_PERIOD_S);
+    uint8_t received[BLUETOOTH_HOST_FIFO_BYTES * 4];
+    uint32_t count = bluetoothHost_readWire(received, sizeof(received));
+    for (uint32_t i = 0; i < count; i++) {
+      if (!telemetryDecoder_addByte(&decoder, received[i], &message))
+        continue;
+      decodedCount++;
+      if (!matchesSent(&message)) {
+        if (mismatches == 0)
+          fprintf(stderr, "Message %u (type %u) does not match what was "
+                          "sent.\n",
+                  message.sequence, message.type);
+        mismatches++;
+      } else if (message.type == TELEMETRY_POWERS_KEY_MESSAGE ||
+                 message.type == TELEMETRY_POWERS_DELTA_MESSAGE) {
+        lastPowersDecoded = message.sequence;
+      }
+    }
+  }
+
+  const bluetoothHost_stats_t *link = bluetoothHost_getStats();
+  const telemetryDecoder_stats_t *errors = &decoder.stats;
+  uint32_t sentCount = 0;
+  for (uint16_t t = 0; t <= TELEMETRY_STATS_MESSAGE; t++)
+    sentCount += tally[t].frames;
+  frameTally_t powersTally = tally[TELEMETRY_POWERS_KEY_MESSAGE];
+  powersTally.frames += tally[TELEMETRY_POWERS_DELTA_MESSAGE].frames;
+  powersTally.bytes += tally[TELEMETRY_POWERS_DELTA_MESSAGE].bytes;
+  double otherBytesPerSecond = (tally[TELEMETRY_HIT_MESSAGE].bytes +
+                                tally[TELEMETRY_STATS_MESSAGE].bytes) /
+                               seconds;
+  double maxPowersRateHz =
+      (BLUETOOTH_HOST_BYTES_PER_SECOND - otherBytesPerSecond) /
+      averageBytes(&powersTally);
+  // A frame cut short just before its delimiter still arrives whole, so the
+  // last powers decoded may be newer than the last one queued in full.
+  bool resynced = lastPowersSequence >= 0 && lastPowersDecoded >= 0 &&
+                  (int8_t)(lastPowersDecoded - lastPowersSequence) >= 0;
+  // Without wire errors, everything queued must arrive, and only frames cut
+  // short by a full queue may fail to decode.
+  uint32_t droppedFrames = telemetry_getDroppedFrameCount();
+  bool clean = errorRate > 0.0 ||
+               (decodedCount >= sentCount - droppedFrames &&
+                (droppedFrames > 0 ||
+                 (errors->framingErrors == 0 && errors->crcErrors == 0 &&
+                  errors->sequenceGaps == 0)));
+  bool passed = mismatches == 0 && resynced && clean;
+
+  printf("{\"powersRateHz\": %g, \"seconds\": %g, \"byteErrorRate\": %g, "
+         "\"keyFrameBytes\": %.2f, \"deltaFrameBytes\": %.2f, "
+         "\"hitFrameBytes\": %.2f, \"statsFrameBytes\": %.2f, "
+         "\"linkUtilization\": %.3f, \"maxPowersRateHz\": %.1f, "
+         "\"maxQueueFill\": %u, \"framesSent\": %u, \"framesDropped\": %u, "
+         "\"framesDecoded\": %u, \"framingErrors\": %u, \"crcErrors\": %u, "
+         "\"sequenceGaps\": %u, \"unbasedDeltas\": %u, "
+         "\"bytesCorrupted\": %u, \"mismatches\": %u, \"resynced\": %s, "
+         "\"passed\": %s}\n",
+         powersRateHz, seconds, errorRate,
+         averageBytes(&tally[TELEMETRY_POWERS_KEY_MESSAGE]),
+         averageBytes(&tally[TELEMETRY_POWERS_DELTA_MESSAGE]),
+         averageBytes(&tally[TELEMETRY_HIT_MESSAGE]),
+         averageBytes(&tally[TELEMETRY_STATS_MESSAGE]),
+         link->bytesSent / (end * BLUETOOTH_HOST_BYTES_PER_SECOND),
+         maxPowersRateHz, link->maxQueueFill, sentCount, droppedFrames,
+         decodedCount, errors->framingErrors, errors->crcErrors,
+         errors->sequenceGaps, errors->unbasedDeltas, link->bytesCorrupted,
+         mismatches, resynced ? "true" : "false", passed ? "true" : "false");
+  return passed ? 0 : -1;
+}
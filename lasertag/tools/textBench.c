@@ -0,0 +1,352 @@
+// Checks the glyph-run text renderer (lasertag/support/textRenderer.c)
+// against the TFT driver's own text drawing and measures what it saves, on
+// the host stand-in for the TFT (displayHost.c), which draws text a dot at a
+// time the way the prebuilt driver does.
+//
+// -n trials each print a few random strings, with newlines, carriage returns
+// and characters the font lacks, at random sizes, colors and places, wrapped
+// or not, and the odd single character, first with display_print() and then
+// with textRenderer_print(). Places are often reused so that opaque text
+// lands on cached text. The two screens must match pixel for pixel. Then a
+// screen of statistics, like the one runningModes.c draws, is printed both
+// ways at each size, transparent and opaque, and printed again with some of
+// its numbers changed. The tool reports transfers and bus bytes per
+// character, how many characters a second a bus moving -b bytes a second
+// would carry, and the host's own characters a second. A JSON summary is
+// printed on stdout and the exit status is non-zero on any mismatch.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I../support -I../../include -I../../platforms/host textBench.c
+//       ../../platforms/host/display.c ../support/textRenderer.c
+//       ../support/displayFont.c ../support/format.c -lm -o textBench
+// Usage: textBench [-n trials] [-S seed] [-b busBytesPerSecond]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include "display.h"
+#include "displayFont.h"
+#include "displayHost.h"
+#include "textRenderer.h"
+
+#define DEFAULT_TRIALS 5000
+#define DEFAULT_BUS_BYTES_PER_SECOND 2.0e6
+#define PIXEL_COUNT (DISPLAY_WIDTH * DISPLAY_HEIGHT)
+#define UNDRAWN_COLOR 0x1234
+#define MAX_PRINTS 4
+#define MAX_STRING_SIZE 80
+#define MAX_TEXT_SIZE 3
+#define PLACE_COUNT 4 // Reused cursor positions, for the cache.
+#define NS_PER_SECOND 1e9
+#define TIMING_SCREENS 200
+#define STATS_LINE_COUNT 10
+#define STATS_LINE_SIZE 64
+#define STATS_BACKGROUND DISPLAY_BLACK
+
+// The two ways of drawing text, with display.h's calls.
+typedef struct {
+  void (*setCursor)(int16_t x, int16_t y);
+  void (*setTextColor)(uint16_t c);
+  void (*setTextColorBg)(uint16_t c, uint16_t bg);
+  void (*setTextSize)(uint8_t s);
+  void (*setTextWrap)(bool w);
+  size_t (*print)(const char str[]);
+  void (*drawChar)(int16_t x, int16_t y, unsigned char c, uint16_t color,
+                   uint16_t bg, uint8_t size);
+} textCalls_t;
+
+static const textCalls_t driverCalls = {
+    display_setCursor,   display_setTextColor, display_setTextColorBg,
+    display_setTextSize, display_setTextWrap,  display_print,
+    display_drawChar};
+
+static const textCalls_t rendererCalls = {
+    textRenderer_setCursor,      textRenderer_setTextColor,
+    textRenderer_setTextColorBg, textRenderer_setTextSize,
+    textRenderer_setTextWrap,    textRenderer_print,
+    textRenderer_drawChar};
+
+static uint32_t randomState = 1;
+
+static uint32_t nextRandom(void) {
+  randomState ^= randomState << 13;
+  randomState ^= randomState >> 17;
+  randomState ^= randomState << 5;
+  return randomState;
+}
+
+static int32_t randomBetween(int32_t low, int32_t high) {
+  return low + (int32_t)(nextRandom() % (uint32_t)(high - low + 1));
+}
+
+// One print, or one drawChar if text is empty.
+typedef struct {
+  int16_t x, y;
+  bool moveCursor;
+  uint16_t color, bg;
+  uint8_t size;
+  bool wrap;
+  char text[MAX_STRING_SIZE];
+  unsigned char c;
+} textOp_t;
+
+typedef struct {
+  uint8_t count;
+  textOp_t ops[MAX_PRINTS];
+} trial_t;
+
+static char randomCharacter(void) {
+  switch (nextRandom() % 16) {
+  case 0:
+    return '\n';
+  case 1:
+    return '\r';
+  case 2:
+    // Not in the font.
+    if (nextRandom() % 2)
+      return (char)randomBetween(1, DISPLAY_FONT_FIRST_CHAR - 1);
+    return (char)randomBetween(DISPLAY_FONT_LAST_CHAR + 1, 255);
+  default:
+    return (char)randomBetween(' ', '~');
+  }
+}
+
+static void makeTrial(trial_t *trial) {
+  static const int16_t placeX[PLACE_COUNT] = {0, 12, 150, 300};
+  static const int16_t placeY[PLACE_COUNT] = {0, 16, 120, 232};
+  static const uint16_t colors[] = {DISPLAY_WHITE, DISPLAY_BLACK,
+                                    DISPLAY_GREEN, DISPLAY_RED};
+  trial->count = randomBetween(1, MAX_PRINTS);
+  for (uint8_t i = 0; i < trial->count; i++) {
+    textOp_t *op = &trial->ops[i];
+    if (i > 0 && trial->ops[i - 1].text[0] && nextRandom() % 3 == 0) {
+      // The last print again, with a character or two changed, as a screen
+      // of statistics is redrawn.
+      *op = trial->ops[i - 1];
+      op->moveCursor = true;
+      uint8_t length = strlen(op->text);
+      for (uint8_t j = randomBetween(0, 2); j > 0; j--)
+        op->text[nextRandom() % length] = randomBetween(' ', '~');
+      continue;
+    }
+    if (nextRandom() % 2) {
+      op->x = placeX[nextRandom() % PLACE_COUNT];
+      op->y = placeY[nextRandom() % PLACE_COUNT];
+    } else {
+      op->x = randomBetween(-20, DISPLAY_WIDTH + 4);
+      op->y = randomBetween(-20, DISPLAY_HEIGHT + 4);
+    }
+    op->moveCursor = nextRandom() % 4 != 0;
+    op->color = colors[nextRandom() % 4];
+    op->bg = (nextRandom() % 2) ? op->color : colors[nextRandom() % 4];
+    op->size = randomBetween(1, MAX_TEXT_SIZE);
+    op->wrap = nextRandom() % 4 != 0;
+    uint8_t length = randomBetween(0, MAX_STRING_SIZE - 1);
+    if (nextRandom() % 8 == 0)
+      length = 0;
+    for (uint8_t j = 0; j < length; j++)
+      op->text[j] = randomCharacter();
+    op->text[length] = '\0';
+    op->c = (unsigned char)randomBetween(0, 255);
+  }
+}
+
+static void runTrial(const trial_t *trial, const textCalls_t *calls) {
+  calls->setCursor(0, 0);
+  for (uint8_t i = 0; i < trial->count; i++) {
+    const textOp_t *op = &trial->ops[i];
+    if (op->text[0] == '\0') {
+      calls->drawChar(op->x, op->y, op->c, op->color, op->bg, op->size);
+      continue;
+    }
+    if (op->moveCursor)
+      calls->setCursor(op->x, op->y);
+    if (op->bg == op->color)
+      calls->setTextColor(op->color);
+    else
+      calls->setTextColorBg(op->color, op->bg);
+    calls->setTextSize(op->size);
+    calls->setTextWrap(op->wrap);
+    calls->print(op->text);
+  }
+}
+
+// Starts the TFT afresh, forgetting what the renderer had cached on it.
+static void clearScreen(void) {
+  displayHost_init(UNDRAWN_COLOR);
+  textRenderer_clearCache();
+}
+
+// The statistics screen, with some numbers changed when variant is odd.
+static void makeStatsScreen(char lines[][STATS_LINE_SIZE], uint32_t variant) {
+  static const char *labels[STATS_LINE_COUNT] = {
+      "ADC mode: bipolar",
+      "Unprocessed elements in ADC buffer: ",
+      "Measured run time in seconds: ",
+      "Cumulative run time in timer ISR: ",
+      "Cumulative run time in detector: ",
+      "Total interrupts: ",
+      "Detector invocation count: ",
+      "Detector invocations per second: ",
+      "UI frames per second: ",
+      "Max ADC backlog: "};
+  for (uint8_t i = 0; i < STATS_LINE_COUNT; i++)
+    snprintf(lines[i], STATS_LINE_SIZE, "%s%s", labels[i],
+             i == 0 ? ""
+                    : (variant % 2 && i % 3 == 1) ? "12347.58" : "12345.67");
+}
+
+static void drawStatsScreen(const textCalls_t *calls, uint8_t size,
+                            bool opaque, char lines[][STATS_LINE_SIZE]) {
+  calls->setTextSize(size);
+  calls->setTextWrap(true);
+  if (opaque)
+    calls->setTextColorBg(DISPLAY_WHITE, STATS_BACKGROUND);
+  else
+    calls->setTextColor(DISPLAY_WHITE);
+  calls->setCursor(0, 0);
+  for (uint8_t i = 0; i < STATS_LINE_COUNT; i++) {
+    calls->print(lines[i]);
+    calls->print("\n");
+  }
+}
+
+static uint32_t printableCount(char lines[][STATS_LINE_SIZE]) {
+  uint32_t count = 0;
+  for (uint8_t i = 0; i < STATS_LINE_COUNT; i++)
+    count += strlen(lines[i]);
+  return count;
+}
+
+static double seconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / NS_PER_SECOND;
+}
+
+typedef struct {
+  double transfersPerChar;
+  double busBytesPerChar;
+  double hostCharsPerSecond;
+} cost_t;
+
+// What drawing the screen costs on a cleared TFT, and the host's speed at it.
+static cost_t measure(const textCalls_t *calls, uint8_t size, bool opaque) {
+  char lines[STATS_LINE_COUNT][STATS_LINE_SIZE];
+  makeStatsScreen(lines, 0);
+  uint32_t chars = printableCount(lines);
+  cost_t cost;
+  clearScreen();
+  drawStatsScreen(calls, size, opaque, lines);
+  cost.transfersPerChar = (double)displayHost_getStats()->transfers / chars;
+  cost.busBytesPerChar = (double)displayHost_getBusBytes() / chars;
+  double start = seconds();
+  for (uint32_t i = 0; i < TIMING_SCREENS; i++) {
+    textRenderer_clearCache();
+    drawStatsScreen(calls, size, opaque, lines);
+  }
+  cost.hostCharsPerSecond = TIMING_SCREENS * chars / (seconds() - start);
+  return cost;
+}
+
+// Bus bytes per character for drawing the screen again with some numbers
+// changed, after it has been drawn once.
+static double measureRedraw(const textCalls_t *calls, uint8_t size) {
+  char lines[STATS_LINE_COUNT][STATS_LINE_SIZE];
+  clearScreen();
+  makeStatsScreen(lines, 0);
+  drawStatsScreen(calls, size, true, lines);
+  uint64_t before = displayHost_getBusBytes();
+  makeStatsScreen(lines, 1);
+  drawStatsScreen(calls, size, true, lines);
+  return (double)(displayHost_getBusBytes() - before) / printableCount(lines);
+}
+
+static void printCost(const char *name, const cost_t *cost,
+                      double busBytesPerSecond) {
+  printf("\"%s\": {\"transfersPerChar\": %.2f, \"busBytesPerChar\": %.1f, "
+         "\"busCharsPerSecond\": %.0f, \"hostCharsPerSecond\": %.0f}",
+         name, cost->transfersPerChar, cost->busBytesPerChar,
+         busBytesPerSecond / cost->busBytesPerChar, cost->hostCharsPerSecond);
+}
+
+int main(int argc, char *argv[]) {
+  uint32_t trials = DEFAULT_TRIALS;
+  uint32_t seed = 1;
+  double busBytesPerSecond = DEFAULT_BUS_BYTES_PER_SECOND;
+  int opt;
+  while ((opt = getopt(argc, argv, "n:S:b:")) != -1) {
+    switch (opt) {
+    case 'n':
+      trials = atoi(optarg);
+      break;
+    case 'S':
+      seed = atoi(optarg);
+      break;
+    case 'b':
+      busBytesPerSecond = atof(optarg);
+      break;
+    default:
+      trials = 0;
+      break;
+    }
+  }
+  if (trials == 0 || busBytesPerSecond <= 0.0) {
+    fprintf(stderr, "Usage: %s [-n trials] [-S seed] [-b busBytesPerSecond]\n",
+            argv[0]);
+    exit(-1);
+  }
+  randomState = seed ? seed : 1;
+  textRenderer_init();
+
+  static display_pixel_t expected[PIXEL_COUNT];
+  uint32_t mismatches = 0;
+  for (uint32_t i = 0; i < trials; i++) {
+    trial_t trial;
+    makeTrial(&trial);
+    clearScreen();
+    runTrial(&trial, &driverCalls);
+    memcpy(expected, displayHost_getPixels(), sizeof(expected));
+    clearScreen();
+    runTrial(&trial, &rendererCalls);
+    if (memcmp(expected, displayHost_getPixels(), sizeof(expected)) != 0) {
+      if (mismatches == 0)
+        fprintf(stderr, "Trial %u differs.\n", i);
+      mismatches++;
+    }
+  }
+  // The cache must have been used for the trials to have checked it.
+  uint32_t cachedCharacters = textRenderer_getStats()->cachedCharacters;
+
+  uint8_t maxRects = 0;
+  for (int c = ' '; c <= '~'; c++)
+    if (textRenderer_getGlyphRectCount(c) > maxRects)
+      maxRects = textRenderer_getGlyphRectCount(c);
+
+  printf("{\"trials\": %u, \"mismatches\": %u, \"cachedCharacters\": %u, "
+         "\"maxGlyphRects\": %u, \"busBytesPerSecond\": %g",
+         trials, mismatches, cachedCharacters, maxRects, busBytesPerSecond);
+  for (uint8_t size = 1; size <= 2; size++) {
+    for (int opaque = 0; opaque <= 1; opaque++) {
+      cost_t driver = measure(&driverCalls, size, opaque);
+      cost_t renderer = measure(&rendererCalls, size, opaque);
+      printf(", \"size%u%s\": {", size, opaque ? "Opaque" : "Transparent");
+      printCost("driver", &driver, busBytesPerSecond);
+      printf(", ");
+      printCost("renderer", &renderer, busBytesPerSecond);
+      printf("}");
+    }
+    printf(", \"size%uRedraw\": {\"driverBusBytesPerChar\": %.1f, "
+           "\"rendererBusBytesPerChar\": %.1f}",
+           size, measureRedraw(&driverCalls, size),
+           measureRedraw(&rendererCalls, size));
+  }
+  bool passed = mismatches == 0 && cachedCharacters > 0;
+  printf(", \"passed\": %s}\n", passed ? "true" : "false");
+  return passed ? 0 : -1;
+}
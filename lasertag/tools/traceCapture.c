@@ -0,0 +1,108 @@
+// Runs the detector (lasertag/detector.c) on the host with tracing on and
+// writes the trace stream (see support/trace.h) the board would send, for
+// trying out tools/traceToChrome without a board. -s seconds of noise are
+// fed through pipelineSim_tick(), whose ADC buffer pushes are recorded as the
+// ISR's, and detector() drains the buffer every -c samples. The host runs
+// both as fast as it can, so the timeline is compressed.
+//
+// A JSON summary is printed on stdout and the exit status is non-zero if the
+// dump is not the header plus the last TRACE_BUFFER_EVENTS events.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -DTRACE_ENABLED=1 -I. -I.. -I../support -I../../include
+//       -I../../drivers
+//       -I../../platforms/zybo/xil_arm_toolchain/bsp/ps7_cortexa9_0/include
+//       traceCapture.c pipelineSim.c ../../platforms/host/interrupts.c
+//       ../support/trace.c ../support/crc16.c ../support/profiler.c
+//       ../detector.c ../filter.c ../queue.c ../buffer.c -pthread
+//       -lm -o traceCapture
+// Usage: traceCapture [-s seconds] [-c samplesPerDetectorCall] -o out.bin
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "detector.h"
+#include "filter.h"
+#include "pipelineSim.h"
+#include "trace.h"
+
+#define SAMPLE_RATE_HZ (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000)
+#define DEFAULT_SECONDS 0.1
+#define DEFAULT_SAMPLES_PER_CALL 50
+#define NOISE_SIGMA 100.0
+#define SEED 47
+
+#if !TRACE_ENABLED
+#error "traceCapture needs -DTRACE_ENABLED=1."
+#endif
+
+int main(int argc, char *argv[]) {
+  double seconds = DEFAULT_SECONDS;
+  uint32_t samplesPerCall = DEFAULT_SAMPLES_PER_CALL;
+  const char *outputName = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:c:o:")) != -1) {
+    switch (opt) {
+    case 's':
+      seconds = atof(optarg);
+      break;
+    case 'c':
+      samplesPerCall = atoi(optarg);
+      break;
+    case 'o':
+      outputName = optarg;
+      break;
+    default:
+      seconds = 0.0;
+      break;
+    }
+  }
+  if (seconds <= 0.0 || samplesPerCall == 0 || !outputName) {
+    fprintf(stderr,
+            "Usage: %s [-s seconds] [-c samplesPerDetectorCall] -o out.bin\n",
+            argv[0]);
+    exit(-1);
+  }
+  FILE *out = fopen(outputName, "wb");
+  if (!out) {
+    fprintf(stderr, "ERROR: cannot create %s.\n", outputName);
+    exit(-1);
+  }
+
+  pipelineSim_init();
+  pipelineSim_seedRandom(SEED);
+  trace_start(TRACE_ALL_IDS);
+  uint32_t samples = (uint32_t)(seconds * SAMPLE_RATE_HZ);
+  for (uint32_t i = 1; i <= samples; i++) {
+    trace_setHostIsrContext(true);
+    pipelineSim_tick(
+        pipelineSim_toAdcValue(NOISE_SIGMA * pipelineSim_gaussian()));
+    trace_setHostIsrContext(false);
+    if (i % samplesPerCall == 0)
+      detector(false);
+  }
+  trace_stop();
+
+  uint8_t frame[TRACE_MAX_FRAME_BYTES];
+  uint32_t frameLength, frames = 0, bytes = 0;
+  while ((frameLength = trace_takeFrame(frame))) {
+    fwrite(frame, 1, frameLength, out);
+    frames++;
+    bytes += frameLength;
+  }
+  fclose(out);
+
+  uint32_t recorded = trace_getEventCount();
+  uint32_t dumped =
+      recorded < TRACE_BUFFER_EVENTS ? recorded : TRACE_BUFFER_EVENTS;
+  uint32_t expectedFrames =
+      1 + (dumped + TRACE_FRAME_EVENTS - 1) / TRACE_FRAME_EVENTS;
+  bool passed = frames == expectedFrames;
+  printf("{\"samples\": %u, \"recordedEvents\": %u, \"dumpedEvents\": %u, "
+         "\"frames\": %u, \"bytes\": %u, \"passed\": %s}\n",
+         samples, recorded, dumped, frames, bytes, passed ? "true" : "false");
+  return passed ? 0 : -1;
+}
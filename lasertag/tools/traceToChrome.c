@@ -0,0 +1,364 @@
+// Decodes the trace stream sent at the end of a running mode built with
+// -DTRACE_ENABLED=1 (see support/trace.h) into Chrome trace_event JSON, for
+// chrome://tracing or https://ui.perfetto.dev. The main loop and the ISR are
+// shown as two threads of one process.
+//
+// As with adcCaptureDecode, the stream may contain console text around the
+// frames and bytes may be lost on the serial link: the decoder resynchronizes
+// on the sync word, rejects frames whose CRC does not match and counts frames
+// missing from the sequence. Timestamps are unwrapped and put in order. The
+// ring starts mid-run, so an end with no begin before it is dropped, and so is
+// everything after a missing frame until each thread is back at the top
+// level, rather than draw scopes that never happened. A summary is printed on
+// stderr.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I. -I../support traceToChrome.c ../support/crc16.c
+//       -o traceToChrome
+// Usage: traceToChrome -o out.json [capture.bin]
+// Reads stdin if no capture file is given.
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h>
+
+#include "crc16.h"
+#include "trace.h"
+
+#define READ_CHUNK_BYTES 65536
+#define MAX_IDS 256
+#define MAX_DEPTH 64
+#define US_PER_SECOND 1e6
+#define MAIN_TID 1
+#define ISR_TID 2
+#define THREAD_COUNT 2
+
+// Frame field offsets, see trace.h.
+#define FRAME_VERSION_OFFSET 4
+#define FRAME_TYPE_OFFSET 5
+#define FRAME_LENGTH_OFFSET 6
+#define FRAME_SEQUENCE_OFFSET 8
+#define MAX_PAYLOAD_BYTES (TRACE_FRAME_EVENTS * TRACE_EVENT_BYTES)
+// Header payload offsets.
+#define HEADER_TICKS_OFFSET 0
+#define HEADER_RECORDED_OFFSET 4
+#define HEADER_DUMPED_OFFSET 8
+#define HEADER_ID_COUNT_OFFSET 12
+#define HEADER_NAMES_OFFSET 13
+
+typedef struct {
+  uint64_t ticks; // Unwrapped.
+  uint32_t order; // Position in the dump, to keep sorting stable.
+  uint8_t id;
+  uint8_t flags;
+  uint16_t arg;
+  bool gapBefore; // Frames were missing just before this event.
+} event_t;
+
+typedef struct {
+  uint32_t frames;
+  uint32_t crcErrors;
+  uint32_t badHeaders;
+  uint32_t missingFrames;
+  uint32_t skippedBytes;
+  uint32_t recordedEvents;
+  uint32_t dumpedEvents;
+  uint32_t decodedEvents;
+  uint32_t droppedEnds;   // Ends with no matching begin.
+  uint32_t unclosedBegins; // Begins still open at the end.
+  uint32_t droppedAfterGaps;
+} decodeStats_t;
+
+static char names[MAX_IDS][TRACE_MAX_NAME_BYTES];
+static uint32_t nameCount;
+static uint32_t ticksPerSecond;
+static bool haveHeader;
+static event_t *events;
+static uint32_t eventCount;
+static uint32_t eventCapacity;
+
+static uint32_t getLittleEndian(const uint8_t *data, uint16_t byteCount) {
+  uint32_t value = 0;
+  for (uint16_t i = 0; i < byteCount; i++)
+    value |= (uint32_t)data[i] << (i * 8);
+  return value;
+}
+
+// Reads all of input into a malloc'd buffer.
+static uint8_t *readAll(FILE *input, size_t *length) {
+  size_t capacity = READ_CHUNK_BYTES;
+  uint8_t *data = malloc(capacity);
+  *length = 0;
+  while (data) {
+    size_t n = fread(data + *length, 1, capacity - *length, input);
+    *length += n;
+    if (*length < capacity)
+      break;
+    capacity *= 2;
+    uint8_t *bigger = realloc(data, capacity);
+    if (!bigger)
+      free(data);
+    data = bigger;
+  }
+  return data;
+}
+
+static bool isSync(const uint8_t *data) {
+  return getLittleEndian(data, TRACE_SYNC_BYTES) == TRACE_SYNC_WORD;
+}
+
+static void readHeader(const uint8_t *payload, uint32_t length,
+                       decodeStats_t *stats) {
+  ticksPerSecond = getLittleEndian(&payload[HEADER_TICKS_OFFSET], 4);
+  stats->recordedEvents = getLittleEndian(&payload[HEADER_RECORDED_OFFSET], 4);
+  stats->dumpedEvents = getLittleEndian(&payload[HEADER_DUMPED_OFFSET], 4);
+  uint32_t idCount = payload[HEADER_ID_COUNT_OFFSET];
+  uint32_t offset = HEADER_NAMES_OFFSET;
+  for (nameCount = 0; nameCount < idCount && offset < length; nameCount++) {
+    uint32_t nameLength = strnlen((const char *)&payload[offset],
+                                  length - offset);
+    snprintf(names[nameCount], TRACE_MAX_NAME_BYTES, "%.*s",
+             (int)nameLength, &payload[offset]);
+    offset += nameLength + 1;
+  }
+  haveHeader = true;
+}
+
+static bool addEvent(const event_t *event) {
+  if (eventCount == eventCapacity) {
+    eventCapacity = eventCapacity ? eventCapacity * 2 : READ_CHUNK_BYTES;
+    event_t *bigger = realloc(events, eventCapacity * sizeof(event_t));
+    if (!bigger)
+      return false;
+    events = bigger;
+  }
+  events[eventCount++] = *event;
+  return true;
+}
+
+// Unwraps the 32-bit timestamps in the order the events were recorded. An
+// event can be a little older than the one before it (the ISR recorded in
+// between reading the clock and claiming a slot), so steps are signed.
+static void readEvents(const uint8_t *payload, uint32_t length, bool gap,
+                       uint64_t *ticks, uint32_t *lastTimestamp) {
+  for (uint32_t offset = 0; offset + TRACE_EVENT_BYTES <= length;
+       offset += TRACE_EVENT_BYTES) {
+    uint32_t timestamp = getLittleEndian(&payload[offset], 4);
+    if (eventCount == 0)
+      *ticks = timestamp;
+    else
+      *ticks += (int32_t)(timestamp - *lastTimestamp);
+    *lastTimestamp = timestamp;
+    event_t event = {.ticks = *ticks,
+                     .order = eventCount,
+                     .id = payload[offset + 4],
+                     .flags = payload[offset + 5],
+                     .arg = getLittleEndian(&payload[offset + 6], 2),
+                     .gapBefore = gap && offset == 0};
+    if (!addEvent(&event)) {
+      fprintf(stderr, "ERROR: out of memory.\n");
+      exit(-1);
+    }
+  }
+}
+
+// Decodes every good frame in data[0..length) into events.
+static void decode(const uint8_t *data, size_t length, decodeStats_t *stats) {
+  uint32_t expectedSequence = 0;
+  uint64_t ticks = 0;
+  uint32_t lastTimestamp = 0;
+  size_t i = 0;
+  while (i + TRACE_FRAME_HEADER_BYTES <= length) {
+    if (!isSync(&data[i])) {
+      stats->skippedBytes++;
+      i++;
+      continue;
+    }
+    const uint8_t *frame = &data[i];
+    uint32_t payloadLength = getLittleEndian(&frame[FRAME_LENGTH_OFFSET], 2);
+    uint8_t type = frame[FRAME_TYPE_OFFSET];
+    if (frame[FRAME_VERSION_OFFSET] != TRACE_FORMAT_VERSION ||
+        (type != TRACE_HEADER_FRAME && type != TRACE_EVENTS_FRAME) ||
+        payloadLength > MAX_PAYLOAD_BYTES) {
+      stats->badHeaders++;
+      stats->skippedBytes++;
+      i++;
+      continue;
+    }
+    size_t payloadEnd = TRACE_FRAME_HEADER_BYTES + payloadLength;
+    size_t frameLength = payloadEnd + TRACE_FRAME_CRC_BYTES;
+    if (i + frameLength > length)
+      break; // Truncated at the end of the stream.
+    uint16_t crc = crc16_compute(&frame[TRACE_SYNC_BYTES],
+                                 payloadEnd - TRACE_SYNC_BYTES);
+    if (crc != getLittleEndian(&frame[payloadEnd], TRACE_FRAME_CRC_BYTES)) {
+      stats->crcErrors++;
+      stats->skippedBytes++;
+      i++;
+      continue;
+    }
+
+    const uint8_t *payload = &frame[TRACE_FRAME_HEADER_BYTES];
+    uint32_t sequence = getLittleEndian(&frame[FRAME_SEQUENCE_OFFSET], 4);
+    if (type == TRACE_HEADER_FRAME) {
+      // A new dump: keep only the last one in the stream.
+      eventCount = 0;
+      expectedSequence = 1;
+      stats->missingFrames = 0;
+      readHeader(payload, payloadLength, stats);
+    } else if (haveHeader && sequence >= expectedSequence) {
+      stats->missingFrames += sequence - expectedSequence;
+      readEvents(payload, payloadLength, sequence != expectedSequence, &ticks,
+                 &lastTimestamp);
+      expectedSequence = sequence + 1;
+    }
+    stats->frames++;
+    i += frameLength;
+  }
+  stats->skippedBytes += length - i;
+}
+
+static int compareEvents(const void *a, const void *b) {
+  const event_t *x = a, *y = b;
+  if (x->ticks != y->ticks)
+    return x->ticks < y->ticks ? -1 : 1;
+  return x->order < y->order ? -1 : x->order > y->order;
+}
+
+static const char *eventName(uint8_t id) {
+  static char unknown[TRACE_MAX_NAME_BYTES];
+  if (id < nameCount)
+    return names[id];
+  snprintf(unknown, sizeof(unknown), "id%u", id);
+  return unknown;
+}
+
+// Writes the events as JSON, leaving out ends that match no begin and, after
+// a gap, everything on a thread until it is back at the top level.
+static void writeJson(FILE *out, decodeStats_t *stats) {
+  uint8_t stacks[THREAD_COUNT][MAX_DEPTH];
+  uint32_t depths[THREAD_COUNT] = {0};
+  bool resyncing[THREAD_COUNT] = {false};
+  uint64_t firstTicks = eventCount ? events[0].ticks : 0;
+  fprintf(out, "{\"displayTimeUnit\": \"ns\", \"traceEvents\": [\n");
+  fprintf(out, "{\"name\": \"process_name\", \"ph\": \"M\", \"pid\": 1, "
+               "\"args\": {\"name\": \"lasertag\"}},\n");
+  fprintf(out, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+               "\"tid\": %d, \"args\": {\"name\": \"main\"}},\n", MAIN_TID);
+  fprintf(out, "{\"name\": \"thread_name\", \"ph\": \"M\", \"pid\": 1, "
+               "\"tid\": %d, \"args\": {\"name\": \"ISR\"}}", ISR_TID);
+  for (uint32_t i = 0; i < eventCount; i++) {
+    const event_t *event = &events[i];
+    uint32_t thread = (event->flags & TRACE_FLAG_ISR) ? 1 : 0;
+    uint8_t phase = event->flags & TRACE_PHASE_MASK;
+    if (event->gapBefore)
+      for (uint32_t t = 0; t < THREAD_COUNT; t++)
+        resyncing[t] = depths[t] > 0;
+    if (resyncing[thread]) {
+      // Wait for this thread's open scopes to close, unseen.
+      stats->droppedAfterGaps++;
+      if (phase == TRACE_PHASE_END && depths[thread] > 0 &&
+          --depths[thread] == 0)
+        resyncing[thread] = false;
+      else if (phase == TRACE_PHASE_BEGIN && depths[thread] < MAX_DEPTH)
+        stacks[thread][depths[thread]++] = event->id;
+      continue;
+    }
+    if (phase == TRACE_PHASE_END) {
+      if (depths[thread] == 0 ||
+          stacks[thread][depths[thread] - 1] != event->id) {
+        stats->droppedEnds++;
+        continue;
+      }
+      depths[thread]--;
+    } else if (phase == TRACE_PHASE_BEGIN) {
+      if (depths[thread] == MAX_DEPTH) {
+        stats->droppedEnds++; // Its end will not match.
+        continue;
+      }
+      stacks[thread][depths[thread]++] = event->id;
+    }
+    double us = (double)(event->ticks - firstTicks) / ticksPerSecond *
+                US_PER_SECOND;
+    fprintf(out,
+            ",\n{\"name\": \"%s\", \"ph\": \"%s\", \"ts\": %.3f, "
+            "\"pid\": 1, \"tid\": %d, \"args\": {\"arg\": %u}}",
+            eventName(event->id),
+            phase == TRACE_PHASE_BEGIN ? "B"
+            : phase == TRACE_PHASE_END ? "E"
+                                       : "i\", \"s\": \"t",
+            us, thread ? ISR_TID : MAIN_TID, event->arg);
+    stats->decodedEvents++;
+  }
+  fprintf(out, "\n]}\n");
+  for (uint32_t t = 0; t < THREAD_COUNT; t++)
+    stats->unclosedBegins += resyncing[t] ? 0 : depths[t];
+}
+
+int main(int argc, char *argv[]) {
+  const char *outputName = NULL;
+  int opt;
+  while ((opt = getopt(argc, argv, "o:")) != -1) {
+    switch (opt) {
+    case 'o':
+      outputName = optarg;
+      break;
+    default:
+      outputName = NULL;
+      optind = argc + 1;
+      break;
+    }
+  }
+  if (!outputName || optind + 1 < argc) {
+    fprintf(stderr, "Usage: %s -o out.json [capture.bin]\n", argv[0]);
+    exit(-1);
+  }
+
+  FILE *input = stdin;
+  if (optind < argc && !(input = fopen(argv[optind], "rb"))) {
+    fprintf(stderr, "ERROR: cannot open %s.\n", argv[optind]);
+    exit(-1);
+  }
+  size_t length;
+  uint8_t *data = readAll(input, &length);
+  if (!data) {
+    fprintf(stderr, "ERROR: unable to allocate input buffer.\n");
+    exit(-1);
+  }
+  decodeStats_t stats;
+  memset(&stats, 0, sizeof(stats));
+  decode(data, length, &stats);
+  free(data);
+  if (!haveHeader || ticksPerSecond == 0) {
+    fprintf(stderr, "ERROR: no trace header found.\n");
+    exit(-1);
+  }
+  qsort(events, eventCount, sizeof(event_t), compareEvents);
+
+  FILE *out = fopen(outputName, "w");
+  if (!out) {
+    fprintf(stderr, "ERROR: cannot create %s.\n", outputName);
+    exit(-1);
+  }
+  writeJson(out, &stats);
+  fclose(out);
+  double seconds = eventCount ? (double)(events[eventCount - 1].ticks -
+                                         events[0].ticks) /
+                                    ticksPerSecond
+                              : 0.0;
+  free(events);
+
+  fprintf(stderr,
+          "%u frames, %u of %u recorded events dumped, %u written "
+          "(%.6f s), %u missing frames, %u ends without a begin, "
+          "%u dropped after gaps, %u begins left open, %u CRC errors, "
+          "%u bad headers, %u bytes skipped.\n",
+          stats.frames, stats.dumpedEvents, stats.recordedEvents,
+          stats.decodedEvents, seconds, stats.missingFrames,
+          stats.droppedEnds, stats.droppedAfterGaps, stats.unclosedBegins,
+          stats.crcErrors, stats.badHeaders, stats.skippedBytes);
+  return 0;
+}
@@ -0,0 +1,271 @@
+// Runs the continuous-mode main loop (runningModes_continuous()) on the host
+// in simulated time, to see how redrawing the histogram holds up the
+// detector. The 100 kHz ISR is pipelineSim_tick() with noise as input, and
+// the real detector, filter and histogram code runs against the TFT stand-in
+// in displayHost.c. Each detector() call costs -d nanoseconds per sample it
+// processes plus -l microseconds of loop overhead, and drawing costs the time
+// the bytes the TFT driver would send take on a bus moving -b bytes a second.
+// Samples keep arriving while either is going on.
+//
+// The loop is run twice: redrawing the whole histogram every 30000 passes, as
+// continuous mode used to, and with support/uiScheduler.c pacing frames by
+// time and drawing 16 rows of bar per chunk in slices while the backlog is
+// low. The tool reports the ADC backlog and the frame rate for each. A JSON
+// summary is printed on stdout and the exit status is non-zero if the
+// scheduled loop lets the backlog reach SUGGESTED_REMAINING_ELEMENT_COUNT or
+// falls well short of its frame rate.
+//
+// Build from lasertag/tools:
+//   gcc -O2 -I. -I.. -I../support -I../../include -I../../drivers
+//       -I../../platforms/zybo/xil_arm_toolchain/bsp/ps7_cortexa9_0/include
+//       -I../../platforms/host uiSchedulerSim.c pipelineSim.c
+//       ../../platforms/host/interrupts.c ../../platforms/host/display.c
+//       ../support/uiScheduler.c ../support/histogram.c
+//       ../support/framebuffer.c ../support/textRenderer.c
+//       ../support/displayFont.c ../support/format.c ../support/profiler.c
+//       ../detector.c ../filter.c ../queue.c ../buffer.c -pthread
+//       -lm -o uiSchedulerSim
+// Usage: uiSchedulerSim [-s seconds] [-d detectorNsPerSample]
+//                       [-l loopOverheadUs] [-b busBytesPerSecond]
+
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <unistd.h>
+
+#include "buffer.h"
+#include "detector.h"
+#include "displayHost.h"
+#include "filter.h"
+#include "histogram.h"
+#include "pipelineSim.h"
+#include "uiScheduler.h"
+
+#define SAMPLE_RATE_HZ (FILTER_SAMPLE_FREQUENCY_IN_KHZ * 1000)
+#define DEFAULT_SECONDS 10.0
+#define DEFAULT_DETECTOR_NS_PER_SAMPLE 3000.0
+#define DEFAULT_LOOP_OVERHEAD_US 5.0
+#define DEFAULT_BUS_BYTES_PER_SECOND 2.0e6
+#define NOISE_SIGMA 100.0
+#define SEED 43
+#define UNDRAWN_COLOR 0x1234
+#define NS_PER_SECOND 1e9
+#define US_PER_SECOND 1e6
+
+// As in runningModes.c.
+#define SYSTEM_TICKS_PER_HISTOGRAM_UPDATE 30000
+#define SUGGESTED_REMAINING_ELEMENT_COUNT 500
+#define RUNNING_MODE_UI_FRAME_SECONDS (1.0 / 3)
+#define RUNNING_MODE_UI_SLICE_SECONDS 0.002
+#define RUNNING_MODE_UI_MAX_BACKLOG (SUGGESTED_REMAINING_ELEMENT_COUNT / 4)
+#define RUNNING_MODE_UI_ROWS_PER_CHUNK 16
+
+// Slowest acceptable scheduled frame rate, as a fraction of the target.
+#define MIN_FRAME_RATE_FRACTION 0.9
+
+static double detectorSecondsPerSample = DEFAULT_DETECTOR_NS_PER_SAMPLE /
+                                         NS_PER_SECOND;
+static double loopOverheadSeconds = DEFAULT_LOOP_OVERHEAD_US / US_PER_SECOND;
+static double busBytesPerSecond = DEFAULT_BUS_BYTES_PER_SECOND;
+
+static double now;          // Simulated time.
+static uint64_t produced;   // Samples the ISR has pushed.
+static uint32_t maxBacklog; // Largest ADC backlog seen.
+static double backlogSum;   // For the mean backlog at each detector() call.
+static uint32_t detectorCalls;
+static bool overflowed;
+
+// histogram.c only calls this from histogram_runTest().
+void utils_msDelay(long ms) { (void)ms; }
+
+// Moves simulated time forward, with the ISR pushing the samples that fall
+// due.
+static void advance(double seconds) {
+  now += seconds;
+  uint64_t due = (uint64_t)(now * SAMPLE_RATE_HZ);
+  for (; produced < due; produced++) {
+    if (buffer_elements() == buffer_size())
+      overflowed = true;
+    pipelineSim_tick(
+        pipelineSim_toAdcValue(NOISE_SIGMA * pipelineSim_gaussian()));
+    if (buffer_elements() > maxBacklog)
+      maxBacklog = buffer_elements();
+  }
+}
+
+// Charges the time the TFT took for what was drawn since the last call.
+static void chargeDrawing(void) {
+  static uint64_t chargedBytes;
+  uint64_t busBytes = displayHost_getBusBytes();
+  if (busBytes < chargedBytes)
+    chargedBytes = 0; // displayHost_init() started the count again.
+  advance((busBytes - chargedBytes) / busBytesPerSecond);
+  chargedBytes = busBytes;
+}
+
+// One pass of the main loop up to and including detector().
+static void runDetector(void) {
+  uint32_t backlog = buffer_elements();
+  backlogSum += backlog;
+  detectorCalls++;
+  detector(true);
+  advance(loopOverheadSeconds + backlog * detectorSecondsPerSample);
+}
+
+static double simClock(void) { return now; }
+
+static void beginHistogramFrame(void) {
+  double powerValues[FILTER_FREQUENCY_COUNT];
+  filter_getCurrentPowerValues(powerValues);
+  histogram_setUserFrequencyPower(powerValues);
+}
+
+static bool drawHistogramChunk(void) {
+  bool done = histogram_updateDisplayStep(RUNNING_MODE_UI_ROWS_PER_CHUNK);
+  chargeDrawing();
+  return done;
+}
+
+static const uiScheduler_config_t histogramUi = {
+    .periodSeconds = RUNNING_MODE_UI_FRAME_SECONDS,
+    .sliceSeconds = RUNNING_MODE_UI_SLICE_SECONDS,
+    .maxBacklog = RUNNING_MODE_UI_MAX_BACKLOG,
+    .clock = simClock,
+    .beginFrame = beginHistogramFrame,
+    .drawChunk = drawHistogramChunk};
+
+typedef struct {
+  uint32_t frames;
+  double framesPerSecond;
+  uint32_t maxBacklog;
+  double meanBacklog;
+  double maxFrameSeconds;
+  bool overflowed;
+} result_t;
+
+// Clears the screen and the pipeline. The time histogram_init() takes is not
+// counted.
+static void start(void) {
+  displayHost_init(UNDRAWN_COLOR);
+  histogram_init(FILTER_FREQUENCY_COUNT);
+  chargeDrawing();
+  pipelineSim_init();
+  pipelineSim_seedRandom(SEED);
+  now = 0.0;
+  produced = 0;
+  maxBacklog = 0;
+  backlogSum = 0.0;
+  detectorCalls = 0;
+  overflowed = false;
+}
+
+static void finish(result_t *result) {
+  result->maxBacklog = maxBacklog;
+  result->meanBacklog = detectorCalls ? backlogSum / detectorCalls : 0.0;
+  result->overflowed = overflowed;
+}
+
+// The loop as it was: a whole frame every SYSTEM_TICKS_PER_HISTOGRAM_UPDATE
+// passes.
+static void runTickPaced(double seconds, result_t *result) {
+  uint32_t ticks = 0;
+  double lastFrameEnd = 0.0;
+  start();
+  result->frames = 0;
+  result->maxFrameSeconds = 0.0;
+  while (now < seconds) {
+    runDetector();
+    if (++ticks < SYSTEM_TICKS_PER_HISTOGRAM_UPDATE)
+      continue;
+    double frameStart = now;
+    beginHistogramFrame();
+    histogram_updateDisplay();
+    chargeDrawing();
+    if (now - frameStart > result->maxFrameSeconds)
+      result->maxFrameSeconds = now - frameStart;
+    result->frames++;
+    lastFrameEnd = now;
+    ticks = 0;
+  }
+  finish(result);
+  result->framesPerSecond = lastFrameEnd > 0.0 ? result->frames / lastFrameEnd
+                                               : 0.0;
+}
+
+static void runScheduled(double seconds, result_t *result) {
+  start();
+  uiScheduler_init(&histogramUi);
+  while (now < seconds) {
+    runDetector();
+    uiScheduler_service(buffer_elements());
+  }
+  finish(result);
+  const uiScheduler_stats_t *stats = uiScheduler_getStats();
+  result->frames = stats->frames;
+  result->framesPerSecond = uiScheduler_getFramesPerSecond();
+  result->maxFrameSeconds = stats->maxFrameSeconds;
+}
+
+static void printResult(const char *name, const result_t *result) {
+  printf("\"%s\": {\"frames\": %u, \"framesPerSecond\": %.2f, "
+         "\"maxFrameMs\": %.1f, \"maxBacklog\": %u, \"meanBacklog\": %.1f, "
+         "\"overflowed\": %s}",
+         name, result->frames, result->framesPerSecond,
+         result->maxFrameSeconds * 1000.0, result->maxBacklog,
+         result->meanBacklog, result->overflowed ? "true" : "false");
+}
+
+int main(int argc, char *argv[]) {
+  double seconds = DEFAULT_SECONDS;
+  int opt;
+  while ((opt = getopt(argc, argv, "s:d:l:b:")) != -1) {
+    switch (opt) {
+    case 's':
+      seconds = atof(optarg);
+      break;
+    case 'd':
+      detectorSecondsPerSample = atof(optarg) / NS_PER_SECOND;
+      break;
+    case 'l':
+      loopOverheadSeconds = atof(optarg) / US_PER_SECOND;
+      break;
+    case 'b':
+      busBytesPerSecond = atof(optarg);
+      break;
+    default:
+      seconds = 0.0;
+      break;
+    }
+  }
+  if (seconds <= 0.0 || detectorSecondsPerSample < 0.0 ||
+      loopOverheadSeconds <= 0.0 || busBytesPerSecond <= 0.0) {
+    fprintf(stderr,
+            "Usage: %s [-s seconds] [-d detectorNsPerSample] "
+            "[-l loopOverheadUs] [-b busBytesPerSecond]\n",
+            argv[0]);
+    exit(-1);
+  }
+
+  result_t tickPaced, scheduled;
+  runTickPaced(seconds, &tickPaced);
+  runScheduled(seconds, &scheduled);
+  const uiScheduler_stats_t *stats = uiScheduler_getStats();
+  bool passed = scheduled.maxBacklog < SUGGESTED_REMAINING_ELEMENT_COUNT &&
+                !scheduled.overflowed &&
+                scheduled.framesPerSecond >=
+                    MIN_FRAME_RATE_FRACTION / RUNNING_MODE_UI_FRAME_SECONDS;
+
+  printf("{\"seconds\": %g, \"detectorNsPerSample\": %g, "
+         "\"loopOverheadUs\": %g, \"busBytesPerSecond\": %g, ",
+         seconds, detectorSecondsPerSample * NS_PER_SECOND,
+         loopOverheadSeconds * US_PER_SECOND, busBytesPerSecond);
+  printResult("tickPaced", &tickPaced);
+  printf(", ");
+  printResult("scheduled", &scheduled);
+  printf(", \"chunks\": %u, \"deferrals\": %u, \"maxSliceMs\": %.2f, "
+         "\"passed\": %s}\n",
+         stats->chunks, stats->deferrals, stats->maxSliceSeconds * 1000.0,
+         passed ? "true" : "false");
+  return passed ? 0 : -1;
+}
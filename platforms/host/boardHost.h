@@ -0,0 +1,33 @@
+#ifndef BOARDHOST_H_
+#define BOARDHOST_H_
+
+#include <stdint.h>
+
+// Host-side state behind buttons.h, switches.h and leds.h, and the ADC
+// behind interrupts_getAdcData(), for simulations to drive and check. MIO
+// pins read back what was written. See displayHost.h for the TFT and
+// interrupts.c here for the timer tick.
+
+// Mid-scale, which the detector scales to 0.0: what a quiet input reads.
+#define BOARD_HOST_ADC_MIDSCALE 2048
+
+// Returns the next ADC conversion; called by interrupts_getAdcData().
+typedef uint32_t (*boardHost_adcSource_t)(void);
+
+// Sets what buttons_read() returns (BUTTONS_BTN*_MASK bits).
+void boardHost_setButtons(int32_t buttons);
+
+// Sets what switches_read() returns (SWITCHES_SW*_MASK bits).
+void boardHost_setSwitches(int32_t switches);
+
+// Returns the value last written to LD3..LD0 with leds_write().
+int boardHost_getLeds(void);
+
+// Returns the value last written to LD4 with leds_writeLd4().
+int boardHost_getLd4(void);
+
+// Sets where interrupts_getAdcData() gets its samples; NULL for a constant
+// BOARD_HOST_ADC_MIDSCALE.
+void boardHost_setAdcSource(boardHost_adcSource_t source);
+
+#endif /* BOARDHOST_H_ */
@@ -0,0 +1,16 @@
+#include <stdint.h>
+
+#include "boardHost.h"
+#include "buttons.h"
+
+static volatile int32_t buttons;
+
+int32_t buttons_init() { return BUTTONS_INIT_STATUS_OK; }
+
+int32_t buttons_read() { return buttons; }
+
+// Nobody is there to press them.
+void buttons_runTest() {}
+
+// Sets what buttons_read() returns (BUTTONS_BTN*_MASK bits).
+void boardHost_setButtons(int32_t value) { buttons = value; }
@@ -0,0 +1,400 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+#include "display.h"
+#include "displayFont.h"
+#include "displayHost.h"
+
+#define DECIMAL_INT_CHARS 12 // "-2147483648" and the NUL.
+
+// Rows of width pixels each; the two always multiply to DISPLAY_WIDTH *
+// DISPLAY_HEIGHT, so a rotation just reshapes the rows.
+static display_pixel_t screen[DISPLAY_WIDTH * DISPLAY_HEIGHT];
+static int16_t width = DISPLAY_WIDTH, height = DISPLAY_HEIGHT;
+static displayHost_stats_t stats;
+static int16_t cursorX, cursorY;
+static uint16_t textColor, textBgColor;
+static uint8_t textSize;
+static bool textWrap;
+
+// Sets every pixel to color and clears the statistics and the text settings.
+void displayHost_init(uint16_t color) {
+  for (int32_t i = 0; i < DISPLAY_WIDTH * DISPLAY_HEIGHT; i++)
+    screen[i] = color;
+  memset(&stats, 0, sizeof(stats));
+  cursorX = cursorY = 0;
+  textColor = textBgColor = DISPLAY_WHITE;
+  textSize = 1;
+  textWrap = true;
+}
+
+// Returns the rows of the screen, display_width() pixels each.
+const display_pixel_t *displayHost_getPixels(void) { return screen; }
+
+// Returns the statistics since displayHost_init().
+const displayHost_stats_t *displayHost_getStats(void) { return &stats; }
+
+// Bytes the transfers so far would have put on the bus.
+uint64_t displayHost_getBusBytes(void) {
+  return (uint64_t)stats.transfers * DISPLAY_HOST_TRANSFER_OVERHEAD_BYTES +
+         (uint64_t)stats.pixels * DISPLAY_HOST_BYTES_PER_PIXEL;
+}
+
+// The screen starts black, in landscape with the origin upper left.
+void display_init() {
+  width = DISPLAY_WIDTH;
+  height = DISPLAY_HEIGHT;
+  displayHost_init(DISPLAY_BLACK);
+}
+
+// Everything is drawn with this. A rectangle with no pixels on the screen is
+// not sent.
+void display_fillRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                      uint16_t color) {
+  int32_t left = x < 0 ? 0 : x, top = y < 0 ? 0 : y;
+  int32_t right = (int32_t)x + w, bottom = (int32_t)y + h;
+  if (right > width)
+    right = width;
+  if (bottom > height)
+    bottom = height;
+  if (right <= left || bottom <= top)
+    return;
+  for (int32_t row = top; row < bottom; row++)
+    for (int32_t column = left; column < right; column++)
+      screen[row * width + column] = color;
+  stats.transfers++;
+  stats.pixels += (right - left) * (bottom - top);
+}
+
+void display_drawPixel(int16_t x, int16_t y, uint16_t color) {
+  display_fillRect(x, y, 1, 1, color);
+}
+
+void display_drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  display_fillRect(x, y, w, 1, color);
+}
+
+void display_drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  display_fillRect(x, y, 1, h, color);
+}
+
+// Straight lines are one transfer; others a pixel at a time, as the driver
+// draws them (Bresenham).
+void display_drawLine(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                      uint16_t color) {
+  if (y0 == y1) {
+    display_drawFastHLine(x0 < x1 ? x0 : x1, y0, abs(x1 - x0) + 1, color);
+    return;
+  }
+  if (x0 == x1) {
+    display_drawFastVLine(x0, y0 < y1 ? y0 : y1, abs(y1 - y0) + 1, color);
+    return;
+  }
+  int16_t dx = abs(x1 - x0), dy = -abs(y1 - y0);
+  int16_t stepX = x0 < x1 ? 1 : -1, stepY = y0 < y1 ? 1 : -1;
+  int32_t error = dx + dy;
+  while (true) {
+    display_drawPixel(x0, y0, color);
+    if (x0 == x1 && y0 == y1)
+      break;
+    int32_t doubled = 2 * error;
+    if (doubled >= dy) {
+      error += dy;
+      x0 += stepX;
+    }
+    if (doubled <= dx) {
+      error += dx;
+      y0 += stepY;
+    }
+  }
+}
+
+void display_drawRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                      uint16_t color) {
+  display_drawFastHLine(x, y, w, color);
+  display_drawFastHLine(x, y + h - 1, w, color);
+  display_drawFastVLine(x, y, h, color);
+  display_drawFastVLine(x + w - 1, y, h, color);
+}
+
+void display_fillScreen(uint16_t color) {
+  display_fillRect(0, 0, width, height, color);
+}
+
+// The colors on the screen are what was drawn, so there is nothing to invert.
+void display_invertDisplay(bool i) { (void)i; }
+
+// Draws the parts of a circle outline in the quadrants set in corners: 1
+// upper left, 2 upper right, 4 lower right, 8 lower left.
+static void drawCircleCorners(int16_t x0, int16_t y0, int16_t r,
+                              uint8_t corners, uint16_t color) {
+  int16_t f = 1 - r, ddFx = 1, ddFy = -2 * r, x = 0, y = r;
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddFy += 2;
+      f += ddFy;
+    }
+    x++;
+    ddFx += 2;
+    f += ddFx;
+    if (corners & 0x4) {
+      display_drawPixel(x0 + x, y0 + y, color);
+      display_drawPixel(x0 + y, y0 + x, color);
+    }
+    if (corners & 0x2) {
+      display_drawPixel(x0 + x, y0 - y, color);
+      display_drawPixel(x0 + y, y0 - x, color);
+    }
+    if (corners & 0x8) {
+      display_drawPixel(x0 - y, y0 + x, color);
+      display_drawPixel(x0 - x, y0 + y, color);
+    }
+    if (corners & 0x1) {
+      display_drawPixel(x0 - y, y0 - x, color);
+      display_drawPixel(x0 - x, y0 - y, color);
+    }
+  }
+}
+
+// Fills the right (sides bit 0) and left (bit 1) halves of a circle with
+// vertical lines, stretched down by delta for rounded rectangles.
+static void fillCircleSides(int16_t x0, int16_t y0, int16_t r, uint8_t sides,
+                            int16_t delta, uint16_t color) {
+  int16_t f = 1 - r, ddFx = 1, ddFy = -2 * r, x = 0, y = r;
+  while (x < y) {
+    if (f >= 0) {
+      y--;
+      ddFy += 2;
+      f += ddFy;
+    }
+    x++;
+    ddFx += 2;
+    f += ddFx;
+    if (sides & 0x1) {
+      display_drawFastVLine(x0 + x, y0 - y, 2 * y + 1 + delta, color);
+      display_drawFastVLine(x0 + y, y0 - x, 2 * x + 1 + delta, color);
+    }
+    if (sides & 0x2) {
+      display_drawFastVLine(x0 - x, y0 - y, 2 * y + 1 + delta, color);
+      display_drawFastVLine(x0 - y, y0 - x, 2 * x + 1 + delta, color);
+    }
+  }
+}
+
+void display_drawCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+  display_drawPixel(x0, y0 + r, color);
+  display_drawPixel(x0, y0 - r, color);
+  display_drawPixel(x0 + r, y0, color);
+  display_drawPixel(x0 - r, y0, color);
+  drawCircleCorners(x0, y0, r, 0xF, color);
+}
+
+void display_fillCircle(int16_t x0, int16_t y0, int16_t r, uint16_t color) {
+  display_drawFastVLine(x0, y0 - r, 2 * r + 1, color);
+  fillCircleSides(x0, y0, r, 0x3, 0, color);
+}
+
+void display_drawTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                          int16_t x2, int16_t y2, uint16_t color) {
+  display_drawLine(x0, y0, x1, y1, color);
+  display_drawLine(x1, y1, x2, y2, color);
+  display_drawLine(x2, y2, x0, y0, color);
+}
+
+static void swap16(int16_t *a, int16_t *b) {
+  int16_t t = *a;
+  *a = *b;
+  *b = t;
+}
+
+// Fills a row at a time between the edges, with the vertices sorted by y.
+void display_fillTriangle(int16_t x0, int16_t y0, int16_t x1, int16_t y1,
+                          int16_t x2, int16_t y2, uint16_t color) {
+  if (y0 > y1) {
+    swap16(&y0, &y1);
+    swap16(&x0, &x1);
+  }
+  if (y1 > y2) {
+    swap16(&y2, &y1);
+    swap16(&x2, &x1);
+  }
+  if (y0 > y1) {
+    swap16(&y0, &y1);
+    swap16(&x0, &x1);
+  }
+  if (y0 == y2) { // All on one row.
+    int16_t left = x0, right = x0;
+    left = x1 < left ? x1 : left;
+    left = x2 < left ? x2 : left;
+    right = x1 > right ? x1 : right;
+    right = x2 > right ? x2 : right;
+    display_drawFastHLine(left, y0, right - left + 1, color);
+    return;
+  }
+  for (int16_t y = y0; y <= y2; y++) {
+    // The long edge 0-2, and 0-1 or 1-2 depending on the half.
+    int16_t a = x0 + (int32_t)(x2 - x0) * (y - y0) / (y2 - y0);
+    int16_t b = y < y1 || y1 == y2
+                    ? (y1 == y0 ? x1
+                                : x0 + (int32_t)(x1 - x0) * (y - y0) /
+                                           (y1 - y0))
+                    : x1 + (int32_t)(x2 - x1) * (y - y1) / (y2 - y1);
+    if (a > b)
+      swap16(&a, &b);
+    display_drawFastHLine(a, y, b - a + 1, color);
+  }
+}
+
+void display_drawRoundRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                           int16_t r, uint16_t color) {
+  display_drawFastHLine(x + r, y, w - 2 * r, color);
+  display_drawFastHLine(x + r, y + h - 1, w - 2 * r, color);
+  display_drawFastVLine(x, y + r, h - 2 * r, color);
+  display_drawFastVLine(x + w - 1, y + r, h - 2 * r, color);
+  drawCircleCorners(x + r, y + r, r, 0x1, color);
+  drawCircleCorners(x + w - r - 1, y + r, r, 0x2, color);
+  drawCircleCorners(x + w - r - 1, y + h - r - 1, r, 0x4, color);
+  drawCircleCorners(x + r, y + h - r - 1, r, 0x8, color);
+}
+
+void display_fillRoundRect(int16_t x, int16_t y, int16_t w, int16_t h,
+                           int16_t r, uint16_t color) {
+  display_fillRect(x + r, y, w - 2 * r, h, color);
+  fillCircleSides(x + w - r - 1, y + r, r, 0x1, h - 2 * r - 1, color);
+  fillCircleSides(x + r, y + r, r, 0x2, h - 2 * r - 1, color);
+}
+
+// bitmap is rows of w bits, most significant bit first, each row padded to a
+// whole byte. Only the set bits are drawn.
+void display_drawBitmap(int16_t x, int16_t y, const uint8_t *bitmap, int16_t w,
+                        int16_t h, uint16_t color) {
+  int16_t rowBytes = (w + 7) / 8;
+  for (int16_t j = 0; j < h; j++)
+    for (int16_t i = 0; i < w; i++)
+      if (bitmap[j * rowBytes + i / 8] & (0x80 >> (i % 8)))
+        display_drawPixel(x + i, y + j, color);
+}
+
+void display_drawChar(int16_t x, int16_t y, unsigned char c, uint16_t color,
+                      uint16_t bg, uint8_t size) {
+  const uint8_t *glyph = displayFont_getGlyph(c);
+  for (int16_t i = 0; i < DISPLAY_CHAR_WIDTH; i++) {
+    uint8_t line = (i < DISPLAY_FONT_GLYPH_COLUMNS) ? glyph[i] : 0;
+    for (int16_t j = 0; j < DISPLAY_CHAR_HEIGHT; j++, line >>= 1) {
+      if (line & 1)
+        display_fillRect(x + i * size, y + j * size, size, size, color);
+      else if (bg != color)
+        display_fillRect(x + i * size, y + j * size, size, size, bg);
+    }
+  }
+}
+
+void display_setCursor(int16_t x, int16_t y) {
+  cursorX = x;
+  cursorY = y;
+}
+
+void display_setTextColor(uint16_t c) { textColor = textBgColor = c; }
+
+void display_setTextColorBg(uint16_t c, uint16_t bg) {
+  textColor = c;
+  textBgColor = bg;
+}
+
+void display_setTextSize(uint8_t s) { textSize = s ? s : 1; }
+
+void display_setTextWrap(bool w) { textWrap = w; }
+
+// Portrait rotations swap the width and the height; what is on the screen is
+// not turned.
+void display_setRotation(uint8_t r) {
+  bool landscape = (r & 1) != 0;
+  width = landscape ? DISPLAY_WIDTH : DISPLAY_HEIGHT;
+  height = landscape ? DISPLAY_HEIGHT : DISPLAY_WIDTH;
+}
+
+int16_t display_width() { return width; }
+
+int16_t display_height() { return height; }
+
+uint16_t display_color565(uint8_t r, uint8_t g, uint8_t b) {
+  return ((r & 0xF8) << 8) | ((g & 0xFC) << 3) | (b >> 3);
+}
+
+size_t display_printChar(char c) {
+  if (c == '\n') {
+    cursorY += textSize * DISPLAY_CHAR_HEIGHT;
+    cursorX = 0;
+  } else if (c != '\r') {
+    display_drawChar(cursorX, cursorY, c, textColor, textBgColor, textSize);
+    cursorX += textSize * DISPLAY_CHAR_WIDTH;
+    if (textWrap && cursorX > width - textSize * DISPLAY_CHAR_WIDTH) {
+      cursorY += textSize * DISPLAY_CHAR_HEIGHT;
+      cursorX = 0;
+    }
+  }
+  return 1;
+}
+
+size_t display_print(const char str[]) {
+  size_t count = 0;
+  for (; str[count]; count++)
+    display_printChar(str[count]);
+  return count;
+}
+
+size_t display_printDecimalInt(int num) {
+  char text[DECIMAL_INT_CHARS];
+  snprintf(text, sizeof(text), "%d", num);
+  return display_print(text);
+}
+
+size_t display_println(const char str[]) {
+  return display_print(str) + display_printChar('\n');
+}
+
+size_t display_printlnChar(char c) {
+  return display_printChar(c) + display_printChar('\n');
+}
+
+size_t display_printlnDecimalInt(int num) {
+  return display_printDecimalInt(num) + display_printChar('\n');
+}
+
+// The driver's test routines return how long they took in microseconds; on
+// the host there is nothing to test.
+unsigned long display_testLines(uint16_t color) { return (void)color, 0; }
+unsigned long display_testFastLines(uint16_t color1, uint16_t color2) {
+  return (void)color1, (void)color2, 0;
+}
+unsigned long display_testRects(uint16_t color) { return (void)color, 0; }
+unsigned long display_testFilledRects(uint16_t color1, uint16_t color2) {
+  return (void)color1, (void)color2, 0;
+}
+unsigned long display_testFilledCircles(uint8_t radius, uint16_t color) {
+  return (void)radius, (void)color, 0;
+}
+unsigned long display_testCircles(uint8_t radius, uint16_t color) {
+  return (void)radius, (void)color, 0;
+}
+unsigned long display_testTriangles() { return 0; }
+unsigned long display_testFilledTriangles() { return 0; }
+unsigned long display_testRoundRects() { return 0; }
+unsigned long display_testFilledRoundRects() { return 0; }
+unsigned long display_testFillScreen() { return 0; }
+unsigned long display_testText() { return 0; }
+unsigned long display_test() { return 0; }
+
+// There is no touch panel.
+bool display_isTouched(void) { return false; }
+
+void display_getTouchedPoint(int16_t *x, int16_t *y, uint8_t *z) {
+  *x = *y = 0;
+  *z = 0;
+}
+
+void display_clearOldTouchData() {}
@@ -0,0 +1,39 @@
+#ifndef DISPLAYHOST_H_
+#define DISPLAYHOST_H_
+
+#include <stdint.h>
+
+#include "display.h"
+
+// Host-side stand-in for the TFT behind display.h. The drawing calls paint a
+// copy of the screen in memory and count the transfers the prebuilt driver
+// would make for them: one per fillRect, straight line or pixel, one per
+// pixel of other lines and of circle outlines, and one per pixel of text,
+// since the driver draws characters a dot at a time (a size-s dot is an s by
+// s fillRect). Each transfer sets the TFT's address window before writing
+// two bytes a pixel; the bus cost is estimated from that. There is no touch
+// panel, and the driver's test routines do nothing.
+
+// Column and page address commands with four parameter bytes each, and the
+// memory write command.
+#define DISPLAY_HOST_TRANSFER_OVERHEAD_BYTES 11
+#define DISPLAY_HOST_BYTES_PER_PIXEL 2
+
+typedef struct {
+  uint32_t transfers; // Address windows set.
+  uint32_t pixels;    // Pixels written.
+} displayHost_stats_t;
+
+// Sets every pixel to color and clears the statistics and the text settings.
+void displayHost_init(uint16_t color);
+
+// Returns the rows of the screen, display_width() pixels each.
+const display_pixel_t *displayHost_getPixels(void);
+
+// Returns the statistics since displayHost_init().
+const displayHost_stats_t *displayHost_getStats(void);
+
+// Bytes the transfers so far would have put on the bus.
+uint64_t displayHost_getBusBytes(void);
+
+#endif /* DISPLAYHOST_H_ */
@@ -0,0 +1,185 @@
+// Host version of the board's interrupts.c. A thread stands in for the ARM
+// private timer: once interrupts_initAll() has been called and the timer,
+// its interrupt and the ARM interrupts are all enabled, it calls
+// isr_function() at the timer rate, 100 kHz by default, paced against
+// CLOCK_MONOTONIC. The ISR runs with a lock held that
+// interrupts_disableArmInts() also takes, so once that returns the ISR is
+// not running and will not start until interrupts_enableArmInts(), as on the
+// board. Ticks while the ISR is disabled are lost rather than pended. If the
+// host falls behind, the ISR is called back to back to catch up, unless it is
+// more than INTERRUPTS_MAX_LATE_TICKS behind, when the ticks are dropped.
+//
+// Programs that link this without an ISR of their own get one that does
+// nothing. interrupts_getAdcData() reads the source set with
+// boardHost_setAdcSource().
+
+#include <pthread.h>
+#include <stdbool.h>
+#include <stdint.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <time.h>
+
+#include "boardHost.h"
+#include "interrupts.h"
+
+// As on the board: the private timer runs at half the 650 MHz CPU clock and a
+// load value of 3249 gives 100 kHz.
+#define ZYBO_BUS_CLOCK 325000000
+#define PRIVATE_TIMER_LOAD_VALUE_DEFAULT 3249
+#define INTERRUPTS_MAX_LATE_TICKS 10000
+#define NANOSECONDS_PER_SECOND 1000000000L
+
+volatile int interrupts_isrFlagGlobal = 0;
+
+static pthread_mutex_t interrupts_isrLock = PTHREAD_MUTEX_INITIALIZER;
+static pthread_cond_t interrupts_enabledCondition = PTHREAD_COND_INITIALIZER;
+static bool interrupts_initAllCompletedFlag = false;
+static bool interrupts_armIntsEnabled;
+static bool interrupts_timerIntsEnabled;
+static bool interrupts_timerRunning;
+static u32 interrupts_loadValue = PRIVATE_TIMER_LOAD_VALUE_DEFAULT;
+static volatile u32 interrupts_isrCount;
+static boardHost_adcSource_t interrupts_adcSource;
+
+// Programs with no ISR of their own get this one.
+__attribute__((weak)) void isr_function() {}
+
+// True if the ISR should run on the next tick. Call with the lock held.
+static bool interrupts_tickEnabled() {
+  return interrupts_armIntsEnabled && interrupts_timerIntsEnabled &&
+         interrupts_timerRunning;
+}
+
+static void interrupts_addNanoseconds(struct timespec *time, long ns) {
+  time->tv_nsec += ns;
+  while (time->tv_nsec >= NANOSECONDS_PER_SECOND) {
+    time->tv_nsec -= NANOSECONDS_PER_SECOND;
+    time->tv_sec++;
+  }
+}
+
+// Nanoseconds from a to b.
+static int64_t interrupts_elapsedNs(const struct timespec *a,
+                                    const struct timespec *b) {
+  return (int64_t)(b->tv_sec - a->tv_sec) * NANOSECONDS_PER_SECOND +
+         (b->tv_nsec - a->tv_nsec);
+}
+
+// The private timer.
+static void *interrupts_runTimer(void *unused) {
+  (void)unused;
+  struct timespec next, now;
+  pthread_mutex_lock(&interrupts_isrLock);
+  clock_gettime(CLOCK_MONOTONIC, &next);
+  while (true) {
+    while (!interrupts_tickEnabled()) {
+      pthread_cond_wait(&interrupts_enabledCondition, &interrupts_isrLock);
+      clock_gettime(CLOCK_MONOTONIC, &next);
+    }
+    long periodNs = NANOSECONDS_PER_SECOND /
+                    (long)interrupts_getPrivateTimerTicksPerSecond();
+    pthread_mutex_unlock(&interrupts_isrLock);
+
+    interrupts_addNanoseconds(&next, periodNs);
+    clock_gettime(CLOCK_MONOTONIC, &now);
+    if (interrupts_elapsedNs(&next, &now) >
+        (int64_t)INTERRUPTS_MAX_LATE_TICKS * periodNs)
+      next = now;
+    clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &next, NULL);
+
+    pthread_mutex_lock(&interrupts_isrLock);
+    if (interrupts_tickEnabled()) {
+      isr_function();
+      interrupts_isrCount++;
+      interrupts_isrFlagGlobal = 1;
+    }
+  }
+  return NULL;
+}
+
+// Sets value under the lock and wakes the timer if it can now tick.
+static void interrupts_set(bool *flag, bool value) {
+  pthread_mutex_lock(&interrupts_isrLock);
+  *flag = value;
+  if (interrupts_tickEnabled())
+    pthread_cond_signal(&interrupts_enabledCondition);
+  pthread_mutex_unlock(&interrupts_isrLock);
+}
+
+// Starts the timer thread, with everything disabled.
+int interrupts_initAll(bool printFailedStatusFlag) {
+  if (interrupts_initAllCompletedFlag) {
+    printf("interrupts_initAll() has already been invoked. Double invocation "
+           "is not allowed.\n");
+    exit(-1);
+  }
+  interrupts_initAllCompletedFlag = true;
+  pthread_t thread;
+  if (pthread_create(&thread, NULL, interrupts_runTimer, NULL) != 0) {
+    if (printFailedStatusFlag)
+      printf("Creating the timer thread failed.\n");
+    return 1;
+  }
+  pthread_detach(thread);
+  return 0;
+}
+
+// The tick rate follows the load value as on the board.
+void interrupts_setPrivateTimerLoadValue(u32 loadValue) {
+  pthread_mutex_lock(&interrupts_isrLock);
+  interrupts_loadValue = loadValue;
+  pthread_mutex_unlock(&interrupts_isrLock);
+}
+
+// Returns the number of private timer ticks that occur in 1 second.
+u32 interrupts_getPrivateTimerTicksPerSecond() {
+  return ZYBO_BUS_CLOCK / (interrupts_loadValue + 1);
+}
+
+int interrupts_enableArmInts() {
+  interrupts_set(&interrupts_armIntsEnabled, true);
+  return 0;
+}
+
+// Returns once the ISR is not running.
+int interrupts_disableArmInts() {
+  interrupts_set(&interrupts_armIntsEnabled, false);
+  return 0;
+}
+
+int interrupts_startArmPrivateTimer() {
+  interrupts_set(&interrupts_timerRunning, true);
+  return 0;
+}
+
+int interrupts_stopArmPrivateTimer() {
+  interrupts_set(&interrupts_timerRunning, false);
+  return 0;
+}
+
+void interrupts_enableTimerGlobalInts() {
+  interrupts_set(&interrupts_timerIntsEnabled, true);
+}
+
+void interrupts_disableTimerGlobalInts() {
+  interrupts_set(&interrupts_timerIntsEnabled, false);
+}
+
+// Keep track of total number of times interrupt_timerIsr is invoked.
+u32 interrupts_isrInvocationCount() { return interrupts_isrCount; }
+
+// The host ADC is unipolar, like the board's default.
+bool interrupts_getAdcInputMode() { return INTERRUPTS_ADC_DEFAULT_INPUT_MODE; }
+
+// Returns the next sample from the source set with boardHost_setAdcSource().
+uint32_t interrupts_getAdcData() {
+  boardHost_adcSource_t source = interrupts_adcSource;
+  return source ? source() : BOARD_HOST_ADC_MIDSCALE;
+}
+
+// Sets where interrupts_getAdcData() gets its samples; NULL for a constant
+// BOARD_HOST_ADC_MIDSCALE.
+void boardHost_setAdcSource(boardHost_adcSource_t source) {
+  interrupts_adcSource = source;
+}
@@ -0,0 +1,94 @@
+#include <stdbool.h>
+#include <stdint.h>
+#include <time.h>
+
+#include "intervalTimer.h"
+
+// The three timers in the fabric, here accumulating CLOCK_MONOTONIC time.
+#define INTERVAL_TIMER_COUNT 3
+#define NANOSECONDS_PER_SECOND 1e9
+#define TEST_SECONDS 0.001
+
+typedef struct {
+  bool running;
+  double startSeconds;
+  double totalSeconds;
+} intervalTimer_t;
+static intervalTimer_t intervalTimers[INTERVAL_TIMER_COUNT];
+
+static double monotonicSeconds(void) {
+  struct timespec now;
+  clock_gettime(CLOCK_MONOTONIC, &now);
+  return now.tv_sec + now.tv_nsec / NANOSECONDS_PER_SECOND;
+}
+
+intervalTimer_status_t intervalTimer_init(uint32_t timerNumber) {
+  if (timerNumber >= INTERVAL_TIMER_COUNT)
+    return INTERVAL_TIMER_STATUS_FAIL;
+  intervalTimer_reset(timerNumber);
+  return INTERVAL_TIMER_STATUS_OK;
+}
+
+intervalTimer_status_t intervalTimer_initAll() {
+  for (uint32_t i = 0; i < INTERVAL_TIMER_COUNT; i++)
+    intervalTimer_init(i);
+  return INTERVAL_TIMER_STATUS_OK;
+}
+
+void intervalTimer_start(uint32_t timerNumber) {
+  intervalTimer_t *timer = &intervalTimers[timerNumber];
+  if (timer->running)
+    return;
+  timer->startSeconds = monotonicSeconds();
+  timer->running = true;
+}
+
+void intervalTimer_stop(uint32_t timerNumber) {
+  intervalTimer_t *timer = &intervalTimers[timerNumber];
+  if (!timer->running)
+    return;
+  timer->totalSeconds += monotonicSeconds() - timer->startSeconds;
+  timer->running = false;
+}
+
+void intervalTimer_reset(uint32_t timerNumber) {
+  intervalTimers[timerNumber].running = false;
+  intervalTimers[timerNumber].totalSeconds = 0;
+}
+
+void intervalTimer_resetAll() {
+  for (uint32_t i = 0; i < INTERVAL_TIMER_COUNT; i++)
+    intervalTimer_reset(i);
+}
+
+// Like the hardware, a running timer reports the time so far.
+double intervalTimer_getTotalDurationInSeconds(uint32_t timerNumber) {
+  intervalTimer_t *timer = &intervalTimers[timerNumber];
+  if (timer->running)
+    return timer->totalSeconds + monotonicSeconds() - timer->startSeconds;
+  return timer->totalSeconds;
+}
+
+// Times a short busy wait and checks that the timer saw it and then held
+// still once stopped.
+intervalTimer_status_t intervalTimer_test(uint32_t timerNumber) {
+  if (intervalTimer_init(timerNumber) != INTERVAL_TIMER_STATUS_OK)
+    return INTERVAL_TIMER_STATUS_FAIL;
+  intervalTimer_start(timerNumber);
+  double start = monotonicSeconds();
+  while (monotonicSeconds() - start < TEST_SECONDS)
+    ;
+  intervalTimer_stop(timerNumber);
+  double total = intervalTimer_getTotalDurationInSeconds(timerNumber);
+  bool passed = total >= TEST_SECONDS &&
+                intervalTimer_getTotalDurationInSeconds(timerNumber) == total;
+  intervalTimer_reset(timerNumber);
+  return passed ? INTERVAL_TIMER_STATUS_OK : INTERVAL_TIMER_STATUS_FAIL;
+}
+
+intervalTimer_status_t intervalTimer_testAll() {
+  for (uint32_t i = 0; i < INTERVAL_TIMER_COUNT; i++)
+    if (intervalTimer_test(i) != INTERVAL_TIMER_STATUS_OK)
+      return INTERVAL_TIMER_STATUS_FAIL;
+  return INTERVAL_TIMER_STATUS_OK;
+}
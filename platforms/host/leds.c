@@ -0,0 +1,27 @@
+#include <stdbool.h>
+
+#include "boardHost.h"
+#include "leds.h"
+
+#define LEDS_MASK 0xF
+
+static volatile int leds, ld4;
+
+int leds_init(bool printFailedStatusFlag) {
+  (void)printFailedStatusFlag;
+  leds = ld4 = 0;
+  return 0;
+}
+
+void leds_write(int ledValue) { leds = ledValue & LEDS_MASK; }
+
+void leds_writeLd4(int ledValue) { ld4 = ledValue ? 1 : 0; }
+
+// Nobody is there to watch them blink.
+int leds_runTest() { return 0; }
+
+// Returns the value last written to LD3..LD0 with leds_write().
+int boardHost_getLeds(void) { return leds; }
+
+// Returns the value last written to LD4 with leds_writeLd4().
+int boardHost_getLd4(void) { return ld4; }
@@ -0,0 +1,42 @@
+#include <stdbool.h>
+#include <stdint.h>
+
+#include "mio.h"
+
+// The Zynq has 54 MIO pins; they read back what was last written.
+#define MIO_PIN_COUNT 54
+#define MIO_BANK0_PINS 16
+
+static volatile u8 pins[MIO_PIN_COUNT];
+
+int mio_init(bool printFailedStatusFlag) {
+  (void)printFailedStatusFlag;
+  for (u8 i = 0; i < MIO_PIN_COUNT; i++)
+    pins[i] = 0;
+  return 0;
+}
+
+u8 mio_readPin(u8 mioPinNumber) {
+  return mioPinNumber < MIO_PIN_COUNT ? pins[mioPinNumber] : 0;
+}
+
+void mio_writePin(u8 mioPinNumber, u8 value) {
+  if (mioPinNumber < MIO_PIN_COUNT)
+    pins[mioPinNumber] = value ? 1 : 0;
+}
+
+void mio_WriteBank0(u32 value) {
+  for (u8 i = 0; i < MIO_BANK0_PINS; i++)
+    pins[i] = (value >> i) & 1;
+}
+
+uint16_t mio_readBank0() {
+  uint16_t value = 0;
+  for (u8 i = 0; i < MIO_BANK0_PINS; i++)
+    value |= pins[i] << i;
+  return value;
+}
+
+void mio_setPinAsInput(u8 mioPinNo) { (void)mioPinNo; }
+
+void mio_setPinAsOutput(u8 mioPinNo) { (void)mioPinNo; }
@@ -0,0 +1,16 @@
+#include <stdint.h>
+
+#include "boardHost.h"
+#include "switches.h"
+
+static volatile int32_t switches;
+
+int32_t switches_init() { return SWITCHES_INIT_STATUS_OK; }
+
+int32_t switches_read() { return switches; }
+
+// Nobody is there to slide them.
+void switches_runTest() {}
+
+// Sets what switches_read() returns (SWITCHES_SW*_MASK bits).
+void boardHost_setSwitches(int32_t value) { switches = value; }
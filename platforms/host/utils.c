@@ -0,0 +1,21 @@
+#include <time.h>
+
+#include "utils.h"
+
+#define NANOSECONDS_PER_MS 1000000L
+#define MS_PER_SECOND 1000
+#define SLEEP_NS 10000 // A timer tick at 100 kHz.
+
+void utils_msDelay(long ms) {
+  struct timespec delay = {.tv_sec = ms / MS_PER_SECOND,
+                           .tv_nsec = (ms % MS_PER_SECOND) * NANOSECONDS_PER_MS};
+  while (nanosleep(&delay, &delay) != 0)
+    ;
+}
+
+// Gives up the processor for about a timer tick, so a loop waiting on the ISR
+// does not spin.
+void utils_sleep() {
+  struct timespec delay = {.tv_sec = 0, .tv_nsec = SLEEP_NS};
+  nanosleep(&delay, NULL);
+}
@@ -5,6 +5,7 @@ SET(CMAKE_CROSSCOMPILING 1)
 
 set(CMAKE_C_COMPILER "arm-none-eabi-gcc")
 set(CMAKE_CXX_COMPILER "arm-none-eabi-g++")
+set(CMAKE_ASM_COMPILER "arm-none-eabi-gcc")
 SET(CMAKE_SHARED_LIBRARY_LINK_CXX_FLAGS)
 SET(CMAKE_SHARED_LIBRARY_LINK_C_FLAGS)
 